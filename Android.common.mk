@@ -37,26 +37,38 @@ LOCAL_SRC_FILES := \
 	src/node_buffer.cc \
 	src/node_constants.cc \
 	src/node_crypto.cc \
+	src/node_crypto_bio.cc \
 	src/node_dtrace.cc \
 	src/node_extensions.cc \
 	src/node_file.cc \
+	src/node_file_cache.cc \
 	src/node_http_parser.cc \
 	src/node_io_watcher.cc \
 	src/node_javascript.cc \
+	src/node_json.cc \
+	src/node_log.cc \
 	src/node_main.cc \
+	src/node_numeric.cc \
 	src/node_os.cc \
+	src/node_profiler.cc \
 	src/node_script.cc \
+	src/node_shm_cache.cc \
 	src/node_signal_watcher.cc \
 	src/node_stat_watcher.cc \
 	src/node_string.cc \
+	src/node_util.cc \
+	src/node_websocket.cc \
 	src/node_zlib.cc \
 	src/cares_wrap.cc \
+	src/channel_wrap.cc \
 	src/fs_event_wrap.cc \
 	src/handle_wrap.cc \
 	src/pipe_wrap.cc \
 	src/process_wrap.cc \
+	src/shm_ring_wrap.cc \
 	src/stream_wrap.cc \
 	src/tcp_wrap.cc \
+	src/timer_wheel.cc \
 	src/timer_wrap.cc \
 	src/tty_wrap.cc \
 	src/udp_wrap.cc \
@@ -19,8 +19,10 @@ NODE_LOCAL_JS_LIBRARY_FILES := \
 	lib/https.js \
 	lib/module.js \
 	lib/net.js \
+	lib/numeric.js \
 	lib/os.js \
 	lib/path.js \
+	lib/profiler.js \
 	lib/punycode.js \
 	lib/querystring.js \
 	lib/readline.js \
@@ -34,6 +36,7 @@ NODE_LOCAL_JS_LIBRARY_FILES := \
 	lib/url.js \
 	lib/util.js \
 	lib/vm.js \
+	lib/websocket.js \
 	lib/zlib.js \
 	src/macros.py
 
@@ -0,0 +1,28 @@
+// Small copy() and fill() calls, as done when writing frame headers.
+// Usage: node benchmark/buffer_small_copy.js [bytes]
+var size = +process.argv[2] || 16;
+var n = 1e6;
+
+var src = new Buffer(size);
+var dst = new Buffer(size * 2);
+src.fill(1);
+
+function bench(name, fn) {
+  var start = Date.now();
+  for (var i = 0; i < n; i++) fn();
+  var ms = Date.now() - start;
+  console.log('%s %d bytes: %d ms, %d ops/s', name, size, ms,
+              Math.round(n / ms * 1000));
+}
+
+bench('copy', function() {
+  src.copy(dst, size >> 1, 0, size);
+});
+
+bench('fill', function() {
+  dst.fill(0, 0, size);
+});
+
+bench('native copy', function() {
+  src.parent.copy(dst.parent, dst.offset, src.offset, src.offset + size);
+});
@@ -0,0 +1,19 @@
+var common = require('../common.js');
+
+var bench = common.createBenchmark(main, {
+  len: [8, 128, 4096, 65536],
+  n: [64]
+});
+
+function main(conf) {
+  var source = new Buffer(conf.len);
+  var target = new Buffer(conf.len);
+  source.fill(1);
+  var n = conf.n * 1024 * 1024 / conf.len;
+
+  bench.start();
+  for (var i = 0; i < n; i++) {
+    source.copy(target, 0);
+  }
+  bench.end(n);
+}
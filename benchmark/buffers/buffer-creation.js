@@ -0,0 +1,20 @@
+var common = require('../common.js');
+var SlowBuffer = require('buffer').SlowBuffer;
+
+var bench = common.createBenchmark(main, {
+  type: ['fast', 'slow'],
+  len: [10, 1024, 8192, 65536],
+  n: [1024]
+});
+
+function main(conf) {
+  var len = conf.len;
+  var n = conf.n * 1024;
+  var clazz = conf.type === 'fast' ? Buffer : SlowBuffer;
+
+  bench.start();
+  for (var i = 0; i < n; i++) {
+    new clazz(len);
+  }
+  bench.end(n);
+}
@@ -0,0 +1,19 @@
+var common = require('../common.js');
+
+var bench = common.createBenchmark(main, {
+  encoding: ['ascii', 'utf8', 'ucs2', 'binary', 'hex', 'base64'],
+  len: [16, 1024, 65536],
+  n: [64]
+});
+
+function main(conf) {
+  var buf = new Buffer(conf.len);
+  buf.fill(0x61);
+  var n = conf.n * 1024 * 1024 / conf.len;
+
+  bench.start();
+  for (var i = 0; i < n; i++) {
+    buf.toString(conf.encoding);
+  }
+  bench.end(n);
+}
@@ -0,0 +1,20 @@
+var common = require('../common.js');
+
+var bench = common.createBenchmark(main, {
+  encoding: ['ascii', 'utf8', 'ucs2', 'hex'],
+  len: [16, 1024, 65536],
+  n: [64]
+});
+
+function main(conf) {
+  var str = new Array(conf.len + 1).join(conf.encoding === 'hex' ? 'ab' : 'a');
+  var buf = new Buffer(Buffer.byteLength(str, conf.encoding));
+  // About the same number of bytes whatever the length.
+  var n = conf.n * 1024 * 1024 / conf.len;
+
+  bench.start();
+  for (var i = 0; i < n; i++) {
+    buf.write(str, 0, conf.encoding);
+  }
+  bench.end(n);
+}
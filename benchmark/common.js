@@ -0,0 +1,365 @@
+// Harness for the benchmarks in the category directories, and the pieces
+// run.js and compare.js share.
+//
+// A benchmark is a script that hands its main function and the values of
+// its parameters to createBenchmark(), and brackets the measured work with
+// bench.start() and bench.end():
+//
+//   var common = require('../common.js');
+//   var bench = common.createBenchmark(main, {
+//     len: [16, 1024],
+//     n: [1e6]
+//   });
+//
+//   function main(conf) {
+//     bench.start();
+//     for (var i = 0; i < conf.n; i++) ...;
+//     bench.end(conf.n);
+//   }
+//
+// bench.end() takes the number of operations done and reports them per
+// second, along with an optional object of other figures to show; it ends
+// the process, so every measurement gets a fresh one.
+// Running a benchmark by hand runs each combination of its parameters once.
+// The runners pass a single combination as name=value arguments instead and
+// read the result back as JSON.
+
+var path = require('path');
+var fs = require('fs');
+var spawn = require('child_process').spawn;
+
+// Port for the benchmarks that listen, NODE_BENCH_PORT to override.
+exports.PORT = +process.env.NODE_BENCH_PORT || 12346;
+
+exports.categories = [
+  'buffers',
+  'http_parser',
+  'net',
+  'fs',
+  'zlib',
+  'crypto',
+  'timers',
+  'events',
+  'startup'
+];
+
+
+exports.createBenchmark = function(main, configs) {
+  return new Benchmark(main, configs);
+};
+
+
+function Benchmark(main, configs) {
+  this.name = path.relative(__dirname, process.argv[1]);
+  this.configs = configs;
+  this.config = null;
+  this._start = 0;
+
+  var self = this;
+  var args = process.argv.slice(2);
+
+  // Let the parameters be set up before main() runs.
+  process.nextTick(function() {
+    if (process.env.NODE_BENCH_LIST) {
+      console.log(JSON.stringify(self.combinations()));
+      return;
+    }
+
+    if (args.length > 0) {
+      self.config = self.parseArgs(args);
+      main(self.config);
+    } else {
+      self.runAll();
+    }
+  });
+}
+
+
+// Every combination of parameter values, as a list of objects.
+Benchmark.prototype.combinations = function() {
+  var result = [{}];
+
+  Object.keys(this.configs).forEach(function(name) {
+    var next = [];
+    this.configs[name].forEach(function(value) {
+      result.forEach(function(partial) {
+        var config = {};
+        for (var k in partial) config[k] = partial[k];
+        config[name] = value;
+        next.push(config);
+      });
+    });
+    result = next;
+  }, this);
+
+  return result;
+};
+
+
+// Parameters missing from the arguments take their first value.
+Benchmark.prototype.parseArgs = function(args) {
+  var config = {};
+
+  for (var name in this.configs) {
+    config[name] = this.configs[name][0];
+  }
+
+  args.forEach(function(arg) {
+    var match = arg.match(/^([^=]+)=(.*)$/);
+    if (!match || !(match[1] in this.configs)) {
+      throw new Error('Unknown benchmark parameter: ' + arg);
+    }
+    var value = match[2];
+    config[match[1]] = /^-?\d+(\.\d+)?(e\d+)?$/.test(value) ? +value : value;
+  }, this);
+
+  return config;
+};
+
+
+Benchmark.prototype.runAll = function() {
+  var self = this;
+  var queue = this.combinations();
+
+  (function next() {
+    var config = queue.shift();
+    if (!config) return;
+
+    exports.runOnce(process.execPath, self.name, config, function(err, res) {
+      if (err) throw err;
+      var line = exports.format(self.name, config) + ': ' +
+                 res.rate.toFixed(2);
+      for (var k in res.extra) line += ' ' + k + '=' + res.extra[k];
+      console.log(line);
+      next();
+    });
+  })();
+};
+
+
+Benchmark.prototype.start = function() {
+  this._start = Date.now();
+};
+
+
+Benchmark.prototype.end = function(operations, extra) {
+  var elapsed = (Date.now() - this._start) / 1000;
+  // Anything measured in under a millisecond is meaningless anyway.
+  var rate = operations / Math.max(elapsed, 0.001);
+
+  console.log(JSON.stringify({
+    name: this.name,
+    config: this.config,
+    rate: rate,
+    time: elapsed,
+    extra: extra || {}
+  }));
+  process.exit(0);
+};
+
+
+exports.format = function(name, config) {
+  var parts = [name];
+  for (var k in config) parts.push(k + '=' + config[k]);
+  return parts.join(' ');
+};
+
+
+// Lists the benchmark scripts of the given categories or files, relative
+// to this directory. Files may also be given relative to the working
+// directory.
+exports.find = function(names) {
+  var files = [];
+
+  if (names.length === 0) names = exports.categories;
+
+  names.forEach(function(name) {
+    if (/\.js$/.test(name)) {
+      var full = path.resolve(name);
+      try {
+        fs.statSync(full);
+      } catch (e) {
+        full = path.resolve(__dirname, name);
+      }
+      files.push(path.relative(__dirname, full));
+      return;
+    }
+    fs.readdirSync(path.resolve(__dirname, name)).sort().forEach(function(f) {
+      if (/\.js$/.test(f)) files.push(path.join(name, f));
+    });
+  });
+
+  return files;
+};
+
+
+function runScript(node, name, args, env, callback) {
+  var childEnv = {};
+  for (var k in process.env) childEnv[k] = process.env[k];
+  for (var k in env) childEnv[k] = env[k];
+
+  var child = spawn(node, [path.join(__dirname, name)].concat(args),
+                    { env: childEnv });
+  var out = '';
+  var err = '';
+
+  child.stdout.setEncoding('utf8');
+  child.stdout.on('data', function(d) { out += d; });
+  child.stderr.setEncoding('utf8');
+  child.stderr.on('data', function(d) { err += d; });
+
+  child.on('exit', function(code) {
+    var lines = out.trim().split('\n');
+    var result;
+
+    try {
+      result = JSON.parse(lines[lines.length - 1]);
+    } catch (e) {
+      result = null;
+    }
+
+    if (code !== 0 || result === null) {
+      callback(new Error(name + ' ' + args.join(' ') + ' failed with code ' +
+                         code + '\n' + err));
+      return;
+    }
+    callback(null, result);
+  });
+}
+
+
+exports.listCombinations = function(node, name, callback) {
+  runScript(node, name, [], { NODE_BENCH_LIST: '1' }, callback);
+};
+
+
+exports.runOnce = function(node, name, config, callback) {
+  var args = [];
+  for (var k in config) args.push(k + '=' + config[k]);
+  runScript(node, name, args, {}, callback);
+};
+
+
+// Statistics
+
+exports.mean = function(samples) {
+  var sum = 0;
+  for (var i = 0; i < samples.length; i++) sum += samples[i];
+  return sum / samples.length;
+};
+
+
+exports.variance = function(samples) {
+  var n = samples.length;
+  if (n < 2) return 0;
+
+  var mean = exports.mean(samples);
+  var sum = 0;
+  for (var i = 0; i < n; i++) {
+    sum += (samples[i] - mean) * (samples[i] - mean);
+  }
+  return sum / (n - 1);
+};
+
+
+// Two-sided 97.5% quantiles of Student's t distribution for 1 to 30
+// degrees of freedom; beyond that the normal one is close enough.
+var T_975 = [
+  12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+];
+
+
+// Half-width of the 95% confidence interval of the mean, relative to it.
+exports.confidence = function(samples) {
+  var n = samples.length;
+  if (n < 2) return Infinity;
+
+  var t = n - 1 <= T_975.length ? T_975[n - 2] : 1.96;
+  var mean = exports.mean(samples);
+  return t * Math.sqrt(exports.variance(samples) / n) / mean;
+};
+
+
+function logGamma(x) {
+  // Lanczos approximation, g = 7.
+  var c = [
+    0.99999999999980993, 676.5203681218851, -1259.1392167224028,
+    771.32342877765313, -176.61502916214059, 12.507343278686905,
+    -0.13857109526572012, 9.9843695780195716e-6, 1.5056327351493116e-7
+  ];
+  x -= 1;
+  var a = c[0];
+  var t = x + 7.5;
+  for (var i = 1; i < 9; i++) a += c[i] / (x + i);
+  return 0.5 * Math.log(2 * Math.PI) + (x + 0.5) * Math.log(t) - t +
+         Math.log(a);
+}
+
+
+// Continued fraction for the regularized incomplete beta function.
+function betaFraction(x, a, b) {
+  var qab = a + b;
+  var qap = a + 1;
+  var qam = a - 1;
+  var c = 1;
+  var d = 1 - qab * x / qap;
+  if (Math.abs(d) < 1e-30) d = 1e-30;
+  d = 1 / d;
+  var h = d;
+
+  for (var m = 1; m <= 200; m++) {
+    var m2 = 2 * m;
+    var aa = m * (b - m) * x / ((qam + m2) * (a + m2));
+    d = 1 + aa * d;
+    if (Math.abs(d) < 1e-30) d = 1e-30;
+    c = 1 + aa / c;
+    if (Math.abs(c) < 1e-30) c = 1e-30;
+    d = 1 / d;
+    h *= d * c;
+
+    aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2));
+    d = 1 + aa * d;
+    if (Math.abs(d) < 1e-30) d = 1e-30;
+    c = 1 + aa / c;
+    if (Math.abs(c) < 1e-30) c = 1e-30;
+    d = 1 / d;
+    var delta = d * c;
+    h *= delta;
+    if (Math.abs(delta - 1) < 3e-12) break;
+  }
+
+  return h;
+}
+
+
+function incompleteBeta(x, a, b) {
+  if (x <= 0) return 0;
+  if (x >= 1) return 1;
+
+  var front = Math.exp(logGamma(a + b) - logGamma(a) - logGamma(b) +
+                       a * Math.log(x) + b * Math.log(1 - x));
+  if (x < (a + 1) / (a + b + 2)) {
+    return front * betaFraction(x, a, b) / a;
+  }
+  return 1 - front * betaFraction(1 - x, b, a) / b;
+}
+
+
+// Welch's t-test of two samples: the two-sided p-value of the hypothesis
+// that they have the same mean.
+exports.ttest = function(a, b) {
+  var va = exports.variance(a) / a.length;
+  var vb = exports.variance(b) / b.length;
+
+  if (va + vb === 0) {
+    return exports.mean(a) === exports.mean(b) ? 1 : 0;
+  }
+
+  var t = (exports.mean(b) - exports.mean(a)) / Math.sqrt(va + vb);
+  var df = (va + vb) * (va + vb) /
+           (va * va / (a.length - 1) + vb * vb / (b.length - 1));
+
+  return incompleteBeta(df / (df + t * t), df / 2, 0.5);
+};
@@ -0,0 +1,127 @@
+// Compares two node builds on the benchmark suite.
+//
+//   node benchmark/compare.js --old=PATH --new=PATH [options] [category ...]
+//   node benchmark/compare.js old.json new.json
+//
+// The first form runs both binaries on every configuration, alternating
+// between them so that changes in machine load hit both alike. The second
+// compares two files written by run.js --json. Either way every
+// configuration gets the change in its mean rate and the p-value of
+// Welch's t-test; stars mark changes that are unlikely to be noise.
+
+var fs = require('fs');
+var common = require('./common.js');
+var run = require('./run.js');
+
+var usage =
+    'usage: node benchmark/compare.js --old=PATH --new=PATH [options] ' +
+    '[category|file ...]\n' +
+    '       node benchmark/compare.js old.json new.json\n' +
+    'Takes the options of run.js besides --node; --json writes both sets ' +
+    'of samples.\n';
+
+
+function stars(p) {
+  if (p < 0.001) return '***';
+  if (p < 0.01) return '**';
+  if (p < 0.05) return '*';
+  return '';
+}
+
+
+function compare(name, config, before, after) {
+  var oldMean = common.mean(before);
+  var newMean = common.mean(after);
+  var change = (newMean - oldMean) / oldMean * 100;
+  var p = common.ttest(before, after);
+
+  console.log(common.format(name, config) + ': ' +
+              (change >= 0 ? '+' : '') + change.toFixed(2) + '% ' +
+              stars(p) + ' (p=' + p.toFixed(4) + ', ' +
+              oldMean.toFixed(2) + ' -> ' + newMean.toFixed(2) + ')');
+
+  return {
+    name: name,
+    config: config,
+    old: before,
+    new: after,
+    change: change,
+    p: p
+  };
+}
+
+
+function compareFiles(oldFile, newFile) {
+  var before = JSON.parse(fs.readFileSync(oldFile, 'utf8')).results;
+  var after = JSON.parse(fs.readFileSync(newFile, 'utf8')).results;
+  var index = {};
+
+  before.forEach(function(r) {
+    index[common.format(r.name, r.config)] = r;
+  });
+
+  after.forEach(function(r) {
+    var old = index[common.format(r.name, r.config)];
+    if (old) compare(r.name, r.config, old.samples, r.samples);
+  });
+}
+
+
+function compareBuilds(options) {
+  var nodes = [options.old, options.new];
+  var results = [];
+
+  // Configurations come from the new build; benchmarks it added are
+  // skipped if the old one cannot run them.
+  run.plan(options.new, options, function(err, plan) {
+    if (err) throw err;
+
+    (function next() {
+      var entry = plan.shift();
+      if (!entry) return finish();
+
+      run.measure(nodes, entry, options, function(err, samples) {
+        if (err) {
+          console.error(common.format(entry.name, entry.config) +
+                        ': skipped, ' + err.message.split('\n')[0]);
+          return next();
+        }
+        results.push(compare(entry.name, entry.config,
+                             samples[0], samples[1]));
+        next();
+      });
+    })();
+  });
+
+  function finish() {
+    if (!options.json) return;
+
+    var report = {
+      old: options.old,
+      new: options.new,
+      date: new Date().toISOString(),
+      results: results
+    };
+    fs.writeFileSync(options.json, JSON.stringify(report, null, 2) + '\n');
+  }
+}
+
+
+var args = process.argv.slice(2);
+
+if (args.length === 2 && /\.json$/.test(args[0]) && /\.json$/.test(args[1])) {
+  compareFiles(args[0], args[1]);
+} else {
+  var options = run.parseOptions(args, function(name, value, options) {
+    if (name !== 'old' && name !== 'new') return false;
+    options[name] = value;
+    return true;
+  });
+
+  if (!options || !options.old || !options.new) {
+    process.stderr.write(usage);
+    process.exit(1);
+  }
+
+  compareBuilds(options);
+}
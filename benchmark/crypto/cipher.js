@@ -0,0 +1,24 @@
+// Encrypts a buffer in one update() per call. Reports megabytes per second.
+var common = require('../common.js');
+var crypto = require('crypto');
+
+var bench = common.createBenchmark(main, {
+  cipher: ['aes-128-cbc', 'aes-256-cbc', 'rc4'],
+  len: [1024, 65536],
+  n: [256]
+});
+
+function main(conf) {
+  var data = new Buffer(conf.len);
+  data.fill('x');
+  var n = conf.n * 1024 * 1024 / conf.len;
+  var bytes = 0;
+
+  bench.start();
+  for (var i = 0; i < n; i++) {
+    var cipher = crypto.createCipher(conf.cipher, 'a password');
+    bytes += cipher.update(data, 'binary', 'binary').length;
+    bytes += cipher.final('binary').length;
+  }
+  bench.end(bytes / (1024 * 1024));
+}
@@ -0,0 +1,20 @@
+var common = require('../common.js');
+var crypto = require('crypto');
+
+var bench = common.createBenchmark(main, {
+  algo: ['md5', 'sha1', 'sha256'],
+  len: [64, 65536],
+  n: [256]
+});
+
+function main(conf) {
+  var data = new Buffer(conf.len);
+  data.fill('x');
+  var n = conf.n * 1024 * 1024 / conf.len / 4;
+
+  bench.start();
+  for (var i = 0; i < n; i++) {
+    crypto.createHash(conf.algo).update(data).digest('hex');
+  }
+  bench.end(n);
+}
@@ -0,0 +1,38 @@
+// EventEmitter#emit() with `listeners` listeners and `args` arguments.
+var common = require('../common.js');
+var EventEmitter = require('events').EventEmitter;
+
+var bench = common.createBenchmark(main, {
+  listeners: [1, 2, 10],
+  args: [0, 2, 5],
+  n: [2e6]
+});
+
+function main(conf) {
+  var n = conf.n;
+  var ee = new EventEmitter();
+  ee.setMaxListeners(0);
+
+  var calls = 0;
+  for (var i = 0; i < conf.listeners; i++) {
+    ee.on('dummy', function() { calls++; });
+  }
+
+  var i;
+  switch (conf.args) {
+    case 0:
+      bench.start();
+      for (i = 0; i < n; i++) ee.emit('dummy');
+      break;
+    case 2:
+      bench.start();
+      for (i = 0; i < n; i++) ee.emit('dummy', 5, true);
+      break;
+    default:
+      bench.start();
+      for (i = 0; i < n; i++) ee.emit('dummy', 5, true, 7, 'x', null);
+  }
+  bench.end(n);
+
+  if (calls !== n * conf.listeners) throw new Error('missed listener calls');
+}
@@ -0,0 +1,36 @@
+// fs.readFile() of one file with `c` reads in flight at any time.
+var common = require('../common.js');
+var fs = require('fs');
+var path = require('path');
+
+var filename = path.join(__dirname, '.readfile-' + process.pid);
+
+var bench = common.createBenchmark(main, {
+  len: [1024, 1024 * 1024],
+  c: [1, 16],
+  n: [2000]
+});
+
+function main(conf) {
+  var data = new Buffer(conf.len);
+  data.fill('x');
+  fs.writeFileSync(filename, data);
+  process.on('exit', function() {
+    try { fs.unlinkSync(filename); } catch (e) {}
+  });
+
+  var started = 0;
+  var finished = 0;
+
+  function read() {
+    started++;
+    fs.readFile(filename, function(err, d) {
+      if (err) throw err;
+      if (++finished === conf.n) return bench.end(conf.n);
+      if (started < conf.n) read();
+    });
+  }
+
+  bench.start();
+  for (var i = 0; i < conf.c; i++) read();
+}
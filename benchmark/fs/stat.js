@@ -0,0 +1,26 @@
+// fs.stat() with `c` calls in flight at any time, which is mostly a
+// measure of the thread pool round trip.
+var common = require('../common.js');
+var fs = require('fs');
+
+var bench = common.createBenchmark(main, {
+  c: [1, 64],
+  n: [50000]
+});
+
+function main(conf) {
+  var started = 0;
+  var finished = 0;
+
+  function stat() {
+    started++;
+    fs.stat(__filename, function(err) {
+      if (err) throw err;
+      if (++finished === conf.n) return bench.end(conf.n);
+      if (started < conf.n) stat();
+    });
+  }
+
+  bench.start();
+  for (var i = 0; i < conf.c; i++) stat();
+}
@@ -0,0 +1,44 @@
+// Parses the same message over and over with the parser binding http.js
+// uses, with no sockets involved.
+var common = require('../common.js');
+var HTTPParser = process.binding('http_parser').HTTPParser;
+
+var bench = common.createBenchmark(main, {
+  type: ['request', 'response'],
+  headers: [4, 32],
+  body: [0, 4096],
+  n: [1e5]
+});
+
+function message(conf) {
+  var lines = conf.type === 'request' ?
+      ['GET /some/path/to/a/resource?with=query HTTP/1.1'] :
+      ['HTTP/1.1 200 OK'];
+
+  for (var i = 0; i < conf.headers; i++) {
+    lines.push('X-Header-' + i + ': some value ' + i);
+  }
+  lines.push('Content-Length: ' + conf.body);
+
+  return new Buffer(lines.join('\r\n') + '\r\n\r\n' +
+                    new Array(conf.body + 1).join('x'));
+}
+
+function main(conf) {
+  var buf = message(conf);
+  var type = conf.type === 'request' ? HTTPParser.REQUEST : HTTPParser.RESPONSE;
+  var parser = new HTTPParser(type);
+  var completed = 0;
+
+  parser.onHeaders = function() {};
+  parser.onHeadersComplete = function() {};
+  parser.onBody = function() {};
+  parser.onMessageComplete = function() { completed++; };
+
+  bench.start();
+  for (var i = 0; i < conf.n; i++) {
+    parser.reinitialize(type);
+    parser.execute(buf, 0, buf.length);
+  }
+  bench.end(completed);
+}
@@ -0,0 +1,43 @@
+// Keep-alive GET requests to a local server from `c` concurrent clients.
+var common = require('../common.js');
+var http = require('http');
+
+var PORT = common.PORT;
+
+var bench = common.createBenchmark(main, {
+  len: [4, 16384],
+  c: [1, 50],
+  n: [10000]
+});
+
+function main(conf) {
+  var body = new Buffer(conf.len);
+  body.fill('x');
+
+  var server = http.createServer(function(req, res) {
+    res.writeHead(200, { 'Content-Length': body.length });
+    res.end(body);
+  });
+
+  server.listen(PORT, function() {
+    var agent = new http.Agent();
+    agent.maxSockets = conf.c;
+
+    var started = 0;
+    var finished = 0;
+
+    function request() {
+      started++;
+      http.get({ port: PORT, path: '/', agent: agent }, function(res) {
+        res.on('data', function() {});
+        res.on('end', function() {
+          if (++finished === conf.n) return bench.end(conf.n);
+          if (started < conf.n) request();
+        });
+      });
+    }
+
+    bench.start();
+    for (var i = 0; i < conf.c; i++) request();
+  });
+}
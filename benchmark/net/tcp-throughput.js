@@ -0,0 +1,39 @@
+// Streams a buffer over a loopback TCP connection as fast as the client
+// takes it, for `dur` seconds. Reports gigabits per second.
+var common = require('../common.js');
+var net = require('net');
+
+var PORT = common.PORT;
+
+var bench = common.createBenchmark(main, {
+  len: [1024, 65536, 1024 * 1024],
+  dur: [5]
+});
+
+function main(conf) {
+  var chunk = new Buffer(conf.len);
+  chunk.fill('x');
+
+  var server = net.createServer(function(socket) {
+    (function write() {
+      while (socket.write(chunk));
+      socket.once('drain', write);
+    })();
+  });
+
+  server.listen(PORT, function() {
+    var received = 0;
+    var client = net.connect(PORT);
+
+    client.on('data', function(d) {
+      received += d.length;
+    });
+
+    client.once('connect', function() {
+      bench.start();
+      setTimeout(function() {
+        bench.end(received * 8 / 1e9);
+      }, conf.dur * 1000);
+    });
+  });
+}
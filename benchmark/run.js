@@ -1,31 +1,199 @@
-var path = require("path");
-var util = require("util");
-var childProcess = require("child_process");
-var benchmarks = [ "timers.js"
-                 , "process_loop.js"
-                 , "static_http_server.js"
-                 ];
-
-var benchmarkDir = path.dirname(__filename);
-
-function exec (script, callback) {
-  var start = new Date();
-  var child = childProcess.spawn(process.argv[0], [path.join(benchmarkDir, script)]);
-  child.addListener("exit", function (code) {
-    var elapsed = new Date() - start;
-    callback(elapsed, code);
-  });
-}
+// Runs the benchmark suite, repeating every configuration until its mean
+// is known precisely enough.
+//
+//   node benchmark/run.js [options] [category|file ...]
+//
+// See README.md for the options.
+
+var fs = require('fs');
+var common = require('./common.js');
+
+var usage =
+    'usage: node benchmark/run.js [options] [category|file ...]\n' +
+    '  --runs=N          runs per configuration at least, default 5\n' +
+    '  --max-runs=N      runs per configuration at most, default 30\n' +
+    '  --precision=P     stop once the 95% confidence interval of the mean\n' +
+    '                    is within P of it, default 0.02\n' +
+    '  --filter=RE       only run benchmarks whose name matches RE\n' +
+    '  --set=name=value  run with this parameter value only\n' +
+    '  --node=PATH       node binary to benchmark, default this one\n' +
+    '  --json=FILE       write the samples to FILE\n';
+
 
-function runNext (i) {
-  if (i >= benchmarks.length) return;
-  util.print(benchmarks[i] + ": ");
-  exec(benchmarks[i], function (elapsed, code) {
-    if (code != 0) {
-      console.log("ERROR  ");
+// Parses the options shared with compare.js. Returns null on bad usage.
+exports.parseOptions = function(argv, extra) {
+  var options = {
+    runs: 5,
+    maxRuns: 30,
+    precision: 0.02,
+    filter: null,
+    set: {},
+    node: process.execPath,
+    json: null,
+    names: []
+  };
+
+  for (var i = 0; i < argv.length; i++) {
+    var arg = argv[i];
+    var match = arg.match(/^--([a-z-]+)(?:=(.*))?$/);
+
+    if (!match) {
+      options.names.push(arg);
+      continue;
     }
-    console.log(elapsed);
-    runNext(i+1);
+
+    var value = match[2];
+    switch (match[1]) {
+      case 'runs':
+        options.runs = Math.max(2, parseInt(value, 10));
+        break;
+      case 'max-runs':
+        options.maxRuns = parseInt(value, 10);
+        break;
+      case 'precision':
+        options.precision = parseFloat(value);
+        break;
+      case 'filter':
+        options.filter = new RegExp(value);
+        break;
+      case 'set':
+        var kv = (value || '').match(/^([^=]+)=(.*)$/);
+        if (!kv) return null;
+        options.set[kv[1]] = kv[2];
+        break;
+      case 'node':
+        options.node = value;
+        break;
+      case 'json':
+        options.json = value;
+        break;
+      default:
+        if (extra && extra(match[1], value, options)) break;
+        return null;
+    }
+  }
+
+  if (options.maxRuns < options.runs) options.maxRuns = options.runs;
+  return options;
+};
+
+
+// Calls back with the configurations to run of every selected benchmark,
+// as a list of { name, config } in order.
+exports.plan = function(node, options, callback) {
+  var files = common.find(options.names).filter(function(name) {
+    return !options.filter || options.filter.test(name);
   });
+  var plan = [];
+
+  (function next() {
+    var name = files.shift();
+    if (!name) return callback(null, plan);
+
+    common.listCombinations(node, name, function(err, configs) {
+      if (err) return callback(err);
+
+      var seen = {};
+      configs.forEach(function(config) {
+        for (var k in options.set) {
+          if (k in config) config[k] = options.set[k];
+        }
+        // --set can make combinations collapse into one.
+        var key = JSON.stringify(config);
+        if (seen[key]) return;
+        seen[key] = true;
+        plan.push({ name: name, config: config });
+      });
+      next();
+    });
+  })();
 };
-runNext(0);
+
+
+// Runs each of `nodes` on one configuration in turn, round after round,
+// until each has its minimum runs and a precise enough mean or has reached
+// its maximum. Calls back with a list of samples per binary.
+exports.measure = function(nodes, entry, options, callback) {
+  var samples = nodes.map(function() { return []; });
+
+  function done(i) {
+    var n = samples[i].length;
+    if (n < options.runs) return false;
+    if (n >= options.maxRuns) return true;
+    return common.confidence(samples[i]) <= options.precision;
+  }
+
+  (function round() {
+    var pending = [];
+    for (var i = 0; i < nodes.length; i++) {
+      if (!done(i)) pending.push(i);
+    }
+    if (pending.length === 0) return callback(null, samples);
+
+    (function next() {
+      var i = pending.shift();
+      if (i === undefined) return round();
+
+      common.runOnce(nodes[i], entry.name, entry.config, function(err, res) {
+        if (err) return callback(err);
+        samples[i].push(res.rate);
+        next();
+      });
+    })();
+  })();
+};
+
+
+function main() {
+  var options = exports.parseOptions(process.argv.slice(2));
+  if (!options) {
+    process.stderr.write(usage);
+    process.exit(1);
+  }
+
+  var results = [];
+
+  exports.plan(options.node, options, function(err, plan) {
+    if (err) throw err;
+
+    (function next() {
+      var entry = plan.shift();
+      if (!entry) return finish();
+
+      exports.measure([options.node], entry, options, function(err, s) {
+        if (err) throw err;
+
+        var samples = s[0];
+        var mean = common.mean(samples);
+        var ci = common.confidence(samples);
+
+        console.log(common.format(entry.name, entry.config) + ': ' +
+                    mean.toFixed(2) + ' ±' + (ci * 100).toFixed(2) +
+                    '% (' + samples.length + ' runs)');
+
+        results.push({
+          name: entry.name,
+          config: entry.config,
+          mean: mean,
+          confidence: ci,
+          samples: samples
+        });
+        next();
+      });
+    })();
+  });
+
+  function finish() {
+    if (!options.json) return;
+
+    var report = {
+      node: options.node,
+      date: new Date().toISOString(),
+      results: results
+    };
+    fs.writeFileSync(options.json, JSON.stringify(report, null, 2) + '\n');
+  }
+}
+
+
+if (module === require.main) main();
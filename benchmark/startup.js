@@ -1,10 +1,15 @@
 var spawn = require('child_process').spawn,
+    fs = require('fs'),
     path = require('path'),
     emptyJsFile = path.join(__dirname, '../test/fixtures/semicolon.js'),
     starts = 100,
     i = 0,
     start;
 
+// Size of the module tree that the resolution benchmark loads.
+var packages = 50,
+    filesPerPackage = 20;
+
 function startNode() {
   var node = spawn(process.execPath || process.argv[0], [emptyJsFile]);
   node.on('exit', function(exitCode) {
@@ -18,9 +23,67 @@ function startNode() {
     } else{
       var duration = +new Date - start;
       console.log('Started node %d times in %s ms. %d ms / start.', starts, duration, duration / starts);
+      resolve();
     }
   });
 }
 
-start = +new Date;
-startNode();
+// Writes `packages` packages of `filesPerPackage` files each into `dir`.
+// Every file requires the next one without an extension, and the first
+// file of every package requires the next package by name, so that the
+// lookups go through node_modules directories and extensions the way an
+// application's do.
+function writeModuleTree(dir) {
+  function mkdir(p) {
+    try { fs.mkdirSync(p, 0777); } catch (e) {}
+  }
+  mkdir(dir);
+  mkdir(path.join(dir, 'node_modules'));
+  for (var p = 0; p < packages; p++) {
+    var pkg = path.join(dir, 'node_modules', 'pkg' + p);
+    mkdir(pkg);
+    for (var f = 0; f < filesPerPackage; f++) {
+      var body = '';
+      if (f + 1 < filesPerPackage) body += 'require("./file' + (f + 1) + '");\n';
+      if (f == 0 && p + 1 < packages) body += 'require("pkg' + (p + 1) + '");\n';
+      fs.writeFileSync(path.join(pkg, f == 0 ? 'index.js' : 'file' + f + '.js'),
+                       body);
+    }
+  }
+  fs.writeFileSync(path.join(dir, 'main.js'), 'require("pkg0");\n');
+}
+
+// Loads the module tree in a fresh process, which reports the time spent in
+// require() and how many of the stat() calls it made went to the disk.
+function resolve() {
+  var dir = path.join(__dirname, '../test/tmp/startup-modules');
+  writeModuleTree(dir);
+
+  var child = spawn(process.execPath || process.argv[0],
+                    [__filename, 'resolve-child', path.join(dir, 'main.js')]);
+  child.stdout.pipe(process.stdout);
+  child.stderr.pipe(process.stderr);
+}
+
+function resolveChild(main) {
+  var stats = 0;
+  var statSync = fs.statSync;
+  fs.statSync = function() {
+    stats++;
+    return statSync.apply(this, arguments);
+  };
+
+  var start = Date.now();
+  require(main);
+  var duration = Date.now() - start;
+
+  console.log('Loaded %d modules in %d ms with %d stat() calls.',
+              packages * filesPerPackage, duration, stats);
+}
+
+if (process.argv[2] == 'resolve-child') {
+  resolveChild(process.argv[3]);
+} else {
+  start = +new Date;
+  startNode();
+}
@@ -0,0 +1,287 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Starts node instances on threads of their own, one after the other, and
+// keeps them all running until the last has started. For every instance it
+// reports the time from Isolate::New() to its first line of JavaScript, how
+// much the resident set of the process grew, and how long Stop() and the
+// teardown that follows take.
+//
+//   node_bench_isolates [-n count] [-p] [-e script] [-j] [node options]
+//
+// -p takes the instances from an IsolatePool filled beforehand, so that
+// only resuming a prepared instance is timed. -e runs script in each
+// instance before it counts as started. -j prints JSON instead of a table.
+
+#include <node.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+# include <mach/mach.h>
+# include <mach/mach_time.h>
+#endif
+
+namespace {
+
+struct Instance {
+  node::Isolate* isolate;
+  pthread_t thread;
+  uv_thread_shared_t shared;
+  char* args[4];
+  double start_ms;
+  double teardown_ms;
+  size_t rss_delta;
+};
+
+
+uint64_t Now() {
+#ifdef __APPLE__
+  static mach_timebase_info_data_t info;
+  if (info.denom == 0) mach_timebase_info(&info);
+  return mach_absolute_time() * info.numer / info.denom;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+
+double Millis(uint64_t nsecs) {
+  return static_cast<double>(nsecs) / 1e6;
+}
+
+
+size_t ResidentSetSize() {
+#ifdef __APPLE__
+  struct task_basic_info info;
+  mach_msg_type_number_t count = TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), TASK_BASIC_INFO,
+                reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+    return 0;
+  }
+  return info.resident_size;
+#else
+  unsigned long size, resident;
+  FILE* f = fopen("/proc/self/statm", "r");
+  if (f == NULL) return 0;
+  int r = fscanf(f, "%lu %lu", &size, &resident);
+  fclose(f);
+  return r == 2 ? resident * sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+
+// Runs an instance to completion and tears it down on its own thread, the
+// way process_wrap.cc does for child_process.fork().
+void* InstanceMain(void* arg) {
+  Instance* instance = static_cast<Instance*>(arg);
+  instance->isolate->Start(&instance->shared);
+  instance->isolate->Dispose();
+  delete instance->isolate;
+  instance->isolate = NULL;
+  return NULL;
+}
+
+
+void Usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [-n count] [-p] [-e script] [-j] [node options]\n",
+          name);
+  exit(1);
+}
+
+
+void Summarize(const char* label, double* values, int count, double scale) {
+  double total = 0, min = values[0], max = values[0];
+  for (int i = 0; i < count; i++) {
+    total += values[i];
+    if (values[i] < min) min = values[i];
+    if (values[i] > max) max = values[i];
+  }
+  printf("%-16s mean %10.2f  min %10.2f  max %10.2f\n",
+         label, total / count / scale, min / scale, max / scale);
+}
+
+}  // namespace
+
+
+int main(int argc, char* argv[]) {
+  int count = 8;
+  bool use_pool = false;
+  bool json = false;
+  const char* script = "";
+
+  // What is left over goes to node::Initialize().
+  char** node_argv = new char*[argc + 1];
+  int node_argc = 0;
+  node_argv[node_argc++] = argv[0];
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      count = atoi(argv[++i]);
+      if (count <= 0) Usage(argv[0]);
+    } else if (strcmp(argv[i], "-p") == 0) {
+      use_pool = true;
+    } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      script = argv[++i];
+    } else if (strcmp(argv[i], "-j") == 0) {
+      json = true;
+    } else if (strcmp(argv[i], "-h") == 0) {
+      Usage(argv[0]);
+    } else {
+      node_argv[node_argc++] = argv[i];
+    }
+  }
+  node_argv[node_argc] = NULL;
+
+  if (node::Initialize(node_argc, node_argv) != 0) return 1;
+
+  // Every instance writes a byte to the pipe once its script has run, then
+  // stays up until it is stopped.
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    return 1;
+  }
+
+  size_t code_size = strlen(script) + 128;
+  char* code = new char[code_size];
+  snprintf(code, code_size,
+           "%s;require('fs').writeSync(%d, '.');setInterval(function(){},1e9)",
+           script, fds[1]);
+
+  node::IsolatePool* pool = NULL;
+  uint64_t fill_time = 0;
+  if (use_pool) {
+    char* pool_argv[] = { argv[0], NULL };
+    pool = new node::IsolatePool(1, pool_argv);
+    uint64_t start = Now();
+    pool->Fill(count);
+    fill_time = Now() - start;
+  }
+
+  Instance* instances = new Instance[count];
+  size_t rss_before = ResidentSetSize();
+  size_t rss_last = rss_before;
+
+  for (int i = 0; i < count; i++) {
+    Instance* instance = &instances[i];
+    memset(&instance->shared, 0, sizeof(instance->shared));
+    instance->args[0] = argv[0];
+    instance->args[1] = const_cast<char*>("-e");
+    instance->args[2] = code;
+    instance->args[3] = NULL;
+    instance->shared.args = instance->args;
+    instance->shared.stdin_fd = -1;
+    instance->shared.stdout_fd = -1;
+    instance->shared.stderr_fd = -1;
+
+    uint64_t start = Now();
+    instance->isolate = pool ? pool->Take() : node::Isolate::New();
+    if (pthread_create(&instance->thread, NULL, InstanceMain, instance) != 0) {
+      perror("pthread_create");
+      return 1;
+    }
+
+    char c;
+    ssize_t r;
+    do {
+      r = read(fds[0], &c, 1);
+    } while (r == -1 && errno == EINTR);
+    if (r != 1) {
+      fprintf(stderr, "instance %d did not start\n", i);
+      return 1;
+    }
+    instance->start_ms = Millis(Now() - start);
+
+    size_t rss = ResidentSetSize();
+    instance->rss_delta = rss > rss_last ? rss - rss_last : 0;
+    rss_last = rss;
+  }
+
+  size_t rss_all = ResidentSetSize();
+
+  for (int i = 0; i < count; i++) {
+    Instance* instance = &instances[i];
+    uint64_t start = Now();
+    instance->isolate->Stop(0);
+    pthread_join(instance->thread, NULL);
+    instance->teardown_ms = Millis(Now() - start);
+  }
+
+  double* values = new double[count];
+
+  if (json) {
+    printf("{\"count\":%d,\"pooled\":%s,\"poolFillMs\":%.3f,"
+           "\"rssBefore\":%lu,\"rssAll\":%lu,\"instances\":[",
+           count, pool ? "true" : "false", Millis(fill_time),
+           static_cast<unsigned long>(rss_before),
+           static_cast<unsigned long>(rss_all));
+    for (int i = 0; i < count; i++) {
+      printf("%s{\"startMs\":%.3f,\"rssDelta\":%lu,\"teardownMs\":%.3f}",
+             i ? "," : "", instances[i].start_ms,
+             static_cast<unsigned long>(instances[i].rss_delta),
+             instances[i].teardown_ms);
+    }
+    printf("]}\n");
+  } else {
+    printf("%5s %14s %14s %14s\n",
+           "#", "first JS (ms)", "RSS delta (KB)", "teardown (ms)");
+    for (int i = 0; i < count; i++) {
+      printf("%5d %14.2f %14lu %14.2f\n", i, instances[i].start_ms,
+             static_cast<unsigned long>(instances[i].rss_delta / 1024),
+             instances[i].teardown_ms);
+    }
+    printf("\n");
+
+    for (int i = 0; i < count; i++) values[i] = instances[i].start_ms;
+    Summarize("first JS (ms)", values, count, 1);
+    for (int i = 0; i < count; i++) values[i] = instances[i].rss_delta;
+    Summarize("RSS delta (KB)", values, count, 1024);
+    for (int i = 0; i < count; i++) values[i] = instances[i].teardown_ms;
+    Summarize("teardown (ms)", values, count, 1);
+
+    printf("\n%d instances: RSS %lu KB -> %lu KB",
+           count, static_cast<unsigned long>(rss_before / 1024),
+           static_cast<unsigned long>(rss_all / 1024));
+    if (pool) printf(", pool filled in %.2f ms", Millis(fill_time));
+    printf("\n");
+  }
+
+  delete[] values;
+  delete[] instances;
+  delete pool;
+  delete[] code;
+  close(fds[0]);
+  close(fds[1]);
+  node::Dispose();
+
+  return 0;
+}
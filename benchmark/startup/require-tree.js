@@ -0,0 +1,84 @@
+// Loads a tree of packages nested `depth` node_modules folders deep, each
+// of `files` files that also require a package at the top of the tree, the
+// way npm lays out dependencies. Reports modules loaded per second and the
+// file system calls made, which the first require() of a tree is made of.
+var common = require('../common.js');
+var fs = require('fs');
+var path = require('path');
+
+var bench = common.createBenchmark(main, {
+  depth: [4, 16],
+  files: [8]
+});
+
+var tmpDir = process.env.TMPDIR || process.env.TEMP || '/tmp';
+
+function mkdir(dir) {
+  try {
+    fs.mkdirSync(dir, '0755');
+  } catch (e) {
+    if (e.code !== 'EEXIST') throw e;
+  }
+}
+
+// Writes the tree unless it is there already, and returns its main file.
+function build(depth, files) {
+  var root = path.join(tmpDir, 'node-bench-require-tree-' + depth + '-' + files);
+  var main = path.join(root, 'main.js');
+  if (path.existsSync(main)) return main;
+
+  mkdir(root);
+  mkdir(path.join(root, 'node_modules'));
+  mkdir(path.join(root, 'node_modules', 'shared'));
+  fs.writeFileSync(path.join(root, 'node_modules', 'shared', 'index.js'),
+                   'module.exports = 0;\n');
+
+  var dir = root;
+  for (var level = 0; level < depth; level++) {
+    dir = path.join(dir, 'node_modules', 'pkg' + level);
+    mkdir(path.dirname(dir));
+    mkdir(dir);
+    mkdir(path.join(dir, 'lib'));
+    fs.writeFileSync(path.join(dir, 'package.json'),
+                     JSON.stringify({ name: 'pkg' + level,
+                                      main: './lib/main' }));
+
+    var source = '';
+    for (var i = 0; i < files; i++) {
+      source += 'require("./f' + i + '");\n';
+      fs.writeFileSync(path.join(dir, 'lib', 'f' + i + '.js'),
+                       'module.exports = require("shared") + ' + i + ';\n');
+    }
+    if (level + 1 < depth) source += 'require("pkg' + (level + 1) + '");\n';
+    fs.writeFileSync(path.join(dir, 'lib', 'main.js'), source);
+  }
+
+  fs.writeFileSync(main, 'require("pkg0");\n');
+  return main;
+}
+
+// Counts calls into the fs binding, each of which is a system call or two.
+function countCalls() {
+  var binding = process.binding('fs');
+  var counter = { calls: 0 };
+  ['stat', 'lstat', 'open', 'readFile', 'readlink', 'read'].forEach(
+    function(name) {
+      var fn = binding[name];
+      if (typeof fn !== 'function') return;
+      binding[name] = function() {
+        counter.calls++;
+        return fn.apply(this, arguments);
+      };
+    });
+  return counter;
+}
+
+function main(conf) {
+  var file = build(conf.depth, conf.files);
+  var modules = conf.depth * (conf.files + 1) + 2;
+  var counter = countCalls();
+
+  bench.start();
+  require(file);
+  bench.end(modules, { syscalls: counter.calls });
+}
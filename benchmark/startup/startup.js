@@ -0,0 +1,32 @@
+// Starts node one process after another. `script` is what the new process
+// runs: nothing, or the loading of a few core modules.
+var common = require('../common.js');
+var spawn = require('child_process').spawn;
+
+var scripts = {
+  empty: '',
+  http: 'require("http")',
+  modules: 'require("http"); require("crypto"); require("zlib");' +
+           'require("child_process"); require("repl")'
+};
+
+var bench = common.createBenchmark(main, {
+  script: ['empty', 'http', 'modules'],
+  n: [30]
+});
+
+function main(conf) {
+  var left = conf.n;
+
+  function start() {
+    var child = spawn(process.execPath, ['-e', scripts[conf.script]]);
+    child.on('exit', function(code) {
+      if (code !== 0) throw new Error('node exited with code ' + code);
+      if (--left === 0) return bench.end(conf.n);
+      start();
+    });
+  }
+
+  bench.start();
+  start();
+}
@@ -0,0 +1,19 @@
+// A chain of process.nextTick() callbacks, `depth` at a time.
+var common = require('../common.js');
+
+var bench = common.createBenchmark(main, {
+  depth: [1, 64],
+  n: [1e6]
+});
+
+function main(conf) {
+  var count = 0;
+
+  function tick() {
+    if (++count === conf.n) return bench.end(conf.n);
+    if (count + conf.depth <= conf.n) process.nextTick(tick);
+  }
+
+  bench.start();
+  for (var i = 0; i < conf.depth; i++) process.nextTick(tick);
+}
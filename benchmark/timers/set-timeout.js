@@ -0,0 +1,21 @@
+// Schedules `n` timers at once and waits for all of them. Several lists
+// of timers are in use when the timeouts differ.
+var common = require('../common.js');
+
+var bench = common.createBenchmark(main, {
+  timeouts: [1, 16],
+  n: [100000]
+});
+
+function main(conf) {
+  var fired = 0;
+
+  function onTimeout() {
+    if (++fired === conf.n) bench.end(conf.n);
+  }
+
+  bench.start();
+  for (var i = 0; i < conf.n; i++) {
+    setTimeout(onTimeout, 1 + i % conf.timeouts);
+  }
+}
@@ -0,0 +1,43 @@
+// Sends 256MB over a local TLS connection and reports the throughput. Both
+// ends run in this process, so it mostly measures the cost of the TLS pump.
+var tls = require('tls');
+var fs = require('fs');
+var path = require('path');
+
+var keys = path.join(__dirname, '../test/fixtures/keys');
+var options = {
+  key: fs.readFileSync(path.join(keys, 'agent1-key.pem')),
+  cert: fs.readFileSync(path.join(keys, 'agent1-cert.pem'))
+};
+
+var total = 256 * 1024 * 1024;
+var chunk = new Buffer(64 * 1024);
+chunk.fill(0x61);
+
+var server = tls.createServer(options, function(socket) {
+  var sent = 0;
+  function write() {
+    while (sent < total) {
+      sent += chunk.length;
+      if (!socket.write(chunk)) return socket.once('drain', write);
+    }
+    socket.end();
+  }
+  write();
+});
+
+server.listen(8000, function() {
+  var received = 0;
+  var start = Date.now();
+  var client = tls.connect(8000, function() {
+    start = Date.now();
+  });
+  client.on('data', function(d) {
+    received += d.length;
+  });
+  client.on('end', function() {
+    var sec = (Date.now() - start) / 1000;
+    console.log((received / (1024 * 1024) / sec).toFixed(1) + ' MB/sec');
+    server.close();
+  });
+});
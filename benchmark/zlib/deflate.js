@@ -0,0 +1,54 @@
+// Compresses and decompresses a buffer of mixed text with the synchronous
+// zlib calls, so that only zlib and its binding are measured.
+var common = require('../common.js');
+var zlib = require('zlib');
+
+var bench = common.createBenchmark(main, {
+  method: ['deflate', 'inflate', 'gzip', 'gunzip'],
+  len: [1024, 1024 * 1024],
+  n: [64]
+});
+
+function input(len) {
+  var words = ['node', 'event', 'loop', 'buffer', 'stream', 'socket',
+               'callback', 'isolate', 'thread', 'request', 'response'];
+  var parts = [];
+  var size = 0;
+  for (var i = 0; size < len; i++) {
+    var word = words[(i * 7 + (i >> 3)) % words.length] + ' ' + i + ' ';
+    parts.push(word);
+    size += word.length;
+  }
+  return new Buffer(parts.join('').slice(0, len));
+}
+
+function main(conf) {
+  var data = input(conf.len);
+  var fn;
+
+  switch (conf.method) {
+    case 'deflate':
+      fn = zlib.deflateSync;
+      break;
+    case 'inflate':
+      data = zlib.deflateSync(data);
+      fn = zlib.inflateSync;
+      break;
+    case 'gzip':
+      fn = zlib.gzipSync;
+      break;
+    case 'gunzip':
+      data = zlib.gzipSync(data);
+      fn = zlib.gunzipSync;
+      break;
+  }
+
+  // About the same amount of input whatever the length.
+  var n = Math.max(1, conf.n * 1024 * 1024 / conf.len / 16);
+
+  bench.start();
+  for (var i = 0; i < n; i++) {
+    fn(data);
+  }
+  bench.end(n);
+}
@@ -24,6 +24,11 @@
 #include <http_parser.h>
 #include <assert.h>
 #include <stddef.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
 
 
 #ifndef MIN
@@ -330,6 +335,90 @@ enum header_states
 #define start_state (parser->type == HTTP_REQUEST ? s_start_req : s_start_res)
 
 
+/* Runs of bytes that the state machine accepts one at a time without doing
+ * anything else, the rest of a header value or of the path, query string or
+ * fragment of a URL, are skipped in blocks. Both functions return the first
+ * byte in [p, end) that ends the run, or end.
+ */
+#define HAS_ZERO_BYTE(v)                                                       \
+  (((v) - 0x0101010101010101ULL) & ~(v) & 0x8080808080808080ULL)
+
+static const char *
+find_crlf (const char *p, const char *end)
+{
+#if defined(__SSE2__)
+  const __m128i cr = _mm_set1_epi8(CR);
+  const __m128i lf = _mm_set1_epi8(LF);
+
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr),
+                                              _mm_cmpeq_epi8(v, lf)));
+    if (mask != 0) return p + __builtin_ctz(mask);
+    p += 16;
+  }
+#else
+  while (end - p >= 8) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    if (HAS_ZERO_BYTE(v ^ 0x0d0d0d0d0d0d0d0dULL) ||
+        HAS_ZERO_BYTE(v ^ 0x0a0a0a0a0a0a0a0aULL)) {
+      break;
+    }
+    p += 8;
+  }
+#endif
+
+  while (p != end && *p != CR && *p != LF) p++;
+  return p;
+}
+
+static const char *
+find_non_url_char (const char *p, const char *end)
+{
+#if defined(__SSE2__)
+  /* The bytes normal_url_char[] rejects: up to ' ', '#', '?' and DEL. */
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i hash = _mm_set1_epi8('#');
+  const __m128i question = _mm_set1_epi8('?');
+  const __m128i del = _mm_set1_epi8(127);
+
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    __m128i stop = _mm_cmpeq_epi8(_mm_min_epu8(v, space), v);
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, hash));
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, question));
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, del));
+    int mask = _mm_movemask_epi8(stop);
+#if HTTP_PARSER_STRICT
+    /* Nor any byte above 0x7f. */
+    mask |= _mm_movemask_epi8(v);
+#endif
+    if (mask != 0) return p + __builtin_ctz(mask);
+    p += 16;
+  }
+#endif
+
+  while (p != end && IS_URL_CHAR(*p)) p++;
+  return p;
+}
+
+/* Moves p to the last byte before find() stops, counting the bytes skipped
+ * as header bytes. The run ends early where the header would grow too big,
+ * so that the error is raised at the same byte as without the skip.
+ */
+#define SKIP_RUN(find)                                                         \
+do {                                                                           \
+  const char *run_end = pe, *stop;                                             \
+  if ((uint64_t) (pe - p - 1) > HTTP_MAX_HEADER_SIZE - nread) {                \
+    run_end = p + 1 + (HTTP_MAX_HEADER_SIZE - nread);                          \
+  }                                                                            \
+  stop = find(p + 1, run_end);                                                 \
+  nread += stop - (p + 1);                                                     \
+  p = stop - 1;                                                                \
+} while (0)
+
+
 #if HTTP_PARSER_STRICT
 # define STRICT_CHECK(cond)                                          \
 do {                                                                 \
@@ -844,7 +933,10 @@ size_t http_parser_execute (http_parser *parser,
 
       case s_req_path:
       {
-        if (IS_URL_CHAR(ch)) break;
+        if (IS_URL_CHAR(ch)) {
+          SKIP_RUN(find_non_url_char);
+          break;
+        }
 
         switch (ch) {
           case ' ':
@@ -914,7 +1006,10 @@ size_t http_parser_execute (http_parser *parser,
 
       case s_req_query_string:
       {
-        if (IS_URL_CHAR(ch)) break;
+        if (IS_URL_CHAR(ch)) {
+          SKIP_RUN(find_non_url_char);
+          break;
+        }
 
         switch (ch) {
           case '?':
@@ -984,7 +1079,10 @@ size_t http_parser_execute (http_parser *parser,
 
       case s_req_fragment:
       {
-        if (IS_URL_CHAR(ch)) break;
+        if (IS_URL_CHAR(ch)) {
+          SKIP_RUN(find_non_url_char);
+          break;
+        }
 
         switch (ch) {
           case ' ':
@@ -1397,6 +1495,11 @@ size_t http_parser_execute (http_parser *parser,
           goto header_almost_done;
         }
 
+        if (header_state == h_general) {
+          SKIP_RUN(find_crlf);
+          break;
+        }
+
         c = LOWER(ch);
 
         switch (header_state) {
@@ -1560,6 +1560,32 @@ test_header_overflow_error (int req)
   exit(1);
 }
 
+/* A single value too long for HTTP_MAX_HEADER_SIZE in one buffer, so that
+ * the fast path through header values has to stop at the limit.
+ */
+void
+test_header_overflow_long_value (int req)
+{
+  http_parser parser;
+  http_parser_init(&parser, req ? HTTP_REQUEST : HTTP_RESPONSE);
+  size_t parsed;
+  const char *start = req ? "GET / HTTP/1.1\r\nX: " : "HTTP/1.0 200 OK\r\nX: ";
+  size_t len = HTTP_MAX_HEADER_SIZE + 1000;
+  char *buf = malloc(len);
+  memset(buf, 'a', len);
+  memcpy(buf, start, strlen(start));
+
+  parsed = http_parser_execute(&parser, &settings_null, buf, len);
+  free(buf);
+
+  if (parsed != HTTP_MAX_HEADER_SIZE ||
+      HTTP_PARSER_ERRNO(&parser) != HPE_HEADER_OVERFLOW) {
+    fprintf(stderr, "\n*** header overflow at %u, expected %u ***\n",
+            (unsigned int)parsed, (unsigned int)HTTP_MAX_HEADER_SIZE);
+    exit(1);
+  }
+}
+
 void
 test_no_overflow_long_body (int req, size_t length)
 {
@@ -1815,10 +1841,12 @@ main (void)
   //// OVERFLOW CONDITIONS
 
   test_header_overflow_error(HTTP_REQUEST);
+  test_header_overflow_long_value(HTTP_REQUEST);
   test_no_overflow_long_body(HTTP_REQUEST, 1000);
   test_no_overflow_long_body(HTTP_REQUEST, 100000);
 
   test_header_overflow_error(HTTP_RESPONSE);
+  test_header_overflow_long_value(HTTP_RESPONSE);
   test_no_overflow_long_body(HTTP_RESPONSE, 1000);
   test_no_overflow_long_body(HTTP_RESPONSE, 100000);
 
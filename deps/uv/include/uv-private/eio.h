@@ -223,10 +223,20 @@ typedef struct {
   int size;
 } etp_reqq;
   
-typedef struct {
+typedef struct eio_channel eio_channel;
+
+struct eio_channel {
   etp_reqq res_queue; /* queue of outstanding responses for this channel */
   void *data;         /* use this for what you want */
-} eio_channel;
+  unsigned int max_poll_reqs; /* overrides eio_set_max_poll_reqs if non-zero */
+  int pri;            /* priority the owner submits its requests with */
+  unsigned long nfinished; /* requests finished by eio_poll so far */
+  unsigned int max_running; /* most pool threads its requests may occupy, 0 for no limit */
+  /* private after this point */
+  etp_reqq req_queue; /* requests waiting for a thread */
+  unsigned int running; /* requests being executed */
+  eio_channel *next_ready; /* next channel with waiting requests */
+};
 
 /* eio request structure */
 /* this structure is mostly read-only */
@@ -289,6 +299,10 @@ int eio_init (void (*want_poll)(eio_channel *), void (*done_poll)(eio_channel *)
   
 /* initialises a channel */
 void eio_channel_init(eio_channel *, void *data);
+/* limit the number of threads the channel's requests may occupy, 0 for no limit */
+void eio_channel_set_max_running(eio_channel *, unsigned int nthreads);
+unsigned int eio_channel_nready (eio_channel *); /* requests of this channel waiting for or on a thread */
+unsigned int eio_channel_npending (eio_channel *); /* requests of this channel finished but not yet polled */
 
 /* must be called regularly to handle pending requests */
 /* returns 0 if all requests were handled, -1 if not, or the value of EIO_FINISH if != 0 */
@@ -641,6 +641,8 @@ void ev_once (EV_P_ int fd, int events, ev_tstamp timeout, void (*cb)(int revent
 # if EV_FEATURE_API
 unsigned int ev_iteration (EV_P); /* number of loop iterations */
 unsigned int ev_depth     (EV_P); /* #ev_loop enters - #ev_loop leaves */
+unsigned int ev_spurious_polls (EV_P); /* polls idle watchers kept from blocking that found nothing */
+ev_tstamp    ev_next_timer (EV_P); /* time until the earliest timer is due, negative if there is none */
 void         ev_verify    (EV_P); /* abort if loop data corrupted */
 
 void ev_set_io_collect_interval (EV_P_ ev_tstamp interval); /* sleep at least this time, default 0 */
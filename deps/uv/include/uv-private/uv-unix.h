@@ -52,7 +52,17 @@ typedef pthread_rwlock_t uv_rwlock_t;
 typedef void* uv_lib_t;
 #define UV_DYNAMIC /* empty */
 
+/* The loop's own epoll set, watched by libev as one fd. See src/unix/linux.c */
+#if defined(__linux__)
+# define UV_LOOP_PRIVATE_PLATFORM_FIELDS \
+  ev_io epoll_watcher; \
+  int epoll_fd;
+#else
+# define UV_LOOP_PRIVATE_PLATFORM_FIELDS
+#endif
+
 #define UV_LOOP_PRIVATE_FIELDS \
+  UV_LOOP_PRIVATE_PLATFORM_FIELDS \
   ares_channel channel; \
   /* \
    * While the channel is active this timer is called once per second to be \
@@ -60,7 +70,10 @@ typedef void* uv_lib_t;
    * definition of ares_timeout(). \
    */ \
   ev_timer timer; \
-  struct ev_loop* ev;
+  struct ev_loop* ev; \
+  /* finished uv_queue_work() requests waiting for work_batch_cb */ \
+  ngx_queue_t work_done_queue; \
+  uv_work_batch_cb work_batch_cb;
 
 #define UV_REQ_BUFSML_SIZE (4)
 
@@ -85,6 +98,8 @@ typedef void* uv_lib_t;
   socklen_t addrlen;                \
   uv_buf_t* bufs;                   \
   int bufcnt;                       \
+  int batch;                        \
+  int nsent;                        \
   ssize_t status;                   \
   uv_udp_send_cb send_cb;           \
   uv_buf_t bufsml[UV_REQ_BUFSML_SIZE];  \
@@ -120,6 +135,9 @@ typedef void* uv_lib_t;
 #define UV_UDP_PRIVATE_FIELDS         \
   uv_alloc_cb alloc_cb;               \
   uv_udp_recv_cb recv_cb;             \
+  uv_udp_recv_batch_cb recv_batch_cb; \
+  unsigned int recv_batch_count;      \
+  size_t recv_batch_slot;             \
   ev_io read_watcher;                 \
   ev_io write_watcher;                \
   ngx_queue_t write_queue;            \
@@ -188,7 +206,8 @@ typedef void* uv_lib_t;
   eio_req* eio;
 
 #define UV_WORK_PRIVATE_FIELDS \
-  eio_req* eio;
+  eio_req* eio; \
+  ngx_queue_t done_queue;
 
 #define UV_TTY_PRIVATE_FIELDS \
   struct termios orig_termios; \
@@ -200,6 +219,9 @@ typedef void* uv_lib_t;
 #define UV_FS_EVENT_PRIVATE_FIELDS \
   ev_io read_watcher; \
   uv_fs_event_cb cb; \
+  /* Recursive watchers: the directory of each watch descriptor. */ \
+  char** watch_paths; \
+  int watch_paths_len; \
 
 #elif (defined(__MAC_OS_X_VERSION_MIN_REQUIRED) && __MAC_OS_X_VERSION_MIN_REQUIRED >= 1060) \
   || defined(__FreeBSD__) \
@@ -258,6 +258,10 @@ RB_HEAD(uv_timer_tree_s, uv_timer_s);
 
 #define uv_tcp_server_fields              \
   uv_tcp_accept_t* accept_reqs;           \
+  unsigned int accept_reqs_used;          \
+  unsigned int accept_reqs_max;           \
+  unsigned int accepts_in_tick;           \
+  int64_t accepts_tick;                   \
   unsigned int processed_accepts;         \
   uv_tcp_accept_t* pending_accepts;       \
   LPFN_ACCEPTEX func_acceptex;
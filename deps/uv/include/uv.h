@@ -230,6 +230,16 @@ UV_EXTERN int uv_run (uv_loop_t*);
 UV_EXTERN void uv_ref(uv_loop_t*);
 UV_EXTERN void uv_unref(uv_loop_t*);
 
+/*
+ * Stop a single handle from keeping its loop alive, or make it do so again.
+ * Unlike uv_unref() this follows the handle: it doesn't matter whether it is
+ * active, the loop exits once only unref'd handles are left. Both are no-ops
+ * if the handle already is in the requested state; closing a handle undoes
+ * uv_handle_unref().
+ */
+UV_EXTERN void uv_handle_ref(uv_handle_t*);
+UV_EXTERN void uv_handle_unref(uv_handle_t*);
+
 UV_EXTERN void uv_update_time(uv_loop_t*);
 UV_EXTERN int64_t uv_now(uv_loop_t*);
 
@@ -249,6 +259,10 @@ typedef void (*uv_read_cb)(uv_stream_t* stream, ssize_t nread, uv_buf_t buf);
  * Just like the uv_read_cb except that if the pending parameter is true
  * then you can use uv_accept() to pull the new handle into the process.
  * If no handle is pending then pending will be UV_UNKNOWN_HANDLE.
+ *
+ * On unix pending is UV_TCP, UV_NAMED_PIPE or UV_UDP, and the client passed
+ * to uv_accept() must be a handle of that type, initialized but not yet
+ * bound. Windows only passes UV_TCP.
  */
 typedef void (*uv_read2_cb)(uv_pipe_t* pipe, ssize_t nread, uv_buf_t buf,
     uv_handle_type pending);
@@ -309,6 +323,7 @@ UV_EXTERN const char* uv_err_name(uv_err_t err);
   /* public */ \
   void* data; \
   /* private */ \
+  uint64_t start_time_; /* for the latency counters */ \
   UV_REQ_PRIVATE_FIELDS
 
 /* Abstract base class of all requests. */
@@ -418,6 +433,17 @@ UV_EXTERN int uv_listen(uv_stream_t* stream, int backlog, uv_connection_cb cb);
  */
 UV_EXTERN int uv_accept(uv_stream_t* server, uv_stream_t* client);
 
+/*
+ * Checks for another pending connection from within a uv_connection_cb,
+ * after the connection it was called for has been accepted. Returns 1 if
+ * there is one, uv_accept() will then complete successfully. Returns 0 if
+ * there is none, or the platform can't tell, and -1 on error.
+ *
+ * This lets a server take on a burst of connections at once instead of
+ * getting a uv_connection_cb for each of them.
+ */
+UV_EXTERN int uv_accept_next(uv_stream_t* server);
+
 /*
  * Read data from an incoming stream. The callback will be made several
  * several times until there is no more data to read or uv_read_stop is
@@ -465,6 +491,16 @@ UV_EXTERN int uv_write(uv_write_t* req, uv_stream_t* handle,
 UV_EXTERN int uv_write2(uv_write_t* req, uv_stream_t* handle, uv_buf_t bufs[],
     int bufcnt, uv_stream_t* send_handle, uv_write_cb cb);
 
+/*
+ * Same as uv_write(), but won't queue a write request if the data can't be
+ * written immediately. Only writes when the write queue is empty.
+ *
+ * Returns the number of bytes written, which is 0 if nothing could be
+ * written right now, or -1 on error. Platforms that can't try a write
+ * always return 0.
+ */
+UV_EXTERN int uv_try_write(uv_stream_t* handle, uv_buf_t bufs[], int bufcnt);
+
 /* uv_write_t is a subclass of uv_req_t */
 struct uv_write_s {
   UV_REQ_FIELDS
@@ -509,6 +545,42 @@ UV_EXTERN int uv_tcp_keepalive(uv_tcp_t* handle, int enable,
  */
 UV_EXTERN int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable);
 
+/*
+ * This setting applies to Windows only.
+ * Sets how many accept requests a listening tcp server keeps queued, to begin
+ * with and at most. Call before uv_listen(). The server starts with `initial`
+ * requests (32 if zero) and doubles them, up to `max`, whenever more
+ * connections complete within one tick of the loop clock than it has queued.
+ * The default is 32 growing to 256. No-op on other platforms, which accept
+ * all pending connections whenever the socket becomes readable.
+ */
+UV_EXTERN int uv_tcp_pending_accepts(uv_tcp_t* handle, unsigned int initial,
+    unsigned int max);
+
+/*
+ * Enable/disable SO_REUSEPORT. Call before uv_tcp_bind() to let several
+ * sockets, e.g. one per loop thread, bind and listen on the same address.
+ * The kernel spreads incoming connections across them. Fails with
+ * UV_ENOTSUP where the platform doesn't have SO_REUSEPORT.
+ */
+UV_EXTERN int uv_tcp_reuseport(uv_tcp_t* handle, int enable);
+
+/*
+ * Set TCP_DEFER_ACCEPT on a listening handle: connections are reported only
+ * once the client has sent data, or after `timeout` seconds. Fails with
+ * UV_ENOTSUP where the platform doesn't have TCP_DEFER_ACCEPT.
+ */
+UV_EXTERN int uv_tcp_defer_accept(uv_tcp_t* handle, unsigned int timeout);
+
+/*
+ * Enable TCP Fast Open. On a listening handle, allows up to `qlen` pending
+ * connections that carried data on their SYN; 0 disables it. On any other
+ * handle, a nonzero `qlen` makes the next uv_tcp_connect() send the first
+ * write along with the SYN. Fails with UV_ENOTSUP where the platform doesn't
+ * have TCP_FASTOPEN, or TCP_FASTOPEN_CONNECT for clients.
+ */
+UV_EXTERN int uv_tcp_fastopen(uv_tcp_t* handle, int qlen);
+
 UV_EXTERN int uv_tcp_bind(uv_tcp_t* handle, struct sockaddr_in);
 UV_EXTERN int uv_tcp_bind6(uv_tcp_t* handle, struct sockaddr_in6);
 UV_EXTERN int uv_tcp_getsockname(uv_tcp_t* handle, struct sockaddr* name,
@@ -547,7 +619,14 @@ enum uv_udp_flags {
    * Indicates message was truncated because read buffer was too small. The
    * remainder was discarded by the OS. Used in uv_udp_recv_cb.
    */
-  UV_UDP_PARTIAL = 2
+  UV_UDP_PARTIAL = 2,
+  /*
+   * Sets SO_REUSEPORT, so that several sockets, e.g. one per loop thread,
+   * can bind the same address. The kernel hashes flows across them. Used
+   * with uv_udp_bind() and uv_udp_bind6(); they fail with UV_ENOTSUP where
+   * the platform doesn't have SO_REUSEPORT.
+   */
+  UV_UDP_REUSEPORT = 4
 };
 
 /*
@@ -573,6 +652,30 @@ typedef void (*uv_udp_send_cb)(uv_udp_send_t* req, int status);
 typedef void (*uv_udp_recv_cb)(uv_udp_t* handle, ssize_t nread, uv_buf_t buf,
     struct sockaddr* addr, unsigned flags);
 
+/* One datagram of a batch; see uv_udp_recv_batch_cb. */
+typedef struct uv_udp_msg_s {
+  size_t offset;                /* where it starts in the batch's buffer */
+  size_t len;                   /* its size in bytes */
+  unsigned flags;               /* UV_UDP_PARTIAL if it was truncated */
+  struct sockaddr_storage addr; /* the sender */
+} uv_udp_msg_t;
+
+/*
+ * Callback that is invoked with a batch of received UDP datagrams.
+ *
+ *  handle  UDP handle.
+ *  count   Number of datagrams received, at least 1.
+ *          0 if there is no more data to read. You may
+ *          discard or repurpose the read buffer.
+ *          -1 if a transmission error was detected.
+ *  buf     uv_buf_t holding the datagrams back to back, in the order they
+ *          arrived.
+ *  msgs    Where each datagram is in buf and who sent it.
+ *          Valid for the duration of the callback only.
+ */
+typedef void (*uv_udp_recv_batch_cb)(uv_udp_t* handle, int count,
+    uv_buf_t buf, uv_udp_msg_t* msgs);
+
 /* uv_udp_t is a subclass of uv_handle_t */
 struct uv_udp_s {
   UV_HANDLE_FIELDS
@@ -599,7 +702,7 @@ UV_EXTERN int uv_udp_init(uv_loop_t*, uv_udp_t* handle);
  * Arguments:
  *  handle    UDP handle. Should have been initialized with `uv_udp_init`.
  *  addr      struct sockaddr_in with the address and port to bind to.
- *  flags     Unused.
+ *  flags     Should be 0 or UV_UDP_REUSEPORT.
  *
  * Returns:
  *  0 on success, -1 on error.
@@ -613,7 +716,7 @@ UV_EXTERN int uv_udp_bind(uv_udp_t* handle, struct sockaddr_in addr,
  * Arguments:
  *  handle    UDP handle. Should have been initialized with `uv_udp_init`.
  *  addr      struct sockaddr_in with the address and port to bind to.
- *  flags     Should be 0 or UV_UDP_IPV6ONLY.
+ *  flags     Should be 0 or UV_UDP_IPV6ONLY, OR'ed with UV_UDP_REUSEPORT.
  *
  * Returns:
  *  0 on success, -1 on error.
@@ -679,6 +782,23 @@ UV_EXTERN int uv_udp_send6(uv_udp_send_t* req, uv_udp_t* handle,
     uv_buf_t bufs[], int bufcnt, struct sockaddr_in6 addr,
     uv_udp_send_cb send_cb);
 
+/*
+ * Like uv_udp_send() and uv_udp_send6(), except that every buffer is a
+ * datagram of its own. They go out in order, several per system call with
+ * sendmmsg() where there is one, and send_cb is called once they all have.
+ * A failing datagram fails the request and the ones after it aren't sent.
+ *
+ * Returns:
+ *  0 on success, -1 on error. Fails with UV_ENOSYS on Windows.
+ */
+UV_EXTERN int uv_udp_send_batch(uv_udp_send_t* req, uv_udp_t* handle,
+    uv_buf_t bufs[], int bufcnt, struct sockaddr_in addr,
+    uv_udp_send_cb send_cb);
+
+UV_EXTERN int uv_udp_send_batch6(uv_udp_send_t* req, uv_udp_t* handle,
+    uv_buf_t bufs[], int bufcnt, struct sockaddr_in6 addr,
+    uv_udp_send_cb send_cb);
+
 /*
  * Receive data. If the socket has not previously been bound with `uv_udp_bind`
  * or `uv_udp_bind6`, it is bound to 0.0.0.0 (the "all interfaces" address)
@@ -695,6 +815,20 @@ UV_EXTERN int uv_udp_send6(uv_udp_send_t* req, uv_udp_t* handle,
 UV_EXTERN int uv_udp_recv_start(uv_udp_t* handle, uv_alloc_cb alloc_cb,
     uv_udp_recv_cb recv_cb);
 
+/*
+ * Like uv_udp_recv_start() but reads up to `count` datagrams of at most
+ * `slot_size` bytes at a time, with recvmmsg() where there is one, into a
+ * single buffer of `count * slot_size` bytes from alloc_cb. Longer datagrams
+ * are truncated. count is capped at UV_UDP_BATCH_MAX.
+ *
+ * Returns:
+ *  0 on success, -1 on error. Fails with UV_ENOSYS on Windows.
+ */
+#define UV_UDP_BATCH_MAX 64
+
+UV_EXTERN int uv_udp_recv_batch_start(uv_udp_t* handle, uv_alloc_cb alloc_cb,
+    uv_udp_recv_batch_cb recv_cb, unsigned int count, size_t slot_size);
+
 /*
  * Stop listening for incoming datagrams.
  *
@@ -902,6 +1036,13 @@ UV_EXTERN void uv_timer_set_repeat(uv_timer_t* timer, int64_t repeat);
 
 UV_EXTERN int64_t uv_timer_get_repeat(uv_timer_t* timer);
 
+/*
+ * Returns the number of milliseconds until the earliest active timer of the
+ * loop is due, 0 if one is overdue, or -1 if no timer is active. Like
+ * uv_now(), it is relative to the loop's cached time.
+ */
+UV_EXTERN int64_t uv_next_timeout(uv_loop_t*);
+
 
 /* c-ares integration initialize and terminate */
 UV_EXTERN  int uv_ares_init_options(uv_loop_t*,
@@ -1012,6 +1153,20 @@ UV_EXTERN int uv_spawn(uv_loop_t*, uv_process_t*,
  */
 UV_EXTERN int uv_process_kill(uv_process_t*, int signum);
 
+/*
+ * Forks the calling process, which goes on with the same loop in the child.
+ * Returns the child's pid in the parent, where `process` watches the child
+ * like uv_spawn() does, 0 in the child, and -1 on error. `channel`, if not
+ * NULL, is an initialized pipe that is connected to the other process on
+ * either side.
+ *
+ * The child inherits every handle of the parent, which it should close if
+ * it has no use for them, but only the calling thread. Fails with UV_EBUSY
+ * once the thread pool has started threads, and with UV_ENOSYS on Windows.
+ */
+UV_EXTERN int uv_fork(uv_loop_t*, uv_process_t*, uv_exit_cb exit_cb,
+    uv_pipe_t* channel);
+
 
 /* Kills the process with the specified signal. */
 UV_EXTERN uv_err_t uv_kill(int pid, int signum);
@@ -1064,6 +1219,9 @@ struct uv_work_s {
   uv_loop_t* loop;
   uv_work_cb work_cb;
   uv_after_work_cb after_work_cb;
+  /* What kind of work this is, below UV_WORK_TYPES; only counted. Left as
+   * the caller sets it. */
+  int work_type;
   UV_WORK_PRIVATE_FIELDS
 };
 
@@ -1071,6 +1229,53 @@ struct uv_work_s {
 UV_EXTERN int uv_queue_work(uv_loop_t* loop, uv_work_t* req,
     uv_work_cb work_cb, uv_after_work_cb after_work_cb);
 
+/*
+ * Batched completion of uv_queue_work() requests. With a batch callback set,
+ * the after_work_cb of finished requests are not called one by one: they
+ * are queued, and the batch callback is called once per loop iteration that
+ * finished any, to run them with uv_work_drain(). An embedder can set up
+ * what every callback needs once for all of them, such as a V8 HandleScope.
+ *
+ * uv_work_drain() runs queued callbacks for at most the time the loop gives
+ * to thread pool completions per iteration, and returns 1 if it left some
+ * for the next iteration, 0 if it ran them all. Callbacks run by it are
+ * counted per work_type in uv_counters_t.
+ *
+ * The batch callback is not called on Windows, where after_work_cb is
+ * always called directly.
+ */
+#define UV_WORK_TYPES 8
+
+typedef void (*uv_work_batch_cb)(uv_loop_t* loop);
+
+UV_EXTERN void uv_work_set_batch_cb(uv_loop_t* loop, uv_work_batch_cb cb);
+UV_EXTERN int uv_work_drain(uv_loop_t* loop);
+
+/*
+ * Thread pool tuning. The pool that runs uv_queue_work and the asynchronous
+ * uv_fs_* requests is shared by all loops:
+ *
+ *  - uv_threadpool_set_size sets its number of threads.
+ *  - uv_threadpool_set_max_poll_reqs limits how many completed requests
+ *    the loop runs the callbacks of per iteration; 0 restores the default.
+ *  - uv_threadpool_set_priority sets the priority, from -4 (lowest) to 4,
+ *    of the requests the loop submits from now on. Pending requests of a
+ *    higher priority are always picked up first, so a loop doing bulk work
+ *    at a low priority does not hold up the interactive requests of others.
+ *  - uv_threadpool_set_max_threads caps how many pool threads the loop's
+ *    requests may occupy at once; 0, the default, is no cap. Loops whose
+ *    pending requests have the same priority take turns, whatever the
+ *    order they were submitted in.
+ *
+ * These are no-ops on Windows.
+ */
+UV_EXTERN void uv_threadpool_set_size(unsigned int nthreads);
+UV_EXTERN void uv_threadpool_set_max_poll_reqs(uv_loop_t* loop,
+    unsigned int maxreqs);
+UV_EXTERN void uv_threadpool_set_priority(uv_loop_t* loop, int priority);
+UV_EXTERN void uv_threadpool_set_max_threads(uv_loop_t* loop,
+    unsigned int nthreads);
+
 
 
 
@@ -1255,7 +1460,16 @@ enum uv_fs_event_flags {
    * regular interval.
    * This flag is currently not implemented yet on any backend.
    */
-  UV_FS_EVENT_STAT = 2
+  UV_FS_EVENT_STAT = 2,
+
+  /*
+   * Watches the directories under a directory too, with the filename given
+   * to the callback relative to the watched directory. Directories created
+   * later are watched once they are reported, so files created in them
+   * before that go unnoticed. Only implemented with inotify; elsewhere
+   * uv_fs_event_init() fails with UV_ENOSYS.
+   */
+  UV_FS_EVENT_RECURSIVE = 4
 };
 
 
@@ -1341,6 +1555,33 @@ union uv_any_req {
 };
 
 
+/*
+ * Latency of requests from when they are made until they complete, kept in
+ * uv_counters_t for each kind of request. Bucket 0 of the histogram counts
+ * requests that took under 1 microsecond, bucket i those that took under
+ * 2^i microseconds, and the last bucket everything slower.
+ */
+#define UV_LATENCY_BUCKETS 24
+
+typedef enum {
+  UV_LATENCY_FS,
+  UV_LATENCY_WORK,
+  UV_LATENCY_GETADDRINFO,
+  UV_LATENCY_WRITE,
+  UV_LATENCY_CONNECT,
+  UV_LATENCY_TYPES
+} uv_latency_type;
+
+typedef struct {
+  /* made and not completed yet */
+  uint64_t in_flight;
+  uint64_t completed;
+  /* sum of the latencies of the completed requests, in nanoseconds */
+  uint64_t total_time;
+  uint64_t buckets[UV_LATENCY_BUCKETS];
+} uv_latency_t;
+
+
 struct uv_counters_s {
   uint64_t eio_init;
   uint64_t req_init;
@@ -1358,6 +1599,19 @@ struct uv_counters_s {
   uint64_t process_init;
   uint64_t thread_init;
   uint64_t fs_event_init;
+  /* thread pool completions: eio_poll() calls, requests they finished and
+   * calls that left requests behind for the next round */
+  uint64_t eio_poll;
+  uint64_t eio_done;
+  uint64_t eio_poll_limited;
+  /* batched uv_queue_work() completions: batches, batches that left
+   * callbacks for the next iteration and callbacks run, per work_type */
+  uint64_t work_batch;
+  uint64_t work_batch_limited;
+  uint64_t work_batched[UV_WORK_TYPES];
+  /* asynchronous fs requests, uv_queue_work(), uv_getaddrinfo(), stream
+   * writes and connects, indexed by uv_latency_type */
+  uv_latency_t latency[UV_LATENCY_TYPES];
 };
 
 
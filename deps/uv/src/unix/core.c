@@ -79,6 +79,9 @@ void uv_close(uv_handle_t* handle, uv_close_cb close_cb) {
 
   handle->close_cb = close_cb;
 
+  /* Closing releases the handle's references, so take them back first. */
+  uv_handle_ref(handle);
+
   switch (handle->type) {
     case UV_NAMED_PIPE:
       uv_pipe_cleanup((uv_pipe_t*)handle);
@@ -89,7 +92,7 @@ void uv_close(uv_handle_t* handle, uv_close_cb close_cb) {
       stream = (uv_stream_t*)handle;
 
       uv_read_stop(stream);
-      ev_io_stop(stream->loop->ev, &stream->write_watcher);
+      uv__io_stop((uv_handle_t*)stream, &stream->write_watcher);
 
       uv__close(stream->fd);
       stream->fd = -1;
@@ -169,12 +172,18 @@ uv_loop_t* uv_loop_new(void) {
   loop->ev = ev_loop_new(0);
   ev_set_userdata(loop->ev, loop);
   eio_channel_init (&loop->uv_eio_channel, loop);
+#if HAVE_EPOLL
+  uv__epoll_init(loop);
+#endif
   return loop;
 }
 
 
 void uv_loop_delete(uv_loop_t* loop) {
   uv_ares_destroy(loop, loop->channel);
+#if HAVE_EPOLL
+  uv__epoll_destroy(loop);
+#endif
   ev_loop_destroy(loop->ev);
   free(loop);
 }
@@ -190,6 +199,9 @@ uv_loop_t* uv_default_loop(void) {
 #endif
     ev_set_userdata(default_loop_struct.ev, default_loop_ptr);
     eio_channel_init(&default_loop_struct.uv_eio_channel, default_loop_ptr);
+#if HAVE_EPOLL
+    uv__epoll_init(default_loop_ptr);
+#endif
   }
   assert(default_loop_ptr->ev == EV_DEFAULT_UC);
   return default_loop_ptr;
@@ -311,6 +323,99 @@ void uv_unref(uv_loop_t* loop) {
 }
 
 
+/* The io watchers of handle, which keep the loop alive while active. */
+int uv__handle_io_watchers(uv_handle_t* handle, ev_io* w[2]) {
+  switch (handle->type) {
+    case UV_NAMED_PIPE:
+    case UV_TTY:
+    case UV_TCP:
+      w[0] = &((uv_stream_t*)handle)->read_watcher;
+      w[1] = &((uv_stream_t*)handle)->write_watcher;
+      return 2;
+
+    case UV_UDP:
+      w[0] = &((uv_udp_t*)handle)->read_watcher;
+      w[1] = &((uv_udp_t*)handle)->write_watcher;
+      return 2;
+
+    default:
+      return 0;
+  }
+}
+
+
+void uv_handle_ref(uv_handle_t* handle) {
+  ev_io* w[2];
+  int i, n;
+
+  if (!(handle->flags & UV_UNREF))
+    return;
+
+  handle->flags &= ~UV_UNREF;
+  ev_ref(handle->loop->ev);
+
+  n = uv__handle_io_watchers(handle, w);
+  for (i = 0; i < n; i++) {
+    if (ev_is_active(w[i]))
+      ev_ref(handle->loop->ev);
+  }
+}
+
+
+void uv_handle_unref(uv_handle_t* handle) {
+  ev_io* w[2];
+  int i, n;
+
+  if (handle->flags & (UV_UNREF | UV_CLOSING))
+    return;
+
+  handle->flags |= UV_UNREF;
+  ev_unref(handle->loop->ev);
+
+  n = uv__handle_io_watchers(handle, w);
+  for (i = 0; i < n; i++) {
+    if (ev_is_active(w[i]))
+      ev_unref(handle->loop->ev);
+  }
+}
+
+
+void uv__io_start(uv_handle_t* handle, ev_io* w) {
+  if (ev_is_active(w))
+    return;
+
+#if HAVE_EPOLL
+  if (handle->flags & UV_EV_IO || uv__epoll_start(handle, w)) {
+    handle->flags |= UV_EV_IO;
+    ev_io_start(handle->loop->ev, w);
+  }
+#else
+  ev_io_start(handle->loop->ev, w);
+#endif
+
+  if (handle->flags & UV_UNREF)
+    ev_unref(handle->loop->ev);
+}
+
+
+void uv__io_stop(uv_handle_t* handle, ev_io* w) {
+  if (!ev_is_active(w))
+    return;
+
+  if (handle->flags & UV_UNREF)
+    ev_ref(handle->loop->ev);
+
+#if HAVE_EPOLL
+  if (!(handle->flags & UV_EV_IO)) {
+    uv__epoll_stop(handle, w);
+    return;
+  }
+#endif
+
+  ev_io_stop(handle->loop->ev, w);
+}
+
+
 void uv_update_time(uv_loop_t* loop) {
   ev_now_update(loop->ev);
 }
@@ -321,6 +426,16 @@ int64_t uv_now(uv_loop_t* loop) {
 }
 
 
+int64_t uv_next_timeout(uv_loop_t* loop) {
+  ev_tstamp due = ev_next_timer(loop->ev);
+
+  if (due < 0)
+    return -1;
+
+  return (int64_t)(due * 1000);
+}
+
+
 void uv__req_init(uv_req_t* req) {
   /* loop->counters.req_init++; */
   req->type = UV_UNKNOWN_REQ;
@@ -607,6 +722,8 @@ static int uv_getaddrinfo_done(eio_req* req) {
 
   handle->res = NULL;
 
+  uv__req_latency_done(handle->loop, (uv_req_t*)handle,
+      UV_LATENCY_GETADDRINFO);
   uv_unref(handle->loop);
 
   free(handle->hints);
@@ -688,8 +805,9 @@ int uv_getaddrinfo(uv_loop_t* loop,
   /* TODO check handle->service == NULL */
 
   uv_ref(loop);
+  uv__req_latency_start(loop, (uv_req_t*)handle, UV_LATENCY_GETADDRINFO);
 
-  req = eio_custom(getaddrinfo_thread_proc, EIO_PRI_DEFAULT,
+  req = eio_custom(getaddrinfo_thread_proc, loop->uv_eio_channel.pri,
       uv_getaddrinfo_done, handle, &loop->uv_eio_channel);
   assert(req);
   assert(req->data == handle);
@@ -502,9 +502,18 @@ etp_nthreads (void)
   return retval;
 }
 
-static etp_reqq req_queue;
+static etp_reqq req_queue;     /* reqlock, requests without a channel */
 static eio_channel default_channel;
 
+/*
+ * Channels with requests waiting for a thread, in the order they are served
+ * in (reqlock). A thread takes the waiting request of the highest priority
+ * from a channel below its max_running; channels with the same priority
+ * take turns, so one channel with a long queue does not hold up the others.
+ */
+static eio_channel *ready_first;
+static eio_channel **ready_tail = &ready_first;
+
 static void ecb_noinline ecb_cold
 reqq_init (etp_reqq *q)
 {
@@ -559,6 +568,90 @@ reqq_shift (etp_reqq *q)
   abort ();
 }
 
+/* priority of the first request reqq_shift would return, -1 if empty */
+static int
+reqq_top_pri (etp_reqq *q)
+{
+  int pri;
+
+  if (q->size)
+    for (pri = ETP_NUM_PRI; pri--; )
+      if (q->qs[pri])
+        return pri;
+
+  return -1;
+}
+
+/* reqlock must be held */
+static void
+etp_push (ETP_REQ *req)
+{
+  eio_channel *channel = req->channel;
+
+  if (!channel)
+    {
+      reqq_push (&req_queue, req);
+      return;
+    }
+
+  if (!reqq_push (&channel->req_queue, req))
+    {
+      channel->next_ready = 0;
+      *ready_tail = channel;
+      ready_tail = &channel->next_ready;
+    }
+}
+
+/* reqlock must be held */
+static ETP_REQ *
+etp_shift (void)
+{
+  eio_channel **link, **best_link = 0;
+  eio_channel *channel;
+  int best_pri = -1;
+  ETP_REQ *req;
+
+  for (link = &ready_first; *link; link = &(*link)->next_ready)
+    {
+      int pri;
+
+      channel = *link;
+      if (channel->max_running && channel->running >= channel->max_running)
+        continue;
+
+      pri = reqq_top_pri (&channel->req_queue);
+      if (pri > best_pri)
+        {
+          best_pri  = pri;
+          best_link = link;
+        }
+    }
+
+  if (req_queue.size && reqq_top_pri (&req_queue) >= best_pri)
+    return reqq_shift (&req_queue);
+
+  if (!best_link)
+    return 0;
+
+  /* unlink the channel, and requeue it at the back if it has more */
+  channel = *best_link;
+  *best_link = channel->next_ready;
+  if (ready_tail == &channel->next_ready)
+    ready_tail = best_link;
+
+  req = reqq_shift (&channel->req_queue);
+  ++channel->running;
+
+  if (channel->req_queue.size)
+    {
+      channel->next_ready = 0;
+      *ready_tail = channel;
+      ready_tail = &channel->next_ready;
+    }
+
+  return req;
+}
+
 static int ecb_cold
 etp_init (void (*want_poll)(eio_channel *), void (*done_poll)(eio_channel *))
 {
@@ -645,7 +738,47 @@ etp_end_thread (void)
 void
 eio_channel_init(eio_channel *channel, void *data) {
   reqq_init(&channel->res_queue);
+  reqq_init(&channel->req_queue);
   channel->data = data;
+  channel->max_poll_reqs = 0;
+  channel->pri = EIO_PRI_DEFAULT;
+  channel->nfinished = 0;
+  channel->max_running = 0;
+  channel->running = 0;
+  channel->next_ready = 0;
+}
+
+void
+eio_channel_set_max_running(eio_channel *channel, unsigned int nthreads) {
+  X_LOCK (reqlock);
+  channel->max_running = nthreads;
+  /* a raised limit may let idle threads pick up waiting requests */
+  X_COND_BROADCAST (reqwait);
+  X_UNLOCK (reqlock);
+}
+
+unsigned int
+eio_channel_nready (eio_channel *channel)
+{
+  unsigned int retval;
+
+  X_LOCK (reqlock);
+  retval = channel->req_queue.size + channel->running;
+  X_UNLOCK (reqlock);
+
+  return retval;
+}
+
+unsigned int
+eio_channel_npending (eio_channel *channel)
+{
+  unsigned int retval;
+
+  X_LOCK (reslock);
+  retval = channel->res_queue.size;
+  X_UNLOCK (reslock);
+
+  return retval;
 }
 
 static int
@@ -657,7 +790,7 @@ etp_poll (eio_channel *channel)
   if(!channel) channel = &default_channel;
 
   X_LOCK (reslock);
-  maxreqs = max_poll_reqs;
+  maxreqs = channel->max_poll_reqs ? channel->max_poll_reqs : max_poll_reqs;
   maxtime = max_poll_time;
   X_UNLOCK (reslock);
 
@@ -697,7 +830,9 @@ etp_poll (eio_channel *channel)
         }
       else
         {
-          int res = ETP_FINISH (req);
+          int res;
+          ++channel->nfinished;
+          res = ETP_FINISH (req);
           if (ecb_expect_false (res))
             return res;
         }
@@ -755,7 +890,7 @@ etp_submit (ETP_REQ *req)
       X_LOCK (reqlock);
       ++nreqs;
       ++nready;
-      reqq_push (&req_queue, req);
+      etp_push (req);
       X_COND_SIGNAL (reqwait);
       X_UNLOCK (reqlock);
 
@@ -2040,7 +2175,7 @@ X_THREAD_PROC (etp_proc)
 
       for (;;)
         {
-          self->req = req = reqq_shift (&req_queue);
+          self->req = req = etp_shift ();
 
           if (req)
             break;
@@ -2081,6 +2216,17 @@ X_THREAD_PROC (etp_proc)
 
       ETP_EXECUTE (self, req);
 
+      if (req->channel)
+        {
+          eio_channel *channel = req->channel;
+
+          X_LOCK (reqlock);
+          /* a thread may be waiting for the channel to drop below its limit */
+          if (channel->running-- == channel->max_running && channel->req_queue.size)
+            X_COND_SIGNAL (reqwait);
+          X_UNLOCK (reqlock);
+        }
+
       X_LOCK (reslock);
 
       ++npending;
@@ -1638,6 +1638,24 @@ ev_depth (EV_P)
   return loop_depth;
 }
 
+unsigned int
+ev_spurious_polls (EV_P)
+{
+  return spurious_polls;
+}
+
+ev_tstamp
+ev_next_timer (EV_P)
+{
+  ev_tstamp due;
+
+  if (!timercnt)
+    return -1.;
+
+  due = ANHE_at (timers [HEAP0]) - mn_now;
+  return due < 0. ? 0. : due;
+}
+
 void
 ev_set_io_collect_interval (EV_P_ ev_tstamp interval)
 {
@@ -2495,6 +2513,21 @@ ev_run (EV_P_ int flags)
         backend_poll (EV_A_ waittime);
         assert ((loop_done = EVBREAK_CANCEL, 1)); /* assert for side effect */
 
+#if EV_FEATURE_API && EV_IDLE_ENABLE
+        /* an idle watcher made the poll return at once, and it found nothing */
+        if (expect_false (idleall))
+          {
+            int pri;
+
+            for (pri = NUMPRI; pri--; )
+              if (pendingcnt [pri])
+                break;
+
+            if (pri < 0)
+              ++spurious_polls;
+          }
+#endif
+
         /* update ev_rt_now, do magic */
         time_update (EV_A_ waittime + sleeptime);
       }
@@ -3047,7 +3080,8 @@ infy_add (EV_P_ ev_stat *w)
         w->timer.repeat = w->interval ? w->interval : DEF_STAT_INTERVAL;
       else if (!statfs (w->path, &sfs)
                && (sfs.f_type == 0x1373 /* devfs */
-                   || sfs.f_type == 0xEF53 /* ext2/3 */
+                   || sfs.f_type == 0xEF53 /* ext2/3/4 */
+                   || sfs.f_type == 0x9123683E /* btrfs */
                    || sfs.f_type == 0x3153464a /* jfs */
                    || sfs.f_type == 0x52654973 /* reiser3 */
                    || sfs.f_type == 0x01021994 /* tempfs */
@@ -192,6 +192,7 @@ VARx(unsigned int, origflags) /* original loop flags */
 #if EV_FEATURE_API || EV_GENWRAP
 VARx(unsigned int, loop_count) /* total number of loop iterations/blocks */
 VARx(unsigned int, loop_depth) /* #ev_run enters - #ev_run leaves */
+VARx(unsigned int, spurious_polls) /* polls idle watchers kept from blocking that found nothing */
 
 VARx(void *, userdata)
 VAR (release_cb, void (*release_cb)(EV_P))
@@ -92,6 +92,7 @@
 #define origflags ((loop)->origflags)
 #define loop_count ((loop)->loop_count)
 #define loop_depth ((loop)->loop_depth)
+#define spurious_polls ((loop)->spurious_polls)
 #define userdata ((loop)->userdata)
 #define release_cb ((loop)->release_cb)
 #define acquire_cb ((loop)->acquire_cb)
@@ -189,6 +190,7 @@
 #undef origflags
 #undef loop_count
 #undef loop_depth
+#undef spurious_polls
 #undef userdata
 #undef release_cb
 #undef acquire_cb
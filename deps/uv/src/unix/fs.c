@@ -44,7 +44,7 @@
   uv_fs_req_init(loop, req, type, path, cb); \
   if (cb) { \
     /* async */ \
-    req->eio = eiofunc(args, EIO_PRI_DEFAULT, uv__fs_after, req, &loop->uv_eio_channel); \
+    req->eio = eiofunc(args, loop->uv_eio_channel.pri, uv__fs_after, req, &loop->uv_eio_channel); \
     if (!req->eio) { \
       uv__set_sys_error(loop, ENOMEM); \
       return -1; \
@@ -76,6 +76,9 @@ static void uv_fs_req_init(uv_loop_t* loop, uv_fs_t* req, uv_fs_type fs_type,
   req->path = path ? strdup(path) : NULL;
   req->errorno = 0;
   req->eio = NULL;
+
+  if (cb)
+    uv__req_latency_start(loop, (uv_req_t*)req, UV_LATENCY_FS);
 }
 
 
@@ -110,6 +113,8 @@ static int uv__fs_after(eio_req* eio) {
 
   assert(req->cb);
 
+  uv__req_latency_done(req->loop, (uv_req_t*)req, UV_LATENCY_FS);
+
   req->result = req->eio->result;
   req->errorno = uv_translate_sys_error(req->eio->errorno);
 
@@ -191,7 +196,7 @@ int uv_fs_open(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags,
   if (cb) {
     /* async */
     uv_ref(loop);
-    req->eio = eio_open(path, flags, mode, EIO_PRI_DEFAULT, uv__fs_after, req, &loop->uv_eio_channel);
+    req->eio = eio_open(path, flags, mode, loop->uv_eio_channel.pri, uv__fs_after, req, &loop->uv_eio_channel);
     if (!req->eio) {
       uv__set_sys_error(loop, ENOMEM);
       return -1;
@@ -221,7 +226,7 @@ int uv_fs_read(uv_loop_t* loop, uv_fs_t* req, uv_file fd, void* buf,
   if (cb) {
     /* async */
     uv_ref(loop);
-    req->eio = eio_read(fd, buf, length, offset, EIO_PRI_DEFAULT,
+    req->eio = eio_read(fd, buf, length, offset, loop->uv_eio_channel.pri,
         uv__fs_after, req,  &loop->uv_eio_channel);
 
     if (!req->eio) {
@@ -259,7 +264,7 @@ int uv_fs_write(uv_loop_t* loop, uv_fs_t* req, uv_file file, void* buf,
   if (cb) {
     /* async */
     uv_ref(loop);
-    req->eio = eio_write(file, buf, length, offset, EIO_PRI_DEFAULT,
+    req->eio = eio_write(file, buf, length, offset, loop->uv_eio_channel.pri,
         uv__fs_after, req,  &loop->uv_eio_channel);
     if (!req->eio) {
       uv__set_sys_error(loop, ENOMEM);
@@ -307,7 +312,7 @@ int uv_fs_readdir(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags,
   if (cb) {
     /* async */
     uv_ref(loop);
-    req->eio = eio_readdir(path, flags, EIO_PRI_DEFAULT, uv__fs_after, req,  &loop->uv_eio_channel);
+    req->eio = eio_readdir(path, flags, loop->uv_eio_channel.pri, uv__fs_after, req,  &loop->uv_eio_channel);
     if (!req->eio) {
       uv__set_sys_error(loop, ENOMEM);
       return -1;
@@ -377,7 +382,7 @@ int uv_fs_stat(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb) {
   if (cb) {
     /* async */
     uv_ref(loop);
-    req->eio = eio_stat(pathdup, EIO_PRI_DEFAULT, uv__fs_after, req,  &loop->uv_eio_channel);
+    req->eio = eio_stat(pathdup, loop->uv_eio_channel.pri, uv__fs_after, req,  &loop->uv_eio_channel);
 
     free(pathdup);
 
@@ -411,7 +416,7 @@ int uv_fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
   if (cb) {
     /* async */
     uv_ref(loop);
-    req->eio = eio_fstat(file, EIO_PRI_DEFAULT, uv__fs_after, req,  &loop->uv_eio_channel);
+    req->eio = eio_fstat(file, loop->uv_eio_channel.pri, uv__fs_after, req,  &loop->uv_eio_channel);
 
     if (!req->eio) {
       uv__set_sys_error(loop, ENOMEM);
@@ -520,9 +525,6 @@ int uv_fs_futime(uv_loop_t* loop, uv_fs_t* req, uv_file file, double atime,
     double mtime, uv_fs_cb cb) {
 #if HAVE_FUTIMES
   const char* path = NULL;
-
-  uv_fs_req_init(loop, req, UV_FS_FUTIME, path, cb);
-
   WRAP_EIO(UV_FS_FUTIME, eio_futime, _futime, ARGS3(file, atime, mtime))
 #else
   uv__set_sys_error(loop, ENOSYS);
@@ -550,7 +552,7 @@ int uv_fs_lstat(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb) {
   if (cb) {
     /* async */
     uv_ref(loop);
-    req->eio = eio_lstat(pathdup, EIO_PRI_DEFAULT, uv__fs_after, req,  &loop->uv_eio_channel);
+    req->eio = eio_lstat(pathdup, loop->uv_eio_channel.pri, uv__fs_after, req,  &loop->uv_eio_channel);
 
     free(pathdup);
 
@@ -598,7 +600,7 @@ int uv_fs_readlink(uv_loop_t* loop, uv_fs_t* req, const char* path,
   uv_fs_req_init(loop, req, UV_FS_READLINK, path, cb);
 
   if (cb) {
-    if ((req->eio = eio_readlink(path, EIO_PRI_DEFAULT, uv__fs_after, req,  &loop->uv_eio_channel))) {
+    if ((req->eio = eio_readlink(path, loop->uv_eio_channel.pri, uv__fs_after, req,  &loop->uv_eio_channel))) {
       uv_ref(loop);
       return 0;
     } else {
@@ -671,6 +673,14 @@ static void uv__work(eio_req* eio) {
 
 static int uv__after_work(eio_req *eio) {
   uv_work_t* req = eio->data;
+  uv__req_latency_done(req->loop, (uv_req_t*)req, UV_LATENCY_WORK);
+
+  /* Keeps the loop's reference until uv_work_drain() runs it. */
+  if (req->loop->work_batch_cb) {
+    ngx_queue_insert_tail(&req->loop->work_done_queue, &req->done_queue);
+    return 0;
+  }
+
   uv_unref(req->loop);
   if (req->after_work_cb) {
     req->after_work_cb(req);
@@ -692,12 +702,14 @@ int uv_queue_work(uv_loop_t* loop, uv_work_t* req, uv_work_cb work_cb,
   req->work_cb = work_cb;
   req->after_work_cb = after_work_cb;
 
-  req->eio = eio_custom(uv__work, EIO_PRI_DEFAULT, uv__after_work, req,  &loop->uv_eio_channel);
+  req->eio = eio_custom(uv__work, loop->uv_eio_channel.pri, uv__after_work, req,  &loop->uv_eio_channel);
 
   if (!req->eio) {
     uv__set_sys_error(loop, ENOMEM);
     return -1;
   }
 
+  uv__req_latency_start(loop, (uv_req_t*)req, UV_LATENCY_WORK);
+
   return 0;
 }
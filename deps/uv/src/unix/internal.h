@@ -37,6 +37,9 @@
 # undef HAVE_SYS_UTIMESAT
 # undef HAVE_SYS_PIPE2
 # undef HAVE_SYS_ACCEPT4
+# undef HAVE_SYS_RECVMMSG
+# undef HAVE_SYS_SENDMMSG
+# undef HAVE_EPOLL
 
 # undef _GNU_SOURCE
 # define _GNU_SOURCE
@@ -55,6 +58,14 @@
 # if __NR_accept4
 #  define HAVE_SYS_ACCEPT4 1
 # endif
+# if __NR_recvmmsg
+#  define HAVE_SYS_RECVMMSG 1
+# endif
+# if __NR_sendmmsg
+#  define HAVE_SYS_SENDMMSG 1
+# endif
+
+# define HAVE_EPOLL 1
 
 # if HAVE_SYS_UTIMESAT
 inline static int sys_utimesat(int dirfd,
@@ -93,6 +104,34 @@ inline static int sys_accept4(int fd,
 }
 # endif /* HAVE_SYS_ACCEPT4 */
 
+# if HAVE_SYS_RECVMMSG || HAVE_SYS_SENDMMSG
+/* struct mmsghdr, which older C libraries don't declare */
+struct uv__mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int msg_len;
+};
+# endif
+
+# if HAVE_SYS_RECVMMSG
+inline static int sys_recvmmsg(int fd,
+                               struct uv__mmsghdr* mmsg,
+                               unsigned int vlen,
+                               unsigned int flags)
+{
+  return syscall(__NR_recvmmsg, fd, mmsg, vlen, flags, NULL);
+}
+# endif /* HAVE_SYS_RECVMMSG */
+
+# if HAVE_SYS_SENDMMSG
+inline static int sys_sendmmsg(int fd,
+                               struct uv__mmsghdr* mmsg,
+                               unsigned int vlen,
+                               unsigned int flags)
+{
+  return syscall(__NR_sendmmsg, fd, mmsg, vlen, flags);
+}
+# endif /* HAVE_SYS_SENDMMSG */
+
 #endif /* __linux__ */
 
 #if defined(__sun)
@@ -136,7 +175,11 @@ enum {
   UV_READABLE      = 0x20,   /* The stream is readable */
   UV_WRITABLE      = 0x40,   /* The stream is writable */
   UV_TCP_NODELAY   = 0x080,  /* Disable Nagle. */
-  UV_TCP_KEEPALIVE = 0x100   /* Turn on keep-alive. */
+  UV_TCP_KEEPALIVE = 0x100,  /* Turn on keep-alive. */
+  UV_TCP_REUSEPORT = 0x200,  /* Share the port with other sockets. */
+  UV_TCP_FASTOPEN  = 0x400,  /* Send data with the SYN on connect. */
+  UV_UNREF         = 0x800,  /* uv_handle_unref() called. */
+  UV_EV_IO         = 0x1000  /* io watchers run on libev, not epoll. */
 };
 
 size_t uv__strlcpy(char* dst, const char* src, size_t size);
@@ -145,6 +188,25 @@ int uv__close(int fd);
 void uv__req_init(uv_req_t*);
 void uv__handle_init(uv_loop_t* loop, uv_handle_t* handle, uv_handle_type type);
 
+/* Start and stop an io watcher of handle. Use these rather than ev_io_start()
+ * and ev_io_stop() so that the watchers of an unref'd handle don't keep the
+ * loop alive.
+ */
+void uv__io_start(uv_handle_t* handle, ev_io* w);
+void uv__io_stop(uv_handle_t* handle, ev_io* w);
+int uv__handle_io_watchers(uv_handle_t* handle, ev_io* w[2]);
+
+#if HAVE_EPOLL
+/* The loop's epoll set, where uv__io_start() puts the io watchers of handles
+ * on Linux. uv__epoll_start() fails if the fd can't go there, e.g. because
+ * it's a regular file; libev takes the watcher then.
+ */
+void uv__epoll_init(uv_loop_t* loop);
+void uv__epoll_destroy(uv_loop_t* loop);
+int uv__epoll_start(uv_handle_t* handle, ev_io* w);
+void uv__epoll_stop(uv_handle_t* handle, ev_io* w);
+#endif
+
 
 int uv__nonblock(int fd, int set) __attribute__((unused));
 int uv__cloexec(int fd, int set) __attribute__((unused));
@@ -169,6 +231,8 @@ int uv__connect(uv_connect_t* req, uv_stream_t* stream, struct sockaddr* addr,
 int uv_tcp_listen(uv_tcp_t* tcp, int backlog, uv_connection_cb cb);
 int uv__tcp_nodelay(uv_tcp_t* handle, int enable);
 int uv__tcp_keepalive(uv_tcp_t* handle, int enable, unsigned int delay);
+int uv__tcp_reuseport(uv_tcp_t* handle, int enable);
+int uv__tcp_fastopen_connect(uv_tcp_t* handle);
 
 /* pipe */
 int uv_pipe_listen(uv_pipe_t* handle, int backlog, uv_connection_cb cb);
@@ -177,6 +241,7 @@ int uv_pipe_cleanup(uv_pipe_t* handle);
 
 /* udp */
 void uv__udp_destroy(uv_udp_t* handle);
+int uv__udp_open(uv_udp_t* handle, int fd);
 void uv__udp_watcher_stop(uv_udp_t* handle, ev_io* w);
 
 /* fs */
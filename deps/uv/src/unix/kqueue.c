@@ -91,7 +91,10 @@ int uv_fs_event_init(uv_loop_t* loop,
   int fd;
 
   /* We don't support any flags yet. */
-  assert(!flags);
+  if (flags) {
+    uv__set_artificial_error(loop, UV_ENOSYS);
+    return -1;
+  }
 
   if (cb == NULL) {
     uv__set_sys_error(loop, EINVAL);
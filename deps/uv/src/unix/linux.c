@@ -27,6 +27,10 @@
 #include <assert.h>
 #include <errno.h>
 
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/epoll.h>
 #include <sys/inotify.h>
 #include <sys/sysinfo.h>
 #include <unistd.h>
@@ -83,6 +87,186 @@ uint64_t uv_get_total_memory(void) {
   return (uint64_t) sysconf(_SC_PAGESIZE) * sysconf(_SC_PHYS_PAGES);
 }
 
+#if HAVE_EPOLL
+
+/*
+ * The io watchers of stream and udp handles don't go through libev on Linux,
+ * which would look each fd up in its own table and queue its watchers as
+ * pending before calling them. uv__io_start() puts them in an epoll set of
+ * the loop instead, with the handle in the data of its fd. libev watches
+ * just that set, and when it's readable uv__epoll_io() takes its events with
+ * one epoll_wait() and calls the watchers straight away.
+ *
+ * The watchers are still ev_io structs, so ev_is_active(), ev_feed_event()
+ * and the loop's reference count work on them as before: uv__epoll_start()
+ * marks them active and refs the loop like ev_io_start() does.
+ *
+ * Level-triggered, because uv__read() gives up after a number of reads and
+ * uv_read_stop() leaves data in the socket. Both would lose an edge.
+ */
+static void uv__epoll_io(EV_P_ ev_io* watcher, int revents) {
+  struct epoll_event events[1024];
+  uv_handle_t* handle;
+  ev_io* w[2];
+  int i, j, n, nfds;
+  int got;
+
+  /* Just one batch: libev has to run the events that the callbacks feed,
+   * like finished writes, before the next one, as it would itself.
+   */
+  nfds = epoll_wait(watcher->fd, events, COUNTOF(events), 0);
+
+  for (i = 0; i < nfds; i++) {
+    handle = events[i].data.ptr;
+    got = (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP) ? EV_READ : 0)
+        | (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP) ? EV_WRITE : 0);
+
+    /* A callback may stop or close any handle, this one included, but the
+     * handle stays valid until its close callback runs, after this.
+     */
+    n = uv__handle_io_watchers(handle, w);
+    for (j = 0; j < n; j++) {
+      if (ev_is_active(w[j]) && (w[j]->events & got))
+        w[j]->cb(EV_A_ w[j], w[j]->events & got);
+    }
+  }
+}
+
+
+void uv__epoll_init(uv_loop_t* loop) {
+  loop->epoll_fd = epoll_create(256);
+
+  if (loop->epoll_fd != -1 && uv__cloexec(loop->epoll_fd, 1)) {
+    uv__close(loop->epoll_fd);
+    loop->epoll_fd = -1;
+  }
+
+  /* Without it uv__epoll_start() fails and libev takes every watcher. */
+  if (loop->epoll_fd == -1)
+    return;
+
+  ev_io_init(&loop->epoll_watcher, uv__epoll_io, loop->epoll_fd, EV_READ);
+  ev_io_start(loop->ev, &loop->epoll_watcher);
+
+  /* Only the watchers in the set keep the loop alive, not the set itself. */
+  ev_unref(loop->ev);
+}
+
+
+void uv__epoll_destroy(uv_loop_t* loop) {
+  if (loop->epoll_fd == -1)
+    return;
+
+  ev_ref(loop->ev);
+  ev_io_stop(loop->ev, &loop->epoll_watcher);
+  uv__close(loop->epoll_fd);
+  loop->epoll_fd = -1;
+}
+
+
+/* The epoll events of the handle's fd, from its active watchers. */
+static uint32_t uv__epoll_events(uv_handle_t* handle) {
+  uint32_t events;
+  ev_io* w[2];
+  int i, n;
+
+  events = 0;
+  n = uv__handle_io_watchers(handle, w);
+
+  for (i = 0; i < n; i++) {
+    if (!ev_is_active(w[i]))
+      continue;
+    if (w[i]->events & EV_READ)
+      events |= EPOLLIN;
+    if (w[i]->events & EV_WRITE)
+      events |= EPOLLOUT;
+  }
+
+  return events;
+}
+
+
+static int uv__epoll_ctl(uv_handle_t* handle, int fd, uint32_t old) {
+  struct epoll_event e;
+  int op;
+
+  e.events = uv__epoll_events(handle);
+  e.data.ptr = handle;
+
+  if (e.events == old)
+    return 0;
+
+  if (old == 0)
+    op = EPOLL_CTL_ADD;
+  else if (e.events == 0)
+    op = EPOLL_CTL_DEL;
+  else
+    op = EPOLL_CTL_MOD;
+
+  if (epoll_ctl(handle->loop->epoll_fd, op, fd, &e) == 0)
+    return 0;
+
+  /* The fd was closed and reused under the set's feet, or closed already. */
+  if (op == EPOLL_CTL_ADD && errno == EEXIST)
+    op = EPOLL_CTL_MOD;
+  else if (op == EPOLL_CTL_MOD && errno == ENOENT)
+    op = EPOLL_CTL_ADD;
+  else if (op == EPOLL_CTL_DEL)
+    return 0;
+  else
+    return -1;
+
+  return epoll_ctl(handle->loop->epoll_fd, op, fd, &e);
+}
+
+
+int uv__epoll_start(uv_handle_t* handle, ev_io* w) {
+  uv_loop_t* loop;
+  uint32_t old;
+
+  loop = handle->loop;
+
+  if (loop->epoll_fd == -1)
+    return -1;
+
+  old = uv__epoll_events(handle);
+  w->active = 1;
+
+  if (uv__epoll_ctl(handle, w->fd, old)) {
+    w->active = 0;
+
+    /* libev can only take over while no other watcher of the fd is here. */
+    if (old == 0)
+      return -1;
+
+    uv_fatal_error(errno, "epoll_ctl");
+  }
+
+  ev_ref(loop->ev);
+
+  return 0;
+}
+
+
+void uv__epoll_stop(uv_handle_t* handle, ev_io* w) {
+  uv_loop_t* loop;
+  uint32_t old;
+
+  loop = handle->loop;
+
+  old = uv__epoll_events(handle);
+  w->active = 0;
+  ev_clear_pending(loop->ev, w);
+
+  if (uv__epoll_ctl(handle, w->fd, old))
+    uv_fatal_error(errno, "epoll_ctl");
+
+  ev_unref(loop->ev);
+}
+
+#endif /* HAVE_EPOLL */
+
+
 static int new_inotify_fd(void) {
 #if defined(IN_NONBLOCK) && defined(IN_CLOEXEC)
   return inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
@@ -102,12 +286,157 @@ static int new_inotify_fd(void) {
 }
 
 
+static const int uv__inotify_events = IN_ATTRIB
+                                    | IN_CREATE
+                                    | IN_MODIFY
+                                    | IN_DELETE
+                                    | IN_DELETE_SELF
+                                    | IN_MOVED_FROM
+                                    | IN_MOVED_TO;
+
+
+/* The path of `relpath` under the watched directory, or "" if too long. */
+static char* uv__inotify_join(const char* dir, const char* relpath,
+    char* buf, size_t size) {
+  int n;
+
+  if (*relpath == '\0')
+    n = snprintf(buf, size, "%s", dir);
+  else if (*dir == '\0')
+    n = snprintf(buf, size, "%s", relpath);
+  else
+    n = snprintf(buf, size, "%s/%s", dir, relpath);
+
+  if (n < 0 || (size_t) n >= size)
+    buf[0] = '\0';
+
+  return buf;
+}
+
+
+static int uv__inotify_set_path(uv_fs_event_t* handle, int wd,
+    const char* relpath) {
+  char** paths;
+  int len;
+
+  if (wd >= handle->watch_paths_len) {
+    len = wd + 16;
+    paths = realloc(handle->watch_paths, len * sizeof(*paths));
+    if (paths == NULL)
+      return -1;
+    memset(paths + handle->watch_paths_len, 0,
+           (len - handle->watch_paths_len) * sizeof(*paths));
+    handle->watch_paths = paths;
+    handle->watch_paths_len = len;
+  }
+
+  /* The same directory under another name. */
+  free(handle->watch_paths[wd]);
+  handle->watch_paths[wd] = strdup(relpath);
+  return 0;
+}
+
+
+/*
+ * Watches the directories under `relpath`, and `relpath` itself unless it
+ * is the watched directory, which already is. Goes depth first with a stack
+ * of its own, and skips what can't be watched: symlinks, directories that
+ * are gone by now or that we may not read.
+ */
+static void uv__inotify_add_tree(uv_fs_event_t* handle, const char* relpath) {
+  char path[PATH_MAX];
+  char child[PATH_MAX];
+  char** stack;
+  char** grown;
+  char* dirpath;
+  struct dirent* d;
+  DIR* dir;
+  int size;
+  int top;
+  int wd;
+
+  size = 16;
+  stack = malloc(size * sizeof(*stack));
+  if (stack == NULL)
+    return;
+
+  top = 0;
+  stack[top++] = strdup(relpath);
+
+  while (top > 0) {
+    dirpath = stack[--top];
+    if (dirpath == NULL)
+      continue;
+
+    uv__inotify_join(handle->filename, dirpath, path, sizeof path);
+
+    if (*dirpath != '\0') {
+      wd = inotify_add_watch(handle->fd, path,
+          uv__inotify_events | IN_ONLYDIR | IN_DONT_FOLLOW);
+      if (wd == -1 || uv__inotify_set_path(handle, wd, dirpath)) {
+        free(dirpath);
+        continue;
+      }
+    }
+
+    dir = path[0] ? opendir(path) : NULL;
+    while (dir != NULL && (d = readdir(dir)) != NULL) {
+      if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+        continue;
+#ifdef DT_DIR
+      /* Others fail inotify_add_watch() with ENOTDIR. */
+      if (d->d_type != DT_DIR && d->d_type != DT_UNKNOWN)
+        continue;
+#endif
+      uv__inotify_join(dirpath, d->d_name, child, sizeof child);
+      if (child[0] == '\0')
+        continue;
+
+      if (top == size) {
+        grown = realloc(stack, 2 * size * sizeof(*stack));
+        if (grown == NULL)
+          break;
+        stack = grown;
+        size *= 2;
+      }
+      stack[top++] = strdup(child);
+    }
+
+    if (dir != NULL)
+      closedir(dir);
+    free(dirpath);
+  }
+
+  free(stack);
+}
+
+
+/* Stops watching `relpath` and what's under it, which moved away. */
+static void uv__inotify_remove_tree(uv_fs_event_t* handle,
+    const char* relpath) {
+  size_t len;
+  char* p;
+  int wd;
+
+  len = strlen(relpath);
+
+  for (wd = 0; wd < handle->watch_paths_len; wd++) {
+    p = handle->watch_paths[wd];
+    if (p && strncmp(p, relpath, len) == 0 && (p[len] == '\0' || p[len] == '/'))
+      inotify_rm_watch(handle->fd, wd);  /* IN_IGNORED frees the path */
+  }
+}
+
+
 static void uv__inotify_read(EV_P_ ev_io* w, int revents) {
   struct inotify_event* e;
   uv_fs_event_t* handle;
   const char* filename;
+  const char* dirpath;
+  char path[PATH_MAX];
   ssize_t size;
   int events;
+  int mask;
   char *p;
   /* needs to be large enough for sizeof(inotify_event) + strlen(filename) */
   char buf[4096];
@@ -131,10 +460,13 @@ static void uv__inotify_read(EV_P_ ev_io* w, int revents) {
     for (p = buf; p < buf + size; p += sizeof(*e) + e->len) {
       e = (void*)p;
 
+      /* IN_ISDIR only says what the event is about. */
+      mask = e->mask & ~IN_ISDIR;
+
       events = 0;
-      if (e->mask & (IN_ATTRIB|IN_MODIFY))
+      if (mask & (IN_ATTRIB|IN_MODIFY))
         events |= UV_CHANGE;
-      if (e->mask & ~(IN_ATTRIB|IN_MODIFY))
+      if (mask & ~(IN_ATTRIB|IN_MODIFY))
         events |= UV_RENAME;
 
       /* inotify does not return the filename when monitoring a single file
@@ -143,6 +475,35 @@ static void uv__inotify_read(EV_P_ ev_io* w, int revents) {
        */
       filename = e->len ? e->name : basename_r(handle->filename);
 
+      if (handle->watch_paths != NULL) {
+        dirpath = NULL;
+        if (e->wd >= 0 && e->wd < handle->watch_paths_len)
+          dirpath = handle->watch_paths[e->wd];
+
+        if (mask & IN_IGNORED) {
+          if (dirpath != NULL) {
+            free(handle->watch_paths[e->wd]);
+            handle->watch_paths[e->wd] = NULL;
+          }
+          continue;
+        }
+
+        if (dirpath != NULL && *dirpath != '\0') {
+          /* The parent reports what happens to the directory itself. */
+          if (e->len == 0)
+            continue;
+          filename = uv__inotify_join(dirpath, e->name, path, sizeof path);
+        }
+
+        if (dirpath != NULL && e->len && (e->mask & IN_ISDIR)) {
+          uv__inotify_join(dirpath, e->name, path, sizeof path);
+          if (mask & (IN_CREATE|IN_MOVED_TO))
+            uv__inotify_add_tree(handle, path);
+          else if (mask & IN_MOVED_FROM)
+            uv__inotify_remove_tree(handle, path);
+        }
+      }
+
       handle->cb(handle, filename, events, 0);
 
       if (handle->fd == -1)
@@ -158,11 +519,13 @@ int uv_fs_event_init(uv_loop_t* loop,
                      const char* filename,
                      uv_fs_event_cb cb,
                      int flags) {
-  int events;
   int fd;
+  int wd;
 
-  /* We don't support any flags yet. */
-  assert(!flags);
+  if (flags & ~UV_FS_EVENT_RECURSIVE) {
+    uv__set_artificial_error(loop, UV_ENOSYS);
+    return -1;
+  }
 
   /*
    * TODO share a single inotify fd across the event loop?
@@ -174,15 +537,7 @@ int uv_fs_event_init(uv_loop_t* loop,
     return -1;
   }
 
-  events = IN_ATTRIB
-         | IN_CREATE
-         | IN_MODIFY
-         | IN_DELETE
-         | IN_DELETE_SELF
-         | IN_MOVED_FROM
-         | IN_MOVED_TO;
-
-  if (inotify_add_watch(fd, filename, events) == -1) {
+  if ((wd = inotify_add_watch(fd, filename, uv__inotify_events)) == -1) {
     uv__set_sys_error(loop, errno);
     uv__close(fd);
     return -1;
@@ -192,6 +547,21 @@ int uv_fs_event_init(uv_loop_t* loop,
   handle->filename = strdup(filename); /* this should go! */
   handle->cb = cb;
   handle->fd = fd;
+  handle->watch_paths = NULL;
+  handle->watch_paths_len = 0;
+
+  /* A recursive watcher has every directory under this one on the same fd,
+   * and tells them apart by watch descriptor. */
+  if (flags & UV_FS_EVENT_RECURSIVE) {
+    if (uv__inotify_set_path(handle, wd, "")) {
+      uv__set_sys_error(loop, ENOMEM);
+      uv__close(fd);
+      free(handle->filename);
+      handle->filename = NULL;
+      return -1;
+    }
+    uv__inotify_add_tree(handle, "");
+  }
 
   ev_io_init(&handle->read_watcher, uv__inotify_read, fd, EV_READ);
   ev_io_start(loop->ev, &handle->read_watcher);
@@ -201,9 +571,17 @@ int uv_fs_event_init(uv_loop_t* loop,
 
 
 void uv__fs_event_destroy(uv_fs_event_t* handle) {
+  int wd;
+
   ev_io_stop(handle->loop->ev, &handle->read_watcher);
   uv__close(handle->fd);
   handle->fd = -1;
   free(handle->filename);
   handle->filename = NULL;
+
+  for (wd = 0; wd < handle->watch_paths_len; wd++)
+    free(handle->watch_paths[wd]);
+  free(handle->watch_paths);
+  handle->watch_paths = NULL;
+  handle->watch_paths_len = 0;
 }
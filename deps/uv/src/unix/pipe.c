@@ -137,7 +137,7 @@ int uv_pipe_listen(uv_pipe_t* handle, int backlog, uv_connection_cb cb) {
   } else {
     handle->connection_cb = cb;
     ev_io_init(&handle->read_watcher, uv__pipe_accept, handle->fd, EV_READ);
-    ev_io_start(handle->loop->ev, &handle->read_watcher);
+    uv__io_start((uv_handle_t*)handle, &handle->read_watcher);
   }
 
 out:
@@ -216,14 +216,15 @@ void uv_pipe_connect(uv_connect_t* req,
 
   uv__stream_open((uv_stream_t*)handle, sockfd, UV_READABLE | UV_WRITABLE);
 
-  ev_io_start(handle->loop->ev, &handle->read_watcher);
-  ev_io_start(handle->loop->ev, &handle->write_watcher);
+  uv__io_start((uv_handle_t*)handle, &handle->read_watcher);
+  uv__io_start((uv_handle_t*)handle, &handle->write_watcher);
 
   status = 0;
 
 out:
   handle->delayed_error = status; /* Passed to callback. */
   handle->connect_req = req;
+  uv__req_latency_start(handle->loop, (uv_req_t*)req, UV_LATENCY_CONNECT);
   req->handle = (uv_stream_t*)handle;
   req->type = UV_CONNECT;
   req->cb = cb;
@@ -265,7 +266,7 @@ void uv__pipe_accept(EV_P_ ev_io* watcher, int revents) {
     pipe->connection_cb((uv_stream_t*)pipe, 0);
     if (pipe->accepted_fd == sockfd) {
       /* The user hasn't yet accepted called uv_accept() */
-      ev_io_stop(pipe->loop->ev, &pipe->read_watcher);
+      uv__io_stop((uv_handle_t*)pipe, &pipe->read_watcher);
     }
   }
 
@@ -26,10 +26,14 @@
 #include <errno.h>
 #include <sys/wait.h>
 #include <fcntl.h> /* O_CLOEXEC, O_NONBLOCK */
+#include <limits.h> /* PATH_MAX */
 #include <poll.h>
+#include <signal.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef __APPLE__
 # include <crt_externs.h>
@@ -158,10 +162,241 @@ static int uv__process_init_pipe(uv_pipe_t* handle, int fds[2], int flags) {
 }
 
 
+/*
+ * fork() copies the parent's page tables, which for a process with a large
+ * heap takes milliseconds. vfork() shares the parent's memory until the
+ * child calls execve() or exits instead, so the cost no longer depends on
+ * the size of the parent. Define UV_SPAWN_USE_FORK to always use fork().
+ */
+#if defined(__linux__) && !defined(UV_SPAWN_USE_FORK)
+# define UV__SPAWN_VFORK 1
+#else
+# define UV__SPAWN_VFORK 0
+#endif
+
+/* vfork() returns only after the child has exec'd, see below. */
 #ifndef SPAWN_WAIT_EXEC
-# define SPAWN_WAIT_EXEC 1
+# define SPAWN_WAIT_EXEC (!UV__SPAWN_VFORK)
+#endif
+
+#ifndef PATH_MAX
+# define PATH_MAX 4096
+#endif
+
+#ifndef NSIG
+# define NSIG 32
 #endif
 
+/* Arguments a script without #! line can be run with, see uv__exec_script. */
+#define UV__SCRIPT_ARGS_MAX 256
+
+
+/*
+ * Like perror() but without stdio. A vfork()'d child must not take locks
+ * that another thread of the parent may hold.
+ */
+static void uv__child_error(const char* what) {
+  const char* msg = strerror(errno);
+  ssize_t r;
+
+  r = write(STDERR_FILENO, what, strlen(what));
+  r = write(STDERR_FILENO, ": ", 2);
+  r = write(STDERR_FILENO, msg, strlen(msg));
+  r = write(STDERR_FILENO, "\n", 1);
+  (void) r;
+}
+
+
+/* Sets up stdio and the working directory of a freshly forked child. */
+static void uv__process_child_init(uv_process_options_t* options,
+    int stdin_pipe[2], int stdout_pipe[2], int stderr_pipe[2]) {
+  if (stdin_pipe[0] >= 0) {
+    uv__close(stdin_pipe[1]);
+    dup2(stdin_pipe[0],  STDIN_FILENO);
+  } else {
+    /* Reset flags that might be set by Node */
+    uv__cloexec(STDIN_FILENO, 0);
+    uv__nonblock(STDIN_FILENO, 0);
+  }
+
+  if (stdout_pipe[1] >= 0) {
+    uv__close(stdout_pipe[0]);
+    dup2(stdout_pipe[1], STDOUT_FILENO);
+  } else {
+    /* Reset flags that might be set by Node */
+    uv__cloexec(STDOUT_FILENO, 0);
+    uv__nonblock(STDOUT_FILENO, 0);
+  }
+
+  if (stderr_pipe[1] >= 0) {
+    uv__close(stderr_pipe[0]);
+    dup2(stderr_pipe[1], STDERR_FILENO);
+  } else {
+    /* Reset flags that might be set by Node */
+    uv__cloexec(STDERR_FILENO, 0);
+    uv__nonblock(STDERR_FILENO, 0);
+  }
+
+  if (options->cwd && chdir(options->cwd)) {
+    uv__child_error("chdir()");
+    _exit(127);
+  }
+}
+
+
+#if UV__SPAWN_VFORK
+
+/* What execvp() does for files that are not executables: run them with sh. */
+static void uv__exec_script(const char* path, char** args, char** env) {
+  char* argv[UV__SCRIPT_ARGS_MAX];
+  int i;
+
+  argv[0] = (char*) "/bin/sh";
+  argv[1] = (char*) path;
+
+  for (i = 1; args[i]; i++) {
+    if (i + 1 >= UV__SCRIPT_ARGS_MAX) {
+      errno = E2BIG;
+      return;
+    }
+    argv[i + 1] = args[i];
+  }
+  argv[i + 1] = NULL;
+
+  execve("/bin/sh", argv, env);
+}
+
+
+/*
+ * execvp() with the child's environment. The fork() path can point environ
+ * at options.env before calling execvp() but in a vfork()'d child that
+ * would change environ for every thread of the parent.
+ */
+static void uv__execvpe(const char* file, char** args, char** env) {
+  char buf[PATH_MAX];
+  const char* path;
+  const char* p;
+  const char* end;
+  size_t flen;
+  size_t dlen;
+  int eacces;
+  char** e;
+
+  if (strchr(file, '/')) {
+    execve(file, args, env);
+    if (errno == ENOEXEC)
+      uv__exec_script(file, args, env);
+    return;
+  }
+
+  path = NULL;
+  for (e = env; e && *e; e++) {
+    if (strncmp(*e, "PATH=", 5) == 0) {
+      path = *e + 5;
+      break;
+    }
+  }
+
+  if (path == NULL)
+    path = "/bin:/usr/bin";
+
+  flen = strlen(file);
+  eacces = 0;
+
+  for (p = path; ; p = end + 1) {
+    end = strchr(p, ':');
+    if (end == NULL)
+      end = p + strlen(p);
+
+    dlen = end - p;
+
+    if (dlen + flen + 2 <= sizeof(buf)) {
+      /* An empty entry means the current directory. */
+      if (dlen == 0) {
+        memcpy(buf, file, flen + 1);
+      } else {
+        memcpy(buf, p, dlen);
+        buf[dlen] = '/';
+        memcpy(buf + dlen + 1, file, flen + 1);
+      }
+
+      execve(buf, args, env);
+
+      if (errno == ENOEXEC)
+        uv__exec_script(buf, args, env);
+
+      if (errno == EACCES)
+        eacces = 1;
+      else if (errno != ENOENT && errno != ENOTDIR)
+        return;
+    }
+
+    if (*end == '\0')
+      break;
+  }
+
+  if (eacces)
+    errno = EACCES;
+}
+
+
+/*
+ * Signal handlers are inherited by the child until it execs. With vfork()
+ * they would run on the parent's memory, so all signals are blocked around
+ * the vfork() and the child puts caught signals back to their defaults
+ * before it unblocks them.
+ */
+static void uv__vfork_child_signals(const sigset_t* oldmask) {
+  struct sigaction act;
+  int sig;
+
+  for (sig = 1; sig < NSIG; sig++) {
+    if (sigaction(sig, NULL, &act))
+      continue;
+
+    if (act.sa_handler == SIG_DFL || act.sa_handler == SIG_IGN)
+      continue;
+
+    act.sa_handler = SIG_DFL;
+    act.sa_flags = 0;
+    sigemptyset(&act.sa_mask);
+    sigaction(sig, &act, NULL);
+  }
+
+  sigprocmask(SIG_SETMASK, oldmask, NULL);
+}
+
+
+static pid_t uv__vfork_exec(uv_process_options_t* options, char** env,
+    int stdin_pipe[2], int stdout_pipe[2], int stderr_pipe[2]) {
+  sigset_t all;
+  sigset_t oldmask;
+  pid_t pid;
+  int saved_errno;
+
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &oldmask);
+
+  pid = vfork();
+
+  if (pid == 0) {
+    uv__process_child_init(options, stdin_pipe, stdout_pipe, stderr_pipe);
+    uv__vfork_child_signals(&oldmask);
+    uv__execvpe(options->file, options->args, env);
+    uv__child_error("execvp()");
+    _exit(127);
+    /* Execution never reaches here. */
+  }
+
+  saved_errno = errno;
+  pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+  errno = saved_errno;
+
+  return pid;
+}
+
+#endif /* UV__SPAWN_VFORK */
+
 int uv_spawn(uv_loop_t* loop, uv_process_t* process,
     uv_process_options_t options) {
   /*
@@ -175,8 +410,8 @@ int uv_spawn(uv_loop_t* loop, uv_process_t* process,
 #if SPAWN_WAIT_EXEC
   int signal_pipe[2] = { -1, -1 };
   struct pollfd pfd;
-#endif
   int status;
+#endif
   pid_t pid;
   int flags;
 
@@ -225,6 +460,21 @@ int uv_spawn(uv_loop_t* loop, uv_process_t* process,
     goto error;
 #endif
 
+#if UV__SPAWN_VFORK
+  pid = uv__vfork_exec(&options,
+                       options.env ? options.env : save_our_env,
+                       stdin_pipe,
+                       stdout_pipe,
+                       stderr_pipe);
+
+  if (pid == -1) {
+#if SPAWN_WAIT_EXEC
+    uv__close(signal_pipe[0]);
+    uv__close(signal_pipe[1]);
+#endif
+    goto error;
+  }
+#else
   pid = fork();
 
   if (pid == -1) {
@@ -237,37 +487,7 @@ int uv_spawn(uv_loop_t* loop, uv_process_t* process,
   }
 
   if (pid == 0) {
-    if (stdin_pipe[0] >= 0) {
-      uv__close(stdin_pipe[1]);
-      dup2(stdin_pipe[0],  STDIN_FILENO);
-    } else {
-      /* Reset flags that might be set by Node */
-      uv__cloexec(STDIN_FILENO, 0);
-      uv__nonblock(STDIN_FILENO, 0);
-    }
-
-    if (stdout_pipe[1] >= 0) {
-      uv__close(stdout_pipe[0]);
-      dup2(stdout_pipe[1], STDOUT_FILENO);
-    } else {
-      /* Reset flags that might be set by Node */
-      uv__cloexec(STDOUT_FILENO, 0);
-      uv__nonblock(STDOUT_FILENO, 0);
-    }
-
-    if (stderr_pipe[1] >= 0) {
-      uv__close(stderr_pipe[0]);
-      dup2(stderr_pipe[1], STDERR_FILENO);
-    } else {
-      /* Reset flags that might be set by Node */
-      uv__cloexec(STDERR_FILENO, 0);
-      uv__nonblock(STDERR_FILENO, 0);
-    }
-
-    if (options.cwd && chdir(options.cwd)) {
-      perror("chdir()");
-      _exit(127);
-    }
+    uv__process_child_init(&options, stdin_pipe, stdout_pipe, stderr_pipe);
 
     environ = options.env;
 
@@ -281,6 +501,7 @@ int uv_spawn(uv_loop_t* loop, uv_process_t* process,
 
   /* Restore environment. */
   environ = save_our_env;
+#endif
 
 #if SPAWN_WAIT_EXEC
   /* POLLHUP signals child has exited or execve()'d. */
@@ -346,6 +567,65 @@ error:
   return -1;
 }
 
+int uv_fork(uv_loop_t* loop, uv_process_t* process, uv_exit_cb exit_cb,
+    uv_pipe_t* channel) {
+  int fds[2] = { -1, -1 };
+  pid_t pid;
+
+  uv__handle_init(loop, (uv_handle_t*)process, UV_PROCESS);
+  loop->counters.process_init++;
+
+  process->exit_cb = exit_cb;
+  process->pid = 0;
+
+  /* The child would wait forever for requests queued to threads it lacks. */
+  if (eio_nthreads() > 0) {
+    uv__set_artificial_error(loop, UV_EBUSY);
+    return -1;
+  }
+
+  if (channel && uv__make_socketpair(fds, UV__F_NONBLOCK))
+    goto error;
+
+  pid = fork();
+
+  if (pid == -1)
+    goto error;
+
+  if (pid == 0) {
+    /* The backend's descriptor is shared with the parent. */
+    ev_loop_fork(loop->ev);
+
+    if (channel) {
+      uv__close(fds[0]);
+      uv__stream_open((uv_stream_t*)channel, fds[1],
+          UV_READABLE | UV_WRITABLE);
+    }
+
+    return 0;
+  }
+
+  process->pid = pid;
+
+  ev_child_init(&process->child_watcher, uv__chld, pid, 0);
+  ev_child_start(process->loop->ev, &process->child_watcher);
+  process->child_watcher.data = process;
+
+  if (channel) {
+    uv__close(fds[1]);
+    uv__stream_open((uv_stream_t*)channel, fds[0], UV_READABLE | UV_WRITABLE);
+  }
+
+  return pid;
+
+error:
+  uv__set_sys_error(loop, errno);
+  uv__close(fds[0]);
+  uv__close(fds[1]);
+  return -1;
+}
+
+
 /* retrieves the shared handle, synchronously calling a user callback 
  * callback contains shared handle pointer, or NULL if thread has exited */
 int uv_thread_get_shared(uv_thread_t *thread, int (*cb)(uv_thread_shared_t *, void *), void *data) {
@@ -105,6 +105,11 @@ int uv__stream_open(uv_stream_t* stream, int fd, int flags) {
         uv__tcp_keepalive((uv_tcp_t*)stream, 1, 60)) {
       return -1;
     }
+
+    if ((stream->flags & UV_TCP_REUSEPORT) &&
+        uv__tcp_reuseport((uv_tcp_t*)stream, 1)) {
+      return -1;
+    }
   }
 
   /* Associate the fd with each ev_io watcher. */
@@ -125,6 +130,12 @@ void uv__stream_destroy(uv_stream_t* stream) {
 
   assert(stream->flags & UV_CLOSED);
 
+  /* A connect still in progress is dropped without its callback. */
+  if (stream->connect_req) {
+    uv__req_latency_done(stream->loop, (uv_req_t*)stream->connect_req,
+        UV_LATENCY_CONNECT);
+  }
+
   while (!ngx_queue_empty(&stream->write_queue)) {
     q = ngx_queue_head(&stream->write_queue);
     ngx_queue_remove(q);
@@ -133,6 +144,8 @@ void uv__stream_destroy(uv_stream_t* stream) {
     if (req->bufs != req->bufsml)
       free(req->bufs);
 
+    uv__req_latency_done(stream->loop, (uv_req_t*)req, UV_LATENCY_WRITE);
+
     if (req->cb) {
       uv__set_artificial_error(req->handle->loop, UV_EINTR);
       req->cb(req, -1);
@@ -144,6 +157,7 @@ void uv__stream_destroy(uv_stream_t* stream) {
     ngx_queue_remove(q);
 
     req = ngx_queue_data(q, uv_write_t, queue);
+    uv__req_latency_done(stream->loop, (uv_req_t*)req, UV_LATENCY_WRITE);
     if (req->cb) {
       uv__set_artificial_error(stream->loop, req->error);
       req->cb(req, req->error ? -1 : 0);
@@ -164,7 +178,7 @@ void uv__server_io(EV_P_ ev_io* watcher, int revents) {
   assert(!(stream->flags & UV_CLOSING));
 
   if (stream->accepted_fd >= 0) {
-    ev_io_stop(EV_A, &stream->read_watcher);
+    uv__io_stop((uv_handle_t*)stream, &stream->read_watcher);
     return;
   }
 
@@ -191,7 +205,7 @@ void uv__server_io(EV_P_ ev_io* watcher, int revents) {
       stream->connection_cb((uv_stream_t*)stream, 0);
       if (stream->accepted_fd >= 0) {
         /* The user hasn't yet accepted called uv_accept() */
-        ev_io_stop(stream->loop->ev, &stream->read_watcher);
+        uv__io_stop((uv_handle_t*)stream, &stream->read_watcher);
         return;
       }
     }
@@ -219,7 +233,14 @@ int uv_accept(uv_stream_t* server, uv_stream_t* client) {
     goto out;
   }
 
-  if (uv__stream_open(streamClient, streamServer->accepted_fd,
+  if (client->type == UV_UDP) {
+    /* Only a descriptor received over an IPC pipe can be a UDP socket. */
+    if (uv__udp_open((uv_udp_t*)client, streamServer->accepted_fd)) {
+      uv__close(streamServer->accepted_fd);
+      streamServer->accepted_fd = -1;
+      goto out;
+    }
+  } else if (uv__stream_open(streamClient, streamServer->accepted_fd,
         UV_READABLE | UV_WRITABLE)) {
     /* TODO handle error */
     uv__close(streamServer->accepted_fd);
@@ -227,7 +248,7 @@ int uv_accept(uv_stream_t* server, uv_stream_t* client) {
     goto out;
   }
 
-  ev_io_start(streamServer->loop->ev, &streamServer->read_watcher);
+  uv__io_start((uv_handle_t*)streamServer, &streamServer->read_watcher);
   streamServer->accepted_fd = -1;
   status = 0;
 
@@ -276,7 +297,7 @@ static void uv__drain(uv_stream_t* stream) {
   assert(!uv_write_queue_head(stream));
   assert(stream->write_queue_size == 0);
 
-  ev_io_stop(stream->loop->ev, &stream->write_watcher);
+  uv__io_stop((uv_handle_t*)stream, &stream->write_watcher);
 
   /* Shutdown? */
   if ((stream->flags & UV_SHUTTING) &&
@@ -472,7 +493,7 @@ start:
   assert(!stream->blocking);
 
   /* We're not done. */
-  ev_io_start(stream->loop->ev, &stream->write_watcher);
+  uv__io_start((uv_handle_t*)stream, &stream->write_watcher);
 }
 
 
@@ -488,6 +509,8 @@ static void uv__write_callbacks(uv_stream_t* stream) {
     req = ngx_queue_data(q, struct uv_write_s, queue);
     ngx_queue_remove(q);
 
+    uv__req_latency_done(stream->loop, (uv_req_t*)req, UV_LATENCY_WRITE);
+
     /* NOTE: call callback AFTER freeing the request data. */
     if (req->cb) {
       uv__set_artificial_error(stream->loop, req->error);
@@ -506,13 +529,44 @@ static void uv__write_callbacks(uv_stream_t* stream) {
 }
 
 
+/* Works out what kind of handle the descriptor received over an IPC pipe
+ * is. Descriptors that are none of TCP, pipe or UDP are closed.
+ */
+static uv_handle_type uv__pending_type(uv_stream_t* stream) {
+  struct sockaddr_storage ss;
+  socklen_t len;
+  int type;
+
+  memset(&ss, 0, sizeof ss);
+  len = sizeof ss;
+  if (getsockname(stream->accepted_fd, (struct sockaddr*)&ss, &len) == 0) {
+    len = sizeof type;
+    if (getsockopt(stream->accepted_fd, SOL_SOCKET, SO_TYPE, &type, &len))
+      type = -1;
+
+    if (type == SOCK_STREAM && ss.ss_family == AF_UNIX)
+      return UV_NAMED_PIPE;
+
+    if (ss.ss_family == AF_INET || ss.ss_family == AF_INET6) {
+      if (type == SOCK_STREAM)
+        return UV_TCP;
+      if (type == SOCK_DGRAM)
+        return UV_UDP;
+    }
+  }
+
+  uv__close(stream->accepted_fd);
+  stream->accepted_fd = -1;
+  return UV_UNKNOWN_HANDLE;
+}
+
+
 static void uv__read(uv_stream_t* stream) {
   uv_buf_t buf;
   ssize_t nread;
   struct msghdr msg;
   struct cmsghdr* cmsg;
   char cmsg_space[64];
-  struct ev_loop* ev = stream->loop->ev;
 
   /* XXX: Maybe instead of having UV_READING we just test if
    * tcp->read_cb is NULL or not?
@@ -555,7 +609,7 @@ static void uv__read(uv_stream_t* stream) {
       if (errno == EAGAIN) {
         /* Wait for the next one. */
         if (stream->flags & UV_READING) {
-          ev_io_start(ev, &stream->read_watcher);
+          uv__io_start((uv_handle_t*)stream, &stream->read_watcher);
         }
         uv__set_sys_error(stream->loop, EAGAIN);
 
@@ -583,7 +637,7 @@ static void uv__read(uv_stream_t* stream) {
     } else if (nread == 0) {
       /* EOF */
       uv__set_artificial_error(stream->loop, UV_EOF);
-      ev_io_stop(ev, &stream->read_watcher);
+      uv__io_stop((uv_handle_t*)stream, &stream->read_watcher);
 
       if (stream->read_cb) {
         stream->read_cb(stream, -1, buf);
@@ -626,7 +680,8 @@ static void uv__read(uv_stream_t* stream) {
 
 
         if (stream->accepted_fd >= 0) {
-          stream->read2_cb((uv_pipe_t*)stream, nread, buf, UV_TCP);
+          stream->read2_cb((uv_pipe_t*)stream, nread, buf,
+              uv__pending_type(stream));
         } else {
           stream->read2_cb((uv_pipe_t*)stream, nread, buf, UV_UNKNOWN_HANDLE);
         }
@@ -665,7 +720,7 @@ int uv_shutdown(uv_shutdown_t* req, uv_stream_t* stream, uv_shutdown_cb cb) {
   ((uv_handle_t*)stream)->flags |= UV_SHUTTING;
 
 
-  ev_io_start(stream->loop->ev, &stream->write_watcher);
+  uv__io_start((uv_handle_t*)stream, &stream->write_watcher);
 
   return 0;
 }
@@ -725,10 +780,11 @@ static void uv__stream_connect(uv_stream_t* stream) {
   }
 
   if (!error) {
-    ev_io_start(stream->loop->ev, &stream->read_watcher);
+    uv__io_start((uv_handle_t*)stream, &stream->read_watcher);
 
     /* Successful connection */
     stream->connect_req = NULL;
+    uv__req_latency_done(stream->loop, (uv_req_t*)req, UV_LATENCY_CONNECT);
     if (req->cb) {
       req->cb(req, 0);
     }
@@ -741,6 +797,7 @@ static void uv__stream_connect(uv_stream_t* stream) {
     uv__set_sys_error(stream->loop, error);
 
     stream->connect_req = NULL;
+    uv__req_latency_done(stream->loop, (uv_req_t*)req, UV_LATENCY_CONNECT);
     if (req->cb) {
       req->cb(req, -1);
     }
@@ -748,6 +805,34 @@ static void uv__stream_connect(uv_stream_t* stream) {
 }
 
 
+int uv_accept_next(uv_stream_t* server) {
+  struct sockaddr_storage addr;
+  int fd;
+
+  if (server->accepted_fd >= 0) {
+    return 1;
+  }
+
+  if (server->fd < 0) {
+    uv__set_sys_error(server->loop, EBADF);
+    return -1;
+  }
+
+  fd = uv__accept(server->fd, (struct sockaddr*)&addr, sizeof addr);
+
+  if (fd < 0) {
+    if (errno == EAGAIN) {
+      return 0;
+    }
+    uv__set_sys_error(server->loop, errno);
+    return -1;
+  }
+
+  server->accepted_fd = fd;
+  return 1;
+}
+
+
 int uv__connect(uv_connect_t* req, uv_stream_t* stream, struct sockaddr* addr,
     socklen_t addrlen, uv_connect_cb cb) { 
   int sockfd;
@@ -781,6 +866,11 @@ int uv__connect(uv_connect_t* req, uv_stream_t* stream, struct sockaddr* addr,
     return -1;
   }
 
+  if ((stream->flags & UV_TCP_FASTOPEN) &&
+      uv__tcp_fastopen_connect((uv_tcp_t*)stream)) {
+    return -1;
+  }
+
   stream->connect_req = req;
 
   do {
@@ -806,8 +896,10 @@ int uv__connect(uv_connect_t* req, uv_stream_t* stream, struct sockaddr* addr,
     }
   }
 
+  uv__req_latency_start(stream->loop, (uv_req_t*)req, UV_LATENCY_CONNECT);
+
   assert(stream->write_watcher.data == stream);
-  ev_io_start(stream->loop->ev, &stream->write_watcher);
+  uv__io_start((uv_handle_t*)stream, &stream->write_watcher);
 
   if (stream->delayed_error) {
     ev_feed_event(stream->loop->ev, &stream->write_watcher, EV_WRITE);
@@ -835,6 +927,19 @@ int uv_write2(uv_write_t* req, uv_stream_t* stream, uv_buf_t bufs[], int bufcnt,
       uv__set_sys_error(stream->loop, EOPNOTSUPP);
       return -1;
     }
+
+    /* A UDP socket is passed by its descriptor, like a stream. */
+    if (send_handle->type != UV_TCP &&
+        send_handle->type != UV_NAMED_PIPE &&
+        send_handle->type != UV_UDP) {
+      uv__set_sys_error(stream->loop, EOPNOTSUPP);
+      return -1;
+    }
+
+    if (send_handle->fd < 0) {
+      uv__set_sys_error(stream->loop, EBADF);
+      return -1;
+    }
   }
 
   empty_queue = (stream->write_queue_size == 0);
@@ -864,6 +969,7 @@ int uv_write2(uv_write_t* req, uv_stream_t* stream, uv_buf_t bufs[], int bufcnt,
 
   req->write_index = 0;
   stream->write_queue_size += uv__buf_count(bufs, bufcnt);
+  uv__req_latency_start(stream->loop, (uv_req_t*)req, UV_LATENCY_WRITE);
 
   /* Append the request to write_queue. */
   ngx_queue_insert_tail(&stream->write_queue, &req->queue);
@@ -887,7 +993,7 @@ int uv_write2(uv_write_t* req, uv_stream_t* stream, uv_buf_t bufs[], int bufcnt,
      */
     assert(!stream->blocking);
 
-    ev_io_start(stream->loop->ev, &stream->write_watcher);
+    uv__io_start((uv_handle_t*)stream, &stream->write_watcher);
   }
 
   return 0;
@@ -903,6 +1009,42 @@ int uv_write(uv_write_t* req, uv_stream_t* stream, uv_buf_t bufs[], int bufcnt,
 }
 
 
+int uv_try_write(uv_stream_t* stream, uv_buf_t bufs[], int bufcnt) {
+  ssize_t n;
+
+  if (stream->fd < 0) {
+    uv__set_sys_error(stream->loop, EBADF);
+    return -1;
+  }
+
+  /* Don't overtake queued writes or a pending connect. */
+  if (stream->write_queue_size != 0 || stream->connect_req) {
+    return 0;
+  }
+
+  assert(sizeof(uv_buf_t) == sizeof(struct iovec));
+
+  do {
+    if (bufcnt == 1) {
+      n = write(stream->fd, bufs[0].base, bufs[0].len);
+    } else {
+      n = writev(stream->fd, (struct iovec*) bufs, bufcnt);
+    }
+  }
+  while (n == -1 && errno == EINTR);
+
+  if (n < 0) {
+    if (errno == EAGAIN) {
+      return 0;
+    }
+    uv__set_sys_error(stream->loop, errno);
+    return -1;
+  }
+
+  return n;
+}
+
+
 int uv__read_start_common(uv_stream_t* stream, uv_alloc_cb alloc_cb,
     uv_read_cb read_cb, uv_read2_cb read2_cb) {
   assert(stream->type == UV_TCP || stream->type == UV_NAMED_PIPE ||
@@ -932,7 +1074,7 @@ int uv__read_start_common(uv_stream_t* stream, uv_alloc_cb alloc_cb,
   /* These should have been set by uv_tcp_init. */
   assert(stream->read_watcher.cb == uv__stream_io);
 
-  ev_io_start(stream->loop->ev, &stream->read_watcher);
+  uv__io_start((uv_handle_t*)stream, &stream->read_watcher);
   return 0;
 }
 
@@ -950,7 +1092,7 @@ int uv_read2_start(uv_stream_t* stream, uv_alloc_cb alloc_cb,
 
 
 int uv_read_stop(uv_stream_t* stream) {
-  ev_io_stop(stream->loop->ev, &stream->read_watcher);
+  uv__io_stop((uv_handle_t*)stream, &stream->read_watcher);
   stream->flags &= ~UV_READING;
   stream->read_cb = NULL;
   stream->read2_cb = NULL;
@@ -146,7 +146,10 @@ int uv_fs_event_init(uv_loop_t* loop,
   int portfd;
 
   /* We don't support any flags yet. */
-  assert(!flags);
+  if (flags) {
+    uv__set_artificial_error(loop, UV_ENOSYS);
+    return -1;
+  }
 
   if ((portfd = port_create()) == -1) {
     uv__set_sys_error(loop, errno);
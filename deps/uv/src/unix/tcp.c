@@ -200,7 +200,7 @@ int uv_tcp_listen(uv_tcp_t* tcp, int backlog, uv_connection_cb cb) {
   /* Start listening for connections. */
   ev_io_set(&tcp->read_watcher, tcp->fd, EV_READ);
   ev_set_cb(&tcp->read_watcher, uv__server_io);
-  ev_io_start(tcp->loop->ev, &tcp->read_watcher);
+  uv__io_start((uv_handle_t*)tcp, &tcp->read_watcher);
 
   return 0;
 }
@@ -291,6 +291,24 @@ int uv__tcp_keepalive(uv_tcp_t* handle, int enable, unsigned int delay) {
 }
 
 
+int uv__tcp_reuseport(uv_tcp_t* handle, int enable) {
+#ifdef SO_REUSEPORT
+  if (setsockopt(handle->fd,
+                 SOL_SOCKET,
+                 SO_REUSEPORT,
+                 &enable,
+                 sizeof enable) == -1) {
+    uv__set_sys_error(handle->loop, errno);
+    return -1;
+  }
+  return 0;
+#else
+  uv__set_sys_error(handle->loop, ENOTSUP);
+  return -1;
+#endif
+}
+
+
 int uv_tcp_nodelay(uv_tcp_t* handle, int enable) {
   if (handle->fd != -1 && uv__tcp_nodelay(handle, enable))
     return -1;
@@ -321,6 +339,109 @@ int uv_tcp_keepalive(uv_tcp_t* handle, int enable, unsigned int delay) {
 }
 
 
+int uv_tcp_reuseport(uv_tcp_t* handle, int enable) {
+#ifndef SO_REUSEPORT
+  uv__set_sys_error(handle->loop, ENOTSUP);
+  return -1;
+#endif
+
+  if (handle->fd != -1 && uv__tcp_reuseport(handle, enable))
+    return -1;
+
+  if (enable)
+    handle->flags |= UV_TCP_REUSEPORT;
+  else
+    handle->flags &= ~UV_TCP_REUSEPORT;
+
+  return 0;
+}
+
+
+int uv_tcp_defer_accept(uv_tcp_t* handle, unsigned int timeout) {
+#ifdef TCP_DEFER_ACCEPT
+  if (handle->fd < 0) {
+    uv__set_sys_error(handle->loop, EINVAL);
+    return -1;
+  }
+
+  if (setsockopt(handle->fd,
+                 IPPROTO_TCP,
+                 TCP_DEFER_ACCEPT,
+                 &timeout,
+                 sizeof timeout) == -1) {
+    uv__set_sys_error(handle->loop, errno);
+    return -1;
+  }
+
+  return 0;
+#else
+  uv__set_sys_error(handle->loop, ENOTSUP);
+  return -1;
+#endif
+}
+
+
+int uv__tcp_fastopen_connect(uv_tcp_t* handle) {
+#ifdef TCP_FASTOPEN_CONNECT
+  int yes = 1;
+
+  if (setsockopt(handle->fd,
+                 IPPROTO_TCP,
+                 TCP_FASTOPEN_CONNECT,
+                 &yes,
+                 sizeof yes) == -1) {
+    uv__set_sys_error(handle->loop, errno);
+    return -1;
+  }
+
+  return 0;
+#else
+  uv__set_sys_error(handle->loop, ENOTSUP);
+  return -1;
+#endif
+}
+
+
+int uv_tcp_fastopen(uv_tcp_t* handle, int qlen) {
+  if (handle->connection_cb == NULL) {
+    /* Not listening. Takes effect on uv_tcp_connect(). */
+#ifndef TCP_FASTOPEN_CONNECT
+    uv__set_sys_error(handle->loop, ENOTSUP);
+    return -1;
+#endif
+
+    if (qlen > 0)
+      handle->flags |= UV_TCP_FASTOPEN;
+    else
+      handle->flags &= ~UV_TCP_FASTOPEN;
+
+    return 0;
+  }
+
+#ifdef TCP_FASTOPEN
+  if (setsockopt(handle->fd,
+                 IPPROTO_TCP,
+                 TCP_FASTOPEN,
+                 &qlen,
+                 sizeof qlen) == -1) {
+    uv__set_sys_error(handle->loop, errno);
+    return -1;
+  }
+
+  return 0;
+#else
+  uv__set_sys_error(handle->loop, ENOTSUP);
+  return -1;
+#endif
+}
+
+
 int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
   return 0;
 }
+
+
+int uv_tcp_pending_accepts(uv_tcp_t* handle, unsigned int initial,
+    unsigned int max) {
+  return 0;
+}
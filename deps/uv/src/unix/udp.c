@@ -32,11 +32,13 @@ static void uv__udp_watcher_start(uv_udp_t* handle, ev_io* w);
 static void uv__udp_run_completed(uv_udp_t* handle);
 static void uv__udp_run_pending(uv_udp_t* handle);
 static void uv__udp_recvmsg(uv_udp_t* handle);
+static void uv__udp_recvmmsg(uv_udp_t* handle);
 static void uv__udp_sendmsg(uv_udp_t* handle);
 static void uv__udp_io(EV_P_ ev_io* w, int events);
 static int uv__udp_maybe_deferred_bind(uv_udp_t* handle, int domain);
 static int uv__udp_send(uv_udp_send_t* req, uv_udp_t* handle, uv_buf_t bufs[],
-    int bufcnt, struct sockaddr* addr, socklen_t addrlen, uv_udp_send_cb send_cb);
+    int bufcnt, struct sockaddr* addr, socklen_t addrlen, uv_udp_send_cb send_cb,
+    int batch);
 
 
 static void uv__udp_watcher_start(uv_udp_t* handle, ev_io* w) {
@@ -50,7 +52,7 @@ static void uv__udp_watcher_start(uv_udp_t* handle, ev_io* w) {
   w->data = handle;
   ev_set_cb(w, uv__udp_io);
   ev_io_set(w, handle->fd, flags);
-  ev_io_start(handle->loop->ev, w);
+  uv__io_start((uv_handle_t*)handle, w);
 }
 
 
@@ -62,7 +64,7 @@ void uv__udp_watcher_stop(uv_udp_t* handle, ev_io* w) {
 
   flags = (w == &handle->read_watcher ? EV_READ : EV_WRITE);
 
-  ev_io_stop(handle->loop->ev, w);
+  uv__io_stop((uv_handle_t*)handle, w);
   ev_io_set(w, -1, flags);
   ev_set_cb(w, NULL);
   w->data = (void*)0xDEADBABE;
@@ -90,6 +92,7 @@ void uv__udp_destroy(uv_udp_t* handle) {
   /* Now tear down the handle. */
   handle->flags = 0;
   handle->recv_cb = NULL;
+  handle->recv_batch_cb = NULL;
   handle->alloc_cb = NULL;
   /* but _do not_ touch close_cb */
 
@@ -103,6 +106,83 @@ void uv__udp_destroy(uv_udp_t* handle) {
 }
 
 
+/* Sends what is left of a batch request, one datagram per buffer. Returns
+ * -1 if the socket would block, 0 once the request is done.
+ */
+static int uv__udp_run_batch(uv_udp_t* handle, uv_udp_send_t* req) {
+  struct msghdr h;
+  ssize_t size;
+
+#if HAVE_SYS_SENDMMSG
+  static int no_sendmmsg;
+  struct uv__mmsghdr mmsg[UV_UDP_BATCH_MAX];
+  int i;
+  int n;
+  int r;
+
+  while (!no_sendmmsg && req->nsent < req->bufcnt) {
+    n = req->bufcnt - req->nsent;
+    if (n > UV_UDP_BATCH_MAX)
+      n = UV_UDP_BATCH_MAX;
+
+    for (i = 0; i < n; i++) {
+      memset(&mmsg[i], 0, sizeof mmsg[i]);
+      mmsg[i].msg_hdr.msg_name = &req->addr;
+      mmsg[i].msg_hdr.msg_namelen = req->addrlen;
+      mmsg[i].msg_hdr.msg_iov = (struct iovec*)&req->bufs[req->nsent + i];
+      mmsg[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    do {
+      r = sys_sendmmsg(handle->fd, mmsg, n, 0);
+    }
+    while (r == -1 && errno == EINTR);
+
+    if (r == -1) {
+      if (errno == ENOSYS) {
+        /* a kernel from before 3.0 */
+        no_sendmmsg = 1;
+        break;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return -1;
+      req->status = -errno;
+      return 0;
+    }
+
+    for (i = 0; i < r; i++)
+      req->status += mmsg[i].msg_len;
+    req->nsent += r;
+  }
+#endif
+
+  while (req->nsent < req->bufcnt) {
+    memset(&h, 0, sizeof h);
+    h.msg_name = &req->addr;
+    h.msg_namelen = req->addrlen;
+    h.msg_iov = (struct iovec*)&req->bufs[req->nsent];
+    h.msg_iovlen = 1;
+
+    do {
+      size = sendmsg(handle->fd, &h, 0);
+    }
+    while (size == -1 && errno == EINTR);
+
+    if (size == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return -1;
+      req->status = -errno;
+      return 0;
+    }
+
+    req->status += size;
+    req->nsent++;
+  }
+
+  return 0;
+}
+
+
 static void uv__udp_run_pending(uv_udp_t* handle) {
   uv_udp_send_t* req;
   ngx_queue_t* q;
@@ -116,6 +196,15 @@ static void uv__udp_run_pending(uv_udp_t* handle) {
     req = ngx_queue_data(q, uv_udp_send_t, queue);
     assert(req != NULL);
 
+    if (req->batch) {
+      if (uv__udp_run_batch(handle, req))
+        break;
+
+      ngx_queue_remove(&req->queue);
+      ngx_queue_insert_tail(&handle->write_completed_queue, &req->queue);
+      continue;
+    }
+
     memset(&h, 0, sizeof h);
     h.msg_name = &req->addr;
     h.msg_namelen = req->addrlen;
@@ -249,6 +338,143 @@ static void uv__udp_recvmsg(uv_udp_t* handle) {
 }
 
 
+/* Reads up to n datagrams into the slots of buf, returns how many or -1. */
+static int uv__udp_recv_slots(uv_udp_t* handle,
+                              uv_buf_t buf,
+                              size_t slot,
+                              int n,
+                              uv_udp_msg_t* msgs) {
+  struct iovec iov[UV_UDP_BATCH_MAX];
+  struct msghdr h;
+  ssize_t nread;
+  int i;
+
+#if HAVE_SYS_RECVMMSG
+  static int no_recvmmsg;
+  struct uv__mmsghdr mmsg[UV_UDP_BATCH_MAX];
+  int r;
+
+  if (!no_recvmmsg) {
+    for (i = 0; i < n; i++) {
+      iov[i].iov_base = buf.base + i * slot;
+      iov[i].iov_len = slot;
+      memset(&mmsg[i], 0, sizeof mmsg[i]);
+      mmsg[i].msg_hdr.msg_name = &msgs[i].addr;
+      mmsg[i].msg_hdr.msg_namelen = sizeof msgs[i].addr;
+      mmsg[i].msg_hdr.msg_iov = &iov[i];
+      mmsg[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    do {
+      r = sys_recvmmsg(handle->fd, mmsg, n, 0);
+    }
+    while (r == -1 && errno == EINTR);
+
+    if (r != -1 || errno != ENOSYS) {
+      for (i = 0; i < r; i++) {
+        msgs[i].offset = i * slot;
+        msgs[i].len = mmsg[i].msg_len;
+        msgs[i].flags = (mmsg[i].msg_hdr.msg_flags & MSG_TRUNC) ?
+            UV_UDP_PARTIAL : 0;
+      }
+      return r;
+    }
+
+    /* a kernel from before 2.6.33 */
+    no_recvmmsg = 1;
+  }
+#endif
+
+  for (i = 0; i < n; i++) {
+    iov[i].iov_base = buf.base + i * slot;
+    iov[i].iov_len = slot;
+
+    memset(&h, 0, sizeof h);
+    h.msg_name = &msgs[i].addr;
+    h.msg_namelen = sizeof msgs[i].addr;
+    h.msg_iov = &iov[i];
+    h.msg_iovlen = 1;
+
+    do {
+      nread = recvmsg(handle->fd, &h, 0);
+    }
+    while (nread == -1 && errno == EINTR);
+
+    if (nread == -1) {
+      /* the datagrams read so far still count */
+      if (i > 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        break;
+      return -1;
+    }
+
+    msgs[i].offset = i * slot;
+    msgs[i].len = nread;
+    msgs[i].flags = (h.msg_flags & MSG_TRUNC) ? UV_UDP_PARTIAL : 0;
+  }
+
+  return i;
+}
+
+
+static void uv__udp_recvmmsg(uv_udp_t* handle) {
+  uv_udp_msg_t msgs[UV_UDP_BATCH_MAX];
+  uv_buf_t buf;
+  size_t slot;
+  size_t pos;
+  int count;
+  int n;
+  int i;
+
+  assert(handle->recv_batch_cb != NULL);
+  assert(handle->alloc_cb != NULL);
+
+  do {
+    buf = handle->alloc_cb((uv_handle_t*)handle,
+                           handle->recv_batch_count * handle->recv_batch_slot);
+    assert(buf.len > 0);
+    assert(buf.base != NULL);
+
+    /* alloc_cb may hand out less than it was asked for */
+    slot = handle->recv_batch_slot;
+    if (slot > buf.len)
+      slot = buf.len;
+    n = buf.len / slot;
+    if (n > (int)handle->recv_batch_count)
+      n = handle->recv_batch_count;
+
+    count = uv__udp_recv_slots(handle, buf, slot, n, msgs);
+
+    if (count == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        uv__set_sys_error(handle->loop, EAGAIN);
+        handle->recv_batch_cb(handle, 0, buf, NULL);
+      }
+      else {
+        uv__set_sys_error(handle->loop, errno);
+        handle->recv_batch_cb(handle, -1, buf, NULL);
+      }
+    }
+    else {
+      /* Pack the datagrams so the owner of buf may give back the rest. */
+      for (i = 0, pos = 0; i < count; i++) {
+        if (msgs[i].offset != pos)
+          memmove(buf.base + pos, buf.base + msgs[i].offset, msgs[i].len);
+        msgs[i].offset = pos;
+        pos += msgs[i].len;
+      }
+
+      handle->recv_batch_cb(handle, count, buf, msgs);
+    }
+  }
+  /* A short batch drained the socket. The callback may also decide to pause
+   * or close the handle.
+   */
+  while (count == n
+      && handle->fd != -1
+      && handle->recv_batch_cb != NULL);
+}
+
+
 static void uv__udp_sendmsg(uv_udp_t* handle) {
   assert(!ngx_queue_empty(&handle->write_queue)
       || !ngx_queue_empty(&handle->write_completed_queue));
@@ -279,8 +505,12 @@ static void uv__udp_io(EV_P_ ev_io* w, int events) {
   assert(handle->fd >= 0);
   assert(!(events & ~(EV_READ|EV_WRITE)));
 
-  if (events & EV_READ)
-    uv__udp_recvmsg(handle);
+  if (events & EV_READ) {
+    if (handle->recv_batch_cb)
+      uv__udp_recvmmsg(handle);
+    else
+      uv__udp_recvmsg(handle);
+  }
 
   if (events & EV_WRITE)
     uv__udp_sendmsg(handle);
@@ -302,7 +532,7 @@ static int uv__bind(uv_udp_t* handle,
   fd = -1;
 
   /* Check for bad flags. */
-  if (flags & ~UV_UDP_IPV6ONLY) {
+  if (flags & ~(UV_UDP_IPV6ONLY | UV_UDP_REUSEPORT)) {
     uv__set_sys_error(handle->loop, EINVAL);
     goto out;
   }
@@ -337,6 +567,19 @@ static int uv__bind(uv_udp_t* handle,
 #endif
   }
 
+  if (flags & UV_UDP_REUSEPORT) {
+#ifdef SO_REUSEPORT
+    yes = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof yes) == -1) {
+      uv__set_sys_error(handle->loop, errno);
+      goto out;
+    }
+#else
+    uv__set_sys_error(handle->loop, ENOTSUP);
+    goto out;
+#endif
+  }
+
   if (bind(fd, addr, len) == -1) {
     uv__set_sys_error(handle->loop, errno);
     goto out;
@@ -397,7 +640,8 @@ static int uv__udp_send(uv_udp_send_t* req,
                         int bufcnt,
                         struct sockaddr* addr,
                         socklen_t addrlen,
-                        uv_udp_send_cb send_cb) {
+                        uv_udp_send_cb send_cb,
+                        int batch) {
   if (uv__udp_maybe_deferred_bind(handle, addr->sa_family))
     return -1;
 
@@ -409,6 +653,9 @@ static int uv__udp_send(uv_udp_send_t* req,
   req->send_cb = send_cb;
   req->handle = handle;
   req->bufcnt = bufcnt;
+  req->batch = batch;
+  req->nsent = 0;
+  req->status = 0;
   req->type = UV_UDP_SEND;
 
   if (bufcnt <= UV_REQ_BUFSML_SIZE) {
@@ -441,6 +688,23 @@ int uv_udp_init(uv_loop_t* loop, uv_udp_t* handle) {
 }
 
 
+/* Adopts a bound socket, one received over an IPC pipe. */
+int uv__udp_open(uv_udp_t* handle, int fd) {
+  if (handle->fd != -1) {
+    uv__set_artificial_error(handle->loop, UV_EALREADY);
+    return -1;
+  }
+
+  if (uv__nonblock(fd, 1)) {
+    uv__set_sys_error(handle->loop, errno);
+    return -1;
+  }
+
+  handle->fd = fd;
+  return 0;
+}
+
+
 int uv__udp_bind(uv_udp_t* handle, struct sockaddr_in addr, unsigned flags) {
   return uv__bind(handle,
                   AF_INET,
@@ -538,7 +802,42 @@ int uv_udp_send(uv_udp_send_t* req,
                       bufcnt,
                       (struct sockaddr*)&addr,
                       sizeof addr,
-                      send_cb);
+                      send_cb,
+                      0);
+}
+
+
+int uv_udp_send_batch(uv_udp_send_t* req,
+                      uv_udp_t* handle,
+                      uv_buf_t bufs[],
+                      int bufcnt,
+                      struct sockaddr_in addr,
+                      uv_udp_send_cb send_cb) {
+  return uv__udp_send(req,
+                      handle,
+                      bufs,
+                      bufcnt,
+                      (struct sockaddr*)&addr,
+                      sizeof addr,
+                      send_cb,
+                      1);
+}
+
+
+int uv_udp_send_batch6(uv_udp_send_t* req,
+                       uv_udp_t* handle,
+                       uv_buf_t bufs[],
+                       int bufcnt,
+                       struct sockaddr_in6 addr,
+                       uv_udp_send_cb send_cb) {
+  return uv__udp_send(req,
+                      handle,
+                      bufs,
+                      bufcnt,
+                      (struct sockaddr*)&addr,
+                      sizeof addr,
+                      send_cb,
+                      1);
 }
 
 
@@ -554,7 +853,8 @@ int uv_udp_send6(uv_udp_send_t* req,
                       bufcnt,
                       (struct sockaddr*)&addr,
                       sizeof addr,
-                      send_cb);
+                      send_cb,
+                      0);
 }
 
 
@@ -576,6 +876,36 @@ int uv_udp_recv_start(uv_udp_t* handle,
 
   handle->alloc_cb = alloc_cb;
   handle->recv_cb = recv_cb;
+  handle->recv_batch_cb = NULL;
+  uv__udp_watcher_start(handle, &handle->read_watcher);
+
+  return 0;
+}
+
+
+int uv_udp_recv_batch_start(uv_udp_t* handle,
+                            uv_alloc_cb alloc_cb,
+                            uv_udp_recv_batch_cb recv_cb,
+                            unsigned int count,
+                            size_t slot_size) {
+  if (alloc_cb == NULL || recv_cb == NULL || count == 0 || slot_size == 0) {
+    uv__set_artificial_error(handle->loop, UV_EINVAL);
+    return -1;
+  }
+
+  if (ev_is_active(&handle->read_watcher)) {
+    uv__set_artificial_error(handle->loop, UV_EALREADY);
+    return -1;
+  }
+
+  if (uv__udp_maybe_deferred_bind(handle, AF_INET))
+    return -1;
+
+  handle->alloc_cb = alloc_cb;
+  handle->recv_cb = NULL;
+  handle->recv_batch_cb = recv_cb;
+  handle->recv_batch_count = count < UV_UDP_BATCH_MAX ? count : UV_UDP_BATCH_MAX;
+  handle->recv_batch_slot = slot_size;
   uv__udp_watcher_start(handle, &handle->read_watcher);
 
   return 0;
@@ -586,5 +916,6 @@ int uv_udp_recv_stop(uv_udp_t* handle) {
   uv__udp_watcher_stop(handle, &handle->read_watcher);
   handle->alloc_cb = NULL;
   handle->recv_cb = NULL;
+  handle->recv_batch_cb = NULL;
   return 0;
 }
@@ -27,12 +27,85 @@
 #include <stdio.h>
 #include <pthread.h>
 
+/*
+ * Completed requests are run for at most this long (in seconds) per call to
+ * eio_poll(); whatever is left over is picked up by the idle watcher on the
+ * next loop iteration, after network I/O had its turn. A time budget rather
+ * than a fixed number of requests lets cheap completions, e.g. stat() or
+ * small reads, drain in one go.
+ */
+#define UV_EIO_MAX_POLL_TIME 0.002
+
+
+void uv_work_set_batch_cb(uv_loop_t* loop, uv_work_batch_cb cb) {
+  loop->work_batch_cb = cb;
+}
+
+
+int uv_work_drain(uv_loop_t* loop) {
+  uint64_t deadline;
+  ngx_queue_t* q;
+  uv_work_t* req;
+  int type;
+
+  deadline = uv_hrtime() + (uint64_t) (UV_EIO_MAX_POLL_TIME * 1e9);
+
+  while (!ngx_queue_empty(&loop->work_done_queue)) {
+    q = ngx_queue_head(&loop->work_done_queue);
+    ngx_queue_remove(q);
+    req = ngx_queue_data(q, uv_work_t, done_queue);
+
+    type = req->work_type;
+    if (type < 0 || type >= UV_WORK_TYPES) type = 0;
+    loop->counters.work_batched[type]++;
+
+    uv_unref(loop);
+    if (req->after_work_cb) {
+      req->after_work_cb(req);
+    }
+
+    if (uv_hrtime() >= deadline)
+      break;
+  }
+
+  return !ngx_queue_empty(&loop->work_done_queue);
+}
+
+
+static int uv__eio_poll(uv_loop_t* loop) {
+  unsigned long nfinished = loop->uv_eio_channel.nfinished;
+  int r = eio_poll(&loop->uv_eio_channel);
+
+  loop->counters.eio_poll++;
+  loop->counters.eio_done += loop->uv_eio_channel.nfinished - nfinished;
+  if (r == -1) loop->counters.eio_poll_limited++;
+
+  /* Completions left over make the idle watcher poll again, like requests
+   * eio_poll() did not get to. Should the batch callback have been unset
+   * since they were queued, they are run here. */
+  if (!ngx_queue_empty(&loop->work_done_queue)) {
+    loop->counters.work_batch++;
+    if (loop->work_batch_cb) {
+      loop->work_batch_cb(loop);
+    } else {
+      uv_work_drain(loop);
+    }
+    if (!ngx_queue_empty(&loop->work_done_queue)) {
+      loop->counters.work_batch_limited++;
+      r = -1;
+    }
+  }
+
+  return r;
+}
+
+
 static void uv_eio_do_poll(uv_idle_t* watcher, int status) {
   assert(watcher == &(watcher->loop->uv_eio_poller));
 
   /* printf("uv_eio_poller\n"); */
 
-  if (eio_poll(&watcher->loop->uv_eio_channel) != -1 && uv_is_active((uv_handle_t*) watcher)) {
+  if (uv__eio_poll(watcher->loop) != -1 && uv_is_active((uv_handle_t*) watcher)) {
     /* printf("uv_eio_poller stop\n"); */
     uv_idle_stop(watcher);
     uv_unref(watcher->loop);
@@ -48,7 +121,7 @@ static void uv_eio_want_poll_notifier_cb(uv_async_t* watcher, int status) {
 
   /* printf("want poll notifier\n"); */
 
-  if (eio_poll(&watcher->loop->uv_eio_channel) == -1 && !uv_is_active((uv_handle_t*) &loop->uv_eio_poller)) {
+  if (uv__eio_poll(loop) == -1 && !uv_is_active((uv_handle_t*) &loop->uv_eio_poller)) {
     /* printf("uv_eio_poller start\n"); */
     uv_idle_start(&loop->uv_eio_poller, uv_eio_do_poll);
     uv_ref(loop);
@@ -63,7 +136,7 @@ static void uv_eio_done_poll_notifier_cb(uv_async_t* watcher, int revents) {
 
   /* printf("done poll notifier\n"); */
 
-  if (eio_poll(&watcher->loop->uv_eio_channel) != -1 && uv_is_active((uv_handle_t*) &loop->uv_eio_poller)) {
+  if (uv__eio_poll(loop) != -1 && uv_is_active((uv_handle_t*) &loop->uv_eio_poller)) {
     /* printf("uv_eio_poller stop\n"); */
     uv_idle_stop(&loop->uv_eio_poller);
     uv_unref(loop);
@@ -99,16 +172,48 @@ static pthread_once_t eio_initialised = PTHREAD_ONCE_INIT;
 void eio_init_once() {
   eio_init(uv_eio_want_poll, uv_eio_done_poll);
   /*
-   * Don't handle more than 10 reqs on each eio_poll(). This is to avoid
-   * race conditions. See Node's test/simple/test-eio-race.js
+   * Don't let completions monopolize the loop, whatever their number. See
+   * Node's test/simple/test-eio-race.js
+   *
+   * eio measures time in ticks of 1/977 s and truncates the budget to whole
+   * ticks, so 2ms alone would be a single tick. Adding a millisecond makes
+   * it two ticks, about 2.05ms.
    */
-  eio_set_max_poll_reqs(10);
+  eio_set_max_poll_time(UV_EIO_MAX_POLL_TIME + 0.001);
+}
+
+void uv_threadpool_set_size(unsigned int nthreads) {
+  if (nthreads == 0) return;
+  eio_set_min_parallel(nthreads);
+  eio_set_max_parallel(nthreads);
+}
+
+
+void uv_threadpool_set_max_poll_reqs(uv_loop_t* loop, unsigned int maxreqs) {
+  loop->uv_eio_channel.max_poll_reqs = maxreqs;
 }
 
+
+void uv_threadpool_set_priority(uv_loop_t* loop, int priority) {
+  if (priority < EIO_PRI_MIN) priority = EIO_PRI_MIN;
+  if (priority > EIO_PRI_MAX) priority = EIO_PRI_MAX;
+  loop->uv_eio_channel.pri = priority;
+}
+
+
+void uv_threadpool_set_max_threads(uv_loop_t* loop, unsigned int nthreads) {
+  /* the channel's limit is guarded by eio's locks */
+  pthread_once(&eio_initialised, eio_init_once);
+  eio_channel_set_max_running(&loop->uv_eio_channel, nthreads);
+}
+
+
 void uv_eio_init(uv_loop_t* loop) {
   if (loop->counters.eio_init == 0) {
     loop->counters.eio_init++;
 
+    ngx_queue_init(&loop->work_done_queue);
+
     uv_idle_init(loop, &loop->uv_eio_poller);
     uv_idle_start(&loop->uv_eio_poller, uv_eio_do_poll);
 
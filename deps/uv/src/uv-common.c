@@ -40,6 +40,32 @@ uv_counters_t* uv_counters() {
 }
 
 
+void uv__req_latency_start(uv_loop_t* loop, uv_req_t* req,
+    uv_latency_type type) {
+  req->start_time_ = uv_hrtime();
+  loop->counters.latency[type].in_flight++;
+}
+
+
+void uv__req_latency_done(uv_loop_t* loop, uv_req_t* req,
+    uv_latency_type type) {
+  uv_latency_t* latency = &loop->counters.latency[type];
+  uint64_t nsecs = uv_hrtime() - req->start_time_;
+  uint64_t usecs;
+  int bucket = 0;
+
+  for (usecs = nsecs / 1000; usecs; usecs >>= 1)
+    bucket++;
+  if (bucket >= UV_LATENCY_BUCKETS)
+    bucket = UV_LATENCY_BUCKETS - 1;
+
+  latency->buckets[bucket]++;
+  latency->completed++;
+  latency->total_time += nsecs;
+  latency->in_flight--;
+}
+
+
 uv_buf_t uv_buf_init(char* base, size_t len) {
   uv_buf_t buf;
   buf.base = base;
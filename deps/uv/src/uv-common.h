@@ -57,6 +57,12 @@ void uv__set_artificial_error(uv_loop_t* loop, uv_err_code code);
 uv_err_t uv__new_sys_error(int sys_error);
 uv_err_t uv__new_artificial_error(uv_err_code code);
 
+/* Count a request in, and out, of the latency counters of its kind. */
+void uv__req_latency_start(uv_loop_t* loop, uv_req_t* req,
+    uv_latency_type type);
+void uv__req_latency_done(uv_loop_t* loop, uv_req_t* req,
+    uv_latency_type type);
+
 int uv__tcp_bind(uv_tcp_t* handle, struct sockaddr_in addr);
 int uv__tcp_bind6(uv_tcp_t* handle, struct sockaddr_in6 addr);
 
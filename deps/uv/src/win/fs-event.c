@@ -140,7 +140,10 @@ int uv_fs_event_init(uv_loop_t* loop, uv_fs_event_t* handle,
   wchar_t short_path[MAX_PATH];
 
   /* We don't support any flags yet. */
-  assert(!flags);
+  if (flags) {
+    uv__set_artificial_error(loop, UV_ENOSYS);
+    return -1;
+  }
 
   uv_fs_event_init_handle(loop, handle, filename, cb);
 
@@ -138,6 +138,7 @@ static void uv_fs_req_init_async(uv_loop_t* loop, uv_fs_t* req,
   req->pathw = (wchar_t*)pathw;
   req->errorno = 0;
   req->last_error = 0;
+  uv__req_latency_start(loop, (uv_req_t*) req, UV_LATENCY_FS);
   memset(&req->overlapped, 0, sizeof(req->overlapped));
 }
 
@@ -1473,6 +1474,7 @@ int uv_fs_futime(uv_loop_t* loop, uv_fs_t* req, uv_file file, double atime,
 
 void uv_process_fs_req(uv_loop_t* loop, uv_fs_t* req) {
   assert(req->cb);
+  uv__req_latency_done(loop, (uv_req_t*) req, UV_LATENCY_FS);
   SET_UV_LAST_ERROR_FROM_REQ(req);
   req->cb(req);
 }
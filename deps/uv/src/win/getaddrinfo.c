@@ -119,6 +119,8 @@ void uv_process_getaddrinfo_req(uv_loop_t* loop, uv_getaddrinfo_t* handle,
   char* cur_ptr = NULL;
   uv_err_code uv_ret;
 
+  uv__req_latency_done(loop, (uv_req_t*) handle, UV_LATENCY_GETADDRINFO);
+
   /* release input parameter memory */
   if (handle->alloc != NULL) {
     free(handle->alloc);
@@ -357,6 +359,7 @@ int uv_getaddrinfo(uv_loop_t* loop,
   }
 
   uv_ref(loop);
+  uv__req_latency_start(loop, (uv_req_t*) handle, UV_LATENCY_GETADDRINFO);
 
   return 0;
 
@@ -64,6 +64,22 @@ int uv_is_active(uv_handle_t* handle) {
 }
 
 
+void uv_handle_ref(uv_handle_t* handle) {
+  if (handle->flags & UV_HANDLE_UNREF) {
+    handle->flags &= ~UV_HANDLE_UNREF;
+    uv_ref(handle->loop);
+  }
+}
+
+
+void uv_handle_unref(uv_handle_t* handle) {
+  if (!(handle->flags & (UV_HANDLE_UNREF | UV_HANDLE_CLOSING))) {
+    handle->flags |= UV_HANDLE_UNREF;
+    uv_unref(handle->loop);
+  }
+}
+
+
 void uv_close(uv_handle_t* handle, uv_close_cb cb) {
   uv_tcp_t* tcp;
   uv_pipe_t* pipe;
@@ -76,6 +92,9 @@ void uv_close(uv_handle_t* handle, uv_close_cb cb) {
     return;
   }
 
+  /* The endgame releases the handle's reference, so take it back first. */
+  uv_handle_ref(handle);
+
   handle->flags |= UV_HANDLE_CLOSING;
   handle->close_cb = cb;
 
@@ -455,6 +455,7 @@ void uv_pipe_connect(uv_connect_t* req, uv_pipe_t* handle,
   req->type = UV_CONNECT;
   req->handle = (uv_stream_t*) handle;
   req->cb = cb;
+  uv__req_latency_start(loop, (uv_req_t*) req, UV_LATENCY_CONNECT);
 
   /* Convert name to UTF16. */
   nameSize = uv_utf8_to_utf16(name, NULL, 0) * sizeof(wchar_t);
@@ -1066,6 +1067,7 @@ static int uv_pipe_write_impl(uv_loop_t* loop, uv_write_t* req,
 
     handle->reqs_pending++;
     handle->write_reqs_pending++;
+    uv__req_latency_start(loop, (uv_req_t*) ipc_header_req, UV_LATENCY_WRITE);
 
     /* If we don't have any raw data to write - we're done. */
     if (!(ipc_frame.header.flags & UV_IPC_RAW_DATA)) {
@@ -1124,6 +1126,7 @@ static int uv_pipe_write_impl(uv_loop_t* loop, uv_write_t* req,
 
   handle->reqs_pending++;
   handle->write_reqs_pending++;
+  uv__req_latency_start(loop, (uv_req_t*) req, UV_LATENCY_WRITE);
 
   return 0;
 }
@@ -1338,6 +1341,8 @@ void uv_process_pipe_write_req(uv_loop_t* loop, uv_pipe_t* handle,
     uv_write_t* req) {
   assert(handle->type == UV_NAMED_PIPE);
 
+  uv__req_latency_done(loop, (uv_req_t*) req, UV_LATENCY_WRITE);
+
   assert(handle->write_queue_size >= req->queued_bytes);
   handle->write_queue_size -= req->queued_bytes;
 
@@ -1422,6 +1427,8 @@ void uv_process_pipe_connect_req(uv_loop_t* loop, uv_pipe_t* handle,
     uv_connect_t* req) {
   assert(handle->type == UV_NAMED_PIPE);
 
+  uv__req_latency_done(loop, (uv_req_t*) req, UV_LATENCY_CONNECT);
+
   if (req->cb) {
     if (REQ_SUCCESS(req)) {
       uv_pipe_connection_init(handle);
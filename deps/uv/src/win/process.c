@@ -1138,3 +1138,10 @@ uv_err_t uv_kill(int pid, int signum) {
 
   return err;
 }
+
+
+int uv_fork(uv_loop_t* loop, uv_process_t* process, uv_exit_cb exit_cb,
+    uv_pipe_t* channel) {
+  uv__set_artificial_error(loop, UV_ENOSYS);
+  return -1;
+}
@@ -148,6 +148,18 @@ int uv_write2(uv_write_t* req, uv_stream_t* handle, uv_buf_t bufs[], int bufcnt,
 }
 
 
+int uv_accept_next(uv_stream_t* server) {
+  /* Pending accepts are reported one by one through the completion port. */
+  return 0;
+}
+
+
+int uv_try_write(uv_stream_t* handle, uv_buf_t bufs[], int bufcnt) {
+  /* Writes complete through the completion port; there's nothing to try. */
+  return 0;
+}
+
+
 int uv_shutdown(uv_shutdown_t* req, uv_stream_t* handle, uv_shutdown_cb cb) {
   uv_loop_t* loop = handle->loop;
 
@@ -35,9 +35,10 @@
 const unsigned int uv_active_tcp_streams_threshold = 0;
 
 /*
- * Number of simultaneous pending AcceptEx calls.
+ * Number of simultaneous pending AcceptEx calls, to begin with and at most.
  */
 const unsigned int uv_simultaneous_server_accepts = 32;
+const unsigned int uv_max_server_accepts = 256;
 
 /* A zero-size buffer for use by uv_tcp_read */
 static char uv_zero_[] = "";
@@ -153,6 +154,10 @@ int uv_tcp_init(uv_loop_t* loop, uv_tcp_t* handle) {
   handle->func_acceptex = NULL;
   handle->func_connectex = NULL;
   handle->processed_accepts = 0;
+  handle->accept_reqs_used = uv_simultaneous_server_accepts;
+  handle->accept_reqs_max = uv_max_server_accepts;
+  handle->accepts_in_tick = 0;
+  handle->accepts_tick = 0;
 
   loop->counters.tcp_init++;
 
@@ -196,7 +201,7 @@ void uv_tcp_endgame(uv_loop_t* loop, uv_tcp_t* handle) {
 
     if (!(handle->flags & UV_HANDLE_CONNECTION) && handle->accept_reqs) {
       if (handle->flags & UV_HANDLE_EMULATE_IOCP) {
-        for (i = 0; i < uv_simultaneous_server_accepts; i++) {
+        for (i = 0; i < handle->accept_reqs_used; i++) {
           req = &handle->accept_reqs[i];
           if (req->wait_handle != INVALID_HANDLE_VALUE) {
             UnregisterWait(req->wait_handle);
@@ -383,6 +388,57 @@ static void uv_tcp_queue_accept(uv_tcp_t* handle, uv_tcp_accept_t* req) {
 }
 
 
+static void uv_tcp_init_accept_req(uv_tcp_t* handle, uv_tcp_accept_t* req) {
+  uv_req_init(handle->loop, (uv_req_t*)req);
+  req->type = UV_ACCEPT;
+  req->accept_socket = INVALID_SOCKET;
+  req->data = handle;
+
+  req->wait_handle = INVALID_HANDLE_VALUE;
+  if (handle->flags & UV_HANDLE_EMULATE_IOCP) {
+    req->event_handle = CreateEvent(NULL, 0, 0, NULL);
+    if (!req->event_handle) {
+      uv_fatal_error(GetLastError(), "CreateEvent");
+    }
+  } else {
+    req->event_handle = NULL;
+  }
+}
+
+
+/*
+ * Called when as many connections completed within one tick of the loop
+ * clock as there are accept requests queued. The kernel may have had none
+ * left to complete further connections with, which then wait in the listen
+ * backlog or, once it's full, get refused. Double the queued requests. The
+ * array was allocated for the maximum up front, so requests that are queued
+ * never move.
+ */
+static void uv_tcp_grow_accepts(uv_tcp_t* handle) {
+  unsigned int i, used;
+
+  if (!(handle->flags & UV_HANDLE_LISTENING) ||
+      handle->flags & (UV_HANDLE_CLOSING |
+                       UV_HANDLE_TCP_SINGLE_ACCEPT |
+                       UV_HANDLE_TCP_ACCEPT_STATE_CHANGING)) {
+    return;
+  }
+
+  used = handle->accept_reqs_used * 2;
+  if (used > handle->accept_reqs_max) {
+    used = handle->accept_reqs_max;
+  }
+
+  for (i = handle->accept_reqs_used; i < used; i++) {
+    uv_tcp_init_accept_req(handle, &handle->accept_reqs[i]);
+    uv_tcp_queue_accept(handle, &handle->accept_reqs[i]);
+  }
+
+  handle->accept_reqs_used = used;
+  handle->accepts_in_tick = 0;
+}
+
+
 static void uv_tcp_queue_read(uv_loop_t* loop, uv_tcp_t* handle) {
   uv_read_t* req;
   uv_buf_t buf;
@@ -440,8 +496,7 @@ static void uv_tcp_queue_read(uv_loop_t* loop, uv_tcp_t* handle) {
 
 int uv_tcp_listen(uv_tcp_t* handle, int backlog, uv_connection_cb cb) {
   uv_loop_t* loop = handle->loop;
-  unsigned int i, simultaneous_accepts;
-  uv_tcp_accept_t* req;
+  unsigned int i;
 
   assert(backlog > 0);
 
@@ -470,34 +525,20 @@ int uv_tcp_listen(uv_tcp_t* handle, int backlog, uv_connection_cb cb) {
   handle->flags |= UV_HANDLE_LISTENING;
   handle->connection_cb = cb;
 
-  simultaneous_accepts = handle->flags & UV_HANDLE_TCP_SINGLE_ACCEPT ? 1
-    : uv_simultaneous_server_accepts;
+  if (handle->flags & UV_HANDLE_TCP_SINGLE_ACCEPT) {
+    handle->accept_reqs_used = 1;
+  }
 
   if(!handle->accept_reqs) {
     handle->accept_reqs = (uv_tcp_accept_t*)
-      malloc(simultaneous_accepts * sizeof(uv_tcp_accept_t));
+      malloc(handle->accept_reqs_max * sizeof(uv_tcp_accept_t));
     if (!handle->accept_reqs) {
       uv_fatal_error(ERROR_OUTOFMEMORY, "malloc");
     }
 
-    for (i = 0; i < simultaneous_accepts; i++) {
-      req = &handle->accept_reqs[i];
-      uv_req_init(loop, (uv_req_t*)req);
-      req->type = UV_ACCEPT;
-      req->accept_socket = INVALID_SOCKET;
-      req->data = handle;
-
-      req->wait_handle = INVALID_HANDLE_VALUE;
-      if (handle->flags & UV_HANDLE_EMULATE_IOCP) {
-        req->event_handle = CreateEvent(NULL, 0, 0, NULL);
-        if (!req->event_handle) {
-          uv_fatal_error(GetLastError(), "CreateEvent");
-        }
-      } else {
-        req->event_handle = NULL;
-      }
-
-      uv_tcp_queue_accept(handle, req);
+    for (i = 0; i < handle->accept_reqs_used; i++) {
+      uv_tcp_init_accept_req(handle, &handle->accept_reqs[i]);
+      uv_tcp_queue_accept(handle, &handle->accept_reqs[i]);
     }
   }
 
@@ -546,7 +587,7 @@ int uv_tcp_accept(uv_tcp_t* server, uv_tcp_t* client) {
 
       server->processed_accepts++;
 
-      if (server->processed_accepts >= uv_simultaneous_server_accepts) {
+      if (server->processed_accepts >= server->accept_reqs_used) {
         server->processed_accepts = 0;
         /* 
          * All previously queued accept requests are now processed.
@@ -648,6 +689,8 @@ int uv__tcp_connect(uv_connect_t* req,
     return -1;
   }
 
+  uv__req_latency_start(loop, (uv_req_t*) req, UV_LATENCY_CONNECT);
+
   return 0;
 }
 
@@ -706,6 +749,8 @@ int uv__tcp_connect6(uv_connect_t* req,
     return -1;
   }
 
+  uv__req_latency_start(loop, (uv_req_t*) req, UV_LATENCY_CONNECT);
+
   return 0;
 }
 
@@ -807,6 +852,8 @@ int uv_tcp_write(uv_loop_t* loop, uv_write_t* req, uv_tcp_t* handle,
     return -1;
   }
 
+  uv__req_latency_start(loop, (uv_req_t*) req, UV_LATENCY_WRITE);
+
   return 0;
 }
 
@@ -930,6 +977,8 @@ void uv_process_tcp_write_req(uv_loop_t* loop, uv_tcp_t* handle,
     uv_write_t* req) {
   assert(handle->type == UV_TCP);
 
+  uv__req_latency_done(loop, (uv_req_t*) req, UV_LATENCY_WRITE);
+
   assert(handle->write_queue_size >= req->queued_bytes);
   handle->write_queue_size -= req->queued_bytes;
 
@@ -975,6 +1024,15 @@ void uv_process_tcp_accept_req(uv_loop_t* loop, uv_tcp_t* handle,
     req->next_pending = handle->pending_accepts;
     handle->pending_accepts = req;
 
+    if (handle->accepts_tick != loop->time) {
+      handle->accepts_tick = loop->time;
+      handle->accepts_in_tick = 0;
+    }
+    if (++handle->accepts_in_tick >= handle->accept_reqs_used &&
+        handle->accept_reqs_used < handle->accept_reqs_max) {
+      uv_tcp_grow_accepts(handle);
+    }
+
     /* Accept and SO_UPDATE_ACCEPT_CONTEXT were successful. */
     if (handle->connection_cb) {
       handle->connection_cb((uv_stream_t*)handle, 0);
@@ -998,6 +1056,8 @@ void uv_process_tcp_connect_req(uv_loop_t* loop, uv_tcp_t* handle,
     uv_connect_t* req) {
   assert(handle->type == UV_TCP);
 
+  uv__req_latency_done(loop, (uv_req_t*) req, UV_LATENCY_CONNECT);
+
   if (req->cb) {
     if (REQ_SUCCESS(req)) {
       if (setsockopt(handle->socket,
@@ -1075,6 +1135,24 @@ int uv_tcp_keepalive(uv_tcp_t* handle, int enable, unsigned int delay) {
   return 0;
 }
 
+int uv_tcp_reuseport(uv_tcp_t* handle, int enable) {
+  /* SO_REUSEADDR on Windows lets sockets steal each other's port, which
+   * isn't the load balancing behaviour this is meant for. */
+  uv__set_artificial_error(handle->loop, UV_ENOTSUP);
+  return -1;
+}
+
+
+int uv_tcp_defer_accept(uv_tcp_t* handle, unsigned int timeout) {
+  uv__set_artificial_error(handle->loop, UV_ENOTSUP);
+  return -1;
+}
+
+
+int uv_tcp_fastopen(uv_tcp_t* handle, int qlen) {
+  uv__set_artificial_error(handle->loop, UV_ENOTSUP);
+  return -1;
+}
 
 
 int uv_tcp_duplicate_socket(uv_tcp_t* handle, int pid,
@@ -1142,5 +1220,26 @@ int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
     handle->flags |= UV_HANDLE_TCP_ACCEPT_STATE_CHANGING;
   }
 
+  return 0;
+}
+
+
+int uv_tcp_pending_accepts(uv_tcp_t* handle, unsigned int initial,
+    unsigned int max) {
+  if (initial == 0) {
+    initial = max < uv_simultaneous_server_accepts ? max
+      : uv_simultaneous_server_accepts;
+  }
+
+  /* The accept requests can't move once queued, so only before listening. */
+  if (handle->flags & UV_HANDLE_CONNECTION || handle->accept_reqs ||
+      initial == 0 || initial > max) {
+    uv__set_artificial_error(handle->loop, UV_EINVAL);
+    return -1;
+  }
+
+  handle->accept_reqs_used = initial;
+  handle->accept_reqs_max = max;
+
   return 0;
 }
\ No newline at end of file
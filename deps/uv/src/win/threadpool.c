@@ -62,12 +62,41 @@ int uv_queue_work(uv_loop_t* loop, uv_work_t* req, uv_work_cb work_cb,
   }
 
   uv_ref(loop);
+  uv__req_latency_start(loop, (uv_req_t*) req, UV_LATENCY_WORK);
   return 0;
 }
 
 
+/* Completions are run as the system thread pool posts them. */
+void uv_work_set_batch_cb(uv_loop_t* loop, uv_work_batch_cb cb) {
+}
+
+
+int uv_work_drain(uv_loop_t* loop) {
+  return 0;
+}
+
+
+/* The system thread pool sizes and schedules itself. */
+void uv_threadpool_set_size(unsigned int nthreads) {
+}
+
+
+void uv_threadpool_set_max_poll_reqs(uv_loop_t* loop, unsigned int maxreqs) {
+}
+
+
+void uv_threadpool_set_priority(uv_loop_t* loop, int priority) {
+}
+
+
+void uv_threadpool_set_max_threads(uv_loop_t* loop, unsigned int nthreads) {
+}
+
+
 void uv_process_work_req(uv_loop_t* loop, uv_work_t* req) {
   assert(req->after_work_cb);
+  uv__req_latency_done(loop, (uv_req_t*) req, UV_LATENCY_WORK);
   req->after_work_cb(req);
   uv_unref(loop);
 }
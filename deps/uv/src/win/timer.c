@@ -216,6 +216,19 @@ int64_t uv_timer_get_repeat(uv_timer_t* handle) {
 }
 
 
+int64_t uv_next_timeout(uv_loop_t* loop) {
+  uv_timer_t* timer;
+  int64_t delta;
+
+  timer = RB_MIN(uv_timer_tree_s, &loop->timers);
+  if (timer == NULL)
+    return -1;
+
+  delta = timer->due - loop->time;
+  return delta < 0 ? 0 : delta;
+}
+
+
 DWORD uv_get_poll_timeout(uv_loop_t* loop) {
   uv_timer_t* timer;
   int64_t delta;
@@ -1652,6 +1652,7 @@ int uv_tty_write(uv_loop_t* loop, uv_write_t* req, uv_tty_t* handle,
   req->type = UV_WRITE;
   req->handle = (uv_stream_t*) handle;
   req->cb = cb;
+  uv__req_latency_start(loop, (uv_req_t*) req, UV_LATENCY_WRITE);
 
   handle->reqs_pending++;
   handle->write_reqs_pending++;
@@ -1673,6 +1674,7 @@ int uv_tty_write(uv_loop_t* loop, uv_write_t* req, uv_tty_t* handle,
 void uv_process_tty_write_req(uv_loop_t* loop, uv_tty_t* handle,
   uv_write_t* req) {
 
+  uv__req_latency_done(loop, (uv_req_t*) req, UV_LATENCY_WRITE);
   handle->write_queue_size -= req->queued_bytes;
 
   if (req->cb) {
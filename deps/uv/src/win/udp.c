@@ -176,6 +176,12 @@ static int uv__bind(uv_udp_t* handle,
     return -1;
   }
 
+  if (flags & UV_UDP_REUSEPORT) {
+    /* SO_REUSEADDR on windows lets any socket steal the port. */
+    uv__set_artificial_error(handle->loop, UV_ENOTSUP);
+    return -1;
+  }
+
   if (handle->socket == INVALID_SOCKET) {
     sock = socket(domain, SOCK_DGRAM, 0);
     if (sock == INVALID_SOCKET) {
@@ -371,6 +377,30 @@ int uv_udp_recv_start(uv_udp_t* handle, uv_alloc_cb alloc_cb,
 }
 
 
+int uv_udp_send_batch(uv_udp_send_t* req, uv_udp_t* handle, uv_buf_t bufs[],
+    int bufcnt, struct sockaddr_in addr, uv_udp_send_cb cb) {
+  /* not implemented yet */
+  uv__set_artificial_error(handle->loop, UV_ENOSYS);
+  return -1;
+}
+
+
+int uv_udp_send_batch6(uv_udp_send_t* req, uv_udp_t* handle, uv_buf_t bufs[],
+    int bufcnt, struct sockaddr_in6 addr, uv_udp_send_cb cb) {
+  /* not implemented yet */
+  uv__set_artificial_error(handle->loop, UV_ENOSYS);
+  return -1;
+}
+
+
+int uv_udp_recv_batch_start(uv_udp_t* handle, uv_alloc_cb alloc_cb,
+    uv_udp_recv_batch_cb recv_cb, unsigned int count, size_t slot_size) {
+  /* not implemented yet */
+  uv__set_artificial_error(handle->loop, UV_ENOSYS);
+  return -1;
+}
+
+
 int uv_udp_recv_stop(uv_udp_t* handle) {
   if (handle->flags & UV_HANDLE_READING) {
     handle->flags &= ~UV_HANDLE_READING;
@@ -270,6 +270,76 @@ TEST_IMPL(fs_event_no_callback_on_close) {
 }
 
 
+#ifdef __linux__
+static void fs_event_cb_dir_recursive(uv_fs_event_t* handle,
+  const char* filename, int events, int status) {
+  ++fs_event_cb_called;
+  ASSERT(handle == &fs_event);
+  ASSERT(status == 0);
+  ASSERT(events == UV_RENAME);
+  ASSERT(filename != NULL);
+
+  /* Each step only happens once the previous one has been reported, so the
+   * new directory is being watched by the time a file is created in it. */
+  if (strcmp(filename, "sub/file1") == 0) {
+    create_dir(handle->loop, "watch_dir/sub/new");
+  } else if (strcmp(filename, "sub/new") == 0) {
+    create_file(handle->loop, "watch_dir/sub/new/file2");
+  } else {
+    ASSERT(strcmp(filename, "sub/new/file2") == 0);
+    uv_close((uv_handle_t*)handle, close_cb);
+  }
+}
+
+
+static void timer_cb_dir_recursive(uv_timer_t* handle, int status) {
+  ++timer_cb_called;
+  create_file(handle->loop, "watch_dir/sub/file1");
+  uv_close((uv_handle_t*)handle, close_cb);
+}
+
+
+static void cleanup_dir_recursive(uv_loop_t* loop) {
+  uv_fs_t fs_req;
+  uv_fs_unlink(loop, &fs_req, "watch_dir/sub/new/file2", NULL);
+  uv_fs_rmdir(loop, &fs_req, "watch_dir/sub/new", NULL);
+  uv_fs_unlink(loop, &fs_req, "watch_dir/sub/file1", NULL);
+  uv_fs_rmdir(loop, &fs_req, "watch_dir/sub", NULL);
+  uv_fs_rmdir(loop, &fs_req, "watch_dir", NULL);
+}
+
+
+TEST_IMPL(fs_event_watch_dir_recursive) {
+  uv_loop_t* loop = uv_default_loop();
+  int r;
+
+  /* Setup */
+  cleanup_dir_recursive(loop);
+  create_dir(loop, "watch_dir");
+  create_dir(loop, "watch_dir/sub");
+
+  r = uv_fs_event_init(loop, &fs_event, "watch_dir",
+    fs_event_cb_dir_recursive, UV_FS_EVENT_RECURSIVE);
+  ASSERT(r != -1);
+  r = uv_timer_init(loop, &timer);
+  ASSERT(r != -1);
+  r = uv_timer_start(&timer, timer_cb_dir_recursive, 100, 0);
+  ASSERT(r != -1);
+
+  uv_run(loop);
+
+  ASSERT(fs_event_cb_called == 3);
+  ASSERT(timer_cb_called == 1);
+  ASSERT(close_cb_called == 2);
+
+  /* Cleanup */
+  cleanup_dir_recursive(loop);
+
+  return 0;
+}
+#endif
+
+
 static void fs_event_fail(uv_fs_event_t* handle, const char* filename,
   int events, int status) {
   ASSERT(0 && "should never be called");
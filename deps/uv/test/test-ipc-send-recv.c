@@ -0,0 +1,165 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Passes a pipe server and a UDP socket from one end of a socketpair to the
+ * other and accepts them there.
+ */
+
+#ifndef _WIN32
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static uv_pipe_t send_channel;
+static uv_pipe_t recv_channel;
+static uv_write_t write_req;
+static uv_handle_type expected_type;
+static uv_stream_t* sent_handle;
+
+static uv_pipe_t send_pipe;
+static uv_pipe_t recv_pipe;
+static uv_udp_t send_udp;
+static uv_udp_t recv_udp;
+
+static int read2_cb_called;
+static int write_cb_called;
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  static char slab[64];
+  return uv_buf_init(slab, sizeof slab);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  write_cb_called++;
+  /* The descriptor is on its way; the sender's copy can go. */
+  uv_close((uv_handle_t*)sent_handle, NULL);
+}
+
+
+static void read2_cb(uv_pipe_t* pipe,
+                     ssize_t nread,
+                     uv_buf_t buf,
+                     uv_handle_type pending) {
+  struct sockaddr_in addr;
+  int namelen;
+  int r;
+
+  if (nread == 0) return;
+
+  ASSERT(nread == 1);
+  ASSERT(pending == expected_type);
+  read2_cb_called++;
+
+  if (pending == UV_NAMED_PIPE) {
+    r = uv_pipe_init(uv_default_loop(), &recv_pipe, 0);
+    ASSERT(r == 0);
+    r = uv_accept((uv_stream_t*)pipe, (uv_stream_t*)&recv_pipe);
+    ASSERT(r == 0);
+    uv_close((uv_handle_t*)&recv_pipe, NULL);
+  } else {
+    r = uv_udp_init(uv_default_loop(), &recv_udp);
+    ASSERT(r == 0);
+    r = uv_accept((uv_stream_t*)pipe, (uv_stream_t*)&recv_udp);
+    ASSERT(r == 0);
+
+    namelen = sizeof addr;
+    r = uv_udp_getsockname(&recv_udp, (struct sockaddr*)&addr, &namelen);
+    ASSERT(r == 0);
+    ASSERT(ntohs(addr.sin_port) == TEST_PORT);
+    uv_close((uv_handle_t*)&recv_udp, NULL);
+  }
+
+  uv_close((uv_handle_t*)&send_channel, NULL);
+  uv_close((uv_handle_t*)&recv_channel, NULL);
+}
+
+
+static void send_recv(uv_stream_t* handle, uv_handle_type type) {
+  uv_buf_t buf;
+  int fds[2];
+  int r;
+
+  r = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+  ASSERT(r == 0);
+
+  uv_pipe_init(uv_default_loop(), &send_channel, 1);
+  uv_pipe_open(&send_channel, fds[0]);
+  uv_pipe_init(uv_default_loop(), &recv_channel, 1);
+  uv_pipe_open(&recv_channel, fds[1]);
+
+  expected_type = type;
+  sent_handle = handle;
+  buf = uv_buf_init(".", 1);
+  r = uv_write2(&write_req, (uv_stream_t*)&send_channel, &buf, 1, handle,
+      write_cb);
+  ASSERT(r == 0);
+
+  r = uv_read2_start((uv_stream_t*)&recv_channel, alloc_cb, read2_cb);
+  ASSERT(r == 0);
+
+  r = uv_run(uv_default_loop());
+  ASSERT(r == 0);
+
+  ASSERT(write_cb_called == 1);
+  ASSERT(read2_cb_called == 1);
+}
+
+
+TEST_IMPL(ipc_send_recv_pipe) {
+  int r;
+
+  unlink(TEST_PIPENAME);
+
+  r = uv_pipe_init(uv_default_loop(), &send_pipe, 0);
+  ASSERT(r == 0);
+  r = uv_pipe_bind(&send_pipe, TEST_PIPENAME);
+  ASSERT(r == 0);
+  r = uv_listen((uv_stream_t*)&send_pipe, SOMAXCONN, NULL);
+  ASSERT(r == 0);
+
+  send_recv((uv_stream_t*)&send_pipe, UV_NAMED_PIPE);
+
+  return 0;
+}
+
+
+TEST_IMPL(ipc_send_recv_udp) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  int r;
+
+  r = uv_udp_init(uv_default_loop(), &send_udp);
+  ASSERT(r == 0);
+  r = uv_udp_bind(&send_udp, addr, 0);
+  ASSERT(r == 0);
+
+  send_recv((uv_stream_t*)&send_udp, UV_UDP);
+
+  return 0;
+}
+
+#endif
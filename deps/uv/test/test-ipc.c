@@ -275,4 +275,33 @@ TEST_IMPL(listen_no_simultaneous_accepts) {
 
   return 0;
 }
+
+
+TEST_IMPL(listen_pending_accepts) {
+  uv_tcp_t server;
+  int r;
+  struct sockaddr_in addr = uv_ip4_addr("0.0.0.0", TEST_PORT);
+
+  r = uv_tcp_init(uv_default_loop(), &server);
+  ASSERT(r == 0);
+
+  r = uv_tcp_bind(&server, addr);
+  ASSERT(r == 0);
+
+  r = uv_tcp_pending_accepts(&server, 8, 4);
+  ASSERT(r == -1);
+  ASSERT(uv_last_error(uv_default_loop()).code == UV_EINVAL);
+
+  r = uv_tcp_pending_accepts(&server, 8, 64);
+  ASSERT(r == 0);
+
+  r = uv_listen((uv_stream_t*)&server, SOMAXCONN, NULL);
+  ASSERT(r == 0);
+  ASSERT(server.reqs_pending == 8);
+
+  r = uv_tcp_pending_accepts(&server, 16, 64);
+  ASSERT(r == -1);
+
+  return 0;
+}
 #endif
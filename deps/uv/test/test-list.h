@@ -23,6 +23,10 @@ TEST_DECLARE   (tty)
 TEST_DECLARE   (stdio_over_pipes)
 TEST_DECLARE   (ipc_listen_before_write)
 TEST_DECLARE   (ipc_listen_after_write)
+#ifndef _WIN32
+TEST_DECLARE   (ipc_send_recv_pipe)
+TEST_DECLARE   (ipc_send_recv_udp)
+#endif
 TEST_DECLARE   (tcp_ping_pong)
 TEST_DECLARE   (tcp_ping_pong_v6)
 TEST_DECLARE   (tcp_ref)
@@ -66,6 +70,7 @@ TEST_DECLARE   (timer)
 TEST_DECLARE   (timer_ref)
 TEST_DECLARE   (timer_ref2)
 TEST_DECLARE   (timer_again)
+TEST_DECLARE   (timer_next_timeout)
 TEST_DECLARE   (idle_starvation)
 TEST_DECLARE   (loop_handles)
 TEST_DECLARE   (ref)
@@ -92,6 +97,12 @@ TEST_DECLARE   (spawn_stdin)
 TEST_DECLARE   (spawn_and_kill)
 TEST_DECLARE   (spawn_and_ping)
 TEST_DECLARE   (kill)
+#ifndef _WIN32
+TEST_DECLARE   (spawn_path_from_env)
+TEST_DECLARE   (spawn_not_found)
+TEST_DECLARE   (fork_exit_code)
+TEST_DECLARE   (fork_channel)
+#endif
 TEST_DECLARE   (fs_file_noent)
 TEST_DECLARE   (fs_file_async)
 TEST_DECLARE   (fs_file_sync)
@@ -111,10 +122,16 @@ TEST_DECLARE   (fs_event_watch_file)
 TEST_DECLARE   (fs_event_watch_file_current_dir)
 TEST_DECLARE   (fs_event_no_callback_on_close)
 TEST_DECLARE   (fs_event_immediate_close)
+#ifdef __linux__
+TEST_DECLARE   (fs_event_watch_dir_recursive)
+#endif
 TEST_DECLARE   (fs_readdir_empty_dir)
 TEST_DECLARE   (fs_readdir_file)
 TEST_DECLARE   (fs_open_dir)
 TEST_DECLARE   (threadpool_queue_work_simple)
+TEST_DECLARE   (threadpool_latency_counters)
+TEST_DECLARE   (threadpool_batch_completion)
+TEST_DECLARE   (threadpool_max_threads)
 TEST_DECLARE   (thread_mutex)
 TEST_DECLARE   (thread_rwlock)
 #ifdef _WIN32
@@ -123,6 +140,7 @@ TEST_DECLARE   (argument_escaping)
 TEST_DECLARE   (environment_creation)
 TEST_DECLARE   (listen_with_simultaneous_accepts)
 TEST_DECLARE   (listen_no_simultaneous_accepts)
+TEST_DECLARE   (listen_pending_accepts)
 #endif
 HELPER_DECLARE (tcp4_echo_server)
 HELPER_DECLARE (tcp6_echo_server)
@@ -136,6 +154,10 @@ TASK_LIST_START
   TEST_ENTRY  (stdio_over_pipes)
   TEST_ENTRY  (ipc_listen_before_write)
   TEST_ENTRY  (ipc_listen_after_write)
+#ifndef _WIN32
+  TEST_ENTRY  (ipc_send_recv_pipe)
+  TEST_ENTRY  (ipc_send_recv_udp)
+#endif
 
   TEST_ENTRY  (tcp_ref)
 
@@ -202,6 +224,7 @@ TASK_LIST_START
   TEST_ENTRY  (timer_ref2)
 
   TEST_ENTRY  (timer_again)
+  TEST_ENTRY  (timer_next_timeout)
 
   TEST_ENTRY  (idle_starvation)
 
@@ -239,12 +262,19 @@ TASK_LIST_START
   TEST_ENTRY  (spawn_and_kill)
   TEST_ENTRY  (spawn_and_ping)
   TEST_ENTRY  (kill)
+#ifndef _WIN32
+  TEST_ENTRY  (spawn_path_from_env)
+  TEST_ENTRY  (spawn_not_found)
+  TEST_ENTRY  (fork_exit_code)
+  TEST_ENTRY  (fork_channel)
+#endif
 #ifdef _WIN32
   TEST_ENTRY  (spawn_detect_pipe_name_collisions_on_windows)
   TEST_ENTRY  (argument_escaping)
   TEST_ENTRY  (environment_creation)
   TEST_ENTRY  (listen_with_simultaneous_accepts)
   TEST_ENTRY  (listen_no_simultaneous_accepts)
+  TEST_ENTRY  (listen_pending_accepts)
 #endif
 
   TEST_ENTRY  (fs_file_noent)
@@ -265,10 +295,16 @@ TASK_LIST_START
   TEST_ENTRY  (fs_event_watch_file_current_dir)
   TEST_ENTRY  (fs_event_no_callback_on_close)
   TEST_ENTRY  (fs_event_immediate_close)
+#ifdef __linux__
+  TEST_ENTRY  (fs_event_watch_dir_recursive)
+#endif
   TEST_ENTRY  (fs_readdir_empty_dir)
   TEST_ENTRY  (fs_readdir_file)
   TEST_ENTRY  (fs_open_dir)
   TEST_ENTRY  (threadpool_queue_work_simple)
+  TEST_ENTRY  (threadpool_latency_counters)
+  TEST_ENTRY  (threadpool_batch_completion)
+  TEST_ENTRY  (threadpool_max_threads)
   TEST_ENTRY  (thread_mutex)
   TEST_ENTRY  (thread_rwlock)
 
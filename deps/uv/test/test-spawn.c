@@ -466,3 +466,152 @@ TEST_IMPL(environment_creation) {
   return 0;
 }
 #endif
+
+#ifndef _WIN32
+#include <unistd.h> /* _exit */
+
+static int expected_exit_status;
+
+
+static void exit_status_cb(uv_process_t* process, int exit_status,
+    int term_signal) {
+  printf("exit_cb\n");
+  exit_cb_called++;
+  ASSERT(exit_status == expected_exit_status);
+  ASSERT(term_signal == 0);
+  uv_close((uv_handle_t*)process, close_cb);
+}
+
+
+/* The PATH of the child's environment, not ours, is searched. */
+TEST_IMPL(spawn_path_from_env) {
+  int r;
+  char* sh_args[] = { "true", NULL };
+  char* sh_env[] = { "PATH=/nonexistent:/bin:/usr/bin", NULL };
+
+  options.file = "true";
+  options.args = sh_args;
+  options.env = sh_env;
+  options.exit_cb = exit_status_cb;
+  expected_exit_status = 0;
+
+  r = uv_spawn(uv_default_loop(), &process, options);
+  ASSERT(r == 0);
+
+  r = uv_run(uv_default_loop());
+  ASSERT(r == 0);
+
+  ASSERT(exit_cb_called == 1);
+  ASSERT(close_cb_called == 1);
+
+  return 0;
+}
+
+
+/* Like with execvp(), a missing program makes the child exit with 127. */
+TEST_IMPL(spawn_not_found) {
+  int r;
+  char* missing_args[] = { "uv-spawn-no-such-program", NULL };
+  char* missing_env[] = { "PATH=/nonexistent", NULL };
+
+  options.file = missing_args[0];
+  options.args = missing_args;
+  options.env = missing_env;
+  options.exit_cb = exit_status_cb;
+  expected_exit_status = 127;
+
+  r = uv_spawn(uv_default_loop(), &process, options);
+  ASSERT(r == 0);
+
+  r = uv_run(uv_default_loop());
+  ASSERT(r == 0);
+
+  ASSERT(exit_cb_called == 1);
+  ASSERT(close_cb_called == 1);
+
+  return 0;
+}
+
+
+static void fork_timer_cb(uv_timer_t* handle, int status) {
+  /* Only the child's loop runs this. */
+  _exit(3);
+}
+
+
+/* The child goes on with the same loop, and the parent sees it exit. */
+TEST_IMPL(fork_exit_code) {
+  int r;
+
+  r = uv_timer_init(uv_default_loop(), &timer);
+  ASSERT(r == 0);
+
+  expected_exit_status = 3;
+  r = uv_fork(uv_default_loop(), &process, exit_status_cb, NULL);
+  ASSERT(r >= 0);
+
+  if (r == 0) {
+    r = uv_timer_start(&timer, fork_timer_cb, 1, 0);
+    ASSERT(r == 0);
+    uv_run(uv_default_loop());
+    _exit(1);
+  }
+
+  ASSERT(process.pid == r);
+  uv_close((uv_handle_t*)&timer, close_cb);
+
+  r = uv_run(uv_default_loop());
+  ASSERT(r == 0);
+
+  ASSERT(exit_cb_called == 1);
+  ASSERT(close_cb_called == 2);
+
+  return 0;
+}
+
+
+static uv_pipe_t fork_channel;
+static uv_write_t fork_write_req;
+
+
+static void fork_write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  _exit(0);
+}
+
+
+/* The child writes to its end of the channel, the parent reads to the EOF. */
+TEST_IMPL(fork_channel) {
+  int r;
+  uv_buf_t buf;
+
+  r = uv_pipe_init(uv_default_loop(), &fork_channel, 0);
+  ASSERT(r == 0);
+
+  expected_exit_status = 0;
+  r = uv_fork(uv_default_loop(), &process, exit_status_cb, &fork_channel);
+  ASSERT(r >= 0);
+
+  if (r == 0) {
+    buf = uv_buf_init("hello from the child", 20);
+    r = uv_write(&fork_write_req, (uv_stream_t*)&fork_channel, &buf, 1,
+        fork_write_cb);
+    ASSERT(r == 0);
+    uv_run(uv_default_loop());
+    _exit(1);
+  }
+
+  r = uv_read_start((uv_stream_t*)&fork_channel, on_alloc, on_read);
+  ASSERT(r == 0);
+
+  r = uv_run(uv_default_loop());
+  ASSERT(r == 0);
+
+  ASSERT(exit_cb_called == 1);
+  ASSERT(close_cb_called == 2);
+  ASSERT(output_used == 20);
+  ASSERT(memcmp(output, "hello from the child", 20) == 0);
+
+  return 0;
+}
+#endif
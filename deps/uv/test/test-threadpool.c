@@ -55,3 +55,166 @@ TEST_IMPL(threadpool_queue_work_simple) {
 
   return 0;
 }
+
+
+static void latency_after_work_cb(uv_work_t* req) {
+  uv_latency_t* latency = &req->loop->counters.latency[UV_LATENCY_WORK];
+  /* Counted out before the callback runs. */
+  ASSERT(latency->in_flight == 0);
+  ASSERT(latency->completed == 1);
+  after_work_cb_count++;
+}
+
+
+TEST_IMPL(threadpool_latency_counters) {
+  uv_loop_t* loop;
+  uv_latency_t* latency;
+  uint64_t bucketed;
+  int r;
+  int i;
+
+  loop = uv_loop_new();
+  latency = &loop->counters.latency[UV_LATENCY_WORK];
+  after_work_cb_count = 0;
+
+  work_req.data = &data;
+  r = uv_queue_work(loop, &work_req, work_cb, latency_after_work_cb);
+  ASSERT(r == 0);
+  ASSERT(latency->in_flight == 1);
+  ASSERT(latency->completed == 0);
+
+  uv_run(loop);
+
+  ASSERT(after_work_cb_count == 1);
+  ASSERT(latency->in_flight == 0);
+  ASSERT(latency->completed == 1);
+  ASSERT(latency->total_time > 0);
+
+  bucketed = 0;
+  for (i = 0; i < UV_LATENCY_BUCKETS; i++)
+    bucketed += latency->buckets[i];
+  ASSERT(bucketed == 1);
+
+  /* Nothing else was counted. */
+  ASSERT(loop->counters.latency[UV_LATENCY_FS].completed == 0);
+  ASSERT(loop->counters.latency[UV_LATENCY_WRITE].completed == 0);
+
+  uv_loop_delete(loop);
+
+  return 0;
+}
+
+
+#define BATCH_REQS 16
+
+static uv_work_t batch_reqs[BATCH_REQS];
+static int batch_cb_count;
+static int batch_depth;
+
+
+static void batched_after_work_cb(uv_work_t* req) {
+  /* Only ever run from within the batch callback. */
+  ASSERT(batch_depth == 1);
+  after_work_cb_count++;
+}
+
+
+static void batch_cb(uv_loop_t* loop) {
+  batch_cb_count++;
+  batch_depth++;
+  while (uv_work_drain(loop));
+  batch_depth--;
+}
+
+
+TEST_IMPL(threadpool_batch_completion) {
+  uv_loop_t* loop;
+  int r;
+  int i;
+
+  loop = uv_loop_new();
+  uv_work_set_batch_cb(loop, batch_cb);
+  after_work_cb_count = 0;
+
+  for (i = 0; i < BATCH_REQS; i++) {
+    batch_reqs[i].work_type = i % 2 ? 3 : 1;
+    r = uv_queue_work(loop, &batch_reqs[i], NULL, batched_after_work_cb);
+    ASSERT(r == 0);
+  }
+
+  uv_run(loop);
+
+  ASSERT(after_work_cb_count == BATCH_REQS);
+  ASSERT(batch_cb_count >= 1);
+  ASSERT(batch_cb_count <= BATCH_REQS);
+  ASSERT(loop->counters.work_batch == (uint64_t) batch_cb_count);
+  ASSERT(loop->counters.work_batched[1] == BATCH_REQS / 2);
+  ASSERT(loop->counters.work_batched[3] == BATCH_REQS / 2);
+  ASSERT(loop->counters.work_batched[0] == 0);
+
+  uv_loop_delete(loop);
+
+  return 0;
+}
+
+
+#define CAPPED_REQS 8
+#define CAPPED_MAX_THREADS 2
+
+static uv_work_t capped_reqs[CAPPED_REQS];
+static uv_mutex_t capped_mutex;
+static int capped_running;
+static int capped_max_running;
+
+
+static void capped_work_cb(uv_work_t* req) {
+  uv_mutex_lock(&capped_mutex);
+  capped_running++;
+  if (capped_running > capped_max_running)
+    capped_max_running = capped_running;
+  uv_mutex_unlock(&capped_mutex);
+
+  /* Long enough for the other threads to pick up work if allowed to. */
+  uv_sleep(20);
+
+  uv_mutex_lock(&capped_mutex);
+  capped_running--;
+  uv_mutex_unlock(&capped_mutex);
+}
+
+
+static void capped_after_work_cb(uv_work_t* req) {
+  after_work_cb_count++;
+}
+
+
+TEST_IMPL(threadpool_max_threads) {
+  uv_loop_t* loop;
+  int r;
+  int i;
+
+  ASSERT(0 == uv_mutex_init(&capped_mutex));
+  uv_threadpool_set_size(CAPPED_REQS);
+
+  loop = uv_loop_new();
+  uv_threadpool_set_max_threads(loop, CAPPED_MAX_THREADS);
+  after_work_cb_count = 0;
+
+  for (i = 0; i < CAPPED_REQS; i++) {
+    r = uv_queue_work(loop, &capped_reqs[i], capped_work_cb,
+        capped_after_work_cb);
+    ASSERT(r == 0);
+  }
+
+  uv_run(loop);
+
+  /* Everything queued ran, but never more than the cap at a time. */
+  ASSERT(after_work_cb_count == CAPPED_REQS);
+  ASSERT(capped_running == 0);
+  ASSERT(capped_max_running == CAPPED_MAX_THREADS);
+
+  uv_loop_delete(loop);
+  uv_mutex_destroy(&capped_mutex);
+
+  return 0;
+}
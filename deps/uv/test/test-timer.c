@@ -170,3 +170,40 @@ TEST_IMPL(timer_ref2) {
 
   return 0;
 }
+
+
+TEST_IMPL(timer_next_timeout) {
+  uv_loop_t* loop;
+  uv_timer_t near, far;
+  int64_t timeout;
+  int r;
+
+  loop = uv_loop_new();
+  ASSERT(uv_next_timeout(loop) == -1);
+
+  r = uv_timer_init(loop, &far);
+  ASSERT(r == 0);
+  r = uv_timer_start(&far, never_cb, 10000, 0);
+  ASSERT(r == 0);
+
+  r = uv_timer_init(loop, &near);
+  ASSERT(r == 0);
+  r = uv_timer_start(&near, never_cb, 500, 0);
+  ASSERT(r == 0);
+
+  timeout = uv_next_timeout(loop);
+  ASSERT(timeout > 0 && timeout <= 500);
+
+  r = uv_timer_stop(&near);
+  ASSERT(r == 0);
+  timeout = uv_next_timeout(loop);
+  ASSERT(timeout > 500 && timeout <= 10000);
+
+  r = uv_timer_stop(&far);
+  ASSERT(r == 0);
+  ASSERT(uv_next_timeout(loop) == -1);
+
+  uv_loop_delete(loop);
+
+  return 0;
+}
@@ -30,6 +30,10 @@
 #include "log-utils.h"
 #include "string-stream.h"
 
+#ifdef __linux__
+#include <unistd.h>  // getpid
+#endif
+
 namespace v8 {
 namespace internal {
 
@@ -41,6 +45,10 @@ Log::Log(Logger* logger)
   : is_stopped_(false),
     output_handle_(NULL),
     ll_output_handle_(NULL),
+    perf_output_handle_(NULL),
+    perf_buffer_(NULL),
+    perf_buffer_pos_(0),
+    perf_last_flush_(0),
     mutex_(NULL),
     message_buffer_(NULL),
     logger_(logger) {
@@ -132,6 +140,8 @@ void Log::Initialize() {
       }
     }
   }
+
+  if (FLAG_perf_basic_prof) OpenPerfMap();
 }
 
 
@@ -170,6 +180,60 @@ void Log::OpenFile(const char* name) {
 }
 
 
+// Size of the buffer perf map entries are collected in. Longer names are
+// cut short to fit.
+static const int kPerfMapBufferSize = 64 * KB;
+static const int kPerfMapMaxNameSize = 1 * KB;
+
+// How long entries may wait in the buffer before they are written out, so
+// that a running perf top sees new code soon enough.
+static const double kPerfMapFlushIntervalMs = 1000;
+
+
+void Log::OpenPerfMap() {
+#ifdef __linux__
+  ScopedVector<char> name(32);
+  OS::SNPrintF(name, "/tmp/perf-%d.map", static_cast<int>(getpid()));
+  // The first isolate starts a new map, the others add to it.
+  const char* mode = Isolate::Current()->IsDefaultIsolate() ? "w" : "a";
+  perf_output_handle_ = OS::FOpen(name.start(), mode);
+  if (perf_output_handle_ == NULL) return;
+  setvbuf(perf_output_handle_, NULL, _IONBF, 0);
+  perf_buffer_ = NewArray<char>(kPerfMapBufferSize);
+  perf_buffer_pos_ = 0;
+  perf_last_flush_ = OS::TimeCurrentMillis();
+#endif
+}
+
+
+void Log::WritePerfMapEntry(Address start, int size,
+                            const char* name, int name_size) {
+  if (!IsPerfMapEnabled()) return;
+  if (name_size > kPerfMapMaxNameSize) name_size = kPerfMapMaxNameSize;
+  // An address, a size and the separators take well under 64 bytes.
+  if (perf_buffer_pos_ + name_size + 64 > kPerfMapBufferSize) FlushPerfMap();
+  Vector<char> entry(perf_buffer_ + perf_buffer_pos_,
+                     kPerfMapBufferSize - perf_buffer_pos_);
+  int length = OS::SNPrintF(entry, "%" V8PRIxPTR " %x %.*s\n",
+                            reinterpret_cast<uintptr_t>(start),
+                            size, name_size, name);
+  if (length > 0) perf_buffer_pos_ += length;
+  if (OS::TimeCurrentMillis() - perf_last_flush_ >= kPerfMapFlushIntervalMs) {
+    FlushPerfMap();
+  }
+}
+
+
+void Log::FlushPerfMap() {
+  if (perf_buffer_pos_ > 0) {
+    size_t rv = fwrite(perf_buffer_, 1, perf_buffer_pos_, perf_output_handle_);
+    USE(rv);
+    perf_buffer_pos_ = 0;
+  }
+  perf_last_flush_ = OS::TimeCurrentMillis();
+}
+
+
 FILE* Log::Close() {
   FILE* result = NULL;
   if (output_handle_ != NULL) {
@@ -182,6 +246,13 @@ FILE* Log::Close() {
   output_handle_ = NULL;
   if (ll_output_handle_ != NULL) fclose(ll_output_handle_);
   ll_output_handle_ = NULL;
+  if (perf_output_handle_ != NULL) {
+    FlushPerfMap();
+    fclose(perf_output_handle_);
+  }
+  perf_output_handle_ = NULL;
+  DeleteArray(perf_buffer_);
+  perf_buffer_ = NULL;
 
   DeleteArray(message_buffer_);
   message_buffer_ = NULL;
@@ -54,6 +54,11 @@ class Log {
     return !is_stopped_ && output_handle_ != NULL;
   }
 
+  // Returns whether a perf map is being written.
+  bool IsPerfMapEnabled() {
+    return !is_stopped_ && perf_output_handle_ != NULL;
+  }
+
   // Size of buffer used for formatting log messages.
   static const int kMessageBufferSize = 2048;
 
@@ -73,6 +78,19 @@ class Log {
   // Opens a temporary file for logging.
   void OpenTemporaryFile();
 
+  // Opens /tmp/perf-<pid>.map, where perf looks up the symbols of code
+  // it finds no other symbols for.
+  void OpenPerfMap();
+
+  // Adds an entry for a piece of generated code to the perf map. Entries
+  // are buffered and written out when the buffer fills up or a second has
+  // passed since the last write.
+  void WritePerfMapEntry(Address start, int size,
+                         const char* name, int name_size);
+
+  // Writes out the buffered perf map entries.
+  void FlushPerfMap();
+
   // Implementation of writing to a log file.
   int WriteToFile(const char* msg, int length) {
     ASSERT(output_handle_ != NULL);
@@ -93,6 +111,14 @@ class Log {
   // Used when low-level profiling is active.
   FILE* ll_output_handle_;
 
+  // Used when --perf-basic-prof is active. Entries are collected in
+  // perf_buffer_ and written with a single write each time, so that
+  // several isolates can append to the same map without mixing their lines.
+  FILE* perf_output_handle_;
+  char* perf_buffer_;
+  int perf_buffer_pos_;
+  double perf_last_flush_;
+
   // mutex_ is a Mutex used for enforcing exclusive
   // access to the formatting buffer and the log file or log memory buffer.
   Mutex* mutex_;
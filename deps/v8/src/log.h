@@ -343,6 +343,9 @@ class Logger {
 
   void LowLevelLogWriteBytes(const char* bytes, int size);
 
+  // Writes a perf map entry for code when --perf-basic-prof is on.
+  void PerfBasicCodeCreateEvent(Code* code, const char* name, int name_size);
+
   template <typename T>
   void LowLevelLogWriteStruct(const T& s) {
     char tag = T::kTag;
@@ -136,6 +136,8 @@ void MarkCompactCollector::Prepare(GCTracer* tracer) {
     compacting_collection_ = false;
   }
 #endif
+  // A perf map can't express code that moved.
+  if (FLAG_perf_basic_prof) compacting_collection_ = false;
 
   PagedSpaces spaces;
   for (PagedSpace* space = spaces.next();
@@ -45,21 +45,6 @@ SlowBuffer.prototype.inspect = function() {
 };
 
 
-SlowBuffer.prototype.hexSlice = function(start, end) {
-  var len = this.length;
-
-  if (!start || start < 0) start = 0;
-  if (!end || end < 0 || end > len) end = len;
-
-  var out = '';
-  for (var i = start; i < end; i++) {
-    out += toHex(this[i]);
-  }
-  return out;
-};
-
-
-
 SlowBuffer.prototype.toString = function(encoding, start, end) {
   encoding = String(encoding || 'utf8').toLowerCase();
   start = +start || 0;
@@ -97,36 +82,6 @@ SlowBuffer.prototype.toString = function(encoding, start, end) {
 };
 
 
-SlowBuffer.prototype.hexWrite = function(string, offset, length) {
-  offset = +offset || 0;
-  var remaining = this.length - offset;
-  if (!length) {
-    length = remaining;
-  } else {
-    length = +length;
-    if (length > remaining) {
-      length = remaining;
-    }
-  }
-
-  // must be an even number of digits
-  var strLen = string.length;
-  if (strLen % 2) {
-    throw new Error('Invalid hex string');
-  }
-  if (length > strLen / 2) {
-    length = strLen / 2;
-  }
-  for (var i = 0; i < length; i++) {
-    var byte = parseInt(string.substr(i * 2, 2), 16);
-    if (isNaN(byte)) throw new Error('Invalid hex string');
-    this[offset + i] = byte;
-  }
-  SlowBuffer._charsWritten = i * 2;
-  return i;
-};
-
-
 SlowBuffer.prototype.write = function(string, offset, length, encoding) {
   // Support both (string, offset, length, encoding)
   // and the legacy (string, encoding, offset, length)
@@ -219,6 +174,15 @@ function Buffer(subject, encoding, offset) {
     this.length = coerce(encoding);
     this.parent = subject;
     this.offset = offset;
+    SlowBuffer.makeFastBuffer(this.parent, this, this.offset, this.length);
+  } else if (subject && typeof subject === 'object' &&
+             typeof subject.length !== 'number' &&
+             subject instanceof ArrayBuffer) {
+    // Share the ArrayBuffer's memory instead of copying it.
+    this.parent = new SlowBuffer(subject);
+    this.length = this.parent.length;
+    this.offset = 0;
+    SlowBuffer.makeFastBuffer(this.parent, this, this.offset, this.length);
   } else {
     // Find the length
     switch (type = typeof subject) {
@@ -239,18 +203,10 @@ function Buffer(subject, encoding, offset) {
                         'array or string.');
     }
 
-    if (this.length > Buffer.poolSize) {
-      // Big buffer, just alloc one.
-      this.parent = new SlowBuffer(this.length);
-      this.offset = 0;
-
-    } else {
-      // Small buffer.
-      if (!pool || pool.length - pool.used < this.length) allocPool();
-      this.parent = pool;
-      this.offset = pool.used;
-      pool.used += this.length;
-    }
+    // Sets this.parent and this.offset, to a slice of the buffer pool or,
+    // above Buffer.poolSize bytes, to a SlowBuffer of its own, and makes
+    // this a fast buffer over them; one native call.
+    SlowBuffer.allocFast(this, this.length, Buffer.poolSize);
 
     // Treat array-ish objects as a byte array.
     if (isArrayIsh(subject)) {
@@ -259,11 +215,13 @@ function Buffer(subject, encoding, offset) {
       }
     } else if (type == 'string') {
       // We are a string
-      this.length = this.write(subject, 0, encoding);
+      var written = this.write(subject, 0, encoding);
+      if (written !== this.length) {
+        this.length = written;
+        SlowBuffer.makeFastBuffer(this.parent, this, this.offset, written);
+      }
     }
   }
-
-  SlowBuffer.makeFastBuffer(this.parent, this, this.offset, this.length);
 }
 
 function isArrayIsh(subject) {
@@ -276,12 +234,13 @@ exports.SlowBuffer = SlowBuffer;
 exports.Buffer = Buffer;
 
 Buffer.poolSize = 8 * 1024;
-var pool;
 
-function allocPool() {
-  pool = new SlowBuffer(Buffer.poolSize);
-  pool.used = 0;
-}
+// 'ascii' and 'binary' strings of at least this many bytes share the
+// buffer's memory instead of being copied. Off by default.
+Buffer.externalStringSize = Infinity;
+
+// fill() and copy() at or below this many bytes stay in JavaScript.
+var FAST_COPY_MAX = 64;
 
 
 // Static methods
@@ -414,10 +373,12 @@ Buffer.prototype.toString = function(encoding, start, end) {
       return this.parent.utf8Slice(start, end);
 
     case 'ascii':
-      return this.parent.asciiSlice(start, end);
+      return this.parent.asciiSlice(start, end,
+                                    end - start >= Buffer.externalStringSize);
 
     case 'binary':
-      return this.parent.binarySlice(start, end);
+      return this.parent.binarySlice(start, end,
+                                     end - start >= Buffer.externalStringSize);
 
     case 'base64':
       return this.parent.base64Slice(start, end);
@@ -436,6 +397,72 @@ Buffer.prototype.toString = function(encoding, start, end) {
 Buffer.byteLength = SlowBuffer.byteLength;
 
 
+// concat(list, [totalLength])
+Buffer.concat = function(list, length) {
+  if (!Array.isArray(list)) {
+    throw new TypeError('Usage: Buffer.concat(list, [length])');
+  }
+
+  if (list.length === 0) {
+    return new Buffer(0);
+  } else if (list.length === 1) {
+    return list[0];
+  }
+
+  if (typeof length !== 'number') {
+    length = 0;
+    for (var i = 0; i < list.length; i++) {
+      length += list[i].length;
+    }
+  }
+
+  var buffer = new Buffer(length);
+  SlowBuffer.concat(list, buffer);
+  return buffer;
+};
+
+
+function assertBuffers(a, b) {
+  if (!Buffer.isBuffer(a) || !Buffer.isBuffer(b)) {
+    throw new TypeError('Arguments must be Buffers');
+  }
+}
+
+
+// compare(a, b), usable as a sort() comparator
+Buffer.compare = function compare(a, b) {
+  assertBuffers(a, b);
+  return SlowBuffer.compare(a, b);
+};
+
+
+Buffer.timingSafeEqual = function timingSafeEqual(a, b) {
+  assertBuffers(a, b);
+  return SlowBuffer.timingSafeEqual(a, b);
+};
+
+
+Buffer.prototype.compare = function compare(other) {
+  assertBuffers(this, other);
+  return SlowBuffer.compare(this, other);
+};
+
+
+Buffer.prototype.equals = function equals(other) {
+  assertBuffers(this, other);
+  return SlowBuffer.equals(this, other);
+};
+
+
+// arenaStats
+Buffer.arenaStats = SlowBuffer.arenaStats;
+
+
+// Allocation site sampling
+Buffer.setAllocationSampling = SlowBuffer.setAllocationSampling;
+Buffer.allocationProfile = SlowBuffer.allocationProfile;
+
+
 // fill(value, start=0, end=buffer.length)
 Buffer.prototype.fill = function fill(value, start, end) {
   value || (value = 0);
@@ -463,6 +490,16 @@ Buffer.prototype.fill = function fill(value, start, end) {
     throw new Error('end out of bounds');
   }
 
+  // Short fills are cheaper as element stores, which V8 compiles into
+  // direct writes through the external array pointer, than as a call into
+  // C++ that has to unwrap and check every argument.
+  if (end - start <= FAST_COPY_MAX && (value | 0) === value) {
+    for (var i = start; i < end; i++) {
+      this[i] = value;
+    }
+    return;
+  }
+
   return this.parent.fill(value,
                           start + this.offset,
                           end + this.offset);
@@ -503,6 +540,24 @@ Buffer.prototype.copy = function(target, target_start, start, end) {
     end = target.length - target_start + start;
   }
 
+  // See fill(). Overlapping ranges are only possible within one parent;
+  // copy from the back when the target lies after the source.
+  var n = end - start;
+  if (n <= FAST_COPY_MAX && target instanceof Buffer) {
+    var i;
+    if (target.parent === this.parent &&
+        target.offset + target_start > this.offset + start) {
+      for (i = n - 1; i >= 0; i--) {
+        target[target_start + i] = this[start + i];
+      }
+    } else {
+      for (i = 0; i < n; i++) {
+        target[target_start + i] = this[start + i];
+      }
+    }
+    return n;
+  }
+
   return this.parent.copy(target.parent,
                           target_start + target.offset,
                           start + this.offset,
@@ -510,6 +565,27 @@ Buffer.prototype.copy = function(target, target_start, start, end) {
 };
 
 
+// indexOf(value, byteOffset=0, encoding='utf8')
+Buffer.prototype.indexOf = function(value, byteOffset, encoding) {
+  byteOffset = +byteOffset || 0;
+  if (byteOffset < 0) byteOffset = Math.max(this.length + byteOffset, 0);
+  if (byteOffset > this.length) return -1;
+
+  if (typeof value === 'string') {
+    value = new Buffer(value, encoding);
+  } else if (typeof value === 'number') {
+    value = value & 0xff;
+  } else if (!Buffer.isBuffer(value)) {
+    throw new TypeError('value must be a string, number or Buffer');
+  }
+
+  var index = this.parent.indexOf(value,
+                                  this.offset + byteOffset,
+                                  this.offset + this.length);
+  return index < 0 ? -1 : index - this.offset;
+};
+
+
 // slice(start, end)
 Buffer.prototype.slice = function(start, end) {
   if (end === undefined) end = this.length;
@@ -698,7 +774,7 @@ Buffer.prototype.readInt8 = function(offset, noAssert) {
 };
 
 function readInt16(buffer, offset, isBigEndian, noAssert) {
-  var neg;
+  var neg, val;
 
   if (!noAssert) {
     assert.ok(typeof (isBigEndian) === 'boolean',
@@ -729,7 +805,7 @@ Buffer.prototype.readInt16BE = function(offset, noAssert) {
 };
 
 function readInt32(buffer, offset, isBigEndian, noAssert) {
-  var neg;
+  var neg, val;
 
   if (!noAssert) {
     assert.ok(typeof (isBigEndian) === 'boolean',
@@ -1119,3 +1195,80 @@ Buffer.prototype.writeDoubleLE = function(value, offset, noAssert) {
 Buffer.prototype.writeDoubleBE = function(value, offset, noAssert) {
   writeDouble(this, value, offset, true, noAssert);
 };
+
+
+// Bulk reads and writes of numbers, through typed arrays. The bounds are
+// checked even with noAssert; it costs one comparison per call here.
+
+// The typed array constructors are looked up on first use, so that loading
+// this module doesn't create them.
+function arrayOf(type) {
+  return type.array || (type.array = global[type.arrayName]);
+}
+
+function readArray(buffer, offset, count, target, type, isBigEndian,
+                   noAssert) {
+  var TypedArray = arrayOf(type);
+  if (target === undefined) target = new TypedArray(count);
+
+  if (!noAssert) {
+    assert.ok(offset !== undefined && offset !== null,
+        'missing offset');
+
+    assert.ok(target instanceof TypedArray,
+        'target must be a ' + type.arrayName);
+  }
+
+  if (offset + count * type.size > buffer.length) {
+    throw new RangeError('Trying to read beyond buffer length');
+  }
+
+  return buffer.parent.readTypedArray(buffer.offset + offset, target, count,
+                                      !isBigEndian);
+}
+
+function writeArray(buffer, source, offset, type, isBigEndian, noAssert) {
+  var TypedArray = arrayOf(type);
+  if (!(source instanceof TypedArray)) source = new TypedArray(source);
+
+  if (!noAssert) {
+    assert.ok(offset !== undefined && offset !== null,
+        'missing offset');
+  }
+
+  if (offset + source.length * type.size > buffer.length) {
+    throw new RangeError('Trying to write beyond buffer length');
+  }
+
+  buffer.parent.writeTypedArray(source, buffer.offset + offset, source.length,
+                                !isBigEndian);
+}
+
+[
+  { name: 'Int16', array: null, arrayName: 'Int16Array', size: 2 },
+  { name: 'UInt16', array: null, arrayName: 'Uint16Array', size: 2 },
+  { name: 'Int32', array: null, arrayName: 'Int32Array', size: 4 },
+  { name: 'UInt32', array: null, arrayName: 'Uint32Array', size: 4 },
+  { name: 'Float', array: null, arrayName: 'Float32Array', size: 4 },
+  { name: 'Double', array: null, arrayName: 'Float64Array', size: 8 }
+].forEach(function(type) {
+  Buffer.prototype['read' + type.name + 'ArrayLE'] =
+      function(offset, count, target, noAssert) {
+        return readArray(this, offset, count, target, type, false, noAssert);
+      };
+
+  Buffer.prototype['read' + type.name + 'ArrayBE'] =
+      function(offset, count, target, noAssert) {
+        return readArray(this, offset, count, target, type, true, noAssert);
+      };
+
+  Buffer.prototype['write' + type.name + 'ArrayLE'] =
+      function(source, offset, noAssert) {
+        writeArray(this, source, offset, type, false, noAssert);
+      };
+
+  Buffer.prototype['write' + type.name + 'ArrayBE'] =
+      function(source, offset, noAssert) {
+        writeArray(this, source, offset, type, true, noAssert);
+      };
+});
@@ -20,6 +20,7 @@
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 var EventEmitter = require('events').EventEmitter;
+var SlowBuffer = require('buffer').SlowBuffer;
 var net = require('net');
 var Process = process.binding('process_wrap').Process;
 var inherits = require('util').inherits;
@@ -68,10 +69,55 @@ function mergeOptions(target, overrides) {
 }
 
 
-function setupChannel(target, channel) {
+// IPC messages are either JSON lines or, when both ends agreed on binary
+// framing through NODE_CHANNEL_FRAMING, frames of a 4 byte big endian
+// length, a type byte and the payload. Frames are split in PipeWrap.
+var FRAME_HEADER = 5,
+    FRAME_MAX = 64 * 1024 * 1024,
+    FRAME_JSON = 0,
+    FRAME_BUFFER = 1;
+
+
+function frameMessage(message) {
+  var type, payload, buffer, length;
+
+  if (Buffer.isBuffer(message)) {
+    type = FRAME_BUFFER;
+    length = message.length;
+  } else {
+    type = FRAME_JSON;
+    payload = JSON.stringify(message);
+    length = Buffer.byteLength(payload);
+  }
+
+  if (length > FRAME_MAX) {
+    throw new Error('IPC message too large');
+  }
+
+  buffer = new Buffer(FRAME_HEADER + length);
+  if (type === FRAME_BUFFER) {
+    message.copy(buffer, FRAME_HEADER);
+  } else {
+    buffer.write(payload, FRAME_HEADER, 'utf8');
+  }
+
+  buffer[0] = (length >>> 24) & 0xff;
+  buffer[1] = (length >>> 16) & 0xff;
+  buffer[2] = (length >>> 8) & 0xff;
+  buffer[3] = length & 0xff;
+  buffer[4] = type;
+  return buffer;
+}
+
+
+function setupChannel(target, channel, framing) {
   var isWindows = process.platform === 'win32';
   target._channel = channel;
 
+  // Received UDP handles are instantiated from the udp_wrap binding, which
+  // has to be loaded before the first one arrives. Windows only passes TCP.
+  if (!isWindows) process.binding('udp_wrap');
+
   var jsonBuffer = '';
 
   if (isWindows) {
@@ -111,7 +157,35 @@ function setupChannel(target, channel) {
     }
   };
 
+  channel.onframes = function(buffers, offsets, lengths, types, handles) {
+    for (var i = 0; i < buffers.length; i++) {
+      var start = offsets[i], end = offsets[i] + lengths[i];
+      var message, recvHandle = handles[i];
+
+      if (recvHandle && setSimultaneousAccepts) {
+        // Update simultaneous accepts on Windows
+        setSimultaneousAccepts(recvHandle);
+      }
+
+      if (types[i] === FRAME_BUFFER) {
+        message = buffers[i].slice(start, end);
+      } else {
+        message = JSON.parse(buffers[i].toString('utf8', start, end));
+      }
+
+      target.emit('message', message, recvHandle);
+    }
+  };
+
+  if (framing) channel.setFraming(true);
+
   target.send = function(message, sendHandle) {
+    return target._send(message, sendHandle, nop);
+  };
+
+  // Like send() but calls `oncomplete` once the message, and the handle
+  // with it, has been written to the channel.
+  target._send = function(message, sendHandle, oncomplete) {
     if (!target._channel) throw new Error("channel closed");
 
     // For overflow protection don't write if channel queue is too deep.
@@ -119,7 +193,8 @@ function setupChannel(target, channel) {
       return false;
     }
 
-    var buffer = Buffer(JSON.stringify(message) + '\n');
+    var buffer = framing ? frameMessage(message) :
+                           Buffer(JSON.stringify(message) + '\n');
 
     if (sendHandle && setSimultaneousAccepts) {
       // Update simultaneous accepts on Windows
@@ -132,7 +207,7 @@ function setupChannel(target, channel) {
       throw new Error(errno + " cannot write to IPC channel.");
     }
 
-    writeReq.oncomplete = nop;
+    writeReq.oncomplete = oncomplete;
 
     return true;
   };
@@ -145,6 +220,10 @@ function nop() { }
 
 
 exports.fork = function(modulePath, args, options) {
+  if (options && options.zygote) {
+    return options.zygote.fork(modulePath, args, options);
+  }
+
   if (!options) options = {};
   options.fork = true;
 
@@ -168,12 +247,21 @@ exports.fork = function(modulePath, args, options) {
   if (!options.env) options.env = { };
   options.env.NODE_CHANNEL_FD = 42;
 
+  var framing = options.ipcFraming === 'binary';
+  if (framing) {
+    options.env.NODE_CHANNEL_FRAMING = 'binary';
+  } else if (options.ipcFraming && options.ipcFraming !== 'json') {
+    throw new Error('ipcFraming must be "json" or "binary"');
+  } else {
+    delete options.env.NODE_CHANNEL_FRAMING;
+  }
+
   // stdin is the IPC channel.
   options.stdinStream = createPipe(true);
 
   var child = spawn(process.execPath, args, options);
 
-  setupChannel(child, options.stdinStream);
+  setupChannel(child, options.stdinStream, framing);
 
   child.on('exit', function() {
     if (child._channel) {
@@ -189,7 +277,329 @@ exports._forkChild = function() {
   // set process.send()
   var p = createPipe(true);
   p.open(process._stdio_fds[0]);
-  setupChannel(process, p);
+  setupChannel(process, p, process.env.NODE_CHANNEL_FRAMING === 'binary');
+};
+
+
+// A zygote is a node process that loads the modules children need once, and
+// then forks a child from itself for each fork() instead of starting node
+// again. The children are the zygote's; it reports their pids and how they
+// exit, and hands this process one end of a socketpair as each child's
+// channel. Messages to the zygote and back:
+//
+//   { cmd: 'fork', id, modulePath, args, env, cwd, framing }
+//   { cmd: 'forked', id, pid } with the channel, or { cmd: 'forked', id,
+//   error } if forking failed
+//   { cmd: 'exit', id, code, signal }
+//   { cmd: 'close' } to exit once the children have
+function Zygote(options) {
+  EventEmitter.call(this);
+
+  var self = this;
+  options = options || {};
+
+  var env = {};
+  var source = options.env || process.env;
+  for (var key in source) env[key] = source[key];
+  env.NODE_ZYGOTE = JSON.stringify(options.preload || []);
+  env.NODE_CHANNEL_FD = 42;
+  delete env.NODE_CHANNEL_FRAMING;
+
+  var channel = createPipe(true);
+
+  this._children = {};
+  this._nextId = 1;
+  this._closed = false;
+
+  this._process = spawn(process.execPath, [], {
+    cwd: options.cwd,
+    env: env,
+    customFds: [-1, 1, 2],
+    stdinStream: channel
+  });
+  this.pid = this._process.pid;
+
+  setupChannel(this._process, channel, false);
+
+  this._process.on('message', function(message, handle) {
+    var child = self._children[message.id];
+    if (!child) return;
+
+    if (message.cmd === 'forked') {
+      child._forked(message, handle);
+    } else if (message.cmd === 'exit') {
+      delete self._children[message.id];
+      child._exited(message.code, message.signal);
+    }
+  });
+
+  this._process.on('exit', function(code, signal) {
+    if (self._process._channel) self._process._channel.close();
+
+    // Children that weren't forked yet never will be.
+    for (var id in self._children) {
+      var child = self._children[id];
+      delete self._children[id];
+      if (child.pid === null) {
+        child.emit('error', new Error('zygote exited'));
+      }
+    }
+
+    self.emit('exit', code, signal);
+  });
+}
+inherits(Zygote, EventEmitter);
+
+
+Zygote.prototype.fork = function(modulePath, args, options) {
+  if (this._closed) throw new Error('zygote closed');
+
+  options = options || {};
+
+  var framing = options.ipcFraming === 'binary';
+  if (options.ipcFraming && options.ipcFraming !== 'json' && !framing) {
+    throw new Error('ipcFraming must be "json" or "binary"');
+  }
+
+  var env = {};
+  var source = options.env || process.env;
+  for (var key in source) env[key] = source[key];
+  env.NODE_CHANNEL_FD = 42;
+  if (framing) {
+    env.NODE_CHANNEL_FRAMING = 'binary';
+  } else {
+    delete env.NODE_CHANNEL_FRAMING;
+  }
+
+  var id = this._nextId++;
+  var child = new ZygoteChild(framing);
+  this._children[id] = child;
+
+  this._process.send({
+    cmd: 'fork',
+    id: id,
+    modulePath: require('path').resolve(modulePath),
+    args: args || [],
+    env: env,
+    cwd: options.cwd || process.cwd(),
+    framing: framing
+  });
+
+  return child;
+};
+
+
+// No fork() after this. The zygote exits once the children it forked have.
+Zygote.prototype.close = function() {
+  if (this._closed) return;
+  this._closed = true;
+  if (this._process._channel) this._process.send({ cmd: 'close' });
+};
+
+
+// What fork() on a zygote returns: a child with send(), kill() and the
+// 'message' and 'exit' events, which has no pid until the zygote reported
+// it. Messages sent before that wait.
+function ZygoteChild(framing) {
+  EventEmitter.call(this);
+
+  var self = this;
+
+  this.pid = null;
+  this.exitCode = null;
+  this.signalCode = null;
+  this.killed = false;
+
+  this._framing = framing;
+  this._channel = null;
+  this._queue = [];
+  this._killSignal = null;
+
+  this.send = function(message, sendHandle) {
+    if (self._queue === null) throw new Error('channel closed');
+    self._queue.push([message, sendHandle]);
+    return true;
+  };
+}
+inherits(ZygoteChild, EventEmitter);
+
+
+ZygoteChild.prototype._forked = function(message, channel) {
+  var queue = this._queue;
+  this._queue = null;
+
+  if (message.error) {
+    this.emit('error', errnoException(message.error, 'fork'));
+    return;
+  }
+
+  this.pid = message.pid;
+  setupChannel(this, channel, this._framing);
+
+  for (var i = 0; i < queue.length; i++) {
+    this.send(queue[i][0], queue[i][1]);
+  }
+
+  if (this._killSignal) this.kill(this._killSignal);
+};
+
+
+ZygoteChild.prototype._exited = function(exitCode, signalCode) {
+  // Like a ChildProcess, either a code or a signal.
+  if (signalCode) {
+    this.signalCode = signalCode;
+  } else {
+    this.exitCode = exitCode;
+  }
+
+  if (this._channel) this._channel.close();
+  this._channel = null;
+
+  this.emit('exit', this.exitCode, this.signalCode);
+};
+
+
+ZygoteChild.prototype.kill = function(sig) {
+  if (!constants) {
+    constants = process.binding('constants');
+  }
+
+  sig = sig || 'SIGTERM';
+  if (!constants[sig]) {
+    throw new Error('Unknown signal: ' + sig);
+  }
+
+  if (this.exitCode !== null || this.signalCode !== null) return;
+
+  if (this.pid === null) {
+    this._killSignal = sig;
+    return;
+  }
+
+  this.killed = true;
+  try {
+    process.kill(this.pid, sig);
+  } catch (e) {
+    // It exited meanwhile, which the zygote is about to report.
+  }
+};
+
+
+exports.createZygote = function(options) {
+  if (typeof Process.prototype.fork !== 'function') {
+    throw new Error('Zygotes are not supported on this platform');
+  }
+  return new Zygote(options);
+};
+
+
+// The zygote's main. It waits for fork requests on its channel, and the
+// children it forks return from here to run their module.
+exports._zygoteMain = function() {
+  var Module = require('module');
+  var path = require('path');
+  var fs = require('fs');
+
+  var preload = JSON.parse(process.env.NODE_ZYGOTE);
+  delete process.env.NODE_ZYGOTE;
+
+  // Modules are found as from a module in the zygote's working directory.
+  var cwd = process.cwd();
+  var loader = new Module('zygote');
+  loader.filename = path.join(cwd, 'zygote');
+  loader.paths = Module._nodeModulePaths(cwd);
+  for (var i = 0; i < preload.length; i++) loader.require(preload[i]);
+
+  var children = {};
+  var count = 0;
+  var sending = [];
+  var closing = false;
+
+  function maybeClose() {
+    if (closing && count === 0 && process._channel) {
+      process._channel.close();
+      process._channel = null;
+    }
+  }
+
+  function report(message, handle) {
+    if (handle) sending.push(handle);
+    process._send(message, handle, function() {
+      var i = handle ? sending.indexOf(handle) : -1;
+      if (i !== -1) {
+        sending.splice(i, 1);
+        handle.close();
+      }
+      maybeClose();
+    });
+  }
+
+  function onmessage(message) {
+    if (message.cmd === 'close') {
+      closing = true;
+      maybeClose();
+      return;
+    }
+
+    if (message.cmd !== 'fork') return;
+
+    var channel = createPipe(true);
+    var handle = new Process();
+    var pid = handle.fork(channel);
+
+    if (pid === 0) {
+      becomeChild(message, channel, handle);
+      return;
+    }
+
+    if (pid < 0) {
+      handle.close();
+      channel.close();
+      report({ cmd: 'forked', id: message.id, error: errno });
+      return;
+    }
+
+    children[pid] = handle;
+    count++;
+    handle.onexit = function(exitCode, signalCode) {
+      delete children[pid];
+      count--;
+      handle.close();
+      report({
+        cmd: 'exit',
+        id: message.id,
+        code: exitCode,
+        signal: signalCode
+      });
+    };
+
+    report({ cmd: 'forked', id: message.id, pid: pid }, channel);
+  }
+
+  function becomeChild(message, channel, handle) {
+    // Whatever the zygote had open is not the child's.
+    handle.close();
+    for (var pid in children) children[pid].close();
+    for (var i = 0; i < sending.length; i++) sending[i].close();
+    sending = [];
+    process.removeAllListeners('message');
+
+    // The zygote's channel is stdin; /dev/null takes its place.
+    process._channel.close();
+    process._channel = null;
+    fs.openSync('/dev/null', 'r');
+
+    setupChannel(process, channel, message.framing);
+
+    for (var key in process.env) delete process.env[key];
+    for (var key in message.env) process.env[key] = message.env[key];
+    process.chdir(message.cwd);
+    process.argv = [process.argv[0], message.modulePath].concat(message.args);
+
+    process.nextTick(Module.runMain);
+  }
+
+  process.on('message', onmessage);
 };
 
 
@@ -301,23 +711,21 @@ exports.execFile = function(file /* args, options, callback */) {
     }, options.timeout);
   }
 
-  child.stdout.setEncoding(options.encoding);
-  child.stderr.setEncoding(options.encoding);
+  function overflow() {
+    if (err) return;
+    err = new Error('maxBuffer exceeded.');
+    kill();
+  }
 
-  child.stdout.addListener('data', function(chunk) {
-    stdout += chunk;
-    if (stdout.length > options.maxBuffer) {
-      err = new Error('maxBuffer exceeded.');
-      kill();
-    }
+  // The pipes collect the output natively and it is decoded once at EOF.
+  // Should someone else want the 'data' events, collection stops and the
+  // output is concatenated from the chunks as they come in.
+  collectOutput(child.stdout, options, overflow, function(output) {
+    stdout = output;
   });
 
-  child.stderr.addListener('data', function(chunk) {
-    stderr += chunk;
-    if (stderr.length > options.maxBuffer) {
-      err = new Error('maxBuffer exceeded.');
-      kill();
-    }
+  collectOutput(child.stderr, options, overflow, function(output) {
+    stderr = output;
   });
 
   child.addListener('exit', exithandler);
@@ -326,6 +734,51 @@ exports.execFile = function(file /* args, options, callback */) {
 };
 
 
+function collectOutput(stream, options, overflow, done) {
+  var handle = stream._handle;
+  var output = '';
+  var collecting = true;
+
+  function ondata(chunk) {
+    output += chunk;
+    done(output);
+    if (output.length > options.maxBuffer) overflow();
+  }
+
+  function fallback() {
+    collecting = false;
+    stream.removeListener('newListener', onnewlistener);
+    stream.setEncoding(options.encoding);
+    stream.addListener('data', ondata);
+  }
+
+  function onnewlistener(type) {
+    if (type !== 'data' || !collecting) return;
+
+    fallback();
+    if (handle.collectStop) {
+      output = stream._decoder.write(handle.collectStop());
+      done(output);
+    }
+  }
+
+  if (!handle.collectStart) {
+    fallback();
+    return;
+  }
+
+  handle.oncollect = function(buffer, overflowed) {
+    collecting = false;
+    stream.removeListener('newListener', onnewlistener);
+    done(buffer.toString(options.encoding));
+    if (overflowed) overflow();
+  };
+
+  stream.addListener('newListener', onnewlistener);
+  handle.collectStart(options.maxBuffer);
+}
+
+
 var spawn = exports.spawn = function(file, args, options) {
   args = args ? args.slice(0) : [];
   args.unshift(file);
@@ -500,3 +953,248 @@ ChildProcess.prototype.kill = function(sig) {
     // TODO: raise error if r == -1?
   }
 };
+
+
+// Channels between isolates of the same process.
+var ChannelBinding;
+var BUFFER_KEY = '\u0000buffer';
+
+function channelBinding() {
+  // Lazy load
+  if (!ChannelBinding) {
+    ChannelBinding = process.binding('channel_wrap');
+  }
+  return ChannelBinding;
+}
+
+
+function Channel() {
+  EventEmitter.call(this);
+
+  var self = this;
+  this._handle = new (channelBinding().Channel)();
+  this.id = this._handle.id;
+
+  this._handle.onmessage = function(json, buffers) {
+    var message = JSON.parse(json, function(key, value) {
+      if (value && typeof value[BUFFER_KEY] === 'number') {
+        var slow = buffers[value[BUFFER_KEY]];
+        return new Buffer(slow, slow.length, 0);
+      }
+      return value;
+    });
+    self.emit('message', message);
+  };
+}
+inherits(Channel, EventEmitter);
+
+
+Channel.prototype.close = function() {
+  if (!this._handle) return;
+  this._handle.close();
+  this._handle = null;
+  this.emit('close');
+};
+
+
+Channel.prototype.unref = function() {
+  if (this._handle && !this._unref) {
+    this._unref = true;
+    this._handle.unref();
+  }
+};
+
+
+Channel.prototype.ref = function() {
+  if (this._handle && this._unref) {
+    this._unref = false;
+    this._handle.ref();
+  }
+};
+
+
+exports.createChannel = function() {
+  return new Channel();
+};
+
+
+function ChannelPort(id) {
+  this.id = id;
+  this._handle = new (channelBinding().ChannelPort)(id);
+}
+
+
+ChannelPort.prototype.send = function(message) {
+  if (!this._handle) throw new Error('channel closed');
+
+  var buffers = [], parents = [], offsets = [], lengths = [];
+  var json = JSON.stringify(message, function(key, value) {
+    var b = this[key];
+    if (Buffer.isBuffer(b) || b instanceof SlowBuffer) {
+      buffers.push(b);
+      parents.push(b.parent || b);
+      offsets.push(b.offset || 0);
+      lengths.push(b.length);
+      var placeholder = {};
+      placeholder[BUFFER_KEY] = buffers.length - 1;
+      return placeholder;
+    }
+    return value;
+  });
+  if (json === undefined) json = 'null';
+
+  var r = this._handle.post(json, parents, offsets, lengths);
+
+  // Buffers whose storage was handed over are left empty.
+  for (var i = 0; i < buffers.length; i++) {
+    if (parents[i].length === 0) buffers[i].length = 0;
+  }
+
+  if (r) throw errnoException(errno, 'send');
+};
+
+
+ChannelPort.prototype.close = function() {
+  if (!this._handle) return;
+  this._handle.close();
+  this._handle = null;
+};
+
+
+exports.connectChannel = function(id) {
+  return new ChannelPort(id);
+};
+
+
+// Workers run a module in an isolate of their own, on a thread of this
+// process, and exchange messages with their parent over channels. The
+// parent's channel id is passed in NODE_WORKER_CHANNEL; the worker answers
+// with the id of its own channel, and messages sent meanwhile are queued.
+function Worker(modulePath, args, options) {
+  EventEmitter.call(this);
+
+  var self = this;
+  options = options || {};
+
+  var env = {};
+  var source = options.env || process.env;
+  for (var key in source) env[key] = source[key];
+
+  this._inbox = new Channel();
+  this._port = null;
+  this._queue = [];
+  env.NODE_WORKER_CHANNEL = this._inbox.id;
+
+  this._inbox.on('message', function(envelope) {
+    switch (envelope.type) {
+      case 'ready':
+        try {
+          self._port = new ChannelPort(envelope.channel);
+        } catch (e) {
+          // The worker is already on its way out.
+          self._queue = [];
+          break;
+        }
+        var queue = self._queue;
+        self._queue = null;
+        for (var i = 0; i < queue.length; i++) self._port.send(queue[i]);
+        break;
+
+      case 'message':
+        self.emit('message', envelope.data);
+        break;
+
+      case 'error':
+        var err = new Error(envelope.error.message);
+        err.name = envelope.error.name;
+        err.stack = envelope.error.stack;
+        self.emit('error', err);
+        break;
+    }
+  });
+
+  // stdout and stderr are this process's; stdin is a pipe of its own, as
+  // two isolates reading one terminal would steal each other's input.
+  this._child = spawn(process.execPath,
+                      [modulePath].concat(args || []),
+                      { cwd: options.cwd,
+                        env: env,
+                        customFds: [-1, 1, 2],
+                        fork: true });
+
+  this._child.on('exit', function(code, signal) {
+    // The thread is gone, so whatever it sent has arrived.
+    self._inbox._handle.flush();
+    self._inbox.close();
+    self._inbox = null;
+    if (self._port) self._port.close();
+    self._port = null;
+    self._queue = null;
+    self.emit('exit', code, signal);
+  });
+}
+inherits(Worker, EventEmitter);
+
+
+Worker.prototype.send = function(message) {
+  if (!this._inbox) throw new Error('worker has exited');
+
+  var envelope = { type: 'message', data: message };
+  if (this._port) {
+    this._port.send(envelope);
+  } else {
+    this._queue.push(envelope);
+  }
+};
+
+
+Worker.prototype.kill = function(sig) {
+  if (this._inbox) this._child.kill(sig);
+};
+
+
+exports.createWorker = function(modulePath, args, options) {
+  if (!process.features.isolates) {
+    throw new Error('Workers need a build with isolates');
+  }
+  return new Worker(modulePath, args, options);
+};
+
+
+exports._workerChild = function(id) {
+  var inbox = new Channel();
+  var port = new ChannelPort(id);
+
+  // The worker runs for as long as it listens for messages, like a forked
+  // child with its IPC channel.
+  inbox.unref();
+  process.on('newListener', function(event) {
+    if (event === 'message') inbox.ref();
+  });
+
+  inbox.on('message', function(envelope) {
+    if (envelope.type === 'message') process.emit('message', envelope.data);
+  });
+
+  process.send = function(message) {
+    port.send({ type: 'message', data: message });
+  };
+
+  // Uncaught exceptions are the parent's 'error' events, unless the worker
+  // handles them itself.
+  process.on('uncaughtException', function(err) {
+    if (process.listeners('uncaughtException').length > 1) return;
+
+    var error = err instanceof Error ?
+        { name: err.name, message: err.message, stack: err.stack } :
+        { name: 'Error', message: String(err), stack: String(err) };
+    try {
+      port.send({ type: 'error', error: error });
+    } catch (e) {
+      console.error(err && err.stack || err);
+    }
+    process.exit(1);
+  });
+
+  port.send({ type: 'ready', channel: inbox.id });
+};
@@ -23,6 +23,8 @@ var assert = require('assert');
 var fork = require('child_process').fork;
 var net = require('net');
 var EventEmitter = require('events').EventEmitter;
+var path = require('path');
+var util = require('util');
 
 var cluster = module.exports = new EventEmitter();
 
@@ -47,14 +49,228 @@ var servers = {};
 var workerFilename;
 var workerArgs;
 
+var distributors = {};
+
 // Used in the worker:
 var workerId = 0;
 var queryIds = 0;
 var queryCallbacks = {};
+var distributedHandles = {};
+var workerServers = [];
 
 cluster.isWorker = 'NODE_WORKER_ID' in process.env;
 cluster.isMaster = ! cluster.isWorker;
 
+// How connections to shared servers reach the workers:
+//
+// 'none'  - every worker accepts on the shared listening handle and the
+//           kernel picks who wins (the default).
+// 'rr'    - the master accepts and hands connections out in turn.
+// 'least' - the master accepts and hands each connection to the worker
+//           with the fewest connections still open (worker.queueDepth).
+//
+// Passing accepted connections needs Unix domain sockets; Windows always
+// uses 'none'.
+cluster.schedulingPolicy = process.env.NODE_CLUSTER_SCHED_POLICY || 'none';
+
+// Bytes of shared memory for each direction of worker.ring. 0, the default,
+// forks workers without a ring. Not available on Windows.
+cluster.ringSize = parseInt(process.env.NODE_CLUSTER_RING_SIZE, 10) || 0;
+
+
+// A pair of shared memory rings between the master and one worker, for
+// small frequent messages that should not pay for a pipe write and a JSON
+// parse each. The ring files live on /dev/shm when there is one and are
+// unlinked once both sides have mapped them.
+//
+// send() returns false, and drops the message, when the other side has
+// not caught up and the ring is full. The buffers 'message' is emitted
+// with are slices of the shared mapping that are reused once the listener
+// returns; copy what you want to keep.
+function Ring(base, size, isMaster) {
+  EventEmitter.call(this);
+
+  var ShmRing = process.binding('shm_ring_wrap').ShmRing;
+  var self = this;
+  var down = base + '.down';
+  var up = base + '.up';
+
+  this._base = base;
+  this._tx = new ShmRing();
+  this._rx = new ShmRing();
+
+  // The master creates both rings before the worker is forked.
+  this._tx.open(isMaster ? down : up, size, isMaster);
+  this._rx.open(isMaster ? up : down, size, isMaster);
+
+  // The read side's mapping, for whoever wants to look at it directly.
+  this.buffer = this._rx.buffer;
+
+  this._rx.onmessages = function(offsets, lengths) {
+    if (!offsets) {
+      self.emit('error', errnoException(errno, 'read'));
+      return;
+    }
+    var view = self._rx.buffer;
+    for (var i = 0; i < offsets.length; i++) {
+      self.emit('message', view.slice(offsets[i], offsets[i] + lengths[i]));
+    }
+  };
+
+  if (this._rx.readStart()) {
+    throw errnoException(errno, 'readStart');
+  }
+  // The IPC channel is what keeps a worker alive, not its ring.
+  this._rx.unref();
+}
+util.inherits(Ring, EventEmitter);
+
+
+Ring.prototype.send = function(data, encoding) {
+  if (!this._tx) throw new Error('Ring is closed');
+  if (!Buffer.isBuffer(data)) data = new Buffer(String(data), encoding);
+
+  if (this._tx.write(data.parent || data, data.offset || 0, data.length)) {
+    if (errno === 'EAGAIN') return false;
+    throw errnoException(errno, 'write');
+  }
+  return true;
+};
+
+
+Ring.prototype._unlink = function() {
+  if (!this._tx) return;
+  this._tx.unlink(this._base + '.down');
+  this._tx.unlink(this._base + '.up');
+};
+
+
+Ring.prototype.close = function() {
+  if (!this._tx) return;
+  this._tx.close();
+  this._rx.close();
+  this._tx = this._rx = null;
+  this.emit('close');
+};
+
+
+// A key/value cache in shared memory that the master and every worker see,
+// src/node_shm_cache.cc. The master creates it, before forking, in a file
+// named after its pid and the cache's name, and removes the file when it
+// exits. get() returns a copy of the value.
+function SharedCache(file, size, create) {
+  var ShmCache = process.binding('shm_cache').ShmCache;
+  this._handle = new ShmCache();
+  // A file left behind by an earlier process with the same pid.
+  if (create) this._handle.unlink(file);
+  this._handle.open(file, size, create);
+}
+
+
+SharedCache.prototype.get = function(key, encoding) {
+  if (!this._handle) throw new Error('Cache is closed');
+  var value = this._handle.get(String(key));
+  if (!value) return value;
+  // The binding hands out a SlowBuffer.
+  value = new Buffer(value, value.length, 0);
+  return encoding ? value.toString(encoding) : value;
+};
+
+
+SharedCache.prototype.set = function(key, value, ttl) {
+  if (!this._handle) throw new Error('Cache is closed');
+  if (!Buffer.isBuffer(value)) value = new Buffer(String(value));
+  return this._handle.set(String(key), value.parent || value,
+                          value.offset || 0, value.length, ttl || 0);
+};
+
+
+SharedCache.prototype.del = function(key) {
+  if (!this._handle) throw new Error('Cache is closed');
+  return this._handle.del(String(key));
+};
+
+
+SharedCache.prototype.clear = function() {
+  if (!this._handle) throw new Error('Cache is closed');
+  this._handle.clear();
+};
+
+
+SharedCache.prototype.stats = function() {
+  if (!this._handle) throw new Error('Cache is closed');
+  return this._handle.stats();
+};
+
+
+SharedCache.prototype.close = function() {
+  if (!this._handle) return;
+  this._handle.close();
+  this._handle = null;
+};
+
+
+var caches = {};
+var cacheFiles = [];
+
+
+function cacheBase(pid) {
+  return path.join(ringDir(), 'node-cache-' + pid);
+}
+
+
+// cluster.cache(name, [options]) returns the shared cache of that name. In
+// the master it is created, options.size bytes big (16 MB by default); in a
+// worker it must have been created before the worker was forked.
+cluster.cache = function(name, options) {
+  if (process.platform === 'win32') {
+    throw new Error('cluster.cache() is not available on Windows');
+  }
+  name = String(name);
+  if (!/^[\w.-]+$/.test(name)) {
+    throw new Error('Cache names may only have letters, digits, ' +
+                    '"_", "." and "-"');
+  }
+  if (caches[name]) return caches[name];
+
+  var cache;
+  if (cluster.isMaster) {
+    var file = cacheBase(process.pid) + '-' + name;
+    var size = (options && options.size) || 16 * 1024 * 1024;
+    cache = new SharedCache(file, size, true);
+    if (cacheFiles.length === 0) {
+      process.on('exit', function() {
+        var ShmCache = process.binding('shm_cache').ShmCache;
+        var handle = new ShmCache();
+        cacheFiles.forEach(function(file) { handle.unlink(file); });
+      });
+    }
+    cacheFiles.push(file);
+  } else {
+    if (!process.env.NODE_CLUSTER_CACHE) {
+      throw new Error('This worker was not forked by cluster');
+    }
+    cache = new SharedCache(process.env.NODE_CLUSTER_CACHE + '-' + name, 0,
+                            false);
+  }
+
+  return caches[name] = cache;
+};
+
+
+function ringDir() {
+  if (path.existsSync('/dev/shm')) return '/dev/shm';
+  return process.env.TMPDIR || '/tmp';
+}
+
+
+function errnoException(errorno, syscall) {
+  var e = new Error(syscall + ' ' + errorno);
+  e.errno = e.code = errorno;
+  e.syscall = syscall;
+  return e;
+}
+
 // Call this from the master process. It will start child workers.
 //
 // options.workerFilename
@@ -102,6 +318,8 @@ function handleWorkerMessage(worker, message) {
     case 'online':
       debug("Worker " + worker.pid + " online");
       worker.online = true;
+      // The worker has mapped its ring by now.
+      if (worker.ring) worker.ring._unlink();
       break;
 
     case 'queryServer':
@@ -110,6 +328,26 @@ function handleWorkerMessage(worker, message) {
                 message.addressType;
       var response = { _queryId: message._queryId };
 
+      if (distributing()) {
+        if (!(key in distributors)) {
+          distributors[key] = createDistributor(key, message);
+        }
+
+        var distributor = distributors[key];
+        if (distributor) {
+          distributor.add(worker);
+          response.distributed = true;
+          response.key = key;
+          response.sockname = distributor.handle.getsockname ?
+                              distributor.handle.getsockname() : null;
+          worker.send(response);
+          break;
+        }
+
+        // Could not listen in the master; fall back to a shared handle.
+        delete distributors[key];
+      }
+
       if (key in servers == false) {
         // Create a new server.
         debug('create new server ' + key);
@@ -120,6 +358,26 @@ function handleWorkerMessage(worker, message) {
       worker.send(response, servers[key]);
       break;
 
+    case 'listening':
+      var address = {
+        address: message.address,
+        port: message.port,
+        addressType: message.addressType
+      };
+      worker.listening = true;
+      worker.emit('listening', address);
+      cluster.emit('listening', worker, address);
+      break;
+
+    case 'connDone':
+      if (worker.queueDepth > 0) worker.queueDepth--;
+      break;
+
+    case 'serverClose':
+      var distributor = distributors[message.key];
+      if (distributor) distributor.remove(worker, true);
+      break;
+
     default:
       // Ignore.
       break;
@@ -127,6 +385,110 @@ function handleWorkerMessage(worker, message) {
 }
 
 
+function distributing() {
+  var policy = cluster.schedulingPolicy;
+  return process.platform !== 'win32' &&
+         (policy === 'rr' || policy === 'least');
+}
+
+
+// Accepts connections for one shared server in the master and passes them
+// on to the workers listening on it.
+function Distributor(key, handle) {
+  var self = this;
+
+  this.key = key;
+  this.handle = handle;
+  this.workers = [];
+  this.next = 0;
+
+  handle.onconnection = function(clientHandle) {
+    self.distribute(clientHandle);
+  };
+}
+
+
+Distributor.prototype.add = function(worker) {
+  if (this.workers.indexOf(worker) < 0) this.workers.push(worker);
+};
+
+
+// Workers that die are just dropped; the port stays open for the next
+// worker. Once the last worker closes its server the port is released.
+Distributor.prototype.remove = function(worker, closed) {
+  var i = this.workers.indexOf(worker);
+  if (i < 0) return;
+
+  this.workers.splice(i, 1);
+
+  if (closed && this.workers.length === 0) {
+    this.handle.close();
+    delete distributors[this.key];
+  }
+};
+
+
+Distributor.prototype.pick = function() {
+  var workers = this.workers;
+  if (workers.length === 0) return null;
+
+  if (cluster.schedulingPolicy === 'least') {
+    var best = workers[0];
+    for (var i = 1; i < workers.length; i++) {
+      if (workers[i].queueDepth < best.queueDepth) best = workers[i];
+    }
+    return best;
+  }
+
+  this.next = this.next % workers.length;
+  return workers[this.next++];
+};
+
+
+Distributor.prototype.distribute = function(clientHandle) {
+  if (!clientHandle) {
+    debug('accept error on ' + this.key + ': ' + errno);
+    return;
+  }
+
+  var worker = this.pick();
+  if (!worker) {
+    clientHandle.close();
+    return;
+  }
+
+  // The worker has its own copy of the socket once the write is done.
+  var sent = false;
+  try {
+    sent = worker._send({ cmd: 'newconn', key: this.key }, clientHandle,
+                        function() { clientHandle.close(); });
+  } catch (e) {
+    debug('newconn to worker ' + worker.pid + ' failed: ' + e.message);
+  }
+
+  if (sent) {
+    worker.queueDepth++;
+  } else {
+    clientHandle.close();
+  }
+};
+
+
+function createDistributor(key, message) {
+  var handle = net._createServerHandle(message.address,
+                                       message.port,
+                                       message.addressType);
+  if (!handle) return null;
+
+  if (handle.listen(message.backlog || 511)) {
+    handle.close();
+    return null;
+  }
+
+  return new Distributor(key, handle);
+}
+
+
 function eachWorker(cb) {
   // This can only be called from the master.
   assert(cluster.isMaster);
@@ -143,6 +505,12 @@ cluster.fork = function() {
   // This can only be called from the master.
   assert(cluster.isMaster);
 
+  var policy = cluster.schedulingPolicy;
+  if (policy !== 'none' && policy !== 'rr' && policy !== 'least') {
+    throw new Error('cluster.schedulingPolicy must be "none", "rr" or ' +
+                    '"least"');
+  }
+
   // Lazily start the master process stuff.
   startMaster();
 
@@ -155,10 +523,29 @@ cluster.fork = function() {
 
   envCopy['NODE_WORKER_ID'] = id;
 
-  var worker = fork(workerFilename, workerArgs, { env: envCopy });
+  if (process.platform !== 'win32') {
+    envCopy['NODE_CLUSTER_CACHE'] = cacheBase(process.pid);
+  }
+
+  var ring = null;
+  if (cluster.ringSize > 0 && process.platform !== 'win32') {
+    var base = path.join(ringDir(),
+                         'node-cluster-' + process.pid + '-' + id);
+    ring = new Ring(base, cluster.ringSize, true);
+    envCopy['NODE_CLUSTER_RING'] = base;
+  }
+
+  // Workers run this same node, so they always understand binary framing.
+  var worker = fork(workerFilename, workerArgs, { env: envCopy,
+                                                  ipcFraming: 'binary' });
 
   workers[id] = worker;
 
+  if (ring) worker.ring = ring;
+
+  // Connections the master passed to this worker that are still open.
+  worker.queueDepth = 0;
+
   worker.on('message', function(message) {
     handleWorkerMessage(worker, message);
   });
@@ -166,6 +553,13 @@ cluster.fork = function() {
   worker.on('exit', function() {
     debug('worker id=' + id + ' died');
     delete workers[id];
+    if (worker.ring) {
+      worker.ring._unlink();
+      worker.ring.close();
+    }
+    for (var key in distributors) {
+      distributors[key].remove(worker);
+    }
     cluster.emit('death', worker);
   });
 
@@ -173,16 +567,131 @@ cluster.fork = function() {
 };
 
 
+// Asks `worker` to stop accepting connections and to exit once the ones it
+// has are done. After `timeout` ms (default 30000) it is killed.
+function drainWorker(worker, timeout, cb) {
+  var timer = null;
+
+  worker.suicide = true;
+  worker.once('exit', function() {
+    if (timer) clearTimeout(timer);
+    if (cb) cb();
+  });
+
+  try {
+    worker.send({ cmd: 'disconnect' });
+  } catch (e) {
+    // The channel is gone already; the worker is on its way out.
+    worker.kill();
+    return;
+  }
+
+  timer = setTimeout(function() {
+    debug('worker ' + worker.pid + ' did not drain in time');
+    worker.kill();
+  }, timeout === undefined ? 30000 : timeout);
+}
+
+
+// Replaces the running workers one at a time. Each replacement is forked
+// and must be listening (and warmed up, when options.warmup is given)
+// before the worker it replaces stops accepting connections, so the number
+// of workers serving never drops.
+//
+// options.timeout
+// How long, in ms, a worker gets to finish its connections once it was
+// asked to stop. Also how long a replacement gets to start listening.
+// Default 30000.
+//
+// options.warmup
+// function(worker, callback), called once a replacement is listening. The
+// old worker is drained when callback is called.
+cluster.reload = function(options, cb) {
+  // This can only be called from the master.
+  assert(cluster.isMaster);
+
+  if (typeof options === 'function') {
+    cb = options;
+    options = {};
+  }
+  options = options || {};
+
+  var timeout = options.timeout === undefined ? 30000 : options.timeout;
+  var old = [];
+  var draining = 0;
+  var failed = null;
+
+  eachWorker(function(worker) {
+    if (!worker.suicide) old.push(worker);
+  });
+
+  function done() {
+    if (old.length === 0 && draining === 0 && cb) {
+      cb(failed);
+      cb = null;
+    }
+  }
+
+  function next() {
+    var worker = old.shift();
+    if (!worker) return done();
+
+    var replacement = cluster.fork();
+    var timer = setTimeout(function() {
+      replacement.removeListener('listening', onlistening);
+      failed = new Error('worker ' + replacement.pid +
+                         ' did not start listening');
+      old = [];
+      drainWorker(replacement, 0, done);
+    }, timeout);
+
+    function onlistening() {
+      clearTimeout(timer);
+      if (options.warmup) {
+        options.warmup(replacement, replace);
+      } else {
+        replace();
+      }
+    }
+
+    function replace() {
+      draining++;
+      drainWorker(worker, timeout, function() {
+        draining--;
+        done();
+      });
+      next();
+    }
+
+    replacement.once('listening', onlistening);
+  }
+
+  next();
+};
+
+
 // Internal function. Called from src/node.js when worker process starts.
 cluster._startWorker = function() {
   assert(cluster.isWorker);
   workerId = parseInt(process.env.NODE_WORKER_ID);
 
+  if (process.env.NODE_CLUSTER_RING) {
+    cluster.ring = new Ring(process.env.NODE_CLUSTER_RING, 0, false);
+  }
+
   queryMaster({ cmd: 'online' });
 
   // Make callbacks from queryMaster()
   process.on('message', function(msg, handle) {
     debug("recv " + JSON.stringify(msg));
+    if (msg.cmd === 'newconn') {
+      onNewConnection(msg.key, handle);
+      return;
+    }
+    if (msg.cmd === 'disconnect') {
+      disconnectWorker();
+      return;
+    }
     if (msg._queryId && msg._queryId in queryCallbacks) {
       var cb = queryCallbacks[msg._queryId];
       if (typeof cb == 'function') {
@@ -215,15 +724,104 @@ function queryMaster(msg, cb) {
 
 // Internal function. Called by lib/net.js when attempting to bind a
 // server.
-cluster._getServer = function(address, port, addressType, cb) {
+cluster._getServer = function(server, address, port, addressType, cb) {
   assert(cluster.isWorker);
 
+  workerServers.push(server);
+
   queryMaster({
     cmd: "queryServer",
     address: address,
     port: port,
-    addressType: addressType
+    addressType: addressType,
+    backlog: server.backlog
   }, function(msg, handle) {
-    cb(handle);
+    // 'listening' is emitted on the next tick, after cb() set things up.
+    server.once('listening', function() {
+      process.send({
+        cmd: 'listening',
+        address: address,
+        port: port,
+        addressType: addressType
+      });
+    });
+
+    cb(msg.distributed ? new DistributedHandle(msg.key, msg.sockname) :
+                         handle);
+  });
+};
+
+
+// Stops accepting on every server of this worker and exits once their open
+// connections are done. The master kills us if that takes too long.
+function disconnectWorker() {
+  var servers = workerServers.filter(function(server) {
+    return server._handle;
+  });
+  var open = servers.length;
+
+  workerServers = [];
+
+  if (open === 0) process.exit(0);
+
+  servers.forEach(function(server) {
+    server.once('close', function() {
+      if (--open === 0) process.exit(0);
+    });
+    server.close();
   });
+}
+
+
+// Stands in for the listening handle of a server whose connections the
+// master accepts. net.Server only needs listen(), getsockname(), close()
+// and an onconnection callback from it.
+function DistributedHandle(key, sockname) {
+  this.key = key;
+  this.sockname = sockname;
+  this.onconnection = null;
+  distributedHandles[key] = this;
+}
+
+
+DistributedHandle.prototype.listen = function() {
+  return 0;
+};
+
+
+DistributedHandle.prototype.getsockname = function() {
+  return this.sockname;
+};
+
+
+// The master's handle is what keeps the port open.
+DistributedHandle.prototype.ref = function() {};
+DistributedHandle.prototype.unref = function() {};
+
+
+DistributedHandle.prototype.close = function() {
+  delete distributedHandles[this.key];
+  process.send({ cmd: 'serverClose', key: this.key });
 };
+
+
+function onNewConnection(key, clientHandle) {
+  var server = distributedHandles[key];
+
+  if (!clientHandle) return;
+
+  // Tell the master when the connection is done with, whoever closes it.
+  var close = clientHandle.close;
+  clientHandle.close = function() {
+    clientHandle.close = close;
+    process.send({ cmd: 'connDone', key: key });
+    return close.apply(this, arguments);
+  };
+
+  if (!server || !server.onconnection) {
+    clientHandle.close();
+    return;
+  }
+
+  server.onconnection(clientHandle);
+}
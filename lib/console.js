@@ -71,3 +71,100 @@ exports.assert = function(expression) {
     require('assert').ok(false, util.format.apply(this, arr));
   }
 };
+
+
+var logLevels = ['debug', 'info', 'warn', 'error'];
+
+// A logger writes JSON lines with a timestamp, the level, a message and
+// fields to a file descriptor. Records are formatted in C++ into a buffer
+// that is written on the thread pool at the end of the tick, see
+// src/node_log.cc.
+function Logger(options) {
+  options = options || {};
+
+  var level = logLevels.indexOf(options.level || 'info');
+  if (level === -1) {
+    throw new Error('Unknown log level: ' + options.level);
+  }
+
+  var fd;
+  if (typeof options.path === 'string') {
+    fd = require('fs').openSync(options.path, 'a');
+    this._ownFd = true;
+  } else if (typeof options.fd === 'number') {
+    fd = options.fd;
+    this._ownFd = false;
+  } else {
+    fd = process._stdio_fds[1];
+    this._ownFd = false;
+  }
+
+  var Handle = process.binding('log').Logger;
+  this.fd = fd;
+  this.level = logLevels[level];
+  this._level = level;
+  this._handle = new Handle(fd, Date.now(), options.bufferSize, level);
+  this._scheduled = false;
+
+  var self = this;
+  this._flushTick = function() {
+    self._scheduled = false;
+    if (self._handle) self._handle.flush();
+  };
+  this._flushSync = function() {
+    if (self._handle) self._handle.flushSync();
+  };
+  process._exitFlushers.push(this._flushSync);
+}
+
+
+Logger.prototype.log = function(level, msg, fields) {
+  if (!this._handle) throw new Error('Logger is closed');
+
+  var index = typeof level === 'number' ? level : logLevels.indexOf(level);
+  if (index === -1) throw new Error('Unknown log level: ' + level);
+  if (index < this._level) return false;
+
+  this._handle.log(index, msg, fields);
+  if (!this._scheduled) {
+    this._scheduled = true;
+    process.nextTick(this._flushTick);
+  }
+  return true;
+};
+
+
+logLevels.forEach(function(name, index) {
+  Logger.prototype[name] = function(msg, fields) {
+    return this.log(index, msg, fields);
+  };
+});
+
+
+Logger.prototype.flushSync = function() {
+  if (this._handle) this._handle.flushSync();
+};
+
+
+Logger.prototype.stats = function() {
+  return this._handle ? this._handle.stats() : null;
+};
+
+
+Logger.prototype.close = function() {
+  if (!this._handle) return;
+
+  this._handle.close();
+  this._handle = null;
+
+  var flushers = process._exitFlushers;
+  var i = flushers.indexOf(this._flushSync);
+  if (i !== -1) flushers.splice(i, 1);
+
+  if (this._ownFd) require('fs').closeSync(this.fd);
+};
+
+
+exports.createLogger = function(options) {
+  return new Logger(options);
+};
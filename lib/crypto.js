@@ -31,6 +31,8 @@ try {
   var Verify = binding.Verify;
   var DiffieHellman = binding.DiffieHellman;
   var PBKDF2 = binding.PBKDF2;
+  var digestBatch = binding.digestBatch;
+  var hashFile = binding.hashFile;
   var randomBytes = binding.randomBytes;
   var pseudoRandomBytes = binding.pseudoRandomBytes;
   var crypto = true;
@@ -39,6 +41,45 @@ try {
   var crypto = false;
 }
 
+var SlowBuffer = require('buffer').SlowBuffer;
+
+
+// Native methods return their 'buffer' encoded output as a SlowBuffer that
+// owns the result; expose it as an ordinary Buffer over the same memory.
+function fastBuffer(result) {
+  if (result instanceof SlowBuffer) {
+    return new Buffer(result, result.length, 0);
+  }
+  return result;
+}
+
+
+function addBufferOutput(klass, names) {
+  names.forEach(function(name) {
+    var method = klass.prototype[name];
+    klass.prototype[name] = function() {
+      var last = arguments.length - 1;
+      var callback = arguments[last];
+      if (typeof callback === 'function') {
+        // The asynchronous form, method(..., callback(err, result)).
+        arguments[last] = function(err, result) {
+          callback(err, fastBuffer(result));
+        };
+      }
+      return fastBuffer(method.apply(this, arguments));
+    };
+  });
+}
+
+
+if (crypto) {
+  addBufferOutput(Hash, ['digest']);
+  addBufferOutput(Hmac, ['digest']);
+  addBufferOutput(Cipher, ['update', 'final']);
+  addBufferOutput(Decipher, ['update', 'final', 'finaltol']);
+  addBufferOutput(Sign, ['sign']);
+}
+
 
 function Credentials(secureProtocol, flags, context) {
   if (!(this instanceof Credentials)) {
@@ -67,6 +108,27 @@ function Credentials(secureProtocol, flags, context) {
 exports.Credentials = Credentials;
 
 
+// Identifies the configuration of a context, so identical ones can share a
+// single OpenSSL context across the process.
+function sharedContextKey(options) {
+  var hash = new Hash('sha1');
+
+  ['secureProtocol', 'secureOptions', 'key', 'passphrase', 'cert', 'ca',
+   'crl', 'ciphers', 'sessionIdContext', 'verifyCacheTTL',
+   'verifyCacheSize'].forEach(function(name) {
+    var values = options[name] === undefined ? [] : [].concat(options[name]);
+    hash.update(name + ':' + values.length + ':');
+    values.forEach(function(value) {
+      if (!Buffer.isBuffer(value)) value = new Buffer(String(value));
+      hash.update(value.length + ':');
+      hash.update(value);
+    });
+  });
+
+  return hash.digest('hex');
+}
+
+
 exports.createCredentials = function(options, context) {
   if (!options) options = {};
 
@@ -76,6 +138,13 @@ exports.createCredentials = function(options, context) {
 
   if (context) return c;
 
+  // Ticket keys live with the SecureContext that set them, not the SSL_CTX.
+  var sharedKey = null;
+  if (options.shared && !options.ticketKeys) {
+    sharedKey = sharedContextKey(options);
+    if (c.context.useShared(sharedKey)) return c;
+  }
+
   if (options.key) {
     if (options.passphrase) {
       c.context.setKey(options.key, options.passphrase);
@@ -114,6 +183,16 @@ exports.createCredentials = function(options, context) {
     c.context.setSessionIdContext(options.sessionIdContext);
   }
 
+  if (options.ticketKeys) {
+    c.context.setTicketKeys(options.ticketKeys);
+  }
+
+  if (options.verifyCacheTTL) {
+    c.context.setVerifyCache(options.verifyCacheTTL, options.verifyCacheSize);
+  }
+
+  if (sharedKey) c.context.share(sharedKey);
+
   return c;
 };
 
@@ -130,6 +209,51 @@ exports.createHmac = function(hmac, key) {
 };
 
 
+// cipher.update(data, callback) encrypts or decrypts data on the thread pool
+// and calls back with a buffer. Asynchronous updates of one object are run
+// one at a time, in the order they were made.
+function runAsyncUpdate(self) {
+  var job = self._updateQueue[0];
+
+  function done(err, result) {
+    self._updateQueue.shift();
+    job[1](err, fastBuffer(result));
+    if (self._updateQueue.length > 0) runAsyncUpdate(self);
+  }
+
+  try {
+    self._updateAsync(job[0], done);
+  } catch (err) {
+    process.nextTick(function() {
+      done(err);
+    });
+  }
+}
+
+
+function addAsyncUpdate(klass) {
+  var update = klass.prototype.update;
+
+  klass.prototype.update = function(data, callback) {
+    if (typeof callback !== 'function') {
+      return update.apply(this, arguments);
+    }
+
+    if (!Buffer.isBuffer(data)) data = new Buffer(String(data), 'binary');
+
+    var queue = this._updateQueue || (this._updateQueue = []);
+    queue.push([data, callback]);
+    if (queue.length === 1) runAsyncUpdate(this);
+  };
+}
+
+
+if (crypto) {
+  addAsyncUpdate(Cipher);
+  addAsyncUpdate(Decipher);
+}
+
+
 exports.Cipher = Cipher;
 exports.createCipher = function(cipher, password) {
   return (new Cipher).init(cipher, password);
@@ -164,6 +288,12 @@ exports.createVerify = function(algorithm) {
 
 exports.DiffieHellman = DiffieHellman;
 exports.createDiffieHellman = function(size_or_key, enc) {
+  if (typeof enc === 'function') {
+    // Generate the prime on the thread pool
+    binding.generateDiffieHellman(size_or_key, enc);
+    return;
+  }
+
   if (!size_or_key) {
     return new DiffieHellman();
   } else if (!enc) {
@@ -174,10 +304,111 @@ exports.createDiffieHellman = function(size_or_key, enc) {
 
 };
 
+exports.getDiffieHellman = function(group_name) {
+  return binding.diffieHellmanGroup(group_name);
+};
+
 exports.pbkdf2 = PBKDF2;
 
-exports.randomBytes = randomBytes;
-exports.pseudoRandomBytes = pseudoRandomBytes;
 
-exports.rng = randomBytes;
-exports.prng = pseudoRandomBytes;
+// Strings are taken as binary, like hash.update() does.
+function toBatchBuffer(data) {
+  return Buffer.isBuffer(data) ? data : new Buffer(String(data), 'binary');
+}
+
+
+function runDigestBatch(algorithm, key, inputs, callback) {
+  if (!Array.isArray(inputs)) {
+    throw new TypeError('inputs must be an array');
+  }
+
+  // A private copy, so the caller can't drop the buffers under a pending job
+  inputs = inputs.map(toBatchBuffer);
+
+  if (typeof callback !== 'function') {
+    var digests = digestBatch(algorithm, key, inputs);
+    return new Buffer(digests, digests.length, 0);
+  }
+
+  digestBatch(algorithm, key, inputs, function(err, digests) {
+    if (err) return callback(err);
+    callback(null, new Buffer(digests, digests.length, 0));
+  });
+}
+
+
+exports.hashBatch = function(algorithm, inputs, callback) {
+  return runDigestBatch(algorithm, null, inputs, callback);
+};
+
+
+exports.hmacBatch = function(algorithm, key, inputs, callback) {
+  return runDigestBatch(algorithm, toBatchBuffer(key), inputs, callback);
+};
+
+// The file is read and digested on the thread pool; none of it enters
+// JavaScript.
+exports.hashFile = function(path, algorithm, encoding, callback) {
+  if (typeof encoding === 'function') {
+    callback = encoding;
+    encoding = null;
+  }
+
+  hashFile(String(path), algorithm, function(err, digest) {
+    if (err) return callback(err);
+    callback(null, encoding ? digest.toString(encoding) : fastBuffer(digest));
+  });
+};
+
+
+// Small synchronous requests are cut from a block of strong random bytes,
+// the way small Buffers are cut from the buffer pool. A new block is made on
+// the thread pool once half of the current one is used. No byte is handed
+// out twice.
+var randomPoolSize = 32 * 1024;
+var randomPoolMaxRequest = 256;
+var randomPool = null;
+var randomPoolUsed = 0;
+var randomPoolRefilling = false;
+
+
+function refillRandomPool() {
+  randomPoolRefilling = true;
+  randomBytes(randomPoolSize, function(err, block) {
+    randomPoolRefilling = false;
+    // On error the next requests take the synchronous path, which throws
+    if (err) return;
+    randomPool = block;
+    randomPoolUsed = 0;
+  });
+}
+
+
+function pooledRandomBytes(generator) {
+  return function(size, callback) {
+    if (typeof callback !== 'function' &&
+        size === (size >>> 0) &&
+        size <= randomPoolMaxRequest) {
+      var left = randomPool ? randomPool.length - randomPoolUsed : 0;
+      if (left < randomPoolSize / 2 && !randomPoolRefilling) {
+        refillRandomPool();
+      }
+      if (randomPool && size <= left) {
+        var buf = new Buffer(randomPool, size, randomPoolUsed);
+        randomPoolUsed += size;
+        return buf;
+      }
+    }
+    return generator(size, callback);
+  };
+}
+
+
+if (crypto) {
+  // Strong bytes from the pool do for pseudoRandomBytes() too
+  exports.randomBytes = pooledRandomBytes(randomBytes);
+  exports.pseudoRandomBytes = pooledRandomBytes(pseudoRandomBytes);
+}
+
+exports.rng = exports.randomBytes;
+exports.prng = exports.pseudoRandomBytes;
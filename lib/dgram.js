@@ -22,7 +22,8 @@
 var util = require('util');
 var events = require('events');
 
-var UDP = process.binding('udp_wrap').UDP;
+var binding = process.binding('udp_wrap');
+var UDP = binding.UDP;
 
 // lazily loaded
 var dns = null;
@@ -77,6 +78,7 @@ function newHandle(type) {
     handle.lookup = lookup6;
     handle.bind = handle.bind6;
     handle.send = handle.send6;
+    handle.sendBatch = handle.sendBatch6;
     return handle;
   }
 
@@ -90,13 +92,22 @@ function newHandle(type) {
 function Socket(type, listener) {
   events.EventEmitter.call(this);
 
+  var options = {};
+  if (typeof type === 'object' && type !== null) {
+    options = type;
+    type = options.type;
+  }
+
   var handle = newHandle(type);
   handle.socket = this;
 
   this._handle = handle;
   this._receiving = false;
+  this._recvBatch = 0;
+  this._recvBatchSlot = 0;
   this._bound = false;
   this.type = type;
+  this.reusePort = !!options.reusePort;
   this.fd = null; // compatibility hack
 
   if (typeof listener === 'function')
@@ -116,10 +127,31 @@ Socket.prototype.bind = function(port, address) {
 
   self._healthCheck();
 
+  // A socket that is bound already, received from another process with
+  // child.send() or process.send().
+  if (port instanceof UDP) {
+    var handle = port;
+    handle.lookup = self._handle.lookup;
+    handle.bind = self._handle.bind;
+    handle.send = self._handle.send;
+    handle.sendBatch = self._handle.sendBatch;
+    handle.socket = self;
+
+    self._handle.close();
+    self._handle = handle;
+    self._bound = true;
+    self._startReceiving();
+    process.nextTick(function() {
+      self.emit('listening');
+    });
+    return;
+  }
+
   // resolve address first
   self._handle.lookup(address, function(err, ip) {
     if (!err) {
-      if (self._handle.bind(ip, port || 0, /*flags=*/0)) {
+      var flags = self.reusePort ? binding.UV_UDP_REUSEPORT : 0;
+      if (self._handle.bind(ip, port || 0, flags)) {
         err = errnoException(errno, 'bind');
       }
       else {
@@ -190,6 +222,95 @@ Socket.prototype.send = function(buffer,
 };
 
 
+// Sends buffers[i], or the part of it given by offsets[i] and lengths[i], as
+// a datagram each with as few system calls as possible. callback(err, n)
+// runs once, when all n datagrams have gone out or one of them failed.
+Socket.prototype.sendBatch = function(buffers,
+                                      offsets,
+                                      lengths,
+                                      port,
+                                      address,
+                                      callback) {
+  var self = this;
+
+  if (!Array.isArray(buffers))
+    throw new TypeError('First argument must be an array of buffers');
+
+  if (!offsets || !lengths) {
+    offsets = new Array(buffers.length);
+    lengths = new Array(buffers.length);
+    for (var i = 0; i < buffers.length; i++) {
+      offsets[i] = 0;
+      lengths[i] = buffers[i].length;
+    }
+  }
+
+  if (offsets.length !== buffers.length || lengths.length !== buffers.length)
+    throw new Error('buffers, offsets and lengths must be the same length');
+
+  for (var i = 0; i < buffers.length; i++) {
+    if (!Buffer.isBuffer(buffers[i]))
+      throw new TypeError('buffers must only contain buffers');
+    if (offsets[i] + lengths[i] > buffers[i].length)
+      throw new Error('Offset + length beyond buffer length');
+  }
+
+  callback = callback || noop;
+
+  self._healthCheck();
+  self._startReceiving();
+
+  self._handle.lookup(address, function(err, ip) {
+    if (err) {
+      callback(err);
+      self.emit('error', err);
+      return;
+    }
+
+    var req = self._handle.sendBatch(buffers, offsets, lengths, port, ip);
+    if (req) {
+      req.oncomplete = afterSendBatch;
+      req.cb = callback;
+    } else if (errno === 'ENOSYS') {
+      sendEach(self, buffers, offsets, lengths, port, ip, callback);
+    } else {
+      callback(errnoException(errno, 'sendBatch'));
+    }
+  });
+};
+
+
+function afterSendBatch(status, handle, req, buffers) {
+  if (status)
+    req.cb(errnoException(errno, 'sendBatch'));
+  else
+    req.cb(null, buffers.length);
+}
+
+
+// For platforms without native batches.
+function sendEach(self, buffers, offsets, lengths, port, ip, callback) {
+  var pending = buffers.length;
+  var failed = null;
+
+  if (pending === 0) return callback(null, 0);
+
+  function onsent(status, handle, req) {
+    if (status && !failed) failed = errnoException(errno, 'sendBatch');
+    if (--pending === 0) callback(failed, failed ? undefined : buffers.length);
+  }
+
+  for (var i = 0; i < buffers.length; i++) {
+    var req = self._handle.send(buffers[i], offsets[i], lengths[i], port, ip);
+    if (req) {
+      req.oncomplete = onsent;
+    } else {
+      onsent(-1);
+    }
+  }
+}
+
+
 function afterSend(status, handle, req, buffer) {
   var self = handle.socket;
 
@@ -211,6 +332,31 @@ Socket.prototype.close = function() {
 };
 
 
+// Reads up to count datagrams of at most slotSize bytes per system call.
+Socket.prototype.setRecvBatch = function(count, slotSize) {
+  this._recvBatch = count > 1 ? count : 0;
+  this._recvBatchSlot = slotSize > 0 ? slotSize : 0;
+
+  if (this._receiving) {
+    this._handle.recvStop();
+    this._handle.recvStart(this._recvBatch, this._recvBatchSlot);
+  }
+};
+
+
+// Lets the process exit while this socket is the only thing left open.
+Socket.prototype.unref = function() {
+  this._healthCheck();
+  this._handle.unref();
+};
+
+
+Socket.prototype.ref = function() {
+  this._healthCheck();
+  this._handle.ref();
+};
+
+
 Socket.prototype.address = function() {
   this._healthCheck();
 
@@ -275,7 +421,8 @@ Socket.prototype._startReceiving = function() {
   }
 
   this._handle.onmessage = onMessage;
-  this._handle.recvStart();
+  this._handle.onmessagebatch = onMessageBatch;
+  this._handle.recvStart(this._recvBatch, this._recvBatchSlot);
   this._receiving = true;
   this.fd = -42; // compatibility hack
 };
@@ -289,6 +436,7 @@ Socket.prototype._stopReceiving = function() {
   // this, but node applications (e.g. test/simple/test-dgram-pingpong) may
   // not expect it.
   this._handle.onmessage = noop;
+  this._handle.onmessagebatch = noop;
 
   this._handle.recvStop();
   this._receiving = false;
@@ -296,6 +444,21 @@ Socket.prototype._stopReceiving = function() {
 };
 
 
+function onMessageBatch(handle, buf, offsets, lengths, addresses, ports) {
+  var self = handle.socket;
+
+  for (var i = 0; i < offsets.length; i++) {
+    var start = offsets[i];
+    var size = lengths[i];
+    self.emit('message',
+              buf.slice(start, start + size),
+              { address: addresses[i], port: ports[i], size: size });
+    // a listener may have closed the socket
+    if (!self._handle) return;
+  }
+}
+
+
 function onMessage(handle, nread, buf, rinfo) {
   var self = handle.socket;
 
@@ -92,6 +92,173 @@ function makeAsync(callback) {
 }
 
 
+// Resolver cache. Module state is per isolate, so every isolate gets its
+// own cache and nothing is shared across threads.
+//
+// Answers from c-ares carry TTLs and are kept for the smallest TTL in the
+// answer. getaddrinfo(3) does not report TTLs so dns.lookup() results are
+// kept for `lookupCacheTTL` seconds, which is 0 (no caching) by default.
+// Concurrent requests for the same key share a single in-flight query
+// regardless of the cache settings.
+var cache = {},
+    cacheSize = 0,
+    cacheMax = 1000,
+    lookupCacheTTL = 0,
+    lookupBackend = 'getaddrinfo',
+    inflight = {},
+    cacheStats = { hits: 0, misses: 0, collapsed: 0 };
+
+
+function cacheGet(key) {
+  var entry = cache[key];
+  if (!entry) return null;
+
+  if (entry.expires <= Date.now()) {
+    delete cache[key];
+    cacheSize--;
+    return null;
+  }
+
+  return entry;
+}
+
+
+function cachePut(key, ttl, value, family) {
+  if (!(ttl > 0)) return;
+
+  if (!cache[key]) {
+    if (cacheSize >= cacheMax) cachePurge();
+    cacheSize++;
+  }
+
+  cache[key] = { expires: Date.now() + ttl * 1000,
+                 value: value,
+                 family: family };
+}
+
+
+function cachePurge() {
+  var now = Date.now();
+  for (var key in cache) {
+    if (cache[key].expires <= now) {
+      delete cache[key];
+      cacheSize--;
+    }
+  }
+
+  // Nothing expired; start over rather than tracking recency.
+  if (cacheSize >= cacheMax) {
+    cache = {};
+    cacheSize = 0;
+  }
+}
+
+
+// Returns true if `callback` was queued behind an in-flight query for `key`.
+function joinInflight(key, callback) {
+  var waiters = inflight[key];
+  if (!waiters) return false;
+
+  cacheStats.collapsed++;
+  waiters.callbacks.push(callback);
+  return true;
+}
+
+
+function startInflight(key, wrap) {
+  inflight[key] = { wrap: wrap, callbacks: [] };
+}
+
+
+// Removes `key` from the in-flight table and returns the queries that
+// joined it. Done before any callback runs so a throwing callback cannot
+// leave the entry behind.
+function takeInflight(key) {
+  var waiters = inflight[key];
+  if (!waiters) return [];
+
+  delete inflight[key];
+  return waiters.callbacks;
+}
+
+
+// Hands the answer to every query that joined while it was in flight.
+// Callers get their own copy of array results so they cannot modify what
+// other callers (or the cache) see. Should one callback throw, the ones
+// after it get their answer on the next tick.
+function notifyWaiters(callbacks, err, result, family) {
+  for (var i = 0; i < callbacks.length; i++) {
+    try {
+      if (err) {
+        var e = new Error(err.message);
+        e.errno = e.code = err.code;
+        e.syscall = err.syscall;
+        callbacks[i](e);
+      } else {
+        callbacks[i](null, copyResult(result), family);
+      }
+    } catch (ex) {
+      var rest = callbacks.slice(i + 1);
+      process.nextTick(function() {
+        notifyWaiters(rest, err, result, family);
+      });
+      throw ex;
+    }
+  }
+}
+
+
+function copyResult(result) {
+  return Array.isArray(result) ? result.slice() : result;
+}
+
+
+// Sets how long, in seconds, dns.lookup() answers are cached. 0 disables
+// caching of lookups; in-flight lookups are still shared.
+exports.setLookupCacheTTL = function(ttl) {
+  ttl = +ttl;
+  if (!(ttl >= 0)) {
+    throw new Error('invalid argument: `ttl` must be a non-negative number');
+  }
+  lookupCacheTTL = ttl;
+};
+
+
+// Selects how dns.lookup() resolves names: 'getaddrinfo' (the default) runs
+// getaddrinfo(3) in the thread pool, 'cares' queries the c-ares channel and
+// answers hosts file names from an in-memory copy of the file. The latter
+// never occupies a pool thread, so a slow name server cannot hold up fs or
+// zlib work, but it skips the rest of the system resolver configuration
+// (nsswitch.conf and the like).
+exports.setLookupBackend = function(backend) {
+  if (backend !== 'getaddrinfo' && backend !== 'cares') {
+    throw new Error('invalid argument: `backend` must be ' +
+                    '"getaddrinfo" or "cares"');
+  }
+  lookupBackend = backend;
+};
+
+
+exports.cacheStats = function() {
+  return {
+    hits: cacheStats.hits,
+    misses: cacheStats.misses,
+    collapsed: cacheStats.collapsed,
+    entries: cacheSize,
+    inflight: Object.keys(inflight).length,
+    lookupTTL: lookupCacheTTL,
+    lookupBackend: lookupBackend
+  };
+};
+
+
+exports.clearCache = function() {
+  cache = {};
+  cacheSize = 0;
+  cacheStats.hits = cacheStats.misses = cacheStats.collapsed = 0;
+};
+
+
 // Easy DNS A/AAAA look up
 // lookup(domain, [family,] callback)
 exports.lookup = function(domain, family, callback) {
@@ -129,25 +296,71 @@ exports.lookup = function(domain, family, callback) {
     return {};
   }
 
-  function onanswer(addresses) {
+  var key = 'lookup:' + family + ':' + domain;
+  var entry = cacheGet(key);
+  if (entry) {
+    cacheStats.hits++;
+    callback(null, entry.value, entry.family);
+    callback.immediately = true;
+    return {};
+  }
+
+  if (joinInflight(key, callback)) {
+    callback.immediately = true;
+    return inflight[key].wrap;
+  }
+
+  if (lookupBackend === 'cares') {
+    var host = cares.hostsLookup(domain, family);
+    if (host) {
+      callback(null, host[0], host[1]);
+      callback.immediately = true;
+      return {};
+    }
+  }
+
+  cacheStats.misses++;
+
+  // c-ares answers carry the records' TTL, getaddrinfo answers do not.
+  function onanswer(addresses, addressFamily, ttl) {
+    var waiters = takeInflight(key);
     if (addresses) {
-      if (family) {
-        callback(null, addresses[0], family);
-      } else {
-        callback(null, addresses[0], addresses[0].indexOf(':') >= 0 ? 6 : 4);
+      var address = addresses[0];
+      if (ttl === undefined) {
+        addressFamily = family || (address.indexOf(':') >= 0 ? 6 : 4);
+        ttl = lookupCacheTTL;
+      }
+      cachePut(key, ttl, address, addressFamily);
+      try {
+        callback(null, address, addressFamily);
+      } finally {
+        notifyWaiters(waiters, null, address, addressFamily);
       }
     } else {
-      callback(errnoException(errno, 'getaddrinfo'));
+      var err = errnoException(errno, 'getaddrinfo');
+      try {
+        callback(err);
+      } finally {
+        notifyWaiters(waiters, err);
+      }
     }
   }
 
-  var wrap = cares.getaddrinfo(domain, family);
+  var wrap;
+  if (lookupBackend === 'cares') {
+    wrap = cares.lookup(domain, family, function(status, addresses, fam, ttl) {
+      onanswer(status ? null : addresses, fam, ttl);
+    });
+  } else {
+    wrap = cares.getaddrinfo(domain, family);
+    if (wrap) wrap.oncomplete = onanswer;
+  }
 
   if (!wrap) {
     throw errnoException(errno, 'getaddrinfo');
   }
 
-  wrap.oncomplete = onanswer;
+  startInflight(key, wrap);
 
   callback.immediately = true;
   return wrap;
@@ -158,19 +371,51 @@ function resolver(bindingName) {
   var binding = cares[bindingName];
 
   return function query(name, callback) {
-    function onanswer(status, result) {
+    var key = bindingName + ':' + name;
+
+    // `ttl` is only reported for A and AAAA answers; other record types
+    // are shared while in flight but never cached.
+    function onanswer(status, result, ttl) {
+      var waiters = takeInflight(key);
       if (!status) {
-        callback(null, result);
+        cachePut(key, ttl, result);
+        try {
+          callback(null, copyResult(result));
+        } finally {
+          notifyWaiters(waiters, null, result);
+        }
       } else {
-        callback(errnoException(errno, bindingName));
+        var err = errnoException(errno, bindingName);
+        try {
+          callback(err);
+        } finally {
+          notifyWaiters(waiters, err);
+        }
       }
     }
 
     callback = makeAsync(callback);
+
+    var entry = cacheGet(key);
+    if (entry) {
+      cacheStats.hits++;
+      callback(null, copyResult(entry.value));
+      callback.immediately = true;
+      return {};
+    }
+
+    if (joinInflight(key, callback)) {
+      callback.immediately = true;
+      return inflight[key].wrap;
+    }
+
+    cacheStats.misses++;
+
     var wrap = binding(name, onanswer);
     if (!wrap) {
       throw errnoException(errno, bindingName);
     }
+    startInflight(key, wrap);
 
     callback.immediately = true;
     return wrap;
@@ -37,15 +37,25 @@ EventEmitter.prototype.setMaxListeners = function(n) {
 };
 
 
-EventEmitter.prototype.emit = function() {
-  var type = arguments[0];
+// Arrays of listeners are copied on write: addListener() and
+// removeListener() store a new array rather than change the one there is,
+// and listeners() hands out copies, so emit() can run through it without
+// taking a copy first, even when a listener adds or removes others. The
+// loops still stop at the array's current length, in case code changes
+// _events behind our back.
+//
+// The first three arguments are named, so that the common emits read no
+// more of the arguments object than its length.
+EventEmitter.prototype.emit = function(type, a1, a2, a3) {
+  var events = this._events;
+
   // If there is no 'error' event listener then throw.
   if (type === 'error') {
-    if (!this._events || !this._events.error ||
-        (isArray(this._events.error) && !this._events.error.length))
+    if (!events || !events.error ||
+        (isArray(events.error) && !events.error.length))
     {
-      if (arguments[1] instanceof Error) {
-        throw arguments[1]; // Unhandled 'error' event
+      if (a1 instanceof Error) {
+        throw a1; // Unhandled 'error' event
       } else {
         throw new Error("Uncaught, unspecified 'error' event.");
       }
@@ -53,39 +63,57 @@ EventEmitter.prototype.emit = function() {
     }
   }
 
-  if (!this._events) return false;
-  var handler = this._events[type];
+  if (!events) return false;
+  var handler = events[type];
   if (!handler) return false;
 
+  var len = arguments.length;
+
   if (typeof handler == 'function') {
-    switch (arguments.length) {
+    switch (len) {
       // fast cases
       case 1:
         handler.call(this);
         break;
       case 2:
-        handler.call(this, arguments[1]);
+        handler.call(this, a1);
         break;
       case 3:
-        handler.call(this, arguments[1], arguments[2]);
+        handler.call(this, a1, a2);
+        break;
+      case 4:
+        handler.call(this, a1, a2, a3);
         break;
       // slower
       default:
-        var l = arguments.length;
-        var args = new Array(l - 1);
-        for (var i = 1; i < l; i++) args[i - 1] = arguments[i];
+        var args = new Array(len - 1);
+        for (var i = 1; i < len; i++) args[i - 1] = arguments[i];
         handler.apply(this, args);
     }
     return true;
 
   } else if (isArray(handler)) {
-    var l = arguments.length;
-    var args = new Array(l - 1);
-    for (var i = 1; i < l; i++) args[i - 1] = arguments[i];
-
-    var listeners = handler.slice();
-    for (var i = 0, l = listeners.length; i < l; i++) {
-      listeners[i].apply(this, args);
+    switch (len) {
+      case 1:
+        for (var i = 0; i < handler.length; i++) handler[i].call(this);
+        break;
+      case 2:
+        for (var i = 0; i < handler.length; i++) handler[i].call(this, a1);
+        break;
+      case 3:
+        for (var i = 0; i < handler.length; i++) {
+          handler[i].call(this, a1, a2);
+        }
+        break;
+      case 4:
+        for (var i = 0; i < handler.length; i++) {
+          handler[i].call(this, a1, a2, a3);
+        }
+        break;
+      default:
+        var args = new Array(len - 1);
+        for (var i = 1; i < len; i++) args[i - 1] = arguments[i];
+        for (var i = 0; i < handler.length; i++) handler[i].apply(this, args);
     }
     return true;
 
@@ -112,8 +140,13 @@ EventEmitter.prototype.addListener = function(type, listener) {
     this._events[type] = listener;
   } else if (isArray(this._events[type])) {
 
-    // If we've already got an array, just append.
-    this._events[type].push(listener);
+    // If we've already got an array, append to a copy of it.
+    var list = this._events[type];
+    var copy = new Array(list.length + 1);
+    for (var i = 0; i < list.length; i++) copy[i] = list[i];
+    copy[list.length] = listener;
+    if (list.warned) copy.warned = true;
+    this._events[type] = copy;
 
     // Check for listener leak
     if (!this._events[type].warned) {
@@ -182,9 +215,16 @@ EventEmitter.prototype.removeListener = function(type, listener) {
     }
 
     if (position < 0) return this;
-    list.splice(position, 1);
-    if (list.length == 0)
+    if (list.length == 1) {
       delete this._events[type];
+    } else {
+      var copy = new Array(list.length - 1);
+      for (var i = 0, j = 0; i < list.length; i++) {
+        if (i !== position) copy[j++] = list[i];
+      }
+      if (list.warned) copy.warned = true;
+      this._events[type] = copy;
+    }
   } else if (list === listener ||
              (list.listener && list.listener === listener))
   {
@@ -205,11 +245,10 @@ EventEmitter.prototype.removeAllListeners = function(type) {
   return this;
 };
 
+// Returns a copy; the arrays emit() runs through are never changed.
 EventEmitter.prototype.listeners = function(type) {
-  if (!this._events) this._events = {};
-  if (!this._events[type]) this._events[type] = [];
-  if (!isArray(this._events[type])) {
-    this._events[type] = [this._events[type]];
-  }
-  return this._events[type];
+  var handler = this._events && this._events[type];
+  if (!handler) return [];
+  if (!isArray(handler)) return [handler];
+  return handler.slice();
 };
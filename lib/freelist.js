@@ -20,24 +20,58 @@
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 // This is a free list to avoid creating so many of the same object.
-exports.FreeList = function(name, max, constructor) {
+//
+// The optional `reset` function is called on every object handed to free()
+// so that pooled objects do not keep their last user's state (and whatever
+// it references) alive while they sit in the list.
+exports.FreeList = function(name, max, constructor, reset) {
   this.name = name;
   this.constructor = constructor;
+  this.reset = reset;
   this.max = max;
   this.list = [];
+
+  // Counters, see stats().
+  this.allocs = 0;
+  this.hits = 0;
+  this.frees = 0;
+  this.drops = 0;
 };
 
 
 exports.FreeList.prototype.alloc = function() {
   //debug("alloc " + this.name + " " + this.list.length);
-  return this.list.length ? this.list.shift() :
-                            this.constructor.apply(this, arguments);
+  this.allocs++;
+  if (this.list.length) {
+    this.hits++;
+    // Most recently freed first, it is the likeliest to still be warm.
+    return this.list.pop();
+  }
+  return this.constructor.apply(this, arguments);
 };
 
 
 exports.FreeList.prototype.free = function(obj) {
   //debug("free " + this.name + " " + this.list.length);
+  this.frees++;
+  if (this.reset) this.reset(obj);
   if (this.list.length < this.max) {
     this.list.push(obj);
+  } else {
+    this.drops++;
   }
 };
+
+
+exports.FreeList.prototype.stats = function() {
+  return {
+    name: this.name,
+    max: this.max,
+    length: this.list.length,
+    allocs: this.allocs,
+    hits: this.hits,
+    misses: this.allocs - this.hits,
+    frees: this.frees,
+    drops: this.drops
+  };
+};
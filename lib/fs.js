@@ -32,12 +32,27 @@ var constants = process.binding('constants');
 var fs = exports;
 var Stream = require('stream').Stream;
 var EventEmitter = require('events').EventEmitter;
+var SlowBuffer = require('buffer').SlowBuffer;
 
 var kMinPoolSpace = 128;
 var kPoolSize = 40 * 1024;
+// Largest piece of a file handed to a single sendfile() call.
+var kSendfileSize = 1024 * 1024;
+// How far ahead of a stream with advice 'sequential' the kernel is asked to
+// read, and how many consumed bytes a stream dropping them lets add up.
+var kAdviseWindow = 2 * 1024 * 1024;
 
 fs.Stats = binding.Stats;
 
+
+// The binding hands out file contents as SlowBuffers; give callers a Buffer.
+function fastBuffer(slow) {
+  if (slow instanceof SlowBuffer) {
+    return new Buffer(slow, slow.length, 0);
+  }
+  return slow;
+}
+
 fs.Stats.prototype._checkModeProperty = function(property) {
   return ((this.mode & constants.S_IFMT) === property);
 };
@@ -74,6 +89,25 @@ fs.readFile = function(path, encoding_) {
   var encoding = typeof(encoding_) === 'string' ? encoding_ : null;
   var callback = arguments[arguments.length - 1];
   if (typeof(callback) !== 'function') callback = noop;
+
+  // Where the binding has it, open, fstat, read and close are one thread
+  // pool request.
+  if (binding.readFile && typeof path === 'string') {
+    binding.readFile(path, function(er, buffer) {
+      if (er) return callback(er);
+      buffer = fastBuffer(buffer);
+      if (encoding) {
+        try {
+          buffer = buffer.toString(encoding);
+        } catch (er) {
+          return callback(er);
+        }
+      }
+      callback(null, buffer);
+    });
+    return;
+  }
+
   var readStream = fs.createReadStream(path);
   var buffers = [];
   var nread = 0;
@@ -116,6 +150,11 @@ fs.readFile = function(path, encoding_) {
 };
 
 fs.readFileSync = function(path, encoding) {
+  if (binding.readFile && typeof path === 'string') {
+    var contents = fastBuffer(binding.readFile(path));
+    return encoding ? contents.toString(encoding) : contents;
+  }
+
   var fd = fs.openSync(path, constants.O_RDONLY, 438 /*=0666*/);
   var buffer = new Buffer(4048);
   var buffers = [];
@@ -319,6 +358,160 @@ fs.writeSync = function(fd, buffer, offset, length, position) {
   return binding.write(fd, buffer, offset, length, position);
 };
 
+// Where the binding has writev() and readv() all the buffers go in one
+// thread pool request and as few system calls as the platform allows;
+// elsewhere they are written or read one after the other.
+function checkBuffers(buffers) {
+  for (var i = 0; i < buffers.length; i++) {
+    if (!Buffer.isBuffer(buffers[i])) {
+      throw new TypeError('Second argument needs to be an array of buffers');
+    }
+  }
+}
+
+function transferMany(write, fd, buffers, position, callback) {
+  checkBuffers(buffers);
+  var transfer = write ? fs.write : fs.read;
+  var total = 0;
+  var i = 0;
+  var offset = 0;
+
+  (function next() {
+    while (i < buffers.length && offset === buffers[i].length) {
+      i++;
+      offset = 0;
+    }
+    if (i === buffers.length) return callback(null, total);
+
+    var buffer = buffers[i];
+    transfer(fd, buffer, offset, buffer.length - offset, position,
+             function(err, bytes) {
+      if (err) return total > 0 ? callback(null, total) : callback(err);
+      total += bytes;
+      offset += bytes;
+      if (typeof position === 'number') position += bytes;
+      // Reads stop at the first short one, writes go on.
+      if (bytes === 0 || (!write && offset < buffer.length)) {
+        return callback(null, total);
+      }
+      next();
+    });
+  })();
+}
+
+function transferManySync(write, fd, buffers, position) {
+  checkBuffers(buffers);
+  var transfer = write ? fs.writeSync : fs.readSync;
+  var total = 0;
+
+  for (var i = 0; i < buffers.length; i++) {
+    var buffer = buffers[i];
+    var offset = 0;
+    while (offset < buffer.length) {
+      try {
+        var bytes = transfer(fd, buffer, offset, buffer.length - offset,
+                             position);
+      } catch (err) {
+        if (total > 0) return total;
+        throw err;
+      }
+      total += bytes;
+      offset += bytes;
+      if (typeof position === 'number') position += bytes;
+      if (bytes === 0 || (!write && offset < buffer.length)) return total;
+    }
+  }
+  return total;
+}
+
+fs.writev = function(fd, buffers, position, callback) {
+  callback = callback || noop;
+  // Hold on to the buffers themselves, whatever happens to the array.
+  buffers = buffers.slice();
+
+  if (binding.writev) {
+    binding.writev(fd, buffers, position, false, callback);
+  } else {
+    transferMany(true, fd, buffers, position, callback);
+  }
+};
+
+fs.writevSync = function(fd, buffers, position) {
+  if (binding.writev) return binding.writev(fd, buffers, position, false);
+  return transferManySync(true, fd, buffers, position);
+};
+
+fs.readv = function(fd, buffers, position, callback) {
+  callback = callback || noop;
+  buffers = buffers.slice();
+
+  if (binding.readv) {
+    binding.readv(fd, buffers, position, callback);
+  } else {
+    transferMany(false, fd, buffers, position, callback);
+  }
+};
+
+fs.readvSync = function(fd, buffers, position) {
+  if (binding.readv) return binding.readv(fd, buffers, position);
+  return transferManySync(false, fd, buffers, position);
+};
+
+// Writes buffers at the file position and, with sync, fdatasync()s them,
+// callback(err). The binding does both in one thread pool request.
+function writevDurable(fd, buffers, sync, callback) {
+  if (binding.writev) {
+    binding.writev(fd, buffers, null, sync, callback);
+    return;
+  }
+
+  var length = 0;
+  for (var i = 0; i < buffers.length; i++) length += buffers[i].length;
+
+  fs.writev(fd, buffers, null, function(err, written) {
+    if (!err && written < length) err = new Error('EIO, short write');
+    if (err || !sync) return callback(err);
+    fs.fdatasync(fd, callback);
+  });
+}
+
+// Appends to `fd` with group commit: what is appended while a batch is
+// being written goes out as the next batch, with a single writev() and
+// fdatasync() for all of it, however many appends it holds.
+var AppendWriter = fs.AppendWriter = function(fd, options) {
+  if (!(this instanceof AppendWriter)) return new AppendWriter(fd, options);
+
+  options = options || {};
+  this.fd = fd;
+  this.sync = options.sync !== false;
+  this.writing = false;
+  this._buffers = [];
+  this._callbacks = [];
+};
+
+AppendWriter.prototype.append = function(data, callback) {
+  this._buffers.push(Buffer.isBuffer(data) ? data : new Buffer('' + data));
+  this._callbacks.push(callback);
+  if (!this.writing) this._flush();
+};
+
+AppendWriter.prototype._flush = function() {
+  var self = this;
+  var callbacks = this._callbacks;
+
+  this.writing = true;
+  writevDurable(this.fd, this._buffers, this.sync, function(err) {
+    // Appends from the callbacks wait for the next batch.
+    for (var i = 0; i < callbacks.length; i++) {
+      if (callbacks[i]) callbacks[i](err || null);
+    }
+    self.writing = false;
+    if (self._buffers.length > 0) self._flush();
+  });
+  this._buffers = [];
+  this._callbacks = [];
+};
+
 fs.rename = function(oldPath, newPath, callback) {
   binding.rename(oldPath, newPath, callback || noop);
 };
@@ -376,6 +569,26 @@ fs.sendfileSync = function(outFd, inFd, inOffset, length) {
   return binding.sendfile(outFd, inFd, inOffset, length);
 };
 
+if (binding.mmap) {
+  fs.mmap = function(fd, offset, length, advice) {
+    offset = offset || 0;
+    if (length === undefined) {
+      length = fs.fstatSync(fd).size - offset;
+    }
+    return fastBuffer(binding.mmap(fd, offset, length, advice));
+  };
+}
+
+if (binding.fadvise) {
+  fs.fadvise = function(fd, offset, length, advice, callback) {
+    binding.fadvise(fd, offset, length, advice, callback || noop);
+  };
+
+  fs.fadviseSync = function(fd, offset, length, advice) {
+    binding.fadvise(fd, offset, length, advice);
+  };
+}
+
 fs.readdir = function(path, callback) {
   binding.readdir(path, callback || noop);
 };
@@ -384,6 +597,148 @@ fs.readdirSync = function(path) {
   return binding.readdir(path);
 };
 
+// Where the binding has walk(), the types come from the directory entries
+// and a tree is read in batches on the thread pool. Elsewhere directories
+// are read one at a time and their entries lstat()ed.
+var WALK_BATCH = 1024;
+
+function entryType(stats) {
+  if (stats.isFile()) return 'file';
+  if (stats.isDirectory()) return 'directory';
+  if (stats.isSymbolicLink()) return 'symlink';
+  return 'other';
+}
+
+// Drops the entries that went away between readdir() and lstat().
+function entryTypes(names, results) {
+  var found = { names: [], types: [] };
+  for (var i = 0; i < names.length; i++) {
+    if (results[i] instanceof Error) {
+      if (results[i].code === 'ENOENT') continue;
+      throw results[i];
+    }
+    found.names.push(names[i]);
+    found.types.push(entryType(results[i]));
+  }
+  return found;
+}
+
+function walkDepth(options) {
+  var maxDepth = options && options.maxDepth;
+  return typeof maxDepth === 'number' && isFinite(maxDepth) && maxDepth >= 0 ?
+         maxDepth : -1;
+}
+
+fs.readdirTypes = function(dir, callback) {
+  callback = callback || noop;
+
+  if (binding.walk && typeof dir === 'string') {
+    binding.walk(dir, 0, 0, function(err, names, types) {
+      callback(err, names, types);
+    });
+    return;
+  }
+
+  fs.readdir(dir, function(err, names) {
+    if (err) return callback(err);
+    var paths = names.map(function(name) { return path.join(dir, name); });
+    fs.lstatMany(paths, function(err, results) {
+      try {
+        var found = entryTypes(names, results);
+      } catch (e) {
+        return callback(e);
+      }
+      callback(null, found.names, found.types);
+    });
+  });
+};
+
+fs.readdirTypesSync = function(dir) {
+  if (binding.walk && typeof dir === 'string') {
+    var found = binding.walk(dir, 0, 0);
+    return { names: found[0], types: found[1] };
+  }
+
+  var names = fs.readdirSync(dir);
+  var paths = names.map(function(name) { return path.join(dir, name); });
+  return entryTypes(names, fs.lstatManySync(paths));
+};
+
+fs.walk = function(root, options, callback) {
+  if (typeof options === 'function') {
+    callback = options;
+    options = {};
+  }
+  callback = callback || noop;
+  var batchSize = options && options.batchSize > 0 ? options.batchSize :
+                  WALK_BATCH;
+  var maxDepth = walkDepth(options);
+
+  if (binding.walk && typeof root === 'string') {
+    binding.walk(root, batchSize, maxDepth, function(err, paths, types, done) {
+      if (callback(err, paths, types, done) === false) this.stop = true;
+    });
+    return;
+  }
+
+  // One batch for every directory.
+  var dirs = [{ path: '', depth: 0 }];
+
+  (function next() {
+    var dir = dirs.pop();
+    fs.readdirTypes(dir.path ? path.join(root, dir.path) : root,
+                    function(err, names, types) {
+      if (err) {
+        if (dir.path && (err.code === 'ENOENT' || err.code === 'ENOTDIR')) {
+          names = types = [];
+        } else {
+          return callback(err, undefined, undefined, true);
+        }
+      }
+      var paths = names.map(function(name) {
+        return dir.path ? dir.path + '/' + name : name;
+      });
+      for (var i = paths.length - 1; i >= 0; i--) {
+        if (types[i] === 'directory' &&
+            (maxDepth < 0 || dir.depth < maxDepth)) {
+          dirs.push({ path: paths[i], depth: dir.depth + 1 });
+        }
+      }
+      var done = dirs.length === 0;
+      if (callback(null, paths, types, done) !== false && !done) next();
+    });
+  })();
+};
+
+fs.walkSync = function(root, options) {
+  var maxDepth = walkDepth(options);
+
+  if (binding.walk && typeof root === 'string') {
+    var found = binding.walk(root, 0, maxDepth);
+    return { paths: found[0], types: found[1] };
+  }
+
+  var result = { paths: [], types: [] };
+  (function read(dir, depth) {
+    try {
+      var found = fs.readdirTypesSync(dir ? path.join(root, dir) : root);
+    } catch (err) {
+      if (dir && (err.code === 'ENOENT' || err.code === 'ENOTDIR')) return;
+      throw err;
+    }
+    for (var i = 0; i < found.names.length; i++) {
+      var entry = dir ? dir + '/' + found.names[i] : found.names[i];
+      result.paths.push(entry);
+      result.types.push(found.types[i]);
+      if (found.types[i] === 'directory' &&
+          (maxDepth < 0 || depth < maxDepth)) {
+        read(entry, depth + 1);
+      }
+    }
+  })('', 0);
+  return result;
+};
+
 fs.fstat = function(fd, callback) {
   binding.fstat(fd, callback || noop);
 };
@@ -396,6 +751,57 @@ fs.stat = function(path, callback) {
   binding.stat(path, callback || noop);
 };
 
+// Paths handed to a single thread pool request by statMany(); the pool
+// works on the batches of a bigger call in parallel.
+var STAT_MANY_BATCH = 1024;
+
+function statMany(paths, lstat, callback) {
+  if (!Array.isArray(paths) || paths.length <= STAT_MANY_BATCH) {
+    binding.statMany(paths, lstat, callback);
+    return;
+  }
+
+  for (var i = 0; i < paths.length; i++) {
+    if (typeof paths[i] !== 'string') {
+      throw new TypeError('Bad argument');
+    }
+  }
+
+  var results = new Array(paths.length);
+  var pending = 0;
+
+  function queue(start) {
+    var batch = paths.slice(start, start + STAT_MANY_BATCH);
+    pending++;
+    binding.statMany(batch, lstat, function(err, stats) {
+      for (var j = 0; j < stats.length; j++) {
+        results[start + j] = stats[j];
+      }
+      if (--pending === 0) callback(null, results);
+    });
+  }
+
+  for (var i = 0; i < paths.length; i += STAT_MANY_BATCH) {
+    queue(i);
+  }
+}
+
+fs.statMany = function(paths, callback) {
+  statMany(paths, false, callback || noop);
+};
+
+fs.lstatMany = function(paths, callback) {
+  statMany(paths, true, callback || noop);
+};
+
+fs.statManySync = function(paths) {
+  return binding.statMany(paths, false);
+};
+
+fs.lstatManySync = function(paths) {
+  return binding.statMany(paths, true);
+};
+
 fs.fstatSync = function(fd) {
   return binding.fstat(fd);
 };
@@ -621,11 +1027,23 @@ function FSWatcher() {
       self.emit('change', event, filename);
     }
   };
+
+  // Changes coalesced over a window, see the delay option of fs.watch().
+  this._handle.onchanges = function(events, filenames) {
+    var changes = new Array(events.length);
+    for (var i = 0; i < events.length; i++) {
+      changes[i] = { event: events[i], filename: filenames[i] };
+    }
+    self.emit('changes', changes);
+    for (var i = 0; i < events.length && self._handle; i++) {
+      self.emit('change', events[i], filenames[i]);
+    }
+  };
 }
 util.inherits(FSWatcher, EventEmitter);
 
-FSWatcher.prototype.start = function(filename, persistent) {
-  var r = this._handle.start(filename, persistent);
+FSWatcher.prototype.start = function(filename, persistent, delay, recursive) {
+  var r = this._handle.start(filename, persistent, delay, recursive);
 
   if (r) {
     this._handle.close();
@@ -634,7 +1052,9 @@ FSWatcher.prototype.start = function(filename, persistent) {
 };
 
 FSWatcher.prototype.close = function() {
+  if (!this._handle) return;
   this._handle.close();
+  this._handle = null;
 };
 
 fs.watch = function(filename) {
@@ -656,8 +1076,13 @@ fs.watch = function(filename) {
 
   if (options.persistent === undefined) options.persistent = true;
 
+  var delay = options.delay === undefined ? 0 : Number(options.delay);
+  if (!(delay >= 0)) {
+    throw new TypeError('delay must be a non-negative number');
+  }
+
   watcher = new FSWatcher();
-  watcher.start(filename, options.persistent);
+  watcher.start(filename, options.persistent, delay, !!options.recursive);
 
   watcher.addListener('change', listener);
   return watcher;
@@ -969,13 +1394,41 @@ if (isWindows) {
 
 var pool;
 
-function allocNewPool() {
-  pool = new Buffer(kPoolSize);
+function allocNewPool(minSize) {
+  pool = new Buffer(Math.max(kPoolSize, minSize || 0));
   pool.used = 0;
 }
 
 
 
+// The advice file streams take, and whether it drops consumed pages from the
+// page cache.
+var streamAdvice = {
+  normal: false,
+  random: false,
+  sequential: false,
+  noreuse: true,
+  dontneed: true
+};
+
+
+function checkStreamAdvice(stream) {
+  if (stream.advice == null) return;
+  if (!streamAdvice.hasOwnProperty(stream.advice)) {
+    throw new Error('Unknown advice: ' + stream.advice);
+  }
+  if (streamAdvice[stream.advice]) stream.dropBehind = true;
+}
+
+
+// The hint for the whole file, given once the stream has its fd.
+function adviseFile(stream) {
+  var advice = stream.advice;
+  if (advice == null || advice === 'dontneed') return false;
+  return advice;
+}
+
+
 fs.createReadStream = function(path, options) {
   return new ReadStream(path, options);
 };
@@ -995,6 +1448,15 @@ var ReadStream = fs.ReadStream = function(path, options) {
   this.flags = 'r';
   this.mode = 438; /*=0666*/
   this.bufferSize = 64 * 1024;
+  this.readAhead = 1;
+
+  // Reads in flight or waiting to be emitted, oldest first.
+  this._reads = [];
+  this._readsDone = false;
+
+  // Hints in flight, which the fd must stay open for.
+  this._hints = 0;
+  this._afterHints = null;
 
   options = options || {};
 
@@ -1007,6 +1469,8 @@ var ReadStream = fs.ReadStream = function(path, options) {
 
   if (this.encoding) this.setEncoding(this.encoding);
 
+  checkStreamAdvice(this);
+
   if (this.start !== undefined) {
     if (this.end === undefined) {
       this.end = Infinity;
@@ -1020,6 +1484,7 @@ var ReadStream = fs.ReadStream = function(path, options) {
   }
 
   if (this.fd !== null) {
+    this._adviseStart(this.start);
     return;
   }
 
@@ -1031,6 +1496,7 @@ var ReadStream = fs.ReadStream = function(path, options) {
     }
 
     self.fd = fd;
+    self._adviseStart(self.start === undefined ? 0 : self.start);
     self.emit('open', fd);
     self._read();
   });
@@ -1046,16 +1512,88 @@ ReadStream.prototype.setEncoding = function(encoding) {
 
 
 ReadStream.prototype._read = function() {
+  if (!this.readable || this.paused) return;
+
+  if (this._sendfileDest) {
+    if (this._sendfileBusy || this._reads.length > 0) return;
+    // The socket was full last time. Reading the next chunk into memory and
+    // writing that waits for the socket without tying up a pool thread.
+    if (this._sendfileBlocked) {
+      this._sendfileBlocked = false;
+    } else if (this._sendfile()) {
+      return;
+    }
+  }
+
+  // Reads can only overlap if each has its own position; without one they
+  // would race for the file offset.
+  var depth = this.pos === undefined ? 1 : Math.max(this.readAhead | 0, 1);
+
+  while (this._reads.length < depth && !this._readsDone) {
+    this._queueRead();
+  }
+};
+
+
+// Gives the kernel the stream's advice. `pos` is where the stream starts in
+// the file; without it only the hint for the whole file is given.
+ReadStream.prototype._adviseStart = function(pos) {
+  if (!binding.fadvise) return;
+
+  var advice = adviseFile(this);
+  if (advice) this._advise(0, 0, advice);
+
+  if (pos === undefined) return;
+  this._consumedPos = this._droppedPos = pos;
+  if (this.advice === 'sequential') this._readaheadPos = pos;
+  this._adviseConsumed(0);
+};
+
+
+// Called with the bytes handed on after those before. Keeps the next window
+// read ahead, or drops what was handed on.
+ReadStream.prototype._adviseConsumed = function(bytes) {
+  if (this._consumedPos === undefined) return;
+
+  var pos = this._consumedPos += bytes;
+
+  if (this._readaheadPos !== undefined &&
+      pos + kAdviseWindow / 2 >= this._readaheadPos &&
+      !(this._readaheadPos > this.end)) {
+    this._advise(this._readaheadPos, kAdviseWindow, 'willneed');
+    this._readaheadPos += kAdviseWindow;
+  }
+
+  if (this.dropBehind && pos - this._droppedPos >= kAdviseWindow) {
+    this._advise(this._droppedPos, pos - this._droppedPos, 'dontneed');
+    this._droppedPos = pos;
+  }
+};
+
+
+// Hints are only hints, so their errors are ignored.
+ReadStream.prototype._advise = function(offset, length, advice) {
   var self = this;
-  if (!this.readable || this.paused || this.reading) return;
 
-  this.reading = true;
+  this._hints++;
+  binding.fadvise(this.fd, offset, length, advice, function() {
+    if (--self._hints === 0 && self._afterHints) {
+      var cb = self._afterHints;
+      self._afterHints = null;
+      cb();
+    }
+  });
+};
+
+
+ReadStream.prototype._queueRead = function() {
+  var self = this;
 
   if (!pool || pool.length - pool.used < kMinPoolSpace) {
     // discard the old pool. Can't add to the free list because
     // users might have refernces to slices on it.
     pool = null;
-    allocNewPool();
+    allocNewPool(this.bufferSize);
   }
 
   // Grab another reference to the pool in the case that while we're in the
@@ -1067,47 +1605,117 @@ ReadStream.prototype._read = function() {
 
   if (this.pos !== undefined) {
     toRead = Math.min(this.end - this.pos + 1, toRead);
+    // Nothing is left before `end`; this empty read signals the EOF.
+    if (toRead <= 0) {
+      toRead = 0;
+      this._readsDone = true;
+    }
   }
 
+  var req = { done: false, err: null, buffer: null };
+  this._reads.push(req);
+
   function afterRead(err, bytesRead) {
-    self.reading = false;
-    if (err) {
-      self.emit('error', err);
-      self.readable = false;
-      return;
+    if (!err && thisPool === pool && pool.used === start + toRead) {
+      // Nothing was reserved behind this read, so the pool space it didn't
+      // fill can go to the next one.
+      pool.used = start + bytesRead;
     }
 
-    if (bytesRead === 0) {
-      self.emit('end');
-      self.destroy();
-      return;
+    req.done = true;
+    req.err = err;
+    if (!err && bytesRead > 0) {
+      req.buffer = thisPool.slice(start, start + bytesRead);
     }
 
-    var b = thisPool.slice(start, start + bytesRead);
+    self._flushReads();
+  }
 
-    // Possible optimizition here?
-    // Reclaim some bytes if bytesRead < toRead?
-    // Would need to ensure that pool === thisPool.
+  fs.read(this.fd, pool, pool.used, toRead, this.pos, afterRead);
 
-    // do not emit events if the stream is paused
-    if (self.paused) {
-      self.buffer = b;
-      return;
-    }
+  if (this.pos !== undefined) {
+    this.pos += toRead;
+  }
+  pool.used += toRead;
+};
+
+
+// Sends the next piece of the file to the socket piped to, without copying
+// it through a buffer. Returns false if it has to be read instead.
+ReadStream.prototype._sendfile = function() {
+  var self = this;
+  var length = Math.min(this.end - this.pos + 1, kSendfileSize);
+
+  // The EOF is left to the regular read path.
+  if (length <= 0) return false;
+
+  function afterSendfile(err, bytesSent) {
+    self._sendfileBusy = false;
 
-    // do not emit events anymore after we declared the stream unreadable
     if (!self.readable) return;
 
-    self._emitData(b);
+    if (err) {
+      if (err.code === 'EAGAIN') {
+        self._sendfileBlocked = true;
+      } else {
+        // Let the regular path read and write the data, which reports the
+        // error from where it belongs.
+        self._sendfileDest = null;
+      }
+    } else if (bytesSent === 0) {
+      self._sendfileDest = null;
+    } else {
+      self.pos += bytesSent;
+      self._adviseConsumed(bytesSent);
+    }
+
     self._read();
   }
 
-  fs.read(this.fd, pool, pool.used, toRead, this.pos, afterRead);
+  this._sendfileBusy = true;
+  if (this._sendfileDest._sendfile(this.fd, this.pos, length, afterSendfile)) {
+    return true;
+  }
 
-  if (this.pos !== undefined) {
-    this.pos += toRead;
+  this._sendfileBusy = false;
+  this._sendfileDest = null;
+  return false;
+};
+
+
+// Emits the completed reads in file order, then queues more.
+ReadStream.prototype._flushReads = function() {
+  var reads = this._reads;
+
+  while (reads.length && reads[0].done) {
+    // do not emit events anymore after we declared the stream unreadable
+    if (!this.readable) return;
+
+    var req = reads[0];
+
+    if (req.err) {
+      reads.length = 0;
+      this.emit('error', req.err);
+      this.readable = false;
+      return;
+    }
+
+    if (!req.buffer) {
+      reads.length = 0;
+      this.emit('end');
+      this.destroy();
+      return;
+    }
+
+    // do not emit events if the stream is paused, resume() will.
+    if (this.paused) return;
+
+    reads.shift();
+    this._emitData(req.buffer);
+    this._adviseConsumed(req.buffer.length);
   }
-  pool.used += toRead;
+
+  this._read();
 };
 
 
@@ -1126,6 +1734,19 @@ ReadStream.prototype.destroy = function(cb) {
   this.readable = false;
 
   function close() {
+    if (self.dropBehind && self._consumedPos > self._droppedPos) {
+      self._advise(self._droppedPos,
+                   self._consumedPos - self._droppedPos,
+                   'dontneed');
+      self._droppedPos = self._consumedPos;
+    }
+
+    // The fd could be reused by the time a pending hint runs.
+    if (self._hints > 0) {
+      self._afterHints = close;
+      return;
+    }
+
     fs.close(self.fd, function(err) {
       if (err) {
         if (cb) cb(err);
@@ -1146,6 +1767,25 @@ ReadStream.prototype.destroy = function(cb) {
 };
 
 
+// Piping into a TCP socket sends the file with sendfile(2) rather than
+// emitting 'data', unless the stream decodes strings.
+ReadStream.prototype.pipe = function(dest, options) {
+  if (typeof dest._sendfile === 'function' && !this._decoder &&
+      !this._sendfileDest && this.listeners('data').length === 0) {
+    if (this.pos === undefined && this.fd === null) {
+      // We open the file ourselves, so reading starts at 0.
+      this.pos = 0;
+      this.end = Infinity;
+    }
+    if (this.pos !== undefined) {
+      this._sendfileDest = dest;
+    }
+  }
+
+  return Stream.prototype.pipe.call(this, dest, options);
+};
+
+
 ReadStream.prototype.pause = function() {
   this.paused = true;
 };
@@ -1154,15 +1794,10 @@ ReadStream.prototype.pause = function() {
 ReadStream.prototype.resume = function() {
   this.paused = false;
 
-  if (this.buffer) {
-    this._emitData(this.buffer);
-    this.buffer = null;
-  }
-
   // hasn't opened yet.
   if (null == this.fd) return;
 
-  this._read();
+  this._flushReads();
 };
 
 
@@ -1202,12 +1837,16 @@ var WriteStream = fs.WriteStream = function(path, options) {
     this.pos = this.start;
   }
 
+  checkStreamAdvice(this);
+
   this.busy = false;
   this._queue = [];
 
   if (this.fd === null) {
     this._queue.push([fs.open, this.path, this.flags, this.mode, undefined]);
     this.flush();
+  } else {
+    this._adviseStart(this.start);
   }
 };
 util.inherits(WriteStream, Stream);
@@ -1243,6 +1882,7 @@ WriteStream.prototype.flush = function() {
 
     if (method == fs.write) {
       self.bytesWritten += arguments[1];
+      self._adviseWritten();
       if (cb) {
         // write callback
         cb(null, arguments[1]);
@@ -1251,6 +1891,9 @@ WriteStream.prototype.flush = function() {
     } else if (method === fs.open) {
       // save reference for file pointer
       self.fd = arguments[1];
+      // Appending writes start at an offset we don't know.
+      self._adviseStart(self.start !== undefined ? self.start :
+                        /a/.test(self.flags) ? undefined : 0);
       self.emit('open', self.fd);
 
     } else if (method === fs.close) {
@@ -1273,6 +1916,45 @@ WriteStream.prototype.flush = function() {
   method.apply(this, args);
 };
 
+// Hints are queued like writes, so that they run before the fd is closed,
+// and their errors are ignored.
+function fadviseQuietly(fd, offset, length, advice, callback) {
+  binding.fadvise(fd, offset, length, advice, function() {
+    callback(null);
+  });
+}
+
+
+// Gives the kernel the stream's advice. `pos` is where the stream starts
+// writing; without it only the hint for the whole file is given.
+WriteStream.prototype._adviseStart = function(pos) {
+  if (!binding.fadvise) return;
+
+  var advice = adviseFile(this);
+  if (advice) this._queue.unshift([fadviseQuietly, 0, 0, advice, undefined]);
+
+  if (pos !== undefined) this._startPos = this._droppedPos = pos;
+};
+
+
+// Drops the pages written from the page cache. Only written back pages go,
+// so every call also covers the window before, whose writeback the previous
+// call started.
+WriteStream.prototype._adviseWritten = function() {
+  if (!this.dropBehind || this._startPos === undefined) return;
+
+  var pos = this._startPos + this.bytesWritten;
+  if (pos - this._droppedPos < 2 * kAdviseWindow) return;
+
+  this._queue.unshift([fadviseQuietly,
+                       this._droppedPos,
+                       pos - this._droppedPos,
+                       'dontneed',
+                       undefined]);
+  this._droppedPos = pos - kAdviseWindow;
+};
+
+
 WriteStream.prototype.write = function(data) {
   if (!this.writable) {
     this.emit('error', new Error('stream not writable'));
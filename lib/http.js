@@ -24,8 +24,13 @@ var net = require('net');
 var stream = require('stream');
 var EventEmitter = require('events').EventEmitter;
 var FreeList = require('freelist').FreeList;
-var HTTPParser = process.binding('http_parser').HTTPParser;
+var parserBinding = process.binding('http_parser');
+var HTTPParser = parserBinding.HTTPParser;
+var serializeHeaders = parserBinding.serializeHeaders;
+var ResponseCache = parserBinding.ResponseCache;
+var headerResult = [0];
 var assert = require('assert').ok;
+var zlib;  // loaded by the first response with compression on
 
 
 var debug;
@@ -41,6 +46,7 @@ var parsers = new FreeList('parsers', 1000, function() {
 
   parser._headers = [];
   parser._url = '';
+  parser.setLowerCaseHeaders(true);
 
   // Only called in the slow case where slow means
   // that the request headers were either fragmented
@@ -77,10 +83,15 @@ var parsers = new FreeList('parsers', 1000, function() {
     parser.incoming.httpVersion = info.versionMajor + '.' + info.versionMinor;
     parser.incoming.url = url;
 
-    for (var i = 0, n = headers.length; i < n; i += 2) {
-      var k = headers[i];
-      var v = headers[i + 1];
-      parser.incoming._addHeaderLine(k.toLowerCase(), v);
+    if (!Array.isArray(headers)) {
+      // Lazy headers from the parser, see server.lazyHeaders.
+      parser.incoming.headers = headers;
+    } else {
+      for (var i = 0, n = headers.length; i < n; i += 2) {
+        var k = headers[i];
+        var v = headers[i + 1];
+        parser.incoming._addHeaderLine(k, v);
+      }
     }
 
     if (info.method) {
@@ -125,7 +136,7 @@ var parsers = new FreeList('parsers', 1000, function() {
       for (var i = 0, n = headers.length; i < n; i += 2) {
         var k = headers[i];
         var v = headers[i + 1];
-        parser.incoming._addHeaderLine(k.toLowerCase(), v);
+        parser.incoming._addHeaderLine(k, v);
       }
       parser._headers = [];
       parser._url = '';
@@ -138,7 +149,39 @@ var parsers = new FreeList('parsers', 1000, function() {
     }
   };
 
+  // Batch mode: the events of one execute() call arrive in a single call.
+  parser.onBatch = function(events, b) {
+    for (var i = 0, n = events.length; i < n; i += 3) {
+      switch (events[i]) {
+        case HTTPParser.BATCH_HEADERS:
+          parser.onHeaders(events[i + 1], events[i + 2]);
+          break;
+        case HTTPParser.BATCH_HEADERS_COMPLETE:
+          parser.onHeadersComplete(events[i + 1]);
+          break;
+        case HTTPParser.BATCH_BODY:
+          parser.onBody(b, events[i + 1], events[i + 2]);
+          break;
+        case HTTPParser.BATCH_MESSAGE_COMPLETE:
+          parser.onMessageComplete();
+          break;
+        case HTTPParser.BATCH_BODY_BUFFER:
+          parser.onBody(events[i + 1], 0, events[i + 1].length);
+          break;
+      }
+    }
+  };
+
   return parser;
+}, function(parser) {
+  // Drop everything that ties a pooled parser to its last connection so
+  // the socket, the message and the user's listeners can be collected.
+  parser.socket = null;
+  parser.incoming = null;
+  parser.onIncoming = null;
+  parser._headers = [];
+  parser._url = '';
+  parser.setResponseCache(null);
 });
 exports.parsers = parsers;
 
@@ -199,13 +242,10 @@ var STATUS_CODES = exports.STATUS_CODES = {
   510 : 'Not Extended'                // RFC 2774
 };
 
+// 'HTTP/1.1 200 OK\r\n' and so on, by status code, for the default phrases.
+var statusLines = {};
+
 
-var connectionExpression = /Connection/i;
-var transferEncodingExpression = /Transfer-Encoding/i;
-var closeExpression = /close/i;
-var chunkExpression = /chunk/i;
-var contentLengthExpression = /Content-Length/i;
-var expectExpression = /Expect/i;
 var continueExpression = /100-continue/i;
 
 
@@ -250,6 +290,50 @@ IncomingMessage.prototype.setEncoding = function(encoding) {
 };
 
 
+// Parses the body as JSON while it arrives and calls back with the value,
+// or with a SyntaxError, or an Error if the message was aborted.
+IncomingMessage.prototype.readJSON = function(callback) {
+  var self = this;
+  var parser = new util.JSONParser();
+  var done = false;
+
+  function finish(err, value) {
+    if (done) return;
+    done = true;
+    self.removeListener('data', ondata);
+    self.removeListener('end', onend);
+    self.removeListener('aborted', onaborted);
+    callback(err, value);
+  }
+
+  function ondata(chunk) {
+    try {
+      parser.write(chunk);
+    } catch (err) {
+      finish(err);
+    }
+  }
+
+  function onend() {
+    var value;
+    try {
+      value = parser.end();
+    } catch (err) {
+      return finish(err);
+    }
+    finish(null, value);
+  }
+
+  function onaborted() {
+    finish(new Error('aborted'));
+  }
+
+  this.on('data', ondata);
+  this.on('end', onend);
+  this.on('aborted', onaborted);
+};
+
+
 IncomingMessage.prototype.pause = function() {
   this.socket.pause();
 };
@@ -326,6 +410,7 @@ function OutgoingMessage() {
   this.chunkedEncoding = false;
   this.shouldKeepAlive = true;
   this.useChunkedEncodingByDefault = true;
+  this.sendDate = false;
 
   this._hasBody = true;
   this._trailer = '';
@@ -365,7 +450,7 @@ OutgoingMessage.prototype._send = function(data, encoding) {
   // the same packet. Future versions of Node are going to take care of
   // this at a lower level and in a more general way.
   if (!this._headerSent) {
-    if (typeof data === 'string') {
+    if (typeof data === 'string' && this.output.length === 0) {
       data = this._header + data;
     } else {
       this.output.unshift(this._header);
@@ -381,15 +466,12 @@ OutgoingMessage.prototype._writeRaw = function(data, encoding) {
   if (this.connection &&
       this.connection._httpMessage === this &&
       this.connection.writable) {
-    // There might be pending data in the this.output buffer.
-    while (this.output.length) {
-      if (!this.connection.writable) {
-        this._buffer(data, encoding);
-        return false;
-      }
-      var c = this.output.shift();
-      var e = this.outputEncodings.shift();
-      this.connection.write(c, e);
+    // There might be pending data in the this.output buffer. Send it along
+    // with the new data in one go.
+    if (this.output.length) {
+      this.output.push(data);
+      this.outputEncodings.push(encoding);
+      return this._flushOutput();
     }
 
     // Directly write to socket.
@@ -401,6 +483,28 @@ OutgoingMessage.prototype._writeRaw = function(data, encoding) {
 };
 
 
+// Writes everything in this.output to the connection. net.Socket sends the
+// chunks with a single write request, other streams get them one by one.
+OutgoingMessage.prototype._flushOutput = function() {
+  var output = this.output;
+  var outputEncodings = this.outputEncodings;
+  var connection = this.connection;
+  var ret;
+
+  this.output = [];
+  this.outputEncodings = [];
+
+  if (connection._writev) {
+    return connection._writev(output, outputEncodings);
+  }
+
+  for (var i = 0; i < output.length; i++) {
+    ret = connection.write(output[i], outputEncodings[i]);
+  }
+  return ret;
+};
+
+
 OutgoingMessage.prototype._buffer = function(data, encoding) {
   if (data.length === 0) return;
 
@@ -429,96 +533,29 @@ OutgoingMessage.prototype._buffer = function(data, encoding) {
 
 
 OutgoingMessage.prototype._storeHeader = function(firstLine, headers) {
-  var sentConnectionHeader = false;
-  var sentContentLengthHeader = false;
-  var sentTransferEncodingHeader = false;
-  var sentExpect = false;
-
   // firstLine in the case of request is: 'GET /index.html HTTP/1.1\r\n'
   // in the case of response it is: 'HTTP/1.1 200 OK\r\n'
-  var messageHeader = firstLine;
-  var field, value;
-  var self = this;
-
-  function store(field, value) {
-    messageHeader += field + ': ' + value + CRLF;
-
-    if (connectionExpression.test(field)) {
-      sentConnectionHeader = true;
-      if (closeExpression.test(value)) {
-        self._last = true;
-      } else {
-        self.shouldKeepAlive = true;
-      }
-
-    } else if (transferEncodingExpression.test(field)) {
-      sentTransferEncodingHeader = true;
-      if (chunkExpression.test(value)) self.chunkedEncoding = true;
-
-    } else if (contentLengthExpression.test(field)) {
-      sentContentLengthHeader = true;
-
-    } else if (expectExpression.test(field)) {
-      sentExpect = true;
-    }
-  }
-
-  if (headers) {
-    var keys = Object.keys(headers);
-    var isArray = (Array.isArray(headers));
-    var field, value;
-
-    for (var i = 0, l = keys.length; i < l; i++) {
-      var key = keys[i];
-      if (isArray) {
-        field = headers[key][0];
-        value = headers[key][1];
-      } else {
-        field = key;
-        value = headers[key];
-      }
-
-      if (Array.isArray(value)) {
-        for (var j = 0; j < value.length; j++) {
-          store(field, value[j]);
-        }
-      } else {
-        store(field, value);
-      }
-    }
-  }
-
-  // keep-alive logic
-  if (sentConnectionHeader === false) {
-    if (this.shouldKeepAlive &&
-        (sentContentLengthHeader || this.useChunkedEncodingByDefault || this.agent)) {
-      messageHeader += 'Connection: keep-alive\r\n';
-    } else {
-      this._last = true;
-      messageHeader += 'Connection: close\r\n';
-    }
-  }
-
-  if (sentContentLengthHeader == false && sentTransferEncodingHeader == false) {
-    if (this._hasBody) {
-      if (this.useChunkedEncodingByDefault) {
-        messageHeader += 'Transfer-Encoding: chunked\r\n';
-        this.chunkedEncoding = true;
-      } else {
-        this._last = true;
-      }
-    } else {
-      // Make sure we don't end the 0\r\n\r\n at the end of the message.
-      this.chunkedEncoding = false;
-    }
+  var flags = 0;
+  if (this.shouldKeepAlive) flags |= parserBinding.HEADER_KEEP_ALIVE;
+  if (this.useChunkedEncodingByDefault) {
+    flags |= parserBinding.HEADER_CHUNKED_BY_DEFAULT;
   }
+  if (this.agent) flags |= parserBinding.HEADER_HAS_AGENT;
+  if (this._hasBody) flags |= parserBinding.HEADER_HAS_BODY;
+  if (this.sendDate) flags |= parserBinding.HEADER_SEND_DATE;
 
-  this._header = messageHeader + CRLF;
+  this._header = serializeHeaders(firstLine, headers, flags, headerResult);
   this._headerSent = false;
 
+  flags = headerResult[0];
+  if (flags & parserBinding.HEADER_LAST) this._last = true;
+  if (flags & parserBinding.HEADER_SET_KEEP_ALIVE) this.shouldKeepAlive = true;
+  if (flags & parserBinding.HEADER_CHUNKED) this.chunkedEncoding = true;
+  if (flags & parserBinding.HEADER_NOT_CHUNKED) this.chunkedEncoding = false;
+
   // wait until the first body chunk, or close(), is sent to flush,
   // UNLESS we're sending Expect: 100-continue.
-  if (sentExpect) this._send('');
+  if (flags & parserBinding.HEADER_EXPECT) this._send('');
 };
 
 
@@ -604,17 +641,37 @@ OutgoingMessage.prototype.write = function(chunk, encoding) {
 
   if (chunk.length === 0) return false;
 
+  if (this._cacheChunks) this._cacheChunks.push(chunk, encoding);
+
+  if (this._zlib) {
+    return this._compress(chunk, encoding);
+  }
+
+  return this._writeBody(chunk, encoding);
+};
+
+
+// Frames a body chunk, if the message is chunked, and sends it.
+OutgoingMessage.prototype._writeBody = function(chunk, encoding) {
   var len, ret;
   if (this.chunkedEncoding) {
     if (typeof(chunk) === 'string') {
       len = Buffer.byteLength(chunk, encoding);
       chunk = len.toString(16) + CRLF + chunk + CRLF;
       ret = this._send(chunk, encoding);
+    } else if (this._headerSent && this.output.length === 0 &&
+               Buffer.isBuffer(chunk) && this.connection &&
+               this.connection._httpMessage === this &&
+               this.connection.writable && this.connection._writeChunk) {
+      // Nothing queued in front of it, let the socket frame the buffer
+      // without copying it.
+      ret = this.connection._writeChunk(chunk);
     } else {
-      // buffer
+      // buffer. Queue the chunk size line and the chunk so that they go out
+      // together with the trailing CRLF.
       len = chunk.length;
-      this._send(len.toString(16) + CRLF);
-      this._send(chunk);
+      this._buffer(len.toString(16) + CRLF, 'ascii');
+      this._buffer(chunk);
       ret = this._send(CRLF);
     }
   } else {
@@ -626,6 +683,73 @@ OutgoingMessage.prototype.write = function(chunk, encoding) {
 };
 
 
+// Body chunks of a compressed message collect here until there is a batch
+// worth deflating, or the message goes idle.
+OutgoingMessage.prototype._compress = function(chunk, encoding) {
+  if (!Buffer.isBuffer(chunk)) chunk = new Buffer(chunk, encoding);
+  this._zlibPending.push(chunk);
+  this._zlibPendingLength += chunk.length;
+
+  if (this._zlibPendingLength >= this._zlib._chunkSize) {
+    return this._deflatePending(zlib.Z_NO_FLUSH);
+  }
+
+  this._armZlibFlush();
+  return this._zlibRet;
+};
+
+
+OutgoingMessage.prototype._deflatePending = function(flush) {
+  var pending = this._zlibPending;
+  var input;
+  if (pending.length === 1) {
+    input = pending[0];
+  } else {
+    input = new Buffer(this._zlibPendingLength);
+    for (var i = 0, off = 0; i < pending.length; i++) {
+      pending[i].copy(input, off);
+      off += pending[i].length;
+    }
+  }
+  this._zlibPending = [];
+  this._zlibPendingLength = 0;
+
+  var out = this._zlib._processSync(input, flush);
+  if (out.length > 0) {
+    this._zlibRet = this._writeBody(out);
+  }
+
+  if (flush === zlib.Z_NO_FLUSH) {
+    // deflate() may be holding on to some of it.
+    this._armZlibFlush();
+  }
+  return this._zlibRet;
+};
+
+
+OutgoingMessage.prototype._armZlibFlush = function() {
+  if (this._zlibTimer) return;
+  var self = this;
+  this._zlibTimer = setTimeout(function() {
+    self._zlibTimer = null;
+    if (self._zlib) self._deflatePending(zlib.Z_SYNC_FLUSH);
+  }, this._zlibFlushDelay);
+};
+
+
+OutgoingMessage.prototype._finishCompression = function() {
+  if (this._zlibTimer) {
+    clearTimeout(this._zlibTimer);
+    this._zlibTimer = null;
+  }
+  var ret = this._deflatePending(zlib.Z_FINISH);
+  // Back to the pool for the next response.
+  this._zlib._binding.close();
+  this._zlib = null;
+  return ret;
+};
+
+
 OutgoingMessage.prototype.addTrailers = function(headers) {
   this._trailer = '';
   var keys = Object.keys(headers);
@@ -651,6 +775,15 @@ OutgoingMessage.prototype.end = function(data, encoding) {
     return false;
   }
   if (!this._header) {
+    if (data && this._compressOptions) {
+      // The whole body, for the size threshold.
+      this._endLength = Buffer.isBuffer(data) ? data.length :
+                        Buffer.byteLength(data, encoding);
+    }
+    if (this._cacheChunks && !this._compressOptions) {
+      // A cached response needs a length rather than chunks.
+      this._setImplicitLength(data, encoding);
+    }
     this._implicitHeader();
   }
 
@@ -662,7 +795,8 @@ OutgoingMessage.prototype.end = function(data, encoding) {
 
   var ret;
 
-  var hot = this._headerSent === false &&
+  var hot = !this._zlib &&
+            this._headerSent === false &&
             typeof(data) === 'string' &&
             data.length > 0 &&
             this.output.length === 0 &&
@@ -685,12 +819,17 @@ OutgoingMessage.prototype.end = function(data, encoding) {
       ret = this.connection.write(this._header + data, encoding);
     }
     this._headerSent = true;
+    if (this._cacheChunks) this._cacheChunks.push(data, encoding);
 
   } else if (data) {
     // Normal body write.
     ret = this.write(data, encoding);
   }
 
+  if (this._zlib) {
+    ret = this._finishCompression();
+  }
+
   if (!hot) {
     if (this.chunkedEncoding) {
       ret = this._send('0\r\n' + this._trailer + '\r\n'); // Last chunk.
@@ -702,6 +841,8 @@ OutgoingMessage.prototype.end = function(data, encoding) {
 
   this.finished = true;
 
+  if (this._cacheChunks) this._storeInCache();
+
   // There is the first message on the outgoing queue, and we've sent
   // everything to the socket.
   debug('outgoing message end.');
@@ -749,14 +890,11 @@ OutgoingMessage.prototype._flush = function() {
   if (!this.socket) return;
 
   var ret;
-  while (this.output.length) {
+  if (this.output.length) {
 
     if (!this.socket.writable) return; // XXX Necessary?
 
-    var data = this.output.shift();
-    var encoding = this.outputEncodings.shift();
-
-    ret = this.socket.write(data, encoding);
+    ret = this._flushOutput();
   }
 
   if (this.finished) {
@@ -780,6 +918,9 @@ function ServerResponse(req) {
     this.useChunkedEncodingByDefault = false;
     this.shouldKeepAlive = false;
   }
+
+  this._acceptEncoding = req.headers['accept-encoding'];
+  this._ifNoneMatch = req.headers['if-none-match'];
 }
 util.inherits(ServerResponse, OutgoingMessage);
 
@@ -788,6 +929,207 @@ exports.ServerResponse = ServerResponse;
 
 ServerResponse.prototype.statusCode = 200;
 
+// Compresses the body with gzip or deflate, whichever the client prefers,
+// provided it is at least `threshold` bytes where the length is known up
+// front. Output deflated so far is flushed after `flushDelay` ms without a
+// write.
+ServerResponse.prototype.compress = function(options) {
+  if (this._header) {
+    throw new Error('Can\'t enable compression after headers are sent.');
+  }
+  options = options || {};
+  this._compressOptions = {
+    threshold: options.threshold === undefined ? 1024 : options.threshold,
+    flushDelay: options.flushDelay === undefined ? 10 : options.flushDelay,
+    level: options.level,
+    memLevel: options.memLevel,
+    windowBits: options.windowBits
+  };
+};
+
+
+// Picks 'gzip' or 'deflate' from an Accept-Encoding header, or null.
+function acceptedEncoding(header) {
+  if (!header) return null;
+
+  var best = null;
+  var bestQ = 0;
+  var codings = header.split(',');
+  for (var i = 0; i < codings.length; i++) {
+    var params = codings[i].split(';');
+    var coding = params[0].trim().toLowerCase();
+    if (coding !== 'gzip' && coding !== 'deflate' && coding !== '*') continue;
+
+    var q = 1;
+    for (var j = 1; j < params.length; j++) {
+      var m = /^\s*q\s*=\s*([0-9.]+)\s*$/.exec(params[j]);
+      if (m) q = parseFloat(m[1]);
+    }
+    if (coding === '*') coding = 'gzip';
+    // gzip wins ties.
+    if (q > bestQ || (q === bestQ && q > 0 && coding === 'gzip')) {
+      best = coding;
+      bestQ = q;
+    }
+  }
+  return bestQ > 0 ? best : null;
+}
+
+
+// Decides whether the response body gets compressed, and if so, returns the
+// headers with Content-Encoding added and Content-Length gone.
+ServerResponse.prototype._setupCompression = function(headers) {
+  var options = this._compressOptions;
+  var coding = acceptedEncoding(this._acceptEncoding);
+  var length = this._endLength;
+  var isArray = Array.isArray(headers);
+  var fields = [];
+  var i, field, value;
+
+  if (headers) {
+    var keys = Object.keys(headers);
+    for (i = 0; i < keys.length; i++) {
+      if (isArray) {
+        field = headers[keys[i]][0];
+        value = headers[keys[i]][1];
+      } else {
+        field = keys[i];
+        value = headers[field];
+      }
+      var lower = field.toLowerCase();
+      if (lower === 'content-encoding') return headers;
+      if (lower === 'content-length') {
+        length = parseInt(value, 10);
+        continue;
+      }
+      fields.push([field, value]);
+    }
+  }
+
+  // Caches need to know the body depends on Accept-Encoding.
+  fields.push(['Vary', 'Accept-Encoding']);
+
+  if (!coding || (length !== undefined && length < options.threshold)) {
+    if (isArray) {
+      return headers ? headers.concat([['Vary', 'Accept-Encoding']]) :
+                       [['Vary', 'Accept-Encoding']];
+    }
+    var copy = {};
+    if (headers) {
+      for (i = 0; i < keys.length; i++) copy[keys[i]] = headers[keys[i]];
+    }
+    copy['Vary'] = 'Accept-Encoding';
+    return copy;
+  }
+
+  fields.push(['Content-Encoding', coding]);
+
+  if (!zlib) zlib = require('zlib');
+  var zopts = {
+    level: options.level,
+    memLevel: options.memLevel,
+    windowBits: options.windowBits
+  };
+  this._zlib = coding === 'gzip' ? new zlib.Gzip(zopts) :
+                                   new zlib.Deflate(zopts);
+  this._zlibPending = [];
+  this._zlibPendingLength = 0;
+  this._zlibFlushDelay = options.flushDelay;
+  this._zlibTimer = null;
+  this._zlibRet = true;
+
+  return fields;
+};
+
+
+// Answers later requests with the same method, Host, URL and values of the
+// request headers named by Vary with this response, for ttl milliseconds.
+// See Server#setResponseCache().
+ServerResponse.prototype.cache = function(ttl) {
+  if (this.finished) {
+    throw new Error('Can\'t cache a response that has ended.');
+  }
+  if (!this._responseCache || this._header || !(ttl > 0)) return;
+  this._cacheTTL = ttl;
+  this._cacheChunks = [];
+};
+
+
+ServerResponse.prototype._setImplicitLength = function(data, encoding) {
+  var headers = this._headers;
+  if (headers &&
+      (headers['content-length'] !== undefined ||
+       headers['transfer-encoding'] !== undefined)) {
+    return;
+  }
+  var length = !data ? 0 : Buffer.isBuffer(data) ? data.length :
+                               Buffer.byteLength(data, encoding);
+  this.setHeader('Content-Length', length);
+};
+
+
+var contentLengthExpression = /\r\ncontent-length: *(\d+)/i;
+var varyExpression = /\r\nvary: *([^\r]*)/i;
+
+// Hands the response to the cache, if it can be replayed as it is: sent
+// whole, with a Content-Length and uncompressed, on a keep-alive HTTP/1.1
+// connection.
+ServerResponse.prototype._storeInCache = function() {
+  var chunks = this._cacheChunks;
+  var req = this._cacheRequest;
+  this._cacheChunks = null;
+  this._cacheRequest = null;
+
+  if (this.chunkedEncoding || this._last || !this.shouldKeepAlive ||
+      this._compressOptions || req.httpVersion !== '1.1' ||
+      (req.method !== 'GET' && req.method !== 'HEAD')) {
+    return;
+  }
+
+  var header = this._header;
+  var length = contentLengthExpression.exec(header);
+  if (!length) return;
+
+  var body = [];
+  var bodyLength = 0;
+  for (var i = 0; i < chunks.length; i += 2) {
+    var chunk = chunks[i];
+    if (!Buffer.isBuffer(chunk)) chunk = new Buffer(chunk, chunks[i + 1]);
+    body.push(chunk);
+    bodyLength += chunk.length;
+  }
+  // Anything that bypassed write() and end(), like sendFile(), is missing.
+  if (this._hasBody && bodyLength !== parseInt(length[1], 10)) return;
+
+  var varyNames = [];
+  var varyValues = [];
+  var vary = varyExpression.exec(header);
+  if (vary) {
+    varyNames = vary[1].split(',').map(function(name) {
+      return name.trim().toLowerCase();
+    }).filter(function(name) {
+      return name.length > 0;
+    });
+    for (var i = 0; i < varyNames.length; i++) {
+      if (varyNames[i] === '*') return;
+      var value = req.headers[varyNames[i]];
+      if (Array.isArray(value)) value = value.join(', ');
+      varyValues.push(value === undefined ? '' : String(value));
+    }
+  }
+
+  var host = req.headers.host;
+  this._responseCache.set(req.method,
+                          host === undefined ? '' : String(host),
+                          req.url,
+                          varyNames,
+                          varyValues,
+                          new Buffer(header, 'ascii'),
+                          Buffer.concat(body),
+                          this._cacheTTL);
+};
+
+
 ServerResponse.prototype.writeContinue = function() {
   this._writeRaw('HTTP/1.1 100 Continue' + CRLF + CRLF, 'ascii');
   this._sent100 = true;
@@ -843,8 +1185,15 @@ ServerResponse.prototype.writeHead = function(statusCode) {
     headers = obj;
   }
 
-  var statusLine = 'HTTP/1.1 ' + statusCode.toString() + ' ' +
-                   reasonPhrase + CRLF;
+  var statusLine;
+  if (headerIndex === 1 && STATUS_CODES[statusCode]) {
+    statusLine = statusLines[statusCode] ||
+                 (statusLines[statusCode] = 'HTTP/1.1 ' + statusCode + ' ' +
+                                            reasonPhrase + CRLF);
+  } else {
+    statusLine = 'HTTP/1.1 ' + statusCode.toString() + ' ' +
+                 reasonPhrase + CRLF;
+  }
 
   if (statusCode === 204 || statusCode === 304 ||
       (100 <= statusCode && statusCode <= 199)) {
@@ -867,6 +1216,10 @@ ServerResponse.prototype.writeHead = function(statusCode) {
     this.shouldKeepAlive = false;
   }
 
+  if (this._compressOptions && this._hasBody) {
+    headers = this._setupCompression(headers);
+  }
+
   this._storeHeader(statusLine, headers);
 };
 
@@ -875,6 +1228,238 @@ ServerResponse.prototype.writeHeader = function() {
 };
 
 
+// FILES
+//
+// res.sendFile() serves from a cache of open files, src/node_file_cache.cc,
+// that also keeps their size, ETag and Last-Modified, and drops them when
+// they change. The header and the file go out from there with write() and
+// sendfile() as far as the socket takes them without blocking, which for
+// small files is all of it. What is left goes through the socket, with
+// sendfile() on the thread pool while it keeps up.
+
+exports.fileCacheSize = 256;
+
+var fileCache;
+// Largest piece of a file sent in one go once the socket is full.
+var kSendFileChunk = 64 * 1024;
+
+
+function getFileCache() {
+  if (fileCache === undefined) {
+    try {
+      var FileCache = process.binding('file_cache').FileCache;
+      fileCache = new FileCache(exports.fileCacheSize);
+    } catch (e) {
+      // POSIX only
+      fileCache = null;
+    }
+  }
+  return fileCache;
+}
+
+
+function etagMatches(header, etag) {
+  if (!header) return false;
+  var tags = header.split(',');
+  for (var i = 0; i < tags.length; i++) {
+    var tag = tags[i].trim();
+    if (tag === etag || tag === '*') return true;
+  }
+  return false;
+}
+
+
+ServerResponse.prototype.sendFile = function(filename, callback) {
+  var self = this;
+
+  callback = callback || function(err) {
+    if (err) self.emit('error', err);
+  };
+  filename = require('path').resolve(filename);
+
+  var cache = getFileCache();
+  if (!cache) return this._sendFileStream(filename, callback);
+
+  var entry = cache.get(filename);
+  if (entry) return this._sendFileEntry(cache, entry, callback);
+
+  cache.open(filename, function(err, entry) {
+    if (err) return callback(err);
+    if (!entry) return self._sendFileStream(filename, callback);
+    self._sendFileEntry(cache, entry, callback);
+  });
+};
+
+
+ServerResponse.prototype._sendFileEntry = function(cache, entry, callback) {
+  var self = this;
+
+  // The length is known and the file is sent as it is.
+  this._compressOptions = null;
+  this.setHeader('ETag', entry.etag);
+  this.setHeader('Last-Modified', entry.lastModified);
+
+  if (etagMatches(this._ifNoneMatch, entry.etag)) {
+    this.writeHead(304);
+    this.end();
+    return callback(null);
+  }
+
+  this.setHeader('Content-Length', entry.size);
+  this.writeHead(this.statusCode);
+
+  var socket = this.connection;
+  if (!this._hasBody || entry.size === 0 ||
+      !socket || socket._httpMessage !== this || !socket.writable ||
+      !socket._handle || !socket._handle.fileno ||
+      this.output.length > 0 || socket._pendingWriteReqs > 0 ||
+      socket._corkedChunks) {
+    // HEAD, or the socket is busy or can't do it.
+    if (!this._hasBody) {
+      this.end();
+      return callback(null);
+    }
+    cache.hold(entry.id);
+    return this._sendFileFd(entry.fd, 0, entry.size, false, function(err) {
+      cache.release(entry.id);
+      callback(err);
+    });
+  }
+
+  var header = this._header;
+  var sent = cache.send(socket._handle.fileno(), entry.id, header);
+  this._headerSent = true;
+  socket.bytesWritten += sent;
+  // like active() in net.js
+  if (socket._idleTimeout > 0) {
+    socket._handle.setIdleTimeout(socket._idleTimeout);
+  }
+
+  if (sent === header.length + entry.size) {
+    this.end();
+    return callback(null);
+  }
+
+  if (sent < header.length) socket.write(header.slice(sent), 'ascii');
+  var offset = Math.max(sent - header.length, 0);
+
+  cache.hold(entry.id);
+  this._sendFileFd(entry.fd, offset, entry.size, true, function(err) {
+    cache.release(entry.id);
+    callback(err);
+  });
+};
+
+
+// Sends bytes offset to end of fd and then ends the response. With
+// `sendfile` the socket takes them straight from the file while it keeps
+// up; otherwise, and once it is full, they are read and written, which also
+// works before the response has the socket to itself.
+ServerResponse.prototype._sendFileFd = function(fd, offset, end, sendfile,
+                                                callback) {
+  var self = this;
+  var socket = this.connection;
+  var done = false;
+
+  function finish(err) {
+    if (done) return;
+    done = true;
+    if (socket) socket.removeListener('close', onclose);
+    if (err) {
+      if (socket) socket.destroy();
+    } else {
+      self.end();
+    }
+    callback(err || null);
+  }
+
+  function onclose() {
+    finish(new Error('socket hang up'));
+  }
+
+  if (socket) socket.on('close', onclose);
+
+  function next() {
+    if (done) return;
+    if (offset >= end) return finish();
+
+    var length = Math.min(end - offset, kSendFileChunk);
+
+    if (sendfile) {
+      var started = socket._sendfile(fd, offset, length,
+                                     function(err, bytesSent) {
+        if (err && err.code !== 'EAGAIN') return finish(err);
+        if (!err && bytesSent > 0) {
+          offset += bytesSent;
+          return next();
+        }
+        // The socket is full, let the next piece wait for it in its queue.
+        write(length);
+      });
+      if (!started) finish(new Error('Socket can not sendfile'));
+    } else {
+      write(length);
+    }
+  }
+
+  function write(length) {
+    var buffer = new Buffer(length);
+    require('fs').read(fd, buffer, 0, length, offset,
+                       function(err, bytesRead) {
+      if (err) return finish(err);
+      if (bytesRead === 0) return finish(new Error('File changed size'));
+      offset += bytesRead;
+      self._send(buffer.slice(0, bytesRead));
+      if (socket && socket._httpMessage === self &&
+          socket._pendingWriteReqs > 0) {
+        socket.once('drain', next);
+      } else {
+        next();
+      }
+    });
+  }
+
+  next();
+};
+
+
+// Without the cache, on Windows or where the file's directory can't be
+// watched.
+ServerResponse.prototype._sendFileStream = function(filename, callback) {
+  var self = this;
+  var fs = require('fs');
+
+  fs.open(filename, 'r', function(err, fd) {
+    if (err) return callback(err);
+    fs.fstat(fd, function(err, stat) {
+      if (!err && !stat.isFile()) {
+        err = new Error('EISDIR, not a file \'' + filename + '\'');
+        err.code = 'EISDIR';
+      }
+      if (err) {
+        fs.close(fd);
+        return callback(err);
+      }
+
+      self._compressOptions = null;
+      self.setHeader('Last-Modified', stat.mtime.toUTCString());
+      self.setHeader('Content-Length', stat.size);
+      self.writeHead(self.statusCode);
+      if (!self._hasBody) {
+        fs.close(fd);
+        self.end();
+        return callback(null);
+      }
+
+      self._sendFileFd(fd, 0, stat.size, false, function(err) {
+        fs.close(fd);
+        callback(err);
+      });
+    });
+  });
+};
+
+
 // New Agent code.
 
 // The largest departure from the previous implementation is that
@@ -893,10 +1478,21 @@ function Agent(options) {
   self.requests = {};
   self.sockets = {};
   self.maxSockets = self.options.maxSockets || Agent.defaultMaxSockets;
+  // Idle keep-alive sockets, most recently used last, per host:port.
+  self.freeSockets = {};
+  self.maxFreeSockets = self.options.maxFreeSockets || 0;
+  self.freeSocketTimeout = self.options.freeSocketTimeout ||
+                           Agent.defaultFreeSocketTimeout;
+  // How many requests may be sent on a socket before their responses have
+  // arrived, see setupPipeline().
+  self.pipelining = self.options.pipelining || 0;
   self.on('free', function(socket, host, port) {
     var name = host + ':' + port;
     if (self.requests[name] && self.requests[name].length) {
-      self.requests[name].shift().onSocket(socket);
+      self._assignSocket(self.requests[name].shift(), socket);
+    } else if (self.maxFreeSockets > 0 &&
+               socket.readable && socket.writable) {
+      self.addFreeSocket(socket, name);
     } else {
       // If there are no pending requests just destroy the
       // socket and it will get removed from the pool. This
@@ -911,6 +1507,7 @@ util.inherits(Agent, EventEmitter);
 exports.Agent = Agent;
 
 Agent.defaultMaxSockets = 5;
+Agent.defaultFreeSocketTimeout = 15000;
 
 Agent.prototype.defaultPort = 80;
 Agent.prototype.addRequest = function(req, host, port) {
@@ -918,9 +1515,17 @@ Agent.prototype.addRequest = function(req, host, port) {
   if (!this.sockets[name]) {
     this.sockets[name] = [];
   }
-  if (this.sockets[name].length < this.maxSockets) {
+  var socket = this.takeFreeSocket(name);
+  if (socket) {
+    // Reuse the idle socket that was used last.
+    this._assignSocket(req, socket);
+  } else if (this.sockets[name].length < this.maxSockets) {
     // If we are under maxSockets create a new one.
-    req.onSocket(this.createSocket(name, host, port));
+    this._assignSocket(req, this.createSocket(name, host, port));
+  } else if (this.pipelining > 0 &&
+             (socket = this._pipelineSocket(name, req))) {
+    // Send it behind the requests on a busy socket.
+    this._assignSocket(req, socket);
   } else {
     // We are over limit so we'll add it to the queue.
     if (!this.requests[name]) {
@@ -936,6 +1541,7 @@ Agent.prototype.createSocket = function(name, host, port) {
     self.sockets[name] = [];
   }
   this.sockets[name].push(s);
+  if (self.pipelining > 0) setupPipeline(self, s, host, port);
   var onFree = function() {
     self.emit('free', s, host, port);
   }
@@ -970,6 +1576,16 @@ Agent.prototype.removeSocket = function(s, name, host, port) {
     delete this.sockets[name];
     delete this.requests[name];
   }
+  var free = this.freeSockets[name];
+  if (free) {
+    var index = free.indexOf(s);
+    if (index !== -1) {
+      free.splice(index, 1);
+    }
+    if (free.length === 0) {
+      delete this.freeSockets[name];
+    }
+  }
   if (this.requests[name] && this.requests[name].length) {
     // If we have pending requests and a socket gets closed a new one
     // needs to be created to take over in the pool for the one that closed.
@@ -977,6 +1593,214 @@ Agent.prototype.removeSocket = function(s, name, host, port) {
   }
 };
 
+// Keeps an idle socket for the next request to the same host:port. Past
+// maxFreeSockets the least recently used one is closed.
+Agent.prototype.addFreeSocket = function(socket, name) {
+  var free = this.freeSockets[name] || (this.freeSockets[name] = []);
+  free.push(socket);
+  if (free.length > this.maxFreeSockets) {
+    free.shift().destroy();
+  }
+  socket.setTimeout(this.freeSocketTimeout);
+  socket.on('timeout', onFreeSocketTimeout);
+  socket.on('error', onFreeSocketError);
+};
+Agent.prototype.takeFreeSocket = function(name) {
+  var free = this.freeSockets[name];
+  if (!free) return null;
+  var socket = free.pop();
+  if (free.length === 0) {
+    delete this.freeSockets[name];
+  }
+  socket.setTimeout(0);
+  socket.removeListener('timeout', onFreeSocketTimeout);
+  socket.removeListener('error', onFreeSocketError);
+  return socket;
+};
+
+Agent.prototype._assignSocket = function(req, socket) {
+  if (socket._pipeline) {
+    req.onPipelineSocket(socket);
+  } else {
+    req.onSocket(socket);
+  }
+};
+
+
+// Methods whose requests may be sent again when the connection fails before
+// their response arrived, RFC 2616 9.1.2.
+var idempotentMethods = {
+  GET: true, HEAD: true, OPTIONS: true, TRACE: true, PUT: true, DELETE: true
+};
+
+function canPipeline(socket, req, depth) {
+  var pipeline = socket._pipeline;
+  if (socket._httpMessage || socket._pipelineClosing || !socket.writable) {
+    return false;
+  }
+  if (pipeline.length === 0) return true;
+  if (pipeline.length >= depth || !idempotentMethods[req.method]) {
+    return false;
+  }
+  // Nothing goes behind a request that could not be retried.
+  for (var i = 0; i < pipeline.length; i++) {
+    if (!idempotentMethods[pipeline[i].method]) return false;
+  }
+  return true;
+}
+
+
+// The socket with the fewest requests in flight that req can be sent on
+// right away, if any.
+Agent.prototype._pipelineSocket = function(name, req) {
+  var sockets = this.sockets[name];
+  var best = null;
+  for (var i = 0; i < sockets.length; i++) {
+    var s = sockets[i];
+    if (s._pipeline && canPipeline(s, req, this.pipelining) &&
+        (!best || s._pipeline.length < best._pipeline.length)) {
+      best = s;
+    }
+  }
+  return best;
+};
+
+
+// Called when a request on a pipelined socket got its response or was
+// written out: sends the next waiting request, or frees an idle socket.
+Agent.prototype._pipelineNext = function(socket) {
+  var name = socket._pipelineHost + ':' + socket._pipelinePort;
+  var queue = this.requests[name];
+
+  if (queue && queue.length &&
+      canPipeline(socket, queue[0], this.pipelining)) {
+    this._assignSocket(queue.shift(), socket);
+  } else if (socket._pipeline.length === 0 && !socket._httpMessage &&
+             !socket._pipelineClosing) {
+    this.emit('free', socket, socket._pipelineHost, socket._pipelinePort);
+  }
+};
+
+
+// A socket of an agent with pipelining on reads all responses with one
+// parser and hands each to the oldest request still waiting, in
+// socket._pipeline. Requests that had no response yet when the socket
+// fails are sent again on another one, if their method is idempotent and
+// they have no body; the others get the error.
+function setupPipeline(agent, socket, host, port) {
+  var parser = parsers.alloc();
+  parser.reinitialize(HTTPParser.RESPONSE);
+  parser.socket = socket;
+  parser.incoming = null;
+
+  socket._pipeline = [];
+  socket._pipelineHost = host;
+  socket._pipelinePort = port;
+  socket._pipelineClosing = false;
+  socket._pipelineError = null;
+
+  httpSocketSetup(socket);
+
+  socket.ondata = function(d, start, end) {
+    var ret = parser.execute(d, start, end - start);
+    if (ret instanceof Error) {
+      debug('parse error');
+      socket.destroy(ret);
+    } else if (parser.incoming && parser.incoming.upgrade) {
+      // Upgrades are not pipelined.
+      socket.destroy();
+    }
+  };
+
+  socket.onend = function() {
+    parser.finish();
+    socket.destroy();
+  };
+
+  socket.on('error', function(err) {
+    debug('HTTP PIPELINE SOCKET ERROR: ' + err.message);
+    socket._pipelineError = err;
+  });
+
+  socket.on('close', function() {
+    parsers.free(parser);
+    socket._pipelineClosing = true;
+
+    var pipeline = socket._pipeline;
+    socket._pipeline = [];
+    socket._httpMessage = null;
+
+    pipeline.forEach(function(req) {
+      if (req.res) {
+        // Socket closed before we emitted "end".
+        req.emit('close');
+        req.res.emit('aborted');
+        req.res.emit('end');
+        req.res.emit('close');
+      } else if (!req._aborted && !req._hasBodyData && !req._retried &&
+                 idempotentMethods[req.method] && req._header) {
+        debug('AGENT retrying ' + req.method + ' ' + req.path);
+        req._retried = true;
+        req.socket = req.connection = null;
+        // Everything was written: the header, as there is no body.
+        req.output = [req._header];
+        req.outputEncodings = ['ascii'];
+        agent.addRequest(req, host, port);
+      } else {
+        req.emit('error', socket._pipelineError || createHangUpError());
+        req._hadError = true;
+        req.emit('close');
+      }
+    });
+  });
+
+  parser.onIncoming = function(res, shouldKeepAlive) {
+    var req = socket._pipeline[0];
+
+    if (!req || req.res) {
+      // A response nobody asked for.
+      socket.destroy();
+      return;
+    }
+
+    if (res.statusCode == 100) {
+      req.emit('continue');
+      return true;
+    }
+
+    req.res = res;
+
+    // The server closes the connection after this response; requests sent
+    // behind it will be retried.
+    if (!shouldKeepAlive) socket._pipelineClosing = true;
+
+    res.on('end', function() {
+      socket._pipeline.shift();
+      if (socket._pipelineClosing) {
+        if (socket.writable) socket.destroySoon();
+      } else {
+        agent._pipelineNext(socket);
+      }
+    });
+
+    DTRACE_HTTP_CLIENT_RESPONSE(socket, req);
+    req.emit('response', res);
+
+    return req.method == 'HEAD';
+  };
+}
+
+
+function onFreeSocketTimeout() {
+  debug('AGENT idle socket timeout');
+  this.destroy();
+}
+
+function onFreeSocketError(err) {
+  // The 'close' that follows removes the socket from the pool.
+  debug('AGENT idle socket error: ' + err.message);
+}
+
 var globalAgent = new Agent();
 exports.globalAgent = globalAgent;
 
@@ -1076,6 +1900,7 @@ ClientRequest.prototype._implicitHeader = function() {
 };
 
 ClientRequest.prototype.abort = function() {
+  this._aborted = true;
   if (this.socket) {
     // in-progress
     this.socket.destroy();
@@ -1088,6 +1913,49 @@ ClientRequest.prototype.abort = function() {
 };
 
 
+// A request with a body is not retried on a pipelined socket.
+ClientRequest.prototype.write = function(chunk) {
+  if (chunk && chunk.length) this._hasBodyData = true;
+  return OutgoingMessage.prototype.write.apply(this, arguments);
+};
+
+
+ClientRequest.prototype.end = function(data) {
+  if (data && data.length) this._hasBodyData = true;
+  return OutgoingMessage.prototype.end.apply(this, arguments);
+};
+
+
+// Sends the request on a socket of setupPipeline(). It writes once the
+// request before it has been written out.
+ClientRequest.prototype.onPipelineSocket = function(socket) {
+  var req = this;
+  var agent = req.agent;
+
+  socket._pipeline.push(req);
+  socket._httpMessage = req;
+
+  process.nextTick(function() {
+    req.socket = socket;
+    req.connection = socket;
+
+    req.once('finish', function() {
+      if (socket._httpMessage === req) socket._httpMessage = null;
+      agent._pipelineNext(socket);
+    });
+
+    // The constructor flushes the request once it has its first socket.
+    if (req._retried) {
+      req._deferToConnect(null, null, function() {
+        req._flush();
+      });
+    }
+
+    req.emit('socket', socket);
+  });
+};
+
+
 function createHangUpError() {
   var error = new Error('socket hang up');
   error.code = 'ECONNRESET';
@@ -1313,9 +2181,23 @@ function httpSocketSetup(socket) {
 }
 
 
-function Server(requestListener) {
-  if (!(this instanceof Server)) return new Server(requestListener);
-  net.Server.call(this, { allowHalfOpen: true });
+function Server(options, requestListener) {
+  if (!(this instanceof Server)) return new Server(options, requestListener);
+
+  if (typeof options == 'function') {
+    requestListener = options;
+    options = null;
+  }
+
+  // Takes the options of net.Server, except that HTTP needs half-open
+  // connections.
+  var netOptions = { allowHalfOpen: true };
+  if (options) {
+    for (var key in options) {
+      if (key !== 'allowHalfOpen') netOptions[key] = options[key];
+    }
+  }
+  net.Server.call(this, netOptions);
 
   if (requestListener) {
     this.addListener('request', requestListener);
@@ -1327,15 +2209,42 @@ function Server(requestListener) {
   this.httpAllowHalfOpen = false;
 
   this.addListener('connection', connectionListener);
+
+  this._responseCache = null;
 }
 util.inherits(Server, net.Server);
 
 
+// Keeps up to maxEntries responses marked with response.cache(); 0 turns
+// the cache off. Connections accepted from then on answer requests for
+// cached responses natively.
+Server.prototype.setResponseCache = function(maxEntries) {
+  if (maxEntries === undefined) maxEntries = 1000;
+  this._responseCache = maxEntries > 0 ? new ResponseCache(maxEntries) : null;
+};
+
+
+Server.prototype.clearResponseCache = function() {
+  if (this._responseCache) this._responseCache.clear();
+};
+
+
+Server.prototype.getResponseCacheStats = function() {
+  return this._responseCache ? this._responseCache.stats() : null;
+};
+
+// What clients that an overloaded server turns away get; see
+// net.Server#setOverload().
+Server.prototype._overloadResponse = 'HTTP/1.1 503 Service Unavailable\r\n' +
+                                     'Connection: close\r\n' +
+                                     'Content-Length: 0\r\n\r\n';
+
+
 exports.Server = Server;
 
 
-exports.createServer = function(requestListener) {
-  return new Server(requestListener);
+exports.createServer = function(options, requestListener) {
+  return new Server(options, requestListener);
 };
 
 
@@ -1364,6 +2273,13 @@ function connectionListener(socket) {
 
   var parser = parsers.alloc();
   parser.reinitialize(HTTPParser.REQUEST);
+  parser.setLazyHeaders(self.lazyHeaders === true);
+  parser.setBatchMode(true);
+  parser.setCollectBody(self.collectBodySize || 0);
+  parser.setMaxHeaderSize(self.maxHeaderSize || 0);
+  if (self._responseCache) {
+    parser.setResponseCache(self._responseCache, socket);
+  }
   parser.socket = socket;
   parser.incoming = null;
 
@@ -1419,6 +2335,7 @@ function connectionListener(socket) {
   socket.addListener('close', function() {
     debug('server socket close');
     // unref the parser for easy gc
+    if (self._responseCache) parser.setResponseCache(null);
     parsers.free(parser);
 
     abortIncoming();
@@ -1433,6 +2350,10 @@ function connectionListener(socket) {
     var res = new ServerResponse(req);
     debug('server response shouldKeepAlive: ' + shouldKeepAlive);
     res.shouldKeepAlive = shouldKeepAlive;
+    if (self._responseCache) {
+      res._responseCache = self._responseCache;
+      res._cacheRequest = req;
+    }
     DTRACE_HTTP_SERVER_REQUEST(req, socket);
 
     if (socket._httpMessage) {
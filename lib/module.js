@@ -23,6 +23,7 @@ var NativeModule = require('native_module');
 var Script = process.binding('evals').NodeScript;
 var runInThisContext = Script.runInThisContext;
 var runInNewContext = Script.runInNewContext;
+var runInThisContextCached = Script.runInThisContextCached;
 var assert = require('assert').ok;
 
 
@@ -49,6 +50,9 @@ module.exports = Module;
 // Set the environ variable NODE_MODULE_CONTEXTS=1 to make node load all
 // modules in thier own context.
 Module._contextLoad = (+process.env['NODE_MODULE_CONTEXTS'] > 0);
+// Set the environ variable NODE_CODE_CACHE to a directory to keep the parser
+// data of compiled modules there, so that later runs parse them faster.
+Module._codeCache = process.env['NODE_CODE_CACHE'] || null;
 Module._cache = {};
 Module._pathCache = {};
 Module._extensions = {};
@@ -83,12 +87,212 @@ var debug = Module._debug;
 //   -> a.<ext>
 //   -> a/index.<ext>
 
-function statPath(path) {
+// What stat() found for the paths looked at while resolving modules. Only
+// kept for the duration of a require() call: a file that a lookup didn't
+// find may be created later. Set to an empty object to reset it meanwhile.
+Module._statCache = null;
+
+// An application archive holds the files of an application in one file,
+// made with tools/archive.js. Set the environ variable NODE_ARCHIVE to its
+// path to mount it over the directory it lies in, or the one in
+// NODE_ARCHIVE_ROOT: modules below that directory are then looked up and
+// read in the archive only, which is mapped into memory once.
+//
+// The archive starts with "NODEARC1", then the length of its index as a 32
+// bit little endian number, then the index, which is JSON, then the contents
+// of the files. The index maps paths relative to the root, with forward
+// slashes, to [offset, length] into the contents for files, 1 for
+// directories and 0 for files left on disk, such as addons.
+Module._archive = null;
+
+var pathSep = process.platform === 'win32' ? '\\' : '/';
+
+function Archive(filename, root) {
+  var fs = NativeModule.require('fs');
+  var data;
+
+  if (fs.mmap) {
+    var fd = fs.openSync(filename, 'r');
+    try {
+      data = fs.mmap(fd, 0, undefined, 'random');
+    } finally {
+      fs.closeSync(fd);
+    }
+  } else {
+    data = fs.readFileSync(filename);
+  }
+  // Buffer methods are used on it below, which a bare mapping lacks.
+  if (!Buffer.isBuffer(data)) {
+    data = new Buffer(data, data.length, 0);
+  }
+
+  if (data.length < 12 || data.toString('ascii', 0, 8) !== 'NODEARC1') {
+    throw new Error(filename + ' is not an application archive');
+  }
+
+  var indexEnd = 12 + data.readUInt32LE(8);
+  this.filename = filename;
+  this.root = path.resolve(root);
+  this.entries = JSON.parse(data.toString('utf8', 12, indexEnd));
+  this.data = data;
+  this.base = indexEnd;
+}
+
+// Key of `filename` in the index, or null if it is outside the root.
+Archive.prototype.key = function(filename) {
+  if (filename === this.root) return '';
+
+  var prefix = this.root.charAt(this.root.length - 1) === pathSep ?
+      this.root : this.root + pathSep;
+  if (filename.slice(0, prefix.length) !== prefix) return null;
+
+  var key = filename.slice(prefix.length);
+  return pathSep === '/' ? key : key.split(pathSep).join('/');
+};
+
+// Same as statPath(), or undefined if the archive doesn't cover `filename`.
+Archive.prototype.stat = function(filename) {
+  var key = this.key(filename);
+  if (key === null) return undefined;
+  if (key === '') return 1;
+  if (!hasOwnProperty(this.entries, key)) return -1;
+
+  var entry = this.entries[key];
+  return typeof entry === 'number' ? entry : 0;
+};
+
+// The contents of `filename` as a string, or undefined if it is to be read
+// from disk.
+Archive.prototype.read = function(filename) {
+  var key = this.key(filename);
+  if (key === null) return undefined;
+
+  var entry = hasOwnProperty(this.entries, key) ? this.entries[key] : null;
+  if (entry === 0) return undefined;
+  if (!Array.isArray(entry)) {
+    var err = new Error('ENOENT, no such file in ' + this.filename + " '" +
+                        filename + "'");
+    err.code = 'ENOENT';
+    throw err;
+  }
+
+  var start = this.base + entry[0];
+  return this.data.toString('utf8', start, start + entry[1]);
+};
+
+Module._initArchive = function() {
+  var filename = process.env['NODE_ARCHIVE'];
+  if (!filename) return;
+
+  filename = path.resolve(filename);
+  var root = process.env['NODE_ARCHIVE_ROOT'] || path.dirname(filename);
+  Module._archive = new Archive(filename, root);
+};
+
+// Modules whose sources are being read ahead of require(), by filename: the
+// fs binding's Prefetch object reading them and the index of each in it.
+Module._prefetched = {};
+
+// Starts reading `filenames` in parallel on the thread pool, so that their
+// sources are in memory by the time require() gets to them. Names that
+// aren't modules are harmless: their contents are read and left unused.
+Module.prefetch = function(filenames) {
+  var binding = process.binding('fs');
+  if (!binding.Prefetch) return;
+
+  var archive = Module._archive;
+  filenames = filenames.filter(function(filename) {
+    return typeof filename === 'string' &&
+           !hasOwnProperty(Module._prefetched, filename) &&
+           !(archive && archive.key(filename) !== null);
+  });
+  if (filenames.length === 0) return;
+
+  var prefetch = new binding.Prefetch(filenames);
+  filenames.forEach(function(filename, i) {
+    Module._prefetched[filename] = [prefetch, i];
+  });
+};
+
+// Set the environ variable NODE_MODULE_MANIFEST to a file to prefetch the
+// modules listed in it at startup. The manifest is a JSON array of
+// filenames, and is written at exit with the modules that were read, if
+// they changed; it need not exist beforehand.
+Module._manifest = null;
+
+Module._initManifest = function() {
+  var filename = process.env['NODE_MODULE_MANIFEST'];
+  if (!filename) return;
+
   var fs = NativeModule.require('fs');
+  var manifest = Module._manifest = {
+    filename: path.resolve(filename),
+    listed: [],
+    loaded: []
+  };
+
   try {
-    return fs.statSync(path);
-  } catch (ex) {}
-  return false;
+    var listed = JSON.parse(fs.readFileSync(manifest.filename, 'utf8'));
+    if (Array.isArray(listed)) manifest.listed = listed;
+  } catch (e) {
+    debug('no module manifest in ' + manifest.filename);
+  }
+  Module.prefetch(manifest.listed);
+
+  // What startup didn't use is not worth keeping.
+  process.nextTick(function() {
+    manifest.listed.forEach(function(filename) {
+      delete Module._prefetched[filename];
+    });
+  });
+
+  process.on('exit', function() {
+    if (manifest.loaded.join('\n') === manifest.listed.join('\n')) return;
+    try {
+      fs.writeFileSync(manifest.filename, JSON.stringify(manifest.loaded));
+    } catch (e) {
+      debug('could not write the module manifest: ' + e.message);
+    }
+  });
+};
+
+// Reads the source of a module, from the archive if it holds it, or from
+// its prefetch if there is one.
+function readSource(filename) {
+  if (Module._manifest) Module._manifest.loaded.push(filename);
+
+  var content = Module._archive ? Module._archive.read(filename) : undefined;
+  if (content === undefined && hasOwnProperty(Module._prefetched, filename)) {
+    var prefetched = Module._prefetched[filename];
+    delete Module._prefetched[filename];
+    var buffer = prefetched[0].take(prefetched[1]);
+    if (buffer) content = buffer.toString('utf8');
+  }
+  if (content === undefined) {
+    content = NativeModule.require('fs').readFileSync(filename, 'utf8');
+  }
+  return content;
+}
+
+// Returns 0 for files, 1 for directories and -1 if `path` can't be stat'ed.
+function statPath(path) {
+  var cache = Module._statCache;
+  if (cache && hasOwnProperty(cache, path)) {
+    return cache[path];
+  }
+
+  var result = Module._archive ? Module._archive.stat(path) : undefined;
+  if (result === undefined) {
+    var fs = NativeModule.require('fs');
+    try {
+      result = fs.statSync(path).isDirectory() ? 1 : 0;
+    } catch (ex) {
+      result = -1;
+    }
+  }
+
+  if (cache) cache[path] = result;
+  return result;
 }
 
 // check if the directory is a package.json dir
@@ -99,10 +303,12 @@ function readPackage(requestPath) {
     return packageCache[requestPath];
   }
 
-  var fs = NativeModule.require('fs');
+  // Most directories have none; stat()ing is cheaper than failing to read.
+  var jsonPath = path.resolve(requestPath, 'package.json');
+  if (statPath(jsonPath) !== 0) return false;
+
   try {
-    var jsonPath = path.resolve(requestPath, 'package.json');
-    var json = fs.readFileSync(jsonPath, 'utf8');
+    var json = readSource(jsonPath);
   } catch (e) {
     return false;
   }
@@ -135,8 +341,11 @@ Module._realpathCache = {};
 // check if the file exists and is not a directory
 function tryFile(requestPath) {
   var fs = NativeModule.require('fs');
-  var stats = statPath(requestPath);
-  if (stats && !stats.isDirectory()) {
+  if (statPath(requestPath) === 0) {
+    // The archive holds no links.
+    if (Module._archive && Module._archive.key(requestPath) !== null) {
+      return requestPath;
+    }
     return fs.realpathSync(requestPath, Module._realpathCache);
   }
   return false;
@@ -155,8 +364,14 @@ function tryExtensions(p, exts) {
 }
 
 
+// Requests that _findPath() could not find, with the time it tried. They
+// count as missing for Module._missTimeout milliseconds, long enough for
+// loops that keep trying an optional module but not to hide one installed
+// meanwhile. Set to an empty object to reset.
+Module._missCache = {};
+Module._missTimeout = 1000;
+
 Module._findPath = function(request, paths) {
-  var fs = NativeModule.require('fs');
   var exts = Object.keys(Module._extensions);
 
   if (request.charAt(0) === '/') {
@@ -165,16 +380,27 @@ Module._findPath = function(request, paths) {
 
   var trailingSlash = (request.slice(-1) === '/');
 
-  var cacheKey = JSON.stringify({request: request, paths: paths});
+  var cacheKey = request + '\x00' + paths.join('\x00');
   if (Module._pathCache[cacheKey]) {
     return Module._pathCache[cacheKey];
   }
 
+  if (hasOwnProperty(Module._missCache, cacheKey)) {
+    if (Date.now() - Module._missCache[cacheKey] < Module._missTimeout) {
+      return false;
+    }
+    delete Module._missCache[cacheKey];
+  }
+
   // For each path
   for (var i = 0, PL = paths.length; i < PL; i++) {
     var basePath = path.resolve(paths[i], request);
     var filename;
 
+    // Whatever matches is in the directory of basePath, which for most
+    // node_modules folders looked in doesn't exist.
+    if (statPath(path.dirname(basePath)) !== 1) continue;
+
     if (!trailingSlash) {
       // try to join the request to the path
       filename = tryFile(basePath);
@@ -185,13 +411,14 @@ Module._findPath = function(request, paths) {
       }
     }
 
-    if (!filename) {
+    // The rest needs basePath to be a directory.
+    if (!filename && statPath(basePath) === 1) {
       filename = tryPackage(basePath, exts);
-    }
 
-    if (!filename) {
-      // try it with each of the extensions at "index"
-      filename = tryExtensions(path.resolve(basePath, 'index'), exts);
+      if (!filename) {
+        // try it with each of the extensions at "index"
+        filename = tryExtensions(path.resolve(basePath, 'index'), exts);
+      }
     }
 
     if (filename) {
@@ -199,6 +426,8 @@ Module._findPath = function(request, paths) {
       return filename;
     }
   }
+
+  Module._missCache[cacheKey] = Date.now();
   return false;
 };
 
@@ -353,8 +582,17 @@ Module.prototype.load = function(filename) {
 };
 
 
+// Number of require() calls in progress.
+var requireDepth = 0;
+
 Module.prototype.require = function(path) {
-  return Module._load(path, this);
+  // One cache for everything a require() loads, however deep.
+  if (requireDepth++ == 0) Module._statCache = {};
+  try {
+    return Module._load(path, this);
+  } finally {
+    if (--requireDepth == 0) Module._statCache = null;
+  }
 };
 
 
@@ -424,7 +662,9 @@ Module.prototype._compile = function(content, filename) {
   // create wrapper function
   var wrapper = Module.wrap(content);
 
-  var compiledWrapper = runInThisContext(wrapper, filename, true);
+  var compiledWrapper = Module._codeCache ?
+      runInThisContextCached(wrapper, filename, Module._codeCache) :
+      runInThisContext(wrapper, filename, true);
   if (filename === process.argv[1] && global.v8debug) {
     global.v8debug.Debug.setBreakPoint(compiledWrapper, 0, 0);
   }
@@ -446,14 +686,14 @@ function stripBOM(content) {
 
 // Native extension for .js
 Module._extensions['.js'] = function(module, filename) {
-  var content = NativeModule.require('fs').readFileSync(filename, 'utf8');
+  var content = readSource(filename);
   module._compile(stripBOM(content), filename);
 };
 
 
 // Native extension for .json
 Module._extensions['.json'] = function(module, filename) {
-  var content = NativeModule.require('fs').readFileSync(filename, 'utf8');
+  var content = readSource(filename);
   module.exports = JSON.parse(stripBOM(content));
 };
 
@@ -495,6 +735,8 @@ Module.requireRepl = function() {
 };
 
 Module._initPaths();
+Module._initArchive();
+Module._initManifest();
 
 // backwards compatibility
 Module.Module = Module;
@@ -21,7 +21,6 @@
 
 var events = require('events');
 var stream = require('stream');
-var timers = require('timers');
 var util = require('util');
 var assert = require('assert');
 
@@ -46,6 +45,13 @@ var FLAG_SHUTDOWN = 1 << 1;
 var FLAG_DESTROY_SOON = 1 << 2;
 var FLAG_SHUTDOWNQUED = 1 << 3;
 
+// Maximum number of buffers handed to a single handle.writev() call.
+var WRITEV_MAX_BUFFERS = 1024;
+
+// While a socket is corked, write() keeps returning true until this many
+// bytes are held back.
+var CORK_HIGH_WATER = 64 * 1024;
+
 
 var debug;
 if (process.env.NODE_DEBUG && /net/.test(process.env.NODE_DEBUG)) {
@@ -87,13 +93,68 @@ function initSocketHandle(self) {
   self.bytesRead = 0;
   self.bytesWritten = 0;
 
+  self._corked = 0;
+  self._corkedChunks = null;
+  self._corkedEncodings = null;
+  self._corkedCallbacks = null;
+  self._corkedLength = 0;
+
   // Handle creation may be deferred to bind() or connect() time.
+  if (self._handle) attachHandle(self);
+}
+
+
+// Points the callbacks of self._handle at the socket and applies the
+// socket's settings to it.
+function attachHandle(self) {
   if (self._handle) {
     self._handle.socket = self;
     self._handle.onread = onread;
+    self._handle.ontimeout = ontimeout;
+    self._handle.onwritedrain = onwritedrain;
+    if (self._idleTimeout > 0) self._handle.setIdleTimeout(self._idleTimeout);
+    if (self._writeHighWater > 0) {
+      self._handle.setWriteWatermarks(self._writeHighWater,
+                                      self._writeLowWater);
+    }
+    if (self._unref) self._handle.unref();
+  }
+}
+
+
+// Reads and writes reset the idle timeout in the handle itself. Everything
+// else that counts as activity, connecting and sendfile(), goes through
+// here.
+function active(self) {
+  if (self._idleTimeout > 0 && self._handle) {
+    self._handle.setIdleTimeout(self._idleTimeout);
   }
 }
 
+
+function ontimeout() {
+  var self = this.socket;
+  if (self) self._onTimeout();
+}
+
+
+// Called by the handle once its write queue is back at the low watermark.
+// afterWrite() emits 'drain' itself when the last write is done.
+function onwritedrain() {
+  var self = this.socket;
+  if (!self || self.destroyed || self._pendingWriteReqs == 0) return;
+  if (self.ondrain) self.ondrain();
+  self.emit('drain');
+}
+
+
+// What write() returns: whether the write queue is below the high
+// watermark, or empty if there are no watermarks.
+function writeReady(self) {
+  if (self._writeHighWater > 0) return !self._handle.writeBlocked;
+  return self._handle.writeQueueSize == 0;
+}
+
 function Socket(options) {
   if (!(this instanceof Socket)) return new Socket(options);
 
@@ -118,7 +179,12 @@ function Socket(options) {
     this._handle = options && options.handle;
     initSocketHandle(this);
     this.allowHalfOpen = options && options.allowHalfOpen;
+    this.fastOpen = options && options.fastOpen;
   }
+
+  this.setConnectTimeout(options && options.connectTimeout);
+  this._attemptDelay = options && options.attemptDelay >= 0 ?
+      options.attemptDelay : 250;
 }
 util.inherits(Socket, stream.Stream);
 
@@ -136,17 +202,26 @@ Socket.prototype.listen = function() {
 
 Socket.prototype.setTimeout = function(msecs, callback) {
   if (msecs > 0) {
-    timers.enroll(this, msecs);
-    timers.active(this);
+    this._idleTimeout = msecs;
+    active(this);
     if (callback) {
       this.once('timeout', callback);
     }
   } else if (msecs === 0) {
-    timers.unenroll(this);
+    this._idleTimeout = 0;
+    if (this._handle) this._handle.setIdleTimeout(0);
   }
 };
 
 
+// Makes every TCP connect attempt that follows fail with ETIMEDOUT if it
+// hasn't completed within `msecs` milliseconds. The timer runs in the
+// handle, and 0 turns it off.
+Socket.prototype.setConnectTimeout = function(msecs) {
+  this._connectTimeout = msecs > 0 ? msecs : 0;
+};
+
+
 Socket.prototype._onTimeout = function() {
   this.emit('timeout');
 };
@@ -169,6 +244,19 @@ Socket.prototype.address = function() {
 };
 
 
+// Lets the process exit while this socket is the only thing left open.
+Socket.prototype.unref = function() {
+  this._unref = true;
+  if (this._handle) this._handle.unref();
+};
+
+
+Socket.prototype.ref = function() {
+  this._unref = false;
+  if (this._handle) this._handle.ref();
+};
+
+
 Object.defineProperty(Socket.prototype, 'readyState', {
   get: function() {
     if (this._connecting) {
@@ -188,11 +276,27 @@ Object.defineProperty(Socket.prototype, 'readyState', {
 
 Object.defineProperty(Socket.prototype, 'bufferSize', {
   get: function() {
-    return this._handle.writeQueueSize + this._connectQueueSize;
+    var queued = this._writeHighWater > 0 ?
+                 this._handle.getWriteQueueSize() :
+                 this._handle.writeQueueSize;
+    return queued + this._connectQueueSize + this._corkedLength;
   }
 });
 
 
+// The write queue is checked natively: write() returns false once `high`
+// bytes are queued, and 'drain' is emitted as soon as no more than `low`
+// are, rather than only once everything is written. 0 turns this off.
+Socket.prototype.setWriteWatermarks = function(high, low) {
+  this._writeHighWater = high > 0 ? high : 0;
+  this._writeLowWater = low > 0 ? low : 0;
+  if (this._handle) {
+    this._handle.setWriteWatermarks(this._writeHighWater,
+                                    this._writeLowWater);
+  }
+};
+
+
 Socket.prototype.pause = function() {
   this._handle.readStop();
 };
@@ -219,6 +323,11 @@ Socket.prototype.end = function(data, encoding) {
   if (data) this.write(data, encoding);
   DTRACE_NET_STREAM_END(this);
 
+  // The FIN has to go out after anything that is still corked.
+  this._corked = 0;
+  this._flushCorked();
+  if (!this._handle) return false;
+
   if (!this.readable) {
     this.destroySoon();
   } else {
@@ -259,6 +368,9 @@ Socket.prototype.destroySoon = function() {
   this.writable = false;
   this._flags |= FLAG_DESTROY_SOON;
 
+  this._corked = 0;
+  this._flushCorked();
+
   if (this._pendingWriteReqs == 0) {
     this.destroy();
   }
@@ -279,17 +391,35 @@ Socket.prototype.destroy = function(exception) {
 
   debug('destroy');
 
-  this.readable = this.writable = false;
+  // Give corked writes the same chance to reach the kernel as writes that
+  // were issued before destroy() and went out immediately.
+  this._corked = 0;
+  if (exception) {
+    this._corkedChunks = this._corkedEncodings = this._corkedCallbacks = null;
+    this._corkedLength = 0;
+  } else {
+    this._flushCorked();
+  }
 
-  timers.unenroll(this);
+  this.readable = this.writable = false;
 
   if (this.server && !this.destroyed) {
     this.server.connections--;
     this.server._emitCloseIfDrained();
   }
 
+  if (this._connectRace) {
+    var race = this._connectRace;
+    this._connectRace = null;
+    clearTimeout(race.timer);
+    race.handles.forEach(function(handle) {
+      if (handle !== self._handle) handle.close();
+    });
+  }
+
   debug('close');
   if (this._handle) {
+    this._handle.setIdleTimeout(0);
     this._handle.close();
     this._handle.onread = noop;
     this._handle = null;
@@ -309,8 +439,6 @@ function onread(buffer, offset, length) {
   var self = handle.socket;
   assert.equal(handle, self._handle);
 
-  timers.active(self);
-
   var end = offset + length;
 
   if (buffer) {
@@ -358,6 +486,43 @@ function onread(buffer, offset, length) {
 }
 
 
+// A socket piped into another socket hands the copying to the native
+// layer: the data never reaches javascript and no 'data' events are
+// emitted. Anything that wants to see the data, a 'data' listener,
+// setEncoding() or ondata, keeps the data going through javascript, as does
+// options.native === false.
+Socket.prototype.pipe = function(dest, options) {
+  var self = this;
+  var native = dest instanceof Socket &&
+               self._handle && self._handle.pipeTo &&
+               dest._handle && dest._handle.pipeTo &&
+               !self._connecting && !dest._connecting &&
+               !self._decoder && !self.ondata &&
+               !(self._events && self._events['data']) &&
+               !(options && options.native === false);
+
+  stream.Stream.prototype.pipe.call(self, dest, options);
+
+  if (native && self._handle.pipeTo(dest._handle) === 0) {
+    self._handle.onpipeend = function(bytes, onWrite) {
+      self.bytesRead += bytes;
+      dest.bytesWritten += bytes;
+
+      if (onWrite) {
+        // The source stays paused.
+        if (!dest.destroyed) dest.destroy(errnoException(errno, 'write'));
+        return;
+      }
+
+      // EOF or a read error, taken as onread would have.
+      onread.call(self._handle, null, 0, 0);
+    };
+  }
+
+  return dest;
+};
+
+
 Socket.prototype.setEncoding = function(encoding) {
   var StringDecoder = require('string_decoder').StringDecoder; // lazy load
   this._decoder = new StringDecoder(encoding);
@@ -403,33 +568,266 @@ Socket.prototype.write = function(data, arg1, arg2) {
     }
   }
 
-  // Change strings to buffers. SLOW
+  var length;
+
   if (typeof data == 'string') {
-    data = new Buffer(data, encoding);
+    // ASCII and UTF-8 strings are handed to the handle as they are, anything
+    // else is changed to a buffer. SLOW
+    encoding = (encoding || 'utf8').toLowerCase();
+    if (encoding == 'utf-8') encoding = 'utf8';
+
+    if (this._handle && this._handle.writeUtf8String &&
+        (encoding == 'utf8' || encoding == 'ascii')) {
+      length = encoding == 'ascii' ? data.length :
+                                     Buffer.byteLength(data, 'utf8');
+    } else {
+      data = new Buffer(data, encoding);
+      encoding = null;
+    }
   }
 
-  this.bytesWritten += data.length;
+  if (length === undefined) length = data.length;
+
+  this.bytesWritten += length;
 
   // If we are still connecting, then buffer this for later.
   if (this._connecting) {
-    this._connectQueueSize += data.length;
+    this._connectQueueSize += length;
     if (this._connectQueue) {
-      this._connectQueue.push([data, encoding, cb]);
+      this._connectQueue.push([data, encoding, cb, false, length]);
     } else {
-      this._connectQueue = [[data, encoding, cb]];
+      this._connectQueue = [[data, encoding, cb, false, length]];
+    }
+    return false;
+  }
+
+  return this._write(data, encoding, cb, length);
+};
+
+
+/*
+ * While corked, writes are held back in user memory and sent with a single
+ * write request (one writev syscall) once the socket is uncorked. TCP sockets
+ * cork themselves automatically until the end of the current tick, so that
+ * e.g. an HTTP response's header, body and last chunk leave as one segment.
+ */
+Socket.prototype.cork = function() {
+  this._corked++;
+};
+
+
+Socket.prototype.uncork = function() {
+  if (this._corked > 0 && --this._corked == 0) {
+    this._flushCorked();
+  }
+};
+
+
+Socket.prototype._flushCorked = function() {
+  var chunks = this._corkedChunks;
+  if (!chunks) return true;
+
+  var encodings = this._corkedEncodings;
+  var callbacks = this._corkedCallbacks;
+  this._corkedChunks = this._corkedEncodings = this._corkedCallbacks = null;
+  this._corkedLength = 0;
+
+  // destroy() may have come first.
+  if (!this._handle) return false;
+
+  var cb;
+  if (callbacks.length == 1) {
+    cb = callbacks[0];
+  } else if (callbacks.length > 1) {
+    cb = function() {
+      for (var i = 0; i < callbacks.length; i++) callbacks[i]();
+    };
+  }
+
+  if (chunks.length == 1) {
+    return this._writeHandle(chunks[0], encodings[0], cb);
+  }
+
+  for (var i = 0; i < chunks.length; i++) {
+    if (typeof chunks[i] == 'string') {
+      chunks[i] = new Buffer(chunks[i], encodings[i]);
+    }
+  }
+
+  return this._writeBuffers(chunks, cb);
+};
+
+
+// Sends `length` bytes of the file `fd` from `position` on straight to the
+// kernel with sendfile(2), callback(err, bytesSent). Writes queued on the
+// socket go out first; writes made meanwhile are held back until the file
+// data is out. Returns false, without calling `cb`, if the handle can't do
+// this.
+Socket.prototype._sendfile = function(fd, position, length, cb) {
+  var self = this;
+
+  if (!this._handle || !this._handle.fileno || this._connecting) {
+    return false;
+  }
+
+  if (this._pendingWriteReqs > 0 || this._corkedChunks) {
+    this.once('drain', function() {
+      if (!self._sendfile(fd, position, length, cb)) {
+        cb(new Error('Socket can not sendfile'));
+      }
+    });
+    return true;
+  }
+
+  if (!this.writable) {
+    process.nextTick(function() {
+      cb(new Error('Socket is not writable'));
+    });
+    return true;
+  }
+
+  active(this);
+  this.cork();
+
+  require('fs').sendfile(this._handle.fileno(), fd, position, length,
+                         function(err, bytesSent) {
+    if (!err) {
+      self.bytesWritten += bytesSent;
+      active(self);
+    }
+    self.uncork();
+    cb(err, bytesSent);
+  });
+
+  return true;
+};
+
+
+// `data` is a buffer, or a string if `encoding` is 'ascii' or 'utf8'.
+// `length` is its size in bytes.
+Socket.prototype._write = function(data, encoding, cb, length) {
+  // Only TCP handles (recognizable by setNoDelay) cork automatically. Pipes
+  // and TTYs carry stdio, which must not lag behind a process.exit() that
+  // follows a write.
+  if (this._corked == 0 && this._handle.setNoDelay) {
+    var self = this;
+    this._corked++;
+    process.nextTick(function() {
+      self.uncork();
+    });
+  }
+
+  if (this._corked > 0) {
+    if (!this._corkedChunks) {
+      this._corkedChunks = [];
+      this._corkedEncodings = [];
+      this._corkedCallbacks = [];
+    }
+    this._corkedChunks.push(data);
+    this._corkedEncodings.push(encoding);
+    if (cb) this._corkedCallbacks.push(cb);
+    this._corkedLength += length === undefined ? data.length : length;
+    if (this._writeHighWater > 0) {
+      return this._corkedLength < this._writeHighWater &&
+             !this._handle.writeBlocked;
+    }
+    return this._corkedLength < CORK_HIGH_WATER;
+  }
+
+  return this._writeHandle(data, encoding, cb);
+};
+
+
+Socket.prototype._writeHandle = function(data, encoding, cb) {
+  var handle = this._handle;
+  var writeReq;
+
+  if (this._pendingWriteReqs == 0 && handle.tryWrite) {
+    // Nothing in flight, so the kernel may take the data right away. Only
+    // what remains of it ends up in a write request.
+    writeReq = handle.tryWrite(data, encoding);
+  } else if (typeof data != 'string') {
+    writeReq = handle.write(data);
+  } else if (encoding == 'ascii') {
+    writeReq = handle.writeAsciiString(data);
+  } else {
+    writeReq = handle.writeUtf8String(data);
+  }
+
+  if (!writeReq) {
+    this.destroy(errnoException(errno, 'write'));
+    return false;
+  }
+
+  if (writeReq === true) {
+    // Written synchronously, complete it like any other write.
+    this._pendingWriteReqs++;
+    process.nextTick(function() {
+      afterWrite(0, handle, { cb: cb });
+    });
+    return true;
+  }
+
+  writeReq.oncomplete = afterWrite;
+  writeReq.cb = cb;
+  this._pendingWriteReqs++;
+
+  return writeReady(this);
+};
+
+
+/*
+ * Writes several chunks with a single write request. `chunks` is an array of
+ * strings and/or buffers, `encodings` an optional array with the encoding of
+ * each string chunk. Handles that support it send all chunks with one
+ * writev() syscall.
+ */
+Socket.prototype._writev = function(chunks, encodings, cb) {
+  var buffers = new Array(chunks.length);
+
+  for (var i = 0; i < chunks.length; i++) {
+    var data = chunks[i];
+    if (typeof data == 'string') {
+      data = new Buffer(data, encodings && encodings[i]);
+    }
+    this.bytesWritten += data.length;
+    buffers[i] = data;
+  }
+
+  if (this._connecting) {
+    for (var i = 0; i < buffers.length; i++) {
+      this._connectQueueSize += buffers[i].length;
     }
+    if (!this._connectQueue) this._connectQueue = [];
+    this._connectQueue.push([buffers, null, cb, true]);
     return false;
   }
 
-  return this._write(data, encoding, cb);
+  return this._writeChunks(buffers, cb);
 };
 
 
-Socket.prototype._write = function(data, encoding, cb) {
-  timers.active(this);
+/*
+ * Writes the buffer `data` framed as one chunk of HTTP chunked
+ * transfer-encoding. Unless the chunk has to queue up behind corked or
+ * pending-connect writes, the handle adds the length line and trailing CRLF
+ * around `data` itself and sends all three with one writev() syscall.
+ */
+Socket.prototype._writeChunk = function(data, cb) {
+  var handle = this._handle;
+
+  if (this._connecting || this._corked > 0 || !handle.writeChunk) {
+    return this._writev([data.length.toString(16) + '\r\n', data, '\r\n'],
+                        ['ascii', null, 'ascii'],
+                        cb);
+  }
+
+  // Hex digits of the length plus two CRLFs.
+  var framing = 4;
+  for (var n = data.length; n > 0; n = Math.floor(n / 16)) framing++;
+  this.bytesWritten += data.length + framing;
 
-  // `encoding` is unused right now, `data` is always a buffer.
-  var writeReq = this._handle.write(data);
+  var writeReq = handle.writeChunk(data);
 
   if (!writeReq) {
     this.destroy(errnoException(errno, 'write'));
@@ -440,7 +838,56 @@ Socket.prototype._write = function(data, encoding, cb) {
   writeReq.cb = cb;
   this._pendingWriteReqs++;
 
-  return this._handle.writeQueueSize == 0;
+  return writeReady(this);
+};
+
+
+// Sends `buffers` as one write request unless they have to join the corked
+// writes, which would otherwise be overtaken.
+Socket.prototype._writeChunks = function(buffers, cb) {
+  if (this._corked == 0 && !this._handle.setNoDelay) {
+    return this._writeBuffers(buffers, cb);
+  }
+
+  var ret;
+  for (var i = 0; i < buffers.length; i++) {
+    ret = this._write(buffers[i], null,
+                      i == buffers.length - 1 ? cb : undefined);
+  }
+  return ret;
+};
+
+
+Socket.prototype._writeBuffers = function(buffers, cb) {
+  var ret, i;
+
+  if (buffers.length == 1 || !this._handle.writev) {
+    for (i = 0; i < buffers.length; i++) {
+      ret = this._writeHandle(buffers[i], null,
+                              i == buffers.length - 1 ? cb : undefined);
+      if (!this._handle) return false;
+    }
+    return ret;
+  }
+
+  for (i = 0; i < buffers.length; i += WRITEV_MAX_BUFFERS) {
+    var last = i + WRITEV_MAX_BUFFERS >= buffers.length;
+    var batch = (i == 0 && last) ? buffers :
+                buffers.slice(i, i + WRITEV_MAX_BUFFERS);
+
+    var writeReq = this._handle.writev(batch);
+
+    if (!writeReq) {
+      this.destroy(errnoException(errno, 'write'));
+      return false;
+    }
+
+    writeReq.oncomplete = afterWrite;
+    writeReq.cb = last ? cb : undefined;
+    this._pendingWriteReqs++;
+  }
+
+  return writeReady(this);
 };
 
 
@@ -453,8 +900,6 @@ function afterWrite(status, handle, req, buffer) {
   }
   // TODO check status.
 
-  timers.active(this);
-
   self._pendingWriteReqs--;
 
   if (self._pendingWriteReqs == 0) {
@@ -482,11 +927,16 @@ function connect(self, address, port, addressType) {
 
   assert.ok(self._connecting);
 
+  // Best effort, the connection works just as well without it.
+  if (self.fastOpen && self._handle.setFastOpen) {
+    self._handle.setFastOpen(1);
+  }
+
   var connectReq;
   if (addressType == 6) {
-    connectReq = self._handle.connect6(address, port);
+    connectReq = self._handle.connect6(address, port, self._connectTimeout);
   } else if (addressType == 4) {
-    connectReq = self._handle.connect(address, port);
+    connectReq = self._handle.connect(address, port, self._connectTimeout);
   } else {
     connectReq = self._handle.connect(address, afterConnect);
   }
@@ -519,7 +969,7 @@ Socket.prototype.connect = function(port /* [host], [cb] */) {
     }
   }
 
-  timers.active(this);
+  active(this);
 
   self._connecting = true;
   self.writable = true;
@@ -527,6 +977,9 @@ Socket.prototype.connect = function(port /* [host], [cb] */) {
   if (pipe) {
     connect(self, /*pipe_name=*/port);
 
+  } else if (Array.isArray(host)) {
+    connectRace(self, host, port);
+
   } else if (typeof host == 'string') {
     debug('connect: find host ' + host);
     require('dns').lookup(host, function(err, ip, addressType) {
@@ -544,7 +997,7 @@ Socket.prototype.connect = function(port /* [host], [cb] */) {
           self.emit('error', err);
         });
       } else {
-        timers.active(self);
+        active(self);
 
         addressType = addressType || 4;
 
@@ -564,6 +1017,105 @@ Socket.prototype.connect = function(port /* [host], [cb] */) {
 };
 
 
+// Connects to the first of `addresses` that accepts. The next attempt
+// starts, on a handle of its own, once the one before it has been pending
+// for self._attemptDelay milliseconds or has failed. The socket takes over
+// the handle of the first attempt to succeed and closes the others.
+function connectRace(self, addresses, port) {
+  addresses.forEach(function(address) {
+    if (!exports.isIP(address)) {
+      throw new Error('connect: ' + address + ' is not an IP address');
+    }
+  });
+
+  if (addresses.length == 0) {
+    throw new Error('connect: no addresses');
+  }
+
+  var race = self._connectRace = { handles: [], timer: null };
+  var next = 0;
+  var failures = 0;
+
+  self.remotePort = port;
+
+  function start() {
+    race.timer = null;
+    if (self._connectRace !== race) return;
+
+    var address = addresses[next];
+    var handle = next == 0 ? self._handle : createTCP();
+    next++;
+
+    if (self._unref) handle.unref();
+    race.handles.push(handle);
+
+    var req;
+    if (exports.isIPv6(address)) {
+      req = handle.connect6(address, port, self._connectTimeout);
+    } else {
+      req = handle.connect(address, port, self._connectTimeout);
+    }
+
+    if (req === null) {
+      onfailure(handle, errnoException(errno, 'connect'));
+      return;
+    }
+
+    req.address = address;
+    req.oncomplete = oncomplete;
+
+    if (next < addresses.length) {
+      race.timer = setTimeout(start, self._attemptDelay);
+    }
+  }
+
+  function onfailure(handle, err) {
+    // The socket's own handle is closed by destroy() or once another wins.
+    if (handle !== self._handle) {
+      race.handles.splice(race.handles.indexOf(handle), 1);
+      handle.close();
+    }
+
+    if (++failures == addresses.length) {
+      self._connectRace = null;
+      self._connectQueueCleanUp();
+      self.destroy(err);
+    } else if (next < addresses.length) {
+      clearTimeout(race.timer);
+      start();
+    }
+  }
+
+  function oncomplete(status, handle, req) {
+    if (self._connectRace !== race) return;
+
+    if (status != 0) {
+      onfailure(handle, errnoException(errno, 'connect'));
+      return;
+    }
+
+    clearTimeout(race.timer);
+    self._connectRace = null;
+
+    if (handle !== self._handle) {
+      self._handle.setIdleTimeout(0);
+      self._handle.onread = noop;
+      self._handle = handle;
+      attachHandle(self);
+    }
+
+    race.handles.forEach(function(other) {
+      if (other !== handle) other.close();
+    });
+
+    self.remoteAddress = req.address;
+    afterConnect(0, handle, req);
+  }
+
+  start();
+}
+
+
 function afterConnect(status, handle, req) {
   var self = handle.socket;
 
@@ -581,7 +1133,7 @@ function afterConnect(status, handle, req) {
 
   if (status == 0) {
     self.readable = self.writable = true;
-    timers.active(self);
+    active(self);
 
     handle.readStart();
 
@@ -590,7 +1142,13 @@ function afterConnect(status, handle, req) {
     if (self._connectQueue) {
       debug('Drain the connect queue');
       for (var i = 0; i < self._connectQueue.length; i++) {
-        self._write.apply(self, self._connectQueue[i]);
+        var args = self._connectQueue[i];
+        if (args[3]) {
+          // Queued by _writev().
+          self._writeChunks(args[0], args[2]);
+        } else {
+          self._write(args[0], args[1], args[2], args[4]);
+        }
       }
       self._connectQueueCleanUp();
     }
@@ -641,6 +1199,13 @@ function Server(/* [ options, ] listener */) {
 
   this.connections = 0;
   this.allowHalfOpen = options.allowHalfOpen || false;
+  this.acceptBatchSize = options.acceptBatchSize || 1;
+  this.reusePort = options.reusePort || false;
+  this.deferAccept = options.deferAccept || 0;
+  this.fastOpen = options.fastOpen || false;
+  this.backlog = options.backlog || 0;
+  this.pendingAccepts = options.pendingAccepts || 0;
+  this.overload = options.overload || null;
 
   this._handle = null;
 }
@@ -652,7 +1217,7 @@ function toPort(x) { return (x = Number(x)) >= 0 ? x : false; }
 
 
 var createServerHandle = exports._createServerHandle =
-    function(address, port, addressType) {
+    function(address, port, addressType, reusePort) {
   var r = 0;
   // assign handle in listen, and clean up if bind or listen fails
   var handle =
@@ -661,9 +1226,9 @@ var createServerHandle = exports._createServerHandle =
   if (address || port) {
     debug('bind to ' + address);
     if (addressType == 6) {
-      r = handle.bind6(address, port);
+      r = handle.bind6(address, port, reusePort);
     } else {
-      r = handle.bind(address, port);
+      r = handle.bind(address, port, reusePort);
     }
   }
 
@@ -683,7 +1248,8 @@ Server.prototype._listen2 = function(address, port, addressType) {
   // If there is not yet a handle, we need to create one and bind.
   // In the case of a server sent via IPC, we don't need to do this.
   if (!self._handle) {
-    self._handle = createServerHandle(address, port, addressType);
+    self._handle = createServerHandle(address, port, addressType,
+                                      self.reusePort);
     if (!self._handle) {
       process.nextTick(function() {
         self.emit('error', errnoException(errno, 'listen'));
@@ -694,8 +1260,22 @@ Server.prototype._listen2 = function(address, port, addressType) {
 
   self._handle.onconnection = onconnection;
   self._handle.socket = self;
+  if (self._unref) self._handle.unref();
+
+  if (self.acceptBatchSize > 1 && self._handle.setAcceptBatchSize) {
+    self._handle.onconnectionbatch = onconnectionbatch;
+    self._handle.setAcceptBatchSize(self.acceptBatchSize);
+  }
 
-  r = self._handle.listen(self._backlog || 128);
+  // Only takes effect before listen(); servers received over IPC listen
+  // already and keep what they have.
+  if (self.pendingAccepts && self._handle.setPendingAccepts) {
+    self._handle.setPendingAccepts(0, self.pendingAccepts);
+  }
+
+  if (self.overload) applyOverload(self);
+
+  r = self._handle.listen(self.backlog || 128);
 
   if (r) {
     self._handle.close();
@@ -706,6 +1286,15 @@ Server.prototype._listen2 = function(address, port, addressType) {
     return;
   }
 
+  // Both are optimizations only, unsupported platforms simply go without.
+  if (self.deferAccept && self._handle.setDeferAccept) {
+    self._handle.setDeferAccept(self.deferAccept);
+  }
+  if (self.fastOpen && self._handle.setFastOpen) {
+    self._handle.setFastOpen(self.fastOpen === true ?
+                             self.backlog || 128 : self.fastOpen);
+  }
+
   process.nextTick(function() {
     self.emit('listening');
   });
@@ -714,7 +1303,8 @@ Server.prototype._listen2 = function(address, port, addressType) {
 
 function listen(self, address, port, addressType) {
   if (process.env.NODE_WORKER_ID) {
-    require('cluster')._getServer(address, port, addressType, function(handle) {
+    require('cluster')._getServer(self, address, port, addressType,
+                                  function(handle) {
       self._handle = handle;
       self._listen2(address, port, addressType);
     });
@@ -768,6 +1358,60 @@ Server.prototype.listen = function() {
   return self;
 };
 
+// What a server turned away while overloaded is sent before it is closed.
+Server.prototype._overloadResponse = null;
+
+
+function applyOverload(self) {
+  if (!self._handle.setOverload) return;
+
+  var o = self.overload || {};
+  var maxLag = o.maxLag || 0;
+  var resumeLag = o.resumeLag === undefined ? maxLag / 2 : o.resumeLag;
+  var response = o.response === undefined ? self._overloadResponse
+                                           : o.response;
+  if (typeof response === 'string') response = new Buffer(response);
+
+  self._handle.onoverload = function(overloaded, rejected) {
+    self.overloaded = overloaded;
+    self.emit('overload', overloaded, rejected);
+  };
+  self._handle.setOverload(maxLag, resumeLag, o.maxRequests || 0,
+                           response || undefined);
+}
+
+
+Server.prototype.setOverload = function(options) {
+  this.overload = options || null;
+  if (this._handle) applyOverload(this);
+};
+
+
+Server.prototype.overloaded = false;
+
+
+Server.prototype.unref = function() {
+  this._unref = true;
+  if (this._handle) this._handle.unref();
+};
+
+
+Server.prototype.ref = function() {
+  this._unref = false;
+  if (this._handle) this._handle.ref();
+};
+
+
+// The state of the accept queue, see TCPWrap::GetListenQueue(). null where
+// the platform or the handle can't tell.
+Server.prototype.listenQueue = function() {
+  if (this._handle && this._handle.getListenQueue) {
+    return this._handle.getListenQueue();
+  }
+  return null;
+};
+
+
 Server.prototype.address = function() {
   if (this._handle && this._handle.getsockname) {
     return this._handle.getsockname();
@@ -778,6 +1422,13 @@ Server.prototype.address = function() {
   }
 };
 
+function onconnectionbatch(clientHandles) {
+  for (var i = 0; i < clientHandles.length; i++) {
+    onconnection.call(this, clientHandles[i]);
+  }
+}
+
+
 function onconnection(clientHandle) {
   var handle = this;
   var self = handle.socket;
@@ -869,3 +1520,8 @@ exports.isIPv4 = function(input) {
 exports.isIPv6 = function(input) {
   return exports.isIP(input) === 6;
 };
+
+
+exports.setSlabCompaction = function(threshold) {
+  process.binding('tcp_wrap').setSlabCompaction(threshold);
+};
@@ -0,0 +1,113 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var binding = process.binding('numeric');
+
+
+// Each function takes a Float64Array, Float32Array, Int32Array or
+// Uint32Array and runs natively over its memory. With a callback the work
+// goes to the thread pool, in chunks that run in parallel for large arrays,
+// and the callback gets (err, result); without one the result is returned.
+
+exports.sum = function(array, callback) {
+  return binding.sum(array, callback);
+};
+
+
+exports.min = function(array, callback) {
+  return binding.min(array, callback);
+};
+
+
+exports.max = function(array, callback) {
+  return binding.max(array, callback);
+};
+
+
+exports.dot = function(a, b, callback) {
+  return binding.dot(a, b, callback);
+};
+
+
+// Sets every element x of `array` to x * factor + offset, in place, and
+// returns `array`.
+exports.scale = function(array, factor, offset, callback) {
+  if (typeof offset === 'function') {
+    callback = offset;
+    offset = 0;
+  }
+  if (offset === undefined) offset = 0;
+  return binding.scale(array, factor, offset, callback);
+};
+
+
+// Counts the elements of `array` in `bins` bins of equal width between
+// `options.min` and `options.max`, which default to those of the array.
+exports.histogram = function(array, options, callback) {
+  if (typeof options === 'number') options = { bins: options };
+  var bins = options.bins;
+  var min = options.min;
+  var max = options.max;
+
+  if (bins !== (bins >>> 0) || bins === 0) {
+    throw new TypeError('Bins must be a positive integer');
+  }
+
+  if (typeof callback !== 'function') {
+    if (min === undefined) min = binding.min(array);
+    if (max === undefined) max = binding.max(array);
+    return binding.histogram(array, bins, min, rangeEnd(min, max));
+  }
+
+  findRange(function() {
+    // Such as an empty array, which has no range.
+    try {
+      binding.histogram(array, bins, min, rangeEnd(min, max), callback);
+    } catch (err) {
+      process.nextTick(function() {
+        callback(err);
+      });
+    }
+  });
+
+  function findRange(cb) {
+    if (min === undefined) {
+      return binding.min(array, function(err, value) {
+        min = value;
+        findRange(cb);
+      });
+    }
+    if (max === undefined) {
+      return binding.max(array, function(err, value) {
+        max = value;
+        findRange(cb);
+      });
+    }
+    cb();
+  }
+};
+
+
+// An array of one value still needs a range to count it in.
+function rangeEnd(min, max) {
+  return max > min ? max : min + 1;
+}
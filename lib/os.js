@@ -27,6 +27,7 @@ exports.uptime = binding.getUptime;
 exports.freemem = binding.getFreeMem;
 exports.totalmem = binding.getTotalMem;
 exports.cpus = binding.getCPUs;
+exports.cpuTimes = binding.getCPUTimes;
 exports.type = binding.getOSType;
 exports.release = binding.getOSRelease;
 exports.networkInterfaces = binding.getInterfaceAddresses;
@@ -0,0 +1,94 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var binding = process.binding('profiler');
+
+// Titles of the profiles being recorded.
+var running = {};
+
+
+// Starts recording a CPU profile under `title`. Starting a title that is
+// being recorded already does nothing.
+exports.start = function(title) {
+  title = title === undefined ? '' : String(title);
+  if (running[title]) return;
+  running[title] = true;
+  binding.startProfiling(title);
+};
+
+
+// Stops recording `title` and returns the profile as a JSON string, or
+// null when it was not being recorded.
+exports.stop = function(title) {
+  title = title === undefined ? '' : String(title);
+  if (!running[title]) return null;
+  delete running[title];
+  return binding.stopProfiling(title);
+};
+
+
+// Records a profile for `duration` ms and calls back with its JSON.
+exports.record = function(duration, callback) {
+  var title = 'record-' + Date.now() + '-' + Math.random();
+  exports.start(title);
+  setTimeout(function() {
+    callback(null, exports.stop(title));
+  }, duration);
+};
+
+
+// Writes a heap snapshot to `path`, or to `path` itself when it is an fd.
+// The snapshot is streamed to the file as V8 serializes it.
+exports.writeHeapSnapshot = function(path, title) {
+  title = title === undefined ? '' : String(title);
+  if (typeof path === 'number') {
+    binding.writeHeapSnapshot(path, title);
+    return;
+  }
+  var fs = require('fs');
+  var fd = fs.openSync(path, 'w', 0644);
+  try {
+    binding.writeHeapSnapshot(fd, title);
+  } finally {
+    fs.closeSync(fd);
+  }
+};
+
+
+var onSignal = null;
+
+// Makes SIGUSR2 write a heap snapshot into `dir`, the working directory by
+// default. Passing false stops it.
+exports.snapshotOnSignal = function(dir) {
+  if (onSignal) {
+    process.removeListener('SIGUSR2', onSignal);
+    onSignal = null;
+  }
+  if (dir === false) return;
+  dir = dir || process.cwd();
+  onSignal = function() {
+    var path = require('path').join(dir,
+        'heap-' + process.pid + '-' + Date.now() + '.heapsnapshot');
+    exports.writeHeapSnapshot(path);
+  };
+  process.on('SIGUSR2', onSignal);
+};
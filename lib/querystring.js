@@ -22,7 +22,9 @@
 // Query String Utilities
 
 var QueryString = exports;
-var urlDecode = process.binding('http_parser').urlDecode;
+var binding = process.binding('http_parser');
+var urlDecode = binding.urlDecode;
+var parseQueryString = binding.parseQueryString;
 
 
 // If obj.hasOwnProperty has been overridden, then calling
@@ -105,9 +107,11 @@ QueryString.unescapeBuffer = function(s, decodeSpaces) {
 };
 
 
-QueryString.unescape = function(s, decodeSpaces) {
+function unescape(s, decodeSpaces) {
+  if (typeof s === 'string') return urlDecode(s, decodeSpaces);
   return QueryString.unescapeBuffer(s, decodeSpaces).toString();
-};
+}
+QueryString.unescape = unescape;
 
 
 QueryString.escape = function(str) {
@@ -169,6 +173,13 @@ QueryString.parse = QueryString.decode = function(qs, sep, eq) {
     return obj;
   }
 
+  // Decode natively in one pass unless a custom separator or unescape
+  // function needs the generic version below.
+  if (typeof sep === 'string' && typeof eq === 'string' &&
+      QueryString.unescape === unescape) {
+    return parseQueryString(qs, sep, eq);
+  }
+
   qs.split(sep).forEach(function(kvp) {
     var x = kvp.split(eq);
     var k = QueryString.unescape(x[0], true);
@@ -20,7 +20,7 @@
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 var Timer = process.binding('timer_wrap').Timer;
-var L = require('_linklist');
+var TimerWheel = process.binding('timer_wheel').TimerWheel;
 var assert = require('assert').ok;
 
 var debug;
@@ -33,80 +33,90 @@ if (process.env.NODE_DEBUG && /timer/.test(process.env.NODE_DEBUG)) {
 
 // IDLE TIMEOUTS
 //
-// Because often many sockets will have the same idle timeout we will not
-// use one timeout watcher per item. It is too much overhead.  Instead
-// we'll use a single watcher for all sockets with the same timeout value
-// and a linked list. This technique is described in the libev manual:
+// Idle timeouts are jittered, so grouping them by duration behind one
+// watcher per list still meant a watcher for nearly every socket. Instead
+// all of them, setTimeout() included, share a single native timing wheel
+// (src/timer_wheel.cc) that adds and removes in constant time and runs one
+// uv timer between them.
+//
+// Activity does not touch the wheel. active() only moves _idleStart, and
+// when the original entry comes due the item is added again for whatever
+// is left of its timeout. This is the lazy rescheduling described in the
+// libev manual:
 // http://pod.tst.eu/http://cvs.schmorp.de/libev/ev.pod#Be_smart_about_timeouts
+//
+// With a timer slack set (process.setTimerSlack(), --timer-slack) the
+// wheel and Timer handles move expiries up to the next slack boundary, so
+// that timeouts due around the same time run in one batch. Items with
+// _precise set are exempt.
 
-// Object containing all lists, timers
-// key = time in milliseconds
-// value = list
-var lists = {};
+var wheel = null;
 
+// key = wheel id, value = item
+var items = [];
 
-// the main function - creates lists on demand and the watchers associated
-// with them.
-function insert(item, msecs) {
-  item._idleStart = new Date();
-  item._idleTimeout = msecs;
 
-  if (msecs < 0) return;
+function add(item, msecs) {
+  if (!wheel) {
+    wheel = new TimerWheel();
+    wheel.ontimeout = onTimeout;
+  }
 
-  var list;
+  var id = wheel.add(msecs, item._precise === true);
+  assert(id >= 0);
+  items[id] = item;
+  item._idleId = id;
+}
 
-  if (lists[msecs]) {
-    list = lists[msecs];
-  } else {
-    list = new Timer();
-    list.start(msecs, 0);
-
-    L.init(list);
-
-    lists[msecs] = list;
-
-    list.ontimeout = function() {
-      debug('timeout callback ' + msecs);
-
-      var now = new Date();
-      debug('now: ' + now);
-
-      var first;
-      while (first = L.peek(list)) {
-        var diff = now - first._idleStart;
-        if (diff + 1 < msecs) {
-          list.start(msecs - diff, 0);
-          debug(msecs + ' list wait because diff is ' + diff);
-          return;
-        } else {
-          L.remove(first);
-          assert(first !== L.peek(list));
-          if (first._onTimeout) first._onTimeout();
-        }
-      }
 
-      debug(msecs + ' list empty');
-      assert(L.isEmpty(list));
-      list.close();
-      delete lists[msecs];
-    };
+function expire(id, now) {
+  var item = items[id];
+  // removed by an earlier callback of the same batch
+  if (!item) return;
+
+  items[id] = null;
+  item._idleId = -1;
+
+  var msecs = item._idleTimeout;
+  var diff = now - item._idleStart;
+  if (diff + 1 < msecs) {
+    // active() was called since, or the timeout is further out than the
+    // wheel reaches.
+    debug(msecs + ' item wait because diff is ' + diff);
+    add(item, msecs - diff);
+  } else if (item._onTimeout) {
+    item._onTimeout();
   }
+}
+
 
-  L.append(list, item);
-  assert(!L.isEmpty(list)); // list is not empty
+function onTimeout(ids) {
+  debug('timeout callback ' + ids.length);
+
+  var now = new Date();
+  var i = 0;
+
+  try {
+    for (; i < ids.length; i++) expire(ids[i], now);
+  } finally {
+    // A callback that threw must not take the rest of the batch with it.
+    for (i++; i < ids.length; i++) {
+      var item = items[ids[i]];
+      if (item) {
+        items[ids[i]] = null;
+        add(item, 0);
+      }
+    }
+  }
 }
 
 
 var unenroll = exports.unenroll = function(item) {
-  L.remove(item);
-
-  var list = lists[item._idleTimeout];
-  // if empty then stop the watcher
   debug('unenroll');
-  if (list && L.isEmpty(list)) {
-    debug('unenroll: list empty');
-    list.close();
-    delete lists[item._idleTimeout];
+  if (item._idleId >= 0) {
+    wheel.remove(item._idleId);
+    items[item._idleId] = null;
+    item._idleId = -1;
   }
 };
 
@@ -115,10 +125,9 @@ var unenroll = exports.unenroll = function(item) {
 exports.enroll = function(item, msecs) {
   // if this item was already in a list somewhere
   // then we should unenroll it from that
-  if (item._idleNext) unenroll(item);
+  unenroll(item);
 
   item._idleTimeout = msecs;
-  L.init(item);
 };
 
 
@@ -127,13 +136,8 @@ exports.enroll = function(item, msecs) {
 exports.active = function(item) {
   var msecs = item._idleTimeout;
   if (msecs >= 0) {
-    var list = lists[msecs];
-    if (!list || L.isEmpty(list)) {
-      insert(item, msecs);
-    } else {
-      item._idleStart = new Date();
-      L.append(list, item);
-    }
+    item._idleStart = new Date();
+    if (!(item._idleId >= 0)) add(item, msecs);
   }
 };
 
@@ -143,6 +147,75 @@ exports.active = function(item) {
  */
 
 
+function Timeout(after) {
+  this._idleTimeout = after;
+  this._idleId = -1;
+  this._handle = null;
+}
+
+
+// The wheel is shared by every timeout, so an unref'd timeout moves to a
+// Timer handle of its own for the time it has left.
+Timeout.prototype.unref = function() {
+  if (!this._handle) {
+    if (!(this._idleId >= 0)) return; // fired or cleared
+
+    var self = this;
+    var left = this._idleTimeout - (new Date() - this._idleStart);
+    unenroll(this);
+
+    this._handle = new Timer();
+    this._handle.ontimeout = function() {
+      self._handle.close();
+      self._handle = null;
+      if (self._onTimeout) self._onTimeout();
+    };
+    this._handle.start(left > 0 ? left : 0, 0, this._precise === true);
+  }
+  this._handle.unref();
+};
+
+
+// Exempts the timeout from the timer slack.
+Timeout.prototype.precise = function() {
+  if (this._precise) return this;
+  this._precise = true;
+
+  if (this._handle) {
+    // already on a handle of its own, restart it for the time left
+    var left = this._idleTimeout - (new Date() - this._idleStart);
+    this._handle.stop();
+    this._handle.start(left > 0 ? left : 0, 0, true);
+  } else if (this._idleId >= 0) {
+    unenroll(this);
+    add(this, this._idleTimeout - (new Date() - this._idleStart));
+  }
+  return this;
+};
+
+
+// For setInterval() and setTimeout(callback, 0). An interval starts its
+// period over, precisely.
+Timer.prototype.precise = function() {
+  if (this._precise) return this;
+  this._precise = true;
+
+  // getRepeat() has the period rounded to the slack; start over with the
+  // one that was asked for.
+  var repeat = this._repeat || this.getRepeat();
+  if (repeat > 0) {
+    this.stop();
+    this.start(repeat, repeat, true);
+  }
+  return this;
+};
+
+
+Timeout.prototype.ref = function() {
+  if (this._handle) this._handle.ref();
+};
+
+
 exports.setTimeout = function(callback, after) {
   var timer;
 
@@ -163,9 +236,7 @@ exports.setTimeout = function(callback, after) {
     timer.ontimeout = timer._onTimeout;
     timer.start(0, 0);
   } else {
-    timer = { _idleTimeout: after };
-    timer._idlePrev = timer;
-    timer._idleNext = timer;
+    timer = new Timeout(after);
 
     if (arguments.length <= 2) {
       timer._onTimeout = callback;
@@ -190,6 +261,10 @@ exports.clearTimeout = function(timer) {
       timer.close(); // for after === 0
     } else {
       exports.unenroll(timer);
+      if (timer._handle) {
+        timer._handle.close();
+        timer._handle = null;
+      }
     }
   }
 };
@@ -203,7 +278,8 @@ exports.setInterval = function(callback, repeat) {
     callback.apply(timer, args);
   }
 
-  timer.start(repeat, repeat ? repeat : 1);
+  timer._repeat = repeat ? repeat : 1;
+  timer.start(repeat, timer._repeat);
   return timer;
 };
 
@@ -214,3 +290,77 @@ exports.clearInterval = function(timer) {
     timer.close();
   }
 };
+
+
+// IMMEDIATES
+//
+// Callbacks that yield to I/O: they run after the loop has polled, one
+// batch per iteration. Like the nextTick queue in src/node.js they are kept
+// in a ring buffer, with the count in process._immediateInfo[0] so that
+// node::Isolate enters JavaScript only when there is work; it then runs all
+// immediates queued before the batch started, and the ticks they queue,
+// with one call of process._immediateCallback().
+
+var immediateQueue = new Array(16);
+var immediateHead = 0;
+var immediateInfo = process._immediateInfo;
+var tickInfo = process._tickInfo;
+
+
+function growImmediateQueue() {
+  var size = immediateQueue.length;
+  var queue = new Array(size * 2);
+  for (var i = 0; i < size; i++) {
+    queue[i] = immediateQueue[(immediateHead + i) & (size - 1)];
+  }
+  immediateQueue = queue;
+  immediateHead = 0;
+}
+
+
+process._immediateCallback = function() {
+  var l = immediateInfo[0];
+
+  while (l-- > 0) {
+    var immediate = immediateQueue[immediateHead];
+    immediateQueue[immediateHead] = undefined;
+    immediateHead = (immediateHead + 1) & (immediateQueue.length - 1);
+    immediateInfo[0]--;
+    // null if cleared
+    if (immediate._onImmediate) immediate._onImmediate();
+    // nextTick() still means before anything else, the next immediate
+    // included.
+    if (tickInfo[0] > 0) process._tickCallback();
+  }
+
+  if (immediateInfo[0] === 0 && immediateQueue.length > 1024) {
+    immediateQueue = new Array(16);
+    immediateHead = 0;
+  }
+};
+
+
+exports.setImmediate = function(callback) {
+  var immediate = { _onImmediate: callback };
+
+  if (arguments.length > 1) {
+    var args = Array.prototype.slice.call(arguments, 1);
+    immediate._onImmediate = function() {
+      callback.apply(immediate, args);
+    };
+  }
+
+  var length = immediateInfo[0];
+  if (length === immediateQueue.length) growImmediateQueue();
+  immediateQueue[(immediateHead + length) & (immediateQueue.length - 1)] =
+      immediate;
+  immediateInfo[0] = length + 1;
+  if (length === 0) process._needImmediateCallback();
+
+  return immediate;
+};
+
+
+exports.clearImmediate = function(immediate) {
+  if (immediate) immediate._onImmediate = null;
+};
@@ -25,6 +25,13 @@ var net = require('net');
 var events = require('events');
 var stream = require('stream');
 var END_OF_FILE = 42;
+// Slab shared by all CryptoStreams for the data they emit, which gets
+// exact-size slices of it. A new one is started when less than a TLS
+// record's worth of room is left.
+var kPoolSize = 64 * 1024;
+var kMinPoolSpace = 16 * 1024;
+var slab = null;
+var slabOffset = 0;
 var assert = require('assert').ok;
 
 var debug;
@@ -81,6 +88,7 @@ function CryptoStream(pair) {
   this._pending = [];
   this._pendingCallbacks = [];
   this._pendingBytes = 0;
+  this._pushDrained = false;
 }
 util.inherits(CryptoStream, stream.Stream);
 
@@ -314,12 +322,32 @@ CryptoStream.prototype._push = function() {
   }
 
   while (!this._paused) {
+    // Nothing to read: don't touch the slab, or even call into OpenSSL.
+    if (!this._maybePushable()) {
+      if (this._destroyAfterPush && this._internallyPendingBytes() == 0) {
+        this._done();
+      }
+      return;
+    }
+
+    // Read into the free end of the slab, like net does with socket reads.
+    if (!slab || slab.length - slabOffset < kMinPoolSpace) {
+      slab = new Buffer(kPoolSize);
+      slabOffset = 0;
+    }
+
+    var pool = slab;
+    var start = slabOffset;
+    // Hold on to the rest of it while reading: OpenSSL can call back into
+    // JS (an SNI callback, say), which may push on another stream.
+    slabOffset = pool.length;
     var bytesRead = 0;
     var chunkBytes = 0;
-    var pool = new Buffer(16 * 4096); // alloc every time?
+    var room;
 
     do {
-      chunkBytes = this._pusher(pool, bytesRead, pool.length - bytesRead);
+      room = pool.length - start - bytesRead;
+      chunkBytes = this._pusher(pool, start + bytesRead, room);
 
       if (this.pair.ssl && this.pair.ssl.error) {
         this.pair.error();
@@ -332,10 +360,19 @@ CryptoStream.prototype._push = function() {
         bytesRead += chunkBytes;
       }
 
-    } while (chunkBytes > 0 && bytesRead < pool.length);
+      // Both clearOut and encOut fill as much as they can, so a short read
+      // means there is nothing more for now.
+    } while (chunkBytes === room && start + bytesRead < pool.length);
 
     assert(bytesRead >= 0);
 
+    // Give back what wasn't used.
+    if (slab === pool && slabOffset === pool.length) {
+      slabOffset = start + bytesRead;
+    }
+
+    this._pushDrained = bytesRead == 0;
+
     // Bail out if we didn't read any data.
     if (bytesRead == 0) {
       if (this._internallyPendingBytes() == 0 && this._destroyAfterPush) {
@@ -344,7 +381,7 @@ CryptoStream.prototype._push = function() {
       return;
     }
 
-    var chunk = pool.slice(0, bytesRead);
+    var chunk = pool.slice(start, start + bytesRead);
 
     if (this === this.pair.cleartext) {
       debug('cleartext emit "data" with ' + bytesRead + ' bytes');
@@ -360,7 +397,11 @@ CryptoStream.prototype._push = function() {
     }
 
     // Optimization: emit the original buffer with end points
-    if (this.ondata) this.ondata(pool, 0, bytesRead);
+    if (this.ondata) this.ondata(pool, start, start + bytesRead);
+
+    // Stop here if the buffer wasn't filled; the next cycle picks up
+    // anything that arrives meanwhile.
+    if (start + bytesRead < pool.length) return;
   }
 };
 
@@ -478,9 +519,29 @@ CleartextStream.prototype._internallyPendingBytes = function() {
 };
 
 
+// Whether clearOut may have something. Until the handshake is done it has
+// to be called anyway, since it drives the handshake. After that, once a
+// call found nothing, only new encrypted input can produce more.
+CleartextStream.prototype._maybePushable = function() {
+  if (!this.pair.ssl) return false;
+  if (!this.pair._secureEstablished || !this._pushDrained) return true;
+  return this.pair.ssl.clearPending() > 0;
+};
+
+
 CleartextStream.prototype._puller = function(b) {
   debug('clearIn ' + b.length + ' bytes');
-  return this.pair.ssl.clearIn(b, 0, b.length);
+  var rv = this.pair.ssl.clearIn(b, 0, b.length);
+  if (rv > 0 && this.pair._recordSize > 0) this.pair._scheduleClearFlush();
+  return rv;
+};
+
+
+// Coalesce writes smaller than `size` bytes into TLS records of up to that
+// size. What is buffered is written at the end of the tick. 0 turns it off.
+CleartextStream.prototype.setRecordSize = function(size) {
+  if (this.pair.ssl) this.pair.ssl.setRecordSize(size);
+  this.pair._recordSize = size;
 };
 
 
@@ -519,6 +580,12 @@ EncryptedStream.prototype._internallyPendingBytes = function() {
 };
 
 
+// encOut can't return more than encPending says is there.
+EncryptedStream.prototype._maybePushable = function() {
+  return this._internallyPendingBytes() > 0;
+};
+
+
 EncryptedStream.prototype._puller = function(b) {
   debug('writing from encIn');
   return this.pair.ssl.encIn(b, 0, b.length);
@@ -591,6 +658,23 @@ function SecurePair(credentials, isServer, requestCert, rejectUnauthorized,
     this.npnProtocol = null;
   }
 
+  if (this._isServer && options.server) {
+    this._setupSessionCallbacks(options.server);
+  }
+
+  this._recordSize = 0;
+  this._clearFlushScheduled = false;
+  this._clearBuffered = false;
+  if (options.recordSize) {
+    this.ssl.setRecordSize(options.recordSize);
+    this._recordSize = options.recordSize;
+  }
+
+  // Run the private key operation of server handshakes on the thread pool
+  this._asyncHandshake = this._isServer && options.asyncHandshake ? true
+                                                                   : false;
+  this._handshakePending = false;
+
   /* Acts as a r/w stream to the cleartext side of the stream. */
   this.cleartext = new CleartextStream(this);
 
@@ -609,6 +693,68 @@ function SecurePair(credentials, isServer, requestCert, rejectUnauthorized,
 util.inherits(SecurePair, events.EventEmitter);
 
 
+// Hooks the server's 'newSession' and 'resumeSession' listeners up to the
+// connection, so sessions can live in a store outside of this process.
+SecurePair.prototype._setupSessionCallbacks = function(server) {
+  var self = this;
+
+  if (server.listeners('newSession').length > 0) {
+    this.ssl.onnewsession = function(id, session) {
+      server.emit('newSession', id, session);
+    };
+  }
+
+  if (server.listeners('resumeSession').length > 0) {
+    this.ssl.onclienthello = function(hello) {
+      var once = false;
+
+      server.emit('resumeSession', hello.sessionId, function(err, session) {
+        if (once) return;
+        once = true;
+
+        // The connection may have gone away while we were looking
+        if (!self.ssl) return;
+
+        // On errors simply fall back to a full handshake
+        if (!err && session) self.ssl.loadSession(session);
+        self.ssl.endParser();
+        self.cycle();
+      });
+    };
+    this.ssl.enableSessionCallbacks();
+  }
+};
+
+
+// Writes out the cleartext the connection coalesced during this tick, once
+// for all the writes made in it.
+SecurePair.prototype._scheduleClearFlush = function() {
+  if (this._clearFlushScheduled) return;
+  this._clearFlushScheduled = true;
+
+  var self = this;
+  process.nextTick(function() {
+    self._clearFlushScheduled = false;
+    if (!self.ssl) return;
+    if (self._flushCleartext()) self.cycle();
+  });
+};
+
+
+// Returns false if the connection failed. Cleartext may stay buffered while
+// a renegotiation waits for the peer; it is retried on the next input.
+SecurePair.prototype._flushCleartext = function() {
+  this._clearBuffered = this.ssl.clearFlush() > 0;
+
+  if (this.ssl.error) {
+    this.error();
+    return false;
+  }
+
+  return true;
+};
+
+
 exports.createSecurePair = function(credentials,
                                     isServer,
                                     requestCert,
@@ -651,7 +797,7 @@ exports.createSecurePair = function(credentials,
  * completed negotiation and emit 'secure' from here if it has.
  */
 SecurePair.prototype.cycle = function(depth) {
-  if (this._doneFlag) return;
+  if (this._doneFlag || this._handshakePending) return;
 
   depth = depth ? depth : 0;
 
@@ -666,6 +812,12 @@ SecurePair.prototype.cycle = function(depth) {
     this.cycleEncryptedPullLock = false;
   }
 
+  if (this._clearBuffered && this.ssl && !this._flushCleartext()) return;
+
+  if (this._asyncHandshake && !this._secureEstablished && this._offload()) {
+    return;
+  }
+
   if (!this.cycleCleartextPullLock) {
     this.cycleCleartextPullLock = true;
     debug('cleartext._pull');
@@ -696,6 +848,30 @@ SecurePair.prototype.cycle = function(depth) {
 };
 
 
+SecurePair.prototype._offload = function() {
+  var self = this;
+
+  if (!this.ssl) return false;
+
+  this._handshakePending = this.ssl.handshakeAsync(function() {
+    self._handshakePending = false;
+
+    // The pair may have been destroyed in the meantime
+    if (!self.ssl) return;
+
+    if (self.ssl.error) {
+      self.error();
+      return;
+    }
+
+    self.maybeInitFinished();
+    self.cycle();
+  });
+
+  return this._handshakePending;
+};
+
+
 SecurePair.prototype.maybeInitFinished = function() {
   if (this.ssl && !this._secureEstablished && this.ssl.isInitFinished()) {
     if (process.features.tls_npn) {
@@ -853,8 +1029,13 @@ function Server(/* [options], listener */) {
     secureProtocol: self.secureProtocol,
     secureOptions: self.secureOptions,
     crl: self.crl,
-    sessionIdContext: self.sessionIdContext
+    sessionIdContext: self.sessionIdContext,
+    ticketKeys: self.ticketKeys,
+    verifyCacheTTL: self.verifyCacheTTL,
+    verifyCacheSize: self.verifyCacheSize,
+    shared: self.shareContext
   });
+  this._sharedCreds = sharedCreds;
 
   // constructor call
   net.Server.call(this, function(socket) {
@@ -865,6 +1046,9 @@ function Server(/* [options], listener */) {
                               self.requestCert,
                               self.rejectUnauthorized,
                               {
+                                server: self,
+                                asyncHandshake: self.asyncHandshake,
+                                recordSize: self.recordSize,
                                 NPNProtocols: self.NPNProtocols,
                                 SNICallback: self.SNICallback
                               });
@@ -941,6 +1125,12 @@ Server.prototype.setOptions = function(options) {
   } else {
     this.SNICallback = this.SNICallback.bind(this);
   }
+  if (options.ticketKeys) this.ticketKeys = options.ticketKeys;
+  if (options.verifyCacheTTL) this.verifyCacheTTL = options.verifyCacheTTL;
+  if (options.verifyCacheSize) this.verifyCacheSize = options.verifyCacheSize;
+  if (options.asyncHandshake) this.asyncHandshake = true;
+  if (options.recordSize) this.recordSize = options.recordSize;
+  if (options.shareContext) this.shareContext = true;
   if (options.sessionIdContext) {
     this.sessionIdContext = options.sessionIdContext;
   } else if (this.requestCert) {
@@ -950,6 +1140,28 @@ Server.prototype.setOptions = function(options) {
   }
 };
 
+Server.prototype.getTicketKeys = function() {
+  return this._sharedCreds.context.getTicketKeys();
+};
+
+
+Server.prototype.setTicketKeys = function(keys) {
+  this._sharedCreds.context.setTicketKeys(keys);
+};
+
+
+// Revokes certificates without restarting the server; this also empties the
+// verification cache.
+Server.prototype.addCRL = function(crl) {
+  this._sharedCreds.context.addCRL(crl);
+};
+
+
+Server.prototype.getVerifyCacheStats = function() {
+  return this._sharedCreds.context.getVerifyCacheStats();
+};
+
+
 // SNI Contexts High-Level API
 Server.prototype._contexts = [];
 Server.prototype.addContext = function(servername, credentials) {
@@ -1020,7 +1232,8 @@ exports.connect = function(port /* host, options, cb */) {
   var pair = new SecurePair(sslcontext, false, true, false,
                             {
                               NPNProtocols: this.NPNProtocols,
-                              servername: options.servername || host
+                              servername: options.servername || host,
+                              recordSize: options.recordSize
                             });
 
   if (options.session) {
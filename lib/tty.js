@@ -58,11 +58,10 @@ function ReadStream(fd) {
 
   this.writable = false;
 
-  var self = this,
-      keypressListeners = this.listeners('keypress');
+  var self = this;
 
   function onData(b) {
-    if (keypressListeners.length) {
+    if (self.listeners('keypress').length) {
       self._emitKey(b);
     } else {
       // Nobody's watching anyway
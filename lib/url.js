@@ -92,6 +92,11 @@ function urlParse(url, parseQueryString, slashesDenoteHost) {
     throw new TypeError("Parameter 'url' must be a string, not " + typeof url);
   }
 
+  if (!slashesDenoteHost) {
+    var fast = pathParse(url, parseQueryString);
+    if (fast) return fast;
+  }
+
   var out = {},
       rest = url;
 
@@ -304,6 +309,56 @@ function urlParse(url, parseQueryString, slashesDenoteHost) {
   return out;
 }
 
+// Fast path for the most common input by far, a request path such as
+// '/foo/bar?a=b'. There is no protocol, no host and nothing that has to be
+// chopped or escaped, so the general parser reduces to splitting on '#' and
+// '?' and the href is the input itself. Returns null when the general parser
+// is needed.
+function pathParse(url, parseQueryString) {
+  var l = url.length;
+  if (l === 0 || url.charCodeAt(0) !== 47 /* '/' */) return null;
+  if (l > 1 && url.charCodeAt(1) === 47) return null; // '//host' or auth
+
+  var hash = -1, qm = -1;
+  for (var i = 0; i < l; i++) {
+    switch (url.charCodeAt(i)) {
+      case 35: /* '#' */
+        if (hash === -1) hash = i;
+        break;
+      case 63: /* '?' */
+        if (qm === -1 && hash === -1) qm = i;
+        break;
+      // delims and autoEscape, see above.
+      case 9: case 10: case 13: case 32: case 34: case 39: case 60: case 62:
+      case 96:
+        return null;
+    }
+  }
+
+  var out = {};
+  var end = l;
+  if (hash !== -1) {
+    out.hash = url.slice(hash);
+    end = hash;
+  }
+  if (qm !== -1) {
+    out.search = url.slice(qm, end);
+    out.query = url.slice(qm + 1, end);
+    if (parseQueryString) {
+      out.query = querystring.parse(out.query);
+    }
+    end = qm;
+  } else if (parseQueryString) {
+    out.search = '';
+    out.query = {};
+  }
+  // A leading '/' always leaves a non-empty pathname.
+  out.pathname = url.slice(0, end);
+  out.path = out.pathname + (out.search || '');
+  out.href = url;
+  return out;
+}
+
 // format a parsed object into a url string
 function urlFormat(obj) {
   // ensure it's an object, and not a string url.
@@ -19,7 +19,8 @@
 // OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
-var formatRegExp = /%[sdj%]/g;
+var binding = process.binding('util');
+
 exports.format = function(f) {
   if (typeof f !== 'string') {
     var objects = [];
@@ -29,28 +30,11 @@ exports.format = function(f) {
     return objects.join(' ');
   }
 
-  var i = 1;
-  var args = arguments;
-  var len = args.length;
-  var str = String(f).replace(formatRegExp, function(x) {
-    if (i >= len) return x;
-    switch (x) {
-      case '%s': return String(args[i++]);
-      case '%d': return Number(args[i++]);
-      case '%j': return JSON.stringify(args[i++]);
-      case '%%': return '%';
-      default:
-        return x;
-    }
-  });
-  for (var x = args[i]; i < len; x = args[++i]) {
-    if (x === null || typeof x !== 'object') {
-      str += ' ' + x;
-    } else {
-      str += ' ' + inspect(x);
-    }
-  }
-  return str;
+  // The rest is done natively, see src/node_util.cc.
+  var args = new Array(arguments.length + 1);
+  args[0] = inspect;
+  for (var i = 0; i < arguments.length; i++) args[i + 1] = arguments[i];
+  return binding.format.apply(binding, args);
 };
 
 
@@ -95,6 +79,7 @@ function inspect(obj, showHidden, depth, colors) {
   var ctx = {
     showHidden: showHidden,
     seen: [],
+    flat: !showHidden && !colors,
     stylize: colors ? stylizeWithColor : stylizeNoColor
   };
   return formatValue(ctx, obj, (typeof depth === 'undefined' ? 2 : depth));
@@ -151,6 +136,13 @@ function stylizeNoColor(str, styleType) {
 
 
 function formatValue(ctx, value, recurseTimes) {
+  // Primitives, and arrays and objects of nothing but primitives, are
+  // formatted natively unless they have an inspect() method or accessors.
+  if (ctx.flat && !(recurseTimes < 0)) {
+    var flat = binding.inspectFlat(value);
+    if (flat !== undefined) return flat;
+  }
+
   // Provide a hook for user-specified inspect functions.
   // Check that value is an object with an inspect function on it
   if (value && typeof value.inspect === 'function' &&
@@ -494,6 +486,29 @@ exports.pump = function(readStream, writeStream, callback) {
 };
 
 
+var jsonBinding;
+
+// Parses JSON text that arrives in pieces, without joining it into one
+// string first. See src/node_json.cc.
+function JSONParser() {
+  if (!jsonBinding) jsonBinding = process.binding('json');
+  this._handle = new jsonBinding.JSONParser();
+}
+exports.JSONParser = JSONParser;
+
+
+JSONParser.prototype.write = function(chunk) {
+  if (typeof chunk === 'string') chunk = new Buffer(chunk, 'utf8');
+  this._handle.write(chunk, 0, chunk.length);
+};
+
+
+JSONParser.prototype.end = function(chunk) {
+  if (chunk) this.write(chunk);
+  return this._handle.end();
+};
+
+
 /**
  * Inherit the prototype methods from one constructor into another.
  *
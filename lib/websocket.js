@@ -0,0 +1,159 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var binding = process.binding('websocket');
+
+var FRAME_END = binding.WS_FRAME_END;
+var FIN = binding.WS_FIN;
+
+var EMPTY = new Buffer(0);
+
+var randomBytes;
+try {
+  randomBytes = require('crypto').randomBytes;
+} catch (e) {
+  // Built without OpenSSL.
+}
+
+exports.CONTINUATION = binding.WS_OP_CONTINUATION;
+exports.TEXT = binding.WS_OP_TEXT;
+exports.BINARY = binding.WS_OP_BINARY;
+exports.CLOSE = binding.WS_OP_CLOSE;
+exports.PING = binding.WS_OP_PING;
+exports.PONG = binding.WS_OP_PONG;
+
+
+// Reads the frames of a WebSocket connection and calls onmessage() with
+// the opcode and payload of every complete message and control frame.
+// Payloads are unmasked in the Buffers passed to execute() and handed out
+// as slices of them where the message came in one piece.
+function Parser(options) {
+  options = options || {};
+  this._handle = new binding.WebSocketParser(options.maxPayload,
+                                             !!options.requireMask);
+  this._handle.onframes = onframes;
+  this._handle.owner = this;
+  this._data = [];
+  this._control = [];
+  this.onmessage = null;
+}
+exports.Parser = Parser;
+
+
+function deliver(parser, opcode, pieces) {
+  var payload;
+  if (pieces.length === 1) {
+    payload = pieces[0];
+  } else if (pieces.length === 0) {
+    payload = EMPTY;
+  } else {
+    payload = Buffer.concat(pieces);
+  }
+  if (parser.onmessage) parser.onmessage(opcode, payload);
+}
+
+
+function onframes(pieces, buffer) {
+  var parser = this.owner;
+
+  for (var i = 0; i < pieces.length; i += 4) {
+    var opcode = pieces[i];
+    var flags = pieces[i + 1];
+    var start = pieces[i + 2];
+    var length = pieces[i + 3];
+
+    // Control frames may come between the fragments of a message.
+    if (opcode & 0x8) {
+      if (length > 0) parser._control.push(buffer.slice(start, start + length));
+      if (flags & FRAME_END) {
+        var control = parser._control;
+        parser._control = [];
+        deliver(parser, opcode, control);
+      }
+    } else {
+      if (length > 0) parser._data.push(buffer.slice(start, start + length));
+      if ((flags & FRAME_END) && (flags & FIN)) {
+        var data = parser._data;
+        parser._data = [];
+        deliver(parser, opcode, data);
+      }
+    }
+  }
+}
+
+
+// Returns null, or an Error with the reason and the closeCode to send when
+// the input is not valid framing. The parser has to be reset() after one.
+Parser.prototype.execute = function(buffer, start, end) {
+  if (start === undefined) start = 0;
+  if (end === undefined) end = buffer.length;
+  if (end === start) return null;
+
+  var r = this._handle.execute(buffer, start, end - start);
+  return r instanceof Error ? r : null;
+};
+
+
+Parser.prototype.reset = function() {
+  this._handle.reinitialize();
+  this._data = [];
+  this._control = [];
+};
+
+
+function maskKey(mask) {
+  if (Buffer.isBuffer(mask)) return mask;
+  if (randomBytes) return randomBytes(4);
+  var key = new Buffer(4);
+  for (var i = 0; i < 4; i++) key[i] = Math.floor(Math.random() * 256);
+  return key;
+}
+
+
+// Returns a Buffer with one frame. options.fin defaults to true;
+// options.mask is true for a fresh key or the 4 byte Buffer to use.
+exports.frame = function(opcode, payload, options) {
+  if (typeof payload === 'string') {
+    payload = new Buffer(payload, 'utf8');
+  } else if (payload == null) {
+    payload = EMPTY;
+  } else if (!Buffer.isBuffer(payload)) {
+    throw new TypeError('payload must be a string or a Buffer');
+  }
+
+  var fin = !(options && options.fin === false);
+  var key = options && options.mask ? maskKey(options.mask) : null;
+
+  var out = new Buffer(binding.WS_MAX_HEADER + payload.length);
+  var size = binding.writeHeader(out, 0, opcode, fin, payload.length, key);
+  payload.copy(out, size);
+  if (key) binding.mask(out, size, size + payload.length, key, 0);
+
+  return out.slice(0, size + payload.length);
+};
+
+
+// Masks or unmasks buffer[start..end) in place with a 4 byte key.
+exports.mask = function(buffer, key, start, end) {
+  if (start === undefined) start = 0;
+  if (end === undefined) end = buffer.length;
+  binding.mask(buffer, start, end, key, 0);
+};
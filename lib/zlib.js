@@ -37,10 +37,18 @@ binding.Z_MIN_CHUNK = 64;
 binding.Z_MAX_CHUNK = Infinity;
 binding.Z_DEFAULT_CHUNK = (16 * 1024);
 
+// Blocks of a parallel gzip; each is primed with 32K of the one before.
+binding.Z_MIN_PARALLEL_BLOCK = (32 * 1024);
+binding.Z_DEFAULT_PARALLEL_BLOCK = (128 * 1024);
+
 binding.Z_MIN_MEMLEVEL = 1;
 binding.Z_MAX_MEMLEVEL = 9;
 binding.Z_DEFAULT_MEMLEVEL = 8;
 
+// writes of up to this many bytes are (de)compressed on the main thread,
+// which is cheaper than the trip through the thread pool.
+binding.Z_DEFAULT_INLINE_SIZE = 1024;
+
 binding.Z_MIN_LEVEL = -1;
 binding.Z_MAX_LEVEL = 9;
 binding.Z_DEFAULT_LEVEL = binding.Z_DEFAULT_COMPRESSION;
@@ -90,73 +98,221 @@ exports.createUnzip = function(o) {
 
 // Convenience methods.
 // compress/decompress a string or buffer in one step.
-exports.deflate = function(buffer, callback) {
-  zlibBuffer(new Deflate(), buffer, callback);
+exports.deflate = function(buffer, opts, callback) {
+  zlibBuffer(binding.Deflate, buffer, opts, callback);
 };
 
-exports.gzip = function(buffer, callback) {
-  zlibBuffer(new Gzip(), buffer, callback);
+exports.gzip = function(buffer, opts, callback) {
+  if (opts && opts.parallel) {
+    gzipParallel(buffer, opts, callback);
+  } else {
+    zlibBuffer(binding.Gzip, buffer, opts, callback);
+  }
 };
 
-exports.deflateRaw = function(buffer, callback) {
-  zlibBuffer(new DeflateRaw(), buffer, callback);
+exports.deflateRaw = function(buffer, opts, callback) {
+  zlibBuffer(binding.DeflateRaw, buffer, opts, callback);
 };
 
-exports.unzip = function(buffer, callback) {
-  zlibBuffer(new Unzip(), buffer, callback);
+exports.unzip = function(buffer, opts, callback) {
+  zlibBuffer(binding.Unzip, buffer, opts, callback);
 };
 
-exports.inflate = function(buffer, callback) {
-  zlibBuffer(new Inflate(), buffer, callback);
+exports.inflate = function(buffer, opts, callback) {
+  zlibBuffer(binding.Inflate, buffer, opts, callback);
 };
 
-exports.gunzip = function(buffer, callback) {
-  zlibBuffer(new Gunzip(), buffer, callback);
+exports.gunzip = function(buffer, opts, callback) {
+  zlibBuffer(binding.Gunzip, buffer, opts, callback);
 };
 
-exports.inflateRaw = function(buffer, callback) {
-  zlibBuffer(new InflateRaw(), buffer, callback);
+exports.inflateRaw = function(buffer, opts, callback) {
+  zlibBuffer(binding.InflateRaw, buffer, opts, callback);
 };
 
-function zlibBuffer(engine, buffer, callback) {
-  var buffers = [];
-  var nread = 0;
+// Synchronous versions, which return the result or throw.
+exports.deflateSync = function(buffer, opts) {
+  return zlibBufferSync(new Deflate(opts), buffer);
+};
 
-  engine.on('error', function(err) {
-    engine.removeListener('end');
-    engine.removeListener('error');
-    callback(err);
-  });
+exports.gzipSync = function(buffer, opts) {
+  return zlibBufferSync(new Gzip(opts), buffer);
+};
 
-  engine.on('data', function(chunk) {
-    buffers.push(chunk);
-    nread += chunk.length;
-  });
+exports.deflateRawSync = function(buffer, opts) {
+  return zlibBufferSync(new DeflateRaw(opts), buffer);
+};
 
-  engine.on('end', function() {
-    var buffer;
-    switch(buffers.length) {
-      case 0:
-        buffer = new Buffer(0);
-        break;
-      case 1:
-        buffer = buffers[0];
-        break;
-      default:
-        buffer = new Buffer(nread);
-        var n = 0;
-        buffers.forEach(function(b) {
-          var l = b.length;
-          b.copy(buffer, n, 0, l);
-          n += l;
-        });
-        break;
+exports.unzipSync = function(buffer, opts) {
+  return zlibBufferSync(new Unzip(opts), buffer);
+};
+
+exports.inflateSync = function(buffer, opts) {
+  return zlibBufferSync(new Inflate(opts), buffer);
+};
+
+exports.gunzipSync = function(buffer, opts) {
+  return zlibBufferSync(new Gunzip(opts), buffer);
+};
+
+exports.inflateRawSync = function(buffer, opts) {
+  return zlibBufferSync(new InflateRaw(opts), buffer);
+};
+
+// Checksums, which continue from `value` if given.
+function checksum(fn, initial) {
+  return function(data, value) {
+    if (typeof data === 'string') {
+      data = new Buffer(data);
+    } else if (!Buffer.isBuffer(data)) {
+      throw new TypeError('Not a string or buffer');
     }
-    callback(null, buffer);
-  });
+    return fn(data, value === undefined ? initial : value >>> 0);
+  };
+}
+
+exports.crc32 = checksum(binding.crc32, 0);
+exports.crc32c = checksum(binding.crc32c, 0);
+exports.adler32 = checksum(binding.adler32, 1);
+
+function concatBuffers(buffers, nread) {
+  switch (buffers.length) {
+    case 0:
+      return new Buffer(0);
+    case 1:
+      return buffers[0];
+    default:
+      var buffer = new Buffer(nread);
+      var n = 0;
+      buffers.forEach(function(b) {
+        var l = b.length;
+        b.copy(buffer, n, 0, l);
+        n += l;
+      });
+      return buffer;
+  }
+}
+
+// Hands the whole buffer to the binding in one thread pool request, which
+// returns the output as a single buffer. `opts.output` is a buffer to write
+// the output into, `opts.outputSize` the expected size of the output.
+function zlibBuffer(Binding, buffer, opts, callback) {
+  if (typeof opts === 'function') {
+    callback = opts;
+    opts = {};
+  }
+  opts = opts || {};
+
+  var output = opts.output;
+  if (output !== undefined && !Buffer.isBuffer(output)) {
+    throw new TypeError('output must be a Buffer');
+  }
+  var outputSize = opts.outputSize;
+  if (outputSize !== undefined &&
+      (typeof outputSize !== 'number' || !(outputSize >= 0))) {
+    throw new TypeError('outputSize must be a non-negative number');
+  }
+
+  if (typeof buffer === 'string') {
+    buffer = new Buffer(buffer);
+  } else if (!Buffer.isBuffer(buffer)) {
+    process.nextTick(function() {
+      callback(new Error('Invalid argument'));
+    });
+    return;
+  }
+
+  var handle = new Binding();
+  handle.init(exports.Z_DEFAULT_WINDOWBITS,
+              exports.Z_DEFAULT_COMPRESSION,
+              exports.Z_DEFAULT_MEMLEVEL,
+              exports.Z_DEFAULT_STRATEGY);
+
+  var req = handle.processAll(buffer, outputSize, output);
+  req.buffer = buffer;
+  req.output = output;
+  req.handle = handle;
+  req.callback = function(err, result) {
+    if (err !== binding.Z_STREAM_END) {
+      callback(zlibError(err));
+    } else if (typeof result === 'number') {
+      // All of it fit into `output`
+      callback(null, output.slice(0, result));
+    } else {
+      // The binding's SlowBuffer lacks most of Buffer's methods.
+      callback(null, new Buffer(result, result.length, 0));
+    }
+  };
+}
+
+// Deflates blocks of the buffer on several pool threads at once, and joins
+// them into one gzip stream.
+function gzipParallel(buffer, opts, callback) {
+  var level = opts.level || exports.Z_DEFAULT_COMPRESSION;
+  var blockSize = opts.blockSize || exports.Z_DEFAULT_PARALLEL_BLOCK;
+
+  if (level < exports.Z_MIN_LEVEL || level > exports.Z_MAX_LEVEL) {
+    throw new Error('Invalid compression level: ' + level);
+  }
+  if (blockSize < exports.Z_MIN_PARALLEL_BLOCK) {
+    throw new Error('Invalid block size: ' + blockSize);
+  }
+
+  if (typeof buffer === 'string') {
+    buffer = new Buffer(buffer);
+  } else if (!Buffer.isBuffer(buffer)) {
+    process.nextTick(function() {
+      callback(new Error('Invalid argument'));
+    });
+    return;
+  }
+
+  var req = binding.gzipParallel(buffer, level, blockSize);
+  req.buffer = buffer;
+  req.callback = function(err, result) {
+    if (err !== binding.Z_STREAM_END) {
+      callback(zlibError(err));
+    } else {
+      callback(null, new Buffer(result, result.length, 0));
+    }
+  };
+}
+
+// Drives the engine's binding directly, without its queue and events.
+function zlibBufferSync(engine, buffer) {
+  if (typeof buffer === 'string') {
+    buffer = new Buffer(buffer);
+  } else if (!Buffer.isBuffer(buffer)) {
+    throw new TypeError('Not a string or buffer');
+  }
+
+  try {
+    return engine._processSync(buffer, binding.Z_FINISH);
+  } finally {
+    // Don't leave zlib's state to the garbage collector.
+    engine._binding.close();
+  }
+}
 
-  engine.write(buffer);
-  engine.end();
+function zlibError(code) {
+  // Z_BUF_ERROR with room left in the output: the input ended too soon.
+  if (code === binding.Z_BUF_ERROR) {
+    return new Error('unexpected end of input');
+  }
+  if (code === binding.Z_NEED_DICT) {
+    return new Error('Missing dictionary');
+  }
+  return new Error(zlibErrorName(code));
+}
+
+function zlibErrorName(code) {
+  var keys = Object.keys(binding);
+  for (var i = 0; i < keys.length; i++) {
+    if (/^Z_.*ERROR$/.test(keys[i]) && binding[keys[i]] === code) {
+      return keys[i];
+    }
+  }
+  return 'zlib error ' + code;
 }
 
 
@@ -259,13 +415,30 @@ function Zlib(opts, Binding) {
     }
   }
 
+  if (opts.dictionary) {
+    if (!Buffer.isBuffer(opts.dictionary)) {
+      throw new Error('Invalid dictionary: it should be a Buffer instance');
+    }
+    if (Binding === binding.Gzip || Binding === binding.Gunzip) {
+      throw new Error('Gzip streams do not support a dictionary');
+    }
+  }
+
   this._binding = new Binding();
   this._binding.init(opts.windowBits || exports.Z_DEFAULT_WINDOWBITS,
                      opts.level || exports.Z_DEFAULT_COMPRESSION,
                      opts.memLevel || exports.Z_DEFAULT_MEMLEVEL,
-                     opts.strategy || exports.Z_DEFAULT_STRATEGY);
+                     opts.strategy || exports.Z_DEFAULT_STRATEGY,
+                     opts.dictionary);
 
   this._chunkSize = opts.chunkSize || exports.Z_DEFAULT_CHUNK;
+  if (opts.inline) {
+    this._inlineSize = Infinity;
+  } else if (opts.inlineSize !== undefined) {
+    this._inlineSize = opts.inlineSize;
+  } else {
+    this._inlineSize = exports.Z_DEFAULT_INLINE_SIZE;
+  }
   this._buffer = new Buffer(this._chunkSize);
   this._offset = 0;
   var self = this;
@@ -318,6 +491,57 @@ Zlib.prototype.end = function end(chunk, cb) {
   return ret;
 };
 
+// Runs `buffer` through zlib on this thread with the given flush mode, and
+// returns whatever output that produced as one buffer. Output is cut from
+// the same slab as the stream's, so nothing returned is written over later.
+// Throws on zlib errors.
+Zlib.prototype._processSync = function(buffer, flush) {
+  var chunkSize = this._chunkSize;
+  var buffers = [];
+  var nread = 0;
+  var inOff = 0;
+  var availIn = buffer.length;
+  var result;
+
+  do {
+    var availOut = chunkSize - this._offset;
+    result = this._binding.writeSync(flush,
+                                     buffer,
+                                     inOff,
+                                     availIn,
+                                     this._buffer,
+                                     this._offset,
+                                     availOut);
+
+    // With Z_FINISH, inflate() reports a full output buffer as Z_BUF_ERROR
+    // too. With room left, it means the input ended early.
+    if (result[2] === binding.Z_BUF_ERROR) {
+      if (result[1] > 0 && flush === binding.Z_FINISH) {
+        throw zlibError(result[2]);
+      }
+    } else if (result[2] < 0 || result[2] === binding.Z_NEED_DICT) {
+      throw zlibError(result[2]);
+    }
+
+    inOff += availIn - result[0];
+    availIn = result[0];
+
+    var have = availOut - result[1];
+    if (have > 0) {
+      buffers.push(this._buffer.slice(this._offset, this._offset + have));
+      this._offset += have;
+      nread += have;
+    }
+
+    if (result[1] === 0 || this._offset >= chunkSize) {
+      this._offset = 0;
+      this._buffer = new Buffer(chunkSize);
+    }
+  } while (result[1] === 0 && result[2] !== binding.Z_STREAM_END);
+
+  return concatBuffers(buffers, nread);
+};
+
 Zlib.prototype._process = function() {
   if (this._processing || this._paused) return;
 
@@ -341,19 +565,10 @@ Zlib.prototype._process = function() {
   var self = this;
   var availInBefore = chunk && chunk.length;
   var availOutBefore = this._chunkSize - this._offset;
+  var inline = (availInBefore || 0) <= this._inlineSize;
 
   var inOff = 0;
-  var req = this._binding.write(this._flush,
-                                chunk, // in
-                                inOff, // in_off
-                                availInBefore, // in_len
-                                this._buffer, // out
-                                this._offset, //out_off
-                                availOutBefore); // out_len
-
-  req.buffer = chunk;
-  req.callback = callback;
-  this._processing = req;
+  write(availOutBefore);
 
   function callback(availInAfter, availOutAfter, buffer) {
     var have = availOutBefore - availOutAfter;
@@ -382,16 +597,7 @@ Zlib.prototype._process = function() {
       inOff += (availInBefore - availInAfter);
       availInBefore = availInAfter;
 
-      var newReq = self._binding.write(self._flush,
-                                       chunk,
-                                       inOff,
-                                       availInBefore,
-                                       self._buffer,
-                                       self._offset,
-                                       self._chunkSize);
-      newReq.callback = callback; // this same function
-      newReq.buffer = chunk;
-      self._processing = newReq;
+      write(self._chunkSize);
       return;
     }
 
@@ -400,6 +606,35 @@ Zlib.prototype._process = function() {
     if (cb) cb();
     self._process();
   }
+
+  function write(availOut) {
+    if (inline) {
+      var result = self._binding.writeSync(self._flush,
+                                           chunk,
+                                           inOff,
+                                           availInBefore,
+                                           self._buffer,
+                                           self._offset,
+                                           availOut);
+      // Still call back on a later tick, like the thread pool does.
+      process.nextTick(function() {
+        callback(result[0], result[1]);
+      });
+      self._processing = true;
+      return;
+    }
+
+    var req = self._binding.write(self._flush,
+                                  chunk, // in
+                                  inOff, // in_off
+                                  availInBefore, // in_len
+                                  self._buffer, // out
+                                  self._offset, //out_off
+                                  availOut); // out_len
+    req.buffer = chunk;
+    req.callback = callback; // this same function
+    self._processing = req;
+  }
 };
 
 Zlib.prototype.pause = function() {
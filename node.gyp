@@ -6,6 +6,7 @@
     'werror': '',
     'target_arch': 'ia32',
     'node_use_dtrace': 'false',
+    'node_use_systemtap': 'false',
     'node_use_openssl%': 'true',
     'node_use_system_openssl%': 'false',
     'node_isolate': 'true',
@@ -30,8 +31,10 @@
       'lib/https.js',
       'lib/module.js',
       'lib/net.js',
+      'lib/numeric.js',
       'lib/os.js',
       'lib/path.js',
+      'lib/profiler.js',
       'lib/punycode.js',
       'lib/querystring.js',
       'lib/readline.js',
@@ -45,6 +48,7 @@
       'lib/url.js',
       'lib/util.js',
       'lib/vm.js',
+      'lib/websocket.js',
       'lib/zlib.js',
     ],
   },
@@ -71,6 +75,7 @@
       'sources': [
         'src/fs_event_wrap.cc',
         'src/cares_wrap.cc',
+        'src/channel_wrap.cc',
         'src/handle_wrap.cc',
         'src/node.cc',
         'src/node_buffer.cc',
@@ -79,13 +84,20 @@
         'src/node_file.cc',
         'src/node_http_parser.cc',
         'src/node_javascript.cc',
+        'src/node_json.cc',
+        'src/node_log.cc',
+        'src/node_numeric.cc',
         'src/node_os.cc',
+        'src/node_profiler.cc',
         'src/node_script.cc',
         'src/node_string.cc',
+        'src/node_util.cc',
+        'src/node_websocket.cc',
         'src/node_zlib.cc',
         'src/pipe_wrap.cc',
         'src/stream_wrap.cc',
         'src/tcp_wrap.cc',
+        'src/timer_wheel.cc',
         'src/timer_wrap.cc',
         'src/tty_wrap.cc',
         'src/process_wrap.cc',
@@ -97,6 +109,8 @@
         'src/node_buffer.h',
         'src/node_constants.h',
         'src/node_crypto.h',
+        'src/node_crypto_bio.h',
+        'src/node_crypto_groups.h',
         'src/node_extensions.h',
         'src/node_file.h',
         'src/node_http_parser.h',
@@ -106,10 +120,12 @@
         'src/node_script.h',
         'src/node_string.h',
         'src/node_version.h',
+        'src/node_zlib.h',
         'src/pipe_wrap.h',
         'src/platform.h',
         'src/req_wrap.h',
         'src/stream_wrap.h',
+        'src/udp_wrap.h',
         'src/v8_typed_array.h',
         'deps/http_parser/http_parser.h',
         'deps/v8/include/v8.h',
@@ -131,7 +147,7 @@
       'conditions': [
         [ 'node_use_openssl=="true"', {
           'defines': [ 'HAVE_OPENSSL=1' ],
-          'sources': [ 'src/node_crypto.cc' ],
+          'sources': [ 'src/node_crypto.cc', 'src/node_crypto_bio.cc' ],
           'conditions': [
             [ 'node_use_system_openssl=="false"', {
               'dependencies': [ './deps/openssl/openssl.gyp:openssl' ],
@@ -157,6 +173,14 @@
           ],
         }],
 
+        [ 'node_use_systemtap=="true"', {
+          'defines': [ 'HAVE_SYSTEMTAP=1' ],
+          'sources': [
+            'src/node_dtrace.cc',
+            'src/node_dtrace.h',
+          ],
+        }],
+
         [ 'OS=="win"', {
           'sources': [
             'src/platform_win32.cc',
@@ -176,6 +200,9 @@
             'src/node_signal_watcher.cc',
             'src/node_stat_watcher.cc',
             'src/node_io_watcher.cc',
+            'src/shm_ring_wrap.cc',
+            'src/node_file_cache.cc',
+            'src/node_shm_cache.cc',
           ]
         }],
         [ 'OS=="mac"', {
@@ -265,14 +292,14 @@
           # action?
 
           'conditions': [
-            [ 'node_use_dtrace=="true"', {
+            [ 'node_use_dtrace=="true" or node_use_systemtap=="true"', {
               'action': [
                 'python',
                 'tools/js2c.py',
                 '<@(_outputs)',
                 '<@(library_files)'
               ],
-            }, { # No Dtrace
+            }, { # No probes
               'action': [
                 'python',
                 'tools/js2c.py',
@@ -285,6 +312,43 @@
         },
       ],
     }, # end node_js2c
-  ] # end targets
+  ], # end targets
+
+  'conditions': [
+    [ 'node_isolate=="true" and OS!="win"', {
+      'targets': [
+        {
+          # Starts isolates side by side: benchmark/startup/isolates.cc
+          'target_name': 'node_bench_isolates',
+          'type': 'executable',
+
+          'dependencies': [
+            'libnode',
+          ],
+
+          'include_dirs': [
+            'src',
+            'deps/v8/include',
+            'deps/uv/include',
+          ],
+
+          'sources': [
+            'benchmark/startup/isolates.cc',
+          ],
+
+          'defines': [
+            '_LARGEFILE_SOURCE',
+            '_FILE_OFFSET_BITS=64',
+          ],
+
+          'conditions': [
+            [ 'OS=="linux"', {
+              'libraries': [ '-lpthread', '-lrt' ],
+            }],
+          ],
+        },
+      ],
+    }],
+  ],
 }
 
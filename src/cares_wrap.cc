@@ -26,6 +26,10 @@
 #include <uv.h>
 
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <sys/stat.h>
 
 #if defined(__OpenBSD__) || defined(__MINGW32__) || defined(_MSC_VER) || defined(ANDROID)
 # include <nameser.h>
@@ -67,17 +71,50 @@ using v8::Persistent;
 using v8::String;
 using v8::Value;
 
+struct HostsEntry {
+  char* name;
+  int family;
+  char address[INET6_ADDRSTRLEN];
+};
+
 class CaresWrapStatics : public ModuleStatics {
 public:
     Persistent<String> oncomplete_sym;
     struct ares_channeldata *ares_channel;
+
+    // Parsed hosts file, see HostsLookup().
+    HostsEntry* hosts;
+    int hosts_count;
+    time_t hosts_mtime;
+    uint64_t hosts_checked;
+
     CaresWrapStatics() {
       ares_channel = 0;
+      hosts = NULL;
+      hosts_count = 0;
+      hosts_mtime = 0;
+      hosts_checked = 0;
+    }
+
+    ~CaresWrapStatics() {
+      FreeHosts();
+    }
+
+    void FreeHosts() {
+      for (int i = 0; i < hosts_count; i++) free(hosts[i].name);
+      free(hosts);
+      hosts = NULL;
+      hosts_count = 0;
     }
 };
 
 typedef class ReqWrap<uv_getaddrinfo_t> GetAddrInfoReqWrap;
 
+// Upper bound on the number of per-address TTLs we ask c-ares for. Answers
+// with more records than this still parse, the extra TTLs are just ignored.
+#define MAX_ADDRTTLS 64
+
+
 static Local<Array> HostentToAddresses(struct hostent* host) {
   HandleScope scope;
   Local<Array> addresses = Array::New();
@@ -151,6 +188,132 @@ static void SetAresErrno(int errorno) {
 }
 
 
+// How often, in nanoseconds, the hosts file is stat'ed for changes.
+#define HOSTS_CHECK_INTERVAL (5 * 1000000000ULL)
+
+
+static int HostsPath(char* buf, size_t size) {
+#ifdef _WIN32
+  const char* root = getenv("SystemRoot");
+  if (root == NULL) return -1;
+  return snprintf(buf, size, "%s\\System32\\drivers\\etc\\hosts", root) <
+         (int) size ? 0 : -1;
+#else
+  return snprintf(buf, size, "/etc/hosts") < (int) size ? 0 : -1;
+#endif
+}
+
+
+static int HostsAdd(CaresWrapStatics* statics, int* alloc, const char* name,
+    int family, const char* address) {
+  if (statics->hosts_count == *alloc) {
+    int n = *alloc ? *alloc * 2 : 16;
+    HostsEntry* hosts = (HostsEntry*) realloc(statics->hosts,
+                                              n * sizeof(HostsEntry));
+    if (hosts == NULL) return -1;
+    statics->hosts = hosts;
+    *alloc = n;
+  }
+
+  HostsEntry* entry = &statics->hosts[statics->hosts_count];
+  entry->name = strdup(name);
+  if (entry->name == NULL) return -1;
+  entry->family = family;
+  strncpy(entry->address, address, sizeof(entry->address) - 1);
+  entry->address[sizeof(entry->address) - 1] = '\0';
+  statics->hosts_count++;
+  return 0;
+}
+
+
+static void HostsParse(CaresWrapStatics* statics, FILE* fp) {
+  char line[1024];
+  char addr[16];
+  int alloc = 0;
+
+  statics->FreeHosts();
+
+  while (fgets(line, sizeof(line), fp)) {
+    char* p = strchr(line, '#');
+    if (p) *p = '\0';
+
+    char* address = strtok(line, " \t\r\n");
+    if (address == NULL) continue;
+
+    int family;
+    if (uv_inet_pton(AF_INET, address, addr) == 1) {
+      family = 4;
+    } else if (uv_inet_pton(AF_INET6, address, addr) == 1) {
+      family = 6;
+    } else {
+      continue;
+    }
+
+    char* name;
+    while ((name = strtok(NULL, " \t\r\n"))) {
+      if (HostsAdd(statics, &alloc, name, family, address)) return;
+    }
+  }
+}
+
+
+// The hosts file is read into memory the first time it is needed and
+// re-read only when its mtime changes, which is checked at most every
+// HOSTS_CHECK_INTERVAL. That keeps the lookup path free of file I/O.
+static void HostsRefresh(CaresWrapStatics* statics) {
+  uint64_t now = uv_hrtime();
+  if (statics->hosts_checked &&
+      now - statics->hosts_checked < HOSTS_CHECK_INTERVAL) {
+    return;
+  }
+  statics->hosts_checked = now;
+
+  char path[1024];
+  struct stat st;
+  if (HostsPath(path, sizeof(path)) || stat(path, &st)) {
+    statics->FreeHosts();
+    statics->hosts_mtime = 0;
+    return;
+  }
+
+  if (st.st_mtime == statics->hosts_mtime && statics->hosts != NULL) return;
+
+  FILE* fp = fopen(path, "r");
+  if (fp == NULL) return;
+
+  HostsParse(statics, fp);
+  statics->hosts_mtime = st.st_mtime;
+  fclose(fp);
+}
+
+
+static int HostsNameEqual(const char* a, const char* b) {
+  while (*a && tolower((unsigned char) *a) == tolower((unsigned char) *b)) {
+    a++;
+    b++;
+  }
+  return *a == *b;
+}
+
+
+// Returns the first hosts file entry for `name` in the wanted family (4, 6
+// or 0 for either), or NULL.
+static HostsEntry* HostsLookup(const char* name, int family) {
+  CaresWrapStatics *statics = NODE_STATICS_GET(node_cares_wrap, CaresWrapStatics);
+  HostsRefresh(statics);
+
+  for (int i = 0; i < statics->hosts_count; i++) {
+    HostsEntry* entry = &statics->hosts[i];
+    if ((family == 0 || entry->family == family) &&
+        HostsNameEqual(entry->name, name)) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+
 class QueryWrap {
  public:
   QueryWrap() {
@@ -232,6 +395,13 @@ class QueryWrap {
     MakeCallback(object_, "oncomplete", 3, argv);
   }
 
+  void CallOnComplete(Local<Value> answer, Local<Value> family,
+      Local<Value> ttl) {
+    HandleScope scope;
+    Local<Value> argv[4] = { Integer::New(0), answer, family, ttl };
+    MakeCallback(object_, "oncomplete", 4, argv);
+  }
+
   void ParseError(int status) {
     assert(status != ARES_SUCCESS);
     SetAresErrno(status);
@@ -269,7 +439,10 @@ class QueryAWrap: public QueryWrap {
 
     struct hostent* host;
 
-    int status = ares_parse_a_reply(buf, len, &host, NULL, NULL);
+    struct ares_addrttl addrttls[MAX_ADDRTTLS];
+    int naddrttls = MAX_ADDRTTLS;
+
+    int status = ares_parse_a_reply(buf, len, &host, addrttls, &naddrttls);
     if (status != ARES_SUCCESS) {
       this->ParseError(status);
       return;
@@ -278,7 +451,12 @@ class QueryAWrap: public QueryWrap {
     Local<Array> addresses = HostentToAddresses(host);
     ares_free_hostent(host);
 
-    this->CallOnComplete(addresses);
+    int ttl = -1;
+    for (int i = 0; i < naddrttls; i++) {
+      if (ttl < 0 || addrttls[i].ttl < ttl) ttl = addrttls[i].ttl;
+    }
+
+    this->CallOnComplete(addresses, Integer::New(ttl));
   }
 };
 
@@ -302,7 +480,10 @@ class QueryAaaaWrap: public QueryWrap {
 
     struct hostent* host;
 
-    int status = ares_parse_aaaa_reply(buf, len, &host, NULL, NULL);
+    struct ares_addr6ttl addrttls[MAX_ADDRTTLS];
+    int naddrttls = MAX_ADDRTTLS;
+
+    int status = ares_parse_aaaa_reply(buf, len, &host, addrttls, &naddrttls);
     if (status != ARES_SUCCESS) {
       this->ParseError(status);
       return;
@@ -311,7 +492,12 @@ class QueryAaaaWrap: public QueryWrap {
     Local<Array> addresses = HostentToAddresses(host);
     ares_free_hostent(host);
 
-    this->CallOnComplete(addresses);
+    int ttl = -1;
+    for (int i = 0; i < naddrttls; i++) {
+      if (ttl < 0 || addrttls[i].ttl < ttl) ttl = addrttls[i].ttl;
+    }
+
+    this->CallOnComplete(addresses, Integer::New(ttl));
   }
 };
 
@@ -553,6 +739,120 @@ class GetHostByNameWrap: public QueryWrap {
 };
 
 
+// dns.lookup() through c-ares. Unlike ares_gethostbyname() this never reads
+// the hosts file (that is HostsLookup's job, from memory) and prefers IPv4
+// for unspecified families like getaddrinfo does: A first, then AAAA.
+class LookupWrap: public QueryWrap {
+ public:
+  LookupWrap() : name_(NULL), family_(0), type_(ns_t_a) {
+  }
+
+  ~LookupWrap() {
+    free(name_);
+  }
+
+  int Send(const char* name, int family) {
+    name_ = strdup(name);
+    if (name_ == NULL) return ARES_ENOMEM;
+
+    family_ = family;
+    type_ = family == 6 ? ns_t_aaaa : ns_t_a;
+    Search();
+    return 0;
+  }
+
+ protected:
+  void Search() {
+    CaresWrapStatics *statics = NODE_STATICS_GET(node_cares_wrap, CaresWrapStatics);
+    ares_search(statics->ares_channel,
+                name_,
+                ns_c_in,
+                type_,
+                SearchCallback,
+                GetQueryArg());
+  }
+
+  static void SearchCallback(void *arg, int status, int timeouts,
+      unsigned char* answer_buf, int answer_len) {
+    LookupWrap* wrap = reinterpret_cast<LookupWrap*>(arg);
+
+    if (status == ARES_SUCCESS) {
+      status = wrap->ParseAnswer(answer_buf, answer_len);
+      if (status == ARES_SUCCESS) {
+        delete wrap;
+        return;
+      }
+    }
+
+    if (wrap->family_ == 0 && wrap->type_ == ns_t_a &&
+        (status == ARES_ENODATA || status == ARES_ENOTFOUND)) {
+      wrap->type_ = ns_t_aaaa;
+      wrap->Search();
+      return;
+    }
+
+    wrap->ParseError(status);
+    delete wrap;
+  }
+
+  int ParseAnswer(unsigned char* buf, int len) {
+    HandleScope scope;
+
+    struct hostent* host;
+    struct ares_addrttl addrttls[MAX_ADDRTTLS];
+    struct ares_addr6ttl addr6ttls[MAX_ADDRTTLS];
+    int naddrttls = MAX_ADDRTTLS;
+    int status;
+
+    if (type_ == ns_t_a) {
+      status = ares_parse_a_reply(buf, len, &host, addrttls, &naddrttls);
+    } else {
+      status = ares_parse_aaaa_reply(buf, len, &host, addr6ttls, &naddrttls);
+    }
+    if (status != ARES_SUCCESS) return status;
+
+    int ttl = -1;
+    for (int i = 0; i < naddrttls; i++) {
+      int t = type_ == ns_t_a ? addrttls[i].ttl : addr6ttls[i].ttl;
+      if (ttl < 0 || t < ttl) ttl = t;
+    }
+
+    Local<Array> addresses = HostentToAddresses(host);
+    ares_free_hostent(host);
+
+    if (addresses->Length() == 0) return ARES_ENODATA;
+
+    this->CallOnComplete(addresses,
+                         Integer::New(type_ == ns_t_a ? 4 : 6),
+                         Integer::New(ttl));
+    return ARES_SUCCESS;
+  }
+
+ private:
+  char* name_;
+  int family_;
+  int type_;
+};
+
+
+// Synchronous, in-memory hosts file lookup:
+// hostsLookup(name, family) -> [address, family] or null.
+static Handle<Value> HostsLookup(const Arguments& args) {
+  HandleScope scope;
+
+  String::Utf8Value name(args[0]->ToString());
+  int family = args[1]->Int32Value();
+
+  HostsEntry* entry = HostsLookup(*name, family);
+  if (entry == NULL) return scope.Close(v8::Null());
+
+  Local<Array> result = Array::New(2);
+  result->Set(0, String::New(entry->address));
+  result->Set(1, Integer::New(entry->family));
+  return scope.Close(result);
+}
+
+
 template <class Wrap>
 static Handle<Value> Query(const Arguments& args) {
   HandleScope scope;
@@ -764,6 +1064,9 @@ static void Initialize(Handle<Object> target) {
   NODE_SET_METHOD(target, "getHostByAddr", Query<GetHostByAddrWrap>);
   NODE_SET_METHOD(target, "getHostByName", QueryWithFamily<GetHostByNameWrap>);
 
+  NODE_SET_METHOD(target, "lookup", QueryWithFamily<LookupWrap>);
+  NODE_SET_METHOD(target, "hostsLookup", HostsLookup);
+
   NODE_SET_METHOD(target, "getaddrinfo", GetAddrInfo);
 
   target->Set(String::NewSymbol("AF_INET"), Integer::New(AF_INET));
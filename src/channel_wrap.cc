@@ -0,0 +1,592 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <node.h>
+#include <node_buffer.h>
+#include <handle_wrap.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define UNWRAP(type) \
+  assert(!args.Holder().IsEmpty()); \
+  assert(args.Holder()->InternalFieldCount() > 0); \
+  type* wrap = \
+      static_cast<type*>(args.Holder()->GetPointerFromInternalField(0)); \
+  if (!wrap) { \
+    uv_err_t err; \
+    err.code = UV_EBADF; \
+    SetErrno(err); \
+    return scope.Close(Integer::New(-1)); \
+  }
+
+// ATOMIC_XCHG is only an acquire barrier with gcc, so stores made before
+// it may become visible after it. ATOMIC_BARRIER is a full fence.
+#ifdef _WIN32
+# define ATOMIC_XCHG(p, v) InterlockedExchangePointer((PVOID volatile*) (p), (v))
+# define ATOMIC_BARRIER() MemoryBarrier()
+#else
+# define ATOMIC_XCHG(p, v) __sync_lock_test_and_set((p), (v))
+# define ATOMIC_BARRIER() __sync_synchronize()
+#endif
+
+namespace node {
+
+using v8::Object;
+using v8::Handle;
+using v8::Local;
+using v8::Persistent;
+using v8::Value;
+using v8::HandleScope;
+using v8::FunctionTemplate;
+using v8::String;
+using v8::Array;
+using v8::Function;
+using v8::Context;
+using v8::Arguments;
+using v8::Integer;
+using v8::Exception;
+using v8::ThrowException;
+
+
+// Channels carry messages between isolates of the same process. A channel
+// is a mailbox with a single reader, the isolate that created it, and any
+// number of writers, which connect to it by id. Writers push onto a
+// lock-free queue and wake the reader's loop with uv_async_send.
+//
+// A message is a JSON string plus the buffers it refers to. Buffers that
+// own their whole SlowBuffer are transferred by handing the storage over;
+// slices of shared pools are copied. The host posts to channels the same
+// way, see PostChannelMessage() and PostChannelTask() in node.h.
+
+struct ChannelNode {
+  ChannelNode* volatile next;
+};
+
+
+struct ChannelPart {
+  char* data;
+  size_t length;
+  Buffer::free_callback callback;
+  void* hint;
+};
+
+
+struct ChannelMessage : public ChannelNode {
+  char* json;
+  size_t json_length;
+  int part_count;
+  ChannelPart* parts;
+  // set for a message that is a host task instead
+  ChannelTask task;
+  void* task_arg;
+
+  ChannelMessage() : json(NULL), json_length(0), part_count(0), parts(NULL),
+                     task(NULL), task_arg(NULL) {}
+
+  ~ChannelMessage() {
+    if (task) task(task_arg, -1);
+    delete [] json;
+    for (int i = 0; i < part_count; i++) {
+      if (parts[i].data) parts[i].callback(parts[i].data, parts[i].hint);
+    }
+    delete [] parts;
+  }
+};
+
+
+static void FreeCopy(char* data, void* hint) {
+  delete [] data;
+}
+
+
+class Mailbox {
+ public:
+  Mailbox(uv_async_t* async) : async_(async), closed_(false), refs_(1) {
+    uv_rwlock_init(&lock_);
+    stub_.next = NULL;
+    head_ = &stub_;
+    tail_ = &stub_;
+  }
+
+  ~Mailbox() {
+    while (ChannelMessage* message = Pop()) delete message;
+    uv_rwlock_destroy(&lock_);
+  }
+
+  // Any thread. Takes ownership of the message; returns false, and frees
+  // it, if the reader has gone away.
+  bool Post(ChannelMessage* message) {
+    uv_rwlock_rdlock(&lock_);
+    bool open = !closed_;
+    if (open) {
+      Push(message);
+      uv_async_send(async_);
+    }
+    uv_rwlock_rdunlock(&lock_);
+
+    if (!open) delete message;
+    return open;
+  }
+
+  // Reader thread. Once this returns no writer touches the async handle.
+  void Close() {
+    uv_rwlock_wrlock(&lock_);
+    closed_ = true;
+    uv_rwlock_wrunlock(&lock_);
+  }
+
+  // Reader thread. Returns NULL when the queue is empty, or when a writer
+  // is half way through a push; its uv_async_send follows.
+  ChannelMessage* Pop() {
+    ChannelNode* tail = tail_;
+    ChannelNode* next = LoadAcquire(&tail->next);
+
+    if (tail == &stub_) {
+      if (next == NULL) return NULL;
+      tail_ = next;
+      tail = next;
+      next = LoadAcquire(&next->next);
+    }
+
+    if (next == NULL) {
+      if (tail != head_) return NULL;
+      Push(&stub_);
+      next = LoadAcquire(&tail->next);
+      if (next == NULL) return NULL;
+    }
+
+    tail_ = next;
+    return static_cast<ChannelMessage*>(tail);
+  }
+
+  static Mailbox* Acquire(int id);
+  static void Release(Mailbox* mailbox);
+  static int Register(Mailbox* mailbox);
+  static void Unregister(Mailbox* mailbox);
+
+ private:
+  // A node is published twice: to other writers by the exchange on head_,
+  // and to the reader by the store to prev->next. Both are release points:
+  // the fences keep the message's contents and its NULL next from becoming
+  // visible after either. Pop() pairs with the second through LoadAcquire().
+  void Push(ChannelNode* node) {
+    node->next = NULL;
+    ATOMIC_BARRIER();
+    ChannelNode* prev = static_cast<ChannelNode*>(ATOMIC_XCHG(&head_, node));
+    ATOMIC_BARRIER();
+    prev->next = node;
+  }
+
+  // Reads a next pointer; what the node it points to holds is then visible.
+  static ChannelNode* LoadAcquire(ChannelNode* volatile* p) {
+    ChannelNode* node = *p;
+    ATOMIC_BARRIER();
+    return node;
+  }
+
+  ChannelNode* volatile head_;
+  ChannelNode* tail_;
+  ChannelNode stub_;
+
+  uv_async_t* async_;
+  uv_rwlock_t lock_;
+  bool closed_;
+
+  // guarded by the registry
+  int id_;
+  int refs_;
+  Mailbox* registry_next_;
+};
+
+
+static struct ChannelRegistry {
+  ChannelRegistry() {
+    uv_mutex_init(&mutex);
+    head = NULL;
+    next_id = 1;
+  }
+
+  uv_mutex_t mutex;
+  Mailbox* head;
+  int next_id;
+} registry;
+
+
+int Mailbox::Register(Mailbox* mailbox) {
+  uv_mutex_lock(&registry.mutex);
+  mailbox->id_ = registry.next_id++;
+  mailbox->registry_next_ = registry.head;
+  registry.head = mailbox;
+  uv_mutex_unlock(&registry.mutex);
+  return mailbox->id_;
+}
+
+
+// Hides the mailbox from Acquire() and drops the reader's reference.
+void Mailbox::Unregister(Mailbox* mailbox) {
+  uv_mutex_lock(&registry.mutex);
+  for (Mailbox** p = &registry.head; *p; p = &(*p)->registry_next_) {
+    if (*p == mailbox) {
+      *p = mailbox->registry_next_;
+      break;
+    }
+  }
+  uv_mutex_unlock(&registry.mutex);
+  Release(mailbox);
+}
+
+
+Mailbox* Mailbox::Acquire(int id) {
+  uv_mutex_lock(&registry.mutex);
+  Mailbox* mailbox = registry.head;
+  while (mailbox && mailbox->id_ != id) mailbox = mailbox->registry_next_;
+  if (mailbox) mailbox->refs_++;
+  uv_mutex_unlock(&registry.mutex);
+  return mailbox;
+}
+
+
+void Mailbox::Release(Mailbox* mailbox) {
+  uv_mutex_lock(&registry.mutex);
+  bool last = --mailbox->refs_ == 0;
+  uv_mutex_unlock(&registry.mutex);
+  if (last) delete mailbox;
+}
+
+
+// The reading end, owned by the isolate that created it.
+class ChannelWrap : public HandleWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    HandleWrap::Initialize(target);
+
+    Local<FunctionTemplate> constructor = FunctionTemplate::New(New);
+    constructor->InstanceTemplate()->SetInternalFieldCount(1);
+    constructor->SetClassName(String::NewSymbol("Channel"));
+
+    NODE_SET_PROTOTYPE_METHOD(constructor, "close", Close);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "unref", HandleWrap::Unref);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "ref", HandleWrap::Ref);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "flush", Flush);
+
+    target->Set(String::NewSymbol("Channel"), constructor->GetFunction());
+  }
+
+ private:
+  static Handle<Value> New(const Arguments& args) {
+    // This constructor should not be exposed to public javascript.
+    // Therefore we assert that we are not trying to call this as a
+    // normal function.
+    assert(args.IsConstructCall());
+
+    HandleScope scope;
+    ChannelWrap* wrap = new ChannelWrap(args.This());
+    assert(wrap);
+
+    return scope.Close(args.This());
+  }
+
+  ChannelWrap(Handle<Object> object)
+      : HandleWrap(object, (uv_handle_t*) &handle_) {
+    int r = uv_async_init(Isolate::GetCurrentLoop(), &handle_, OnAsync);
+    assert(r == 0);
+    handle_.data = this;
+
+    mailbox_ = new Mailbox(&handle_);
+    int id = Mailbox::Register(mailbox_);
+    object->Set(String::NewSymbol("id"), Integer::New(id));
+
+    Isolate::GetCurrent()->AddCleanupHook(OnIsolateCleanup, this);
+  }
+
+  void Shutdown() {
+    if (!mailbox_) return;
+    mailbox_->Close();
+    Mailbox::Unregister(mailbox_);
+    mailbox_ = NULL;
+  }
+
+  static void OnIsolateCleanup(void* arg) {
+    static_cast<ChannelWrap*>(arg)->Shutdown();
+  }
+
+  static Handle<Value> Close(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP(ChannelWrap)
+
+    Isolate::GetCurrent()->RemoveCleanupHook(OnIsolateCleanup, wrap);
+    wrap->Shutdown();
+
+    return HandleWrap::Close(args);
+  }
+
+  // Delivers the messages that have arrived without waiting for the loop,
+  // such as the last ones of a writer that is known to be done.
+  static Handle<Value> Flush(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP(ChannelWrap)
+
+    wrap->Deliver();
+
+    return scope.Close(Integer::New(0));
+  }
+
+  static void OnAsync(uv_async_t* handle, int status) {
+    ChannelWrap* wrap = static_cast<ChannelWrap*>(handle->data);
+    assert(wrap);
+    wrap->Deliver();
+  }
+
+  void Deliver() {
+    HandleScope scope;
+
+    while (mailbox_) {
+      ChannelMessage* message = mailbox_->Pop();
+      if (message == NULL) break;
+
+      if (message->task) {
+        ChannelTask task = message->task;
+        message->task = NULL;
+        void* arg = message->task_arg;
+        delete message;
+        task(arg, 0);
+        continue;
+      }
+
+      Local<Array> buffers = Array::New(message->part_count);
+      for (int i = 0; i < message->part_count; i++) {
+        ChannelPart* part = &message->parts[i];
+        Buffer* buffer = Buffer::New(part->data, part->length,
+                                     part->callback, part->hint);
+        part->data = NULL;
+        buffers->Set(i, buffer->handle_);
+      }
+
+      Local<Value> argv[2] = {
+        String::New(message->json, message->json_length),
+        buffers
+      };
+      delete message;
+
+      // The callback may close the channel.
+      MakeCallback(object_, "onmessage", 2, argv);
+    }
+  }
+
+  uv_async_t handle_;
+  Mailbox* mailbox_;
+};
+
+
+// A writing end, in any isolate.
+class ChannelPort : public ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    Local<FunctionTemplate> constructor = FunctionTemplate::New(New);
+    constructor->InstanceTemplate()->SetInternalFieldCount(1);
+    constructor->SetClassName(String::NewSymbol("ChannelPort"));
+
+    NODE_SET_PROTOTYPE_METHOD(constructor, "post", Post);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "close", Close);
+
+    target->Set(String::NewSymbol("ChannelPort"),
+                constructor->GetFunction());
+  }
+
+ private:
+  ChannelPort(Mailbox* mailbox) : mailbox_(mailbox) {}
+
+  ~ChannelPort() {
+    if (mailbox_) Mailbox::Release(mailbox_);
+  }
+
+  static Handle<Value> New(const Arguments& args) {
+    assert(args.IsConstructCall());
+
+    HandleScope scope;
+
+    Mailbox* mailbox = Mailbox::Acquire(args[0]->Int32Value());
+    if (!mailbox) {
+      return ThrowException(Exception::Error(
+          String::New("No channel with that id")));
+    }
+
+    ChannelPort* port = new ChannelPort(mailbox);
+    port->Wrap(args.This());
+
+    return scope.Close(args.This());
+  }
+
+  // post(json, slowBuffers, offsets, lengths)
+  static Handle<Value> Post(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP(ChannelPort)
+
+    if (!wrap->mailbox_) {
+      uv_err_t err;
+      err.code = UV_EPIPE;
+      SetErrno(err);
+      return scope.Close(Integer::New(-1));
+    }
+
+    String::Utf8Value json(args[0]);
+    Local<Array> buffers = Local<Array>::Cast(args[1]);
+    Local<Array> offsets = Local<Array>::Cast(args[2]);
+    Local<Array> lengths = Local<Array>::Cast(args[3]);
+
+    ChannelMessage* message = new ChannelMessage;
+    message->json_length = json.length();
+    message->json = new char[message->json_length];
+    memcpy(message->json, *json, message->json_length);
+    message->part_count = buffers->Length();
+    message->parts = new ChannelPart[message->part_count];
+
+    for (int i = 0; i < message->part_count; i++) {
+      Local<Object> obj = buffers->Get(i)->ToObject();
+      size_t offset = offsets->Get(i)->Uint32Value();
+      size_t length = lengths->Get(i)->Uint32Value();
+      ChannelPart* part = &message->parts[i];
+
+      assert(Buffer::HasInstance(obj));
+      assert(offset + length <= Buffer::Length(obj));
+
+      // Hand the storage over when the buffer is all of it
+      char* data = NULL;
+      if (offset == 0 && length == Buffer::Length(obj)) {
+        data = Buffer::Detach(obj, &part->length);
+      }
+
+      if (data) {
+        part->data = data;
+        part->callback = Buffer::FreeDetached;
+        part->hint = reinterpret_cast<void*>(part->length);
+      } else {
+        part->data = new char[length ? length : 1];
+        part->length = length;
+        part->callback = FreeCopy;
+        part->hint = NULL;
+        memcpy(part->data, Buffer::Data(obj) + offset, length);
+      }
+    }
+
+    if (!wrap->mailbox_->Post(message)) {
+      uv_err_t err;
+      err.code = UV_EPIPE;
+      SetErrno(err);
+      return scope.Close(Integer::New(-1));
+    }
+
+    return scope.Close(Integer::New(0));
+  }
+
+  static Handle<Value> Close(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP(ChannelPort)
+
+    if (wrap->mailbox_) {
+      Mailbox::Release(wrap->mailbox_);
+      wrap->mailbox_ = NULL;
+    }
+
+    return scope.Close(Integer::New(0));
+  }
+
+  Mailbox* mailbox_;
+};
+
+
+static int PostToChannel(int id, ChannelMessage* message) {
+  Mailbox* mailbox = Mailbox::Acquire(id);
+  if (!mailbox) {
+    delete message;
+    return -1;
+  }
+
+  bool posted = mailbox->Post(message);
+  Mailbox::Release(mailbox);
+  return posted ? 0 : -1;
+}
+
+
+int PostChannelMessage(int id, const char* json, size_t json_length,
+                       const ChannelBuffer* buffers, int count) {
+  ChannelMessage* message = new ChannelMessage;
+  message->part_count = count;
+  message->parts = new ChannelPart[count];
+  for (int i = 0; i < count; i++) {
+    message->parts[i].data = buffers[i].data;
+    message->parts[i].length = buffers[i].length;
+    message->parts[i].callback = buffers[i].free_cb;
+    message->parts[i].hint = buffers[i].hint;
+  }
+
+  if (json) {
+    message->json_length = json_length;
+    message->json = new char[json_length ? json_length : 1];
+    memcpy(message->json, json, json_length);
+  } else {
+    // [{"\u0000buffer":0},...]
+    static const char placeholder[] = "{\"\\u0000buffer\":%d}";
+    size_t size = 2 + count * (sizeof(placeholder) + 12);
+    message->json = new char[size];
+    size_t length = 0;
+    message->json[length++] = '[';
+    for (int i = 0; i < count; i++) {
+      if (i > 0) message->json[length++] = ',';
+      length += snprintf(message->json + length, size - length,
+                         placeholder, i);
+    }
+    message->json[length++] = ']';
+    message->json_length = length;
+  }
+
+  return PostToChannel(id, message);
+}
+
+
+int PostChannelTask(int id, ChannelTask task, void* arg) {
+  assert(task);
+  ChannelMessage* message = new ChannelMessage;
+  message->task = task;
+  message->task_arg = arg;
+  return PostToChannel(id, message);
+}
+
+
+static void InitChannelWrap(Handle<Object> target) {
+  ChannelWrap::Initialize(target);
+  ChannelPort::Initialize(target);
+}
+
+
+}  // namespace node
+
+NODE_MODULE(node_channel_wrap, node::InitChannelWrap)
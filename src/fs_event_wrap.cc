@@ -23,6 +23,9 @@
 #include <handle_wrap.h>
 
 #include <stdlib.h>
+#include <map>
+#include <string>
+#include <vector>
 
 using namespace v8;
 
@@ -53,9 +56,23 @@ private:
 
   static void OnEvent(uv_fs_event_t* handle, const char* filename, int events,
     int status);
+  static void OnWindow(uv_timer_t* handle, int status);
+  static void OnWindowClose(uv_handle_t* handle);
+
+  void Queue(const char* filename, int events);
+  void Flush();
 
   uv_fs_event_t handle_;
   bool initialized_;
+
+  // With a delay, events are coalesced for that many milliseconds from the
+  // first one and delivered together. Pending changes are kept in order of
+  // arrival, with the events seen for each filename or'ed together; a NULL
+  // filename is kept as "\0", which no real one can be.
+  uv_timer_t* window_;
+  int64_t delay_;
+  std::vector<std::string> pending_;
+  std::map<std::string, int> pending_events_;
 };
 
 
@@ -63,11 +80,14 @@ FSEventWrap::FSEventWrap(Handle<Object> object): HandleWrap(object,
                                                     (uv_handle_t*)&handle_) {
   handle_.data = reinterpret_cast<void*>(this);
   initialized_ = false;
+  window_ = NULL;
+  delay_ = 0;
 }
 
 
 FSEventWrap::~FSEventWrap() {
   assert(initialized_ == false);
+  assert(window_ == NULL);
 }
 
 
@@ -109,14 +129,26 @@ Handle<Value> FSEventWrap::Start(const Arguments& args) {
 
   String::Utf8Value path(args[0]->ToString());
 
+  int64_t delay = args[2]->IntegerValue();
+  int flags = args[3]->IsTrue() ? UV_FS_EVENT_RECURSIVE : 0;
+
   uv_loop_t *loop = Isolate::GetCurrentLoop();
-  int r = uv_fs_event_init(loop, &wrap->handle_, *path, OnEvent, 0);
+  int r = uv_fs_event_init(loop, &wrap->handle_, *path, OnEvent, flags);
   if (r == 0) {
     // Check for persistent argument
     if (!args[1]->IsTrue()) {
       uv_unref(loop);
     }
     wrap->initialized_ = true;
+
+    if (delay > 0) {
+      wrap->delay_ = delay;
+      wrap->window_ = new uv_timer_t;
+      uv_timer_init(loop, wrap->window_);
+      wrap->window_->data = wrap;
+      // Whether the process stays up is up to the watcher itself.
+      uv_unref(loop);
+    }
   } else { 
     SetLastErrno();
   }
@@ -134,6 +166,16 @@ void FSEventWrap::OnEvent(uv_fs_event_t* handle, const char* filename,
 
   assert(wrap->object_.IsEmpty() == false);
 
+  if (wrap->window_ != NULL) {
+    if (status == 0) {
+      wrap->Queue(filename, events);
+      return;
+    }
+    // Changes seen before the error come first.
+    wrap->Flush();
+    if (!wrap->initialized_) return;
+  }
+
   if (status) {
     SetLastErrno();
     eventStr = String::Empty();
@@ -158,6 +200,78 @@ void FSEventWrap::OnEvent(uv_fs_event_t* handle, const char* filename,
 }
 
 
+void FSEventWrap::Queue(const char* filename, int events) {
+  std::string key = filename ? filename : std::string(1, '\0');
+
+  std::map<std::string, int>::iterator it = pending_events_.find(key);
+  if (it != pending_events_.end()) {
+    it->second |= events;
+    return;
+  }
+
+  if (pending_.empty()) {
+    uv_timer_start(window_, OnWindow, delay_, 0);
+  }
+
+  pending_.push_back(key);
+  pending_events_[key] = events;
+}
+
+
+// Delivers the pending changes as two arrays of the same length: the events
+// and the filenames, one entry for each distinct pair.
+void FSEventWrap::Flush() {
+  if (pending_.empty()) return;
+
+  HandleScope scope;
+
+  uv_timer_stop(window_);
+
+  Local<Array> events = Array::New();
+  Local<Array> filenames = Array::New();
+  Local<String> rename = String::New("rename");
+  Local<String> change = String::New("change");
+  uint32_t n = 0;
+
+  for (size_t i = 0; i < pending_.size(); i++) {
+    const std::string& key = pending_[i];
+    int mask = pending_events_[key];
+
+    Local<Value> filename = key.size() == 1 && key[0] == '\0'
+        ? Local<Value>::New(v8::Null())
+        : Local<Value>(String::New(key.data(), key.size()));
+
+    if (mask & UV_RENAME) {
+      events->Set(n, rename);
+      filenames->Set(n++, filename);
+    }
+    if (mask & UV_CHANGE) {
+      events->Set(n, change);
+      filenames->Set(n++, filename);
+    }
+  }
+
+  // The callback may close the watcher or start another window.
+  pending_.clear();
+  pending_events_.clear();
+
+  Local<Value> argv[2] = { events, filenames };
+  MakeCallback(object_, "onchanges", 2, argv);
+}
+
+
+void FSEventWrap::OnWindow(uv_timer_t* handle, int status) {
+  FSEventWrap* wrap = reinterpret_cast<FSEventWrap*>(handle->data);
+  assert(wrap->initialized_);
+  wrap->Flush();
+}
+
+
+void FSEventWrap::OnWindowClose(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_timer_t*>(handle);
+}
+
+
 Handle<Value> FSEventWrap::Close(const Arguments& args) {
   HandleScope scope;
 
@@ -167,6 +281,17 @@ Handle<Value> FSEventWrap::Close(const Arguments& args) {
     return Undefined();
 
   wrap->initialized_ = false;
+
+  // Changes still pending are dropped along with the watcher.
+  if (wrap->window_ != NULL) {
+    wrap->pending_.clear();
+    wrap->pending_events_.clear();
+    // uv_close() drops the reference uv_timer_init() took.
+    uv_ref(wrap->window_->loop);
+    uv_close(reinterpret_cast<uv_handle_t*>(wrap->window_), OnWindowClose);
+    wrap->window_ = NULL;
+  }
+
   return HandleWrap::Close(args);
 }
 
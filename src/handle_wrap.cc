@@ -57,18 +57,33 @@ void HandleWrap::Initialize(Handle<Object> target) {
 }
 
 
-// This function is used only for process.stdout. It's put here instead of
-// in TTYWrap because here we have access to the Close binding.
+// Stops the handle from keeping the loop alive, whether it is active or not.
+// Subclasses expose this as unref() and Ref() as ref(); both may be called
+// any number of times.
 Handle<Value> HandleWrap::Unref(const Arguments& args) {
   HandleScope scope;
 
   UNWRAP
 
-  // Calling this function twice should never happen.
-  assert(wrap->unref == false);
+  if (!wrap->unref) {
+    wrap->unref = true;
+    // a ProcessWrap has no handle until it has spawned; see SetHandle()
+    if (wrap->handle__) uv_handle_unref(wrap->handle__);
+  }
+
+  return v8::Undefined();
+}
+
+
+Handle<Value> HandleWrap::Ref(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
 
-  wrap->unref = true;
-  uv_unref(Isolate::GetCurrentLoop());
+  if (wrap->unref) {
+    wrap->unref = false;
+    if (wrap->handle__) uv_handle_ref(wrap->handle__);
+  }
 
   return v8::Undefined();
 }
@@ -80,12 +95,10 @@ Handle<Value> HandleWrap::Close(const Arguments& args) {
   UNWRAP
 
   assert(!wrap->object_.IsEmpty());
+  wrap->Unlink();
+  // undoes uv_handle_unref()
   uv_close(wrap->handle__, OnClose);
-
-  if (wrap->unref) {
-    uv_ref(Isolate::GetCurrentLoop());
-    wrap->unref = false;
-  }
+  wrap->unref = false;
 
   wrap->StateChange();
 
@@ -93,24 +106,39 @@ Handle<Value> HandleWrap::Close(const Arguments& args) {
 }
 
 
-HandleWrap::HandleWrap(Handle<Object> object, uv_handle_t* h) {
+HandleWrap::HandleWrap(Handle<Object> object,
+                       uv_handle_t* h,
+                       bool async_context) {
   unref = false;
   handle__ = h;
   if (h) {
     h->data = this;
   }
 
+  isolate_ = Isolate::GetCurrent();
+  prev_wrap = NULL;
+  next_wrap = isolate_->handle_wraps;
+  if (next_wrap) next_wrap->prev_wrap = this;
+  isolate_->handle_wraps = this;
+
   HandleScope scope;
   assert(object_.IsEmpty());
   assert(object->InternalFieldCount() > 0);
   object_ = v8::Persistent<v8::Object>::New(object);
   object_->SetPointerInInternalField(0, this);
+
+  if (async_context && isolate_->async_tracking && isolate_->async_context) {
+    object_->SetHiddenValue(
+        isolate_->async_context_sym,
+        Integer::NewFromUnsigned(isolate_->async_context));
+  }
 }
 
 
 void HandleWrap::SetHandle(uv_handle_t* h) {
   handle__ = h;
   h->data = this;
+  if (unref) uv_handle_unref(h);
 }
 
 
@@ -119,6 +147,39 @@ HandleWrap::~HandleWrap() {
 }
 
 
+void HandleWrap::Unlink() {
+  if (prev_wrap) {
+    prev_wrap->next_wrap = next_wrap;
+  } else if (isolate_->handle_wraps == this) {
+    isolate_->handle_wraps = next_wrap;
+  }
+  if (next_wrap) next_wrap->prev_wrap = prev_wrap;
+  prev_wrap = next_wrap = NULL;
+}
+
+
+void HandleWrap::CloseAll() {
+  Isolate* isolate = Isolate::GetCurrent();
+  while (HandleWrap* wrap = isolate->handle_wraps) {
+    wrap->Unlink();
+    // a ProcessWrap has no handle until it has spawned
+    if (wrap->handle__) uv_close(wrap->handle__, NULL);
+  }
+}
+
+
+void HandleWrap::Count(unsigned int* open, unsigned int* active) {
+  Isolate* isolate = Isolate::GetCurrent();
+  *open = *active = 0;
+  for (HandleWrap* wrap = isolate->handle_wraps; wrap; wrap = wrap->next_wrap) {
+    ++*open;
+    if (wrap->handle__ && !wrap->unref && uv_is_active(wrap->handle__)) {
+      ++*active;
+    }
+  }
+}
+
+
 void HandleWrap::OnClose(uv_handle_t* handle) {
   HandleWrap* wrap = static_cast<HandleWrap*>(handle->data);
 
@@ -49,22 +49,44 @@ class HandleWrap {
     static void Initialize(v8::Handle<v8::Object> target);
     static v8::Handle<v8::Value> Close(const v8::Arguments& args);
     static v8::Handle<v8::Value> Unref(const v8::Arguments& args);
+    static v8::Handle<v8::Value> Ref(const v8::Arguments& args);
+    // Closes every handle of the current isolate that is still open. The
+    // close callbacks are never run, so this is only for an isolate whose
+    // loop is about to be deleted.
+    static void CloseAll();
+    // Counts the handles of the current isolate that are open, and those of
+    // them that are active and referenced, so keep its loop alive.
+    static void Count(unsigned int* open, unsigned int* active);
+
+    // NULL once the handle is closed.
+    uv_handle_t* GetHandle() { return handle__; }
 
   protected:
-    HandleWrap(v8::Handle<v8::Object> object, uv_handle_t* handle);
+    // A handle whose callbacks serve many contexts, such as a timer list,
+    // passes false for async_context so as not to keep the one it was
+    // made in; see Isolate::async_tracking.
+    HandleWrap(v8::Handle<v8::Object> object,
+               uv_handle_t* handle,
+               bool async_context = true);
     virtual ~HandleWrap();
 
     virtual void SetHandle(uv_handle_t* h);
     virtual void StateChange() {}
 
     v8::Persistent<v8::Object> object_;
+    // the isolate the handle was created in
+    Isolate* isolate_;
 
   private:
     static void OnClose(uv_handle_t* handle);
+    void Unlink();
     // Using double underscore due to handle_ member in tcp_wrap. Probably
     // tcp_wrap should rename it's member to 'handle'.
     uv_handle_t* handle__;
     bool unref;
+    // the isolate's list of open handles
+    HandleWrap* prev_wrap;
+    HandleWrap* next_wrap;
 };
 
 
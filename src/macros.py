@@ -1,6 +1,5 @@
 # This file is used by tools/js2c.py to preprocess out the DTRACE symbols in
-# builds that don't support DTrace. This is not used in builds that support
-# DTrace.
+# builds without probes. This is not used in builds with DTrace or systemtap.
 macro DTRACE_HTTP_CLIENT_REQUEST(x) = ;
 macro DTRACE_HTTP_CLIENT_RESPONSE(x) = ;
 macro DTRACE_HTTP_SERVER_REQUEST(x) = ;
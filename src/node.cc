@@ -23,7 +23,7 @@
 #include <uv.h>
 
 #include <v8-debug.h>
-#ifdef HAVE_DTRACE
+#if defined(HAVE_DTRACE) || defined(HAVE_SYSTEMTAP)
 # include <node_dtrace.h>
 #endif
 
@@ -63,6 +63,7 @@ typedef int mode_t;
 #ifdef __POSIX__
 # include <pwd.h> /* getpwnam() */
 # include <grp.h> /* getgrnam() */
+# include <sys/resource.h> /* getrusage() */
 # ifndef ANDROID
 #  define __REENTRANT_GRP__
 # endif
@@ -70,11 +71,14 @@ typedef int mode_t;
 
 #include "platform.h"
 #include <node_buffer.h>
+#include <handle_wrap.h>
+#include <stream_wrap.h>
 #ifdef __POSIX__
 # include <node_io_watcher.h>
 #endif
 #include <node_file.h>
 #include <node_http_parser.h>
+#include <node_zlib.h>
 #ifdef __POSIX__
 # include <node_signal_watcher.h>
 # include <node_stat_watcher.h>
@@ -107,17 +111,20 @@ Isolate *Isolate::GetDefault() {return &defaultIsolate;}
 Isolate *Isolate::GetCurrent() {return static_cast<Isolate *>(v8::Isolate::GetCurrent()->GetData());}
 uv_loop_t *Isolate::GetCurrentLoop() {return GetCurrent()->Loop();}
 
-bool need_gc;
-
-#define FAST_TICK 700.
-#define GC_WAIT_TIME 5000.
-#define RPM_SAMPLES 100
-#define TICK_TIME(n) tick_times[(tick_time_head - (n)) % RPM_SAMPLES]
-static int64_t tick_times[RPM_SAMPLES];
+#define FAST_TICK 700
+#define GC_WAIT_TIME 5000
+// Assumed cost of a full collection, in ms, until one has been timed.
+#define GC_IDLE_COST 10
+// KB of freed memory each pool keeps when idle, see NodeOptions.
+#define IDLE_RETAIN 1024
+#define MB (1024 * 1024)
+#define TICK_TIME(n) \
+  tick_times[(tick_time_head + RPM_SAMPLES - (n)) % RPM_SAMPLES]
 
 void Isolate::StartGCTimer () {
   if (!uv_is_active((uv_handle_t*) &gc_timer)) {
-    uv_timer_start(&gc_timer, CheckStatus, 5000, 5000);
+    uv_timer_start(&gc_timer, CheckStatus,
+                   options.gc_wait_time, options.gc_wait_time);
   }
 }
 
@@ -134,13 +141,77 @@ void Isolate::Idle(uv_idle_t* watcher, int status) {
 void Isolate::__Idle(uv_idle_t* watcher, int status) {
   assert((uv_idle_t*) watcher == &gc_idle);
 
-  if (V8::IdleNotification()) {
+  CheckIdleGCCollision();
+
+  // Any idle notification may turn into a full compacting collection, so
+  // only send one if the next timer is further off than twice the average
+  // full collection. Otherwise stop until __Check() finds the loop idle
+  // again, rather than spin on a poll that the idle watcher keeps from
+  // blocking.
+  uv_update_time(Loop());
+  int64_t budget = uv_next_timeout(Loop());
+  double cost = gc_mark_sweep.count ?
+      2e-6 * gc_mark_sweep.pause_total / gc_mark_sweep.count : GC_IDLE_COST;
+
+  if (budget >= 0 && budget < cost) {
+    gc_idle_deferred++;
+    uv_idle_stop(&gc_idle);
+    return;
+  }
+
+  uint64_t start = uv_hrtime();
+  bool done = V8::IdleNotification();
+  uint64_t pause = uv_hrtime() - start;
+
+  gc_idle_steps++;
+  if (budget >= 0 && pause > static_cast<uint64_t>(budget) * 1000000) {
+    gc_idle_overruns++;
+  }
+  gc_idle_callbacks = callback_count;
+  gc_idle_iteration = loop_iterations;
+  gc_idle_unchecked = true;
+
+  if (done) {
     uv_idle_stop(&gc_idle);
     StopGCTimer();
+    TrimIdleMemory();
   }
 }
 
 
+// Once V8 has nothing left to collect, gives the memory that pools of
+// freed storage hold beyond options.idle_retain back to malloc, and then
+// what malloc holds free back to the OS, so that the resident set comes
+// down after a burst of traffic.
+void Isolate::TrimIdleMemory() {
+  if (options.idle_retain < 0) return;
+
+  size_t before, after;
+  if (Platform::GetMemory(&before) != 0) before = 0;
+
+  size_t retain = static_cast<size_t>(options.idle_retain) * 1024;
+  Buffer::TrimArena(retain);
+  StreamWrap::TrimSlabPool(retain);
+  TrimZlibStreams(retain);
+  TrimHttpParsers(retain);
+  Platform::TrimHeap();
+
+  if (before != 0 && Platform::GetMemory(&after) == 0 && after < before) {
+    idle_released_bytes += before - after;
+  }
+}
+
+
+// Called once the loop iteration after an idle GC step has run its
+// callbacks: either from the next step, or from the prepare watcher of the
+// iteration after that when there is none.
+void Isolate::CheckIdleGCCollision() {
+  if (!gc_idle_unchecked) return;
+  if (callback_count != gc_idle_callbacks) gc_idle_collisions++;
+  gc_idle_unchecked = false;
+}
+
+
 // Called directly after every call to select() (or epoll, or whatever)
 void Isolate::Check(uv_check_t* watcher, int status) {
   static_cast<Isolate *>(watcher->data)->__Check(watcher, status);
@@ -154,12 +225,15 @@ void Isolate::__Check(uv_check_t* watcher, int status) {
 
   StartGCTimer();
 
-  for (int i = 0; i < (int)(GC_WAIT_TIME/FAST_TICK); i++) {
+  int samples = options.gc_wait_time / options.gc_fast_tick;
+  if (samples > RPM_SAMPLES - 2) samples = RPM_SAMPLES - 2;
+
+  for (int i = 0; i < samples; i++) {
     double d = TICK_TIME(i+1) - TICK_TIME(i+2);
     //printf("d = %f\n", d);
-    // If in the last 5 ticks the difference between
-    // ticks was less than 0.7 seconds, then continue.
-    if (d < FAST_TICK) {
+    // If in the last few ticks the difference between
+    // ticks was less than gc_fast_tick, then continue.
+    if (d < options.gc_fast_tick) {
       //printf("---\n");
       return;
     }
@@ -175,55 +249,99 @@ void Isolate::Tick(void) {
   // Avoid entering a V8 scope.
   if (!need_tick_cb) return;
 
-  need_tick_cb = false;
-  if (uv_is_active((uv_handle_t*) &tick_spinner)) {
-    uv_idle_stop(&tick_spinner);
-    uv_unref(Loop());
-  }
+  if (tick_info[0] > 0) {
+    HandleScope scope;
 
-  HandleScope scope;
+    if (tick_callback_sym.IsEmpty()) {
+      // Lazily set the symbol
+      tick_callback_sym =
+        Persistent<String>::New(String::NewSymbol("_tickCallback"));
+    }
+
+    Local<Value> cb_v = process->Get(tick_callback_sym);
+    if (!cb_v->IsFunction()) return;
+    Local<Function> cb = Local<Function>::Cast(cb_v);
 
-  if (tick_callback_sym.IsEmpty()) {
-    // Lazily set the symbol
-    tick_callback_sym =
-      Persistent<String>::New(String::NewSymbol("_tickCallback"));
+    TryCatch try_catch;
+
+    uint64_t start = uv_hrtime();
+    cb->Call(process, 0, NULL);
+    __RecordCallback(uv_hrtime() - start);
+
+    if (try_catch.HasCaught()) {
+      FatalException(try_catch);
+    }
   }
 
-  Local<Value> cb_v = process->Get(tick_callback_sym);
-  if (!cb_v->IsFunction()) return;
-  Local<Function> cb = Local<Function>::Cast(cb_v);
+  // Callbacks queued by the ones that ran, or left over after one of them
+  // threw, run on the next tick.
+  if (tick_info[0] > 0) return;
 
-  TryCatch try_catch;
+  need_tick_cb = false;
+  uv_unref(Loop());
+}
 
-  cb->Call(process, 0, NULL);
+// Runs the setImmediate() callbacks queued so far, with a single call into
+// JavaScript, and the ticks they queued.
+void Isolate::RunImmediates(void) {
+  if (!need_immediate_cb) return;
 
-  if (try_catch.HasCaught()) {
-    FatalException(try_catch);
+  if (immediate_info[0] > 0) {
+    HandleScope scope;
+
+    if (immediate_callback_sym.IsEmpty()) {
+      immediate_callback_sym =
+        Persistent<String>::New(String::NewSymbol("_immediateCallback"));
+    }
+
+    Local<Value> cb_v = process->Get(immediate_callback_sym);
+    if (!cb_v->IsFunction()) return;
+    Local<Function> cb = Local<Function>::Cast(cb_v);
+
+    TryCatch try_catch;
+
+    uint64_t start = uv_hrtime();
+    cb->Call(process, 0, NULL);
+    __RecordCallback(uv_hrtime() - start);
+
+    if (try_catch.HasCaught()) {
+      FatalException(try_catch);
+    }
+
+    Tick();
   }
-}
 
-void Isolate::Spin(uv_idle_t* handle, int status) {
-  static_cast<Isolate *>(handle->data)->__Spin(handle, status);
+  // Immediates queued by the ones that ran wait for the next iteration.
+  if (immediate_info[0] > 0) return;
+
+  need_immediate_cb = false;
+  uv_unref(Loop());
 }
 
-void Isolate::__Spin(uv_idle_t* handle, int status) {
-  assert((uv_idle_t*) handle == &tick_spinner);
-  assert(status == 0);
-  Tick();
+void Isolate::TickAsync(uv_async_t* handle, int status) {
+  static_cast<Isolate *>(handle->data)->Tick();
 }
 
 
 Handle<Value> Isolate::NeedTickCallback(const Arguments& args) {
   Isolate *isolate = Isolate::GetCurrent();
   HandleScope scope;
-  isolate->need_tick_cb = true;
-  // TODO: this tick_spinner shouldn't be necessary. An ev_prepare should be
-  // sufficent, the problem is only in the case of the very last "tick" -
-  // there is nothing left to do in the event loop and libev will exit. The
-  // ev_prepare callback isn't called before exiting. Thus we start this
-  // tick_spinner to keep the event loop alive long enough to handle it.
-  if (!uv_is_active((uv_handle_t*) &isolate->tick_spinner)) {
-    uv_idle_start(&isolate->tick_spinner, Spin);
+  // The prepare and check watchers run the ticks, this only keeps the loop
+  // from exiting before they did. Unlike an idle watcher it doesn't make
+  // the poll return at once.
+  if (!isolate->need_tick_cb) {
+    isolate->need_tick_cb = true;
+    uv_ref(isolate->Loop());
+  }
+  return Undefined();
+}
+
+Handle<Value> Isolate::NeedImmediateCallback(const Arguments& args) {
+  Isolate *isolate = Isolate::GetCurrent();
+  HandleScope scope;
+  // Like NeedTickCallback(); the check watcher runs them.
+  if (!isolate->need_immediate_cb) {
+    isolate->need_immediate_cb = true;
     uv_ref(isolate->Loop());
   }
   return Undefined();
@@ -237,6 +355,25 @@ void Isolate::__PrepareTick(uv_prepare_t* handle, int status) {
   assert(handle == &prepare_tick_watcher);
   assert(status == 0);
   Tick();
+  // Ticks queued by the ones that just ran, and immediates, would wait for
+  // the poll to time out. Wake it up instead; these are the only cases where
+  // it mustn't block.
+  if (tick_info[0] > 0 || immediate_info[0] > 0) uv_async_send(&tick_async);
+
+  uint64_t now = uv_hrtime();
+  if (loop_check_time) {
+    loop_last_callback = now - loop_check_time;
+    loop_callback_total += loop_last_callback;
+    if (loop_last_callback > loop_max_callback) {
+      loop_max_callback = loop_last_callback;
+    }
+    loop_iterations++;
+  }
+  loop_prepare_time = now;
+
+  if (gc_idle_unchecked && loop_iterations >= gc_idle_iteration + 2) {
+    CheckIdleGCCollision();
+  }
 }
 
 void Isolate::CheckTick(uv_check_t* handle, int status) {
@@ -246,7 +383,40 @@ void Isolate::CheckTick(uv_check_t* handle, int status) {
 void Isolate::__CheckTick(uv_check_t* handle, int status) {
   assert(handle == &check_tick_watcher);
   assert(status == 0);
+
+  uint64_t now = uv_hrtime();
+  if (loop_prepare_time) {
+    loop_last_poll = now - loop_prepare_time;
+    loop_poll_total += loop_last_poll;
+  }
+  loop_check_time = now;
+
   Tick();
+  RunImmediates();
+}
+
+// The log2 histogram bucket of a duration: 0 under 1us, i under 2^i us.
+static inline int DurationBucket(uint64_t nsecs) {
+  int bucket = 0;
+  for (uint64_t usecs = nsecs / 1000; usecs; usecs >>= 1) bucket++;
+  if (bucket >= LOOP_STATS_BUCKETS) bucket = LOOP_STATS_BUCKETS - 1;
+  return bucket;
+}
+
+void Isolate::__RecordCallback(uint64_t nsecs) {
+  callback_buckets[DurationBucket(nsecs)]++;
+  callback_count++;
+  callback_total += nsecs;
+  if (nsecs > callback_max) callback_max = nsecs;
+}
+
+void Isolate::__RecordAsync(uint32_t context, uint32_t type,
+                            uint64_t start, uint64_t end) {
+  AsyncRecord* record = &async_ring[async_ring_count++ % ASYNC_RING_SIZE];
+  record->context = context;
+  record->type = type;
+  record->start = start;
+  record->end = end;
 }
 
 static inline const char *errno_string(int errorno) {
@@ -826,30 +996,54 @@ Handle<Value> FromConstructorTemplate(Persistent<FunctionTemplate>& t,
 //
 // Maybe make this a method of a node::Handle super class
 //
+// Callers on hot paths pass a persistent symbol, which V8 looks up without
+// first making a string of the name and finding its symbol.
 void MakeCallback(Handle<Object> object,
-                  const char* method,
+                  Handle<String> symbol,
                   int argc,
                   Handle<Value> argv[]) {
   HandleScope scope;
 
-  Local<Value> callback_v = object->Get(String::New(method));
+  Local<Value> callback_v = object->Get(symbol);
   if (!callback_v->IsFunction()) {
-    fprintf(stderr, "method = %s", method);
+    String::Utf8Value method(symbol);
+    fprintf(stderr, "method = %s", *method);
   }
   assert(callback_v->IsFunction());
   Local<Function> callback = Local<Function>::Cast(callback_v);
 
   // TODO Hook for long stack traces to be made here.
 
+  Isolate* isolate = Isolate::GetCurrent();
+  uint32_t async_context = isolate->async_context;
+  if (isolate->async_tracking) {
+    Local<Value> context = object->GetHiddenValue(isolate->async_context_sym);
+    isolate->async_context = context.IsEmpty() ? 0 : context->Uint32Value();
+  }
+
   TryCatch try_catch;
 
+  uint64_t start = uv_hrtime();
   callback->Call(object, argc, argv);
+  isolate->__RecordCallback(uv_hrtime() - start);
+
+  // A context the callback set lasts until it returns.
+  isolate->async_context = async_context;
 
   if (try_catch.HasCaught()) {
     FatalException(try_catch);
   }
 }
 
+
+void MakeCallback(Handle<Object> object,
+                  const char* method,
+                  int argc,
+                  Handle<Value> argv[]) {
+  HandleScope scope;
+  MakeCallback(object, String::NewSymbol(method), argc, argv);
+}
+
 void SetLastErrno() {
     Isolate *isolate = Isolate::GetCurrent();
     isolate->__SetErrno(uv_last_error(isolate->Loop()));
@@ -1346,7 +1540,7 @@ void Isolate::__CheckStatus(uv_timer_t* watcher, int status) {
 
   //printfb("timer d = %f\n", d);
 
-  if (d  >= GC_WAIT_TIME - 1.) {
+  if (d  >= options.gc_wait_time - 1.) {
     //fprintf(stderr, "start idle\n");
     uv_idle_start(&gc_idle, Idle);
   }
@@ -1366,6 +1560,62 @@ static Handle<Value> Uptime(const Arguments& args) {
 }
 
 
+// hrtime([time])
+//
+// The monotonic clock as [seconds, nanoseconds] since an arbitrary point.
+// Given an earlier result, returns the time since then instead. Given a
+// Float64Array of two, stores the current time into it and returns it, so
+// that sampling doesn't allocate.
+static Handle<Value> Hrtime(const Arguments& args) {
+  HandleScope scope;
+  uint64_t t = uv_hrtime();
+
+  if (args.Length() > 0 && args[0]->IsObject()) {
+    Local<Object> time = args[0]->ToObject();
+
+    if (v8_typed_array::HasExternalElements(time, kExternalDoubleArray, 2)) {
+      double* data = static_cast<double*>(
+          time->GetIndexedPropertiesExternalArrayData());
+      data[0] = static_cast<double>(t / 1000000000);
+      data[1] = static_cast<double>(t % 1000000000);
+      return scope.Close(time);
+    }
+
+    if (!time->IsArray() || Local<Array>::Cast(time)->Length() != 2) {
+      return ThrowException(Exception::TypeError(
+          String::New("process.hrtime() only accepts an Array of two")));
+    }
+    uint64_t sec = time->Get(0)->IntegerValue();
+    uint64_t nsec = time->Get(1)->IntegerValue();
+    t -= sec * 1000000000 + nsec;
+  }
+
+  Local<Array> result = Array::New(2);
+  result->Set(0, Number::New(static_cast<double>(t / 1000000000)));
+  result->Set(1, Integer::NewFromUnsigned(
+      static_cast<uint32_t>(t % 1000000000)));
+  return scope.Close(result);
+}
+
+
+// The loop's idea of the current time in milliseconds, which it updates
+// once per iteration. Reading it costs no system call.
+static Handle<Value> LoopTime(const Arguments& args) {
+  HandleScope scope;
+  double now = static_cast<double>(uv_now(Isolate::GetCurrentLoop()));
+  return scope.Close(Number::New(now));
+}
+
+
+// Runs the thread pool completions of a loop iteration in one handle scope
+// rather than each on its own. uv_work_drain() stops at the loop's time
+// budget; the rest wait for the next iteration.
+static void DrainWork(uv_loop_t* loop) {
+  HandleScope scope;
+  uv_work_drain(loop);
+}
+
+
 v8::Handle<v8::Value> UVCounters(const v8::Arguments& args) {
   Isolate *isolate = Isolate::GetCurrent();
   HandleScope scope;
@@ -1392,13 +1642,388 @@ v8::Handle<v8::Value> UVCounters(const v8::Arguments& args) {
   setc(timer_init)
   setc(process_init)
   setc(fs_event_init)
+  setc(eio_poll)
+  setc(eio_done)
+  setc(eio_poll_limited)
+  setc(work_batch)
+  setc(work_batch_limited)
 
 #undef setc
 
+  // Completions run in batches, per WorkType.
+  Local<Object> batched = Object::New();
+#define setw(name, type) \
+    batched->Set(String::New(name), \
+                 Integer::New(static_cast<int32_t>(c->work_batched[type])));
+  setw("other", WORK_OTHER)
+  setw("fs", WORK_FS)
+  setw("zlib", WORK_ZLIB)
+  setw("crypto", WORK_CRYPTO)
+#undef setw
+  obj->Set(String::New("work_batched"), batched);
+
+#ifdef __POSIX__
+  // Polls that idle watchers kept from blocking and that found nothing to
+  // do.
+  obj->Set(String::New("spurious_poll"),
+           Integer::New(ev_spurious_polls(isolate->Loop()->ev)));
+#endif
+
   return scope.Close(obj);
 }
 
 
+// The number of instances parked in the default isolate pool, 0 without
+// one. For tests.
+static Handle<Value> IsolatePoolSize(const Arguments& args) {
+  HandleScope scope;
+  IsolatePool* pool = IsolatePool::GetDefault();
+  return scope.Close(Integer::New(pool ? pool->Size() : 0));
+}
+
+
+// Copies the request latency counters of the loop into a Float64Array. Every
+// request type takes a slot of in flight, completed and total time in
+// nanoseconds followed by the histogram buckets, in uv_latency_type order.
+// An array of the right size passed in is filled in place so that frequent
+// sampling doesn't allocate.
+static Handle<Value> UVLatency(const Arguments& args) {
+  Isolate *isolate = Isolate::GetCurrent();
+  HandleScope scope;
+
+  const int slot = 3 + UV_LATENCY_BUCKETS;
+  const int length = UV_LATENCY_TYPES * slot;
+  uv_counters_t* c = &isolate->Loop()->counters;
+
+  Local<Object> array;
+  if (args.Length() > 0 && args[0]->IsObject()) {
+    array = args[0]->ToObject();
+    if (!v8_typed_array::HasExternalElements(array,
+                                             kExternalDoubleArray,
+                                             length) ||
+        array->GetIndexedPropertiesExternalArrayDataLength() != length) {
+      return ThrowException(Exception::TypeError(
+          String::New("Argument must be a Float64Array of the right length")));
+    }
+  } else {
+    Local<Value> ctor =
+        Context::GetCurrent()->Global()->Get(String::New("Float64Array"));
+    if (!ctor->IsFunction()) {
+      return ThrowException(Exception::Error(
+          String::New("Float64Array is not available")));
+    }
+    Local<Value> argv[1] = { Integer::New(length) };
+    array = Local<Function>::Cast(ctor)->NewInstance(1, argv);
+    if (array.IsEmpty()) return Undefined();  // exception pending
+    if (!v8_typed_array::HasExternalElements(array,
+                                             kExternalDoubleArray,
+                                             length)) {
+      return ThrowException(Exception::TypeError(
+          String::New("Float64Array did not make a Float64Array")));
+    }
+  }
+
+  double* data = static_cast<double*>(
+      array->GetIndexedPropertiesExternalArrayData());
+
+  for (int type = 0; type < UV_LATENCY_TYPES; type++) {
+    uv_latency_t* l = &c->latency[type];
+    double* out = data + type * slot;
+
+    out[0] = static_cast<double>(l->in_flight);
+    out[1] = static_cast<double>(l->completed);
+    out[2] = static_cast<double>(l->total_time);
+    for (int i = 0; i < UV_LATENCY_BUCKETS; i++) {
+      out[3 + i] = static_cast<double>(l->buckets[i]);
+    }
+  }
+
+  return scope.Close(array);
+}
+
+
+static inline Local<Number> NanosToMillis(uint64_t nsecs) {
+  return Number::New(static_cast<double>(nsecs) / 1e6);
+}
+
+
+v8::Handle<v8::Value> Isolate::LoopStats(const v8::Arguments& args) {
+  Isolate *isolate = Isolate::GetCurrent();
+  HandleScope scope;
+
+  Local<Object> stats = Object::New();
+  stats->Set(String::New("iterations"),
+             Number::New(static_cast<double>(isolate->loop_iterations)));
+  stats->Set(String::New("pollTime"),
+             NanosToMillis(isolate->loop_poll_total));
+  stats->Set(String::New("callbackTime"),
+             NanosToMillis(isolate->loop_callback_total));
+  stats->Set(String::New("lastPollTime"),
+             NanosToMillis(isolate->loop_last_poll));
+  stats->Set(String::New("lastCallbackTime"),
+             NanosToMillis(isolate->loop_last_callback));
+  stats->Set(String::New("maxCallbackTime"),
+             NanosToMillis(isolate->loop_max_callback));
+
+  Local<Object> callbacks = Object::New();
+  callbacks->Set(String::New("count"),
+                 Number::New(static_cast<double>(isolate->callback_count)));
+  callbacks->Set(String::New("totalTime"),
+                 NanosToMillis(isolate->callback_total));
+  callbacks->Set(String::New("maxTime"),
+                 NanosToMillis(isolate->callback_max));
+  Local<Array> histogram = Array::New(LOOP_STATS_BUCKETS);
+  for (int i = 0; i < LOOP_STATS_BUCKETS; i++) {
+    histogram->Set(i, Integer::NewFromUnsigned(isolate->callback_buckets[i]));
+  }
+  callbacks->Set(String::New("histogram"), histogram);
+  stats->Set(String::New("callbacks"), callbacks);
+
+  unsigned int open, active;
+  HandleWrap::Count(&open, &active);
+  stats->Set(String::New("handles"), Integer::NewFromUnsigned(open));
+  stats->Set(String::New("activeHandles"), Integer::NewFromUnsigned(active));
+  stats->Set(String::New("requests"),
+             Integer::NewFromUnsigned(isolate->req_wraps));
+  Local<Object> pool = Object::New();
+  pool->Set(String::New("size"), Integer::New(isolate->req_wrap_pool_count));
+  pool->Set(String::New("hits"), Number::New(isolate->req_wrap_pool_hits));
+  pool->Set(String::New("misses"), Number::New(isolate->req_wrap_pool_misses));
+  pool->Set(String::New("drops"), Number::New(isolate->req_wrap_pool_drops));
+  stats->Set(String::New("requestPool"), pool);
+
+#ifdef __POSIX__
+  eio_channel* channel = &isolate->Loop()->uv_eio_channel;
+  Local<Object> eio = Object::New();
+  eio->Set(String::New("ready"),
+           Integer::NewFromUnsigned(eio_channel_nready(channel)));
+  eio->Set(String::New("pending"),
+           Integer::NewFromUnsigned(eio_channel_npending(channel)));
+  stats->Set(String::New("eio"), eio);
+#endif
+
+  return scope.Close(stats);
+}
+
+
+Local<Object> Isolate::GCKindStatsObject(const GCKindStats& kind) {
+  Local<Object> obj = Object::New();
+  obj->Set(String::New("count"),
+           Number::New(static_cast<double>(kind.count)));
+  obj->Set(String::New("pauseTime"), NanosToMillis(kind.pause_total));
+  obj->Set(String::New("maxPauseTime"), NanosToMillis(kind.pause_max));
+  obj->Set(String::New("lastPauseTime"), NanosToMillis(kind.last_pause));
+  obj->Set(String::New("reclaimed"), Number::New(kind.reclaimed));
+  Local<Array> histogram = Array::New(LOOP_STATS_BUCKETS);
+  for (int i = 0; i < LOOP_STATS_BUCKETS; i++) {
+    histogram->Set(i, Integer::NewFromUnsigned(kind.buckets[i]));
+  }
+  obj->Set(String::New("histogram"), histogram);
+  return obj;
+}
+
+
+v8::Handle<v8::Value> Isolate::GCStats(const v8::Arguments& args) {
+  Isolate *isolate = Isolate::GetCurrent();
+  HandleScope scope;
+
+  Local<Object> stats = Object::New();
+  stats->Set(String::New("scavenge"),
+             GCKindStatsObject(isolate->gc_scavenge));
+  stats->Set(String::New("markSweep"),
+             GCKindStatsObject(isolate->gc_mark_sweep));
+
+  Local<Object> idle = Object::New();
+  idle->Set(String::New("steps"),
+            Number::New(static_cast<double>(isolate->gc_idle_steps)));
+  idle->Set(String::New("deferred"),
+            Number::New(static_cast<double>(isolate->gc_idle_deferred)));
+  idle->Set(String::New("overruns"),
+            Number::New(static_cast<double>(isolate->gc_idle_overruns)));
+  idle->Set(String::New("collisions"),
+            Number::New(static_cast<double>(isolate->gc_idle_collisions)));
+  stats->Set(String::New("idle"), idle);
+
+  HeapStatistics v8_heap_stats;
+  V8::GetHeapStatistics(&v8_heap_stats);
+  stats->Set(String::New("heapTotal"),
+             Integer::NewFromUnsigned(v8_heap_stats.total_heap_size()));
+  stats->Set(String::New("heapUsed"),
+             Integer::NewFromUnsigned(v8_heap_stats.used_heap_size()));
+  stats->Set(String::New("heapLimit"),
+             Number::New(static_cast<double>(isolate->options.max_old_space +
+                                             isolate->options.max_new_space) *
+                         MB));
+  stats->Set(String::New("external"),
+             Number::New(V8::AdjustAmountOfExternalAllocatedMemory(0)));
+  stats->Set(String::New("buffers"),
+             Number::New(static_cast<double>(Buffer::HeldBytes())));
+
+  return scope.Close(stats);
+}
+
+
+// asyncTracking([on]) turns async context tracking on or off, and returns
+// whether it is on.
+v8::Handle<v8::Value> Isolate::AsyncTracking(const v8::Arguments& args) {
+  Isolate *isolate = Isolate::GetCurrent();
+  HandleScope scope;
+
+  if (args.Length() > 0) {
+    bool on = args[0]->BooleanValue();
+    if (on && !isolate->async_ring) {
+      isolate->async_context_sym = NODE_PSYMBOL("asyncContext");
+      isolate->async_ring = new AsyncRecord[ASYNC_RING_SIZE];
+    }
+    isolate->async_tracking = on;
+  }
+
+  return scope.Close(Boolean::New(isolate->async_tracking));
+}
+
+
+// setTimerSlack(ms) sets the timer slack of the isolate for timers started
+// from now on, and returns the previous one.
+v8::Handle<v8::Value> Isolate::SetTimerSlack(const v8::Arguments& args) {
+  Isolate *isolate = Isolate::GetCurrent();
+  HandleScope scope;
+
+  int64_t previous = isolate->timer_slack;
+  int64_t ms = args[0]->IntegerValue();
+  isolate->timer_slack = ms > 0 ? ms : 0;
+
+  return scope.Close(Number::New(static_cast<double>(previous)));
+}
+
+
+// setAsyncContext(id) makes `id`, a 32 bit unsigned integer, the current
+// context, 0 being none, and returns the previous one.
+v8::Handle<v8::Value> Isolate::SetAsyncContext(const v8::Arguments& args) {
+  Isolate *isolate = Isolate::GetCurrent();
+  HandleScope scope;
+
+  uint32_t previous = isolate->async_context;
+  isolate->async_context = args[0]->Uint32Value();
+
+  return scope.Close(Integer::NewFromUnsigned(previous));
+}
+
+
+v8::Handle<v8::Value> Isolate::GetAsyncContext(const v8::Arguments& args) {
+  Isolate *isolate = Isolate::GetCurrent();
+  HandleScope scope;
+  return scope.Close(Integer::NewFromUnsigned(isolate->async_context));
+}
+
+
+static const char* ReqTypeName(uint32_t type) {
+  switch (type) {
+    case UV_CONNECT: return "connect";
+    case UV_WRITE: return "write";
+    case UV_SHUTDOWN: return "shutdown";
+    case UV_UDP_SEND: return "send";
+    case UV_FS: return "fs";
+    case UV_WORK: return "work";
+    case UV_GETADDRINFO: return "getaddrinfo";
+    default: return "unknown";
+  }
+}
+
+
+// asyncRecords() returns the requests recorded since the last call, oldest
+// first, and how many of them the ring lost by overwriting.
+v8::Handle<v8::Value> Isolate::AsyncRecords(const v8::Arguments& args) {
+  Isolate *isolate = Isolate::GetCurrent();
+  HandleScope scope;
+
+  uint64_t read = isolate->async_ring_read;
+  uint64_t count = isolate->async_ring_count;
+  uint64_t lost = 0;
+  if (count - read > ASYNC_RING_SIZE) {
+    lost = count - read - ASYNC_RING_SIZE;
+    read = count - ASYNC_RING_SIZE;
+  }
+
+  Local<String> context_sym = String::New("context");
+  Local<String> type_sym = String::New("type");
+  Local<String> start_sym = String::New("start");
+  Local<String> end_sym = String::New("end");
+
+  Local<Array> records = Array::New(static_cast<int>(count - read));
+  for (uint32_t i = 0; read < count; i++, read++) {
+    AsyncRecord* record = &isolate->async_ring[read % ASYNC_RING_SIZE];
+    Local<Object> obj = Object::New();
+    obj->Set(context_sym, Integer::NewFromUnsigned(record->context));
+    obj->Set(type_sym, String::New(ReqTypeName(record->type)));
+    obj->Set(start_sym, NanosToMillis(record->start));
+    obj->Set(end_sym, NanosToMillis(record->end));
+    records->Set(i, obj);
+  }
+  isolate->async_ring_read = count;
+
+  Local<Object> result = Object::New();
+  result->Set(String::New("records"), records);
+  result->Set(String::New("lost"), Number::New(static_cast<double>(lost)));
+  return scope.Close(result);
+}
+
+
+// process.memoryUsage.rss(), the one figure of memoryUsage() that is not
+// known without asking the system.
+static Handle<Value> RSS(const Arguments& args) {
+  HandleScope scope;
+  size_t rss;
+
+  if (Platform::GetMemory(&rss) != 0) {
+    return ThrowException(Exception::Error(String::New(strerror(errno))));
+  }
+
+  return scope.Close(Number::New(static_cast<double>(rss)));
+}
+
+
+#ifdef __POSIX__
+static inline Local<Number> TimevalToMicros(const struct timeval& tv) {
+  return Number::New(static_cast<double>(tv.tv_sec) * 1e6 + tv.tv_usec);
+}
+
+
+// What getrusage() knows about the whole process. CPU times are in
+// microseconds and maxRSS in kilobytes.
+static Handle<Value> ResourceUsage(const Arguments& args) {
+  HandleScope scope;
+  struct rusage ru;
+
+  if (getrusage(RUSAGE_SELF, &ru) != 0) {
+    return ThrowException(ErrnoException(errno, "getrusage"));
+  }
+
+  Local<Object> usage = Object::New();
+  usage->Set(String::NewSymbol("userCPUTime"), TimevalToMicros(ru.ru_utime));
+  usage->Set(String::NewSymbol("systemCPUTime"),
+             TimevalToMicros(ru.ru_stime));
+  usage->Set(String::NewSymbol("maxRSS"),
+             Number::New(static_cast<double>(ru.ru_maxrss)));
+  usage->Set(String::NewSymbol("minorPageFaults"),
+             Number::New(static_cast<double>(ru.ru_minflt)));
+  usage->Set(String::NewSymbol("majorPageFaults"),
+             Number::New(static_cast<double>(ru.ru_majflt)));
+  usage->Set(String::NewSymbol("fsRead"),
+             Number::New(static_cast<double>(ru.ru_inblock)));
+  usage->Set(String::NewSymbol("fsWrite"),
+             Number::New(static_cast<double>(ru.ru_oublock)));
+  usage->Set(String::NewSymbol("signals"),
+             Number::New(static_cast<double>(ru.ru_nsignals)));
+  usage->Set(String::NewSymbol("voluntaryContextSwitches"),
+             Number::New(static_cast<double>(ru.ru_nvcsw)));
+  usage->Set(String::NewSymbol("involuntaryContextSwitches"),
+             Number::New(static_cast<double>(ru.ru_nivcsw)));
+
+  return scope.Close(usage);
+}
+#endif  // __POSIX__
+
+
 v8::Handle<v8::Value> Isolate::MemoryUsage(const v8::Arguments& args) {
   Isolate *isolate = Isolate::GetCurrent();
   HandleScope scope;
@@ -1418,6 +2043,10 @@ v8::Handle<v8::Value> Isolate::MemoryUsage(const v8::Arguments& args) {
     isolate->rss_symbol = NODE_PSYMBOL("rss");
     isolate->heap_total_symbol = NODE_PSYMBOL("heapTotal");
     isolate->heap_used_symbol = NODE_PSYMBOL("heapUsed");
+    isolate->pinned_slabs_symbol = NODE_PSYMBOL("pinnedSlabs");
+    isolate->external_symbol = NODE_PSYMBOL("external");
+    isolate->buffers_symbol = NODE_PSYMBOL("buffers");
+    isolate->released_symbol = NODE_PSYMBOL("released");
   }
 
   info->Set(isolate->rss_symbol, Integer::NewFromUnsigned(rss));
@@ -1430,6 +2059,20 @@ v8::Handle<v8::Value> Isolate::MemoryUsage(const v8::Arguments& args) {
   info->Set(isolate->heap_used_symbol,
             Integer::NewFromUnsigned(v8_heap_stats.used_heap_size()));
 
+  info->Set(isolate->pinned_slabs_symbol,
+            Integer::New(StreamWrap::PinnedSlabs()));
+
+  // Memory outside the V8 heap that this isolate keeps alive: all of what
+  // was reported to V8, and the part of it held by Buffers
+  info->Set(isolate->external_symbol,
+            Number::New(V8::AdjustAmountOfExternalAllocatedMemory(0)));
+  info->Set(isolate->buffers_symbol,
+            Number::New(static_cast<double>(Buffer::HeldBytes())));
+
+  // Resident memory given back by the trims after idle GCs, in all
+  info->Set(isolate->released_symbol,
+            Number::New(static_cast<double>(isolate->idle_released_bytes)));
+
   return scope.Close(info);
 }
 
@@ -1559,6 +2202,15 @@ void OnFatalError(const char* location, const char* message) {
   BREAK_AND_EXIT(1);
 }
 
+// Writes out what a buffered process.stdout holds, see src/node.js.
+static void FlushStdio(Handle<Object> process) {
+  HandleScope scope;
+  Local<Value> flush_v = process->Get(String::NewSymbol("_flushStdio"));
+  if (!flush_v->IsFunction()) return;
+  TryCatch try_catch;
+  Local<Function>::Cast(flush_v)->Call(process, 0, NULL);
+}
+
 void FatalException(TryCatch &try_catch) {
     Isolate::GetCurrent()->__FatalException(try_catch);
 }
@@ -1574,6 +2226,7 @@ void Isolate::__FatalException(TryCatch &try_catch) {
     
   // Check if uncaught_exception_counter indicates a recursion
   if (uncaught_exception_counter > 0) {
+    FlushStdio(process);
     ReportException(try_catch, true);
     BREAK_AND_EXIT(1);
     return;
@@ -1601,6 +2254,7 @@ void Isolate::__FatalException(TryCatch &try_catch) {
   uint32_t length = listener_array->Length();
   // Report and exit if process has no "uncaughtException" listener
   if (length == 0) {
+    FlushStdio(process);
     ReportException(try_catch, true);
     BREAK_AND_EXIT(1);
     return;
@@ -1855,6 +2509,13 @@ Handle<Object> Isolate::GetFeatures() {
   obj->Set(String::NewSymbol("tls_sni"), Boolean::New(use_sni));
   obj->Set(String::NewSymbol("tls"),
       Boolean::New(get_builtin_module("crypto") != NULL));
+  obj->Set(String::NewSymbol("isolates"),
+#if defined(NODE_FORK_ISOLATE)
+    True()
+#else
+    False()
+#endif
+  );
 
   return scope.Close(obj);
 }
@@ -1865,6 +2526,7 @@ static Handle<Value> DebugProcess(const Arguments& args);
 void Isolate::SetupLocalEnv(char *env[]) {
     HandleScope scope;
     
+  if (!local_env.IsEmpty()) local_env.Dispose();
   local_env = Persistent<Object>::New(Object::New());
   if(env) {
     for(int i = 0; env[i]; i++) {
@@ -1877,11 +2539,34 @@ void Isolate::SetupLocalEnv(char *env[]) {
   }
 }
 
-Handle<Object> Isolate::SetupProcessObject(int argc, char *argv[]) {
+void Isolate::SetupArgv(Handle<Object> process, int argc, char *argv[]) {
   HandleScope scope;
 
   int i, j;
 
+  Local<Array> arguments = Array::New(argc - options.args_start_index + 1);
+  arguments->Set(Integer::New(0), String::New(argv[0]));
+  for (j = 1, i = options.args_start_index; i < argc; j++, i++) {
+    Local<String> arg = String::New(argv[i]);
+    arguments->Set(Integer::New(j), arg);
+  }
+  // assign it
+  process->Set(String::NewSymbol("argv"), arguments);
+}
+
+void Isolate::SetupStdioFds(Handle<Object> process) {
+  HandleScope scope;
+
+  Local<Array> fds = Array::New(3);
+  fds->Set(Integer::New(0), Integer::New(stdin_fd));
+  fds->Set(Integer::New(1), Integer::New(stdout_fd));
+  fds->Set(Integer::New(2), Integer::New(stderr_fd));
+  process->Set(String::NewSymbol("_stdio_fds"), fds);
+}
+
+Handle<Object> Isolate::SetupProcessObject(int argc, char *argv[]) {
+  HandleScope scope;
+
   Local<FunctionTemplate> process_template = FunctionTemplate::New();
 
   process = Persistent<Object>::New(process_template->GetFunction()->NewInstance());
@@ -1914,7 +2599,7 @@ Handle<Object> Isolate::SetupProcessObject(int argc, char *argv[]) {
   versions->Set(String::NewSymbol("uv"), String::New(buf));
 #if HAVE_OPENSSL
   // Stupid code to slice out the version string.
-  int c, l = strlen(OPENSSL_VERSION_TEXT);
+  int i, j, c, l = strlen(OPENSSL_VERSION_TEXT);
   for (i = j = 0; i < l; i++) {
     c = OPENSSL_VERSION_TEXT[i];
     if ('0' <= c && c <= '9') {
@@ -1938,14 +2623,7 @@ Handle<Object> Isolate::SetupProcessObject(int argc, char *argv[]) {
   process->Set(String::NewSymbol("platform"), String::New(PLATFORM));
 
   // process.argv
-  Local<Array> arguments = Array::New(argc - options.args_start_index + 1);
-  arguments->Set(Integer::New(0), String::New(argv[0]));
-  for (j = 1, i = options.args_start_index; i < argc; j++, i++) {
-    Local<String> arg = String::New(argv[i]);
-    arguments->Set(Integer::New(j), arg);
-  }
-  // assign it
-  process->Set(String::NewSymbol("argv"), arguments);
+  SetupArgv(process, argc, argv);
 
   // create process.env
   Local<ObjectTemplate> envTemplate = ObjectTemplate::New();
@@ -1977,14 +2655,22 @@ Handle<Object> Isolate::SetupProcessObject(int argc, char *argv[]) {
   delete [] execPath;
   
   //stdio_fds
-  Local<Array> fds = Array::New(3);
-  fds->Set(Integer::New(0), Integer::New(stdin_fd));
-  fds->Set(Integer::New(1), Integer::New(stdout_fd));
-  fds->Set(Integer::New(2), Integer::New(stderr_fd));
-  process->Set(String::NewSymbol("_stdio_fds"), fds);
+  SetupStdioFds(process);
 
   // define various internal methods
   NODE_SET_METHOD(process, "_needTickCallback", NeedTickCallback);
+
+  Local<Object> tick_info_obj = Object::New();
+  tick_info_obj->SetIndexedPropertiesToExternalArrayData(
+      tick_info, kExternalUnsignedIntArray, 1);
+  process->Set(String::NewSymbol("_tickInfo"), tick_info_obj);
+
+  NODE_SET_METHOD(process, "_needImmediateCallback", NeedImmediateCallback);
+
+  Local<Object> immediate_info_obj = Object::New();
+  immediate_info_obj->SetIndexedPropertiesToExternalArrayData(
+      immediate_info, kExternalUnsignedIntArray, 1);
+  process->Set(String::NewSymbol("_immediateInfo"), immediate_info_obj);
   NODE_SET_METHOD(process, "reallyExit", Exit);
   NODE_SET_METHOD(process, "chdir", Chdir);
   NODE_SET_METHOD(process, "cwd", Cwd);
@@ -2006,10 +2692,27 @@ Handle<Object> Isolate::SetupProcessObject(int argc, char *argv[]) {
   NODE_SET_METHOD(process, "dlopen", DLOpen);
 
   NODE_SET_METHOD(process, "uptime", Uptime);
+  NODE_SET_METHOD(process, "hrtime", Hrtime);
+  NODE_SET_METHOD(process, "loopTime", LoopTime);
   NODE_SET_METHOD(process, "memoryUsage", MemoryUsage);
+  NODE_SET_METHOD(process->Get(String::NewSymbol("memoryUsage"))->ToObject(),
+                  "rss", RSS);
+#ifdef __POSIX__
+  NODE_SET_METHOD(process, "resourceUsage", ResourceUsage);
+#endif
   NODE_SET_METHOD(process, "uvCounters", UVCounters);
+  NODE_SET_METHOD(process, "uvLatency", UVLatency);
+  NODE_SET_METHOD(process, "_isolatePoolSize", IsolatePoolSize);
+  NODE_SET_METHOD(process, "loopStats", LoopStats);
+  NODE_SET_METHOD(process, "gcStats", GCStats);
+  NODE_SET_METHOD(process, "asyncTracking", AsyncTracking);
+  NODE_SET_METHOD(process, "setTimerSlack", SetTimerSlack);
+  NODE_SET_METHOD(process, "setAsyncContext", SetAsyncContext);
+  NODE_SET_METHOD(process, "getAsyncContext", GetAsyncContext);
+  NODE_SET_METHOD(process, "asyncRecords", AsyncRecords);
 
   NODE_SET_METHOD(process, "binding", Binding);
+  NODE_SET_METHOD(process, "_compileNative", CompileNative);
 
   return process;
 }
@@ -2062,7 +2765,7 @@ void Isolate::Load(Handle<Object> process) {
   Local<Object> global = v8::Context::GetCurrent()->Global();
   Local<Value> args[1] = { Local<Value>::New(process) };
 
-#ifdef HAVE_DTRACE
+#if defined(HAVE_DTRACE) || defined(HAVE_SYSTEMTAP)
   InitDTrace(global);
 #endif
 
@@ -2084,13 +2787,35 @@ static void PrintHelp() {
          "  --v8-options         print v8 command line options\n"
          "  --vars               print various compiled-in variables\n"
          "  --max-stack-size=val set max v8 stack size (bytes)\n"
+         "  --max-old-space=mb   limit the isolate's old generation heap\n"
+         "  --max-new-space=mb   limit the isolate's young generation heap\n"
+         "  --fs-threads=n       size of the fs thread pool\n"
+#if defined(NODE_FORK_ISOLATE)
+         "  --isolate-pool=n     keep n prepared isolates for fork()\n"
+#endif
+         "  --fs-max-poll-reqs=n run at most n fs callbacks per loop iteration\n"
+         "  --fs-priority=n      priority of the isolate's fs requests,\n"
+         "                       -4 (bulk) to 4 (interactive), default 0\n"
+         "  --fs-max-threads=n   fs threads the isolate may use at once,\n"
+         "                       default no limit\n"
+         "  --gc-fast-tick=ms    loop iterations closer than this are busy,\n"
+         "                       default 700\n"
+         "  --gc-wait-time=ms    idle time before an idle GC, default 5000\n"
+         "  --idle-retain=kb     freed memory each pool keeps once idle,\n"
+         "                       default 1024, -1 to keep all\n"
+         "  --timer-slack=ms     let timers that are not precise expire\n"
+         "                       together on multiples of ms, default 0\n"
          "\n"
          "Enviromental variables:\n"
          "NODE_PATH              ':'-separated list of directories\n"
          "                       prefixed to the module search path.\n"
          "NODE_MODULE_CONTEXTS   Set to 1 to load modules in their own\n"
          "                       global contexts.\n"
+         "NODE_CODE_CACHE        Directory in which to keep parser data\n"
+         "                       for faster loading of modules.\n"
          "NODE_DISABLE_COLORS    Set to 1 to disable colors in the REPL\n"
+         "NODE_TRACE_STARTUP     Set to 1 to list the modules and bindings\n"
+         "                       loaded before the main script.\n"
          "\n"
          "Documentation can be found at http://nodejs.org/\n");
 }
@@ -2102,6 +2827,17 @@ NodeOptions::NodeOptions() {
   debug_wait_connect = false;
   debug_port = 5858;
   max_stack_size = 0;
+  max_old_space = 0;
+  max_new_space = 0;
+  fs_max_poll_reqs = 0;
+  fs_priority = 0;
+  fs_max_threads = 0;
+  gc_fast_tick = FAST_TICK;
+  gc_wait_time = GC_WAIT_TIME;
+  idle_retain = IDLE_RETAIN;
+  timer_slack = 0;
+  fs_threads = 0;
+  isolate_pool_size = 0;
 }
 
 NodeOptions::~NodeOptions() {}
@@ -2142,6 +2878,46 @@ void NodeOptions::ParseArgs(int argc, char **argv) {
       p = 1 + strchr(arg, '=');
       max_stack_size = atoi(p);
       argv[i] = const_cast<char*>("");
+    } else if (strstr(arg, "--max-old-space=") == arg) {
+      int mb = atoi(1 + strchr(arg, '='));
+      if (mb > 0) max_old_space = mb;
+      argv[i] = const_cast<char*>("");
+    } else if (strstr(arg, "--max-new-space=") == arg) {
+      int mb = atoi(1 + strchr(arg, '='));
+      if (mb > 0) max_new_space = mb;
+      argv[i] = const_cast<char*>("");
+    } else if (strstr(arg, "--fs-threads=") == arg) {
+      fs_threads = atoi(1 + strchr(arg, '='));
+      argv[i] = const_cast<char*>("");
+    } else if (strstr(arg, "--isolate-pool=") == arg) {
+      isolate_pool_size = atoi(1 + strchr(arg, '='));
+      argv[i] = const_cast<char*>("");
+    } else if (strstr(arg, "--fs-max-poll-reqs=") == arg) {
+      fs_max_poll_reqs = atoi(1 + strchr(arg, '='));
+      argv[i] = const_cast<char*>("");
+    } else if (strstr(arg, "--fs-priority=") == arg) {
+      fs_priority = atoi(1 + strchr(arg, '='));
+      argv[i] = const_cast<char*>("");
+    } else if (strstr(arg, "--fs-max-threads=") == arg) {
+      int n = atoi(1 + strchr(arg, '='));
+      fs_max_threads = n > 0 ? n : 0;
+      argv[i] = const_cast<char*>("");
+    } else if (strstr(arg, "--gc-fast-tick=") == arg) {
+      int ms = atoi(1 + strchr(arg, '='));
+      if (ms > 0) gc_fast_tick = ms;
+      argv[i] = const_cast<char*>("");
+    } else if (strstr(arg, "--gc-wait-time=") == arg) {
+      int ms = atoi(1 + strchr(arg, '='));
+      if (ms > 0) gc_wait_time = ms;
+      argv[i] = const_cast<char*>("");
+    } else if (strstr(arg, "--idle-retain=") == arg) {
+      int kb = atoi(1 + strchr(arg, '='));
+      idle_retain = kb >= 0 ? kb : -1;
+      argv[i] = const_cast<char*>("");
+    } else if (strstr(arg, "--timer-slack=") == arg) {
+      int ms = atoi(1 + strchr(arg, '='));
+      timer_slack = ms > 0 ? ms : 0;
+      argv[i] = const_cast<char*>("");
     } else if (strcmp(arg, "--eval") == 0 || strcmp(arg, "-e") == 0) {
       if (argc <= i + 1) {
         fprintf(stderr, "Error: --eval requires an argument\n");
@@ -2186,7 +2962,20 @@ void NodeOptions::ParseDebugOpt(const char* arg) {
   EXIT(1);
 }
   
-void NodeOptions::SetResourceConstraints() {
+// Applies to the current v8::Isolate. The heap limits can only be set before
+// its heap is set up, so callers pass configure_heap = false afterwards.
+void NodeOptions::SetResourceConstraints(bool configure_heap) {
+  v8::ResourceConstraints constraints;
+  bool set = false;
+
+  if (configure_heap && max_old_space) {
+    constraints.set_max_old_space_size(max_old_space * MB);
+    set = true;
+  }
+  if (configure_heap && max_new_space) {
+    constraints.set_max_young_space_size(max_new_space * MB);
+    set = true;
+  }
   if(max_stack_size) {
     // For the normal stack which moves from high to low addresses when frames
     // are pushed, we can compute the limit as stack_size bytes below the
@@ -2196,8 +2985,9 @@ void NodeOptions::SetResourceConstraints() {
     uint32_t stack_var;
     uint32_t *stack_limit = &stack_var - (max_stack_size / sizeof(uint32_t));
     constraints.set_stack_limit(stack_limit);
-    v8::SetResourceConstraints(&constraints);
+    set = true;
   }
+  if (set) v8::SetResourceConstraints(&constraints);
 }
 
 
@@ -2429,11 +3219,20 @@ static Handle<Value> DebugProcess(const Arguments& args) {
 #endif // _WIN32
 
 
-int Isolate::Init(int argc, char *argv[]) {
+int Isolate::Init(int argc, char *argv[], bool configure_heap) {
   // Parse options, inheriting already-provided global options
   options = node::options;
   options.ParseArgs(argc, argv);
-  options.SetResourceConstraints();
+  options.SetResourceConstraints(configure_heap);
+  V8::AddGCPrologueCallback(GCStart);
+  V8::AddGCEpilogueCallback(GCDone);
+  V8::AddGCEpilogueCallback(HeapLimitCheck);
+
+  uv_threadpool_set_max_poll_reqs(Loop(), options.fs_max_poll_reqs);
+  uv_threadpool_set_priority(Loop(), options.fs_priority);
+  uv_threadpool_set_max_threads(Loop(), options.fs_max_threads);
+  uv_work_set_batch_cb(Loop(), DrainWork);
+  timer_slack = options.timer_slack;
 
   uv_prepare_init(Loop(), &prepare_tick_watcher);
   uv_prepare_start(&prepare_tick_watcher, PrepareTick);
@@ -2443,7 +3242,7 @@ int Isolate::Init(int argc, char *argv[]) {
   uv_check_start(&check_tick_watcher,CheckTick);
   uv_unref(Loop());
 
-  uv_idle_init(Loop(), &tick_spinner);
+  uv_async_init(Loop(), &tick_async, TickAsync);
   uv_unref(Loop());
 
   uv_check_init(Loop(), &gc_check);
@@ -2504,6 +3303,7 @@ void Isolate::EmitExit(v8::Handle<v8::Object> process) {
   if (try_catch.HasCaught()) {
     FatalException(try_catch);
   }
+  FlushStdio(process);
 }
 
 
@@ -2522,20 +3322,24 @@ int Isolate::Start(uv_thread_shared_t *hnd) {
   if(hnd->stdout_fd >= 0) stdout_fd = hnd->stdout_fd;
   if(hnd->stderr_fd >= 0) stderr_fd = hnd->stderr_fd;
 
-  // Get and enter v8::Isolate
+  if (prepared) return Resume(argc, hnd->args, hnd->env);
+
+  // Get and enter v8::Isolate; the heap of one that is already running was
+  // configured by node::Initialize()
   isolate = v8::Isolate::GetCurrent();
+  bool configure_heap = !isolate;
   if(!isolate) isolate = v8::Isolate::New();
   isolate->SetData(this);
   v8::Locker locker(isolate);
   v8::Isolate::Scope isolate_scope(isolate);
   
   // Process arguments and other Isolate-wide init
-  Init(argc, hnd->args);
+  Init(argc, hnd->args, configure_heap);
   RETURN_ON_EXIT(exit_status);
 
   // Create the one and only Context for this isolate.
   v8::HandleScope handle_scope;
-  Persistent<v8::Context> context = v8::Context::New();
+  context = v8::Context::New();
   v8::Context::Scope context_scope(context);
 
   // set up JS-side prerequisites
@@ -2549,6 +3353,90 @@ int Isolate::Start(uv_thread_shared_t *hnd) {
   Load(process);
   RETURN_ON_EXIT(exit_status);
 
+  return Run(process);
+}
+
+int Isolate::Prepare(int argc, char *argv[]) {
+  assert(!prepared);
+
+  // A prepared instance can be started on another thread, so it always
+  // gets its own v8::Isolate.
+  isolate = v8::Isolate::New();
+  isolate->SetData(this);
+  v8::Locker locker(isolate);
+  v8::Isolate::Scope isolate_scope(isolate);
+
+  Init(argc, argv, true);
+  RETURN_ON_EXIT(exit_status);
+
+  v8::HandleScope handle_scope;
+  context = v8::Context::New();
+  v8::Context::Scope context_scope(context);
+
+  SetupLocalEnv(NULL);
+  Handle<Object> process = SetupProcessObject(argc, argv);
+  process->Set(String::NewSymbol("_pooled"), True());
+  v8_typed_array::AttachBindings(context->Global());
+  RETURN_ON_EXIT(exit_status);
+
+  // src/node.js stops before the main script and leaves process._runMain()
+  Load(process);
+  RETURN_ON_EXIT(exit_status);
+
+  prepared = true;
+  return 0;
+}
+
+bool Isolate::IsPrepared() {
+  return prepared;
+}
+
+// Starts a prepared instance. Options that affect the bootstrap were fixed
+// by Prepare(); the script, its arguments, the environment and stdio are
+// taken from here.
+int Isolate::Resume(int argc, char *argv[], char *env[]) {
+  prepared = false;
+
+  v8::Locker locker(isolate);
+  v8::Isolate::Scope isolate_scope(isolate);
+
+  NodeOptions run_options = options;
+  run_options.ParseArgs(argc, argv);
+  options.args_start_index = run_options.args_start_index;
+  options.eval_string = run_options.eval_string;
+  RETURN_ON_EXIT(exit_status);
+
+  // The stack limit belongs to the thread that runs the instance
+  options.SetResourceConstraints(false);
+
+  v8::HandleScope handle_scope;
+  v8::Context::Scope context_scope(context);
+
+  if (env) SetupLocalEnv(env);
+  Local<Object> process_l = Local<Object>::New(process);
+  SetupArgv(process_l, argc, argv);
+  SetupStdioFds(process_l);
+  if (options.eval_string) {
+    process_l->Set(String::NewSymbol("_eval"),
+                   String::New(options.eval_string));
+  }
+
+  Local<Value> run_main_v = process_l->Get(String::NewSymbol("_runMain"));
+  assert(run_main_v->IsFunction());
+  Local<Function> run_main = Local<Function>::Cast(run_main_v);
+
+  TryCatch try_catch;
+  run_main->Call(process_l, 0, NULL);
+  if (try_catch.HasCaught()) {
+    ReportException(try_catch, true);
+    EXIT(11);
+  }
+  RETURN_ON_EXIT(exit_status);
+
+  return Run(process_l);
+}
+
+int Isolate::Run(Handle<Object> process) {
   // All our arguments are loaded. We've evaluated all of the scripts. We
   // might even have created TCP servers. Now we enter the main eventloop. If
   // there are no watchers on the loop (except for the ones that were
@@ -2557,7 +3445,8 @@ int Isolate::Start(uv_thread_shared_t *hnd) {
   uv_run(Loop());
   RETURN_ON_EXIT(exit_status);
 
-  EmitExit(process);
+  // like a process killed with SIGKILL, a stopped instance gets no 'exit'
+  if (term_signal != SIGKILL) EmitExit(process);
   if(exitHandler) exitHandler();
 #ifndef NDEBUG
   // Clean up.
@@ -2567,6 +3456,171 @@ int Isolate::Start(uv_thread_shared_t *hnd) {
   return exit_status;
 }
 
+
+IsolatePool::IsolatePool(int argc, char *argv[]) {
+  uv_mutex_init(&mutex_);
+  entries_ = NULL;
+  size_ = 0;
+  target_ = 0;
+  filling_ = false;
+
+  // Init() blanks out the options it has parsed, so keep a private copy
+  argc_ = argc;
+  argv_ = new char*[argc + 1];
+  for (int i = 0; i < argc; i++) argv_[i] = strdup(argv[i]);
+  argv_[argc] = NULL;
+}
+
+IsolatePool::~IsolatePool() {
+  while (entries_) {
+    Entry* entry = entries_;
+    entries_ = entry->next;
+    entry->isolate->Dispose();
+    delete entry->isolate;
+    delete entry;
+  }
+  for (int i = 0; i < argc_; i++) free(argv_[i]);
+  delete [] argv_;
+  uv_mutex_destroy(&mutex_);
+}
+
+int IsolatePool::Fill(int count) {
+  while (Size() < count) {
+    char** argv = new char*[argc_ + 1];
+    memcpy(argv, argv_, (argc_ + 1) * sizeof(char*));
+
+    Isolate* isolate = Isolate::New();
+    int r = isolate->Prepare(argc_, argv);
+    delete [] argv;
+
+    if (r != 0 || !isolate->IsPrepared()) {
+      isolate->Dispose();
+      delete isolate;
+      break;
+    }
+
+    Entry* entry = new Entry;
+    entry->isolate = isolate;
+    uv_mutex_lock(&mutex_);
+    entry->next = entries_;
+    entries_ = entry;
+    size_++;
+    uv_mutex_unlock(&mutex_);
+  }
+
+  return Size();
+}
+
+Isolate* IsolatePool::Take() {
+  uv_mutex_lock(&mutex_);
+  Entry* entry = entries_;
+  if (entry) {
+    entries_ = entry->next;
+    size_--;
+  }
+  uv_mutex_unlock(&mutex_);
+
+  if (!entry) return Isolate::New();
+
+  Isolate* isolate = entry->isolate;
+  delete entry;
+  return isolate;
+}
+
+int IsolatePool::Size() {
+  uv_mutex_lock(&mutex_);
+  int size = size_;
+  uv_mutex_unlock(&mutex_);
+  return size;
+}
+
+static IsolatePool* default_pool = NULL;
+
+#define FILL_DELAY 50
+
+void IsolatePool::SetDefault(IsolatePool* pool, int size) {
+  if (pool) pool->target_ = size;
+  default_pool = pool;
+}
+
+IsolatePool* IsolatePool::GetDefault() {
+  return default_pool;
+}
+
+void IsolatePool::FillThread(void* arg) {
+  IsolatePool* pool = static_cast<IsolatePool*>(arg);
+  pool->Fill(pool->target_);
+  uv_mutex_lock(&pool->mutex_);
+  pool->filling_ = false;
+  uv_mutex_unlock(&pool->mutex_);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall FillThreadMain(void* arg) {
+  IsolatePool::FillThread(arg);
+  return 0;
+}
+#else
+static void* FillThreadMain(void* arg) {
+  IsolatePool::FillThread(arg);
+  return NULL;
+}
+#endif
+
+static void FreeFillTimer(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_timer_t*>(handle);
+}
+
+// Preparing an instance takes tens of milliseconds of CPU, so it is done on
+// a detached thread of its own rather than the thread pool, where it would
+// hold up fs requests. Nothing waits for it: the process can exit in the
+// middle of a fill.
+void IsolatePool::FillTimer(uv_timer_t* timer, int status) {
+  IsolatePool* pool = static_cast<IsolatePool*>(timer->data);
+  bool started;
+#ifdef _WIN32
+  uintptr_t thread = _beginthreadex(NULL, 0, FillThreadMain, pool, 0, NULL);
+  started = thread != 0;
+  if (started) CloseHandle(reinterpret_cast<HANDLE>(thread));
+#else
+  pthread_t thread;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  started = pthread_create(&thread, &attr, FillThreadMain, pool) == 0;
+  pthread_attr_destroy(&attr);
+#endif
+
+  if (!started) {
+    uv_mutex_lock(&pool->mutex_);
+    pool->filling_ = false;
+    uv_mutex_unlock(&pool->mutex_);
+  }
+
+  uv_ref(timer->loop);
+  uv_close(reinterpret_cast<uv_handle_t*>(timer), FreeFillTimer);
+}
+
+void IsolatePool::FillDefault(uv_loop_t* loop) {
+  IsolatePool* pool = default_pool;
+  if (!pool) return;
+
+  uv_mutex_lock(&pool->mutex_);
+  bool start = !pool->filling_ && pool->size_ < pool->target_;
+  if (start) pool->filling_ = true;
+  uv_mutex_unlock(&pool->mutex_);
+  if (!start) return;
+
+  // Wait a little before preparing replacements, so they don't compete with
+  // an instance that was just handed out. Neither the timer nor the fill
+  // keeps the loop alive.
+  uv_timer_t* timer = new uv_timer_t;
+  uv_timer_init(loop, timer);
+  timer->data = pool;
+  uv_timer_start(timer, FillTimer, FILL_DELAY, 0);
+  uv_unref(loop);
+}
+
 uv_loop_t *Isolate::Loop() {
     return loop_;
 }
@@ -2576,12 +3630,54 @@ uv_loop_t *Isolate::GetLoop() {
 }
     
 Isolate::Isolate() {
+  memset(&statics_, 0, sizeof(statics_));
+  handle_wraps = NULL;
+  req_wraps = 0;
+  req_wrap_pool_count = 0;
+  req_wrap_pool_hits = 0;
+  req_wrap_pool_misses = 0;
+  req_wrap_pool_drops = 0;
+  async_tracking = false;
+  async_context = 0;
+  timer_slack = 0;
+  async_ring = NULL;
+  async_ring_count = 0;
+  async_ring_read = 0;
+  isolate = NULL;
   check_tick_watcher.data = this;
   prepare_tick_watcher.data = this;
-  tick_spinner.data = this;
+  tick_async.data = this;
+  need_tick_cb = false;
+  tick_info[0] = 0;
+  need_immediate_cb = false;
+  immediate_info[0] = 0;
+  loop_prepare_time = 0;
+  loop_check_time = 0;
+  loop_iterations = 0;
+  loop_poll_total = 0;
+  loop_callback_total = 0;
+  loop_last_poll = 0;
+  loop_last_callback = 0;
+  loop_max_callback = 0;
+  callback_count = 0;
+  callback_total = 0;
+  callback_max = 0;
+  memset(callback_buckets, 0, sizeof(callback_buckets));
+  memset(&gc_scavenge, 0, sizeof(gc_scavenge));
+  memset(&gc_mark_sweep, 0, sizeof(gc_mark_sweep));
+  gc_start_time = 0;
+  gc_start_used = 0;
   gc_check.data = this;
   gc_idle.data = this;
   gc_timer.data = this;
+  gc_idle_steps = 0;
+  gc_idle_deferred = 0;
+  gc_idle_overruns = 0;
+  gc_idle_collisions = 0;
+  gc_idle_callbacks = 0;
+  gc_idle_iteration = 0;
+  gc_idle_unchecked = false;
+  idle_released_bytes = 0;
     
 #ifdef OPENSSL_NPN_NEGOTIATED
   use_npn = true;
@@ -2597,23 +3693,141 @@ Isolate::Isolate() {
   use_sni = false;
 #endif
   tick_time_head = 0;
+  memset(tick_times, 0, sizeof(tick_times));
   uncaught_exception_counter = 0;
   exit_status = 0;
   term_signal = 0;
   loop_ = (this == &defaultIsolate) ? uv_default_loop(): uv_loop_new();
+  loop_->data = this;
   exitHandler = 0;
+  cleanup_hooks = NULL;
+  heap_limit_cb = NULL;
+  heap_limit_data = NULL;
+  heap_limit_percent = 0;
+  heap_limit_hit = false;
+  prepared = false;
 }
 
 Isolate::~Isolate() {
+    RunCleanupHooks();
+    delete[] async_ring;
     if(this != &defaultIsolate) uv_loop_delete(loop_);
 }
+
+void Isolate::RunCleanupHooks() {
+  while (CleanupHook* hook = cleanup_hooks) {
+    cleanup_hooks = hook->next;
+    hook->fn(hook->arg);
+    delete hook;
+  }
+}
+
+// ext_statics is a struct of ModuleStatics pointers only
+void Isolate::FreeStatics() {
+  ModuleStatics** statics = reinterpret_cast<ModuleStatics**>(&statics_);
+  for (size_t i = 0; i < sizeof(statics_) / sizeof(*statics); i++) {
+    delete statics[i];
+    statics[i] = NULL;
+  }
+}
+
+void Isolate::AddCleanupHook(void (*fn)(void*), void* arg) {
+  CleanupHook* hook = new CleanupHook;
+  hook->fn = fn;
+  hook->arg = arg;
+  hook->next = cleanup_hooks;
+  cleanup_hooks = hook;
+}
+
+void Isolate::RemoveCleanupHook(void (*fn)(void*), void* arg) {
+  for (CleanupHook** p = &cleanup_hooks; *p; p = &(*p)->next) {
+    if ((*p)->fn == fn && (*p)->arg == arg) {
+      CleanupHook* hook = *p;
+      *p = hook->next;
+      delete hook;
+      return;
+    }
+  }
+}
   
+void Isolate::SetHeapLimitCallback(HeapLimitCallback cb, void* data,
+                                   int percent) {
+  heap_limit_cb = cb;
+  heap_limit_data = data;
+  heap_limit_percent = percent;
+  heap_limit_hit = false;
+}
+
+void Isolate::HeapLimitCheck(GCType type, GCCallbackFlags flags) {
+  Isolate *isolate = Isolate::GetCurrent();
+  if (!isolate->heap_limit_cb) return;
+
+  size_t limit = static_cast<size_t>(isolate->options.max_old_space +
+                                     isolate->options.max_new_space) * MB;
+  if (!limit) return;
+
+  HeapStatistics v8_heap_stats;
+  V8::GetHeapStatistics(&v8_heap_stats);
+  size_t used = v8_heap_stats.used_heap_size();
+
+  if (used * 100 < limit * isolate->heap_limit_percent) {
+    isolate->heap_limit_hit = false;
+  } else if (!isolate->heap_limit_hit) {
+    isolate->heap_limit_hit = true;
+    isolate->heap_limit_cb(isolate, used, limit, isolate->heap_limit_data);
+  }
+}
+
+void Isolate::GCStart(GCType type, GCCallbackFlags flags) {
+  Isolate *isolate = Isolate::GetCurrent();
+  HeapStatistics v8_heap_stats;
+  V8::GetHeapStatistics(&v8_heap_stats);
+  isolate->gc_start_used = v8_heap_stats.used_heap_size();
+  isolate->gc_start_time = uv_hrtime();
+}
+
+void Isolate::GCDone(GCType type, GCCallbackFlags flags) {
+  Isolate *isolate = Isolate::GetCurrent();
+  if (!isolate->gc_start_time) return;
+  uint64_t pause = uv_hrtime() - isolate->gc_start_time;
+  isolate->gc_start_time = 0;
+
+  HeapStatistics v8_heap_stats;
+  V8::GetHeapStatistics(&v8_heap_stats);
+  size_t used = v8_heap_stats.used_heap_size();
+
+  GCKindStats& kind = type == kGCTypeScavenge ? isolate->gc_scavenge
+                                              : isolate->gc_mark_sweep;
+  kind.count++;
+  kind.pause_total += pause;
+  kind.last_pause = pause;
+  if (pause > kind.pause_max) kind.pause_max = pause;
+  kind.buckets[DurationBucket(pause)]++;
+  if (used < isolate->gc_start_used) {
+    kind.reclaimed += static_cast<double>(isolate->gc_start_used - used);
+  }
+}
+
 Isolate *Isolate::New() {
   return new Isolate();
 }
   
 void Isolate::Dispose() {
+  if (!isolate) return;
+  {
+    v8::Locker locker(isolate);
+    v8::Isolate::Scope isolate_scope(isolate);
+    RunCleanupHooks();
+    // Stop() leaves servers and sockets open; their fds must not outlive
+    // the instance
+    HandleWrap::CloseAll();
+    while (req_wrap_pool_count > 0) {
+      req_wrap_pool[--req_wrap_pool_count].Dispose();
+    }
+    FreeStatics();
+  }
   isolate->Dispose();
+  isolate = NULL;
 }
   
 int Isolate::Stop(int signum) {
@@ -2624,7 +3838,8 @@ int Isolate::Stop(int signum) {
    * execution to return back to the event loop */
   if(signum == SIGKILL || signum == SIGABRT) {
     term_signal = signum;
-    V8::TerminateExecution(isolate);
+    // a NULL isolate would terminate the caller's
+    if (isolate) V8::TerminateExecution(isolate);
   }
   return exit_status;
 }
@@ -2653,11 +3868,20 @@ int Initialize(int argc, char *argv[]) {
     
   // now initialise v8 with options and resource constraints
   options.SetResourceConstraints();
+  uv_threadpool_set_size(options.fs_threads);
   V8::SetFlagsFromCommandLine(&v8argc, v8argv, false);
   V8::Initialize();
   
   // overwrite the processed option arguments to avoid them being re-processed
   for(int i=1; i < options.args_start_index; i++) argv[i] = const_cast<char*>("");
+
+#if defined(NODE_FORK_ISOLATE)
+  if (options.isolate_pool_size > 0) {
+    IsolatePool::SetDefault(new IsolatePool(1, argv),
+                            options.isolate_pool_size);
+    IsolatePool::FillDefault(uv_default_loop());
+  }
+#endif
   
 #if defined(__POSIX__) && !defined(NODE_LIBRARY)
   // Ignore SIGPIPE
@@ -108,6 +108,8 @@
 
 namespace node {
 
+class HandleWrap;
+
 class NodeOptions {
 public:
   // the index of the first non-option argument, after processing
@@ -115,14 +117,33 @@ public:
   // instance options, may be specified globally or per-isolate
   char *eval_string;
   int max_stack_size;
-  v8::ResourceConstraints constraints;
+  // heap limits of the isolate in MB, 0 for V8's defaults; these only take
+  // effect before the isolate's heap is set up
+  int max_old_space;
+  int max_new_space;
+  // thread pool use of the isolate's loop, see uv_threadpool_set_*()
+  int fs_max_poll_reqs;
+  int fs_priority;
+  int fs_max_threads;
+  // idle GC heuristics, in ms: an idle GC starts after gc_wait_time without
+  // two loop iterations closer together than gc_fast_tick
+  int gc_fast_tick;
+  int gc_wait_time;
+  // KB that each pool of freed memory (Buffer arenas, slabs, zlib streams,
+  // header arenas) keeps when the isolate goes idle, the rest is handed
+  // back to the OS; -1 to keep everything
+  int idle_retain;
+  // timer slack in ms, see process.setTimerSlack(); 0 for none
+  int timer_slack;
   // global-only (debug) options, ignored if passed as isolate options
+  int fs_threads;
+  int isolate_pool_size;
   bool use_debug_agent;
   bool debug_wait_connect;
   int debug_port;
   void ParseArgs(int argc, char **argv);
   void ParseDebugOpt(const char* arg);
-  void SetResourceConstraints();
+  void SetResourceConstraints(bool configure_heap = true);
   NodeOptions();
   ~NodeOptions();
 };
@@ -132,12 +153,38 @@ public:
     NODE_EXTERN static Isolate* GetDefault();
     NODE_EXTERN static Isolate* GetCurrent();
     static uv_loop_t* GetCurrentLoop();
-    int Start(uv_thread_shared_t *options);
+    // The isolate that owns loop. Cheaper than GetCurrent() where a handle
+    // or request, and so its loop, is at hand.
+    static Isolate* FromLoop(uv_loop_t* loop) {
+      return static_cast<Isolate*>(loop->data);
+    }
+    NODE_EXTERN int Start(uv_thread_shared_t *options);
     NODE_EXTERN int Start(int argc, char *argv[]);
+    // Boots the instance up to the point just before the main script runs,
+    // on the calling thread. Start(), on any thread, then runs the script.
+    NODE_EXTERN int Prepare(int argc, char *argv[]);
+    NODE_EXTERN bool IsPrepared();
+    // Makes Start() return. With SIGKILL or SIGABRT running JavaScript is
+    // terminated, and SIGKILL also skips process.on('exit') listeners.
     NODE_EXTERN int Stop(int signum);
     NODE_EXTERN static Isolate* New();
+    // Tears the instance down once Start() has returned: runs the cleanup
+    // hooks, closes the handles that are still open without running their
+    // callbacks, frees the per-module statics and disposes the v8::Isolate.
     NODE_EXTERN void Dispose();
     NODE_EXTERN void setExitHandler(void (*)());
+    // Hooks run on the isolate's thread when it is destroyed, before its
+    // loop goes away, most recently added first.
+    NODE_EXTERN void AddCleanupHook(void (*fn)(void*), void* arg);
+    NODE_EXTERN void RemoveCleanupHook(void (*fn)(void*), void* arg);
+    // Called on the isolate's thread after a GC that leaves more than percent
+    // of the --max-old-space plus --max-new-space limit in use, then not
+    // again until usage has dropped back below it. It runs inside the GC, so
+    // it may call Stop() but must not run JavaScript. Set before Start().
+    typedef void (*HeapLimitCallback)(Isolate* isolate, size_t used,
+                                      size_t limit, void* data);
+    NODE_EXTERN void SetHeapLimitCallback(HeapLimitCallback cb, void* data,
+                                          int percent = 90);
 
     v8::Local<v8::Value> ErrnoException(int errorno,
         const char *syscall = NULL,
@@ -149,6 +196,55 @@ public:
     NODE_EXTERN uv_loop_t *Loop();
     NODE_EXTERN uv_loop_t *GetLoop();
     ext_statics statics_;
+    // open handles, most recently created first; see HandleWrap::CloseAll()
+    HandleWrap* handle_wraps;
+    // ReqWraps created and not yet deleted; maintained by ReqWrap
+    unsigned int req_wraps;
+    // Request objects of finished ReqWraps, handed out again to new ones
+    // instead of making a new object and Persistent handle each time.
+#define REQ_WRAP_POOL_SIZE 128
+    v8::Persistent<v8::Object> req_wrap_pool[REQ_WRAP_POOL_SIZE];
+    int req_wrap_pool_count;
+    // For process.loopStats(): objects taken from the pool, made because it
+    // was empty, and disposed of because it was full.
+    double req_wrap_pool_hits;
+    double req_wrap_pool_misses;
+    double req_wrap_pool_drops;
+    // Counts a callback into JavaScript from the loop for process.loopStats().
+    void __RecordCallback(uint64_t nsecs);
+    // How long the last turn of the loop spent in callbacks, in uv_hrtime()
+    // nanoseconds; what every I/O event of the turn after had to wait.
+    uint64_t LastCallbackTime() { return loop_last_callback; }
+    // Timer slack, for process.setTimerSlack(). Timeouts that are not
+    // precise expire at the next multiple of timer_slack milliseconds of
+    // uv_now() instead, so that timeouts close together run in one wakeup.
+    int64_t timer_slack;
+    int64_t SlackExpiry(int64_t expires) {
+      if (timer_slack <= 0) return expires;
+      return (expires + timer_slack - 1) / timer_slack * timer_slack;
+    }
+    // Async contexts, for process.setAsyncContext(). While tracking is on,
+    // requests and handles keep the context that was current when they were
+    // made, as a hidden value under async_context_sym, and MakeCallback()
+    // makes it current again for their callbacks. Requests made in a
+    // context are recorded when they finish, in a ring of the last
+    // ASYNC_RING_SIZE; async_ring_count counts all records ever written and
+    // async_ring_read those process.asyncRecords() has returned.
+#define ASYNC_RING_SIZE 4096
+    struct AsyncRecord {
+      uint32_t context;
+      uint32_t type;  // uv_req_type
+      uint64_t start;
+      uint64_t end;
+    };
+    bool async_tracking;
+    uint32_t async_context;
+    v8::Persistent<v8::String> async_context_sym;
+    AsyncRecord* async_ring;
+    uint64_t async_ring_count;
+    uint64_t async_ring_read;
+    void __RecordAsync(uint32_t context, uint32_t type,
+                       uint64_t start, uint64_t end);
     int exit_status;
     int term_signal;
 
@@ -161,20 +257,27 @@ private:
 
     static void Idle(uv_idle_t* watcher, int status);
     static void Check(uv_check_t* watcher, int status);
-    static void Spin(uv_idle_t* handle, int status);
+    static void TickAsync(uv_async_t* handle, int status);
     static void PrepareTick(uv_prepare_t* handle, int status);
     static void CheckTick(uv_check_t* handle, int status);
     static void CheckStatus(uv_timer_t* watcher, int status);
+    static void HeapLimitCheck(v8::GCType type, v8::GCCallbackFlags flags);
+    static void GCStart(v8::GCType type, v8::GCCallbackFlags flags);
+    static void GCDone(v8::GCType type, v8::GCCallbackFlags flags);
 
     void __Idle(uv_idle_t* watcher, int status);
     void __Check(uv_check_t* watcher, int status);
-    void __Spin(uv_idle_t* handle, int status);
     void __PrepareTick(uv_prepare_t* handle, int status);
     void __CheckTick(uv_check_t* handle, int status);
     void __CheckStatus(uv_timer_t* watcher, int status);
+    void CheckIdleGCCollision();
+    void TrimIdleMemory();
     void Tick(void);
+    void RunImmediates(void);
 
     static v8::Handle<v8::Value> NeedTickCallback(const v8::Arguments& args);
+    static v8::Handle<v8::Value> NeedImmediateCallback(
+        const v8::Arguments& args);
     static v8::Handle<v8::Value> Chdir(const v8::Arguments& args);
     static v8::Handle<v8::Value> Cwd(const v8::Arguments& args);
     static v8::Handle<v8::Value> Umask(const v8::Arguments& args);
@@ -186,19 +289,34 @@ private:
 #endif // __POSIX__
     static v8::Handle<v8::Value> Exit(const v8::Arguments& args);
     static v8::Handle<v8::Value> MemoryUsage(const v8::Arguments& args);
+    static v8::Handle<v8::Value> LoopStats(const v8::Arguments& args);
+    static v8::Handle<v8::Value> GCStats(const v8::Arguments& args);
+    static v8::Handle<v8::Value> AsyncTracking(const v8::Arguments& args);
+    static v8::Handle<v8::Value> SetTimerSlack(const v8::Arguments& args);
+    static v8::Handle<v8::Value> SetAsyncContext(const v8::Arguments& args);
+    static v8::Handle<v8::Value> GetAsyncContext(const v8::Arguments& args);
+    static v8::Handle<v8::Value> AsyncRecords(const v8::Arguments& args);
     static v8::Handle<v8::Value> Kill(const v8::Arguments& args);
     static v8::Handle<v8::Value> Binding(const v8::Arguments& args);
 
     v8::Handle<v8::Object> GetFeatures();
 
-    int Init(int argc, char *argv[]);
+    int Init(int argc, char *argv[], bool configure_heap);
     v8::Handle<v8::Object> SetupProcessObject(int argc, char *argv[]);
     void SetupLocalEnv(char *env[]);
+    void SetupArgv(v8::Handle<v8::Object> process, int argc, char *argv[]);
+    void SetupStdioFds(v8::Handle<v8::Object> process);
     void Load(v8::Handle<v8::Object> process);
+    int Resume(int argc, char *argv[], char *env[]);
+    int Run(v8::Handle<v8::Object> process);
     void EmitExit(v8::Handle<v8::Object> process);
+    void RunCleanupHooks();
+    void FreeStatics();
 
     v8::Isolate *isolate;
+    v8::Persistent<v8::Context> context;
     v8::Persistent<v8::Object> process;
+    bool prepared;
     
     v8::Persistent<v8::String> errno_symbol;
     v8::Persistent<v8::String> syscall_symbol;
@@ -208,6 +326,10 @@ private:
     v8::Persistent<v8::String> rss_symbol;
     v8::Persistent<v8::String> heap_total_symbol;
     v8::Persistent<v8::String> heap_used_symbol;
+    v8::Persistent<v8::String> pinned_slabs_symbol;
+    v8::Persistent<v8::String> external_symbol;
+    v8::Persistent<v8::String> buffers_symbol;
+    v8::Persistent<v8::String> released_symbol;
     
     v8::Persistent<v8::String> listeners_symbol;
     v8::Persistent<v8::String> uncaught_exception_symbol;
@@ -218,11 +340,60 @@ private:
 
     uv_check_t check_tick_watcher;
     uv_prepare_t prepare_tick_watcher;
-    uv_idle_t tick_spinner;
+    uv_async_t tick_async;
     uv_async_t stop_watcher;
     
+    // Set, and the loop referenced, from the first nextTick() on an empty
+    // queue until Tick() finds the queue empty again.
     bool need_tick_cb;
     v8::Persistent<v8::String> tick_callback_sym;
+    // Shared with src/node.js as process._tickInfo. Its first element is the
+    // number of queued nextTick() callbacks, so that Tick() can tell whether
+    // there is anything to do without entering JavaScript.
+    uint32_t tick_info[1];
+
+    // The same for setImmediate() callbacks, shared as
+    // process._immediateInfo.
+    bool need_immediate_cb;
+    v8::Persistent<v8::String> immediate_callback_sym;
+    uint32_t immediate_info[1];
+
+    // Collected for process.loopStats(). Times are uv_hrtime() nanoseconds.
+    // An iteration is split at the check watcher, which runs straight after
+    // the poll: poll time runs from the prepare watcher up to it, callback
+    // time from it up to the next prepare watcher. Callback durations go
+    // into log2 buckets; bucket 0 is under 1us and bucket i under 2^i us.
+#define LOOP_STATS_BUCKETS 24
+    uint64_t loop_prepare_time;
+    uint64_t loop_check_time;
+    uint64_t loop_iterations;
+    uint64_t loop_poll_total;
+    uint64_t loop_callback_total;
+    uint64_t loop_last_poll;
+    uint64_t loop_last_callback;
+    uint64_t loop_max_callback;
+    uint64_t callback_count;
+    uint64_t callback_total;
+    uint64_t callback_max;
+    uint32_t callback_buckets[LOOP_STATS_BUCKETS];
+
+    // Collected for process.gcStats(), one set per kind of collection, in
+    // the same units and buckets as the callback figures above. reclaimed
+    // is what the collections took off the used heap size; for scavenges
+    // that excludes what they promoted to the old space.
+    struct GCKindStats {
+      uint64_t count;
+      uint64_t pause_total;
+      uint64_t pause_max;
+      uint64_t last_pause;
+      double reclaimed;
+      uint32_t buckets[LOOP_STATS_BUCKETS];
+    };
+    static v8::Local<v8::Object> GCKindStatsObject(const GCKindStats& kind);
+    GCKindStats gc_scavenge;
+    GCKindStats gc_mark_sweep;
+    uint64_t gc_start_time;
+    size_t gc_start_used;
 
     bool use_npn;
     bool use_sni;
@@ -243,20 +414,115 @@ private:
     uv_check_t gc_check;
     uv_idle_t gc_idle;
     uv_timer_t gc_timer;
+
+    // Idle notifications only go out when the next timer is far enough off
+    // for a full collection; collected for process.gcStats(). A step
+    // collided with I/O if the loop iteration after it ran callbacks, which
+    // had to wait for it.
+    uint64_t gc_idle_steps;
+    uint64_t gc_idle_deferred;
+    uint64_t gc_idle_overruns;
+    uint64_t gc_idle_collisions;
+    uint64_t gc_idle_callbacks;   // callback_count after the last step
+    uint64_t gc_idle_iteration;   // loop_iterations after the last step
+    bool gc_idle_unchecked;       // the last step awaits its collision check
+    // How much the resident set shrank when pools and the malloc heap were
+    // trimmed after idle GCs; see TrimIdleMemory().
+    uint64_t idle_released_bytes;
     uv_loop_t *loop_;
     
+    enum { RPM_SAMPLES = 100 };
+    int64_t tick_times[RPM_SAMPLES];
     int tick_time_head;
     
     v8::Persistent<v8::Object> binding_cache;
     v8::Persistent<v8::Array> module_load_list;
     void (*exitHandler)();
 
+    struct CleanupHook {
+      void (*fn)(void*);
+      void* arg;
+      CleanupHook* next;
+    };
+    CleanupHook* cleanup_hooks;
+
+    HeapLimitCallback heap_limit_cb;
+    void* heap_limit_data;
+    int heap_limit_percent;
+    bool heap_limit_hit;
+
+};
+
+// Keeps instances that were prepared ahead of time, so that starting one
+// doesn't pay for the bootstrap. All methods can be called from any thread.
+class IsolatePool {
+public:
+    // Instances are prepared with these arguments; only the script and its
+    // arguments, the environment and stdio are taken from Start().
+    NODE_EXTERN IsolatePool(int argc, char *argv[]);
+    NODE_EXTERN ~IsolatePool();
+    // Prepares instances on the calling thread until count are parked.
+    // Returns the number that are parked.
+    NODE_EXTERN int Fill(int count);
+    // Hands out a parked instance, or a new one if the pool is empty.
+    NODE_EXTERN Isolate* Take();
+    NODE_EXTERN int Size();
+
+    // The pool child_process.fork() takes instances from in isolate builds,
+    // kept at size instances. node sets one up for --isolate-pool=n.
+    NODE_EXTERN static void SetDefault(IsolatePool* pool, int size);
+    static IsolatePool* GetDefault();
+    // Tops the default pool up on a thread of its own, after a timer on
+    // loop.
+    static void FillDefault(uv_loop_t* loop);
+    // What that thread runs; not for use elsewhere.
+    static void FillThread(void* arg);
+
+private:
+    struct Entry {
+      Isolate* isolate;
+      Entry* next;
+    };
+
+    static void FillTimer(uv_timer_t* timer, int status);
+
+    uv_mutex_t mutex_;
+    Entry* entries_;
+    int size_;
+    int target_;
+    bool filling_;
+    char** argv_;
+    int argc_;
 };
 
 NODE_EXTERN int Start(int argc, char *argv[]);
 NODE_EXTERN int Initialize(int argc, char *argv[]);
 NODE_EXTERN void Dispose();
 
+// Posting to the channels of child_process.createChannel() from the host,
+// on any thread. A buffer's storage becomes the Buffer that JavaScript
+// receives, without a copy; free_cb(data, hint) runs once that is garbage
+// collected, or on whichever thread drops the message undelivered.
+struct ChannelBuffer {
+  char* data;
+  size_t length;
+  void (*free_cb)(char* data, void* hint);
+  void* hint;
+};
+// Posts a message to channel id. json is copied; buffers are referred to
+// from it as {"\u0000buffer": index}. Without json the message is an array
+// of the buffers. Returns 0, or -1 if there is no such channel or it has
+// been closed, the buffers having been freed.
+NODE_EXTERN int PostChannelMessage(int id, const char* json,
+                                   size_t json_length,
+                                   const ChannelBuffer* buffers, int count);
+// Runs task(arg, 0) on the thread of the isolate that owns channel id, in
+// order with its messages, with the isolate's context entered. If the
+// channel goes away first, task(arg, -1) runs instead, on any thread; if
+// it was gone already that is before PostChannelTask() returns -1.
+typedef void (*ChannelTask)(void* arg, int status);
+NODE_EXTERN int PostChannelTask(int id, ChannelTask task, void* arg);
+
 #define NODE_PSYMBOL(s) \
   v8::Persistent<v8::String>::New(v8::String::NewSymbol(s))
 
@@ -285,6 +551,16 @@ do {                                                                      \
 } while (0)
 
 enum encoding {ASCII, UTF8, BASE64, UCS2, BINARY, HEX};
+
+// What a uv_work_t is for, set in its work_type before it is queued. Only
+// used to count batched completions per kind, see process.uvCounters().
+enum WorkType {
+  WORK_OTHER = 0,
+  WORK_FS,
+  WORK_ZLIB,
+  WORK_CRYPTO
+};
+
 enum encoding ParseEncoding(v8::Handle<v8::Value> encoding_v,
                             enum encoding _default = BINARY);
 NODE_EXTERN void FatalException(v8::TryCatch &try_catch);
@@ -409,6 +685,10 @@ NODE_EXTERN void MakeCallback(v8::Handle<v8::Object> object,
                               const char* method,
                               int argc,
                               v8::Handle<v8::Value> argv[]);
+NODE_EXTERN void MakeCallback(v8::Handle<v8::Object> object,
+                              v8::Handle<v8::String> symbol,
+                              int argc,
+                              v8::Handle<v8::Value> argv[]);
 
 }  // namespace node
 #endif  // SRC_NODE_H_
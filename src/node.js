@@ -44,12 +44,33 @@
     startup.processKillAndExit();
     startup.processSignalHandlers();
 
-    startup.processChannel();
-
     startup.removedMethods();
 
+    // An instance prepared for an isolate pool stops here, before anything
+    // that depends on its arguments or environment. node::Isolate::Start()
+    // calls process._runMain() once the instance is handed out.
+    if (process._pooled) {
+      delete process._pooled;
+      // These don't look at the environment when they load
+      NativeModule.require('path');
+      NativeModule.require('fs');
+      process._runMain = function() {
+        delete process._runMain;
+        startup.processChannel();
+        startup.resolveArgv0();
+        startup.runMain();
+      };
+      return;
+    }
+
+    startup.processChannel();
+
     startup.resolveArgv0();
 
+    startup.runMain();
+  }
+
+  startup.runMain = function() {
     // There are various modes that Node can run in. The most common two
     // are running from a script and running the REPL - but there are a few
     // others like the debugger or running --eval arguments. Here we decide
@@ -68,6 +89,10 @@
       var d = NativeModule.require('_debugger');
       d.start();
 
+    } else if (process.env.NODE_ZYGOTE) {
+      // Started by child_process.createZygote() to fork children.
+      NativeModule.require('child_process')._zygoteMain();
+
     } else if (process._eval != null) {
       // User passed '-e' or '--eval' arguments to Node.
       var Module = NativeModule.require('module');
@@ -77,6 +102,7 @@
       var module = new Module('eval');
       module.filename = path.join(cwd, 'eval');
       module.paths = Module._nodeModulePaths(cwd);
+      if (process.env.NODE_TRACE_STARTUP) startup.traceStartup();
       module._compile('eval(process._eval)', 'eval');
 
     } else if (process.argv[1]) {
@@ -95,6 +121,7 @@
       // REMOVEME: nextTick should not be necessary. This hack to get
       // test/simple/test-exception-handler2.js working.
       // Main entry point into most programs:
+      if (process.env.NODE_TRACE_STARTUP) process.nextTick(startup.traceStartup);
       process.nextTick(Module.runMain);
 
     } else {
@@ -120,7 +147,7 @@
         });
       }
     }
-  }
+  };
 
   startup.globalVariables = function() {
     global.process = process;
@@ -150,6 +177,16 @@
       var t = NativeModule.require('timers');
       return t.clearInterval.apply(this, arguments);
     };
+
+    global.setImmediate = function() {
+      var t = NativeModule.require('timers');
+      return t.setImmediate.apply(this, arguments);
+    };
+
+    global.clearImmediate = function() {
+      var t = NativeModule.require('timers');
+      return t.clearImmediate.apply(this, arguments);
+    };
   };
 
   startup.globalConsole = function() {
@@ -159,6 +196,13 @@
   };
 
 
+  // Set NODE_TRACE_STARTUP=1 to print the modules and bindings that were
+  // loaded before the main script runs.
+  startup.traceStartup = function() {
+    var trace = 'startup: ' + process.moduleLoadList.join(', ') + '\n';
+    NativeModule.require('fs').writeSync(2, trace);
+  };
+
   startup._lazyConstants = null;
 
   startup.lazyConstants = function() {
@@ -179,32 +223,51 @@
   };
 
   startup.processNextTick = function() {
-    var nextTickQueue = [];
+    // A ring buffer whose size is a power of two, oldest callback at
+    // nextTickHead. The number of queued callbacks is kept in tickInfo[0],
+    // where Isolate::Tick() in src/node.cc reads it.
+    var nextTickQueue = new Array(16);
+    var nextTickHead = 0;
+    var tickInfo = process._tickInfo;
+
+    function growNextTickQueue() {
+      var size = nextTickQueue.length;
+      var queue = new Array(size * 2);
+      for (var i = 0; i < size; i++) {
+        queue[i] = nextTickQueue[(nextTickHead + i) & (size - 1)];
+      }
+      nextTickQueue = queue;
+      nextTickHead = 0;
+    }
 
     process._tickCallback = function() {
-      var l = nextTickQueue.length;
-      if (l === 0) return;
-
-      var q = nextTickQueue;
-      nextTickQueue = [];
-
-      try {
-        for (var i = 0; i < l; i++) q[i]();
+      // Callbacks queued from here on wait for the next tick. Each one is
+      // taken off the queue before it runs, so when it throws the rest are
+      // still queued and Tick() comes back for them.
+      var l = tickInfo[0];
+
+      while (l-- > 0) {
+        var callback = nextTickQueue[nextTickHead];
+        nextTickQueue[nextTickHead] = undefined;
+        nextTickHead = (nextTickHead + 1) & (nextTickQueue.length - 1);
+        tickInfo[0]--;
+        callback();
       }
-      catch (e) {
-        if (i + 1 < l) {
-          nextTickQueue = q.slice(i + 1).concat(nextTickQueue);
-        }
-        if (nextTickQueue.length) {
-          process._needTickCallback();
-        }
-        throw e; // process.nextTick error, or 'error' event on first tick
+
+      // Don't hold on to the queue a burst of callbacks left behind.
+      if (tickInfo[0] === 0 && nextTickQueue.length > 1024) {
+        nextTickQueue = new Array(16);
+        nextTickHead = 0;
       }
     };
 
     process.nextTick = function(callback) {
-      nextTickQueue.push(callback);
-      process._needTickCallback();
+      var length = tickInfo[0];
+      if (length === nextTickQueue.length) growNextTickQueue();
+      nextTickQueue[(nextTickHead + length) & (nextTickQueue.length - 1)] =
+          callback;
+      tickInfo[0] = length + 1;
+      if (length === 0) process._needTickCallback();
     };
   };
 
@@ -274,6 +337,51 @@
     return stream;
   }
 
+  // With NODE_STDIO_BUFFER set to a number of bytes, stdout gathers the
+  // strings written to it when it is a file or a pipe, and passes them on in
+  // one write when that many are waiting or at the end of the tick. A burst
+  // of console.log() calls then costs one system call instead of one each.
+  // Whatever is waiting is written out before the process exits, also when
+  // it dies of an exception.
+  function bufferStdioStream(stream, limit) {
+    var write = stream.write;
+    var pending = [];
+    var pendingLength = 0;
+    var scheduled = false;
+
+    function flush() {
+      scheduled = false;
+      if (pending.length === 0) return;
+
+      var data = pending.join('');
+      pending = [];
+      pendingLength = 0;
+      write.call(stream, data);
+    }
+
+    stream.write = function(data, encoding, cb) {
+      // Only plain strings are gathered, anything else goes out after them.
+      if (typeof data !== 'string' || typeof encoding === 'function' ||
+          cb || (encoding && encoding !== 'utf8')) {
+        flush();
+        return write.apply(stream, arguments);
+      }
+
+      pending.push(data);
+      pendingLength += data.length;
+
+      if (pendingLength >= limit) {
+        flush();
+      } else if (!scheduled) {
+        scheduled = true;
+        process.nextTick(flush);
+      }
+      return true;
+    };
+
+    stream._flush = flush;
+  }
+
   startup.processStdio = function() {
     var stdin, stdout, stderr;
 
@@ -283,9 +391,30 @@
       stdout.end = stdout.destroy = stdout.destroySoon = function() {
         throw new Error('process.stdout cannot be closed');
       };
+      var limit = +process.env.NODE_STDIO_BUFFER;
+      if (limit > 0 && stdout._type !== 'tty') {
+        bufferStdioStream(stdout, limit);
+      }
       return stdout;
     });
 
+    // Other buffered output, such as that of console loggers, adds a function
+    // here that writes it out synchronously.
+    process._exitFlushers = [];
+
+    // Called on the way out, from process.exit() and from src/node.cc.
+    process._flushStdio = function() {
+      var flushers = process._exitFlushers.slice();
+      if (stdout && stdout._flush) flushers.push(stdout._flush);
+      for (var i = 0; i < flushers.length; i++) {
+        try {
+          flushers[i]();
+        } catch (e) {
+          // Nowhere left to report it.
+        }
+      }
+    };
+
     process.__defineGetter__('stderr', function() {
       if (stderr) return stderr;
       stderr = createWritableStdioStream(process._stdio_fds[2]);
@@ -338,6 +467,7 @@
   startup.processKillAndExit = function() {
     process.exit = function(code) {
       process.emit('exit', code || 0);
+      process._flushStdio();
       process.reallyExit(code || 0);
     };
 
@@ -423,6 +553,15 @@
       cp._forkChild(fd);
       assert(process.send);
     }
+
+    // A worker started with child_process.createWorker() talks to its
+    // parent over channels instead.
+    if (process.env.NODE_WORKER_CHANNEL) {
+      var id = parseInt(process.env.NODE_WORKER_CHANNEL);
+      delete process.env.NODE_WORKER_CHANNEL;
+      NativeModule.require('child_process')._workerChild(id);
+      assert(process.send);
+    }
   }
 
   startup._removedProcessMethods = {
@@ -470,9 +609,6 @@
   // core modules found in lib/*.js. All core modules are compiled into the
   // node binary, so they can be loaded faster.
 
-  var Script = process.binding('evals').NodeScript;
-  var runInThisContext = Script.runInThisContext;
-
   function NativeModule(id) {
     this.filename = id + '.js';
     this.id = id;
@@ -529,10 +665,11 @@
   ];
 
   NativeModule.prototype.compile = function() {
-    var source = NativeModule.getSource(this.id);
-    source = NativeModule.wrap(source);
-
-    var fn = runInThisContext(source, this.filename, true);
+    var fn = process._compileNative(this.id,
+                                    NativeModule.wrapper[0],
+                                    NativeModule.wrapper[1],
+                                    this.filename,
+                                    process.env.NODE_CODE_CACHE || null);
     fn(this.exports, NativeModule.require, this, this.filename);
 
     this.loaded = true;
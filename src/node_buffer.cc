@@ -23,10 +23,13 @@
 #include <node.h>
 #include <node_statics.h>
 #include <node_buffer.h>
+#include <v8_typed_array.h>
 
 #include <v8.h>
 
 #include <assert.h>
+#include <math.h> // exp, log
+#include <stdio.h> // snprintf
 #include <stdlib.h> // malloc, free
 #include <string.h> // memcpy
 
@@ -38,6 +41,12 @@
 # include <arpa/inet.h> // htons, htonl
 #endif
 
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
 
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 
@@ -45,14 +54,349 @@ namespace node {
 
 using namespace v8;
     
+// Storage for buffers longer than BUFFER_ARENA_THRESHOLD and up to
+// BUFFER_ARENA_MAX bytes comes from size classes, four per power of two
+// starting at BUFFER_ARENA_MIN, and is recycled instead of going back to
+// malloc. Each isolate keeps a lock-free cache of freed blocks; blocks that
+// do not fit in it go to a depot shared by all isolates.
+#define BUFFER_ARENA_THRESHOLD (4 * 1024)
+#define BUFFER_ARENA_MIN (8 * 1024)
+#define BUFFER_ARENA_MAX (1024 * 1024)
+#define BUFFER_ARENA_CLASSES 29
+#define BUFFER_CACHE_BYTES (4 * 1024 * 1024)
+#define BUFFER_DEPOT_BYTES (16 * 1024 * 1024)
+
+// Freed blocks are chained through their first bytes.
+struct ArenaBlock {
+  ArenaBlock* next;
+};
+
+struct ArenaFreeList {
+  ArenaBlock* head;
+  size_t count;
+};
+
+static size_t arena_class_size[BUFFER_ARENA_CLASSES];
+
+static struct ArenaDepot {
+  ArenaDepot() {
+    uv_mutex_init(&mutex);
+    bytes = 0;
+    memset(lists, 0, sizeof(lists));
+
+    size_t base = BUFFER_ARENA_MIN;
+    arena_class_size[0] = base;
+    for (int i = 1; i < BUFFER_ARENA_CLASSES; i += 4, base *= 2) {
+      for (int j = 0; j < 4; j++) {
+        arena_class_size[i + j] = base + (j + 1) * (base / 4);
+      }
+    }
+    assert(arena_class_size[BUFFER_ARENA_CLASSES - 1] == BUFFER_ARENA_MAX);
+  }
+
+  uv_mutex_t mutex;
+  size_t bytes;
+  ArenaFreeList lists[BUFFER_ARENA_CLASSES];
+} arena_depot;
+
+
+// Buffer storage can be sampled by the JavaScript stack that allocated it,
+// on average once every `interval` bytes. A sample stands for the bytes
+// that went unsampled around it, so the live bytes of a site estimate all
+// the storage allocated there that is still held.
+#define BUFFER_SAMPLE_FRAMES 10
+#define BUFFER_SAMPLE_BUCKETS 256
+
+// Allocation sites are never freed before the isolate exits; a program
+// only has so many places that allocate buffers.
+struct BufferSampleSite {
+  BufferSampleSite* next;
+  uint32_t hash;
+  double live_bytes;
+  size_t live_count;
+  size_t stack_length;
+  char stack[1];  // frames separated by newlines, not terminated
+};
+
+
 class BufferStatics : public ModuleStatics {
+  BufferStatics() : pool_buffer(NULL),
+                    pool_used(0),
+                    arena_cached_bytes(0),
+                    arena_live_bytes(0),
+                    arena_reserved_bytes(0),
+                    arena_hits(0),
+                    arena_misses(0),
+                    held_bytes(0),
+                    sample_interval(0),
+                    sample_countdown(0),
+                    sample_seed(0x9e3779b9) {
+    memset(arena_cache, 0, sizeof(arena_cache));
+    memset(sample_sites, 0, sizeof(sample_sites));
+  }
+  ~BufferStatics();
+
   Persistent<String> length_symbol;
   Persistent<String> chars_written_sym;
   Persistent<String> write_sym;
   Persistent<FunctionTemplate> constructor_template;
+  Persistent<String> parent_sym;
+  Persistent<String> offset_sym;
+
+  // The SlowBuffer that allocFast() cuts small Buffers from.
+  Persistent<Object> pool;
+  Buffer* pool_buffer;
+  size_t pool_used;
+
+  ArenaFreeList arena_cache[BUFFER_ARENA_CLASSES];
+  size_t arena_cached_bytes;
+  size_t arena_live_bytes;
+  size_t arena_reserved_bytes;
+  double arena_hits;
+  double arena_misses;
+  // storage of all live Buffers, including storage they adopted
+  size_t held_bytes;
+
+  // mean number of bytes between samples, 0 when not sampling
+  double sample_interval;
+  double sample_countdown;
+  uint32_t sample_seed;
+  BufferSampleSite* sample_sites[BUFFER_SAMPLE_BUCKETS];
+
   friend class Buffer;
+  friend char* ArenaAlloc(BufferStatics* statics, size_t length);
+  friend void ArenaFree(BufferStatics* statics, char* data, size_t length);
 };
 
+
+// Returns the size class for `length`, or -1 if the arena does not serve it.
+static inline int ArenaClass(size_t length) {
+  if (length <= BUFFER_ARENA_THRESHOLD || length > BUFFER_ARENA_MAX) {
+    return -1;
+  }
+  int c = 0;
+  while (arena_class_size[c] < length) c++;
+  return c;
+}
+
+
+static inline ArenaBlock* ArenaPop(ArenaFreeList* list) {
+  ArenaBlock* block = list->head;
+  if (block) {
+    list->head = block->next;
+    list->count--;
+  }
+  return block;
+}
+
+
+static inline void ArenaPush(ArenaFreeList* list, char* data) {
+  ArenaBlock* block = reinterpret_cast<ArenaBlock*>(data);
+  block->next = list->head;
+  list->head = block;
+  list->count++;
+}
+
+
+// Hands a block back to the depot, or to malloc if the depot is full.
+static void ArenaRelease(int c, char* data) {
+  size_t size = arena_class_size[c];
+
+  uv_mutex_lock(&arena_depot.mutex);
+  if (arena_depot.bytes + size <= BUFFER_DEPOT_BYTES) {
+    ArenaPush(&arena_depot.lists[c], data);
+    arena_depot.bytes += size;
+    data = NULL;
+  }
+  uv_mutex_unlock(&arena_depot.mutex);
+
+  free(data);
+}
+
+
+char* ArenaAlloc(BufferStatics* statics, size_t length) {
+  int c = ArenaClass(length);
+  size_t size = arena_class_size[c];
+  ArenaBlock* block = ArenaPop(&statics->arena_cache[c]);
+
+  if (block) {
+    statics->arena_cached_bytes -= size;
+  } else {
+    uv_mutex_lock(&arena_depot.mutex);
+    block = ArenaPop(&arena_depot.lists[c]);
+    if (block) arena_depot.bytes -= size;
+    uv_mutex_unlock(&arena_depot.mutex);
+  }
+
+  if (block) {
+    statics->arena_hits++;
+  } else {
+    statics->arena_misses++;
+    block = static_cast<ArenaBlock*>(malloc(size));
+    if (block == NULL) return NULL;
+  }
+
+  statics->arena_live_bytes += length;
+  statics->arena_reserved_bytes += size;
+  return reinterpret_cast<char*>(block);
+}
+
+
+void ArenaFree(BufferStatics* statics, char* data, size_t length) {
+  int c = ArenaClass(length);
+  size_t size = arena_class_size[c];
+
+  statics->arena_live_bytes -= length;
+  statics->arena_reserved_bytes -= size;
+
+  if (statics->arena_cached_bytes + size <= BUFFER_CACHE_BYTES) {
+    ArenaPush(&statics->arena_cache[c], data);
+    statics->arena_cached_bytes += size;
+  } else {
+    ArenaRelease(c, data);
+  }
+}
+
+
+BufferStatics::~BufferStatics() {
+  for (int c = 0; c < BUFFER_ARENA_CLASSES; c++) {
+    while (ArenaBlock* block = ArenaPop(&arena_cache[c])) {
+      ArenaRelease(c, reinterpret_cast<char*>(block));
+    }
+  }
+
+  for (int i = 0; i < BUFFER_SAMPLE_BUCKETS; i++) {
+    BufferSampleSite* site = sample_sites[i];
+    while (site) {
+      BufferSampleSite* next = site->next;
+      free(site);
+      site = next;
+    }
+  }
+}
+
+// Slices shorter than this go straight to String::New; scanning them first
+// costs more than it saves.
+#define UTF8_SPLIT_MIN 64
+// Shortest ASCII run worth creating as a separate one-byte string.
+#define UTF8_ASCII_RUN_MIN 64
+// Upper bound on the number of pieces one slice is split into, so the
+// resulting cons string stays shallow.
+#define UTF8_MAX_PIECES 32
+// Number of UTF-16 units staged on the stack per String::Write call.
+#define UTF8_WRITE_CHUNK 1024
+
+
+// Returns the length of the leading run of bytes below 0x80.
+static size_t AsciiPrefixLength(const char* data, size_t len) {
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    if (_mm_movemask_epi8(v) != 0) break;
+  }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+    uint8x8_t m = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+    if (vget_lane_u64(vreinterpret_u64_u8(m), 0) & 0x8080808080808080ULL) {
+      break;
+    }
+  }
+#else
+  for (; i + sizeof(uintptr_t) <= len; i += sizeof(uintptr_t)) {
+    uintptr_t word;
+    memcpy(&word, data + i, sizeof(word));
+    if (word & (static_cast<uintptr_t>(-1) / 0xFF * 0x80)) break;
+  }
+#endif
+
+  while (i < len && !(data[i] & 0x80)) i++;
+  return i;
+}
+
+
+// Narrows UTF-16 units below 0x80 into bytes. Stops at the first unit that
+// needs more than one byte and returns the number of units consumed.
+static size_t NarrowAscii(char* dst, const uint16_t* src, size_t len) {
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= len; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+    __m128i t = _mm_and_si128(_mm_or_si128(a, b), high);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(t, zero)) != 0xFFFF) break;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packus_epi16(a, b));
+  }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+  for (; i + 8 <= len; i += 8) {
+    uint16x8_t v = vld1q_u16(src + i);
+    uint16x4_t m = vorr_u16(vget_low_u16(v), vget_high_u16(v));
+    if (vget_lane_u64(vreinterpret_u64_u16(m), 0) & 0xFF80FF80FF80FF80ULL) {
+      break;
+    }
+    vst1_u8(reinterpret_cast<uint8_t*>(dst + i), vmovn_u16(v));
+  }
+#endif
+
+  for (; i < len && src[i] < 0x80; i++) dst[i] = static_cast<char>(src[i]);
+  return i;
+}
+
+
+// Same output as String::WriteUtf8: every UTF-16 unit is encoded on its
+// own, and a character that does not fit in the remaining space is not
+// written at all.
+static int WriteUtf8Fast(Handle<String> s,
+                         char* dst,
+                         size_t capacity,
+                         int* chars_written) {
+  uint16_t units[UTF8_WRITE_CHUNK];
+  int length = s->Length();
+  size_t pos = 0;
+  int nchars = 0;
+
+  while (nchars < length && pos < capacity) {
+    int n = MIN(length - nchars, UTF8_WRITE_CHUNK);
+    s->Write(units, nchars, n, String::HINT_MANY_WRITES_EXPECTED |
+                               String::NO_NULL_TERMINATION);
+
+    int i = 0;
+    while (i < n) {
+      size_t run = NarrowAscii(dst + pos, units + i,
+                               MIN(static_cast<size_t>(n - i), capacity - pos));
+      pos += run;
+      i += run;
+      if (i == n || pos == capacity) break;
+
+      uint16_t c = units[i];
+      if (c < 0x800) {
+        if (pos + 2 > capacity) break;
+        dst[pos++] = 0xC0 | (c >> 6);
+        dst[pos++] = 0x80 | (c & 0x3F);
+      } else {
+        if (pos + 3 > capacity) break;
+        dst[pos++] = 0xE0 | (c >> 12);
+        dst[pos++] = 0x80 | ((c >> 6) & 0x3F);
+        dst[pos++] = 0x80 | (c & 0x3F);
+      }
+      i++;
+    }
+
+    nchars += i;
+    if (i < n) break;
+  }
+
+  *chars_written = nchars;
+  return pos;
+}
+
+
 #define SLICE_ARGS(start_arg, end_arg)                               \
   if (!start_arg->IsInt32() || !end_arg->IsInt32()) {                \
     return ThrowException(Exception::TypeError(                      \
@@ -73,8 +417,7 @@ class BufferStatics : public ModuleStatics {
           String::New("end cannot be longer than parent.length")));  \
   }
 
-static inline size_t base64_decoded_size(const char *src, size_t size) {
-  const char *const end = src + size;
+static inline size_t base64_decoded_size_fast(size_t size) {
   const int remainder = size % 4;
 
   size = (size / 4) * 3;
@@ -88,10 +431,20 @@ static inline size_t base64_decoded_size(const char *src, size_t size) {
     }
   }
 
+  return size;
+}
+
+// Only the trailing padding needs looking at, don't copy out the string.
+static inline size_t base64_decoded_size(Handle<String> string) {
+  const int length = string->Length();
+  size_t size = base64_decoded_size_fast(length);
+
   // check for trailing padding (1 or 2 bytes)
   if (size > 0) {
-    if (end[-1] == '=') size--;
-    if (end[-2] == '=') size--;
+    uint16_t tail[2];
+    string->Write(tail, length - 2, 2, String::NO_NULL_TERMINATION);
+    if (static_cast<char>(tail[1]) == '=') size--;
+    if (static_cast<char>(tail[0]) == '=') size--;
   }
 
   return size;
@@ -104,8 +457,7 @@ static size_t ByteLength (Handle<String> string, enum encoding enc) {
   if (enc == UTF8) {
     return string->Utf8Length();
   } else if (enc == BASE64) {
-    String::Utf8Value v(string);
-    return base64_decoded_size(*v, v.length());
+    return base64_decoded_size(string);
   } else if (enc == UCS2) {
     return string->Length() * 2;
   } else if (enc == HEX) {
@@ -186,6 +538,16 @@ Handle<Value> Buffer::New(const Arguments &args) {
     // var buffer = new Buffer(1024);
     size_t length = args[0]->Uint32Value();
     buffer = new Buffer(args.This(), length);
+  } else if (v8_typed_array::IsArrayBuffer(args[0])) {
+    // var buffer = new SlowBuffer(arrayBuffer);
+    // Shares the ArrayBuffer's memory, which stays alive as long as either.
+    size_t length;
+    void* hint;
+    char* data = v8_typed_array::RetainArrayBufferData(args[0]->ToObject(),
+                                                       &length,
+                                                       &hint);
+    buffer = new Buffer(args.This(), 0);
+    buffer->Replace(data, length, v8_typed_array::ReleaseArrayBufferData, hint);
   } else {
     return ThrowException(Exception::TypeError(String::New("Bad argument")));
   }
@@ -198,6 +560,7 @@ Buffer::Buffer(Handle<Object> wrapper, size_t length) : ObjectWrap() {
 
   length_ = 0;
   callback_ = NULL;
+  sample_site_ = NULL;
 
   Replace(NULL, length, NULL, NULL);
 }
@@ -208,26 +571,82 @@ Buffer::~Buffer() {
 }
 
 
+char* Buffer::Detach(Handle<Object> obj, size_t *length) {
+  HandleScope scope;
+  BufferStatics *statics = NODE_STATICS_GET(node_buffer, BufferStatics);
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(obj);
+
+  if (buffer->callback_ || buffer->length_ == 0) return NULL;
+
+  char *data = buffer->data_;
+  *length = buffer->length_;
+
+  // The block leaves this isolate's accounting; FreeDetached returns it to
+  // the shared depot rather than to any isolate's cache.
+  int c = ArenaClass(*length);
+  if (c >= 0) {
+    statics->arena_live_bytes -= *length;
+    statics->arena_reserved_bytes -= arena_class_size[c];
+  }
+  V8::AdjustAmountOfExternalAllocatedMemory(-(sizeof(Buffer) + *length));
+  statics->held_bytes -= *length;
+
+  buffer->length_ = 0;
+  buffer->data_ = NULL;
+  buffer->Replace(NULL, 0, NULL, NULL);
+  return data;
+}
+
+
+void Buffer::FreeDetached(char *data, void *hint) {
+  size_t length = reinterpret_cast<size_t>(hint);
+  int c = ArenaClass(length);
+  if (c >= 0) {
+    ArenaRelease(c, data);
+  } else {
+    delete [] data;
+  }
+}
+
+
 void Buffer::Replace(char *data, size_t length,
                      free_callback callback, void *hint) {
   HandleScope scope;
   BufferStatics *statics = NODE_STATICS_GET(node_buffer, BufferStatics);
 
+  if (sample_site_) ReleaseSample();
+
+  statics->held_bytes -= length_;
   if (callback_) {
     callback_(data_, callback_hint_);
   } else if (length_) {
-    delete [] data_;
+    if (ArenaClass(length_) >= 0) {
+      ArenaFree(statics, data_, length_);
+    } else {
+      delete [] data_;
+    }
     V8::AdjustAmountOfExternalAllocatedMemory(-(sizeof(Buffer) + length_));
   }
 
   length_ = length;
   callback_ = callback;
   callback_hint_ = hint;
+  statics->held_bytes += length_;
 
   if (callback_) {
     data_ = data;
   } else if (length_) {
-    data_ = new char[length_];
+    if (ArenaClass(length_) >= 0) {
+      data_ = ArenaAlloc(statics, length_);
+      if (data_ == NULL) {
+        // Same failure new[] would have had, without an allocator
+        // exception to carry it.
+        fprintf(stderr, "FATAL ERROR: Buffer allocation failed\n");
+        abort();
+      }
+    } else {
+      data_ = new char[length_];
+    }
     if (data)
       memcpy(data_, data, length_);
     V8::AdjustAmountOfExternalAllocatedMemory(sizeof(Buffer) + length_);
@@ -239,16 +658,158 @@ void Buffer::Replace(char *data, size_t length,
                                                    kExternalUnsignedByteArray,
                                                    length_);
   handle_->Set(statics->length_symbol, Integer::NewFromUnsigned(length_));
+
+  if (length_ && statics->sample_interval > 0) SampleAllocation();
 }
 
 
+// Returns the number of bytes until the next sample. The distances are
+// exponentially distributed so that every byte is equally likely to be
+// sampled, whatever the pattern of allocation sizes.
+static double SampleDistance(uint32_t* seed, double interval) {
+  uint32_t x = *seed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *seed = x;
+  return -log((x + 1.0) / 4294967296.0) * interval;
+}
+
+
+// Writes the JavaScript stack, innermost frame first, to `stack` and returns
+// its length. Buffers created with no JavaScript on the stack are put down
+// to a single "<native>" frame.
+static size_t FormatAllocationStack(char* stack, size_t size) {
+  HandleScope scope;
+  Local<StackTrace> trace = StackTrace::CurrentStackTrace(BUFFER_SAMPLE_FRAMES);
+  int frames = trace.IsEmpty() ? 0 : trace->GetFrameCount();
+  size_t length = 0;
+
+  for (int i = 0; i < frames; i++) {
+    Local<StackFrame> frame = trace->GetFrame(i);
+    String::Utf8Value name(frame->GetFunctionName());
+    String::Utf8Value script(frame->GetScriptName());
+
+    int n = snprintf(stack + length, size - length, "%s%s (%s:%d:%d)",
+                     i > 0 ? "\n" : "",
+                     name.length() > 0 ? *name : "<anonymous>",
+                     script.length() > 0 ? *script : "<unknown>",
+                     frame->GetLineNumber(),
+                     frame->GetColumn());
+    if (n < 0 || static_cast<size_t>(n) >= size - length) {
+      // Truncated; keep the frames that fit.
+      break;
+    }
+    length += n;
+  }
+
+  if (length == 0) {
+    length = snprintf(stack, size, "<native>");
+  }
+  return length;
+}
+
+
+void Buffer::SampleAllocation() {
+  BufferStatics *statics = NODE_STATICS_GET(node_buffer, BufferStatics);
+
+  statics->sample_countdown -= length_;
+  if (statics->sample_countdown > 0) return;
+  statics->sample_countdown = SampleDistance(&statics->sample_seed,
+                                             statics->sample_interval);
+
+  char stack[BUFFER_SAMPLE_FRAMES * 256];
+  size_t stack_length = FormatAllocationStack(stack, sizeof(stack));
+
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < stack_length; i++) {
+    hash = (hash ^ static_cast<uint8_t>(stack[i])) * 16777619u;
+  }
+
+  BufferSampleSite** bucket =
+      &statics->sample_sites[hash % BUFFER_SAMPLE_BUCKETS];
+  BufferSampleSite* site = *bucket;
+  while (site && (site->hash != hash ||
+                  site->stack_length != stack_length ||
+                  memcmp(site->stack, stack, stack_length) != 0)) {
+    site = site->next;
+  }
+
+  if (site == NULL) {
+    site = static_cast<BufferSampleSite*>(
+        malloc(sizeof(BufferSampleSite) + stack_length));
+    if (site == NULL) return;
+    site->hash = hash;
+    site->live_bytes = 0;
+    site->live_count = 0;
+    site->stack_length = stack_length;
+    memcpy(site->stack, stack, stack_length);
+    site->next = *bucket;
+    *bucket = site;
+  }
+
+  // An allocation of n bytes is sampled with probability
+  // 1 - exp(-n / interval); weighing it by the inverse keeps the estimate
+  // unbiased for small and large buffers alike.
+  double bytes = static_cast<double>(length_);
+  sample_bytes_ = bytes / (1 - exp(-bytes / statics->sample_interval));
+  sample_site_ = site;
+  site->live_bytes += sample_bytes_;
+  site->live_count++;
+}
+
+
+void Buffer::ReleaseSample() {
+  sample_site_->live_bytes -= sample_bytes_;
+  sample_site_->live_count--;
+  sample_site_ = NULL;
+}
+
+
+// A string resource that points into a Buffer's memory instead of copying
+// it onto the V8 heap. The Buffer is kept alive until the string is
+// collected.
+class ExternalBufferString : public String::ExternalAsciiStringResource {
+ public:
+  ExternalBufferString(Buffer *buffer, const char *data, size_t length)
+      : buffer_(buffer), data_(data), length_(length) {
+    buffer_->Ref();
+  }
+
+  ~ExternalBufferString() {
+    buffer_->Unref();
+  }
+
+  // Returns an external string for the bytes, or an empty handle if they
+  // are not all ASCII and so cannot be shared with V8.
+  static Local<String> New(Buffer *buffer, const char *data, size_t length) {
+    if (AsciiPrefixLength(data, length) != length) return Local<String>();
+    return String::NewExternal(new ExternalBufferString(buffer, data, length));
+  }
+
+  const char* data() const { return data_; }
+  size_t length() const { return length_; }
+
+ private:
+  Buffer *buffer_;
+  const char *data_;
+  size_t length_;
+};
+
+
+// var string = buffer.binarySlice(start, end, [external]);
 Handle<Value> Buffer::BinarySlice(const Arguments &args) {
   HandleScope scope;
   Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
   SLICE_ARGS(args[0], args[1])
 
   char *data = parent->data_ + start;
-  //Local<String> string = String::New(data, end - start);
+
+  if (args[2]->IsTrue()) {
+    Local<String> string = ExternalBufferString::New(parent, data, end - start);
+    if (!string.IsEmpty()) return scope.Close(string);
+  }
 
   Local<Value> b =  Encode(data, end - start, BINARY);
 
@@ -256,25 +817,174 @@ Handle<Value> Buffer::BinarySlice(const Arguments &args) {
 }
 
 
+// var string = buffer.asciiSlice(start, end, [external]);
 Handle<Value> Buffer::AsciiSlice(const Arguments &args) {
   HandleScope scope;
   Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
   SLICE_ARGS(args[0], args[1])
 
   char* data = parent->data_ + start;
+
+  if (args[2]->IsTrue()) {
+    Local<String> string = ExternalBufferString::New(parent, data, end - start);
+    if (!string.IsEmpty()) return scope.Close(string);
+  }
+
   Local<String> string = String::New(data, end - start);
 
   return scope.Close(string);
 }
 
 
+// Decodes `len` bytes of UTF-8. The caller provides the HandleScope.
+static Local<String> DecodeUtf8(const char *data, size_t len) {
+  size_t pos = AsciiPrefixLength(data, len);
+  if (len < UTF8_SPLIT_MIN || pos == len) {
+    return String::New(data, len);
+  }
+
+  // V8 decodes the whole slice one char at a time as soon as it sees a
+  // single high byte. Keep long ASCII runs on its fast path and only hand
+  // the segments around the high bytes to the generic decoder. ASCII bytes
+  // never occur inside a UTF-8 sequence, so splitting before one is safe.
+  Local<String> string = String::New(data, pos);
+  int pieces = 1;
+
+  while (pos < len) {
+    size_t seg_end = pos;
+    while (seg_end < len) {
+      if (data[seg_end] & 0x80) {
+        seg_end++;
+        continue;
+      }
+      size_t run = AsciiPrefixLength(data + seg_end, len - seg_end);
+      if (run >= UTF8_ASCII_RUN_MIN) break;
+      seg_end += run;
+    }
+    if (pieces + 2 > UTF8_MAX_PIECES) seg_end = len;
+
+    string = String::Concat(string, String::New(data + pos, seg_end - pos));
+    pos = seg_end;
+    if (pos == len) break;
+
+    size_t run = AsciiPrefixLength(data + pos, len - pos);
+    string = String::Concat(string, String::New(data + pos, run));
+    pos += run;
+    pieces += 2;
+  }
+
+  return string;
+}
+
+
 Handle<Value> Buffer::Utf8Slice(const Arguments &args) {
   HandleScope scope;
   Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
   SLICE_ARGS(args[0], args[1])
-  char *data = parent->data_ + start;
-  Local<String> string = String::New(data, end - start);
-  return scope.Close(string);
+  return scope.Close(DecodeUtf8(parent->data_ + start, end - start));
+}
+
+
+// Decodes a stream of UTF-8 chunks for StringDecoder. A character that is
+// split between two chunks is kept here until its last byte arrives, so
+// every write() decodes its chunk in one pass without slicing it.
+class Utf8Decoder : public ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target);
+
+ private:
+  Utf8Decoder() : ObjectWrap(), received_(0), length_(0) {}
+
+  static Handle<Value> New(const Arguments &args);
+  static Handle<Value> Write(const Arguments &args);
+
+  char char_[4];
+  size_t received_;
+  size_t length_;
+};
+
+
+Handle<Value> Utf8Decoder::New(const Arguments &args) {
+  HandleScope scope;
+  Utf8Decoder *decoder = new Utf8Decoder();
+  decoder->Wrap(args.This());
+  return args.This();
+}
+
+
+// var string = decoder.write(buffer);
+Handle<Value> Utf8Decoder::Write(const Arguments &args) {
+  HandleScope scope;
+  Utf8Decoder *decoder = ObjectWrap::Unwrap<Utf8Decoder>(args.This());
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Argument must be a Buffer")));
+  }
+
+  Local<Object> buffer = args[0]->ToObject();
+  const char *data = Buffer::Data(buffer);
+  size_t len = Buffer::Length(buffer);
+  size_t pos = 0;
+  Local<String> head;
+
+  // Finish the character that the last chunk ended in.
+  if (decoder->length_) {
+    pos = MIN(decoder->length_ - decoder->received_, len);
+    memcpy(decoder->char_ + decoder->received_, data, pos);
+    decoder->received_ += pos;
+
+    if (decoder->received_ < decoder->length_) {
+      return scope.Close(String::Empty());
+    }
+
+    head = String::New(decoder->char_, decoder->length_);
+    decoder->received_ = decoder->length_ = 0;
+  }
+
+  // Hold back a lead byte in the last three bytes that still misses some of
+  // its continuation bytes.
+  size_t tail = MIN(len - pos, 3);
+  for (; tail > 0; tail--) {
+    unsigned char c = data[len - tail];
+
+    // See http://en.wikipedia.org/wiki/UTF-8#Description
+    if (tail == 1 && c >> 5 == 0x06) {
+      decoder->length_ = 2;
+      break;
+    }
+    if (tail <= 2 && c >> 4 == 0x0E) {
+      decoder->length_ = 3;
+      break;
+    }
+    if (tail <= 3 && c >> 3 == 0x1E) {
+      decoder->length_ = 4;
+      break;
+    }
+  }
+
+  if (tail) {
+    memcpy(decoder->char_, data + len - tail, tail);
+    decoder->received_ = tail;
+  }
+
+  Local<String> body = DecodeUtf8(data + pos, len - pos - tail);
+  if (head.IsEmpty()) return scope.Close(body);
+  if (body->Length() == 0) return scope.Close(head);
+  return scope.Close(String::Concat(head, body));
+}
+
+
+void Utf8Decoder::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  Local<FunctionTemplate> t = FunctionTemplate::New(Utf8Decoder::New);
+  t->InstanceTemplate()->SetInternalFieldCount(1);
+  t->SetClassName(String::NewSymbol("Utf8Decoder"));
+
+  NODE_SET_PROTOTYPE_METHOD(t, "write", Utf8Decoder::Write);
+
+  target->Set(String::NewSymbol("Utf8Decoder"), t->GetFunction());
 }
 
 Handle<Value> Buffer::Ucs2Slice(const Arguments &args) {
@@ -310,6 +1020,164 @@ static const int unbase64_table[] =
 #define unbase64(x) unbase64_table[(uint8_t)(x)]
 
 
+// Number of UTF-16 units staged on the stack per String::Write call when
+// decoding base64.
+#define BASE64_DECODE_CHUNK 4096
+
+
+#if defined(__SSE2__)
+// Encodes 12 bytes into 16 base64 characters.
+static inline void base64_encode_block(char* dst, const uint8_t* src) {
+  __m128i v = _mm_set_epi32((src[9] << 16) | (src[10] << 8) | src[11],
+                            (src[6] << 16) | (src[7] << 8) | src[8],
+                            (src[3] << 16) | (src[4] << 8) | src[5],
+                            (src[0] << 16) | (src[1] << 8) | src[2]);
+
+  // Spread the four sextets of each 24-bit group over the bytes of its lane,
+  // most significant first.
+  const __m128i sextet = _mm_set1_epi32(0x3F);
+  __m128i i = _mm_or_si128(
+      _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 18), sextet),
+                   _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 12), sextet),
+                                  8)),
+      _mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 6), sextet),
+                                  16),
+                   _mm_slli_epi32(_mm_and_si128(v, sextet), 24)));
+
+  // 'A' + i, then shift the ranges for a-z, 0-9, '+' and '/'.
+  __m128i offset = _mm_set1_epi8(65);
+  offset = _mm_add_epi8(offset, _mm_and_si128(
+      _mm_cmpgt_epi8(i, _mm_set1_epi8(25)), _mm_set1_epi8(6)));
+  offset = _mm_add_epi8(offset, _mm_and_si128(
+      _mm_cmpgt_epi8(i, _mm_set1_epi8(51)), _mm_set1_epi8(-75)));
+  offset = _mm_add_epi8(offset, _mm_and_si128(
+      _mm_cmpgt_epi8(i, _mm_set1_epi8(61)), _mm_set1_epi8(-15)));
+  offset = _mm_add_epi8(offset, _mm_and_si128(
+      _mm_cmpgt_epi8(i, _mm_set1_epi8(62)), _mm_set1_epi8(3)));
+
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_add_epi8(i, offset));
+}
+
+
+// Decodes 16 base64 characters into 12 bytes. Returns false, without
+// writing anything, if any of them is outside the alphabet.
+static inline bool base64_decode_block(char* dst, const uint16_t* src) {
+  __m128i x = _mm_packus_epi16(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8)));
+
+  __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('A' - 1)),
+                                _mm_cmplt_epi8(x, _mm_set1_epi8('Z' + 1)));
+  __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('a' - 1)),
+                                _mm_cmplt_epi8(x, _mm_set1_epi8('z' + 1)));
+  __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('0' - 1)),
+                                _mm_cmplt_epi8(x, _mm_set1_epi8('9' + 1)));
+  __m128i plus = _mm_cmpeq_epi8(x, _mm_set1_epi8('+'));
+  __m128i slash = _mm_cmpeq_epi8(x, _mm_set1_epi8('/'));
+
+  __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                               _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+  if (_mm_movemask_epi8(valid) != 0xFFFF) return false;
+
+  __m128i offset = _mm_or_si128(
+      _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-65)),
+                   _mm_and_si128(lower, _mm_set1_epi8(-71))),
+      _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(4)),
+                   _mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(19)),
+                                _mm_and_si128(slash, _mm_set1_epi8(16)))));
+  __m128i v = _mm_add_epi8(x, offset);
+
+  // Merge sextet pairs into 12-bit values, then those into 24-bit groups.
+  v = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0xFF)), 6),
+                   _mm_srli_epi16(v, 8));
+  v = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xFFFF)), 12),
+                   _mm_srli_epi32(v, 16));
+
+  uint32_t groups[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(groups), v);
+  for (int k = 0; k < 4; k++) {
+    *dst++ = groups[k] >> 16;
+    *dst++ = groups[k] >> 8;
+    *dst++ = groups[k];
+  }
+  return true;
+}
+#endif
+
+
+// Encodes 3 bytes into 4 base64 characters.
+static inline void base64_encode_group(char* dst, const uint8_t* src) {
+  dst[0] = base64_table[src[0] >> 2];
+  dst[1] = base64_table[((src[0] & 0x03) << 4) | (src[1] >> 4)];
+  dst[2] = base64_table[((src[1] & 0x0F) << 2) | (src[2] >> 6)];
+  dst[3] = base64_table[src[2] & 0x3F];
+}
+
+
+// Decoder state carried between String::Write chunks: the sextets of the
+// group seen so far.
+struct Base64DecodeState {
+  uint32_t bits;
+  int count;
+};
+
+
+// Decodes `len` units into `dst`. Characters outside the alphabet, padding
+// included, are skipped. So '=' doesn't end the input: "QQ==QUJD" decodes
+// as "QQQUJD" would, which is what the decoder before this one did too.
+// Output past `dst_end` is dropped; that only happens for malformed input,
+// where the padding makes the decoded size estimate too small. Returns the
+// end of the output.
+static char* base64_decode(char* dst,
+                           char* dst_end,
+                           const uint16_t* src,
+                           size_t len,
+                           Base64DecodeState* state) {
+  const uint16_t* const end = src + len;
+
+  while (src < end) {
+#if defined(__SSE2__)
+    if (state->count == 0) {
+      while (end - src >= 16 && dst_end - dst >= 12 &&
+             base64_decode_block(dst, src)) {
+        dst += 12;
+        src += 16;
+      }
+      if (src == end) break;
+    }
+#endif
+
+    int v = unbase64(*src++);
+    if (v < 0) continue;
+
+    state->bits = (state->bits << 6) | v;
+    if (++state->count == 4) {
+      if (dst < dst_end) *dst++ = state->bits >> 16;
+      if (dst < dst_end) *dst++ = state->bits >> 8;
+      if (dst < dst_end) *dst++ = state->bits;
+      state->bits = 0;
+      state->count = 0;
+    }
+  }
+
+  return dst;
+}
+
+
+// Writes out a trailing partial group of 2 or 3 sextets.
+static char* base64_decode_finish(char* dst,
+                                  char* dst_end,
+                                  Base64DecodeState* state) {
+  if (state->count == 2) {
+    if (dst < dst_end) *dst++ = state->bits >> 4;
+  } else if (state->count == 3) {
+    if (dst < dst_end) *dst++ = state->bits >> 10;
+    if (dst < dst_end) *dst++ = state->bits >> 2;
+  }
+  return dst;
+}
+
+
 Handle<Value> Buffer::Base64Slice(const Arguments &args) {
   HandleScope scope;
   Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
@@ -319,64 +1187,148 @@ Handle<Value> Buffer::Base64Slice(const Arguments &args) {
   int out_len = (n + 2 - ((n + 2) % 3)) / 3 * 4;
   char *out = new char[out_len];
 
-  uint8_t bitbuf[3];
-  int i = start; // data() index
-  int j = 0; // out index
-  char c;
-  bool b1_oob, b2_oob;
-
-  while (i < end) {
-    bitbuf[0] = parent->data_[i++];
-
-    if (i < end) {
-      bitbuf[1] = parent->data_[i];
-      b1_oob = false;
-    }  else {
-      bitbuf[1] = 0;
-      b1_oob = true;
-    }
-    i++;
-
-    if (i < end) {
-      bitbuf[2] = parent->data_[i];
-      b2_oob = false;
-    }  else {
-      bitbuf[2] = 0;
-      b2_oob = true;
-    }
-    i++;
+  const uint8_t* src = reinterpret_cast<const uint8_t*>(parent->data_ + start);
+  const uint8_t* const src_end = src + n;
+  char* dst = out;
 
+#if defined(__SSE2__)
+  for (; src_end - src >= 12; src += 12, dst += 16) {
+    base64_encode_block(dst, src);
+  }
+#endif
 
-    c = bitbuf[0] >> 2;
-    assert(c < 64);
-    out[j++] = base64_table[(int)c];
-    assert(j < out_len);
+  for (; src_end - src >= 3; src += 3, dst += 4) {
+    base64_encode_group(dst, src);
+  }
 
-    c = ((bitbuf[0] & 0x03) << 4) | (bitbuf[1] >> 4);
-    assert(c < 64);
-    out[j++] = base64_table[(int)c];
-    assert(j < out_len);
+  if (src < src_end) {
+    uint8_t tail[3] = { src[0], 0, 0 };
+    if (src_end - src == 2) tail[1] = src[1];
+    base64_encode_group(dst, tail);
+    dst[3] = '=';
+    if (src_end - src == 1) dst[2] = '=';
+    dst += 4;
+  }
+  assert(dst == out + out_len);
 
-    if (b1_oob) {
-      out[j++] = '=';
-    } else {
-      c = ((bitbuf[1] & 0x0F) << 2) | (bitbuf[2] >> 6);
-      assert(c < 64);
-      out[j++] = base64_table[(int)c];
-    }
-    assert(j < out_len);
+  Local<String> string = String::New(out, out_len);
+  delete [] out;
+  return scope.Close(string);
+}
 
-    if (b2_oob) {
-      out[j++] = '=';
-    } else {
-      c = bitbuf[2] & 0x3F;
-      assert(c < 64);
-      out[j++]  = base64_table[(int)c];
-    }
-    assert(j <= out_len);
+
+static const char *hex_table = "0123456789abcdef";
+
+static const int unhex_table[] =
+  {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  , 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,-1,-1,-1,-1,-1,-1
+  ,-1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  };
+#define unhex(x) ((x) < 128 ? unhex_table[(x)] : -1)
+
+// Number of UTF-16 units staged on the stack per String::Write call when
+// decoding hex.
+#define HEX_DECODE_CHUNK 4096
+
+
+#if defined(__SSE2__)
+// Turns 16 nibbles in the low half of each byte into '0'-'9', 'a'-'f'.
+static inline __m128i hex_encode_nibbles(__m128i n) {
+  __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)),
+                                 _mm_set1_epi8('a' - '0' - 10));
+  return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), letter);
+}
+
+
+// Encodes 16 bytes into 32 hex characters.
+static inline void hex_encode_block(char* dst, const char* src) {
+  const __m128i low = _mm_set1_epi8(0x0F);
+  __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  __m128i hi = hex_encode_nibbles(_mm_and_si128(_mm_srli_epi16(x, 4), low));
+  __m128i lo = hex_encode_nibbles(_mm_and_si128(x, low));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                   _mm_unpacklo_epi8(hi, lo));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16),
+                   _mm_unpackhi_epi8(hi, lo));
+}
+
+
+// Turns 16 hex characters into their nibble values. Clears `valid` if any
+// of them is not a hex digit.
+static inline __m128i hex_decode_nibbles(__m128i c, bool* valid) {
+  __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+  // Folding to lower case leaves digits alone and maps 'A'-'F' to 'a'-'f'.
+  __m128i folded = _mm_or_si128(c, _mm_set1_epi8(0x20));
+  __m128i letter = _mm_and_si128(
+      _mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+      _mm_cmplt_epi8(folded, _mm_set1_epi8('f' + 1)));
+
+  if (_mm_movemask_epi8(_mm_or_si128(digit, letter)) != 0xFFFF) {
+    *valid = false;
   }
 
-  Local<String> string = String::New(out, out_len);
+  return _mm_or_si128(
+      _mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+      _mm_and_si128(letter, _mm_sub_epi8(folded, _mm_set1_epi8('a' - 10))));
+}
+
+
+// Decodes 32 hex characters into 16 bytes. Returns false, without writing
+// anything, if any of them is not a hex digit.
+static inline bool hex_decode_block(char* dst, const uint16_t* src) {
+  const __m128i* in = reinterpret_cast<const __m128i*>(src);
+  __m128i a = _mm_packus_epi16(_mm_loadu_si128(in), _mm_loadu_si128(in + 1));
+  __m128i b = _mm_packus_epi16(_mm_loadu_si128(in + 2),
+                               _mm_loadu_si128(in + 3));
+
+  bool valid = true;
+  a = hex_decode_nibbles(a, &valid);
+  b = hex_decode_nibbles(b, &valid);
+  if (!valid) return false;
+
+  // Each 16-bit lane holds the high nibble in its low byte and the low
+  // nibble in its high byte.
+  const __m128i mask = _mm_set1_epi16(0xFF);
+  a = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(a, mask), 4),
+                   _mm_srli_epi16(a, 8));
+  b = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(b, mask), 4),
+                   _mm_srli_epi16(b, 8));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(a, b));
+  return true;
+}
+#endif
+
+
+Handle<Value> Buffer::HexSlice(const Arguments &args) {
+  HandleScope scope;
+  Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
+  SLICE_ARGS(args[0], args[1])
+
+  int n = end - start;
+  char *out = new char[n * 2];
+
+  const char* src = parent->data_ + start;
+  const char* const src_end = src + n;
+  char* dst = out;
+
+#if defined(__SSE2__)
+  for (; src_end - src >= 16; src += 16, dst += 32) {
+    hex_encode_block(dst, src);
+  }
+#endif
+
+  for (; src < src_end; src++) {
+    *dst++ = hex_table[(*src >> 4) & 0x0F];
+    *dst++ = hex_table[*src & 0x0F];
+  }
+
+  Local<String> string = String::New(out, n * 2);
   delete [] out;
   return scope.Close(string);
 }
@@ -498,11 +1450,7 @@ Handle<Value> Buffer::Utf8Write(const Arguments &args) {
 
   int char_written;
 
-  int written = s->WriteUtf8(p,
-                             max_length,
-                             &char_written,
-                             (String::HINT_MANY_WRITES_EXPECTED |
-                              String::NO_NULL_TERMINATION));
+  int written = WriteUtf8Fast(s, p, max_length, &char_written);
 
   statics->constructor_template->GetFunction()->Set(statics->chars_written_sym,
                                            Integer::New(char_written));
@@ -613,7 +1561,7 @@ Handle<Value> Buffer::Base64Write(const Arguments &args) {
             "Argument must be a string")));
   }
 
-  String::AsciiValue s(args[0]->ToString());
+  Local<String> s = args[0]->ToString();
   size_t offset = args[1]->Int32Value();
 
   // handle zero-length buffers graciously
@@ -626,58 +1574,99 @@ Handle<Value> Buffer::Base64Write(const Arguments &args) {
             "Offset is out of bounds")));
   }
 
-  const size_t size = base64_decoded_size(*s, s.length());
+  const size_t size = base64_decoded_size(s);
   if (size > buffer->length_ - offset) {
     // throw exception, don't silently truncate
     return ThrowException(Exception::TypeError(String::New(
             "Buffer too small")));
   }
 
-  char a, b, c, d;
+  // Decode straight from the string's characters, one chunk at a time,
+  // instead of copying the whole string out first.
+  uint16_t units[BASE64_DECODE_CHUNK];
+  Base64DecodeState state = { 0, 0 };
   char* start = buffer->data_ + offset;
   char* dst = start;
-  const char *src = *s;
-  const char *const srcEnd = src + s.length();
+  char* const dst_end = start + size;
+  const int length = s->Length();
+
+  for (int i = 0; i < length; i += BASE64_DECODE_CHUNK) {
+    int n = MIN(length - i, BASE64_DECODE_CHUNK);
+    s->Write(units, i, n, String::HINT_MANY_WRITES_EXPECTED |
+                          String::NO_NULL_TERMINATION);
+    dst = base64_decode(dst, dst_end, units, n, &state);
+  }
+  dst = base64_decode_finish(dst, dst_end, &state);
 
-  while (src < srcEnd) {
-    int remaining = srcEnd - src;
+  statics->constructor_template->GetFunction()->Set(statics->chars_written_sym,
+                                           Integer::New(length));
 
-    while (unbase64(*src) < 0 && src < srcEnd) {
-      src++;
-      remaining--;
-    }
-    if (remaining == 0 || *src == '=') break;
-    a = unbase64(*src++);
+  return scope.Close(Integer::New(dst - start));
+}
 
-    while (unbase64(*src) < 0 && src < srcEnd) {
-      src++;
-      remaining--;
-    }
-    if (remaining <= 1 || *src == '=') break;
-    b = unbase64(*src++);
-    *dst++ = (a << 2) | ((b & 0x30) >> 4);
 
-    while (unbase64(*src) < 0 && src < srcEnd) {
-      src++;
-      remaining--;
-    }
-    if (remaining <= 2 || *src == '=') break;
-    c = unbase64(*src++);
-    *dst++ = ((b & 0x0F) << 4) | ((c & 0x3C) >> 2);
+// var bytesWritten = buffer.hexWrite(string, offset, [maxLength]);
+Handle<Value> Buffer::HexWrite(const Arguments &args) {
+  HandleScope scope;
+  BufferStatics *statics = NODE_STATICS_GET(node_buffer, BufferStatics);
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(args.This());
+
+  if (!args[0]->IsString()) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Argument must be a string")));
+  }
+
+  Local<String> s = args[0]->ToString();
+
+  // must be an even number of digits
+  if (s->Length() % 2) {
+    return ThrowException(Exception::Error(String::New(
+            "Invalid hex string")));
+  }
+
+  size_t offset = args[1]->Uint32Value();
+
+  if (s->Length() > 0 && offset >= buffer->length_) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Offset is out of bounds")));
+  }
+
+  size_t max_length = args[2]->IsUndefined() ? buffer->length_ - offset
+                                             : args[2]->Uint32Value();
+  max_length = MIN(buffer->length_ - offset, max_length);
+
+  const int length = MIN(s->Length() / 2, max_length);
+  uint16_t units[HEX_DECODE_CHUNK];
+  char* dst = buffer->data_ + offset;
+  int i = 0; // bytes written
 
-    while (unbase64(*src) < 0 && src < srcEnd) {
-      src++;
-      remaining--;
+  while (i < length) {
+    int n = MIN(length - i, HEX_DECODE_CHUNK / 2);
+    s->Write(units, i * 2, n * 2, String::HINT_MANY_WRITES_EXPECTED |
+                                  String::NO_NULL_TERMINATION);
+
+    int j = 0;
+#if defined(__SSE2__)
+    for (; n - j >= 16 && hex_decode_block(dst + i + j, units + j * 2); j += 16);
+#endif
+
+    for (; j < n; j++) {
+      int hi = unhex(units[j * 2]);
+      int lo = unhex(units[j * 2 + 1]);
+      if (hi < 0 || lo < 0) {
+        return ThrowException(Exception::Error(String::New(
+                "Invalid hex string")));
+      }
+      dst[i + j] = (hi << 4) | lo;
     }
-    if (remaining <= 3 || *src == '=') break;
-    d = unbase64(*src++);
-    *dst++ = ((c & 0x03) << 6) | (d & 0x3F);
+
+    i += n;
   }
 
   statics->constructor_template->GetFunction()->Set(statics->chars_written_sym,
-                                           Integer::New(s.length()));
+                                           Integer::New(i * 2));
 
-  return scope.Close(Integer::New(dst - start));
+  return scope.Close(Integer::New(i));
 }
 
 
@@ -732,6 +1721,446 @@ Handle<Value> Buffer::ByteLength(const Arguments &args) {
 }
 
 
+// Returns the offset of the first occurrence of `needle` in `haystack`, or
+// -1. Candidates are found by matching the first and the last byte of the
+// needle, 16 positions at a time with SSE2, and then compared in full.
+static ssize_t SearchBytes(const char* haystack,
+                           size_t haystack_len,
+                           const char* needle,
+                           size_t needle_len) {
+  if (needle_len == 0) return 0;
+  if (needle_len > haystack_len) return -1;
+
+  if (needle_len == 1) {
+    const void* p = memchr(haystack, needle[0], haystack_len);
+    return p ? static_cast<const char*>(p) - haystack : -1;
+  }
+
+  const size_t last = haystack_len - needle_len;  // last candidate position
+  size_t i = 0;
+
+#if defined(__SSE2__) && defined(__GNUC__)
+  const __m128i first_byte = _mm_set1_epi8(needle[0]);
+  const __m128i last_byte = _mm_set1_epi8(needle[needle_len - 1]);
+
+  for (; i + 16 <= last + 1; i += 16) {
+    __m128i a = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(haystack + i));
+    __m128i b = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(haystack + i + needle_len - 1));
+    unsigned mask = _mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(a, first_byte),
+                      _mm_cmpeq_epi8(b, last_byte)));
+    while (mask) {
+      size_t pos = i + __builtin_ctz(mask);
+      if (memcmp(haystack + pos + 1, needle + 1, needle_len - 2) == 0) {
+        return pos;
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  while (i <= last) {
+    const void* p = memchr(haystack + i, needle[0], last - i + 1);
+    if (p == NULL) break;
+    size_t pos = static_cast<const char*>(p) - haystack;
+    if (haystack[pos + needle_len - 1] == needle[needle_len - 1] &&
+        memcmp(haystack + pos + 1, needle + 1, needle_len - 2) == 0) {
+      return pos;
+    }
+    i = pos + 1;
+  }
+
+  return -1;
+}
+
+
+// var index = buffer.indexOf(needle, start, end);
+// `needle` is a Buffer or a byte value. Returns -1 if it is not found.
+Handle<Value> Buffer::IndexOf(const Arguments &args) {
+  HandleScope scope;
+  Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
+  SLICE_ARGS(args[1], args[2])
+
+  const char* hay = parent->data_ + start;
+  size_t hay_len = end - start;
+  ssize_t r;
+
+  if (args[0]->IsNumber()) {
+    char byte = args[0]->Int32Value();
+    r = SearchBytes(hay, hay_len, &byte, 1);
+  } else if (Buffer::HasInstance(args[0])) {
+    Local<Object> needle = args[0]->ToObject();
+    r = SearchBytes(hay, hay_len, Buffer::Data(needle), Buffer::Length(needle));
+  } else {
+    return ThrowException(Exception::TypeError(String::New(
+            "Argument must be a Buffer or a number")));
+  }
+
+  return scope.Close(Integer::New(r < 0 ? -1 : r + start));
+}
+
+
+// var bytesCopied = SlowBuffer.concat(list, target);
+// Copies the Buffers in `list` back to back into `target`, as far as they
+// fit.
+Handle<Value> Buffer::Concat(const Arguments &args) {
+  HandleScope scope;
+
+  if (!args[0]->IsArray()) {
+    return ThrowException(Exception::TypeError(String::New(
+            "First arg should be an Array")));
+  }
+
+  if (!Buffer::HasInstance(args[1])) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Second arg should be a Buffer")));
+  }
+
+  Local<Array> list = Local<Array>::Cast(args[0]);
+  Local<Object> target = args[1]->ToObject();
+  char* dst = Buffer::Data(target);
+  size_t room = Buffer::Length(target);
+  size_t copied = 0;
+
+  for (uint32_t i = 0; i < list->Length() && copied < room; i++) {
+    Local<Value> item = list->Get(i);
+    if (!Buffer::HasInstance(item)) {
+      return ThrowException(Exception::TypeError(String::New(
+              "List items should be Buffers")));
+    }
+
+    Local<Object> source = item->ToObject();
+    size_t n = MIN(Buffer::Length(source), room - copied);
+    // memmove, a source may be a slice of the target.
+    if (n > 0) memmove(dst + copied, Buffer::Data(source), n);
+    copied += n;
+  }
+
+  return scope.Close(Integer::New(copied));
+}
+
+
+// Checks that both arguments are Buffers. Returns false after throwing.
+static bool TwoBufferArgs(const Arguments &args) {
+  if (!Buffer::HasInstance(args[0]) || !Buffer::HasInstance(args[1])) {
+    ThrowException(Exception::TypeError(String::New(
+            "Arguments must be Buffers")));
+    return false;
+  }
+  return true;
+}
+
+
+// SlowBuffer.compare(a, b) orders Buffers by their bytes like memcmp, a
+// shorter Buffer before a longer one it is a prefix of. Returns -1, 0 or 1.
+Handle<Value> Buffer::Compare(const Arguments &args) {
+  HandleScope scope;
+  if (!TwoBufferArgs(args)) return Undefined();
+
+  Local<Object> a = args[0]->ToObject();
+  Local<Object> b = args[1]->ToObject();
+  size_t a_len = Buffer::Length(a);
+  size_t b_len = Buffer::Length(b);
+
+  // libc's memcmp compares a vector register at a time
+  int r = memcmp(Buffer::Data(a), Buffer::Data(b), MIN(a_len, b_len));
+  if (r == 0) r = a_len < b_len ? -1 : a_len > b_len;
+
+  return scope.Close(Integer::New(r < 0 ? -1 : r > 0));
+}
+
+
+// SlowBuffer.equals(a, b)
+Handle<Value> Buffer::Equals(const Arguments &args) {
+  HandleScope scope;
+  if (!TwoBufferArgs(args)) return Undefined();
+
+  Local<Object> a = args[0]->ToObject();
+  Local<Object> b = args[1]->ToObject();
+  size_t len = Buffer::Length(a);
+
+  bool equal = len == Buffer::Length(b) &&
+               memcmp(Buffer::Data(a), Buffer::Data(b), len) == 0;
+
+  return scope.Close(Boolean::New(equal));
+}
+
+
+// SlowBuffer.timingSafeEqual(a, b) looks at every byte whatever the
+// differences are, so the time taken says nothing about where the first
+// one is. Meant for MACs and other secrets.
+Handle<Value> Buffer::TimingSafeEqual(const Arguments &args) {
+  HandleScope scope;
+  if (!TwoBufferArgs(args)) return Undefined();
+
+  Local<Object> a = args[0]->ToObject();
+  Local<Object> b = args[1]->ToObject();
+  size_t len = Buffer::Length(a);
+
+  if (len != Buffer::Length(b)) {
+    return ThrowException(Exception::RangeError(String::New(
+            "Buffers must have the same length")));
+  }
+
+  const volatile unsigned char* x =
+      reinterpret_cast<const unsigned char*>(Buffer::Data(a));
+  const volatile unsigned char* y =
+      reinterpret_cast<const unsigned char*>(Buffer::Data(b));
+  unsigned char diff = 0;
+  for (size_t i = 0; i < len; i++) diff |= x[i] ^ y[i];
+
+  return scope.Close(Boolean::New(diff == 0));
+}
+
+
+// Checks that `arg` is a typed array and that `count` of its elements fit
+// both in it and in `buffer` from `offset` on. Returns the element size, or
+// 0 after throwing.
+static int TypedArrayCopyArgs(Buffer* buffer,
+                              Handle<Value> arg,
+                              size_t offset,
+                              size_t count,
+                              Local<Object>* array) {
+  if (!arg->IsObject() ||
+      !arg->ToObject()->HasIndexedPropertiesInExternalArrayData()) {
+    ThrowException(Exception::TypeError(String::New(
+            "Argument must be a typed array")));
+    return 0;
+  }
+  *array = arg->ToObject();
+
+  int element_size = v8_typed_array::SizeOfArrayElementForType(
+      (*array)->GetIndexedPropertiesExternalArrayDataType());
+  size_t length = (*array)->GetIndexedPropertiesExternalArrayDataLength();
+
+  if (element_size == 0 || count > length) {
+    ThrowException(Exception::RangeError(String::New(
+            "Typed array is too small")));
+    return 0;
+  }
+
+  if (offset > Buffer::Length(buffer) ||
+      count > (Buffer::Length(buffer) - offset) / element_size) {
+    ThrowException(Exception::RangeError(String::New(
+            "Trying to access beyond buffer length")));
+    return 0;
+  }
+
+  return element_size;
+}
+
+
+// buffer.readTypedArray(offset, target, count, littleEndian);
+Handle<Value> Buffer::ReadTypedArray(const Arguments &args) {
+  HandleScope scope;
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(args.This());
+
+  size_t offset = args[0]->Uint32Value();
+  size_t count = args[2]->Uint32Value();
+  Local<Object> target;
+  int element_size = TypedArrayCopyArgs(buffer, args[1], offset, count,
+                                        &target);
+  if (element_size == 0) return Undefined();
+
+  v8_typed_array::CopyElements(
+      static_cast<char*>(target->GetIndexedPropertiesExternalArrayData()),
+      buffer->data_ + offset,
+      count,
+      element_size,
+      args[3]->BooleanValue());
+
+  return scope.Close(target);
+}
+
+
+// buffer.writeTypedArray(source, offset, count, littleEndian);
+Handle<Value> Buffer::WriteTypedArray(const Arguments &args) {
+  HandleScope scope;
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(args.This());
+
+  size_t offset = args[1]->Uint32Value();
+  size_t count = args[2]->Uint32Value();
+  Local<Object> source;
+  int element_size = TypedArrayCopyArgs(buffer, args[0], offset, count,
+                                        &source);
+  if (element_size == 0) return Undefined();
+
+  v8_typed_array::CopyElements(
+      buffer->data_ + offset,
+      static_cast<char*>(source->GetIndexedPropertiesExternalArrayData()),
+      count,
+      element_size,
+      args[3]->BooleanValue());
+
+  return scope.Close(Integer::New(count * element_size));
+}
+
+
+// var stats = SlowBuffer.arenaStats();
+size_t Buffer::HeldBytes() {
+  BufferStatics *statics = NODE_STATICS_GET(node_buffer, BufferStatics);
+  return statics ? statics->held_bytes : 0;
+}
+
+
+// Frees the blocks of `lists` beyond `retain` bytes, largest first.
+static size_t ArenaTrimLists(ArenaFreeList* lists, size_t* bytes,
+                             size_t retain) {
+  size_t freed = 0;
+
+  for (int c = BUFFER_ARENA_CLASSES - 1; c >= 0 && *bytes > retain; c--) {
+    size_t size = arena_class_size[c];
+    while (*bytes > retain) {
+      ArenaBlock* block = ArenaPop(&lists[c]);
+      if (block == NULL) break;
+      free(block);
+      *bytes -= size;
+      freed += size;
+    }
+  }
+
+  return freed;
+}
+
+
+size_t Buffer::TrimArena(size_t retain) {
+  BufferStatics *statics = NODE_STATICS_GET(node_buffer, BufferStatics);
+  size_t freed = 0;
+
+  if (statics) {
+    freed += ArenaTrimLists(statics->arena_cache,
+                            &statics->arena_cached_bytes,
+                            retain);
+  }
+
+  uv_mutex_lock(&arena_depot.mutex);
+  freed += ArenaTrimLists(arena_depot.lists, &arena_depot.bytes, retain);
+  uv_mutex_unlock(&arena_depot.mutex);
+
+  return freed;
+}
+
+
+Handle<Value> Buffer::ArenaStats(const Arguments &args) {
+  HandleScope scope;
+  BufferStatics *statics = NODE_STATICS_GET(node_buffer, BufferStatics);
+
+  uv_mutex_lock(&arena_depot.mutex);
+  size_t depot_bytes = arena_depot.bytes;
+  uv_mutex_unlock(&arena_depot.mutex);
+
+  // Share of the memory this isolate holds in the arena, live blocks and
+  // cached ones, that is not carrying buffer data.
+  size_t held = statics->arena_reserved_bytes + statics->arena_cached_bytes;
+  double fragmentation =
+      held ? 1.0 - static_cast<double>(statics->arena_live_bytes) / held : 0;
+
+  Local<Object> stats = Object::New();
+  stats->Set(String::NewSymbol("liveBytes"),
+             Number::New(statics->arena_live_bytes));
+  stats->Set(String::NewSymbol("reservedBytes"),
+             Number::New(statics->arena_reserved_bytes));
+  stats->Set(String::NewSymbol("cachedBytes"),
+             Number::New(statics->arena_cached_bytes));
+  stats->Set(String::NewSymbol("depotBytes"), Number::New(depot_bytes));
+  stats->Set(String::NewSymbol("hits"), Number::New(statics->arena_hits));
+  stats->Set(String::NewSymbol("misses"), Number::New(statics->arena_misses));
+  stats->Set(String::NewSymbol("fragmentation"), Number::New(fragmentation));
+
+  return scope.Close(stats);
+}
+
+
+// SlowBuffer.setAllocationSampling(interval)
+Handle<Value> Buffer::SetAllocationSampling(const Arguments &args) {
+  HandleScope scope;
+  BufferStatics *statics = NODE_STATICS_GET(node_buffer, BufferStatics);
+
+  double interval = args[0]->NumberValue();
+  if (!(interval >= 0)) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Sampling interval must be a non-negative number")));
+  }
+
+  statics->sample_interval = interval;
+  statics->sample_countdown =
+      interval > 0 ? SampleDistance(&statics->sample_seed, interval) : 0;
+
+  return Undefined();
+}
+
+
+static int CompareSampleSites(const void* a, const void* b) {
+  double x = (*static_cast<BufferSampleSite* const*>(a))->live_bytes;
+  double y = (*static_cast<BufferSampleSite* const*>(b))->live_bytes;
+  return x < y ? 1 : x > y ? -1 : 0;
+}
+
+
+// var sites = SlowBuffer.allocationProfile();
+Handle<Value> Buffer::AllocationProfile(const Arguments &args) {
+  HandleScope scope;
+  BufferStatics *statics = NODE_STATICS_GET(node_buffer, BufferStatics);
+
+  size_t count = 0;
+  for (int i = 0; i < BUFFER_SAMPLE_BUCKETS; i++) {
+    for (BufferSampleSite* site = statics->sample_sites[i];
+         site;
+         site = site->next) {
+      if (site->live_count > 0) count++;
+    }
+  }
+
+  BufferSampleSite** sites = static_cast<BufferSampleSite**>(
+      malloc((count ? count : 1) * sizeof(*sites)));
+  if (sites == NULL) {
+    return ThrowException(Exception::Error(String::New("Out of memory")));
+  }
+
+  size_t n = 0;
+  for (int i = 0; i < BUFFER_SAMPLE_BUCKETS; i++) {
+    for (BufferSampleSite* site = statics->sample_sites[i];
+         site;
+         site = site->next) {
+      if (site->live_count > 0) sites[n++] = site;
+    }
+  }
+  qsort(sites, count, sizeof(*sites), CompareSampleSites);
+
+  Local<String> stack_sym = String::NewSymbol("stack");
+  Local<String> bytes_sym = String::NewSymbol("bytes");
+  Local<String> count_sym = String::NewSymbol("count");
+  Local<Array> result = Array::New(count);
+
+  for (size_t i = 0; i < count; i++) {
+    BufferSampleSite* site = sites[i];
+    Local<Array> frames = Array::New();
+    const char* start = site->stack;
+    const char* end = site->stack + site->stack_length;
+    uint32_t nframes = 0;
+
+    while (start < end) {
+      const char* nl = static_cast<const char*>(
+          memchr(start, '\n', end - start));
+      if (nl == NULL) nl = end;
+      frames->Set(nframes++, String::New(start, nl - start));
+      start = nl + 1;
+    }
+
+    Local<Object> entry = Object::New();
+    entry->Set(stack_sym, frames);
+    entry->Set(bytes_sym, Number::New(site->live_bytes));
+    entry->Set(count_sym, Number::New(site->live_count));
+    result->Set(i, entry);
+  }
+
+  free(sites);
+  return scope.Close(result);
+}
+
+
 Handle<Value> Buffer::MakeFastBuffer(const Arguments &args) {
   HandleScope scope;
 
@@ -753,6 +2182,55 @@ Handle<Value> Buffer::MakeFastBuffer(const Arguments &args) {
 }
 
 
+// allocFast(buffer, length, poolSize) gives a new fast Buffer its storage:
+// sets buffer.parent and buffer.offset and points its indexed data at them,
+// in place of allocating from a pool in javascript and then calling
+// makeFastBuffer(). Up to poolSize bytes come from the current pool, 8 byte
+// aligned; more get a SlowBuffer of their own.
+Handle<Value> Buffer::AllocFast(const Arguments &args) {
+  HandleScope scope;
+  BufferStatics *statics = NODE_STATICS_GET(node_buffer, BufferStatics);
+
+  Local<Object> fast_buffer = args[0]->ToObject();
+  size_t length = args[1]->Uint32Value();
+  size_t pool_size = args[2]->Uint32Value();
+
+  Local<Object> parent;
+  Buffer *buffer;
+  size_t offset = 0;
+
+  if (length > pool_size) {
+    buffer = Buffer::New(length);
+    if (buffer == NULL) return Undefined();
+    parent = Local<Object>::New(buffer->handle_);
+  } else {
+    if (statics->pool.IsEmpty() ||
+        statics->pool_buffer->length_ != pool_size ||
+        statics->pool_buffer->length_ - statics->pool_used < length) {
+      buffer = Buffer::New(pool_size);
+      if (buffer == NULL) return Undefined();
+      if (!statics->pool.IsEmpty()) statics->pool.Dispose();
+      statics->pool = Persistent<Object>::New(buffer->handle_);
+      statics->pool_buffer = buffer;
+      statics->pool_used = 0;
+    }
+    buffer = statics->pool_buffer;
+    parent = Local<Object>::New(statics->pool);
+    offset = statics->pool_used;
+    // Keep every buffer 8 byte aligned, so typed arrays can view them
+    statics->pool_used = (offset + length + 7) & ~7;
+  }
+
+  fast_buffer->Set(statics->parent_sym, parent);
+  fast_buffer->Set(statics->offset_sym, Integer::NewFromUnsigned(offset));
+  fast_buffer->SetIndexedPropertiesToExternalArrayData(buffer->data_ + offset,
+                                                       kExternalUnsignedByteArray,
+                                                       length);
+
+  return Undefined();
+}
+
+
 bool Buffer::HasInstance(v8::Handle<v8::Value> val) {
   if (!val->IsObject()) return false;
   v8::Local<v8::Object> obj = val->ToObject();
@@ -775,6 +2253,8 @@ void Buffer::Initialize(Handle<Object> target) {
 
   statics->length_symbol = Persistent<String>::New(String::NewSymbol("length"));
   statics->chars_written_sym = Persistent<String>::New(String::NewSymbol("_charsWritten"));
+  statics->parent_sym = Persistent<String>::New(String::NewSymbol("parent"));
+  statics->offset_sym = Persistent<String>::New(String::NewSymbol("offset"));
 
   Local<FunctionTemplate> t = FunctionTemplate::New(Buffer::New);
   statics->constructor_template = Persistent<FunctionTemplate>::New(t);
@@ -786,6 +2266,7 @@ void Buffer::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "asciiSlice", Buffer::AsciiSlice);
   NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "base64Slice", Buffer::Base64Slice);
   NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "ucs2Slice", Buffer::Ucs2Slice);
+  NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "hexSlice", Buffer::HexSlice);
   // TODO NODE_SET_PROTOTYPE_METHOD(t, "utf16Slice", Utf16Slice);
   // copy
   NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "utf8Slice", Buffer::Utf8Slice);
@@ -795,8 +2276,12 @@ void Buffer::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "binaryWrite", Buffer::BinaryWrite);
   NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "base64Write", Buffer::Base64Write);
   NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "ucs2Write", Buffer::Ucs2Write);
+  NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "hexWrite", Buffer::HexWrite);
+  NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "readTypedArray", Buffer::ReadTypedArray);
+  NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "writeTypedArray", Buffer::WriteTypedArray);
   NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "fill", Buffer::Fill);
   NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "copy", Buffer::Copy);
+  NODE_SET_PROTOTYPE_METHOD(statics->constructor_template, "indexOf", Buffer::IndexOf);
 
   NODE_SET_METHOD(statics->constructor_template->GetFunction(),
                   "byteLength",
@@ -804,8 +2289,34 @@ void Buffer::Initialize(Handle<Object> target) {
   NODE_SET_METHOD(statics->constructor_template->GetFunction(),
                   "makeFastBuffer",
                   Buffer::MakeFastBuffer);
+  NODE_SET_METHOD(statics->constructor_template->GetFunction(),
+                  "allocFast",
+                  Buffer::AllocFast);
+  NODE_SET_METHOD(statics->constructor_template->GetFunction(),
+                  "arenaStats",
+                  Buffer::ArenaStats);
+  NODE_SET_METHOD(statics->constructor_template->GetFunction(),
+                  "concat",
+                  Buffer::Concat);
+  NODE_SET_METHOD(statics->constructor_template->GetFunction(),
+                  "compare",
+                  Buffer::Compare);
+  NODE_SET_METHOD(statics->constructor_template->GetFunction(),
+                  "equals",
+                  Buffer::Equals);
+  NODE_SET_METHOD(statics->constructor_template->GetFunction(),
+                  "timingSafeEqual",
+                  Buffer::TimingSafeEqual);
+  NODE_SET_METHOD(statics->constructor_template->GetFunction(),
+                  "setAllocationSampling",
+                  Buffer::SetAllocationSampling);
+  NODE_SET_METHOD(statics->constructor_template->GetFunction(),
+                  "allocationProfile",
+                  Buffer::AllocationProfile);
 
   target->Set(String::NewSymbol("SlowBuffer"), statics->constructor_template->GetFunction());
+
+  Utf8Decoder::Initialize(target);
 }
 
 
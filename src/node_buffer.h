@@ -63,6 +63,9 @@ namespace node {
  */
 
 
+class ExternalBufferString;
+struct BufferSampleSite;
+
 class NODE_EXTERN Buffer: public ObjectWrap {
  public:
 
@@ -98,6 +101,22 @@ class NODE_EXTERN Buffer: public ObjectWrap {
   static Buffer* New(char *data, size_t length,
                      free_callback callback, void *hint); // public constructor
 
+  // Takes the storage away from a SlowBuffer, which is left empty, so that
+  // it can be handed to another isolate. Returns NULL for empty buffers and
+  // for buffers whose storage was supplied with a free_callback. The result
+  // is adopted with New(data, length, FreeDetached, length).
+  static char* Detach(v8::Handle<v8::Object> obj, size_t *length);
+  static void FreeDetached(char *data, void *hint);
+
+  // Bytes held by the current isolate's Buffers, storage that was passed in
+  // with a free_callback included.
+  static size_t HeldBytes();
+
+  // Frees the arena blocks that the current isolate's cache, and the depot
+  // shared by all isolates, hold beyond `retain` bytes each. Returns the
+  // bytes freed.
+  static size_t TrimArena(size_t retain);
+
   private:
   static v8::Handle<v8::Value> New(const v8::Arguments &args);
   static v8::Handle<v8::Value> BinarySlice(const v8::Arguments &args);
@@ -105,23 +124,43 @@ class NODE_EXTERN Buffer: public ObjectWrap {
   static v8::Handle<v8::Value> Base64Slice(const v8::Arguments &args);
   static v8::Handle<v8::Value> Utf8Slice(const v8::Arguments &args);
   static v8::Handle<v8::Value> Ucs2Slice(const v8::Arguments &args);
+  static v8::Handle<v8::Value> HexSlice(const v8::Arguments &args);
   static v8::Handle<v8::Value> BinaryWrite(const v8::Arguments &args);
   static v8::Handle<v8::Value> Base64Write(const v8::Arguments &args);
   static v8::Handle<v8::Value> AsciiWrite(const v8::Arguments &args);
   static v8::Handle<v8::Value> Utf8Write(const v8::Arguments &args);
   static v8::Handle<v8::Value> Ucs2Write(const v8::Arguments &args);
+  static v8::Handle<v8::Value> HexWrite(const v8::Arguments &args);
+  static v8::Handle<v8::Value> ReadTypedArray(const v8::Arguments &args);
+  static v8::Handle<v8::Value> WriteTypedArray(const v8::Arguments &args);
   static v8::Handle<v8::Value> ByteLength(const v8::Arguments &args);
   static v8::Handle<v8::Value> MakeFastBuffer(const v8::Arguments &args);
+  static v8::Handle<v8::Value> AllocFast(const v8::Arguments &args);
+  static v8::Handle<v8::Value> ArenaStats(const v8::Arguments &args);
   static v8::Handle<v8::Value> Fill(const v8::Arguments &args);
   static v8::Handle<v8::Value> Copy(const v8::Arguments &args);
+  static v8::Handle<v8::Value> IndexOf(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Concat(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Compare(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Equals(const v8::Arguments &args);
+  static v8::Handle<v8::Value> TimingSafeEqual(const v8::Arguments &args);
+  static v8::Handle<v8::Value> SetAllocationSampling(const v8::Arguments &args);
+  static v8::Handle<v8::Value> AllocationProfile(const v8::Arguments &args);
 
   Buffer(v8::Handle<v8::Object> wrapper, size_t length);
   void Replace(char *data, size_t length, free_callback callback, void *hint);
+  void SampleAllocation();
+  void ReleaseSample();
 
   size_t length_;
   char* data_;
   free_callback callback_;
   void* callback_hint_;
+  // allocation site the storage was sampled at, if it was
+  BufferSampleSite* sample_site_;
+  double sample_bytes_;
+
+  friend class ExternalBufferString;
 };
 
 
@@ -20,12 +20,14 @@
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <node_crypto.h>
+#include <node_crypto_bio.h>
 #include <v8.h>
 
 #include <node.h>
 #include <node_statics.h>
 #include <node_buffer.h>
 #include <node_root_certs.h>
+#include <node_crypto_groups.h>
 
 #include <string.h>
 #ifdef _MSC_VER
@@ -34,9 +36,14 @@
 #endif
 
 #include <stdlib.h>
+#include <stdio.h>
 
 #include <errno.h>
 
+#include <map>
+#include <string>
+#include <vector>
+
 /* Sigh. */
 #ifdef _WIN32
 # include <windows.h>
@@ -55,6 +62,11 @@
     return ThrowException(Exception::TypeError(String::New("Not a string or buffer"))); \
   }
 
+#define ASSERT_NOT_BUSY(obj) \
+  if ((obj)->busy_) { \
+    return ThrowException(Exception::Error(String::New("Asynchronous update in progress"))); \
+  }
+
 static const char *PUBLIC_KEY_PFX =  "-----BEGIN PUBLIC KEY-----";
 static const int PUBLIC_KEY_PFX_LEN = strlen(PUBLIC_KEY_PFX);
 
@@ -83,7 +95,11 @@ public:
     Persistent<String> name_symbol;
     Persistent<String> version_symbol;
     Persistent<String> ext_key_usage_symbol;
+    Persistent<String> onnewsession_symbol;
+    Persistent<String> onclienthello_symbol;
+    Persistent<String> session_id_symbol;
     Persistent<FunctionTemplate> secure_context_constructor;
+    Persistent<Function> diffie_hellman_constructor;
 };
 
 static unsigned long crypto_id_cb(void) {
@@ -97,6 +113,40 @@ static unsigned long crypto_id_cb(void) {
 static uv_rwlock_t* locks;
 
 
+// A context configured once and handed to every SecureContext, in any
+// isolate, that asks for the same key.
+struct SharedContext {
+  char* key;
+  SSL_CTX* ctx;
+  int users;
+  SharedContext* next;
+};
+
+// OpenSSL and the contexts above are per process, not per isolate.
+static struct ProcessState {
+  ProcessState() {
+    uv_mutex_init(&mutex);
+    initialized = false;
+    contexts = NULL;
+  }
+
+  uv_mutex_t mutex;
+  bool initialized;
+  SharedContext* contexts;
+} process_state;
+
+
+// Must be called with process_state.mutex held.
+static SharedContext* FindSharedContext(const char* key) {
+  for (SharedContext* entry = process_state.contexts;
+       entry != NULL;
+       entry = entry->next) {
+    if (strcmp(entry->key, key) == 0) return entry;
+  }
+  return NULL;
+}
+
+
 static void crypto_lock_init(void) {
   int i, n;
 
@@ -127,6 +177,182 @@ static void crypto_lock_cb(int mode, int n, const char* file, int line) {
 }
 
 
+// Peer certificate chains that verified, so that peers presenting the same
+// chain again skip X509_verify_cert(). Entries are keyed by the SHA-256 of
+// the DER of the peer's certificate followed by the chain it sent, and
+// expire after the TTL or with the certificate. Only successes are kept, and
+// adding a CRL drops them all. The cache belongs to an SSL_CTX, which
+// isolates may share, hence the lock.
+class VerifyCache {
+ public:
+  VerifyCache() : ttl_(0), max_entries_(0), generation_(0),
+                  hits_(0), misses_(0) {
+    uv_mutex_init(&mutex_);
+  }
+
+  ~VerifyCache() {
+    uv_mutex_destroy(&mutex_);
+  }
+
+  // `ttl` in milliseconds.
+  void Configure(double ttl, size_t max_entries) {
+    uv_mutex_lock(&mutex_);
+    ttl_ = static_cast<uint64_t>(ttl * 1e6);
+    max_entries_ = max_entries;
+    entries_.clear();
+    uv_mutex_unlock(&mutex_);
+  }
+
+  bool Lookup(const std::string& key, X509* cert) {
+    uint64_t now = uv_hrtime();
+    bool hit = false;
+
+    uv_mutex_lock(&mutex_);
+    Entries::iterator it = entries_.find(key);
+    if (it != entries_.end()) {
+      if (it->second > now &&
+          X509_cmp_current_time(X509_get_notAfter(cert)) > 0) {
+        hit = true;
+      } else {
+        entries_.erase(it);
+      }
+    }
+    if (hit) hits_++; else misses_++;
+    uv_mutex_unlock(&mutex_);
+
+    return hit;
+  }
+
+  // `generation` is what Generation() returned before the chain was
+  // verified: a chain that verified before a CRL came in is not added.
+  void Insert(const std::string& key, unsigned int generation) {
+    uint64_t now = uv_hrtime();
+
+    uv_mutex_lock(&mutex_);
+    if (generation == generation_ && max_entries_ > 0) {
+      if (entries_.size() >= max_entries_) Evict(now);
+      entries_[key] = now + ttl_;
+    }
+    uv_mutex_unlock(&mutex_);
+  }
+
+  unsigned int Generation() {
+    uv_mutex_lock(&mutex_);
+    unsigned int generation = generation_;
+    uv_mutex_unlock(&mutex_);
+    return generation;
+  }
+
+  void Clear() {
+    uv_mutex_lock(&mutex_);
+    entries_.clear();
+    generation_++;
+    uv_mutex_unlock(&mutex_);
+  }
+
+  Local<Object> Stats() {
+    HandleScope scope;
+    Local<Object> stats = Object::New();
+
+    uv_mutex_lock(&mutex_);
+    stats->Set(String::NewSymbol("size"), Number::New(entries_.size()));
+    stats->Set(String::NewSymbol("hits"), Number::New(hits_));
+    stats->Set(String::NewSymbol("misses"), Number::New(misses_));
+    uv_mutex_unlock(&mutex_);
+
+    return scope.Close(stats);
+  }
+
+ private:
+  typedef std::map<std::string, uint64_t> Entries;
+
+  // Makes room for one more entry: drops the expired ones, or if there are
+  // none, the first in key order, which is as good as a random one.
+  void Evict(uint64_t now) {
+    Entries::iterator it = entries_.begin();
+    while (it != entries_.end()) {
+      if (it->second <= now) {
+        entries_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+    if (entries_.size() >= max_entries_) entries_.erase(entries_.begin());
+  }
+
+  uv_mutex_t mutex_;
+  uint64_t ttl_;
+  size_t max_entries_;
+  unsigned int generation_;
+  double hits_;
+  double misses_;
+  Entries entries_;
+};
+
+// The SSL_CTX ex_data slot of its VerifyCache, freed along with it.
+static int verify_cache_index = -1;
+
+static void FreeVerifyCache(void* parent, void* ptr, CRYPTO_EX_DATA* ad,
+                            int idx, long argl, void* argp) {
+  delete static_cast<VerifyCache*>(ptr);
+}
+
+static VerifyCache* GetVerifyCache(SSL_CTX* ctx) {
+  return static_cast<VerifyCache*>(
+      SSL_CTX_get_ex_data(ctx, verify_cache_index));
+}
+
+static bool AddCertToDigest(EVP_MD_CTX* md, X509* cert) {
+  int len = i2d_X509(cert, NULL);
+  if (len <= 0) return false;
+  unsigned char* der = new unsigned char[len];
+  unsigned char* p = der;
+  i2d_X509(cert, &p);
+  EVP_DigestUpdate(md, der, len);
+  delete[] der;
+  return true;
+}
+
+// Stands in for X509_verify_cert() in the handshakes of a context with a
+// verification cache. A hit leaves X509_V_OK as the verification result,
+// as a successful verification would.
+static int CachedVerifyCallback(X509_STORE_CTX* ctx, void* arg) {
+  VerifyCache* cache = static_cast<VerifyCache*>(arg);
+
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_len = 0;
+  bool ok = ctx->cert != NULL;
+
+  EVP_MD_CTX md;
+  EVP_MD_CTX_init(&md);
+  EVP_DigestInit_ex(&md, EVP_sha256(), NULL);
+  if (ok) ok = AddCertToDigest(&md, ctx->cert);
+  for (int i = 0; ok && ctx->untrusted && i < sk_X509_num(ctx->untrusted);
+       i++) {
+    ok = AddCertToDigest(&md, sk_X509_value(ctx->untrusted, i));
+  }
+  EVP_DigestFinal_ex(&md, digest, &digest_len);
+  EVP_MD_CTX_cleanup(&md);
+
+  if (!ok) return X509_verify_cert(ctx);
+
+  std::string key(reinterpret_cast<char*>(digest), digest_len);
+  if (cache->Lookup(key, ctx->cert)) {
+    X509_STORE_CTX_set_error(ctx, X509_V_OK);
+    return 1;
+  }
+
+  unsigned int generation = cache->Generation();
+  int r = X509_verify_cert(ctx);
+  // VerifyCallback lets verification go on whatever goes wrong, so the
+  // outcome is in the error.
+  if (r == 1 && X509_STORE_CTX_get_error(ctx) == X509_V_OK) {
+    cache->Insert(key, generation);
+  }
+  return r;
+}
+
+
 
 
 void SecureContext::Initialize(Handle<Object> target) {
@@ -149,6 +375,14 @@ void SecureContext::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(t, "setOptions", SecureContext::SetOptions);
   NODE_SET_PROTOTYPE_METHOD(t, "setSessionIdContext",
                                SecureContext::SetSessionIdContext);
+  NODE_SET_PROTOTYPE_METHOD(t, "setTicketKeys", SecureContext::SetTicketKeys);
+  NODE_SET_PROTOTYPE_METHOD(t, "getTicketKeys", SecureContext::GetTicketKeys);
+  NODE_SET_PROTOTYPE_METHOD(t, "setVerifyCache",
+                               SecureContext::SetVerifyCache);
+  NODE_SET_PROTOTYPE_METHOD(t, "getVerifyCacheStats",
+                               SecureContext::GetVerifyCacheStats);
+  NODE_SET_PROTOTYPE_METHOD(t, "useShared", SecureContext::UseShared);
+  NODE_SET_PROTOTYPE_METHOD(t, "share", SecureContext::Share);
   NODE_SET_PROTOTYPE_METHOD(t, "close", SecureContext::Close);
 
   target->Set(String::NewSymbol("SecureContext"), t->GetFunction());
@@ -218,6 +452,8 @@ Handle<Value> SecureContext::Init(const Arguments& args) {
   // Enable session caching?
   SSL_CTX_set_session_cache_mode(sc->ctx_, SSL_SESS_CACHE_SERVER);
   // SSL_CTX_set_session_cache_mode(sc->ctx_,SSL_SESS_CACHE_OFF);
+  SSL_CTX_sess_set_get_cb(sc->ctx_, Connection::GetSessionCallback);
+  SSL_CTX_sess_set_new_cb(sc->ctx_, Connection::NewSessionCallback);
 
   sc->ca_store_ = NULL;
   return True();
@@ -459,6 +695,10 @@ Handle<Value> SecureContext::AddCRL(const Arguments& args) {
   X509_STORE_set_flags(sc->ca_store_, X509_V_FLAG_CRL_CHECK |
                                       X509_V_FLAG_CRL_CHECK_ALL);
 
+  // Chains that verified may be revoked now.
+  VerifyCache* cache = GetVerifyCache(sc->ctx_);
+  if (cache) cache->Clear();
+
   BIO_free(bio);
   X509_CRL_free(x509);
 
@@ -466,6 +706,51 @@ Handle<Value> SecureContext::AddCRL(const Arguments& args) {
 }
 
 
+// setVerifyCache(ttl, [maxEntries]) remembers peer chains that verified for
+// `ttl` milliseconds, see VerifyCache. A ttl of 0 turns the cache off.
+Handle<Value> SecureContext::SetVerifyCache(const Arguments& args) {
+  HandleScope scope;
+
+  SecureContext *sc = ObjectWrap::Unwrap<SecureContext>(args.Holder());
+
+  if (!args[0]->IsNumber() || !(args[0]->NumberValue() >= 0)) {
+    return ThrowException(Exception::TypeError(
+          String::New("TTL must be a non-negative number")));
+  }
+  double ttl = args[0]->NumberValue();
+  size_t max_entries = args[1]->IsUint32() ? args[1]->Uint32Value() : 10000;
+
+  VerifyCache* cache = GetVerifyCache(sc->ctx_);
+
+  if (ttl == 0) {
+    SSL_CTX_set_cert_verify_callback(sc->ctx_, NULL, NULL);
+    if (cache) cache->Clear();
+    return True();
+  }
+
+  if (cache == NULL) {
+    cache = new VerifyCache();
+    SSL_CTX_set_ex_data(sc->ctx_, verify_cache_index, cache);
+  }
+  cache->Configure(ttl, max_entries);
+  SSL_CTX_set_cert_verify_callback(sc->ctx_, CachedVerifyCallback, cache);
+
+  return True();
+}
+
+
+Handle<Value> SecureContext::GetVerifyCacheStats(const Arguments& args) {
+  HandleScope scope;
+
+  SecureContext *sc = ObjectWrap::Unwrap<SecureContext>(args.Holder());
+
+  VerifyCache* cache = GetVerifyCache(sc->ctx_);
+  if (cache == NULL) return Null();
+
+  return scope.Close(cache->Stats());
+}
+
+
 
 Handle<Value> SecureContext::AddRootCerts(const Arguments& args) {
   HandleScope scope;
@@ -474,14 +759,19 @@ Handle<Value> SecureContext::AddRootCerts(const Arguments& args) {
 
   assert(sc->ca_store_ == NULL);
 
+  // The store is built once per process and shared by all isolates.
+  uv_mutex_lock(&process_state.mutex);
+
   if (!root_cert_store) {
-    root_cert_store = X509_STORE_new();
+    X509_STORE* store = X509_STORE_new();
 
     for (int i = 0; root_certs[i]; i++) {
       BIO *bp = BIO_new(BIO_s_mem());
 
       if (!BIO_write(bp, root_certs[i], strlen(root_certs[i]))) {
         BIO_free(bp);
+        X509_STORE_free(store);
+        uv_mutex_unlock(&process_state.mutex);
         return False();
       }
 
@@ -489,16 +779,22 @@ Handle<Value> SecureContext::AddRootCerts(const Arguments& args) {
 
       if (x509 == NULL) {
         BIO_free(bp);
+        X509_STORE_free(store);
+        uv_mutex_unlock(&process_state.mutex);
         return False();
       }
 
-      X509_STORE_add_cert(root_cert_store, x509);
+      X509_STORE_add_cert(store, x509);
 
       BIO_free(bp);
       X509_free(x509);
     }
+
+    root_cert_store = store;
   }
 
+  uv_mutex_unlock(&process_state.mutex);
+
   sc->ca_store_ = root_cert_store;
   SSL_CTX_set_cert_store(sc->ctx_, sc->ca_store_);
 
@@ -569,6 +865,194 @@ Handle<Value> SecureContext::SetSessionIdContext(const Arguments& args) {
   return True();
 }
 
+Handle<Value> SecureContext::SetTicketKeys(const Arguments& args) {
+  HandleScope scope;
+
+  SecureContext *sc = ObjectWrap::Unwrap<SecureContext>(args.Holder());
+
+#ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB
+  if (args.Length() != 1 || !Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(String::New("Bad parameter")));
+  }
+
+  if (sc->shared_ != NULL) {
+    return ThrowException(Exception::Error(
+          String::New("Cannot set ticket keys on a shared context")));
+  }
+
+  Local<Object> keys = args[0]->ToObject();
+  size_t keys_length = Buffer::Length(keys);
+
+  if (keys_length == 0 ||
+      keys_length % kTicketKeyLength != 0 ||
+      keys_length > kMaxTicketKeys * kTicketKeyLength) {
+    return ThrowException(Exception::TypeError(
+          String::New("Ticket keys must be 1 to 8 keys of 48 bytes each")));
+  }
+
+  memcpy(sc->ticket_keys_, Buffer::Data(keys), keys_length);
+  sc->ticket_key_count_ = keys_length / kTicketKeyLength;
+
+  SSL_CTX_set_app_data(sc->ctx_, sc);
+  SSL_CTX_set_tlsext_ticket_key_cb(sc->ctx_, TicketKeyCallback);
+
+  return True();
+#else
+  return ThrowException(Exception::Error(
+        String::New("Session tickets not supported by this OpenSSL")));
+#endif
+}
+
+
+Handle<Value> SecureContext::GetTicketKeys(const Arguments& args) {
+  HandleScope scope;
+
+  SecureContext *sc = ObjectWrap::Unwrap<SecureContext>(args.Holder());
+
+  if (sc->ticket_key_count_ == 0) return Undefined();
+
+  Buffer* keys = Buffer::New(reinterpret_cast<char*>(sc->ticket_keys_),
+                             sc->ticket_key_count_ * kTicketKeyLength);
+  return scope.Close(keys->handle_);
+}
+
+
+#ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB
+int SecureContext::TicketKeyCallback(SSL *ssl,
+                                     unsigned char *name,
+                                     unsigned char *iv,
+                                     EVP_CIPHER_CTX *ectx,
+                                     HMAC_CTX *hctx,
+                                     int enc) {
+  // Tickets are always handled by the context the connection started on.
+  SecureContext *sc = static_cast<SecureContext*>(
+      SSL_CTX_get_app_data(ssl->initial_ctx));
+
+  if (enc) {
+    unsigned char* key = sc->ticket_keys_[0];
+
+    if (RAND_pseudo_bytes(iv, 16) < 0) return -1;
+    memcpy(name, key, 16);
+    EVP_EncryptInit_ex(ectx, EVP_aes_128_cbc(), NULL, key + 32, iv);
+    HMAC_Init_ex(hctx, key + 16, 16, EVP_sha256(), NULL);
+    return 1;
+  }
+
+  for (int i = 0; i < sc->ticket_key_count_; i++) {
+    unsigned char* key = sc->ticket_keys_[i];
+    if (memcmp(name, key, 16) != 0) continue;
+
+    HMAC_Init_ex(hctx, key + 16, 16, EVP_sha256(), NULL);
+    EVP_DecryptInit_ex(ectx, EVP_aes_128_cbc(), NULL, key + 32, iv);
+
+    // Retired keys are accepted as they are. Asking OpenSSL to renew the
+    // ticket (returning 2) sends a NewSessionTicket in the abbreviated
+    // handshake, which 0.9.8 clients reject as an unexpected message.
+    return 1;
+  }
+
+  // Unknown key: fall back to a full handshake
+  return 0;
+}
+#endif
+
+
+// Swaps our context for the shared one registered under the key, if any.
+// Returns true in that case, the caller then skips configuring it.
+Handle<Value> SecureContext::UseShared(const Arguments& args) {
+  HandleScope scope;
+
+  SecureContext *sc = ObjectWrap::Unwrap<SecureContext>(args.Holder());
+
+  if (args.Length() != 1 || !args[0]->IsString()) {
+    return ThrowException(Exception::TypeError(String::New("Bad parameter")));
+  }
+
+  String::Utf8Value key(args[0]->ToString());
+
+  uv_mutex_lock(&process_state.mutex);
+  SharedContext* entry = FindSharedContext(*key);
+  if (entry != NULL) entry->users++;
+  uv_mutex_unlock(&process_state.mutex);
+
+  if (entry == NULL) return False();
+
+  sc->FreeCTXMem();
+  sc->ctx_ = entry->ctx;
+  sc->shared_ = entry;
+
+  return True();
+}
+
+
+// Publishes our fully configured context under the key. Should another
+// isolate have beaten us to it, we switch to theirs instead.
+Handle<Value> SecureContext::Share(const Arguments& args) {
+  HandleScope scope;
+
+  SecureContext *sc = ObjectWrap::Unwrap<SecureContext>(args.Holder());
+
+  if (args.Length() != 1 || !args[0]->IsString()) {
+    return ThrowException(Exception::TypeError(String::New("Bad parameter")));
+  }
+
+  if (sc->shared_ != NULL || sc->ctx_ == NULL) return False();
+
+  String::Utf8Value key(args[0]->ToString());
+
+  uv_mutex_lock(&process_state.mutex);
+
+  SharedContext* entry = FindSharedContext(*key);
+  SSL_CTX* own = NULL;
+
+  if (entry != NULL) {
+    entry->users++;
+    own = sc->ctx_;
+  } else {
+    entry = new SharedContext;
+    entry->key = new char[key.length() + 1];
+    memcpy(entry->key, *key, key.length() + 1);
+    entry->ctx = sc->ctx_;
+    entry->users = 1;
+    entry->next = process_state.contexts;
+    process_state.contexts = entry;
+  }
+
+  uv_mutex_unlock(&process_state.mutex);
+
+  if (own != NULL) FreeCTX(own);
+  sc->ctx_ = entry->ctx;
+  sc->ca_store_ = NULL;
+  sc->shared_ = entry;
+
+  return True();
+}
+
+
+void SecureContext::ReleaseShared() {
+  SharedContext* entry = shared_;
+  shared_ = NULL;
+
+  uv_mutex_lock(&process_state.mutex);
+
+  bool last = --entry->users == 0;
+  if (last) {
+    SharedContext** link = &process_state.contexts;
+    while (*link != entry) link = &(*link)->next;
+    *link = entry->next;
+  }
+
+  uv_mutex_unlock(&process_state.mutex);
+
+  if (last) {
+    // Connections still using it hold their own reference.
+    FreeCTX(entry->ctx);
+    delete[] entry->key;
+    delete entry;
+  }
+}
+
+
 Handle<Value> SecureContext::Close(const Arguments& args) {
   HandleScope scope;
   SecureContext *sc = ObjectWrap::Unwrap<SecureContext>(args.Holder());
@@ -706,6 +1190,13 @@ void Connection::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(t, "shutdown", Connection::Shutdown);
   NODE_SET_PROTOTYPE_METHOD(t, "receivedShutdown", Connection::ReceivedShutdown);
   NODE_SET_PROTOTYPE_METHOD(t, "close", Connection::Close);
+  NODE_SET_PROTOTYPE_METHOD(t, "enableSessionCallbacks",
+                            Connection::EnableSessionCallbacks);
+  NODE_SET_PROTOTYPE_METHOD(t, "loadSession", Connection::LoadSession);
+  NODE_SET_PROTOTYPE_METHOD(t, "endParser", Connection::EndParser);
+  NODE_SET_PROTOTYPE_METHOD(t, "handshakeAsync", Connection::HandshakeAsync);
+  NODE_SET_PROTOTYPE_METHOD(t, "setRecordSize", Connection::SetRecordSize);
+  NODE_SET_PROTOTYPE_METHOD(t, "clearFlush", Connection::ClearFlush);
 
 #ifdef OPENSSL_NPN_NEGOTIATED
   NODE_SET_PROTOTYPE_METHOD(t, "getNegotiatedProtocol", Connection::GetNegotiatedProto);
@@ -889,6 +1380,147 @@ int Connection::SelectSNIContextCallback_(SSL *s, int *ad, void* arg) {
 }
 #endif
 
+int Connection::ClientHelloParser::Write(const char* data, size_t len) {
+  // The lookup is still running: keep the bytes queued on the JS side.
+  if (state_ == kPaused) return 0;
+
+  if (offset_ + len > sizeof(data_)) {
+    // Not a ClientHello we can make sense of; stop intercepting.
+    Finish();
+  } else {
+    memcpy(data_ + offset_, data, len);
+    offset_ += len;
+    Parse();
+    return len;
+  }
+
+  int bytes_written = BIO_write(conn_->bio_read_, data, len);
+  conn_->HandleBIOError(conn_->bio_read_, "BIO_write", bytes_written);
+  return bytes_written;
+}
+
+
+void Connection::ClientHelloParser::Parse() {
+  HandleScope scope;
+
+  const unsigned char* body = reinterpret_cast<unsigned char*>(data_);
+
+  if (offset_ < 6) return;
+
+  // Only TLS handshake records carrying a ClientHello are of interest,
+  // SSLv2 compatible hellos cannot resume TLS sessions anyway.
+  if (body[0] != 22 || body[5] != 1) return Finish();
+
+  if (offset_ < kSessionIdOffset + 1) return;
+
+  size_t session_size = body[kSessionIdOffset];
+  if (session_size == 0 || session_size > 32) return Finish();
+  if (offset_ < kSessionIdOffset + 1 + session_size) return;
+
+  CryptoStatics *statics = NODE_STATICS_GET(node_crypto, CryptoStatics);
+
+  Local<Value> cb = conn_->handle_->Get(statics->onclienthello_symbol);
+  if (!cb->IsFunction()) return Finish();
+
+  state_ = kPaused;
+
+  Buffer* session_id = Buffer::New(data_ + kSessionIdOffset + 1,
+                                   session_size);
+  Local<Object> hello = Object::New();
+  hello->Set(statics->session_id_symbol,
+             Local<Value>::New(session_id->handle_));
+
+  Local<Value> argv[1] = { hello };
+
+  TryCatch try_catch;
+  Local<Function>::Cast(cb)->Call(conn_->handle_, 1, argv);
+  if (try_catch.HasCaught()) {
+    FatalException(try_catch);
+  }
+}
+
+
+void Connection::ClientHelloParser::Finish() {
+  if (state_ == kEnded) return;
+  state_ = kEnded;
+
+  if (offset_ > 0 && conn_->ssl_ != NULL) {
+    BIO_write(conn_->bio_read_, data_, offset_);
+  }
+  offset_ = 0;
+}
+
+
+SSL_SESSION* Connection::GetSessionCallback(SSL *s,
+                                            unsigned char *key,
+                                            int len,
+                                            int *copy) {
+  Connection* p = static_cast<Connection*>(SSL_get_app_data(s));
+
+  // OpenSSL takes over our reference.
+  *copy = 0;
+
+  SSL_SESSION* sess = p->next_sess_;
+  p->next_sess_ = NULL;
+
+  return sess;
+}
+
+
+int Connection::NewSessionCallback(SSL *s, SSL_SESSION *sess) {
+  Connection* p = static_cast<Connection*>(SSL_get_app_data(s));
+  if (!p->is_server_) return 0;
+
+  if (p->handshake_pending_) {
+    // Called on the thread pool: keep the reference and emit the session
+    // once the handshake step is back on the loop.
+    if (p->deferred_sess_ != NULL) SSL_SESSION_free(p->deferred_sess_);
+    p->deferred_sess_ = sess;
+    return 1;
+  }
+
+  p->EmitNewSession(sess);
+
+  // We kept no reference to the session.
+  return 0;
+}
+
+
+void Connection::EmitNewSession(SSL_SESSION *sess) {
+  HandleScope scope;
+
+  CryptoStatics *statics = NODE_STATICS_GET(node_crypto, CryptoStatics);
+
+  Local<Value> cb = handle_->Get(statics->onnewsession_symbol);
+  if (!cb->IsFunction()) return;
+
+  int size = i2d_SSL_SESSION(sess, NULL);
+  if (size <= 0) return;
+
+  Buffer* serialized = Buffer::New(size);
+  unsigned char* serialized_data =
+      reinterpret_cast<unsigned char*>(Buffer::Data(serialized));
+  i2d_SSL_SESSION(sess, &serialized_data);
+
+  unsigned int session_id_length;
+  const unsigned char* session_id = SSL_SESSION_get_id(sess,
+                                                       &session_id_length);
+  Buffer* id = Buffer::New(reinterpret_cast<const char*>(session_id),
+                           session_id_length);
+
+  Local<Value> argv[2] = {
+    Local<Value>::New(id->handle_),
+    Local<Value>::New(serialized->handle_)
+  };
+
+  TryCatch try_catch;
+  Local<Function>::Cast(cb)->Call(handle_, 2, argv);
+  if (try_catch.HasCaught()) {
+    FatalException(try_catch);
+  }
+}
+
+
 Handle<Value> Connection::New(const Arguments& args) {
   HandleScope scope;
 
@@ -905,8 +1537,8 @@ Handle<Value> Connection::New(const Arguments& args) {
   bool is_server = args[1]->BooleanValue();
 
   p->ssl_ = SSL_new(sc->ctx_);
-  p->bio_read_ = BIO_new(BIO_s_mem());
-  p->bio_write_ = BIO_new(BIO_s_mem());
+  p->bio_read_ = BIO_new(NodeBIO::GetMethod());
+  p->bio_write_ = BIO_new(NodeBIO::GetMethod());
 
   SSL_set_app_data(p->ssl_, p);
 
@@ -977,6 +1609,9 @@ Handle<Value> Connection::EncIn(const Arguments& args) {
 
   Connection *ss = Connection::Unwrap(args);
 
+  // The SSL object is busy on the thread pool, try again afterwards
+  if (ss->handshake_pending_) return scope.Close(Integer::New(0));
+
   if (args.Length() < 3) {
     return ThrowException(Exception::TypeError(
           String::New("Takes 3 parameters")));
@@ -1003,8 +1638,13 @@ Handle<Value> Connection::EncIn(const Arguments& args) {
           String::New("Length is extends beyond buffer")));
   }
 
-  int bytes_written = BIO_write(ss->bio_read_, buffer_data + off, len);
-  ss->HandleBIOError(ss->bio_read_, "BIO_write", bytes_written);
+  int bytes_written;
+  if (ss->is_server_ && !ss->hello_parser_.ended()) {
+    bytes_written = ss->hello_parser_.Write(buffer_data + off, len);
+  } else {
+    bytes_written = BIO_write(ss->bio_read_, buffer_data + off, len);
+    ss->HandleBIOError(ss->bio_read_, "BIO_write", bytes_written);
+  }
   ss->SetShutdownFlags();
 
   return scope.Close(Integer::New(bytes_written));
@@ -1016,6 +1656,9 @@ Handle<Value> Connection::ClearOut(const Arguments& args) {
 
   Connection *ss = Connection::Unwrap(args);
 
+  // The SSL object is busy on the thread pool, try again afterwards
+  if (ss->handshake_pending_) return scope.Close(Integer::New(0));
+
   if (args.Length() < 3) {
     return ThrowException(Exception::TypeError(
           String::New("Takes 3 parameters")));
@@ -1056,11 +1699,25 @@ Handle<Value> Connection::ClearOut(const Arguments& args) {
     if (rv < 0) return scope.Close(Integer::New(rv));
   }
 
-  int bytes_read = SSL_read(ss->ssl_, buffer_data + off, len);
-  ss->HandleSSLError("SSL_read:ClearOut", bytes_read);
-  ss->SetShutdownFlags();
-
-  return scope.Close(Integer::New(bytes_read));
+  // SSL_read() returns one record at a time. Keep reading until the buffer
+  // is full or there is nothing left, so that JS gets everything in one
+  // call. A failure after some data was read is left for the next call.
+  int bytes_read = 0;
+  while (static_cast<size_t>(bytes_read) < len) {
+    int rv = SSL_read(ss->ssl_, buffer_data + off + bytes_read,
+                      len - bytes_read);
+    if (rv <= 0) {
+      if (bytes_read == 0) {
+        bytes_read = rv;
+        ss->HandleSSLError("SSL_read:ClearOut", rv);
+      }
+      break;
+    }
+    bytes_read += rv;
+  }
+  ss->SetShutdownFlags();
+
+  return scope.Close(Integer::New(bytes_read));
 }
 
 
@@ -1069,6 +1726,9 @@ Handle<Value> Connection::ClearPending(const Arguments& args) {
 
   Connection *ss = Connection::Unwrap(args);
 
+  // The SSL object is busy on the thread pool, try again afterwards
+  if (ss->handshake_pending_) return scope.Close(Integer::New(0));
+
   int bytes_pending = BIO_pending(ss->bio_read_);
   return scope.Close(Integer::New(bytes_pending));
 }
@@ -1079,6 +1739,9 @@ Handle<Value> Connection::EncPending(const Arguments& args) {
 
   Connection *ss = Connection::Unwrap(args);
 
+  // The SSL object is busy on the thread pool, try again afterwards
+  if (ss->handshake_pending_) return scope.Close(Integer::New(0));
+
   int bytes_pending = BIO_pending(ss->bio_write_);
   return scope.Close(Integer::New(bytes_pending));
 }
@@ -1089,6 +1752,9 @@ Handle<Value> Connection::EncOut(const Arguments& args) {
 
   Connection *ss = Connection::Unwrap(args);
 
+  // The SSL object is busy on the thread pool, try again afterwards
+  if (ss->handshake_pending_) return scope.Close(Integer::New(0));
+
   if (args.Length() < 3) {
     return ThrowException(Exception::TypeError(
           String::New("Takes 3 parameters")));
@@ -1129,6 +1795,9 @@ Handle<Value> Connection::ClearIn(const Arguments& args) {
 
   Connection *ss = Connection::Unwrap(args);
 
+  // The SSL object is busy on the thread pool, try again afterwards
+  if (ss->handshake_pending_) return scope.Close(Integer::New(0));
+
   if (args.Length() < 3) {
     return ThrowException(Exception::TypeError(
           String::New("Takes 3 parameters")));
@@ -1168,6 +1837,23 @@ Handle<Value> Connection::ClearIn(const Arguments& args) {
     if (rv < 0) return scope.Close(Integer::New(rv));
   }
 
+  if (ss->coalesce_size_ > 0) {
+    // Make room first, or keep the order of the bytes if this write
+    // bypasses the buffer
+    if (ss->coalesce_len_ > 0 &&
+        (len >= ss->coalesce_size_ ||
+         ss->coalesce_len_ + len > ss->coalesce_size_)) {
+      int rv = ss->FlushCleartext();
+      if (rv != 0) return scope.Close(Integer::New(rv < 0 ? rv : 0));
+    }
+
+    if (len < ss->coalesce_size_) {
+      memcpy(ss->coalesce_buf_ + ss->coalesce_len_, buffer_data + off, len);
+      ss->coalesce_len_ += len;
+      return scope.Close(Integer::New(len));
+    }
+  }
+
   int bytes_written = SSL_write(ss->ssl_, buffer_data + off, len);
 
   ss->HandleSSLError("SSL_write:ClearIn", bytes_written);
@@ -1370,6 +2056,9 @@ Handle<Value> Connection::Start(const Arguments& args) {
 
   Connection *ss = Connection::Unwrap(args);
 
+  // The SSL object is busy on the thread pool, try again afterwards
+  if (ss->handshake_pending_) return scope.Close(Integer::New(0));
+
   if (!SSL_is_init_finished(ss->ssl_)) {
     int rv;
     if (ss->is_server_) {
@@ -1392,7 +2081,11 @@ Handle<Value> Connection::Shutdown(const Arguments& args) {
 
   Connection *ss = Connection::Unwrap(args);
 
+  // The SSL object is busy on the thread pool, try again afterwards
+  if (ss->handshake_pending_) return scope.Close(Integer::New(0));
+
   if (ss->ssl_ == NULL) return False();
+  ss->FlushCleartext();
   int rv = SSL_shutdown(ss->ssl_);
 
   ss->HandleSSLError("SSL_shutdown", rv);
@@ -1594,6 +2287,12 @@ Handle<Value> Connection::Close(const Arguments& args) {
 
   Connection *ss = Connection::Unwrap(args);
 
+  if (ss->handshake_pending_) {
+    // Freed by AfterHandshake once the worker lets go of it
+    ss->close_pending_ = true;
+    return True();
+  }
+
   if (ss->ssl_ != NULL) {
     SSL_free(ss->ssl_);
     ss->ssl_ = NULL;
@@ -1601,6 +2300,244 @@ Handle<Value> Connection::Close(const Arguments& args) {
   return True();
 }
 
+Handle<Value> Connection::EnableSessionCallbacks(const Arguments& args) {
+  HandleScope scope;
+
+  Connection *ss = Connection::Unwrap(args);
+
+  if (ss->is_server_) {
+    // A ticket would only be understood by the server that issued it, and
+    // a client offering one skips the session id lookup altogether.
+#ifdef SSL_OP_NO_TICKET
+    SSL_set_options(ss->ssl_, SSL_OP_NO_TICKET);
+#endif
+    ss->hello_parser_.Start();
+  }
+
+  return True();
+}
+
+
+Handle<Value> Connection::LoadSession(const Arguments& args) {
+  HandleScope scope;
+
+  Connection *ss = Connection::Unwrap(args);
+
+  if (args.Length() >= 1 && Buffer::HasInstance(args[0])) {
+    Local<Object> session = args[0]->ToObject();
+    const unsigned char* p =
+        reinterpret_cast<unsigned char*>(Buffer::Data(session));
+    SSL_SESSION* sess = d2i_SSL_SESSION(NULL, &p, Buffer::Length(session));
+
+    // A session loaded earlier for this connection is replaced
+    if (ss->next_sess_ != NULL) SSL_SESSION_free(ss->next_sess_);
+    ss->next_sess_ = sess;
+  }
+
+  return True();
+}
+
+
+Handle<Value> Connection::EndParser(const Arguments& args) {
+  HandleScope scope;
+
+  Connection *ss = Connection::Unwrap(args);
+
+  ss->hello_parser_.Finish();
+
+  return True();
+}
+
+
+// Writes out the coalesced cleartext. Returns how many bytes are still
+// buffered, which happens while a renegotiation waits for the peer, or the
+// failed SSL_write's result.
+int Connection::FlushCleartext() {
+  if (ssl_ == NULL || handshake_pending_) {
+    return static_cast<int>(coalesce_len_);
+  }
+
+  while (coalesce_len_ > 0) {
+    int rv = SSL_write(ssl_, coalesce_buf_, coalesce_len_);
+    int err = HandleSSLError("SSL_write:ClearFlush", rv);
+    SetShutdownFlags();
+
+    if (rv <= 0) return err < 0 ? err : static_cast<int>(coalesce_len_);
+
+    coalesce_len_ -= rv;
+    memmove(coalesce_buf_, coalesce_buf_ + rv, coalesce_len_);
+  }
+
+  return 0;
+}
+
+
+Handle<Value> Connection::SetRecordSize(const Arguments& args) {
+  HandleScope scope;
+
+  Connection *ss = Connection::Unwrap(args);
+
+  int size = args[0]->Int32Value();
+  if (size < 0 || size > SSL3_RT_MAX_PLAIN_LENGTH) {
+    return ThrowException(Exception::RangeError(
+          String::New("Record size must be between 0 and 16384")));
+  }
+
+  if (static_cast<size_t>(size) == ss->coalesce_size_) return Undefined();
+
+  if (ss->coalesce_len_ > 0 && ss->FlushCleartext() != 0) {
+    return ThrowException(Exception::Error(
+          String::New("Buffered cleartext could not be written")));
+  }
+
+  delete[] ss->coalesce_buf_;
+  ss->coalesce_buf_ = size > 0 ? new char[size] : NULL;
+  ss->coalesce_size_ = size;
+
+  return Undefined();
+}
+
+
+Handle<Value> Connection::ClearFlush(const Arguments& args) {
+  HandleScope scope;
+
+  Connection *ss = Connection::Unwrap(args);
+
+  return scope.Close(Integer::New(ss->FlushCleartext()));
+}
+
+
+struct handshake_req {
+  Connection* conn;
+  int rv;
+  char* error;
+  size_t error_len;
+  Persistent<Object> handle;
+  Persistent<Function> callback;
+};
+
+
+// Runs the next server handshake step on the thread pool if it is the one
+// carrying the client's key exchange, i.e. the RSA private key operation.
+// Earlier steps call into JS (SNI, session lookup) and stay on the loop.
+// Returns true if the step was queued; callback() is invoked when done.
+Handle<Value> Connection::HandshakeAsync(const Arguments& args) {
+  HandleScope scope;
+
+  Connection *ss = Connection::Unwrap(args);
+
+  if (args.Length() < 1 || !args[0]->IsFunction()) {
+    return ThrowException(Exception::TypeError(
+          String::New("Callback must be a function")));
+  }
+
+  if (ss->handshake_pending_ || !ss->is_server_ || ss->ssl_ == NULL ||
+      SSL_is_init_finished(ss->ssl_) || BIO_pending(ss->bio_read_) <= 0) {
+    return False();
+  }
+
+  switch (SSL_state(ss->ssl_)) {
+    case SSL3_ST_SR_CERT_A:
+    case SSL3_ST_SR_CERT_B:
+    case SSL3_ST_SR_KEY_EXCH_A:
+    case SSL3_ST_SR_KEY_EXCH_B:
+      break;
+    default:
+      return False();
+  }
+
+  handshake_req* request = new handshake_req;
+  request->conn = ss;
+  request->rv = 0;
+  request->error = NULL;
+  request->error_len = 0;
+  request->handle = Persistent<Object>::New(ss->handle_);
+  request->callback = Persistent<Function>::New(
+      Local<Function>::Cast(args[0]));
+
+  ss->handshake_pending_ = true;
+
+  uv_work_t* req = new uv_work_t();
+  req->data = request;
+  req->work_type = WORK_CRYPTO;
+  uv_queue_work(Isolate::GetCurrentLoop(),
+                req,
+                Connection::HandshakeWork,
+                Connection::AfterHandshake);
+
+  return True();
+}
+
+
+void Connection::HandshakeWork(uv_work_t* work_req) {
+  handshake_req* request = static_cast<handshake_req*>(work_req->data);
+  Connection* ss = request->conn;
+
+  request->rv = SSL_do_handshake(ss->ssl_);
+  if (request->rv > 0) return;
+
+  // OpenSSL's error queue is per thread, so collect it here.
+  int err = SSL_get_error(ss->ssl_, request->rv);
+  if (err != SSL_ERROR_SSL && err != SSL_ERROR_SYSCALL) return;
+
+  BIO* bio = BIO_new(BIO_s_mem());
+  if (bio == NULL) return;
+
+  BUF_MEM* mem;
+  ERR_print_errors(bio);
+  BIO_get_mem_ptr(bio, &mem);
+  request->error = new char[mem->length];
+  request->error_len = mem->length;
+  memcpy(request->error, mem->data, mem->length);
+  BIO_free(bio);
+}
+
+
+void Connection::AfterHandshake(uv_work_t* work_req) {
+  HandleScope scope;
+
+  handshake_req* request = static_cast<handshake_req*>(work_req->data);
+  Connection* ss = request->conn;
+  delete work_req;
+
+  ss->handshake_pending_ = false;
+
+  if (ss->close_pending_) {
+    ss->close_pending_ = false;
+    SSL_free(ss->ssl_);
+    ss->ssl_ = NULL;
+  } else {
+    if (ss->deferred_sess_ != NULL) {
+      ss->EmitNewSession(ss->deferred_sess_);
+      SSL_SESSION_free(ss->deferred_sess_);
+      ss->deferred_sess_ = NULL;
+    }
+
+    if (request->error != NULL) {
+      Local<Value> e = Exception::Error(String::New(request->error,
+                                                    request->error_len));
+      ss->handle_->Set(String::New("error"), e);
+    }
+    ss->SetShutdownFlags();
+  }
+
+  Local<Value> argv[1] = { Integer::New(request->rv) };
+
+  TryCatch try_catch;
+
+  request->callback->Call(request->handle, 1, argv);
+
+  if (try_catch.HasCaught())
+    FatalException(try_catch);
+
+  delete[] request->error;
+  request->handle.Dispose();
+  request->callback.Dispose();
+
+  delete request;
+}
+
+
 #ifdef OPENSSL_NPN_NEGOTIATED
 Handle<Value> Connection::GetNegotiatedProto(const Arguments& args) {
   HandleScope scope;
@@ -1677,6 +2614,40 @@ Handle<Value> Connection::SetSNICallback(const Arguments& args) {
 }
 #endif
 
+static void FreeExternalOutput(char* data, void* hint) {
+  V8::AdjustAmountOfExternalAllocatedMemory(
+      -static_cast<int>(reinterpret_cast<intptr_t>(hint)));
+  delete[] data;
+}
+
+
+// Hands a new[]-allocated result over to a Buffer without copying it.
+static Local<Object> ExternalBuffer(char* data, size_t len) {
+  HandleScope scope;
+  V8::AdjustAmountOfExternalAllocatedMemory(static_cast<int>(len));
+  Buffer* result = Buffer::New(data, len, FreeExternalOutput,
+                               reinterpret_cast<void*>(len));
+  return scope.Close(Local<Object>::New(result->handle_));
+}
+
+
+// Copies a small result, like a digest on the stack, into a new Buffer.
+static Local<Object> CopyBuffer(const void* data, size_t len) {
+  HandleScope scope;
+  Buffer* result = Buffer::New(len);
+  memcpy(Buffer::Data(result), data, len);
+  return scope.Close(Local<Object>::New(result->handle_));
+}
+
+
+// Outputs are returned as a Buffer when the encoding argument is 'buffer'.
+static inline bool IsBufferEncoding(Handle<Value> encoding_v) {
+  if (!encoding_v->IsString()) return false;
+  String::Utf8Value encoding(encoding_v);
+  return strcasecmp(*encoding, "buffer") == 0;
+}
+
+
 static void HexEncode(unsigned char *md_value,
                       int md_len,
                       char** md_hexdigest,
@@ -1858,6 +2829,114 @@ int local_EVP_DecryptFinal_ex(EVP_CIPHER_CTX *ctx,
 }
 
 
+// Runs EVP_CipherUpdate() for Cipher and Decipher on the thread pool.
+// The object is marked busy meanwhile so nothing else touches its context;
+// lib/crypto.js queues further updates until the callback has run.
+struct CipherUpdateReq {
+  EVP_CIPHER_CTX* ctx;
+  bool* busy;
+  unsigned char* data;
+  size_t len;
+  unsigned char* out;
+  int out_len;
+  int ok;
+  Persistent<Object> handle;
+  Persistent<Object> buffer;
+  Persistent<Function> callback;
+
+  static Handle<Value> Start(const Arguments& args,
+                             EVP_CIPHER_CTX* ctx,
+                             bool initialised,
+                             bool* busy) {
+    HandleScope scope;
+
+    if (*busy) {
+      return ThrowException(Exception::Error(String::New(
+          "Asynchronous update in progress")));
+    }
+
+    if (args.Length() < 2 || !Buffer::HasInstance(args[0]) ||
+        !args[1]->IsFunction()) {
+      return ThrowException(Exception::TypeError(String::New(
+          "Takes a buffer and a callback")));
+    }
+
+    if (!initialised) {
+      return ThrowException(Exception::Error(String::New("Not initialized")));
+    }
+
+    Local<Object> buffer = args[0]->ToObject();
+
+    CipherUpdateReq* request = new CipherUpdateReq;
+    request->ctx = ctx;
+    request->busy = busy;
+    request->data = reinterpret_cast<unsigned char*>(Buffer::Data(buffer));
+    request->len = Buffer::Length(buffer);
+    request->out = NULL;
+    request->out_len = 0;
+    request->ok = 0;
+    request->handle = Persistent<Object>::New(args.This());
+    request->buffer = Persistent<Object>::New(buffer);
+    request->callback = Persistent<Function>::New(
+        Local<Function>::Cast(args[1]));
+
+    *busy = true;
+
+    uv_work_t* req = new uv_work_t();
+    req->data = request;
+    req->work_type = WORK_CRYPTO;
+    uv_queue_work(Isolate::GetCurrentLoop(), req, Work, After);
+
+    return Undefined();
+  }
+
+  static void Work(uv_work_t* req) {
+    CipherUpdateReq* request = static_cast<CipherUpdateReq*>(req->data);
+
+    int size = request->len + EVP_CIPHER_CTX_block_size(request->ctx);
+    request->out = new unsigned char[size];
+    request->ok = EVP_CipherUpdate(request->ctx,
+                                   request->out,
+                                   &request->out_len,
+                                   request->data,
+                                   request->len);
+  }
+
+  static void After(uv_work_t* req) {
+    HandleScope scope;
+
+    CipherUpdateReq* request = static_cast<CipherUpdateReq*>(req->data);
+    delete req;
+
+    *request->busy = false;
+
+    Handle<Value> argv[2];
+    if (request->ok) {
+      argv[0] = Null();
+      argv[1] = ExternalBuffer(reinterpret_cast<char*>(request->out),
+                               request->out_len);
+    } else {
+      delete[] request->out;
+      argv[0] = Exception::Error(String::New("EVP_CipherUpdate error"));
+      argv[1] = Undefined();
+    }
+
+    TryCatch try_catch;
+
+    request->callback->Call(request->handle, 2, argv);
+
+    if (try_catch.HasCaught())
+      FatalException(try_catch);
+
+    request->handle.Dispose();
+    request->buffer.Dispose();
+    request->callback.Dispose();
+
+    delete request;
+  }
+};
+
+
 class Cipher : public ObjectWrap {
  public:
   static void Initialize (v8::Handle<v8::Object> target) {
@@ -1870,6 +2949,7 @@ class Cipher : public ObjectWrap {
     NODE_SET_PROTOTYPE_METHOD(t, "init", CipherInit);
     NODE_SET_PROTOTYPE_METHOD(t, "initiv", CipherInitIv);
     NODE_SET_PROTOTYPE_METHOD(t, "update", CipherUpdate);
+    NODE_SET_PROTOTYPE_METHOD(t, "_updateAsync", CipherUpdateAsync);
     NODE_SET_PROTOTYPE_METHOD(t, "final", CipherFinal);
 
     target->Set(String::NewSymbol("Cipher"), t->GetFunction());
@@ -1957,6 +3037,7 @@ class Cipher : public ObjectWrap {
     HandleScope scope;
 
     Cipher *cipher = ObjectWrap::Unwrap<Cipher>(args.This());
+    ASSERT_NOT_BUSY(cipher);
 
     cipher->incomplete_base64=NULL;
 
@@ -1993,6 +3074,7 @@ class Cipher : public ObjectWrap {
 
   static Handle<Value> CipherInitIv(const Arguments& args) {
     Cipher *cipher = ObjectWrap::Unwrap<Cipher>(args.This());
+    ASSERT_NOT_BUSY(cipher);
 
     HandleScope scope;
 
@@ -2043,6 +3125,7 @@ class Cipher : public ObjectWrap {
 
   static Handle<Value> CipherUpdate(const Arguments& args) {
     Cipher *cipher = ObjectWrap::Unwrap<Cipher>(args.This());
+    ASSERT_NOT_BUSY(cipher);
 
     HandleScope scope;
 
@@ -2078,6 +3161,11 @@ class Cipher : public ObjectWrap {
       return ThrowException(exception);
     }
 
+    if (IsBufferEncoding(args[2])) {
+      return scope.Close(ExternalBuffer(reinterpret_cast<char*>(out),
+                                        out_len));
+    }
+
     Local<Value> outString;
     if (out_len==0) {
       outString=String::New("");
@@ -2092,7 +3180,7 @@ class Cipher : public ObjectWrap {
         if (strcasecmp(*encoding, "hex") == 0) {
           // Hex encoding
           HexEncode(out, out_len, &out_hexdigest, &out_hex_len);
-          outString = Encode(out_hexdigest, out_hex_len, BINARY);
+          outString = String::New(out_hexdigest, out_hex_len);
           delete [] out_hexdigest;
         } else if (strcasecmp(*encoding, "base64") == 0) {
           // Base64 encoding
@@ -2122,7 +3210,7 @@ class Cipher : public ObjectWrap {
           }
 
           base64(out, out_len, &out_hexdigest, &out_hex_len);
-          outString = Encode(out_hexdigest, out_hex_len, BINARY);
+          outString = String::New(out_hexdigest, out_hex_len);
           delete [] out_hexdigest;
         } else if (strcasecmp(*encoding, "binary") == 0) {
           outString = Encode(out, out_len, BINARY);
@@ -2138,8 +3226,15 @@ class Cipher : public ObjectWrap {
     return scope.Close(outString);
   }
 
+  static Handle<Value> CipherUpdateAsync(const Arguments& args) {
+    Cipher *cipher = ObjectWrap::Unwrap<Cipher>(args.This());
+    return CipherUpdateReq::Start(args, &cipher->ctx, cipher->initialised_,
+                                  &cipher->busy_);
+  }
+
   static Handle<Value> CipherFinal(const Arguments& args) {
     Cipher *cipher = ObjectWrap::Unwrap<Cipher>(args.This());
+    ASSERT_NOT_BUSY(cipher);
 
     HandleScope scope;
 
@@ -2154,6 +3249,11 @@ class Cipher : public ObjectWrap {
     assert(out_value != NULL);
     assert(out_len != -1);
 
+    if (IsBufferEncoding(args[0])) {
+      return scope.Close(ExternalBuffer(reinterpret_cast<char*>(out_value),
+                                        r == 0 ? 0 : out_len));
+    }
+
     if (out_len == 0 || r == 0) {
       return scope.Close(String::New(""));
     }
@@ -2166,7 +3266,7 @@ class Cipher : public ObjectWrap {
       if (strcasecmp(*encoding, "hex") == 0) {
         // Hex encoding
         HexEncode(out_value, out_len, &out_hexdigest, &out_hex_len);
-        outString = Encode(out_hexdigest, out_hex_len, BINARY);
+        outString = String::New(out_hexdigest, out_hex_len);
         delete [] out_hexdigest;
       } else if (strcasecmp(*encoding, "base64") == 0) {
         // Check to see if we need to add in previous base64 overhang
@@ -2183,7 +3283,7 @@ class Cipher : public ObjectWrap {
           out_len += cipher->incomplete_base64_len;
         }
         base64(out_value, out_len, &out_hexdigest, &out_hex_len);
-        outString = Encode(out_hexdigest, out_hex_len, BINARY);
+        outString = String::New(out_hexdigest, out_hex_len);
         delete [] out_hexdigest;
       } else if (strcasecmp(*encoding, "binary") == 0) {
         outString = Encode(out_value, out_len, BINARY);
@@ -2199,6 +3299,7 @@ class Cipher : public ObjectWrap {
   Cipher () : ObjectWrap ()
   {
     initialised_ = false;
+    busy_ = false;
   }
 
   ~Cipher () {
@@ -2212,6 +3313,7 @@ class Cipher : public ObjectWrap {
   EVP_CIPHER_CTX ctx; /* coverity[member_decl] */
   const EVP_CIPHER *cipher; /* coverity[member_decl] */
   bool initialised_;
+  bool busy_;
   char* incomplete_base64; /* coverity[member_decl] */
   int incomplete_base64_len; /* coverity[member_decl] */
 
@@ -2233,6 +3335,7 @@ class Decipher : public ObjectWrap {
     NODE_SET_PROTOTYPE_METHOD(t, "init", DecipherInit);
     NODE_SET_PROTOTYPE_METHOD(t, "initiv", DecipherInitIv);
     NODE_SET_PROTOTYPE_METHOD(t, "update", DecipherUpdate);
+    NODE_SET_PROTOTYPE_METHOD(t, "_updateAsync", DecipherUpdateAsync);
     NODE_SET_PROTOTYPE_METHOD(t, "final", DecipherFinal);
     NODE_SET_PROTOTYPE_METHOD(t, "finaltol", DecipherFinalTolerate);
 
@@ -2338,6 +3441,7 @@ class Decipher : public ObjectWrap {
 
   static Handle<Value> DecipherInit(const Arguments& args) {
     Decipher *cipher = ObjectWrap::Unwrap<Decipher>(args.This());
+    ASSERT_NOT_BUSY(cipher);
 
     HandleScope scope;
 
@@ -2376,6 +3480,7 @@ class Decipher : public ObjectWrap {
 
   static Handle<Value> DecipherInitIv(const Arguments& args) {
     Decipher *cipher = ObjectWrap::Unwrap<Decipher>(args.This());
+    ASSERT_NOT_BUSY(cipher);
 
     HandleScope scope;
 
@@ -2429,6 +3534,7 @@ class Decipher : public ObjectWrap {
     HandleScope scope;
 
     Decipher *cipher = ObjectWrap::Unwrap<Decipher>(args.This());
+    ASSERT_NOT_BUSY(cipher);
 
     ASSERT_IS_STRING_OR_BUFFER(args[0]);
 
@@ -2520,6 +3626,12 @@ class Decipher : public ObjectWrap {
       return ThrowException(exception);
     }
 
+    if (IsBufferEncoding(args[2])) {
+      if (alloc_buf) delete [] buf;
+      return scope.Close(ExternalBuffer(reinterpret_cast<char*>(out),
+                                        out_len));
+    }
+
     Local<Value> outString;
     if (out_len==0) {
       outString=String::New("");
@@ -2561,10 +3673,17 @@ class Decipher : public ObjectWrap {
 
   }
 
+  static Handle<Value> DecipherUpdateAsync(const Arguments& args) {
+    Decipher *cipher = ObjectWrap::Unwrap<Decipher>(args.This());
+    return CipherUpdateReq::Start(args, &cipher->ctx, cipher->initialised_,
+                                  &cipher->busy_);
+  }
+
   static Handle<Value> DecipherFinal(const Arguments& args) {
     HandleScope scope;
 
     Decipher *cipher = ObjectWrap::Unwrap<Decipher>(args.This());
+    ASSERT_NOT_BUSY(cipher);
 
     unsigned char* out_value = NULL;
     int out_len = -1;
@@ -2575,6 +3694,11 @@ class Decipher : public ObjectWrap {
     assert(out_value != NULL);
     assert(out_len != -1);
 
+    if (IsBufferEncoding(args[0])) {
+      return scope.Close(ExternalBuffer(reinterpret_cast<char*>(out_value),
+                                        r == 0 ? 0 : out_len));
+    }
+
     if (out_len == 0 || r == 0) {
       return scope.Close(String::New(""));
     }
@@ -2609,6 +3733,7 @@ class Decipher : public ObjectWrap {
 
   static Handle<Value> DecipherFinalTolerate(const Arguments& args) {
     Decipher *cipher = ObjectWrap::Unwrap<Decipher>(args.This());
+    ASSERT_NOT_BUSY(cipher);
 
     HandleScope scope;
 
@@ -2619,6 +3744,11 @@ class Decipher : public ObjectWrap {
     out_value = NULL;
     int r = cipher->DecipherFinal(&out_value, &out_len, true);
 
+    if (IsBufferEncoding(args[0])) {
+      return scope.Close(ExternalBuffer(reinterpret_cast<char*>(out_value),
+                                        r == 0 ? 0 : out_len));
+    }
+
     if (out_len == 0 || r == 0) {
       delete [] out_value;
       return scope.Close(String::New(""));
@@ -2654,6 +3784,7 @@ class Decipher : public ObjectWrap {
 
   Decipher () : ObjectWrap () {
     initialised_ = false;
+    busy_ = false;
   }
 
   ~Decipher () {
@@ -2667,6 +3798,7 @@ class Decipher : public ObjectWrap {
   EVP_CIPHER_CTX ctx;
   const EVP_CIPHER *cipher_;
   bool initialised_;
+  bool busy_;
   unsigned char* incomplete_utf8;
   int incomplete_utf8_len;
   char incomplete_hex;
@@ -2830,6 +3962,11 @@ class Hmac : public ObjectWrap {
     assert(md_value != NULL);
     assert(md_len != -1);
 
+    if (IsBufferEncoding(args[0])) {
+      return scope.Close(ExternalBuffer(reinterpret_cast<char*>(md_value),
+                                        r == 0 ? 0 : md_len));
+    }
+
     if (md_len == 0 || r == 0) {
       return scope.Close(String::New(""));
     }
@@ -2842,11 +3979,11 @@ class Hmac : public ObjectWrap {
       if (strcasecmp(*encoding, "hex") == 0) {
         // Hex encoding
         HexEncode(md_value, md_len, &md_hexdigest, &md_hex_len);
-        outString = Encode(md_hexdigest, md_hex_len, BINARY);
+        outString = String::New(md_hexdigest, md_hex_len);
         delete [] md_hexdigest;
       } else if (strcasecmp(*encoding, "base64") == 0) {
         base64(md_value, md_len, &md_hexdigest, &md_hex_len);
-        outString = Encode(md_hexdigest, md_hex_len, BINARY);
+        outString = String::New(md_hexdigest, md_hex_len);
         delete [] md_hexdigest;
       } else if (strcasecmp(*encoding, "binary") == 0) {
         outString = Encode(md_value, md_len, BINARY);
@@ -2984,6 +4121,10 @@ class Hash : public ObjectWrap {
     EVP_MD_CTX_cleanup(&hash->mdctx);
     hash->initialised_ = false;
 
+    if (IsBufferEncoding(args[0])) {
+      return scope.Close(CopyBuffer(md_value, md_len));
+    }
+
     if (md_len == 0) {
       return scope.Close(String::New(""));
     }
@@ -3000,13 +4141,13 @@ class Hash : public ObjectWrap {
         char* md_hexdigest;
         int md_hex_len;
         HexEncode(md_value, md_len, &md_hexdigest, &md_hex_len);
-        outString = Encode(md_hexdigest, md_hex_len, BINARY);
+        outString = String::New(md_hexdigest, md_hex_len);
         delete [] md_hexdigest;
       } else if (strcasecmp(*encoding, "base64") == 0) {
         char* md_hexdigest;
         int md_hex_len;
         base64(md_value, md_len, &md_hexdigest, &md_hex_len);
-        outString = Encode(md_hexdigest, md_hex_len, BINARY);
+        outString = String::New(md_hexdigest, md_hex_len);
         delete [] md_hexdigest;
       } else if (strcasecmp(*encoding, "binary") == 0) {
         outString = Encode(md_value, md_len, BINARY);
@@ -3036,6 +4177,86 @@ class Hash : public ObjectWrap {
   bool initialised_;
 };
 
+// Keys that sign() and verify() parsed from PEM, so that signing many tokens
+// with one key reads it once. Shared by all isolates and the thread pool;
+// Get() returns a reference that the caller frees. When full, the oldest
+// key goes.
+#define KEY_CACHE_SIZE 32
+
+class KeyCache {
+ public:
+  KeyCache() {
+    uv_mutex_init(&mutex_);
+  }
+
+  // is_private: a private key, else a public key or an X.509 certificate.
+  EVP_PKEY* Get(bool is_private, const char* pem, int len) {
+    std::string key(is_private ? "S" : "V");
+    key.append(pem, len);
+
+    uv_mutex_lock(&mutex_);
+    std::map<std::string, EVP_PKEY*>::iterator it = keys_.find(key);
+    if (it != keys_.end()) {
+      EVP_PKEY* pkey = it->second;
+      CRYPTO_add(&pkey->references, 1, CRYPTO_LOCK_EVP_PKEY);
+      uv_mutex_unlock(&mutex_);
+      return pkey;
+    }
+    uv_mutex_unlock(&mutex_);
+
+    EVP_PKEY* pkey = Parse(is_private, pem, len);
+    if (pkey == NULL) return NULL;
+
+    uv_mutex_lock(&mutex_);
+    if (keys_.find(key) == keys_.end()) {
+      if (order_.size() >= KEY_CACHE_SIZE) {
+        it = keys_.find(order_.front());
+        EVP_PKEY_free(it->second);
+        keys_.erase(it);
+        order_.erase(order_.begin());
+      }
+      CRYPTO_add(&pkey->references, 1, CRYPTO_LOCK_EVP_PKEY);
+      keys_[key] = pkey;
+      order_.push_back(key);
+    }
+    uv_mutex_unlock(&mutex_);
+
+    return pkey;
+  }
+
+ private:
+  static EVP_PKEY* Parse(bool is_private, const char* pem, int len) {
+    BIO* bp = BIO_new_mem_buf(const_cast<char*>(pem), len);
+    if (bp == NULL) return NULL;
+
+    EVP_PKEY* pkey = NULL;
+    if (is_private) {
+      pkey = PEM_read_bio_PrivateKey(bp, NULL, NULL, NULL);
+    } else if (len >= PUBLIC_KEY_PFX_LEN &&
+               strncmp(pem, PUBLIC_KEY_PFX, PUBLIC_KEY_PFX_LEN) == 0) {
+      // A PKCS#8 public key
+      pkey = PEM_read_bio_PUBKEY(bp, NULL, NULL, NULL);
+    } else {
+      // X.509 fallback
+      X509* x509 = PEM_read_bio_X509(bp, NULL, NULL, NULL);
+      if (x509 != NULL) {
+        pkey = X509_get_pubkey(x509);
+        X509_free(x509);
+      }
+    }
+
+    BIO_free(bp);
+    return pkey;
+  }
+
+  uv_mutex_t mutex_;
+  std::map<std::string, EVP_PKEY*> keys_;
+  std::vector<std::string> order_;
+};
+
+static KeyCache* key_cache;
+
+
 class Sign : public ObjectWrap {
  public:
   static void
@@ -3072,26 +4293,21 @@ class Sign : public ObjectWrap {
     return 1;
   }
 
+  // Also called on the thread pool, see sign_req.
   int SignFinal(unsigned char** md_value,
                 unsigned int *md_len,
                 char* key_pem,
                 int key_pemLen) {
     if (!initialised_) return 0;
 
-    BIO *bp = NULL;
-    EVP_PKEY* pkey;
-    bp = BIO_new(BIO_s_mem());
-    if(!BIO_write(bp, key_pem, key_pemLen)) return 0;
-
-    pkey = PEM_read_bio_PrivateKey( bp, NULL, NULL, NULL );
+    EVP_PKEY* pkey = key_cache->Get(true, key_pem, key_pemLen);
     if (pkey == NULL) return 0;
 
-    EVP_SignFinal(&mdctx, *md_value, md_len, pkey);
+    int r = EVP_SignFinal(&mdctx, *md_value, md_len, pkey);
     EVP_MD_CTX_cleanup(&mdctx);
     initialised_ = false;
     EVP_PKEY_free(pkey);
-    BIO_free(bp);
-    return 1;
+    return r == 1;
   }
 
 
@@ -3106,11 +4322,18 @@ class Sign : public ObjectWrap {
     return args.This();
   }
 
+  static Handle<Value> ThrowPending() {
+    return ThrowException(Exception::Error(
+          String::New("Signing in progress")));
+  }
+
   static Handle<Value> SignInit(const Arguments& args) {
     HandleScope scope;
 
     Sign *sign = ObjectWrap::Unwrap<Sign>(args.This());
 
+    if (sign->pending_) return ThrowPending();
+
     if (args.Length() == 0 || !args[0]->IsString()) {
       return ThrowException(Exception::Error(String::New(
         "Must give signtype string as argument")));
@@ -3132,6 +4355,8 @@ class Sign : public ObjectWrap {
 
     HandleScope scope;
 
+    if (sign->pending_) return ThrowPending();
+
     ASSERT_IS_STRING_OR_BUFFER(args[0]);
     enum encoding enc = ParseEncoding(args[1]);
     ssize_t len = DecodeBytes(args[0], enc);
@@ -3165,57 +4390,163 @@ class Sign : public ObjectWrap {
     return args.This();
   }
 
+  struct sign_req {
+    Sign* sign;
+    std::string key;
+    unsigned char* md_value;
+    unsigned int md_len;
+    int r;
+    Persistent<Value> encoding;
+    Persistent<Function> callback;
+  };
+
+  // sign(key, [encoding], [callback]). With a callback the private key
+  // operation runs on the thread pool and the signature, or an error, is
+  // passed to callback(err, signature).
   static Handle<Value> SignFinal(const Arguments& args) {
     Sign *sign = ObjectWrap::Unwrap<Sign>(args.This());
 
     HandleScope scope;
 
+    if (sign->pending_) return ThrowPending();
+
     unsigned char* md_value;
     unsigned int md_len;
-    char* md_hexdigest;
-    int md_hex_len;
-    Local<Value> outString;
-
-    md_len = 8192; // Maximum key size is 8192 bits
-    md_value = new unsigned char[md_len];
 
     ASSERT_IS_STRING_OR_BUFFER(args[0]);
     ssize_t len = DecodeBytes(args[0], BINARY);
 
     if (len < 0) {
-      delete [] md_value;
       Local<Value> exception = Exception::TypeError(String::New("Bad argument"));
       return ThrowException(exception);
     }
 
-    char* buf = new char[len];
-    ssize_t written = DecodeWrite(buf, len, args[0], BINARY);
-    assert(written == len);
+    md_len = 8192; // Maximum key size is 8192 bits
+    md_value = new unsigned char[md_len];
+
+    if (args.Length() > 1 && args[args.Length() - 1]->IsFunction()) {
+      sign_req* req = new sign_req;
+      req->sign = sign;
+      if (Buffer::HasInstance(args[0])) {
+        Local<Object> key_obj = args[0]->ToObject();
+        req->key.assign(Buffer::Data(key_obj), Buffer::Length(key_obj));
+      } else {
+        req->key.resize(len);
+        ssize_t written = DecodeWrite(&req->key[0], len, args[0], BINARY);
+        assert(written == len);
+      }
+      req->md_value = md_value;
+      req->md_len = md_len;
+      req->r = 0;
+      req->encoding = Persistent<Value>::New(
+          args.Length() > 2 ? args[1] : Local<Value>::New(Undefined()));
+      req->callback = Persistent<Function>::New(
+          Local<Function>::Cast(args[args.Length() - 1]));
+
+      sign->pending_ = true;
+      sign->Ref();
 
-    int r = sign->SignFinal(&md_value, &md_len, buf, len);
+      uv_work_t* work_req = new uv_work_t();
+      work_req->data = req;
+      work_req->work_type = WORK_CRYPTO;
+      uv_queue_work(Isolate::GetCurrentLoop(),
+                    work_req,
+                    SignWork,
+                    AfterSign);
 
-    delete [] buf;
+      return Undefined();
+    }
+
+    int r;
+    if (Buffer::HasInstance(args[0])) {
+      Local<Object> key_obj = args[0]->ToObject();
+      r = sign->SignFinal(&md_value, &md_len, Buffer::Data(key_obj),
+                          Buffer::Length(key_obj));
+    } else {
+      char* buf = new char[len];
+      ssize_t written = DecodeWrite(buf, len, args[0], BINARY);
+      assert(written == len);
+      r = sign->SignFinal(&md_value, &md_len, buf, len);
+      delete [] buf;
+    }
+
+    return scope.Close(EncodeSignature(md_value, md_len, r, args[1]));
+  }
+
+  static void SignWork(uv_work_t* work_req) {
+    sign_req* req = static_cast<sign_req*>(work_req->data);
+    req->r = req->sign->SignFinal(&req->md_value, &req->md_len,
+                                  &req->key[0], req->key.size());
+  }
+
+  static void AfterSign(uv_work_t* work_req) {
+    HandleScope scope;
+    sign_req* req = static_cast<sign_req*>(work_req->data);
+    delete work_req;
+
+    Sign* sign = req->sign;
+    sign->pending_ = false;
+
+    Handle<Value> argv[2];
+    if (req->r) {
+      argv[0] = Null();
+      argv[1] = EncodeSignature(req->md_value, req->md_len, req->r,
+                                req->encoding);
+    } else {
+      delete [] req->md_value;
+      argv[0] = Exception::Error(String::New("SignFinal error"));
+      argv[1] = Undefined();
+    }
+
+    TryCatch try_catch;
+
+    req->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+
+    if (try_catch.HasCaught())
+      FatalException(try_catch);
+
+    req->encoding.Dispose();
+    req->callback.Dispose();
+    delete req;
+    sign->Unref();
+  }
+
+  // Returns the signature as sign() does: a Buffer, or a string in the
+  // encoding given, or "" if signing failed. Takes md_value.
+  static Local<Value> EncodeSignature(unsigned char* md_value,
+                                      unsigned int md_len,
+                                      int r,
+                                      Handle<Value> encoding) {
+    HandleScope scope;
+    char* md_hexdigest;
+    int md_hex_len;
+    Local<Value> outString;
+
+    if (IsBufferEncoding(encoding)) {
+      return scope.Close(ExternalBuffer(reinterpret_cast<char*>(md_value),
+                                        r == 0 ? 0 : md_len));
+    }
 
     if (md_len == 0 || r == 0) {
       delete [] md_value;
       return scope.Close(String::New(""));
     }
 
-    if (args.Length() == 1 || !args[1]->IsString()) {
+    if (!encoding->IsString()) {
       // Binary
       outString = Encode(md_value, md_len, BINARY);
     } else {
-      String::Utf8Value encoding(args[1]->ToString());
-      if (strcasecmp(*encoding, "hex") == 0) {
+      String::Utf8Value enc(encoding->ToString());
+      if (strcasecmp(*enc, "hex") == 0) {
         // Hex encoding
         HexEncode(md_value, md_len, &md_hexdigest, &md_hex_len);
-        outString = Encode(md_hexdigest, md_hex_len, BINARY);
+        outString = String::New(md_hexdigest, md_hex_len);
         delete [] md_hexdigest;
-      } else if (strcasecmp(*encoding, "base64") == 0) {
+      } else if (strcasecmp(*enc, "base64") == 0) {
         base64(md_value, md_len, &md_hexdigest, &md_hex_len);
-        outString = Encode(md_hexdigest, md_hex_len, BINARY);
+        outString = String::New(md_hexdigest, md_hex_len);
         delete [] md_hexdigest;
-      } else if (strcasecmp(*encoding, "binary") == 0) {
+      } else if (strcasecmp(*enc, "binary") == 0) {
         outString = Encode(md_value, md_len, BINARY);
       } else {
         outString = String::New("");
@@ -3230,6 +4561,7 @@ class Sign : public ObjectWrap {
 
   Sign () : ObjectWrap () {
     initialised_ = false;
+    pending_ = false;
   }
 
   ~Sign () {
@@ -3243,6 +4575,8 @@ class Sign : public ObjectWrap {
   EVP_MD_CTX mdctx; /* coverity[member_decl] */
   const EVP_MD *md; /* coverity[member_decl] */
   bool initialised_;
+  // an asynchronous sign() owns mdctx
+  bool pending_;
 };
 
 class Verify : public ObjectWrap {
@@ -3282,54 +4616,21 @@ class Verify : public ObjectWrap {
   }
 
 
-  int VerifyFinal(char* key_pem, int key_pemLen, unsigned char* sig, int siglen) {
+  // Also called on the thread pool, see verify_req.
+  int VerifyFinal(const char* key_pem, int key_pemLen,
+                  const unsigned char* sig, int siglen) {
     if (!initialised_) return 0;
 
-    EVP_PKEY* pkey = NULL;
-    BIO *bp = NULL;
-    X509 *x509 = NULL;
-    int r = 0;
-
-    bp = BIO_new(BIO_s_mem());
-    if (bp == NULL) {
+    EVP_PKEY* pkey = key_cache->Get(false, key_pem, key_pemLen);
+    if (pkey == NULL) {
       ERR_print_errors_fp(stderr);
       return 0;
     }
-    if(!BIO_write(bp, key_pem, key_pemLen)) {
-      ERR_print_errors_fp(stderr);
-      return 0;
-    }
-
-    // Check if this is a PKCS#8 public key before trying as X.509
-    if (strncmp(key_pem, PUBLIC_KEY_PFX, PUBLIC_KEY_PFX_LEN) == 0) {
-      pkey = PEM_read_bio_PUBKEY(bp, NULL, NULL, NULL);
-      if (pkey == NULL) {
-        ERR_print_errors_fp(stderr);
-        return 0;
-      }
-    } else {
-      // X.509 fallback
-      x509 = PEM_read_bio_X509(bp, NULL, NULL, NULL);
-      if (x509 == NULL) {
-        ERR_print_errors_fp(stderr);
-        return 0;
-      }
-
-      pkey = X509_get_pubkey(x509);
-      if (pkey == NULL) {
-        ERR_print_errors_fp(stderr);
-        return 0;
-      }
-    }
 
-    r = EVP_VerifyFinal(&mdctx, sig, siglen, pkey);
+    int r = EVP_VerifyFinal(&mdctx, const_cast<unsigned char*>(sig), siglen,
+                            pkey);
 
-    if(pkey != NULL)
-      EVP_PKEY_free (pkey);
-    if (x509 != NULL)
-      X509_free(x509);
-    if (bp != NULL)
-      BIO_free(bp);
+    EVP_PKEY_free (pkey);
     EVP_MD_CTX_cleanup(&mdctx);
     initialised_ = false;
 
@@ -3348,12 +4649,19 @@ class Verify : public ObjectWrap {
     return args.This();
   }
 
+  static Handle<Value> ThrowPending() {
+    return ThrowException(Exception::Error(
+          String::New("Verification in progress")));
+  }
+
 
   static Handle<Value> VerifyInit(const Arguments& args) {
     Verify *verify = ObjectWrap::Unwrap<Verify>(args.This());
 
     HandleScope scope;
 
+    if (verify->pending_) return ThrowPending();
+
     if (args.Length() == 0 || !args[0]->IsString()) {
       return ThrowException(Exception::Error(String::New(
         "Must give verifytype string as argument")));
@@ -3376,6 +4684,8 @@ class Verify : public ObjectWrap {
 
     Verify *verify = ObjectWrap::Unwrap<Verify>(args.This());
 
+    if (verify->pending_) return ThrowPending();
+
     ASSERT_IS_STRING_OR_BUFFER(args[0]);
     enum encoding enc = ParseEncoding(args[1]);
     ssize_t len = DecodeBytes(args[0], enc);
@@ -3410,11 +4720,25 @@ class Verify : public ObjectWrap {
   }
 
 
+  struct verify_req {
+    Verify* verify;
+    std::string key;
+    std::string sig;
+    bool known_format;
+    int r;
+    Persistent<Function> callback;
+  };
+
+  // verify(key, signature, [format], [callback]). With a callback the
+  // public key operation runs on the thread pool and the result is passed
+  // to callback(null, valid).
   static Handle<Value> VerifyFinal(const Arguments& args) {
     HandleScope scope;
 
     Verify *verify = ObjectWrap::Unwrap<Verify>(args.This());
 
+    if (verify->pending_) return ThrowPending();
+
     ASSERT_IS_STRING_OR_BUFFER(args[0]);
     ssize_t klen = DecodeBytes(args[0], BINARY);
 
@@ -3423,58 +4747,132 @@ class Verify : public ObjectWrap {
       return ThrowException(exception);
     }
 
-    char* kbuf = new char[klen];
-    ssize_t kwritten = DecodeWrite(kbuf, klen, args[0], BINARY);
-    assert(kwritten == klen);
-
     ASSERT_IS_STRING_OR_BUFFER(args[1]);
     ssize_t hlen = DecodeBytes(args[1], BINARY);
 
     if (hlen < 0) {
-      delete [] kbuf;
       Local<Value> exception = Exception::TypeError(String::New("Bad argument"));
       return ThrowException(exception);
     }
 
-    unsigned char* hbuf = new unsigned char[hlen];
-    ssize_t hwritten = DecodeWrite((char *)hbuf, hlen, args[1], BINARY);
-    assert(hwritten == hlen);
-    unsigned char* dbuf;
-    int dlen;
-
-    int r=-1;
+    // Buffers are read in place, strings are decoded into a copy.
+    char* kbuf;
+    bool kbuf_alloc = !Buffer::HasInstance(args[0]);
+    if (kbuf_alloc) {
+      kbuf = new char[klen];
+      ssize_t kwritten = DecodeWrite(kbuf, klen, args[0], BINARY);
+      assert(kwritten == klen);
+    } else {
+      kbuf = Buffer::Data(args[0]->ToObject());
+      klen = Buffer::Length(args[0]->ToObject());
+    }
 
-    if (args.Length() == 2 || !args[2]->IsString()) {
-      // Binary
-      r = verify->VerifyFinal(kbuf, klen, hbuf, hlen);
+    unsigned char* hbuf;
+    bool hbuf_alloc = !Buffer::HasInstance(args[1]);
+    if (hbuf_alloc) {
+      hbuf = new unsigned char[hlen];
+      ssize_t hwritten = DecodeWrite((char *)hbuf, hlen, args[1], BINARY);
+      assert(hwritten == hlen);
     } else {
+      hbuf = reinterpret_cast<unsigned char*>(Buffer::Data(args[1]->ToObject()));
+      hlen = Buffer::Length(args[1]->ToObject());
+    }
+
+    // The signature as bytes, decoded from its format into dbuf if need be.
+    unsigned char* sig = hbuf;
+    int siglen = hlen;
+    unsigned char* dbuf = NULL;
+    int dlen;
+    bool known_format = true;
+
+    if (args.Length() > 2 && args[2]->IsString()) {
       String::Utf8Value encoding(args[2]->ToString());
       if (strcasecmp(*encoding, "hex") == 0) {
         // Hex encoding
         HexDecode(hbuf, hlen, (char **)&dbuf, &dlen);
-        r = verify->VerifyFinal(kbuf, klen, dbuf, dlen);
-        delete [] dbuf;
+        sig = dbuf;
+        siglen = dlen;
       } else if (strcasecmp(*encoding, "base64") == 0) {
         // Base64 encoding
         unbase64(hbuf, hlen, (char **)&dbuf, &dlen);
-        r = verify->VerifyFinal(kbuf, klen, dbuf, dlen);
-        delete [] dbuf;
-      } else if (strcasecmp(*encoding, "binary") == 0) {
-        r = verify->VerifyFinal(kbuf, klen, hbuf, hlen);
-      } else {
+        sig = dbuf;
+        siglen = dlen;
+      } else if (strcasecmp(*encoding, "binary") != 0) {
         fprintf(stderr, "node-crypto : Verify .verify encoding "
                         "can be binary, hex or base64\n");
+        known_format = false;
       }
     }
 
-    delete [] kbuf;
-    delete [] hbuf;
+    Local<Value> result;
+
+    if (args.Length() > 2 && args[args.Length() - 1]->IsFunction()) {
+      verify_req* req = new verify_req;
+      req->verify = verify;
+      req->key.assign(kbuf, klen);
+      req->sig.assign(reinterpret_cast<char*>(sig), siglen);
+      req->known_format = known_format;
+      req->r = 0;
+      req->callback = Persistent<Function>::New(
+          Local<Function>::Cast(args[args.Length() - 1]));
+
+      verify->pending_ = true;
+      verify->Ref();
+
+      uv_work_t* work_req = new uv_work_t();
+      work_req->data = req;
+      work_req->work_type = WORK_CRYPTO;
+      uv_queue_work(Isolate::GetCurrentLoop(),
+                    work_req,
+                    VerifyWork,
+                    AfterVerify);
+      result = Local<Value>::New(Undefined());
+    } else {
+      int r = known_format ? verify->VerifyFinal(kbuf, klen, sig, siglen) : -1;
+      result = Local<Value>::New(Boolean::New(r && r != -1));
+    }
+
+    delete [] dbuf;
+    if (kbuf_alloc) delete [] kbuf;
+    if (hbuf_alloc) delete [] hbuf;
+
+    return scope.Close(result);
+  }
+
+  static void VerifyWork(uv_work_t* work_req) {
+    verify_req* req = static_cast<verify_req*>(work_req->data);
+    if (!req->known_format) return;
+    req->r = req->verify->VerifyFinal(
+        req->key.data(), req->key.size(),
+        reinterpret_cast<const unsigned char*>(req->sig.data()),
+        req->sig.size());
+  }
+
+  static void AfterVerify(uv_work_t* work_req) {
+    HandleScope scope;
+    verify_req* req = static_cast<verify_req*>(work_req->data);
+    delete work_req;
+
+    Verify* verify = req->verify;
+    verify->pending_ = false;
+
+    Handle<Value> argv[2] = { Null(), Boolean::New(req->r == 1) };
+
+    TryCatch try_catch;
+
+    req->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+
+    if (try_catch.HasCaught())
+      FatalException(try_catch);
 
-    return Boolean::New(r && r != -1);
+    req->callback.Dispose();
+    delete req;
+    verify->Unref();
   }
 
   Verify () : ObjectWrap () {
     initialised_ = false;
+    pending_ = false;
   }
 
   ~Verify () {
@@ -3488,6 +4886,8 @@ class Verify : public ObjectWrap {
   EVP_MD_CTX mdctx; /* coverity[member_decl] */
   const EVP_MD *md; /* coverity[member_decl] */
   bool initialised_;
+  // an asynchronous verify() owns mdctx
+  bool pending_;
 
 };
 
@@ -3509,14 +4909,18 @@ class DiffieHellman : public ObjectWrap {
     NODE_SET_PROTOTYPE_METHOD(t, "setPublicKey", SetPublicKey);
     NODE_SET_PROTOTYPE_METHOD(t, "setPrivateKey", SetPrivateKey);
 
+    CryptoStatics *statics = NODE_STATICS_GET(node_crypto, CryptoStatics);
+    statics->diffie_hellman_constructor =
+        Persistent<Function>::New(t->GetFunction());
+
     target->Set(String::NewSymbol("DiffieHellman"), t->GetFunction());
+    NODE_SET_METHOD(target, "diffieHellmanGroup", GetGroup);
+    NODE_SET_METHOD(target, "generateDiffieHellman", GenerateAsync);
   }
 
   bool Init(int primeLength) {
-    dh = DH_new();
-    DH_generate_parameters_ex(dh, primeLength, DH_GENERATOR_2, 0);
-    bool result = VerifyContext();
-    if (!result) return false;
+    dh = Generate(primeLength);
+    if (dh == NULL) return false;
     initialised_ = true;
     return true;
   }
@@ -3540,7 +4944,13 @@ class DiffieHellman : public ObjectWrap {
     bool initialized = false;
 
     if (args.Length() > 0) {
-      if (args[0]->IsInt32()) {
+      if (args[0]->IsExternal()) {
+        // From GetGroup() or GenerateAsync(), which checked the parameters
+        diffieHellman->dh =
+            static_cast<DH*>(Handle<External>::Cast(args[0])->Value());
+        diffieHellman->initialised_ = true;
+        initialized = true;
+      } else if (args[0]->IsInt32()) {
         diffieHellman->Init(args[0]->Int32Value());
         initialized = true;
       } else {
@@ -3593,20 +5003,96 @@ class DiffieHellman : public ObjectWrap {
             String::New("Not initialized")));
     }
 
+    if (diffieHellman->keygen_pending_) {
+      return ThrowException(Exception::Error(
+            String::New("Key generation in progress")));
+    }
+
+    // generateKeys([encoding], callback) works on the thread pool
+    if (args.Length() > 0 && args[args.Length() - 1]->IsFunction()) {
+      Local<Function> callback =
+          Local<Function>::Cast(args[args.Length() - 1]);
+      dh_keys_req* req = new dh_keys_req;
+      req->dh = diffieHellman;
+      req->ok = false;
+      req->encoding = Persistent<Value>::New(
+          args.Length() > 1 ? args[0] : Local<Value>::New(Undefined()));
+      req->callback = Persistent<Function>::New(callback);
+
+      diffieHellman->keygen_pending_ = true;
+      diffieHellman->Ref();
+
+      uv_work_t* work_req = new uv_work_t();
+      work_req->data = req;
+      work_req->work_type = WORK_CRYPTO;
+      uv_queue_work(Isolate::GetCurrentLoop(),
+                    work_req,
+                    GenerateKeysWork,
+                    AfterGenerateKeys);
+
+      return Undefined();
+    }
+
     if (!DH_generate_key(diffieHellman->dh)) {
       return ThrowException(Exception::Error(
             String::New("Key generation failed")));
     }
 
-    Local<Value> outString;
+    return scope.Close(diffieHellman->EncodePublicKey(args[0]));
+  }
 
-    int dataSize = BN_num_bytes(diffieHellman->dh->pub_key);
+  struct dh_keys_req {
+    DiffieHellman* dh;
+    bool ok;
+    Persistent<Value> encoding;
+    Persistent<Function> callback;
+  };
+
+  static void GenerateKeysWork(uv_work_t* work_req) {
+    dh_keys_req* req = static_cast<dh_keys_req*>(work_req->data);
+    req->ok = DH_generate_key(req->dh->dh) != 0;
+  }
+
+  static void AfterGenerateKeys(uv_work_t* work_req) {
+    HandleScope scope;
+    dh_keys_req* req = static_cast<dh_keys_req*>(work_req->data);
+    delete work_req;
+
+    DiffieHellman* diffieHellman = req->dh;
+    diffieHellman->keygen_pending_ = false;
+
+    Handle<Value> argv[2];
+    if (req->ok) {
+      argv[0] = Null();
+      argv[1] = diffieHellman->EncodePublicKey(req->encoding);
+    } else {
+      argv[0] = Exception::Error(String::New("Key generation failed"));
+      argv[1] = Undefined();
+    }
+
+    TryCatch try_catch;
+
+    req->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+
+    if (try_catch.HasCaught())
+      FatalException(try_catch);
+
+    req->encoding.Dispose();
+    req->callback.Dispose();
+    delete req;
+    diffieHellman->Unref();
+  }
+
+  Local<Value> EncodePublicKey(Handle<Value> encoding) {
+    HandleScope scope;
+
+    int dataSize = BN_num_bytes(dh->pub_key);
     char* data = new char[dataSize];
-    BN_bn2bin(diffieHellman->dh->pub_key,
-        reinterpret_cast<unsigned char*>(data));
+    BN_bn2bin(dh->pub_key, reinterpret_cast<unsigned char*>(data));
 
-    if (args.Length() > 0 && args[0]->IsString()) {
-      outString = EncodeWithEncoding(args[0], data, dataSize);
+    Local<Value> outString;
+    if (encoding->IsString()) {
+      outString = EncodeWithEncoding(encoding, data, dataSize);
     } else {
       outString = Encode(data, dataSize, BINARY);
     }
@@ -3615,6 +5101,104 @@ class DiffieHellman : public ObjectWrap {
     return scope.Close(outString);
   }
 
+  // diffieHellmanGroup(name) makes a DiffieHellman of one of the MODP
+  // groups, whose primes need neither generating nor checking.
+  static Handle<Value> GetGroup(const Arguments& args) {
+    HandleScope scope;
+    CryptoStatics *statics = NODE_STATICS_GET(node_crypto, CryptoStatics);
+
+    String::Utf8Value name(args[0]->ToString());
+    const ModpGroup* group = NULL;
+    for (size_t i = 0; i < ARRAY_SIZE(modp_groups); i++) {
+      if (strcmp(*name, modp_groups[i].name) == 0) {
+        group = &modp_groups[i];
+        break;
+      }
+    }
+
+    if (group == NULL) {
+      return ThrowException(Exception::Error(
+            String::New("Unknown group")));
+    }
+
+    DH* dh = DH_new();
+    dh->p = BN_bin2bn(group->prime, group->prime_size, 0);
+    dh->g = BN_new();
+    if (dh->p == NULL || dh->g == NULL || !BN_set_word(dh->g, 2)) {
+      DH_free(dh);
+      return ThrowException(Exception::Error(
+            String::New("Initialization failed")));
+    }
+
+    Handle<Value> argv[1] = { External::New(dh) };
+    return scope.Close(
+        statics->diffie_hellman_constructor->NewInstance(1, argv));
+  }
+
+  struct dh_params_req {
+    int bits;
+    DH* dh;
+    Persistent<Function> callback;
+  };
+
+  // generateDiffieHellman(primeLength, callback) generates and checks a
+  // prime on the thread pool, which takes seconds for larger ones.
+  static Handle<Value> GenerateAsync(const Arguments& args) {
+    HandleScope scope;
+
+    if (!args[0]->IsInt32() || !args[1]->IsFunction()) {
+      return ThrowException(Exception::TypeError(
+            String::New("Bad parameter")));
+    }
+
+    dh_params_req* req = new dh_params_req;
+    req->bits = args[0]->Int32Value();
+    req->dh = NULL;
+    req->callback = Persistent<Function>::New(Local<Function>::Cast(args[1]));
+
+    uv_work_t* work_req = new uv_work_t();
+    work_req->data = req;
+    work_req->work_type = WORK_CRYPTO;
+    uv_queue_work(Isolate::GetCurrentLoop(),
+                  work_req,
+                  GenerateParamsWork,
+                  AfterGenerateParams);
+
+    return Undefined();
+  }
+
+  static void GenerateParamsWork(uv_work_t* work_req) {
+    dh_params_req* req = static_cast<dh_params_req*>(work_req->data);
+    req->dh = Generate(req->bits);
+  }
+
+  static void AfterGenerateParams(uv_work_t* work_req) {
+    HandleScope scope;
+    CryptoStatics *statics = NODE_STATICS_GET(node_crypto, CryptoStatics);
+    dh_params_req* req = static_cast<dh_params_req*>(work_req->data);
+    delete work_req;
+
+    Handle<Value> argv[2];
+    if (req->dh != NULL) {
+      Handle<Value> external[1] = { External::New(req->dh) };
+      argv[0] = Null();
+      argv[1] = statics->diffie_hellman_constructor->NewInstance(1, external);
+    } else {
+      argv[0] = Exception::Error(String::New("Initialization failed"));
+      argv[1] = Undefined();
+    }
+
+    TryCatch try_catch;
+
+    req->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+
+    if (try_catch.HasCaught())
+      FatalException(try_catch);
+
+    req->callback.Dispose();
+    delete req;
+  }
+
   static Handle<Value> GetPrime(const Arguments& args) {
     DiffieHellman* diffieHellman =
       ObjectWrap::Unwrap<DiffieHellman>(args.This());
@@ -3679,6 +5263,11 @@ class DiffieHellman : public ObjectWrap {
       return ThrowException(Exception::Error(String::New("Not initialized")));
     }
 
+    if (diffieHellman->keygen_pending_) {
+      return ThrowException(Exception::Error(
+            String::New("Key generation in progress")));
+    }
+
     if (diffieHellman->dh->pub_key == NULL) {
       return ThrowException(Exception::Error(
             String::New("No public key - did you forget to generate one?")));
@@ -3712,6 +5301,11 @@ class DiffieHellman : public ObjectWrap {
       return ThrowException(Exception::Error(String::New("Not initialized")));
     }
 
+    if (diffieHellman->keygen_pending_) {
+      return ThrowException(Exception::Error(
+            String::New("Key generation in progress")));
+    }
+
     if (diffieHellman->dh->priv_key == NULL) {
       return ThrowException(Exception::Error(
             String::New("No private key - did you forget to generate one?")));
@@ -3745,6 +5339,11 @@ class DiffieHellman : public ObjectWrap {
       return ThrowException(Exception::Error(String::New("Not initialized")));
     }
 
+    if (diffieHellman->keygen_pending_) {
+      return ThrowException(Exception::Error(
+            String::New("Key generation in progress")));
+    }
+
     BIGNUM* key = 0;
 
     if (args.Length() == 0) {
@@ -3827,6 +5426,11 @@ class DiffieHellman : public ObjectWrap {
       return ThrowException(Exception::Error(String::New("Not initialized")));
     }
 
+    if (diffieHellman->keygen_pending_) {
+      return ThrowException(Exception::Error(
+            String::New("Key generation in progress")));
+    }
+
     if (args.Length() == 0) {
       return ThrowException(Exception::Error(
             String::New("First argument must be public key")));
@@ -3873,6 +5477,11 @@ class DiffieHellman : public ObjectWrap {
             String::New("Not initialized")));
     }
 
+    if (diffieHellman->keygen_pending_) {
+      return ThrowException(Exception::Error(
+            String::New("Key generation in progress")));
+    }
+
     if (args.Length() == 0) {
       return ThrowException(Exception::Error(
             String::New("First argument must be private key")));
@@ -3910,6 +5519,7 @@ class DiffieHellman : public ObjectWrap {
 
   DiffieHellman() : ObjectWrap() {
     initialised_ = false;
+    keygen_pending_ = false;
     dh = NULL;
   }
 
@@ -3920,7 +5530,24 @@ class DiffieHellman : public ObjectWrap {
   }
 
  private:
+  // Generates parameters with a new prime and checks them. Returns NULL if
+  // that fails. Safe to call off the loop thread.
+  static DH* Generate(int primeLength) {
+    DH* dh = DH_new();
+    if (dh == NULL) return NULL;
+    if (!DH_generate_parameters_ex(dh, primeLength, DH_GENERATOR_2, 0) ||
+        !VerifyContext(dh)) {
+      DH_free(dh);
+      return NULL;
+    }
+    return dh;
+  }
+
   bool VerifyContext() {
+    return VerifyContext(dh);
+  }
+
+  static bool VerifyContext(DH* dh) {
     int codes;
     if (!DH_check(dh, &codes)) return false;
     if (codes & DH_CHECK_P_NOT_SAFE_PRIME) return false;
@@ -4000,6 +5627,8 @@ class DiffieHellman : public ObjectWrap {
   }
 
   bool initialised_;
+  // While generateKeys() runs on the thread pool it owns the keys
+  bool keygen_pending_;
   DH* dh;
 };
 
@@ -4115,12 +5744,315 @@ PBKDF2(const Arguments& args) {
 
   uv_work_t* req = new uv_work_t();
   req->data = request;
+  req->work_type = WORK_CRYPTO;
   uv_queue_work(Isolate::GetCurrentLoop(), req, EIO_PBKDF2, EIO_PBKDF2After);
 
   return Undefined();
 }
 
 
+struct digest_batch_req {
+  const EVP_MD* md;
+  char* key;
+  int key_len;
+  int count;
+  char** data;
+  size_t* lengths;
+  char* out;
+  unsigned int md_size;
+  Persistent<Object> inputs;
+  Persistent<Function> callback;
+};
+
+
+// Hashes every input with one EVP_MD_CTX (or HMAC_CTX when there is a key)
+// and writes the digests back to back into request->out.
+static void DigestBatchRun(digest_batch_req* request) {
+  unsigned char* out = reinterpret_cast<unsigned char*>(request->out);
+  unsigned int len;
+
+  if (request->key != NULL) {
+    HMAC_CTX ctx;
+    HMAC_CTX_init(&ctx);
+    HMAC_Init_ex(&ctx, request->key, request->key_len, request->md, NULL);
+    for (int i = 0; i < request->count; i++) {
+      // A NULL key restarts with the one set above
+      if (i > 0) HMAC_Init_ex(&ctx, NULL, 0, NULL, NULL);
+      HMAC_Update(&ctx,
+                  reinterpret_cast<unsigned char*>(request->data[i]),
+                  request->lengths[i]);
+      HMAC_Final(&ctx, out + i * request->md_size, &len);
+    }
+    HMAC_CTX_cleanup(&ctx);
+  } else {
+    EVP_MD_CTX ctx;
+    EVP_MD_CTX_init(&ctx);
+    for (int i = 0; i < request->count; i++) {
+      EVP_DigestInit_ex(&ctx, request->md, NULL);
+      EVP_DigestUpdate(&ctx, request->data[i], request->lengths[i]);
+      EVP_DigestFinal_ex(&ctx, out + i * request->md_size, &len);
+    }
+    EVP_MD_CTX_cleanup(&ctx);
+  }
+}
+
+
+static void DigestBatchFree(digest_batch_req* request) {
+  delete[] request->key;
+  delete[] request->data;
+  delete[] request->lengths;
+  request->inputs.Dispose();
+  request->callback.Dispose();
+  delete request;
+}
+
+
+void
+EIO_DigestBatch(uv_work_t* req) {
+  digest_batch_req* request = (digest_batch_req*)req->data;
+  DigestBatchRun(request);
+}
+
+
+void
+EIO_DigestBatchAfter(uv_work_t* req) {
+  HandleScope scope;
+
+  digest_batch_req* request = (digest_batch_req*)req->data;
+  delete req;
+
+  Handle<Value> argv[2] = {
+    Null(),
+    ExternalBuffer(request->out, request->count * request->md_size)
+  };
+
+  TryCatch try_catch;
+
+  request->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+
+  if (try_catch.HasCaught())
+    FatalException(try_catch);
+
+  DigestBatchFree(request);
+}
+
+
+// digestBatch(algorithm, key, buffers, [callback]) digests every buffer,
+// as an HMAC when key is a buffer, and returns them in one buffer.
+Handle<Value>
+DigestBatch(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 3 || !args[0]->IsString())
+    return ThrowException(Exception::TypeError(String::New("Bad parameter")));
+
+  String::Utf8Value algorithm(args[0]->ToString());
+  const EVP_MD* md = EVP_get_digestbyname(*algorithm);
+  if (md == NULL)
+    return ThrowException(Exception::Error(String::New(
+        "Unknown message digest")));
+
+  if (!args[1]->IsNull() && !Buffer::HasInstance(args[1]))
+    return ThrowException(Exception::TypeError(String::New(
+        "Key must be a buffer")));
+
+  if (!args[2]->IsArray())
+    return ThrowException(Exception::TypeError(String::New(
+        "Inputs must be an array of buffers")));
+
+  Local<Array> inputs = Local<Array>::Cast(args[2]);
+  int count = inputs->Length();
+
+  bool async = args.Length() > 3 && args[3]->IsFunction();
+
+  digest_batch_req* request = new digest_batch_req;
+  request->md = md;
+  request->key = NULL;
+  request->key_len = 0;
+  request->count = count;
+  request->data = new char*[count];
+  request->lengths = new size_t[count];
+  request->md_size = EVP_MD_size(md);
+
+  for (int i = 0; i < count; i++) {
+    Local<Value> input = inputs->Get(i);
+    if (!Buffer::HasInstance(input)) {
+      DigestBatchFree(request);
+      return ThrowException(Exception::TypeError(String::New(
+          "Inputs must be an array of buffers")));
+    }
+    request->data[i] = Buffer::Data(input->ToObject());
+    request->lengths[i] = Buffer::Length(input->ToObject());
+  }
+
+  if (Buffer::HasInstance(args[1])) {
+    Local<Object> key = args[1]->ToObject();
+    request->key_len = Buffer::Length(key);
+    request->key = new char[request->key_len];
+    memcpy(request->key, Buffer::Data(key), request->key_len);
+  }
+
+  size_t len = count * request->md_size;
+
+  if (!async) {
+    Buffer* result = Buffer::New(len);
+    request->out = Buffer::Data(result);
+    DigestBatchRun(request);
+    DigestBatchFree(request);
+    return scope.Close(result->handle_);
+  }
+
+  // The inputs array is ours (see lib/crypto.js), holding it keeps every
+  // buffer alive until the work is done.
+  request->out = new char[len > 0 ? len : 1];
+  request->inputs = Persistent<Object>::New(inputs);
+  request->callback = Persistent<Function>::New(
+      Local<Function>::Cast(args[3]));
+
+  uv_work_t* req = new uv_work_t();
+  req->data = request;
+  req->work_type = WORK_CRYPTO;
+  uv_queue_work(Isolate::GetCurrentLoop(),
+                req,
+                EIO_DigestBatch,
+                EIO_DigestBatchAfter);
+
+  return Undefined();
+}
+
+
+// Files are read in chunks of this size for hashFile()
+#define HASH_FILE_CHUNK (1024 * 1024)
+
+struct hash_file_req {
+  const EVP_MD* md;
+  char* path;
+  // errno and the call that failed, 0 if none did
+  int err;
+  const char* syscall;
+  unsigned char out[EVP_MAX_MD_SIZE];
+  unsigned int md_size;
+  Persistent<Function> callback;
+};
+
+
+void
+EIO_HashFile(uv_work_t* req) {
+  hash_file_req* request = (hash_file_req*)req->data;
+
+  FILE* file = fopen(request->path, "rb");
+  if (file == NULL) {
+    request->err = errno;
+    request->syscall = "open";
+    return;
+  }
+
+  char* chunk = static_cast<char*>(malloc(HASH_FILE_CHUNK));
+  if (chunk == NULL) {
+    fclose(file);
+    request->err = ENOMEM;
+    request->syscall = "read";
+    return;
+  }
+
+  // The chunks are large, stdio buffering would only add a copy
+  setvbuf(file, NULL, _IONBF, 0);
+
+  EVP_MD_CTX ctx;
+  EVP_MD_CTX_init(&ctx);
+  EVP_DigestInit_ex(&ctx, request->md, NULL);
+
+  size_t n;
+  while ((n = fread(chunk, 1, HASH_FILE_CHUNK, file)) > 0) {
+    EVP_DigestUpdate(&ctx, chunk, n);
+  }
+
+  if (ferror(file)) {
+    request->err = errno ? errno : EIO;
+    request->syscall = "read";
+  } else {
+    EVP_DigestFinal_ex(&ctx, request->out, &request->md_size);
+  }
+
+  EVP_MD_CTX_cleanup(&ctx);
+  free(chunk);
+  fclose(file);
+}
+
+
+void
+EIO_HashFileAfter(uv_work_t* req) {
+  HandleScope scope;
+
+  hash_file_req* request = (hash_file_req*)req->data;
+  delete req;
+
+  Handle<Value> argv[2];
+
+  if (request->err) {
+    argv[0] = ErrnoException(request->err, request->syscall, "",
+                             request->path);
+    argv[1] = Undefined();
+  } else {
+    Buffer* digest = Buffer::New(request->md_size);
+    memcpy(Buffer::Data(digest), request->out, request->md_size);
+    argv[0] = Null();
+    argv[1] = digest->handle_;
+  }
+
+  TryCatch try_catch;
+
+  request->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+
+  if (try_catch.HasCaught())
+    FatalException(try_catch);
+
+  request->callback.Dispose();
+  delete[] request->path;
+  delete request;
+}
+
+
+// hashFile(path, algorithm, callback) reads and digests the file on the
+// thread pool, and calls back with the digest in a buffer.
+Handle<Value>
+HashFile(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 3 || !args[0]->IsString() || !args[1]->IsString() ||
+      !args[2]->IsFunction())
+    return ThrowException(Exception::TypeError(String::New("Bad parameter")));
+
+  String::Utf8Value algorithm(args[1]->ToString());
+  const EVP_MD* md = EVP_get_digestbyname(*algorithm);
+  if (md == NULL)
+    return ThrowException(Exception::Error(String::New(
+        "Unknown message digest")));
+
+  String::Utf8Value path(args[0]->ToString());
+
+  hash_file_req* request = new hash_file_req;
+  request->md = md;
+  request->path = new char[path.length() + 1];
+  memcpy(request->path, *path, path.length() + 1);
+  request->err = 0;
+  request->syscall = NULL;
+  request->md_size = 0;
+  request->callback = Persistent<Function>::New(
+      Local<Function>::Cast(args[2]));
+
+  uv_work_t* req = new uv_work_t();
+  req->data = request;
+  req->work_type = WORK_CRYPTO;
+  uv_queue_work(Isolate::GetCurrentLoop(),
+                req,
+                EIO_HashFile,
+                EIO_HashFileAfter);
+
+  return Undefined();
+}
+
+
 typedef int (*RandomBytesGenerator)(unsigned char* buf, int size);
 
 struct RandomBytesRequest {
@@ -4232,6 +6164,7 @@ Handle<Value> RandomBytes(const Arguments& args) {
     Local<Function> callback_v = Local<Function>(Function::Cast(*args[1]));
     req->callback_ = Persistent<Function>::New(callback_v);
 
+    req->work_req_.work_type = WORK_CRYPTO;
     uv_queue_work(Isolate::GetCurrentLoop(),
                   &req->work_req_,
                   RandomBytesWork<generator>,
@@ -4257,29 +6190,40 @@ void InitCrypto(Handle<Object> target) {
   HandleScope scope;
   NODE_STATICS_NEW(node_crypto, CryptoStatics, statics);
 
-  SSL_library_init();
-  OpenSSL_add_all_algorithms();
-  OpenSSL_add_all_digests();
-  SSL_load_error_strings();
-  ERR_load_crypto_strings();
+  // Every isolate loads this module but OpenSSL is set up only once.
+  uv_mutex_lock(&process_state.mutex);
+  if (!process_state.initialized) {
+    SSL_library_init();
+    OpenSSL_add_all_algorithms();
+    OpenSSL_add_all_digests();
+    SSL_load_error_strings();
+    ERR_load_crypto_strings();
 
-  crypto_lock_init();
-  CRYPTO_set_locking_callback(crypto_lock_cb);
-  CRYPTO_set_id_callback(crypto_id_cb);
+    crypto_lock_init();
+    CRYPTO_set_locking_callback(crypto_lock_cb);
+    CRYPTO_set_id_callback(crypto_id_cb);
 
-  // Turn off compression. Saves memory - do it in userland.
+    // Turn off compression. Saves memory - do it in userland.
 #if !defined(OPENSSL_NO_COMP)
-  STACK_OF(SSL_COMP)* comp_methods =
+    STACK_OF(SSL_COMP)* comp_methods =
 #if OPENSSL_VERSION_NUMBER < 0x00908000L
-    SSL_COMP_get_compression_method()
+      SSL_COMP_get_compression_method()
 #else
-    SSL_COMP_get_compression_methods()
+      SSL_COMP_get_compression_methods()
 #endif
-  ;
-  sk_SSL_COMP_zero(comp_methods);
-  assert(sk_SSL_COMP_num(comp_methods) == 0);
+    ;
+    sk_SSL_COMP_zero(comp_methods);
+    assert(sk_SSL_COMP_num(comp_methods) == 0);
 #endif
 
+    verify_cache_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL,
+                                                  FreeVerifyCache);
+    key_cache = new KeyCache();
+
+    process_state.initialized = true;
+  }
+  uv_mutex_unlock(&process_state.mutex);
+
   SecureContext::Initialize(target);
   Connection::Initialize(target);
   Cipher::Initialize(target);
@@ -4291,6 +6235,8 @@ void InitCrypto(Handle<Object> target) {
   Verify::Initialize(target);
 
   NODE_SET_METHOD(target, "PBKDF2", PBKDF2);
+  NODE_SET_METHOD(target, "digestBatch", DigestBatch);
+  NODE_SET_METHOD(target, "hashFile", HashFile);
   NODE_SET_METHOD(target, "randomBytes", RandomBytes<RAND_bytes>);
   NODE_SET_METHOD(target, "pseudoRandomBytes", RandomBytes<RAND_pseudo_bytes>);
 
@@ -4304,6 +6250,9 @@ void InitCrypto(Handle<Object> target) {
   statics->fingerprint_symbol   = NODE_PSYMBOL("fingerprint");
   statics->name_symbol       = NODE_PSYMBOL("name");
   statics->version_symbol    = NODE_PSYMBOL("version");
+  statics->onnewsession_symbol  = NODE_PSYMBOL("onnewsession");
+  statics->onclienthello_symbol = NODE_PSYMBOL("onclienthello");
+  statics->session_id_symbol    = NODE_PSYMBOL("sessionId");
   statics->ext_key_usage_symbol = NODE_PSYMBOL("ext_key_usage");
 }
 
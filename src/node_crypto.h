@@ -48,6 +48,8 @@ namespace crypto {
 
 static X509_STORE* root_cert_store;
 
+struct SharedContext;
+
 class SecureContext : ObjectWrap {
  public:
   static void Initialize(v8::Handle<v8::Object> target);
@@ -67,23 +69,53 @@ class SecureContext : ObjectWrap {
   static v8::Handle<v8::Value> SetCiphers(const v8::Arguments& args);
   static v8::Handle<v8::Value> SetOptions(const v8::Arguments& args);
   static v8::Handle<v8::Value> SetSessionIdContext(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetTicketKeys(const v8::Arguments& args);
+  static v8::Handle<v8::Value> GetTicketKeys(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetVerifyCache(const v8::Arguments& args);
+  static v8::Handle<v8::Value> GetVerifyCacheStats(const v8::Arguments& args);
+  static v8::Handle<v8::Value> UseShared(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Share(const v8::Arguments& args);
   static v8::Handle<v8::Value> Close(const v8::Arguments& args);
 
+#ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB
+  static int TicketKeyCallback(SSL *ssl,
+                               unsigned char *name,
+                               unsigned char *iv,
+                               EVP_CIPHER_CTX *ectx,
+                               HMAC_CTX *hctx,
+                               int enc);
+#endif
+
+  // Each key is a 16 byte name, a 16 byte HMAC secret and a 16 byte AES
+  // key. The first key encrypts new tickets, all of them decrypt.
+  static const int kTicketKeyLength = 48;
+  static const int kMaxTicketKeys = 8;
+
   SecureContext() : ObjectWrap() {
     ctx_ = NULL;
     ca_store_ = NULL;
+    ticket_key_count_ = 0;
+    shared_ = NULL;
+  }
+
+  static void FreeCTX(SSL_CTX* ctx) {
+    if (ctx->cert_store == root_cert_store) {
+      // SSL_CTX_free() will attempt to free the cert_store as well.
+      // Since we want our root_cert_store to stay around forever
+      // we just clear the field. Hopefully OpenSSL will not modify this
+      // struct in future versions.
+      ctx->cert_store = NULL;
+    }
+    SSL_CTX_free(ctx);
   }
 
   void FreeCTXMem() {
-    if (ctx_) {
-      if (ctx_->cert_store == root_cert_store) {
-        // SSL_CTX_free() will attempt to free the cert_store as well.
-        // Since we want our root_cert_store to stay around forever
-        // we just clear the field. Hopefully OpenSSL will not modify this
-        // struct in future versions.
-        ctx_->cert_store = NULL;
-      }
-      SSL_CTX_free(ctx_);
+    if (shared_) {
+      ReleaseShared();
+      ctx_ = NULL;
+      ca_store_ = NULL;
+    } else if (ctx_) {
+      FreeCTX(ctx_);
       ctx_ = NULL;
       ca_store_ = NULL;
     } else {
@@ -91,17 +123,32 @@ class SecureContext : ObjectWrap {
     }
   }
 
+  void ReleaseShared();
+
   ~SecureContext() {
     FreeCTXMem();
   }
 
  private:
+  unsigned char ticket_keys_[kMaxTicketKeys][kTicketKeyLength];
+  int ticket_key_count_;
+
+  // Set when ctx_ comes from the process wide cache of contexts
+  SharedContext* shared_;
 };
 
 class Connection : ObjectWrap {
  public:
   static void Initialize(v8::Handle<v8::Object> target);
 
+  // Session cache hooks, installed on every SecureContext. They let JS
+  // keep sessions in a store shared by several servers or processes.
+  static SSL_SESSION* GetSessionCallback(SSL *s,
+                                         unsigned char *key,
+                                         int len,
+                                         int *copy);
+  static int NewSessionCallback(SSL *s, SSL_SESSION *sess);
+
 #ifdef OPENSSL_NPN_NEGOTIATED
   v8::Persistent<v8::Object> npnProtos_;
   v8::Persistent<v8::Value> selectedNPNProto_;
@@ -132,6 +179,15 @@ class Connection : ObjectWrap {
   static v8::Handle<v8::Value> ReceivedShutdown(const v8::Arguments& args);
   static v8::Handle<v8::Value> Start(const v8::Arguments& args);
   static v8::Handle<v8::Value> Close(const v8::Arguments& args);
+  static v8::Handle<v8::Value> EnableSessionCallbacks(
+      const v8::Arguments& args);
+  static v8::Handle<v8::Value> LoadSession(const v8::Arguments& args);
+  static v8::Handle<v8::Value> EndParser(const v8::Arguments& args);
+  static v8::Handle<v8::Value> HandshakeAsync(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetRecordSize(const v8::Arguments& args);
+  static v8::Handle<v8::Value> ClearFlush(const v8::Arguments& args);
+  static void HandshakeWork(uv_work_t* work_req);
+  static void AfterHandshake(uv_work_t* work_req);
 
 #ifdef OPENSSL_NPN_NEGOTIATED
   // NPN
@@ -154,11 +210,13 @@ class Connection : ObjectWrap {
   static int SelectSNIContextCallback_(SSL *s, int *ad, void* arg);
 #endif
 
+  void EmitNewSession(SSL_SESSION *sess);
   int HandleBIOError(BIO *bio, const char* func, int rv);
   int HandleSSLError(const char* func, int rv);
 
   void ClearError();
   void SetShutdownFlags();
+  int FlushCleartext();
 
   static Connection* Unwrap(const v8::Arguments& args) {
     Connection* ss = ObjectWrap::Unwrap<Connection>(args.Holder());
@@ -166,9 +224,48 @@ class Connection : ObjectWrap {
     return ss;
   }
 
-  Connection() : ObjectWrap() {
+  // Holds back the first bytes a server receives until the ClientHello
+  // is complete, so that JS gets a chance to look up the session the
+  // client asks to resume before OpenSSL consults its own cache.
+  class ClientHelloParser {
+   public:
+    enum State {
+      kEnded,
+      kWaiting,
+      kPaused
+    };
+
+    explicit ClientHelloParser(Connection* c)
+        : conn_(c), state_(kEnded), offset_(0) {
+    }
+
+    void Start() { state_ = kWaiting; }
+    bool ended() { return state_ == kEnded; }
+    int Write(const char* data, size_t len);
+    void Finish();
+
+   private:
+    // Record header + handshake header + version + random + session id
+    static const size_t kSessionIdOffset = 5 + 4 + 2 + 32;
+
+    void Parse();
+
+    Connection* conn_;
+    State state_;
+    char data_[18432];
+    size_t offset_;
+  };
+
+  Connection() : ObjectWrap(), hello_parser_(this) {
     bio_read_ = bio_write_ = NULL;
     ssl_ = NULL;
+    next_sess_ = NULL;
+    deferred_sess_ = NULL;
+    handshake_pending_ = false;
+    close_pending_ = false;
+    coalesce_buf_ = NULL;
+    coalesce_size_ = 0;
+    coalesce_len_ = 0;
   }
 
   ~Connection() {
@@ -177,6 +274,18 @@ class Connection : ObjectWrap {
       ssl_ = NULL;
     }
 
+    if (next_sess_ != NULL) {
+      SSL_SESSION_free(next_sess_);
+      next_sess_ = NULL;
+    }
+
+    if (deferred_sess_ != NULL) {
+      SSL_SESSION_free(deferred_sess_);
+      deferred_sess_ = NULL;
+    }
+
+    delete[] coalesce_buf_;
+
 #ifdef OPENSSL_NPN_NEGOTIATED
     if (!npnProtos_.IsEmpty()) npnProtos_.Dispose();
     if (!selectedNPNProto_.IsEmpty()) selectedNPNProto_.Dispose();
@@ -194,6 +303,21 @@ class Connection : ObjectWrap {
   BIO *bio_write_;
   SSL *ssl_;
 
+  ClientHelloParser hello_parser_;
+  SSL_SESSION* next_sess_;
+
+  // While a handshake step runs on the thread pool the SSL object and its
+  // BIOs belong to the worker; the loop leaves them alone until it's done.
+  bool handshake_pending_;
+  bool close_pending_;
+  SSL_SESSION* deferred_sess_;
+
+  // Small cleartext writes collect here until they fill a record or JS
+  // flushes them at the end of the tick, so they go out in one SSL_write.
+  char* coalesce_buf_;
+  size_t coalesce_size_;
+  size_t coalesce_len_;
+
   bool is_server_; /* coverity[member_decl] */
 };
 
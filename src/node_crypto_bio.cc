@@ -0,0 +1,283 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <node_crypto_bio.h>
+#include <openssl/bio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace node {
+namespace crypto {
+
+BIO_METHOD NodeBIO::method_ = {
+  BIO_TYPE_MEM,
+  "node.js SSL buffer",
+  NodeBIO::Write,
+  NodeBIO::Read,
+  NodeBIO::Puts,
+  NodeBIO::Gets,
+  NodeBIO::Ctrl,
+  NodeBIO::New,
+  NodeBIO::Free,
+  NULL
+};
+
+
+BIO_METHOD* NodeBIO::GetMethod() {
+  return &method_;
+}
+
+
+NodeBIO::~NodeBIO() {
+  Reset();
+  free(read_head_);
+  free(spare_);
+}
+
+
+int NodeBIO::New(BIO* bio) {
+  bio->ptr = new NodeBIO();
+  bio->shutdown = 1;
+  bio->init = 1;
+
+  return 1;
+}
+
+
+int NodeBIO::Free(BIO* bio) {
+  if (bio == NULL) return 0;
+
+  if (bio->shutdown) {
+    if (bio->init && bio->ptr != NULL) {
+      delete FromBIO(bio);
+      bio->ptr = NULL;
+    }
+  }
+
+  return 1;
+}
+
+
+int NodeBIO::Read(BIO* bio, char* out, int len) {
+  BIO_clear_retry_flags(bio);
+
+  NodeBIO* nbio = FromBIO(bio);
+  int bytes = nbio->Read(out, len);
+
+  if (bytes == 0) {
+    // Like BIO_s_mem(): ask to be retried, unless told to report EOF.
+    bytes = nbio->eof_return_;
+    if (bytes != 0) BIO_set_retry_read(bio);
+  }
+
+  return bytes;
+}
+
+
+int NodeBIO::Write(BIO* bio, const char* data, int len) {
+  BIO_clear_retry_flags(bio);
+
+  FromBIO(bio)->Write(data, len);
+
+  return len;
+}
+
+
+int NodeBIO::Puts(BIO* bio, const char* str) {
+  return Write(bio, str, strlen(str));
+}
+
+
+int NodeBIO::Gets(BIO* bio, char* out, int size) {
+  NodeBIO* nbio = FromBIO(bio);
+
+  if (size <= 0) return 0;
+  if (nbio->length_ == 0) return 0;
+
+  // Up to and including the newline, leaving room for the terminator.
+  int i = nbio->IndexOf('\n', size - 1);
+  size_t len = i == -1 ? size - 1 : i + 1;
+  if (len > nbio->length_) len = nbio->length_;
+
+  size_t bytes = nbio->Read(out, len);
+  out[bytes] = '\0';
+
+  return bytes;
+}
+
+
+long NodeBIO::Ctrl(BIO* bio, int cmd, long num, void* ptr) {
+  NodeBIO* nbio = FromBIO(bio);
+  long ret = 1;
+
+  switch (cmd) {
+    case BIO_CTRL_RESET:
+      nbio->Reset();
+      break;
+    case BIO_CTRL_EOF:
+      ret = nbio->length_ == 0;
+      break;
+    case BIO_C_SET_BUF_MEM_EOF_RETURN:
+      nbio->eof_return_ = num;
+      break;
+    case BIO_CTRL_INFO:
+      ret = nbio->length_;
+      if (ptr != NULL) *reinterpret_cast<void**>(ptr) = NULL;
+      break;
+    case BIO_C_SET_BUF_MEM:
+    case BIO_C_GET_BUF_MEM_PTR:
+      assert(0 && "Can't use SET_BUF_MEM_PTR with NodeBIO");
+      ret = 0;
+      break;
+    case BIO_CTRL_GET_CLOSE:
+      ret = bio->shutdown;
+      break;
+    case BIO_CTRL_SET_CLOSE:
+      bio->shutdown = num;
+      break;
+    case BIO_CTRL_WPENDING:
+      ret = 0;
+      break;
+    case BIO_CTRL_PENDING:
+      ret = nbio->length_;
+      break;
+    case BIO_CTRL_DUP:
+    case BIO_CTRL_FLUSH:
+      ret = 1;
+      break;
+    case BIO_CTRL_PUSH:
+    case BIO_CTRL_POP:
+    default:
+      ret = 0;
+      break;
+  }
+
+  return ret;
+}
+
+
+NodeBIO::Buffer* NodeBIO::NewBuffer() {
+  Buffer* buf = spare_;
+  if (buf != NULL) {
+    spare_ = NULL;
+  } else {
+    buf = static_cast<Buffer*>(malloc(sizeof(Buffer)));
+    // OpenSSL can't do anything sensible with a failed write either.
+    if (buf == NULL) abort();
+  }
+
+  buf->read_pos = 0;
+  buf->write_pos = 0;
+  buf->next = NULL;
+  return buf;
+}
+
+
+size_t NodeBIO::Read(char* out, size_t size) {
+  size_t bytes_read = 0;
+
+  while (bytes_read < size && read_head_ != NULL) {
+    Buffer* buf = read_head_;
+    size_t avail = buf->write_pos - buf->read_pos;
+    size_t n = size - bytes_read < avail ? size - bytes_read : avail;
+
+    memcpy(out + bytes_read, buf->data + buf->read_pos, n);
+    buf->read_pos += n;
+    bytes_read += n;
+
+    if (buf->read_pos == buf->write_pos) {
+      if (buf == write_head_) {
+        // Empty now; start over at the front.
+        buf->read_pos = buf->write_pos = 0;
+        break;
+      }
+
+      read_head_ = buf->next;
+      if (spare_ == NULL) {
+        spare_ = buf;
+      } else {
+        free(buf);
+      }
+    }
+  }
+
+  length_ -= bytes_read;
+  return bytes_read;
+}
+
+
+void NodeBIO::Write(const char* data, size_t size) {
+  if (write_head_ == NULL) {
+    read_head_ = write_head_ = NewBuffer();
+  }
+
+  while (size > 0) {
+    Buffer* buf = write_head_;
+    size_t room = kBufferLength - buf->write_pos;
+
+    if (room == 0) {
+      buf->next = NewBuffer();
+      write_head_ = buf->next;
+      continue;
+    }
+
+    size_t n = size < room ? size : room;
+    memcpy(buf->data + buf->write_pos, data, n);
+    buf->write_pos += n;
+    data += n;
+    size -= n;
+    length_ += n;
+  }
+}
+
+
+int NodeBIO::IndexOf(char c, size_t limit) {
+  size_t i = 0;
+
+  for (Buffer* buf = read_head_; buf != NULL && i < limit; buf = buf->next) {
+    for (size_t pos = buf->read_pos; pos < buf->write_pos && i < limit;
+         pos++, i++) {
+      if (buf->data[pos] == c) return i;
+    }
+  }
+
+  return -1;
+}
+
+
+void NodeBIO::Reset() {
+  // Keep the first buffer, free the rest.
+  while (read_head_ != NULL && read_head_ != write_head_) {
+    Buffer* next = read_head_->next;
+    free(read_head_);
+    read_head_ = next;
+  }
+
+  if (read_head_ != NULL) {
+    read_head_->read_pos = read_head_->write_pos = 0;
+  }
+  length_ = 0;
+}
+
+}  // namespace crypto
+}  // namespace node
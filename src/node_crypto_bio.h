@@ -0,0 +1,90 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef SRC_NODE_CRYPTO_BIO_H_
+#define SRC_NODE_CRYPTO_BIO_H_
+
+#include <openssl/bio.h>
+
+namespace node {
+namespace crypto {
+
+// The in-memory BIO an SSL connection reads its input from and writes its
+// output to. BIO_s_mem() moves whatever is left to the front of its
+// buffer on every read, so reading a large chunk of input a record at a
+// time costs time quadratic in the chunk size. NodeBIO keeps the data in a
+// list of fixed-size buffers and reads them in place.
+class NodeBIO {
+ public:
+  static BIO_METHOD* GetMethod();
+
+ protected:
+  static const size_t kBufferLength = 16 * 1024;
+
+  NodeBIO() : length_(0), eof_return_(-1), read_head_(NULL),
+              write_head_(NULL), spare_(NULL) {
+  }
+
+  ~NodeBIO();
+
+  static int New(BIO* bio);
+  static int Free(BIO* bio);
+  static int Read(BIO* bio, char* out, int len);
+  static int Write(BIO* bio, const char* data, int len);
+  static int Puts(BIO* bio, const char* str);
+  static int Gets(BIO* bio, char* out, int size);
+  static long Ctrl(BIO* bio, int cmd, long num, void* ptr);
+
+  static inline NodeBIO* FromBIO(BIO* bio) {
+    return static_cast<NodeBIO*>(bio->ptr);
+  }
+
+  size_t Read(char* out, size_t size);
+  void Write(const char* data, size_t size);
+  // Returns the offset of the first `c`, or -1.
+  int IndexOf(char c, size_t limit);
+  void Reset();
+
+  struct Buffer {
+    size_t read_pos;
+    size_t write_pos;
+    Buffer* next;
+    char data[kBufferLength];
+  };
+
+  Buffer* NewBuffer();
+
+  size_t length_;
+  int eof_return_;
+  // Reads come out of read_head_, writes go to the end of write_head_.
+  Buffer* read_head_;
+  Buffer* write_head_;
+  // One emptied buffer kept back for the next write.
+  Buffer* spare_;
+
+  static BIO_METHOD method_;
+};
+
+}  // namespace crypto
+}  // namespace node
+
+#endif  // SRC_NODE_CRYPTO_BIO_H_
@@ -22,27 +22,18 @@
 #include <node_dtrace.h>
 #include <string.h>
 
-#ifdef HAVE_DTRACE
-#include "node_provider.h"
-#else
-#define NODE_HTTP_SERVER_REQUEST(arg0, arg1)
-#define NODE_HTTP_SERVER_REQUEST_ENABLED() (0)
-#define NODE_HTTP_SERVER_RESPONSE(arg0)
-#define NODE_HTTP_SERVER_RESPONSE_ENABLED() (0)
-#define NODE_HTTP_CLIENT_REQUEST(arg0, arg1)
-#define NODE_HTTP_CLIENT_REQUEST_ENABLED() (0)
-#define NODE_HTTP_CLIENT_RESPONSE(arg0)
-#define NODE_HTTP_CLIENT_RESPONSE_ENABLED() (0)
-#define NODE_NET_SERVER_CONNECTION(arg0)
-#define NODE_NET_SERVER_CONNECTION_ENABLED() (0)
-#define NODE_NET_STREAM_END(arg0)
-#define NODE_NET_STREAM_END_ENABLED() (0)
-#define NODE_NET_SOCKET_READ(arg0, arg1)
-#define NODE_NET_SOCKET_READ_ENABLED() (0)
-#define NODE_NET_SOCKET_WRITE(arg0, arg1)
-#define NODE_NET_SOCKET_WRITE_ENABLED() (0)
-#define NODE_GC_START(arg0, arg1)
-#define NODE_GC_DONE(arg0, arg1)
+#include <node_probes.h>
+
+#ifdef HAVE_SYSTEMTAP
+// The tracer finds the semaphores through the probes' notes and raises them
+// while it is attached.
+#define NODE_SDT_DEFINE_SEMAPHORE(name)                                      \
+  unsigned short node_##name##_semaphore                                     \
+      __attribute__((unused, section(".probes")));
+extern "C" {
+NODE_SDT_PROBES(NODE_SDT_DEFINE_SEMAPHORE)
+}
+#undef NODE_SDT_DEFINE_SEMAPHORE
 #endif
 
 namespace node {
@@ -315,7 +306,7 @@ void InitDTrace(Handle<Object> target) {
     target->Set(String::NewSymbol(tab[i].name), tab[i].templ->GetFunction());
   }
 
-#ifdef HAVE_DTRACE
+#if defined(HAVE_DTRACE) || defined(HAVE_SYSTEMTAP)
   v8::V8::AddGCPrologueCallback((GCPrologueCallback)dtrace_gc_start);
   v8::V8::AddGCEpilogueCallback((GCEpilogueCallback)dtrace_gc_done);
 #endif
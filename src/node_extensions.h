@@ -28,14 +28,21 @@ NODE_EXT_LIST_ITEM(node_crypto)
 NODE_EXT_LIST_ITEM(node_evals)
 NODE_EXT_LIST_ITEM(node_fs)
 NODE_EXT_LIST_ITEM(node_http_parser)
+NODE_EXT_LIST_ITEM(node_json)
+NODE_EXT_LIST_ITEM(node_log)
+NODE_EXT_LIST_ITEM(node_numeric)
 #ifdef __POSIX__
 NODE_EXT_LIST_ITEM(node_signal_watcher)
 #endif
 NODE_EXT_LIST_ITEM(node_os)
+NODE_EXT_LIST_ITEM(node_profiler)
+NODE_EXT_LIST_ITEM(node_util)
+NODE_EXT_LIST_ITEM(node_websocket)
 NODE_EXT_LIST_ITEM(node_zlib)
 
 // libuv rewrite
 NODE_EXT_LIST_ITEM(node_timer_wrap)
+NODE_EXT_LIST_ITEM(node_timer_wheel)
 NODE_EXT_LIST_ITEM(node_tcp_wrap)
 NODE_EXT_LIST_ITEM(node_udp_wrap)
 NODE_EXT_LIST_ITEM(node_pipe_wrap)
@@ -43,6 +50,12 @@ NODE_EXT_LIST_ITEM(node_cares_wrap)
 NODE_EXT_LIST_ITEM(node_tty_wrap)
 NODE_EXT_LIST_ITEM(node_process_wrap)
 NODE_EXT_LIST_ITEM(node_fs_event_wrap)
+NODE_EXT_LIST_ITEM(node_channel_wrap)
+#ifdef __POSIX__
+NODE_EXT_LIST_ITEM(node_shm_ring_wrap)
+NODE_EXT_LIST_ITEM(node_file_cache)
+NODE_EXT_LIST_ITEM(node_shm_cache)
+#endif
 
 NODE_EXT_LIST_END
 
@@ -24,8 +24,13 @@
 #include "node_buffer.h"
 #ifdef __POSIX__
 # include "node_stat_watcher.h"
+# include <sys/mman.h>
+# include <dirent.h>
+# include <sys/uio.h>
+# include <pthread.h>
 #endif
 #include "req_wrap.h"
+#include "node_probes.h"
 
 #include <fcntl.h>
 #include <sys/types.h>
@@ -34,6 +39,9 @@
 #include <string.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
 
 #if defined(__MINGW32__) || defined(_MSC_VER)
 # include <io.h>
@@ -46,6 +54,9 @@ namespace node {
 using namespace v8;
 
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
+// Largest Buffer that can be indexed, like the largest external array V8
+// supports.
+#define BUFFER_MAX_LENGTH 0x3fffffff
 #define THROW_BAD_ARGS \
   ThrowException(Exception::TypeError(String::New("Bad argument")))
 
@@ -64,9 +75,35 @@ static inline int IsInt64(double x) {
 #endif
 
 
+static inline char* ProbePath(uv_fs_t* req) {
+  return req->path ? req->path : const_cast<char*>("");
+}
+
+
+// Fires the probes for an fs request that was just dispatched to the thread
+// pool.
+static inline void FireRequestProbes(uv_fs_t* req) {
+  if (NODE_FS_REQUEST_START_ENABLED()) {
+    NODE_FS_REQUEST_START(req->fs_type, ProbePath(req));
+  }
+#ifdef __POSIX__
+  if (NODE_EIO_QUEUE_DEPTH_ENABLED()) {
+    eio_channel* channel = &req->loop->uv_eio_channel;
+    NODE_EIO_QUEUE_DEPTH(eio_channel_nready(channel),
+                         eio_channel_npending(channel));
+  }
+#endif
+}
+
+
 static void After(uv_fs_t *req) {
   HandleScope scope;
-  FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
+
+  if (NODE_FS_REQUEST_DONE_ENABLED()) {
+    NODE_FS_REQUEST_DONE(req->fs_type, static_cast<int>(req->result),
+                         req->errorno, ProbePath(req));
+  }
+  FileStatics *statics = NODE_STATICS_LOOP(node_fs, FileStatics, req->loop);
 
   FSReqWrap* req_wrap = (FSReqWrap*) req->data;
   assert(&req_wrap->req_ == req);
@@ -184,7 +221,9 @@ static void After(uv_fs_t *req) {
 
   TryCatch try_catch;
 
+  uint64_t start = uv_hrtime();
   callback->Call(req_wrap->object_, argc, argv);
+  Isolate::FromLoop(req->loop)->__RecordCallback(uv_hrtime() - start);
 
   if (try_catch.HasCaught()) {
     FatalException(try_catch);
@@ -273,6 +312,7 @@ Local<Value> FSError(int errorno,
   assert(r == 0);                                                  \
   req_wrap->object_->Set(statics->oncomplete_sym, callback);                \
   req_wrap->Dispatched();                                          \
+  FireRequestProbes(&req_wrap->req_);                              \
   return scope.Close(req_wrap->object_);
 
 #define SYNC_CALL(func, path, ...)                                \
@@ -308,26 +348,58 @@ static Handle<Value> Close(const Arguments& args) {
   }
 }
 
-Local<Object> BuildStatsObject(NODE_STAT_STRUCT *s) {
+// atime, mtime and ctime are kept as numbers, in seconds, in the internal
+// fields of a Stats object. They are only turned into Date objects when
+// they are read, and most stat() callers never look at them. The Date takes
+// the number's place so that later reads return the same object. Assigning
+// to the property stores the value as it is.
+enum StatsField {
+  STATS_ATIME,
+  STATS_MTIME,
+  STATS_CTIME,
+  // Bit (1 << STATS_*) set once the field holds its final value.
+  STATS_MATERIALIZED,
+  STATS_FIELD_COUNT
+};
+
+
+static Handle<Value> StatsTimeGetter(Local<String> property,
+                                     const AccessorInfo& info) {
   HandleScope scope;
-  FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
+  Local<Object> self = info.Holder();
+  int index = info.Data()->Int32Value();
+  int materialized = self->GetInternalField(STATS_MATERIALIZED)->Int32Value();
+  Local<Value> value = self->GetInternalField(index);
 
-  if (statics->dev_symbol.IsEmpty()) {
-    statics->dev_symbol = NODE_PSYMBOL("dev");
-    statics->ino_symbol = NODE_PSYMBOL("ino");
-    statics->mode_symbol = NODE_PSYMBOL("mode");
-    statics->nlink_symbol = NODE_PSYMBOL("nlink");
-    statics->uid_symbol = NODE_PSYMBOL("uid");
-    statics->gid_symbol = NODE_PSYMBOL("gid");
-    statics->rdev_symbol = NODE_PSYMBOL("rdev");
-    statics->size_symbol = NODE_PSYMBOL("size");
-    statics->blksize_symbol = NODE_PSYMBOL("blksize");
-    statics->blocks_symbol = NODE_PSYMBOL("blocks");
-    statics->atime_symbol = NODE_PSYMBOL("atime");
-    statics->mtime_symbol = NODE_PSYMBOL("mtime");
-    statics->ctime_symbol = NODE_PSYMBOL("ctime");
+  if (!(materialized & (1 << index))) {
+    value = NODE_UNIXTIME_V8(value->NumberValue());
+    self->SetInternalField(index, value);
+    self->SetInternalField(STATS_MATERIALIZED,
+                           Integer::New(materialized | (1 << index)));
   }
 
+  return scope.Close(value);
+}
+
+
+static void StatsTimeSetter(Local<String> property,
+                            Local<Value> value,
+                            const AccessorInfo& info) {
+  HandleScope scope;
+  Local<Object> self = info.Holder();
+  int index = info.Data()->Int32Value();
+  int materialized = self->GetInternalField(STATS_MATERIALIZED)->Int32Value();
+
+  self->SetInternalField(index, value);
+  self->SetInternalField(STATS_MATERIALIZED,
+                         Integer::New(materialized | (1 << index)));
+}
+
+
+Local<Object> BuildStatsObject(NODE_STAT_STRUCT *s) {
+  HandleScope scope;
+  FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
+
   Local<Object> stats =
     statics->stats_constructor_template->GetFunction()->NewInstance();
 
@@ -364,13 +436,18 @@ Local<Object> BuildStatsObject(NODE_STAT_STRUCT *s) {
 #endif
 
   /* time of last access */
-  stats->Set(statics->atime_symbol, NODE_UNIXTIME_V8(s->st_atime));
+  stats->SetInternalField(STATS_ATIME,
+                          Number::New(static_cast<double>(s->st_atime)));
 
   /* time of last modification */
-  stats->Set(statics->mtime_symbol, NODE_UNIXTIME_V8(s->st_mtime));
+  stats->SetInternalField(STATS_MTIME,
+                          Number::New(static_cast<double>(s->st_mtime)));
 
   /* time of last status change */
-  stats->Set(statics->ctime_symbol, NODE_UNIXTIME_V8(s->st_ctime));
+  stats->SetInternalField(STATS_CTIME,
+                          Number::New(static_cast<double>(s->st_ctime)));
+
+  stats->SetInternalField(STATS_MATERIALIZED, Integer::New(0));
 
   return scope.Close(stats);
 }
@@ -429,6 +506,761 @@ static Handle<Value> FStat(const Arguments& args) {
   }
 }
 
+// The paths and results of one statMany() call. The paths are stored back
+// to back in one block, NUL terminated.
+struct StatBatch {
+  StatBatch(bool lstat, int count, size_t size) : lstat(lstat), count(count) {
+    paths = new char[size];
+    offsets = new size_t[count];
+    errors = new int[count];
+    stats = new NODE_STAT_STRUCT[count];
+  }
+
+  ~StatBatch() {
+    delete [] paths;
+    delete [] offsets;
+    delete [] errors;
+    delete [] stats;
+  }
+
+  bool lstat;
+  int count;
+  char* paths;
+  size_t* offsets;
+  int* errors;
+  NODE_STAT_STRUCT* stats;
+};
+
+typedef class ReqWrap<uv_work_t> StatManyWrap;
+
+
+// Runs on the thread pool for async calls, so it must not touch V8 or the
+// loop; errors are kept as plain errno values.
+static void StatManyWork(StatBatch* batch) {
+  for (int i = 0; i < batch->count; i++) {
+    const char* path = batch->paths + batch->offsets[i];
+#ifdef _WIN32
+    int r = _stati64(path, &batch->stats[i]);
+#else
+    int r = batch->lstat ? lstat(path, &batch->stats[i])
+                         : stat(path, &batch->stats[i]);
+#endif
+    batch->errors[i] = r == 0 ? 0 : errno;
+  }
+}
+
+
+static void StatManyWork(uv_work_t* req) {
+  StatManyWrap* req_wrap = static_cast<StatManyWrap*>(req->data);
+  StatManyWork(static_cast<StatBatch*>(req_wrap->data_));
+}
+
+
+static Local<Array> StatManyResults(StatBatch* batch) {
+  Isolate* isolate = Isolate::GetCurrent();
+  const char* syscall = batch->lstat ? "lstat" : "stat";
+  Local<Array> results = Array::New(batch->count);
+
+  for (int i = 0; i < batch->count; i++) {
+    if (batch->errors[i]) {
+      results->Set(i, isolate->ErrnoException(batch->errors[i],
+                                              syscall,
+                                              "",
+                                              batch->paths + batch->offsets[i]));
+    } else {
+      results->Set(i, BuildStatsObject(&batch->stats[i]));
+    }
+  }
+
+  return results;
+}
+
+
+static void AfterStatMany(uv_work_t* req) {
+  HandleScope scope;
+
+  StatManyWrap* req_wrap = static_cast<StatManyWrap*>(req->data);
+  StatBatch* batch = static_cast<StatBatch*>(req_wrap->data_);
+
+  Local<Value> argv[2] = {
+    Local<Value>::New(Null()),
+    StatManyResults(batch)
+  };
+
+  FileStatics *statics = NODE_STATICS_LOOP(node_fs, FileStatics, req->loop);
+  MakeCallback(req_wrap->object_, statics->oncomplete_sym, 2, argv);
+
+  delete batch;
+  delete req_wrap;
+}
+
+
+// statMany(paths, lstat, [callback])
+//
+// Stats all of `paths` with a single thread pool request and one callback,
+// callback(null, results). results[i] is a Stats object, or the Error for
+// paths[i]. Without a callback the results are returned directly.
+static Handle<Value> StatMany(const Arguments& args) {
+  HandleScope scope;
+  FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
+
+  if (args.Length() < 2 || !args[0]->IsArray()) {
+    return THROW_BAD_ARGS;
+  }
+
+  Local<Array> paths = Local<Array>::Cast(args[0]);
+  int count = paths->Length();
+
+  size_t size = 0;
+  for (int i = 0; i < count; i++) {
+    Local<Value> path = paths->Get(i);
+    if (!path->IsString()) return THROW_BAD_ARGS;
+    size += path->ToString()->Utf8Length() + 1;
+  }
+
+  StatBatch* batch = new StatBatch(args[1]->BooleanValue(), count, size);
+
+  size_t offset = 0;
+  for (int i = 0; i < count; i++) {
+    batch->offsets[i] = offset;
+    offset += paths->Get(i)->ToString()->WriteUtf8(batch->paths + offset);
+  }
+
+  if (!args[2]->IsFunction()) {
+    StatManyWork(batch);
+    Local<Array> results = StatManyResults(batch);
+    delete batch;
+    return scope.Close(results);
+  }
+
+  StatManyWrap* req_wrap = new StatManyWrap();
+  req_wrap->data_ = batch;
+  req_wrap->object_->Set(statics->oncomplete_sym, args[2]);
+  // The work callback finds the batch through req_.data, and may run before
+  // uv_queue_work() returns.
+  req_wrap->Dispatched();
+
+  req_wrap->req_.work_type = WORK_FS;
+  int r = uv_queue_work(Isolate::GetCurrentLoop(),
+                        &req_wrap->req_,
+                        StatManyWork,
+                        AfterStatMany);
+  assert(r == 0);
+
+  return scope.Close(req_wrap->object_);
+}
+
+#ifdef __POSIX__
+// What readFile() finds in a file: its contents, or the failing syscall and
+// its errno.
+struct FileContents {
+  explicit FileContents(const char* path_)
+      : path(strdup(path_)), error(0), syscall(NULL), data(NULL), length(0) {
+  }
+  ~FileContents() {
+    free(path);
+    free(data);
+  }
+
+  char* path;
+  int error;
+  const char* syscall;
+  char* data;
+  size_t length;
+};
+
+typedef class ReqWrap<uv_work_t> ReadFileWrap;
+
+
+// Runs on the thread pool for async calls. The size fstat() reports is only
+// the first guess: a file may grow while it is read, and files in /proc
+// report 0, so reading goes on until EOF.
+static void ReadFileWork(FileContents* file) {
+  int fd = open(file->path, O_RDONLY);
+  if (fd == -1) {
+    file->error = errno;
+    file->syscall = "open";
+    return;
+  }
+
+  struct stat s;
+  if (fstat(fd, &s) == -1) {
+    file->error = errno;
+    file->syscall = "fstat";
+    close(fd);
+    return;
+  }
+
+  // One more byte than the file is, so that the read which finds the EOF
+  // doesn't need a bigger buffer.
+  size_t capacity = S_ISREG(s.st_mode) && s.st_size > 0 ? s.st_size + 1
+                                                         : 8192;
+  file->data = static_cast<char*>(malloc(capacity));
+
+  while (file->data) {
+    if (file->length == capacity) {
+      capacity *= 2;
+      char* data = static_cast<char*>(realloc(file->data, capacity));
+      if (!data) break;
+      file->data = data;
+    }
+
+    ssize_t n = read(fd, file->data + file->length, capacity - file->length);
+    if (n == 0) break;
+    if (n == -1) {
+      if (errno == EINTR) continue;
+      file->error = errno;
+      file->syscall = "read";
+      break;
+    }
+
+    file->length += n;
+    if (file->length > BUFFER_MAX_LENGTH) {
+      file->error = EFBIG;
+      file->syscall = "read";
+      break;
+    }
+  }
+
+  if (!file->data) {
+    file->error = ENOMEM;
+    file->syscall = "read";
+  }
+
+  close(fd);
+}
+
+
+static void ReadFileWork(uv_work_t* req) {
+  ReadFileWrap* req_wrap = static_cast<ReadFileWrap*>(req->data);
+  ReadFileWork(static_cast<FileContents*>(req_wrap->data_));
+}
+
+
+static void FreeFileContents(char* data, void* hint) {
+  V8::AdjustAmountOfExternalAllocatedMemory(
+      -static_cast<intptr_t>(reinterpret_cast<size_t>(hint)));
+  free(data);
+}
+
+
+// The contents as a Buffer that takes over their memory, or the Error.
+static Local<Value> ReadFileResult(FileContents* file) {
+  if (file->error) {
+    return Isolate::GetCurrent()->ErrnoException(file->error,
+                                                 file->syscall,
+                                                 "",
+                                                 file->path);
+  }
+
+  Buffer* buffer = Buffer::New(file->data,
+                               file->length,
+                               FreeFileContents,
+                               reinterpret_cast<void*>(file->length));
+  V8::AdjustAmountOfExternalAllocatedMemory(file->length);
+  file->data = NULL;
+
+  return Local<Value>::New(buffer->handle_);
+}
+
+
+static void AfterReadFile(uv_work_t* req) {
+  HandleScope scope;
+
+  ReadFileWrap* req_wrap = static_cast<ReadFileWrap*>(req->data);
+  FileContents* file = static_cast<FileContents*>(req_wrap->data_);
+
+  Local<Value> result = ReadFileResult(file);
+  Local<Value> argv[2];
+  if (file->error) {
+    argv[0] = result;
+    argv[1] = Local<Value>::New(Undefined());
+  } else {
+    argv[0] = Local<Value>::New(Null());
+    argv[1] = result;
+  }
+
+  FileStatics *statics = NODE_STATICS_LOOP(node_fs, FileStatics, req->loop);
+  MakeCallback(req_wrap->object_, statics->oncomplete_sym, 2, argv);
+
+  delete file;
+  delete req_wrap;
+}
+
+
+// readFile(path, [callback])
+//
+// Opens, sizes, reads and closes the file `path` with a single thread pool
+// request, callback(err, buffer). Without a callback the buffer is
+// returned, or the error thrown.
+static Handle<Value> ReadFile(const Arguments& args) {
+  HandleScope scope;
+  FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
+
+  if (args.Length() < 1 || !args[0]->IsString()) {
+    return THROW_BAD_ARGS;
+  }
+
+  String::Utf8Value path(args[0]);
+  FileContents* file = new FileContents(*path);
+
+  if (!args[1]->IsFunction()) {
+    ReadFileWork(file);
+    Local<Value> result = ReadFileResult(file);
+    bool failed = file->error != 0;
+    delete file;
+    if (failed) return ThrowException(result);
+    return scope.Close(result);
+  }
+
+  ReadFileWrap* req_wrap = new ReadFileWrap();
+  req_wrap->data_ = file;
+  req_wrap->object_->Set(statics->oncomplete_sym, args[1]);
+  // The work callback finds the file through req_.data, and may run before
+  // uv_queue_work() returns.
+  req_wrap->Dispatched();
+
+  req_wrap->req_.work_type = WORK_FS;
+  int r = uv_queue_work(Isolate::GetCurrentLoop(),
+                        &req_wrap->req_,
+                        ReadFileWork,
+                        AfterReadFile);
+  assert(r == 0);
+
+  return scope.Close(req_wrap->object_);
+}
+
+
+// new Prefetch(paths) reads the files `paths` in parallel, one thread pool
+// request each, for a caller that will soon want them one at a time and
+// synchronously, as require() does at startup. take(i) returns the contents
+// of paths[i] as a Buffer: at once if its read is done, after waiting for it
+// if it is under way, or after reading the file itself if its request has
+// yet to start. It returns undefined if the read failed, or the file was
+// already taken, so that the caller can read it the usual way and report
+// errors as it always would.
+class FilePrefetch : public ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    Local<FunctionTemplate> t = FunctionTemplate::New(New);
+    t->InstanceTemplate()->SetInternalFieldCount(1);
+    t->SetClassName(String::NewSymbol("Prefetch"));
+
+    NODE_SET_PROTOTYPE_METHOD(t, "take", Take);
+
+    target->Set(String::NewSymbol("Prefetch"), t->GetFunction());
+  }
+
+ private:
+  enum State {
+    QUEUED,
+    READING,
+    DONE,
+    TAKEN
+  };
+
+  struct Entry {
+    FilePrefetch* prefetch;
+    FileContents* file;
+    State state;
+    uv_work_t req;
+  };
+
+  explicit FilePrefetch(Handle<Array> paths)
+      : ObjectWrap(),
+        entries_(paths->Length()) {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&done_, NULL);
+
+    for (size_t i = 0; i < entries_.size(); i++) {
+      String::Utf8Value path(paths->Get(i));
+      Entry& entry = entries_[i];
+      entry.prefetch = this;
+      entry.file = new FileContents(*path);
+      entry.state = QUEUED;
+      entry.req.data = &entry;
+    }
+  }
+
+  // Only runs once the after callbacks of all requests have.
+  ~FilePrefetch() {
+    for (size_t i = 0; i < entries_.size(); i++) delete entries_[i].file;
+    pthread_cond_destroy(&done_);
+    pthread_mutex_destroy(&mutex_);
+  }
+
+  static Handle<Value> New(const Arguments& args) {
+    HandleScope scope;
+
+    if (!args[0]->IsArray()) {
+      return THROW_BAD_ARGS;
+    }
+
+    FilePrefetch* prefetch = new FilePrefetch(args[0].As<Array>());
+    prefetch->Wrap(args.This());
+
+    for (size_t i = 0; i < prefetch->entries_.size(); i++) {
+      // Keeps the entries alive until the request is done with them.
+      prefetch->Ref();
+      prefetch->entries_[i].req.work_type = WORK_FS;
+      int r = uv_queue_work(Isolate::GetCurrentLoop(),
+                            &prefetch->entries_[i].req,
+                            Work,
+                            After);
+      assert(r == 0);
+    }
+
+    return args.This();
+  }
+
+  static void Work(uv_work_t* req) {
+    Entry* entry = static_cast<Entry*>(req->data);
+    FilePrefetch* prefetch = entry->prefetch;
+
+    pthread_mutex_lock(&prefetch->mutex_);
+    bool claimed = entry->state == QUEUED;
+    if (claimed) entry->state = READING;
+    pthread_mutex_unlock(&prefetch->mutex_);
+
+    // take() got to it first.
+    if (!claimed) return;
+
+    ReadFileWork(entry->file);
+
+    pthread_mutex_lock(&prefetch->mutex_);
+    entry->state = DONE;
+    pthread_cond_broadcast(&prefetch->done_);
+    pthread_mutex_unlock(&prefetch->mutex_);
+  }
+
+  static void After(uv_work_t* req) {
+    HandleScope scope;
+    Entry* entry = static_cast<Entry*>(req->data);
+    entry->prefetch->Unref();
+  }
+
+  // take(index)
+  static Handle<Value> Take(const Arguments& args) {
+    HandleScope scope;
+    FilePrefetch* prefetch = ObjectWrap::Unwrap<FilePrefetch>(args.This());
+
+    uint32_t index = args[0]->Uint32Value();
+    if (!args[0]->IsUint32() || index >= prefetch->entries_.size()) {
+      return THROW_BAD_ARGS;
+    }
+
+    Entry* entry = &prefetch->entries_[index];
+
+    pthread_mutex_lock(&prefetch->mutex_);
+    bool claimed = entry->state == QUEUED;
+    if (claimed) {
+      entry->state = READING;
+    } else {
+      while (entry->state == READING) {
+        pthread_cond_wait(&prefetch->done_, &prefetch->mutex_);
+      }
+    }
+    bool taken = entry->state == TAKEN;
+    entry->state = TAKEN;
+    pthread_mutex_unlock(&prefetch->mutex_);
+
+    if (taken) return Undefined();
+    if (claimed) ReadFileWork(entry->file);
+    if (entry->file->error) return Undefined();
+
+    return scope.Close(ReadFileResult(entry->file));
+  }
+
+  pthread_mutex_t mutex_;
+  pthread_cond_t done_;
+  std::vector<Entry> entries_;
+};
+
+// A directory tree that walk() goes through one batch of entries per thread
+// pool request. The open directories are kept as a stack, so that the next
+// batch starts where the last one stopped.
+struct DirWalk {
+  enum Type { TYPE_FILE, TYPE_DIRECTORY, TYPE_SYMLINK, TYPE_OTHER };
+
+  struct Level {
+    Level(DIR* dir, size_t length) : dir(dir), length(length) {}
+    DIR* dir;
+    // The length of `path` in the directory above.
+    size_t length;
+  };
+
+  DirWalk(const char* root, size_t batch_size, int max_depth)
+      : root(root), batch_size(batch_size), max_depth(max_depth),
+        started(false), error(0), syscall(NULL) {
+  }
+  ~DirWalk() {
+    Close();
+  }
+
+  void Close() {
+    while (!levels.empty()) {
+      closedir(levels.back().dir);
+      levels.pop_back();
+    }
+  }
+
+  void Fail(const char* failed, const std::string& failed_path) {
+    error = errno;
+    syscall = failed;
+    error_path = failed_path;
+    Close();
+  }
+
+  bool done() const {
+    return error != 0 || (started && levels.empty());
+  }
+
+  std::string root;
+  size_t batch_size;  // 0 for no limit
+  int max_depth;      // -1 for no limit
+  bool started;
+  std::vector<Level> levels;
+  // The directory being read relative to the root, with a trailing slash.
+  std::string path;
+
+  // The entries of the current batch, paths relative to the root stored
+  // back to back, NUL terminated.
+  std::string names;
+  std::vector<size_t> offsets;
+  std::vector<char> types;
+
+  int error;
+  const char* syscall;
+  std::string error_path;
+};
+
+typedef class ReqWrap<uv_work_t> DirWalkWrap;
+
+
+// The type from the directory entry, which saves a stat() on most file
+// systems. Those that leave it DT_UNKNOWN get an lstat(); -1 means the entry
+// is gone.
+static int DirEntryType(DirWalk* walk,
+                        struct dirent* ent,
+                        const std::string& path) {
+#ifdef DT_DIR
+  switch (ent->d_type) {
+    case DT_REG: return DirWalk::TYPE_FILE;
+    case DT_DIR: return DirWalk::TYPE_DIRECTORY;
+    case DT_LNK: return DirWalk::TYPE_SYMLINK;
+    case DT_UNKNOWN: break;
+    default: return DirWalk::TYPE_OTHER;
+  }
+#endif
+
+  struct stat s;
+  if (lstat((walk->root + '/' + path).c_str(), &s) == -1) {
+    return errno == ENOENT ? -1 : DirWalk::TYPE_OTHER;
+  }
+  if (S_ISREG(s.st_mode)) return DirWalk::TYPE_FILE;
+  if (S_ISDIR(s.st_mode)) return DirWalk::TYPE_DIRECTORY;
+  if (S_ISLNK(s.st_mode)) return DirWalk::TYPE_SYMLINK;
+  return DirWalk::TYPE_OTHER;
+}
+
+
+// Runs on the thread pool for async calls. Directories are listed before
+// what is in them; symlinks are not followed. A directory that is removed
+// or replaced while the walk runs is skipped, any other error ends it.
+static void DirWalkWork(DirWalk* walk) {
+  walk->names.clear();
+  walk->offsets.clear();
+  walk->types.clear();
+
+  if (!walk->started) {
+    walk->started = true;
+    DIR* dir = opendir(walk->root.c_str());
+    if (dir == NULL) {
+      walk->Fail("opendir", walk->root);
+      return;
+    }
+    walk->levels.push_back(DirWalk::Level(dir, 0));
+  }
+
+  while (!walk->levels.empty() &&
+         (walk->batch_size == 0 || walk->offsets.size() < walk->batch_size)) {
+    errno = 0;
+    struct dirent* ent = readdir(walk->levels.back().dir);
+
+    if (ent == NULL) {
+      if (errno != 0) {
+        walk->Fail("readdir", walk->root + '/' + walk->path);
+        return;
+      }
+      closedir(walk->levels.back().dir);
+      walk->path.resize(walk->levels.back().length);
+      walk->levels.pop_back();
+      continue;
+    }
+
+    const char* name = ent->d_name;
+    if (name[0] == '.' &&
+        (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+      continue;
+    }
+
+    std::string entry = walk->path + name;
+    int type = DirEntryType(walk, ent, entry);
+    if (type == -1) continue;
+
+    walk->offsets.push_back(walk->names.size());
+    walk->names.append(entry);
+    walk->names.push_back('\0');
+    walk->types.push_back(static_cast<char>(type));
+
+    if (type != DirWalk::TYPE_DIRECTORY ||
+        (walk->max_depth >= 0 &&
+         walk->levels.size() > static_cast<size_t>(walk->max_depth))) {
+      continue;
+    }
+
+    std::string full = walk->root + '/' + entry;
+    DIR* dir = opendir(full.c_str());
+    if (dir == NULL) {
+      if (errno == ENOENT || errno == ENOTDIR) continue;
+      walk->Fail("opendir", full);
+      return;
+    }
+    walk->levels.push_back(DirWalk::Level(dir, walk->path.size()));
+    walk->path = entry + '/';
+  }
+}
+
+
+static void DirWalkWork(uv_work_t* req) {
+  DirWalkWrap* req_wrap = static_cast<DirWalkWrap*>(req->data);
+  DirWalkWork(static_cast<DirWalk*>(req_wrap->data_));
+}
+
+
+// The batch as [paths, types], or the Error.
+static Local<Value> DirWalkResult(DirWalk* walk) {
+  if (walk->error) {
+    return Isolate::GetCurrent()->ErrnoException(walk->error,
+                                                 walk->syscall,
+                                                 "",
+                                                 walk->error_path.c_str());
+  }
+
+  Local<String> type_names[] = {
+    String::NewSymbol("file"),
+    String::NewSymbol("directory"),
+    String::NewSymbol("symlink"),
+    String::NewSymbol("other")
+  };
+
+  int count = walk->offsets.size();
+  Local<Array> paths = Array::New(count);
+  Local<Array> types = Array::New(count);
+  for (int i = 0; i < count; i++) {
+    paths->Set(i, String::New(walk->names.data() + walk->offsets[i]));
+    types->Set(i, type_names[static_cast<int>(walk->types[i])]);
+  }
+
+  Local<Array> result = Array::New(2);
+  result->Set(0, paths);
+  result->Set(1, types);
+  return result;
+}
+
+
+static void AfterDirWalk(uv_work_t* req) {
+  HandleScope scope;
+
+  DirWalkWrap* req_wrap = static_cast<DirWalkWrap*>(req->data);
+  DirWalk* walk = static_cast<DirWalk*>(req_wrap->data_);
+
+  Local<Value> result = DirWalkResult(walk);
+  Local<Value> argv[4];
+  if (walk->error) {
+    argv[0] = result;
+    argv[1] = Local<Value>::New(Undefined());
+    argv[2] = Local<Value>::New(Undefined());
+  } else {
+    Local<Array> batch = Local<Array>::Cast(result);
+    argv[0] = Local<Value>::New(Null());
+    argv[1] = batch->Get(0);
+    argv[2] = batch->Get(1);
+  }
+  argv[3] = Local<Value>::New(Boolean::New(walk->done()));
+
+  FileStatics *statics = NODE_STATICS_LOOP(node_fs, FileStatics, req->loop);
+  MakeCallback(req_wrap->object_, statics->oncomplete_sym, 4, argv);
+
+  // The callback stops the walk early by setting `stop` on the request.
+  if (!walk->done() &&
+      !req_wrap->object_->Get(String::NewSymbol("stop"))->BooleanValue()) {
+    req_wrap->req_.work_type = WORK_FS;
+    int r = uv_queue_work(Isolate::GetCurrentLoop(),
+                          &req_wrap->req_,
+                          DirWalkWork,
+                          AfterDirWalk);
+    assert(r == 0);
+    return;
+  }
+
+  delete walk;
+  delete req_wrap;
+}
+
+
+// walk(root, batchSize, maxDepth, [callback])
+//
+// Walks the tree under `root`, callback(err, paths, types, done) for every
+// batchSize entries found. paths are relative to root and types are 'file',
+// 'directory', 'symlink' or 'other'. A batchSize of 0 lists everything at
+// once, a maxDepth of 0 only root itself and -1 the whole tree. Without a
+// callback [paths, types] is returned, or the error thrown.
+static Handle<Value> Walk(const Arguments& args) {
+  HandleScope scope;
+  FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
+
+  if (args.Length() < 3 || !args[0]->IsString()) {
+    return THROW_BAD_ARGS;
+  }
+
+  String::Utf8Value root(args[0]);
+  int64_t batch_size = args[1]->IntegerValue();
+  DirWalk* walk = new DirWalk(*root,
+                              batch_size > 0 ? batch_size : 0,
+                              args[2]->Int32Value());
+
+  if (!args[3]->IsFunction()) {
+    walk->batch_size = 0;
+    DirWalkWork(walk);
+    Local<Value> result = DirWalkResult(walk);
+    bool failed = walk->error != 0;
+    delete walk;
+    if (failed) return ThrowException(result);
+    return scope.Close(result);
+  }
+
+  DirWalkWrap* req_wrap = new DirWalkWrap();
+  req_wrap->data_ = walk;
+  req_wrap->object_->Set(statics->oncomplete_sym, args[3]);
+  // The work callback finds the walk through req_.data, and may run before
+  // uv_queue_work() returns.
+  req_wrap->Dispatched();
+
+  req_wrap->req_.work_type = WORK_FS;
+  int r = uv_queue_work(Isolate::GetCurrentLoop(),
+                        &req_wrap->req_,
+                        DirWalkWork,
+                        AfterDirWalk);
+  assert(r == 0);
+
+  return scope.Close(req_wrap->object_);
+}
+#endif  // __POSIX__
+
+
 static Handle<Value> Symlink(const Arguments& args) {
   HandleScope scope;
   FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
@@ -645,14 +1477,16 @@ static Handle<Value> SendFile(const Arguments& args) {
   if (args.Length() < 4 ||
       !args[0]->IsUint32() ||
       !args[1]->IsUint32() ||
-      !args[2]->IsUint32() ||
+      !args[2]->IsNumber() ||
+      args[2]->IntegerValue() < 0 ||
       !args[3]->IsUint32()) {
     return THROW_BAD_ARGS;
   }
 
   int out_fd = args[0]->Uint32Value();
   int in_fd = args[1]->Uint32Value();
-  off_t in_offset = args[2]->Uint32Value();
+  // Offsets past 4GB are fine as long as they are integers.
+  off_t in_offset = args[2]->IntegerValue();
   size_t length = args[3]->Uint32Value();
 
   if (args[4]->IsFunction()) {
@@ -663,6 +1497,196 @@ static Handle<Value> SendFile(const Arguments& args) {
   }
 }
 
+#ifdef __POSIX__
+static void FreeMapping(char* data, void* hint) {
+  munmap(data, reinterpret_cast<size_t>(hint));
+}
+
+
+// mmap(fd, offset, length, [advice])
+//
+// Maps `length` bytes of `fd` starting at `offset`, a multiple of the page
+// size, into a Buffer that is unmapped when it is garbage collected. The
+// mapping is private: its pages come from the page cache and are shared with
+// everybody mapping or reading the file until the Buffer writes to them, and
+// those writes never reach the file. `advice` is passed to madvise().
+static Handle<Value> Mmap(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 3 ||
+      !args[0]->IsInt32() ||
+      !args[1]->IsNumber() ||
+      args[1]->IntegerValue() < 0 ||
+      !args[2]->IsUint32() ||
+      args[2]->Uint32Value() > BUFFER_MAX_LENGTH) {
+    return THROW_BAD_ARGS;
+  }
+
+  int fd = args[0]->Int32Value();
+  off_t offset = args[1]->IntegerValue();
+  size_t length = args[2]->Uint32Value();
+
+  int advice = MADV_NORMAL;
+  if (args[3]->IsString()) {
+    String::Utf8Value name(args[3]);
+    if (strcmp(*name, "normal") == 0) {
+      advice = MADV_NORMAL;
+    } else if (strcmp(*name, "random") == 0) {
+      advice = MADV_RANDOM;
+    } else if (strcmp(*name, "sequential") == 0) {
+      advice = MADV_SEQUENTIAL;
+    } else if (strcmp(*name, "willneed") == 0) {
+      advice = MADV_WILLNEED;
+    } else if (strcmp(*name, "dontneed") == 0) {
+      advice = MADV_DONTNEED;
+    } else {
+      return ThrowException(Exception::TypeError(
+            String::New("Unknown madvise advice")));
+    }
+  }
+
+  // mmap() refuses empty mappings; an empty file maps to an empty Buffer.
+  if (length == 0) {
+    return scope.Close(Buffer::New(0)->handle_);
+  }
+
+  void* data = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                    offset);
+  if (data == MAP_FAILED) {
+    return ThrowException(Isolate::GetCurrent()->ErrnoException(errno,
+                                                                "mmap"));
+  }
+
+  // Only a hint, the mapping works without it.
+  if (advice != MADV_NORMAL) madvise(data, length, advice);
+
+  Buffer* buffer = Buffer::New(static_cast<char*>(data),
+                               length,
+                               FreeMapping,
+                               reinterpret_cast<void*>(length));
+  return scope.Close(buffer->handle_);
+}
+#endif  // __POSIX__
+
+
+#ifdef POSIX_FADV_NORMAL
+struct FileHint {
+  int fd;
+  off_t offset;
+  off_t length;
+  int advice;
+  int error;
+};
+
+typedef class ReqWrap<uv_work_t> FadviseWrap;
+
+
+static void FadviseWork(uv_work_t* req) {
+  FadviseWrap* req_wrap = static_cast<FadviseWrap*>(req->data);
+  FileHint* hint = static_cast<FileHint*>(req_wrap->data_);
+  // Returns the error rather than setting errno.
+  hint->error = posix_fadvise(hint->fd, hint->offset, hint->length,
+                              hint->advice);
+}
+
+
+static void AfterFadvise(uv_work_t* req) {
+  HandleScope scope;
+
+  FadviseWrap* req_wrap = static_cast<FadviseWrap*>(req->data);
+  FileHint* hint = static_cast<FileHint*>(req_wrap->data_);
+
+  Local<Value> argv[1];
+  if (hint->error) {
+    argv[0] = Isolate::GetCurrent()->ErrnoException(hint->error,
+                                                    "posix_fadvise");
+  } else {
+    argv[0] = Local<Value>::New(Null());
+  }
+
+  FileStatics *statics = NODE_STATICS_LOOP(node_fs, FileStatics, req->loop);
+  MakeCallback(req_wrap->object_, statics->oncomplete_sym, 1, argv);
+
+  delete hint;
+  delete req_wrap;
+}
+
+
+// fadvise(fd, offset, length, advice, [callback])
+//
+// Tells the kernel how `length` bytes of `fd` from `offset` on, or the rest
+// of the file if `length` is 0, are going to be accessed. `advice` is passed
+// to posix_fadvise(). 'willneed' starts reading the range into the page
+// cache, and 'dontneed' drops its clean pages from it after starting the
+// writeback of dirty ones; both can block, so the call runs on the thread
+// pool when given a callback.
+static Handle<Value> Fadvise(const Arguments& args) {
+  HandleScope scope;
+  FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
+
+  if (args.Length() < 4 ||
+      !args[0]->IsInt32() ||
+      !args[1]->IsNumber() ||
+      args[1]->IntegerValue() < 0 ||
+      !args[2]->IsNumber() ||
+      args[2]->IntegerValue() < 0 ||
+      !args[3]->IsString()) {
+    return THROW_BAD_ARGS;
+  }
+
+  int advice;
+  String::Utf8Value name(args[3]);
+  if (strcmp(*name, "normal") == 0) {
+    advice = POSIX_FADV_NORMAL;
+  } else if (strcmp(*name, "random") == 0) {
+    advice = POSIX_FADV_RANDOM;
+  } else if (strcmp(*name, "sequential") == 0) {
+    advice = POSIX_FADV_SEQUENTIAL;
+  } else if (strcmp(*name, "willneed") == 0) {
+    advice = POSIX_FADV_WILLNEED;
+  } else if (strcmp(*name, "dontneed") == 0) {
+    advice = POSIX_FADV_DONTNEED;
+  } else if (strcmp(*name, "noreuse") == 0) {
+    advice = POSIX_FADV_NOREUSE;
+  } else {
+    return ThrowException(Exception::TypeError(
+          String::New("Unknown fadvise advice")));
+  }
+
+  FileHint* hint = new FileHint();
+  hint->fd = args[0]->Int32Value();
+  hint->offset = args[1]->IntegerValue();
+  hint->length = args[2]->IntegerValue();
+  hint->advice = advice;
+  hint->error = 0;
+
+  if (!args[4]->IsFunction()) {
+    int r = posix_fadvise(hint->fd, hint->offset, hint->length, hint->advice);
+    delete hint;
+    if (r != 0) {
+      return ThrowException(Isolate::GetCurrent()->ErrnoException(
+            r, "posix_fadvise"));
+    }
+    return Undefined();
+  }
+
+  FadviseWrap* req_wrap = new FadviseWrap();
+  req_wrap->data_ = hint;
+  req_wrap->object_->Set(statics->oncomplete_sym, args[4]);
+  req_wrap->Dispatched();
+
+  req_wrap->req_.work_type = WORK_FS;
+  int r = uv_queue_work(Isolate::GetCurrentLoop(),
+                        &req_wrap->req_,
+                        FadviseWork,
+                        AfterFadvise);
+  assert(r == 0);
+
+  return scope.Close(req_wrap->object_);
+}
+#endif  // POSIX_FADV_NORMAL
+
+
 static Handle<Value> ReadDir(const Arguments& args) {
   HandleScope scope;
   FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
@@ -856,6 +1880,234 @@ static Handle<Value> Read(const Arguments& args) {
 }
 
 
+#ifdef __POSIX__
+// The buffers of one writev() or readv() call and how far it got.
+struct IoVecs {
+  IoVecs(int fd, bool write, off_t pos, int count)
+      : fd(fd), write(write), datasync(false), pos(pos), iovs(count),
+        result(0), error(0), syscall(NULL) {
+  }
+
+  int fd;
+  bool write;
+  // Whether to fdatasync() after writing, where a short write is an error.
+  bool datasync;
+  off_t pos;  // -1 for the current file position
+  std::vector<struct iovec> iovs;
+  ssize_t result;
+  int error;
+  const char* syscall;
+};
+
+typedef class ReqWrap<uv_work_t> IoVecsWrap;
+
+
+// One system call on the buffers from `iov` on, of which it sets `count` to
+// those it was given.
+static ssize_t IoVecsTransfer(IoVecs* req, struct iovec* iov, int* count) {
+  if (req->pos < 0) {
+    return req->write ? writev(req->fd, iov, *count)
+                      : readv(req->fd, iov, *count);
+  }
+
+#if defined(__linux__) && !defined(ANDROID)
+  return req->write ? pwritev(req->fd, iov, *count, req->pos)
+                    : preadv(req->fd, iov, *count, req->pos);
+#else
+  // No pwritev() and preadv() here, so one buffer at a time.
+  *count = 1;
+  return req->write ? pwrite(req->fd, iov->iov_base, iov->iov_len, req->pos)
+                    : pread(req->fd, iov->iov_base, iov->iov_len, req->pos);
+#endif
+}
+
+
+// Runs on the thread pool for async calls. Writes go on after a short write
+// until all is written, as fs.writeFile() does; reads stop at the first
+// short read, which is the end of the file for regular files. An error after
+// some of the data was transferred only ends the call early, unless the data
+// is to be synced.
+static void IoVecsTransferAll(IoVecs* req) {
+  size_t i = 0;
+
+  while (i < req->iovs.size()) {
+    int count = req->iovs.size() - i;
+    if (count > IOV_MAX) count = IOV_MAX;
+
+    ssize_t n = IoVecsTransfer(req, &req->iovs[i], &count);
+    if (n == -1) {
+      if (errno == EINTR) continue;
+      if (req->result == 0 || req->datasync) req->error = errno;
+      return;
+    }
+
+    size_t wanted = 0;
+    for (int j = 0; j < count; j++) wanted += req->iovs[i + j].iov_len;
+
+    req->result += n;
+    if (req->pos >= 0) req->pos += n;
+
+    // Skip the buffers done and trim the one done in part.
+    size_t left = n;
+    while (i < req->iovs.size() && left >= req->iovs[i].iov_len) {
+      left -= req->iovs[i].iov_len;
+      i++;
+    }
+    if (left > 0) {
+      req->iovs[i].iov_base = static_cast<char*>(req->iovs[i].iov_base) + left;
+      req->iovs[i].iov_len -= left;
+    }
+
+    if (static_cast<size_t>(n) < wanted && (!req->write || n == 0)) {
+      if (req->datasync) req->error = EIO;
+      return;
+    }
+  }
+}
+
+
+static void IoVecsWork(IoVecs* req) {
+  IoVecsTransferAll(req);
+  if (req->error) {
+    req->syscall = req->write ? (req->pos < 0 ? "writev" : "pwritev")
+                              : (req->pos < 0 ? "readv" : "preadv");
+    return;
+  }
+
+  if (req->datasync) {
+#ifdef __APPLE__
+    int r = fsync(req->fd);
+#else
+    int r = fdatasync(req->fd);
+#endif
+    if (r == -1) {
+      req->error = errno;
+      req->syscall = "fdatasync";
+    }
+  }
+}
+
+
+static void IoVecsWork(uv_work_t* req) {
+  IoVecsWrap* req_wrap = static_cast<IoVecsWrap*>(req->data);
+  IoVecsWork(static_cast<IoVecs*>(req_wrap->data_));
+}
+
+
+static Local<Value> IoVecsError(IoVecs* req) {
+  return Isolate::GetCurrent()->ErrnoException(req->error, req->syscall);
+}
+
+
+static void AfterIoVecs(uv_work_t* req) {
+  HandleScope scope;
+
+  IoVecsWrap* req_wrap = static_cast<IoVecsWrap*>(req->data);
+  IoVecs* iovecs = static_cast<IoVecs*>(req_wrap->data_);
+
+  Local<Value> argv[2];
+  if (iovecs->error) {
+    argv[0] = IoVecsError(iovecs);
+    argv[1] = Local<Value>::New(Undefined());
+  } else {
+    argv[0] = Local<Value>::New(Null());
+    argv[1] = Integer::New(iovecs->result);
+  }
+
+  FileStatics *statics = NODE_STATICS_LOOP(node_fs, FileStatics, req->loop);
+  MakeCallback(req_wrap->object_, statics->oncomplete_sym, 2, argv);
+
+  delete iovecs;
+  delete req_wrap;
+}
+
+
+// writev(fd, buffers, position, datasync, [callback])
+// readv(fd, buffers, position, [callback])
+//
+// Writes all of `buffers`, or reads into them in turn, with as few system
+// calls as the platform allows in a single thread pool request,
+// callback(err, bytes). A null position uses the current file position.
+// With datasync the data written is fdatasync()ed by the same request.
+// Without a callback the number of bytes is returned, or the error thrown.
+static Handle<Value> IoVecsCall(const Arguments& args, bool write) {
+  HandleScope scope;
+  FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
+
+  if (args.Length() < 2 || !args[0]->IsInt32() || !args[1]->IsArray()) {
+    return THROW_BAD_ARGS;
+  }
+
+  ASSERT_OFFSET(args[2]);
+
+  Local<Array> buffers = Local<Array>::Cast(args[1]);
+  int count = buffers->Length();
+
+  for (int i = 0; i < count; i++) {
+    if (!Buffer::HasInstance(buffers->Get(i))) {
+      return ThrowException(Exception::TypeError(
+            String::New("Second argument needs to be an array of buffers")));
+    }
+  }
+
+  IoVecs* req = new IoVecs(args[0]->Int32Value(),
+                           write,
+                           GET_OFFSET(args[2]),
+                           count);
+
+  for (int i = 0; i < count; i++) {
+    Local<Object> buffer = buffers->Get(i)->ToObject();
+    req->iovs[i].iov_base = Buffer::Data(buffer);
+    req->iovs[i].iov_len = Buffer::Length(buffer);
+  }
+
+  Local<Value> callback = args[3];
+  if (write) {
+    req->datasync = args[3]->IsTrue();
+    callback = args[4];
+  }
+
+  if (!callback->IsFunction()) {
+    IoVecsWork(req);
+    Local<Value> result = req->error ? IoVecsError(req)
+                                     : Local<Value>(Integer::New(req->result));
+    bool failed = req->error != 0;
+    delete req;
+    if (failed) return ThrowException(result);
+    return scope.Close(result);
+  }
+
+  IoVecsWrap* req_wrap = new IoVecsWrap();
+  req_wrap->data_ = req;
+  req_wrap->object_->Set(statics->oncomplete_sym, callback);
+  // The buffers must outlive the request.
+  req_wrap->object_->Set(statics->buf_symbol, args[1]);
+  // The work callback finds the buffers through req_.data, and may run
+  // before uv_queue_work() returns.
+  req_wrap->Dispatched();
+
+  req_wrap->req_.work_type = WORK_FS;
+  int r = uv_queue_work(Isolate::GetCurrentLoop(),
+                        &req_wrap->req_,
+                        IoVecsWork,
+                        AfterIoVecs);
+  assert(r == 0);
+
+  return scope.Close(req_wrap->object_);
+}
+
+
+static Handle<Value> WriteV(const Arguments& args) {
+  return IoVecsCall(args, true);
+}
+
+
+static Handle<Value> ReadV(const Arguments& args) {
+  return IoVecsCall(args, false);
+}
+#endif  // __POSIX__
+
+
 /* fs.chmod(path, mode);
  * Wrapper for chmod(1) / EIO_CHMOD
  */
@@ -1019,10 +2271,24 @@ void File::Initialize(Handle<Object> target) {
   NODE_SET_METHOD(target, "rmdir", RMDir);
   NODE_SET_METHOD(target, "mkdir", MKDir);
   NODE_SET_METHOD(target, "sendfile", SendFile);
+#ifdef __POSIX__
+  NODE_SET_METHOD(target, "mmap", Mmap);
+#endif
+#ifdef POSIX_FADV_NORMAL
+  NODE_SET_METHOD(target, "fadvise", Fadvise);
+#endif
   NODE_SET_METHOD(target, "readdir", ReadDir);
   NODE_SET_METHOD(target, "stat", Stat);
   NODE_SET_METHOD(target, "lstat", LStat);
   NODE_SET_METHOD(target, "fstat", FStat);
+  NODE_SET_METHOD(target, "statMany", StatMany);
+#ifdef __POSIX__
+  NODE_SET_METHOD(target, "readFile", ReadFile);
+  NODE_SET_METHOD(target, "walk", Walk);
+  FilePrefetch::Initialize(target);
+  NODE_SET_METHOD(target, "writev", WriteV);
+  NODE_SET_METHOD(target, "readv", ReadV);
+#endif
   NODE_SET_METHOD(target, "link", Link);
   NODE_SET_METHOD(target, "symlink", Symlink);
   NODE_SET_METHOD(target, "readlink", ReadLink);
@@ -1048,8 +2314,36 @@ void File::Initialize(Handle<Object> target) {
 void InitFs(Handle<Object> target) {
   HandleScope scope;
   NODE_STATICS_NEW(node_fs, FileStatics, statics);
+  statics->dev_symbol = NODE_PSYMBOL("dev");
+  statics->ino_symbol = NODE_PSYMBOL("ino");
+  statics->mode_symbol = NODE_PSYMBOL("mode");
+  statics->nlink_symbol = NODE_PSYMBOL("nlink");
+  statics->uid_symbol = NODE_PSYMBOL("uid");
+  statics->gid_symbol = NODE_PSYMBOL("gid");
+  statics->rdev_symbol = NODE_PSYMBOL("rdev");
+  statics->size_symbol = NODE_PSYMBOL("size");
+  statics->blksize_symbol = NODE_PSYMBOL("blksize");
+  statics->blocks_symbol = NODE_PSYMBOL("blocks");
+  statics->atime_symbol = NODE_PSYMBOL("atime");
+  statics->mtime_symbol = NODE_PSYMBOL("mtime");
+  statics->ctime_symbol = NODE_PSYMBOL("ctime");
+
   // Initialize the stats object
   Local<FunctionTemplate> stat_templ = FunctionTemplate::New();
+  Local<ObjectTemplate> stat_inst = stat_templ->InstanceTemplate();
+  stat_inst->SetInternalFieldCount(STATS_FIELD_COUNT);
+  stat_inst->SetAccessor(statics->atime_symbol,
+                         StatsTimeGetter,
+                         StatsTimeSetter,
+                         Integer::New(STATS_ATIME));
+  stat_inst->SetAccessor(statics->mtime_symbol,
+                         StatsTimeGetter,
+                         StatsTimeSetter,
+                         Integer::New(STATS_MTIME));
+  stat_inst->SetAccessor(statics->ctime_symbol,
+                         StatsTimeGetter,
+                         StatsTimeSetter,
+                         Integer::New(STATS_CTIME));
   statics->stats_constructor_template = Persistent<FunctionTemplate>::New(stat_templ);
   target->Set(String::NewSymbol("Stats"),
                statics->stats_constructor_template->GetFunction());
@@ -28,8 +28,15 @@
 
 namespace node {
 
+#ifdef __POSIX__
+struct StatPollGroup;
+#endif
+
 class FileStatics : public ModuleStatics {
 public:
+#ifdef __POSIX__
+  FileStatics() : stat_poll_groups(NULL) {}
+#endif
   v8::Persistent<v8::String> encoding_symbol;
   v8::Persistent<v8::String> errno_symbol;
   v8::Persistent<v8::String> buf_symbol;
@@ -53,6 +60,8 @@ public:
   v8::Persistent<v8::String> ctime_symbol;
 #ifdef __POSIX__
   v8::Persistent<v8::FunctionTemplate> stat_watcher_constructor_template;
+  // The StatWatchers that poll, grouped by interval.
+  StatPollGroup* stat_poll_groups;
 #endif
 };
     
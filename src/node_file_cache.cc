@@ -0,0 +1,546 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <node.h>
+#include <node_object_wrap.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#define UNWRAP \
+  assert(!args.Holder().IsEmpty()); \
+  assert(args.Holder()->InternalFieldCount() > 0); \
+  FileCache* cache = \
+      ObjectWrap::Unwrap<FileCache>(args.Holder());
+
+#define FILE_CACHE_DEFAULT_SIZE 256
+
+namespace node {
+
+using v8::Object;
+using v8::Handle;
+using v8::Local;
+using v8::Persistent;
+using v8::Value;
+using v8::HandleScope;
+using v8::FunctionTemplate;
+using v8::Function;
+using v8::String;
+using v8::Integer;
+using v8::Number;
+using v8::Arguments;
+using v8::Context;
+using v8::TryCatch;
+using v8::Exception;
+using v8::ThrowException;
+
+
+// Open files for res.sendFile(), with what a response needs to know about
+// them, least recently used ones closed first.
+//
+//   var cache = new FileCache(max);
+//   cache.open(path, function(err, entry) { ... });  // on the thread pool
+//   var entry = cache.get(path);  // null if not cached
+//   var sent = cache.send(socketFd, entry.id, header);
+//   cache.hold(entry.id); ... cache.release(entry.id);
+//
+// An entry is { id, fd, size, mtime, etag, lastModified }. send() writes the
+// header and then the file to a non-blocking socket on the calling thread,
+// as far as the socket takes them without blocking, and returns the bytes
+// sent. The caller sends the rest the slow way, holding the entry meanwhile
+// so that its fd stays open even if the entry is dropped.
+//
+// Entries are dropped when their file changes. One uv_fs_event_t watches
+// each directory that has cached files, which inotify reports changes to
+// the files in by name. Where watching a directory doesn't report that, an
+// event without a name drops all of the directory's entries, and get()
+// checks the fd with fstat() as well.
+class FileCache : public ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    Local<FunctionTemplate> t = FunctionTemplate::New(New);
+    t->InstanceTemplate()->SetInternalFieldCount(1);
+    t->SetClassName(String::NewSymbol("FileCache"));
+
+    NODE_SET_PROTOTYPE_METHOD(t, "open", Open);
+    NODE_SET_PROTOTYPE_METHOD(t, "get", Get);
+    NODE_SET_PROTOTYPE_METHOD(t, "send", Send);
+    NODE_SET_PROTOTYPE_METHOD(t, "hold", Hold);
+    NODE_SET_PROTOTYPE_METHOD(t, "release", Release);
+
+    target->Set(String::NewSymbol("FileCache"), t->GetFunction());
+  }
+
+ private:
+  struct Dir;
+
+  struct Entry {
+    std::string path;
+    int id;
+    int fd;
+    int64_t size;
+    time_t mtime;
+    char etag[48];
+    char last_modified[32];
+    // the cache's own reference counts as one, see hold()
+    int refs;
+    Dir* dir;
+    Entry* lru_prev;
+    Entry* lru_next;
+  };
+
+  struct Dir {
+    uv_fs_event_t handle;
+    std::string path;
+    int entries;
+    FileCache* cache;
+  };
+
+  struct OpenReq {
+    uv_work_t req;
+    FileCache* cache;
+    std::string path;
+    int fd;
+    int err;
+    struct stat st;
+    Persistent<Function> callback;
+  };
+
+  explicit FileCache(int max)
+      : ObjectWrap(), max_(max), count_(0), lru_head_(NULL), lru_tail_(NULL) {
+    loop_ = Isolate::GetCurrentLoop();
+    Isolate::GetCurrent()->AddCleanupHook(OnIsolateCleanup, this);
+  }
+
+  ~FileCache() {
+    Isolate::GetCurrent()->RemoveCleanupHook(OnIsolateCleanup, this);
+    Clear();
+  }
+
+  static void OnIsolateCleanup(void* arg) {
+    static_cast<FileCache*>(arg)->Clear();
+  }
+
+  // Closes everything, held entries included.
+  void Clear() {
+    for (size_t i = 0; i < entries_.size(); i++) {
+      if (entries_[i]) {
+        close(entries_[i]->fd);
+        delete entries_[i];
+        entries_[i] = NULL;
+      }
+    }
+    files_.clear();
+    lru_head_ = lru_tail_ = NULL;
+    count_ = 0;
+
+    std::map<std::string, Dir*>::iterator it;
+    for (it = dirs_.begin(); it != dirs_.end(); ++it) CloseDir(it->second);
+    dirs_.clear();
+  }
+
+  static Handle<Value> New(const Arguments& args) {
+    HandleScope scope;
+
+    int max = args[0]->Int32Value();
+    FileCache* cache = new FileCache(max > 0 ? max : FILE_CACHE_DEFAULT_SIZE);
+    cache->Wrap(args.This());
+
+    return args.This();
+  }
+
+  // open(path, callback) opens and stats the file on the thread pool, and
+  // calls back with its entry. The entry is null if the file can't be
+  // cached because its directory can't be watched.
+  static Handle<Value> Open(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    if (!args[0]->IsString() || !args[1]->IsFunction()) {
+      return ThrowException(Exception::TypeError(
+          String::New("Bad argument")));
+    }
+
+    String::Utf8Value path(args[0]);
+
+    OpenReq* req = new OpenReq;
+    req->req.data = req;
+    req->cache = cache;
+    req->path = *path;
+    req->fd = -1;
+    req->err = 0;
+    req->callback = Persistent<Function>::New(args[1].As<Function>());
+
+    // Kept alive until the request is done with it.
+    cache->Ref();
+    req->req.work_type = WORK_FS;
+    int r = uv_queue_work(cache->loop_, &req->req, OpenWork, AfterOpen);
+    assert(r == 0);
+
+    return v8::Undefined();
+  }
+
+  static void OpenWork(uv_work_t* work) {
+    OpenReq* req = static_cast<OpenReq*>(work->data);
+
+    req->fd = open(req->path.c_str(), O_RDONLY);
+    if (req->fd < 0) {
+      req->err = errno;
+      return;
+    }
+
+    fcntl(req->fd, F_SETFD, FD_CLOEXEC);
+
+    if (fstat(req->fd, &req->st) < 0) {
+      req->err = errno;
+    } else if (!S_ISREG(req->st.st_mode)) {
+      req->err = S_ISDIR(req->st.st_mode) ? EISDIR : EINVAL;
+    }
+
+    if (req->err) {
+      close(req->fd);
+      req->fd = -1;
+    }
+  }
+
+  static void AfterOpen(uv_work_t* work) {
+    HandleScope scope;
+
+    OpenReq* req = static_cast<OpenReq*>(work->data);
+    FileCache* cache = req->cache;
+
+    Local<Value> argv[2] = { Local<Value>::New(v8::Null()),
+                             Local<Value>::New(v8::Null()) };
+
+    if (req->err) {
+      argv[0] = ErrnoException(req->err, "open", "", req->path.c_str());
+    } else {
+      // Another open() of the same file may have finished first.
+      Entry* entry = cache->Find(req->path);
+      if (entry) {
+        close(req->fd);
+      } else {
+        entry = cache->Insert(req->path, req->fd, &req->st);
+      }
+      if (entry) argv[1] = cache->EntryObject(entry);
+    }
+
+    TryCatch try_catch;
+
+    req->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+
+    if (try_catch.HasCaught())
+      FatalException(try_catch);
+
+    req->callback.Dispose();
+    delete req;
+    cache->Unref();
+  }
+
+  // get(path)
+  static Handle<Value> Get(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    String::Utf8Value path(args[0]);
+    Entry* entry = cache->Find(*path);
+    if (!entry) return scope.Close(v8::Null());
+
+#ifndef __linux__
+    // Only inotify reports changes to the files in a directory.
+    struct stat st;
+    if (fstat(entry->fd, &st) < 0 || st.st_size != entry->size ||
+        st.st_mtime != entry->mtime || st.st_nlink == 0) {
+      cache->Evict(entry);
+      return scope.Close(v8::Null());
+    }
+#endif
+
+    cache->Unlink(entry);
+    cache->PushFront(entry);
+
+    return scope.Close(cache->EntryObject(entry));
+  }
+
+  // send(socketFd, id, header)
+  static Handle<Value> Send(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    int out = args[0]->Int32Value();
+    Entry* entry = cache->Lookup(args[1]->Int32Value());
+    if (!entry) {
+      return ThrowException(Exception::Error(
+          String::New("No file cache entry with that id")));
+    }
+
+    String::AsciiValue header(args[2]);
+    size_t header_length = header.length();
+    size_t sent = 0;
+
+    // Errors are left for the slow way, which reports them as usual.
+    while (sent < header_length) {
+      ssize_t n = write(out, *header + sent, header_length - sent);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      sent += n;
+    }
+
+    if (sent == header_length) {
+      int64_t offset = 0;
+      while (offset < entry->size) {
+        uv_fs_t req;
+        int n = uv_fs_sendfile(cache->loop_, &req, out, entry->fd, offset,
+                               entry->size - offset, NULL);
+        uv_fs_req_cleanup(&req);
+        if (n <= 0) break;
+        offset += n;
+      }
+      sent += offset;
+    }
+
+    return scope.Close(Number::New(static_cast<double>(sent)));
+  }
+
+  // hold(id) keeps the entry's fd open until release(id).
+  static Handle<Value> Hold(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    Entry* entry = cache->Lookup(args[0]->Int32Value());
+    if (entry) entry->refs++;
+
+    return v8::Undefined();
+  }
+
+  static Handle<Value> Release(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    Entry* entry = cache->Lookup(args[0]->Int32Value());
+    if (entry) cache->ReleaseEntry(entry);
+
+    return v8::Undefined();
+  }
+
+  Local<Object> EntryObject(Entry* entry) {
+    HandleScope scope;
+
+    Local<Object> obj = Object::New();
+    obj->Set(String::NewSymbol("id"), Integer::New(entry->id));
+    obj->Set(String::NewSymbol("fd"), Integer::New(entry->fd));
+    obj->Set(String::NewSymbol("size"),
+             Number::New(static_cast<double>(entry->size)));
+    obj->Set(String::NewSymbol("mtime"), NODE_UNIXTIME_V8(entry->mtime));
+    obj->Set(String::NewSymbol("etag"), String::New(entry->etag));
+    obj->Set(String::NewSymbol("lastModified"),
+             String::New(entry->last_modified));
+
+    return scope.Close(obj);
+  }
+
+  Entry* Find(const std::string& path) {
+    std::map<std::string, Entry*>::iterator it = files_.find(path);
+    return it == files_.end() ? NULL : it->second;
+  }
+
+  Entry* Lookup(int id) {
+    if (id < 0 || id >= static_cast<int>(entries_.size())) return NULL;
+    return entries_[id];
+  }
+
+  // Returns NULL, having closed fd, if the directory can't be watched.
+  Entry* Insert(const std::string& path, int fd, struct stat* st) {
+    size_t slash = path.rfind('/');
+    std::string dir_path = slash == std::string::npos ? "." :
+                           slash == 0 ? "/" : path.substr(0, slash);
+
+    Dir* dir = WatchDir(dir_path);
+    if (!dir) {
+      close(fd);
+      return NULL;
+    }
+
+    Entry* entry = new Entry;
+    entry->path = path;
+    entry->fd = fd;
+    entry->size = st->st_size;
+    entry->mtime = st->st_mtime;
+    entry->refs = 1;
+    entry->dir = dir;
+    dir->entries++;
+
+    snprintf(entry->etag, sizeof(entry->etag), "\"%llx-%llx\"",
+             static_cast<unsigned long long>(entry->mtime),
+             static_cast<unsigned long long>(entry->size));
+    struct tm tm;
+    gmtime_r(&entry->mtime, &tm);
+    strftime(entry->last_modified, sizeof(entry->last_modified),
+             "%a, %d %b %Y %H:%M:%S GMT", &tm);
+
+    if (free_ids_.empty()) {
+      entry->id = entries_.size();
+      entries_.push_back(entry);
+    } else {
+      entry->id = free_ids_.back();
+      free_ids_.pop_back();
+      entries_[entry->id] = entry;
+    }
+
+    files_[path] = entry;
+    PushFront(entry);
+    if (++count_ > max_) Evict(lru_tail_);
+
+    return entry;
+  }
+
+  // Drops the entry from the cache; its fd stays open while it is held.
+  void Evict(Entry* entry) {
+    files_.erase(entry->path);
+    Unlink(entry);
+    count_--;
+
+    Dir* dir = entry->dir;
+    entry->dir = NULL;
+    if (--dir->entries == 0) {
+      dirs_.erase(dir->path);
+      CloseDir(dir);
+    }
+
+    ReleaseEntry(entry);
+  }
+
+  void ReleaseEntry(Entry* entry) {
+    if (--entry->refs > 0) return;
+    assert(entry->dir == NULL);
+    close(entry->fd);
+    entries_[entry->id] = NULL;
+    free_ids_.push_back(entry->id);
+    delete entry;
+  }
+
+  void PushFront(Entry* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = lru_head_;
+    if (lru_head_) lru_head_->lru_prev = entry;
+    lru_head_ = entry;
+    if (!lru_tail_) lru_tail_ = entry;
+  }
+
+  void Unlink(Entry* entry) {
+    if (entry->lru_prev) {
+      entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+      lru_head_ = entry->lru_next;
+    }
+    if (entry->lru_next) {
+      entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+      lru_tail_ = entry->lru_prev;
+    }
+  }
+
+  Dir* WatchDir(const std::string& path) {
+    std::map<std::string, Dir*>::iterator it = dirs_.find(path);
+    if (it != dirs_.end()) return it->second;
+
+    Dir* dir = new Dir;
+    dir->path = path;
+    dir->entries = 0;
+    dir->cache = this;
+    dir->handle.data = dir;
+
+    if (uv_fs_event_init(loop_, &dir->handle, path.c_str(), OnDirEvent, 0)) {
+      delete dir;
+      return NULL;
+    }
+    // The cache doesn't keep the loop alive.
+    uv_handle_unref(reinterpret_cast<uv_handle_t*>(&dir->handle));
+
+    dirs_[path] = dir;
+    return dir;
+  }
+
+  static void CloseDir(Dir* dir) {
+    dir->cache = NULL;
+    uv_close(reinterpret_cast<uv_handle_t*>(&dir->handle), OnDirClose);
+  }
+
+  static void OnDirClose(uv_handle_t* handle) {
+    delete static_cast<Dir*>(handle->data);
+  }
+
+  static void OnDirEvent(uv_fs_event_t* handle, const char* filename,
+                         int events, int status) {
+    Dir* dir = static_cast<Dir*>(handle->data);
+    FileCache* cache = dir->cache;
+    if (!cache) return;
+
+    if (filename && status == 0) {
+      Entry* entry = cache->Find(dir->path == "/" ? "/" + std::string(filename)
+                                                  : dir->path + "/" + filename);
+      if (entry) cache->Evict(entry);
+      return;
+    }
+
+    // Don't know which file it was
+    Entry* entry = cache->lru_head_;
+    while (entry) {
+      Entry* next = entry->lru_next;
+      if (entry->dir == dir) cache->Evict(entry);
+      entry = next;
+    }
+  }
+
+  uv_loop_t* loop_;
+  int max_;
+  int count_;
+  std::map<std::string, Entry*> files_;
+  std::map<std::string, Dir*> dirs_;
+  // by id; NULL for free ids
+  std::vector<Entry*> entries_;
+  std::vector<int> free_ids_;
+  // most recently used first
+  Entry* lru_head_;
+  Entry* lru_tail_;
+};
+
+
+}  // namespace node
+
+NODE_MODULE(node_file_cache, node::FileCache::Initialize)
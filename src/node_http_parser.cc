@@ -24,6 +24,8 @@
 #include <v8.h>
 #include <node.h>
 #include <node_buffer.h>
+#include <node_probes.h>
+#include <stream_wrap.h>
 
 #include <http_parser.h>
 
@@ -32,8 +34,15 @@
 #include <strings.h>  /* strcasecmp() */
 #else
 #define strcasecmp _stricmp
+#define strncasecmp _strnicmp
 #endif
 #include <stdlib.h>  /* free() */
+#include <stdio.h>  /* fprintf() */
+#include <time.h>  /* gmtime_r() */
+
+#include <map>
+#include <string>
+#include <vector>
 
 // This is a binding to http_parser (https://github.com/joyent/http-parser)
 // The goal is to decouple sockets from parsing for more javascript-level
@@ -51,12 +60,15 @@ namespace node {
 
 using namespace v8;
     
+class Parser;
+
 class HttpStatics : public ModuleStatics {
 public:
     Persistent<String> on_headers_sym;
     Persistent<String> on_headers_complete_sym;
     Persistent<String> on_body_sym;
     Persistent<String> on_message_complete_sym;
+    Persistent<String> on_batch_sym;
     Persistent<String> delete_sym;
     Persistent<String> get_sym;
     Persistent<String> head_sym;
@@ -91,6 +103,21 @@ public:
     Persistent<String> upgrade_sym;
     Persistent<String> headers_sym;
     Persistent<String> url_sym;
+    Persistent<String> writable_sym;
+    Persistent<String> http_message_sym;
+    Persistent<String> corked_chunks_sym;
+    Persistent<String> handle_sym;
+    Persistent<FunctionTemplate> headers_template;
+    // Well-known header names, lowercased, indexed by header_name_hash().
+    const char* header_names[256];
+    Persistent<String> header_syms[256];
+    // Scratch space for serializeHeaders(), grown as needed.
+    uint16_t* header_buf;
+    size_t header_buf_size;
+    // The Date header for the second in date_time.
+    time_t date_time;
+    char date_line[64];
+    size_t date_len;
     struct http_parser_settings settings;
     // This is a hack to get the current_buffer to the callbacks with the least
     // amount of overhead. Nothing else will run while http_parser_execute()
@@ -98,10 +125,18 @@ public:
     Local<Value>* current_buffer;
     char* current_buffer_data;
     size_t current_buffer_len;
+    // All live parsers, for TrimHttpParsers().
+    Parser* parsers;
     HttpStatics() {
       memset(&settings, 0, sizeof(http_parser_settings));
+      memset(header_names, 0, sizeof(header_names));
+      header_buf = NULL;
+      header_buf_size = 0;
+      date_time = 0;
+      date_len = 0;
       current_buffer = 0;
       current_buffer_data = 0;
+      parsers = NULL;
     }
 };
 
@@ -139,8 +174,7 @@ public:
 
 
 static inline Persistent<String>
-method_to_str(unsigned short m) {
-  HttpStatics *statics = NODE_STATICS_GET(node_http_parser, HttpStatics);
+method_to_str(HttpStatics* statics, unsigned short m) {
   switch (m) {
     case HTTP_DELETE:     return statics->delete_sym;
     case HTTP_GET:        return statics->get_sym;
@@ -171,46 +205,202 @@ method_to_str(unsigned short m) {
 }
 
 
-// helper class for the Parser
-struct StringPtr {
-  StringPtr() {
-    on_heap_ = false;
-    Reset();
+// Header names that get a persistent lowercased symbol, so that common
+// headers do not cost a string allocation per request.
+static const char* const known_header_names[] = {
+  "accept", "accept-charset", "accept-encoding", "accept-language",
+  "accept-ranges", "age", "allow", "authorization", "cache-control",
+  "connection", "content-disposition", "content-encoding",
+  "content-language", "content-length", "content-location", "content-md5",
+  "content-range", "content-type", "cookie", "date", "dnt", "etag", "expect",
+  "expires", "from", "host", "if-match", "if-modified-since",
+  "if-none-match", "if-range", "if-unmodified-since", "keep-alive",
+  "last-modified", "link", "location", "max-forwards", "origin", "pragma",
+  "proxy-authenticate", "proxy-authorization", "proxy-connection", "range",
+  "referer", "retry-after", "server", "set-cookie", "te", "trailer",
+  "transfer-encoding", "upgrade", "user-agent", "vary", "via", "warning",
+  "www-authenticate", "x-forwarded-for", "x-forwarded-proto",
+  "x-requested-with"
+};
+
+
+// A perfect hash for known_header_names, ignoring case. InitHttpParser
+// asserts that no two names share a slot; anything else that hashes to a
+// used slot is told apart by the comparison in HeaderNameToString().
+static inline unsigned header_name_hash(const char* s, size_t len) {
+  return (len + 2 * (s[0] | 0x20) + (s[len - 1] | 0x20) +
+          22 * (s[len / 2] | 0x20)) & 255;
+}
+
+
+// Returns the lowercased header name as a JS string.
+static Handle<String> HeaderNameToString(HttpStatics* statics,
+                                         const char* s,
+                                         size_t len) {
+  if (len == 0) return String::Empty();
+
+  unsigned h = header_name_hash(s, len);
+  const char* known = statics->header_names[h];
+  if (known && strlen(known) == len && strncasecmp(known, s, len) == 0) {
+    return statics->header_syms[h];
+  }
+
+  char stack[256];
+  char* lower = len <= sizeof(stack) ? stack : new char[len];
+  for (size_t i = 0; i < len; i++) {
+    char c = s[i];
+    lower[i] = (c >= 'A' && c <= 'Z') ? c | 0x20 : c;
   }
+  Local<String> name = String::New(lower, len);
+  if (lower != stack) delete[] lower;
+  return name;
+}
 
 
-  ~StringPtr() {
-    Reset();
+// Event types for batch mode, see Parser::Push().
+enum BatchEvent {
+  BATCH_HEADERS = 0,
+  BATCH_HEADERS_COMPLETE,
+  BATCH_BODY,
+  BATCH_MESSAGE_COMPLETE,
+  BATCH_BODY_BUFFER
+};
+
+
+// Storage for the URLs, header fields and values that arrive in more than
+// one piece, which StringPtr can't point into the input for. Chunks double
+// in size from HEADER_ARENA_MIN and are reused for the parser's next
+// message, so a connection stops allocating once its first split header is
+// through. Reset() keeps up to HEADER_ARENA_KEEP bytes of them.
+#define HEADER_ARENA_MIN 1024
+#define HEADER_ARENA_KEEP (16 * 1024)
+
+class HeaderArena {
+ public:
+  HeaderArena() : current_(0), used_(0) {
+  }
+
+
+  ~HeaderArena() {
+    for (size_t i = 0; i < chunks_.size(); i++) delete[] chunks_[i].data;
+  }
+
+
+  char* Alloc(size_t size) {
+    while (current_ < chunks_.size()) {
+      Chunk& chunk = chunks_[current_];
+      if (chunk.size - used_ >= size) {
+        char* p = chunk.data + used_;
+        used_ += size;
+        return p;
+      }
+      current_++;
+      used_ = 0;
+    }
+
+    Chunk chunk;
+    chunk.size = chunks_.empty() ? HEADER_ARENA_MIN : 2 * chunks_.back().size;
+    while (chunk.size < size) chunk.size *= 2;
+    chunk.data = new char[chunk.size];
+    chunks_.push_back(chunk);
+    current_ = chunks_.size() - 1;
+    used_ = size;
+    return chunk.data;
+  }
+
+
+  // Grows the last allocation, which ends at `end`, by `size` bytes if
+  // there is room for them after it.
+  bool Extend(const char* end, size_t size) {
+    if (current_ >= chunks_.size()) return false;
+    Chunk& chunk = chunks_[current_];
+    if (end != chunk.data + used_ || chunk.size - used_ < size) return false;
+    used_ += size;
+    return true;
   }
 
 
+  // Everything allocated so far is free again.
   void Reset() {
-    if (on_heap_) {
-      delete[] str_;
-      on_heap_ = false;
+    size_t kept = 0;
+    size_t i = 0;
+    while (i < chunks_.size() && kept + chunks_[i].size <= HEADER_ARENA_KEEP) {
+      kept += chunks_[i].size;
+      i++;
+    }
+    for (size_t j = i; j < chunks_.size(); j++) delete[] chunks_[j].data;
+    chunks_.resize(i);
+    current_ = 0;
+    used_ = 0;
+  }
+
+
+  // Frees the chunks past the one in use once `keep` bytes are held, and
+  // returns the bytes freed. Allocations still in use stay where they are.
+  size_t Trim(size_t keep) {
+    size_t kept = 0;
+    size_t i = 0;
+    while (i < chunks_.size() &&
+           (i <= current_ || kept + chunks_[i].size <= keep)) {
+      kept += chunks_[i].size;
+      i++;
     }
+    size_t freed = 0;
+    for (size_t j = i; j < chunks_.size(); j++) {
+      freed += chunks_[j].size;
+      delete[] chunks_[j].data;
+    }
+    chunks_.resize(i);
+    return freed;
+  }
+
+
+  size_t Size() const {
+    size_t size = 0;
+    for (size_t i = 0; i < chunks_.size(); i++) size += chunks_[i].size;
+    return size;
+  }
+
+ private:
+  struct Chunk {
+    char* data;
+    size_t size;
+  };
+
+  std::vector<Chunk> chunks_;
+  size_t current_;
+  size_t used_;
+};
+
+
+// helper class for the Parser
+struct StringPtr {
+  StringPtr() {
+    Reset();
+  }
+
 
+  void Reset() {
     str_ = NULL;
     size_ = 0;
+    in_arena_ = false;
   }
 
 
-  void Update(const char* str, size_t size) {
-    if (str_ == NULL)
+  void Update(const char* str, size_t size, HeaderArena* arena) {
+    if (str_ == NULL) {
       str_ = str;
-    else if (on_heap_ || str_ + size != str) {
-      // Non-consecutive input, make a copy on the heap.
-      // TODO Use slab allocation, O(n) allocs is bad.
-      char* s = new char[size_ + size];
+    } else if (!in_arena_ && str_ + size_ == str) {
+      // Consecutive input.
+    } else if (in_arena_ && arena->Extend(str_ + size_, size)) {
+      memcpy(const_cast<char*>(str_) + size_, str, size);
+    } else {
+      // Non-consecutive input, copy it to the arena.
+      char* s = arena->Alloc(size_ + size);
       memcpy(s, str_, size_);
       memcpy(s + size_, str, size);
-
-      if (on_heap_)
-        delete[] str_;
-      else
-        on_heap_ = true;
-
       str_ = s;
+      in_arena_ = true;
     }
     size_ += size;
   }
@@ -225,223 +415,866 @@ struct StringPtr {
 
 
   const char* str_;
-  bool on_heap_;
+  bool in_arena_;
   size_t size_;
 };
 
 
-class Parser : public ObjectWrap {
+// A request's headers for lazy mode. The header bytes are copied into one
+// block when the headers are complete, with the field names lowercased, and
+// a named interceptor turns a header into a JS string only when it is read.
+// The value is stored on the object as an ordinary property from then on,
+// and writes and deletes go to ordinary properties, so the object behaves
+// like the one IncomingMessage._addHeaderLine() fills in.
+class HttpHeaders : public ObjectWrap {
 public:
-  Parser(enum http_parser_type type) : ObjectWrap() {
-    Init(type);
+  static Local<Object> New(HttpStatics* statics,
+                           StringPtr* fields,
+                           StringPtr* values,
+                           int count) {
+    Local<Object> obj = statics->headers_template->GetFunction()->NewInstance();
+    HttpHeaders* headers = ObjectWrap::Unwrap<HttpHeaders>(obj);
+    headers->statics_ = statics;
+
+    size_t size = 0;
+    for (int i = 0; i < count; i++) {
+      size += fields[i].size_ + values[i].size_;
+    }
+
+    char* data = headers->data_ = new char[size];
+    headers->count_ = count;
+
+    for (int i = 0; i < count; i++) {
+      Entry* e = &headers->entries_[i];
+      e->name = data - headers->data_;
+      e->name_len = fields[i].size_;
+      for (size_t j = 0; j < e->name_len; j++) {
+        char c = fields[i].str_[j];
+        *data++ = (c >= 'A' && c <= 'Z') ? c | 0x20 : c;
+      }
+      e->value = data - headers->data_;
+      e->value_len = values[i].size_;
+      memcpy(data, values[i].str_, e->value_len);
+      data += e->value_len;
+      e->pending = true;
+    }
+
+    return obj;
   }
 
 
-  ~Parser() {
+  static void Initialize() {
+    HttpStatics *statics = NODE_STATICS_GET(node_http_parser, HttpStatics);
+
+    Local<FunctionTemplate> t = FunctionTemplate::New(HttpHeaders::Construct);
+    t->SetClassName(String::NewSymbol("HTTPHeaders"));
+    t->InstanceTemplate()->SetInternalFieldCount(1);
+    t->InstanceTemplate()->SetNamedPropertyHandler(HttpHeaders::Getter,
+                                                   HttpHeaders::Setter,
+                                                   HttpHeaders::Query,
+                                                   HttpHeaders::Deleter,
+                                                   HttpHeaders::Enumerator);
+    statics->headers_template = Persistent<FunctionTemplate>::New(t);
   }
 
 
-  HTTP_CB(on_message_begin) {
-    num_fields_ = num_values_ = -1;
-    url_.Reset();
-    return 0;
+private:
+  struct Entry {
+    size_t name;
+    size_t name_len;
+    size_t value;
+    size_t value_len;
+    bool pending;  // not yet read, overwritten or deleted
+  };
+
+
+  HttpHeaders() : ObjectWrap(), statics_(NULL), data_(NULL), count_(0) {
   }
 
 
-  HTTP_DATA_CB(on_url) {
-    url_.Update(at, length);
-    return 0;
+  ~HttpHeaders() {
+    delete[] data_;
   }
 
 
-  HTTP_DATA_CB(on_header_field) {
-    if (num_fields_ == num_values_) {
-      // start of new field name
-      if (++num_fields_ == ARRAY_SIZE(fields_)) {
-        Flush();
-        num_fields_ = 0;
-        num_values_ = -1;
+  static Handle<Value> Construct(const Arguments& args) {
+    HttpHeaders* headers = new HttpHeaders();
+    headers->Wrap(args.This());
+    return args.This();
+  }
+
+
+  // How repeated headers are combined, as in IncomingMessage._addHeaderLine.
+  enum Combine { FIRST, JOIN, ARRAY };
+
+  Combine CombineFor(const Entry* e) const {
+    const char* name = data_ + e->name;
+    static const char* joined[] = {
+      "accept", "accept-charset", "accept-encoding", "accept-language",
+      "connection", "cookie", "pragma", "link"
+    };
+
+    if (e->name_len == 10 && memcmp(name, "set-cookie", 10) == 0)
+      return ARRAY;
+    if (e->name_len >= 2 && name[0] == 'x' && name[1] == '-')
+      return JOIN;
+    for (size_t i = 0; i < ARRAY_SIZE(joined); i++) {
+      if (strlen(joined[i]) == e->name_len &&
+          memcmp(name, joined[i], e->name_len) == 0) {
+        return JOIN;
       }
-      fields_[num_fields_].Reset();
     }
+    return FIRST;
+  }
 
-    assert(num_fields_ < (int)ARRAY_SIZE(fields_));
-    assert(num_fields_ == num_values_ + 1);
-
-    fields_[num_fields_].Update(at, length);
 
-    return 0;
+  bool SameName(const Entry* a, const Entry* b) const {
+    return a->name_len == b->name_len &&
+           memcmp(data_ + a->name, data_ + b->name, a->name_len) == 0;
   }
 
 
-  HTTP_DATA_CB(on_header_value) {
-    if (num_values_ != num_fields_) {
-      // start of new header value
-      values_[++num_values_].Reset();
+  // Returns the first pending entry named `property`, or NULL.
+  Entry* Find(Local<String> property) {
+    uint16_t stack[64];
+    int len = property->Length();
+    uint16_t* name = len <= (int)ARRAY_SIZE(stack) ? stack : new uint16_t[len];
+    property->Write(name, 0, len, String::NO_NULL_TERMINATION);
+
+    Entry* found = NULL;
+    for (int i = 0; i < count_ && found == NULL; i++) {
+      Entry* e = &entries_[i];
+      if (!e->pending || e->name_len != (size_t)len) continue;
+      const unsigned char* s = (const unsigned char*) data_ + e->name;
+      int j = 0;
+      while (j < len && name[j] == s[j]) j++;
+      if (j == len) found = e;
     }
 
-    assert(num_values_ < (int)ARRAY_SIZE(values_));
-    assert(num_values_ == num_fields_);
+    if (name != stack) delete[] name;
+    return found;
+  }
 
-    values_[num_values_].Update(at, length);
 
-    return 0;
+  // Marks `first` and every later entry with its name as no longer pending.
+  void Settle(Entry* first) {
+    for (Entry* e = first; e < entries_ + count_; e++) {
+      if (SameName(e, first)) e->pending = false;
+    }
   }
 
 
-  HTTP_CB(on_headers_complete) {
-    HttpStatics *statics = NODE_STATICS_GET(node_http_parser, HttpStatics);
-    Local<Value> cb = handle_->Get(statics->on_headers_complete_sym);
-
-    if (!cb->IsFunction())
-      return 0;
+  Local<Value> Materialize(Entry* first) {
+    Combine combine = CombineFor(first);
+    Local<String> value = String::New(data_ + first->value, first->value_len);
 
-    Local<Object> message_info = Object::New();
+    if (combine == FIRST) return value;
 
-    if (have_flushed_) {
-      // Slow case, flush remaining headers.
-      Flush();
-    }
-    else {
-      // Fast case, pass headers and URL to JS land.
-      message_info->Set(statics->headers_sym, CreateHeaders());
-      if (parser_.type == HTTP_REQUEST)
-        message_info->Set(statics->url_sym, url_.ToString());
+    Local<Array> array;
+    if (combine == ARRAY) {
+      array = Array::New();
+      array->Set(0, value);
     }
-    num_fields_ = num_values_ = -1;
 
-    // METHOD
-    if (parser_.type == HTTP_REQUEST) {
-      message_info->Set(statics->method_sym, method_to_str(parser_.method));
+    for (Entry* e = first + 1; e < entries_ + count_; e++) {
+      if (!SameName(e, first)) continue;
+      Local<String> next = String::New(data_ + e->value, e->value_len);
+      if (combine == ARRAY) {
+        array->Set(array->Length(), next);
+      } else {
+        value = String::Concat(String::Concat(value, String::New(", ")), next);
+      }
     }
 
-    // STATUS
-    if (parser_.type == HTTP_RESPONSE) {
-      message_info->Set(statics->status_code_sym, Integer::New(parser_.status_code));
-    }
+    if (combine == ARRAY) return array;
+    return value;
+  }
 
-    // VERSION
-    message_info->Set(statics->version_major_sym, Integer::New(parser_.http_major));
-    message_info->Set(statics->version_minor_sym, Integer::New(parser_.http_minor));
 
-    message_info->Set(statics->should_keep_alive_sym,
-        http_should_keep_alive(&parser_) ? True() : False());
+  static Handle<Value> Getter(Local<String> property,
+                              const AccessorInfo& info) {
+    HttpHeaders* self = ObjectWrap::Unwrap<HttpHeaders>(info.Holder());
+    Entry* e = self->Find(property);
+    if (e == NULL) return Handle<Value>();
 
-    message_info->Set(statics->upgrade_sym, parser_.upgrade ? True() : False());
+    HandleScope scope;
+    Local<Value> value = self->Materialize(e);
+    self->Settle(e);
+    info.Holder()->ForceSet(property, value);
+    return scope.Close(value);
+  }
 
-    Local<Value> argv[1] = { message_info };
 
-    Local<Value> head_response =
-        Local<Function>::Cast(cb)->Call(handle_, 1, argv);
+  static Handle<Value> Setter(Local<String> property,
+                              Local<Value> value,
+                              const AccessorInfo& info) {
+    HttpHeaders* self = ObjectWrap::Unwrap<HttpHeaders>(info.Holder());
+    Entry* e = self->Find(property);
+    if (e != NULL) self->Settle(e);
+    // Let V8 store it as an ordinary property.
+    return Handle<Value>();
+  }
 
-    if (head_response.IsEmpty()) {
-      got_exception_ = true;
-      return -1;
+
+  static Handle<Integer> Query(Local<String> property,
+                               const AccessorInfo& info) {
+    HttpHeaders* self = ObjectWrap::Unwrap<HttpHeaders>(info.Holder());
+    if (self->Find(property) == NULL) return Handle<Integer>();
+    return Integer::New(None);
+  }
+
+
+  static Handle<Boolean> Deleter(Local<String> property,
+                                 const AccessorInfo& info) {
+    HttpHeaders* self = ObjectWrap::Unwrap<HttpHeaders>(info.Holder());
+    Entry* e = self->Find(property);
+    if (e == NULL) return Handle<Boolean>();
+    self->Settle(e);
+    return True();
+  }
+
+
+  static Handle<Array> Enumerator(const AccessorInfo& info) {
+    HttpHeaders* self = ObjectWrap::Unwrap<HttpHeaders>(info.Holder());
+    HandleScope scope;
+    Local<Array> names = Array::New();
+
+    for (int i = 0; i < self->count_; i++) {
+      Entry* e = &self->entries_[i];
+      if (!e->pending) continue;
+
+      bool seen = false;
+      for (int j = 0; j < i && !seen; j++) {
+        seen = self->SameName(&self->entries_[j], e);
+      }
+      if (seen) continue;
+
+      names->Set(names->Length(),
+                 HeaderNameToString(self->statics_,
+                                    self->data_ + e->name,
+                                    e->name_len));
     }
 
-    return head_response->IsTrue() ? 1 : 0;
+    return scope.Close(names);
   }
 
 
-  HTTP_DATA_CB(on_body) {
+  HttpStatics* statics_;
+  char* data_;
+  Entry entries_[32];
+  int count_;
+};
+
+
+// Responses that a server answers identical requests with for a while, see
+// ServerResponse#cache(). They are keyed by method, Host and URL, so that
+// virtual hosts sharing a server don't answer for each other, and told apart
+// by the values of the request headers their Vary header names. A request
+// parser given the cache with setResponseCache() writes a matching response
+// to the socket itself instead of passing the request on to JS land.
+class ResponseCache : public ObjectWrap {
+public:
+  struct Entry {
+    // Lowercased request header names, and the values they had.
+    std::vector<std::string> vary_names;
+    std::vector<std::string> vary_values;
+    uint64_t expires;  // in uv_now() time
+    Persistent<Object> header;
+    Persistent<Object> body;
+  };
+
+
+  static void Initialize(Handle<Object> target) {
     HandleScope scope;
-    HttpStatics *statics = NODE_STATICS_GET(node_http_parser, HttpStatics);
 
-    Local<Value> cb = handle_->Get(statics->on_body_sym);
-    if (!cb->IsFunction())
-      return 0;
+    Local<FunctionTemplate> t = FunctionTemplate::New(ResponseCache::New);
+    t->InstanceTemplate()->SetInternalFieldCount(1);
+    t->SetClassName(String::NewSymbol("ResponseCache"));
 
-    Handle<Value> argv[3] = {
-      *statics->current_buffer,
-      Integer::New(at - statics->current_buffer_data),
-      Integer::New(length)
-    };
+    NODE_SET_PROTOTYPE_METHOD(t, "set", ResponseCache::Set);
+    NODE_SET_PROTOTYPE_METHOD(t, "clear", ResponseCache::Clear);
+    NODE_SET_PROTOTYPE_METHOD(t, "stats", ResponseCache::Stats);
 
-    Local<Value> r = Local<Function>::Cast(cb)->Call(handle_, 3, argv);
+    target->Set(String::NewSymbol("ResponseCache"), t->GetFunction());
+  }
 
-    if (r.IsEmpty()) {
-      got_exception_ = true;
-      return -1;
+
+  // The key responses to `method` requests for `url` on `host` are kept
+  // under.
+  static std::string Key(const char* method, size_t method_len,
+                         const char* host, size_t host_len,
+                         const char* url, size_t url_len) {
+    std::string key(method, method_len);
+    key.append(" ");
+    if (host_len > 0) key.append(host, host_len);
+    key.append(" ");
+    if (url_len > 0) key.append(url, url_len);
+    return key;
+  }
+
+
+  // Returns the fresh entry for the request, or NULL. `fields` and `values`
+  // are the request's headers.
+  Entry* Lookup(uv_loop_t* loop,
+                const std::string& key,
+                const StringPtr* fields,
+                const StringPtr* values,
+                int count) {
+    Entries::iterator it = entries_.find(key);
+    if (it == entries_.end()) {
+      misses_++;
+      return NULL;
     }
 
-    return 0;
+    uint64_t now = uv_now(loop);
+    Variants& variants = it->second;
+    for (size_t i = 0; i < variants.size(); i++) {
+      Entry* e = variants[i];
+      if (e->expires <= now) continue;
+      if (VaryMatches(e, fields, values, count)) {
+        hits_++;
+        return e;
+      }
+    }
+
+    misses_++;
+    return NULL;
   }
 
 
-  HTTP_CB(on_message_complete) {
-    HandleScope scope;
-    HttpStatics *statics = NODE_STATICS_GET(node_http_parser, HttpStatics);
+private:
+  typedef std::vector<Entry*> Variants;
+  typedef std::map<std::string, Variants> Entries;
 
-    if (num_fields_ != -1)
-      Flush(); // Flush trailing HTTP headers.
 
-    Local<Value> cb = handle_->Get(statics->on_message_complete_sym);
+  ResponseCache(size_t max_entries)
+      : ObjectWrap(), max_entries_(max_entries), size_(0),
+        hits_(0), misses_(0) {
+  }
 
-    if (!cb->IsFunction())
-      return 0;
 
-    Local<Value> r = Local<Function>::Cast(cb)->Call(handle_, 0, NULL);
+  ~ResponseCache() {
+    DropAll();
+  }
 
-    if (r.IsEmpty()) {
-      got_exception_ = true;
-      return -1;
+
+  static void DeleteEntry(Entry* e) {
+    e->header.Dispose();
+    e->body.Dispose();
+    delete e;
+  }
+
+
+  void DropAll() {
+    for (Entries::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+      for (size_t i = 0; i < it->second.size(); i++) {
+        DeleteEntry(it->second[i]);
+      }
+    }
+    entries_.clear();
+    size_ = 0;
+  }
+
+
+  // Drops the expired entries, and the variants of the first URL in key
+  // order if that wasn't enough to make room for one more.
+  void Evict(uint64_t now) {
+    Entries::iterator it = entries_.begin();
+    while (it != entries_.end()) {
+      Variants& variants = it->second;
+      for (size_t i = 0; i < variants.size(); ) {
+        if (variants[i]->expires <= now) {
+          DeleteEntry(variants[i]);
+          variants.erase(variants.begin() + i);
+          size_--;
+        } else {
+          i++;
+        }
+      }
+      if (variants.empty()) {
+        entries_.erase(it++);
+      } else {
+        ++it;
+      }
     }
 
-    return 0;
+    if (size_ >= max_entries_ && !entries_.empty()) {
+      it = entries_.begin();
+      for (size_t i = 0; i < it->second.size(); i++) {
+        DeleteEntry(it->second[i]);
+      }
+      size_ -= it->second.size();
+      entries_.erase(it);
+    }
   }
 
 
-  static Handle<Value> New(const Arguments& args) {
-    HandleScope scope;
+  // The value of a request header, repeated ones joined with ", ".
+  static std::string HeaderValue(const std::string& name,
+                                 const StringPtr* fields,
+                                 const StringPtr* values,
+                                 int count) {
+    std::string value;
+    bool found = false;
+    for (int i = 0; i < count; i++) {
+      if (fields[i].size_ != name.size() ||
+          strncasecmp(fields[i].str_, name.data(), name.size()) != 0) {
+        continue;
+      }
+      if (found) value.append(", ");
+      value.append(values[i].str_, values[i].size_);
+      found = true;
+    }
+    return value;
+  }
 
-    http_parser_type type =
-        static_cast<http_parser_type>(args[0]->Int32Value());
 
-    if (type != HTTP_REQUEST && type != HTTP_RESPONSE) {
-      return ThrowException(Exception::Error(String::New(
-          "Argument must be HTTPParser.REQUEST or HTTPParser.RESPONSE")));
+  static bool VaryMatches(Entry* e,
+                          const StringPtr* fields,
+                          const StringPtr* values,
+                          int count) {
+    for (size_t i = 0; i < e->vary_names.size(); i++) {
+      if (HeaderValue(e->vary_names[i], fields, values, count) !=
+          e->vary_values[i]) {
+        return false;
+      }
     }
+    return true;
+  }
 
-    Parser* parser = new Parser(type);
-    parser->Wrap(args.This());
+
+  // new ResponseCache(maxEntries)
+  static Handle<Value> New(const Arguments& args) {
+    HandleScope scope;
+
+    size_t max_entries = args[0]->IsUint32() ? args[0]->Uint32Value() : 1000;
+    ResponseCache* cache = new ResponseCache(max_entries);
+    cache->Wrap(args.This());
 
     return args.This();
   }
 
 
-  // var bytesParsed = parser->execute(buffer, off, len);
-  static Handle<Value> Execute(const Arguments& args) {
+  // cache.set(method, host, url, varyNames, varyValues, header, body, ttl)
+  // Replaces the response with the same vary values, if any.
+  static Handle<Value> Set(const Arguments& args) {
     HandleScope scope;
-    HttpStatics *statics = NODE_STATICS_GET(node_http_parser, HttpStatics);
-
-    Parser* parser = ObjectWrap::Unwrap<Parser>(args.This());
 
-    assert(!statics->current_buffer);
-    assert(!statics->current_buffer_data);
+    ResponseCache* cache = ObjectWrap::Unwrap<ResponseCache>(args.This());
 
-    if (statics->current_buffer) {
+    if (!args[3]->IsArray() || !args[4]->IsArray() ||
+        !Buffer::HasInstance(args[5]) || !Buffer::HasInstance(args[6])) {
       return ThrowException(Exception::TypeError(
-            String::New("Already parsing a buffer")));
+            String::New("Bad arguments")));
     }
 
-    Local<Value> buffer_v = args[0];
+    String::Utf8Value method(args[0]);
+    String::Utf8Value host(args[1]);
+    String::Utf8Value url(args[2]);
+    std::string key = Key(*method, method.length(),
+                          *host, host.length(),
+                          *url, url.length());
 
-    if (!Buffer::HasInstance(buffer_v)) {
+    Local<Array> names = Local<Array>::Cast(args[3]);
+    Local<Array> values = Local<Array>::Cast(args[4]);
+    if (names->Length() != values->Length()) {
       return ThrowException(Exception::TypeError(
-            String::New("Argument should be a buffer")));
+            String::New("Bad arguments")));
     }
 
-    Local<Object> buffer_obj = buffer_v->ToObject();
-    char *buffer_data = Buffer::Data(buffer_obj);
-    size_t buffer_len = Buffer::Length(buffer_obj);
+    if (cache->max_entries_ == 0) return Undefined();
 
-    size_t off = args[1]->Int32Value();
-    if (off >= buffer_len) {
-      return ThrowException(Exception::Error(
-            String::New("Offset is out of bounds")));
-    }
+    uint64_t now = uv_now(Isolate::GetCurrentLoop());
+    int64_t ttl = args[7]->IntegerValue();
+    if (ttl <= 0) return Undefined();
 
-    size_t len = args[2]->Int32Value();
+    Entry* e = new Entry();
+    for (uint32_t i = 0; i < names->Length(); i++) {
+      String::Utf8Value name(names->Get(i));
+      String::Utf8Value value(values->Get(i));
+      std::string lower(*name, name.length());
+      for (size_t j = 0; j < lower.size(); j++) {
+        char c = lower[j];
+        if (c >= 'A' && c <= 'Z') lower[j] = c | 0x20;
+      }
+      e->vary_names.push_back(lower);
+      e->vary_values.push_back(std::string(*value, value.length()));
+    }
+    e->expires = now + ttl;
+    e->header = Persistent<Object>::New(args[5]->ToObject());
+    e->body = Persistent<Object>::New(args[6]->ToObject());
+
+    Variants& variants = cache->entries_[key];
+    for (size_t i = 0; i < variants.size(); i++) {
+      if (variants[i]->vary_names == e->vary_names &&
+          variants[i]->vary_values == e->vary_values) {
+        DeleteEntry(variants[i]);
+        variants[i] = e;
+        return Undefined();
+      }
+    }
+
+    if (cache->size_ >= cache->max_entries_) {
+      cache->Evict(now);
+    }
+    // Eviction may have dropped the URL's list.
+    cache->entries_[key].push_back(e);
+    cache->size_++;
+
+    return Undefined();
+  }
+
+
+  static Handle<Value> Clear(const Arguments& args) {
+    HandleScope scope;
+
+    ResponseCache* cache = ObjectWrap::Unwrap<ResponseCache>(args.This());
+    cache->DropAll();
+
+    return Undefined();
+  }
+
+
+  // cache.stats() returns { size, hits, misses }.
+  static Handle<Value> Stats(const Arguments& args) {
+    HandleScope scope;
+
+    ResponseCache* cache = ObjectWrap::Unwrap<ResponseCache>(args.This());
+
+    Local<Object> stats = Object::New();
+    stats->Set(String::NewSymbol("size"), Number::New(cache->size_));
+    stats->Set(String::NewSymbol("hits"), Number::New(cache->hits_));
+    stats->Set(String::NewSymbol("misses"), Number::New(cache->misses_));
+
+    return scope.Close(stats);
+  }
+
+
+  size_t max_entries_;
+  size_t size_;
+  double hits_;
+  double misses_;
+  Entries entries_;
+};
+
+
+// A cached response on its way to the socket. The entry may be replaced or
+// dropped meanwhile, so the write keeps the buffers alive itself.
+struct CachedResponseWrite {
+  uv_write_t req;
+  Persistent<Object> header;
+  Persistent<Object> body;
+
+  static void After(uv_write_t* req, int status) {
+    CachedResponseWrite* w = container_of(req, CachedResponseWrite, req);
+    w->header.Dispose();
+    w->body.Dispose();
+    delete w;
+  }
+};
+
+
+class Parser : public ObjectWrap {
+public:
+  Parser(enum http_parser_type type) : ObjectWrap() {
+    statics_ = NODE_STATICS_GET(node_http_parser, HttpStatics);
+    lower_case_headers_ = false;
+    body_ = NULL;
+    body_size_ = 0;
+    cache_ = NULL;
+    Init(type);
+
+    prev_ = NULL;
+    next_ = statics_->parsers;
+    if (next_) next_->prev_ = this;
+    statics_->parsers = this;
+  }
+
+
+  ~Parser() {
+    free(body_);
+    cache_obj_.Dispose();
+    socket_.Dispose();
+
+    if (prev_) {
+      prev_->next_ = next_;
+    } else {
+      statics_->parsers = next_;
+    }
+    if (next_) next_->prev_ = prev_;
+  }
+
+
+  // Trims the header arenas of the isolate's parsers until they hold no
+  // more than `retain` bytes between them, as far as the messages being
+  // parsed allow. Returns the bytes freed.
+  static size_t TrimArenas(HttpStatics* statics, size_t retain) {
+    size_t kept = 0;
+    size_t freed = 0;
+
+    for (Parser* parser = statics->parsers; parser; parser = parser->next_) {
+      freed += parser->arena_.Trim(retain > kept ? retain - kept : 0);
+      kept += parser->arena_.Size();
+    }
+
+    return freed;
+  }
+
+
+  HTTP_CB(on_message_begin) {
+    num_fields_ = num_values_ = -1;
+    url_.Reset();
+    arena_.Reset();
+    header_bytes_ = 0;
+    body_length_ = 0;
+    body_overflow_ = false;
+    cached_message_ = false;
+    return 0;
+  }
+
+
+  // Counts header bytes against setMaxHeaderSize(). Returns false, and the
+  // callbacks fail the parse, once there are too many.
+  bool CountHeaderBytes(size_t length) {
+    header_bytes_ += length;
+    if (max_header_size_ > 0 && header_bytes_ > max_header_size_) {
+      header_overflow_ = true;
+      return false;
+    }
+    return true;
+  }
+
+
+  HTTP_DATA_CB(on_url) {
+    if (!CountHeaderBytes(length)) return -1;
+    url_.Update(at, length, &arena_);
+    return 0;
+  }
+
+
+  HTTP_DATA_CB(on_header_field) {
+    if (!CountHeaderBytes(length)) return -1;
+
+    if (num_fields_ == num_values_) {
+      // start of new field name
+      if (++num_fields_ == ARRAY_SIZE(fields_)) {
+        Flush();
+        num_fields_ = 0;
+        num_values_ = -1;
+      }
+      fields_[num_fields_].Reset();
+    }
+
+    assert(num_fields_ < (int)ARRAY_SIZE(fields_));
+    assert(num_fields_ == num_values_ + 1);
+
+    fields_[num_fields_].Update(at, length, &arena_);
+
+    return 0;
+  }
+
+
+  HTTP_DATA_CB(on_header_value) {
+    if (!CountHeaderBytes(length)) return -1;
+
+    if (num_values_ != num_fields_) {
+      // start of new header value
+      values_[++num_values_].Reset();
+    }
+
+    assert(num_values_ < (int)ARRAY_SIZE(values_));
+    assert(num_values_ == num_fields_);
+
+    values_[num_values_].Update(at, length, &arena_);
+
+    return 0;
+  }
+
+
+  HTTP_CB(on_headers_complete) {
+    HttpStatics *statics = statics_;
+
+    if (cache_ != NULL) {
+      if (ServeCached()) {
+        cached_message_ = true;
+        num_fields_ = num_values_ = -1;
+        return 0;
+      }
+      delivered_ = true;
+    }
+
+    Local<Value> cb = handle_->Get(statics->on_headers_complete_sym);
+
+    if (!batch_ && !cb->IsFunction())
+      return 0;
+
+    Local<Object> message_info = Object::New();
+
+    if (have_flushed_) {
+      // Slow case, flush remaining headers.
+      Flush();
+    }
+    else {
+      // Fast case, pass headers and URL to JS land.
+      if (lazy_headers_) {
+        message_info->Set(statics->headers_sym,
+                          HttpHeaders::New(statics_,
+                                           fields_,
+                                           values_,
+                                           num_values_ + 1));
+      } else {
+        message_info->Set(statics->headers_sym, CreateHeaders());
+      }
+      if (parser_.type == HTTP_REQUEST)
+        message_info->Set(statics->url_sym, url_.ToString());
+    }
+    num_fields_ = num_values_ = -1;
+
+    // METHOD
+    if (parser_.type == HTTP_REQUEST) {
+      message_info->Set(statics->method_sym,
+                        method_to_str(statics, parser_.method));
+    }
+
+    // STATUS
+    if (parser_.type == HTTP_RESPONSE) {
+      message_info->Set(statics->status_code_sym, Integer::New(parser_.status_code));
+    }
+
+    // VERSION
+    message_info->Set(statics->version_major_sym, Integer::New(parser_.http_major));
+    message_info->Set(statics->version_minor_sym, Integer::New(parser_.http_minor));
+
+    message_info->Set(statics->should_keep_alive_sym,
+        http_should_keep_alive(&parser_) ? True() : False());
+
+    message_info->Set(statics->upgrade_sym, parser_.upgrade ? True() : False());
+
+    if (batch_) {
+      // Only request parsers batch, and a request is never a HEAD response.
+      Push(BATCH_HEADERS_COMPLETE, message_info);
+      return 0;
+    }
+
+    Local<Value> argv[1] = { message_info };
+
+    Local<Value> head_response =
+        Local<Function>::Cast(cb)->Call(handle_, 1, argv);
+
+    if (head_response.IsEmpty()) {
+      got_exception_ = true;
+      return -1;
+    }
+
+    return head_response->IsTrue() ? 1 : 0;
+  }
+
+
+  HTTP_DATA_CB(on_body) {
+    HandleScope scope;
+    HttpStatics *statics = statics_;
+
+    if (cached_message_) return 0;
+
+    if (collect_limit_ > 0 && !body_overflow_) {
+      if (body_length_ + length <= collect_limit_) {
+        CollectBody(at, length);
+        return 0;
+      }
+      // Too large to collect: hand over what we have and stream the rest.
+      body_overflow_ = true;
+      if (EmitCollectedBody() != 0) return -1;
+    }
+
+    return EmitBody(*statics->current_buffer,
+                    at - statics->current_buffer_data,
+                    length);
+  }
+
+
+  HTTP_CB(on_message_complete) {
+    HandleScope scope;
+    HttpStatics *statics = statics_;
+
+    if (cached_message_) return 0;
+
+    if (EmitCollectedBody() != 0) return -1;
+
+    if (num_fields_ != -1)
+      Flush(); // Flush trailing HTTP headers.
+
+    if (batch_) {
+      Push(BATCH_MESSAGE_COMPLETE);
+      return 0;
+    }
+
+    Local<Value> cb = handle_->Get(statics->on_message_complete_sym);
+
+    if (!cb->IsFunction())
+      return 0;
+
+    Local<Value> r = Local<Function>::Cast(cb)->Call(handle_, 0, NULL);
+
+    if (r.IsEmpty()) {
+      got_exception_ = true;
+      return -1;
+    }
+
+    return 0;
+  }
+
+
+  static Handle<Value> New(const Arguments& args) {
+    HandleScope scope;
+
+    http_parser_type type =
+        static_cast<http_parser_type>(args[0]->Int32Value());
+
+    if (type != HTTP_REQUEST && type != HTTP_RESPONSE) {
+      return ThrowException(Exception::Error(String::New(
+          "Argument must be HTTPParser.REQUEST or HTTPParser.RESPONSE")));
+    }
+
+    Parser* parser = new Parser(type);
+    parser->Wrap(args.This());
+
+    return args.This();
+  }
+
+
+  // var bytesParsed = parser->execute(buffer, off, len);
+  static Handle<Value> Execute(const Arguments& args) {
+    HandleScope scope;
+
+    Parser* parser = ObjectWrap::Unwrap<Parser>(args.This());
+    HttpStatics *statics = parser->statics_;
+
+    assert(!statics->current_buffer);
+    assert(!statics->current_buffer_data);
+
+    if (statics->current_buffer) {
+      return ThrowException(Exception::TypeError(
+            String::New("Already parsing a buffer")));
+    }
+
+    Local<Value> buffer_v = args[0];
+
+    if (!Buffer::HasInstance(buffer_v)) {
+      return ThrowException(Exception::TypeError(
+            String::New("Argument should be a buffer")));
+    }
+
+    Local<Object> buffer_obj = buffer_v->ToObject();
+    char *buffer_data = Buffer::Data(buffer_obj);
+    size_t buffer_len = Buffer::Length(buffer_obj);
+
+    size_t off = args[1]->Int32Value();
+    if (off >= buffer_len) {
+      return ThrowException(Exception::Error(
+            String::New("Offset is out of bounds")));
+    }
+
+    size_t len = args[2]->Int32Value();
     if (off+len > buffer_len) {
       return ThrowException(Exception::Error(
             String::New("Length is extends beyond buffer")));
@@ -452,75 +1285,370 @@ public:
     statics->current_buffer_data = buffer_data;
     statics->current_buffer_len = buffer_len;
     parser->got_exception_ = false;
+    parser->delivered_ = false;
+
+    Local<Array> batch;
+    if (parser->batch_mode_) {
+      batch = Array::New();
+      parser->batch_ = &batch;
+      parser->batch_length_ = 0;
+    }
 
     size_t nparsed =
       http_parser_execute(&parser->parser_, &statics->settings, buffer_data + off, len);
 
+    if (NODE_HTTP_PARSER_EXECUTE_ENABLED()) {
+      NODE_HTTP_PARSER_EXECUTE(parser->parser_.type, static_cast<int>(len),
+                               static_cast<int>(nparsed));
+    }
+
+    parser->batch_ = NULL;
+
+    // Deliver the batch while the buffer is still the current one, so that
+    // the handler sees the same state the single callbacks would have.
+    if (parser->batch_mode_ && parser->batch_length_ > 0) {
+      Local<Value> cb = parser->handle_->Get(statics->on_batch_sym);
+      if (cb->IsFunction()) {
+        Local<Value> argv[2] = { batch, buffer_v };
+        Local<Value> r = Local<Function>::Cast(cb)->Call(parser->handle_, 2, argv);
+        if (r.IsEmpty()) parser->got_exception_ = true;
+      }
+    }
+
     // Unassign the 'buffer_' variable
     assert(statics->current_buffer);
     statics->current_buffer = NULL;
     statics->current_buffer_data = NULL;
 
-    // If there was an exception in one of the callbacks
-    if (parser->got_exception_) return Local<Value>();
+    // If there was an exception in one of the callbacks
+    if (parser->got_exception_) return Local<Value>();
+
+    Local<Integer> nparsed_obj = Integer::New(nparsed);
+    // If there was a parse error in one of the callbacks
+    // TODO What if there is an error on EOF?
+    if (!parser->parser_.upgrade && nparsed != len) {
+      Local<Value> e = Exception::Error(String::NewSymbol("Parse Error"));
+      Local<Object> obj = e->ToObject();
+      obj->Set(String::NewSymbol("bytesParsed"), nparsed_obj);
+      if (parser->header_overflow_) {
+        obj->Set(String::NewSymbol("code"),
+                 String::NewSymbol("HPE_HEADER_OVERFLOW"));
+      }
+      return scope.Close(e);
+    } else {
+      return scope.Close(nparsed_obj);
+    }
+  }
+
+
+  static Handle<Value> Finish(const Arguments& args) {
+    HandleScope scope;
+
+    Parser* parser = ObjectWrap::Unwrap<Parser>(args.This());
+    HttpStatics *statics = parser->statics_;
+
+    assert(!statics->current_buffer);
+    parser->got_exception_ = false;
+
+    int rv = http_parser_execute(&(parser->parser_), &statics->settings, NULL, 0);
+
+    if (parser->got_exception_) return Local<Value>();
+
+    if (rv != 0) {
+      Local<Value> e = Exception::Error(String::NewSymbol("Parse Error"));
+      Local<Object> obj = e->ToObject();
+      obj->Set(String::NewSymbol("bytesParsed"), Integer::New(0));
+      return scope.Close(e);
+    }
+
+    return Undefined();
+  }
+
+
+  static Handle<Value> Reinitialize(const Arguments& args) {
+    HandleScope scope;
+
+    http_parser_type type =
+        static_cast<http_parser_type>(args[0]->Int32Value());
+
+    if (type != HTTP_REQUEST && type != HTTP_RESPONSE) {
+      return ThrowException(Exception::Error(String::New(
+          "Argument must be HTTPParser.REQUEST or HTTPParser.RESPONSE")));
+    }
+
+    Parser* parser = ObjectWrap::Unwrap<Parser>(args.This());
+    parser->Init(type);
+
+    return Undefined();
+  }
+
+
+  // parser.setLazyHeaders(true);
+  // Headers that arrive in one piece are then passed to onHeadersComplete as
+  // an object that creates header strings on access, see HttpHeaders.
+  static Handle<Value> SetLazyHeaders(const Arguments& args) {
+    HandleScope scope;
+
+    Parser* parser = ObjectWrap::Unwrap<Parser>(args.This());
+    parser->lazy_headers_ = args[0]->IsTrue();
+
+    return Undefined();
+  }
+
+
+  // parser.setBatchMode(true);
+  // Events from one execute() call are then collected and passed to a single
+  // onBatch(events, buffer) call, see Push(). Only request parsers batch,
+  // since a response parser has to tell onHeadersComplete's result.
+  static Handle<Value> SetBatchMode(const Arguments& args) {
+    HandleScope scope;
+
+    Parser* parser = ObjectWrap::Unwrap<Parser>(args.This());
+    parser->batch_mode_ = args[0]->IsTrue() &&
+                          parser->parser_.type == HTTP_REQUEST;
+
+    return Undefined();
+  }
+
+
+  // parser.setCollectBody(maxBytes);
+  // Bodies of up to maxBytes are then copied together in C++ and passed to
+  // a single onBody(buffer, 0, length) call before onMessageComplete. Larger
+  // bodies are passed on as the collected part followed by the remaining
+  // chunks as they arrive. 0 turns collecting off.
+  static Handle<Value> SetCollectBody(const Arguments& args) {
+    HandleScope scope;
+
+    Parser* parser = ObjectWrap::Unwrap<Parser>(args.This());
+    int64_t limit = args[0]->IntegerValue();
+    parser->collect_limit_ = limit > 0 ? limit : 0;
+
+    return Undefined();
+  }
+
 
-    Local<Integer> nparsed_obj = Integer::New(nparsed);
-    // If there was a parse error in one of the callbacks
-    // TODO What if there is an error on EOF?
-    if (!parser->parser_.upgrade && nparsed != len) {
-      Local<Value> e = Exception::Error(String::NewSymbol("Parse Error"));
-      Local<Object> obj = e->ToObject();
-      obj->Set(String::NewSymbol("bytesParsed"), nparsed_obj);
-      return scope.Close(e);
-    } else {
-      return scope.Close(nparsed_obj);
-    }
+  // parser.setMaxHeaderSize(bytes);
+  // Fails the parse, with an error whose code is 'HPE_HEADER_OVERFLOW', once
+  // a message's URL, header fields and values add up to more than this many
+  // bytes. 0 leaves only http_parser's own limit. Reset by reinitialize().
+  static Handle<Value> SetMaxHeaderSize(const Arguments& args) {
+    HandleScope scope;
+
+    Parser* parser = ObjectWrap::Unwrap<Parser>(args.This());
+    int64_t limit = args[0]->IntegerValue();
+    parser->max_header_size_ = limit > 0 ? limit : 0;
+
+    return Undefined();
   }
 
 
-  static Handle<Value> Finish(const Arguments& args) {
+  // parser.setLowerCaseHeaders(true);
+  // Header names are then passed to JS lowercased, using shared symbols for
+  // the common ones. Unlike the other modes this survives reinitialize().
+  static Handle<Value> SetLowerCaseHeaders(const Arguments& args) {
     HandleScope scope;
-    HttpStatics *statics = NODE_STATICS_GET(node_http_parser, HttpStatics);
 
     Parser* parser = ObjectWrap::Unwrap<Parser>(args.This());
+    parser->lower_case_headers_ = args[0]->IsTrue();
 
-    assert(!statics->current_buffer);
-    parser->got_exception_ = false;
+    return Undefined();
+  }
 
-    int rv = http_parser_execute(&(parser->parser_), &statics->settings, NULL, 0);
 
-    if (parser->got_exception_) return Local<Value>();
+  // parser.setResponseCache(cache, socket);
+  // Requests the ResponseCache has a response for are then answered by
+  // writing it to socket._handle, see ServeCached(). Like the header case
+  // this survives reinitialize(); setResponseCache(null) turns it off.
+  static Handle<Value> SetResponseCache(const Arguments& args) {
+    HandleScope scope;
 
-    if (rv != 0) {
-      Local<Value> e = Exception::Error(String::NewSymbol("Parse Error"));
-      Local<Object> obj = e->ToObject();
-      obj->Set(String::NewSymbol("bytesParsed"), Integer::New(0));
-      return scope.Close(e);
+    Parser* parser = ObjectWrap::Unwrap<Parser>(args.This());
+
+    parser->cache_obj_.Dispose();
+    parser->cache_obj_.Clear();
+    parser->socket_.Dispose();
+    parser->socket_.Clear();
+    parser->cache_ = NULL;
+
+    if (args[0]->IsObject() && args[1]->IsObject()) {
+      Local<Object> cache_obj = args[0]->ToObject();
+      assert(cache_obj->InternalFieldCount() > 0);
+      parser->cache_ = ObjectWrap::Unwrap<ResponseCache>(cache_obj);
+      parser->cache_obj_ = Persistent<Object>::New(cache_obj);
+      parser->socket_ = Persistent<Object>::New(args[1]->ToObject());
     }
 
     return Undefined();
   }
 
 
-  static Handle<Value> Reinitialize(const Arguments& args) {
+private:
+
+  // Writes the cached response to the current request, if there is one and
+  // nothing else can be in the way: the request is a keep-alive HTTP/1.1
+  // GET or HEAD without a body, and the socket has no response of JS land's
+  // in flight, as _httpMessage would be, or held back by cork().
+  bool ServeCached() {
+    if (delivered_ || have_flushed_ || parser_.upgrade) return false;
+    if (parser_.method != HTTP_GET && parser_.method != HTTP_HEAD) {
+      return false;
+    }
+    if (parser_.http_major != 1 || parser_.http_minor != 1) return false;
+    if (!http_should_keep_alive(&parser_)) return false;
+    if ((parser_.flags & F_CHUNKED) || parser_.content_length > 0) {
+      return false;
+    }
+
     HandleScope scope;
+    HttpStatics *statics = statics_;
+
+    if (!socket_->Get(statics->writable_sym)->IsTrue()) return false;
+    Local<Value> message = socket_->Get(statics->http_message_sym);
+    if (!message->IsNull() && !message->IsUndefined()) return false;
+    Local<Value> corked = socket_->Get(statics->corked_chunks_sym);
+    if (!corked->IsNull() && !corked->IsUndefined()) return false;
+
+    Local<Value> handle_v = socket_->Get(statics->handle_sym);
+    if (!handle_v->IsObject()) return false;
+    Local<Object> handle = handle_v->ToObject();
+    if (handle->InternalFieldCount() == 0) return false;
+    StreamWrap* wrap =
+        static_cast<StreamWrap*>(handle->GetPointerFromInternalField(0));
+    if (wrap == NULL || wrap->GetHandle() == NULL) return false;
+    uv_stream_t* stream = wrap->GetStream();
+
+    // Like IncomingMessage#headers, the first Host header counts.
+    const char* host = "";
+    size_t host_len = 0;
+    for (int i = 0; i < num_values_ + 1; i++) {
+      if (fields_[i].size_ == 4 &&
+          strncasecmp(fields_[i].str_, "host", 4) == 0) {
+        host = values_[i].str_;
+        host_len = values_[i].size_;
+        break;
+      }
+    }
 
-    http_parser_type type =
-        static_cast<http_parser_type>(args[0]->Int32Value());
+    const char* method = parser_.method == HTTP_GET ? "GET" : "HEAD";
+    std::string key = ResponseCache::Key(method, strlen(method),
+                                         host, host_len,
+                                         url_.str_, url_.size_);
+
+    ResponseCache::Entry* e =
+        cache_->Lookup(stream->loop, key, fields_, values_, num_values_ + 1);
+    if (e == NULL) return false;
+
+    CachedResponseWrite* w = new CachedResponseWrite();
+    w->header = Persistent<Object>::New(e->header);
+    w->body = Persistent<Object>::New(e->body);
+
+    uv_buf_t bufs[2];
+    int count = 1;
+    bufs[0] = uv_buf_init(Buffer::Data(w->header), Buffer::Length(w->header));
+    if (Buffer::Length(w->body) > 0) {
+      bufs[1] = uv_buf_init(Buffer::Data(w->body), Buffer::Length(w->body));
+      count = 2;
+    }
 
-    if (type != HTTP_REQUEST && type != HTTP_RESPONSE) {
-      return ThrowException(Exception::Error(String::New(
-          "Argument must be HTTPParser.REQUEST or HTTPParser.RESPONSE")));
+    if (uv_write(&w->req, stream, bufs, count, CachedResponseWrite::After)) {
+      w->header.Dispose();
+      w->body.Dispose();
+      delete w;
+      return false;
     }
 
-    Parser* parser = ObjectWrap::Unwrap<Parser>(args.This());
-    parser->Init(type);
+    return true;
+  }
 
-    return Undefined();
+
+  int EmitBody(Handle<Value> buffer, size_t start, size_t length) {
+    HttpStatics *statics = statics_;
+
+    if (batch_) {
+      if (statics->current_buffer && buffer == *statics->current_buffer) {
+        Push(BATCH_BODY, Integer::New(start), Integer::New(length));
+      } else {
+        Push(BATCH_BODY_BUFFER, buffer);
+      }
+      return 0;
+    }
+
+    Local<Value> cb = handle_->Get(statics->on_body_sym);
+    if (!cb->IsFunction())
+      return 0;
+
+    Handle<Value> argv[3] = {
+      buffer,
+      Integer::New(start),
+      Integer::New(length)
+    };
+
+    Local<Value> r = Local<Function>::Cast(cb)->Call(handle_, 3, argv);
+
+    if (r.IsEmpty()) {
+      got_exception_ = true;
+      return -1;
+    }
+
+    return 0;
   }
 
 
-private:
+  void CollectBody(const char* at, size_t length) {
+    if (body_length_ + length > body_size_) {
+      size_t size = body_size_ ? body_size_ : 16 * 1024;
+      while (size < body_length_ + length) size *= 2;
+      if (size > collect_limit_) size = collect_limit_;
+
+      char* body = static_cast<char*>(realloc(body_, size));
+      if (body == NULL) {
+        fprintf(stderr, "ERROR: out of memory\n");
+        abort();
+      }
+      body_ = body;
+      body_size_ = size;
+    }
+
+    memcpy(body_ + body_length_, at, length);
+    body_length_ += length;
+  }
+
+
+  static void FreeBody(char* data, void* hint) {
+    free(data);
+  }
+
+
+  // Passes the collected body on as one Buffer, which takes over the memory.
+  int EmitCollectedBody() {
+    if (body_length_ == 0) return 0;
+
+    HandleScope scope;
+    size_t length = body_length_;
+    Buffer* buffer = Buffer::New(body_, length, FreeBody, NULL);
+    body_ = NULL;
+    body_size_ = 0;
+    body_length_ = 0;
+
+    return EmitBody(buffer->handle_, 0, length);
+  }
+
+
+  // Appends an event to the batch as three slots: type, then two arguments.
+  //   BATCH_HEADERS           headers, url         (like onHeaders)
+  //   BATCH_HEADERS_COMPLETE  info                 (like onHeadersComplete)
+  //   BATCH_BODY              start, length        (like onBody)
+  //   BATCH_BODY_BUFFER       buffer               (a collected body)
+  //   BATCH_MESSAGE_COMPLETE                       (like onMessageComplete)
+  void Push(int type,
+            Handle<Value> a = Handle<Value>(),
+            Handle<Value> b = Handle<Value>()) {
+    Local<Array> batch = *batch_;
+    batch->Set(batch_length_++, Integer::New(type));
+    batch->Set(batch_length_++, a.IsEmpty() ? Handle<Value>(Undefined()) : a);
+    batch->Set(batch_length_++, b.IsEmpty() ? Handle<Value>(Undefined()) : b);
+  }
+
 
   Local<Array> CreateHeaders() {
     // num_values_ is either -1 or the entry # of the last header
@@ -528,7 +1656,13 @@ private:
     Local<Array> headers = Array::New(2 * (num_values_ + 1));
 
     for (int i = 0; i < num_values_ + 1; ++i) {
-      headers->Set(2 * i, fields_[i].ToString());
+      if (lower_case_headers_) {
+        headers->Set(2 * i, HeaderNameToString(statics_,
+                                               fields_[i].str_,
+                                               fields_[i].size_));
+      } else {
+        headers->Set(2 * i, fields_[i].ToString());
+      }
       headers->Set(2 * i + 1, values_[i].ToString());
     }
 
@@ -539,7 +1673,15 @@ private:
   // spill headers and request path to JS land
   void Flush() {
     HandleScope scope;
-    HttpStatics *statics = NODE_STATICS_GET(node_http_parser, HttpStatics);
+    HttpStatics *statics = statics_;
+
+    if (batch_) {
+      Push(BATCH_HEADERS, CreateHeaders(), url_.ToString());
+      url_.Reset();
+      arena_.Reset();
+      have_flushed_ = true;
+      return;
+    }
 
     Local<Value> cb = handle_->Get(statics->on_headers_sym);
 
@@ -557,31 +1699,556 @@ private:
       got_exception_ = true;
 
     url_.Reset();
+    arena_.Reset();
     have_flushed_ = true;
   }
 
 
   void Init(enum http_parser_type type) {
     http_parser_init(&parser_, type);
+    lazy_headers_ = false;
+    batch_mode_ = false;
+    batch_ = NULL;
+    collect_limit_ = 0;
+    body_length_ = 0;
+    body_overflow_ = false;
     url_.Reset();
+    arena_.Reset();
+    header_bytes_ = 0;
+    max_header_size_ = 0;
+    header_overflow_ = false;
     num_fields_ = -1;
     num_values_ = -1;
     have_flushed_ = false;
     got_exception_ = false;
+    delivered_ = false;
+    cached_message_ = false;
   }
 
 
   http_parser parser_;
+  // Looked up once here rather than through the current isolate on every
+  // callback.
+  HttpStatics* statics_;
   StringPtr fields_[32];  // header fields
   StringPtr values_[32];  // header values
   StringPtr url_;
+  HeaderArena arena_;
+  // Bytes of URL, header fields and values of the current message, and the
+  // most setMaxHeaderSize() allows, 0 for no limit of our own.
+  size_t header_bytes_;
+  size_t max_header_size_;
+  bool header_overflow_;
   int num_fields_;
   int num_values_;
   bool have_flushed_;
   bool got_exception_;
+  bool lazy_headers_;
+  bool lower_case_headers_;
+  bool batch_mode_;
+  // Set while Execute() runs in batch mode.
+  Local<Array>* batch_;
+  uint32_t batch_length_;
+  // Body collected by setCollectBody().
+  size_t collect_limit_;
+  char* body_;
+  size_t body_size_;
+  size_t body_length_;
+  bool body_overflow_;
+  // Set by setResponseCache().
+  ResponseCache* cache_;
+  Persistent<Object> cache_obj_;
+  Persistent<Object> socket_;
+  // A request of this execute() call went to JS land.
+  bool delivered_;
+  // The current request was answered from the cache.
+  bool cached_message_;
+  // Neighbours in statics_->parsers.
+  Parser* prev_;
+  Parser* next_;
+};
+
+
+// Flags for serializeHeaders(). The first group describes the message, the
+// second one is reported back through the result array.
+enum HeaderFlags {
+  HEADER_KEEP_ALIVE          = 0x01,  // shouldKeepAlive
+  HEADER_CHUNKED_BY_DEFAULT  = 0x02,  // useChunkedEncodingByDefault
+  HEADER_HAS_AGENT           = 0x04,
+  HEADER_HAS_BODY            = 0x08,
+  HEADER_SEND_DATE           = 0x10,
+
+  HEADER_LAST                = 0x100,  // close the connection afterwards
+  HEADER_SET_KEEP_ALIVE      = 0x200,
+  HEADER_CHUNKED             = 0x400,
+  HEADER_NOT_CHUNKED         = 0x800,
+  HEADER_EXPECT              = 0x1000,
+
+  // Used only while serializing.
+  HEADER_SENT_CONNECTION         = 0x10000,
+  HEADER_SENT_TRANSFER_ENCODING  = 0x20000,
+  HEADER_SENT_CONTENT_LENGTH     = 0x40000
+};
+
+
+// Builds a header block as UTF-16 in the isolate's scratch buffer, so the
+// result is a single flat string however many fields there are.
+class HeaderWriter {
+public:
+  HeaderWriter(HttpStatics* statics) : statics_(statics), pos_(0) {
+  }
+
+
+  void Append(Handle<String> s) {
+    int len = s->Length();
+    Reserve(len);
+    s->Write(statics_->header_buf + pos_, 0, len, String::NO_NULL_TERMINATION);
+    pos_ += len;
+  }
+
+
+  void Append(const char* s, size_t len) {
+    Reserve(len);
+    for (size_t i = 0; i < len; i++) {
+      statics_->header_buf[pos_++] = (unsigned char) s[i];
+    }
+  }
+
+
+  // Whether the text in [start, end) contains `needle`, which must be
+  // lowercase, ignoring case. Mirrors the unanchored /needle/i tests the JS
+  // serializer used.
+  bool Contains(size_t start, size_t end, const char* needle) const {
+    const uint16_t* s = statics_->header_buf;
+    size_t n = strlen(needle);
+
+    for (size_t i = start; i + n <= end; i++) {
+      size_t j = 0;
+      while (j < n && Lower(s[i + j]) == needle[j]) j++;
+      if (j == n) return true;
+    }
+    return false;
+  }
+
+
+  bool Equals(size_t start, size_t end, const char* needle) const {
+    return end - start == strlen(needle) && Contains(start, end, needle);
+  }
+
+
+  size_t Position() const {
+    return pos_;
+  }
+
+
+  Local<String> ToString() const {
+    return String::New(statics_->header_buf, pos_);
+  }
+
+
+private:
+  static uint16_t Lower(uint16_t c) {
+    return (c >= 'A' && c <= 'Z') ? c | 0x20 : c;
+  }
+
+
+  void Reserve(size_t n) {
+    if (pos_ + n <= statics_->header_buf_size) return;
+
+    size_t size = statics_->header_buf_size ? statics_->header_buf_size : 4096;
+    while (size < pos_ + n) size *= 2;
+
+    uint16_t* buf = new uint16_t[size];
+    memcpy(buf, statics_->header_buf, pos_ * sizeof(uint16_t));
+    delete[] statics_->header_buf;
+    statics_->header_buf = buf;
+    statics_->header_buf_size = size;
+  }
+
+
+  HttpStatics* statics_;
+  size_t pos_;
 };
 
 
+static inline char* FormatDigits(char* p, int value, int width) {
+  for (int i = width - 1; i >= 0; i--) {
+    p[i] = '0' + value % 10;
+    value /= 10;
+  }
+  return p + width;
+}
+
+
+// Appends "Date: <RFC 1123 date>\r\n", formatted at most once a second.
+static void AppendDate(HeaderWriter* writer, HttpStatics* statics) {
+  static const char days[] = "SunMonTueWedThuFriSat";
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+  time_t now = time(NULL);
+
+  if (now != statics->date_time) {
+    struct tm tm;
+#if defined(_MSC_VER)
+    gmtime_s(&tm, &now);
+#else
+    gmtime_r(&now, &tm);
+#endif
+
+    char* p = statics->date_line;
+    memcpy(p, "Date: ", 6); p += 6;
+    memcpy(p, days + 3 * tm.tm_wday, 3); p += 3;
+    memcpy(p, ", ", 2); p += 2;
+    p = FormatDigits(p, tm.tm_mday, 2);
+    *p++ = ' ';
+    memcpy(p, months + 3 * tm.tm_mon, 3); p += 3;
+    *p++ = ' ';
+    p = FormatDigits(p, tm.tm_year + 1900, 4);
+    *p++ = ' ';
+    p = FormatDigits(p, tm.tm_hour, 2);
+    *p++ = ':';
+    p = FormatDigits(p, tm.tm_min, 2);
+    *p++ = ':';
+    p = FormatDigits(p, tm.tm_sec, 2);
+    memcpy(p, " GMT\r\n", 6); p += 6;
+
+    statics->date_len = p - statics->date_line;
+    statics->date_time = now;
+  }
+
+  writer->Append(statics->date_line, statics->date_len);
+}
+
+
+// Writes "field: value\r\n" and notes the fields that affect framing.
+// Returns false if converting the field or value to a string threw.
+static bool StoreHeader(HeaderWriter* writer,
+                        Handle<Value> field_v,
+                        Handle<Value> value_v,
+                        int* flags,
+                        bool* sent_date) {
+  HandleScope scope;
+
+  Local<String> field = field_v->ToString();
+  if (field.IsEmpty()) return false;
+  Local<String> value = value_v->ToString();
+  if (value.IsEmpty()) return false;
+
+  size_t field_start = writer->Position();
+  writer->Append(field);
+  size_t field_end = writer->Position();
+  writer->Append(": ", 2);
+  size_t value_start = writer->Position();
+  writer->Append(value);
+  size_t value_end = writer->Position();
+  writer->Append("\r\n", 2);
+
+  if (writer->Contains(field_start, field_end, "connection")) {
+    *flags |= HEADER_SENT_CONNECTION;
+    if (writer->Contains(value_start, value_end, "close")) {
+      *flags |= HEADER_LAST;
+    } else {
+      *flags |= HEADER_SET_KEEP_ALIVE;
+    }
+  } else if (writer->Contains(field_start, field_end, "transfer-encoding")) {
+    *flags |= HEADER_SENT_TRANSFER_ENCODING;
+    if (writer->Contains(value_start, value_end, "chunk")) {
+      *flags |= HEADER_CHUNKED;
+    }
+  } else if (writer->Contains(field_start, field_end, "content-length")) {
+    *flags |= HEADER_SENT_CONTENT_LENGTH;
+  } else if (writer->Contains(field_start, field_end, "expect")) {
+    *flags |= HEADER_EXPECT;
+  } else if (writer->Equals(field_start, field_end, "date")) {
+    *sent_date = true;
+  }
+
+  return true;
+}
+
+
+// Stores one field, or one line per element when the value is an array.
+static bool StoreHeaders(HeaderWriter* writer,
+                         Handle<Value> field,
+                         Handle<Value> value,
+                         int* flags,
+                         bool* sent_date) {
+  if (!value->IsArray()) {
+    return StoreHeader(writer, field, value, flags, sent_date);
+  }
+
+  Handle<Array> values = Handle<Array>::Cast(value);
+  for (uint32_t i = 0; i < values->Length(); i++) {
+    if (!StoreHeader(writer, field, values->Get(i), flags, sent_date)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+// var header = serializeHeaders(firstLine, headers, flags, result);
+// `headers` is an object of field: value pairs or an array of [field, value]
+// pairs; values that are arrays give one line each. Adds the Connection,
+// Transfer-Encoding and Date fields the message needs, and stores the
+// HEADER_* flags for the caller in result[0].
+static Handle<Value> SerializeHeaders(const Arguments& args) {
+  HandleScope scope;
+  HttpStatics *statics = NODE_STATICS_GET(node_http_parser, HttpStatics);
+
+  if (!args[0]->IsString() || !args[3]->IsArray()) {
+    return ThrowException(Exception::TypeError(
+          String::New("Bad argument")));
+  }
+
+  int in = args[2]->Int32Value();
+  int flags = 0;
+  bool sent_date = false;
+  HeaderWriter writer(statics);
+
+  writer.Append(args[0]->ToString());
+
+  if (args[1]->IsArray()) {
+    Local<Array> headers = Local<Array>::Cast(args[1]);
+    for (uint32_t i = 0; i < headers->Length(); i++) {
+      Local<Object> pair = headers->Get(i)->ToObject();
+      if (pair.IsEmpty()) return Local<Value>();
+      if (!StoreHeaders(&writer, pair->Get(0), pair->Get(1),
+                        &flags, &sent_date)) {
+        return Local<Value>();
+      }
+    }
+  } else if (args[1]->IsObject()) {
+    Local<Object> headers = args[1]->ToObject();
+    Local<Array> keys = headers->GetOwnPropertyNames();
+    for (uint32_t i = 0; i < keys->Length(); i++) {
+      Local<Value> key = keys->Get(i);
+      if (!StoreHeaders(&writer, key, headers->Get(key),
+                        &flags, &sent_date)) {
+        return Local<Value>();
+      }
+    }
+  }
+
+  // keep-alive logic
+  if (!(flags & HEADER_SENT_CONNECTION)) {
+    if ((in & HEADER_KEEP_ALIVE) &&
+        (flags & HEADER_SENT_CONTENT_LENGTH ||
+         in & (HEADER_CHUNKED_BY_DEFAULT | HEADER_HAS_AGENT))) {
+      writer.Append("Connection: keep-alive\r\n", 24);
+    } else {
+      flags |= HEADER_LAST;
+      writer.Append("Connection: close\r\n", 19);
+    }
+  }
+
+  if (!(flags & (HEADER_SENT_CONTENT_LENGTH | HEADER_SENT_TRANSFER_ENCODING))) {
+    if (in & HEADER_HAS_BODY) {
+      if (in & HEADER_CHUNKED_BY_DEFAULT) {
+        writer.Append("Transfer-Encoding: chunked\r\n", 28);
+        flags |= HEADER_CHUNKED;
+      } else {
+        flags |= HEADER_LAST;
+      }
+    } else {
+      // Make sure we don't end the 0\r\n\r\n at the end of the message.
+      flags |= HEADER_NOT_CHUNKED;
+    }
+  }
+
+  if ((in & HEADER_SEND_DATE) && !sent_date) {
+    AppendDate(&writer, statics);
+  }
+
+  writer.Append("\r\n", 2);
+
+  Local<Array> result = Local<Array>::Cast(args[3]);
+  result->Set(0, Integer::New(flags & ~(HEADER_SENT_CONNECTION |
+                                       HEADER_SENT_TRANSFER_ENCODING |
+                                       HEADER_SENT_CONTENT_LENGTH)));
+
+  return scope.Close(writer.ToString());
+}
+
+
+static inline int HexValue(uint16_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+
+// Percent-decodes s[start, end) into `out`, which must have room for
+// end - start bytes, and returns the result decoded as UTF-8. Malformed
+// escapes are kept as they are and characters are truncated to a byte,
+// exactly like querystring.unescapeBuffer() followed by toString().
+static Local<String> DecodeComponent(const uint16_t* s,
+                                     int start,
+                                     int end,
+                                     bool decode_spaces,
+                                     char* out) {
+  int n = 0;
+
+  for (int i = start; i < end; i++) {
+    uint16_t c = s[i];
+
+    if (c == '%') {
+      out[n++] = '%';
+      if (i + 1 == end) break;
+      int hi = HexValue(s[i + 1]);
+      if (hi < 0) {
+        out[n++] = static_cast<char>(s[++i]);
+        continue;
+      }
+      if (i + 2 == end) {
+        out[n++] = static_cast<char>(s[i + 1]);
+        break;
+      }
+      int lo = HexValue(s[i + 2]);
+      if (lo < 0) {
+        out[n++] = static_cast<char>(s[i + 1]);
+        out[n++] = static_cast<char>(s[i + 2]);
+        i += 2;
+        continue;
+      }
+      out[n - 1] = static_cast<char>(hi * 16 + lo);
+      i += 2;
+    } else if (c == '+' && decode_spaces) {
+      out[n++] = ' ';
+    } else {
+      out[n++] = static_cast<char>(c);
+    }
+  }
+
+  return String::New(out, n);
+}
+
+
+// Index of the first occurrence of `needle` in s[start, end), or -1.
+static inline int FindString(const uint16_t* s,
+                             int start,
+                             int end,
+                             const uint16_t* needle,
+                             int needle_len) {
+  for (int i = start; i + needle_len <= end; i++) {
+    if (s[i] == needle[0] &&
+        memcmp(s + i, needle, needle_len * sizeof(*s)) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+static inline bool IsProtoKey(Handle<String> key) {
+  if (key->Length() != 9) return false;
+  static const char proto[] = "__proto__";
+  uint16_t buf[9];
+  key->Write(buf, 0, 9, String::NO_NULL_TERMINATION);
+  for (int i = 0; i < 9; i++) {
+    if (buf[i] != proto[i]) return false;
+  }
+  return true;
+}
+
+
+// var str = urlDecode(str, decodeSpaces);
+static Handle<Value> UrlDecode(const Arguments& args) {
+  HandleScope scope;
+
+  if (!args[0]->IsString()) {
+    return ThrowException(Exception::TypeError(
+          String::New("Bad argument")));
+  }
+
+  String::Value str(args[0]);
+  char* out = new char[str.length() + 1];
+  Local<String> result = DecodeComponent(*str, 0, str.length(),
+                                         args[1]->BooleanValue(), out);
+  delete[] out;
+
+  return scope.Close(result);
+}
+
+
+// var obj = parseQueryString(qs, sep, eq);
+// The native form of querystring.parse(): splits on the (non-empty) sep and
+// eq strings and decodes every key and value in a single pass over qs.
+static Handle<Value> ParseQueryString(const Arguments& args) {
+  HandleScope scope;
+
+  if (!args[0]->IsString() || !args[1]->IsString() || !args[2]->IsString()) {
+    return ThrowException(Exception::TypeError(
+          String::New("Bad argument")));
+  }
+
+  String::Value qs(args[0]);
+  String::Value sep(args[1]);
+  String::Value eq(args[2]);
+
+  if (sep.length() == 0 || eq.length() == 0) {
+    return ThrowException(Exception::TypeError(
+          String::New("Bad argument")));
+  }
+
+  Local<Object> obj = Object::New();
+  int len = qs.length();
+  if (len == 0) return scope.Close(obj);
+
+  char* out = new char[len];
+  int start = 0;
+
+  for (;;) {
+    int end = FindString(*qs, start, len, *sep, sep.length());
+    if (end < 0) end = len;
+
+    int key_end = FindString(*qs, start, end, *eq, eq.length());
+    int value_start;
+    if (key_end < 0) {
+      key_end = end;
+      value_start = end;
+    } else {
+      value_start = key_end + eq.length();
+    }
+
+    Local<String> key = DecodeComponent(*qs, start, key_end, true, out);
+    Local<String> value = DecodeComponent(*qs, value_start, end, true, out);
+
+    if (IsProtoKey(key)) {
+      // obj.__proto__ = value is a no-op for string values in JS; Set()
+      // would create an own property instead.
+    } else if (!obj->HasOwnProperty(key)) {
+      obj->Set(key, value);
+    } else {
+      Local<Value> current = obj->Get(key);
+      if (current->IsArray()) {
+        Local<Array> values = Local<Array>::Cast(current);
+        values->Set(values->Length(), value);
+      } else {
+        Local<Array> values = Array::New(2);
+        values->Set(0, current);
+        values->Set(1, value);
+        obj->Set(key, values);
+      }
+    }
+
+    if (end == len) break;
+    start = end + sep.length();
+  }
+
+  delete[] out;
+
+  return scope.Close(obj);
+}
+
+
+size_t TrimHttpParsers(size_t retain) {
+  HttpStatics *statics = NODE_STATICS_GET(node_http_parser, HttpStatics);
+  return statics ? Parser::TrimArenas(statics, retain) : 0;
+}
+
+
 void InitHttpParser(Handle<Object> target) {
   HandleScope scope;
   NODE_STATICS_NEW(node_http_parser, HttpStatics, statics);
@@ -593,17 +2260,49 @@ void InitHttpParser(Handle<Object> target) {
   PropertyAttribute attrib = (PropertyAttribute) (ReadOnly | DontDelete);
   t->Set(String::NewSymbol("REQUEST"), Integer::New(HTTP_REQUEST), attrib);
   t->Set(String::NewSymbol("RESPONSE"), Integer::New(HTTP_RESPONSE), attrib);
+  t->Set(String::NewSymbol("BATCH_HEADERS"),
+         Integer::New(BATCH_HEADERS), attrib);
+  t->Set(String::NewSymbol("BATCH_HEADERS_COMPLETE"),
+         Integer::New(BATCH_HEADERS_COMPLETE), attrib);
+  t->Set(String::NewSymbol("BATCH_BODY"),
+         Integer::New(BATCH_BODY), attrib);
+  t->Set(String::NewSymbol("BATCH_MESSAGE_COMPLETE"),
+         Integer::New(BATCH_MESSAGE_COMPLETE), attrib);
+  t->Set(String::NewSymbol("BATCH_BODY_BUFFER"),
+         Integer::New(BATCH_BODY_BUFFER), attrib);
 
   NODE_SET_PROTOTYPE_METHOD(t, "execute", Parser::Execute);
   NODE_SET_PROTOTYPE_METHOD(t, "finish", Parser::Finish);
   NODE_SET_PROTOTYPE_METHOD(t, "reinitialize", Parser::Reinitialize);
+  NODE_SET_PROTOTYPE_METHOD(t, "setLazyHeaders", Parser::SetLazyHeaders);
+  NODE_SET_PROTOTYPE_METHOD(t, "setBatchMode", Parser::SetBatchMode);
+  NODE_SET_PROTOTYPE_METHOD(t, "setCollectBody", Parser::SetCollectBody);
+  NODE_SET_PROTOTYPE_METHOD(t, "setMaxHeaderSize", Parser::SetMaxHeaderSize);
+  NODE_SET_PROTOTYPE_METHOD(t, "setLowerCaseHeaders",
+                            Parser::SetLowerCaseHeaders);
+  NODE_SET_PROTOTYPE_METHOD(t, "setResponseCache", Parser::SetResponseCache);
 
   target->Set(String::NewSymbol("HTTPParser"), t->GetFunction());
 
+  NODE_SET_METHOD(target, "serializeHeaders", SerializeHeaders);
+  NODE_SET_METHOD(target, "urlDecode", UrlDecode);
+  NODE_SET_METHOD(target, "parseQueryString", ParseQueryString);
+  NODE_DEFINE_CONSTANT(target, HEADER_KEEP_ALIVE);
+  NODE_DEFINE_CONSTANT(target, HEADER_CHUNKED_BY_DEFAULT);
+  NODE_DEFINE_CONSTANT(target, HEADER_HAS_AGENT);
+  NODE_DEFINE_CONSTANT(target, HEADER_HAS_BODY);
+  NODE_DEFINE_CONSTANT(target, HEADER_SEND_DATE);
+  NODE_DEFINE_CONSTANT(target, HEADER_LAST);
+  NODE_DEFINE_CONSTANT(target, HEADER_SET_KEEP_ALIVE);
+  NODE_DEFINE_CONSTANT(target, HEADER_CHUNKED);
+  NODE_DEFINE_CONSTANT(target, HEADER_NOT_CHUNKED);
+  NODE_DEFINE_CONSTANT(target, HEADER_EXPECT);
+
   statics->on_headers_sym          = NODE_PSYMBOL("onHeaders");
   statics->on_headers_complete_sym = NODE_PSYMBOL("onHeadersComplete");
   statics->on_body_sym             = NODE_PSYMBOL("onBody");
   statics->on_message_complete_sym = NODE_PSYMBOL("onMessageComplete");
+  statics->on_batch_sym            = NODE_PSYMBOL("onBatch");
 
   statics->delete_sym = NODE_PSYMBOL("DELETE");
   statics->get_sym = NODE_PSYMBOL("GET");
@@ -640,6 +2339,21 @@ void InitHttpParser(Handle<Object> target) {
   statics->upgrade_sym = NODE_PSYMBOL("upgrade");
   statics->headers_sym = NODE_PSYMBOL("headers");
   statics->url_sym = NODE_PSYMBOL("url");
+  statics->writable_sym = NODE_PSYMBOL("writable");
+  statics->http_message_sym = NODE_PSYMBOL("_httpMessage");
+  statics->corked_chunks_sym = NODE_PSYMBOL("_corkedChunks");
+  statics->handle_sym = NODE_PSYMBOL("_handle");
+
+  HttpHeaders::Initialize();
+  ResponseCache::Initialize(target);
+
+  for (size_t i = 0; i < ARRAY_SIZE(known_header_names); i++) {
+    const char* name = known_header_names[i];
+    unsigned h = header_name_hash(name, strlen(name));
+    assert(statics->header_names[h] == NULL);
+    statics->header_names[h] = name;
+    statics->header_syms[h] = NODE_PSYMBOL(name);
+  }
 
   statics->settings.on_message_begin    = Parser::on_message_begin;
   statics->settings.on_url              = Parser::on_url;
@@ -28,6 +28,10 @@ namespace node {
 
 void InitHttpParser(v8::Handle<v8::Object> target);
 
+// Frees header arena chunks of the current isolate's parsers beyond
+// `retain` bytes in all and returns the bytes freed.
+size_t TrimHttpParsers(size_t retain);
+
 }
 
 #endif  // NODE_HTTP_PARSER
@@ -24,8 +24,12 @@
 #include <node.h>
 #include <node_statics.h>
 #include <v8.h>
+#include <v8_typed_array.h>
 
 #include <assert.h>
+#include <string.h>
+#include <map>
+#include <vector>
 
 namespace node {
 
@@ -33,8 +37,84 @@ using namespace v8;
     
 class IOWatcherStatics : public ModuleStatics {
     Persistent<FunctionTemplate> constructor_template;
+    Persistent<FunctionTemplate> group_constructor_template;
     Persistent<String> callback_symbol;
     friend class IOWatcher;
+    friend class IOWatcherGroup;
+};
+
+
+// Watches many fds and hands all of those that became ready in one loop
+// iteration to a single callback:
+//
+//   var group = new IOWatcherGroup();
+//   group.callback = function(ready) { ... };
+//   group.add(fd, true, false);
+//   group.start();
+//
+// ready is an Int32Array of pairs, the fd and then its events:
+// IOWatcherGroup.READ, IOWatcherGroup.WRITE or both.
+//
+// The fds' callbacks only collect them. A check watcher at the lowest
+// priority, which libev runs after all the io callbacks of an iteration,
+// makes the one call into javascript.
+class IOWatcherGroup : public ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target);
+
+ private:
+  struct Member {
+    ev_io watcher;
+    IOWatcherGroup* group;
+    bool oneshot;
+  };
+
+  IOWatcherGroup() : ObjectWrap(), started_(false) {
+    loop_ = Isolate::GetCurrentLoop()->ev;
+    ev_check_init(&check_, IOWatcherGroup::Deliver);
+    ev_set_priority(&check_, EV_MINPRI);
+    check_.data = this;
+  }
+
+  ~IOWatcherGroup() {
+    StopWatching();
+    for (std::map<int, Member*>::iterator it = members_.begin();
+         it != members_.end();
+         ++it) {
+      delete it->second;
+    }
+  }
+
+  static Handle<Value> New(const Arguments& args);
+  static Handle<Value> Add(const Arguments& args);
+  static Handle<Value> Remove(const Arguments& args);
+  static Handle<Value> Rearm(const Arguments& args);
+  static Handle<Value> Start(const Arguments& args);
+  static Handle<Value> Stop(const Arguments& args);
+
+  static void Collect(EV_P_ ev_io *w, int revents);
+  static void Deliver(EV_P_ ev_check *w, int revents);
+
+  void StopWatching() {
+    if (!started_) return;
+    for (std::map<int, Member*>::iterator it = members_.begin();
+         it != members_.end();
+         ++it) {
+      ev_io_stop(loop_, &it->second->watcher);
+    }
+    // The check watcher does not keep the loop alive, see Start().
+    ev_ref(loop_);
+    ev_check_stop(loop_, &check_);
+    ready_.clear();
+    started_ = false;
+  }
+
+  struct ev_loop *loop_;
+  ev_check check_;
+  std::map<int, Member*> members_;
+  // fd, events pairs collected for the next callback
+  std::vector<int32_t> ready_;
+  bool started_;
 };
 
 void IOWatcher::Initialize(Handle<Object> target) {
@@ -53,6 +133,8 @@ void IOWatcher::Initialize(Handle<Object> target) {
   target->Set(String::NewSymbol("IOWatcher"), statics->constructor_template->GetFunction());
 
   statics->callback_symbol = NODE_PSYMBOL("callback");
+
+  IOWatcherGroup::Initialize(target);
 }
 
 
@@ -70,13 +152,17 @@ void IOWatcher::Callback(EV_P_ ev_io *w, int revents) {
 
   Local<Function> callback = Local<Function>::Cast(callback_v);
 
+  // Keeps the object alive though stopping drops its reference.
+  Local<Object> handle = Local<Object>::New(io->handle_);
+  if (io->oneshot_) io->Stop();
+
   TryCatch try_catch;
 
   Local<Value> argv[2];
   argv[0] = Local<Value>::New(revents & EV_READ ? True() : False());
   argv[1] = Local<Value>::New(revents & EV_WRITE ? True() : False());
 
-  callback->Call(io->handle_, 2, argv);
+  callback->Call(handle, 2, argv);
 
   if (try_catch.HasCaught()) {
     FatalException(try_catch);
@@ -90,6 +176,10 @@ void IOWatcher::Callback(EV_P_ ev_io *w, int revents) {
 //  io.set(fd, true, false);
 //  io.start();
 //
+// io.set(fd, readable, writable, true) makes a oneshot watcher, which stops
+// before each callback. Call start() again once the fd has been drained,
+// that is, read or written until EAGAIN.
+//
 Handle<Value> IOWatcher::New(const Arguments& args) {
   if (!args.IsConstructCall()) {
     IOWatcherStatics *statics = NODE_STATICS_GET(node_io_watcher, IOWatcherStatics);
@@ -165,10 +255,224 @@ Handle<Value> IOWatcher::Set(const Arguments& args) {
 
   assert(!io->watcher_.active);
   ev_io_set(&io->watcher_, fd, events);
+  io->oneshot_ = args[3]->IsTrue();
+
+  return Undefined();
+}
+
+
+void IOWatcherGroup::Initialize(Handle<Object> target) {
+  HandleScope scope;
+  IOWatcherStatics *statics = NODE_STATICS_GET(node_io_watcher, IOWatcherStatics);
+
+  Local<FunctionTemplate> t = FunctionTemplate::New(IOWatcherGroup::New);
+  statics->group_constructor_template = Persistent<FunctionTemplate>::New(t);
+  t->InstanceTemplate()->SetInternalFieldCount(1);
+  t->SetClassName(String::NewSymbol("IOWatcherGroup"));
+
+  NODE_SET_PROTOTYPE_METHOD(t, "add", IOWatcherGroup::Add);
+  NODE_SET_PROTOTYPE_METHOD(t, "remove", IOWatcherGroup::Remove);
+  NODE_SET_PROTOTYPE_METHOD(t, "rearm", IOWatcherGroup::Rearm);
+  NODE_SET_PROTOTYPE_METHOD(t, "start", IOWatcherGroup::Start);
+  NODE_SET_PROTOTYPE_METHOD(t, "stop", IOWatcherGroup::Stop);
+
+  Local<Function> constructor = t->GetFunction();
+  constructor->Set(String::NewSymbol("READ"), Integer::New(EV_READ));
+  constructor->Set(String::NewSymbol("WRITE"), Integer::New(EV_WRITE));
+
+  target->Set(String::NewSymbol("IOWatcherGroup"), constructor);
+}
+
+
+Handle<Value> IOWatcherGroup::New(const Arguments& args) {
+  if (!args.IsConstructCall()) {
+    IOWatcherStatics *statics = NODE_STATICS_GET(node_io_watcher, IOWatcherStatics);
+    return FromConstructorTemplate(statics->group_constructor_template, args);
+  }
+
+  HandleScope scope;
+  IOWatcherGroup *group = new IOWatcherGroup();
+  group->Wrap(args.This());
+  return args.This();
+}
+
+
+// add(fd, readable, writable, [oneshot]) watches fd, or changes how it is
+// watched. A oneshot fd is left out after it was reported once, until
+// rearm(fd).
+Handle<Value> IOWatcherGroup::Add(const Arguments& args) {
+  HandleScope scope;
+
+  IOWatcherGroup *group = ObjectWrap::Unwrap<IOWatcherGroup>(args.Holder());
+
+  if (!args[0]->IsInt32()) {
+    return ThrowException(Exception::TypeError(
+          String::New("First arg should be a file descriptor.")));
+  }
+
+  int fd = args[0]->Int32Value();
+  int events = 0;
+  if (args[1]->IsTrue()) events |= EV_READ;
+  if (args[2]->IsTrue()) events |= EV_WRITE;
+
+  if (events == 0) {
+    return ThrowException(Exception::TypeError(
+          String::New("Watch the fd for reading, writing or both.")));
+  }
+
+  Member *member;
+  std::map<int, Member*>::iterator it = group->members_.find(fd);
+  if (it == group->members_.end()) {
+    member = new Member;
+    ev_init(&member->watcher, IOWatcherGroup::Collect);
+    member->watcher.data = member;
+    member->group = group;
+    group->members_[fd] = member;
+  } else {
+    member = it->second;
+    ev_io_stop(group->loop_, &member->watcher);
+  }
+
+  member->oneshot = args[3]->IsTrue();
+  ev_io_set(&member->watcher, fd, events);
+  if (group->started_) ev_io_start(group->loop_, &member->watcher);
 
   return Undefined();
 }
 
 
+Handle<Value> IOWatcherGroup::Remove(const Arguments& args) {
+  HandleScope scope;
+
+  IOWatcherGroup *group = ObjectWrap::Unwrap<IOWatcherGroup>(args.Holder());
+
+  int fd = args[0]->Int32Value();
+  std::map<int, Member*>::iterator it = group->members_.find(fd);
+  if (it == group->members_.end()) return False();
+
+  ev_io_stop(group->loop_, &it->second->watcher);
+  delete it->second;
+  group->members_.erase(it);
+
+  // Don't report it any more.
+  std::vector<int32_t>& ready = group->ready_;
+  for (size_t i = 0; i < ready.size(); ) {
+    if (ready[i] == fd) {
+      ready.erase(ready.begin() + i, ready.begin() + i + 2);
+    } else {
+      i += 2;
+    }
+  }
+
+  return True();
+}
+
+
+Handle<Value> IOWatcherGroup::Rearm(const Arguments& args) {
+  HandleScope scope;
+
+  IOWatcherGroup *group = ObjectWrap::Unwrap<IOWatcherGroup>(args.Holder());
+
+  int fd = args[0]->Int32Value();
+  std::map<int, Member*>::iterator it = group->members_.find(fd);
+  if (it == group->members_.end()) return False();
+
+  if (group->started_) ev_io_start(group->loop_, &it->second->watcher);
+
+  return True();
+}
+
+
+Handle<Value> IOWatcherGroup::Start(const Arguments& args) {
+  HandleScope scope;
+
+  IOWatcherGroup *group = ObjectWrap::Unwrap<IOWatcherGroup>(args.Holder());
+  if (group->started_) return Undefined();
+
+  for (std::map<int, Member*>::iterator it = group->members_.begin();
+       it != group->members_.end();
+       ++it) {
+    ev_io_start(group->loop_, &it->second->watcher);
+  }
+  // Only the fds keep the loop alive.
+  ev_check_start(group->loop_, &group->check_);
+  ev_unref(group->loop_);
+  group->started_ = true;
+  group->Ref();
+
+  return Undefined();
+}
+
+
+Handle<Value> IOWatcherGroup::Stop(const Arguments& args) {
+  HandleScope scope;
+
+  IOWatcherGroup *group = ObjectWrap::Unwrap<IOWatcherGroup>(args.Holder());
+  if (!group->started_) return Undefined();
+
+  group->StopWatching();
+  group->Unref();
+
+  return Undefined();
+}
+
+
+void IOWatcherGroup::Collect(EV_P_ ev_io *w, int revents) {
+  Member *member = static_cast<Member*>(w->data);
+  IOWatcherGroup *group = member->group;
+
+  if (member->oneshot) ev_io_stop(group->loop_, w);
+
+  group->ready_.push_back(w->fd);
+  group->ready_.push_back(revents & (EV_READ | EV_WRITE));
+}
+
+
+void IOWatcherGroup::Deliver(EV_P_ ev_check *w, int revents) {
+  IOWatcherGroup *group = static_cast<IOWatcherGroup*>(w->data);
+  if (group->ready_.empty()) return;
+
+  HandleScope scope;
+  IOWatcherStatics *statics = NODE_STATICS_GET(node_io_watcher, IOWatcherStatics);
+
+  Local<Object> handle = Local<Object>::New(group->handle_);
+  Local<Value> callback_v = handle->Get(statics->callback_symbol);
+  if (!callback_v->IsFunction()) {
+    group->ready_.clear();
+    return;
+  }
+
+  Local<Value> ctor =
+      Context::GetCurrent()->Global()->Get(String::New("Int32Array"));
+  if (!ctor->IsFunction()) {
+    group->ready_.clear();
+    return;
+  }
+
+  Local<Value> length = Integer::New(group->ready_.size());
+  Local<Object> ready = Local<Function>::Cast(ctor)->NewInstance(1, &length);
+  if (ready.IsEmpty() ||
+      !v8_typed_array::HasExternalElements(ready,
+                                           kExternalIntArray,
+                                           group->ready_.size())) {
+    group->ready_.clear();
+    return;
+  }
+  memcpy(ready->GetIndexedPropertiesExternalArrayData(),
+         &group->ready_[0],
+         group->ready_.size() * sizeof(int32_t));
+  group->ready_.clear();
+
+  TryCatch try_catch;
+
+  Local<Value> argv[1] = { ready };
+  Local<Function>::Cast(callback_v)->Call(handle, 1, argv);
+
+  if (try_catch.HasCaught()) {
+    FatalException(try_catch);
+  }
+}
+
+
 
 }  // namespace node
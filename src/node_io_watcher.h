@@ -33,7 +33,7 @@ class IOWatcher : ObjectWrap {
   static void Initialize(v8::Handle<v8::Object> target);
 
  protected:
-  IOWatcher() : ObjectWrap() {
+  IOWatcher() : ObjectWrap(), oneshot_(false) {
     ev_init(&watcher_, IOWatcher::Callback);
     watcher_.data = this;
     loop = Isolate::GetCurrentLoop()->ev;
@@ -58,6 +58,8 @@ class IOWatcher : ObjectWrap {
 
   ev_io watcher_;
   struct ev_loop *loop;
+  // stop after each callback until start() is called again
+  bool oneshot_;
 };
 
 }  // namespace node
@@ -23,6 +23,7 @@
 #include "node.h"
 #include "node_natives.h"
 #include "node_string.h"
+#include "node_script.h"
 #include <string.h>
 #if !defined(_MSC_VER)
 #include <strings.h>
@@ -32,18 +33,130 @@ using namespace v8;
 
 namespace node {
 
+// NativeModule sources wrapped in NativeModule.wrapper, with their pre-parse
+// data. Each is built the first time any isolate loads the module, and then
+// shared by all isolates for the life of the process: the source is an
+// external string over the same resource and the parser skips over function
+// bodies it has already seen.
+struct WrappedNative {
+  char *source;
+  size_t source_len;
+  ImmutableAsciiSource *resource;
+  char *pre_data;
+  int pre_data_len;
+};
+
+static struct WrappedNatives {
+  WrappedNatives() {
+    uv_mutex_init(&mutex);
+    int count = 0;
+    while (natives[count].name) count++;
+    list = new WrappedNative[count];
+    memset(list, 0, count * sizeof(WrappedNative));
+    // The unwrapped sources of process.binding('natives') are shared too.
+    sources = new ImmutableAsciiSource*[count];
+    for (int i = 0; i < count; i++) {
+      sources[i] = new ImmutableAsciiSource(natives[i].source,
+                                            natives[i].source_len,
+                                            true);
+    }
+  }
+
+  uv_mutex_t mutex;
+  WrappedNative *list;
+  ImmutableAsciiSource **sources;
+} wrapped_natives;
+
+static ImmutableAsciiSource main_source(node_native,
+                                        sizeof(node_native) - 1,
+                                        true);
+
+// compileNative(id, wrapper0, wrapper1, filename, [cacheDir]) returns the
+// module's function, like runInThisContext(wrapper0 + source + wrapper1,
+// filename). The wrapper must be the same on every call. With cacheDir the
+// pre-parse data is also kept on disk, for the next process.
+Handle<Value> CompileNative(const Arguments& args) {
+  HandleScope scope;
+
+  String::Utf8Value id(args[0]);
+  int i;
+  for (i = 0; natives[i].name; i++) {
+    if (natives[i].source != node_native && strcmp(natives[i].name, *id) == 0)
+      break;
+  }
+  if (!natives[i].name) {
+    return ThrowException(Exception::Error(
+        String::New("No such native module")));
+  }
+
+  WrappedNative *w = &wrapped_natives.list[i];
+
+  uv_mutex_lock(&wrapped_natives.mutex);
+  if (!w->source) {
+    String::Utf8Value head(args[1]);
+    String::Utf8Value tail(args[2]);
+    size_t len = head.length() + natives[i].source_len + tail.length();
+    char *source = new char[len];
+    memcpy(source, *head, head.length());
+    memcpy(source + head.length(), natives[i].source, natives[i].source_len);
+    memcpy(source + head.length() + natives[i].source_len,
+           *tail,
+           tail.length());
+
+    ScriptData *pre_data;
+    if (args[4]->IsString()) {
+      String::Utf8Value cache_dir(args[4]);
+      pre_data = CachedPreData(*cache_dir, source, len);
+    } else {
+      pre_data = ScriptData::PreCompile(source, len);
+    }
+    if (pre_data && !pre_data->HasError()) {
+      w->pre_data_len = pre_data->Length();
+      w->pre_data = new char[w->pre_data_len];
+      memcpy(w->pre_data, pre_data->Data(), w->pre_data_len);
+    }
+    delete pre_data;
+
+    w->source_len = len;
+    w->resource = new ImmutableAsciiSource(source, len, true);
+    w->source = source;
+  }
+  uv_mutex_unlock(&wrapped_natives.mutex);
+
+  // The parser advances through the data as it goes, so each compile needs
+  // its own copy.
+  ScriptData *pre_data = w->pre_data ?
+      ScriptData::New(w->pre_data, w->pre_data_len) : NULL;
+  ScriptOrigin origin(args[3]);
+  Local<Script> script = Script::Compile(
+      ImmutableAsciiSource::SharedString(w->resource), &origin, pre_data);
+  delete pre_data;
+
+  if (script.IsEmpty()) return Handle<Value>();
+  return scope.Close(script->Run());
+}
+
 Handle<String> MainSource() {
-  return BUILTIN_ASCII_ARRAY(node_native, sizeof(node_native)-1);
+  return ImmutableAsciiSource::SharedString(&main_source);
+}
+
+static Handle<Value> GetNativeSource(Local<String> property,
+                                     const AccessorInfo& info) {
+  HandleScope scope;
+  int i = info.Data()->Int32Value();
+  return scope.Close(
+      ImmutableAsciiSource::SharedString(wrapped_natives.sources[i]));
 }
 
+// The sources are only made into strings when read: most isolates never
+// look at more than a few of them, and `id in natives` needs none.
 void DefineJavaScript(v8::Handle<v8::Object> target) {
   HandleScope scope;
 
   for (int i = 0; natives[i].name; i++) {
     if (natives[i].source != node_native) {
-      Local<String> name = String::New(natives[i].name);
-      Handle<String> source = BUILTIN_ASCII_ARRAY(natives[i].source, natives[i].source_len);
-      target->Set(name, source);
+      Local<String> name = String::NewSymbol(natives[i].name);
+      target->SetAccessor(name, GetNativeSource, NULL, Integer::New(i));
     }
   }
 }
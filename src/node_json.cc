@@ -0,0 +1,649 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// An incremental JSON parser over Buffers. Chunks of UTF-8 text go in as
+// they arrive and the parser builds the V8 values directly, so that a body
+// never exists as one JavaScript string:
+//
+//     var parser = new JSONParser();
+//     parser.write(buffer, start, end);  // as often as needed
+//     var value = parser.end();
+//
+// Containers are attached to their parent when they open, so the only
+// state kept between chunks is the chain of open containers, a pending
+// object key and the bytes of a token split by a chunk boundary. Keys are
+// made symbols, which V8 shares, so repeated keys cost one string.
+//
+// The result is that of JSON.parse() on the text decoded as UTF-8. Errors
+// are SyntaxErrors as well, though the messages may differ.
+
+#include <node.h>
+#include <node_buffer.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace node {
+
+using namespace v8;
+
+
+// Bytes that end the fast scan through a string: the quote, the backslash
+// and the control characters, which may not appear in one.
+static bool string_stop[256];
+static bool string_stop_initialized;
+
+static void InitStringStop() {
+  if (string_stop_initialized) return;
+  for (int c = 0; c < 0x20; c++) string_stop[c] = true;
+  string_stop[static_cast<int>('"')] = true;
+  string_stop[static_cast<int>('\\')] = true;
+  string_stop_initialized = true;
+}
+
+
+static inline bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+static inline int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+
+// Appends the UTF-16 code units of the UTF-8 sequence at s to out and
+// returns how many bytes it took. Invalid sequences become U+FFFD, one
+// per byte.
+static size_t DecodeUtf8(const unsigned char* s, size_t length,
+                         std::vector<uint16_t>* out) {
+  unsigned int c = s[0];
+  size_t n;
+  unsigned int min;
+
+  if (c < 0x80) {
+    out->push_back(c);
+    return 1;
+  } else if ((c & 0xe0) == 0xc0) {
+    n = 2;
+    c &= 0x1f;
+    min = 0x80;
+  } else if ((c & 0xf0) == 0xe0) {
+    n = 3;
+    c &= 0x0f;
+    min = 0x800;
+  } else if ((c & 0xf8) == 0xf0) {
+    n = 4;
+    c &= 0x07;
+    min = 0x10000;
+  } else {
+    out->push_back(0xfffd);
+    return 1;
+  }
+
+  if (n > length) {
+    out->push_back(0xfffd);
+    return 1;
+  }
+  for (size_t i = 1; i < n; i++) {
+    if ((s[i] & 0xc0) != 0x80) {
+      out->push_back(0xfffd);
+      return 1;
+    }
+    c = (c << 6) | (s[i] & 0x3f);
+  }
+  if (c < min || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) {
+    out->push_back(0xfffd);
+    return 1;
+  }
+
+  if (c >= 0x10000) {
+    c -= 0x10000;
+    out->push_back(0xd800 | (c >> 10));
+    out->push_back(0xdc00 | (c & 0x3ff));
+  } else {
+    out->push_back(c);
+  }
+  return n;
+}
+
+
+class JSONParser : public ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    InitStringStop();
+
+    Local<FunctionTemplate> t = FunctionTemplate::New(New);
+    t->InstanceTemplate()->SetInternalFieldCount(1);
+    t->SetClassName(String::NewSymbol("JSONParser"));
+
+    NODE_SET_PROTOTYPE_METHOD(t, "write", Write);
+    NODE_SET_PROTOTYPE_METHOD(t, "end", End);
+
+    target->Set(String::NewSymbol("JSONParser"), t->GetFunction());
+  }
+
+ private:
+  enum State {
+    S_VALUE,
+    S_FIRST_VALUE,  // after '[', where ']' may come
+    S_KEY,
+    S_FIRST_KEY,    // after '{', where '}' may come
+    S_COLON,
+    S_AFTER_VALUE,
+    S_STRING,
+    S_NUMBER,
+    S_LITERAL,
+    S_ERROR
+  };
+
+  struct Frame {
+    Persistent<Object> object;
+    bool is_array;
+    uint32_t length;
+  };
+
+  JSONParser() : ObjectWrap() {
+    Reset();
+  }
+
+  ~JSONParser() {
+    Clear();
+  }
+
+  void Reset() {
+    state_ = S_VALUE;
+    string_is_key_ = false;
+    string_escaped_ = false;
+    string_has_escape_ = false;
+    literal_ = NULL;
+    literal_pos_ = 0;
+    token_.clear();
+  }
+
+  void Clear() {
+    for (size_t i = 0; i < stack_.size(); i++) stack_[i].object.Dispose();
+    stack_.clear();
+    if (!result_.IsEmpty()) {
+      result_.Dispose();
+      result_.Clear();
+    }
+    if (!saved_key_.IsEmpty()) {
+      saved_key_.Dispose();
+      saved_key_.Clear();
+    }
+  }
+
+  // Throws a SyntaxError for the byte at c, or for the end of the input if
+  // c is NULL.
+  Handle<Value> Fail(const char* c) {
+    state_ = S_ERROR;
+    Clear();
+    token_.clear();
+    if (c == NULL) {
+      return ThrowException(Exception::SyntaxError(
+            String::New("Unexpected end of input")));
+    }
+    char message[32];
+    if (static_cast<unsigned char>(*c) < 0x80) {
+      snprintf(message, sizeof(message), "Unexpected token %c", *c);
+    } else {
+      snprintf(message, sizeof(message), "Unexpected token ILLEGAL");
+    }
+    return ThrowException(Exception::SyntaxError(String::New(message)));
+  }
+
+  // Puts v where the parser is: the result, the next element of the open
+  // array or the value of the pending key.
+  void Insert(Handle<Value> v) {
+    if (stack_.empty()) {
+      result_ = Persistent<Value>::New(v);
+      return;
+    }
+    Frame& top = stack_.back();
+    if (top.is_array) {
+      top_->Set(top.length++, v);
+    } else {
+      // Like JSON.parse(), make own properties even of __proto__.
+      top_->ForceSet(key_, v);
+      key_.Clear();
+    }
+  }
+
+  void Open(bool is_array) {
+    Local<Object> object;
+    if (is_array) object = Array::New();
+    else object = Object::New();
+    Insert(object);
+
+    stack_.push_back(Frame());
+    Frame& frame = stack_.back();
+    frame.object = Persistent<Object>::New(object);
+    frame.is_array = is_array;
+    frame.length = 0;
+    top_ = object;
+
+    state_ = is_array ? S_FIRST_VALUE : S_FIRST_KEY;
+  }
+
+  void Close() {
+    stack_.back().object.Dispose();
+    stack_.pop_back();
+    if (!stack_.empty()) top_ = Local<Object>::New(stack_.back().object);
+    state_ = S_AFTER_VALUE;
+  }
+
+  // Makes a string of the bytes of a JSON string without its quotes.
+  // Returns an empty handle if an escape is invalid.
+  Local<String> MakeString(const char* data, size_t length, bool escaped,
+                           bool is_key) {
+    if (!escaped) {
+      // V8 decodes UTF-8 the way Buffer#toString() does.
+      int n = static_cast<int>(length);
+      return is_key ? String::NewSymbol(data, n) : String::New(data, n);
+    }
+
+    std::vector<uint16_t>& out = units_;
+    out.clear();
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(data);
+    size_t i = 0;
+
+    while (i < length) {
+      if (s[i] != '\\') {
+        i += DecodeUtf8(s + i, length - i, &out);
+        continue;
+      }
+      if (++i == length) return Local<String>();
+      switch (s[i++]) {
+        case '"': out.push_back('"'); break;
+        case '\\': out.push_back('\\'); break;
+        case '/': out.push_back('/'); break;
+        case 'b': out.push_back('\b'); break;
+        case 'f': out.push_back('\f'); break;
+        case 'n': out.push_back('\n'); break;
+        case 'r': out.push_back('\r'); break;
+        case 't': out.push_back('\t'); break;
+        case 'u': {
+          if (length - i < 4) return Local<String>();
+          int unit = 0;
+          for (int j = 0; j < 4; j++) {
+            int h = HexValue(s[i + j]);
+            if (h < 0) return Local<String>();
+            unit = (unit << 4) | h;
+          }
+          out.push_back(unit);
+          i += 4;
+          break;
+        }
+        default:
+          return Local<String>();
+      }
+    }
+
+    return String::New(out.empty() ? NULL : &out[0],
+                       static_cast<int>(out.size()));
+  }
+
+  // Checks the JSON number grammar, -?(0|[1-9]\d*)(\.\d+)?([eE][+-]?\d+)?
+  static bool IsNumber(const char* s, size_t length) {
+    size_t i = 0;
+    if (i < length && s[i] == '-') i++;
+    if (i == length) return false;
+    if (s[i] == '0') {
+      i++;
+    } else if (s[i] >= '1' && s[i] <= '9') {
+      while (i < length && s[i] >= '0' && s[i] <= '9') i++;
+    } else {
+      return false;
+    }
+    if (i < length && s[i] == '.') {
+      size_t digits = ++i;
+      while (i < length && s[i] >= '0' && s[i] <= '9') i++;
+      if (i == digits) return false;
+    }
+    if (i < length && (s[i] == 'e' || s[i] == 'E')) {
+      i++;
+      if (i < length && (s[i] == '+' || s[i] == '-')) i++;
+      size_t digits = i;
+      while (i < length && s[i] >= '0' && s[i] <= '9') i++;
+      if (i == digits) return false;
+    }
+    return i == length;
+  }
+
+  bool FinishNumber() {
+    const char* s = token_.c_str();
+    size_t length = token_.size();
+    if (!IsNumber(s, length)) return false;
+
+    // Small integers, the common case, without strtod().
+    bool negative = s[0] == '-';
+    size_t digits = length - negative;
+    if (digits <= 9 && strspn(s + negative, "0123456789") == digits &&
+        !(negative && s[1] == '0')) {
+      int32_t value = 0;
+      for (size_t i = negative; i < length; i++) value = value * 10 + s[i] - '0';
+      Insert(Integer::New(negative ? -value : value));
+    } else {
+      Insert(Number::New(strtod(s, NULL)));
+    }
+
+    token_.clear();
+    state_ = S_AFTER_VALUE;
+    return true;
+  }
+
+  // Parses data, returning NULL or a pointer to the byte at fault.
+  const char* Parse(const char* p, const char* end) {
+    while (p < end) {
+      switch (state_) {
+        case S_VALUE:
+        case S_FIRST_VALUE:
+          if (IsSpace(*p)) {
+            p++;
+            break;
+          }
+          switch (*p) {
+            case '"':
+              state_ = S_STRING;
+              string_is_key_ = false;
+              p++;
+              break;
+            case '{':
+              Open(false);
+              p++;
+              break;
+            case '[':
+              Open(true);
+              p++;
+              break;
+            case ']':
+              if (state_ != S_FIRST_VALUE) return p;
+              Close();
+              p++;
+              break;
+            case 't':
+              literal_ = "true";
+              goto literal;
+            case 'f':
+              literal_ = "false";
+              goto literal;
+            case 'n':
+              literal_ = "null";
+            literal:
+              literal_pos_ = 1;
+              state_ = S_LITERAL;
+              p++;
+              break;
+            default:
+              if (*p == '-' || (*p >= '0' && *p <= '9')) {
+                state_ = S_NUMBER;
+                break;
+              }
+              return p;
+          }
+          break;
+
+        case S_KEY:
+        case S_FIRST_KEY:
+          if (IsSpace(*p)) {
+            p++;
+          } else if (*p == '"') {
+            state_ = S_STRING;
+            string_is_key_ = true;
+            p++;
+          } else if (*p == '}' && state_ == S_FIRST_KEY) {
+            Close();
+            p++;
+          } else {
+            return p;
+          }
+          break;
+
+        case S_COLON:
+          if (IsSpace(*p)) {
+            p++;
+          } else if (*p == ':') {
+            state_ = S_VALUE;
+            p++;
+          } else {
+            return p;
+          }
+          break;
+
+        case S_AFTER_VALUE:
+          if (IsSpace(*p)) {
+            p++;
+            break;
+          }
+          if (stack_.empty()) return p;
+          if (*p == ',') {
+            state_ = stack_.back().is_array ? S_VALUE : S_KEY;
+          } else if (*p == (stack_.back().is_array ? ']' : '}')) {
+            Close();
+          } else {
+            return p;
+          }
+          p++;
+          break;
+
+        case S_STRING: {
+          const char* start = p;
+          if (string_escaped_) {
+            string_escaped_ = false;
+            p++;
+          }
+          for (;;) {
+            while (p < end && !string_stop[static_cast<unsigned char>(*p)]) p++;
+            if (p == end || *p != '\\') break;
+            string_has_escape_ = true;
+            if (++p == end) {
+              string_escaped_ = true;
+              break;
+            }
+            p++;
+          }
+          if (p == end) {
+            token_.append(start, p - start);
+            break;
+          }
+          if (*p != '"') return p;  // a control character
+
+          Local<String> s;
+          if (token_.empty()) {
+            s = MakeString(start, p - start, string_has_escape_,
+                           string_is_key_);
+          } else {
+            token_.append(start, p - start);
+            s = MakeString(token_.data(), token_.size(), string_has_escape_,
+                           string_is_key_);
+            token_.clear();
+          }
+          if (s.IsEmpty()) return p;  // a bad escape
+          string_has_escape_ = false;
+          p++;
+
+          if (string_is_key_) {
+            key_ = s;
+            state_ = S_COLON;
+          } else {
+            Insert(s);
+            state_ = S_AFTER_VALUE;
+          }
+          break;
+        }
+
+        case S_NUMBER: {
+          const char* start = p;
+          while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' ||
+                             *p == 'e' || *p == 'E' || *p == '+' ||
+                             *p == '-')) {
+            p++;
+          }
+          token_.append(start, p - start);
+          if (p < end && !FinishNumber()) return p;
+          break;
+        }
+
+        case S_LITERAL:
+          if (*p != literal_[literal_pos_]) return p;
+          p++;
+          if (literal_[++literal_pos_] == '\0') {
+            if (literal_[0] == 'n') Insert(Null());
+            else Insert(literal_[0] == 't' ? True() : False());
+            state_ = S_AFTER_VALUE;
+          }
+          break;
+
+        case S_ERROR:
+          abort();
+      }
+    }
+    return NULL;
+  }
+
+
+  static Handle<Value> New(const Arguments& args) {
+    HandleScope scope;
+    JSONParser* parser = new JSONParser();
+    parser->Wrap(args.This());
+    return args.This();
+  }
+
+
+  // parser.write(buffer, start, end)
+  static Handle<Value> Write(const Arguments& args) {
+    HandleScope scope;
+
+    JSONParser* parser = ObjectWrap::Unwrap<JSONParser>(args.This());
+
+    if (!Buffer::HasInstance(args[0])) {
+      return ThrowException(Exception::TypeError(
+            String::New("Argument should be a buffer")));
+    }
+
+    Local<Object> buffer_obj = args[0]->ToObject();
+    size_t length = Buffer::Length(buffer_obj);
+    size_t start = args[1]->Uint32Value();
+    size_t end = args[2]->IsUndefined() ? length : args[2]->Uint32Value();
+    if (start > end || end > length) {
+      return ThrowException(Exception::Error(String::New("Out of bounds")));
+    }
+
+    if (parser->state_ == S_ERROR) {
+      return ThrowException(Exception::Error(
+            String::New("The parser failed on an earlier write()")));
+    }
+
+    // Between writes the open containers and a pending key are kept in
+    // persistent handles; during one they are local.
+    if (!parser->stack_.empty()) {
+      parser->top_ = Local<Object>::New(parser->stack_.back().object);
+    }
+    if (!parser->saved_key_.IsEmpty()) {
+      parser->key_ = Local<String>::New(parser->saved_key_);
+      parser->saved_key_.Dispose();
+      parser->saved_key_.Clear();
+    }
+
+    char* data = Buffer::Data(buffer_obj);
+    const char* bad = parser->Parse(data + start, data + end);
+
+    if (!parser->key_.IsEmpty()) {
+      parser->saved_key_ = Persistent<String>::New(parser->key_);
+      parser->key_.Clear();
+    }
+    parser->top_.Clear();
+
+    if (bad != NULL) return parser->Fail(bad);
+    return Undefined();
+  }
+
+
+  // var value = parser.end();
+  //
+  // Returns the value and makes the parser ready for the next one.
+  static Handle<Value> End(const Arguments& args) {
+    HandleScope scope;
+
+    JSONParser* parser = ObjectWrap::Unwrap<JSONParser>(args.This());
+
+    if (parser->state_ == S_ERROR) {
+      return ThrowException(Exception::Error(
+            String::New("The parser failed on an earlier write()")));
+    }
+
+    if (parser->state_ == S_NUMBER && parser->stack_.empty()) {
+      if (!parser->FinishNumber()) return parser->Fail(NULL);
+    }
+
+    if (parser->state_ != S_AFTER_VALUE || !parser->stack_.empty()) {
+      return parser->Fail(NULL);
+    }
+
+    Local<Value> result = Local<Value>::New(parser->result_);
+    parser->Clear();
+    parser->Reset();
+    return scope.Close(result);
+  }
+
+
+  State state_;
+  std::vector<Frame> stack_;
+  Persistent<Value> result_;
+
+  // Valid during Write() only.
+  Local<Object> top_;
+  Local<String> key_;
+
+  Persistent<String> saved_key_;
+
+  // The bytes of a string or number that a chunk boundary split.
+  std::string token_;
+  bool string_is_key_;
+  bool string_escaped_;
+  bool string_has_escape_;
+
+  const char* literal_;
+  int literal_pos_;
+
+  std::vector<uint16_t> units_;
+};
+
+
+void InitJSON(Handle<Object> target) {
+  HandleScope scope;
+  JSONParser::Initialize(target);
+}
+
+}  // namespace node
+
+NODE_MODULE(node_json, node::InitJSON)
@@ -0,0 +1,479 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <node.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#ifdef _WIN32
+# include <io.h>
+#else
+# include <poll.h>
+# include <unistd.h>
+#endif
+
+// Buffers smaller than this would have every few records go to the pool.
+#define LOG_MIN_BUFFER_SIZE 4096
+#define LOG_DEFAULT_BUFFER_SIZE (64 * 1024)
+#define LOG_MAX_BUFFER_SIZE (1 << 30)
+
+namespace node {
+
+using namespace v8;
+
+
+static const char* const level_names[] = { "debug", "info", "warn", "error" };
+#define LOG_LEVELS (sizeof(level_names) / sizeof(level_names[0]))
+
+
+// Writes all of data to fd, blocking if it has to. Returns 0 or an errno.
+static int WriteAll(int fd, const char* data, size_t length) {
+  while (length > 0) {
+#ifdef _WIN32
+    int r = _write(fd, data, static_cast<unsigned int>(length));
+#else
+    ssize_t r = write(fd, data, length);
+#endif
+    if (r < 0) {
+      if (errno == EINTR) continue;
+#ifndef _WIN32
+      // Sockets and pipes may have been put in non-blocking mode by the
+      // event loop.
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        poll(&pfd, 1, -1);
+        continue;
+      }
+#endif
+      return errno;
+    }
+    data += r;
+    length -= r;
+  }
+  return 0;
+}
+
+
+// A logger writes records as JSON lines to a file descriptor, which may be
+// a file, pipe or socket:
+//
+//   var logger = new Logger(fd, Date.now(), bufferSize, minLevel);
+//   logger.log(level, msg, fields);
+//   logger.flush();
+//
+// log() formats the record straight into a buffer in C++, so neither
+// util.format() nor a write stream is involved. Once a buffer has records
+// flush() hands it to the thread pool and swaps in the second one, so the
+// write never blocks the loop. A record that does not fit into the free
+// buffer while the other is still being written makes log() wait for that
+// write: records are never dropped, nor reordered.
+//
+// flushSync() writes whatever is buffered before it returns; it is what
+// process.exit() and fatal exceptions use.
+class Logger : public ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    Local<FunctionTemplate> t = FunctionTemplate::New(New);
+    t->InstanceTemplate()->SetInternalFieldCount(1);
+    t->SetClassName(String::NewSymbol("Logger"));
+
+    NODE_SET_PROTOTYPE_METHOD(t, "log", Log);
+    NODE_SET_PROTOTYPE_METHOD(t, "flush", Flush);
+    NODE_SET_PROTOTYPE_METHOD(t, "flushSync", FlushSync);
+    NODE_SET_PROTOTYPE_METHOD(t, "close", Close);
+    NODE_SET_PROTOTYPE_METHOD(t, "stats", Stats);
+
+    target->Set(String::NewSymbol("Logger"), t->GetFunction());
+  }
+
+ private:
+  Logger(int fd, double epoch, size_t size, int min_level)
+      : ObjectWrap(),
+        fd_(fd),
+        min_level_(min_level),
+        size_(size),
+        active_(0),
+        shipped_(0),
+        in_flight_(false),
+        shipped_written_(false),
+        closed_(false),
+        work_errno_(0),
+        work_length_(0),
+        records_(0),
+        bytes_(0),
+        errors_(0) {
+    buffers_[0] = static_cast<char*>(malloc(size));
+    buffers_[1] = static_cast<char*>(malloc(size));
+    used_[0] = used_[1] = 0;
+    uv_mutex_init(&mutex_);
+    work_req_.data = this;
+
+    // Timestamps are this wall clock time plus the monotonic clock since,
+    // which saves a gettimeofday() per record.
+    hrtime_base_ = uv_hrtime();
+    epoch_ = epoch;
+  }
+
+  // What is still buffered is lost; lib/console.js keeps loggers alive
+  // until they are closed.
+  ~Logger() {
+    assert(!in_flight_);
+    uv_mutex_destroy(&mutex_);
+    free(buffers_[0]);
+    free(buffers_[1]);
+  }
+
+  // new Logger(fd, now, bufferSize, minLevel)
+  static Handle<Value> New(const Arguments& args) {
+    HandleScope scope;
+    assert(args.IsConstructCall());
+
+    if (!args[0]->IsInt32() || !args[1]->IsNumber()) {
+      return ThrowException(Exception::TypeError(
+            String::New("Bad arguments")));
+    }
+
+    int64_t size = args[2]->IsNumber() ?
+        args[2]->IntegerValue() : LOG_DEFAULT_BUFFER_SIZE;
+    if (size < LOG_MIN_BUFFER_SIZE) size = LOG_MIN_BUFFER_SIZE;
+    if (size > LOG_MAX_BUFFER_SIZE) {
+      return ThrowException(Exception::RangeError(
+            String::New("bufferSize too large")));
+    }
+
+    Logger* logger = new Logger(args[0]->Int32Value(),
+                                args[1]->NumberValue(),
+                                static_cast<size_t>(size),
+                                args[3]->Int32Value());
+    if (logger->buffers_[0] == NULL || logger->buffers_[1] == NULL) {
+      delete logger;
+      return ThrowException(Exception::Error(String::New("Out of memory")));
+    }
+    logger->Wrap(args.This());
+
+    return scope.Close(args.This());
+  }
+
+  // log(level, msg, fields)
+  //
+  // Returns false for records below the logger's level.
+  static Handle<Value> Log(const Arguments& args) {
+    HandleScope scope;
+    Logger* logger = ObjectWrap::Unwrap<Logger>(args.This());
+
+    int level = args[0]->Int32Value();
+    if (level < logger->min_level_ || logger->closed_) return False();
+    if (level < 0) level = 0;
+    if (level >= static_cast<int>(LOG_LEVELS)) level = LOG_LEVELS - 1;
+
+    std::string& record = logger->record_;
+    record.clear();
+
+    char number[64];
+    double elapsed = static_cast<double>(uv_hrtime() - logger->hrtime_base_);
+    snprintf(number, sizeof number, "%.3f", logger->epoch_ + elapsed / 1e6);
+    record += "{\"t\":";
+    record += number;
+    record += ",\"level\":\"";
+    record += level_names[level];
+    record += "\",\"msg\":";
+    logger->AppendString(args[1]->ToString());
+
+    if (args[2]->IsObject()) {
+      Local<Object> fields = args[2]->ToObject();
+      Local<Array> keys = fields->GetOwnPropertyNames();
+      uint32_t length = keys->Length();
+      for (uint32_t i = 0; i < length; i++) {
+        Local<Value> key = keys->Get(i);
+        record += ',';
+        logger->AppendString(key->ToString());
+        record += ':';
+        logger->AppendValue(fields->Get(key));
+      }
+    }
+
+    record += "}\n";
+    logger->Append(record.data(), record.size());
+    logger->records_++;
+
+    return True();
+  }
+
+  // flush()
+  //
+  // Starts writing out the buffered records on the thread pool, unless a
+  // write is under way already; that one starts the next when it is done.
+  static Handle<Value> Flush(const Arguments& args) {
+    HandleScope scope;
+    Logger* logger = ObjectWrap::Unwrap<Logger>(args.This());
+    if (!logger->in_flight_) logger->Ship();
+    return Undefined();
+  }
+
+  // flushSync()
+  static Handle<Value> FlushSync(const Arguments& args) {
+    HandleScope scope;
+    Logger* logger = ObjectWrap::Unwrap<Logger>(args.This());
+    logger->WriteBuffered();
+    return Undefined();
+  }
+
+  // close()
+  //
+  // Writes what is buffered and drops later records. The file descriptor
+  // is left open for the caller to close.
+  static Handle<Value> Close(const Arguments& args) {
+    HandleScope scope;
+    Logger* logger = ObjectWrap::Unwrap<Logger>(args.This());
+    if (!logger->closed_) {
+      logger->WriteBuffered();
+      logger->closed_ = true;
+    }
+    return Undefined();
+  }
+
+  // stats() -> { records, bytes, errors }
+  static Handle<Value> Stats(const Arguments& args) {
+    HandleScope scope;
+    Logger* logger = ObjectWrap::Unwrap<Logger>(args.This());
+    Local<Object> stats = Object::New();
+    stats->Set(String::NewSymbol("records"),
+               Number::New(static_cast<double>(logger->records_)));
+    stats->Set(String::NewSymbol("bytes"),
+               Number::New(static_cast<double>(logger->bytes_)));
+    stats->Set(String::NewSymbol("errors"),
+               Number::New(static_cast<double>(logger->errors_)));
+    return scope.Close(stats);
+  }
+
+  // Appends value to the record as JSON. Numbers, booleans and null go in
+  // as they are, everything else as its string.
+  void AppendValue(Handle<Value> value) {
+    if (value->IsNumber()) {
+      double n = value->NumberValue();
+      char number[64];
+      if (value->IsInt32()) {
+        snprintf(number, sizeof number, "%d", value->Int32Value());
+      } else if (n != n || n - n != 0) {
+        // NaN and the infinities have no JSON form.
+        strcpy(number, "null");
+      } else {
+        snprintf(number, sizeof number, "%.17g", n);
+      }
+      record_ += number;
+    } else if (value->IsBoolean()) {
+      record_ += value->IsTrue() ? "true" : "false";
+    } else if (value->IsNull() || value->IsUndefined()) {
+      record_ += "null";
+    } else {
+      AppendString(value->ToString());
+    }
+  }
+
+  // Appends str to the record as a quoted JSON string.
+  void AppendString(Handle<String> str) {
+    static const char hex[] = "0123456789abcdef";
+
+    int length = str->Utf8Length();
+    if (scratch_.size() < static_cast<size_t>(length)) {
+      scratch_.resize(length);
+    }
+    if (length > 0) {
+      str->WriteUtf8(&scratch_[0], length, NULL, String::NO_NULL_TERMINATION);
+    }
+
+    record_ += '"';
+    const char* p = scratch_.data();
+    const char* end = p + length;
+    while (p < end) {
+      // Copy the longest run that needs no escaping in one go.
+      const char* run = p;
+      while (p < end && static_cast<unsigned char>(*p) >= 0x20 &&
+             *p != '"' && *p != '\\') {
+        p++;
+      }
+      record_.append(run, p - run);
+      if (p == end) break;
+
+      unsigned char c = static_cast<unsigned char>(*p++);
+      switch (c) {
+        case '"': record_ += "\\\""; break;
+        case '\\': record_ += "\\\\"; break;
+        case '\n': record_ += "\\n"; break;
+        case '\r': record_ += "\\r"; break;
+        case '\t': record_ += "\\t"; break;
+        default: {
+          char escape[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+          record_.append(escape, sizeof escape);
+        }
+      }
+    }
+    record_ += '"';
+  }
+
+  // Copies a finished record into the active buffer.
+  void Append(const char* data, size_t length) {
+    if (used_[active_] + length > size_) {
+      if (in_flight_) {
+        // Both buffers are taken: wait for the one being written.
+        WriteBuffered();
+      } else {
+        Ship();
+      }
+    }
+
+    if (length > size_) {
+      // Does not fit in any buffer, and everything before it is written.
+      uv_mutex_lock(&mutex_);
+      Written(WriteAll(fd_, data, length), length);
+      uv_mutex_unlock(&mutex_);
+      return;
+    }
+
+    memcpy(buffers_[active_] + used_[active_], data, length);
+    used_[active_] += length;
+  }
+
+  // Hands the active buffer to the thread pool.
+  void Ship() {
+    assert(!in_flight_);
+    if (used_[active_] == 0) return;
+
+    shipped_ = active_;
+    active_ = 1 - active_;
+    shipped_written_ = false;
+    in_flight_ = true;
+    // Keep the logger, and with the request the loop, alive until done.
+    Ref();
+    work_req_.work_type = WORK_OTHER;
+    uv_queue_work(Isolate::GetCurrentLoop(), &work_req_, Work, AfterWork);
+  }
+
+  // thread pool!
+  static void Work(uv_work_t* req) {
+    Logger* logger = static_cast<Logger*>(req->data);
+    uv_mutex_lock(&logger->mutex_);
+    if (!logger->shipped_written_) {
+      size_t length = logger->used_[logger->shipped_];
+      logger->work_errno_ = WriteAll(logger->fd_,
+                                     logger->buffers_[logger->shipped_],
+                                     length);
+      logger->work_length_ = length;
+      logger->shipped_written_ = true;
+    }
+    uv_mutex_unlock(&logger->mutex_);
+  }
+
+  static void AfterWork(uv_work_t* req) {
+    HandleScope scope;
+    Logger* logger = static_cast<Logger*>(req->data);
+
+    uv_mutex_lock(&logger->mutex_);
+    if (logger->work_length_ > 0) {
+      logger->Written(logger->work_errno_, logger->work_length_);
+      logger->work_length_ = 0;
+    }
+    uv_mutex_unlock(&logger->mutex_);
+
+    logger->used_[logger->shipped_] = 0;
+    logger->in_flight_ = false;
+
+    // Records that came in meanwhile go out right away.
+    if (!logger->closed_) logger->Ship();
+    logger->Unref();
+  }
+
+  // Writes the buffer being shipped, if the pool has not got to it yet, and
+  // then the active one, so that the records stay in order.
+  void WriteBuffered() {
+    uv_mutex_lock(&mutex_);
+    if (in_flight_ && !shipped_written_) {
+      size_t length = used_[shipped_];
+      Written(WriteAll(fd_, buffers_[shipped_], length), length);
+      shipped_written_ = true;
+    }
+    if (used_[active_] > 0) {
+      size_t length = used_[active_];
+      Written(WriteAll(fd_, buffers_[active_], length), length);
+      used_[active_] = 0;
+    }
+    uv_mutex_unlock(&mutex_);
+  }
+
+  // Counts a write. Records that could not be written are lost; logging
+  // does not throw.
+  void Written(int err, size_t length) {
+    if (err == 0) {
+      bytes_ += length;
+    } else {
+      errors_++;
+    }
+  }
+
+  int fd_;
+  int min_level_;
+  double epoch_;
+  uint64_t hrtime_base_;
+
+  size_t size_;
+  char* buffers_[2];
+  size_t used_[2];
+  int active_;
+  int shipped_;
+
+  uv_work_t work_req_;
+  bool in_flight_;
+  // Whoever writes the shipped buffer first, the pool or WriteBuffered(),
+  // sets this under the mutex.
+  bool shipped_written_;
+  bool closed_;
+  int work_errno_;
+  size_t work_length_;
+
+  std::string record_;
+  std::string scratch_;
+
+  uint64_t records_;
+  uint64_t bytes_;
+  uint64_t errors_;
+
+  uv_mutex_t mutex_;
+};
+
+
+void InitLog(Handle<Object> target) {
+  HandleScope scope;
+  Logger::Initialize(target);
+}
+
+}  // namespace node
+
+NODE_MODULE(node_log, node::InitLog)
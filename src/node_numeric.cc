@@ -0,0 +1,583 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <node.h>
+#include <v8_typed_array.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define NODE_NUMERIC_SSE2 1
+#endif
+
+namespace node {
+
+using namespace v8;
+
+// Reductions and maps over the elements of Float64Array, Float32Array,
+// Int32Array and Uint32Array, see lib/numeric.js. They read the backing
+// store directly; with a callback the array is cut into chunks that run in
+// parallel on the thread pool.
+//
+// Sums and dot products are accumulated in several lanes at once, so their
+// rounding differs from a loop in javascript in the last bits. Integer sums
+// are exact up to 2^53.
+
+// Elements per thread pool request.
+#define NUMERIC_CHUNK (1 << 20)
+
+enum NumericOp { OP_SUM, OP_MIN, OP_MAX, OP_DOT, OP_SCALE, OP_HISTOGRAM };
+
+struct Column {
+  ExternalArrayType type;
+  char* data;
+  size_t length;
+};
+
+// What to compute; only plain data, as it is read on the thread pool.
+struct NumericTask {
+  NumericOp op;
+  Column a;
+  Column b;
+  double factor;
+  double offset;
+  double lo;
+  double hi;
+  uint32_t bins;
+};
+
+struct Partial {
+  double value;
+  double lo;
+  double hi;
+  bool nan;
+  std::vector<uint32_t> counts;
+};
+
+
+// ECMAScript ToInt32, which V8 applies to numbers stored into integer arrays.
+static inline int32_t DoubleToInt32(double d) {
+  if (d >= -2147483648.0 && d <= 2147483647.0) return static_cast<int32_t>(d);
+  if (!isfinite(d)) return 0;
+  d = fmod(d < 0 ? ceil(d) : floor(d), 4294967296.0);
+  if (d < 0) d += 4294967296.0;
+  return static_cast<int32_t>(static_cast<uint32_t>(d));
+}
+
+template <typename T> static inline T Store(double v) {
+  return static_cast<T>(DoubleToInt32(v));
+}
+template <> inline float Store<float>(double v) {
+  return static_cast<float>(v);
+}
+template <> inline double Store<double>(double v) {
+  return v;
+}
+
+
+// Integers add up exactly in 64 bits, floating point in double.
+template <typename T> struct Accumulator { typedef double Type; };
+template <> struct Accumulator<int32_t> { typedef int64_t Type; };
+template <> struct Accumulator<uint32_t> { typedef uint64_t Type; };
+
+template <typename T>
+static double SumKernel(const T* p, size_t n) {
+  typedef typename Accumulator<T>::Type Acc;
+  Acc s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 += p[i];
+    s1 += p[i + 1];
+    s2 += p[i + 2];
+    s3 += p[i + 3];
+  }
+  for (; i < n; i++) s0 += p[i];
+  return static_cast<double>((s0 + s1) + (s2 + s3));
+}
+
+template <typename T>
+static double DotKernel(const T* a, const T* b, size_t n) {
+  double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 += static_cast<double>(a[i]) * b[i];
+    s1 += static_cast<double>(a[i + 1]) * b[i + 1];
+    s2 += static_cast<double>(a[i + 2]) * b[i + 2];
+    s3 += static_cast<double>(a[i + 3]) * b[i + 3];
+  }
+  for (; i < n; i++) s0 += static_cast<double>(a[i]) * b[i];
+  return (s0 + s1) + (s2 + s3);
+}
+
+// Both extremes at once; NaN, which only floating point arrays hold, is
+// noted on the side as it makes both NaN, like Math.min() and Math.max().
+template <typename T>
+static void ExtentKernel(const T* p, size_t n, Partial* out) {
+  T lo = p[0], hi = p[0];
+  bool nan = false;
+  for (size_t i = 0; i < n; i++) {
+    T v = p[i];
+    if (v < lo) lo = v;
+    if (v > hi) hi = v;
+    nan |= v != v;
+  }
+  out->lo = lo;
+  out->hi = hi;
+  out->nan = nan;
+}
+
+template <typename T>
+static void ScaleKernel(T* p, size_t n, double factor, double offset) {
+  for (size_t i = 0; i < n; i++) {
+    p[i] = Store<T>(p[i] * factor + offset);
+  }
+}
+
+// Bins of equal width over [lo, hi]; hi itself falls into the last one.
+// Values outside, and NaN, are not counted.
+template <typename T>
+static void HistogramKernel(const T* p, size_t n, double lo, double hi,
+                            uint32_t bins, uint32_t* counts) {
+  double scale = bins / (hi - lo);
+  for (size_t i = 0; i < n; i++) {
+    double v = p[i];
+    if (!(v >= lo && v <= hi)) continue;
+    uint32_t bin = static_cast<uint32_t>((v - lo) * scale);
+    counts[bin < bins ? bin : bins - 1]++;
+  }
+}
+
+
+#if defined(NODE_NUMERIC_SSE2)
+// SSE2 is part of x86-64, so these need no check at run time. Loads are
+// unaligned: typed arrays can start at any multiple of their element size.
+
+template <>
+double SumKernel<double>(const double* p, size_t n) {
+  __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 = _mm_add_pd(s0, _mm_loadu_pd(p + i));
+    s1 = _mm_add_pd(s1, _mm_loadu_pd(p + i + 2));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(s0, s1));
+  double s = lanes[0] + lanes[1];
+  for (; i < n; i++) s += p[i];
+  return s;
+}
+
+template <>
+double SumKernel<float>(const float* p, size_t n) {
+  __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(p + i);
+    s0 = _mm_add_pd(s0, _mm_cvtps_pd(v));
+    s1 = _mm_add_pd(s1, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(s0, s1));
+  double s = lanes[0] + lanes[1];
+  for (; i < n; i++) s += p[i];
+  return s;
+}
+
+template <>
+double DotKernel<double>(const double* a, const double* b, size_t n) {
+  __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2),
+                                   _mm_loadu_pd(b + i + 2)));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(s0, s1));
+  double s = lanes[0] + lanes[1];
+  for (; i < n; i++) s += a[i] * b[i];
+  return s;
+}
+
+template <>
+void ExtentKernel<double>(const double* p, size_t n, Partial* out) {
+  __m128d lo = _mm_set1_pd(p[0]), hi = lo;
+  __m128d nan = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d v = _mm_loadu_pd(p + i);
+    lo = _mm_min_pd(lo, v);
+    hi = _mm_max_pd(hi, v);
+    nan = _mm_or_pd(nan, _mm_cmpunord_pd(v, v));
+  }
+  double l[2], h[2];
+  _mm_storeu_pd(l, lo);
+  _mm_storeu_pd(h, hi);
+  out->lo = l[0] < l[1] ? l[0] : l[1];
+  out->hi = h[0] > h[1] ? h[0] : h[1];
+  out->nan = _mm_movemask_pd(nan) != 0;
+  for (; i < n; i++) {
+    if (p[i] < out->lo) out->lo = p[i];
+    if (p[i] > out->hi) out->hi = p[i];
+    out->nan |= p[i] != p[i];
+  }
+}
+
+template <>
+void ScaleKernel<double>(double* p, size_t n, double factor, double offset) {
+  __m128d f = _mm_set1_pd(factor), o = _mm_set1_pd(offset);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(p + i, _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(p + i), f), o));
+  }
+  for (; i < n; i++) p[i] = p[i] * factor + offset;
+}
+#endif
+
+
+// Runs `task` over elements [start, end) of its arrays.
+template <typename T>
+static void RunTyped(const NumericTask& task, size_t start, size_t end,
+                     Partial* out) {
+  T* a = reinterpret_cast<T*>(task.a.data) + start;
+  size_t n = end - start;
+
+  switch (task.op) {
+    case OP_SUM:
+      out->value = SumKernel(a, n);
+      break;
+    case OP_MIN:
+    case OP_MAX:
+      if (n > 0) ExtentKernel(a, n, out);
+      break;
+    case OP_DOT:
+      out->value = DotKernel(a, reinterpret_cast<T*>(task.b.data) + start, n);
+      break;
+    case OP_SCALE:
+      ScaleKernel(a, n, task.factor, task.offset);
+      break;
+    case OP_HISTOGRAM:
+      HistogramKernel(a, n, task.lo, task.hi, task.bins, &out->counts[0]);
+      break;
+  }
+}
+
+
+static void InitPartial(const NumericTask& task, Partial* out) {
+  out->value = 0;
+  out->lo = INFINITY;
+  out->hi = -INFINITY;
+  out->nan = false;
+  if (task.op == OP_HISTOGRAM) out->counts.assign(task.bins, 0);
+}
+
+
+static void RunTask(const NumericTask& task, size_t start, size_t end,
+                    Partial* out) {
+  InitPartial(task, out);
+  switch (task.a.type) {
+    case kExternalDoubleArray:
+      RunTyped<double>(task, start, end, out);
+      break;
+    case kExternalFloatArray:
+      RunTyped<float>(task, start, end, out);
+      break;
+    case kExternalIntArray:
+      RunTyped<int32_t>(task, start, end, out);
+      break;
+    case kExternalUnsignedIntArray:
+      RunTyped<uint32_t>(task, start, end, out);
+      break;
+    default:
+      assert(0 && "unreachable");
+  }
+}
+
+
+static void MergePartial(Partial* into, const Partial& from) {
+  into->value += from.value;
+  if (from.lo < into->lo) into->lo = from.lo;
+  if (from.hi > into->hi) into->hi = from.hi;
+  into->nan |= from.nan;
+  for (size_t i = 0; i < from.counts.size(); i++) {
+    into->counts[i] += from.counts[i];
+  }
+}
+
+
+static Local<Value> PartialToValue(const NumericTask& task,
+                                   const Partial& result,
+                                   Handle<Object> array) {
+  HandleScope scope;
+
+  switch (task.op) {
+    case OP_SUM:
+    case OP_DOT:
+      return scope.Close(Number::New(result.value));
+    case OP_MIN:
+      return scope.Close(Number::New(result.nan ? NAN : result.lo));
+    case OP_MAX:
+      return scope.Close(Number::New(result.nan ? NAN : result.hi));
+    case OP_SCALE:
+      return scope.Close(array);
+    case OP_HISTOGRAM: {
+      Local<Array> counts = Array::New(task.bins);
+      for (uint32_t i = 0; i < task.bins; i++) {
+        counts->Set(i, Integer::NewFromUnsigned(result.counts[i]));
+      }
+      return scope.Close(counts);
+    }
+  }
+  return scope.Close(Undefined());
+}
+
+
+// A task split over the thread pool. The chunks are merged into `total` as
+// they finish, on the loop thread, and the callback gets it after the last.
+struct NumericJob {
+  NumericTask task;
+  Partial total;
+  int pending;
+  // The arrays, kept alive along with the memory behind them.
+  Persistent<Object> array;
+  Persistent<Object> other;
+  Persistent<Function> callback;
+};
+
+struct NumericChunk {
+  uv_work_t req;
+  NumericJob* job;
+  size_t start;
+  size_t end;
+  Partial partial;
+};
+
+
+static void NumericWork(uv_work_t* req) {
+  NumericChunk* chunk = static_cast<NumericChunk*>(req->data);
+  RunTask(chunk->job->task, chunk->start, chunk->end, &chunk->partial);
+}
+
+
+static void AfterNumeric(uv_work_t* req) {
+  HandleScope scope;
+
+  NumericChunk* chunk = static_cast<NumericChunk*>(req->data);
+  NumericJob* job = chunk->job;
+
+  MergePartial(&job->total, chunk->partial);
+  delete chunk;
+
+  if (--job->pending > 0) return;
+
+  Local<Value> argv[2] = {
+    Local<Value>::New(Null()),
+    PartialToValue(job->task, job->total, job->array)
+  };
+
+  TryCatch try_catch;
+
+  job->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+
+  if (try_catch.HasCaught())
+    FatalException(try_catch);
+
+  job->array.Dispose();
+  job->other.Dispose();
+  job->callback.Dispose();
+  delete job;
+}
+
+
+static Handle<Value> Queue(const NumericTask& task,
+                           Handle<Object> array,
+                           Handle<Value> other,
+                           Handle<Value> callback) {
+  NumericJob* job = new NumericJob;
+  job->task = task;
+  InitPartial(task, &job->total);
+  job->array = Persistent<Object>::New(array);
+  if (other->IsObject()) {
+    job->other = Persistent<Object>::New(other->ToObject());
+  }
+  job->callback = Persistent<Function>::New(Handle<Function>::Cast(callback));
+
+  // An empty array still takes one trip, so that the callback is never
+  // called synchronously.
+  size_t length = task.a.length;
+  size_t nchunks = length > 0 ? (length + NUMERIC_CHUNK - 1) / NUMERIC_CHUNK
+                              : 1;
+  job->pending = nchunks;
+
+  for (size_t i = 0; i < nchunks; i++) {
+    NumericChunk* chunk = new NumericChunk;
+    chunk->job = job;
+    chunk->start = i * NUMERIC_CHUNK;
+    chunk->end = chunk->start + NUMERIC_CHUNK < length
+        ? chunk->start + NUMERIC_CHUNK
+        : length;
+    chunk->req.data = chunk;
+    chunk->req.work_type = WORK_OTHER;
+    uv_queue_work(Isolate::GetCurrentLoop(),
+                  &chunk->req,
+                  NumericWork,
+                  AfterNumeric);
+  }
+
+  return Undefined();
+}
+
+
+static bool GetColumn(Handle<Value> value, Column* column) {
+  if (!value->IsObject()) return false;
+
+  Local<Object> obj = value->ToObject();
+  if (!obj->HasIndexedPropertiesInExternalArrayData()) return false;
+
+  column->type = obj->GetIndexedPropertiesExternalArrayDataType();
+  switch (column->type) {
+    case kExternalDoubleArray:
+    case kExternalFloatArray:
+    case kExternalIntArray:
+    case kExternalUnsignedIntArray:
+      break;
+    default:
+      return false;
+  }
+
+  column->data = static_cast<char*>(
+      obj->GetIndexedPropertiesExternalArrayData());
+  column->length = obj->GetIndexedPropertiesExternalArrayDataLength();
+  return true;
+}
+
+
+// Computes `task` right away, or on the thread pool if `callback` is a
+// function.
+static Handle<Value> Run(const NumericTask& task,
+                         Handle<Value> array,
+                         Handle<Value> other,
+                         Handle<Value> callback) {
+  HandleScope scope;
+
+  if (callback->IsFunction()) {
+    return scope.Close(Queue(task, array->ToObject(), other, callback));
+  }
+
+  Partial result;
+  RunTask(task, 0, task.a.length, &result);
+  return scope.Close(PartialToValue(task, result, array->ToObject()));
+}
+
+
+#define THROW_TYPE_ERROR(msg) \
+  ThrowException(Exception::TypeError(String::New(msg)))
+
+#define COLUMN_ARG(index, column)                                           \
+  if (!GetColumn(args[index], &column)) {                                   \
+    return THROW_TYPE_ERROR("Argument must be a Float64Array, "             \
+                            "Float32Array, Int32Array or Uint32Array");     \
+  }
+
+
+static NumericTask NewTask(NumericOp op) {
+  NumericTask task;
+  memset(&task, 0, sizeof(task));
+  task.op = op;
+  return task;
+}
+
+
+// sum(array, [callback]), min(array, [callback]), max(array, [callback])
+template <NumericOp op>
+static Handle<Value> Reduce(const Arguments& args) {
+  HandleScope scope;
+  NumericTask task = NewTask(op);
+  COLUMN_ARG(0, task.a)
+  return scope.Close(Run(task, args[0], Undefined(), args[1]));
+}
+
+
+// dot(a, b, [callback])
+static Handle<Value> Dot(const Arguments& args) {
+  HandleScope scope;
+  NumericTask task = NewTask(OP_DOT);
+  COLUMN_ARG(0, task.a)
+  COLUMN_ARG(1, task.b)
+  if (task.a.type != task.b.type || task.a.length != task.b.length) {
+    return THROW_TYPE_ERROR("Arrays must be of the same type and length");
+  }
+  return scope.Close(Run(task, args[0], args[1], args[2]));
+}
+
+
+// scale(array, factor, offset, [callback]) sets every element x of `array`
+// to x * factor + offset.
+static Handle<Value> Scale(const Arguments& args) {
+  HandleScope scope;
+  NumericTask task = NewTask(OP_SCALE);
+  COLUMN_ARG(0, task.a)
+  if (!args[1]->IsNumber() || !args[2]->IsNumber()) {
+    return THROW_TYPE_ERROR("Factor and offset must be numbers");
+  }
+  task.factor = args[1]->NumberValue();
+  task.offset = args[2]->NumberValue();
+  return scope.Close(Run(task, args[0], Undefined(), args[3]));
+}
+
+
+// histogram(array, bins, min, max, [callback])
+static Handle<Value> Histogram(const Arguments& args) {
+  HandleScope scope;
+  NumericTask task = NewTask(OP_HISTOGRAM);
+  COLUMN_ARG(0, task.a)
+  if (!args[1]->IsUint32() || args[1]->Uint32Value() == 0) {
+    return THROW_TYPE_ERROR("Bins must be a positive integer");
+  }
+  task.bins = args[1]->Uint32Value();
+  task.lo = args[2]->NumberValue();
+  task.hi = args[3]->NumberValue();
+  if (!isfinite(task.lo) || !isfinite(task.hi) || !(task.lo < task.hi)) {
+    return THROW_TYPE_ERROR("Range must be finite with min below max");
+  }
+  return scope.Close(Run(task, args[0], Undefined(), args[4]));
+}
+
+
+void InitNumeric(Handle<Object> target) {
+  HandleScope scope;
+
+  NODE_SET_METHOD(target, "sum", Reduce<OP_SUM>);
+  NODE_SET_METHOD(target, "min", Reduce<OP_MIN>);
+  NODE_SET_METHOD(target, "max", Reduce<OP_MAX>);
+  NODE_SET_METHOD(target, "dot", Dot);
+  NODE_SET_METHOD(target, "scale", Scale);
+  NODE_SET_METHOD(target, "histogram", Histogram);
+}
+
+}  // namespace node
+
+NODE_MODULE(node_numeric, node::InitNumeric)
@@ -0,0 +1,151 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_PROBES_H_
+#define NODE_PROBES_H_
+
+// The probe points of the node provider, see src/node_provider.d. Each probe
+// NAME comes with NAME_ENABLED(), which is cheap and false while nothing is
+// attached to it; check it before gathering a probe's arguments.
+//
+// With DTrace the macros are generated from the provider. On Linux they are
+// systemtap-style USDT probes from <sys/sdt.h>, readable by systemtap, perf
+// and bpftrace, each with a semaphore that the tracer raises while it is
+// attached. Otherwise they compile to nothing.
+
+#if defined(HAVE_DTRACE)
+
+#include "node_provider.h"
+
+#elif defined(HAVE_SYSTEMTAP)
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define NODE_SDT_PROBES(X)                                                   \
+  X(net__server__connection)                                                 \
+  X(net__stream__end)                                                        \
+  X(net__socket__read)                                                       \
+  X(net__socket__write)                                                      \
+  X(http__server__request)                                                   \
+  X(http__server__response)                                                  \
+  X(http__client__request)                                                   \
+  X(http__client__response)                                                  \
+  X(http__parser__execute)                                                   \
+  X(fs__request__start)                                                      \
+  X(fs__request__done)                                                       \
+  X(eio__queue__depth)                                                       \
+  X(gc__start)                                                               \
+  X(gc__done)
+
+// The semaphores are defined in node_dtrace.cc.
+#define NODE_SDT_DECLARE_SEMAPHORE(name)                                     \
+  extern unsigned short node_##name##_semaphore;
+extern "C" {
+NODE_SDT_PROBES(NODE_SDT_DECLARE_SEMAPHORE)
+}
+#undef NODE_SDT_DECLARE_SEMAPHORE
+
+#define NODE_SDT_ENABLED(name) __builtin_expect(node_##name##_semaphore, 0)
+
+#define NODE_NET_SERVER_CONNECTION(arg0)                                     \
+  DTRACE_PROBE1(node, net__server__connection, arg0)
+#define NODE_NET_SERVER_CONNECTION_ENABLED()                                 \
+  NODE_SDT_ENABLED(net__server__connection)
+#define NODE_NET_STREAM_END(arg0)                                            \
+  DTRACE_PROBE1(node, net__stream__end, arg0)
+#define NODE_NET_STREAM_END_ENABLED() NODE_SDT_ENABLED(net__stream__end)
+#define NODE_NET_SOCKET_READ(arg0, arg1)                                     \
+  DTRACE_PROBE2(node, net__socket__read, arg0, arg1)
+#define NODE_NET_SOCKET_READ_ENABLED() NODE_SDT_ENABLED(net__socket__read)
+#define NODE_NET_SOCKET_WRITE(arg0, arg1)                                    \
+  DTRACE_PROBE2(node, net__socket__write, arg0, arg1)
+#define NODE_NET_SOCKET_WRITE_ENABLED() NODE_SDT_ENABLED(net__socket__write)
+#define NODE_HTTP_SERVER_REQUEST(arg0, arg1)                                 \
+  DTRACE_PROBE2(node, http__server__request, arg0, arg1)
+#define NODE_HTTP_SERVER_REQUEST_ENABLED()                                   \
+  NODE_SDT_ENABLED(http__server__request)
+#define NODE_HTTP_SERVER_RESPONSE(arg0)                                      \
+  DTRACE_PROBE1(node, http__server__response, arg0)
+#define NODE_HTTP_SERVER_RESPONSE_ENABLED()                                  \
+  NODE_SDT_ENABLED(http__server__response)
+#define NODE_HTTP_CLIENT_REQUEST(arg0, arg1)                                 \
+  DTRACE_PROBE2(node, http__client__request, arg0, arg1)
+#define NODE_HTTP_CLIENT_REQUEST_ENABLED()                                   \
+  NODE_SDT_ENABLED(http__client__request)
+#define NODE_HTTP_CLIENT_RESPONSE(arg0)                                      \
+  DTRACE_PROBE1(node, http__client__response, arg0)
+#define NODE_HTTP_CLIENT_RESPONSE_ENABLED()                                  \
+  NODE_SDT_ENABLED(http__client__response)
+#define NODE_HTTP_PARSER_EXECUTE(arg0, arg1, arg2)                           \
+  DTRACE_PROBE3(node, http__parser__execute, arg0, arg1, arg2)
+#define NODE_HTTP_PARSER_EXECUTE_ENABLED()                                   \
+  NODE_SDT_ENABLED(http__parser__execute)
+#define NODE_FS_REQUEST_START(arg0, arg1)                                    \
+  DTRACE_PROBE2(node, fs__request__start, arg0, arg1)
+#define NODE_FS_REQUEST_START_ENABLED() NODE_SDT_ENABLED(fs__request__start)
+#define NODE_FS_REQUEST_DONE(arg0, arg1, arg2, arg3)                         \
+  DTRACE_PROBE4(node, fs__request__done, arg0, arg1, arg2, arg3)
+#define NODE_FS_REQUEST_DONE_ENABLED() NODE_SDT_ENABLED(fs__request__done)
+#define NODE_EIO_QUEUE_DEPTH(arg0, arg1)                                     \
+  DTRACE_PROBE2(node, eio__queue__depth, arg0, arg1)
+#define NODE_EIO_QUEUE_DEPTH_ENABLED() NODE_SDT_ENABLED(eio__queue__depth)
+#define NODE_GC_START(arg0, arg1)                                            \
+  DTRACE_PROBE2(node, gc__start, arg0, arg1)
+#define NODE_GC_START_ENABLED() NODE_SDT_ENABLED(gc__start)
+#define NODE_GC_DONE(arg0, arg1)                                             \
+  DTRACE_PROBE2(node, gc__done, arg0, arg1)
+#define NODE_GC_DONE_ENABLED() NODE_SDT_ENABLED(gc__done)
+
+#else
+
+#define NODE_HTTP_SERVER_REQUEST(arg0, arg1)
+#define NODE_HTTP_SERVER_REQUEST_ENABLED() (0)
+#define NODE_HTTP_SERVER_RESPONSE(arg0)
+#define NODE_HTTP_SERVER_RESPONSE_ENABLED() (0)
+#define NODE_HTTP_CLIENT_REQUEST(arg0, arg1)
+#define NODE_HTTP_CLIENT_REQUEST_ENABLED() (0)
+#define NODE_HTTP_CLIENT_RESPONSE(arg0)
+#define NODE_HTTP_CLIENT_RESPONSE_ENABLED() (0)
+#define NODE_HTTP_PARSER_EXECUTE(arg0, arg1, arg2)
+#define NODE_HTTP_PARSER_EXECUTE_ENABLED() (0)
+#define NODE_NET_SERVER_CONNECTION(arg0)
+#define NODE_NET_SERVER_CONNECTION_ENABLED() (0)
+#define NODE_NET_STREAM_END(arg0)
+#define NODE_NET_STREAM_END_ENABLED() (0)
+#define NODE_NET_SOCKET_READ(arg0, arg1)
+#define NODE_NET_SOCKET_READ_ENABLED() (0)
+#define NODE_NET_SOCKET_WRITE(arg0, arg1)
+#define NODE_NET_SOCKET_WRITE_ENABLED() (0)
+#define NODE_FS_REQUEST_START(arg0, arg1)
+#define NODE_FS_REQUEST_START_ENABLED() (0)
+#define NODE_FS_REQUEST_DONE(arg0, arg1, arg2, arg3)
+#define NODE_FS_REQUEST_DONE_ENABLED() (0)
+#define NODE_EIO_QUEUE_DEPTH(arg0, arg1)
+#define NODE_EIO_QUEUE_DEPTH_ENABLED() (0)
+#define NODE_GC_START(arg0, arg1)
+#define NODE_GC_START_ENABLED() (0)
+#define NODE_GC_DONE(arg0, arg1)
+#define NODE_GC_DONE_ENABLED() (0)
+
+#endif
+
+#endif  // NODE_PROBES_H_
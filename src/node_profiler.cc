@@ -0,0 +1,228 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <node.h>
+#include <v8.h>
+#include <v8-profiler.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string>
+
+#ifdef __POSIX__
+# include <unistd.h>
+#else
+# include <io.h>
+#endif
+
+// Heap snapshots are written out in chunks of this size as they are
+// serialized.
+#define HEAP_SNAPSHOT_CHUNK_SIZE (64 * 1024)
+
+namespace node {
+
+using namespace v8;
+
+// Wraps V8's sampling CPU profiler. A stopped profile is turned into JSON
+// here, in one pass over the call tree, rather than into a tree of
+// javascript objects that would cost more than the profile itself:
+//
+//   { "title": "...",
+//     "head": { "functionName": "...", "url": "...", "lineNumber": 0,
+//               "callUID": 0, "selfSamples": 0, "totalSamples": 0,
+//               "selfTime": 0, "totalTime": 0, "children": [ ... ] } }
+//
+// Times are in milliseconds.
+
+static void AppendJSONString(std::string* out, Handle<String> value) {
+  String::Utf8Value utf8(value);
+  const char* s = *utf8;
+  int length = utf8.length();
+
+  out->push_back('"');
+  for (int i = 0; i < length; i++) {
+    unsigned char c = s[i];
+    switch (c) {
+      case '"': out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '\n': out->append("\\n"); break;
+      case '\r': out->append("\\r"); break;
+      case '\t': out->append("\\t"); break;
+      default:
+        if (c < 0x20) {
+          char escape[8];
+          snprintf(escape, sizeof escape, "\\u%04x", c);
+          out->append(escape);
+        } else {
+          out->push_back(c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+
+static void AppendNumber(std::string* out, const char* key, double value) {
+  char number[64];
+  snprintf(number, sizeof number, ",\"%s\":%.15g", key, value);
+  out->append(number);
+}
+
+
+static void AppendNode(std::string* out, const CpuProfileNode* node) {
+  out->append("{\"functionName\":");
+  AppendJSONString(out, node->GetFunctionName());
+  out->append(",\"url\":");
+  AppendJSONString(out, node->GetScriptResourceName());
+  AppendNumber(out, "lineNumber", node->GetLineNumber());
+  AppendNumber(out, "callUID", node->GetCallUid());
+  AppendNumber(out, "selfSamples", node->GetSelfSamplesCount());
+  AppendNumber(out, "totalSamples", node->GetTotalSamplesCount());
+  AppendNumber(out, "selfTime", node->GetSelfTime());
+  AppendNumber(out, "totalTime", node->GetTotalTime());
+  out->append(",\"children\":[");
+
+  int count = node->GetChildrenCount();
+  for (int i = 0; i < count; i++) {
+    if (i > 0) out->push_back(',');
+    AppendNode(out, node->GetChild(i));
+  }
+
+  out->append("]}");
+}
+
+
+// startProfiling(title)
+static Handle<Value> StartProfiling(const Arguments& args) {
+  HandleScope scope;
+
+  Local<String> title = args[0]->IsString() ? args[0]->ToString()
+                                            : String::Empty();
+  CpuProfiler::StartProfiling(title);
+
+  return Undefined();
+}
+
+
+// stopProfiling(title) returns the profile as JSON, or null when no
+// profile of that title was being recorded.
+static Handle<Value> StopProfiling(const Arguments& args) {
+  HandleScope scope;
+
+  Local<String> title = args[0]->IsString() ? args[0]->ToString()
+                                            : String::Empty();
+  const CpuProfile* profile = CpuProfiler::StopProfiling(title);
+  if (profile == NULL) return scope.Close(Null());
+
+  std::string json;
+  json.reserve(64 * 1024);
+  json.append("{\"title\":");
+  AppendJSONString(&json, profile->GetTitle());
+  json.append(",\"head\":");
+  AppendNode(&json, profile->GetTopDownRoot());
+  json.push_back('}');
+
+  // V8 keeps every profile until it is deleted.
+  const_cast<CpuProfile*>(profile)->Delete();
+
+  return scope.Close(String::New(json.data(), json.length()));
+}
+
+
+static Handle<Value> GetProfilesCount(const Arguments& args) {
+  HandleScope scope;
+  return scope.Close(Integer::New(CpuProfiler::GetProfilesCount()));
+}
+
+
+// Writes what V8 serializes straight to a file descriptor, so a snapshot
+// never exists as a whole, in the javascript heap or anywhere else.
+class FdOutputStream : public OutputStream {
+ public:
+  explicit FdOutputStream(int fd) : fd_(fd), error_(0) {}
+
+  void EndOfStream() {}
+
+  int GetChunkSize() { return HEAP_SNAPSHOT_CHUNK_SIZE; }
+
+  WriteResult WriteAsciiChunk(char* data, int size) {
+    while (size > 0) {
+      int n = write(fd_, data, size);
+      if (n == -1) {
+        if (errno == EINTR) continue;
+        error_ = errno;
+        return kAbort;
+      }
+      data += n;
+      size -= n;
+    }
+    return kContinue;
+  }
+
+  int error() const { return error_; }
+
+ private:
+  int fd_;
+  int error_;
+};
+
+
+// writeHeapSnapshot(fd, title) takes a full heap snapshot and writes it to
+// fd in V8's JSON snapshot format, the one the Chrome developer tools load.
+static Handle<Value> WriteHeapSnapshot(const Arguments& args) {
+  HandleScope scope;
+
+  int fd = args[0]->Int32Value();
+  Local<String> title = args[1]->IsString() ? args[1]->ToString()
+                                            : String::Empty();
+
+  const HeapSnapshot* snapshot = HeapProfiler::TakeSnapshot(title);
+  if (snapshot == NULL) {
+    return ThrowException(Exception::Error(
+        String::New("Could not take a heap snapshot")));
+  }
+
+  FdOutputStream stream(fd);
+  snapshot->Serialize(&stream, HeapSnapshot::kJSON);
+  const_cast<HeapSnapshot*>(snapshot)->Delete();
+
+  if (stream.error()) {
+    return ThrowException(ErrnoException(stream.error(), "write"));
+  }
+
+  return Undefined();
+}
+
+
+static void InitProfiler(Handle<Object> target) {
+  HandleScope scope;
+
+  NODE_SET_METHOD(target, "startProfiling", StartProfiling);
+  NODE_SET_METHOD(target, "stopProfiling", StopProfiling);
+  NODE_SET_METHOD(target, "getProfilesCount", GetProfilesCount);
+  NODE_SET_METHOD(target, "writeHeapSnapshot", WriteHeapSnapshot);
+}
+
+
+}  // namespace node
+
+NODE_MODULE(node_profiler, node::InitProfiler)
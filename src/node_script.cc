@@ -22,6 +22,15 @@
 #include <node.h>
 #include <node_script.h>
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(_MSC_VER)
+#include <process.h>
+#define getpid _getpid
+#define snprintf _snprintf
+#else
+#include <unistd.h>
+#endif
 
 namespace node {
 
@@ -42,10 +51,51 @@ using v8::Persistent;
 using v8::Integer;
 using v8::Function;
 using v8::FunctionTemplate;
+using v8::ScriptData;
+using v8::ScriptOrigin;
+using v8::PropertyAttribute;
+using v8::V8;
+
+// Idle contexts runInPooledContext() keeps per isolate.
+#define SCRIPT_CONTEXT_POOL_SIZE 4
+
+// A context of the pool, with the own properties its global object had when
+// it was new and their attributes, which Reset() puts back.
+struct PooledContext {
+  Persistent<Context> context;
+  Persistent<Object> values;
+  Persistent<Object> attributes;
+};
+
+// Entries in the cache of CompiledScript(), indexed by a hash of the code.
+#define SCRIPT_CACHE_SIZE 64
+
+struct CachedScript {
+  uint32_t hash;
+  Persistent<String> code;
+  Persistent<String> filename;
+  Persistent<Script> script;
+};
 
 class ScriptStatics : public ModuleStatics {
+ public:
+  ScriptStatics() : context_pool_count(0) {}
+
+ private:
+  PooledContext TakeContext();
+  void ReturnContext(PooledContext pooled, bool reuse);
+  static void Snapshot(PooledContext& pooled);
+  static bool Reset(PooledContext& pooled);
+  Handle<Script> CompiledScript(Handle<String> code, Handle<String> filename);
+
   Persistent<FunctionTemplate> context_constructor_template;
   Persistent<FunctionTemplate> script_constructor_template;
+  Persistent<Function> clone_property_method;
+  PooledContext context_pool[SCRIPT_CONTEXT_POOL_SIZE];
+  int context_pool_count;
+  CachedScript script_cache[SCRIPT_CACHE_SIZE];
+
+  friend void CloneObject(Handle<Object> source, Handle<Object> target);
   friend class WrappedContext;
   friend class WrappedScript;
 };
@@ -71,7 +121,8 @@ class WrappedScript : ObjectWrap {
   static void Initialize(Handle<Object> target);
 
   enum EvalInputFlags { compileCode, unwrapExternal };
-  enum EvalContextFlags { thisContext, newContext, userContext };
+  enum EvalContextFlags { thisContext, newContext, userContext,
+                          pooledContext };
   enum EvalOutputFlags { returnResult, wrapExternal };
 
   template <EvalInputFlags input_flag,
@@ -88,43 +139,161 @@ class WrappedScript : ObjectWrap {
   static Handle<Value> RunInContext(const Arguments& args);
   static Handle<Value> RunInThisContext(const Arguments& args);
   static Handle<Value> RunInNewContext(const Arguments& args);
+  static Handle<Value> RunInPooledContext(const Arguments& args);
   static Handle<Value> CompileRunInContext(const Arguments& args);
   static Handle<Value> CompileRunInThisContext(const Arguments& args);
   static Handle<Value> CompileRunInNewContext(const Arguments& args);
+  static Handle<Value> CompileRunInPooledContext(const Arguments& args);
+  static Handle<Value> CompileRunInThisContextCached(const Arguments& args);
 
   Persistent<Script> script_;
 };
 
 
-Persistent<Function> cloneObjectMethod;
+// Copies the own properties of source onto target with their attributes,
+// skipping those that cannot be set. A value that is source itself becomes
+// target. The API cannot define accessors, so those go through
+// clone_property_method.
+void CloneObject(Handle<Object> source, Handle<Object> target) {
+  HandleScope scope;
+  ScriptStatics *statics = NODE_STATICS_GET(node_evals, ScriptStatics);
+
+  Local<Array> keys = source->GetOwnPropertyNames();
+  uint32_t length = keys->Length();
+
+  for (uint32_t i = 0; i < length; i++) {
+    TryCatch try_catch;
+    Local<Value> key = keys->Get(i);
+
+    if (key->IsNumber()) {
+      Local<Value> value = source->Get(key);
+      if (!value.IsEmpty()) target->Set(key, value);
+    } else if (source->HasRealNamedCallbackProperty(key->ToString())) {
+      Handle<Value> args[] = { source, target, key };
+      statics->clone_property_method->Call(target, 3, args);
+    } else {
+      Handle<Value> value = source->Get(key);
+      if (!value.IsEmpty()) {
+        if (value->StrictEquals(source)) value = target;
+        target->ForceSet(key, value, source->GetPropertyAttributes(key));
+      }
+    }
 
-void CloneObject(Handle<Object> recv,
-                 Handle<Value> source, Handle<Value> target) {
+    if (try_catch.HasCaught() && !try_catch.CanContinue()) {
+      // See EvalMachine.
+      v8::V8::TerminateExecution();
+      return;
+    }
+  }
+}
+
+
+PooledContext ScriptStatics::TakeContext() {
+  if (context_pool_count > 0) return context_pool[--context_pool_count];
+
+  PooledContext pooled;
+  pooled.context = Context::New();
+  return pooled;
+}
+
+
+void ScriptStatics::ReturnContext(PooledContext pooled, bool reuse) {
+  if (reuse && context_pool_count < SCRIPT_CONTEXT_POOL_SIZE) {
+    context_pool[context_pool_count++] = pooled;
+    return;
+  }
+
+  pooled.context->DetachGlobal();
+  pooled.context.Dispose();
+  pooled.values.Dispose();
+  pooled.attributes.Dispose();
+}
+
+
+// Both need pooled.context entered: its global object refuses access from
+// other contexts.
+void ScriptStatics::Snapshot(PooledContext& pooled) {
   HandleScope scope;
 
-  Handle<Value> args[] = {source, target};
-
-  // Init
-  if (cloneObjectMethod.IsEmpty()) {
-    Local<Function> cloneObjectMethod_ = Local<Function>::Cast(
-      Script::Compile(String::New(
-        "(function(source, target) {\n\
-           Object.getOwnPropertyNames(source).forEach(function(key) {\n\
-           try {\n\
-             var desc = Object.getOwnPropertyDescriptor(source, key);\n\
-             if (desc.value === source) desc.value = target;\n\
-             Object.defineProperty(target, key, desc);\n\
-           } catch (e) {\n\
-            // Catch sealed properties errors\n\
-           }\n\
-         });\n\
-        })"
-      ), String::New("binding:script"))->Run()
-    );
-    cloneObjectMethod = Persistent<Function>::New(cloneObjectMethod_);
+  Local<Object> global = pooled.context->Global()->GetPrototype()->ToObject();
+  Local<Array> keys = global->GetOwnPropertyNames();
+  Local<Object> values = Object::New();
+  Local<Object> attributes = Object::New();
+
+  for (uint32_t i = 0; i < keys->Length(); i++) {
+    Local<Value> key = keys->Get(i);
+    values->Set(key, global->Get(key));
+    attributes->Set(key, Integer::New(global->GetPropertyAttributes(key)));
   }
 
-  cloneObjectMethod->Call(recv, 2, args);
+  pooled.values = Persistent<Object>::New(values);
+  pooled.attributes = Persistent<Object>::New(attributes);
+}
+
+
+// Deletes what a script added to the global object and puts back what it
+// replaced or deleted. Changes to the built-in objects themselves stay.
+// False if the context cannot be reused.
+bool ScriptStatics::Reset(PooledContext& pooled) {
+  HandleScope scope;
+  TryCatch try_catch;
+
+  Local<Object> global = pooled.context->Global()->GetPrototype()->ToObject();
+  Local<Array> keys = global->GetOwnPropertyNames();
+
+  for (uint32_t i = 0; i < keys->Length(); i++) {
+    Local<Value> key = keys->Get(i);
+    if (key->IsNumber() || !pooled.values->HasOwnProperty(key->ToString())) {
+      if (!global->ForceDelete(key)) return false;
+    }
+  }
+
+  keys = pooled.values->GetOwnPropertyNames();
+
+  for (uint32_t i = 0; i < keys->Length(); i++) {
+    Local<Value> key = keys->Get(i);
+    PropertyAttribute attributes = static_cast<PropertyAttribute>(
+        pooled.attributes->Get(key)->Int32Value());
+    if (!global->ForceSet(key, pooled.values->Get(key), attributes)) {
+      return false;
+    }
+  }
+
+  return !try_catch.HasCaught();
+}
+
+
+// Compiles code unbound to any context, or returns what an earlier call
+// compiled for the same code and filename, so that code run in one context
+// after another is parsed once. Empty on a syntax error.
+Handle<Script> ScriptStatics::CompiledScript(Handle<String> code,
+                                             Handle<String> filename) {
+  String::Value chars(code);
+  const uint16_t *p = *chars;
+  // FNV-1a
+  uint32_t hash = 2166136261U;
+  for (int i = 0; i < chars.length(); i++) {
+    hash = (hash ^ p[i]) * 16777619U;
+  }
+
+  CachedScript& entry = script_cache[hash % SCRIPT_CACHE_SIZE];
+  if (!entry.script.IsEmpty() && entry.hash == hash &&
+      entry.code->StrictEquals(code) && entry.filename->StrictEquals(filename)) {
+    return entry.script;
+  }
+
+  Local<Script> script = Script::New(code, filename);
+  if (script.IsEmpty()) return script;
+
+  entry.code.Dispose();
+  entry.filename.Dispose();
+  entry.script.Dispose();
+  entry.hash = hash;
+  entry.code = Persistent<String>::New(code);
+  entry.filename = Persistent<String>::New(filename);
+  entry.script = Persistent<Script>::New(script);
+
+  return script;
 }
 
 
@@ -207,6 +376,10 @@ void WrappedScript::Initialize(Handle<Object> target) {
                             "runInNewContext",
                             WrappedScript::RunInNewContext);
 
+  NODE_SET_PROTOTYPE_METHOD(statics->script_constructor_template,
+                            "runInPooledContext",
+                            WrappedScript::RunInPooledContext);
+
   NODE_SET_METHOD(statics->script_constructor_template,
                   "createContext",
                   WrappedScript::CreateContext);
@@ -223,6 +396,24 @@ void WrappedScript::Initialize(Handle<Object> target) {
                   "runInNewContext",
                   WrappedScript::CompileRunInNewContext);
 
+  NODE_SET_METHOD(statics->script_constructor_template,
+                  "runInPooledContext",
+                  WrappedScript::CompileRunInPooledContext);
+
+  NODE_SET_METHOD(statics->script_constructor_template,
+                  "runInThisContextCached",
+                  WrappedScript::CompileRunInThisContextCached);
+
+  // Copies one property by its descriptor, for CloneObject().
+  Local<Value> clone_property = Script::Compile(String::New(
+      "(function(source, target, key) {\n"
+      "  var desc = Object.getOwnPropertyDescriptor(source, key);\n"
+      "  if (desc.value === source) desc.value = target;\n"
+      "  Object.defineProperty(target, key, desc);\n"
+      "})"), String::New("binding:script"))->Run();
+  statics->clone_property_method =
+      Persistent<Function>::New(Local<Function>::Cast(clone_property));
+
   target->Set(String::NewSymbol("NodeScript"),
               statics->script_constructor_template->GetFunction());
 }
@@ -257,7 +448,7 @@ Handle<Value> WrappedScript::CreateContext(const Arguments& args) {
   if (args.Length() > 0) {
     Local<Object> sandbox = args[0]->ToObject();
 
-    CloneObject(args.This(), sandbox, context);
+    CloneObject(sandbox, context);
   }
 
 
@@ -283,6 +474,13 @@ Handle<Value> WrappedScript::RunInNewContext(const Arguments& args) {
 }
 
 
+Handle<Value> WrappedScript::RunInPooledContext(const Arguments& args) {
+  return
+    WrappedScript::EvalMachine<unwrapExternal, pooledContext, returnResult>(
+        args);
+}
+
+
 Handle<Value> WrappedScript::CompileRunInContext(const Arguments& args) {
   return
     WrappedScript::EvalMachine<compileCode, userContext, returnResult>(args);
@@ -301,6 +499,163 @@ Handle<Value> WrappedScript::CompileRunInNewContext(const Arguments& args) {
 }
 
 
+Handle<Value> WrappedScript::CompileRunInPooledContext(const Arguments& args) {
+  return
+    WrappedScript::EvalMachine<compileCode, pooledContext, returnResult>(args);
+}
+
+
+// Cache entries are named after a hash of the V8 version and the source,
+// and start with a header that has to match before the data is used.
+struct PreDataHeader {
+  char magic[4];
+  uint32_t source_length;
+  uint64_t hash;
+  uint32_t data_length;
+};
+
+static const char pre_data_magic[4] = { 'N', 'P', 'D', '1' };
+
+
+static uint64_t HashPreDataSource(const char *source, size_t length) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  const char *version = V8::GetVersion();
+  for (const char *p = version; *p; p++) {
+    hash = (hash ^ (unsigned char) *p) * 1099511628211ULL;
+  }
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (unsigned char) source[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+
+static ScriptData* ReadPreData(const char *path,
+                               uint64_t hash,
+                               size_t source_length) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) return NULL;
+
+  ScriptData *pre_data = NULL;
+  PreDataHeader header;
+  if (fread(&header, sizeof(header), 1, f) == 1 &&
+      memcmp(header.magic, pre_data_magic, sizeof(pre_data_magic)) == 0 &&
+      header.hash == hash &&
+      header.source_length == source_length &&
+      header.data_length > 0) {
+    char *data = new char[header.data_length];
+    if (fread(data, 1, header.data_length, f) == header.data_length) {
+      pre_data = ScriptData::New(data, header.data_length);
+      if (pre_data->HasError()) {
+        delete pre_data;
+        pre_data = NULL;
+      }
+    }
+    delete [] data;
+  }
+
+  fclose(f);
+  return pre_data;
+}
+
+
+static void WritePreData(const char *path,
+                         uint64_t hash,
+                         size_t source_length,
+                         ScriptData *pre_data) {
+  PreDataHeader header;
+  memcpy(header.magic, pre_data_magic, sizeof(pre_data_magic));
+  header.source_length = source_length;
+  header.hash = hash;
+  header.data_length = pre_data->Length();
+
+  // Write to a name of our own and rename into place, so that readers never
+  // see a partial entry.
+  char tmp[PATH_MAX];
+  snprintf(tmp, sizeof(tmp), "%s.%d.%p", path, (int) getpid(), &header);
+  tmp[sizeof(tmp) - 1] = '\0';
+
+  FILE *f = fopen(tmp, "wb");
+  if (f == NULL) return;
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(pre_data->Data(), 1, header.data_length, f) ==
+                header.data_length;
+  ok = fclose(f) == 0 && ok;
+
+  if (!ok || rename(tmp, path) != 0) remove(tmp);
+}
+
+
+ScriptData* CachedPreData(const char *cache_dir,
+                          const char *source,
+                          size_t length) {
+  uint64_t hash = HashPreDataSource(source, length);
+
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%08x%08x.pre", cache_dir,
+           (unsigned) (hash >> 32), (unsigned) hash);
+  path[sizeof(path) - 1] = '\0';
+
+  ScriptData *pre_data = ReadPreData(path, hash, length);
+  if (pre_data) return pre_data;
+
+  pre_data = ScriptData::PreCompile(source, length);
+  if (pre_data->HasError()) {
+    delete pre_data;
+    return NULL;
+  }
+
+  WritePreData(path, hash, length, pre_data);
+  return pre_data;
+}
+
+
+// runInThisContextCached(code, filename, cacheDir) is
+// runInThisContext(code, filename, true), with the pre-parse data for `code`
+// kept in cacheDir.
+Handle<Value> WrappedScript::CompileRunInThisContextCached(
+    const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 3) {
+    return ThrowException(Exception::TypeError(
+          String::New("needs 'code', 'filename' and 'cacheDir' arguments.")));
+  }
+
+  Local<String> code = args[0]->ToString();
+  Local<String> filename = args[1]->ToString();
+  String::Utf8Value cache_dir(args[2]);
+
+  String::Utf8Value source(code);
+  ScriptData *pre_data = CachedPreData(*cache_dir,
+                                       *source,
+                                       source.length());
+
+  TryCatch try_catch;
+
+  ScriptOrigin origin(filename);
+  Handle<Script> script = Script::Compile(code, &origin, pre_data);
+  delete pre_data;
+
+  if (script.IsEmpty()) {
+    // Same as EvalMachine, see there.
+    DisplayExceptionLine(try_catch);
+    return try_catch.ReThrow();
+  }
+
+  Handle<Value> result = script->Run();
+  if (result.IsEmpty()) {
+    if (try_catch.CanContinue())
+      return try_catch.ReThrow();
+    v8::V8::TerminateExecution();
+    return v8::Undefined();
+  }
+
+  return scope.Close(result);
+}
+
+
 template <WrappedScript::EvalInputFlags input_flag,
           WrappedScript::EvalContextFlags context_flag,
           WrappedScript::EvalOutputFlags output_flag>
@@ -325,7 +680,7 @@ Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
   if (input_flag == compileCode) code = args[0]->ToString();
 
   Local<Object> sandbox;
-  if (context_flag == newContext) {
+  if (context_flag == newContext || context_flag == pooledContext) {
     sandbox = args[sandbox_index]->IsObject() ? args[sandbox_index]->ToObject()
                                               : Object::New();
   } else if (context_flag == userContext) {
@@ -347,12 +702,17 @@ Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
   }
 
   Persistent<Context> context;
+  ScriptStatics *statics = NODE_STATICS_GET(node_evals, ScriptStatics);
+  PooledContext pooled;
 
-  Local<Array> keys;
   if (context_flag == newContext) {
     // Create the new context
     context = Context::New();
 
+  } else if (context_flag == pooledContext) {
+    pooled = statics->TakeContext();
+    context = pooled.context;
+
   } else if (context_flag == userContext) {
     // Use the passed in context
     Local<Object> contextArg = args[sandbox_index]->ToObject();
@@ -360,14 +720,18 @@ Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
     context = nContext->GetV8Context();
   }
 
-  // New and user context share code. DRY it up.
-  if (context_flag == userContext || context_flag == newContext) {
+  // New, pooled and user context share code. DRY it up.
+  if (context_flag != thisContext) {
     // Enter the context
     context->Enter();
 
+    if (context_flag == pooledContext && pooled.values.IsEmpty()) {
+      ScriptStatics::Snapshot(pooled);
+    }
+
     // Copy everything from the passed in sandbox (either the persistent
     // context for runInContext(), or the sandbox arg to runInNewContext()).
-    CloneObject(args.This(), sandbox, context->Global()->GetPrototype());
+    CloneObject(sandbox, context->Global()->GetPrototype()->ToObject());
   }
 
   // Catch errors
@@ -376,15 +740,27 @@ Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
   Handle<Value> result;
   Handle<Script> script;
 
-  if (input_flag == compileCode) {
+  if (input_flag == compileCode && context_flag != thisContext) {
+    // Code run in other contexts tends to be run in many of them.
+    script = statics->CompiledScript(code, filename);
+  } else if (input_flag == compileCode) {
     // well, here WrappedScript::New would suffice in all cases, but maybe
     // Compile has a little better performance where possible
     script = output_flag == returnResult ? Script::Compile(code, filename)
                                          : Script::New(code, filename);
+  }
+
+  if (input_flag == compileCode) {
     if (script.IsEmpty()) {
       // FIXME UGLY HACK TO DISPLAY SYNTAX ERRORS.
       if (display_error) DisplayExceptionLine(try_catch);
 
+      if (context_flag == pooledContext) {
+        bool reuse = ScriptStatics::Reset(pooled);
+        context->Exit();
+        statics->ReturnContext(pooled, reuse);
+      }
+
       // Hack because I can't get a proper stacktrace on SyntaxError
       return try_catch.ReThrow();
     }
@@ -410,6 +786,11 @@ Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
         context->DetachGlobal();
         context->Exit();
         context.Dispose();
+      } else if (context_flag == pooledContext) {
+        // A terminated script may have left the context anyhow.
+        bool reuse = try_catch.CanContinue() && ScriptStatics::Reset(pooled);
+        context->Exit();
+        statics->ReturnContext(pooled, reuse);
       }
       /* ReThrow doesn't re-throw TerminationExceptions; a null exception value
        * is re-thrown instead (see Isolate::PropagatePendingExceptionToExternalTryCatch())
@@ -429,12 +810,17 @@ Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
     result = args.This();
   }
 
-  if (context_flag == userContext || context_flag == newContext) {
+  if (context_flag != thisContext) {
     // success! copy changes back onto the sandbox object.
-    CloneObject(args.This(), context->Global()->GetPrototype(), sandbox);
+    CloneObject(context->Global()->GetPrototype()->ToObject(), sandbox);
   }
 
-  if (context_flag == newContext) {
+  if (context_flag == pooledContext) {
+    // Put the context back the way it came out of the pool.
+    bool reuse = ScriptStatics::Reset(pooled);
+    context->Exit();
+    statics->ReturnContext(pooled, reuse);
+  } else if (context_flag == newContext) {
     // Clean up, clean up, everybody everywhere!
     context->DetachGlobal();
     context->Exit();
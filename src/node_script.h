@@ -32,5 +32,12 @@ namespace node {
 
 void InitEvals(v8::Handle<v8::Object> target);
 
+// Returns pre-parse data for the UTF-8 `source`, read from `cache_dir` if
+// it holds an entry for this source, or computed and stored there if not.
+// The caller deletes the result, which is NULL if the source doesn't parse.
+v8::ScriptData* CachedPreData(const char *cache_dir,
+                              const char *source,
+                              size_t length);
+
 } // namespace node
 #endif //  node_script_h
@@ -0,0 +1,762 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+
+#include <node.h>
+#include <node_buffer.h>
+#include <node_object_wrap.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define UNWRAP \
+  assert(!args.Holder().IsEmpty()); \
+  assert(args.Holder()->InternalFieldCount() > 0); \
+  ShmCache* cache = ObjectWrap::Unwrap<ShmCache>(args.Holder()); \
+  if (!cache->header_) { \
+    return ThrowException(Exception::Error( \
+        String::New("Cache is not open"))); \
+  }
+
+#define CACHE_MAGIC 0x43414348  // "CACH"
+#define CACHE_MIN_SIZE (64 * 1024)
+#define CACHE_MAX_SIZE (1 << 30)
+
+// Lock stripes; a bucket belongs to stripe (hash & (CACHE_STRIPES - 1)).
+#define CACHE_STRIPES 64
+
+// Keys and values are stored in chains of blocks of this many bytes.
+#define CACHE_BLOCK_SIZE 128
+
+// Bytes of the file per entry slot, from which the slot count is sized.
+#define CACHE_BYTES_PER_ENTRY 512
+
+// get() gives up and reports a miss after this many torn reads.
+#define CACHE_READ_TRIES 64
+
+// glibc has had robust process-shared mutexes since 2.12.
+#if defined(__linux__) && !defined(ANDROID) && !defined(__ANDROID__)
+# define CACHE_ROBUST_MUTEX 1
+#endif
+
+namespace node {
+
+using v8::Object;
+using v8::Handle;
+using v8::Local;
+using v8::Value;
+using v8::HandleScope;
+using v8::FunctionTemplate;
+using v8::String;
+using v8::Integer;
+using v8::Number;
+using v8::Boolean;
+using v8::Arguments;
+using v8::Exception;
+using v8::ThrowException;
+using v8::Undefined;
+
+
+// A hash table in a file that every process maps, normally on tmpfs.
+//
+// Writers take one process-shared mutex. Readers take no lock: every stripe
+// of buckets has a sequence number that writers make odd while they change
+// its chains, and get() copies the entry out and retries when the sequence
+// number moved meanwhile. Anything a reader follows is bounds checked, so a
+// torn read costs a retry and never a crash. Values are therefore returned
+// as copies; a view of the mapping could change under its holder.
+//
+// Keys and values live in chains of fixed size blocks. When there is no room
+// for a new entry the CLOCK hand evicts one: get() marks entries referenced
+// and the hand skips, and unmarks, those once. Entries past their ttl go
+// first.
+//
+// A process that dies holding the mutex leaves the table in an unknown
+// state. Where mutexes are robust the next writer finds out and empties the
+// table.
+
+struct CacheHeader {
+  uint32_t magic;
+  uint32_t length;
+  uint32_t buckets;
+  uint32_t entries;
+  uint32_t blocks;
+  uint32_t count;
+  // Free lists, as index + 1 with 0 for none.
+  uint32_t free_entry;
+  uint32_t free_block;
+  uint32_t free_blocks;
+  uint32_t hand;
+  pthread_mutex_t lock;
+  volatile uint64_t hits;
+  volatile uint64_t misses;
+  volatile uint64_t sets;
+  volatile uint64_t evictions;
+  volatile uint32_t seq[CACHE_STRIPES];
+};
+
+
+struct CacheEntry {
+  uint32_t hash;
+  // Bucket chain, or free list, as index + 1.
+  uint32_t next;
+  uint32_t key_length;
+  uint32_t value_length;
+  // First block of the key and then the value, as index + 1.
+  uint32_t block;
+  uint32_t used;
+  volatile uint32_t referenced;
+  uint32_t pad;
+  // uv_hrtime() in milliseconds, or 0 for no ttl.
+  uint64_t expires;
+};
+
+
+static inline uint32_t Hash(const char* key, size_t length) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    h ^= static_cast<unsigned char>(key[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+
+static inline uint64_t NowMs() {
+  return uv_hrtime() / 1000000;
+}
+
+
+static void FreeCopy(char* data, void* hint) {
+  free(data);
+}
+
+
+class ShmCache : public ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    Local<FunctionTemplate> t = FunctionTemplate::New(New);
+    t->InstanceTemplate()->SetInternalFieldCount(1);
+    t->SetClassName(String::NewSymbol("ShmCache"));
+
+    NODE_SET_PROTOTYPE_METHOD(t, "open", Open);
+    NODE_SET_PROTOTYPE_METHOD(t, "close", Close);
+    NODE_SET_PROTOTYPE_METHOD(t, "unlink", Unlink);
+    NODE_SET_PROTOTYPE_METHOD(t, "get", Get);
+    NODE_SET_PROTOTYPE_METHOD(t, "set", Set);
+    NODE_SET_PROTOTYPE_METHOD(t, "del", Del);
+    NODE_SET_PROTOTYPE_METHOD(t, "clear", Clear);
+    NODE_SET_PROTOTYPE_METHOD(t, "stats", Stats);
+
+    target->Set(String::NewSymbol("ShmCache"), t->GetFunction());
+  }
+
+ private:
+  ShmCache()
+      : ObjectWrap(),
+        base_(NULL),
+        length_(0),
+        header_(NULL),
+        buckets_(NULL),
+        entries_(NULL),
+        block_next_(NULL),
+        blocks_(NULL) {
+  }
+
+  ~ShmCache() {
+    Unmap();
+  }
+
+  static Handle<Value> New(const Arguments& args) {
+    HandleScope scope;
+    ShmCache* cache = new ShmCache();
+    cache->Wrap(args.This());
+    return args.This();
+  }
+
+  void Unmap() {
+    if (base_) munmap(base_, length_);
+    base_ = NULL;
+    header_ = NULL;
+  }
+
+  // The table follows the header: buckets, entries, the block chain links
+  // and the blocks.
+  static size_t LayoutSize(uint32_t buckets, uint32_t entries,
+                           uint32_t blocks) {
+    return sizeof(CacheHeader) +
+           sizeof(CacheEntry) * (size_t) entries +
+           sizeof(uint32_t) * ((size_t) buckets + blocks) +
+           (size_t) CACHE_BLOCK_SIZE * blocks;
+  }
+
+  void Map(char* base, size_t length) {
+    base_ = base;
+    length_ = length;
+    header_ = reinterpret_cast<CacheHeader*>(base);
+    entries_ = reinterpret_cast<CacheEntry*>(base + sizeof(CacheHeader));
+    buckets_ = reinterpret_cast<volatile uint32_t*>(entries_ +
+                                                    header_->entries);
+    block_next_ = buckets_ + header_->buckets;
+    blocks_ = const_cast<char*>(
+        reinterpret_cast<volatile char*>(block_next_ + header_->blocks));
+  }
+
+  // open(path, size, create). The creator sizes and initializes the file;
+  // size is clamped to between 64 KB and 1 GB.
+  static Handle<Value> Open(const Arguments& args) {
+    HandleScope scope;
+
+    ShmCache* cache = ObjectWrap::Unwrap<ShmCache>(args.Holder());
+    assert(cache->header_ == NULL);
+
+    String::Utf8Value path(args[0]);
+    uint32_t size = args[1]->Uint32Value();
+    bool create = args[2]->IsTrue();
+
+    if (size < CACHE_MIN_SIZE) size = CACHE_MIN_SIZE;
+    if (size > CACHE_MAX_SIZE) size = CACHE_MAX_SIZE;
+
+    int flags = create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR;
+    int fd = open(*path, flags, 0600);
+    if (fd == -1) {
+      return ThrowException(ErrnoException(errno, "open", "", *path));
+    }
+
+    if (create) {
+      if (ftruncate(fd, size) == -1) {
+        int err = errno;
+        close(fd);
+        unlink(*path);
+        return ThrowException(ErrnoException(err, "ftruncate", "", *path));
+      }
+    } else {
+      struct stat s;
+      if (fstat(fd, &s) == -1 || s.st_size < (off_t) sizeof(CacheHeader) ||
+          s.st_size > CACHE_MAX_SIZE) {
+        close(fd);
+        return ThrowException(ErrnoException(EINVAL, "open", "", *path));
+      }
+      size = s.st_size;
+    }
+
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int err = errno;
+    close(fd);
+    if (base == MAP_FAILED) {
+      return ThrowException(ErrnoException(err, "mmap", "", *path));
+    }
+
+    CacheHeader* header = static_cast<CacheHeader*>(base);
+    if (create) {
+      if (!Format(header, size)) {
+        munmap(base, size);
+        unlink(*path);
+        return ThrowException(ErrnoException(EINVAL, "open", "", *path));
+      }
+    } else if (header->magic != CACHE_MAGIC || header->length != size ||
+               (header->buckets & (header->buckets - 1)) != 0 ||
+               header->buckets < CACHE_STRIPES ||
+               LayoutSize(header->buckets, header->entries,
+                          header->blocks) > size) {
+      munmap(base, size);
+      return ThrowException(ErrnoException(EINVAL, "open", "", *path));
+    }
+
+    cache->Map(static_cast<char*>(base), size);
+
+    if (create) {
+      cache->Reset();
+      __sync_synchronize();
+      cache->header_->magic = CACHE_MAGIC;
+    }
+
+    return scope.Close(Integer::New(0));
+  }
+
+  // Sizes the table and initializes the lock; Reset() does the rest.
+  static bool Format(CacheHeader* header, uint32_t size) {
+    size_t avail = size - sizeof(CacheHeader);
+    uint32_t entries = avail / CACHE_BYTES_PER_ENTRY;
+    uint32_t buckets = CACHE_STRIPES;
+    while (buckets < entries) buckets <<= 1;
+    size_t table = sizeof(CacheEntry) * (size_t) entries +
+                   sizeof(uint32_t) * (size_t) buckets;
+    uint32_t blocks = (avail - table) / (CACHE_BLOCK_SIZE + sizeof(uint32_t));
+    assert(LayoutSize(buckets, entries, blocks) <= size);
+
+    pthread_mutexattr_t attr;
+    if (pthread_mutexattr_init(&attr)) return false;
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifdef CACHE_ROBUST_MUTEX
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+    int r = pthread_mutex_init(&header->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (r) return false;
+
+    header->length = size;
+    header->buckets = buckets;
+    header->entries = entries;
+    header->blocks = blocks;
+    header->hits = 0;
+    header->misses = 0;
+    header->sets = 0;
+    header->evictions = 0;
+    for (int i = 0; i < CACHE_STRIPES; i++) header->seq[i] = 0;
+
+    return true;
+  }
+
+  // Empties the table. Called with the lock held, or by the creator before
+  // the magic is written.
+  void Reset() {
+    // A writer that died may have left a stripe odd; make every stripe odd
+    // and then even again, so that readers retry either way.
+    for (int i = 0; i < CACHE_STRIPES; i++) header_->seq[i] |= 1;
+    __sync_synchronize();
+
+    uint32_t entries = header_->entries;
+    uint32_t blocks = header_->blocks;
+
+    for (uint32_t i = 0; i < header_->buckets; i++) buckets_[i] = 0;
+    for (uint32_t i = 0; i < entries; i++) {
+      entries_[i].used = 0;
+      entries_[i].next = i + 1 < entries ? i + 2 : 0;
+    }
+    for (uint32_t i = 0; i < blocks; i++) {
+      block_next_[i] = i + 1 < blocks ? i + 2 : 0;
+    }
+    header_->free_entry = entries ? 1 : 0;
+    header_->free_block = blocks ? 1 : 0;
+    header_->free_blocks = blocks;
+    header_->count = 0;
+    header_->hand = 0;
+
+    __sync_synchronize();
+    for (int i = 0; i < CACHE_STRIPES; i++) header_->seq[i]++;
+  }
+
+  void Lock() {
+    int r = pthread_mutex_lock(&header_->lock);
+#ifdef CACHE_ROBUST_MUTEX
+    if (r == EOWNERDEAD) {
+      Reset();
+      pthread_mutex_consistent(&header_->lock);
+      r = 0;
+    }
+#endif
+    assert(r == 0);
+  }
+
+  void Unlock() {
+    pthread_mutex_unlock(&header_->lock);
+  }
+
+  void WriteBegin(uint32_t hash) {
+    header_->seq[hash & (CACHE_STRIPES - 1)]++;
+    __sync_synchronize();
+  }
+
+  void WriteEnd(uint32_t hash) {
+    __sync_synchronize();
+    header_->seq[hash & (CACHE_STRIPES - 1)]++;
+  }
+
+  static uint32_t BlocksFor(size_t length) {
+    return (length + CACHE_BLOCK_SIZE - 1) / CACHE_BLOCK_SIZE;
+  }
+
+  // Copies length bytes from offset into the chain starting at block. Safe
+  // to call without the lock: returns false if the chain is cut short.
+  bool ReadBytes(uint32_t block, size_t offset, char* dest,
+                 size_t length) const {
+    uint32_t blocks = header_->blocks;
+    while (offset >= CACHE_BLOCK_SIZE) {
+      if (block == 0 || block > blocks) return false;
+      block = block_next_[block - 1];
+      offset -= CACHE_BLOCK_SIZE;
+    }
+    while (length > 0) {
+      if (block == 0 || block > blocks) return false;
+      size_t n = CACHE_BLOCK_SIZE - offset;
+      if (n > length) n = length;
+      memcpy(dest, blocks_ + (size_t) (block - 1) * CACHE_BLOCK_SIZE + offset,
+             n);
+      dest += n;
+      length -= n;
+      offset = 0;
+      block = block_next_[block - 1];
+    }
+    return true;
+  }
+
+  void WriteBytes(uint32_t block, size_t offset, const char* src,
+                  size_t length) {
+    while (offset >= CACHE_BLOCK_SIZE) {
+      block = block_next_[block - 1];
+      offset -= CACHE_BLOCK_SIZE;
+    }
+    while (length > 0) {
+      size_t n = CACHE_BLOCK_SIZE - offset;
+      if (n > length) n = length;
+      memcpy(blocks_ + (size_t) (block - 1) * CACHE_BLOCK_SIZE + offset, src,
+             n);
+      src += n;
+      length -= n;
+      offset = 0;
+      block = block_next_[block - 1];
+    }
+  }
+
+  // With the lock held. Returns the entry's index + 1, or 0.
+  uint32_t Find(uint32_t hash, const char* key, size_t length) {
+    std::string scratch(length, '\0');
+    uint32_t idx = buckets_[hash & (header_->buckets - 1)];
+    while (idx) {
+      CacheEntry* e = &entries_[idx - 1];
+      if (e->hash == hash && e->key_length == length &&
+          ReadBytes(e->block, 0, &scratch[0], length) &&
+          memcmp(scratch.data(), key, length) == 0) {
+        return idx;
+      }
+      idx = e->next;
+    }
+    return 0;
+  }
+
+  // With the lock held and the entry's stripe odd.
+  void Unchain(uint32_t idx) {
+    CacheEntry* e = &entries_[idx - 1];
+    volatile uint32_t* link = &buckets_[e->hash & (header_->buckets - 1)];
+    while (*link != idx) {
+      assert(*link != 0);
+      link = &entries_[*link - 1].next;
+    }
+    *link = e->next;
+  }
+
+  // With the lock held, once no chain leads to the entry.
+  void Release(uint32_t idx) {
+    CacheEntry* e = &entries_[idx - 1];
+    uint32_t n = BlocksFor((size_t) e->key_length + e->value_length);
+    if (n > 0) {
+      uint32_t last = e->block;
+      for (uint32_t i = 1; i < n; i++) last = block_next_[last - 1];
+      block_next_[last - 1] = header_->free_block;
+      header_->free_block = e->block;
+      header_->free_blocks += n;
+    }
+    e->used = 0;
+    e->next = header_->free_entry;
+    header_->free_entry = idx;
+    header_->count--;
+  }
+
+  void Remove(uint32_t idx) {
+    uint32_t hash = entries_[idx - 1].hash;
+    WriteBegin(hash);
+    Unchain(idx);
+    WriteEnd(hash);
+    Release(idx);
+  }
+
+  // With the lock held. Advances the CLOCK hand to an entry that was not
+  // read since the hand last passed it, or is past its ttl, and removes it.
+  bool Evict() {
+    uint32_t entries = header_->entries;
+    uint64_t now = NowMs();
+    for (uint32_t i = 0; i < 2 * entries + 1; i++) {
+      uint32_t slot = header_->hand;
+      header_->hand = slot + 1 < entries ? slot + 1 : 0;
+      CacheEntry* e = &entries_[slot];
+      if (!e->used) continue;
+      if (e->referenced && !(e->expires && e->expires <= now)) {
+        e->referenced = 0;
+        continue;
+      }
+      Remove(slot + 1);
+      __sync_fetch_and_add(&header_->evictions, 1);
+      return true;
+    }
+    return false;
+  }
+
+  // get(key) returns a copy of the value, or undefined.
+  static Handle<Value> Get(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    String::Utf8Value key(args[0]);
+    size_t length = key.length();
+    uint32_t hash = Hash(*key, length);
+    uint32_t stripe = hash & (CACHE_STRIPES - 1);
+    CacheHeader* header = cache->header_;
+    uint32_t entries = header->entries;
+    uint64_t max_value = (uint64_t) header->blocks * CACHE_BLOCK_SIZE;
+    std::string scratch(length, '\0');
+
+    for (int tries = 0; tries < CACHE_READ_TRIES; tries++) {
+      uint32_t seq = header->seq[stripe];
+      if (seq & 1) {
+        if (tries > 8) sched_yield();
+        continue;
+      }
+      __sync_synchronize();
+
+      uint32_t found = 0;
+      bool expired = false;
+      char* data = NULL;
+      uint32_t value_length = 0;
+
+      uint32_t idx = cache->buckets_[hash & (header->buckets - 1)];
+      for (uint32_t steps = 0; idx && idx <= entries && steps < entries;
+           steps++) {
+        CacheEntry* e = &cache->entries_[idx - 1];
+        uint32_t block = e->block;
+        if (e->hash == hash && e->key_length == length &&
+            cache->ReadBytes(block, 0, &scratch[0], length) &&
+            memcmp(scratch.data(), *key, length) == 0) {
+          found = idx;
+          value_length = e->value_length;
+          uint64_t expires = e->expires;
+          if (expires && expires <= NowMs()) {
+            expired = true;
+          } else if (value_length <= max_value) {
+            data = static_cast<char*>(malloc(value_length ? value_length : 1));
+            if (data == NULL) return ThrowException(ErrnoException(ENOMEM));
+            if (!cache->ReadBytes(block, length, data, value_length)) {
+              found = 0;
+            }
+          } else {
+            found = 0;
+          }
+          break;
+        }
+        idx = e->next;
+      }
+
+      __sync_synchronize();
+      if (header->seq[stripe] != seq) {
+        free(data);
+        continue;
+      }
+
+      if (!found || expired) {
+        free(data);
+        break;
+      }
+
+      cache->entries_[found - 1].referenced = 1;
+      __sync_fetch_and_add(&header->hits, 1);
+      Buffer* buffer = Buffer::New(data, value_length, FreeCopy, NULL);
+      return scope.Close(buffer->handle_);
+    }
+
+    __sync_fetch_and_add(&header->misses, 1);
+    return Undefined();
+  }
+
+  // set(key, buffer, offset, length, ttl) returns false when the value
+  // does not fit in the cache at all.
+  static Handle<Value> Set(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    String::Utf8Value key(args[0]);
+    Local<Object> obj = args[1]->ToObject();
+    assert(Buffer::HasInstance(obj));
+    size_t offset = args[2]->Uint32Value();
+    size_t value_length = args[3]->Uint32Value();
+    assert(offset + value_length <= Buffer::Length(obj));
+    double ttl = args[4]->NumberValue();
+
+    size_t key_length = key.length();
+    size_t total = key_length + value_length;
+    uint32_t need = BlocksFor(total);
+    CacheHeader* header = cache->header_;
+    if (need > header->blocks || header->entries == 0) {
+      return scope.Close(Boolean::New(false));
+    }
+
+    uint32_t hash = Hash(*key, key_length);
+
+    cache->Lock();
+
+    while (header->free_entry == 0 || header->free_blocks < need) {
+      if (!cache->Evict()) break;
+    }
+    if (header->free_entry == 0 || header->free_blocks < need) {
+      cache->Unlock();
+      return scope.Close(Boolean::New(false));
+    }
+
+    uint32_t idx = header->free_entry;
+    CacheEntry* e = &cache->entries_[idx - 1];
+    header->free_entry = e->next;
+
+    uint32_t first = 0;
+    if (need > 0) {
+      first = header->free_block;
+      uint32_t last = first;
+      for (uint32_t i = 1; i < need; i++) last = cache->block_next_[last - 1];
+      header->free_block = cache->block_next_[last - 1];
+      cache->block_next_[last - 1] = 0;
+      header->free_blocks -= need;
+    }
+
+    // Nothing leads to the new entry yet, so readers cannot see it being
+    // written.
+    cache->WriteBytes(first, 0, *key, key_length);
+    cache->WriteBytes(first, key_length, Buffer::Data(obj) + offset,
+                      value_length);
+    e->hash = hash;
+    e->key_length = key_length;
+    e->value_length = value_length;
+    e->block = first;
+    e->used = 1;
+    e->referenced = 1;
+    e->expires = ttl > 0 ? NowMs() + (uint64_t) ttl : 0;
+    header->count++;
+
+    // Replace the old entry, if any, in one step.
+    uint32_t old = cache->Find(hash, *key, key_length);
+    cache->WriteBegin(hash);
+    if (old) cache->Unchain(old);
+    volatile uint32_t* bucket =
+        &cache->buckets_[hash & (header->buckets - 1)];
+    e->next = *bucket;
+    *bucket = idx;
+    cache->WriteEnd(hash);
+    if (old) cache->Release(old);
+
+    __sync_fetch_and_add(&header->sets, 1);
+
+    cache->Unlock();
+
+    return scope.Close(Boolean::New(true));
+  }
+
+  // del(key) returns whether there was an entry.
+  static Handle<Value> Del(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    String::Utf8Value key(args[0]);
+    uint32_t hash = Hash(*key, key.length());
+
+    cache->Lock();
+    uint32_t idx = cache->Find(hash, *key, key.length());
+    if (idx) cache->Remove(idx);
+    cache->Unlock();
+
+    return scope.Close(Boolean::New(idx != 0));
+  }
+
+  static Handle<Value> Clear(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    cache->Lock();
+    cache->Reset();
+    cache->Unlock();
+
+    return Undefined();
+  }
+
+  static Handle<Value> Stats(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    CacheHeader* header = cache->header_;
+    Local<Object> stats = Object::New();
+    stats->Set(String::NewSymbol("size"),
+               Integer::NewFromUnsigned(header->length));
+    stats->Set(String::NewSymbol("capacity"),
+               Integer::NewFromUnsigned(header->entries));
+    stats->Set(String::NewSymbol("entries"),
+               Integer::NewFromUnsigned(header->count));
+    stats->Set(String::NewSymbol("freeBytes"),
+               Number::New((double) header->free_blocks * CACHE_BLOCK_SIZE));
+    stats->Set(String::NewSymbol("hits"), Number::New(header->hits));
+    stats->Set(String::NewSymbol("misses"), Number::New(header->misses));
+    stats->Set(String::NewSymbol("sets"), Number::New(header->sets));
+    stats->Set(String::NewSymbol("evictions"),
+               Number::New(header->evictions));
+
+    return scope.Close(stats);
+  }
+
+  // close() unmaps the cache; it stays in the file for everyone else.
+  static Handle<Value> Close(const Arguments& args) {
+    HandleScope scope;
+
+    ShmCache* cache = ObjectWrap::Unwrap<ShmCache>(args.Holder());
+    cache->Unmap();
+
+    return Undefined();
+  }
+
+  // unlink(path) removes the file. Whoever has it mapped keeps using it.
+  static Handle<Value> Unlink(const Arguments& args) {
+    HandleScope scope;
+
+    String::Utf8Value path(args[0]);
+    unlink(*path);
+
+    return Undefined();
+  }
+
+  char* base_;
+  size_t length_;
+  CacheHeader* header_;
+  volatile uint32_t* buckets_;
+  CacheEntry* entries_;
+  volatile uint32_t* block_next_;
+  char* blocks_;
+};
+
+
+static void InitShmCache(Handle<Object> target) {
+  ShmCache::Initialize(target);
+}
+
+
+}  // namespace node
+
+NODE_MODULE(node_shm_cache, node::InitShmCache)
@@ -30,6 +30,68 @@ namespace node {
 
 using namespace v8;
 
+// ev_stat's default and minimum intervals.
+#define DEFAULT_POLL_INTERVAL 5.0074891
+#define MIN_POLL_INTERVAL 0.1074891
+
+
+// StatWatchers that can't be served by inotify alone would each lstat()
+// their path on the event loop every interval. Instead, the watchers of each
+// interval share one timer, and the paths of a group are stat'ed together
+// with a single thread pool request.
+struct StatPollGroup {
+  ev_tstamp interval;
+  ev_timer timer;
+  StatWatcher* watchers;
+  int count;
+  // A poll is on the thread pool.
+  bool busy;
+  StatPollGroup* next;
+};
+
+
+// One poll of a group. The paths are copies, so that watchers can stop
+// while it runs.
+struct StatPollBatch {
+  explicit StatPollBatch(StatPollGroup* group) : group(group) {
+    count = group->count;
+    watchers = new StatWatcher*[count];
+    paths = new char*[count];
+    stats = new ev_statdata[count];
+    req.data = this;
+  }
+
+  ~StatPollBatch() {
+    for (int i = 0; i < count; i++) free(paths[i]);
+    delete [] watchers;
+    delete [] paths;
+    delete [] stats;
+  }
+
+  StatPollGroup* group;
+  int count;
+  StatWatcher** watchers;
+  char** paths;
+  ev_statdata* stats;
+  uv_work_t req;
+};
+
+
+// The fields ev_stat compares to decide whether a file changed.
+static bool StatChanged(const ev_statdata* a, const ev_statdata* b) {
+  return a->st_dev != b->st_dev ||
+         a->st_ino != b->st_ino ||
+         a->st_mode != b->st_mode ||
+         a->st_nlink != b->st_nlink ||
+         a->st_uid != b->st_uid ||
+         a->st_gid != b->st_gid ||
+         a->st_rdev != b->st_rdev ||
+         a->st_size != b->st_size ||
+         a->st_atime != b->st_atime ||
+         a->st_mtime != b->st_mtime ||
+         a->st_ctime != b->st_ctime;
+}
+
 void StatWatcher::Initialize(Handle<Object> target) {
   HandleScope scope;
   FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
@@ -94,7 +156,12 @@ Handle<Value> StatWatcher::Start(const Arguments& args) {
 
   handler->persistent_ = args[1]->IsTrue();
 
-  if (!handler->persistent_) {
+  if (ev_is_active(&handler->watcher_.timer)) {
+    // No inotify, or one that can't be trusted for this path: ev_stat would
+    // poll it on its own.
+    ev_stat_stop(handler->loop, &handler->watcher_);
+    handler->StartPolling(interval);
+  } else if (!handler->persistent_) {
     ev_unref(handler->loop);
   }
 
@@ -117,10 +184,153 @@ void StatWatcher::Stop () {
   if (watcher_.active) {
     if (!persistent_) ev_ref(loop);
     ev_stat_stop(loop, &watcher_);
-    free(path_);
-    path_ = NULL;
-    Unref();
+  } else if (poll_group_) {
+    StopPolling();
+  } else {
+    return;
+  }
+
+  free(path_);
+  path_ = NULL;
+  Unref();
+}
+
+
+void StatWatcher::StartPolling(ev_tstamp interval) {
+  FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
+
+  if (interval == 0.) {
+    interval = DEFAULT_POLL_INTERVAL;
+  } else if (interval < MIN_POLL_INTERVAL) {
+    interval = MIN_POLL_INTERVAL;
+  }
+
+  StatPollGroup* group = statics->stat_poll_groups;
+  while (group && group->interval != interval) group = group->next;
+
+  if (!group) {
+    group = new StatPollGroup();
+    group->interval = interval;
+    group->watchers = NULL;
+    group->count = 0;
+    group->busy = false;
+    group->next = statics->stat_poll_groups;
+    statics->stat_poll_groups = group;
+
+    ev_timer_init(&group->timer, PollTimer, interval, interval);
+    group->timer.data = group;
+    ev_timer_start(loop, &group->timer);
+    // Only persistent watchers keep the loop alive.
+    ev_unref(loop);
   }
+
+  // What ev_stat_start() found is the state changes are detected against.
+  poll_attr_ = watcher_.attr;
+  poll_group_ = group;
+  poll_next_ = group->watchers;
+  group->watchers = this;
+  group->count++;
+
+  if (persistent_) ev_ref(loop);
+}
+
+
+void StatWatcher::StopPolling() {
+  FileStatics *statics = NODE_STATICS_GET(node_fs, FileStatics);
+  StatPollGroup* group = poll_group_;
+
+  StatWatcher** w = &group->watchers;
+  while (*w != this) w = &(*w)->poll_next_;
+  *w = poll_next_;
+  poll_group_ = NULL;
+  poll_next_ = NULL;
+  group->count--;
+
+  if (persistent_) ev_unref(loop);
+
+  if (group->count > 0) return;
+
+  ev_ref(loop);
+  ev_timer_stop(loop, &group->timer);
+
+  StatPollGroup** g = &statics->stat_poll_groups;
+  while (*g != group) g = &(*g)->next;
+  *g = group->next;
+
+  // Otherwise AfterPoll() deletes it.
+  if (!group->busy) delete group;
+}
+
+
+void StatWatcher::PollTimer(EV_P_ ev_timer *timer, int revents) {
+  StatPollGroup* group = static_cast<StatPollGroup*>(timer->data);
+
+  // The previous poll is still waiting for the thread pool.
+  if (group->busy) return;
+
+  StatPollBatch* batch = new StatPollBatch(group);
+  int i = 0;
+  for (StatWatcher* w = group->watchers; w; w = w->poll_next_, i++) {
+    // Kept alive until the results are in.
+    w->Ref();
+    batch->watchers[i] = w;
+    batch->paths[i] = strdup(w->path_);
+  }
+
+  group->busy = true;
+
+  batch->req.work_type = WORK_FS;
+  int r = uv_queue_work(Isolate::GetCurrentLoop(),
+                        &batch->req,
+                        PollWork,
+                        AfterPoll);
+  assert(r == 0);
+}
+
+
+// Runs on the thread pool. Failures look like ev_stat's: a file that can't
+// be stat'ed has no links.
+void StatWatcher::PollWork(uv_work_t* req) {
+  StatPollBatch* batch = static_cast<StatPollBatch*>(req->data);
+
+  for (int i = 0; i < batch->count; i++) {
+    ev_statdata* s = &batch->stats[i];
+    if (lstat(batch->paths[i], s) < 0) {
+      memset(s, 0, sizeof(*s));
+    } else if (!s->st_nlink) {
+      s->st_nlink = 1;
+    }
+  }
+}
+
+
+void StatWatcher::AfterPoll(uv_work_t* req) {
+  StatPollBatch* batch = static_cast<StatPollBatch*>(req->data);
+  StatPollGroup* group = batch->group;
+
+  HandleScope scope;
+
+  for (int i = 0; i < batch->count; i++) {
+    StatWatcher* w = batch->watchers[i];
+
+    // Skip watchers that stopped meanwhile.
+    if (w->poll_group_ == group &&
+        StatChanged(&w->poll_attr_, &batch->stats[i])) {
+      Handle<Value> argv[2];
+      argv[1] = Handle<Value>(BuildStatsObject(&w->poll_attr_));
+      w->poll_attr_ = batch->stats[i];
+      argv[0] = Handle<Value>(BuildStatsObject(&w->poll_attr_));
+      MakeCallback(w->handle_, "onchange", 2, argv);
+    }
+
+    w->Unref();
+  }
+
+  group->busy = false;
+  // The last watcher stopped while the poll ran.
+  if (group->count == 0) delete group;
+
+  delete batch;
 }
 
 
@@ -27,6 +27,8 @@
 
 namespace node {
 
+struct StatPollGroup;
+
 class StatWatcher : ObjectWrap {
  public:
   static void Initialize(v8::Handle<v8::Object> target);
@@ -35,6 +37,8 @@ class StatWatcher : ObjectWrap {
   StatWatcher() : ObjectWrap() {
     persistent_ = false;
     path_ = NULL;
+    poll_group_ = NULL;
+    poll_next_ = NULL;
     ev_init(&watcher_, StatWatcher::Callback);
     watcher_.data = this;
     loop = Isolate::GetCurrentLoop()->ev;
@@ -51,13 +55,24 @@ class StatWatcher : ObjectWrap {
 
  private:
   static void Callback(EV_P_ ev_stat *watcher, int revents);
+  static void PollTimer(EV_P_ ev_timer *timer, int revents);
+  static void PollWork(uv_work_t* req);
+  static void AfterPoll(uv_work_t* req);
 
   void Stop();
+  void StartPolling(ev_tstamp interval);
+  void StopPolling();
 
   ev_stat watcher_;
   struct ev_loop *loop;
   bool persistent_;
   char *path_;
+
+  // Set instead of watcher_ being active when the path is polled, together
+  // with the other watchers of the same interval.
+  StatPollGroup* poll_group_;
+  StatWatcher* poll_next_;
+  ev_statdata poll_attr_;
 };
 
 }  // namespace node
@@ -10,6 +10,11 @@
 #define NODE_STATICS_GET(modname, classname)    \
   static_cast<classname *>(NODE_STATICS(modname, node::Isolate::GetCurrent()))
 
+// Same as NODE_STATICS_GET() for callbacks that have the loop at hand, which
+// saves the thread local lookup of the current isolate.
+#define NODE_STATICS_LOOP(modname, classname, loop)  \
+  static_cast<classname *>(NODE_STATICS(modname, node::Isolate::FromLoop(loop)))
+
 namespace node {
 
 class ModuleStatics {
@@ -24,6 +29,7 @@ public:
 #define NODE_EXT_LIST_END                \
   NODE_EXT_STATICS_DECL(node_io_watcher) \
   NODE_EXT_STATICS_DECL(node_stream_wrap) \
+  NODE_EXT_STATICS_DECL(v8_typed_array) \
   } ext_statics;
 
 #include "node_extensions.h"
@@ -20,6 +20,7 @@
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "node_string.h"
+#include <assert.h>
 
 namespace node {
 
@@ -36,4 +37,11 @@ Handle<String> ImmutableAsciiSource::CreateFromLiteral(
   return scope.Close(ret);
 }
 
+Handle<String> ImmutableAsciiSource::SharedString(
+    ImmutableAsciiSource* source) {
+  HandleScope scope;
+  assert(source->shared_);
+  return scope.Close(String::NewExternal(source));
+}
+
 }
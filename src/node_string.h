@@ -37,14 +37,25 @@ class ImmutableAsciiSource : public v8::String::ExternalAsciiStringResource {
   static v8::Handle<v8::String> CreateFromLiteral(const char *string_literal,
                                                   size_t length);
 
-  ImmutableAsciiSource(const char *src, size_t src_len)
+  // A shared source belongs to whoever made it, not to the strings over it,
+  // so that one can serve the strings of every isolate for the life of the
+  // process; see SharedString().
+  ImmutableAsciiSource(const char *src, size_t src_len, bool shared = false)
       : buffer_(src),
-        buf_len_(src_len) {
+        buf_len_(src_len),
+        shared_(shared) {
   }
 
   ~ImmutableAsciiSource() {
   }
 
+  // A new external string over a shared source.
+  static v8::Handle<v8::String> SharedString(ImmutableAsciiSource* source);
+
+  void Dispose() {
+    if (!shared_) delete this;
+  }
+
   const char *data() const {
       return buffer_;
   }
@@ -56,6 +67,7 @@ class ImmutableAsciiSource : public v8::String::ExternalAsciiStringResource {
  private:
   const char *buffer_;
   size_t buf_len_;
+  bool shared_;
 };
 
 }  // namespace node
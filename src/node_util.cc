@@ -0,0 +1,312 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <node.h>
+
+#include <stdint.h>
+#include <vector>
+
+namespace node {
+
+using namespace v8;
+
+// The fast paths of lib/util.js. Both produce exactly what the JavaScript
+// they stand in for would.
+
+typedef std::vector<uint16_t> Output;
+
+// Entries in one line up to this length, see reduceToSingleString().
+#define INSPECT_LINE_WIDTH 60
+
+
+static void AppendAscii(Output& out, const char* str) {
+  while (*str) out.push_back(static_cast<unsigned char>(*str++));
+}
+
+
+static void AppendString(Output& out, Handle<String> str) {
+  String::Value value(str);
+  out.insert(out.end(), *value, *value + value.length());
+}
+
+
+static Local<String> ToString(const Output& out) {
+  if (out.empty()) return String::Empty();
+  return String::New(&out[0], out.size());
+}
+
+
+// What formatPrimitive() makes of a string: JSON.stringify() between
+// single quotes, with single quotes escaped and double quotes not.
+static void AppendQuoted(Output& out, Handle<String> str) {
+  static const char hex[] = "0123456789abcdef";
+  String::Value value(str);
+  const uint16_t* chars = *value;
+  int length = value.length();
+
+  out.push_back('\'');
+  for (int i = 0; i < length; i++) {
+    uint16_t c = chars[i];
+    switch (c) {
+      case '\'': AppendAscii(out, "\\'"); break;
+      case '\\': AppendAscii(out, "\\\\"); break;
+      case '\b': AppendAscii(out, "\\b"); break;
+      case '\f': AppendAscii(out, "\\f"); break;
+      case '\n': AppendAscii(out, "\\n"); break;
+      case '\r': AppendAscii(out, "\\r"); break;
+      case '\t': AppendAscii(out, "\\t"); break;
+      default:
+        if (c < 0x20) {
+          char escape[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15], 0 };
+          AppendAscii(out, escape);
+        } else {
+          out.push_back(c);
+        }
+    }
+  }
+  out.push_back('\'');
+}
+
+
+// Appends what formatPrimitive() returns for value, or returns false if
+// value is an object.
+static bool AppendPrimitive(Output& out, Handle<Value> value) {
+  if (value.IsEmpty()) {
+    return false;
+  } else if (value->IsString()) {
+    AppendQuoted(out, value.As<String>());
+  } else if (value->IsNumber() || value->IsBoolean() || value->IsNull() ||
+             value->IsUndefined()) {
+    AppendString(out, value->ToString());
+  } else {
+    return false;
+  }
+  return true;
+}
+
+
+// Property names that match /^[a-zA-Z_][a-zA-Z_0-9]*$/ go in bare.
+static void AppendName(Output& out, Handle<String> name) {
+  String::Value value(name);
+  const uint16_t* chars = *value;
+  int length = value.length();
+
+  bool bare = length > 0;
+  for (int i = 0; bare && i < length; i++) {
+    uint16_t c = chars[i];
+    bare = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+           (i > 0 && c >= '0' && c <= '9');
+  }
+
+  if (bare) {
+    out.insert(out.end(), chars, chars + length);
+  } else {
+    AppendQuoted(out, name);
+  }
+}
+
+
+// Appends what util.inspect(value) returns without showHidden and colors
+// for primitives, and for arrays and plain objects whose own enumerable
+// properties are all primitives. For anything else, such as objects with an
+// inspect() method, accessors or nested objects, returns false, and
+// lib/util.js takes the long way. Accessors on array indices are not told
+// apart from values.
+static bool AppendFlat(Output& out, Handle<Value> value) {
+  if (AppendPrimitive(out, value)) return true;
+  if (value->IsFunction()) return false;
+
+  Local<Object> object = value->ToObject();
+  Local<String> class_name = object->ObjectProtoToString();
+  bool array;
+  if (class_name->Equals(String::New("[object Array]"))) {
+    array = true;
+  } else if (class_name->Equals(String::New("[object Object]"))) {
+    array = false;
+  } else {
+    return false;
+  }
+
+  Local<Value> hook = object->Get(String::NewSymbol("inspect"));
+  if (hook.IsEmpty() || hook->IsFunction()) return false;
+
+  Local<Array> keys = object->GetOwnPropertyNames();
+  uint32_t count = keys->Length();
+  if (array && count != Local<Array>::Cast(object)->Length()) {
+    // Holes or named properties.
+    return false;
+  }
+  if (count == 0) {
+    AppendAscii(out, array ? "[]" : "{}");
+    return true;
+  }
+
+  // Every entry as in formatProperty(), separated by NUL for now.
+  Output entries;
+  size_t width = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    size_t start = entries.size();
+    if (array) {
+      if (!object->HasRealIndexedProperty(i)) return false;
+      if (!AppendPrimitive(entries, object->Get(i))) return false;
+    } else {
+      Local<String> key = keys->Get(i)->ToString();
+      if (object->HasRealNamedCallbackProperty(key)) return false;
+      Local<Value> property = object->Get(key);
+      AppendName(entries, key);
+      AppendAscii(entries, ": ");
+      if (!AppendPrimitive(entries, property)) return false;
+    }
+    width += entries.size() - start + 1;
+    entries.push_back(0);
+  }
+
+  // One line, or one entry per line once they get too wide.
+  const char* separator = width > INSPECT_LINE_WIDTH ? ",\n  " : ", ";
+  out.push_back(array ? '[' : '{');
+  out.push_back(' ');
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (entries[i] != 0) {
+      out.push_back(entries[i]);
+    } else if (i + 1 < entries.size()) {
+      AppendAscii(out, separator);
+    }
+  }
+  out.push_back(' ');
+  out.push_back(array ? ']' : '}');
+  return true;
+}
+
+
+// inspectFlat(value)
+//
+// Returns util.inspect(value) for what AppendFlat() can do, or undefined.
+static Handle<Value> InspectFlat(const Arguments& args) {
+  HandleScope scope;
+  Output out;
+  if (!AppendFlat(out, args[0])) return Undefined();
+  return scope.Close(ToString(out));
+}
+
+
+// format(inspect, f, ...)
+//
+// util.format() for a string f. Replaces %s, %d and %j with the arguments
+// that follow and %% with %, as long as there are arguments left, then
+// appends the rest separated by spaces, objects as util.inspect() would
+// show them.
+static Handle<Value> Format(const Arguments& args) {
+  HandleScope scope;
+  TryCatch try_catch;
+
+  Local<Function> inspect = Local<Function>::Cast(args[0]);
+  String::Value format(args[1]);
+  const uint16_t* chars = *format;
+  int length = format.length();
+  int argc = args.Length();
+  int next = 2;
+
+  Output out;
+  out.reserve(length + 16);
+
+  for (int i = 0; i < length; i++) {
+    uint16_t c = chars[i];
+    uint16_t type = i + 1 < length ? chars[i + 1] : 0;
+    if (c != '%' ||
+        (type != 's' && type != 'd' && type != 'j' && type != '%')) {
+      out.push_back(c);
+      continue;
+    }
+
+    i++;
+    if (next >= argc) {
+      out.push_back('%');
+      out.push_back(type);
+      continue;
+    }
+
+    Local<String> str;
+    switch (type) {
+      case 's':
+        str = args[next++]->ToString();
+        break;
+
+      case 'd':
+        str = Number::New(args[next++]->NumberValue())->ToString();
+        break;
+
+      case 'j': {
+        Local<Object> json = Context::GetCurrent()->Global()->Get(
+            String::NewSymbol("JSON"))->ToObject();
+        Local<Function> stringify = Local<Function>::Cast(
+            json->Get(String::NewSymbol("stringify")));
+        Local<Value> argv[1] = { args[next++] };
+        Local<Value> result = stringify->Call(json, 1, argv);
+        if (!result.IsEmpty()) str = result->ToString();
+        break;
+      }
+
+      default:
+        out.push_back('%');
+        continue;
+    }
+
+    if (try_catch.HasCaught()) return try_catch.ReThrow();
+    AppendString(out, str);
+  }
+
+  for (; next < argc; next++) {
+    Local<Value> arg = args[next];
+    out.push_back(' ');
+
+    if (arg->IsNull() || !arg->IsObject() || arg->IsFunction()) {
+      Local<String> str = arg->ToString();
+      if (try_catch.HasCaught()) return try_catch.ReThrow();
+      AppendString(out, str);
+      continue;
+    }
+
+    size_t mark = out.size();
+    if (AppendFlat(out, arg)) continue;
+    if (try_catch.HasCaught()) return try_catch.ReThrow();
+    out.resize(mark);
+
+    Local<Value> argv[1] = { arg };
+    Local<Value> str = inspect->Call(Context::GetCurrent()->Global(), 1, argv);
+    if (try_catch.HasCaught()) return try_catch.ReThrow();
+    AppendString(out, str->ToString());
+  }
+
+  return scope.Close(ToString(out));
+}
+
+
+void InitUtil(Handle<Object> target) {
+  HandleScope scope;
+
+  NODE_SET_METHOD(target, "inspectFlat", InspectFlat);
+  NODE_SET_METHOD(target, "format", Format);
+}
+
+}  // namespace node
+
+NODE_MODULE(node_util, node::InitUtil)
@@ -0,0 +1,546 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// WebSocket (RFC 6455) framing. The parser takes the Buffers a socket reads
+// after an 'upgrade', unmasks payloads where they lie and hands JavaScript
+// one list of payload pieces per execute() call:
+//
+//     parser.onframes = function(pieces, buffer) { ... };
+//     var r = parser.execute(buffer, off, len);  // bytes parsed or an Error
+//
+// pieces is flat, four numbers per piece: the opcode of the message (a
+// continuation frame reports the opcode of the frame that began it), flags,
+// and the offset and length of the payload bytes in buffer. A frame split
+// across reads shows up as several pieces; WS_FRAME_END marks its last one
+// and WS_FIN is set on it when the frame ended its message. Every frame has
+// a piece with WS_FRAME_END, even an empty one.
+
+#include <node.h>
+#include <node_buffer.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+#define WS_MAX_HEADER 14
+#define WS_MAX_CONTROL_PAYLOAD 125
+
+#define WS_FRAME_END 1
+#define WS_FIN 2
+
+#define WS_OP_CONTINUATION 0x0
+#define WS_OP_TEXT 0x1
+#define WS_OP_BINARY 0x2
+#define WS_OP_CLOSE 0x8
+#define WS_OP_PING 0x9
+#define WS_OP_PONG 0xA
+
+// Status codes for the close frame that should answer a parse error.
+#define WS_CLOSE_PROTOCOL_ERROR 1002
+#define WS_CLOSE_TOO_BIG 1009
+
+namespace node {
+
+using namespace v8;
+
+
+// XORs data with the masking key, starting at byte pos of the key stream.
+// The key repeats every four bytes, so after rotating it to pos it can be
+// applied eight or sixteen bytes at a time. memcpy() keeps the wide loads
+// free of alignment and aliasing trouble; compilers turn it into plain
+// moves.
+static void ApplyMask(char* data, size_t length, const uint8_t key[4],
+                      size_t pos) {
+  uint8_t* p = reinterpret_cast<uint8_t*>(data);
+
+  while (length > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    *p++ ^= key[pos++ & 3];
+    length--;
+  }
+
+  if (length >= 8) {
+    // Moving on by multiples of eight leaves pos & 3 as it is.
+    uint8_t rotated[8];
+    for (int i = 0; i < 8; i++) rotated[i] = key[(pos + i) & 3];
+    uint64_t word;
+    memcpy(&word, rotated, sizeof(word));
+
+#if defined(__SSE2__)
+    if (length >= 16) {
+      uint32_t word32;
+      memcpy(&word32, rotated, sizeof(word32));
+      __m128i wide = _mm_set1_epi32(static_cast<int>(word32));
+      do {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i*>(p));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                         _mm_xor_si128(v, wide));
+        p += 16;
+        length -= 16;
+      } while (length >= 16);
+    }
+#endif
+
+    while (length >= 8) {
+      uint64_t v;
+      memcpy(&v, p, sizeof(v));
+      v ^= word;
+      memcpy(p, &v, sizeof(v));
+      p += 8;
+      length -= 8;
+    }
+  }
+
+  while (length > 0) {
+    *p++ ^= key[pos++ & 3];
+    length--;
+  }
+}
+
+
+static Local<Value> FramingError(const char* reason, int close_code,
+                                 size_t nparsed) {
+  Local<Value> e = Exception::Error(String::NewSymbol("Parse Error"));
+  Local<Object> obj = e->ToObject();
+  obj->Set(String::NewSymbol("bytesParsed"), Integer::New(nparsed));
+  obj->Set(String::NewSymbol("reason"), String::New(reason));
+  obj->Set(String::NewSymbol("closeCode"), Integer::New(close_code));
+  return e;
+}
+
+
+class WebSocketParser : public ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    Local<FunctionTemplate> t = FunctionTemplate::New(New);
+    t->InstanceTemplate()->SetInternalFieldCount(1);
+    t->SetClassName(String::NewSymbol("WebSocketParser"));
+
+    NODE_SET_PROTOTYPE_METHOD(t, "execute", Execute);
+    NODE_SET_PROTOTYPE_METHOD(t, "reinitialize", Reinitialize);
+
+    target->Set(String::NewSymbol("WebSocketParser"), t->GetFunction());
+  }
+
+ private:
+  WebSocketParser(double max_payload, bool require_mask)
+      : ObjectWrap(),
+        max_payload_(max_payload),
+        require_mask_(require_mask) {
+    Init();
+  }
+
+  void Init() {
+    header_length_ = 0;
+    in_payload_ = false;
+    remaining_ = 0;
+    mask_pos_ = 0;
+    masked_ = false;
+    opcode_ = 0;
+    fin_ = false;
+    message_opcode_ = 0;
+    message_length_ = 0;
+    failed_ = false;
+  }
+
+  // Two bytes tell how long the rest of the header is.
+  size_t HeaderSize() const {
+    if (header_length_ < 2) return 2;
+    size_t size = 2;
+    int length7 = header_[1] & 0x7f;
+    if (length7 == 126) size += 2;
+    else if (length7 == 127) size += 8;
+    if (header_[1] & 0x80) size += 4;
+    return size;
+  }
+
+  // Checks a complete header and takes the frame's state from it. Returns
+  // NULL or the reason the frame is not allowed.
+  const char* ParseHeader(int* close_code) {
+    *close_code = WS_CLOSE_PROTOCOL_ERROR;
+
+    bool fin = (header_[0] & 0x80) != 0;
+    int opcode = header_[0] & 0x0f;
+    int length7 = header_[1] & 0x7f;
+
+    if (header_[0] & 0x70) return "reserved bits set";
+
+    size_t i = 2;
+    uint64_t length;
+    if (length7 == 126) {
+      length = (header_[2] << 8) | header_[3];
+      i += 2;
+    } else if (length7 == 127) {
+      length = 0;
+      for (int j = 0; j < 8; j++) length = (length << 8) | header_[i + j];
+      if (length >> 63) return "payload length out of range";
+      i += 8;
+    } else {
+      length = length7;
+    }
+
+    masked_ = (header_[1] & 0x80) != 0;
+    if (masked_) memcpy(mask_, header_ + i, 4);
+    else if (require_mask_) return "unmasked frame";
+
+    switch (opcode) {
+      case WS_OP_CLOSE:
+      case WS_OP_PING:
+      case WS_OP_PONG:
+        if (!fin) return "fragmented control frame";
+        if (length > WS_MAX_CONTROL_PAYLOAD) return "control frame too long";
+        opcode_ = opcode;
+        break;
+
+      case WS_OP_CONTINUATION:
+      case WS_OP_TEXT:
+      case WS_OP_BINARY:
+        if (opcode == WS_OP_CONTINUATION) {
+          if (message_opcode_ == 0) return "unexpected continuation frame";
+          opcode_ = message_opcode_;
+        } else {
+          if (message_opcode_ != 0) return "expected continuation frame";
+          opcode_ = opcode;
+          message_length_ = 0;
+        }
+        message_length_ += length;
+        if (max_payload_ > 0 && message_length_ > max_payload_) {
+          *close_code = WS_CLOSE_TOO_BIG;
+          return "message too big";
+        }
+        message_opcode_ = fin ? 0 : opcode_;
+        break;
+
+      default:
+        return "unknown opcode";
+    }
+
+    fin_ = fin;
+    remaining_ = length;
+    mask_pos_ = 0;
+    return NULL;
+  }
+
+  void AddPiece(Local<Array> pieces, uint32_t* count, int flags,
+                size_t offset, size_t length) {
+    pieces->Set((*count)++, Integer::New(opcode_));
+    pieces->Set((*count)++, Integer::New(flags));
+    pieces->Set((*count)++, Integer::NewFromUnsigned(offset));
+    pieces->Set((*count)++, Integer::NewFromUnsigned(length));
+  }
+
+
+  // new WebSocketParser(maxPayload, requireMask)
+  static Handle<Value> New(const Arguments& args) {
+    HandleScope scope;
+
+    double max_payload = args[0]->IsUndefined() ? 0 : args[0]->NumberValue();
+    if (!(max_payload >= 0)) {
+      return ThrowException(Exception::TypeError(
+            String::New("maxPayload must be a non-negative number")));
+    }
+
+    WebSocketParser* parser =
+        new WebSocketParser(max_payload, args[1]->BooleanValue());
+    parser->Wrap(args.This());
+
+    return args.This();
+  }
+
+
+  // var bytesParsed = parser.execute(buffer, off, len);
+  static Handle<Value> Execute(const Arguments& args) {
+    HandleScope scope;
+
+    WebSocketParser* parser = ObjectWrap::Unwrap<WebSocketParser>(args.This());
+
+    Local<Value> buffer_v = args[0];
+    if (!Buffer::HasInstance(buffer_v)) {
+      return ThrowException(Exception::TypeError(
+            String::New("Argument should be a buffer")));
+    }
+
+    Local<Object> buffer_obj = buffer_v->ToObject();
+    char* buffer_data = Buffer::Data(buffer_obj);
+    size_t buffer_len = Buffer::Length(buffer_obj);
+
+    size_t off = args[1]->Uint32Value();
+    if (off > buffer_len) {
+      return ThrowException(Exception::Error(
+            String::New("Offset is out of bounds")));
+    }
+
+    size_t len = args[2]->Uint32Value();
+    if (len > buffer_len - off) {
+      return ThrowException(Exception::Error(
+            String::New("Length is extends beyond buffer")));
+    }
+
+    if (parser->failed_) {
+      return ThrowException(Exception::Error(
+            String::New("Parser failed, call reinitialize() first")));
+    }
+
+    Local<Array> pieces = Array::New();
+    uint32_t count = 0;
+    const char* reason = NULL;
+    int close_code = 0;
+
+    char* p = buffer_data + off;
+    char* end = p + len;
+
+    while (p < end) {
+      if (!parser->in_payload_) {
+        size_t size;
+        while (parser->header_length_ < (size = parser->HeaderSize()) &&
+               p < end) {
+          parser->header_[parser->header_length_++] =
+              static_cast<uint8_t>(*p++);
+        }
+        if (parser->header_length_ < size) break;
+
+        parser->header_length_ = 0;
+        reason = parser->ParseHeader(&close_code);
+        if (reason != NULL) {
+          // Point bytesParsed at the start of the bad frame.
+          p -= size;
+          if (p < buffer_data + off) p = buffer_data + off;
+          break;
+        }
+
+        if (parser->remaining_ == 0) {
+          parser->AddPiece(pieces, &count,
+                           WS_FRAME_END | (parser->fin_ ? WS_FIN : 0),
+                           p - buffer_data, 0);
+        } else {
+          parser->in_payload_ = true;
+        }
+        continue;
+      }
+
+      size_t n = static_cast<size_t>(end - p);
+      if (parser->remaining_ < n) n = static_cast<size_t>(parser->remaining_);
+
+      if (parser->masked_) {
+        ApplyMask(p, n, parser->mask_, parser->mask_pos_);
+        parser->mask_pos_ += n;
+      }
+      parser->remaining_ -= n;
+
+      int flags = 0;
+      if (parser->remaining_ == 0) {
+        flags = WS_FRAME_END | (parser->fin_ ? WS_FIN : 0);
+        parser->in_payload_ = false;
+      }
+      parser->AddPiece(pieces, &count, flags, p - buffer_data, n);
+      p += n;
+    }
+
+    size_t nparsed = p - (buffer_data + off);
+
+    if (count > 0) {
+      Local<Value> cb = args.This()->Get(String::NewSymbol("onframes"));
+      if (cb->IsFunction()) {
+        Local<Value> argv[2] = { pieces, buffer_v };
+        Local<Value> r = Local<Function>::Cast(cb)->Call(args.This(), 2, argv);
+        if (r.IsEmpty()) return Local<Value>();
+      }
+    }
+
+    if (reason != NULL) {
+      parser->failed_ = true;
+      return scope.Close(FramingError(reason, close_code, nparsed));
+    }
+
+    return scope.Close(Integer::NewFromUnsigned(nparsed));
+  }
+
+
+  static Handle<Value> Reinitialize(const Arguments& args) {
+    HandleScope scope;
+    WebSocketParser* parser = ObjectWrap::Unwrap<WebSocketParser>(args.This());
+    parser->Init();
+    return Undefined();
+  }
+
+
+  double max_payload_;
+  bool require_mask_;
+
+  uint8_t header_[WS_MAX_HEADER];
+  size_t header_length_;
+
+  bool in_payload_;
+  uint64_t remaining_;
+  uint8_t mask_[4];
+  bool masked_;
+  size_t mask_pos_;
+  int opcode_;
+  bool fin_;
+
+  // The opcode of the fragmented message in progress, or 0.
+  int message_opcode_;
+  double message_length_;
+
+  bool failed_;
+};
+
+
+static bool GetMaskKey(Handle<Value> value, uint8_t key[4]) {
+  if (!Buffer::HasInstance(value)) return false;
+  Local<Object> obj = value->ToObject();
+  if (Buffer::Length(obj) < 4) return false;
+  memcpy(key, Buffer::Data(obj), 4);
+  return true;
+}
+
+
+// mask(buffer, start, end, key, keyOffset)
+//
+// XORs buffer[start..end) in place with the 4 byte Buffer key, beginning
+// at byte keyOffset of the key stream. Masking and unmasking are the same.
+static Handle<Value> Mask(const Arguments& args) {
+  HandleScope scope;
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(
+          String::New("Argument should be a buffer")));
+  }
+
+  uint8_t key[4];
+  if (!GetMaskKey(args[3], key)) {
+    return ThrowException(Exception::TypeError(
+          String::New("Mask key should be a buffer of 4 bytes")));
+  }
+
+  Local<Object> buffer_obj = args[0]->ToObject();
+  size_t length = Buffer::Length(buffer_obj);
+  size_t start = args[1]->Uint32Value();
+  size_t end = args[2]->Uint32Value();
+  if (start > end || end > length) {
+    return ThrowException(Exception::Error(
+          String::New("Out of bounds")));
+  }
+
+  ApplyMask(Buffer::Data(buffer_obj) + start, end - start, key,
+            args[4]->Uint32Value());
+
+  return Undefined();
+}
+
+
+// writeHeader(buffer, offset, opcode, fin, length, [key])
+//
+// Writes a frame header with the shortest length encoding and returns its
+// size. There must be room for WS_MAX_HEADER bytes at offset.
+static Handle<Value> WriteHeader(const Arguments& args) {
+  HandleScope scope;
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(
+          String::New("Argument should be a buffer")));
+  }
+
+  Local<Object> buffer_obj = args[0]->ToObject();
+  size_t offset = args[1]->Uint32Value();
+  if (offset > Buffer::Length(buffer_obj) ||
+      Buffer::Length(buffer_obj) - offset < WS_MAX_HEADER) {
+    return ThrowException(Exception::Error(
+          String::New("Out of bounds")));
+  }
+
+  int opcode = args[2]->Int32Value();
+  if (opcode < 0 || opcode > 0xf) {
+    return ThrowException(Exception::TypeError(
+          String::New("Bad opcode")));
+  }
+
+  double length_d = args[4]->NumberValue();
+  if (!(length_d >= 0) || length_d > 9007199254740992.0) {
+    return ThrowException(Exception::TypeError(
+          String::New("Bad payload length")));
+  }
+  uint64_t length = static_cast<uint64_t>(length_d);
+
+  uint8_t key[4];
+  bool masked = false;
+  if (!args[5]->IsUndefined() && !args[5]->IsNull()) {
+    if (!GetMaskKey(args[5], key)) {
+      return ThrowException(Exception::TypeError(
+            String::New("Mask key should be a buffer of 4 bytes")));
+    }
+    masked = true;
+  }
+
+  uint8_t* out = reinterpret_cast<uint8_t*>(Buffer::Data(buffer_obj)) + offset;
+  size_t i = 0;
+
+  out[i++] = (args[3]->BooleanValue() ? 0x80 : 0) | opcode;
+  uint8_t mask_bit = masked ? 0x80 : 0;
+  if (length < 126) {
+    out[i++] = mask_bit | static_cast<uint8_t>(length);
+  } else if (length < 0x10000) {
+    out[i++] = mask_bit | 126;
+    out[i++] = static_cast<uint8_t>(length >> 8);
+    out[i++] = static_cast<uint8_t>(length);
+  } else {
+    out[i++] = mask_bit | 127;
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      out[i++] = static_cast<uint8_t>(length >> shift);
+    }
+  }
+
+  if (masked) {
+    memcpy(out + i, key, 4);
+    i += 4;
+  }
+
+  return scope.Close(Integer::New(i));
+}
+
+
+void InitWebSocket(Handle<Object> target) {
+  HandleScope scope;
+
+  WebSocketParser::Initialize(target);
+
+  NODE_SET_METHOD(target, "mask", Mask);
+  NODE_SET_METHOD(target, "writeHeader", WriteHeader);
+
+  NODE_DEFINE_CONSTANT(target, WS_MAX_HEADER);
+  NODE_DEFINE_CONSTANT(target, WS_FRAME_END);
+  NODE_DEFINE_CONSTANT(target, WS_FIN);
+  NODE_DEFINE_CONSTANT(target, WS_OP_CONTINUATION);
+  NODE_DEFINE_CONSTANT(target, WS_OP_TEXT);
+  NODE_DEFINE_CONSTANT(target, WS_OP_BINARY);
+  NODE_DEFINE_CONSTANT(target, WS_OP_CLOSE);
+  NODE_DEFINE_CONSTANT(target, WS_OP_PING);
+  NODE_DEFINE_CONSTANT(target, WS_OP_PONG);
+}
+
+}  // namespace node
+
+NODE_MODULE(node_websocket, node::InitWebSocket)
@@ -22,13 +22,21 @@
 
 #include <v8.h>
 #include <errno.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <zlib.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
 #include <node.h>
 #include <node_buffer.h>
+#include <node_zlib.h>
 #include <req_wrap.h>
 
 
@@ -39,11 +47,6 @@ using namespace v8;
 // write() returns one of these, and then calls the cb() when it's done.
 typedef ReqWrap<uv_work_t> WorkReqWrap;
     
-class ZlibStatics : public ModuleStatics {
-public:
-  Persistent<String> callback_sym;
-};
-
 enum node_zlib_mode {
   DEFLATE = 1,
   INFLATE,
@@ -54,10 +57,70 @@ enum node_zlib_mode {
   UNZIP
 };
 
+static inline bool IsDeflateMode(node_zlib_mode mode) {
+  return mode == DEFLATE || mode == GZIP || mode == DEFLATERAW;
+}
+
+// An initialized z_stream and the settings it was initialized with.
+// deflate's state points back at the z_stream, so it stays put on the heap.
+struct ZStream {
+  z_stream strm;
+  node_zlib_mode mode;
+  int level;
+  int windowBits;
+  int memLevel;
+  int strategy;
+  ZStream *next;
+};
+
+// The most reset streams an isolate keeps around for reuse.
+#define ZLIB_MAX_FREE_STREAMS 16
+
+class ZlibStatics : public ModuleStatics {
+public:
+  ZlibStatics() : free_streams(NULL), free_stream_count(0) {}
+
+  ~ZlibStatics() {
+    while (free_streams != NULL) {
+      ZStream *stream = free_streams;
+      free_streams = stream->next;
+      FreeStream(stream);
+    }
+  }
+
+  static void FreeStream(ZStream *stream) {
+    if (IsDeflateMode(stream->mode)) {
+      (void)deflateEnd(&stream->strm);
+    } else {
+      (void)inflateEnd(&stream->strm);
+    }
+    delete stream;
+  }
+
+  // zlib's own estimate of the memory a stream allocates, see zconf.h.
+  static size_t StreamBytes(ZStream *stream) {
+    int windowBits = stream->windowBits;
+    if (windowBits < 0) windowBits = -windowBits;
+    windowBits &= 15;
+    if (windowBits == 0) windowBits = MAX_WBITS;
+
+    if (IsDeflateMode(stream->mode)) {
+      return (1 << (windowBits + 2)) + (1 << (stream->memLevel + 9));
+    }
+    return (1 << windowBits) + 7 * 1024;
+  }
+
+  Persistent<String> callback_sym;
+
+  // Streams that were reset when their owner was done with them, most
+  // recently released first.
+  ZStream *free_streams;
+  int free_stream_count;
+};
+
 template <node_zlib_mode mode> class ZCtx;
 
 
-void InitZlib(v8::Handle<v8::Object> target);
 
 
 /**
@@ -66,21 +129,304 @@ void InitZlib(v8::Handle<v8::Object> target);
 template <node_zlib_mode mode> class ZCtx : public ObjectWrap {
  public:
 
-  ZCtx() : ObjectWrap() {
+  ZCtx() : ObjectWrap(), init_done_(false), stream_(NULL), strm_(NULL),
+           dictionary_(NULL), dictionary_len_(0), out_(NULL), out_len_(0),
+           target_(NULL) {
   }
 
   ~ZCtx() {
-    if (mode == DEFLATE || mode == GZIP || mode == DEFLATERAW) {
-      (void)deflateEnd(&strm_);
-    } else if (mode == INFLATE || mode == GUNZIP || mode == INFLATERAW) {
-      (void)inflateEnd(&strm_);
+    End();
+    free(out_);
+    dictionary_obj_.Dispose();
+  }
+
+  // Gives up zlib's state, which is several hundred KB for deflate. It is
+  // reset and kept for the next stream with the same settings, as long as
+  // the isolate isn't holding too many already.
+  void End() {
+    if (!init_done_) return;
+    init_done_ = false;
+
+    ZStream *stream = stream_;
+    stream_ = NULL;
+    strm_ = NULL;
+
+    ZlibStatics *statics = NODE_STATICS_GET(node_zlib, ZlibStatics);
+    int err = IsDeflateMode(mode) ? deflateReset(&stream->strm) :
+                                    inflateReset(&stream->strm);
+
+    if (err == Z_OK && statics->free_stream_count < ZLIB_MAX_FREE_STREAMS) {
+      stream->next = statics->free_streams;
+      statics->free_streams = stream;
+      statics->free_stream_count++;
+      return;
     }
+
+    ZlibStatics::FreeStream(stream);
+  }
+
+  // Takes a free stream with these settings out of the isolate's pool, or
+  // returns NULL.
+  static ZStream*
+  ReuseStream(int level, int windowBits, int memLevel, int strategy) {
+    ZlibStatics *statics = NODE_STATICS_GET(node_zlib, ZlibStatics);
+    ZStream **link = &statics->free_streams;
+
+    while (*link != NULL) {
+      ZStream *stream = *link;
+      // inflate only has windowBits to go by.
+      if (stream->mode == mode &&
+          stream->windowBits == windowBits &&
+          (!IsDeflateMode(mode) || (stream->level == level &&
+                                    stream->memLevel == memLevel &&
+                                    stream->strategy == strategy))) {
+        *link = stream->next;
+        statics->free_stream_count--;
+        return stream;
+      }
+      link = &stream->next;
+    }
+
+    return NULL;
+  }
+
+  // close()
+  //
+  // Frees zlib's state now rather than when the object is collected. No
+  // write() may follow.
+  static Handle<Value>
+  Close(const Arguments& args) {
+    HandleScope scope;
+    ZCtx<mode> *ctx = ObjectWrap::Unwrap< ZCtx<mode> >(args.This());
+    ctx->End();
+    return Undefined();
   }
 
   // write(flush, in, in_off, in_len, out, out_off, out_len)
   static Handle<Value>
   Write(const Arguments& args) {
     HandleScope scope;
+    ZCtx<mode> *ctx = Prepare(args);
+
+    WorkReqWrap *req_wrap = new WorkReqWrap();
+    req_wrap->data_ = ctx;
+
+    // build up the work request
+    uv_work_t* work_req = new uv_work_t();
+    work_req->data = req_wrap;
+    work_req->work_type = WORK_ZLIB;
+
+    uv_queue_work(Isolate::GetCurrentLoop(),
+                  work_req,
+                  ZCtx<mode>::Process,
+                  ZCtx<mode>::After);
+
+    req_wrap->Dispatched();
+
+    return req_wrap->object_;
+  }
+
+
+  // writeSync(flush, in, in_off, in_len, out, out_off, out_len)
+  //
+  // Like write(), but runs deflate() or inflate() right away on this thread
+  // and returns [avail_in, avail_out, err]. For small inputs that is cheaper
+  // than the trip through the thread pool.
+  static Handle<Value>
+  WriteSync(const Arguments& args) {
+    HandleScope scope;
+    ZCtx<mode> *ctx = Prepare(args);
+
+    Run(ctx);
+
+    Local<Array> result = Array::New(3);
+    result->Set(0, Integer::New(ctx->strm_->avail_in));
+    result->Set(1, Integer::New(ctx->strm_->avail_out));
+    result->Set(2, Integer::New(ctx->err_));
+    return scope.Close(result);
+  }
+
+
+  // processAll(in, [outputSize], [target])
+  //
+  // Compresses or decompresses all of buffer `in` in a single thread pool
+  // request. Deflate writes into one buffer that deflateBound() says is big
+  // enough; inflate starts with `outputSize` bytes if given and grows its
+  // buffer on the pool until the stream ends. With a `target` Buffer the
+  // output goes straight into it, and only moves to a buffer of its own if
+  // it doesn't fit. The caller keeps `target` alive until the callback.
+  // Calls req.callback(err, result) with zlib's last return code and, on
+  // Z_STREAM_END, the whole output as one Buffer, or the number of bytes
+  // written if all of it went into `target`. Ends the stream, so nothing
+  // else may be written to it.
+  static Handle<Value>
+  ProcessAll(const Arguments& args) {
+    HandleScope scope;
+    ZCtx<mode> *ctx = ObjectWrap::Unwrap< ZCtx<mode> >(args.This());
+    assert(ctx->init_done_ && "processAll before init");
+
+    assert(Buffer::HasInstance(args[0]));
+    Local<Object> in_buf = args[0]->ToObject();
+    size_t in_len = Buffer::Length(in_buf);
+
+    size_t out_len;
+    if (Buffer::HasInstance(args[2])) {
+      Local<Object> target = args[2]->ToObject();
+      ctx->target_ = reinterpret_cast<Bytef *>(Buffer::Data(target));
+      out_len = Buffer::Length(target);
+    } else if (IsDeflateMode(mode)) {
+      out_len = deflateBound(ctx->strm_, in_len);
+    } else if (args[1]->IsNumber() && args[1]->IntegerValue() > 0) {
+      int64_t hint = args[1]->IntegerValue();
+      out_len = hint < kMaxOutputSize ? hint : kMaxOutputSize;
+    } else {
+      out_len = in_len * 4;
+      if (out_len < kMinInflateSize) out_len = kMinInflateSize;
+    }
+
+    ctx->out_ = ctx->target_ ?
+        ctx->target_ : reinterpret_cast<Bytef *>(malloc(out_len));
+    ctx->out_len_ = out_len;
+
+    ctx->strm_->avail_in = in_len;
+    ctx->strm_->next_in = reinterpret_cast<Bytef *>(Buffer::Data(in_buf));
+    ctx->strm_->avail_out = ctx->out_ ? out_len : 0;
+    ctx->strm_->next_out = ctx->out_;
+    ctx->flush_ = Z_FINISH;
+
+    WorkReqWrap *req_wrap = new WorkReqWrap();
+    req_wrap->data_ = ctx;
+
+    uv_work_t* work_req = new uv_work_t();
+    work_req->data = req_wrap;
+    work_req->work_type = WORK_ZLIB;
+
+    uv_queue_work(Isolate::GetCurrentLoop(),
+                  work_req,
+                  ZCtx<mode>::ProcessAllWork,
+                  ZCtx<mode>::AfterProcessAll);
+
+    req_wrap->Dispatched();
+
+    return req_wrap->object_;
+  }
+
+
+  // thread pool!
+  static void
+  ProcessAllWork(uv_work_t* work_req) {
+    WorkReqWrap *req_wrap = reinterpret_cast<WorkReqWrap *>(work_req->data);
+    ZCtx<mode> *ctx = (ZCtx<mode> *)req_wrap->data_;
+
+    if (ctx->out_ == NULL && ctx->out_len_ > 0) {
+      ctx->err_ = Z_MEM_ERROR;
+      return;
+    }
+
+    for (;;) {
+      Run(ctx);
+
+      if (ctx->err_ == Z_STREAM_END) return;
+
+      if (ctx->strm_->avail_out > 0) {
+        // With Z_FINISH and room to spare, anything but the end of the
+        // stream means the input was cut short.
+        if (ctx->err_ == Z_OK) ctx->err_ = Z_BUF_ERROR;
+        return;
+      }
+
+      // Out of room: inflate, or the target was too small. Double the buffer.
+      if (ctx->err_ != Z_OK && ctx->err_ != Z_BUF_ERROR) return;
+
+      size_t used = ctx->out_len_;
+      size_t len = used > 0 ? used * 2 : kMinInflateSize;
+      Bytef *out;
+      if (len > kMaxOutputSize) {
+        out = NULL;
+      } else if (ctx->out_ == ctx->target_) {
+        out = reinterpret_cast<Bytef *>(malloc(len));
+        if (out != NULL) {
+          memcpy(out, ctx->target_, used);
+          ctx->target_ = NULL;
+        }
+      } else {
+        out = reinterpret_cast<Bytef *>(realloc(ctx->out_, len));
+      }
+      if (out == NULL) {
+        ctx->err_ = Z_MEM_ERROR;
+        return;
+      }
+
+      ctx->out_ = out;
+      ctx->out_len_ = len;
+      ctx->strm_->next_out = out + used;
+      ctx->strm_->avail_out = len - used;
+    }
+  }
+
+
+  static void
+  FreeOutput(char *data, void *hint) {
+    V8::AdjustAmountOfExternalAllocatedMemory(
+        -static_cast<int>(reinterpret_cast<intptr_t>(hint)));
+    free(data);
+  }
+
+
+  // v8 land!
+  static void
+  AfterProcessAll(uv_work_t* work_req) {
+    HandleScope scope;
+    ZlibStatics *statics = NODE_STATICS_GET(node_zlib, ZlibStatics);
+    WorkReqWrap *req_wrap = reinterpret_cast<WorkReqWrap *>(work_req->data);
+    ZCtx<mode> *ctx = (ZCtx<mode> *)req_wrap->data_;
+
+    Local<Value> args[2] = { Integer::New(ctx->err_), Local<Value>() };
+    int argc = 1;
+
+    if (ctx->err_ == Z_STREAM_END && ctx->target_ != NULL) {
+      args[1] = Integer::New(ctx->out_len_ - ctx->strm_->avail_out);
+      argc = 2;
+      ctx->out_ = NULL;
+    } else if (ctx->err_ == Z_STREAM_END) {
+      size_t len = ctx->out_len_ - ctx->strm_->avail_out;
+      Bytef *out = ctx->out_;
+
+      // deflateBound() and the doubling both leave slack at the end.
+      if (len < ctx->out_len_) {
+        Bytef *shrunk =
+            reinterpret_cast<Bytef *>(realloc(out, len > 0 ? len : 1));
+        if (shrunk != NULL) out = shrunk;
+      }
+      ctx->out_ = NULL;
+
+      V8::AdjustAmountOfExternalAllocatedMemory(static_cast<int>(len));
+      Buffer *result = Buffer::New(reinterpret_cast<char *>(out),
+                                   len,
+                                   FreeOutput,
+                                   reinterpret_cast<void *>(len));
+      args[1] = Local<Object>::New(result->handle_);
+      argc = 2;
+    } else {
+      if (ctx->out_ != ctx->target_) free(ctx->out_);
+      ctx->out_ = NULL;
+    }
+    ctx->target_ = NULL;
+
+    ctx->End();
+
+    assert(req_wrap->object_->Get(statics->callback_sym)->IsFunction() &&
+           "Invalid callback");
+    MakeCallback(req_wrap->object_, "callback", argc, args);
+
+    delete req_wrap;
+    delete work_req;
+  }
+
+
+  // Points the stream at the buffers of a write() or writeSync() call.
+  static ZCtx<mode>*
+  Prepare(const Arguments& args) {
     assert(args.Length() == 7);
 
     ZCtx<mode> *ctx = ObjectWrap::Unwrap< ZCtx<mode> >(args.This());
@@ -115,30 +461,16 @@ template <node_zlib_mode mode> class ZCtx : public ObjectWrap {
     assert(out_off + out_len <= Buffer::Length(out_buf));
     out = reinterpret_cast<Bytef *>(Buffer::Data(out_buf) + out_off);
 
-    WorkReqWrap *req_wrap = new WorkReqWrap();
-
-    req_wrap->data_ = ctx;
-    ctx->strm_.avail_in = in_len;
-    ctx->strm_.next_in = &(*in);
-    ctx->strm_.avail_out = out_len;
-    ctx->strm_.next_out = out;
+    ctx->strm_->avail_in = in_len;
+    ctx->strm_->next_in = &(*in);
+    ctx->strm_->avail_out = out_len;
+    ctx->strm_->next_out = out;
     ctx->flush_ = flush;
 
     // set this so that later on, I can easily tell how much was written.
     ctx->chunk_size_ = out_len;
 
-    // build up the work request
-    uv_work_t* work_req = new uv_work_t();
-    work_req->data = req_wrap;
-
-    uv_queue_work(Isolate::GetCurrentLoop(),
-                  work_req,
-                  ZCtx<mode>::Process,
-                  ZCtx<mode>::After);
-
-    req_wrap->Dispatched();
-
-    return req_wrap->object_;
+    return ctx;
   }
 
 
@@ -149,8 +481,15 @@ template <node_zlib_mode mode> class ZCtx : public ObjectWrap {
   static void
   Process(uv_work_t* work_req) {
     WorkReqWrap *req_wrap = reinterpret_cast<WorkReqWrap *>(work_req->data);
-    ZCtx<mode> *ctx = (ZCtx<mode> *)req_wrap->data_;
+    Run((ZCtx<mode> *)req_wrap->data_);
 
+    // now After will emit the output, and
+    // either schedule another call to Process,
+    // or shift the queue and call Process.
+  }
+
+  static void
+  Run(ZCtx<mode> *ctx) {
     // If the avail_out is left at 0, then it means that it ran out
     // of room.  If there was avail_out left over, then it means
     // that all of the input was consumed.
@@ -159,22 +498,31 @@ template <node_zlib_mode mode> class ZCtx : public ObjectWrap {
       case DEFLATE:
       case GZIP:
       case DEFLATERAW:
-        err = deflate(&(ctx->strm_), ctx->flush_);
+        err = deflate(ctx->strm_, ctx->flush_);
         break;
       case UNZIP:
       case INFLATE:
       case GUNZIP:
       case INFLATERAW:
-        err = inflate(&(ctx->strm_), ctx->flush_);
+        err = inflate(ctx->strm_, ctx->flush_);
+        // A zlib header can ask for the dictionary it was compressed with.
+        if (err == Z_NEED_DICT && ctx->dictionary_len_ > 0) {
+          err = inflateSetDictionary(ctx->strm_,
+                                     ctx->dictionary_,
+                                     ctx->dictionary_len_);
+          if (err == Z_OK) {
+            err = inflate(ctx->strm_, ctx->flush_);
+          } else if (err == Z_STREAM_ERROR) {
+            // Not what the data was compressed with.
+            err = Z_DATA_ERROR;
+          }
+        }
         break;
       default:
         assert(0 && "wtf?");
     }
     assert(err != Z_STREAM_ERROR);
-
-    // now After will emit the output, and
-    // either schedule another call to Process,
-    // or shift the queue and call Process.
+    ctx->err_ = err;
   }
 
   // v8 land!
@@ -184,8 +532,8 @@ template <node_zlib_mode mode> class ZCtx : public ObjectWrap {
     ZlibStatics *statics = NODE_STATICS_GET(node_zlib, ZlibStatics);
     WorkReqWrap *req_wrap = reinterpret_cast<WorkReqWrap *>(work_req->data);
     ZCtx<mode> *ctx = (ZCtx<mode> *)req_wrap->data_;
-    Local<Integer> avail_out = Integer::New(ctx->strm_.avail_out);
-    Local<Integer> avail_in = Integer::New(ctx->strm_.avail_in);
+    Local<Integer> avail_out = Integer::New(ctx->strm_->avail_out);
+    Local<Integer> avail_in = Integer::New(ctx->strm_->avail_in);
 
     // call the write() cb
     assert(req_wrap->object_->Get(statics->callback_sym)->IsFunction() &&
@@ -210,8 +558,8 @@ template <node_zlib_mode mode> class ZCtx : public ObjectWrap {
   Init(const Arguments& args) {
     HandleScope scope;
 
-    assert(args.Length() == 4 &&
-           "init(windowBits, level, memLevel, strategy)");
+    assert((args.Length() == 4 || args.Length() == 5) &&
+           "init(windowBits, level, memLevel, strategy, [dictionary])");
 
     ZCtx<mode> *ctx = ObjectWrap::Unwrap< ZCtx<mode> >(args.This());
 
@@ -231,6 +579,22 @@ template <node_zlib_mode mode> class ZCtx : public ObjectWrap {
             strategy == Z_FIXED ||
             strategy == Z_DEFAULT_STRATEGY) && "invalid strategy");
 
+    ctx->dictionary_obj_.Dispose();
+    ctx->dictionary_obj_.Clear();
+    ctx->dictionary_ = NULL;
+    ctx->dictionary_len_ = 0;
+
+    if (args.Length() == 5 && !args[4]->IsUndefined()) {
+      assert(Buffer::HasInstance(args[4]) && "dictionary must be a buffer");
+      assert(mode != GZIP && mode != GUNZIP &&
+             "gzip streams have no dictionary");
+      Local<Object> dictionary = args[4]->ToObject();
+      // The thread pool reads it, so keep it alive and where it is.
+      ctx->dictionary_obj_ = Persistent<Object>::New(dictionary);
+      ctx->dictionary_ = reinterpret_cast<Bytef *>(Buffer::Data(dictionary));
+      ctx->dictionary_len_ = Buffer::Length(dictionary);
+    }
+
     Init(ctx, level, windowBits, memLevel, strategy);
     return Undefined();
   }
@@ -241,15 +605,13 @@ template <node_zlib_mode mode> class ZCtx : public ObjectWrap {
        int windowBits,
        int memLevel,
        int strategy) {
+    ctx->End();
+
     ctx->level_ = level;
     ctx->windowBits_ = windowBits;
     ctx->memLevel_ = memLevel;
     ctx->strategy_ = strategy;
 
-    ctx->strm_.zalloc = Z_NULL;
-    ctx->strm_.zfree = Z_NULL;
-    ctx->strm_.opaque = Z_NULL;
-
     ctx->flush_ = Z_NO_FLUSH;
 
     if (mode == GZIP || mode == GUNZIP) {
@@ -264,12 +626,40 @@ template <node_zlib_mode mode> class ZCtx : public ObjectWrap {
       ctx->windowBits_ *= -1;
     }
 
+    ZStream *stream = ReuseStream(ctx->level_,
+                                  ctx->windowBits_,
+                                  ctx->memLevel_,
+                                  ctx->strategy_);
+    if (stream != NULL) {
+      ctx->stream_ = stream;
+      ctx->strm_ = &stream->strm;
+      ctx->init_done_ = true;
+      // Resetting the stream dropped any dictionary it had.
+      SetDictionary(ctx);
+      return;
+    }
+
+    stream = new ZStream();
+    stream->mode = mode;
+    stream->level = ctx->level_;
+    stream->windowBits = ctx->windowBits_;
+    stream->memLevel = ctx->memLevel_;
+    stream->strategy = ctx->strategy_;
+    stream->next = NULL;
+
+    stream->strm.zalloc = Z_NULL;
+    stream->strm.zfree = Z_NULL;
+    stream->strm.opaque = Z_NULL;
+
+    ctx->stream_ = stream;
+    ctx->strm_ = &stream->strm;
+
     int err;
     switch (mode) {
       case DEFLATE:
       case GZIP:
       case DEFLATERAW:
-        err = deflateInit2(&(ctx->strm_),
+        err = deflateInit2(ctx->strm_,
                            ctx->level_,
                            Z_DEFLATED,
                            ctx->windowBits_,
@@ -280,7 +670,7 @@ template <node_zlib_mode mode> class ZCtx : public ObjectWrap {
       case GUNZIP:
       case INFLATERAW:
       case UNZIP:
-        err = inflateInit2(&(ctx->strm_), ctx->windowBits_);
+        err = inflateInit2(ctx->strm_, ctx->windowBits_);
         break;
       default:
         assert(0 && "wtf?");
@@ -288,34 +678,512 @@ template <node_zlib_mode mode> class ZCtx : public ObjectWrap {
 
     ctx->init_done_ = true;
     assert(err == Z_OK);
+
+    SetDictionary(ctx);
+  }
+
+  // Deflate and raw inflate take the dictionary up front. Inflate and
+  // unzip wait for the zlib header to ask for it, in Run().
+  static void
+  SetDictionary(ZCtx *ctx) {
+    if (ctx->dictionary_len_ == 0) return;
+
+    int err = Z_OK;
+    switch (mode) {
+      case DEFLATE:
+      case DEFLATERAW:
+        err = deflateSetDictionary(ctx->strm_,
+                                   ctx->dictionary_,
+                                   ctx->dictionary_len_);
+        break;
+      case INFLATERAW:
+        err = inflateSetDictionary(ctx->strm_,
+                                   ctx->dictionary_,
+                                   ctx->dictionary_len_);
+        break;
+      default:
+        break;
+    }
+
+    assert(err == Z_OK && "failed to set dictionary");
   }
 
  private:
 
   bool init_done_;
 
-  z_stream strm_;
+  ZStream *stream_;
+  z_stream *strm_;
   int level_;
   int windowBits_;
   int memLevel_;
   int strategy_;
 
   int flush_;
+  // What the last deflate() or inflate() returned.
+  int err_;
 
   int chunk_size_;
+
+  // The preset dictionary, if any, and the Buffer that holds it.
+  Persistent<Object> dictionary_obj_;
+  Bytef *dictionary_;
+  size_t dictionary_len_;
+
+  // processAll()'s output, malloc()ed so its Buffer can take it over, or
+  // the caller's target_ for as long as that is big enough.
+  Bytef *out_;
+  size_t out_len_;
+  Bytef *target_;
+
+  static const size_t kMinInflateSize = 1024;
+  static const size_t kMaxOutputSize = 0x3fffffff;
 };
 
 
+/**
+ * Parallel gzip
+ *
+ * The input is cut into blocks that are deflated at the same time on the
+ * thread pool, each primed with the last 32K of the block before it. All
+ * but the last block end with a sync flush, so their raw deflate output
+ * joins into one stream, and crc32_combine() gives the checksum of the
+ * whole. The result is a single ordinary gzip member.
+ */
+
+#define GZIP_DICTIONARY_SIZE (32 * 1024)
+
+struct GzipJob;
+
+struct GzipBlock {
+  uv_work_t work_req;
+  GzipJob *job;
+
+  const Bytef *in;
+  size_t in_len;
+  const Bytef *dictionary;
+  size_t dictionary_len;
+  bool last;
+
+  Bytef *out;
+  size_t out_len;
+  uLong crc;
+  int err;
+};
+
+struct GzipJob {
+  WorkReqWrap *req_wrap;
+  int level;
+  size_t in_len;
+  GzipBlock *blocks;
+  size_t block_count;
+  size_t pending;
+};
+
+
+// thread pool!
+static void GzipBlockWork(uv_work_t* work_req) {
+  GzipBlock *block = reinterpret_cast<GzipBlock *>(work_req->data);
+  const bool last = block->last;
+
+  block->crc = crc32(crc32(0L, Z_NULL, 0), block->in, block->in_len);
+
+  z_stream strm;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+
+  block->err = deflateInit2(&strm,
+                            block->job->level,
+                            Z_DEFLATED,
+                            -MAX_WBITS,
+                            8,
+                            Z_DEFAULT_STRATEGY);
+  if (block->err != Z_OK) return;
+
+  if (block->dictionary_len > 0) {
+    (void)deflateSetDictionary(&strm, block->dictionary, block->dictionary_len);
+  }
+
+  // Leave room for the empty stored block a sync flush ends with.
+  size_t len = deflateBound(&strm, block->in_len) + 16;
+  block->out = reinterpret_cast<Bytef *>(malloc(len));
+  if (block->out == NULL) {
+    block->err = Z_MEM_ERROR;
+    (void)deflateEnd(&strm);
+    return;
+  }
+
+  strm.next_in = const_cast<Bytef *>(block->in);
+  strm.avail_in = block->in_len;
+  strm.next_out = block->out;
+  strm.avail_out = len;
+
+  int err = deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+  if (last) {
+    block->err = err == Z_STREAM_END ? Z_OK : Z_BUF_ERROR;
+  } else {
+    block->err = (err == Z_OK && strm.avail_in == 0 && strm.avail_out > 0) ?
+        Z_OK : Z_BUF_ERROR;
+  }
+  block->out_len = len - strm.avail_out;
+
+  (void)deflateEnd(&strm);
+}
+
+
+static void FreeGzipOutput(char *data, void *hint) {
+  V8::AdjustAmountOfExternalAllocatedMemory(
+      -static_cast<int>(reinterpret_cast<intptr_t>(hint)));
+  free(data);
+}
+
+
+static void WriteLE32(Bytef *p, uLong n) {
+  p[0] = n & 0xff;
+  p[1] = (n >> 8) & 0xff;
+  p[2] = (n >> 16) & 0xff;
+  p[3] = (n >> 24) & 0xff;
+}
+
+
+// v8 land! Joins the blocks once the last of them is done.
+static void AfterGzipBlock(uv_work_t* work_req) {
+  GzipBlock *block = reinterpret_cast<GzipBlock *>(work_req->data);
+  GzipJob *job = block->job;
+  if (--job->pending > 0) return;
+
+  HandleScope scope;
+
+  int err = Z_OK;
+  size_t len = 10 + 8;  // header and trailer
+  uLong crc = crc32(0L, Z_NULL, 0);
+  for (size_t i = 0; i < job->block_count; i++) {
+    GzipBlock *b = &job->blocks[i];
+    if (b->err != Z_OK) err = b->err;
+    len += b->out_len;
+    crc = crc32_combine(crc, b->crc, b->in_len);
+  }
+
+  Bytef *out = NULL;
+  if (err == Z_OK) {
+    out = reinterpret_cast<Bytef *>(malloc(len));
+    if (out == NULL) err = Z_MEM_ERROR;
+  }
+
+  if (out != NULL) {
+    // No name, no mtime, unix.
+    static const Bytef header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+    memcpy(out, header, sizeof header);
+
+    Bytef *p = out + sizeof header;
+    for (size_t i = 0; i < job->block_count; i++) {
+      memcpy(p, job->blocks[i].out, job->blocks[i].out_len);
+      p += job->blocks[i].out_len;
+    }
+    WriteLE32(p, crc);
+    WriteLE32(p + 4, job->in_len);
+  }
+
+  for (size_t i = 0; i < job->block_count; i++) {
+    free(job->blocks[i].out);
+  }
+
+  Local<Value> args[2];
+  int argc = 1;
+  if (err == Z_OK) {
+    args[0] = Integer::New(Z_STREAM_END);
+    V8::AdjustAmountOfExternalAllocatedMemory(static_cast<int>(len));
+    Buffer *result = Buffer::New(reinterpret_cast<char *>(out),
+                                 len,
+                                 FreeGzipOutput,
+                                 reinterpret_cast<void *>(len));
+    args[1] = Local<Object>::New(result->handle_);
+    argc = 2;
+  } else {
+    args[0] = Integer::New(err);
+  }
+
+  WorkReqWrap *req_wrap = job->req_wrap;
+  delete[] job->blocks;
+  delete job;
+
+  MakeCallback(req_wrap->object_, "callback", argc, args);
+  delete req_wrap;
+}
+
+
+// gzipParallel(in, level, blockSize)
+//
+// Calls req.callback(err, result) with Z_STREAM_END and the gzipped input
+// in one Buffer, or with a zlib error code.
+static Handle<Value> GzipParallel(const Arguments& args) {
+  HandleScope scope;
+
+  assert(args.Length() == 3 && "gzipParallel(in, level, blockSize)");
+  assert(Buffer::HasInstance(args[0]));
+  Local<Object> in_buf = args[0]->ToObject();
+  const Bytef *in = reinterpret_cast<Bytef *>(Buffer::Data(in_buf));
+  size_t in_len = Buffer::Length(in_buf);
+
+  int level = args[1]->Int32Value();
+  assert((level >= -1 && level <= 9) && "invalid compression level");
+
+  size_t block_size = args[2]->Uint32Value();
+  assert(block_size >= GZIP_DICTIONARY_SIZE && "block size too small");
+
+  GzipJob *job = new GzipJob();
+  job->req_wrap = new WorkReqWrap();
+  job->req_wrap->data_ = job;
+  job->level = level;
+  job->in_len = in_len;
+  job->block_count = in_len == 0 ? 1 : (in_len + block_size - 1) / block_size;
+  job->pending = job->block_count;
+  job->blocks = new GzipBlock[job->block_count];
+
+  for (size_t i = 0; i < job->block_count; i++) {
+    GzipBlock *block = &job->blocks[i];
+    size_t off = i * block_size;
+
+    block->job = job;
+    block->in = in + off;
+    block->in_len = in_len - off < block_size ? in_len - off : block_size;
+    block->dictionary = i > 0 ? block->in - GZIP_DICTIONARY_SIZE : NULL;
+    block->dictionary_len = i > 0 ? GZIP_DICTIONARY_SIZE : 0;
+    block->last = i == job->block_count - 1;
+    block->out = NULL;
+    block->out_len = 0;
+    block->crc = 0;
+    block->err = Z_OK;
+
+    block->work_req.data = block;
+    block->work_req.work_type = WORK_ZLIB;
+    uv_queue_work(Isolate::GetCurrentLoop(),
+                  &block->work_req,
+                  GzipBlockWork,
+                  AfterGzipBlock);
+  }
+
+  job->req_wrap->Dispatched();
+
+  return job->req_wrap->object_;
+}
+
+
+/**
+ * Checksums
+ *
+ * crc32 and adler32 are zlib's. crc32c, the Castagnoli polynomial used by
+ * iSCSI, ext4 and many storage formats, uses the crc32 instructions of
+ * SSE 4.2 or ARMv8 where the CPU has them, and slice-by-8 tables if not.
+ */
+static uint32_t crc32c_table[8][256];
+
+static uint32_t Crc32cSlice8(uint32_t crc, const uint8_t *p, size_t len) {
+  crc = ~crc;
+
+  while (len > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    len--;
+  }
+
+  while (len >= 8) {
+    uint32_t lo = crc ^ (p[0] | p[1] << 8 | p[2] << 16 |
+                         static_cast<uint32_t>(p[3]) << 24);
+    uint32_t hi = p[4] | p[5] << 8 | p[6] << 16 |
+                  static_cast<uint32_t>(p[7]) << 24;
+    crc = crc32c_table[7][lo & 0xff] ^
+          crc32c_table[6][(lo >> 8) & 0xff] ^
+          crc32c_table[5][(lo >> 16) & 0xff] ^
+          crc32c_table[4][lo >> 24] ^
+          crc32c_table[3][hi & 0xff] ^
+          crc32c_table[2][(hi >> 8) & 0xff] ^
+          crc32c_table[1][(hi >> 16) & 0xff] ^
+          crc32c_table[0][hi >> 24];
+    p += 8;
+    len -= 8;
+  }
+
+  while (len-- > 0) {
+    crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  }
+
+  return ~crc;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NODE_CRC32C_SSE42 1
+
+__attribute__((target("sse4.2")))
+static uint32_t Crc32cSse42(uint32_t crc, const uint8_t *p, size_t len) {
+  crc = ~crc;
+
+  while (len > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    crc = __builtin_ia32_crc32qi(crc, *p++);
+    len--;
+  }
+
+#if defined(__x86_64__)
+  uint64_t crc64 = crc;
+  while (len >= 8) {
+    crc64 = __builtin_ia32_crc32di(crc64,
+                                   *reinterpret_cast<const uint64_t *>(p));
+    p += 8;
+    len -= 8;
+  }
+  crc = static_cast<uint32_t>(crc64);
+#endif
+
+  while (len >= 4) {
+    crc = __builtin_ia32_crc32si(crc, *reinterpret_cast<const uint32_t *>(p));
+    p += 4;
+    len -= 4;
+  }
+
+  while (len-- > 0) {
+    crc = __builtin_ia32_crc32qi(crc, *p++);
+  }
+
+  return ~crc;
+}
+
+static bool HasSse42() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  return (ecx & bit_SSE4_2) != 0;
+}
+
+#elif defined(__ARM_FEATURE_CRC32)
+#define NODE_CRC32C_ARMV8 1
+
+static uint32_t Crc32cArmv8(uint32_t crc, const uint8_t *p, size_t len) {
+  crc = ~crc;
+
+  while (len > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    crc = __crc32cb(crc, *p++);
+    len--;
+  }
+
+  while (len >= 8) {
+    crc = __crc32cd(crc, *reinterpret_cast<const uint64_t *>(p));
+    p += 8;
+    len -= 8;
+  }
+
+  while (len-- > 0) {
+    crc = __crc32cb(crc, *p++);
+  }
+
+  return ~crc;
+}
+#endif
+
+typedef uint32_t (*Crc32cFunction)(uint32_t crc, const uint8_t *p, size_t len);
+static Crc32cFunction crc32c_function = Crc32cSlice8;
+
+// Fills the tables and picks the kernel once, at startup, before any
+// isolate threads exist.
+static struct Crc32cInit {
+  Crc32cInit() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int k = 0; k < 8; k++) {
+        crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+      }
+      crc32c_table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+      for (int t = 1; t < 8; t++) {
+        uint32_t prev = crc32c_table[t - 1][i];
+        crc32c_table[t][i] = (prev >> 8) ^ crc32c_table[0][prev & 0xff];
+      }
+    }
+
+#if defined(NODE_CRC32C_SSE42)
+    if (HasSse42()) crc32c_function = Crc32cSse42;
+#elif defined(NODE_CRC32C_ARMV8)
+    crc32c_function = Crc32cArmv8;
+#endif
+  }
+} crc32c_init;
+
+// crc32(buffer, value), adler32(buffer, value) and crc32c(buffer, value)
+// continue the checksum `value` over the bytes of `buffer`.
+static Handle<Value> Crc32(const Arguments& args) {
+  HandleScope scope;
+  assert(Buffer::HasInstance(args[0]));
+  Local<Object> buf = args[0]->ToObject();
+  uLong crc = crc32(args[1]->Uint32Value(),
+                    reinterpret_cast<Bytef *>(Buffer::Data(buf)),
+                    Buffer::Length(buf));
+  return scope.Close(Integer::NewFromUnsigned(crc));
+}
+
+
+static Handle<Value> Adler32(const Arguments& args) {
+  HandleScope scope;
+  assert(Buffer::HasInstance(args[0]));
+  Local<Object> buf = args[0]->ToObject();
+  uLong adler = adler32(args[1]->Uint32Value(),
+                        reinterpret_cast<Bytef *>(Buffer::Data(buf)),
+                        Buffer::Length(buf));
+  return scope.Close(Integer::NewFromUnsigned(adler));
+}
+
+
+static Handle<Value> Crc32c(const Arguments& args) {
+  HandleScope scope;
+  assert(Buffer::HasInstance(args[0]));
+  Local<Object> buf = args[0]->ToObject();
+  uint32_t crc = crc32c_function(
+      args[1]->Uint32Value(),
+      reinterpret_cast<const uint8_t *>(Buffer::Data(buf)),
+      Buffer::Length(buf));
+  return scope.Close(Integer::NewFromUnsigned(crc));
+}
+
+
 #define NODE_ZLIB_CLASS(mode, name)   \
   { \
     Local<FunctionTemplate> z = FunctionTemplate::New(ZCtx<mode>::New); \
     z->InstanceTemplate()->SetInternalFieldCount(1); \
     NODE_SET_PROTOTYPE_METHOD(z, "write", ZCtx<mode>::Write); \
+    NODE_SET_PROTOTYPE_METHOD(z, "writeSync", ZCtx<mode>::WriteSync); \
+    NODE_SET_PROTOTYPE_METHOD(z, "processAll", ZCtx<mode>::ProcessAll); \
+    NODE_SET_PROTOTYPE_METHOD(z, "close", ZCtx<mode>::Close); \
     NODE_SET_PROTOTYPE_METHOD(z, "init", ZCtx<mode>::Init); \
     z->SetClassName(String::NewSymbol(name)); \
     target->Set(String::NewSymbol(name), z->GetFunction()); \
   }
 
+size_t TrimZlibStreams(size_t retain) {
+  ZlibStatics *statics = NODE_STATICS_GET(node_zlib, ZlibStatics);
+  if (statics == NULL) return 0;
+
+  // Keep the most recently released streams, they are the likeliest to be
+  // asked for again.
+  ZStream **link = &statics->free_streams;
+  size_t kept = 0;
+  size_t freed = 0;
+
+  while (*link != NULL) {
+    ZStream *stream = *link;
+    size_t bytes = ZlibStatics::StreamBytes(stream);
+    if (kept + bytes <= retain) {
+      kept += bytes;
+      link = &stream->next;
+      continue;
+    }
+    *link = stream->next;
+    statics->free_stream_count--;
+    ZlibStatics::FreeStream(stream);
+    freed += bytes;
+  }
+
+  return freed;
+}
+
+
 void InitZlib(Handle<Object> target) {
   HandleScope scope;
   NODE_STATICS_NEW(node_zlib, ZlibStatics, statics);
@@ -328,6 +1196,11 @@ void InitZlib(Handle<Object> target) {
   NODE_ZLIB_CLASS(GUNZIP, "Gunzip")
   NODE_ZLIB_CLASS(UNZIP, "Unzip")
 
+  NODE_SET_METHOD(target, "gzipParallel", GzipParallel);
+  NODE_SET_METHOD(target, "crc32", Crc32);
+  NODE_SET_METHOD(target, "adler32", Adler32);
+  NODE_SET_METHOD(target, "crc32c", Crc32c);
+
   statics->callback_sym = NODE_PSYMBOL("callback");
 
   NODE_DEFINE_CONSTANT(target, Z_NO_FLUSH);
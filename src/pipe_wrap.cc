@@ -26,6 +26,17 @@
 #include <stream_wrap.h>
 #include <pipe_wrap.h>
 
+#include <stdlib.h> /* realloc, free */
+#include <string.h> /* memcpy */
+
+// Frames are a 4 byte big endian payload length, a 1 byte payload type and
+// the payload.
+#define FRAME_HEADER 5
+#define FRAME_MAX (64 * 1024 * 1024)
+// First allocation for collected input, doubled as it fills up.
+#define COLLECT_INITIAL_SIZE (64 * 1024)
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
 #define UNWRAP \
   assert(!args.Holder().IsEmpty()); \
   assert(args.Holder()->InternalFieldCount() > 0); \
@@ -53,6 +64,7 @@ using v8::TryCatch;
 using v8::Context;
 using v8::Arguments;
 using v8::Integer;
+using v8::Array;
 
 Persistent<Function> pipeConstructor;
 
@@ -66,6 +78,19 @@ uv_pipe_t* PipeWrap::UVHandle() {
 }
 
 
+Local<Object> PipeWrap::Instantiate(bool ipc) {
+  // If this assert fires then process.binding('pipe_wrap') hasn't been
+  // called yet.
+  assert(pipeConstructor.IsEmpty() == false);
+
+  HandleScope scope;
+  Local<Value> argv[1] = { Local<Value>::New(ipc ? v8::True() : v8::False()) };
+  Local<Object> obj = pipeConstructor->NewInstance(1, argv);
+
+  return scope.Close(obj);
+}
+
+
 PipeWrap* PipeWrap::Unwrap(Local<Object> obj) {
   assert(!obj.IsEmpty());
   assert(obj->InternalFieldCount() > 0);
@@ -85,16 +110,34 @@ void PipeWrap::Initialize(Handle<Object> target) {
 
   NODE_SET_PROTOTYPE_METHOD(t, "close", HandleWrap::Close);
   NODE_SET_PROTOTYPE_METHOD(t, "unref", HandleWrap::Unref);
+  NODE_SET_PROTOTYPE_METHOD(t, "ref", HandleWrap::Ref);
 
   NODE_SET_PROTOTYPE_METHOD(t, "readStart", StreamWrap::ReadStart);
   NODE_SET_PROTOTYPE_METHOD(t, "readStop", StreamWrap::ReadStop);
   NODE_SET_PROTOTYPE_METHOD(t, "write", StreamWrap::Write);
+  NODE_SET_PROTOTYPE_METHOD(t, "writeAsciiString", StreamWrap::WriteAsciiString);
+  NODE_SET_PROTOTYPE_METHOD(t, "writeUtf8String", StreamWrap::WriteUtf8String);
+  NODE_SET_PROTOTYPE_METHOD(t, "tryWrite", StreamWrap::TryWrite);
+  NODE_SET_PROTOTYPE_METHOD(t, "setIdleTimeout", StreamWrap::SetIdleTimeout);
+  NODE_SET_PROTOTYPE_METHOD(t, "setWriteWatermarks",
+                            StreamWrap::SetWriteWatermarks);
+  NODE_SET_PROTOTYPE_METHOD(t, "getWriteQueueSize",
+                            StreamWrap::GetWriteQueueSize);
+  NODE_SET_PROTOTYPE_METHOD(t, "pipeTo", StreamWrap::PipeTo);
+#ifndef _WIN32
+  // Windows named pipes only accept one buffer per write request.
+  NODE_SET_PROTOTYPE_METHOD(t, "writev", StreamWrap::Writev);
+  NODE_SET_PROTOTYPE_METHOD(t, "writeChunk", StreamWrap::WriteChunk);
+#endif
   NODE_SET_PROTOTYPE_METHOD(t, "shutdown", StreamWrap::Shutdown);
 
   NODE_SET_PROTOTYPE_METHOD(t, "bind", Bind);
   NODE_SET_PROTOTYPE_METHOD(t, "listen", Listen);
   NODE_SET_PROTOTYPE_METHOD(t, "connect", Connect);
   NODE_SET_PROTOTYPE_METHOD(t, "open", Open);
+  NODE_SET_PROTOTYPE_METHOD(t, "setFraming", SetFraming);
+  NODE_SET_PROTOTYPE_METHOD(t, "collectStart", CollectStart);
+  NODE_SET_PROTOTYPE_METHOD(t, "collectStop", CollectStop);
 
   pipeConstructor = Persistent<Function>::New(t->GetFunction());
 
@@ -117,7 +160,17 @@ Handle<Value> PipeWrap::New(const Arguments& args) {
 
 
 PipeWrap::PipeWrap(Handle<Object> object, bool ipc)
-    : StreamWrap(object, (uv_stream_t*) &handle_) {
+    : StreamWrap(object, (uv_stream_t*) &handle_),
+      framing_(false),
+      frame_(NULL),
+      frame_len_(0),
+      frame_size_(0),
+      collecting_(false),
+      collect_overflow_(false),
+      collect_(NULL),
+      collect_len_(0),
+      collect_size_(0),
+      collect_max_(0) {
   int r = uv_pipe_init(Isolate::GetCurrentLoop(), &handle_, ipc);
   assert(r == 0); // How do we proxy this error up to javascript?
                   // Suggestion: uv_pipe_init() returns void.
@@ -126,6 +179,299 @@ PipeWrap::PipeWrap(Handle<Object> object, bool ipc)
 }
 
 
+PipeWrap::~PipeWrap() {
+  free(frame_);
+  free(collect_);
+  if (!frame_handle_.IsEmpty()) frame_handle_.Dispose();
+}
+
+
+// setFraming(true) makes the pipe split its input into length-prefixed
+// frames and hand them to onframes(buffers, offsets, lengths, types,
+// handles) instead of calling onread. Frames that arrive in one read are
+// slices of the read slab; only frames spanning reads are copied.
+Handle<Value> PipeWrap::SetFraming(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  wrap->framing_ = args[0]->IsTrue();
+
+  return scope.Close(Integer::New(0));
+}
+
+
+// collectStart(maxBytes) makes the pipe append everything it reads to one
+// growing buffer instead of calling onread for every chunk. At EOF the
+// buffer is handed to oncollect(buffer, false). If more than maxBytes
+// arrive, oncollect(buffer, true) gets what fit and the rest of the input is
+// read and dropped.
+Handle<Value> PipeWrap::CollectStart(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  wrap->collecting_ = true;
+  wrap->collect_overflow_ = false;
+  wrap->collect_max_ = args[0]->IsNumber() ? args[0]->IntegerValue() : 0;
+
+  return scope.Close(Integer::New(0));
+}
+
+
+// Stops collecting and returns what was collected so far as a Buffer.
+// Reads after this go to onread again.
+Handle<Value> PipeWrap::CollectStop(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  wrap->collecting_ = false;
+
+  return scope.Close(wrap->TakeCollected());
+}
+
+
+static void FreeCollected(char* data, void* hint) {
+  free(data);
+}
+
+
+Local<Value> PipeWrap::TakeCollected() {
+  HandleScope scope;
+  Buffer* buffer;
+
+  if (collect_len_ == 0) {
+    buffer = Buffer::New(0);
+    free(collect_);
+  } else {
+    buffer = Buffer::New(collect_, collect_len_, FreeCollected, NULL);
+  }
+
+  collect_ = NULL;
+  collect_len_ = collect_size_ = 0;
+
+  return scope.Close(Local<Object>::New(buffer->handle_));
+}
+
+
+void PipeWrap::Collect(const char* data, size_t len) {
+  HandleScope scope;
+
+  if (collect_overflow_) return;
+
+  if (collect_max_ && collect_len_ + len > collect_max_) {
+    len = collect_max_ - collect_len_;
+    collect_overflow_ = true;
+  }
+
+  if (collect_len_ + len > collect_size_) {
+    size_t size = collect_size_ ? collect_size_ : COLLECT_INITIAL_SIZE;
+    while (size < collect_len_ + len) size *= 2;
+
+    char* collect = static_cast<char*>(realloc(collect_, size));
+    if (collect == NULL) {
+      // Report what we have rather than abort the process.
+      collect_overflow_ = true;
+      len = 0;
+    } else {
+      collect_ = collect;
+      collect_size_ = size;
+    }
+  }
+
+  if (len > 0) {
+    memcpy(collect_ + collect_len_, data, len);
+    collect_len_ += len;
+  }
+
+  if (collect_overflow_) {
+    Local<Value> argv[2] = { TakeCollected(), Local<Value>::New(v8::True()) };
+    MakeCallback(object_, "oncollect", 2, argv);
+  }
+}
+
+
+void PipeWrap::OnReadEnd() {
+  if (!collecting_) return;
+
+  collecting_ = false;
+  if (collect_overflow_) return;
+
+  HandleScope scope;
+  Local<Value> argv[2] = { TakeCollected(), Local<Value>::New(v8::False()) };
+  MakeCallback(object_, "oncollect", 2, argv);
+}
+
+
+bool PipeWrap::ReserveFrame(size_t size) {
+  if (size <= frame_size_) return true;
+
+  char* frame = static_cast<char*>(realloc(frame_, size));
+  if (frame == NULL) return false;
+
+  frame_ = frame;
+  frame_size_ = size;
+  return true;
+}
+
+
+void PipeWrap::FramingError(int code) {
+  free(frame_);
+  frame_ = NULL;
+  frame_len_ = frame_size_ = 0;
+
+  uv_err_t err;
+  err.code = static_cast<uv_err_code>(code);
+  SetErrno(err);
+  MakeCallback(object_, "onread", 0, NULL);
+}
+
+
+static inline size_t FrameLength(const char* header) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(header);
+  return (static_cast<size_t>(p[0]) << 24) |
+         (static_cast<size_t>(p[1]) << 16) |
+         (static_cast<size_t>(p[2]) << 8) |
+         static_cast<size_t>(p[3]);
+}
+
+
+static inline int FrameType(const char* header) {
+  return static_cast<unsigned char>(header[4]);
+}
+
+
+bool PipeWrap::OnReadData(Local<Value> slab,
+                          size_t offset,
+                          size_t nread,
+                          Local<Value> pending) {
+  if (collecting_) {
+    Collect(Buffer::Data(slab->ToObject()) + offset, nread);
+    return true;
+  }
+
+  if (!framing_) return false;
+
+  HandleScope scope;
+
+  const char* data = Buffer::Data(slab->ToObject()) + offset;
+  Local<Array> buffers = Array::New();
+  Local<Array> offsets = Array::New();
+  Local<Array> lengths = Array::New();
+  Local<Array> types = Array::New();
+  Local<Array> handles = Array::New();
+  int n = 0;
+  size_t pos = 0;
+
+  // The kernel ends a read with the message that carried a handle, so the
+  // handle belongs to the last frame starting in this read. That frame may
+  // only complete in a later read.
+  int handle_index = -1;
+  bool handle_later = false;
+  bool started_here = false;
+
+  while (pos < nread) {
+    size_t avail = nread - pos;
+
+    // Fast path: the whole frame is in this read.
+    if (frame_len_ == 0 && avail >= FRAME_HEADER) {
+      size_t len = FrameLength(data + pos);
+      if (len > FRAME_MAX) {
+        FramingError(UV_EPROTO);
+        return true;
+      }
+
+      if (avail - FRAME_HEADER >= len) {
+        handle_index = n;
+        handle_later = false;
+        buffers->Set(n, slab);
+        offsets->Set(n, Integer::NewFromUnsigned(offset + pos +
+                                                 FRAME_HEADER));
+        lengths->Set(n, Integer::NewFromUnsigned(len));
+        types->Set(n, Integer::New(FrameType(data + pos)));
+        n++;
+        pos += FRAME_HEADER + len;
+        continue;
+      }
+    }
+
+    if (frame_len_ == 0) {
+      started_here = true;
+      handle_later = true;
+    }
+
+    // Collect the header first and then the payload of a frame that spans
+    // reads.
+    if (frame_len_ < FRAME_HEADER) {
+      if (!ReserveFrame(FRAME_HEADER)) {
+        FramingError(UV_ENOMEM);
+        return true;
+      }
+
+      size_t take = MIN(FRAME_HEADER - frame_len_, avail);
+      memcpy(frame_ + frame_len_, data + pos, take);
+      frame_len_ += take;
+      pos += take;
+      avail -= take;
+
+      if (frame_len_ < FRAME_HEADER) break;
+
+      size_t len = FrameLength(frame_);
+      if (len > FRAME_MAX) {
+        FramingError(UV_EPROTO);
+        return true;
+      }
+      if (!ReserveFrame(FRAME_HEADER + len)) {
+        FramingError(UV_ENOMEM);
+        return true;
+      }
+    }
+
+    size_t len = FrameLength(frame_);
+    size_t take = MIN(FRAME_HEADER + len - frame_len_, avail);
+    memcpy(frame_ + frame_len_, data + pos, take);
+    frame_len_ += take;
+    pos += take;
+
+    if (frame_len_ == FRAME_HEADER + len) {
+      if (started_here) {
+        handle_index = n;
+        handle_later = false;
+      } else if (!frame_handle_.IsEmpty()) {
+        handles->Set(n, frame_handle_);
+        frame_handle_.Dispose();
+        frame_handle_.Clear();
+      }
+
+      Buffer* buffer = Buffer::New(frame_ + FRAME_HEADER, len);
+      buffers->Set(n, Local<Object>::New(buffer->handle_));
+      offsets->Set(n, Integer::New(0));
+      lengths->Set(n, Integer::NewFromUnsigned(len));
+      types->Set(n, Integer::New(FrameType(frame_)));
+      n++;
+      frame_len_ = 0;
+      started_here = false;
+    }
+  }
+
+  if (!pending.IsEmpty()) {
+    if (handle_later || handle_index < 0) {
+      if (!frame_handle_.IsEmpty()) frame_handle_.Dispose();
+      frame_handle_ = Persistent<Value>::New(pending);
+    } else {
+      handles->Set(handle_index, pending);
+    }
+  }
+
+  if (n == 0) return true;
+
+  Local<Value> argv[5] = { buffers, offsets, lengths, types, handles };
+  MakeCallback(object_, "onframes", 5, argv);
+  return true;
+}
+
+
 Handle<Value> PipeWrap::Bind(const Arguments& args) {
   HandleScope scope;
 
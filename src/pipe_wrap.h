@@ -29,22 +29,54 @@ class PipeWrap : StreamWrap {
  public:
   uv_pipe_t* UVHandle();
 
+  static v8::Local<v8::Object> Instantiate(bool ipc = false);
   static PipeWrap* Unwrap(v8::Local<v8::Object> obj);
   static void Initialize(v8::Handle<v8::Object> target);
 
  private:
   PipeWrap(v8::Handle<v8::Object> object, bool ipc);
+  ~PipeWrap();
 
   static v8::Handle<v8::Value> New(const v8::Arguments& args);
   static v8::Handle<v8::Value> Bind(const v8::Arguments& args);
   static v8::Handle<v8::Value> Listen(const v8::Arguments& args);
   static v8::Handle<v8::Value> Connect(const v8::Arguments& args);
   static v8::Handle<v8::Value> Open(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetFraming(const v8::Arguments& args);
+  static v8::Handle<v8::Value> CollectStart(const v8::Arguments& args);
+  static v8::Handle<v8::Value> CollectStop(const v8::Arguments& args);
+
+  bool OnReadData(v8::Local<v8::Value> slab,
+                  size_t offset,
+                  size_t nread,
+                  v8::Local<v8::Value> pending);
+  bool ReserveFrame(size_t size);
+  void FramingError(int code);
+  void OnReadEnd();
+  void Collect(const char* data, size_t len);
+  v8::Local<v8::Value> TakeCollected();
 
   static void OnConnection(uv_stream_t* handle, int status);
   static void AfterConnect(uv_connect_t* req, int status);
 
   uv_pipe_t handle_;
+
+  // Length-prefixed framing, see SetFraming(). frame_ holds the frame that
+  // is still being received, header included.
+  bool framing_;
+  char* frame_;
+  size_t frame_len_;
+  size_t frame_size_;
+  // A handle that came with a read that did not complete a frame yet.
+  v8::Persistent<v8::Value> frame_handle_;
+
+  // Collected input, see CollectStart(). collect_max_ is 0 for no limit.
+  bool collecting_;
+  bool collect_overflow_;
+  char* collect_;
+  size_t collect_len_;
+  size_t collect_size_;
+  size_t collect_max_;
 };
 
 
@@ -26,6 +26,10 @@
 
 namespace node {
 
+// GetCPUTimes() stores the user, nice, sys, idle and irq milliseconds of
+// every CPU, in this order.
+#define CPU_TIMES_FIELDS 5
+
 class Platform {
  public:
   static char** SetupArgs(int argc, char *argv[]);
@@ -34,6 +38,12 @@ class Platform {
 
   static int GetMemory(size_t *rss);
   static int GetCPUInfo(v8::Local<v8::Array> *cpus);
+  // Fills in the times of at most count CPUs and returns how many there
+  // are, or -1 where there is no cheaper way than GetCPUInfo().
+  static int GetCPUTimes(double *times, int count);
+  // Hands memory that malloc keeps free back to the OS, where the
+  // allocator has a way to.
+  static void TrimHeap();
   static double GetUptime(bool adjusted = false)
   {
     return adjusted ? GetUptimeImpl() - prog_start_time : GetUptimeImpl();
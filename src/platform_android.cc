@@ -254,6 +254,15 @@ int Platform::GetCPUInfo(Local<Array> *cpus) {
   return 0;
 }
 
+int Platform::GetCPUTimes(double *times, int count) {
+  // Not implemented
+  return -1;
+}
+
+void Platform::TrimHeap() {
+  // Not implemented
+}
+
 double Platform::GetUptimeImpl() {
 #if HAVE_MONOTONIC_CLOCK
   struct timespec now;
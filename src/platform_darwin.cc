@@ -38,6 +38,8 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <ifaddrs.h>
+#include <malloc/malloc.h>
+#include <AvailabilityMacros.h>
 
 
 
@@ -139,6 +141,17 @@ int Platform::GetCPUInfo(Local<Array> *cpus) {
   return 0;
 }
 
+int Platform::GetCPUTimes(double *times, int count) {
+  // Not implemented
+  return -1;
+}
+
+void Platform::TrimHeap() {
+#if MAC_OS_X_VERSION_MAX_ALLOWED >= 1070
+  malloc_zone_pressure_relief(NULL, 0);
+#endif
+}
+
 double Platform::GetUptimeImpl() {
   time_t now;
   struct timeval info;
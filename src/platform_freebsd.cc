@@ -153,6 +153,15 @@ int Platform::GetCPUInfo(Local<Array> *cpus) {
   return 0;
 }
 
+int Platform::GetCPUTimes(double *times, int count) {
+  // Not implemented
+  return -1;
+}
+
+void Platform::TrimHeap() {
+  // Not implemented
+}
+
 double Platform::GetUptimeImpl() {
   time_t now;
   struct timeval info;
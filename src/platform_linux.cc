@@ -44,6 +44,15 @@
 
 #include <time.h>
 
+/* GetMemory, GetCPUInfo, GetCPUTimes */
+#include <fcntl.h>
+#include <pthread.h>
+
+/* TrimHeap */
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+
 #ifndef CLOCK_MONOTONIC
 # include <sys/sysinfo.h>
 #endif
@@ -54,7 +63,6 @@ namespace node {
 
 using namespace v8;
 
-static char buf[MAXPATHLEN + 1];
 double Platform::prog_start_time = Platform::GetUptime();
 
 static struct {
@@ -127,110 +135,58 @@ const char* Platform::GetProcessTitle(int *len) {
 }
 
 
+// /proc/self/statm stays open, so that sampling the resident set size is a
+// single pread().
+static pthread_once_t statm_once = PTHREAD_ONCE_INIT;
+static int statm_fd = -1;
+
+static void OpenStatm() {
+  statm_fd = open("/proc/self/statm", O_RDONLY);
+  if (statm_fd != -1) fcntl(statm_fd, F_SETFD, FD_CLOEXEC);
+}
+
 int Platform::GetMemory(size_t *rss) {
-  FILE *f = fopen("/proc/self/stat", "r");
-  if (!f) return -1;
-
-  int itmp;
-  char ctmp;
-  size_t page_size = getpagesize();
-  char *cbuf;
-  bool foundExeEnd;
-
-  /* PID */
-  if (fscanf(f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* Exec file */
-  cbuf = buf;
-  foundExeEnd = false;
-  if (fscanf (f, "%c", cbuf++) == 0) goto error; // (
-  while (1) {
-    if (fscanf(f, "%c", cbuf) == 0) goto error;
-    if (*cbuf == ')') {
-      foundExeEnd = true;
-    } else if (foundExeEnd && *cbuf == ' ') {
-      *cbuf = 0;
-      break;
-    }
+  char statm[256];
+  ssize_t r;
 
-    cbuf++;
-  }
-  /* State */
-  if (fscanf (f, "%c ", &ctmp) == 0) goto error; /* coverity[secure_coding] */
-  /* Parent process */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* Process group */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* Session id */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* TTY */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* TTY owner process group */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* Flags */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* Minor faults (no memory page) */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* Minor faults, children */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* Major faults (memory page faults) */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* Major faults, children */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* utime */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* stime */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* utime, children */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* stime, children */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* jiffies remaining in current time slice */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* 'nice' value */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* jiffies until next timeout */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* jiffies until next SIGALRM */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* start time (jiffies since system boot) */
-  if (fscanf (f, "%d ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-
-  /* Virtual memory size */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-
-  /* Resident set size */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  *rss = (size_t) itmp * page_size;
-
-  /* rlim */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* Start of text */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* End of text */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-  /* Start of stack */
-  if (fscanf (f, "%u ", &itmp) == 0) goto error; /* coverity[secure_coding] */
-
-  fclose (f);
+  pthread_once(&statm_once, OpenStatm);
+  if (statm_fd == -1) return -1;
+
+  do {
+    r = pread(statm_fd, statm, sizeof(statm) - 1, 0);
+  } while (r == -1 && errno == EINTR);
+  if (r <= 0) return -1;
+  statm[r] = 0;
+
+  /* size resident shared text lib data dt, in pages */
+  char *p = statm;
+  strtoul(p, &p, 10);
+  *rss = (size_t) strtoul(p, NULL, 10) * getpagesize();
 
   return 0;
+}
 
-error:
-  fclose (f);
-  return -1;
+
+void Platform::TrimHeap() {
+#ifdef __GLIBC__
+  // Also gives back free pages in the middle of the heap, not only at its
+  // top, and trims the arenas of other threads.
+  malloc_trim(0);
+#endif
 }
 
 
-int Platform::GetCPUInfo(Local<Array> *cpus) {
-  HandleScope scope;
-  Local<Object> cpuinfo;
-  Local<Object> cputimes;
-  unsigned int ticks = (unsigned int)sysconf(_SC_CLK_TCK),
-               multiplier = ((uint64_t)1000L / ticks), cpuspeed;
-  int numcpus = 0, i = 0;
-  unsigned long long ticks_user, ticks_sys, ticks_idle, ticks_nice, ticks_intr;
-  char line[512], speedPath[256], model[512];
-  FILE *fpStat = fopen("/proc/stat", "r");
+// The model and speed of the CPUs do not change while we run, so
+// /proc/cpuinfo and sysfs are only read the first time they are asked for.
+static pthread_once_t cpu_models_once = PTHREAD_ONCE_INIT;
+static char cpu_model[512];
+static int cpu_speed_count;
+static unsigned int* cpu_speeds;
+
+static void ReadCPUModels() {
+  char line[512], speedPath[256];
+  unsigned int cpuspeed = 0;
+  int numcpus = 0;
   FILE *fpModel = fopen("/proc/cpuinfo", "r");
   FILE *fpSpeed;
 
@@ -240,8 +196,8 @@ int Platform::GetCPUInfo(Local<Array> *cpus) {
         numcpus++;
         if (numcpus == 1) {
           char *p = strchr(line, ':') + 2;
-          strcpy(model, p);
-          model[strlen(model)-1] = 0;
+          strcpy(cpu_model, p);
+          cpu_model[strlen(cpu_model)-1] = 0;
         }
       } else if (strncmp(line, "cpu MHz", 7) == 0) {
         if (numcpus == 1) {
@@ -252,48 +208,145 @@ int Platform::GetCPUInfo(Local<Array> *cpus) {
     fclose(fpModel);
   }
 
-  *cpus = Array::New(numcpus);
+  // A CPU without cpufreq gets the speed of the one before it.
+  long count = sysconf(_SC_NPROCESSORS_CONF);
+  cpu_speed_count = count > 0 ? count : 0;
+  cpu_speeds = new unsigned int[cpu_speed_count + 1];
+  for (int i = 0; i < cpu_speed_count; i++) {
+    snprintf(speedPath, sizeof(speedPath),
+             "/sys/devices/system/cpu/cpu%u/cpufreq/cpuinfo_max_freq", i);
 
-  if (fpStat) {
-    while (fgets(line, 511, fpStat) != NULL) {
-      if (strncmp(line, "cpu ", 4) == 0) {
-        continue;
-      } else if (strncmp(line, "cpu", 3) != 0) {
-        break;
+    fpSpeed = fopen(speedPath, "r");
+
+    if (fpSpeed) {
+      if (fgets(line, 511, fpSpeed) != NULL) {
+        sscanf(line, "%u", &cpuspeed);
+        cpuspeed /= 1000;
       }
+      fclose(fpSpeed);
+    }
 
-      sscanf(line, "%*s %llu %llu %llu %llu %*llu %llu",
-             &ticks_user, &ticks_nice, &ticks_sys, &ticks_idle, &ticks_intr);
-      snprintf(speedPath, sizeof(speedPath),
-               "/sys/devices/system/cpu/cpu%u/cpufreq/cpuinfo_max_freq", i);
+    cpu_speeds[i] = cpuspeed;
+  }
+  cpu_speeds[cpu_speed_count] = cpuspeed;
+}
 
-      fpSpeed = fopen(speedPath, "r");
 
-      if (fpSpeed) {
-        if (fgets(line, 511, fpSpeed) != NULL) {
-          sscanf(line, "%u", &cpuspeed);
-          cpuspeed /= 1000;
-        }
-        fclose(fpSpeed);
+int Platform::GetCPUTimes(double *times, int count) {
+  unsigned int ticks = (unsigned int)sysconf(_SC_CLK_TCK),
+               multiplier = ((uint64_t)1000L / ticks);
+
+  // The lines of the CPUs come first; one read normally gets all of them.
+  char stackbuf[16384];
+  char *data = stackbuf;
+  size_t size = sizeof(stackbuf), length = 0;
+
+  int fd = open("/proc/stat", O_RDONLY);
+  if (fd == -1) return -1;
+
+  for (;;) {
+    if (length == size - 1) {
+      size *= 2;
+      char *grown = static_cast<char*>(
+          data == stackbuf ? malloc(size) : realloc(data, size));
+      if (grown == NULL) break;
+      if (data == stackbuf) memcpy(grown, stackbuf, length);
+      data = grown;
+    }
+    ssize_t r = read(fd, data + length, size - 1 - length);
+    if (r == -1 && errno == EINTR) continue;
+    if (r <= 0) break;
+    length += r;
+    // Done once a line other than a CPU's has begun.
+    char *last = static_cast<char*>(memrchr(data, '\n', length));
+    if (last && last - data + 4 < static_cast<ssize_t>(length) &&
+        strncmp(last + 1, "cpu", 3) != 0) {
+      break;
+    }
+  }
+  close(fd);
+  data[length] = 0;
+
+  int numcpus = 0;
+  char *line = data;
+  while (*line) {
+    char *end = strchr(line, '\n');
+    if (strncmp(line, "cpu", 3) != 0) break;
+
+    if (line[3] >= '0' && line[3] <= '9') {
+      // cpuN user nice sys idle iowait irq
+      char *p = line + 3;
+      strtoul(p, &p, 10);
+      unsigned long long user = strtoull(p, &p, 10);
+      unsigned long long nice = strtoull(p, &p, 10);
+      unsigned long long sys = strtoull(p, &p, 10);
+      unsigned long long idle = strtoull(p, &p, 10);
+      strtoull(p, &p, 10);
+      unsigned long long irq = strtoull(p, &p, 10);
+
+      if (numcpus < count) {
+        double *out = times + numcpus * CPU_TIMES_FIELDS;
+        out[0] = user * multiplier;
+        out[1] = nice * multiplier;
+        out[2] = sys * multiplier;
+        out[3] = idle * multiplier;
+        out[4] = irq * multiplier;
       }
+      numcpus++;
+    }
+
+    if (end == NULL) break;
+    line = end + 1;
+  }
 
-      cpuinfo = Object::New();
-      cputimes = Object::New();
-      cputimes->Set(String::New("user"), Number::New(ticks_user * multiplier));
-      cputimes->Set(String::New("nice"), Number::New(ticks_nice * multiplier));
-      cputimes->Set(String::New("sys"), Number::New(ticks_sys * multiplier));
-      cputimes->Set(String::New("idle"), Number::New(ticks_idle * multiplier));
-      cputimes->Set(String::New("irq"), Number::New(ticks_intr * multiplier));
+  if (data != stackbuf) free(data);
 
-      cpuinfo->Set(String::New("model"), String::New(model));
-      cpuinfo->Set(String::New("speed"), Number::New(cpuspeed));
+  return numcpus;
+}
 
-      cpuinfo->Set(String::New("times"), cputimes);
-      (*cpus)->Set(i++, cpuinfo);
-    }
-    fclose(fpStat);
+
+int Platform::GetCPUInfo(Local<Array> *cpus) {
+  HandleScope scope;
+  Local<Object> cpuinfo;
+  Local<Object> cputimes;
+  double stacktimes[64 * CPU_TIMES_FIELDS];
+  double *times = stacktimes;
+  int numcpus;
+
+  pthread_once(&cpu_models_once, ReadCPUModels);
+
+  numcpus = GetCPUTimes(times, 64);
+  if (numcpus > 64) {
+    times = new double[numcpus * CPU_TIMES_FIELDS];
+    numcpus = GetCPUTimes(times, numcpus);
+  }
+  if (numcpus < 0) numcpus = 0;
+
+  *cpus = Array::New(numcpus);
+
+  Local<String> model = String::New(cpu_model);
+  for (int i = 0; i < numcpus; i++) {
+    double *t = times + i * CPU_TIMES_FIELDS;
+    unsigned int cpuspeed =
+        cpu_speeds[i < cpu_speed_count ? i : cpu_speed_count];
+
+    cpuinfo = Object::New();
+    cputimes = Object::New();
+    cputimes->Set(String::New("user"), Number::New(t[0]));
+    cputimes->Set(String::New("nice"), Number::New(t[1]));
+    cputimes->Set(String::New("sys"), Number::New(t[2]));
+    cputimes->Set(String::New("idle"), Number::New(t[3]));
+    cputimes->Set(String::New("irq"), Number::New(t[4]));
+
+    cpuinfo->Set(String::New("model"), model);
+    cpuinfo->Set(String::New("speed"), Number::New(cpuspeed));
+
+    cpuinfo->Set(String::New("times"), cputimes);
+    (*cpus)->Set(i, cpuinfo);
   }
 
+  if (times != stacktimes) delete[] times;
+
   return 0;
 }
 
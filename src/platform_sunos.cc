@@ -205,6 +205,17 @@ int Platform::GetCPUInfo(Local<Array> *cpus) {
 }
 
 
+int Platform::GetCPUTimes(double *times, int count) {
+  // Not implemented
+  return -1;
+}
+
+
+void Platform::TrimHeap() {
+  // Not implemented
+}
+
+
 double Platform::GetUptimeImpl() {
   kstat_ctl_t   *kc;
   kstat_t       *ksp;
@@ -27,6 +27,7 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <malloc.h> // _heapmin
 #if defined(__MINGW32__)
 #include <sys/param.h> // for MAXPATHLEN
 #include <unistd.h> // getpagesize
@@ -277,6 +278,17 @@ int Platform::GetCPUInfo(Local<Array> *cpus) {
 }
 
 
+int Platform::GetCPUTimes(double *times, int count) {
+  // Not implemented
+  return -1;
+}
+
+
+void Platform::TrimHeap() {
+  _heapmin();
+}
+
+
 double Platform::GetUptimeImpl() {
   return (double)GetTickCount()/1000.0;
 }
@@ -24,6 +24,9 @@
 #include <pipe_wrap.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef __POSIX__
+# include <unistd.h>
+#endif
 
 #define UNWRAP \
   assert(!args.Holder().IsEmpty()); \
@@ -69,6 +72,9 @@ class ProcessWrap : public HandleWrap {
     NODE_SET_PROTOTYPE_METHOD(constructor, "close", HandleWrap::Close);
 
     NODE_SET_PROTOTYPE_METHOD(constructor, "spawn", Spawn);
+#ifdef __POSIX__
+    NODE_SET_PROTOTYPE_METHOD(constructor, "fork", Fork);
+#endif
     NODE_SET_PROTOTYPE_METHOD(constructor, "kill", Kill);
 
     target->Set(String::NewSymbol("Process"), constructor->GetFunction());
@@ -97,6 +103,11 @@ class ProcessWrap : public HandleWrap {
   static void *IsolateMain(uv_thread_shared_t *hnd, void *thread_arg) {
     node::Isolate *isolate = static_cast<node::Isolate *>(thread_arg);
     isolate->Start(hnd);
+    // kill() from the parent must not reach the instance once it is being
+    // torn down; IsolateStop() runs under the same lock
+    pthread_mutex_lock(&hnd->mtx);
+    hnd->thread_arg = NULL;
+    pthread_mutex_unlock(&hnd->mtx);
     hnd->exit_status = isolate->exit_status;
     hnd->term_signal = isolate->term_signal;
     isolate->Dispose();
@@ -199,7 +210,10 @@ class ProcessWrap : public HandleWrap {
     // options.fork
     Local<Value> fork_v = js_options->Get(String::New("fork"));    
     if (fork_v->IsBoolean() && fork_v->BooleanValue()) {
-      Isolate *isolate = node::Isolate::New();
+      // Take a prepared instance if there's a pool, and top it up again
+      IsolatePool *pool = IsolatePool::GetDefault();
+      Isolate *isolate = pool ? pool->Take() : node::Isolate::New();
+      if (pool) IsolatePool::FillDefault(Isolate::GetCurrentLoop());
       if(!isolate) {
         r = UV_ENOMEM;
       } else {
@@ -239,6 +253,45 @@ class ProcessWrap : public HandleWrap {
     return scope.Close(Integer::New(r));
   }
 
+#ifdef __POSIX__
+  // fork([channel])
+  //
+  // Forks this process, which goes on running the same JavaScript in the
+  // child; see uv_fork(). Returns the child's pid, which is also set as
+  // `pid`, 0 in the child and -1 on error. `channel`, an IPC pipe that isn't
+  // open yet, is connected to the other process on either side.
+  static Handle<Value> Fork(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    uv_pipe_t* channel = NULL;
+    if (args[0]->IsObject()) {
+      channel = PipeWrap::Unwrap(args[0]->ToObject())->UVHandle();
+    }
+
+    int r = uv_fork(Isolate::GetCurrentLoop(), &wrap->process_, OnExit,
+                    channel);
+
+    wrap->SetHandle((uv_handle_t*)&wrap->process_);
+    assert(wrap->process_.data == wrap);
+
+    if (r == -1) {
+      SetLastErrno();
+    } else if (r == 0) {
+      // There is no process to watch or kill on this side.
+      wrap->is_exited_ = true;
+      Local<Object> process = Context::GetCurrent()->Global()->Get(
+          String::NewSymbol("process"))->ToObject();
+      process->Set(String::NewSymbol("pid"), Integer::New(getpid()));
+    } else {
+      wrap->object_->Set(String::New("pid"), Integer::New(r));
+    }
+
+    return scope.Close(Integer::New(r));
+  }
+#endif
+
   static Handle<Value> Kill(const Arguments& args) {
     HandleScope scope;
 
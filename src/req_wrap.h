@@ -28,16 +28,50 @@ template <typename T>
 class ReqWrap {
  public:
   ReqWrap() {
-    v8::HandleScope scope;
-    object_ = v8::Persistent<v8::Object>::New(v8::Object::New());
+    Isolate* isolate = Isolate::GetCurrent();
+    if (isolate->req_wrap_pool_count > 0) {
+      int i = --isolate->req_wrap_pool_count;
+      object_ = isolate->req_wrap_pool[i];
+      isolate->req_wrap_pool[i].Clear();
+      isolate->req_wrap_pool_hits++;
+    } else {
+      v8::HandleScope scope;
+      object_ = v8::Persistent<v8::Object>::New(v8::Object::New());
+      isolate->req_wrap_pool_misses++;
+    }
+    data_ = NULL;
+    isolate->req_wraps++;
+
+    async_context_ = 0;
+    if (isolate->async_tracking && isolate->async_context) {
+      v8::HandleScope scope;
+      async_context_ = isolate->async_context;
+      async_start_ = uv_hrtime();
+      object_->SetHiddenValue(
+          isolate->async_context_sym,
+          v8::Integer::NewFromUnsigned(async_context_));
+    }
   }
 
   ~ReqWrap() {
     // Assert that someone has called Dispatched()
     assert(req_.data == this);
     assert(!object_.IsEmpty());
-    object_.Dispose();
+    Isolate* isolate = Isolate::GetCurrent();
+    if (async_context_) {
+      isolate->__RecordAsync(async_context_, req_.type,
+                             async_start_, uv_hrtime());
+      object_->DeleteHiddenValue(isolate->async_context_sym);
+    }
+    if (isolate->req_wrap_pool_count < REQ_WRAP_POOL_SIZE) {
+      Reset();
+      isolate->req_wrap_pool[isolate->req_wrap_pool_count++] = object_;
+    } else {
+      object_.Dispose();
+      isolate->req_wrap_pool_drops++;
+    }
     object_.Clear();
+    isolate->req_wraps--;
   }
 
   // Call this after the req has been dispatched.
@@ -45,9 +79,36 @@ class ReqWrap {
     req_.data = this;
   }
 
+  // Keeps `value`, such as the buffer being written, alive as long as the
+  // request, out of sight of javascript. `key` must be a persistent symbol.
+  void Hold(v8::Handle<v8::String> key, v8::Handle<v8::Value> value) {
+    object_->SetHiddenValue(key, value);
+    held_ = key;
+  }
+
   v8::Persistent<v8::Object> object_;
   T req_;
   void* data_;
+
+ private:
+  // Drops what javascript and Hold() left on the object before it goes
+  // back to the pool. The properties stay, set to undefined, so that the
+  // object keeps its hidden class and the next `req.oncomplete = ...` in
+  // lib/ finds it in its inline cache.
+  void Reset() {
+    v8::HandleScope scope;
+    if (!held_.IsEmpty()) object_->DeleteHiddenValue(held_);
+    v8::Local<v8::Array> names = object_->GetOwnPropertyNames();
+    for (uint32_t i = 0; i < names->Length(); i++) {
+      object_->Set(names->Get(i), v8::Undefined());
+    }
+  }
+
+  v8::Handle<v8::String> held_;
+  // The context the request was made in, and when; see
+  // Isolate::async_tracking.
+  uint32_t async_context_;
+  uint64_t async_start_;
 };
 
 
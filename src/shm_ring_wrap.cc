@@ -0,0 +1,514 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+
+#include <node.h>
+#include <node_buffer.h>
+#include <handle_wrap.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define UNWRAP \
+  assert(!args.Holder().IsEmpty()); \
+  assert(args.Holder()->InternalFieldCount() > 0); \
+  ShmRingWrap* wrap = static_cast<ShmRingWrap*>( \
+      args.Holder()->GetPointerFromInternalField(0)); \
+  if (!wrap) { \
+    uv_err_t err; \
+    err.code = UV_EBADF; \
+    SetErrno(err); \
+    return scope.Close(Integer::New(-1)); \
+  }
+
+#define RING_MAGIC 0x52494e47  // "RING"
+#define RING_MIN_SIZE 4096
+#define RING_MAX_SIZE (1 << 30)
+
+// Length word that tells the reader to go back to the start of the ring.
+#define RING_SKIP 0xffffffff
+
+// Upper bound on the messages handed to javascript in one onmessages call.
+#define RING_BATCH 1024
+
+namespace node {
+
+using v8::Object;
+using v8::Handle;
+using v8::Local;
+using v8::Persistent;
+using v8::Value;
+using v8::HandleScope;
+using v8::FunctionTemplate;
+using v8::String;
+using v8::Array;
+using v8::Integer;
+using v8::Arguments;
+using v8::ThrowException;
+
+
+// A ring is a single producer, single consumer queue in a file that both
+// processes map, normally on tmpfs. Messages are a 4 byte length and the
+// payload, padded to 4 bytes. A message never wraps: when it does not fit
+// before the end of the ring the producer writes RING_SKIP and starts over
+// at offset 0, so the reader can hand out slices of the mapping.
+//
+// head and tail are free running byte counters, written only by the
+// producer and the consumer respectively. A consumer that has drained the
+// ring sets `sleeping` and waits on the doorbell, a FIFO next to the ring
+// file; a producer that finds `sleeping` set clears it and writes one byte
+// to the FIFO. Both sides issue a full barrier between their store and the
+// load of the other's field, so a wakeup cannot be lost.
+
+struct RingHeader {
+  uint32_t magic;
+  uint32_t size;
+  char pad0[56];
+  volatile uint32_t head;
+  char pad1[60];
+  volatile uint32_t tail;
+  volatile uint32_t sleeping;
+  char pad2[56];
+};
+
+
+// The mapping outlives the wrap while javascript holds the view buffer.
+struct RingMapping {
+  char* base;
+  size_t length;
+  int refs;
+};
+
+
+static void ReleaseMapping(char* data, void* hint) {
+  RingMapping* mapping = static_cast<RingMapping*>(hint);
+  if (--mapping->refs == 0) {
+    munmap(mapping->base, mapping->length);
+    delete mapping;
+  }
+}
+
+
+static inline uint32_t Align4(uint32_t n) {
+  return (n + 3) & ~3;
+}
+
+
+class ShmRingWrap : public HandleWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    HandleWrap::Initialize(target);
+
+    Local<FunctionTemplate> constructor = FunctionTemplate::New(New);
+    constructor->InstanceTemplate()->SetInternalFieldCount(1);
+    constructor->SetClassName(String::NewSymbol("ShmRing"));
+
+    NODE_SET_PROTOTYPE_METHOD(constructor, "close", Close);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "ref", HandleWrap::Ref);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "unref", HandleWrap::Unref);
+
+    NODE_SET_PROTOTYPE_METHOD(constructor, "open", Open);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "unlink", Unlink);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "write", Write);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "readStart", ReadStart);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "readStop", ReadStop);
+
+    target->Set(String::NewSymbol("ShmRing"), constructor->GetFunction());
+  }
+
+ private:
+  static Handle<Value> New(const Arguments& args) {
+    // This constructor should not be exposed to public javascript.
+    // Therefore we assert that we are not trying to call this as a
+    // normal function.
+    assert(args.IsConstructCall());
+
+    HandleScope scope;
+    ShmRingWrap* wrap = new ShmRingWrap(args.This());
+    assert(wrap);
+
+    return scope.Close(args.This());
+  }
+
+  ShmRingWrap(Handle<Object> object)
+      : HandleWrap(object, (uv_handle_t*) &handle_),
+        mapping_(NULL),
+        header_(NULL),
+        data_(NULL),
+        mask_(0),
+        bell_fd_(-1),
+        reading_(false),
+        active_(false) {
+    int r = uv_pipe_init(Isolate::GetCurrentLoop(), &handle_, 0);
+    assert(r == 0);
+    handle_.data = this;
+  }
+
+  ~ShmRingWrap() {
+    // A reader's doorbell belongs to handle_ and is closed with it.
+    if (!reading_ && bell_fd_ != -1) close(bell_fd_);
+    if (mapping_) ReleaseMapping(NULL, mapping_);
+  }
+
+  static Handle<Value> Close(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    wrap->active_ = false;
+
+    return HandleWrap::Close(args);
+  }
+
+  // open(path, size, create). The creator sizes and initializes the ring
+  // and makes the doorbell FIFO, path + ".bell". size is rounded up to a
+  // power of two. Sets this.buffer to a Buffer over the message area.
+  static Handle<Value> Open(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    assert(wrap->mapping_ == NULL);
+
+    String::Utf8Value path(args[0]);
+    uint32_t size = args[1]->Uint32Value();
+    bool create = args[2]->IsTrue();
+
+    uint32_t ring_size = RING_MIN_SIZE;
+    while (ring_size < size && ring_size < RING_MAX_SIZE) ring_size <<= 1;
+
+    std::string bell_path(*path);
+    bell_path += ".bell";
+
+    int flags = create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR;
+    int fd = open(*path, flags, 0600);
+    if (fd == -1) {
+      return ThrowException(ErrnoException(errno, "open", "", *path));
+    }
+
+    if (create) {
+      if (ftruncate(fd, sizeof(RingHeader) + ring_size) == -1) {
+        int err = errno;
+        close(fd);
+        unlink(*path);
+        return ThrowException(ErrnoException(err, "ftruncate", "", *path));
+      }
+      if (mkfifo(bell_path.c_str(), 0600) == -1) {
+        int err = errno;
+        close(fd);
+        unlink(*path);
+        return ThrowException(ErrnoException(err, "mkfifo", "",
+                                             bell_path.c_str()));
+      }
+    } else {
+      struct stat s;
+      if (fstat(fd, &s) == -1 || s.st_size < (off_t) sizeof(RingHeader)) {
+        close(fd);
+        return ThrowException(ErrnoException(EINVAL, "open", "", *path));
+      }
+      ring_size = s.st_size - sizeof(RingHeader);
+    }
+
+    size_t length = sizeof(RingHeader) + ring_size;
+    void* base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int err = errno;
+    close(fd);
+    if (base == MAP_FAILED) {
+      return ThrowException(ErrnoException(err, "mmap", "", *path));
+    }
+
+    RingHeader* header = static_cast<RingHeader*>(base);
+    if (create) {
+      header->size = ring_size;
+      header->head = 0;
+      header->tail = 0;
+      header->sleeping = 0;
+      __sync_synchronize();
+      header->magic = RING_MAGIC;
+    } else if (header->magic != RING_MAGIC || header->size != ring_size ||
+               (ring_size & (ring_size - 1)) != 0) {
+      munmap(base, length);
+      return ThrowException(ErrnoException(EINVAL, "open", "", *path));
+    }
+
+    // O_RDWR keeps a FIFO open without waiting for the other side, and
+    // keeps the reader from seeing EOF while no producer has it open.
+    wrap->bell_fd_ = open(bell_path.c_str(), O_RDWR | O_NONBLOCK);
+    if (wrap->bell_fd_ == -1) {
+      err = errno;
+      munmap(base, length);
+      return ThrowException(ErrnoException(err, "open", "",
+                                           bell_path.c_str()));
+    }
+
+    wrap->mapping_ = new RingMapping;
+    wrap->mapping_->base = static_cast<char*>(base);
+    wrap->mapping_->length = length;
+    wrap->mapping_->refs = 2;
+    wrap->header_ = header;
+    wrap->data_ = wrap->mapping_->base + sizeof(RingHeader);
+    wrap->mask_ = ring_size - 1;
+
+    Buffer* view = Buffer::New(wrap->data_, ring_size, ReleaseMapping,
+                               wrap->mapping_);
+    wrap->object_->Set(String::NewSymbol("buffer"), view->handle_);
+
+    return scope.Close(Integer::New(0));
+  }
+
+  // unlink(path) removes the ring file and its doorbell. Both sides keep
+  // working once they have opened the ring.
+  static Handle<Value> Unlink(const Arguments& args) {
+    HandleScope scope;
+
+    String::Utf8Value path(args[0]);
+    std::string bell_path(*path);
+    bell_path += ".bell";
+
+    unlink(*path);
+    unlink(bell_path.c_str());
+
+    return scope.Close(Integer::New(0));
+  }
+
+  // write(buffer, offset, length). Returns -1 and sets errno to EAGAIN when
+  // the ring has no room for the message right now, or to EMSGSIZE when it
+  // never will.
+  static Handle<Value> Write(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    if (!wrap->header_) {
+      uv_err_t err;
+      err.code = UV_EBADF;
+      SetErrno(err);
+      return scope.Close(Integer::New(-1));
+    }
+
+    Local<Object> obj = args[0]->ToObject();
+    assert(Buffer::HasInstance(obj));
+    size_t offset = args[1]->Uint32Value();
+    size_t length = args[2]->Uint32Value();
+    assert(offset + length <= Buffer::Length(obj));
+
+    uv_err_code code = wrap->Push(Buffer::Data(obj) + offset, length);
+    if (code != UV_OK) {
+      uv_err_t err;
+      err.code = code;
+      SetErrno(err);
+      return scope.Close(Integer::New(-1));
+    }
+
+    return scope.Close(Integer::New(0));
+  }
+
+  uv_err_code Push(const char* message, size_t length) {
+    uint32_t size = mask_ + 1;
+    uint32_t need = 4 + Align4(length);
+    if (length >= RING_SKIP || need > size) return UV_EMSGSIZE;
+
+    uint32_t head = header_->head;
+    uint32_t tail = header_->tail;
+    uint32_t pos = head & mask_;
+
+    if (size - pos < need) {
+      // Give the rest of the ring to the reader first; the message then
+      // goes at offset 0 once there is room there.
+      if (size - (head - tail) < size - pos) return UV_EAGAIN;
+      *reinterpret_cast<uint32_t*>(data_ + pos) = RING_SKIP;
+      head += size - pos;
+      pos = 0;
+      __sync_synchronize();
+      header_->head = head;
+    }
+
+    if (size - (head - tail) < need) {
+      tail = header_->tail;
+      if (size - (head - tail) < need) {
+        Ring();
+        return UV_EAGAIN;
+      }
+    }
+
+    *reinterpret_cast<uint32_t*>(data_ + pos) = length;
+    memcpy(data_ + pos + 4, message, length);
+    __sync_synchronize();
+    header_->head = head + need;
+
+    Ring();
+    return UV_OK;
+  }
+
+  // Producer. Wakes the consumer if it went to sleep.
+  void Ring() {
+    __sync_synchronize();
+    if (header_->sleeping && __sync_lock_test_and_set(&header_->sleeping, 0)) {
+      char c = 0;
+      // A full FIFO has a wakeup pending already.
+      while (write(bell_fd_, &c, 1) == -1 && errno == EINTR);
+    }
+  }
+
+  static Handle<Value> ReadStart(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    if (!wrap->header_) {
+      uv_err_t err;
+      err.code = UV_EBADF;
+      SetErrno(err);
+      return scope.Close(Integer::New(-1));
+    }
+
+    if (!wrap->reading_) {
+      uv_pipe_open(&wrap->handle_, wrap->bell_fd_);
+      wrap->reading_ = true;
+    }
+
+    int r = uv_read_start((uv_stream_t*) &wrap->handle_, OnAlloc, OnRead);
+    if (r) {
+      SetErrno(uv_last_error(Isolate::GetCurrentLoop()));
+      return scope.Close(Integer::New(r));
+    }
+    wrap->active_ = true;
+
+    // Messages may have arrived before anyone listened for the doorbell.
+    wrap->Drain();
+
+    return scope.Close(Integer::New(0));
+  }
+
+  static Handle<Value> ReadStop(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    int r = 0;
+    wrap->active_ = false;
+    if (wrap->reading_) {
+      r = uv_read_stop((uv_stream_t*) &wrap->handle_);
+      if (r) SetErrno(uv_last_error(Isolate::GetCurrentLoop()));
+    }
+
+    return scope.Close(Integer::New(r));
+  }
+
+  static uv_buf_t OnAlloc(uv_handle_t* handle, size_t suggested_size) {
+    static char bell[64];
+    return uv_buf_init(bell, sizeof bell);
+  }
+
+  static void OnRead(uv_stream_t* handle, ssize_t nread, uv_buf_t buf) {
+    HandleScope scope;
+
+    ShmRingWrap* wrap = static_cast<ShmRingWrap*>(handle->data);
+    assert(wrap);
+
+    // The doorbell is opened read-write, so it never reports EOF.
+    if (nread < 0) {
+      SetErrno(uv_last_error(Isolate::GetCurrentLoop()));
+      MakeCallback(wrap->object_, "onmessages", 0, NULL);
+      return;
+    }
+
+    wrap->Drain();
+  }
+
+  // Consumer. Hands the messages in the ring to onmessages(offsets,
+  // lengths), as slices of this.buffer, then releases their space.
+  void Drain() {
+    uint32_t size = mask_ + 1;
+
+    while (active_) {
+      uint32_t tail = header_->tail;
+      uint32_t head = header_->head;
+
+      if (tail == head) {
+        header_->sleeping = 1;
+        __sync_synchronize();
+        if (header_->head == tail) return;
+        header_->sleeping = 0;
+        continue;
+      }
+
+      __sync_synchronize();
+
+      Local<Array> offsets = Array::New();
+      Local<Array> lengths = Array::New();
+      int count = 0;
+
+      while (tail != head && count < RING_BATCH) {
+        uint32_t pos = tail & mask_;
+        uint32_t length = *reinterpret_cast<uint32_t*>(data_ + pos);
+        if (length == RING_SKIP) {
+          tail += size - pos;
+          continue;
+        }
+        offsets->Set(count, Integer::NewFromUnsigned(pos + 4));
+        lengths->Set(count, Integer::NewFromUnsigned(length));
+        count++;
+        tail += 4 + Align4(length);
+      }
+
+      if (count > 0) {
+        Local<Value> argv[2] = { offsets, lengths };
+        // The callback may stop reading or close the ring; the mapping
+        // stays valid until the wrap is deleted.
+        MakeCallback(object_, "onmessages", 2, argv);
+      }
+
+      __sync_synchronize();
+      header_->tail = tail;
+    }
+  }
+
+  uv_pipe_t handle_;
+  RingMapping* mapping_;
+  RingHeader* header_;
+  char* data_;
+  uint32_t mask_;
+  int bell_fd_;
+  // reading_: handle_ owns the doorbell; active_: between readStart and
+  // readStop or close.
+  bool reading_;
+  bool active_;
+};
+
+
+static void InitShmRingWrap(Handle<Object> target) {
+  ShmRingWrap::Initialize(target);
+}
+
+
+}  // namespace node
+
+NODE_MODULE(node_shm_ring_wrap, node::InitShmRingWrap)
@@ -24,13 +24,44 @@
 #include <handle_wrap.h>
 #include <stream_wrap.h>
 #include <tcp_wrap.h>
+#include <pipe_wrap.h>
+#include <udp_wrap.h>
 #include <req_wrap.h>
 
+#include <stdlib.h> /* abort */
+#include <string.h> /* memcpy */
+
 
 namespace node {
 
 
 #define SLAB_SIZE (1024 * 1024)
+// Handles whose reads stay this small allocate from slabs of the small class,
+// so that the slices they retain don't pin full-size slabs.
+#define SMALL_SLAB_SIZE (64 * 1024)
+#define SMALL_READ_SIZE (4 * 1024)
+// Bounds of the per-handle read size; the upper one is what libuv suggests.
+#define READ_SIZE_MIN 1024
+#define READ_SIZE_MAX (64 * 1024)
+// Number of retired slabs kept around for reuse instead of being freed.
+#define SLAB_POOL_SIZE 8
+// Upper bound on the number of buffers accepted by a single writev() call;
+// matches the smallest IOV_MAX of the platforms we support.
+#define WRITEV_MAX_BUFFERS 1024
+// writev() calls with up to this many buffers don't need a heap allocated
+// uv_buf_t array.
+#define WRITEV_STACK_BUFFERS 16
+// String writes up to this many bytes are encoded into the shared write
+// arena, bigger ones get storage of their own.
+#define WRITE_ARENA_SIZE (64 * 1024)
+#define WRITE_ARENA_MAX (8 * 1024)
+// The idle sweep runs at most this many times per shortest idle timeout, so
+// that a timeout fires no more than that fraction of it late.
+#define IDLE_SWEEP_DIVISOR 8
+// A native pipe reads into chunks of this size and has at most this many
+// of them waiting for the destination.
+#define PIPE_CHUNK_SIZE (64 * 1024)
+#define PIPE_CHUNKS 16
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
 
@@ -47,6 +78,10 @@ using v8::TryCatch;
 using v8::Context;
 using v8::Arguments;
 using v8::Integer;
+using v8::Array;
+using v8::Exception;
+using v8::Number;
+using v8::V8;
 
 
 #define UNWRAP \
@@ -65,45 +100,442 @@ using v8::Integer;
 typedef class ReqWrap<uv_shutdown_t> ShutdownWrap;
 typedef class ReqWrap<uv_write_t> WriteWrap;
 
+
+// Backing memory for string writes. Each write request holds a reference
+// (in WriteWrap::data_) to the arena its bytes live in; once all of them
+// completed the arena is rewound, or freed if a fresh one replaced it in the
+// meantime.
+struct WriteArena {
+  size_t size;
+  size_t used;
+  int refs;
+
+  static WriteArena* New(size_t size) {
+    WriteArena* arena =
+        reinterpret_cast<WriteArena*>(new char[sizeof(WriteArena) + size]);
+    arena->size = size;
+    arena->used = 0;
+    arena->refs = 0;
+    return arena;
+  }
+
+  static void Delete(WriteArena* arena) {
+    delete [] reinterpret_cast<char*>(arena);
+  }
+
+  char* Data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+
+// Resource of a large ASCII string that has been externalized by a write.
+// The string keeps pointing at this memory for the rest of its life, so
+// writing it again doesn't copy at all.
+class ExternalWriteString : public String::ExternalAsciiStringResource {
+ public:
+  ExternalWriteString(char* data, size_t length)
+      : data_(data), length_(length) {
+    V8::AdjustAmountOfExternalAllocatedMemory(length_);
+  }
+
+  ~ExternalWriteString() {
+    delete [] data_;
+    V8::AdjustAmountOfExternalAllocatedMemory(-static_cast<int>(length_));
+  }
+
+  const char* data() const { return data_; }
+  size_t length() const { return length_; }
+
+ private:
+  char* data_;
+  size_t length_;
+};
+
+
+enum SlabClass { SLAB_LARGE, SLAB_SMALL, SLAB_CLASSES };
+
 class StreamStatics : public ModuleStatics {
-    size_t slab_used;
-    uv_stream_t* handle_that_last_alloced;
+    // One current slab per class, kept alive as a hidden value on the
+    // global object under slab_class_sym.
+    size_t slab_used[SLAB_CLASSES];
+    uv_stream_t* handle_that_last_alloced[SLAB_CLASSES];
+    Persistent<String> slab_class_sym[SLAB_CLASSES];
+    bool slab_class_active[SLAB_CLASSES];
     Persistent<String> slab_sym;
+    // Slabs whose Buffer is still alive, current ones included.
+    int slabs_live;
+    // Reads of up to this many bytes are copied out of the slab; see
+    // SetSlabCompaction().
+    size_t compact_read_threshold;
     Persistent<String> buffer_sym;
     Persistent<String> write_queue_size_sym;
-    bool initialized;
+    // The callbacks made on every read and write.
+    Persistent<String> onread_sym;
+    Persistent<String> oncomplete_sym;
+    Persistent<String> ontimeout_sym;
+    Persistent<String> write_blocked_sym;
+    Persistent<String> onwritedrain_sym;
+
+    // Slab memory whose Buffer has been garbage collected. Since every slice
+    // handed to javascript holds a reference to its parent slab, a slab only
+    // lands here once the last slice of it is gone.
+    char* slab_pool[SLAB_POOL_SIZE];
+    int slab_pool_count;
+    // Counters exposed through getSlabPoolStats().
+    double slab_pool_hits;
+    double slab_pool_misses;
+    size_t slab_bytes_resident;
+
+    WriteArena* write_arena;
+
+    // Streams with an idle timeout, checked by one timer for all of them.
+    // idle_wake_at is when idle_timer is due, if idle_timer_armed.
+    StreamWrap* idle_wraps;
+    uv_timer_t* idle_timer;
+    bool idle_timer_armed;
+    int64_t idle_wake_at;
+
     friend class StreamWrap;
-    StreamStatics() {slab_used = 0; initialized = false;}
+    friend char* WriteArenaAlloc(StreamStatics*, size_t, void**);
+    friend void WriteArenaRelease(StreamStatics*, void*);
+    StreamStatics() {
+      write_arena = NULL;
+      idle_wraps = NULL;
+      idle_timer = NULL;
+      idle_timer_armed = false;
+      idle_wake_at = 0;
+      for (int i = 0; i < SLAB_CLASSES; i++) {
+        slab_used[i] = 0;
+        handle_that_last_alloced[i] = NULL;
+        slab_class_active[i] = false;
+      }
+      slabs_live = 0;
+      compact_read_threshold = 0;
+      slab_pool_count = 0;
+      slab_pool_hits = 0;
+      slab_pool_misses = 0;
+      slab_bytes_resident = 0;
+    }
 };
 
-void StreamWrap::Initialize(Handle<Object> target) {
-  NODE_STATICS_NEW(node_stream_wrap, StreamStatics, statics);
-  if (statics->initialized) {
-    return;
+char* WriteArenaAlloc(StreamStatics* statics, size_t size, void** ref) {
+  WriteArena* arena = statics->write_arena;
+
+  if (size > WRITE_ARENA_MAX) {
+    arena = WriteArena::New(size);
+  } else if (arena == NULL || arena->used + size > arena->size) {
+    if (arena != NULL && arena->refs == 0) {
+      arena->used = 0;
+    } else {
+      // The old arena goes away with its last write.
+      arena = WriteArena::New(WRITE_ARENA_SIZE);
+      statics->write_arena = arena;
+    }
+  }
+
+  char* data = arena->Data() + arena->used;
+  arena->used += size;
+  arena->refs++;
+  *ref = arena;
+  return data;
+}
+
+
+void WriteArenaRelease(StreamStatics* statics, void* ref) {
+  WriteArena* arena = static_cast<WriteArena*>(ref);
+
+  if (--arena->refs > 0) return;
+
+  if (arena == statics->write_arena) {
+    arena->used = 0;
   } else {
-    statics->initialized = true;
+    WriteArena::Delete(arena);
   }
+}
 
+
+void StreamWrap::Initialize(Handle<Object> target) {
   HandleScope scope;
 
+  NODE_SET_METHOD(target, "getSlabPoolStats", GetSlabPoolStats);
+  NODE_SET_METHOD(target, "setSlabCompaction", SetSlabCompaction);
+
+  // tcp_wrap, pipe_wrap and tty_wrap all call in here; make sure they share
+  // the same slab and slab pool.
+  if (NODE_STATICS_GET(node_stream_wrap, StreamStatics)) return;
+
+  NODE_STATICS_NEW(node_stream_wrap, StreamStatics, statics);
+
   HandleWrap::Initialize(target);
 
   statics->slab_sym = Persistent<String>::New(String::NewSymbol("slab"));
+  statics->slab_class_sym[SLAB_LARGE] = statics->slab_sym;
+  statics->slab_class_sym[SLAB_SMALL] =
+    Persistent<String>::New(String::NewSymbol("smallSlab"));
   statics->buffer_sym = Persistent<String>::New(String::NewSymbol("buffer"));
   statics->write_queue_size_sym =
     Persistent<String>::New(String::NewSymbol("writeQueueSize"));
+  statics->onread_sym = NODE_PSYMBOL("onread");
+  statics->oncomplete_sym = NODE_PSYMBOL("oncomplete");
+  statics->ontimeout_sym = NODE_PSYMBOL("ontimeout");
+  statics->write_blocked_sym = NODE_PSYMBOL("writeBlocked");
+  statics->onwritedrain_sym = NODE_PSYMBOL("onwritedrain");
 }
 
 
+// Moves data from one stream to another without it going through
+// javascript. Reads land in chunks of the pipe's own and are written out of
+// them as they are; once PIPE_CHUNKS of them wait for the destination the
+// source stops reading until a write completes. The source gets one
+// onpipeend(bytes, onWrite) callback when the pipe is over, with errno set
+// to EOF or to the error that ended it, and onWrite true when the error
+// came from the destination.
+//
+// A stream that goes away while it is piped only detaches itself; the
+// pipe is freed once its writes are done.
+struct PipeChunk {
+  uv_write_t req;
+  StreamPipe* pipe;
+  PipeChunk* next;
+  char data[PIPE_CHUNK_SIZE];
+};
+
+
+class StreamPipe {
+ public:
+  StreamPipe(StreamWrap* src, StreamWrap* dst)
+      : src_(src),
+        dst_(dst),
+        free_(NULL),
+        chunks_(0),
+        writes_(0),
+        bytes_(0),
+        reading_(false),
+        paused_(false),
+        done_(false),
+        on_write_(false) {
+    src_obj_ = Persistent<Object>::New(src->object_);
+    src->pipe_ = this;
+    dst->pipe_dest_ = this;
+    error_.code = UV_OK;
+  }
+
+  ~StreamPipe() {
+    while (free_) {
+      PipeChunk* chunk = free_;
+      free_ = chunk->next;
+      delete chunk;
+    }
+    src_obj_.Dispose();
+  }
+
+  int Start() {
+    // Whatever javascript was reading is taken over.
+    uv_read_stop(src_->stream_);
+    return Read();
+  }
+
+  static int Resume(StreamPipe* pipe) {
+    pipe->paused_ = false;
+    return pipe->Read();
+  }
+
+  static void Pause(StreamPipe* pipe) {
+    pipe->paused_ = true;
+    pipe->reading_ = false;
+  }
+
+  // Called when either stream is deleted. Without a source nobody is told
+  // that the pipe ended.
+  static void Detach(StreamPipe* pipe, StreamWrap* wrap) {
+    bool is_src = wrap == pipe->src_;
+    if (is_src) {
+      pipe->StopReading();
+      pipe->src_ = NULL;
+      wrap->pipe_ = NULL;
+    } else {
+      pipe->dst_ = NULL;
+      wrap->pipe_dest_ = NULL;
+    }
+    pipe->Fail(UV_EINTR, !is_src);
+    pipe->MaybeFinish();
+  }
+
+ private:
+  int Read() {
+    if (reading_ || paused_ || done_ || !src_) return 0;
+    if (chunks_ == PIPE_CHUNKS && free_ == NULL) return 0;
+
+    int r = uv_read_start(src_->stream_, OnAlloc, OnRead);
+    if (r) {
+      SetErrno(uv_last_error(src_->stream_->loop));
+      return r;
+    }
+    reading_ = true;
+    return 0;
+  }
+
+  void StopReading() {
+    if (reading_ && src_) uv_read_stop(src_->stream_);
+    reading_ = false;
+  }
+
+  PipeChunk* TakeChunk() {
+    PipeChunk* chunk = free_;
+    if (chunk) {
+      free_ = chunk->next;
+    } else {
+      chunk = new PipeChunk;
+      chunk->pipe = this;
+      chunks_++;
+    }
+    return chunk;
+  }
+
+  void ReturnChunk(PipeChunk* chunk) {
+    chunk->next = free_;
+    free_ = chunk;
+  }
+
+  // Ends the pipe, unless it ended already. The first reason sticks.
+  void Fail(uv_err_code code, bool on_write) {
+    if (error_.code == UV_OK) {
+      error_.code = code;
+      on_write_ = on_write;
+    }
+    StopReading();
+    done_ = true;
+  }
+
+  void MaybeFinish() {
+    if (!done_ || writes_ > 0) return;
+
+    if (src_) {
+      src_->pipe_ = NULL;
+      if (dst_) dst_->pipe_dest_ = NULL;
+
+      HandleScope scope;
+      SetErrno(error_);
+      Local<Value> argv[2] = {
+        Number::New(static_cast<double>(bytes_)),
+        Local<Value>::New(v8::Boolean::New(on_write_))
+      };
+      MakeCallback(src_obj_, "onpipeend", 2, argv);
+    } else if (dst_) {
+      dst_->pipe_dest_ = NULL;
+    }
+
+    delete this;
+  }
+
+  static uv_buf_t OnAlloc(uv_handle_t* handle, size_t suggested_size) {
+    StreamWrap* wrap = static_cast<StreamWrap*>(handle->data);
+    assert(wrap && wrap->pipe_);
+    PipeChunk* chunk = wrap->pipe_->TakeChunk();
+    return uv_buf_init(chunk->data, PIPE_CHUNK_SIZE);
+  }
+
+  static void OnRead(uv_stream_t* handle, ssize_t nread, uv_buf_t buf) {
+    StreamWrap* wrap = static_cast<StreamWrap*>(handle->data);
+    assert(wrap && wrap->pipe_);
+    StreamPipe* pipe = wrap->pipe_;
+    PipeChunk* chunk = container_of(buf.base, PipeChunk, data);
+
+    if (nread <= 0) {
+      pipe->ReturnChunk(chunk);
+      if (nread < 0) {
+        // EOF, or a read error.
+        pipe->Fail(uv_last_error(handle->loop).code, false);
+        pipe->MaybeFinish();
+      }
+      return;
+    }
+
+    wrap->Touch();
+    pipe->bytes_ += nread;
+
+    if (!pipe->dst_) {
+      pipe->ReturnChunk(chunk);
+      return;
+    }
+
+    uv_buf_t out = uv_buf_init(chunk->data, nread);
+    int r = uv_write(&chunk->req, pipe->dst_->stream_, &out, 1, AfterWrite);
+    if (r) {
+      pipe->ReturnChunk(chunk);
+      pipe->Fail(uv_last_error(handle->loop).code, true);
+      pipe->MaybeFinish();
+      return;
+    }
+
+    pipe->writes_++;
+    pipe->dst_->Touch();
+
+    // Out of chunks: wait for the destination to catch up.
+    if (pipe->free_ == NULL && pipe->chunks_ == PIPE_CHUNKS) {
+      pipe->StopReading();
+    }
+  }
+
+  static void AfterWrite(uv_write_t* req, int status) {
+    PipeChunk* chunk = container_of(req, PipeChunk, req);
+    StreamPipe* pipe = chunk->pipe;
+
+    pipe->writes_--;
+    pipe->ReturnChunk(chunk);
+
+    if (status) {
+      pipe->Fail(uv_last_error(req->handle->loop).code, true);
+    } else if (pipe->dst_) {
+      pipe->dst_->UpdateWriteQueueSize();
+      pipe->Read();
+    }
+
+    pipe->MaybeFinish();
+  }
+
+  StreamWrap* src_;
+  StreamWrap* dst_;
+  // Keeps the source's object, which gets onpipeend, alive.
+  Persistent<Object> src_obj_;
+  PipeChunk* free_;
+  int chunks_;
+  int writes_;
+  int64_t bytes_;
+  bool reading_;
+  bool paused_;
+  bool done_;
+  bool on_write_;
+  uv_err_t error_;
+};
+
+
 StreamWrap::StreamWrap(Handle<Object> object, uv_stream_t* stream)
     : HandleWrap(object, (uv_handle_t*)stream) {
+  statics_ = NODE_STATICS_GET(node_stream_wrap, StreamStatics);
   stream_ = stream;
+  read_size_ = READ_SIZE_MAX;
+  slab_class_ = SLAB_LARGE;
+  idle_timeout_ = 0;
+  last_active_ = 0;
+  idle_fired_ = false;
+  idle_prev_ = idle_next_ = NULL;
+  pipe_ = pipe_dest_ = NULL;
+  write_high_water_ = 0;
+  write_low_water_ = 0;
+  write_blocked_ = false;
   if (stream) {
     stream->data = this;
   }
 }
 
 
+StreamWrap::~StreamWrap() {
+  if (idle_timeout_) UnlinkIdle();
+  if (pipe_) StreamPipe::Detach(pipe_, this);
+  if (pipe_dest_) StreamPipe::Detach(pipe_dest_, this);
+}
+
+
 void StreamWrap::SetHandle(uv_handle_t* h) {
   HandleWrap::SetHandle(h);
   stream_ = (uv_stream_t*)h;
@@ -111,10 +543,64 @@ void StreamWrap::SetHandle(uv_handle_t* h) {
 }
 
 
-void StreamWrap::UpdateWriteQueueSize() {
+// Without watermarks javascript finds the size of the write queue in
+// writeQueueSize, set on every change. With them it only gets writeBlocked,
+// set when the queue reaches the high watermark and cleared when it falls
+// back to the low one.
+bool StreamWrap::UpdateWriteQueueSize() {
   HandleScope scope;
-  StreamStatics *statics = NODE_STATICS_GET(node_stream_wrap, StreamStatics);
-  object_->Set(statics->write_queue_size_sym, Integer::New(stream_->write_queue_size));
+  size_t size = stream_->write_queue_size;
+
+  if (write_high_water_ == 0) {
+    object_->Set(statics_->write_queue_size_sym, Integer::New(size));
+    return false;
+  }
+
+  if (!write_blocked_ && size >= write_high_water_) {
+    write_blocked_ = true;
+    object_->Set(statics_->write_blocked_sym, v8::True());
+  } else if (write_blocked_ && size <= write_low_water_) {
+    write_blocked_ = false;
+    object_->Set(statics_->write_blocked_sym, v8::False());
+    return true;
+  }
+
+  return false;
+}
+
+
+// handle.setWriteWatermarks(high, low)
+//
+// Sets handle.writeBlocked once `high` bytes or more wait in the write
+// queue, and clears it and calls handle.onwritedrain(), if there is one,
+// once no more than `low` do. A high watermark of 0 turns them off.
+Handle<Value> StreamWrap::SetWriteWatermarks(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  int64_t high = args[0]->IntegerValue();
+  int64_t low = args[1]->IntegerValue();
+  if (high < 0) high = 0;
+  if (low < 0) low = 0;
+  if (low >= high && high > 0) low = high - 1;
+
+  wrap->write_high_water_ = high;
+  wrap->write_low_water_ = low;
+  wrap->write_blocked_ = false;
+  wrap->object_->Set(wrap->statics_->write_blocked_sym, v8::False());
+  wrap->UpdateWriteQueueSize();
+
+  return scope.Close(Integer::New(0));
+}
+
+
+Handle<Value> StreamWrap::GetWriteQueueSize(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  return scope.Close(Integer::NewFromUnsigned(wrap->stream_->write_queue_size));
 }
 
 
@@ -123,6 +609,11 @@ Handle<Value> StreamWrap::ReadStart(const Arguments& args) {
 
   UNWRAP
 
+  // A piped stream resumes the pipe instead of reading into javascript.
+  if (wrap->pipe_) {
+    return scope.Close(Integer::New(StreamPipe::Resume(wrap->pipe_)));
+  }
+
   bool ipc_pipe = wrap->stream_->type == UV_NAMED_PIPE &&
                   ((uv_pipe_t*)wrap->stream_)->ipc;
   int r;
@@ -144,6 +635,8 @@ Handle<Value> StreamWrap::ReadStop(const Arguments& args) {
 
   UNWRAP
 
+  if (wrap->pipe_) StreamPipe::Pause(wrap->pipe_);
+
   int r = uv_read_stop(wrap->stream_);
 
   // Error starting the tcp.
@@ -153,13 +646,319 @@ Handle<Value> StreamWrap::ReadStop(const Arguments& args) {
 }
 
 
-inline char* StreamWrap::NewSlab(Handle<Object> global,
-                                        Handle<Object> wrap_obj) {
+// pipeTo(dest) pipes this stream into dest natively, see StreamPipe.
+Handle<Value> StreamWrap::PipeTo(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  assert(args[0]->IsObject());
+  Local<Object> dest_obj = args[0]->ToObject();
+  assert(dest_obj->InternalFieldCount() > 0);
+  StreamWrap* dest = static_cast<StreamWrap*>(
+      dest_obj->GetPointerFromInternalField(0));
+
+  if (!dest || dest == wrap || wrap->pipe_ || dest->pipe_dest_) {
+    uv_err_t err;
+    err.code = dest ? UV_EINVAL : UV_EBADF;
+    SetErrno(err);
+    return scope.Close(Integer::New(-1));
+  }
+
+  StreamPipe* pipe = new StreamPipe(wrap, dest);
+  int r = pipe->Start();
+  if (r) StreamPipe::Detach(pipe, wrap);
+
+  return scope.Close(Integer::New(r));
+}
+
+
+Handle<Value> StreamWrap::GetSlabPoolStats(const Arguments& args) {
+  HandleScope scope;
+  StreamStatics *statics = NODE_STATICS_GET(node_stream_wrap, StreamStatics);
+
+  Local<Object> obj = Object::New();
+  obj->Set(String::NewSymbol("hits"), Number::New(statics->slab_pool_hits));
+  obj->Set(String::NewSymbol("misses"),
+           Number::New(statics->slab_pool_misses));
+  obj->Set(String::NewSymbol("pooled"),
+           Integer::New(statics->slab_pool_count));
+  obj->Set(String::NewSymbol("bytesResident"),
+           Number::New(statics->slab_bytes_resident));
+
+  return scope.Close(obj);
+}
+
+
+// setSlabCompaction(threshold)
+//
+// Reads of at most `threshold` bytes are handed to javascript in a buffer of
+// their own rather than as a slice of the slab. A slice that javascript holds
+// on to, e.g. a partial request head on an idle keep-alive connection, keeps
+// the whole slab alive; small copies don't. 0 turns compaction off.
+Handle<Value> StreamWrap::SetSlabCompaction(const Arguments& args) {
+  HandleScope scope;
+  StreamStatics *statics = NODE_STATICS_GET(node_stream_wrap, StreamStatics);
+
+  int64_t threshold = args[0]->IntegerValue();
+  statics->compact_read_threshold = threshold > 0 ? threshold : 0;
+
+  return v8::Undefined();
+}
+
+
+// handle.setIdleTimeout(msecs)
+//
+// Calls handle.ontimeout() once the stream has seen no reads or writes for
+// `msecs` milliseconds, and again only after it has been active since.
+// Activity is recorded natively, so javascript doesn't have to pass every
+// read and write on to a timer. Calling this also counts as activity; 0
+// turns the timeout off.
+//
+// One timer per isolate sweeps all streams, at most IDLE_SWEEP_DIVISOR
+// times per shortest timeout. Timeouts are coarse: they may fire up to that
+// fraction of their duration late.
+Handle<Value> StreamWrap::SetIdleTimeout(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  int64_t msecs = args[0]->IntegerValue();
+  if (msecs < 0) msecs = 0;
+
+  if (msecs == 0) {
+    if (wrap->idle_timeout_) wrap->UnlinkIdle();
+    wrap->idle_timeout_ = 0;
+    wrap->idle_fired_ = false;
+    return scope.Close(Integer::New(0));
+  }
+
+  StreamStatics* statics = wrap->statics_;
+
+  if (statics->idle_timer == NULL) {
+    uv_loop_t* loop = wrap->stream_->loop;
+    statics->idle_timer = new uv_timer_t;
+    int r = uv_timer_init(loop, statics->idle_timer);
+    assert(r == 0);
+    statics->idle_timer->data = statics;
+    // The streams keep the loop alive, the sweep doesn't have to.
+    uv_unref(loop);
+    Isolate::FromLoop(loop)->AddCleanupHook(CloseIdleTimer, statics);
+  }
+
+  if (wrap->idle_timeout_ == 0) {
+    wrap->idle_prev_ = NULL;
+    wrap->idle_next_ = statics->idle_wraps;
+    if (wrap->idle_next_) wrap->idle_next_->idle_prev_ = wrap;
+    statics->idle_wraps = wrap;
+  }
+
+  wrap->idle_timeout_ = msecs;
+  wrap->last_active_ = uv_now(wrap->stream_->loop);
+  wrap->idle_fired_ = false;
+  ArmIdleTimer(statics, wrap->last_active_ + msecs);
+
+  return scope.Close(Integer::New(0));
+}
+
+
+void StreamWrap::UnlinkIdle() {
+  if (idle_prev_) {
+    idle_prev_->idle_next_ = idle_next_;
+  } else {
+    statics_->idle_wraps = idle_next_;
+  }
+  if (idle_next_) idle_next_->idle_prev_ = idle_prev_;
+  idle_prev_ = idle_next_ = NULL;
+}
+
+
+// The stream is active again after its timeout fired; the sweep may not be
+// running anymore.
+void StreamWrap::RearmIdleTimeout() {
+  idle_fired_ = false;
+  ArmIdleTimer(statics_, last_active_ + idle_timeout_);
+}
+
+
+// Makes sure the sweep runs no later than `deadline`.
+void StreamWrap::ArmIdleTimer(StreamStatics* statics, int64_t deadline) {
+  // closed along with the isolate
+  if (statics->idle_timer == NULL) return;
+  if (statics->idle_timer_armed && statics->idle_wake_at <= deadline) return;
+
+  int64_t now = uv_now(statics->idle_timer->loop);
+  int64_t timeout = deadline > now ? deadline - now : 0;
+
+  uv_timer_stop(statics->idle_timer);
+  int r = uv_timer_start(statics->idle_timer, OnIdleTimer, timeout, 0);
+  assert(r == 0);
+
+  statics->idle_timer_armed = true;
+  statics->idle_wake_at = deadline;
+}
+
+
+void StreamWrap::OnIdleTimer(uv_timer_t* handle, int status) {
+  StreamStatics* statics = static_cast<StreamStatics*>(handle->data);
+  statics->idle_timer_armed = false;
+
+  HandleScope scope;
+
+  int64_t now = uv_now(handle->loop);
+  int64_t next = -1;
+  int64_t shortest = -1;
+
+  // ontimeout may close streams or change their timeouts, so the expired
+  // ones are collected before any of them is called.
+  Local<Array> expired;
+  uint32_t count = 0;
+
+  for (StreamWrap* wrap = statics->idle_wraps; wrap; wrap = wrap->idle_next_) {
+    if (wrap->idle_fired_) continue;
+
+    int64_t deadline = wrap->last_active_ + wrap->idle_timeout_;
+    if (deadline <= now) {
+      wrap->idle_fired_ = true;
+      if (expired.IsEmpty()) expired = Array::New();
+      expired->Set(count++, wrap->object_);
+      continue;
+    }
+
+    if (next < 0 || deadline < next) next = deadline;
+    if (shortest < 0 || wrap->idle_timeout_ < shortest) {
+      shortest = wrap->idle_timeout_;
+    }
+  }
+
+  if (next >= 0) {
+    int64_t earliest = now + shortest / IDLE_SWEEP_DIVISOR;
+    ArmIdleTimer(statics, next > earliest ? next : earliest);
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    Local<Object> object = expired->Get(i)->ToObject();
+    StreamWrap* wrap =
+        static_cast<StreamWrap*>(object->GetPointerFromInternalField(0));
+
+    // Closed, switched off or active again by an earlier callback.
+    if (wrap == NULL || !wrap->idle_fired_) continue;
+
+    MakeCallback(object, statics->ontimeout_sym, 0, NULL);
+  }
+}
+
+
+void StreamWrap::OnIdleTimerClose(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_timer_t*>(handle);
+}
+
+
+void StreamWrap::CloseIdleTimer(void* arg) {
+  StreamStatics* statics = static_cast<StreamStatics*>(arg);
+  uv_timer_t* timer = statics->idle_timer;
+
+  statics->idle_timer = NULL;
+  statics->idle_timer_armed = false;
+  // uv_close() drops the reference uv_timer_init() took.
+  uv_ref(timer->loop);
+  uv_close(reinterpret_cast<uv_handle_t*>(timer), OnIdleTimerClose);
+}
+
+
+// Number of slabs kept alive only by slices javascript still holds on to.
+int StreamWrap::PinnedSlabs() {
+  StreamStatics *statics = NODE_STATICS_GET(node_stream_wrap, StreamStatics);
+  if (statics == NULL) return 0;
+
+  int pinned = statics->slabs_live;
+  for (int i = 0; i < SLAB_CLASSES; i++) {
+    if (statics->slab_class_active[i]) pinned--;
+  }
+
+  return pinned;
+}
+
+
+size_t StreamWrap::TrimSlabPool(size_t retain) {
   StreamStatics *statics = NODE_STATICS_GET(node_stream_wrap, StreamStatics);
-  Buffer* b = Buffer::New(SLAB_SIZE);
-  global->SetHiddenValue(statics->slab_sym, b->handle_);
-  assert(Buffer::Length(b) == SLAB_SIZE);
-  statics->slab_used = 0;
+  if (statics == NULL) return 0;
+
+  size_t freed = 0;
+  while (statics->slab_pool_count > 0 &&
+         static_cast<size_t>(statics->slab_pool_count) * SLAB_SIZE > retain) {
+    delete [] statics->slab_pool[--statics->slab_pool_count];
+    statics->slab_bytes_resident -= SLAB_SIZE;
+    V8::AdjustAmountOfExternalAllocatedMemory(-SLAB_SIZE);
+    freed += SLAB_SIZE;
+  }
+
+  return freed;
+}
+
+
+// Called when the Buffer wrapping a slab is garbage collected.
+void StreamWrap::ReleaseSlab(char* data, void* hint) {
+  StreamStatics *statics = static_cast<StreamStatics*>(hint);
+
+  statics->slabs_live--;
+
+  if (statics->slab_pool_count < SLAB_POOL_SIZE) {
+    statics->slab_pool[statics->slab_pool_count++] = data;
+    return;
+  }
+
+  delete [] data;
+  statics->slab_bytes_resident -= SLAB_SIZE;
+  V8::AdjustAmountOfExternalAllocatedMemory(-SLAB_SIZE);
+}
+
+
+// Small slabs are cheap to get again, they aren't pooled.
+void StreamWrap::ReleaseSmallSlab(char* data, void* hint) {
+  StreamStatics *statics = static_cast<StreamStatics*>(hint);
+
+  statics->slabs_live--;
+
+  delete [] data;
+  statics->slab_bytes_resident -= SMALL_SLAB_SIZE;
+  V8::AdjustAmountOfExternalAllocatedMemory(-SMALL_SLAB_SIZE);
+}
+
+
+inline char* StreamWrap::NewSlab(StreamStatics* statics,
+                                 Handle<Object> global,
+                                 Handle<Object> wrap_obj,
+                                 int slab_class) {
+  Buffer* b;
+
+  if (slab_class == SLAB_SMALL) {
+    char* data = new char[SMALL_SLAB_SIZE];
+    statics->slab_bytes_resident += SMALL_SLAB_SIZE;
+    V8::AdjustAmountOfExternalAllocatedMemory(SMALL_SLAB_SIZE);
+    b = Buffer::New(data, SMALL_SLAB_SIZE, ReleaseSmallSlab, statics);
+  } else {
+    char* data;
+
+    if (statics->slab_pool_count > 0) {
+      data = statics->slab_pool[--statics->slab_pool_count];
+      statics->slab_pool_hits++;
+    } else {
+      // Pooled slabs stay accounted for as external memory, only tell V8
+      // about slabs that are really new.
+      data = new char[SLAB_SIZE];
+      statics->slab_pool_misses++;
+      statics->slab_bytes_resident += SLAB_SIZE;
+      V8::AdjustAmountOfExternalAllocatedMemory(SLAB_SIZE);
+    }
+
+    b = Buffer::New(data, SLAB_SIZE, ReleaseSlab, statics);
+  }
+
+  global->SetHiddenValue(statics->slab_class_sym[slab_class], b->handle_);
+  statics->slab_class_active[slab_class] = true;
+  statics->slabs_live++;
+  statics->slab_used[slab_class] = 0;
   wrap_obj->SetHiddenValue(statics->slab_sym, b->handle_);
   return Buffer::Data(b);
 }
@@ -167,108 +966,172 @@ inline char* StreamWrap::NewSlab(Handle<Object> global,
 
 uv_buf_t StreamWrap::OnAlloc(uv_handle_t* handle, size_t suggested_size) {
   HandleScope scope;
-  StreamStatics *statics = NODE_STATICS_GET(node_stream_wrap, StreamStatics);
 
   StreamWrap* wrap = static_cast<StreamWrap*>(handle->data);
   assert(wrap->stream_ == reinterpret_cast<uv_stream_t*>(handle));
+  StreamStatics *statics = wrap->statics_;
+
+  size_t size = MIN(wrap->read_size_, suggested_size);
+  int slab_class = size <= SMALL_READ_SIZE ? SLAB_SMALL : SLAB_LARGE;
+  size_t slab_size = slab_class == SLAB_SMALL ? SMALL_SLAB_SIZE : SLAB_SIZE;
+  size_t used = statics->slab_used[slab_class];
 
   char* slab = NULL;
 
   Handle<Object> global = Context::GetCurrent()->Global();
-  Local<Value> slab_v = global->GetHiddenValue(statics->slab_sym);
+  Local<Value> slab_v =
+      global->GetHiddenValue(statics->slab_class_sym[slab_class]);
 
   if (slab_v.IsEmpty()) {
     // No slab currently. Create a new one.
-    slab = NewSlab(global, wrap->object_);
+    slab = NewSlab(statics, global, wrap->object_, slab_class);
   } else {
     // Use existing slab.
     Local<Object> slab_obj = slab_v->ToObject();
     slab = Buffer::Data(slab_obj);
-    assert(Buffer::Length(slab_obj) == SLAB_SIZE);
-    assert(SLAB_SIZE >= statics->slab_used);
+    assert(Buffer::Length(slab_obj) == slab_size);
+    assert(slab_size >= used);
 
-    // If less than 64kb is remaining on the slab allocate a new one.
-    if (SLAB_SIZE - statics->slab_used < 64 * 1024) {
-      slab = NewSlab(global, wrap->object_);
+    // If the read doesn't fit onto the slab anymore allocate a new one.
+    if (slab_size - used < size) {
+      slab = NewSlab(statics, global, wrap->object_, slab_class);
     } else {
       wrap->object_->SetHiddenValue(statics->slab_sym, slab_obj);
     }
   }
 
+  used = statics->slab_used[slab_class];
+
   uv_buf_t buf;
-  buf.base = slab + statics->slab_used;
-  buf.len = MIN(SLAB_SIZE - statics->slab_used, suggested_size);
+  buf.base = slab + used;
+  buf.len = size;
 
-  wrap->slab_offset_ = statics->slab_used;
-  statics->slab_used += buf.len;
+  wrap->slab_offset_ = used;
+  wrap->slab_class_ = slab_class;
+  statics->slab_used[slab_class] += buf.len;
 
-  statics->handle_that_last_alloced = reinterpret_cast<uv_stream_t*>(handle);
+  statics->handle_that_last_alloced[slab_class] =
+      reinterpret_cast<uv_stream_t*>(handle);
 
   return buf;
 }
 
 
+// Follows the sizes of the handle's recent reads: a read that filled the
+// buffer doubles the next one, reads using less than a quarter of it halve
+// it.
+void StreamWrap::UpdateReadSize(size_t nread, size_t len) {
+  if (nread == len) {
+    read_size_ = MIN(read_size_ * 2, READ_SIZE_MAX);
+  } else if (nread < len / 4 && read_size_ > READ_SIZE_MIN) {
+    read_size_ /= 2;
+  }
+}
+
+
 void StreamWrap::OnReadCommon(uv_stream_t* handle, ssize_t nread,
     uv_buf_t buf, uv_handle_type pending) {
   HandleScope scope;
-  StreamStatics *statics = NODE_STATICS_GET(node_stream_wrap, StreamStatics);
 
   StreamWrap* wrap = static_cast<StreamWrap*>(handle->data);
+  StreamStatics *statics = wrap->statics_;
+  int slab_class = wrap->slab_class_;
 
   // We should not be getting this callback if someone as already called
   // uv_close() on the handle.
   assert(wrap->object_.IsEmpty() == false);
 
+  wrap->Touch();
+
   // Remove the reference to the slab to avoid memory leaks;
   Local<Value> slab_v = wrap->object_->GetHiddenValue(statics->slab_sym);
   wrap->object_->SetHiddenValue(statics->slab_sym, v8::Null());
 
   if (nread < 0)  {
     // EOF or Error
-    if (statics->handle_that_last_alloced == handle) {
-      statics->slab_used -= buf.len;
+    if (statics->handle_that_last_alloced[slab_class] == handle) {
+      statics->slab_used[slab_class] -= buf.len;
     }
 
+    wrap->OnReadEnd();
+
     SetLastErrno();
-    MakeCallback(wrap->object_, "onread", 0, NULL);
+    MakeCallback(wrap->object_, statics->onread_sym, 0, NULL);
     return;
   }
 
   assert(nread <= buf.len);
 
-  if (statics->handle_that_last_alloced == handle) {
-    statics->slab_used -= (buf.len - nread);
+  if (statics->handle_that_last_alloced[slab_class] == handle) {
+    statics->slab_used[slab_class] -= (buf.len - nread);
   }
 
   if (nread > 0) {
+    wrap->UpdateReadSize(nread, buf.len);
+
+    size_t offset = wrap->slab_offset_;
+
+    if (static_cast<size_t>(nread) <= statics->compact_read_threshold) {
+      Buffer* copy = Buffer::New(buf.base, nread);
+      slab_v = Local<Object>::New(copy->handle_);
+      offset = 0;
+
+      // Nothing refers to this part of the slab anymore.
+      if (statics->handle_that_last_alloced[slab_class] == handle) {
+        statics->slab_used[slab_class] -= nread;
+      }
+    }
+
     int argc = 3;
     Local<Value> argv[4] = {
       slab_v,
-      Integer::New(wrap->slab_offset_),
+      Integer::New(offset),
       Integer::New(nread)
     };
 
 
-    if (pending == UV_TCP) {
-      // Instantiate the client javascript object and handle.
-      Local<Object> pending_obj = TCPWrap::Instantiate();
-
-      // Unwrap the client javascript object.
-      assert(pending_obj->InternalFieldCount() > 0);
-      TCPWrap* pending_wrap =
-          static_cast<TCPWrap*>(pending_obj->GetPointerFromInternalField(0));
-
-      int r = uv_accept(handle, pending_wrap->GetStream());
+    if (pending != UV_UNKNOWN_HANDLE) {
+      // Instantiate the javascript object and handle of the right type,
+      // then pull the received descriptor into it.
+      Local<Object> pending_obj;
+      uv_stream_t* pending_handle;
+
+      switch (pending) {
+        case UV_TCP:
+          pending_obj = TCPWrap::Instantiate();
+          pending_handle = static_cast<TCPWrap*>(
+              pending_obj->GetPointerFromInternalField(0))->GetStream();
+          break;
+
+        case UV_NAMED_PIPE:
+          // Received over an IPC pipe, it can pass handles in turn.
+          pending_obj = PipeWrap::Instantiate(true);
+          pending_handle = reinterpret_cast<uv_stream_t*>(
+              PipeWrap::Unwrap(pending_obj)->UVHandle());
+          break;
+
+        case UV_UDP:
+          pending_obj = UDPWrap::Instantiate();
+          pending_handle = reinterpret_cast<uv_stream_t*>(
+              UDPWrap::Unwrap(pending_obj)->UVHandle());
+          break;
+
+        default:
+          assert(0 && "unexpected pending handle type");
+          abort();
+      }
+
+      int r = uv_accept(handle, pending_handle);
       assert(r == 0);
 
       argv[3] = pending_obj;
       argc++;
-    } else {
-      // We only support sending UV_TCP right now.
-      assert(pending == UV_UNKNOWN_HANDLE);
     }
 
-    MakeCallback(wrap->object_, "onread", argc, argv);
+    Local<Value> pending_obj = argc > 3 ? argv[3] : Local<Value>();
+    if (wrap->OnReadData(slab_v, offset, nread, pending_obj)) return;
+
+    MakeCallback(wrap->object_, statics->onread_sym, argc, argv);
   }
 }
 
@@ -286,10 +1149,11 @@ void StreamWrap::OnRead2(uv_pipe_t* handle, ssize_t nread, uv_buf_t buf,
 
 Handle<Value> StreamWrap::Write(const Arguments& args) {
   HandleScope scope;
-  StreamStatics *statics = NODE_STATICS_GET(node_stream_wrap, StreamStatics);
 
   UNWRAP
 
+  StreamStatics *statics = wrap->statics_;
+
   bool ipc_pipe = wrap->stream_->type == UV_NAMED_PIPE &&
                   ((uv_pipe_t*)wrap->stream_)->ipc;
 
@@ -307,43 +1171,272 @@ Handle<Value> StreamWrap::Write(const Arguments& args) {
     length = args[2]->IntegerValue();
   }
 
-  WriteWrap* req_wrap = new WriteWrap();
-
-  req_wrap->object_->SetHiddenValue(statics->buffer_sym, buffer_obj);
-
   uv_buf_t buf;
   buf.base = Buffer::Data(buffer_obj) + offset;
   buf.len = length;
 
-  int r;
-
   if (!ipc_pipe) {
-    r = uv_write(&req_wrap->req_, wrap->stream_, &buf, 1, StreamWrap::AfterWrite);
+    return scope.Close(QueueWrite(wrap, buf, buffer_obj, NULL, false));
+  }
+
+  wrap->Touch();
+
+  WriteWrap* req_wrap = new WriteWrap();
+
+  req_wrap->Hold(statics->buffer_sym, buffer_obj);
+
+  uv_stream_t* send_stream = NULL;
+
+  // Any TCP, pipe or UDP handle can be sent; libuv rejects other types.
+  if (args[3]->IsObject()) {
+    Local<Object> send_obj = args[3]->ToObject();
+    assert(send_obj->InternalFieldCount() > 0);
+    HandleWrap* send_wrap = static_cast<HandleWrap*>(
+        send_obj->GetPointerFromInternalField(0));
+    if (send_wrap == NULL || send_wrap->GetHandle() == NULL) {
+      uv_err_t err;
+      err.code = UV_EBADF;
+      SetErrno(err);
+      delete req_wrap;
+      return scope.Close(v8::Null());
+    }
+    send_stream = reinterpret_cast<uv_stream_t*>(send_wrap->GetHandle());
+  }
+
+  int r = uv_write2(&req_wrap->req_,
+                    wrap->stream_,
+                    &buf,
+                    1,
+                    send_stream,
+                    StreamWrap::AfterWrite);
+
+  req_wrap->Dispatched();
+
+  wrap->UpdateWriteQueueSize();
+
+  if (r) {
+    SetLastErrno();
+    delete req_wrap;
+    return scope.Close(v8::Null());
   } else {
-    uv_stream_t* send_stream = NULL;
-
-    if (args[3]->IsObject()) {
-      Local<Object> send_stream_obj = args[3]->ToObject();
-      assert(send_stream_obj->InternalFieldCount() > 0);
-      StreamWrap* send_stream_wrap = static_cast<StreamWrap*>(
-          send_stream_obj->GetPointerFromInternalField(0));
-      send_stream = send_stream_wrap->GetStream();
+    return scope.Close(req_wrap->object_);
+  }
+}
+
+
+// var req = handle.writev([buffer1, buffer2, ...]);
+//
+// Queues all buffers with a single uv_write() so that they go out with one
+// writev(2) rather than one write(2) per buffer. The oncomplete callback
+// receives the array in place of the buffer.
+Handle<Value> StreamWrap::Writev(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  StreamStatics *statics = wrap->statics_;
+
+  if (!args[0]->IsArray()) {
+    return ThrowException(Exception::TypeError(
+          String::New("First argument must be an array of Buffers")));
+  }
+
+  Local<Array> buffers = Local<Array>::Cast(args[0]);
+  uint32_t count = buffers->Length();
+
+  if (count == 0 || count > WRITEV_MAX_BUFFERS) {
+    return ThrowException(Exception::RangeError(
+          String::New("Bad number of buffers")));
+  }
+
+  uv_buf_t bufs_stack[WRITEV_STACK_BUFFERS];
+  uv_buf_t* bufs = bufs_stack;
+  if (count > WRITEV_STACK_BUFFERS) {
+    bufs = new uv_buf_t[count];
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    Local<Value> buffer_v = buffers->Get(i);
+    if (!Buffer::HasInstance(buffer_v)) {
+      if (bufs != bufs_stack) delete [] bufs;
+      return ThrowException(Exception::TypeError(
+            String::New("First argument must be an array of Buffers")));
     }
+    Local<Object> buffer_obj = buffer_v->ToObject();
+    bufs[i].base = Buffer::Data(buffer_obj);
+    bufs[i].len = Buffer::Length(buffer_obj);
+  }
+
+  wrap->Touch();
 
-    r = uv_write2(&req_wrap->req_,
-                  wrap->stream_,
-                  &buf,
-                  1,
-                  send_stream,
-                  StreamWrap::AfterWrite);
+  WriteWrap* req_wrap = new WriteWrap();
+
+  // Keep the buffers alive until the write completes.
+  req_wrap->Hold(statics->buffer_sym, buffers);
+
+  // uv_write() copies the uv_buf_t array, the memory the entries point to
+  // is kept alive by the hidden reference above.
+  int r = uv_write(&req_wrap->req_,
+                   wrap->stream_,
+                   bufs,
+                   count,
+                   StreamWrap::AfterWrite);
+
+  if (bufs != bufs_stack) delete [] bufs;
+
+  req_wrap->Dispatched();
+
+  wrap->UpdateWriteQueueSize();
+
+  if (r) {
+    SetLastErrno();
+    delete req_wrap;
+    return scope.Close(v8::Null());
+  } else {
+    return scope.Close(req_wrap->object_);
+  }
+}
+
+
+// var req = handle.writeChunk(buffer);
+//
+// Sends `buffer` framed as one chunk of HTTP chunked transfer-encoding. The
+// hex length line, the buffer and the closing CRLF go out with a single
+// uv_write(); only the few framing bytes are copied, into the write arena.
+Handle<Value> StreamWrap::WriteChunk(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  StreamStatics *statics = wrap->statics_;
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(
+          String::New("First argument must be a buffer")));
+  }
+
+  Local<Object> buffer_obj = args[0]->ToObject();
+  size_t length = Buffer::Length(buffer_obj);
+
+  // Up to 16 hex digits and CRLF for the length line, then the final CRLF.
+  void* arena;
+  char* framing = WriteArenaAlloc(statics, 20, &arena);
+  char digits[16];
+  int ndigits = 0;
+  do {
+    digits[ndigits++] = "0123456789abcdef"[length & 15];
+    length >>= 4;
+  } while (length > 0);
+  int n = 0;
+  while (ndigits > 0) framing[n++] = digits[--ndigits];
+  memcpy(framing + n, "\r\n\r\n", 4);
+
+  uv_buf_t bufs[3];
+  bufs[0].base = framing;
+  bufs[0].len = n + 2;
+  bufs[1].base = Buffer::Data(buffer_obj);
+  bufs[1].len = Buffer::Length(buffer_obj);
+  bufs[2].base = framing + n + 2;
+  bufs[2].len = 2;
+
+  wrap->Touch();
+
+  WriteWrap* req_wrap = new WriteWrap();
+  req_wrap->data_ = arena;
+  req_wrap->Hold(statics->buffer_sym, buffer_obj);
+
+  int r = uv_write(&req_wrap->req_,
+                   wrap->stream_,
+                   bufs,
+                   3,
+                   StreamWrap::AfterWrite);
+
+  req_wrap->Dispatched();
+
+  wrap->UpdateWriteQueueSize();
+
+  if (r) {
+    SetLastErrno();
+    WriteArenaRelease(statics, arena);
+    delete req_wrap;
+    return scope.Close(v8::Null());
+  } else {
+    return scope.Close(req_wrap->object_);
+  }
+}
+
+
+// Replaces `string` by an external one if it is pure ASCII, so that its
+// bytes can be handed to the kernel as they are stored.
+static bool MakeExternalAscii(Local<String> string) {
+  if (!string->CanMakeExternal()) return false;
+
+  size_t length = string->Length();
+  if (static_cast<size_t>(string->Utf8Length()) != length) return false;
+
+  char* data = new char[length];
+  string->WriteAscii(data, 0, length, String::NO_NULL_TERMINATION);
+
+  ExternalWriteString* resource = new ExternalWriteString(data, length);
+  if (!string->MakeExternal(resource)) {
+    delete resource;
+    return false;
   }
 
+  return true;
+}
+
+
+// Writes `buf` with a new write request. `buffer` is kept alive until the
+// request completes; `arena` is the write arena reference `buf` was
+// allocated from, if any.
+//
+// With `try_write` set, as much of `buf` as the kernel takes right away is
+// written first. If that was all of it, no request is made and true is
+// returned instead.
+Handle<Value> StreamWrap::QueueWrite(StreamWrap* wrap,
+                                     uv_buf_t buf,
+                                     Handle<Value> buffer,
+                                     void* arena,
+                                     bool try_write) {
+  HandleScope scope;
+  StreamStatics *statics = wrap->statics_;
+
+  wrap->Touch();
+
+  if (try_write) {
+    // On errors, fall through: the queued write reports them the usual way.
+    int n = uv_try_write(wrap->stream_, &buf, 1);
+    if (n > 0) {
+      if (static_cast<size_t>(n) == buf.len) {
+        if (arena) WriteArenaRelease(statics, arena);
+        return scope.Close(v8::True());
+      }
+      buf.base += n;
+      buf.len -= n;
+    }
+  }
+
+  WriteWrap* req_wrap = new WriteWrap();
+  req_wrap->data_ = arena;
+
+  if (!buffer.IsEmpty()) {
+    req_wrap->Hold(statics->buffer_sym, buffer);
+  }
+
+  int r = uv_write(&req_wrap->req_,
+                   wrap->stream_,
+                   &buf,
+                   1,
+                   StreamWrap::AfterWrite);
+
   req_wrap->Dispatched();
 
   wrap->UpdateWriteQueueSize();
 
   if (r) {
     SetLastErrno();
+    if (arena) WriteArenaRelease(statics, arena);
     delete req_wrap;
     return scope.Close(v8::Null());
   } else {
@@ -352,32 +1445,155 @@ Handle<Value> StreamWrap::Write(const Arguments& args) {
 }
 
 
+// var req = handle.writeAsciiString(string);
+// var req = handle.writeUtf8String(string);
+//
+// Writes a string without turning it into a Buffer first. Small strings are
+// encoded into the write arena, large ASCII strings are externalized and
+// written from the string's own storage.
+template <enum encoding encoding>
+Handle<Value> StreamWrap::WriteStringImpl(const Arguments& args,
+                                          bool try_write) {
+  HandleScope scope;
+
+  UNWRAP
+
+  StreamStatics *statics = wrap->statics_;
+
+  if (!args[0]->IsString()) {
+    return ThrowException(Exception::TypeError(
+          String::New("First argument must be a string")));
+  }
+
+  Local<String> string = args[0]->ToString();
+  size_t length = string->Length();
+
+  uv_buf_t buf;
+  void* arena = NULL;
+
+  if (length > WRITE_ARENA_MAX &&
+      (string->IsExternalAscii() || MakeExternalAscii(string))) {
+    String::ExternalAsciiStringResource* resource =
+        string->GetExternalAsciiStringResource();
+    buf.base = const_cast<char*>(resource->data());
+    buf.len = resource->length();
+
+    // Keep the string, and with it the resource, alive.
+    return scope.Close(QueueWrite(wrap, buf, string, NULL, try_write));
+  }
+
+  if (encoding == ASCII) {
+    buf.base = WriteArenaAlloc(statics, length, &arena);
+    buf.len = string->WriteAscii(buf.base, 0, length,
+                                 String::NO_NULL_TERMINATION);
+  } else {
+    size_t storage_size = string->Utf8Length();
+    buf.base = WriteArenaAlloc(statics, storage_size, &arena);
+    buf.len = string->WriteUtf8(buf.base, storage_size, NULL,
+                                String::NO_NULL_TERMINATION);
+  }
+
+  return scope.Close(QueueWrite(wrap, buf, Handle<Value>(), arena, try_write));
+}
+
+
+Handle<Value> StreamWrap::WriteAsciiString(const Arguments& args) {
+  return WriteStringImpl<ASCII>(args, false);
+}
+
+
+Handle<Value> StreamWrap::WriteUtf8String(const Arguments& args) {
+  return WriteStringImpl<UTF8>(args, false);
+}
+
+
+// var req = handle.tryWrite(data, [encoding]);
+//
+// Like write(), writeAsciiString() and writeUtf8String() rolled into one,
+// but tries to write `data` right away. Returns true, and never calls
+// oncomplete, if that worked for all of it.
+Handle<Value> StreamWrap::TryWrite(const Arguments& args) {
+  if (args[0]->IsString()) {
+    if (ParseEncoding(args[1], UTF8) == ASCII) {
+      return WriteStringImpl<ASCII>(args, true);
+    }
+    return WriteStringImpl<UTF8>(args, true);
+  }
+
+  HandleScope scope;
+
+  UNWRAP
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(
+          String::New("First argument must be a string or Buffer")));
+  }
+
+  Local<Object> buffer_obj = args[0]->ToObject();
+
+  uv_buf_t buf;
+  buf.base = Buffer::Data(buffer_obj);
+  buf.len = Buffer::Length(buffer_obj);
+
+  return scope.Close(QueueWrite(wrap, buf, buffer_obj, NULL, true));
+}
+
+
+#ifndef _WIN32
+// var fd = handle.fileno();
+//
+// The stream's file descriptor, for system calls libuv doesn't wrap such as
+// sendfile(2). Anything written through it bypasses the write queue, so the
+// caller has to make sure that is empty.
+Handle<Value> StreamWrap::Fileno(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  return scope.Close(Integer::New(wrap->stream_->fd));
+}
+#endif
+
+
 void StreamWrap::AfterWrite(uv_write_t* req, int status) {
   WriteWrap* req_wrap = (WriteWrap*) req->data;
   StreamWrap* wrap = (StreamWrap*) req->handle->data;
 
   HandleScope scope;
-  StreamStatics *statics = NODE_STATICS_GET(node_stream_wrap, StreamStatics);
+  StreamStatics *statics = wrap->statics_;
 
   // The wrap and request objects should still be there.
   assert(req_wrap->object_.IsEmpty() == false);
   assert(wrap->object_.IsEmpty() == false);
 
+  wrap->Touch();
+
   if (status) {
     SetLastErrno();
   }
 
-  wrap->UpdateWriteQueueSize();
+  bool drained = wrap->UpdateWriteQueueSize();
+
+  // String writes from the write arena don't keep anything alive.
+  Local<Value> buffer = req_wrap->object_->GetHiddenValue(statics->buffer_sym);
+  if (buffer.IsEmpty()) buffer = Local<Value>::New(v8::Undefined());
 
   Local<Value> argv[4] = {
     Integer::New(status),
     Local<Value>::New(wrap->object_),
     Local<Value>::New(req_wrap->object_),
-    req_wrap->object_->GetHiddenValue(statics->buffer_sym),
+    buffer
   };
 
-  MakeCallback(req_wrap->object_, "oncomplete", 4, argv);
+  MakeCallback(req_wrap->object_, statics->oncomplete_sym, 4, argv);
+
+  // After oncomplete, so that javascript has counted the write as done.
+  if (drained && !wrap->object_.IsEmpty() &&
+      wrap->object_->Get(statics->onwritedrain_sym)->IsFunction()) {
+    MakeCallback(wrap->object_, statics->onwritedrain_sym, 0, NULL);
+  }
 
+  if (req_wrap->data_) WriteArenaRelease(statics, req_wrap->data_);
   delete req_wrap;
 }
 
@@ -423,7 +1639,7 @@ void StreamWrap::AfterShutdown(uv_shutdown_t* req, int status) {
     Local<Value>::New(req_wrap->object_)
   };
 
-  MakeCallback(req_wrap->object_, "oncomplete", 3, argv);
+  MakeCallback(req_wrap->object_, wrap->statics_->oncomplete_sym, 3, argv);
 
   delete req_wrap;
 }
@@ -28,6 +28,9 @@
 
 namespace node {
 
+class StreamStatics;
+class StreamPipe;
+
 class StreamWrap : public HandleWrap {
  public:
   uv_stream_t* GetStream() { return stream_; }
@@ -36,19 +39,83 @@ class StreamWrap : public HandleWrap {
 
   // JavaScript functions
   static v8::Handle<v8::Value> Write(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Writev(const v8::Arguments& args);
+  static v8::Handle<v8::Value> WriteChunk(const v8::Arguments& args);
+  static v8::Handle<v8::Value> WriteAsciiString(const v8::Arguments& args);
+  static v8::Handle<v8::Value> WriteUtf8String(const v8::Arguments& args);
+  static v8::Handle<v8::Value> TryWrite(const v8::Arguments& args);
+#ifndef _WIN32
+  static v8::Handle<v8::Value> Fileno(const v8::Arguments& args);
+#endif
   static v8::Handle<v8::Value> ReadStart(const v8::Arguments& args);
   static v8::Handle<v8::Value> ReadStop(const v8::Arguments& args);
   static v8::Handle<v8::Value> Shutdown(const v8::Arguments& args);
+  static v8::Handle<v8::Value> GetSlabPoolStats(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetSlabCompaction(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetIdleTimeout(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetWriteWatermarks(const v8::Arguments& args);
+  static v8::Handle<v8::Value> GetWriteQueueSize(const v8::Arguments& args);
+  static v8::Handle<v8::Value> PipeTo(const v8::Arguments& args);
+
+  static int PinnedSlabs();
+  // Frees the pooled slabs of the current isolate beyond `retain` bytes and
+  // returns the bytes freed.
+  static size_t TrimSlabPool(size_t retain);
 
  protected:
   StreamWrap(v8::Handle<v8::Object> object, uv_stream_t* stream);
-  virtual ~StreamWrap() { }
+  virtual ~StreamWrap();
   virtual void SetHandle(uv_handle_t* h);
   void StateChange() { }
-  void UpdateWriteQueueSize();
+  // Returns true when the write queue just fell back to the low watermark.
+  bool UpdateWriteQueueSize();
+
+  // Gets the data of every successful read before onread is called.
+  // Subclasses return true when they have delivered it themselves.
+  virtual bool OnReadData(v8::Local<v8::Value> slab,
+                          size_t offset,
+                          size_t nread,
+                          v8::Local<v8::Value> pending) {
+    return false;
+  }
+
+  // Called on EOF or a read error, before onread is.
+  virtual void OnReadEnd() { }
 
  private:
-  static inline char* NewSlab(v8::Handle<v8::Object> global, v8::Handle<v8::Object> wrap_obj);
+  friend class StreamPipe;
+
+  static inline char* NewSlab(StreamStatics* statics,
+                              v8::Handle<v8::Object> global,
+                              v8::Handle<v8::Object> wrap_obj,
+                              int slab_class);
+  static void ReleaseSlab(char* data, void* hint);
+  static void ReleaseSmallSlab(char* data, void* hint);
+  void UpdateReadSize(size_t nread, size_t len);
+
+  // Reads and writes count as activity for the idle timeout. This is all
+  // they pay for it; only the first activity after the timeout fired has
+  // to arm the sweep again.
+  void Touch() {
+    last_active_ = uv_now(stream_->loop);
+    if (idle_fired_) RearmIdleTimeout();
+  }
+  void RearmIdleTimeout();
+  void UnlinkIdle();
+  static void ArmIdleTimer(StreamStatics* statics, int64_t deadline);
+  static void OnIdleTimer(uv_timer_t* handle, int status);
+  static void OnIdleTimerClose(uv_handle_t* handle);
+  static void CloseIdleTimer(void* arg);
+
+  static v8::Handle<v8::Value> QueueWrite(StreamWrap* wrap,
+                                          uv_buf_t buf,
+                                          v8::Handle<v8::Value> buffer,
+                                          void* arena,
+                                          bool try_write);
+
+  template <enum encoding encoding>
+  static v8::Handle<v8::Value> WriteStringImpl(const v8::Arguments& args,
+                                               bool try_write);
 
   // Callbacks for libuv
   static void AfterWrite(uv_write_t* req, int status);
@@ -62,7 +129,29 @@ class StreamWrap : public HandleWrap {
       uv_buf_t buf, uv_handle_type pending);
 
   size_t slab_offset_;
+  int slab_class_;
+  // What OnAlloc hands out for the next read.
+  size_t read_size_;
   uv_stream_t* stream_;
+  // this isolate's slabs, looked up once rather than on every read and write
+  StreamStatics* statics_;
+  // Idle timeout in milliseconds, 0 when off, and the uv_now() of the last
+  // read or write. idle_fired_ is set from the time ontimeout was called
+  // until the stream is active again.
+  int64_t idle_timeout_;
+  int64_t last_active_;
+  bool idle_fired_;
+  // this isolate's streams that have an idle timeout
+  StreamWrap* idle_prev_;
+  StreamWrap* idle_next_;
+  // The native pipe this stream is the source or the destination of, see
+  // PipeTo().
+  StreamPipe* pipe_;
+  StreamPipe* pipe_dest_;
+  // See SetWriteWatermarks(); write_high_water_ is 0 when they are off.
+  size_t write_high_water_;
+  size_t write_low_water_;
+  bool write_blocked_;
 };
 
 
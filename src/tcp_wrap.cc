@@ -27,6 +27,17 @@
 #include <tcp_wrap.h>
 
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+# include <errno.h>
+# include <fcntl.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <string.h>
+# include <unistd.h>
+# include <string>
+#endif
 
 // Temporary hack: libuv should provide uv_inet_pton and uv_inet_ntop.
 #if defined(__MINGW32__) || defined(_MSC_VER)
@@ -71,14 +82,19 @@ using v8::Context;
 using v8::Arguments;
 using v8::Integer;
 using v8::Undefined;
-
-typedef class ReqWrap<uv_connect_t> ConnectWrap;
+using v8::Null;
+using v8::Number;
+using v8::Array;
 
 class TCPStatics : public ModuleStatics {
     v8::Persistent<v8::Function> tcpConstructor;
     v8::Persistent<v8::String> family_symbol;
     v8::Persistent<v8::String> address_symbol;
     v8::Persistent<v8::String> port_symbol;
+    v8::Persistent<v8::String> onconnection_symbol;
+    v8::Persistent<v8::String> onconnectionbatch_symbol;
+    v8::Persistent<v8::String> onoverload_symbol;
+    v8::Persistent<v8::String> oncomplete_symbol;
     friend class TCPWrap;
 };
 
@@ -108,11 +124,27 @@ void TCPWrap::Initialize(Handle<Object> target) {
   t->InstanceTemplate()->SetInternalFieldCount(1);
 
   NODE_SET_PROTOTYPE_METHOD(t, "close", HandleWrap::Close);
+  NODE_SET_PROTOTYPE_METHOD(t, "unref", HandleWrap::Unref);
+  NODE_SET_PROTOTYPE_METHOD(t, "ref", HandleWrap::Ref);
 
   NODE_SET_PROTOTYPE_METHOD(t, "readStart", StreamWrap::ReadStart);
   NODE_SET_PROTOTYPE_METHOD(t, "readStop", StreamWrap::ReadStop);
   NODE_SET_PROTOTYPE_METHOD(t, "write", StreamWrap::Write);
+  NODE_SET_PROTOTYPE_METHOD(t, "writev", StreamWrap::Writev);
+  NODE_SET_PROTOTYPE_METHOD(t, "writeChunk", StreamWrap::WriteChunk);
+  NODE_SET_PROTOTYPE_METHOD(t, "writeAsciiString", StreamWrap::WriteAsciiString);
+  NODE_SET_PROTOTYPE_METHOD(t, "writeUtf8String", StreamWrap::WriteUtf8String);
+  NODE_SET_PROTOTYPE_METHOD(t, "tryWrite", StreamWrap::TryWrite);
+  NODE_SET_PROTOTYPE_METHOD(t, "setIdleTimeout", StreamWrap::SetIdleTimeout);
+  NODE_SET_PROTOTYPE_METHOD(t, "setWriteWatermarks",
+                            StreamWrap::SetWriteWatermarks);
+  NODE_SET_PROTOTYPE_METHOD(t, "getWriteQueueSize",
+                            StreamWrap::GetWriteQueueSize);
+  NODE_SET_PROTOTYPE_METHOD(t, "pipeTo", StreamWrap::PipeTo);
   NODE_SET_PROTOTYPE_METHOD(t, "shutdown", StreamWrap::Shutdown);
+#ifndef _WIN32
+  NODE_SET_PROTOTYPE_METHOD(t, "fileno", StreamWrap::Fileno);
+#endif
 
   NODE_SET_PROTOTYPE_METHOD(t, "bind", Bind);
   NODE_SET_PROTOTYPE_METHOD(t, "listen", Listen);
@@ -123,6 +155,14 @@ void TCPWrap::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(t, "getpeername", GetPeerName);
   NODE_SET_PROTOTYPE_METHOD(t, "setNoDelay", SetNoDelay);
   NODE_SET_PROTOTYPE_METHOD(t, "setKeepAlive", SetKeepAlive);
+  NODE_SET_PROTOTYPE_METHOD(t, "setDeferAccept", SetDeferAccept);
+  NODE_SET_PROTOTYPE_METHOD(t, "setFastOpen", SetFastOpen);
+  NODE_SET_PROTOTYPE_METHOD(t, "setPendingAccepts", SetPendingAccepts);
+  NODE_SET_PROTOTYPE_METHOD(t, "setAcceptBatchSize", SetAcceptBatchSize);
+  NODE_SET_PROTOTYPE_METHOD(t, "setOverload", SetOverload);
+#ifdef __linux__
+  NODE_SET_PROTOTYPE_METHOD(t, "getListenQueue", GetListenQueue);
+#endif
 
 #ifdef _WIN32
   NODE_SET_PROTOTYPE_METHOD(t, "setSimultaneousAccepts", SetSimultaneousAccepts);
@@ -131,6 +171,10 @@ void TCPWrap::Initialize(Handle<Object> target) {
   statics->tcpConstructor = Persistent<Function>::New(t->GetFunction());
 
   statics->family_symbol = NODE_PSYMBOL("family");
+  statics->onconnection_symbol = NODE_PSYMBOL("onconnection");
+  statics->onconnectionbatch_symbol = NODE_PSYMBOL("onconnectionbatch");
+  statics->onoverload_symbol = NODE_PSYMBOL("onoverload");
+  statics->oncomplete_symbol = NODE_PSYMBOL("oncomplete");
   statics->address_symbol = NODE_PSYMBOL("address");
   statics->port_symbol = NODE_PSYMBOL("port");
 
@@ -157,12 +201,35 @@ TCPWrap::TCPWrap(Handle<Object> object)
   int r = uv_tcp_init(Isolate::GetCurrentLoop(), &handle_);
   assert(r == 0); // How do we proxy this error up to javascript?
                   // Suggestion: uv_tcp_init() returns void.
+  accept_batch_size_ = 1;
+  overload_lag_ = 0;
+  overload_resume_lag_ = 0;
+  overload_requests_ = 0;
+  overloaded_ = false;
+  overload_response_ = NULL;
+  overload_response_len_ = 0;
+  overload_rejected_ = 0;
+  connect_req_ = NULL;
+  connect_timer_ = NULL;
+  connect_timed_out_ = false;
   UpdateWriteQueueSize();
 }
 
 
 TCPWrap::~TCPWrap() {
   assert(object_.IsEmpty());
+  delete [] overload_response_;
+
+  // On Unix, closing the handle drops a connect still in progress without
+  // calling back.
+  delete connect_req_;
+
+  if (connect_timer_) {
+    // uv_close() drops the reference uv_timer_init() took.
+    uv_ref(connect_timer_->loop);
+    uv_close(reinterpret_cast<uv_handle_t*>(connect_timer_),
+             OnConnectTimerClose);
+  }
 }
 
 
@@ -281,6 +348,56 @@ Handle<Value> TCPWrap::SetKeepAlive(const Arguments& args) {
 }
 
 
+Handle<Value> TCPWrap::SetDeferAccept(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  unsigned int timeout = args[0]->Uint32Value();
+
+  int r = uv_tcp_defer_accept(&wrap->handle_, timeout);
+  if (r)
+    SetLastErrno();
+
+  return scope.Close(Integer::New(r));
+}
+
+
+Handle<Value> TCPWrap::SetFastOpen(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  int qlen = args[0]->Int32Value();
+
+  int r = uv_tcp_fastopen(&wrap->handle_, qlen);
+  if (r)
+    SetLastErrno();
+
+  return scope.Close(Integer::New(r));
+}
+
+
+// handle.setPendingAccepts(initial, max)
+//
+// Windows only, a no-op elsewhere: how many AcceptEx requests the server
+// queues when it starts listening, and how far it may grow them under load.
+Handle<Value> TCPWrap::SetPendingAccepts(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  unsigned int initial = args[0]->Uint32Value();
+  unsigned int max = args[1]->Uint32Value();
+
+  int r = uv_tcp_pending_accepts(&wrap->handle_, initial, max);
+  if (r)
+    SetLastErrno();
+
+  return scope.Close(Integer::New(r));
+}
+
+
 #ifdef _WIN32
 Handle<Value> TCPWrap::SetSimultaneousAccepts(const Arguments& args) {
   HandleScope scope;
@@ -307,7 +424,16 @@ Handle<Value> TCPWrap::Bind(const Arguments& args) {
   int port = args[1]->Int32Value();
 
   struct sockaddr_in address = uv_ip4_addr(*ip_address, port);
-  int r = uv_tcp_bind(&wrap->handle_, address);
+  int r = 0;
+
+  // An optional third argument asks for SO_REUSEPORT.
+  if (args[2]->IsTrue()) {
+    r = uv_tcp_reuseport(&wrap->handle_, 1);
+  }
+
+  if (r == 0) {
+    r = uv_tcp_bind(&wrap->handle_, address);
+  }
 
   // Error starting the tcp.
   if (r) SetLastErrno();
@@ -325,7 +451,16 @@ Handle<Value> TCPWrap::Bind6(const Arguments& args) {
   int port = args[1]->Int32Value();
 
   struct sockaddr_in6 address = uv_ip6_addr(*ip6_address, port);
-  int r = uv_tcp_bind6(&wrap->handle_, address);
+  int r = 0;
+
+  // An optional third argument asks for SO_REUSEPORT.
+  if (args[2]->IsTrue()) {
+    r = uv_tcp_reuseport(&wrap->handle_, 1);
+  }
+
+  if (r == 0) {
+    r = uv_tcp_bind6(&wrap->handle_, address);
+  }
 
   // Error starting the tcp.
   if (r) SetLastErrno();
@@ -350,8 +485,302 @@ Handle<Value> TCPWrap::Listen(const Arguments& args) {
 }
 
 
+// handle.setAcceptBatchSize(n)
+//
+// With n > 1, up to n pending connections are accepted at once and passed
+// to onconnectionbatch(clients) instead of onconnection(client) each.
+Handle<Value> TCPWrap::SetAcceptBatchSize(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  int size = args[0]->Int32Value();
+  wrap->accept_batch_size_ = size > 1 ? size : 1;
+
+  return Undefined();
+}
+
+
+// handle.setOverload(maxLag, resumeLag, maxRequests, [response])
+//
+// Sheds load natively: once the last turn of the event loop spent maxLag ms
+// or more in callbacks, or maxRequests or more requests are in flight, new
+// connections are accepted and turned away without calling into
+// javascript, until the lag is back under resumeLag ms and the requests
+// under maxRequests. Those turned away are sent `response`, a Buffer, if
+// there is one, and closed. onoverload(overloaded, rejected) is called when
+// the server goes in or out of that state. Zeros turn it off.
+Handle<Value> TCPWrap::SetOverload(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  wrap->overload_lag_ =
+      static_cast<uint64_t>(args[0]->NumberValue() * 1e6);
+  wrap->overload_resume_lag_ =
+      static_cast<uint64_t>(args[1]->NumberValue() * 1e6);
+  wrap->overload_requests_ = args[2]->Uint32Value();
+  if (!wrap->overload_lag_ && !wrap->overload_requests_) {
+    wrap->overloaded_ = false;
+  }
+
+  delete [] wrap->overload_response_;
+  wrap->overload_response_ = NULL;
+  wrap->overload_response_len_ = 0;
+  if (Buffer::HasInstance(args[3])) {
+    Local<Object> response = args[3]->ToObject();
+    size_t len = Buffer::Length(response);
+    if (len) {
+      wrap->overload_response_ = new char[len];
+      memcpy(wrap->overload_response_, Buffer::Data(response), len);
+      wrap->overload_response_len_ = len;
+    }
+  }
+
+  return Undefined();
+}
+
+
+// Enters or leaves the overloaded state, and returns whether it changed.
+bool TCPWrap::UpdateOverload() {
+  if (!overload_lag_ && !overload_requests_) return false;
+
+  Isolate* isolate = Isolate::FromLoop(handle_.loop);
+  uint64_t lag = isolate->LastCallbackTime();
+  unsigned int requests = isolate->req_wraps;
+  bool was = overloaded_;
+
+  if (!overloaded_) {
+    overloaded_ = (overload_lag_ && lag >= overload_lag_) ||
+                  (overload_requests_ && requests >= overload_requests_);
+  } else {
+    overloaded_ = !((!overload_lag_ || lag < overload_resume_lag_) &&
+                    (!overload_requests_ || requests < overload_requests_));
+  }
+
+  return overloaded_ != was;
+}
+
+
+void TCPWrap::NotifyOverload() {
+  HandleScope scope;
+  TCPStatics* statics = NODE_STATICS_LOOP(node_tcp_wrap,
+                                          TCPStatics,
+                                          handle_.loop);
+
+  if (!object_->Get(statics->onoverload_symbol)->IsFunction()) return;
+
+  Local<Value> argv[2] = {
+    Local<Value>::New(v8::Boolean::New(overloaded_)),
+    Number::New(overload_rejected_)
+  };
+  MakeCallback(object_, statics->onoverload_symbol, 2, argv);
+}
+
+
+// A connection turned away while the server is overloaded. It is sent the
+// response, if there is one, and shut down. What the client sends meanwhile
+// is read and dropped, so that closing doesn't reset the connection under
+// the response. A client that hasn't closed its end within REJECT_TIMEOUT
+// ms is cut off.
+#define REJECT_TIMEOUT 5000
+
+struct RejectedConnection {
+  uv_tcp_t handle;
+  uv_timer_t timer;
+  uv_write_t write_req;
+  uv_shutdown_t shutdown_req;
+  int open_handles;
+  bool closing;
+  char discard[512];
+  char response[1];  // the rest follows
+};
+
+
+static void RejectClosed(uv_handle_t* handle) {
+  RejectedConnection* c = static_cast<RejectedConnection*>(handle->data);
+  if (--c->open_handles == 0) free(c);
+}
+
+
+static void RejectClose(RejectedConnection* c) {
+  if (c->closing) return;
+  c->closing = true;
+  uv_close((uv_handle_t*) &c->handle, RejectClosed);
+  uv_close((uv_handle_t*) &c->timer, RejectClosed);
+}
+
+
+static uv_buf_t RejectAlloc(uv_handle_t* handle, size_t suggested_size) {
+  RejectedConnection* c = static_cast<RejectedConnection*>(handle->data);
+  return uv_buf_init(c->discard, sizeof(c->discard));
+}
+
+
+static void RejectRead(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  if (nread < 0) RejectClose(static_cast<RejectedConnection*>(stream->data));
+}
+
+
+static void RejectShutdown(uv_shutdown_t* req, int status) {
+  RejectedConnection* c = static_cast<RejectedConnection*>(req->data);
+  if (status) RejectClose(c);
+}
+
+
+static void RejectWritten(uv_write_t* req, int status) {
+  RejectedConnection* c = static_cast<RejectedConnection*>(req->data);
+  if (status || c->closing) {
+    RejectClose(c);
+    return;
+  }
+
+  c->shutdown_req.data = c;
+  if (uv_shutdown(&c->shutdown_req, (uv_stream_t*) &c->handle,
+                  RejectShutdown)) {
+    RejectClose(c);
+  }
+}
+
+
+static void RejectTimeout(uv_timer_t* timer, int status) {
+  RejectClose(static_cast<RejectedConnection*>(timer->data));
+}
+
+
+void TCPWrap::RejectConnection() {
+  size_t len = overload_response_len_;
+  RejectedConnection* c = static_cast<RejectedConnection*>(
+      malloc(sizeof(RejectedConnection) + len));
+  uv_loop_t* loop = handle_.loop;
+
+  uv_tcp_init(loop, &c->handle);
+  c->handle.data = c;
+  int r = uv_accept((uv_stream_t*) &handle_, (uv_stream_t*) &c->handle);
+  assert(r == 0);
+
+  uv_timer_init(loop, &c->timer);
+  c->timer.data = c;
+  c->open_handles = 2;
+  c->closing = false;
+  overload_rejected_++;
+
+  if (len == 0) {
+    RejectClose(c);
+    return;
+  }
+
+  memcpy(c->response, overload_response_, len);
+  uv_buf_t buf = uv_buf_init(c->response, len);
+  c->write_req.data = c;
+
+  uv_read_start((uv_stream_t*) &c->handle, RejectAlloc, RejectRead);
+  uv_timer_start(&c->timer, RejectTimeout, REJECT_TIMEOUT, 0);
+  if (uv_write(&c->write_req, (uv_stream_t*) &c->handle, &buf, 1,
+               RejectWritten)) {
+    RejectClose(c);
+  }
+}
+
+
+#ifdef __linux__
+// Finds the TcpExt counters ListenOverflows and ListenDrops in
+// /proc/net/netstat, where a line of names is followed by one of values.
+static bool ReadListenOverflows(double* overflows, double* drops) {
+  int fd = open("/proc/net/netstat", O_RDONLY);
+  if (fd == -1) return false;
+
+  std::string text;
+  char buf[4096];
+  ssize_t n;
+  do {
+    n = read(fd, buf, sizeof(buf));
+    if (n > 0) text.append(buf, n);
+  } while (n > 0 || (n == -1 && errno == EINTR));
+  close(fd);
+
+  size_t names = text.find("TcpExt:");
+  if (names == std::string::npos) return false;
+  size_t values = text.find("TcpExt:", names + 1);
+  if (values == std::string::npos) return false;
+
+  size_t names_end = text.find('\n', names);
+  size_t values_end = text.find('\n', values);
+  if (values_end == std::string::npos) values_end = text.size();
+
+  int found = 0;
+  size_t name = names + 7;
+  size_t value = values + 7;
+  while (name < names_end && value < values_end) {
+    while (text[name] == ' ') name++;
+    while (text[value] == ' ') value++;
+    size_t name_end = text.find_first_of(" \n", name);
+    size_t value_end = text.find_first_of(" \n", value);
+    if (name_end == std::string::npos) name_end = text.size();
+    if (value_end == std::string::npos) value_end = text.size();
+
+    std::string key = text.substr(name, name_end - name);
+    double v = strtod(text.c_str() + value, NULL);
+    if (key == "ListenOverflows") {
+      *overflows = v;
+      found++;
+    } else if (key == "ListenDrops") {
+      *drops = v;
+      found++;
+    }
+
+    name = name_end;
+    value = value_end;
+  }
+
+  return found == 2;
+}
+
+
+// handle.getListenQueue()
+//
+// The accept queue of a listening socket from TCP_INFO: how many
+// connections wait in it and how many it holds. overflows and drops are
+// the counts of connections the whole system refused because a queue was
+// full, or dropped for any reason, since boot. Returns null if the socket
+// is not listening.
+Handle<Value> TCPWrap::GetListenQueue(const Arguments& args) {
+  HandleScope scope;
+
+  UNWRAP
+
+  struct tcp_info info;
+  socklen_t len = sizeof(info);
+  memset(&info, 0, sizeof(info));
+  if (wrap->handle_.fd == -1 ||
+      getsockopt(wrap->handle_.fd, IPPROTO_TCP, TCP_INFO, &info, &len) ||
+      info.tcpi_state != TCP_LISTEN) {
+    return scope.Close(Null());
+  }
+
+  Local<Object> obj = Object::New();
+  // For listening sockets the kernel reuses these two fields.
+  obj->Set(String::NewSymbol("length"),
+           Integer::NewFromUnsigned(info.tcpi_unacked));
+  obj->Set(String::NewSymbol("backlog"),
+           Integer::NewFromUnsigned(info.tcpi_sacked));
+
+  double overflows, drops;
+  if (ReadListenOverflows(&overflows, &drops)) {
+    obj->Set(String::NewSymbol("overflows"), Number::New(overflows));
+    obj->Set(String::NewSymbol("drops"), Number::New(drops));
+  }
+
+  return scope.Close(obj);
+}
+#endif
+
+
 void TCPWrap::OnConnection(uv_stream_t* handle, int status) {
   HandleScope scope;
+  TCPStatics* statics = NODE_STATICS_LOOP(node_tcp_wrap,
+                                          TCPStatics,
+                                          handle->loop);
 
   TCPWrap* wrap = static_cast<TCPWrap*>(handle->data);
   assert(&wrap->handle_ == (uv_tcp_t*)handle);
@@ -362,6 +791,17 @@ void TCPWrap::OnConnection(uv_stream_t* handle, int status) {
 
   Handle<Value> argv[1];
 
+  // Turn everything that is waiting away while overloaded. Javascript only
+  // hears of the change, after the accepts, as it may close the server.
+  bool overload_changed = status == 0 && wrap->UpdateOverload();
+  if (wrap->overloaded_ && status == 0) {
+    do {
+      wrap->RejectConnection();
+    } while (uv_accept_next(handle) == 1);
+    if (overload_changed) wrap->NotifyOverload();
+    return;
+  }
+
   if (status == 0) {
     // Instantiate the client javascript object and handle.
     Local<Object> client_obj = Instantiate();
@@ -376,6 +816,27 @@ void TCPWrap::OnConnection(uv_stream_t* handle, int status) {
     // uv_accept should always work.
     assert(r == 0);
 
+    if (wrap->accept_batch_size_ > 1) {
+      Local<Array> clients = Array::New();
+      clients->Set(0, client_obj);
+
+      // Errors are left for the next regular accept to report.
+      int count = 1;
+      while (count < wrap->accept_batch_size_ && uv_accept_next(handle) == 1) {
+        client_obj = Instantiate();
+        client_wrap =
+            static_cast<TCPWrap*>(client_obj->GetPointerFromInternalField(0));
+        r = uv_accept(handle, (uv_stream_t*)&client_wrap->handle_);
+        assert(r == 0);
+        clients->Set(count++, client_obj);
+      }
+
+      argv[0] = clients;
+      MakeCallback(wrap->object_, statics->onconnectionbatch_symbol, 1, argv);
+      if (overload_changed) wrap->NotifyOverload();
+      return;
+    }
+
     // Successful accept. Call the onconnection callback in JavaScript land.
     argv[0] = client_obj;
   } else {
@@ -383,7 +844,8 @@ void TCPWrap::OnConnection(uv_stream_t* handle, int status) {
     argv[0] = v8::Null();
   }
 
-  MakeCallback(wrap->object_, "onconnection", 1, argv);
+  MakeCallback(wrap->object_, statics->onconnection_symbol, 1, argv);
+  if (overload_changed) wrap->NotifyOverload();
 }
 
 
@@ -391,28 +853,94 @@ void TCPWrap::AfterConnect(uv_connect_t* req, int status) {
   ConnectWrap* req_wrap = (ConnectWrap*) req->data;
   TCPWrap* wrap = (TCPWrap*) req->handle->data;
 
-  HandleScope scope;
+  assert(req_wrap == wrap->connect_req_);
+  wrap->connect_req_ = NULL;
+  if (wrap->connect_timer_) uv_timer_stop(wrap->connect_timer_);
 
-  // The wrap and request objects should still be there.
-  assert(req_wrap->object_.IsEmpty() == false);
-  assert(wrap->object_.IsEmpty() == false);
+  // javascript was told about the timeout already.
+  if (wrap->connect_timed_out_) {
+    wrap->connect_timed_out_ = false;
+    delete req_wrap;
+    return;
+  }
 
   if (status) {
     SetLastErrno();
   }
 
+  wrap->ConnectDone(req_wrap, status);
+
+  delete req_wrap;
+}
+
+
+void TCPWrap::OnConnectTimeout(uv_timer_t* timer, int status) {
+  TCPWrap* wrap = static_cast<TCPWrap*>(timer->data);
+
+  assert(wrap->connect_req_ != NULL);
+  wrap->connect_timed_out_ = true;
+
+  uv_err_t err;
+  err.code = UV_ETIMEDOUT;
+  SetErrno(err);
+
+  wrap->ConnectDone(wrap->connect_req_, -1);
+}
+
+
+void TCPWrap::OnConnectTimerClose(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_timer_t*>(handle);
+}
+
+
+// Calls req.oncomplete(status, handle, req).
+void TCPWrap::ConnectDone(ConnectWrap* req_wrap, int status) {
+  HandleScope scope;
+
+  // The wrap and request objects should still be there.
+  assert(req_wrap->object_.IsEmpty() == false);
+  assert(object_.IsEmpty() == false);
+
   Local<Value> argv[3] = {
     Integer::New(status),
-    Local<Value>::New(wrap->object_),
+    Local<Value>::New(object_),
     Local<Value>::New(req_wrap->object_)
   };
 
-  MakeCallback(req_wrap->object_, "oncomplete", 3, argv);
+  TCPStatics* statics = NODE_STATICS_LOOP(node_tcp_wrap,
+                                          TCPStatics,
+                                          handle_.loop);
+  MakeCallback(req_wrap->object_, statics->oncomplete_symbol, 3, argv);
+}
+
 
-  delete req_wrap;
+// With a timeout, the connect fails with ETIMEDOUT when it hasn't completed
+// after that many milliseconds.
+void TCPWrap::ConnectStarted(ConnectWrap* req_wrap, int64_t timeout) {
+  connect_req_ = req_wrap;
+  connect_timed_out_ = false;
+
+  if (timeout <= 0) return;
+
+  if (connect_timer_ == NULL) {
+    connect_timer_ = new uv_timer_t;
+    int r = uv_timer_init(handle_.loop, connect_timer_);
+    assert(r == 0);
+    connect_timer_->data = this;
+    // The connecting handle keeps the loop alive, the timer doesn't have to.
+    uv_unref(handle_.loop);
+  }
+
+  int r = uv_timer_start(connect_timer_, OnConnectTimeout, timeout, 0);
+  assert(r == 0);
 }
 
 
+// connect(address, port, [timeout])
+//
+// Returns the request, whose oncomplete(status, handle, req) is called once
+// the connection is established or has failed, or null if it could not be
+// started.
 Handle<Value> TCPWrap::Connect(const Arguments& args) {
   HandleScope scope;
 
@@ -438,11 +966,13 @@ Handle<Value> TCPWrap::Connect(const Arguments& args) {
     delete req_wrap;
     return scope.Close(v8::Null());
   } else {
+    wrap->ConnectStarted(req_wrap, args[2]->IntegerValue());
     return scope.Close(req_wrap->object_);
   }
 }
 
 
+// connect6(address, port, [timeout])
 Handle<Value> TCPWrap::Connect6(const Arguments& args) {
   HandleScope scope;
 
@@ -465,6 +995,7 @@ Handle<Value> TCPWrap::Connect6(const Arguments& args) {
     delete req_wrap;
     return scope.Close(v8::Null());
   } else {
+    wrap->ConnectStarted(req_wrap, args[2]->IntegerValue());
     return scope.Close(req_wrap->object_);
   }
 }
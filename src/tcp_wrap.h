@@ -25,6 +25,9 @@
 
 namespace node {
 
+template <typename T> class ReqWrap;
+typedef class ReqWrap<uv_connect_t> ConnectWrap;
+
 class TCPWrap : public StreamWrap {
  public:
   static v8::Local<v8::Object> Instantiate();
@@ -40,12 +43,20 @@ class TCPWrap : public StreamWrap {
   static v8::Handle<v8::Value> GetPeerName(const v8::Arguments& args);
   static v8::Handle<v8::Value> SetNoDelay(const v8::Arguments& args);
   static v8::Handle<v8::Value> SetKeepAlive(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetDeferAccept(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetFastOpen(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetPendingAccepts(const v8::Arguments& args);
   static v8::Handle<v8::Value> Bind(const v8::Arguments& args);
   static v8::Handle<v8::Value> Bind6(const v8::Arguments& args);
   static v8::Handle<v8::Value> Listen(const v8::Arguments& args);
   static v8::Handle<v8::Value> Connect(const v8::Arguments& args);
   static v8::Handle<v8::Value> Connect6(const v8::Arguments& args);
   static v8::Handle<v8::Value> Open(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetAcceptBatchSize(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetOverload(const v8::Arguments& args);
+#ifdef __linux__
+  static v8::Handle<v8::Value> GetListenQueue(const v8::Arguments& args);
+#endif
 
 #ifdef _WIN32
   static v8::Handle<v8::Value> SetSimultaneousAccepts(const v8::Arguments& args);
@@ -53,8 +64,34 @@ class TCPWrap : public StreamWrap {
 
   static void OnConnection(uv_stream_t* handle, int status);
   static void AfterConnect(uv_connect_t* req, int status);
+  static void OnConnectTimeout(uv_timer_t* timer, int status);
+  static void OnConnectTimerClose(uv_handle_t* handle);
+  void ConnectStarted(ConnectWrap* req_wrap, int64_t timeout);
+  void ConnectDone(ConnectWrap* req_wrap, int status);
+
+  bool UpdateOverload();
+  void NotifyOverload();
+  void RejectConnection();
 
   uv_tcp_t handle_;
+  int accept_batch_size_;
+
+  // The connect in progress, if any, and the timer that ends it early; see
+  // Connect(). A connect that timed out stays pending in libuv until the
+  // handle is closed, its oncomplete has run already.
+  ConnectWrap* connect_req_;
+  uv_timer_t* connect_timer_;
+  bool connect_timed_out_;
+
+  // Load shedding; see SetOverload(). Lags are in nanoseconds, and 0 turns
+  // the criterion off.
+  uint64_t overload_lag_;
+  uint64_t overload_resume_lag_;
+  unsigned int overload_requests_;
+  bool overloaded_;
+  char* overload_response_;
+  size_t overload_response_len_;
+  double overload_rejected_;
 };
 
 
@@ -0,0 +1,495 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node.h>
+#include <handle_wrap.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#define UNWRAP \
+  assert(!args.Holder().IsEmpty()); \
+  assert(args.Holder()->InternalFieldCount() > 0); \
+  TimerWheel* wrap =  \
+      static_cast<TimerWheel*>(args.Holder()->GetPointerFromInternalField(0)); \
+  if (!wrap) { \
+    uv_err_t err; \
+    err.code = UV_EBADF; \
+    SetErrno(err); \
+    return scope.Close(Integer::New(-1)); \
+  }
+
+// The wheel has a resolution of one millisecond. Level 0 holds the next 256
+// milliseconds one slot per millisecond, every level above it has 64 slots
+// that each cover a whole turn of the level below. Whenever level 0 wraps
+// around, the next slot of level 1 is spread out over level 0, and so on up.
+#define ROOT_BITS 8
+#define ROOT_SIZE (1 << ROOT_BITS)
+#define ROOT_MASK (ROOT_SIZE - 1)
+#define LEVEL_BITS 6
+#define LEVEL_SIZE (1 << LEVEL_BITS)
+#define LEVEL_MASK (LEVEL_SIZE - 1)
+#define LEVELS 4
+#define SLOTS (ROOT_SIZE + LEVELS * LEVEL_SIZE)
+// Timeouts further out than this fire at the limit; timers.js re-adds them
+// for the rest of the time.
+#define MAX_DELTA ((int64_t) 1 << (ROOT_BITS + LEVELS * LEVEL_BITS))
+
+#define LEVEL_SHIFT(level) (ROOT_BITS + ((level) - 1) * LEVEL_BITS)
+
+namespace node {
+
+using v8::Object;
+using v8::Handle;
+using v8::Local;
+using v8::Persistent;
+using v8::Value;
+using v8::HandleScope;
+using v8::FunctionTemplate;
+using v8::String;
+using v8::Function;
+using v8::Array;
+using v8::Arguments;
+using v8::Integer;
+
+
+// All setTimeout() and socket timeouts of an isolate, behind one uv timer.
+//
+//   var wheel = new TimerWheel();
+//   var id = wheel.add(msecs, [precise]);
+//   wheel.remove(id);
+//   wheel.ontimeout = function(ids) { ... };
+//
+// Adding and removing a timeout is O(1). ontimeout is called once per expiry
+// with the ids of all timeouts that are due, earliest first. The ids stay
+// reserved until it returns, so a timeout removed by the callback of an
+// earlier one can still be told apart.
+//
+// Unless precise is true, a timeout expires at the isolate's timer slack
+// boundary after msecs, so that the timeouts due around then fire in one
+// batch.
+class TimerWheel : public HandleWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    HandleWrap::Initialize(target);
+
+    Local<FunctionTemplate> constructor = FunctionTemplate::New(New);
+    constructor->InstanceTemplate()->SetInternalFieldCount(1);
+    constructor->SetClassName(String::NewSymbol("TimerWheel"));
+
+    NODE_SET_PROTOTYPE_METHOD(constructor, "close", HandleWrap::Close);
+
+    NODE_SET_PROTOTYPE_METHOD(constructor, "add", Add);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "remove", Remove);
+
+    target->Set(String::NewSymbol("TimerWheel"),
+                constructor->GetFunction());
+  }
+
+ private:
+  enum State { FREE, PENDING, FIRED };
+
+  struct Entry {
+    int64_t expires;
+    int prev;
+    int next;
+    int slot;
+    State state;
+  };
+
+  static Handle<Value> New(const Arguments& args) {
+    // This constructor should not be exposed to public javascript.
+    // Therefore we assert that we are not trying to call this as a
+    // normal function.
+    assert(args.IsConstructCall());
+
+    HandleScope scope;
+    TimerWheel *wrap = new TimerWheel(args.This());
+    assert(wrap);
+
+    return scope.Close(args.This());
+  }
+
+  TimerWheel(Handle<Object> object)
+      : HandleWrap(object, (uv_handle_t*) &handle_) {
+    active_ = false;
+    dispatching_ = false;
+
+    loop_ = Isolate::GetCurrentLoop();
+    int r = uv_timer_init(loop_, &handle_);
+    assert(r == 0);
+
+    handle_.data = this;
+
+    // Like TimerWrap, only hold a loop reference while running.
+    uv_unref(loop_);
+
+    entries_ = NULL;
+    capacity_ = 0;
+    free_ = -1;
+    count_ = 0;
+    root_count_ = 0;
+    for (int i = 0; i < SLOTS; i++) slots_[i] = -1;
+    next_tick_ = uv_now(loop_);
+    wake_at_ = 0;
+
+    fired_ = NULL;
+    fired_count_ = 0;
+    fired_capacity_ = 0;
+  }
+
+  ~TimerWheel() {
+    if (!active_) uv_ref(loop_);
+    free(entries_);
+    free(fired_);
+  }
+
+  void StateChange() {
+    bool was_active = active_;
+    active_ = uv_is_active((uv_handle_t*) &handle_);
+
+    if (!was_active && active_) {
+      uv_ref(loop_);
+    } else if (was_active && !active_) {
+      uv_unref(loop_);
+    }
+  }
+
+  // wheel.add(msecs, [precise]), returns the id of the new timeout
+  static Handle<Value> Add(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    int64_t now = uv_now(wrap->loop_);
+    int64_t msecs = args[0]->IntegerValue();
+    if (msecs < 0) msecs = 0;
+    if (msecs >= MAX_DELTA) msecs = MAX_DELTA - 1;
+
+    // Nothing is pending, so the wheel may as well start from now.
+    if (wrap->count_ == 0) wrap->next_tick_ = now;
+
+    int id = wrap->NewEntry();
+    if (id < 0) {
+      uv_err_t err;
+      err.code = UV_ENOMEM;
+      SetErrno(err);
+      return scope.Close(Integer::New(-1));
+    }
+
+    Entry* e = &wrap->entries_[id];
+    e->expires = now + msecs;
+    if (!args[1]->IsTrue()) {
+      int64_t expires = Isolate::FromLoop(wrap->loop_)->SlackExpiry(e->expires);
+      if (expires - now < MAX_DELTA) e->expires = expires;
+    }
+    e->state = PENDING;
+    wrap->Insert(id);
+    wrap->count_++;
+
+    if (!wrap->dispatching_ && (!wrap->active_ || e->expires < wrap->wake_at_))
+      wrap->Schedule();
+
+    return scope.Close(Integer::New(id));
+  }
+
+  // wheel.remove(id)
+  static Handle<Value> Remove(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    int64_t id = args[0]->IntegerValue();
+    if (id < 0 || id >= wrap->capacity_) return scope.Close(Integer::New(0));
+
+    // Timeouts that have fired are freed once ontimeout returns.
+    if (wrap->entries_[id].state != PENDING)
+      return scope.Close(Integer::New(0));
+
+    wrap->Unlink(id);
+    wrap->FreeEntry(id);
+    wrap->count_--;
+
+    // An empty wheel must not keep the loop alive. Otherwise a timeout that
+    // is gone only makes for an early wakeup.
+    if (wrap->count_ == 0 && !wrap->dispatching_) {
+      uv_timer_stop(&wrap->handle_);
+      wrap->StateChange();
+    }
+
+    return scope.Close(Integer::New(0));
+  }
+
+  int NewEntry() {
+    if (free_ < 0) {
+      int capacity = capacity_ ? capacity_ * 2 : 64;
+      Entry* entries = static_cast<Entry*>(
+          realloc(entries_, capacity * sizeof(Entry)));
+      if (entries == NULL) return -1;
+      for (int i = capacity - 1; i >= capacity_; i--) {
+        entries[i].state = FREE;
+        entries[i].next = free_;
+        free_ = i;
+      }
+      entries_ = entries;
+      capacity_ = capacity;
+    }
+
+    int id = free_;
+    free_ = entries_[id].next;
+    return id;
+  }
+
+  void FreeEntry(int id) {
+    entries_[id].state = FREE;
+    entries_[id].next = free_;
+    free_ = id;
+  }
+
+  // Puts a pending entry into the slot for its expiry, seen from next_tick_.
+  void Insert(int id) {
+    Entry* e = &entries_[id];
+    int64_t delta = e->expires - next_tick_;
+    int slot;
+
+    if (delta < 0) {
+      // Overdue, run it with the next tick.
+      slot = next_tick_ & ROOT_MASK;
+    } else if (delta < ROOT_SIZE) {
+      slot = e->expires & ROOT_MASK;
+    } else {
+      int level = 1;
+      while (level < LEVELS && delta >= (int64_t) 1 << LEVEL_SHIFT(level + 1))
+        level++;
+      slot = ROOT_SIZE + (level - 1) * LEVEL_SIZE +
+             ((e->expires >> LEVEL_SHIFT(level)) & LEVEL_MASK);
+    }
+
+    if (slot < ROOT_SIZE) root_count_++;
+
+    e->slot = slot;
+    e->prev = -1;
+    e->next = slots_[slot];
+    if (e->next >= 0) entries_[e->next].prev = id;
+    slots_[slot] = id;
+  }
+
+  void Unlink(int id) {
+    Entry* e = &entries_[id];
+
+    if (e->prev >= 0) {
+      entries_[e->prev].next = e->next;
+    } else {
+      slots_[e->slot] = e->next;
+    }
+    if (e->next >= 0) entries_[e->next].prev = e->prev;
+
+    if (e->slot < ROOT_SIZE) root_count_--;
+  }
+
+  // The tail of a slot list, its oldest entry.
+  int Last(int id) {
+    if (id < 0) return -1;
+    while (entries_[id].next >= 0) id = entries_[id].next;
+    return id;
+  }
+
+  // Spreads one slot of an upper level out over the levels below it.
+  // Returns the slot index so the caller knows whether this level wrapped.
+  int Cascade(int level) {
+    int index = (next_tick_ >> LEVEL_SHIFT(level)) & LEVEL_MASK;
+    int slot = ROOT_SIZE + (level - 1) * LEVEL_SIZE + index;
+
+    // Oldest first, so that Insert() keeps the order the slot had.
+    int id = Last(slots_[slot]);
+    slots_[slot] = -1;
+    while (id >= 0) {
+      int prev = entries_[id].prev;
+      Insert(id);
+      id = prev;
+    }
+
+    return index;
+  }
+
+  // Moves everything due up to and including `now` onto fired_.
+  void Advance(int64_t now) {
+    while (next_tick_ <= now) {
+      if (count_ == 0) {
+        next_tick_ = now + 1;
+        break;
+      }
+
+      int index = next_tick_ & ROOT_MASK;
+
+      if (index == 0) {
+        for (int level = 1; level <= LEVELS && Cascade(level) == 0; level++);
+      } else if (root_count_ == 0) {
+        // Nothing to run before level 0 wraps around again.
+        int64_t skip = (next_tick_ | ROOT_MASK) + 1;
+        next_tick_ = skip <= now ? skip : now + 1;
+        continue;
+      }
+
+      // The slot list has the most recently added first; fire in the order
+      // the timeouts were added.
+      int id = Last(slots_[index]);
+      slots_[index] = -1;
+
+      while (id >= 0) {
+        int i = id;
+        id = entries_[i].prev;
+        root_count_--;
+        count_--;
+        entries_[i].state = FIRED;
+        if (!PushFired(i)) {
+          // Out of memory; leave it for the next turn of the wheel.
+          entries_[i].state = PENDING;
+          count_++;
+          Insert(i);
+        }
+      }
+
+      next_tick_++;
+    }
+  }
+
+  bool PushFired(int id) {
+    if (fired_count_ == fired_capacity_) {
+      int capacity = fired_capacity_ ? fired_capacity_ * 2 : 64;
+      int* fired = static_cast<int*>(realloc(fired_, capacity * sizeof(int)));
+      if (fired == NULL) return false;
+      fired_ = fired;
+      fired_capacity_ = capacity;
+    }
+    fired_[fired_count_++] = id;
+    return true;
+  }
+
+  // The earliest tick at which Advance() has anything to do.
+  int64_t NextTick() {
+    int64_t next = next_tick_ + MAX_DELTA;
+
+    if (root_count_ > 0) {
+      for (int i = 0; i < ROOT_SIZE; i++) {
+        if (slots_[(next_tick_ + i) & ROOT_MASK] >= 0) {
+          next = next_tick_ + i;
+          break;
+        }
+      }
+    }
+
+    for (int level = 1; level <= LEVELS; level++) {
+      int shift = LEVEL_SHIFT(level);
+      int64_t first = ((next_tick_ + ((int64_t) 1 << shift) - 1) >> shift);
+      for (int i = 0; i < LEVEL_SIZE; i++) {
+        int64_t boundary = (first + i) << shift;
+        if (boundary >= next) break;
+        int slot = ROOT_SIZE + (level - 1) * LEVEL_SIZE +
+                   ((first + i) & LEVEL_MASK);
+        if (slots_[slot] >= 0) {
+          next = boundary;
+          break;
+        }
+      }
+    }
+
+    return next;
+  }
+
+  // (Re)starts the uv timer for the next tick that has work, or stops it
+  // when the wheel is empty.
+  void Schedule() {
+    if (count_ == 0) {
+      uv_timer_stop(&handle_);
+      StateChange();
+      return;
+    }
+
+    int64_t now = uv_now(loop_);
+    wake_at_ = NextTick();
+    int64_t timeout = wake_at_ > now ? wake_at_ - now : 0;
+
+    int r = uv_timer_start(&handle_, OnTimeout, timeout, 0);
+    assert(r == 0);
+    StateChange();
+  }
+
+  static void OnTimeout(uv_timer_t* handle, int status) {
+    HandleScope scope;
+
+    TimerWheel* wrap = static_cast<TimerWheel*>(handle->data);
+    assert(wrap);
+
+    wrap->StateChange();
+    wrap->Advance(uv_now(wrap->loop_));
+
+    if (wrap->fired_count_ > 0) {
+      Local<Array> ids = Array::New(wrap->fired_count_);
+      for (int i = 0; i < wrap->fired_count_; i++) {
+        ids->Set(i, Integer::New(wrap->fired_[i]));
+      }
+
+      wrap->dispatching_ = true;
+      Local<Value> argv[1] = { ids };
+      MakeCallback(wrap->object_, "ontimeout", 1, argv);
+      wrap->dispatching_ = false;
+
+      for (int i = 0; i < wrap->fired_count_; i++) {
+        wrap->FreeEntry(wrap->fired_[i]);
+      }
+      wrap->fired_count_ = 0;
+    }
+
+    wrap->Schedule();
+  }
+
+  uv_timer_t handle_;
+  uv_loop_t* loop_;
+  // Mirrors TimerWrap::active_, the loop is held only while running.
+  bool active_;
+  // Set while ontimeout runs; Schedule() is left until it returns.
+  bool dispatching_;
+
+  Entry* entries_;
+  int capacity_;
+  int free_;
+  // pending timeouts, and how many of them are on level 0
+  int count_;
+  int root_count_;
+  // heads of the slot lists, level 0 first
+  int slots_[SLOTS];
+  // the next tick Advance() looks at, in uv_now() milliseconds
+  int64_t next_tick_;
+  int64_t wake_at_;
+
+  // ids handed to ontimeout
+  int* fired_;
+  int fired_count_;
+  int fired_capacity_;
+};
+
+
+}  // namespace node
+
+NODE_MODULE(node_timer_wheel, node::TimerWheel::Initialize)
@@ -63,6 +63,8 @@ class TimerWrap : public HandleWrap {
     constructor->SetClassName(String::NewSymbol("Timer"));
 
     NODE_SET_PROTOTYPE_METHOD(constructor, "close", HandleWrap::Close);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "unref", HandleWrap::Unref);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "ref", HandleWrap::Ref);
 
     NODE_SET_PROTOTYPE_METHOD(constructor, "start", Start);
     NODE_SET_PROTOTYPE_METHOD(constructor, "stop", Stop);
@@ -87,8 +89,10 @@ class TimerWrap : public HandleWrap {
     return scope.Close(args.This());
   }
 
+  // The timer lists of lib/timers.js are shared by every setTimeout() of
+  // the same duration, so timers keep no async context.
   TimerWrap(Handle<Object> object)
-      : HandleWrap(object, (uv_handle_t*) &handle_) {
+      : HandleWrap(object, (uv_handle_t*) &handle_, false) {
     active_ = false;
 
     uv_loop_t *loop = Isolate::GetCurrentLoop();
@@ -130,6 +134,19 @@ class TimerWrap : public HandleWrap {
     int64_t timeout = args[0]->IntegerValue();
     int64_t repeat = args[1]->IntegerValue();
 
+    // start(timeout, repeat, [precise]). Other than precise timers, those
+    // with a timeout start on a timer slack boundary and repeat in whole
+    // multiples of the slack, which keeps them on the boundaries.
+    Isolate* isolate = Isolate::FromLoop(wrap->handle_.loop);
+    if (isolate->timer_slack > 0 && !args[2]->IsTrue()) {
+      int64_t slack = isolate->timer_slack;
+      if (timeout > 0) {
+        int64_t now = uv_now(wrap->handle_.loop);
+        timeout = isolate->SlackExpiry(now + timeout) - now;
+      }
+      if (repeat > 0) repeat = (repeat + slack - 1) / slack * slack;
+    }
+
     int r = uv_timer_start(&wrap->handle_, OnTimeout, timeout, repeat);
 
     // Error starting the timer.
@@ -69,10 +69,20 @@ class TTYWrap : StreamWrap {
 
     NODE_SET_PROTOTYPE_METHOD(t, "close", HandleWrap::Close);
     NODE_SET_PROTOTYPE_METHOD(t, "unref", HandleWrap::Unref);
+    NODE_SET_PROTOTYPE_METHOD(t, "ref", HandleWrap::Ref);
 
     NODE_SET_PROTOTYPE_METHOD(t, "readStart", StreamWrap::ReadStart);
     NODE_SET_PROTOTYPE_METHOD(t, "readStop", StreamWrap::ReadStop);
     NODE_SET_PROTOTYPE_METHOD(t, "write", StreamWrap::Write);
+    NODE_SET_PROTOTYPE_METHOD(t, "writev", StreamWrap::Writev);
+    NODE_SET_PROTOTYPE_METHOD(t, "writeAsciiString", StreamWrap::WriteAsciiString);
+    NODE_SET_PROTOTYPE_METHOD(t, "writeUtf8String", StreamWrap::WriteUtf8String);
+    NODE_SET_PROTOTYPE_METHOD(t, "tryWrite", StreamWrap::TryWrite);
+    NODE_SET_PROTOTYPE_METHOD(t, "setIdleTimeout", StreamWrap::SetIdleTimeout);
+    NODE_SET_PROTOTYPE_METHOD(t, "setWriteWatermarks",
+                              StreamWrap::SetWriteWatermarks);
+    NODE_SET_PROTOTYPE_METHOD(t, "getWriteQueueSize",
+                              StreamWrap::GetWriteQueueSize);
 
     NODE_SET_PROTOTYPE_METHOD(t, "getWindowSize", TTYWrap::GetWindowSize);
     NODE_SET_PROTOTYPE_METHOD(t, "setRawMode", SetRawMode);
@@ -24,8 +24,10 @@
 
 #include <req_wrap.h>
 #include <handle_wrap.h>
+#include <udp_wrap.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 // Temporary hack: libuv should provide uv_inet_pton and uv_inet_ntop.
 // Clean this up in tcp_wrap.cc too.
@@ -70,34 +72,12 @@ void AddressToJS(Handle<Object> info,
 
 typedef ReqWrap<uv_udp_send_t> SendWrap;
 
-class UDPWrap: public HandleWrap {
-public:
-  static void Initialize(Handle<Object> target);
-  static Handle<Value> New(const Arguments& args);
-  static Handle<Value> Bind(const Arguments& args);
-  static Handle<Value> Send(const Arguments& args);
-  static Handle<Value> Bind6(const Arguments& args);
-  static Handle<Value> Send6(const Arguments& args);
-  static Handle<Value> RecvStart(const Arguments& args);
-  static Handle<Value> RecvStop(const Arguments& args);
-  static Handle<Value> GetSockName(const Arguments& args);
-
-private:
-  UDPWrap(Handle<Object> object);
-  virtual ~UDPWrap();
-
-  static Handle<Value> DoBind(const Arguments& args, int family);
-  static Handle<Value> DoSend(const Arguments& args, int family);
-
-  static uv_buf_t OnAlloc(uv_handle_t* handle, size_t suggested_size);
-  static void OnSend(uv_udp_send_t* req, int status);
-  static void OnRecv(uv_udp_t* handle,
-                     ssize_t nread,
-                     uv_buf_t buf,
-                     struct sockaddr* addr,
-                     unsigned flags);
-
-  uv_udp_t handle_;
+class UDPStatics : public ModuleStatics {
+  Persistent<Function> udpConstructor;
+  Persistent<String> onmessage_sym;
+  Persistent<String> onmessagebatch_sym;
+  Persistent<String> oncomplete_sym;
+  friend class UDPWrap;
 };
 
 
@@ -110,10 +90,42 @@ UDPWrap::UDPWrap(Handle<Object> object): HandleWrap(object,
 
 
 UDPWrap::~UDPWrap() {
+  for (int i = 0; i < ADDRESS_CACHE_SIZE; i++) {
+    if (!address_cache_[i].address.IsEmpty()) {
+      address_cache_[i].address.Dispose();
+      address_cache_[i].address.Clear();
+    }
+  }
+}
+
+
+Local<Object> UDPWrap::Instantiate() {
+  // If this assert fires then process.binding('udp_wrap') hasn't been
+  // called yet.
+  UDPStatics *statics = NODE_STATICS_GET(node_udp_wrap, UDPStatics);
+  assert(statics->udpConstructor.IsEmpty() == false);
+
+  HandleScope scope;
+  Local<Object> obj = statics->udpConstructor->NewInstance();
+
+  return scope.Close(obj);
+}
+
+
+UDPWrap* UDPWrap::Unwrap(Local<Object> obj) {
+  assert(!obj.IsEmpty());
+  assert(obj->InternalFieldCount() > 0);
+  return static_cast<UDPWrap*>(obj->GetPointerFromInternalField(0));
+}
+
+
+uv_udp_t* UDPWrap::UVHandle() {
+  return &handle_;
 }
 
 
 void UDPWrap::Initialize(Handle<Object> target) {
+  NODE_STATICS_NEW(node_udp_wrap, UDPStatics, statics);
   HandleWrap::Initialize(target);
 
   HandleScope scope;
@@ -121,6 +133,9 @@ void UDPWrap::Initialize(Handle<Object> target) {
   buffer_sym = NODE_PSYMBOL("buffer");
   port_symbol = NODE_PSYMBOL("port");
   address_symbol = NODE_PSYMBOL("address");
+  statics->onmessage_sym = NODE_PSYMBOL("onmessage");
+  statics->onmessagebatch_sym = NODE_PSYMBOL("onmessagebatch");
+  statics->oncomplete_sym = NODE_PSYMBOL("oncomplete");
 
   Local<FunctionTemplate> t = FunctionTemplate::New(New);
   t->InstanceTemplate()->SetInternalFieldCount(1);
@@ -130,13 +145,19 @@ void UDPWrap::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(t, "send", Send);
   NODE_SET_PROTOTYPE_METHOD(t, "bind6", Bind6);
   NODE_SET_PROTOTYPE_METHOD(t, "send6", Send6);
+  NODE_SET_PROTOTYPE_METHOD(t, "sendBatch", SendBatch);
+  NODE_SET_PROTOTYPE_METHOD(t, "sendBatch6", SendBatch6);
   NODE_SET_PROTOTYPE_METHOD(t, "close", Close);
+  NODE_SET_PROTOTYPE_METHOD(t, "unref", Unref);
+  NODE_SET_PROTOTYPE_METHOD(t, "ref", Ref);
   NODE_SET_PROTOTYPE_METHOD(t, "recvStart", RecvStart);
   NODE_SET_PROTOTYPE_METHOD(t, "recvStop", RecvStop);
   NODE_SET_PROTOTYPE_METHOD(t, "getsockname", GetSockName);
 
-  target->Set(String::NewSymbol("UDP"),
-              Persistent<FunctionTemplate>::New(t)->GetFunction());
+  statics->udpConstructor = Persistent<Function>::New(t->GetFunction());
+
+  target->Set(String::NewSymbol("UDP"), statics->udpConstructor);
+  NODE_DEFINE_CONSTANT(target, UV_UDP_REUSEPORT);
 }
 
 
@@ -208,7 +229,7 @@ Handle<Value> UDPWrap::DoSend(const Arguments& args, int family) {
   size_t length = args[2]->Uint32Value();
 
   SendWrap* req_wrap = new SendWrap();
-  req_wrap->object_->SetHiddenValue(buffer_sym, buffer_obj);
+  req_wrap->Hold(buffer_sym, buffer_obj);
 
   uv_buf_t buf = uv_buf_init(Buffer::Data(buffer_obj) + offset,
                              length);
@@ -253,13 +274,113 @@ Handle<Value> UDPWrap::Send6(const Arguments& args) {
 }
 
 
+#define SEND_BATCH_STACK 64
+
+// sendBatch(buffers, offsets, lengths, port, address)
+// Sends buffers[i].slice(offsets[i], offsets[i] + lengths[i]) as one
+// datagram each with a single request; oncomplete gets the buffers array.
+Handle<Value> UDPWrap::DoSendBatch(const Arguments& args, int family) {
+  HandleScope scope;
+  int r;
+
+  assert(args.Length() == 5);
+
+  UNWRAP
+
+  assert(args[0]->IsArray());
+  assert(args[1]->IsArray());
+  assert(args[2]->IsArray());
+  Local<Array> buffers = Local<Array>::Cast(args[0]);
+  Local<Array> offsets = Local<Array>::Cast(args[1]);
+  Local<Array> lengths = Local<Array>::Cast(args[2]);
+
+  uint32_t count = buffers->Length();
+  uv_buf_t bufs_stack[SEND_BATCH_STACK];
+  uv_buf_t* bufs = bufs_stack;
+  if (count > SEND_BATCH_STACK) bufs = new uv_buf_t[count];
+
+  for (uint32_t i = 0; i < count; i++) {
+    Local<Value> buffer = buffers->Get(i);
+    assert(Buffer::HasInstance(buffer));
+    size_t offset = offsets->Get(i)->Uint32Value();
+    size_t length = lengths->Get(i)->Uint32Value();
+    assert(offset + length <= Buffer::Length(buffer->ToObject()));
+    bufs[i] = uv_buf_init(Buffer::Data(buffer->ToObject()) + offset, length);
+  }
+
+  SendWrap* req_wrap = new SendWrap();
+  req_wrap->Hold(buffer_sym, buffers);
+
+  const unsigned short port = args[3]->Uint32Value();
+  String::Utf8Value address(args[4]->ToString());
+
+  // libuv keeps a copy of bufs
+  switch (family) {
+  case AF_INET:
+    r = uv_udp_send_batch(&req_wrap->req_, &wrap->handle_, bufs, count,
+                          uv_ip4_addr(*address, port), OnSend);
+    break;
+  case AF_INET6:
+    r = uv_udp_send_batch6(&req_wrap->req_, &wrap->handle_, bufs, count,
+                           uv_ip6_addr(*address, port), OnSend);
+    break;
+  default:
+    assert(0 && "unexpected address family");
+    abort();
+  }
+
+  if (bufs != bufs_stack) delete[] bufs;
+
+  req_wrap->Dispatched();
+
+  if (r) {
+    SetLastErrno();
+    delete req_wrap;
+    return Null();
+  }
+  else {
+    return scope.Close(req_wrap->object_);
+  }
+}
+
+
+Handle<Value> UDPWrap::SendBatch(const Arguments& args) {
+  return DoSendBatch(args, AF_INET);
+}
+
+
+Handle<Value> UDPWrap::SendBatch6(const Arguments& args) {
+  return DoSendBatch(args, AF_INET6);
+}
+
+
+// handle.recvStart([count, slotSize])
+// With a count above 1, up to count datagrams of at most slotSize bytes are
+// read at a time and handed to onmessagebatch(handle, buffer, offsets,
+// lengths, addresses, ports) together, packed into one buffer. Where that
+// isn't supported datagrams go to onmessage() one by one as without count.
 Handle<Value> UDPWrap::RecvStart(const Arguments& args) {
   HandleScope scope;
 
   UNWRAP
 
+  uv_loop_t* loop = Isolate::GetCurrentLoop();
+  int count = args[0]->Int32Value();
+  int slot = args[1]->Int32Value();
+  int r = -1;
+
+  if (count > 1) {
+    r = uv_udp_recv_batch_start(&wrap->handle_,
+                                OnAllocBatch,
+                                OnRecvBatch,
+                                count,
+                                slot > 0 ? slot : 64 * 1024);
+  }
+
   // UV_EALREADY means that the socket is already bound but that's okay
-  int r = uv_udp_recv_start(&wrap->handle_, OnAlloc, OnRecv);
+  if (count <= 1 || (r && uv_last_error(loop).code == UV_ENOSYS)) {
+    r = uv_udp_recv_start(&wrap->handle_, OnAlloc, OnRecv);
+  }
   if (r && uv_last_error(Isolate::GetCurrentLoop()).code != UV_EALREADY) {
     SetLastErrno();
     return False();
@@ -326,7 +447,10 @@ void UDPWrap::OnSend(uv_udp_send_t* req, int status) {
     req_wrap->object_->GetHiddenValue(buffer_sym),
   };
 
-  MakeCallback(req_wrap->object_, "oncomplete", 4, argv);
+  UDPStatics* statics = NODE_STATICS_LOOP(node_udp_wrap,
+                                          UDPStatics,
+                                          req->handle->loop);
+  MakeCallback(req_wrap->object_, statics->oncomplete_sym, 4, argv);
   delete req_wrap;
 }
 
@@ -342,6 +466,95 @@ static void ReleaseMemory(char* data, void* arg) {
 }
 
 
+// Batches get malloc()ed so that the end of a part filled one can be given
+// back.
+uv_buf_t UDPWrap::OnAllocBatch(uv_handle_t* handle, size_t suggested_size) {
+  char* data = static_cast<char*>(malloc(suggested_size));
+  // libuv can't do anything sensible with a failed allocation either.
+  if (data == NULL) abort();
+  return uv_buf_init(data, suggested_size);
+}
+
+
+static void ReleaseBatch(char* data, void* arg) {
+  free(data);
+}
+
+
+static bool SameAddress(const sockaddr_storage* a, const sockaddr_storage* b) {
+  if (a->ss_family != b->ss_family) return false;
+
+  switch (a->ss_family) {
+  case AF_INET:
+    return reinterpret_cast<const sockaddr_in*>(a)->sin_addr.s_addr ==
+           reinterpret_cast<const sockaddr_in*>(b)->sin_addr.s_addr;
+
+  case AF_INET6:
+    return memcmp(&reinterpret_cast<const sockaddr_in6*>(a)->sin6_addr,
+                  &reinterpret_cast<const sockaddr_in6*>(b)->sin6_addr,
+                  sizeof(in6_addr)) == 0;
+
+  default:
+    return false;
+  }
+}
+
+
+static int Port(const sockaddr_storage* addr) {
+  switch (addr->ss_family) {
+  case AF_INET:
+    return ntohs(reinterpret_cast<const sockaddr_in*>(addr)->sin_port);
+
+  case AF_INET6:
+    return ntohs(reinterpret_cast<const sockaddr_in6*>(addr)->sin6_port);
+
+  default:
+    return 0;
+  }
+}
+
+
+Local<String> UDPWrap::AddressString(const sockaddr_storage* addr) {
+  const unsigned char* bytes;
+  size_t len;
+
+  switch (addr->ss_family) {
+  case AF_INET:
+    bytes = reinterpret_cast<const unsigned char*>(
+        &reinterpret_cast<const sockaddr_in*>(addr)->sin_addr);
+    len = sizeof(in_addr);
+    break;
+
+  case AF_INET6:
+    bytes = reinterpret_cast<const unsigned char*>(
+        &reinterpret_cast<const sockaddr_in6*>(addr)->sin6_addr);
+    len = sizeof(in6_addr);
+    break;
+
+  default:
+    return String::Empty();
+  }
+
+  unsigned int hash = 0;
+  for (size_t i = 0; i < len; i++) hash = hash * 31 + bytes[i];
+  AddressCacheEntry* entry = &address_cache_[hash % ADDRESS_CACHE_SIZE];
+
+  if (!entry->address.IsEmpty() && SameAddress(&entry->addr, addr)) {
+    return Local<String>::New(entry->address);
+  }
+
+  char ip[INET6_ADDRSTRLEN];
+  uv_inet_ntop(addr->ss_family, bytes, ip, sizeof ip);
+  Local<String> address = String::New(ip);
+
+  if (!entry->address.IsEmpty()) entry->address.Dispose();
+  entry->address = Persistent<String>::New(address);
+  memcpy(&entry->addr, addr, sizeof entry->addr);
+
+  return address;
+}
+
+
 void UDPWrap::OnRecv(uv_udp_t* handle,
                      ssize_t nread,
                      uv_buf_t buf,
@@ -367,13 +580,78 @@ void UDPWrap::OnRecv(uv_udp_t* handle,
     SetLastErrno();
   }
   else {
+    const sockaddr_storage* peer = reinterpret_cast<sockaddr_storage*>(addr);
     Local<Object> rinfo = Object::New();
-    AddressToJS(rinfo, addr, sizeof *addr);
+    rinfo->Set(address_symbol, wrap->AddressString(peer));
+    rinfo->Set(port_symbol, Integer::New(Port(peer)));
     argv[2] = Buffer::New(buf.base, nread, ReleaseMemory, NULL)->handle_;
     argv[3] = rinfo;
   }
 
-  MakeCallback(wrap->object_, "onmessage", ARRAY_SIZE(argv), argv);
+  UDPStatics* statics = NODE_STATICS_LOOP(node_udp_wrap,
+                                          UDPStatics,
+                                          handle->loop);
+  MakeCallback(wrap->object_, statics->onmessage_sym, ARRAY_SIZE(argv), argv);
+}
+
+
+void UDPWrap::OnRecvBatch(uv_udp_t* handle,
+                          int count,
+                          uv_buf_t buf,
+                          uv_udp_msg_t* msgs) {
+  if (count == 0) {
+    ReleaseBatch(buf.base, NULL);
+    return;
+  }
+
+  HandleScope scope;
+
+  UDPWrap* wrap = reinterpret_cast<UDPWrap*>(handle->data);
+  UDPStatics* statics = NODE_STATICS_LOOP(node_udp_wrap,
+                                          UDPStatics,
+                                          handle->loop);
+
+  if (count == -1) {
+    ReleaseBatch(buf.base, NULL);
+    SetLastErrno();
+    Handle<Value> argv[4] = { wrap->object_, Integer::New(-1), Null(), Null() };
+    MakeCallback(wrap->object_, statics->onmessage_sym, ARRAY_SIZE(argv), argv);
+    return;
+  }
+
+  // The datagrams are packed at the start of buf.
+  size_t total = msgs[count - 1].offset + msgs[count - 1].len;
+  char* data = buf.base;
+  if (total > 0 && total < buf.len) {
+    char* shrunk = static_cast<char*>(realloc(data, total));
+    if (shrunk) data = shrunk;
+  }
+
+  Local<Array> offsets = Array::New(count);
+  Local<Array> lengths = Array::New(count);
+  Local<Array> addresses = Array::New(count);
+  Local<Array> ports = Array::New(count);
+
+  for (int i = 0; i < count; i++) {
+    offsets->Set(i, Integer::NewFromUnsigned(msgs[i].offset));
+    lengths->Set(i, Integer::NewFromUnsigned(msgs[i].len));
+    addresses->Set(i, wrap->AddressString(&msgs[i].addr));
+    ports->Set(i, Integer::New(Port(&msgs[i].addr)));
+  }
+
+  Handle<Value> argv[6] = {
+    wrap->object_,
+    Buffer::New(data, total, ReleaseBatch, NULL)->handle_,
+    offsets,
+    lengths,
+    addresses,
+    ports
+  };
+
+  MakeCallback(wrap->object_,
+               statics->onmessagebatch_sym,
+               ARRAY_SIZE(argv),
+               argv);
 }
 
 
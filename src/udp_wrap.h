@@ -0,0 +1,87 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef UDP_WRAP_H_
+#define UDP_WRAP_H_
+#include <handle_wrap.h>
+
+namespace node {
+
+// Datagrams tend to come from a few senders again and again, so each socket
+// remembers the address strings of the last ones it has seen.
+#define ADDRESS_CACHE_SIZE 8
+
+struct AddressCacheEntry {
+  sockaddr_storage addr;
+  v8::Persistent<v8::String> address;
+};
+
+class UDPWrap: public HandleWrap {
+public:
+  static v8::Local<v8::Object> Instantiate();
+  static UDPWrap* Unwrap(v8::Local<v8::Object> obj);
+  static void Initialize(v8::Handle<v8::Object> target);
+  static v8::Handle<v8::Value> New(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Bind(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Send(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Bind6(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Send6(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SendBatch(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SendBatch6(const v8::Arguments& args);
+  static v8::Handle<v8::Value> RecvStart(const v8::Arguments& args);
+  static v8::Handle<v8::Value> RecvStop(const v8::Arguments& args);
+  static v8::Handle<v8::Value> GetSockName(const v8::Arguments& args);
+
+  uv_udp_t* UVHandle();
+
+private:
+  UDPWrap(v8::Handle<v8::Object> object);
+  virtual ~UDPWrap();
+
+  static v8::Handle<v8::Value> DoBind(const v8::Arguments& args, int family);
+  static v8::Handle<v8::Value> DoSend(const v8::Arguments& args, int family);
+  static v8::Handle<v8::Value> DoSendBatch(const v8::Arguments& args,
+                                           int family);
+
+  static uv_buf_t OnAlloc(uv_handle_t* handle, size_t suggested_size);
+  static uv_buf_t OnAllocBatch(uv_handle_t* handle, size_t suggested_size);
+  static void OnSend(uv_udp_send_t* req, int status);
+  static void OnRecv(uv_udp_t* handle,
+                     ssize_t nread,
+                     uv_buf_t buf,
+                     struct sockaddr* addr,
+                     unsigned flags);
+  static void OnRecvBatch(uv_udp_t* handle,
+                          int count,
+                          uv_buf_t buf,
+                          uv_udp_msg_t* msgs);
+
+  v8::Local<v8::String> AddressString(const sockaddr_storage* addr);
+
+  uv_udp_t handle_;
+  AddressCacheEntry address_cache_[ADDRESS_CACHE_SIZE];
+};
+
+
+}  // namespace node
+
+
+#endif  // UDP_WRAP_H_
@@ -19,15 +19,55 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <math.h>  // fmod, isfinite
+#include <stdint.h>
 #include <stdlib.h>  // calloc, etc
 #include <string.h>  // memmove
 
 #include <v8.h>
 
 #include "v8_typed_array.h"
+#include "node.h"
+#include "node_buffer.h"
+#include "node_statics.h"
 
 namespace {
 
+// Function templates are cached per isolate, so that HasInstance checks
+// see the same template the constructors were made from.
+class TypedArrayStatics : public node::ModuleStatics {
+ public:
+  v8::Persistent<v8::FunctionTemplate> array_buffer;
+  v8::Persistent<v8::FunctionTemplate> typed_array[v8::kExternalPixelArray + 1];
+  v8::Persistent<v8::FunctionTemplate> data_view;
+};
+
+#define TYPED_ARRAY_STATICS() \
+  NODE_STATICS_GET(v8_typed_array, TypedArrayStatics)
+
+// The memory behind an ArrayBuffer. A Buffer made from the ArrayBuffer holds
+// a reference of its own, and the memory goes away with the last reference.
+// For an ArrayBuffer made from a Buffer, `owner` keeps that Buffer, which
+// owns the memory, alive instead.
+struct ArrayBufferStore {
+  int refs;
+  void* data;
+  size_t length;
+  v8::Persistent<v8::Object> owner;
+};
+
+void ReleaseStore(ArrayBufferStore* store) {
+  if (--store->refs > 0) return;
+
+  if (store->owner.IsEmpty()) {
+    v8::V8::AdjustAmountOfExternalAllocatedMemory(-store->length);
+    free(store->data);
+  } else {
+    store->owner.Dispose();
+  }
+  delete store;
+}
+
 v8::Handle<v8::Value> ThrowError(const char* msg) {
   return v8::ThrowException(v8::Exception::Error(v8::String::New(msg)));
 }
@@ -49,14 +89,18 @@ class ArrayBuffer {
  public:
   static v8::Handle<v8::FunctionTemplate> GetTemplate() {
     v8::HandleScope scope;
+    TypedArrayStatics* statics = TYPED_ARRAY_STATICS();
+    if (!statics->array_buffer.IsEmpty()) return statics->array_buffer;
+
     v8::Handle<v8::FunctionTemplate> ft_cache;
 
     ft_cache = v8::Handle<v8::FunctionTemplate>(
         v8::FunctionTemplate::New(&ArrayBuffer::V8New));
     ft_cache->SetClassName(v8::String::New("ArrayBuffer"));
     v8::Local<v8::ObjectTemplate> instance = ft_cache->InstanceTemplate();
-    instance->SetInternalFieldCount(1);  // Buffer.
+    instance->SetInternalFieldCount(2);  // Buffer, ArrayBufferStore.
 
+    statics->array_buffer = v8::Persistent<v8::FunctionTemplate>::New(ft_cache);
     return scope.Close(ft_cache);
   }
 
@@ -64,22 +108,32 @@ class ArrayBuffer {
     return GetTemplate()->HasInstance(value);
   }
 
- private:
-  static void WeakCallback(v8::Persistent<v8::Value> value, void* data) {
-    v8::Object* obj = v8::Object::Cast(*value);
-
-    void* ptr = obj->GetIndexedPropertiesExternalArrayData();
-    int element_size = v8_typed_array::SizeOfArrayElementForType(
-        obj->GetIndexedPropertiesExternalArrayDataType());
-    int size =
-        obj->GetIndexedPropertiesExternalArrayDataLength() * element_size;
+  static ArrayBufferStore* Store(v8::Handle<v8::Object> obj) {
+    return static_cast<ArrayBufferStore*>(obj->GetPointerFromInternalField(1));
+  }
 
-    v8::V8::AdjustAmountOfExternalAllocatedMemory(-size);
+  // Is `value` a Buffer or SlowBuffer, as opposed to the typed arrays that
+  // node::Buffer::HasInstance accepts too?
+  static bool IsNodeBuffer(v8::Handle<v8::Value> value) {
+    if (!node::Buffer::HasInstance(value)) return false;
+
+    TypedArrayStatics* statics = TYPED_ARRAY_STATICS();
+    if (statics->array_buffer->HasInstance(value)) return false;
+    for (int i = 0; i <= v8::kExternalPixelArray; i++) {
+      if (!statics->typed_array[i].IsEmpty() &&
+          statics->typed_array[i]->HasInstance(value)) {
+        return false;
+      }
+    }
+    return !statics->data_view->HasInstance(value);
+  }
 
+ private:
+  static void WeakCallback(v8::Persistent<v8::Value> value, void* data) {
     value.ClearWeak();
     value.Dispose();
 
-    free(ptr);
+    ReleaseStore(static_cast<ArrayBufferStore*>(data));
   }
 
   static v8::Handle<v8::Value> V8New(const v8::Arguments& args) {
@@ -90,17 +144,37 @@ class ArrayBuffer {
     // if (args.Length() != 1)
     //   return ThrowError("Wrong number of arguments.");
 
-    if (args[0]->Int32Value() < 0) {
-      return ThrowRangeError("ArrayBufferView size is not a small enough "
-                             "positive integer.");
+    ArrayBufferStore* store = new ArrayBufferStore();
+    store->refs = 1;
+
+    if (IsNodeBuffer(args[0])) {
+      // new ArrayBuffer(buffer) shares the Buffer's memory.
+      v8::Local<v8::Object> buffer = args[0]->ToObject();
+      store->data = buffer->GetIndexedPropertiesExternalArrayData();
+      store->length = buffer->GetIndexedPropertiesExternalArrayDataLength();
+      store->owner = v8::Persistent<v8::Object>::New(buffer);
+    } else {
+      if (args[0]->Int32Value() < 0) {
+        delete store;
+        return ThrowRangeError("ArrayBufferView size is not a small enough "
+                               "positive integer.");
+      }
+
+      store->length = args[0]->Uint32Value();
+      store->data = calloc(store->length, 1);
+      if (!store->data) {
+        delete store;
+        return ThrowError("Unable to allocate ArrayBuffer.");
+      }
+
+      v8::V8::AdjustAmountOfExternalAllocatedMemory(store->length);
     }
 
-    size_t num_bytes = args[0]->Uint32Value();
-    void* buf = calloc(num_bytes, 1);
-    if (!buf)
-      return ThrowError("Unable to allocate ArrayBuffer.");
+    size_t num_bytes = store->length;
+    void* buf = store->data;
 
     args.This()->SetPointerInInternalField(0, buf);
+    args.This()->SetPointerInInternalField(1, store);
 
     args.This()->Set(v8::String::New("byteLength"),
                      v8::Integer::NewFromUnsigned(num_bytes),
@@ -113,25 +187,200 @@ class ArrayBuffer {
     args.This()->SetIndexedPropertiesToExternalArrayData(
         buf, v8::kExternalUnsignedByteArray, num_bytes);
 
-    v8::V8::AdjustAmountOfExternalAllocatedMemory(num_bytes);
-
     v8::Persistent<v8::Object> persistent =
         v8::Persistent<v8::Object>::New(args.This());
-    persistent.MakeWeak(NULL, &ArrayBuffer::WeakCallback);
+    persistent.MakeWeak(store, &ArrayBuffer::WeakCallback);
 
     return args.This();
   }
 };
 
+// TODO(deanm): This isn't beautiful or optimal.
+static void swizzle(char* buf, size_t len) {
+  for (size_t i = 0; i < len / 2; ++i) {
+    char t = buf[i];
+    buf[i] = buf[len - i - 1];
+    buf[len - i - 1] = t;
+  }
+}
+
+static bool isHostLittleEndian() {
+  const uint16_t probe = 1;
+  return *reinterpret_cast<const char*>(&probe) == 1;
+}
+
+// Copies `count` elements of TBytes bytes, swizzling each one. The element
+// size is a constant here, so the swizzle turns into a byte swap. Like
+// memmove, the ranges may overlap.
+template <unsigned int TBytes>
+static void swizzleCopy(char* dst, const char* src, size_t count) {
+  bool backwards = dst > src && dst < src + count * TBytes;
+  for (size_t n = 0; n < count; ++n) {
+    size_t i = backwards ? count - n - 1 : n;
+    char buf[TBytes];
+    memcpy(buf, src + i * TBytes, TBytes);
+    swizzle(buf, TBytes);
+    memcpy(dst + i * TBytes, buf, TBytes);
+  }
+}
+
 static bool checkAlignment(unsigned int val, unsigned int bytes) {
   return (val & (bytes - 1)) == 0;  // Handles bytes == 0.
 }
 
+// The C type of the elements of each kind of external array.
+template <v8::ExternalArrayType TEAType> struct ElementTraits { };
+template <> struct ElementTraits<v8::kExternalByteArray> {
+  typedef signed char Type;
+};
+template <> struct ElementTraits<v8::kExternalUnsignedByteArray> {
+  typedef unsigned char Type;
+};
+template <> struct ElementTraits<v8::kExternalShortArray> {
+  typedef short Type;
+};
+template <> struct ElementTraits<v8::kExternalUnsignedShortArray> {
+  typedef unsigned short Type;
+};
+template <> struct ElementTraits<v8::kExternalIntArray> {
+  typedef int Type;
+};
+template <> struct ElementTraits<v8::kExternalUnsignedIntArray> {
+  typedef unsigned int Type;
+};
+template <> struct ElementTraits<v8::kExternalFloatArray> {
+  typedef float Type;
+};
+template <> struct ElementTraits<v8::kExternalDoubleArray> {
+  typedef double Type;
+};
+
+static unsigned int elementSize(v8::ExternalArrayType type) {
+  switch (type) {
+    case v8::kExternalShortArray:
+    case v8::kExternalUnsignedShortArray:
+      return 2;
+    case v8::kExternalIntArray:
+    case v8::kExternalUnsignedIntArray:
+    case v8::kExternalFloatArray:
+      return 4;
+    case v8::kExternalDoubleArray:
+      return 8;
+    default:
+      return 1;
+  }
+}
+
+// ECMAScript ToInt32, which V8 applies to numbers stored into integer arrays.
+static int32_t doubleToInt32(double d) {
+  if (d >= -2147483648.0 && d <= 2147483647.0) return static_cast<int32_t>(d);
+  if (!isfinite(d)) return 0;
+  d = fmod(d < 0 ? ceil(d) : floor(d), 4294967296.0);
+  if (d < 0) d += 4294967296.0;
+  return static_cast<int32_t>(static_cast<uint32_t>(d));
+}
+
+// Converts one element the way storing its value through the destination's
+// indexed setter would: integers wrap, floating point goes through ToInt32.
+template <typename Dst>
+struct Convert {
+  template <typename Src>
+  static Dst From(Src v) { return static_cast<Dst>(v); }
+  static Dst From(float v) { return static_cast<Dst>(doubleToInt32(v)); }
+  static Dst From(double v) { return static_cast<Dst>(doubleToInt32(v)); }
+};
+
+template <>
+struct Convert<float> {
+  template <typename Src>
+  static float From(Src v) { return static_cast<float>(v); }
+};
+
+template <>
+struct Convert<double> {
+  template <typename Src>
+  static double From(Src v) { return static_cast<double>(v); }
+};
+
+// Plain loops over raw pointers, which the compiler can vectorize.
+template <typename Dst, typename Src>
+static void convertElements(void* dst, const void* src, size_t count) {
+  Dst* d = reinterpret_cast<Dst*>(dst);
+  const Src* s = reinterpret_cast<const Src*>(src);
+  for (size_t i = 0; i < count; ++i) d[i] = Convert<Dst>::From(s[i]);
+}
+
+template <typename Dst>
+static void convertFrom(v8::ExternalArrayType src_type,
+                        void* dst, const void* src, size_t count) {
+  switch (src_type) {
+    case v8::kExternalByteArray:
+      convertElements<Dst, signed char>(dst, src, count);
+      break;
+    case v8::kExternalShortArray:
+      convertElements<Dst, short>(dst, src, count);
+      break;
+    case v8::kExternalUnsignedShortArray:
+      convertElements<Dst, unsigned short>(dst, src, count);
+      break;
+    case v8::kExternalIntArray:
+      convertElements<Dst, int>(dst, src, count);
+      break;
+    case v8::kExternalUnsignedIntArray:
+      convertElements<Dst, unsigned int>(dst, src, count);
+      break;
+    case v8::kExternalFloatArray:
+      convertElements<Dst, float>(dst, src, count);
+      break;
+    case v8::kExternalDoubleArray:
+      convertElements<Dst, double>(dst, src, count);
+      break;
+    default:  // Uint8 and pixel arrays, Buffers.
+      convertElements<Dst, unsigned char>(dst, src, count);
+      break;
+  }
+}
+
+// Whether convertFrom() knows how to read elements of `type`.
+static bool isElementType(v8::ExternalArrayType type) {
+  switch (type) {
+    case v8::kExternalByteArray:
+    case v8::kExternalUnsignedByteArray:
+    case v8::kExternalShortArray:
+    case v8::kExternalUnsignedShortArray:
+    case v8::kExternalIntArray:
+    case v8::kExternalUnsignedIntArray:
+    case v8::kExternalFloatArray:
+    case v8::kExternalDoubleArray:
+    case v8::kExternalPixelArray:
+      return true;
+    default:
+      return false;
+  }
+}
+
+template <typename T>
+T valueToCType(v8::Handle<v8::Value> value);
+
+// Whether `obj` is a typed array or a Buffer, whose elements can be read
+// straight from their memory. ArrayBuffers and DataViews have external data
+// too but no elements of their own.
+static bool hasElementData(v8::Handle<v8::Object> obj) {
+  return obj->HasIndexedPropertiesInExternalArrayData() &&
+         !ArrayBuffer::HasInstance(obj) &&
+         !TYPED_ARRAY_STATICS()->data_view->HasInstance(obj);
+}
+
 template <unsigned int TBytes, v8::ExternalArrayType TEAType>
 class TypedArray {
  public:
   static v8::Handle<v8::FunctionTemplate> GetTemplate() {
     v8::HandleScope scope;
+    TypedArrayStatics* statics = TYPED_ARRAY_STATICS();
+    if (!statics->typed_array[TEAType].IsEmpty()) {
+      return statics->typed_array[TEAType];
+    }
+
     v8::Handle<v8::FunctionTemplate> ft_cache;
 
     ft_cache = v8::Handle<v8::FunctionTemplate>(
@@ -159,6 +408,8 @@ class TypedArray {
                                               default_signature));
     }
 
+    statics->typed_array[TEAType] =
+        v8::Persistent<v8::FunctionTemplate>::New(ft_cache);
     return scope.Close(ft_cache);
   }
 
@@ -179,8 +430,26 @@ class TypedArray {
     unsigned int length = 0;
     unsigned int byte_offset = 0;
 
-    if (ArrayBuffer::HasInstance(args[0])) {  // ArrayBuffer constructor.
-      buffer = v8::Local<v8::Object>::Cast(args[0]);
+    // new Type(buffer, byteOffset[, length]) views the memory of a Buffer
+    // like new Type(new ArrayBuffer(buffer), ...) does. The elements must
+    // be aligned in memory, not only relative to the start of the Buffer.
+    bool buffer_view = args.Length() > 1 && ArrayBuffer::IsNodeBuffer(args[0]);
+    if (buffer_view) {
+      v8::Local<v8::Object> data = args[0]->ToObject();
+      uintptr_t ptr = reinterpret_cast<uintptr_t>(
+          data->GetIndexedPropertiesExternalArrayData());
+      if (!checkAlignment(ptr + args[1]->Uint32Value(), TBytes))
+        return ThrowRangeError("Buffer data is not aligned.");
+    }
+
+    if (buffer_view || ArrayBuffer::HasInstance(args[0])) {
+      if (buffer_view) {
+        v8::Handle<v8::Value> argv[1] = { args[0] };
+        buffer = ArrayBuffer::GetTemplate()->
+                   GetFunction()->NewInstance(1, argv);
+      } else {
+        buffer = v8::Local<v8::Object>::Cast(args[0]);
+      }
       unsigned int buflen =
           buffer->GetIndexedPropertiesExternalArrayDataLength();
 
@@ -227,10 +496,7 @@ class TypedArray {
       args.This()->SetIndexedPropertiesToExternalArrayData(
           buf, TEAType, length);
       // TODO(deanm): check for failure.
-      for (uint32_t i = 0; i < length; ++i) {
-        // Use the v8 setter to deal with typing.  Maybe slow?
-        args.This()->Set(i, obj->Get(i));
-      }
+      copyElements(buf, obj, length);
     } else {  // length constructor.
       // Try to match Chrome, Float32Array(""), Float32Array(true/false) is
       // okay, but Float32Array(null) throws a TypeError and
@@ -283,11 +549,6 @@ class TypedArray {
     v8::Handle<v8::Object> obj = v8::Handle<v8::Object>::Cast(args[0]);
 
     if (TypedArray<TBytes, TEAType>::HasInstance(obj)) {  // ArrayBufferView.
-      v8::Handle<v8::Object> src_buffer = v8::Handle<v8::Object>::Cast(
-          obj->Get(v8::String::New("buffer")));
-      v8::Handle<v8::Object> dst_buffer = v8::Handle<v8::Object>::Cast(
-          args.This()->Get(v8::String::New("buffer")));
-
       if (args[1]->Int32Value() < 0)
         return ThrowRangeError("Offset may not be negative.");
 
@@ -302,6 +563,10 @@ class TypedArray {
       if (src_length > dst_length - offset)
         return ThrowRangeError("Offset/length out of range.");
 
+      if (src_length > static_cast<unsigned int>(
+              obj->GetIndexedPropertiesExternalArrayDataLength()))
+        return ThrowRangeError("Length out of range.");
+
       // We don't want to get the buffer pointer, because that means we'll have
       // to just do the calculations for byteOffset / byteLength again.
       // Instead just use the pointer on the external array data.
@@ -316,7 +581,7 @@ class TypedArray {
       // temporary buffer is copied into the current array.
       memmove(reinterpret_cast<char*>(dst_ptr) + offset * TBytes,
               src_ptr, src_length * TBytes);
-    } else {  // type[]
+    } else {  // type[], other typed arrays and Buffers
       if (args[1]->Int32Value() < 0)
         return ThrowRangeError("Offset may not be negative.");
 
@@ -332,15 +597,54 @@ class TypedArray {
       if (src_length > dst_length - offset)
         return ThrowRangeError("Offset/length out of range.");
 
-      for (uint32_t i = 0; i < src_length; ++i) {
-        // Use the v8 setter to deal with typing.  Maybe slow?
-        args.This()->Set(i + offset, obj->Get(i));
-      }
+      char* dst_ptr = reinterpret_cast<char*>(
+          args.This()->GetIndexedPropertiesExternalArrayData());
+      copyElements(dst_ptr + offset * TBytes, obj, src_length);
     }
 
     return v8::Undefined();
   }
 
+  // Stores the first `count` elements of `src` at `dst`. Typed arrays and
+  // Buffers are converted straight from their memory, anything else goes
+  // through Get() but skips the indexed setter.
+  static void copyElements(void* dst, v8::Handle<v8::Object> src,
+                           unsigned int count) {
+    typedef typename ElementTraits<TEAType>::Type T;
+
+    // `count` comes from the source's length property, which javascript can
+    // set to anything, so its memory is only read as far as it goes.
+    bool direct = hasElementData(src) &&
+        isElementType(src->GetIndexedPropertiesExternalArrayDataType()) &&
+        count <= static_cast<uint32_t>(
+            src->GetIndexedPropertiesExternalArrayDataLength());
+
+    if (!direct) {
+      T* d = reinterpret_cast<T*>(dst);
+      for (uint32_t i = 0; i < count; ++i) d[i] = valueToCType<T>(src->Get(i));
+      return;
+    }
+
+    v8::ExternalArrayType src_type =
+        src->GetIndexedPropertiesExternalArrayDataType();
+    const char* src_ptr = reinterpret_cast<const char*>(
+        src->GetIndexedPropertiesExternalArrayData());
+    size_t src_bytes = count * elementSize(src_type);
+
+    // As the spec asks for views of one ArrayBuffer, convert from a copy
+    // when the ranges overlap.
+    char* tmp = NULL;
+    const char* d = reinterpret_cast<const char*>(dst);
+    if (src_ptr < d + count * TBytes && d < src_ptr + src_bytes) {
+      tmp = new char[src_bytes];
+      memcpy(tmp, src_ptr, src_bytes);
+      src_ptr = tmp;
+    }
+
+    convertFrom<T>(src_type, dst, src_ptr, count);
+    delete[] tmp;
+  }
+
   static v8::Handle<v8::Value> subarray(const v8::Arguments& args) {
     // TODO(deanm): The unsigned / signed type mixing makes me super nervous.
 
@@ -434,6 +738,11 @@ T valueToCType(v8::Handle<v8::Value> value) {
   return 0;
 }
 
+template <>
+signed char valueToCType(v8::Handle<v8::Value> value) {
+  return value->Int32Value();
+}
+
 template <>
 unsigned char valueToCType(v8::Handle<v8::Value> value) {
   return value->Uint32Value();
@@ -479,6 +788,9 @@ class DataView {
  public:
   static v8::Handle<v8::FunctionTemplate> GetTemplate() {
     v8::HandleScope scope;
+    TypedArrayStatics* statics = TYPED_ARRAY_STATICS();
+    if (!statics->data_view.IsEmpty()) return statics->data_view;
+
     v8::Handle<v8::FunctionTemplate> ft_cache;
 
     ft_cache = v8::Handle<v8::FunctionTemplate>(
@@ -515,6 +827,7 @@ class DataView {
                                               default_signature));
     }
 
+    statics->data_view = v8::Persistent<v8::FunctionTemplate>::New(ft_cache);
     return scope.Close(ft_cache);
   }
 
@@ -577,15 +890,6 @@ class DataView {
     return args.This();
   }
 
-  // TODO(deanm): This isn't beautiful or optimal.
-  static void swizzle(char* buf, size_t len) {
-    for (size_t i = 0; i < len / 2; ++i) {
-      char t = buf[i];
-      buf[i] = buf[len - i - 1];
-      buf[len - i - 1] = t;
-    }
-  }
-
   template <typename T>
   static T getValue(void* ptr, unsigned int index, bool swiz) {
     char buf[sizeof(T)];
@@ -717,27 +1021,106 @@ class DataView {
 
 namespace v8_typed_array {
 
+static const char* binding_names[] = {
+  "ArrayBuffer", "Int8Array", "Uint8Array", "Int16Array", "Uint16Array",
+  "Int32Array", "Uint32Array", "Float32Array", "Float64Array", "DataView"
+};
+
+static void DefineBindings(v8::Handle<v8::Object> obj) {
+  NODE_STATICS_NEW(v8_typed_array, TypedArrayStatics, statics);
+
+  // Build every template up front; ArrayBuffer's constructor looks at all
+  // of them.
+  DataView::GetTemplate();
+
+  v8::Handle<v8::Function> ctors[] = {
+    ArrayBuffer::GetTemplate()->GetFunction(),
+    Int8Array::GetTemplate()->GetFunction(),
+    Uint8Array::GetTemplate()->GetFunction(),
+    Int16Array::GetTemplate()->GetFunction(),
+    Uint16Array::GetTemplate()->GetFunction(),
+    Int32Array::GetTemplate()->GetFunction(),
+    Uint32Array::GetTemplate()->GetFunction(),
+    Float32Array::GetTemplate()->GetFunction(),
+    Float64Array::GetTemplate()->GetFunction(),
+    DataView::GetTemplate()->GetFunction()
+  };
+
+  // Replace the lazy accessors that are left with the constructors
+  // themselves. A name the script has assigned to keeps its value.
+  for (size_t i = 0; i < sizeof(binding_names) / sizeof(binding_names[0]);
+       i++) {
+    v8::Local<v8::String> name = v8::String::NewSymbol(binding_names[i]);
+    if (!obj->HasRealNamedCallbackProperty(name)) continue;
+    obj->ForceDelete(name);
+    obj->Set(name, ctors[i]);
+  }
+}
+
+static v8::Handle<v8::Value> LazyGetter(v8::Local<v8::String> name,
+                                        const v8::AccessorInfo& info) {
+  v8::HandleScope scope;
+  v8::Local<v8::Object> holder = info.Holder();
+  DefineBindings(holder);
+  return scope.Close(holder->Get(name));
+}
+
+static void LazySetter(v8::Local<v8::String> name,
+                       v8::Local<v8::Value> value,
+                       const v8::AccessorInfo& info) {
+  v8::HandleScope scope;
+  v8::Local<v8::Object> holder = info.Holder();
+  // Only this name; the other accessors stay until one of them is read.
+  if (holder->HasRealNamedCallbackProperty(name)) holder->ForceDelete(name);
+  holder->Set(name, value);
+}
+
+// The templates are built on first use of any of the constructors, so that
+// isolates which never touch typed arrays don't pay for them. Until then no
+// object can be an ArrayBuffer.
 void AttachBindings(v8::Handle<v8::Object> obj) {
-  obj->Set(v8::String::New("ArrayBuffer"),
-           ArrayBuffer::GetTemplate()->GetFunction());
-  obj->Set(v8::String::New("Int8Array"),
-           Int8Array::GetTemplate()->GetFunction());
-  obj->Set(v8::String::New("Uint8Array"),
-           Uint8Array::GetTemplate()->GetFunction());
-  obj->Set(v8::String::New("Int16Array"),
-           Int16Array::GetTemplate()->GetFunction());
-  obj->Set(v8::String::New("Uint16Array"),
-           Uint16Array::GetTemplate()->GetFunction());
-  obj->Set(v8::String::New("Int32Array"),
-           Int32Array::GetTemplate()->GetFunction());
-  obj->Set(v8::String::New("Uint32Array"),
-           Uint32Array::GetTemplate()->GetFunction());
-  obj->Set(v8::String::New("Float32Array"),
-           Float32Array::GetTemplate()->GetFunction());
-  obj->Set(v8::String::New("Float64Array"),
-           Float64Array::GetTemplate()->GetFunction());
-  obj->Set(v8::String::New("DataView"),
-           DataView::GetTemplate()->GetFunction());
+  for (size_t i = 0; i < sizeof(binding_names) / sizeof(binding_names[0]);
+       i++) {
+    obj->SetAccessor(v8::String::NewSymbol(binding_names[i]),
+                     LazyGetter,
+                     LazySetter);
+  }
+}
+
+bool IsArrayBuffer(v8::Handle<v8::Value> value) {
+  if (!TYPED_ARRAY_STATICS()) return false;
+  return ArrayBuffer::HasInstance(value);
+}
+
+char* RetainArrayBufferData(v8::Handle<v8::Object> obj,
+                            size_t* length,
+                            void** hint) {
+  ArrayBufferStore* store = ArrayBuffer::Store(obj);
+  store->refs++;
+  *length = store->length;
+  *hint = store;
+  return static_cast<char*>(store->data);
+}
+
+void ReleaseArrayBufferData(char* data, void* hint) {
+  ReleaseStore(static_cast<ArrayBufferStore*>(hint));
+}
+
+void CopyElements(char* dst,
+                  const char* src,
+                  size_t count,
+                  int element_size,
+                  bool little_endian) {
+  if (element_size == 1 || little_endian == isHostLittleEndian()) {
+    memmove(dst, src, count * element_size);
+    return;
+  }
+
+  switch (element_size) {
+    case 2: swizzleCopy<2>(dst, src, count); break;
+    case 4: swizzleCopy<4>(dst, src, count); break;
+    case 8: swizzleCopy<8>(dst, src, count); break;
+  }
 }
 
 int SizeOfArrayElementForType(v8::ExternalArrayType type) {
@@ -759,4 +1142,13 @@ int SizeOfArrayElementForType(v8::ExternalArrayType type) {
   }
 }
 
+bool HasExternalElements(v8::Handle<v8::Object> obj,
+                         v8::ExternalArrayType type,
+                         size_t length) {
+  return obj->HasIndexedPropertiesInExternalArrayData() &&
+         obj->GetIndexedPropertiesExternalArrayDataType() == type &&
+         static_cast<size_t>(
+             obj->GetIndexedPropertiesExternalArrayDataLength()) >= length;
+}
+
 }  // namespace v8_typed_array
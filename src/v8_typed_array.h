@@ -28,8 +28,34 @@ namespace v8_typed_array {
 
 void AttachBindings(v8::Handle<v8::Object> obj);
 
+bool IsArrayBuffer(v8::Handle<v8::Value> value);
+
+// Returns the memory behind an ArrayBuffer and takes a reference on it, so
+// that it outlives the ArrayBuffer. Hand `hint` to ReleaseArrayBufferData
+// to drop the reference; it has the signature of a Buffer free_callback.
+char* RetainArrayBufferData(v8::Handle<v8::Object> obj,
+                            size_t* length,
+                            void** hint);
+void ReleaseArrayBufferData(char* data, void* hint);
+
+// Copies `count` elements of `element_size` bytes from `src` to `dst`,
+// converting between host byte order and little or big endian. The
+// conversion is its own inverse, so this works in both directions.
+void CopyElements(char* dst,
+                  const char* src,
+                  size_t count,
+                  int element_size,
+                  bool little_endian);
+
 int SizeOfArrayElementForType(v8::ExternalArrayType type);
 
+// Whether `obj` keeps at least `length` elements of `type` in external
+// memory, which native code may then write directly. Check arrays made with
+// a global constructor too: script can replace the constructor.
+bool HasExternalElements(v8::Handle<v8::Object> obj,
+                         v8::ExternalArrayType type,
+                         size_t length);
+
 }  // namespace v8_typed_array
 
 #endif  // V8_TYPED_ARRAY_H_
@@ -82,6 +82,8 @@ process.on('exit', function() {
                       setInterval,
                       clearTimeout,
                       clearInterval,
+                      setImmediate,
+                      clearImmediate,
                       console,
                       Buffer,
                       process,
@@ -0,0 +1,66 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Flags: --expose_gc
+
+var common = require('../common');
+var assert = require('assert');
+
+assert.throws(function() {
+  Buffer.setAllocationSampling(-1);
+}, TypeError);
+
+Buffer.setAllocationSampling(16 * 1024);
+
+function leakyAllocator(list) {
+  for (var i = 0; i < 50; i++) {
+    list.push(new Buffer(1024 * 1024));
+  }
+}
+
+var held = [];
+leakyAllocator(held);
+
+// Buffers much larger than the interval are always sampled.
+var profile = Buffer.allocationProfile();
+var site = profile.filter(function(entry) {
+  return entry.stack.some(function(frame) {
+    return /^leakyAllocator /.test(frame);
+  });
+})[0];
+
+assert.ok(site);
+assert.equal(site.count, 50);
+var expected = 50 * 1024 * 1024;
+assert.ok(site.bytes >= expected && site.bytes < expected * 1.01);
+assert.equal(profile[0], site);
+
+// Sites drop out once their buffers are freed.
+Buffer.setAllocationSampling(0);
+held = null;
+gc();
+
+profile = Buffer.allocationProfile();
+assert.ok(profile.every(function(entry) {
+  return entry.stack.every(function(frame) {
+    return !/^leakyAllocator /.test(frame);
+  });
+}));
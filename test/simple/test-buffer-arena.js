@@ -0,0 +1,70 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Flags: --expose_gc
+
+var common = require('../common');
+var assert = require('assert');
+var SlowBuffer = require('buffer').SlowBuffer;
+
+var before = Buffer.arenaStats();
+['liveBytes', 'reservedBytes', 'cachedBytes', 'depotBytes', 'hits', 'misses',
+ 'fragmentation'].forEach(function(key) {
+  assert.equal(typeof before[key], 'number', key);
+});
+
+// Small buffers come from the JS pool and larger ones from malloc; only the
+// range in between is served by the arena.
+new SlowBuffer(4096);
+new SlowBuffer(1024 * 1024 + 1);
+var stats = Buffer.arenaStats();
+assert.equal(stats.liveBytes, before.liveBytes);
+assert.equal(stats.hits + stats.misses, before.hits + before.misses);
+
+var b = new SlowBuffer(9000);
+stats = Buffer.arenaStats();
+assert.equal(stats.liveBytes, before.liveBytes + 9000);
+// 9000 bytes round up to the 10KB class.
+assert.equal(stats.reservedBytes, before.reservedBytes + 10 * 1024);
+assert.equal(stats.hits + stats.misses, before.hits + before.misses + 1);
+assert.ok(stats.fragmentation > 0 && stats.fragmentation < 1);
+
+// Storage is usable over its whole length.
+b.fill(0x61, 0, b.length);
+b[8999] = 0x62;
+assert.equal(b.toString('ascii', 8998), 'ab');
+
+// Every size class, plus its edges, round trips data.
+[4097, 8192, 8193, 10240, 10241, 65536, 100000, 524289, 1024 * 1024].forEach(
+  function(len) {
+    var buf = new Buffer(len);
+    buf.fill(len & 0xff);
+    assert.equal(buf[0], len & 0xff);
+    assert.equal(buf[len - 1], len & 0xff);
+  });
+
+// Freed blocks are cached and reused for the next buffer of the class.
+b = null;
+gc();
+var freed = Buffer.arenaStats();
+assert.ok(freed.cachedBytes > 0);
+new SlowBuffer(9500);
+assert.equal(Buffer.arenaStats().hits, freed.hits + 1);
@@ -0,0 +1,85 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Flags: --expose_gc
+
+var common = require('../common');
+var assert = require('assert');
+var SlowBuffer = require('buffer').SlowBuffer;
+
+// Typed arrays over an ArrayBuffer share its memory.
+var ab = new ArrayBuffer(16);
+var f64 = new Float64Array(ab);
+assert.equal(f64.length, 2);
+assert.strictEqual(f64.buffer, ab);
+f64[0] = 1.5;
+assert.equal(new Uint8Array(ab, 8).length, 8);
+assert.equal(new Float64Array(ab, 8, 1).byteOffset, 8);
+
+// A Buffer over an ArrayBuffer.
+var buf = new Buffer(ab);
+assert.equal(buf.length, 16);
+assert.ok(Buffer.isBuffer(buf));
+var expected = new Buffer(8);
+expected.writeDoubleLE(1.5, 0);
+for (var i = 0; i < 8; i++) assert.equal(buf[i], expected[i]);
+buf.writeDoubleLE(-2.25, 8);
+assert.equal(f64[1], -2.25);
+assert.equal(buf.slice(8).readDoubleLE(0), -2.25);
+
+// An ArrayBuffer over a Buffer, including a slice out of the pool.
+var small = new Buffer(24);
+small.fill(0);
+var shared = new ArrayBuffer(small);
+assert.equal(shared.byteLength, 24);
+var view = new Float64Array(shared);
+view[2] = 42.5;
+assert.equal(small.readDoubleLE(16), 42.5);
+small.writeDoubleLE(7, 0);
+assert.equal(view[0], 7);
+
+var slow = new SlowBuffer(32);
+var u32 = new Uint32Array(new ArrayBuffer(slow));
+u32[7] = 0xdeadbeef;
+assert.equal(slow[28], 0xef);
+
+// Only Buffers are shared; other arguments keep their plain meaning.
+assert.equal(new ArrayBuffer(4).byteLength, 4);
+assert.equal(new ArrayBuffer(new Uint8Array(4)).byteLength, 0);
+
+// The memory outlives whichever side is dropped first.
+function churn() {
+  for (var i = 0; i < 200; i++) new Buffer(64 * 1024);
+  gc();
+}
+
+var kept = new Buffer(new ArrayBuffer(64 * 1024));
+kept[65535] = 9;
+churn();
+assert.equal(kept[65535], 9);
+
+var fromBuffer = new Uint8Array(new ArrayBuffer(new Buffer([1, 2, 3])));
+churn();
+assert.equal(fromBuffer[2], 3);
+
+var round = new Buffer(new ArrayBuffer(new Buffer('abc')));
+churn();
+assert.equal(round.toString(), 'abc');
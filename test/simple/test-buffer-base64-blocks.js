@@ -0,0 +1,101 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var alphabet = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/';
+
+// Straightforward reference encoder.
+function encode(buf) {
+  var out = '';
+  for (var i = 0; i < buf.length; i += 3) {
+    var n = (buf[i] << 16) | ((buf[i + 1] || 0) << 8) | (buf[i + 2] || 0);
+    out += alphabet[n >> 18] + alphabet[(n >> 12) & 63];
+    out += i + 1 < buf.length ? alphabet[(n >> 6) & 63] : '=';
+    out += i + 2 < buf.length ? alphabet[n & 63] : '=';
+  }
+  return out;
+}
+
+function random(len) {
+  var buf = new Buffer(len);
+  for (var i = 0; i < len; i++) buf[i] = Math.floor(Math.random() * 256);
+  return buf;
+}
+
+function sameBytes(a, b) {
+  assert.equal(a.length, b.length);
+  for (var i = 0; i < a.length; i++) assert.equal(a[i], b[i], 'byte ' + i);
+}
+
+// Every length around the 12 byte / 16 character block size, and some big
+// ones, through every byte value.
+[0, 1, 2, 3, 11, 12, 13, 14, 23, 24, 25, 47, 48, 49, 1000, 70001].forEach(
+  function(len) {
+    var buf = random(len);
+    var str = encode(buf);
+    assert.equal(buf.toString('base64'), str);
+    assert.equal(Buffer.byteLength(str, 'base64'), len);
+    sameBytes(new Buffer(str, 'base64'), buf);
+    if (len > 0) {
+      assert.equal(buf.slice(1).toString('base64'), encode(buf.slice(1)));
+    }
+  });
+
+var all = new Buffer(256);
+for (var i = 0; i < 256; i++) all[i] = i;
+assert.equal(all.toString('base64'), encode(all));
+sameBytes(new Buffer(encode(all), 'base64'), all);
+
+// Characters outside the alphabet are skipped wherever they fall, including
+// in the middle of a 16 character block.
+var buf = random(300);
+var str = encode(buf);
+var spaced = '';
+for (var i = 0; i < str.length; i++) {
+  spaced += str[i];
+  if (i % 19 === 5) spaced += '\n';
+  if (i % 37 === 0) spaced += ' ';
+  if (i % 53 === 0) spaced += '*';
+}
+sameBytes(new Buffer(spaced, 'base64'), buf);
+
+// Padding in the middle is skipped like any other character outside the
+// alphabet; it doesn't end the input.
+sameBytes(new Buffer('QQ==QUJD', 'base64'),
+          new Buffer([0x41, 0x04, 0x14, 0x24]));
+sameBytes(new Buffer('QQ==QUJD', 'base64'), new Buffer('QQQUJD', 'base64'));
+
+// Non-ASCII characters are treated like their low byte, as before.
+assert.equal(new Buffer('QŕņB', 'base64').toString(), 'AAA');
+
+// Inputs longer than one decode chunk, with the groups straddling chunks.
+var big = random(9000);
+var bigStr = ' ' + encode(big);
+sameBytes(new Buffer(bigStr, 'base64'), big);
+
+// Malformed padding never writes past the decoded size estimate.
+var pool = new Buffer(16);
+pool.fill(0xAA);
+var target = pool.slice(0, 4);
+target.write('QUFB==', 'base64');
+assert.equal(pool[4], 0xAA);
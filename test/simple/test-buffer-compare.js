@@ -0,0 +1,59 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var a = new Buffer('abc');
+var b = new Buffer('abd');
+var c = new Buffer('ab');
+
+assert.equal(Buffer.compare(a, a), 0);
+assert.equal(Buffer.compare(a, new Buffer('abc')), 0);
+assert.equal(Buffer.compare(a, b), -1);
+assert.equal(Buffer.compare(b, a), 1);
+assert.equal(Buffer.compare(c, a), -1);
+assert.equal(Buffer.compare(a, c), 1);
+assert.equal(Buffer.compare(new Buffer(0), new Buffer(0)), 0);
+assert.equal(a.compare(b), -1);
+
+// Bytes compare unsigned.
+assert.equal(Buffer.compare(new Buffer([0x80]), new Buffer([0x7f])), 1);
+
+// Slices compare by their own bytes.
+var big = new Buffer('xxabcxx');
+assert.equal(Buffer.compare(big.slice(2, 5), a), 0);
+assert.ok(big.slice(2, 5).equals(a));
+
+assert.ok(a.equals(new Buffer('abc')));
+assert.ok(!a.equals(b));
+assert.ok(!a.equals(c));
+
+var keys = [b, c, a, new Buffer('a')];
+keys.sort(Buffer.compare);
+assert.deepEqual(keys.map(String), ['a', 'ab', 'abc', 'abd']);
+
+assert.strictEqual(Buffer.timingSafeEqual(a, new Buffer('abc')), true);
+assert.strictEqual(Buffer.timingSafeEqual(a, b), false);
+assert.throws(function() { Buffer.timingSafeEqual(a, c); }, RangeError);
+
+assert.throws(function() { Buffer.compare(a, 'abc'); }, TypeError);
+assert.throws(function() { a.equals([97, 98, 99]); }, TypeError);
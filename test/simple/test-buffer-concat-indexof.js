@@ -0,0 +1,106 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+// Buffer.concat
+var zero = [];
+var one = [new Buffer('asdf')];
+var long = [];
+for (var i = 0; i < 10; i++) long.push(new Buffer('asdf'));
+
+var flatZero = Buffer.concat(zero);
+var flatOne = Buffer.concat(one);
+var flatLong = Buffer.concat(long);
+var flatLongLen = Buffer.concat(long, 40);
+
+assert.equal(flatZero.length, 0);
+assert.equal(flatOne.toString(), 'asdf');
+assert.strictEqual(flatOne, one[0]);
+assert.equal(flatLong.toString(), new Array(11).join('asdf'));
+assert.equal(flatLongLen.toString(), new Array(11).join('asdf'));
+assert.equal(Buffer.concat(long, 6).toString(), 'asdfas');
+
+var big = new Buffer(20000);
+big.fill(0x62);
+var mixed = Buffer.concat([new Buffer('a'), big, new Buffer(0), big.slice(5, 7)]);
+assert.equal(mixed.length, 20003);
+assert.equal(mixed[0], 0x61);
+assert.equal(mixed.toString('ascii', 19999), 'bbbb');
+
+assert.throws(function() {
+  Buffer.concat([new Buffer('a'), 'b']);
+}, /Buffer/);
+assert.throws(function() {
+  Buffer.concat('ab');
+}, /Usage/);
+
+// buffer.indexOf
+var b = new Buffer('abcdef\r\n--boundary\r\nbody\r\n--boundary--');
+
+assert.equal(b.indexOf('a'), 0);
+assert.equal(b.indexOf('f'), 5);
+assert.equal(b.indexOf('\r\n'), 6);
+assert.equal(b.indexOf('--boundary'), 8);
+assert.equal(b.indexOf('--boundary', 9), 26);
+assert.equal(b.indexOf('--boundary--'), 26);
+assert.equal(b.indexOf('--boundary', -12), 26);
+assert.equal(b.indexOf('--boundary', 27), -1);
+assert.equal(b.indexOf('z'), -1);
+assert.equal(b.indexOf(0x0d), 6);
+assert.equal(b.indexOf(0x0d, 7), 18);
+assert.equal(b.indexOf(0x10d), 6);
+assert.equal(b.indexOf(new Buffer('body')), 20);
+assert.equal(b.indexOf(''), 0);
+assert.equal(b.indexOf('', 3), 3);
+assert.equal(b.indexOf('a', b.length + 1), -1);
+assert.equal(b.indexOf('--boundary--x'), -1);
+
+// Slices search only their own bytes.
+var s = b.slice(7, 20);
+assert.equal(s.indexOf('\n'), 0);
+assert.equal(s.indexOf('a'), 8);
+assert.equal(s.indexOf('body'), -1);
+assert.equal(s.indexOf('--boundary\r'), 1);
+
+// Matches at every position, across and at the end of 16 byte blocks.
+var hay = new Buffer(100);
+hay.fill(0x78);
+for (var pos = 0; pos < 97; pos++) {
+  hay.fill(0x78);
+  hay.write('xyz', pos);
+  hay.write('abc', pos);
+  assert.equal(hay.indexOf('abc'), pos);
+  assert.equal(hay.indexOf('ab'), pos);
+  assert.equal(hay.indexOf('abcx'), pos + 3 < 100 ? pos : -1);
+}
+
+// Near misses: first and last byte match but not the middle.
+var miss = new Buffer(new Array(40).join('aXb') + 'aYb');
+assert.equal(miss.indexOf('aYb'), 117);
+
+assert.equal(new Buffer('日本語').indexOf('語'), 6);
+assert.equal(new Buffer('abc').indexOf('YmM=', 0, 'base64'), 1);
+
+assert.throws(function() {
+  b.indexOf({});
+}, TypeError);
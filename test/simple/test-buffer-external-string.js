@@ -0,0 +1,70 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Flags: --expose_gc
+
+var common = require('../common');
+var assert = require('assert');
+
+var text = new Array(5000).join('0123456789abcdef');
+
+// Off by default: the string is a copy.
+var b = new Buffer(text);
+var copy = b.toString('ascii');
+b[0] = 0x7a;
+assert.equal(copy, text);
+
+Buffer.externalStringSize = 1024;
+
+b = new Buffer(text);
+var ascii = b.toString('ascii');
+var binary = b.toString('binary', 16, 2048);
+var small = b.toString('ascii', 0, 16);
+assert.equal(ascii, text);
+assert.equal(binary, text.slice(16, 2048));
+assert.equal(small, '0123456789abcdef');
+
+// Shared strings see later writes; short ones are still copies.
+b[16] = 0x7a;
+assert.equal(binary.charAt(0), 'z');
+assert.equal(ascii.charAt(16), 'z');
+assert.equal(small, '0123456789abcdef');
+b[16] = 0x30;
+
+// The string keeps the buffer's memory alive.
+b = null;
+gc();
+gc();
+var fill = [];
+for (var i = 0; i < 100; i++) fill.push(new Buffer(text));
+assert.equal(ascii, text);
+assert.equal(binary, text.slice(16, 2048));
+assert.equal(ascii.length, text.length);
+assert.equal(ascii.indexOf('cdef0'), 12);
+
+// Bytes outside ASCII are copied and decoded as before.
+var high = new Buffer(4096);
+high.fill(0x41);
+high[100] = 0xe9;
+var s = high.toString('binary');
+assert.equal(s.charCodeAt(100), 0xe9);
+high[101] = 0x42;
+assert.equal(s.charAt(101), 'A');
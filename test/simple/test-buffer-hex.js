@@ -0,0 +1,84 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var SlowBuffer = require('buffer').SlowBuffer;
+
+function toHex(buf) {
+  var out = '';
+  for (var i = 0; i < buf.length; i++) {
+    out += (buf[i] < 16 ? '0' : '') + buf[i].toString(16);
+  }
+  return out;
+}
+
+function random(len) {
+  var buf = new Buffer(len);
+  for (var i = 0; i < len; i++) buf[i] = Math.floor(Math.random() * 256);
+  return buf;
+}
+
+// Lengths around the 16 byte block size and across decode chunks.
+[0, 1, 15, 16, 17, 31, 32, 33, 100, 2047, 2048, 2049, 10000].forEach(
+  function(len) {
+    var buf = random(len);
+    var hex = toHex(buf);
+    assert.equal(buf.toString('hex'), hex);
+    var back = new Buffer(hex, 'hex');
+    assert.equal(back.length, len);
+    assert.equal(toHex(back), hex);
+    assert.equal(toHex(new Buffer(hex.toUpperCase(), 'hex')), hex);
+  });
+
+var all = new Buffer(256);
+for (var i = 0; i < 256; i++) all[i] = i;
+assert.equal(all.toString('hex'), toHex(all));
+assert.equal(all.toString('hex', 250, 256), 'fafbfcfdfeff');
+assert.equal(new SlowBuffer(0).toString('hex'), '');
+
+// maxLength and offset.
+var buf = new Buffer(8);
+buf.fill(0);
+assert.equal(buf.write('0102030405', 6, 'hex'), 2);
+assert.equal(Buffer._charsWritten, 4);
+assert.equal(toHex(buf), '0000000000000102');
+assert.equal(buf.write('aabbcc', 1, 1, 'hex'), 1);
+assert.equal(toHex(buf), '00aa000000000102');
+
+// Invalid digits are rejected wherever they are, in a vector block or in
+// the scalar tail. Bytes before the bad digit are written, as before.
+var good = toHex(random(40));
+[0, 1, 30, 31, 63, 78, 79].forEach(function(pos) {
+  ['g', ' ', 'é', 'İ'].forEach(function(c) {
+    var bad = good.slice(0, pos) + c + good.slice(pos + 1);
+    var target = new Buffer(40);
+    target.fill(0);
+    assert.throws(function() {
+      target.write(bad, 'hex');
+    }, /Invalid hex string/);
+    assert.equal(toHex(target.slice(0, pos >> 1)), good.slice(0, pos & ~1));
+  });
+});
+
+assert.throws(function() {
+  new Buffer('abc', 'hex');
+}, /Invalid hex string/);
@@ -0,0 +1,99 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var types = [
+  ['Int16', Int16Array, 2, [1, -2, 32767, -32768]],
+  ['UInt16', Uint16Array, 2, [1, 2, 65535, 0]],
+  ['Int32', Int32Array, 4, [1, -2, 0x7fffffff, -0x80000000]],
+  ['UInt32', Uint32Array, 4, [1, 2, 0xffffffff, 0xdeadbeef]],
+  ['Float', Float32Array, 4, [1.5, -2.25, 1e30, -0]],
+  ['Double', Float64Array, 8, [1.5, -2.25, 1e300, Math.PI]]
+];
+
+types.forEach(function(t) {
+  var name = t[0], Type = t[1], size = t[2], values = t[3];
+
+  ['LE', 'BE'].forEach(function(endian) {
+    var buf = new Buffer(1 + values.length * size);
+    buf.fill(0);
+
+    // Write in bulk at an odd offset and check against the scalar readers.
+    buf['write' + name + 'Array' + endian](values, 1);
+    for (var i = 0; i < values.length; i++) {
+      assert.equal(buf['read' + name + endian](1 + i * size),
+                   new Type([values[i]])[0]);
+    }
+
+    // Read back in bulk, into a new array and into a given one.
+    var read = buf['read' + name + 'Array' + endian](1, values.length);
+    assert.ok(read instanceof Type);
+    assert.equal(read.length, values.length);
+    for (var i = 0; i < values.length; i++) {
+      assert.equal(read[i], new Type([values[i]])[0]);
+    }
+
+    var target = new Type(values.length + 2);
+    assert.strictEqual(
+        buf['read' + name + 'Array' + endian](1 + size, 2, target), target);
+    assert.equal(target[0], read[1]);
+    assert.equal(target[1], read[2]);
+    assert.equal(target[2], 0);
+
+    assert.throws(function() {
+      buf['read' + name + 'Array' + endian](2, values.length);
+    }, /beyond buffer length/);
+    assert.throws(function() {
+      buf['write' + name + 'Array' + endian](values, 2);
+    }, /beyond buffer length/);
+  });
+});
+
+// Both byte orders of the same value.
+var buf = new Buffer(8);
+buf.writeUInt32ArrayBE([0x01020304, 0x05060708], 0);
+assert.deepEqual(Array.prototype.slice.call(buf),
+                 [1, 2, 3, 4, 5, 6, 7, 8]);
+assert.deepEqual(Array.prototype.slice.call(buf.readUInt32ArrayLE(0, 2)),
+                 [0x04030201, 0x08070605]);
+
+// Typed arrays of the wrong type are rejected unless asserts are skipped;
+// the native side still keeps reads within bounds.
+assert.throws(function() {
+  buf.readInt32ArrayLE(0, 2, new Float64Array(2));
+}, /target must be a Int32Array/);
+assert.throws(function() {
+  buf.readInt32ArrayLE(0, 4, new Int32Array(4), true);
+}, /beyond buffer length/);
+assert.throws(function() {
+  buf.readInt32ArrayLE(0, 2, new Int32Array(1), true);
+}, /too small/);
+
+// Reading from a buffer into a view of its own memory.
+var shared = new Buffer(16);
+for (var i = 0; i < 16; i++) shared[i] = i;
+var view = new Uint32Array(new ArrayBuffer(shared));
+shared.slice(0, 12).readUInt32ArrayBE(0, 3, view);
+assert.equal(view[0], 0x00010203);
+assert.equal(view[1], 0x04050607);
+assert.equal(view[2], 0x08090a0b);
@@ -0,0 +1,84 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+function repeat(s, n) {
+  return new Array(n + 1).join(s);
+}
+
+function roundTrip(str) {
+  var buf = new Buffer(str, 'utf8');
+  assert.equal(buf.length, Buffer.byteLength(str, 'utf8'));
+  assert.equal(buf.toString('utf8'), str);
+  for (var i = 0; i < 40 && i < buf.length; i += 7) {
+    assert.equal(buf.toString('utf8', i, buf.length - i),
+                 buf.slice(i, buf.length - i).toString('utf8'));
+  }
+}
+
+var ascii = repeat('{"key":"value","n":12345},', 100);
+
+roundTrip('');
+roundTrip('a');
+roundTrip(ascii);
+roundTrip(ascii + 'é');
+roundTrip('é' + ascii);
+roundTrip(ascii + '€' + ascii + '😀' + ascii);
+roundTrip(repeat('abé', 500));
+roundTrip(repeat(ascii.slice(0, 70) + '中', 100));
+
+// The decoder must see the same bytes it would have seen without the split:
+// stray continuation bytes and truncated sequences next to ASCII runs.
+var bytes = new Buffer(ascii + ascii);
+bytes[100] = 0xc3;
+bytes[500] = 0x80;
+bytes[900] = 0xe2;
+bytes[901] = 0x82;
+var decoded = bytes.toString('utf8');
+assert.equal(decoded.length, bytes.length);
+assert.equal(decoded.charCodeAt(100), 0xfffd);
+assert.equal(decoded.charCodeAt(101), bytes[101]);
+assert.equal(decoded.charCodeAt(500), 0xfffd);
+assert.equal(decoded.charCodeAt(900), 0xfffd);
+assert.equal(decoded.charCodeAt(901), 0xfffd);
+assert.equal(decoded.slice(902), bytes.slice(902).toString('ascii'));
+
+// Partial writes must stop on a character boundary.
+var buf = new Buffer(10);
+var written = buf.write('abcdefghié', 0);
+assert.equal(written, 9);
+assert.equal(Buffer._charsWritten, 9);
+written = buf.write('abcdefghéz', 0);
+assert.equal(written, 10);
+assert.equal(Buffer._charsWritten, 9);
+assert.equal(buf.toString(), 'abcdefghé');
+written = buf.write('abcdefgh€', 0);
+assert.equal(written, 8);
+assert.equal(Buffer._charsWritten, 8);
+
+// Strings longer than one staging chunk.
+var big = repeat('x', 5000) + 'é' + repeat('y', 5000);
+buf = new Buffer(Buffer.byteLength(big));
+assert.equal(buf.write(big), buf.length);
+assert.equal(Buffer._charsWritten, big.length);
+assert.equal(buf.toString(), big);
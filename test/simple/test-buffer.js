@@ -145,6 +145,22 @@ new Buffer(0);
 b.write('', 1024);
 b.write('', 2048);
 
+// short copies within one buffer, in both directions
+var small = new Buffer('0123456789');
+assert.equal(small.copy(small, 2, 0, 5), 5);
+assert.equal(small.toString(), '0101234789');
+small = new Buffer('0123456789');
+assert.equal(small.copy(small, 0, 2, 7), 5);
+assert.equal(small.toString(), '2345656789');
+
+// short fills truncate the value to a byte
+small.fill(0x141);
+assert.equal(small.toString(), 'AAAAAAAAAA');
+small.fill(-1, 2, 4);
+assert.equal(small[2], 255);
+assert.equal(small[3], 255);
+assert.equal(small[4], 0x41);
+
 // try to copy 0 bytes worth of data into an empty buffer
 b.copy(new Buffer(0), 0, 0, 0);
 
@@ -703,3 +719,17 @@ assert.equal(Buffer({length: 'BAM'}).length, 0);
 // Make sure that strings are not coerced to numbers.
 assert.equal(Buffer('99').length, 2);
 assert.equal(Buffer('13.37').length, 5);
+
+// Small buffers are cut from a shared pool, 8 byte aligned; big ones are
+// not. A change of Buffer.poolSize starts a new pool.
+var poolSize = Buffer.poolSize;
+Buffer.poolSize = 1024;
+var a = new Buffer(3);
+var b = new Buffer(5);
+assert.equal(a.parent.length, 1024);
+assert.strictEqual(a.parent, b.parent);
+assert.equal(a.offset, 0);
+assert.equal(b.offset, 8);
+assert.notStrictEqual(new Buffer(1025).parent, a.parent);
+Buffer.poolSize = poolSize;
+assert.notStrictEqual(new Buffer(1).parent, a.parent);
@@ -0,0 +1,86 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Messages posted to an in-process channel arrive in order, with buffers
+// transferred when they own their storage and copied otherwise.
+
+var common = require('../common');
+var assert = require('assert');
+var cp = require('child_process');
+
+var channel = cp.createChannel();
+assert.equal(typeof channel.id, 'number');
+
+var port = cp.connectChannel(channel.id);
+
+var big = new Buffer(64 * 1024);
+for (var i = 0; i < big.length; i++) big[i] = i % 251;
+var small = new Buffer('hello');
+var slow = new (require('buffer').SlowBuffer)(10);
+for (var i = 0; i < slow.length; i++) slow[i] = 7;
+
+var received = [];
+
+channel.on('message', function(m) {
+  received.push(m);
+  if (received.length < 3) return;
+
+  assert.deepEqual(received[0], { n: 1, s: 'first', a: [1, 2, 3] });
+
+  var m1 = received[1];
+  assert.equal(m1.n, 2);
+  assert.ok(Buffer.isBuffer(m1.big));
+  assert.equal(m1.big.length, 64 * 1024);
+  for (var i = 0; i < m1.big.length; i++) {
+    if (m1.big[i] !== i % 251) assert.fail(m1.big[i], i % 251, 'byte ' + i);
+  }
+  assert.equal(m1.nested.small.toString(), 'hello');
+  assert.equal(m1.slow.length, 10);
+  assert.equal(m1.slow[9], 7);
+
+  assert.equal(received[2], null);
+
+  channel.close();
+
+  assert.throws(function() {
+    port.send('late');
+  }, /EPIPE/);
+  port.close();
+});
+
+port.send({ n: 1, s: 'first', a: [1, 2, 3] });
+port.send({ n: 2, big: big, nested: { small: small }, slow: slow });
+port.send(undefined);
+
+// The storage of big and slow was handed over; small came from the pool and
+// was copied.
+assert.equal(big.length, 0);
+assert.equal(slow.length, 0);
+assert.equal(small.toString(), 'hello');
+
+assert.throws(function() {
+  cp.connectChannel(-1);
+}, /No channel/);
+
+process.on('exit', function() {
+  assert.equal(received.length, 3);
+});
@@ -0,0 +1,69 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var exec = require('child_process').exec;
+
+var bigSize = 3 * 1024 * 1024;
+var gotBig = false, gotOverflow = false, gotListener = false;
+
+// Multi-MB output is collected in one piece. The two bytes of U+00E9
+// arrive in separate writes, which checks that decoding happens once.
+var cmd = '"' + process.execPath + '" -e "' +
+      'process.stdout.write(new Array(' + (bigSize + 1) + ').join(\'x\'));' +
+      'process.stdout.write(new Buffer([0xc3]));' +
+      'setTimeout(function() { process.stdout.write(new Buffer([0xa9])); },' +
+      ' 50);"';
+
+exec(cmd, { maxBuffer: bigSize * 2 }, function(err, stdout, stderr) {
+  if (err) throw err;
+  assert.equal(stdout.length, bigSize + 1);
+  assert.equal(stdout.charAt(bigSize), '\u00e9');
+  assert.equal(stderr, '');
+  gotBig = true;
+});
+
+exec(cmd, { maxBuffer: 1024 }, function(err, stdout, stderr) {
+  assert.ok(err);
+  assert.equal(err.message, 'maxBuffer exceeded.');
+  assert.equal(stdout.length, 1024);
+  gotOverflow = true;
+});
+
+// A 'data' listener still sees the output.
+var seen = '';
+var child = exec('echo hello', function(err, stdout, stderr) {
+  if (err) throw err;
+  assert.equal(stdout, 'hello\n');
+  assert.equal(seen, 'hello\n');
+  gotListener = true;
+});
+child.stdout.on('data', function(chunk) {
+  seen += chunk;
+});
+
+process.on('exit', function() {
+  assert.ok(gotBig);
+  assert.ok(gotOverflow);
+  assert.ok(gotListener);
+});
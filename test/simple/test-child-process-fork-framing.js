@@ -0,0 +1,66 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var fork = require('child_process').fork;
+
+if (process.argv[2] === 'child') {
+  // Echo everything back; Buffers stay Buffers.
+  process.on('message', function(m) {
+    process.send(m);
+  });
+  return;
+}
+
+var child = fork(__filename, ['child'], { ipcFraming: 'binary' });
+
+var big = new Array(300 * 1024).join('x');
+var raw = new Buffer([0, 1, 2, 10, 13, 255]);
+var count = 100;
+var received = [];
+
+child.on('message', function(m) {
+  received.push(m);
+  if (received.length === count + 2) child.kill();
+});
+
+for (var i = 0; i < count; i++) {
+  child.send({ n: i, text: 'line\nbreak' });
+}
+child.send({ big: big });
+child.send(raw);
+
+assert.throws(function() {
+  fork(__filename, ['child'], { ipcFraming: 'xml' });
+});
+
+process.on('exit', function() {
+  assert.equal(received.length, count + 2);
+  for (var i = 0; i < count; i++) {
+    assert.deepEqual(received[i], { n: i, text: 'line\nbreak' });
+  }
+  assert.equal(received[count].big, big);
+  assert.ok(Buffer.isBuffer(received[count + 1]));
+  assert.deepEqual(Array.prototype.slice.call(received[count + 1]),
+                   Array.prototype.slice.call(raw));
+});
@@ -0,0 +1,105 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Unix domain socket servers and UDP sockets can be passed to a child.
+
+var common = require('../common');
+var assert = require('assert');
+var dgram = require('dgram');
+var net = require('net');
+var fork = require('child_process').fork;
+
+if (process.platform === 'win32') {
+  console.error('Skipping: only TCP handles can be passed on Windows.');
+  return;
+}
+
+if (process.argv[2] === 'child') {
+  process.on('message', function(m, handle) {
+    if (m === 'pipe') {
+      var server = net.createServer(function(socket) {
+        socket.end('pipe');
+      });
+      server.listen(handle);
+    } else if (m === 'udp') {
+      var socket = dgram.createSocket('udp4');
+      socket.on('message', function(msg, rinfo) {
+        socket.send(msg, 0, msg.length, rinfo.port, rinfo.address);
+      });
+      socket.bind(handle);
+    }
+    process.send(m);
+  });
+  return;
+}
+
+var UDP = process.binding('udp_wrap').UDP;
+
+var child = fork(__filename, ['child']);
+var pipeReplied = false;
+var udpReplied = false;
+
+// Bound but never listened on or read from here, so everything goes to the
+// child.
+var pipeHandle = net._createServerHandle(common.PIPE, -1, -1);
+assert.ok(pipeHandle);
+var udpHandle = new UDP();
+assert.equal(udpHandle.bind('127.0.0.1', common.PORT, 0), 0);
+
+child.send('pipe', pipeHandle);
+child.send('udp', udpHandle);
+
+child.on('message', function(m) {
+  if (m === 'pipe') {
+    var data = '';
+    var client = net.connect(common.PIPE);
+    client.setEncoding('ascii');
+    client.on('data', function(d) { data += d; });
+    client.on('end', function() {
+      assert.equal(data, 'pipe');
+      pipeReplied = true;
+      done();
+    });
+  } else if (m === 'udp') {
+    var client = dgram.createSocket('udp4');
+    var msg = new Buffer('udp');
+    client.on('message', function(reply) {
+      assert.equal(reply.toString(), 'udp');
+      udpReplied = true;
+      client.close();
+      done();
+    });
+    client.send(msg, 0, msg.length, common.PORT, '127.0.0.1');
+  }
+});
+
+function done() {
+  if (!pipeReplied || !udpReplied) return;
+  pipeHandle.close();
+  udpHandle.close();
+  child.kill();
+}
+
+process.on('exit', function() {
+  assert.ok(pipeReplied);
+  assert.ok(udpReplied);
+});
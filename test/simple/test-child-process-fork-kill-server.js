@@ -0,0 +1,55 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// A killed child must not keep its listening socket, whether it is a
+// process or, in a build with isolates, an isolate in this process.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+var fork = require('child_process').fork;
+
+if (process.argv[2] === 'child') {
+  net.createServer().listen(common.PORT, function() {
+    process.send('listening');
+  });
+  return;
+}
+
+var child = fork(__filename, ['child']);
+var relistened = false;
+
+child.on('message', function(m) {
+  assert.equal(m, 'listening');
+  child.kill('SIGKILL');
+});
+
+child.on('exit', function() {
+  var server = net.createServer();
+  server.listen(common.PORT, function() {
+    relistened = true;
+    server.close();
+  });
+});
+
+process.on('exit', function() {
+  assert.ok(relistened);
+});
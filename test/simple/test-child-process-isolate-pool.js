@@ -0,0 +1,72 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// --isolate-pool=n prepares instances for fork() in the background, and the
+// process doesn't wait for that to finish before it exits.
+
+var common = require('../common');
+var assert = require('assert');
+var cp = require('child_process');
+
+if (!process.features.isolates) {
+  console.error('Skipping: this build has no isolates');
+  process.exit(0);
+}
+
+if (process.argv[2] === 'child') {
+  process.send({ ok: true });
+  return;
+}
+
+if (process.argv[2] === 'parent') {
+  // Wait for the first prepared instance, then fork from the pool.
+  var poll = setInterval(function() {
+    if (process._isolatePoolSize() === 0) return;
+    clearInterval(poll);
+
+    var child = cp.fork(__filename, ['child']);
+    child.on('message', function(m) {
+      assert.ok(m.ok);
+      console.log('forked');
+      child.kill();
+    });
+  }, 10);
+  return;
+}
+
+// More instances than the parent lives long enough to prepare.
+var start = Date.now();
+var parent = cp.spawn(process.execPath,
+                      ['--isolate-pool=1000', __filename, 'parent']);
+var out = '';
+parent.stdout.setEncoding('utf8');
+parent.stdout.on('data', function(d) {
+  out += d;
+});
+parent.stderr.pipe(process.stderr);
+
+parent.on('exit', function(code) {
+  assert.equal(code, 0);
+  assert.equal(out, 'forked\n');
+  assert.equal(process._isolatePoolSize(), 0);
+  // Filling all 1000 would take many seconds.
+  assert.ok(Date.now() - start < 5000, Date.now() - start + 'ms');
+});
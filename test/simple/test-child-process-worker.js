@@ -0,0 +1,84 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var path = require('path');
+var cp = require('child_process');
+
+if (!process.features.isolates) {
+  assert.throws(function() { cp.createWorker('worker.js'); });
+  console.error('Skipping: this build has no isolates');
+  process.exit(0);
+}
+
+var script = path.join(common.fixturesDir, 'worker-echo.js');
+var exits = 0;
+var errors = 0;
+
+// Messages and buffers both ways, and an exit code.
+var echo = cp.createWorker(script);
+var data = new Buffer(64 * 1024);
+for (var i = 0; i < data.length; i++) data[i] = i & 0xff;
+
+echo.send({ n: 1 });
+echo.send({ n: 2, data: data });
+assert.equal(data.length, 0);
+
+var replies = [];
+echo.on('message', function(m) {
+  replies.push(m);
+  if (replies.length == 2) echo.send({ cmd: 'exit', code: 3 });
+});
+
+echo.on('exit', function(code) {
+  assert.equal(code, 3);
+  assert.equal(replies[0].n, 1);
+  assert.equal(replies[1].n, 2);
+  assert.ok(Buffer.isBuffer(replies[1].data));
+  assert.equal(replies[1].data.length, 64 * 1024);
+  assert.equal(replies[1].data[0], 0xff);
+  assert.equal(replies[1].data[64 * 1024 - 1], 0);
+  assert.throws(function() { echo.send({}); });
+  exits++;
+});
+
+// Uncaught exceptions come back as 'error' before 'exit'.
+var thrower = cp.createWorker(script);
+thrower.send({ cmd: 'throw', message: 'oops' });
+
+thrower.on('error', function(err) {
+  assert.ok(err instanceof Error);
+  assert.equal(err.message, 'oops');
+  assert.ok(/oops/.test(err.stack));
+  errors++;
+});
+
+thrower.on('exit', function(code) {
+  assert.equal(errors, 1);
+  assert.equal(code, 1);
+  exits++;
+});
+
+process.on('exit', function() {
+  assert.equal(exits, 2);
+  assert.equal(errors, 1);
+});
@@ -0,0 +1,108 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var cp = require('child_process');
+var path = require('path');
+
+if (process.platform === 'win32') {
+  assert.throws(function() { cp.createZygote(); });
+  return;
+}
+
+var fixture = path.join(common.fixturesDir, 'zygote-child.js');
+var zygote = cp.createZygote({
+  preload: [path.join(common.fixturesDir, 'zygote-preload.js')]
+});
+
+var exits = 0;
+var zygoteExited = false;
+
+// A child with JSON messages that exits by itself.
+var first = zygote.fork(fixture, ['a', 'b'], {
+  env: { ZYGOTE_TEST: 'first' },
+  cwd: common.tmpDir
+});
+assert.strictEqual(first.pid, null);
+
+// Queued until the zygote has forked it.
+first.send({ exit: 7 });
+
+first.on('message', function(m) {
+  assert.strictEqual(m.pid, first.pid);
+  assert.notEqual(m.pid, zygote.pid);
+  assert.notEqual(m.pid, process.pid);
+  assert.strictEqual(m.zygotePid, zygote.pid);
+  assert.ok(m.preloaded);
+  assert.deepEqual(m.argv, ['a', 'b']);
+  assert.strictEqual(m.env, 'first');
+  assert.strictEqual(path.resolve(m.cwd), path.resolve(common.tmpDir));
+});
+
+first.on('exit', function(code, signal) {
+  assert.strictEqual(code, 7);
+  assert.strictEqual(signal, null);
+  exits++;
+  done();
+});
+
+// One with binary framing through fork(), killed once it answered.
+var second = cp.fork(fixture, [], {
+  zygote: zygote,
+  ipcFraming: 'binary',
+  env: { ZYGOTE_TEST: 'second' }
+});
+
+second.on('message', function(m) {
+  if (Buffer.isBuffer(m)) {
+    assert.strictEqual(m.toString(), 'raw');
+    second.kill();
+    return;
+  }
+  assert.strictEqual(m.env, 'second');
+  assert.deepEqual(m.argv, []);
+  second.send(new Buffer('raw'));
+});
+second.send({});
+
+second.on('exit', function(code, signal) {
+  assert.strictEqual(code, null);
+  assert.strictEqual(signal, 'SIGTERM');
+  assert.ok(second.killed);
+  exits++;
+  done();
+});
+
+function done() {
+  if (exits === 2) zygote.close();
+}
+
+zygote.on('exit', function(code) {
+  assert.strictEqual(code, 0);
+  zygoteExited = true;
+  assert.throws(function() { zygote.fork(fixture); }, /zygote closed/);
+});
+
+process.on('exit', function() {
+  assert.strictEqual(exits, 2);
+  assert.ok(zygoteExited);
+});
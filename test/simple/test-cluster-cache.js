@@ -0,0 +1,104 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var cluster = require('cluster');
+var path = require('path');
+
+if (cluster.isWorker) {
+  var cache = cluster.cache('test');
+  assert.equal(cache.get('from-master', 'utf8'), 'hello');
+  assert.ok(cache.set('from-worker', new Buffer([1, 2, 3])));
+  process.send({ cmd: 'done' });
+  return;
+}
+
+var cache = cluster.cache('test', { size: 64 * 1024 });
+assert.strictEqual(cluster.cache('test'), cache);
+
+var base = process.env.TMPDIR || '/tmp';
+if (path.existsSync('/dev/shm')) base = '/dev/shm';
+var file = path.join(base, 'node-cache-' + process.pid + '-test');
+assert.ok(path.existsSync(file));
+
+assert.throws(function() { cluster.cache('../test'); });
+
+// Set, get, overwrite and delete.
+assert.strictEqual(cache.get('missing'), undefined);
+assert.ok(cache.set('a', 'one'));
+assert.ok(cache.get('a') instanceof Buffer);
+assert.equal(cache.get('a').slice(1).toString(), 'ne');
+assert.equal(cache.get('a', 'utf8'), 'one');
+assert.ok(cache.set('a', 'two'));
+assert.equal(cache.get('a', 'utf8'), 'two');
+assert.ok(cache.del('a'));
+assert.ok(!cache.del('a'));
+assert.strictEqual(cache.get('a'), undefined);
+
+// Values that span several blocks, and slices.
+var big = new Buffer(1000);
+for (var i = 0; i < big.length; i++) big[i] = i & 0xff;
+assert.ok(cache.set('big', big.slice(10, 900)));
+assert.deepEqual(cache.get('big'), big.slice(10, 900));
+assert.ok(!cache.set('huge', new Buffer(128 * 1024)));
+
+// Filling the cache evicts entries, but not the one that keeps being read.
+var value = new Buffer(400);
+value.fill(7);
+for (var i = 0; i < 1000; i++) {
+  assert.ok(cache.set('key' + i, value));
+  assert.deepEqual(cache.get('big'), big.slice(10, 900));
+}
+var stats = cache.stats();
+assert.equal(stats.size, 64 * 1024);
+assert.ok(stats.evictions > 0);
+assert.ok(stats.entries <= stats.capacity);
+assert.deepEqual(cache.get('key999'), value);
+
+cache.clear();
+assert.equal(cache.stats().entries, 0);
+assert.strictEqual(cache.get('big'), undefined);
+
+// Entries expire after their ttl.
+assert.ok(cache.set('short', 'lived', 10));
+assert.equal(cache.get('short', 'utf8'), 'lived');
+
+assert.ok(cache.set('from-master', 'hello'));
+
+var worker = cluster.fork();
+var done = false;
+
+worker.on('message', function(m) {
+  if (m.cmd !== 'done') return;
+  done = true;
+  assert.deepEqual(cache.get('from-worker'), new Buffer([1, 2, 3]));
+  assert.strictEqual(cache.get('short'), undefined);
+  worker.kill();
+});
+
+process.on('exit', function() {
+  assert.ok(done);
+  var stats = cache.stats();
+  assert.ok(stats.hits > 0);
+  assert.ok(stats.misses > 0);
+});
@@ -0,0 +1,83 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var cluster = require('cluster');
+var net = require('net');
+
+if (cluster.isWorker) {
+  net.createServer(function(socket) {
+    socket.end(String(process.pid));
+  }).listen(common.PORT);
+  return;
+}
+
+var oldPids = [];
+var deaths = 0;
+var warmedUp = 0;
+var reloaded = false;
+var listening = 0;
+
+cluster.on('death', function(worker) {
+  assert.ok(worker.suicide);
+  deaths++;
+});
+
+function onListening() {
+  if (++listening !== 2) return;
+  cluster.removeListener('listening', onListening);
+
+  cluster.reload({
+    timeout: 5000,
+    warmup: function(worker, done) {
+      assert.ok(worker.listening);
+      assert.equal(oldPids.indexOf(worker.pid), -1);
+      warmedUp++;
+      done();
+    }
+  }, function(err) {
+    if (err) throw err;
+    reloaded = true;
+
+    // The port stayed open and is now served by a replacement.
+    var data = '';
+    var client = net.connect(common.PORT);
+    client.setEncoding('ascii');
+    client.on('data', function(d) { data += d; });
+    client.on('end', function() {
+      assert.equal(oldPids.indexOf(+data), -1);
+      process.exit(0);
+    });
+  });
+}
+
+cluster.on('listening', onListening);
+
+oldPids.push(cluster.fork().pid);
+oldPids.push(cluster.fork().pid);
+
+process.on('exit', function() {
+  assert.ok(reloaded);
+  assert.equal(warmedUp, 2);
+  assert.equal(deaths, 2);
+});
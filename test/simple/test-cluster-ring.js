@@ -0,0 +1,79 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var cluster = require('cluster');
+var path = require('path');
+
+var COUNT = 5000;
+
+if (cluster.isWorker) {
+  var sent = 0;
+  var b = new Buffer(4);
+
+  // A 4k ring fills up long before COUNT messages, so this has to wait for
+  // the master to catch up now and then.
+  function sendSome() {
+    while (sent < COUNT) {
+      b.writeUInt32LE(sent, 0);
+      if (!cluster.ring.send(b)) return setTimeout(sendSome, 1);
+      sent++;
+    }
+  }
+
+  cluster.ring.on('message', function(buffer) {
+    assert.equal(buffer.toString(), 'go');
+    sendSome();
+  });
+  return;
+}
+
+cluster.ringSize = 4096;
+
+var worker = cluster.fork();
+var expected = 0;
+var base = process.env.TMPDIR || '/tmp';
+if (path.existsSync('/dev/shm')) base = '/dev/shm';
+base = path.join(base, 'node-cluster-' + process.pid + '-1');
+
+assert.ok(path.existsSync(base + '.up'));
+assert.ok(path.existsSync(base + '.down.bell'));
+assert.equal(worker.ring.buffer.length, 4096);
+
+worker.on('message', function(m) {
+  if (m.cmd !== 'online') return;
+  // Both sides have the rings mapped; the files are gone.
+  assert.ok(!path.existsSync(base + '.up'));
+  assert.ok(!path.existsSync(base + '.down.bell'));
+  assert.ok(worker.ring.send('go'));
+});
+
+worker.ring.on('message', function(buffer) {
+  assert.equal(buffer.length, 4);
+  assert.equal(buffer.readUInt32LE(0), expected++);
+  if (expected === COUNT) worker.kill();
+});
+
+process.on('exit', function() {
+  assert.equal(expected, COUNT);
+});
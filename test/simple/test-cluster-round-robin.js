@@ -0,0 +1,88 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var cluster = require('cluster');
+var net = require('net');
+
+if (cluster.isWorker) {
+  net.createServer(function(socket) {
+    socket.end(process.env.NODE_WORKER_ID);
+  }).listen(common.PORT, function() {
+    process.send({ cmd: 'ready' });
+  });
+  return;
+}
+
+cluster.schedulingPolicy = 'rr';
+
+assert.throws(function() {
+  cluster.schedulingPolicy = 'random';
+  try {
+    cluster.fork();
+  } finally {
+    cluster.schedulingPolicy = 'rr';
+  }
+});
+
+var workers = [cluster.fork(), cluster.fork()];
+var ready = 0;
+var served = {};
+var connections = 8;
+
+workers.forEach(function(worker) {
+  worker.on('message', function(m) {
+    if (m.cmd === 'ready' && ++ready === workers.length) connectNext();
+  });
+});
+
+function connectNext() {
+  if (connections-- === 0) return finish();
+
+  var data = '';
+  var client = net.connect(common.PORT, function() {
+    client.setEncoding('ascii');
+  });
+  client.on('data', function(d) { data += d; });
+  client.on('end', function() {
+    served[data] = (served[data] || 0) + 1;
+    connectNext();
+  });
+}
+
+function finish() {
+  // Give the workers' connDone messages time to arrive.
+  setTimeout(function() {
+    workers.forEach(function(worker) {
+      assert.equal(worker.queueDepth, 0);
+      worker.kill();
+    });
+  }, 200);
+}
+
+process.on('exit', function() {
+  var ids = Object.keys(served);
+  assert.equal(ids.length, 2);
+  assert.equal(served[ids[0]], 4);
+  assert.equal(served[ids[1]], 4);
+});
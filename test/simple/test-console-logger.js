@@ -0,0 +1,133 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+var spawn = require('child_process').spawn;
+
+var file = path.join(common.tmpDir, 'console-logger.log');
+try { fs.unlinkSync(file); } catch (e) {}
+
+function records(filename) {
+  return fs.readFileSync(filename, 'utf8').split('\n').filter(function(line) {
+    return line !== '';
+  }).map(function(line) {
+    return JSON.parse(line);
+  });
+}
+
+// Fields, escaping and levels.
+var before = Date.now();
+var logger = console.createLogger({ path: file, level: 'info' });
+
+assert.equal(logger.debug('hidden'), false);
+assert.equal(logger.info('plain'), true);
+logger.warn('quote " backslash \\ newline \n tab \t bell \u0007 é中', {
+  n: 42,
+  f: 1.5,
+  nan: NaN,
+  yes: true,
+  nil: null,
+  s: 'x"y',
+  'k"ey': 1
+});
+logger.error(123, { o: { a: 1 } });
+logger.flushSync();
+
+var logged = records(file);
+assert.equal(logged.length, 3);
+
+assert.equal(logged[0].level, 'info');
+assert.equal(logged[0].msg, 'plain');
+assert.ok(logged[0].t >= before - 1);
+assert.ok(logged[0].t <= Date.now() + 1);
+
+assert.equal(logged[1].level, 'warn');
+assert.equal(logged[1].msg,
+             'quote " backslash \\ newline \n tab \t bell \u0007 é中');
+assert.strictEqual(logged[1].n, 42);
+assert.strictEqual(logged[1].f, 1.5);
+assert.strictEqual(logged[1].nan, null);
+assert.strictEqual(logged[1].yes, true);
+assert.strictEqual(logged[1].nil, null);
+assert.strictEqual(logged[1].s, 'x"y');
+assert.strictEqual(logged[1]['k"ey'], 1);
+
+assert.equal(logged[2].level, 'error');
+assert.equal(logged[2].msg, '123');
+assert.equal(logged[2].o, '[object Object]');
+
+assert.throws(function() {
+  console.createLogger({ path: file, level: 'loud' });
+});
+
+// Many records through small buffers are written on the thread pool, in
+// order, and all of them.
+var COUNT = 20000;
+var big = console.createLogger({ path: file, bufferSize: 4096 });
+for (var i = 0; i < COUNT; i++) big.info('record', { i: i });
+
+setTimeout(function() {
+  big.flushSync();
+  var stats = big.stats();
+  assert.equal(stats.records, COUNT);
+  assert.equal(stats.errors, 0);
+  big.close();
+  logger.close();
+  assert.throws(function() { logger.info('closed'); });
+
+  logged = records(file);
+  assert.equal(logged.length, 3 + COUNT);
+  for (var i = 0; i < COUNT; i++) assert.equal(logged[3 + i].i, i);
+
+  runChildren();
+}, 100);
+
+// What is buffered is written when the process exits, however it does.
+var done = 0;
+
+function runChildren() {
+  ['normal', 'exit', 'throw'].forEach(function(how) {
+    var childFile = path.join(common.tmpDir, 'console-logger-' + how + '.log');
+    try { fs.unlinkSync(childFile); } catch (e) {}
+
+    var script =
+        'var logger = console.createLogger({ path: ' +
+        JSON.stringify(childFile) + ' });' +
+        'for (var i = 0; i < 1000; i++) logger.info("r", { i: i });' +
+        (how === 'exit' ? 'process.exit(3);' : '') +
+        (how === 'throw' ? 'throw new Error("boom");' : '');
+
+    var child = spawn(process.execPath, ['-e', script]);
+    child.on('exit', function(code) {
+      assert.equal(code, { normal: 0, exit: 3, 'throw': 1 }[how]);
+      assert.equal(records(childFile).length, 1000, how);
+      done++;
+    });
+  });
+}
+
+process.on('exit', function() {
+  assert.equal(done, 3);
+});
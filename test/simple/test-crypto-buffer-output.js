@@ -0,0 +1,99 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+var crypto = require('crypto');
+var fs = require('fs');
+
+var keyPem = fs.readFileSync(common.fixturesDir + '/test_key.pem');
+var certPem = fs.readFileSync(common.fixturesDir + '/test_cert.pem');
+
+function check(buffer, binary) {
+  assert.ok(Buffer.isBuffer(buffer));
+  assert.equal(typeof buffer.slice(0, 1).copy, 'function');
+  assert.equal(buffer.toString('binary'), binary);
+}
+
+// Hash and Hmac
+check(crypto.createHash('sha1').update('abc').digest('buffer'),
+      crypto.createHash('sha1').update('abc').digest('binary'));
+check(crypto.createHmac('md5', 'key').update('abc').digest('buffer'),
+      crypto.createHmac('md5', 'key').update('abc').digest('binary'));
+
+// The ascii-only encodings are unchanged
+assert.equal(crypto.createHash('md5').update('abc').digest('hex'),
+             '900150983cd24fb0d6963f7d28e17f72');
+assert.equal(crypto.createHash('md5').update('abc').digest('base64'),
+             'kAFQmDzST7DWlj99KOF/cg==');
+
+// Cipher and Decipher
+var plain = new Buffer(1000);
+for (var i = 0; i < plain.length; i++) plain[i] = i & 0xff;
+
+var cipher = crypto.createCipher('aes256', 'secret');
+var expected = cipher.update(plain, 'binary', 'binary') +
+               cipher.final('binary');
+
+cipher = crypto.createCipher('aes256', 'secret');
+var first = cipher.update(plain, 'binary', 'buffer');
+var last = cipher.final('buffer');
+check(first, expected.slice(0, first.length));
+check(last, expected.slice(first.length));
+
+var decipher = crypto.createDecipher('aes256', 'secret');
+var out = decipher.update(expected, 'binary', 'buffer');
+var rest = decipher.final('buffer');
+assert.ok(Buffer.isBuffer(rest));
+assert.equal(out.toString('binary') + rest.toString('binary'),
+             plain.toString('binary'));
+
+// An update that produces no output still gives a buffer
+cipher = crypto.createCipher('aes256', 'secret');
+var empty = cipher.update('', 'binary', 'buffer');
+assert.ok(Buffer.isBuffer(empty));
+assert.equal(empty.length, 0);
+
+// Sign and Verify with buffer keys and signatures
+var signature = crypto.createSign('RSA-SHA1')
+                      .update('message')
+                      .sign(keyPem, 'buffer');
+assert.ok(Buffer.isBuffer(signature));
+assert.equal(signature.toString('binary'),
+             crypto.createSign('RSA-SHA1')
+                   .update('message')
+                   .sign(keyPem.toString(), 'binary'));
+
+assert.ok(crypto.createVerify('RSA-SHA1')
+                .update('message')
+                .verify(certPem, signature));
+assert.ok(crypto.createVerify('RSA-SHA1')
+                .update('message')
+                .verify(certPem.toString(), signature.toString('binary')));
+assert.ok(!crypto.createVerify('RSA-SHA1')
+                 .update('other message')
+                 .verify(certPem, signature));
@@ -0,0 +1,91 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+var crypto = require('crypto');
+
+var plain = new Buffer(1024 * 1024 + 3);
+for (var i = 0; i < plain.length; i++) plain[i] = i % 251;
+
+var expected = crypto.createCipher('aes192', 'secret');
+expected = expected.update(plain.toString('binary'), 'binary', 'binary') +
+           expected.final('binary');
+
+var chunks = [];
+var callbacks = 0;
+var cipher = crypto.createCipher('aes192', 'secret');
+
+// Queue several updates at once; they have to complete in order.
+for (var off = 0; off < plain.length; off += 100000) {
+  (function(n) {
+    cipher.update(plain.slice(off, Math.min(off + 100000, plain.length)), function(err, out) {
+      assert.equal(err, null);
+      assert.ok(Buffer.isBuffer(out));
+      assert.equal(n, callbacks++);
+      chunks.push(out.toString('binary'));
+      if (n === 10) finish();
+    });
+  })(off / 100000);
+}
+
+// Synchronous use while an update is pending is an error.
+assert.throws(function() {
+  cipher.update('x', 'binary', 'binary');
+}, /Asynchronous update in progress/);
+assert.throws(function() {
+  cipher.final('binary');
+}, /Asynchronous update in progress/);
+
+function finish() {
+  var result = chunks.join('') + cipher.final('binary');
+  assert.equal(result, expected);
+
+  var decipher = crypto.createDecipher('aes192', 'secret');
+  decipher.update(result, function(err, out) {
+    assert.equal(err, null);
+    var text = out.toString('binary') + decipher.final('binary');
+    assert.equal(text, plain.toString('binary'));
+    decrypted = true;
+  });
+}
+
+// Errors are passed to the callback.
+var bad = crypto.createCipher('aes192', 'secret');
+bad.final('binary');
+var gotError = false;
+bad.update('abc', function(err, out) {
+  assert.ok(err instanceof Error);
+  gotError = true;
+});
+
+var decrypted = false;
+process.on('exit', function() {
+  assert.equal(callbacks, 11);
+  assert.ok(decrypted);
+  assert.ok(gotError);
+});
@@ -0,0 +1,91 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+var common = require('../common');
+var assert = require('assert');
+var crypto = require('crypto');
+
+var calls = 0;
+
+// The RFC 3526 2048 bit group.
+var modp14 = 'ffffffffffffffffc90fdaa22168c234c4c6628b80dc1cd1' +
+             '29024e088a67cc74020bbea63b139b22514a08798e3404dd' +
+             'ef9519b3cd3a431b302b0a6df25f14374fe1356d6d51c245' +
+             'e485b576625e7ec6f44c42e9a637ed6b0bff5cb6f406b7ed' +
+             'ee386bfb5a899fa5ae9f24117c4b1fe649286651ece45b3d' +
+             'c2007cb8a163bf0598da48361c55d39a69163fa8fd24cf5f' +
+             '83655d23dca3ad961c62f356208552bb9ed529077096966d' +
+             '670c354e4abc9804f1746c08ca18217c32905e462e36ce3b' +
+             'e39e772c180e86039b2783a2ec07a28fb5c55df06f4c52c9' +
+             'de2bcbf6955817183995497cea956ae515d2261898fa0510' +
+             '15728e5a8aacaa68ffffffffffffffff';
+
+var alice = crypto.getDiffieHellman('modp14');
+assert.equal(alice.getPrime('hex'), modp14);
+assert.equal(alice.getGenerator('hex'), '02');
+assert.equal(crypto.getDiffieHellman('modp1').getPrime().length, 96);
+assert.equal(crypto.getDiffieHellman('modp18').getPrime().length, 1024);
+assert.throws(function() { crypto.getDiffieHellman('modp3'); }, /Unknown group/);
+
+// Async key generation agrees with the synchronous one.
+var bob = crypto.getDiffieHellman('modp14');
+var bobKey = bob.generateKeys('hex');
+
+alice.generateKeys('hex', function(err, aliceKey) {
+  assert.equal(err, null);
+  assert.equal(aliceKey, alice.getPublicKey('hex'));
+  assert.equal(alice.computeSecret(bobKey, 'hex', 'hex'),
+               bob.computeSecret(aliceKey, 'hex', 'hex'));
+  calls++;
+});
+
+// The keys are off limits until then.
+assert.throws(function() { alice.getPublicKey(); }, /in progress/);
+assert.throws(function() { alice.generateKeys(); }, /in progress/);
+
+// Without an encoding the key comes back binary.
+var carol = crypto.getDiffieHellman('modp2');
+carol.generateKeys(function(err, key) {
+  assert.equal(err, null);
+  assert.equal(key, carol.getPublicKey());
+  calls++;
+});
+
+// Parameters generated on the thread pool.
+crypto.createDiffieHellman(256, function(err, dh) {
+  assert.equal(err, null);
+  assert.ok(dh instanceof crypto.DiffieHellman);
+  assert.equal(dh.getPrime().length, 32);
+  var other = crypto.createDiffieHellman(dh.getPrime(), 'binary');
+  var key = dh.generateKeys();
+  assert.equal(dh.computeSecret(other.generateKeys()),
+               other.computeSecret(key));
+  calls++;
+});
+
+process.on('exit', function() {
+  assert.equal(calls, 3);
+});
@@ -0,0 +1,95 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+var common = require('../common');
+var assert = require('assert');
+var crypto = require('crypto');
+
+var inputs = [
+  new Buffer(0),
+  new Buffer('cache:key:1'),
+  'cache:key:2',
+  new Buffer(1000)
+];
+inputs[3].fill(0x61);
+
+function expected(create) {
+  return inputs.map(function(input) {
+    return create().update(input).digest('hex');
+  }).join('');
+}
+
+function sha1() { return crypto.createHash('sha1'); }
+function hmac() { return crypto.createHmac('sha1', 'secret'); }
+
+// Synchronous
+var hashes = crypto.hashBatch('sha1', inputs);
+assert.ok(Buffer.isBuffer(hashes));
+assert.equal(hashes.length, inputs.length * 20);
+assert.equal(hashes.toString('hex'), expected(sha1));
+
+var macs = crypto.hmacBatch('sha1', 'secret', inputs);
+assert.equal(macs.toString('hex'), expected(hmac));
+assert.equal(crypto.hmacBatch('sha1', new Buffer('secret'), inputs)
+                   .toString('hex'),
+             expected(hmac));
+
+assert.equal(crypto.hashBatch('md5', []).length, 0);
+
+assert.throws(function() {
+  crypto.hashBatch('no-such-digest', inputs);
+}, /Unknown message digest/);
+
+assert.throws(function() {
+  crypto.hashBatch('sha1', 'not an array');
+}, TypeError);
+
+// On the thread pool
+var calls = 0;
+
+crypto.hashBatch('sha1', inputs, function(err, result) {
+  assert.equal(err, null);
+  assert.equal(result.toString('hex'), expected(sha1));
+  calls++;
+});
+
+var many = [];
+for (var i = 0; i < 10000; i++) many.push(new Buffer('key' + i));
+crypto.hmacBatch('sha256', 'secret', many, function(err, result) {
+  assert.equal(err, null);
+  assert.equal(result.length, 10000 * 32);
+  assert.equal(result.slice(32 * 9999).toString('hex'),
+               crypto.createHmac('sha256', 'secret')
+                     .update('key9999').digest('hex'));
+  calls++;
+});
+
+// The caller's array can change while a job is pending
+many.length = 0;
+
+process.on('exit', function() {
+  assert.equal(calls, 2);
+});
@@ -0,0 +1,72 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+var common = require('../common');
+var assert = require('assert');
+var crypto = require('crypto');
+var fs = require('fs');
+var path = require('path');
+
+var file = path.join(common.tmpDir, 'hash-file.bin');
+
+// Larger than one chunk, so that it takes several reads
+var data = new Buffer(3 * 1024 * 1024 + 123);
+for (var i = 0; i < data.length; i++) data[i] = i % 251;
+fs.writeFileSync(file, data);
+
+var expected = crypto.createHash('sha1').update(data).digest('hex');
+var done = 0;
+
+crypto.hashFile(file, 'sha1', function(err, digest) {
+  assert.ifError(err);
+  assert.ok(digest instanceof Buffer);
+  assert.equal(digest.toString('hex'), expected);
+  assert.equal(digest.readUInt8(0), parseInt(expected.slice(0, 2), 16));
+  done++;
+});
+
+crypto.hashFile(file, 'sha1', 'hex', function(err, digest) {
+  assert.ifError(err);
+  assert.equal(digest, expected);
+  done++;
+});
+
+crypto.hashFile(path.join(common.tmpDir, 'no-such-file'), 'md5',
+                function(err, digest) {
+  assert.ok(err);
+  assert.equal(err.code, 'ENOENT');
+  assert.equal(digest, undefined);
+  done++;
+});
+
+assert.throws(function() {
+  crypto.hashFile(file, 'no-such-hash', function() {});
+}, /Unknown message digest/);
+
+process.on('exit', function() {
+  assert.equal(done, 3);
+  fs.unlinkSync(file);
+});
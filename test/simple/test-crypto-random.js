@@ -56,6 +56,26 @@ process.setMaxListeners(256);
   });
 });
 
+// Small synchronous requests come from the pool; enough of them to use it up
+// and refill it must still give distinct bytes of the right length.
+[crypto.randomBytes,
+  crypto.pseudoRandomBytes
+].forEach(function(f) {
+  var seen = {};
+  for (var i = 0; i < 5000; i++) {
+    var len = i % 257;
+    var buf = f(len);
+    assert.ok(Buffer.isBuffer(buf));
+    assert.equal(len, buf.length);
+    if (len >= 16) {
+      var key = buf.toString('hex');
+      assert.ok(!seen[key], 'random bytes handed out twice');
+      seen[key] = true;
+    }
+  }
+  assert.equal(4096, f(4096).length);
+});
+
 // assert that the callback is indeed called
 function checkCall(cb, desc) {
   var called_ = false;
@@ -0,0 +1,90 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+
+try {
+  var crypto = require('crypto');
+} catch (e) {
+  console.log('Not compiled with OPENSSL support.');
+  process.exit();
+}
+
+var certPem = fs.readFileSync(common.fixturesDir + '/test_cert.pem', 'ascii');
+var keyPem = fs.readFileSync(common.fixturesDir + '/test_key.pem', 'ascii');
+
+var expected = crypto.createSign('RSA-SHA256')
+                     .update('Test123')
+                     .sign(keyPem, 'base64');
+var signed = 0;
+var verified = 0;
+
+// Many signatures with one key, all on the thread pool.
+for (var i = 0; i < 20; i++) {
+  crypto.createSign('RSA-SHA256')
+        .update('Test123')
+        .sign(keyPem, 'base64', function(err, signature) {
+    assert.equal(err, null);
+    assert.equal(signature, expected);
+    signed++;
+  });
+}
+
+var signer = crypto.createSign('RSA-SHA256').update('Test123');
+signer.sign(new Buffer(keyPem), 'buffer', function(err, signature) {
+  assert.equal(err, null);
+  assert.ok(Buffer.isBuffer(signature));
+  assert.equal(signature.toString('base64'), expected);
+  signed++;
+
+  crypto.createVerify('RSA-SHA256')
+        .update('Test123')
+        .verify(certPem, signature, function(err, valid) {
+    assert.equal(err, null);
+    assert.strictEqual(valid, true);
+    verified++;
+  });
+});
+// The signer is busy until the callback.
+assert.throws(function() { signer.update('more'); }, /in progress/);
+
+crypto.createVerify('RSA-SHA256')
+      .update('Test124')
+      .verify(certPem, expected, 'base64', function(err, valid) {
+  assert.equal(err, null);
+  assert.strictEqual(valid, false);
+  verified++;
+});
+
+crypto.createSign('RSA-SHA256')
+      .update('Test123')
+      .sign('not a key', 'base64', function(err, signature) {
+  assert.ok(err instanceof Error);
+  signed++;
+});
+
+process.on('exit', function() {
+  assert.equal(signed, 22);
+  assert.equal(verified, 2);
+});
@@ -0,0 +1,61 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var dgram = require('dgram');
+
+var N = 500;
+var received = 0;
+
+var server = dgram.createSocket('udp4');
+server.setRecvBatch(32, 256);
+
+server.on('message', function(msg, rinfo) {
+  assert.equal(msg.toString(), 'message ' + received);
+  assert.equal(rinfo.address, '127.0.0.1');
+  assert.equal(rinfo.port, client.address().port);
+  assert.equal(rinfo.size, msg.length);
+  if (++received === N) {
+    server.close();
+    client.close();
+  }
+});
+
+server.bind(common.PORT, '127.0.0.1');
+
+var client = dgram.createSocket('udp4');
+var sent = 0;
+
+// Bursts give the server several datagrams to read at a time.
+function burst() {
+  for (var i = 0; i < 50 && sent < N; i++) {
+    var buf = new Buffer('message ' + sent++);
+    client.send(buf, 0, buf.length, common.PORT, '127.0.0.1');
+  }
+  if (sent < N) setTimeout(burst, 5);
+}
+
+server.on('listening', burst);
+
+process.on('exit', function() {
+  assert.equal(received, N);
+});
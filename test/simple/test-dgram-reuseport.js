@@ -0,0 +1,83 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Sockets created with reusePort bind the same port; datagrams sent to it
+// reach one of them.
+
+var common = require('../common');
+var assert = require('assert');
+var dgram = require('dgram');
+
+var COUNT = 20;
+
+var listening = 0;
+var received = 0;
+var error = null;
+
+var sockets = [0, 1].map(function() {
+  var socket = dgram.createSocket({ type: 'udp4', reusePort: true });
+  socket.on('error', function(e) {
+    assert.equal('ENOTSUP', e.code);
+    error = e;
+    socket.close();
+  });
+  socket.on('message', function(msg) {
+    assert.equal(msg.toString(), 'hello');
+    if (++received == COUNT) {
+      sockets.forEach(function(s) { s.close(); });
+    }
+  });
+  socket.on('listening', onListening);
+  return socket;
+});
+
+function onListening() {
+  if (++listening < 2) return;
+
+  // A socket without the option can't join them.
+  var other = dgram.createSocket('udp4');
+  other.on('error', function(e) {
+    assert.equal('EADDRINUSE', e.code);
+    other.close();
+    send();
+  });
+  other.bind(common.PORT, '127.0.0.1');
+}
+
+// A new sender per datagram, so the kernel sees different flows.
+function send() {
+  for (var i = 0; i < COUNT; i++) {
+    var client = dgram.createSocket('udp4');
+    var buf = new Buffer('hello');
+    client.send(buf, 0, buf.length, common.PORT, '127.0.0.1',
+                client.close.bind(client));
+  }
+}
+
+sockets[0].bind(common.PORT, '127.0.0.1');
+sockets[1].bind(common.PORT, '127.0.0.1');
+
+process.on('exit', function() {
+  // Either both sockets share the port, or the platform lacks SO_REUSEPORT.
+  if (error) return;
+  assert.equal(listening, 2);
+  assert.equal(received, COUNT);
+});
@@ -0,0 +1,59 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var dgram = require('dgram');
+
+var N = 20;
+var received = 0;
+
+var server = dgram.createSocket('udp4');
+var clients = [dgram.createSocket('udp4'), dgram.createSocket('udp4')];
+
+server.on('message', function(msg, rinfo) {
+  var client = clients[msg[0]];
+  assert.equal(rinfo.address, '127.0.0.1');
+  assert.equal(rinfo.port, client.address().port);
+  assert.equal(rinfo.size, 1);
+  // Every message gets an rinfo of its own; the cached part is the string.
+  rinfo.address = 'mangled';
+  if (++received === N) {
+    server.close();
+    clients[0].close();
+    clients[1].close();
+  }
+});
+
+server.on('listening', function() {
+  var sent = 0;
+  (function next() {
+    if (sent === N) return;
+    var i = sent++ % 2;
+    clients[i].send(new Buffer([i]), 0, 1, common.PORT, '127.0.0.1', next);
+  })();
+});
+
+server.bind(common.PORT, '127.0.0.1');
+
+process.on('exit', function() {
+  assert.equal(received, N);
+});
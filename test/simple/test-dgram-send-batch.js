@@ -0,0 +1,70 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var dgram = require('dgram');
+
+var N = 100;
+var received = [];
+var sendCount = -1;
+
+var server = dgram.createSocket('udp4');
+var client = dgram.createSocket('udp4');
+
+server.on('message', function(msg, rinfo) {
+  received.push(msg.toString());
+  if (received.length === N) {
+    server.close();
+    client.close();
+  }
+});
+
+server.on('listening', function() {
+  // Send the middle of each buffer, to check offsets and lengths.
+  var buffers = [];
+  var offsets = [];
+  var lengths = [];
+  for (var i = 0; i < N; i++) {
+    var text = 'message ' + i;
+    buffers.push(new Buffer('[' + text + ']'));
+    offsets.push(1);
+    lengths.push(text.length);
+  }
+
+  assert.throws(function() {
+    client.sendBatch([new Buffer(1)], [0], [2], common.PORT, '127.0.0.1');
+  });
+
+  client.sendBatch(buffers, offsets, lengths, common.PORT, '127.0.0.1',
+                   function(err, count) {
+    assert.ifError(err);
+    sendCount = count;
+  });
+});
+
+server.bind(common.PORT, '127.0.0.1');
+
+process.on('exit', function() {
+  assert.equal(sendCount, N);
+  assert.equal(received.length, N);
+  for (var i = 0; i < N; i++) assert.equal(received[i], 'message ' + i);
+});
@@ -0,0 +1,96 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var dns = require('dns');
+
+assert.throws(function() { dns.setLookupCacheTTL(-1); });
+assert.throws(function() { dns.setLookupCacheTTL('foo'); });
+
+dns.setLookupCacheTTL(60);
+dns.clearCache();
+
+var answers = [];
+
+function onlookup(err, address, family) {
+  if (err) throw err;
+  answers.push(address + '/' + family);
+
+  if (answers.length === 3) {
+    var stats = dns.cacheStats();
+    assert.equal(stats.misses, 1);
+    assert.equal(stats.collapsed, 2);
+    assert.equal(stats.inflight, 0);
+    assert.equal(stats.entries, 1);
+    assert.equal(stats.lookupTTL, 60);
+
+    var sync = true;
+    dns.lookup('localhost', 4, function(err, address, family) {
+      if (err) throw err;
+      assert.ok(!sync);
+      assert.equal(address + '/' + family, answers[0]);
+      assert.equal(dns.cacheStats().hits, 1);
+      cachedDone = true;
+      throwingLookups();
+    });
+    sync = false;
+  }
+}
+
+var cachedDone = false;
+
+// A callback that throws doesn't keep the answer from the queries that
+// joined it.
+var thrown = false;
+var survivors = 0;
+
+function throwingLookups() {
+  dns.clearCache();
+  process.once('uncaughtException', function(e) {
+    assert.equal(e.message, 'first');
+    thrown = true;
+  });
+  dns.lookup('localhost', 4, function() {
+    throw new Error('first');
+  });
+  for (var i = 0; i < 2; i++) {
+    dns.lookup('localhost', 4, function(err, address, family) {
+      if (err) throw err;
+      assert.equal(address + '/' + family, answers[0]);
+      survivors++;
+    });
+  }
+}
+
+dns.lookup('localhost', 4, onlookup);
+dns.lookup('localhost', 4, onlookup);
+dns.lookup('localhost', 4, onlookup);
+
+process.on('exit', function() {
+  assert.equal(answers.length, 3);
+  assert.equal(answers[0], answers[1]);
+  assert.equal(answers[0], answers[2]);
+  assert.ok(cachedDone);
+  assert.ok(thrown);
+  assert.equal(survivors, 2);
+});
@@ -0,0 +1,57 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var dns = require('dns');
+
+assert.throws(function() { dns.setLookupBackend('nss'); });
+
+dns.setLookupBackend('cares');
+assert.equal(dns.cacheStats().lookupBackend, 'cares');
+
+var answered = 0;
+
+// localhost comes from the in-memory copy of the hosts file.
+var sync = true;
+dns.lookup('localhost', 4, function(err, address, family) {
+  if (err) throw err;
+  assert.ok(!sync);
+  assert.equal(address, '127.0.0.1');
+  assert.equal(family, 4);
+  answered++;
+});
+sync = false;
+
+// IP addresses never reach the resolver.
+dns.lookup('127.0.0.1', function(err, address, family) {
+  if (err) throw err;
+  assert.equal(address, '127.0.0.1');
+  assert.equal(family, 4);
+  answered++;
+
+  dns.setLookupBackend('getaddrinfo');
+});
+
+process.on('exit', function() {
+  assert.equal(answered, 2);
+});
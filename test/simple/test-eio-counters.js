@@ -0,0 +1,48 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+
+var before = process.uvCounters();
+assert.equal(typeof before.eio_poll, 'number');
+assert.equal(typeof before.eio_done, 'number');
+assert.equal(typeof before.eio_poll_limited, 'number');
+
+// A burst of cheap requests must all finish and be counted.
+var N = 200;
+var pending = N;
+
+for (var i = 0; i < N; i++) {
+  fs.stat(__filename, function(err) {
+    assert.ifError(err);
+    if (--pending === 0) {
+      setTimeout(check, 10);
+    }
+  });
+}
+
+function check() {
+  var after = process.uvCounters();
+  assert.ok(after.eio_done - before.eio_done >= N);
+  assert.ok(after.eio_poll > before.eio_poll);
+}
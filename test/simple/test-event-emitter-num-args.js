@@ -41,8 +41,25 @@ e.emit('numArgs', null, null, null);
 e.emit('numArgs', null, null, null, null);
 e.emit('numArgs', null, null, null, null, null);
 
+// The same with more than one listener.
+var e2 = new events.EventEmitter(),
+    num_args_emited2 = [];
+
+function countArgs() {
+  num_args_emited2.push(arguments.length);
+}
+e2.on('numArgs', countArgs);
+e2.on('numArgs', countArgs);
+
+e2.emit('numArgs');
+e2.emit('numArgs', null);
+e2.emit('numArgs', null, null);
+e2.emit('numArgs', null, null, null);
+e2.emit('numArgs', null, null, null, null);
+
 process.on('exit', function() {
   assert.deepEqual([0, 1, 2, 3, 4, 5], num_args_emited);
+  assert.deepEqual([0, 0, 1, 1, 2, 2, 3, 3, 4, 4], num_args_emited2);
 });
 
 
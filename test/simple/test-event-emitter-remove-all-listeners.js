@@ -41,3 +41,16 @@ e2.removeAllListeners();
 console.error(e2);
 assert.deepEqual([], e2.listeners('foo'));
 assert.deepEqual([], e2.listeners('bar'));
+
+
+// listeners() returns a copy.
+var e3 = new events.EventEmitter();
+var calls = 0;
+e3.on('foo', function() { calls++; });
+e3.on('foo', function() { calls++; });
+e3.listeners('foo').length = 0;
+e3.listeners('foo').push(listener);
+e3.emit('foo');
+assert.equal(calls, 2);
+assert.equal(e3.listeners('foo').length, 2);
+assert.notStrictEqual(e3.listeners('foo'), e3.listeners('foo'));
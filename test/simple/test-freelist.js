@@ -0,0 +1,94 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var FreeList = require('freelist').FreeList;
+var http = require('http');
+
+var created = 0;
+var resets = 0;
+var list = new FreeList('test', 2, function(tag) {
+  created++;
+  return { tag: tag, state: null };
+}, function(obj) {
+  resets++;
+  obj.state = null;
+});
+
+var a = list.alloc('a');
+var b = list.alloc('b');
+var c = list.alloc('c');
+assert.equal(created, 3);
+assert.equal(a.tag, 'a');
+
+a.state = 'dirty';
+list.free(a);
+list.free(b);
+list.free(c); // over max, dropped
+assert.equal(resets, 3);
+assert.equal(a.state, null);
+
+// Most recently freed object comes back first.
+assert.strictEqual(list.alloc(), b);
+assert.strictEqual(list.alloc(), a);
+assert.equal(created, 3);
+
+assert.deepEqual(list.stats(), {
+  name: 'test',
+  max: 2,
+  length: 0,
+  allocs: 5,
+  hits: 2,
+  misses: 3,
+  frees: 3,
+  drops: 1
+});
+
+// A reset hook is optional.
+var plain = new FreeList('plain', 1, function() { return {}; });
+var o = plain.alloc();
+plain.free(o);
+assert.strictEqual(plain.alloc(), o);
+
+// Parsers released by the http server no longer reference their socket.
+var server = http.createServer(function(req, res) {
+  res.end('ok');
+});
+
+server.listen(common.PORT, function() {
+  http.get({ port: common.PORT, path: '/' }, function(res) {
+    res.on('end', function() {
+      server.close();
+    });
+  });
+});
+
+process.on('exit', function() {
+  var stats = http.parsers.stats();
+  assert.ok(stats.frees >= 1);
+  assert.ok(stats.length >= 1);
+  http.parsers.list.forEach(function(parser) {
+    assert.equal(parser.socket, null);
+    assert.equal(parser.incoming, null);
+    assert.equal(parser.onIncoming, null);
+  });
+});
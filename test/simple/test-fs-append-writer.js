@@ -0,0 +1,71 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+var file = path.join(common.tmpDir, 'append-writer.txt');
+try { fs.unlinkSync(file); } catch (e) {}
+var fd = fs.openSync(file, 'a');
+
+var writer = new fs.AppendWriter(fd);
+var acked = [];
+var expected = '';
+
+function append(i) {
+  var record = 'record ' + i + '\n';
+  expected += record;
+  writer.append(i % 2 ? new Buffer(record) : record, function(err) {
+    assert.ifError(err);
+    acked.push(i);
+  });
+}
+
+// The first append starts a batch of its own and the rest wait for it.
+append(0);
+assert.ok(writer.writing);
+for (var i = 1; i < 100; i++) append(i);
+
+// Appends from a callback go with the next batch.
+writer.append('last\n', function(err) {
+  assert.ifError(err);
+  assert.equal(acked.length, 100);
+  writer.append('after\n', function(err) {
+    assert.ifError(err);
+    assert.equal(fs.readFileSync(file, 'utf8'), expected + 'last\nafter\n');
+    fs.closeSync(fd);
+
+    var failed = new fs.AppendWriter(fd, { sync: false });
+    failed.append('x', function(err) {
+      assert.equal(err.code, 'EBADF');
+      done = true;
+    });
+  });
+});
+
+var done = false;
+
+process.on('exit', function() {
+  for (var i = 0; i < acked.length; i++) assert.equal(acked[i], i);
+  assert.ok(done);
+});
@@ -0,0 +1,124 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+if (!fs.fadvise) {
+  console.error('Skipping: no posix_fadvise() on this platform');
+  process.exit(0);
+}
+
+var file = path.join(common.tmpDir, 'fadvise.bin');
+var size = 5 * 1024 * 1024 + 123;
+var data = new Buffer(size);
+for (var i = 0; i < size; i++) data[i] = i % 251;
+
+fs.writeFileSync(file, data);
+
+var fd = fs.openSync(file, 'r');
+['normal', 'sequential', 'random', 'willneed', 'dontneed', 'noreuse'].forEach(
+    function(advice) {
+      fs.fadviseSync(fd, 0, 0, advice);
+      fs.fadviseSync(fd, 4096, 8192, advice);
+    });
+
+assert.throws(function() {
+  fs.fadviseSync(fd, 0, 0, 'never');
+}, TypeError);
+assert.throws(function() {
+  fs.fadviseSync(fd, -1, 0, 'normal');
+}, TypeError);
+
+var asyncDone = false;
+fs.fadvise(fd, 0, size, 'willneed', function(err) {
+  assert.equal(err, null);
+  fs.closeSync(fd);
+  asyncDone = true;
+});
+
+assert.throws(function() {
+  fs.createReadStream(file, {advice: 'never'});
+}, /Unknown advice/);
+assert.throws(function() {
+  fs.createWriteStream(file + '.out', {advice: 'willneed'});
+}, /Unknown advice/);
+
+function readAll(options, cb) {
+  var chunks = [];
+  var length = 0;
+  var stream = fs.createReadStream(file, options);
+  stream.on('data', function(chunk) {
+    chunks.push(chunk);
+    length += chunk.length;
+  });
+  stream.on('close', function() {
+    var all = new Buffer(length);
+    var pos = 0;
+    chunks.forEach(function(chunk) {
+      chunk.copy(all, pos);
+      pos += chunk.length;
+    });
+    cb(all);
+  });
+}
+
+function sameAs(buffer, start, end) {
+  assert.equal(buffer.length, end - start);
+  for (var i = 0; i < buffer.length; i++) {
+    if (buffer[i] !== data[start + i]) {
+      assert.fail(buffer[i], data[start + i], 'byte ' + i + ' differs');
+    }
+  }
+}
+
+var streamsDone = 0;
+
+readAll({advice: 'sequential', dropBehind: true}, function(all) {
+  sameAs(all, 0, size);
+  streamsDone++;
+});
+
+readAll({advice: 'noreuse', start: 1000, end: 3 * 1024 * 1024,
+         readAhead: 4}, function(all) {
+  sameAs(all, 1000, 3 * 1024 * 1024 + 1);
+  streamsDone++;
+});
+
+var out = path.join(common.tmpDir, 'fadvise-out.bin');
+var ws = fs.createWriteStream(out, {advice: 'dontneed'});
+for (var offset = 0; offset < size; offset += 65536) {
+  ws.write(data.slice(offset, Math.min(offset + 65536, size)));
+}
+ws.end();
+ws.on('close', function() {
+  sameAs(fs.readFileSync(out), 0, size);
+  streamsDone++;
+});
+
+process.on('exit', function() {
+  assert.ok(asyncDone);
+  assert.equal(streamsDone, 3);
+  fs.unlinkSync(file);
+  fs.unlinkSync(out);
+});
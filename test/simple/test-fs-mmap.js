@@ -0,0 +1,80 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+if (!fs.mmap) {
+  console.error('Skipping: fs.mmap is not available on this platform');
+  process.exit(0);
+}
+
+var file = path.join(common.fixturesDir, 'person.jpg');
+var expected = fs.readFileSync(file);
+var fd = fs.openSync(file, 'r');
+
+// The whole file by default.
+var buffer = fs.mmap(fd);
+assert.ok(Buffer.isBuffer(buffer));
+assert.equal(buffer.length, expected.length);
+assert.equal(buffer.toString('binary'), expected.toString('binary'));
+
+// A real Buffer, not the binding's SlowBuffer.
+assert.ok(buffer instanceof Buffer);
+assert.equal(buffer.readUInt32LE(0), expected.readUInt32LE(0));
+assert.equal(buffer.slice(2, 6).toString('hex'),
+             expected.slice(2, 6).toString('hex'));
+
+// A range, with advice.
+var mapped = fs.mmap(fd, 0, 1000, 'sequential');
+assert.equal(mapped.length, 1000);
+assert.equal(mapped.toString('hex'), expected.slice(0, 1000).toString('hex'));
+
+// Closing the fd keeps the mapping.
+fs.closeSync(fd);
+assert.equal(mapped[999], expected[999]);
+
+// Writes stay in the buffer.
+mapped[0] = (expected[0] + 1) & 0xff;
+assert.equal(mapped[0], (expected[0] + 1) & 0xff);
+assert.equal(fs.readFileSync(file)[0], expected[0]);
+
+assert.throws(function() {
+  fs.mmap(fd, 0, 10);
+}, /EBADF/);
+
+fd = fs.openSync(file, 'r');
+assert.throws(function() {
+  fs.mmap(fd, 1, 10);
+}, /EINVAL/);
+assert.throws(function() {
+  fs.mmap(fd, 0, 10, 'never');
+}, TypeError);
+fs.closeSync(fd);
+
+// An empty file maps to an empty buffer.
+fd = fs.openSync(path.join(common.fixturesDir, 'empty.txt'), 'r');
+var empty = fs.mmap(fd);
+assert.ok(empty instanceof Buffer);
+assert.equal(empty.length, 0);
+fs.closeSync(fd);
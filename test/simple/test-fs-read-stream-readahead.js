@@ -0,0 +1,75 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+var file = path.join(common.fixturesDir, 'person.jpg');
+var expected = fs.readFileSync(file);
+
+function check(options, begin, end, cb) {
+  var chunks = [];
+  var stream = fs.createReadStream(file, options);
+  var paused = false;
+
+  stream.on('data', function(chunk) {
+    assert.ok(!paused);
+    chunks.push(chunk);
+    // Pause now and then, the reads that finish meanwhile must wait.
+    if (chunks.length % 3 === 0) {
+      paused = true;
+      stream.pause();
+      setTimeout(function() {
+        paused = false;
+        stream.resume();
+      }, 1);
+    }
+  });
+
+  stream.on('end', function() {
+    var total = chunks.reduce(function(n, c) { return n + c.length; }, 0);
+    var actual = new Buffer(total);
+    var offset = 0;
+    chunks.forEach(function(c) {
+      c.copy(actual, offset);
+      offset += c.length;
+    });
+    assert.equal(actual.toString('binary'),
+                 expected.slice(begin, end).toString('binary'));
+    cb();
+  });
+}
+
+var ended = 0;
+function done() { ended++; }
+
+check({ bufferSize: 1024, readAhead: 4, start: 0 },
+      0, expected.length, done);
+check({ bufferSize: 1000, readAhead: 8, start: 10, end: 5009 },
+      10, 5010, done);
+// No position, so only one read can be in flight.
+check({ bufferSize: 512, readAhead: 4 }, 0, expected.length, done);
+
+process.on('exit', function() {
+  assert.equal(ended, 3);
+});
@@ -0,0 +1,85 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var net = require('net');
+var path = require('path');
+
+var file = path.join(common.fixturesDir, 'person.jpg');
+var expected = fs.readFileSync(file);
+
+// Count the bytes that take the fast path.
+var sendfileBytes = 0;
+var sendfile = fs.sendfile;
+fs.sendfile = function(outFd, inFd, inOffset, length, callback) {
+  sendfile(outFd, inFd, inOffset, length, function(err, bytesSent) {
+    if (!err) sendfileBytes += bytesSent;
+    callback(err, bytesSent);
+  });
+};
+
+var tests = [
+  // Whole file, after a write that must go out first.
+  { prefix: 'header\r\n', options: {},
+    begin: 0, end: expected.length },
+  { prefix: '', options: { start: 100, end: 4099 },
+    begin: 100, end: 4100 }
+];
+
+var server = net.createServer(function(socket) {
+  var test = tests[server.connections - 1];
+  if (test.prefix) socket.write(test.prefix);
+  fs.createReadStream(file, test.options).pipe(socket);
+});
+
+var done = 0;
+
+function run(test) {
+  var chunks = [];
+  var client = net.connect(common.PORT);
+  client.on('data', function(chunk) {
+    chunks.push(chunk.toString('binary'));
+  });
+  client.on('end', function() {
+    assert.equal(chunks.join(''),
+                 test.prefix +
+                 expected.slice(test.begin, test.end).toString('binary'));
+    done++;
+    if (done < tests.length) {
+      run(tests[done]);
+    } else {
+      server.close();
+    }
+  });
+}
+
+server.listen(common.PORT, function() {
+  run(tests[0]);
+});
+
+process.on('exit', function() {
+  assert.equal(done, tests.length);
+  if (process.platform !== 'win32') {
+    assert.ok(sendfileBytes > 0);
+  }
+});
@@ -0,0 +1,85 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+var file = path.join(common.fixturesDir, 'person.jpg');
+var expected = fs.readFileSync(file);
+var completed = 0;
+
+assert.ok(Buffer.isBuffer(expected));
+assert.equal(expected.length, fs.statSync(file).size);
+
+fs.readFile(file, function(err, buffer) {
+  assert.equal(err, null);
+  assert.equal(buffer.toString('hex'), expected.toString('hex'));
+  checkBufferMethods(buffer);
+  completed++;
+});
+
+// Both come back as real Buffers, not as the binding's SlowBuffers.
+function checkBufferMethods(buffer) {
+  assert.ok(buffer instanceof Buffer);
+  // JPEG files start with an SOI marker.
+  assert.equal(buffer.readUInt16BE(0), 0xffd8);
+  assert.equal(buffer.slice(0, 2).toString('hex'), 'ffd8');
+  assert.equal(buffer.toString('binary', 0, 1), '\u00ff');
+}
+checkBufferMethods(expected);
+
+var text = path.join(common.fixturesDir, 'elipses.txt');
+fs.readFile(text, 'utf8', function(err, string) {
+  assert.equal(err, null);
+  assert.equal(string, fs.readFileSync(text, 'utf8'));
+  completed++;
+});
+
+fs.readFile(path.join(common.fixturesDir, 'empty.txt'), function(err, buffer) {
+  assert.equal(err, null);
+  assert.equal(buffer.length, 0);
+  completed++;
+});
+
+var missing = path.join(common.fixturesDir, 'does-not-exist');
+fs.readFile(missing, function(err, buffer) {
+  assert.equal(err.code, 'ENOENT');
+  assert.equal(err.syscall, 'open');
+  assert.equal(err.path, missing);
+  assert.equal(buffer, undefined);
+  completed++;
+});
+
+assert.throws(function() {
+  fs.readFileSync(missing);
+}, /ENOENT/);
+
+// Files that don't know their size are read to the end all the same.
+if (process.platform === 'linux') {
+  var status = fs.readFileSync('/proc/self/status', 'utf8');
+  assert.ok(/^Name:/.test(status));
+}
+
+process.on('exit', function() {
+  assert.equal(completed, 4);
+});
@@ -0,0 +1,86 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+var file = path.join(common.fixturesDir, 'x.txt');
+var missing = path.join(common.fixturesDir, 'does-not-exist');
+var paths = [file, common.fixturesDir, missing];
+
+function check(results, syscall) {
+  assert.equal(results.length, 3);
+  assert.ok(results[0] instanceof fs.Stats);
+  assert.ok(results[0].isFile());
+  assert.equal(results[0].size, fs.statSync(file).size);
+  assert.ok(results[1].isDirectory());
+  assert.ok(results[2] instanceof Error);
+  assert.equal(results[2].code, 'ENOENT');
+  assert.equal(results[2].syscall, syscall);
+  assert.equal(results[2].path, missing);
+}
+
+check(fs.statManySync(paths), 'stat');
+check(fs.lstatManySync(paths), 'lstat');
+assert.deepEqual(fs.statManySync([]), []);
+
+assert.throws(function() {
+  fs.statManySync([file, 42]);
+}, TypeError);
+
+var done = 0;
+
+fs.statMany(paths, function(err, results) {
+  assert.equal(err, null);
+  check(results, 'stat');
+  done++;
+});
+
+fs.lstatMany(paths, function(err, results) {
+  assert.equal(err, null);
+  check(results, 'lstat');
+  done++;
+});
+
+fs.statMany([], function(err, results) {
+  assert.deepEqual(results, []);
+  done++;
+});
+
+// Big calls are split into several requests; the results keep their order.
+var many = [];
+for (var i = 0; i < 2500; i++) {
+  many.push(i % 2 ? file : missing);
+}
+fs.statMany(many, function(err, results) {
+  assert.equal(err, null);
+  assert.equal(results.length, many.length);
+  for (var i = 0; i < results.length; i++) {
+    assert.equal(results[i] instanceof Error, i % 2 === 0);
+  }
+  done++;
+});
+
+process.on('exit', function() {
+  assert.equal(done, 4);
+});
@@ -114,6 +114,23 @@ fs.stat(__filename, function(err, s) {
   }
 });
 
+// The time fields become Date objects when first read, and stay the same
+// objects afterwards; assigned values are kept as they are.
+var lazy = fs.statSync(__filename);
+assert.ok(lazy.atime instanceof Date);
+assert.ok(lazy.ctime instanceof Date);
+assert.strictEqual(lazy.mtime, lazy.mtime);
+assert.equal(lazy.mtime.getTime() % 1000, 0);
+assert.deepEqual(Object.keys(lazy).filter(function(k) {
+  return /time$/.test(k);
+}).sort(), ['atime', 'ctime', 'mtime']);
+assert.equal(JSON.parse(JSON.stringify(lazy)).mtime,
+             lazy.mtime.toJSON());
+var unread = fs.statSync(__filename);
+unread.mtime = 42;
+assert.strictEqual(unread.mtime, 42);
+assert.ok(unread.atime instanceof Date);
+
 process.on('exit', function() {
   assert.equal(5, success_count);
   assert.equal(false, got_error);
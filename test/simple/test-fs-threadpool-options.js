@@ -0,0 +1,75 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// The thread pool options must not get in the way of fs requests, whatever
+// the priority, poll limit and pool size.
+
+var common = require('../common');
+var assert = require('assert');
+var spawn = require('child_process').spawn;
+
+if (process.argv[2] === 'child') {
+  var fs = require('fs');
+  var pending = 0;
+  for (var i = 0; i < 50; i++) {
+    pending++;
+    fs.stat(__filename, function(err, stats) {
+      assert.ifError(err);
+      assert.ok(stats.isFile());
+      if (--pending === 0) {
+        fs.readFile(__filename, function(err, data) {
+          assert.ifError(err);
+          console.log('ok ' + data.length);
+        });
+      }
+    });
+  }
+  return;
+}
+
+var runs = [
+  ['--fs-threads=1', '--fs-max-poll-reqs=1', '--fs-priority=-4'],
+  ['--fs-threads=8', '--fs-priority=4'],
+  ['--fs-priority=99', '--fs-max-poll-reqs=0'],
+  ['--fs-threads=4', '--fs-max-threads=1'],
+  ['--fs-max-threads=2', '--fs-priority=-4'],
+  ['--fs-max-threads=0']
+];
+var done = 0;
+
+runs.forEach(function(flags) {
+  var child = spawn(process.execPath, flags.concat([__filename, 'child']));
+  var out = '';
+  child.stdout.setEncoding('utf8');
+  child.stdout.on('data', function(d) {
+    out += d;
+  });
+  child.stderr.pipe(process.stderr);
+  child.on('exit', function(code) {
+    assert.equal(code, 0, flags.join(' '));
+    assert.ok(/^ok \d+/.test(out), flags.join(' '));
+    done++;
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(done, runs.length);
+});
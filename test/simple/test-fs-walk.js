@@ -0,0 +1,145 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+var root = path.join(common.tmpDir, 'walk');
+
+function remove(dir) {
+  fs.readdirSync(dir).forEach(function(name) {
+    var file = path.join(dir, name);
+    if (fs.lstatSync(file).isDirectory()) {
+      remove(file);
+    } else {
+      fs.unlinkSync(file);
+    }
+  });
+  fs.rmdirSync(dir);
+}
+
+if (path.existsSync(root)) remove(root);
+fs.mkdirSync(root);
+fs.mkdirSync(path.join(root, 'a'));
+fs.mkdirSync(path.join(root, 'a/b'));
+fs.mkdirSync(path.join(root, 'd'));
+fs.writeFileSync(path.join(root, 'top'), '');
+fs.writeFileSync(path.join(root, 'a/f1'), '');
+fs.writeFileSync(path.join(root, 'a/b/f2'), '');
+
+var expected = {
+  'a': 'directory',
+  'a/b': 'directory',
+  'a/b/f2': 'file',
+  'a/f1': 'file',
+  'd': 'directory',
+  'top': 'file'
+};
+
+if (process.platform !== 'win32') {
+  fs.symlinkSync('a', path.join(root, 'link'));
+  expected['link'] = 'symlink';
+}
+
+function toObject(paths, types) {
+  assert.equal(paths.length, types.length);
+  var result = {};
+  for (var i = 0; i < paths.length; i++) result[paths[i]] = types[i];
+  return result;
+}
+
+function topLevel(entries) {
+  var result = {};
+  for (var name in entries) {
+    if (name.indexOf('/') === -1) result[name] = entries[name];
+  }
+  return result;
+}
+
+function checkOrder(paths) {
+  // A directory comes before what's in it.
+  paths.forEach(function(p, i) {
+    var parent = path.dirname(p);
+    if (parent !== '.') assert.ok(paths.indexOf(parent) < i, p);
+  });
+}
+
+var found = fs.readdirTypesSync(root);
+assert.deepEqual(toObject(found.names, found.types), topLevel(expected));
+
+found = fs.walkSync(root);
+assert.deepEqual(toObject(found.paths, found.types), expected);
+checkOrder(found.paths);
+
+found = fs.walkSync(root, { maxDepth: 0 });
+assert.deepEqual(toObject(found.paths, found.types), topLevel(expected));
+
+found = fs.walkSync(root, { maxDepth: 1 });
+assert.ok(found.paths.indexOf('a/b') !== -1);
+assert.ok(found.paths.indexOf('a/b/f2') === -1);
+
+assert.throws(function() {
+  fs.walkSync(path.join(root, 'missing'));
+}, /ENOENT/);
+
+var listed = false;
+fs.readdirTypes(root, function(err, names, types) {
+  assert.ifError(err);
+  assert.deepEqual(toObject(names, types), topLevel(expected));
+  listed = true;
+});
+
+var batches = 0;
+var walked = { paths: [], types: [] };
+fs.walk(root, { batchSize: 2 }, function(err, paths, types, done) {
+  assert.ifError(err);
+  assert.ok(paths.length <= 2);
+  batches++;
+  walked.paths = walked.paths.concat(paths);
+  walked.types = walked.types.concat(types);
+  if (done) {
+    assert.deepEqual(toObject(walked.paths, walked.types), expected);
+    checkOrder(walked.paths);
+  }
+});
+
+var stopped = 0;
+fs.walk(root, { batchSize: 1 }, function(err, paths, types, done) {
+  assert.ifError(err);
+  stopped++;
+  return false;
+});
+
+var failed = false;
+fs.walk(path.join(root, 'missing'), function(err, paths, types, done) {
+  assert.equal(err.code, 'ENOENT');
+  assert.ok(done);
+  failed = true;
+});
+
+process.on('exit', function() {
+  assert.ok(listed);
+  assert.ok(failed);
+  assert.ok(batches >= 4);
+  assert.equal(stopped, 1);
+});
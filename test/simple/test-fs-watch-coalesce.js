@@ -0,0 +1,105 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var path = require('path');
+var fs = require('fs');
+
+// Recursive watches and the filename in events both need inotify.
+if (process.platform != 'linux') {
+  console.error('Skipping: recursive watches are only supported on Linux');
+  process.exit(0);
+}
+
+var root = path.join(common.tmpDir, 'watch-coalesce');
+var windows = 0;
+var changesSeen = 0;
+var nestedSeen = 0;
+
+function rmTree(p) {
+  if (!path.existsSync(p)) return;
+  if (fs.lstatSync(p).isDirectory()) {
+    fs.readdirSync(p).forEach(function(name) {
+      rmTree(path.join(p, name));
+    });
+    fs.rmdirSync(p);
+  } else {
+    fs.unlinkSync(p);
+  }
+}
+
+rmTree(root);
+fs.mkdirSync(root);
+fs.mkdirSync(path.join(root, 'sub'));
+
+assert.throws(function() {
+  fs.watch(root, { delay: -1 }, function() {});
+}, TypeError);
+
+
+// A burst of writes to one file comes out as one window with each
+// (event, filename) pair once.
+var watcher = fs.watch(root, { delay: 100 }, function(event, filename) {
+  assert.equal(filename, 'burst.txt');
+  changesSeen++;
+});
+
+watcher.on('changes', function(changes) {
+  windows++;
+  var seen = {};
+  changes.forEach(function(change) {
+    var key = change.event + ' ' + change.filename;
+    assert.ok(!seen[key], 'duplicate ' + key);
+    seen[key] = true;
+  });
+  assert.ok(seen['change burst.txt']);
+  watcher.close();
+  testRecursive();
+});
+
+var fd = fs.openSync(path.join(root, 'burst.txt'), 'w');
+for (var i = 0; i < 50; i++) fs.writeSync(fd, new Buffer('x'), 0, 1, null);
+fs.closeSync(fd);
+
+
+// Files in subdirectories are reported relative to the watched directory,
+// also in directories created after the watch started.
+function testRecursive() {
+  var nested = fs.watch(root, { recursive: true }, function(event, filename) {
+    if (filename == 'sub/new') {
+      fs.writeFileSync(path.join(root, 'sub', 'new', 'deep.txt'), 'x');
+    } else if (filename == 'sub/new/deep.txt') {
+      nestedSeen++;
+      nested.close();
+    }
+  });
+
+  fs.mkdirSync(path.join(root, 'sub', 'new'));
+}
+
+
+process.on('exit', function() {
+  assert.equal(windows, 1);
+  assert.ok(changesSeen >= 1);
+  assert.equal(nestedSeen, 1);
+  rmTree(root);
+});
@@ -0,0 +1,65 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Files that don't exist yet can't be watched with inotify, so these
+// watchers poll, all of them with one timer.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+var files = [1, 2, 3].map(function(i) {
+  var file = path.join(common.tmpDir, 'watch-file-poll-' + i);
+  try { fs.unlinkSync(file); } catch (e) {}
+  return file;
+});
+
+var changes = 0;
+
+files.forEach(function(file) {
+  fs.watchFile(file, { interval: 100 }, function(curr, prev) {
+    assert.equal(prev.nlink, 0);
+    assert.equal(curr.nlink, 1);
+    assert.equal(curr.size, 5);
+    fs.unwatchFile(file);
+    changes++;
+  });
+});
+
+// Not persistent, so it doesn't keep the process alive once the others are
+// gone.
+fs.watchFile(path.join(common.tmpDir, 'watch-file-poll-never'),
+             { interval: 100, persistent: false },
+             function() {});
+
+setTimeout(function() {
+  files.forEach(function(file) {
+    fs.writeFileSync(file, 'hello');
+  });
+}, 50);
+
+process.on('exit', function() {
+  assert.equal(changes, files.length);
+  files.forEach(function(file) {
+    fs.unlinkSync(file);
+  });
+});
@@ -0,0 +1,83 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+var file = path.join(common.tmpDir, 'writev.txt');
+var fd = fs.openSync(file, 'w+');
+
+var records = [];
+for (var i = 0; i < 2000; i++) {
+  records.push(new Buffer('record ' + i + '\n'));
+}
+records.push(new Buffer(0));
+var expected = records.join('');
+
+assert.equal(fs.writevSync(fd, records, null), Buffer.byteLength(expected));
+assert.equal(fs.readFileSync(file, 'utf8'), expected);
+
+// Positional writes leave the file position alone.
+assert.equal(fs.writevSync(fd, [new Buffer('RE'), new Buffer('C')], 0), 3);
+assert.equal(fs.writevSync(fd, [new Buffer('end\n')], null), 4);
+expected = 'REC' + expected.slice(3) + 'end\n';
+assert.equal(fs.readFileSync(file, 'utf8'), expected);
+
+var head = new Buffer(4);
+var rest = new Buffer(expected.length);
+assert.equal(fs.readvSync(fd, [head, rest], 0), expected.length);
+assert.equal(head.toString(), 'RECo');
+assert.equal(rest.toString('utf8', 0, expected.length - 4), expected.slice(4));
+
+assert.throws(function() {
+  fs.writevSync(fd, ['not a buffer'], null);
+});
+
+var wrote = false;
+var read = false;
+
+fs.writev(fd, [new Buffer('ab'), new Buffer('cd')], 0, function(err, written) {
+  assert.ifError(err);
+  assert.equal(written, 4);
+  wrote = true;
+
+  var a = new Buffer(3);
+  var b = new Buffer(3);
+  fs.readv(fd, [a, b], 1, function(err, bytesRead) {
+    assert.ifError(err);
+    assert.equal(bytesRead, 6);
+    assert.equal(a.toString() + b.toString(), ('abcd' + expected.slice(4))
+                                               .slice(1, 7));
+    read = true;
+
+    fs.writev(-1, [a], null, function(err) {
+      assert.equal(err.code, 'EBADF');
+      fs.closeSync(fd);
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.ok(wrote);
+  assert.ok(read);
+});
@@ -0,0 +1,68 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// The idle GC options must be accepted and must not keep a process from
+// running its timers or exiting.
+
+var common = require('../common');
+var assert = require('assert');
+var spawn = require('child_process').spawn;
+
+if (process.argv[2] === 'child') {
+  var garbage = [];
+  var ticks = 0;
+  var timer = setInterval(function() {
+    for (var i = 0; i < 1000; i++) garbage.push({ i: i });
+    garbage = [];
+    if (++ticks === 10) {
+      clearInterval(timer);
+      console.log('ok ' + ticks);
+    }
+  }, 30);
+  return;
+}
+
+var runs = [
+  ['--gc-fast-tick=10', '--gc-wait-time=50'],
+  ['--gc-fast-tick=1', '--gc-wait-time=1000000'],
+  ['--gc-fast-tick=0', '--gc-wait-time=-1']
+];
+var done = 0;
+
+runs.forEach(function(flags) {
+  var child = spawn(process.execPath, flags.concat([__filename, 'child']));
+  var out = '';
+  child.stdout.setEncoding('utf8');
+  child.stdout.on('data', function(d) {
+    out += d;
+  });
+  child.stderr.pipe(process.stderr);
+  child.on('exit', function(code) {
+    assert.equal(code, 0, flags.join(' '));
+    assert.equal(out, 'ok 10\n', flags.join(' '));
+    done++;
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(done, runs.length);
+});
@@ -0,0 +1,52 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+var dgram = require('dgram');
+
+var start = Date.now();
+var fired = false;
+var refFired = false;
+
+// None of these may keep the process alive.
+setInterval(assert.fail, 10000).unref();
+setTimeout(assert.fail, 10000).unref();
+net.createServer(assert.fail).listen(common.PORT).unref();
+var udp = dgram.createSocket('udp4');
+udp.bind(common.PORT);
+udp.unref();
+
+// An unref'd timeout still fires while something else keeps the loop alive.
+setTimeout(function() { fired = true; }, 50).unref();
+setTimeout(function() {}, 100);
+
+// ref() undoes unref().
+var t = setTimeout(function() { refFired = true; }, 200);
+t.unref();
+t.ref();
+
+process.on('exit', function() {
+  assert.ok(fired);
+  assert.ok(refFired);
+  assert.ok(Date.now() - start < 5000);
+});
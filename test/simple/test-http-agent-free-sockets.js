@@ -0,0 +1,84 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// agent.maxFreeSockets keeps idle keep-alive sockets for later requests,
+// closes the least recently used past the cap and the idle ones on timeout.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+
+var connections = 0;
+var server = http.createServer(function(req, res) {
+  res.writeHead(200, { 'Content-Length': 2, 'Connection': 'keep-alive' });
+  res.end('ok');
+});
+server.on('connection', function() {
+  connections++;
+});
+
+var agent = new http.Agent({ maxFreeSockets: 1, freeSocketTimeout: 200 });
+var name = 'localhost:' + common.PORT;
+
+function get(cb) {
+  http.get({ port: common.PORT, path: '/', agent: agent }, function(res) {
+    res.on('data', function() {});
+    res.on('end', function() {
+      // 'free' is emitted after the response's own 'end' listeners.
+      process.nextTick(cb);
+    });
+  });
+}
+
+server.listen(common.PORT, function() {
+  get(function() {
+    assert.equal(agent.freeSockets[name].length, 1);
+    var idle = agent.freeSockets[name][0];
+
+    // Sequential requests reuse the idle socket.
+    get(function() {
+      assert.equal(connections, 1);
+      assert.strictEqual(agent.freeSockets[name][0], idle);
+
+      // Two at once: one reuses the idle socket, one connects. Only one of
+      // them is kept afterwards.
+      var left = 2;
+      function done() {
+        if (--left) return;
+        assert.equal(connections, 2);
+        assert.equal(agent.freeSockets[name].length, 1);
+
+        // Idle sockets close after freeSocketTimeout.
+        setTimeout(function() {
+          assert.equal(agent.freeSockets[name], undefined);
+          assert.equal(agent.sockets[name].length, 0);
+          server.close();
+        }, 600);
+      }
+      get(done);
+      get(done);
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(connections, 2);
+});
@@ -0,0 +1,69 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// An agent with pipelining sends requests to a host on a busy socket, and
+// sends them again elsewhere when the server closes it early.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+
+var connections = 0;
+
+var server = http.createServer(function(req, res) {
+  if (req.url === '/close') res.setHeader('Connection', 'close');
+  res.end(req.url);
+});
+server.on('connection', function() {
+  connections++;
+});
+
+var agent = new http.Agent({ maxSockets: 1, pipelining: 4 });
+
+function get(paths, cb) {
+  var bodies = [];
+  paths.forEach(function(path, i) {
+    http.get({ port: common.PORT, path: path, agent: agent }, function(res) {
+      var body = '';
+      res.setEncoding('utf8');
+      res.on('data', function(d) { body += d; });
+      res.on('end', function() {
+        bodies[i] = body;
+        if (bodies.filter(String).length == paths.length) cb(bodies);
+      });
+    });
+  });
+}
+
+server.listen(common.PORT, function() {
+  get(['/a', '/b', '/c', '/d', '/e'], function(bodies) {
+    assert.deepEqual(bodies, ['/a', '/b', '/c', '/d', '/e']);
+    assert.equal(connections, 1);
+
+    // Requests behind /close are sent again on a new connection.
+    connections = 0;
+    get(['/1', '/close', '/2', '/3'], function(bodies) {
+      assert.deepEqual(bodies, ['/1', '/close', '/2', '/3']);
+      assert.equal(connections, 2);
+      server.close();
+    });
+  });
+});
@@ -0,0 +1,75 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Buffers written to a chunked response, in the same tick as the header and
+// later on their own, must come out framed correctly and in order.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var net = require('net');
+
+var big = new Buffer(70000);
+big.fill(0x61);
+
+var server = http.createServer(function(req, res) {
+  res.writeHead(200, { 'Content-Type': 'text/plain' });
+  res.write(new Buffer('first'));
+  setTimeout(function() {
+    res.write(new Buffer('second'));
+    res.write('third');
+    res.write(new Buffer('fourth'));
+    setTimeout(function() {
+      res.write(big);
+      res.end(new Buffer('last'));
+    }, 10);
+  }, 10);
+});
+
+var received = '';
+
+server.listen(common.PORT, function() {
+  var c = net.createConnection(common.PORT);
+  c.setEncoding('ascii');
+  c.on('connect', function() {
+    c.write('GET / HTTP/1.1\r\nConnection: close\r\n\r\n');
+  });
+  c.on('data', function(d) {
+    received += d;
+  });
+  c.on('end', function() {
+    c.end();
+    server.close();
+  });
+});
+
+process.on('exit', function() {
+  var body = received.slice(received.indexOf('\r\n\r\n') + 4);
+  assert.ok(/Transfer-Encoding: chunked/.test(received));
+  assert.equal(body,
+               '5\r\nfirst\r\n' +
+               '6\r\nsecond\r\n' +
+               '5\r\nthird\r\n' +
+               '6\r\nfourth\r\n' +
+               '11170\r\n' + big.toString('ascii') + '\r\n' +
+               '4\r\nlast\r\n' +
+               '0\r\n\r\n');
+});
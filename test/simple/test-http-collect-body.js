@@ -0,0 +1,90 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// server.collectBodySize: small bodies arrive as one 'data' event, larger
+// ones still arrive complete.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var net = require('net');
+
+var bodies = [];
+
+var server = http.createServer(function(req, res) {
+  var chunks = [];
+  req.on('data', function(chunk) {
+    assert.ok(Buffer.isBuffer(chunk));
+    chunks.push(chunk.toString());
+  });
+  req.on('end', function() {
+    bodies.push({ url: req.url, chunks: chunks, trailer: req.trailers.x });
+    res.writeHead(200, { 'Content-Length': 2 });
+    res.end('ok');
+  });
+});
+server.collectBodySize = 1000;
+
+function chunked(parts) {
+  return parts.map(function(p) {
+    return p.length.toString(16) + '\r\n' + p + '\r\n';
+  }).join('') + '0\r\nX: trailer\r\n\r\n';
+}
+
+var small = ['hello ', 'chunked ', 'world'];
+var large = [];
+for (var i = 0; i < 20; i++) large.push(new Array(101).join(String(i % 10)));
+
+server.listen(common.PORT, function() {
+  var c = net.createConnection(common.PORT);
+  c.on('connect', function() {
+    c.write('POST /small HTTP/1.1\r\n' +
+            'Transfer-Encoding: chunked\r\n\r\n' +
+            chunked(small) +
+            'POST /large HTTP/1.1\r\n' +
+            'Transfer-Encoding: chunked\r\n\r\n' +
+            chunked(large) +
+            'POST /length HTTP/1.1\r\n' +
+            'Content-Length: 3\r\n' +
+            'Connection: close\r\n\r\n' +
+            'abc');
+  });
+  c.on('end', function() {
+    c.end();
+    server.close();
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(bodies.length, 3);
+
+  assert.equal(bodies[0].url, '/small');
+  assert.deepEqual(bodies[0].chunks, ['hello chunked world']);
+  assert.equal(bodies[0].trailer, 'trailer');
+
+  assert.equal(bodies[1].url, '/large');
+  assert.equal(bodies[1].chunks.join(''), large.join(''));
+  assert.ok(bodies[1].chunks.length > 1);
+  assert.equal(bodies[1].chunks[0].length, 1000);
+  assert.equal(bodies[1].trailer, 'trailer');
+
+  assert.deepEqual(bodies[2].chunks, ['abc']);
+});
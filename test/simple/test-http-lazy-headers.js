@@ -0,0 +1,101 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// server.lazyHeaders: request.headers creates its strings on access but
+// otherwise behaves like the object built by IncomingMessage.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+
+var requests = 0;
+
+var srv = http.createServer(function(req, res) {
+  var h = req.headers;
+  requests++;
+
+  assert.equal(h.accept, 'abc, def, ghijklmnopqrst');
+  assert.equal(h.host, 'foo');
+  assert.equal(h['x-bar'], 'banjo, bango');
+  assert.deepEqual(h['set-cookie'], ['a=1', 'b=2']);
+  assert.strictEqual(h['set-cookie'], h['set-cookie']);
+  assert.equal(h.Host, undefined);
+  assert.equal(h.missing, undefined);
+  assert.ok('x-foo' in h);
+  assert.ok(h.hasOwnProperty('x-foo'));
+  assert.ok(!('X-Foo' in h));
+
+  var keys = Object.keys(h).sort();
+  assert.deepEqual(keys, ['accept', 'connection', 'host', 'set-cookie',
+                          'x-bar', 'x-foo']);
+
+  h['set-cookie'].push('c=3');
+  assert.equal(h['set-cookie'].length, 3);
+
+  h['x-foo'] = 'changed';
+  assert.equal(h['x-foo'], 'changed');
+  assert.ok(delete h.host);
+  assert.equal(h.host, undefined);
+  assert.ok(!('host' in h));
+  h.added = 'yes';
+
+  var copy = JSON.parse(JSON.stringify(h));
+  assert.deepEqual(copy, {
+    accept: 'abc, def, ghijklmnopqrst',
+    connection: 'close',
+    'set-cookie': ['a=1', 'b=2', 'c=3'],
+    'x-bar': 'banjo, bango',
+    'x-foo': 'changed',
+    added: 'yes'
+  });
+
+  res.writeHead(200, {'Content-Type' : 'text/plain'});
+  res.end('EOF');
+
+  srv.close();
+});
+srv.lazyHeaders = true;
+
+srv.listen(common.PORT, function() {
+  http.get({
+    host: 'localhost',
+    port: common.PORT,
+    path: '/',
+    agent: false,
+    headers: [
+      ['accept', 'abc'],
+      ['accept', 'def'],
+      ['Accept', 'ghijklmnopqrst'],
+      ['host', 'foo'],
+      ['Host', 'bar'],
+      ['Set-Cookie', 'a=1'],
+      ['set-cookie', 'b=2'],
+      ['x-foo', 'bingo'],
+      ['x-bar', 'banjo'],
+      ['X-Bar', 'bango'],
+      ['connection', 'close']
+    ]
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(requests, 1);
+});
@@ -0,0 +1,84 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Headers that arrive in many pieces are assembled correctly, and
+// server.maxHeaderSize turns away requests with too many header bytes.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var net = require('net');
+
+var cookie = new Array(601).join('c');
+var requests = 0;
+var clientErrors = 0;
+
+var server = http.createServer(function(req, res) {
+  requests++;
+  assert.equal(req.url, '/split/url');
+  assert.equal(req.headers['x-cookie'], cookie);
+  res.end('ok');
+});
+server.maxHeaderSize = 1024;
+
+server.on('clientError', function(e) {
+  assert.equal(e.code, 'HPE_HEADER_OVERFLOW');
+  clientErrors++;
+});
+
+// Writes `pieces` one at a time, each after the previous one was sent.
+function send(pieces, cb) {
+  var socket = net.createConnection(common.PORT);
+  var response = '';
+  socket.setEncoding('utf8');
+  socket.on('data', function(d) { response += d; });
+  socket.on('close', function() { cb(response); });
+  socket.on('connect', function next() {
+    if (pieces.length === 0) return;
+    socket.write(pieces.shift());
+    setTimeout(next, 5);
+  });
+}
+
+server.listen(common.PORT, function() {
+  var pieces = ['GET /spl', 'it/url HTTP/1.1\r\nX-Coo', 'kie: '];
+  for (var i = 0; i < cookie.length; i += 50) {
+    pieces.push(cookie.slice(i, i + 50));
+  }
+  pieces.push('\r\nConnection: close\r\n\r\n');
+
+  send(pieces, function(response) {
+    assert.ok(/^HTTP\/1.1 200/.test(response));
+
+    var big = 'GET / HTTP/1.1\r\nX-Big: ' + new Array(2001).join('b') +
+              '\r\n\r\n';
+    send([big.slice(0, 700), big.slice(700)], function(response) {
+      assert.equal(response, '');
+      server.close();
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(requests, 1);
+  assert.equal(clientErrors, 1);
+});
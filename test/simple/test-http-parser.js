@@ -555,3 +555,112 @@ function expectBody(expected) {
   parser.onHeadersComplete = onHeadersComplete2;
   parser.execute(req2, 0, req2.length);
 })();
+
+
+//
+// Test lowercased header names, both well-known and unknown ones.
+//
+(function() {
+  var long = new Array(300).join('X');
+  var request = Buffer(
+    'GET / HTTP/1.1' + CRLF +
+    'Content-Type: text/plain' + CRLF +
+    'HOST: example.com' + CRLF +
+    'X-Custom-Thing: 1' + CRLF +
+    'Te: trailers' + CRLF +
+    'Hots: not a known name' + CRLF +
+    long + ': long' + CRLF +
+    CRLF
+  );
+
+  var parser = newParser(REQUEST);
+  parser.setLowerCaseHeaders(true);
+
+  parser.onHeadersComplete = mustCall(function(info) {
+    assert.deepEqual(info.headers || parser.headers,
+      ['content-type', 'text/plain',
+       'host', 'example.com',
+       'x-custom-thing', '1',
+       'te', 'trailers',
+       'hots', 'not a known name',
+       long.toLowerCase(), 'long']);
+  });
+
+  parser.execute(request, 0, request.length);
+
+  // The mode is kept across reinitialize().
+  parser.reinitialize(REQUEST);
+  parser.onHeadersComplete = mustCall(function(info) {
+    assert.deepEqual(info.headers || parser.headers,
+      ['content-type', 'text/plain', 'host', 'example.com',
+       'x-custom-thing', '1', 'te', 'trailers', 'hots', 'not a known name',
+       long.toLowerCase(), 'long']);
+  });
+  parser.execute(request, 0, request.length);
+})();
+
+
+//
+// Test batch mode with pipelined requests.
+//
+(function() {
+  var req1 = 'POST /one HTTP/1.1' + CRLF +
+             'Content-Length: 4' + CRLF +
+             CRLF +
+             'ping';
+  var req2 = 'GET /two HTTP/1.1' + CRLF +
+             'Host: example.com' + CRLF +
+             CRLF;
+  var request = Buffer(req1 + req2);
+
+  var parser = newParser(REQUEST);
+  parser.setBatchMode(true);
+
+  parser.onHeadersComplete = function() {
+    assert.ok(false, 'Function should not be called.');
+  };
+  parser.onMessageComplete = parser.onHeadersComplete;
+
+  parser.onBatch = mustCall(function(events, b) {
+    assert.strictEqual(b, request);
+    assert.equal(events.length, 5 * 3);
+
+    assert.equal(events[0], HTTPParser.BATCH_HEADERS_COMPLETE);
+    assert.equal(events[1].method, 'POST');
+    assert.equal(events[1].url, '/one');
+    assert.deepEqual(events[1].headers, ['Content-Length', '4']);
+
+    assert.equal(events[3], HTTPParser.BATCH_BODY);
+    assert.equal(b.slice(events[4], events[4] + events[5]).toString(),
+                 'ping');
+
+    assert.equal(events[6], HTTPParser.BATCH_MESSAGE_COMPLETE);
+
+    assert.equal(events[9], HTTPParser.BATCH_HEADERS_COMPLETE);
+    assert.equal(events[10].method, 'GET');
+    assert.equal(events[10].url, '/two');
+
+    assert.equal(events[12], HTTPParser.BATCH_MESSAGE_COMPLETE);
+  });
+
+  assert.equal(parser.execute(request, 0, request.length), request.length);
+
+  // reinitialize() turns batch mode off again.
+  parser.reinitialize(REQUEST);
+  parser.onHeadersComplete = mustCall(function(info) {}, 2);
+  parser.onMessageComplete = mustCall(function() {}, 2);
+  parser.onBody = mustCall(function(b, start, len) {});
+  parser.execute(request, 0, request.length);
+
+  // Response parsers never batch.
+  var response = Buffer('HTTP/1.1 204 No Content' + CRLF + CRLF);
+  parser = newParser(RESPONSE);
+  parser.setBatchMode(true);
+  parser.onBatch = function() {
+    assert.ok(false, 'Function should not be called.');
+  };
+  parser.onHeadersComplete = mustCall(function(info) {
+    assert.equal(info.statusCode, 204);
+  });
+  parser.execute(response, 0, response.length);
+})();
@@ -0,0 +1,113 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Responses marked with response.cache() answer later identical requests
+// without the request listener.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var net = require('net');
+
+var handled = 0;
+
+var server = http.createServer(function(req, res) {
+  handled++;
+  res.cache(60 * 1000);
+  if (req.url === '/vary') res.setHeader('Vary', 'X-Lang');
+  res.end('response ' + handled + ' for ' + (req.headers['x-lang'] || '-'));
+});
+server.setResponseCache(10);
+
+// Sends the requests one after another on one connection, and calls back
+// with the bodies.
+function fetch(requests, cb) {
+  var socket = net.connect(common.PORT);
+  var bodies = [];
+  var data = '';
+
+  function next() {
+    var r = requests[bodies.length];
+    socket.write('GET ' + r.url + ' HTTP/1.1\r\n' +
+                 'Host: ' + (r.host || 'localhost') + '\r\n' +
+                 (r.lang ? 'X-Lang: ' + r.lang + '\r\n' : '') +
+                 '\r\n');
+  }
+
+  socket.setEncoding('utf8');
+  socket.on('connect', next);
+  socket.on('data', function(d) {
+    data += d;
+    var end = data.indexOf('\r\n\r\n');
+    if (end == -1) return;
+    var length = +/Content-Length: (\d+)/i.exec(data)[1];
+    if (data.length < end + 4 + length) return;
+    bodies.push(data.slice(end + 4, end + 4 + length));
+    data = data.slice(end + 4 + length);
+    if (bodies.length < requests.length) {
+      next();
+    } else {
+      socket.end();
+      cb(bodies);
+    }
+  });
+}
+
+server.listen(common.PORT, function() {
+  fetch([{ url: '/' }, { url: '/' }, { url: '/?q' }, { url: '/' }],
+        function(bodies) {
+    assert.deepEqual(bodies, ['response 1 for -',
+                              'response 1 for -',
+                              'response 2 for -',
+                              'response 1 for -']);
+    assert.equal(handled, 2);
+
+    fetch([{ url: '/vary', lang: 'en' },
+           { url: '/vary', lang: 'de' },
+           { url: '/vary', lang: 'en' },
+           { url: '/vary', lang: 'de' }], function(bodies) {
+      assert.deepEqual(bodies, ['response 3 for en',
+                                'response 4 for de',
+                                'response 3 for en',
+                                'response 4 for de']);
+      assert.equal(handled, 4);
+
+      var stats = server.getResponseCacheStats();
+      assert.equal(stats.size, 4);
+      assert.equal(stats.hits, 4);
+
+      server.clearResponseCache();
+      assert.equal(server.getResponseCacheStats().size, 0);
+
+      // Another Host is another site.
+      fetch([{ url: '/' },
+             { url: '/', host: 'example.com' },
+             { url: '/', host: 'example.com' },
+             { url: '/' }], function(bodies) {
+        assert.deepEqual(bodies, ['response 5 for -',
+                                  'response 6 for -',
+                                  'response 6 for -',
+                                  'response 5 for -']);
+        server.close();
+      });
+    });
+  });
+});
@@ -0,0 +1,178 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// response.compress() gzips or deflates the body according to the
+// request's Accept-Encoding.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var zlib = require('zlib');
+
+var big = new Array(1000).join('compress me please ');
+var streamed = ['first part ', 'second part ', 'third part'];
+
+var server = http.createServer(function(req, res) {
+  res.compress();
+  switch (req.url) {
+    case '/big':
+      res.writeHead(200, { 'Content-Type': 'text/plain' });
+      res.end(big);
+      break;
+
+    case '/small':
+      res.end('tiny');
+      break;
+
+    case '/length':
+      res.setHeader('Content-Length', 2);
+      res.end('ok');
+      break;
+
+    case '/encoded':
+      res.writeHead(200, { 'Content-Encoding': 'identity' });
+      res.end(big);
+      break;
+
+    case '/stream':
+      // Each part should reach the client before the next one is written.
+      res.writeHead(200);
+      var i = 0;
+      (function next() {
+        res.write(streamed[i++]);
+        if (i === streamed.length) return res.end();
+        res.once('partReceived', next);
+      })();
+      streamResponse = res;
+      break;
+  }
+});
+
+var streamResponse;
+
+function get(path, acceptEncoding, cb) {
+  var headers = {};
+  if (acceptEncoding) headers['Accept-Encoding'] = acceptEncoding;
+  http.get({ port: common.PORT, path: path, headers: headers }, function(res) {
+    var chunks = [];
+    res.on('data', function(chunk) {
+      chunks.push(chunk);
+      if (res.onChunk) res.onChunk(chunk);
+    });
+    res.on('end', function() {
+      var body = new Buffer(chunks.reduce(function(n, c) {
+        return n + c.length;
+      }, 0));
+      var off = 0;
+      chunks.forEach(function(c) { c.copy(body, off); off += c.length; });
+      cb(res, body);
+    });
+    if (path === '/stream') {
+      var gunzip = zlib.createGunzip();
+      var seen = '';
+      gunzip.on('data', function(d) {
+        seen += d;
+        streamResponse.emit('partReceived');
+      });
+      res.onChunk = function(chunk) { gunzip.write(chunk); };
+    }
+  });
+}
+
+var tests = [
+  function() {
+    get('/big', 'gzip, deflate', function(res, body) {
+      assert.equal(res.headers['content-encoding'], 'gzip');
+      assert.equal(res.headers['vary'], 'Accept-Encoding');
+      assert.equal(res.headers['content-length'], undefined);
+      assert.ok(body.length < big.length / 10);
+      assert.equal(zlib.gunzipSync(body).toString(), big);
+      next();
+    });
+  },
+  function() {
+    get('/big', 'gzip;q=0.5, deflate', function(res, body) {
+      assert.equal(res.headers['content-encoding'], 'deflate');
+      assert.equal(zlib.inflateSync(body).toString(), big);
+      next();
+    });
+  },
+  function() {
+    get('/big', 'gzip;q=0', function(res, body) {
+      assert.equal(res.headers['content-encoding'], undefined);
+      assert.equal(res.headers['vary'], 'Accept-Encoding');
+      assert.equal(body.toString(), big);
+      next();
+    });
+  },
+  function() {
+    get('/big', null, function(res, body) {
+      assert.equal(res.headers['content-encoding'], undefined);
+      assert.equal(body.toString(), big);
+      next();
+    });
+  },
+  function() {
+    get('/small', 'gzip', function(res, body) {
+      assert.equal(res.headers['content-encoding'], undefined);
+      assert.equal(body.toString(), 'tiny');
+      next();
+    });
+  },
+  function() {
+    get('/length', 'gzip', function(res, body) {
+      assert.equal(res.headers['content-encoding'], undefined);
+      assert.equal(res.headers['content-length'], '2');
+      assert.equal(body.toString(), 'ok');
+      next();
+    });
+  },
+  function() {
+    get('/encoded', 'gzip', function(res, body) {
+      assert.equal(res.headers['content-encoding'], 'identity');
+      assert.equal(body.toString(), big);
+      next();
+    });
+  },
+  function() {
+    get('/stream', 'gzip', function(res, body) {
+      assert.equal(res.headers['content-encoding'], 'gzip');
+      assert.equal(zlib.gunzipSync(body).toString(), streamed.join(''));
+      next();
+    });
+  }
+];
+
+var done = 0;
+function next() {
+  var test = tests.shift();
+  if (!test) return server.close();
+  done++;
+  test();
+}
+
+server.listen(common.PORT, next);
+
+process.on('exit', function() {
+  assert.equal(done, 8);
+  assert.equal(tests.length, 0);
+});
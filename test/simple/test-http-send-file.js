@@ -0,0 +1,129 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var fs = require('fs');
+var path = require('path');
+
+var file = path.join(common.tmpDir, 'send-file.txt');
+var large = path.join(common.tmpDir, 'send-file-large.bin');
+
+fs.writeFileSync(file, 'hello world\n');
+
+var data = new Buffer(4 * 1024 * 1024);
+for (var i = 0; i < data.length; i++) data[i] = i % 253;
+fs.writeFileSync(large, data);
+
+var server = http.createServer(function(req, res) {
+  res.setHeader('Content-Type', 'text/plain');
+  var name = req.url === '/large' ? large :
+             req.url === '/missing' ? file + '.missing' : file;
+  res.sendFile(name, function(err) {
+    if (err) {
+      assert.equal(err.code, 'ENOENT');
+      res.writeHead(404);
+      res.end();
+    }
+  });
+});
+
+
+function get(options, callback) {
+  options.port = common.PORT;
+  http.get(options, function(res) {
+    var chunks = [];
+    res.on('data', function(chunk) { chunks.push(chunk); });
+    res.on('end', function() {
+      var length = 0;
+      chunks.forEach(function(chunk) { length += chunk.length; });
+      var body = new Buffer(length);
+      var offset = 0;
+      chunks.forEach(function(chunk) {
+        chunk.copy(body, offset);
+        offset += chunk.length;
+      });
+      callback(res, body);
+    });
+  });
+}
+
+
+var checks = 0;
+
+server.listen(common.PORT, function() {
+  get({ path: '/' }, function(res, body) {
+    assert.equal(res.statusCode, 200);
+    assert.equal(res.headers['content-type'], 'text/plain');
+    assert.equal(res.headers['content-length'], '12');
+    assert.equal(body.toString(), 'hello world\n');
+    var etag = res.headers['etag'];
+    assert.ok(etag);
+    assert.ok(res.headers['last-modified']);
+    checks++;
+
+    get({ path: '/', headers: { 'If-None-Match': etag } }, function(res, body) {
+      assert.equal(res.statusCode, 304);
+      assert.equal(body.length, 0);
+      checks++;
+
+      // A change drops the file from the cache.
+      fs.writeFileSync(file, 'hello again, world\n');
+      setTimeout(function() {
+        get({ path: '/' }, function(res, body) {
+          assert.equal(res.statusCode, 200);
+          assert.equal(body.toString(), 'hello again, world\n');
+          assert.notEqual(res.headers['etag'], etag);
+          checks++;
+
+          get({ path: '/', method: 'HEAD' }, function(res, body) {
+            assert.equal(res.headers['content-length'], '19');
+            assert.equal(body.length, 0);
+            checks++;
+
+            get({ path: '/large' }, function(res, body) {
+              assert.equal(body.length, data.length);
+              assert.ok(body.toString('hex', 0, 1024) ===
+                        data.toString('hex', 0, 1024));
+              assert.ok(body.toString('hex', body.length - 1024) ===
+                        data.toString('hex', data.length - 1024));
+              checks++;
+
+              get({ path: '/missing' }, function(res, body) {
+                assert.equal(res.statusCode, 404);
+                checks++;
+                server.close();
+              });
+            });
+          });
+        });
+      }, 200);
+    });
+  });
+});
+
+
+process.on('exit', function() {
+  assert.equal(checks, 6);
+  fs.unlinkSync(file);
+  fs.unlinkSync(large);
+});
@@ -0,0 +1,142 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var net = require('net');
+
+var binding = process.binding('http_parser');
+var result = [0];
+
+function serialize(firstLine, headers, flags) {
+  return binding.serializeHeaders(firstLine, headers, flags, result);
+}
+
+var KEEP_ALIVE = binding.HEADER_KEEP_ALIVE;
+var CHUNKED_BY_DEFAULT = binding.HEADER_CHUNKED_BY_DEFAULT;
+var HAS_BODY = binding.HEADER_HAS_BODY;
+
+// Object headers, array values, and the default framing fields.
+assert.equal(serialize('HTTP/1.1 200 OK\r\n',
+                       { 'Content-Type': 'text/plain',
+                         'Set-Cookie': ['a=1', 'b=2'],
+                         'X-Number': 42 },
+                       KEEP_ALIVE | CHUNKED_BY_DEFAULT | HAS_BODY),
+             'HTTP/1.1 200 OK\r\n' +
+             'Content-Type: text/plain\r\n' +
+             'Set-Cookie: a=1\r\n' +
+             'Set-Cookie: b=2\r\n' +
+             'X-Number: 42\r\n' +
+             'Connection: keep-alive\r\n' +
+             'Transfer-Encoding: chunked\r\n\r\n');
+assert.equal(result[0], binding.HEADER_CHUNKED);
+
+// Array of pairs, an explicit Connection: close and Content-Length.
+assert.equal(serialize('GET / HTTP/1.1\r\n',
+                       [['Host', 'example.com'],
+                        ['connection', 'Close'],
+                        ['content-length', '0']],
+                       KEEP_ALIVE | HAS_BODY),
+             'GET / HTTP/1.1\r\nHost: example.com\r\n' +
+             'connection: Close\r\ncontent-length: 0\r\n\r\n');
+assert.equal(result[0], binding.HEADER_LAST);
+
+// No body, nothing to frame it with: the connection is closed.
+assert.equal(serialize('HTTP/1.1 304 Not Modified\r\n', null, 0),
+             'HTTP/1.1 304 Not Modified\r\nConnection: close\r\n\r\n');
+assert.equal(result[0], binding.HEADER_LAST | binding.HEADER_NOT_CHUNKED);
+
+// Expect and a Transfer-Encoding set by the caller.
+serialize('PUT / HTTP/1.1\r\n',
+          { 'Expect': '100-continue', 'Transfer-Encoding': 'Chunked',
+            'Connection': 'keep-alive' },
+          HAS_BODY);
+assert.equal(result[0], binding.HEADER_EXPECT | binding.HEADER_CHUNKED |
+                        binding.HEADER_SET_KEEP_ALIVE);
+
+// Characters outside ASCII are kept as they are.
+assert.equal(serialize('HTTP/1.1 200 OK\r\n', { 'X-Name': 'caf\u00e9' },
+                       KEEP_ALIVE | CHUNKED_BY_DEFAULT),
+             'HTTP/1.1 200 OK\r\nX-Name: caf\u00e9\r\n' +
+             'Connection: keep-alive\r\n\r\n');
+
+// A group of headers large enough to grow the scratch buffer.
+var big = {};
+for (var i = 0; i < 200; i++) big['X-Header-' + i] = new Array(50).join('v');
+var block = serialize('HTTP/1.1 200 OK\r\n', big, 0);
+assert.equal(block.split('\r\n').length, 1 + 200 + 1 + 2);
+
+// Exceptions thrown while converting a value propagate.
+assert.throws(function() {
+  serialize('HTTP/1.1 200 OK\r\n',
+            { 'X-Bad': { toString: function() { throw new Error('nope'); } } },
+            0);
+}, /nope/);
+
+// response.sendDate adds one Date header, unless the response has one.
+var responses = [];
+var server = http.createServer(function(req, res) {
+  res.sendDate = true;
+  if (req.url === '/own') {
+    res.writeHead(200, { 'Date': 'Thu, 01 Jan 1970 00:00:00 GMT' });
+  } else {
+    res.writeHead(200);
+  }
+  res.end('ok');
+});
+
+function get(path, cb) {
+  var c = net.createConnection(common.PORT);
+  var data = '';
+  c.setEncoding('ascii');
+  c.on('connect', function() {
+    c.write('GET ' + path + ' HTTP/1.0\r\n\r\n');
+  });
+  c.on('data', function(chunk) { data += chunk; });
+  c.on('end', function() {
+    c.end();
+    cb(data);
+  });
+}
+
+server.listen(common.PORT, function() {
+  get('/', function(data) {
+    var dates = data.match(/^Date: .*$/mg);
+    assert.equal(dates.length, 1);
+    assert.ok(/^Date: \w{3}, \d\d \w{3} \d{4} \d\d:\d\d:\d\d GMT$/
+              .test(dates[0]));
+    var t = Date.parse(dates[0].slice(6));
+    assert.ok(Math.abs(t - Date.now()) < 5000);
+    responses.push(data);
+
+    get('/own', function(data) {
+      assert.deepEqual(data.match(/^Date: .*$/mg),
+                       ['Date: Thu, 01 Jan 1970 00:00:00 GMT']);
+      responses.push(data);
+      server.close();
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(responses.length, 2);
+});
@@ -0,0 +1,77 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Once the process is idle, freed memory that pools hold beyond
+// --idle-retain goes back to malloc; with --idle-retain=-1 it stays.
+
+var common = require('../common');
+var assert = require('assert');
+var spawn = require('child_process').spawn;
+
+if (process.argv[2] === 'child') {
+  var garbage = [];
+  for (var i = 0; i < 256; i++) garbage.push(new Buffer(64 * 1024));
+  garbage = null;
+
+  setTimeout(function() {
+    var usage = process.memoryUsage();
+    console.log(JSON.stringify({
+      released: usage.released,
+      cached: Buffer.arenaStats().cachedBytes
+    }));
+  }, 3000);
+  return;
+}
+
+function run(retain, cb) {
+  var flags = ['--gc-fast-tick=10', '--gc-wait-time=100',
+               '--idle-retain=' + retain];
+  var child = spawn(process.execPath, flags.concat([__filename, 'child']));
+  var out = '';
+  child.stdout.setEncoding('utf8');
+  child.stdout.on('data', function(d) {
+    out += d;
+  });
+  child.stderr.pipe(process.stderr);
+  child.on('exit', function(code) {
+    assert.equal(code, 0, flags.join(' '));
+    cb(JSON.parse(out));
+  });
+}
+
+var done = 0;
+
+run(0, function(r) {
+  assert.equal(typeof r.released, 'number');
+  assert.ok(r.released >= 0);
+  assert.equal(r.cached, 0);
+  done++;
+});
+
+run(-1, function(r) {
+  assert.equal(r.released, 0);
+  done++;
+});
+
+process.on('exit', function() {
+  assert.equal(done, 2);
+});
@@ -0,0 +1,73 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var binding = process.binding('io_watcher');
+
+// Regular files are always ready, so every watcher here is oneshot.
+var fd1 = fs.openSync(__filename, 'r');
+var fd2 = fs.openSync(common.fixturesDir + '/empty.txt', 'r');
+
+var calls = [];
+var group = new binding.IOWatcherGroup();
+group.callback = function(ready) {
+  assert.ok(ready instanceof Int32Array);
+  var fds = [];
+  for (var i = 0; i < ready.length; i += 2) {
+    assert.ok(ready[i + 1] & binding.IOWatcherGroup.READ);
+    fds.push(ready[i]);
+  }
+  calls.push(fds.sort());
+
+  if (calls.length === 1) {
+    // Both came in one call; neither comes again until it is rearmed.
+    setTimeout(function() {
+      assert.equal(calls.length, 1);
+      assert.ok(group.rearm(fd2));
+    }, 50);
+  } else {
+    group.stop();
+    assert.ok(group.remove(fd1));
+    assert.ok(!group.remove(fd1));
+  }
+};
+group.add(fd1, true, false, true);
+group.add(fd2, true, false, true);
+group.start();
+
+var single = 0;
+var io = new binding.IOWatcher();
+io.callback = function(readable, writable) {
+  assert.ok(readable);
+  single++;
+};
+io.set(fd1, true, false, true);
+io.start();
+
+process.on('exit', function() {
+  assert.deepEqual(calls, [[fd1, fd2].sort(), [fd2]]);
+  assert.equal(single, 1);
+  fs.closeSync(fd1);
+  fs.closeSync(fd2);
+});
@@ -0,0 +1,64 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var spawn = require('child_process').spawn;
+
+if (process.argv[2] === 'child') {
+  // about 64MB of live heap
+  var keep = [];
+  for (var i = 0; i < 64; i++) {
+    var a = new Array(128 * 1024);
+    for (var j = 0; j < a.length; j++) a[j] = j + 0.5;
+    keep.push(a);
+  }
+  return;
+}
+
+function run(flags, cb) {
+  var child = spawn(process.execPath, flags.concat([__filename, 'child']));
+  var stderr = '';
+  child.stderr.setEncoding('utf8');
+  child.stderr.on('data', function(data) {
+    stderr += data;
+  });
+  child.on('exit', function(code) {
+    cb(code, stderr);
+  });
+}
+
+var exits = 0;
+
+run([], function(code, stderr) {
+  assert.equal(code, 0, stderr);
+  exits++;
+});
+
+run(['--max-old-space=16'], function(code, stderr) {
+  assert.notEqual(code, 0);
+  assert.ok(/memory/.test(stderr), stderr);
+  exits++;
+});
+
+process.on('exit', function() {
+  assert.equal(exits, 2);
+});
@@ -28,3 +28,14 @@ var assert = require('assert');
 var r = process.memoryUsage();
 console.log(common.inspect(r));
 assert.equal(true, r['rss'] > 0);
+
+// Buffer storage is reported outside the heap
+var before = process.memoryUsage();
+var b = new Buffer(1024 * 1024);
+var after = process.memoryUsage();
+assert.ok(after.buffers - before.buffers >= b.length);
+assert.ok(after.external - before.external >= b.length);
+
+var rss = process.memoryUsage.rss();
+assert.equal(typeof rss, 'number');
+assert.ok(rss > 0);
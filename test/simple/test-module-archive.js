@@ -0,0 +1,116 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+
+// With NODE_ARCHIVE set, modules below the archive's root are resolved and
+// read from it, even when they are gone from disk.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+var spawn = require('child_process').spawn;
+
+var appDir = path.join(common.tmpDir, 'archive-app');
+var archive = path.join(common.tmpDir, 'archive-app.nar');
+var tool = path.join(__dirname, '../../tools/archive.js');
+
+function rmrf(p) {
+  try {
+    if (fs.statSync(p).isDirectory()) {
+      fs.readdirSync(p).forEach(function(f) {
+        rmrf(path.join(p, f));
+      });
+      fs.rmdirSync(p);
+    } else {
+      fs.unlinkSync(p);
+    }
+  } catch (e) {
+  }
+}
+
+function write(name, content) {
+  var parts = name.split('/');
+  var dir = appDir;
+  for (var i = 0; i < parts.length - 1; i++) {
+    dir = path.join(dir, parts[i]);
+    try { fs.mkdirSync(dir, '0755'); } catch (e) {}
+  }
+  fs.writeFileSync(path.join(appDir, name), content);
+}
+
+function run(args, env, cb) {
+  var childEnv = {};
+  for (var k in process.env) childEnv[k] = process.env[k];
+  for (var k in env) childEnv[k] = env[k];
+
+  var child = spawn(process.execPath, args, { env: childEnv });
+  var out = '';
+  child.stdout.setEncoding('utf8');
+  child.stdout.on('data', function(d) {
+    out += d;
+  });
+  child.stderr.pipe(process.stderr);
+  child.on('exit', function(code) {
+    assert.equal(code, 0);
+    cb(out);
+  });
+}
+
+rmrf(appDir);
+rmrf(archive);
+fs.mkdirSync(appDir, '0755');
+
+write('main.js',
+      'var assert = require("assert");\n' +
+      'assert.throws(function() { require("./missing"); });\n' +
+      'console.log([require("./lib/a"), require("foo"),\n' +
+      '             require("./data.json").value].join(" "));\n');
+write('lib/a.js', 'module.exports = "a";\n');
+write('node_modules/foo/package.json', '{ "main": "./lib/foo" }\n');
+write('node_modules/foo/lib/foo.js', 'module.exports = "foo";\n');
+write('data.json', '{ "value": "json" }\n');
+
+run([tool, archive, appDir], {}, function() {
+  // Only the archive is left.
+  rmrf(appDir);
+
+  // The archive is mapped with fs.mmap; its contents read back through it.
+  var Module = require('module');
+  assert.equal(typeof fs.mmap, 'function');
+  process.env.NODE_ARCHIVE = archive;
+  process.env.NODE_ARCHIVE_ROOT = appDir;
+  Module._initArchive();
+  assert.ok(Buffer.isBuffer(Module._archive.data));
+  assert.equal(Module._archive.read(path.join(appDir, 'lib/a.js')),
+               'module.exports = "a";\n');
+  Module._archive = null;
+  delete process.env.NODE_ARCHIVE;
+  delete process.env.NODE_ARCHIVE_ROOT;
+
+  var env = { NODE_ARCHIVE: archive, NODE_ARCHIVE_ROOT: appDir };
+  run([path.join(appDir, 'main.js')], env, function(out) {
+    assert.equal(out, 'a foo json\n');
+    rmrf(archive);
+    console.log('ok');
+  });
+});
@@ -0,0 +1,102 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// With NODE_CODE_CACHE set, parser data for core and user modules is kept
+// in that directory, and entries that don't match the source are ignored.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+var spawn = require('child_process').spawn;
+
+var cacheDir = path.join(common.tmpDir, 'code-cache');
+var modulePath = path.join(common.tmpDir, 'code-cache-module.js');
+
+function rmrf(dir) {
+  try {
+    fs.readdirSync(dir).forEach(function(f) {
+      fs.unlinkSync(path.join(dir, f));
+    });
+    fs.rmdirSync(dir);
+  } catch (e) {
+  }
+}
+
+rmrf(cacheDir);
+fs.mkdirSync(cacheDir, '0755');
+
+function writeModule(value) {
+  fs.writeFileSync(modulePath,
+                   'function f() { return ' + JSON.stringify(value) + '; }\n' +
+                   'console.log(f());\n');
+}
+
+function run(expected, cb) {
+  var env = {};
+  for (var k in process.env) env[k] = process.env[k];
+  env.NODE_CODE_CACHE = cacheDir;
+
+  var child = spawn(process.execPath, [modulePath], { env: env });
+  var out = '';
+  child.stdout.setEncoding('utf8');
+  child.stdout.on('data', function(d) {
+    out += d;
+  });
+  child.stderr.pipe(process.stderr);
+  child.on('exit', function(code) {
+    assert.equal(code, 0);
+    assert.equal(out, expected + '\n');
+    cb();
+  });
+}
+
+writeModule('first');
+
+run('first', function() {
+  var entries = fs.readdirSync(cacheDir);
+  assert.ok(entries.length > 1, 'core and user module entries');
+  entries.forEach(function(f) {
+    assert.ok(/^[0-9a-f]{16}\.pre$/.test(f), f);
+  });
+
+  // Same sources: no new entries.
+  run('first', function() {
+    assert.equal(fs.readdirSync(cacheDir).length, entries.length);
+
+    // A changed module gets an entry of its own.
+    writeModule('second');
+    run('second', function() {
+      assert.equal(fs.readdirSync(cacheDir).length, entries.length + 1);
+
+      // Damaged entries are not used.
+      fs.readdirSync(cacheDir).forEach(function(f) {
+        fs.writeFileSync(path.join(cacheDir, f), 'garbage');
+      });
+      run('second', function() {
+        rmrf(cacheDir);
+        fs.unlinkSync(modulePath);
+        console.log('ok');
+      });
+    });
+  });
+});
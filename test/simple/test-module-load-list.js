@@ -42,7 +42,6 @@ function checkExpected() {
 }
 
 var expected = [
-  'Binding evals',
   'Binding natives',
   'NativeModule events',
   'NativeModule buffer',
@@ -51,6 +50,7 @@ var expected = [
   'NativeModule util',
   'NativeModule path',
   'NativeModule module',
+  'Binding evals',
   'NativeModule fs',
   'Binding fs',
   'Binding constants',
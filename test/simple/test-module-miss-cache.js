@@ -0,0 +1,49 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+
+// A module that could not be found counts as missing for a while, and is
+// found once that is over.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+var Module = require('module');
+
+var name = 'module-miss-cache-' + process.pid;
+var file = path.join(common.tmpDir, name + '.js');
+var request = path.join(common.tmpDir, name);
+
+try { fs.unlinkSync(file); } catch (e) {}
+
+assert.throws(function() { require(request); }, /Cannot find module/);
+
+fs.writeFileSync(file, 'module.exports = 42;\n');
+
+// Still missing as far as require() knows.
+assert.throws(function() { require(request); }, /Cannot find module/);
+
+Module._missTimeout = 0;
+assert.equal(42, require(request));
+
+fs.unlinkSync(file);
@@ -0,0 +1,88 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+var spawn = require('child_process').spawn;
+var Module = require('module');
+var binding = process.binding('fs');
+
+if (!binding.Prefetch) {
+  console.error('Skipping: the fs binding has no Prefetch here');
+  process.exit(0);
+}
+
+var a = path.join(common.tmpDir, 'prefetch-a.js');
+var b = path.join(common.tmpDir, 'prefetch-b.json');
+var missing = path.join(common.tmpDir, 'prefetch-missing.js');
+fs.writeFileSync(a, 'exports.b = require(' + JSON.stringify(b) + ');');
+fs.writeFileSync(b, '{"answer": 42}');
+try { fs.unlinkSync(missing); } catch (e) {}
+
+// The binding.
+var prefetch = new binding.Prefetch([a, missing, b]);
+assert.equal(prefetch.take(2).toString(), '{"answer": 42}');
+assert.equal(prefetch.take(0).toString(), fs.readFileSync(a, 'utf8'));
+assert.strictEqual(prefetch.take(0), undefined);
+assert.strictEqual(prefetch.take(1), undefined);
+assert.throws(function() { prefetch.take(3); });
+
+// require() takes what Module.prefetch() read.
+Module.prefetch([a, b]);
+assert.ok(a in Module._prefetched);
+assert.deepEqual(require(a), { b: { answer: 42 } });
+assert.ok(!(a in Module._prefetched));
+assert.ok(!(b in Module._prefetched));
+
+// A manifest is written by the first run and used by the second.
+var manifest = path.join(common.tmpDir, 'prefetch.modules');
+try { fs.unlinkSync(manifest); } catch (e) {}
+
+var env = {};
+for (var k in process.env) env[k] = process.env[k];
+env.NODE_MODULE_MANIFEST = manifest;
+
+var runs = 0;
+
+function run(cb) {
+  var child = spawn(process.execPath, ['-e', 'require(' + JSON.stringify(a) +
+                                       ')'], { env: env });
+  child.stderr.pipe(process.stderr);
+  child.on('exit', function(code) {
+    assert.equal(code, 0);
+    runs++;
+    cb();
+  });
+}
+
+run(function() {
+  var listed = JSON.parse(fs.readFileSync(manifest, 'utf8'));
+  assert.deepEqual(listed, [a, b]);
+  run(function() {
+    assert.deepEqual(JSON.parse(fs.readFileSync(manifest, 'utf8')), listed);
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(runs, 2);
+});
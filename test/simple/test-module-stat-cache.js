@@ -0,0 +1,84 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+var Module = require('module');
+
+var root = path.join(common.tmpDir, 'module-stat-cache');
+
+function mkdir(dir) {
+  try {
+    fs.mkdirSync(dir, 0777);
+  } catch (e) {
+    if (e.code !== 'EEXIST') throw e;
+  }
+}
+
+mkdir(root);
+mkdir(path.join(root, 'node_modules'));
+mkdir(path.join(root, 'one'));
+mkdir(path.join(root, 'two'));
+fs.writeFileSync(path.join(root, 'node_modules', 'dep.js'),
+                 'exports.dep = true;');
+fs.writeFileSync(path.join(root, 'one', 'index.js'),
+                 'module.exports = require("dep");');
+fs.writeFileSync(path.join(root, 'two', 'index.js'),
+                 'module.exports = require("dep");');
+fs.writeFileSync(path.join(root, 'main.js'),
+                 'exports.one = require("./one");\n' +
+                 'exports.two = require("./two");\n');
+
+var stats = {};
+var statSync = fs.statSync;
+fs.statSync = function(p) {
+  stats[p] = (stats[p] || 0) + 1;
+  return statSync.apply(this, arguments);
+};
+
+assert.equal(Module._statCache, null);
+
+var main = require(path.join(root, 'main'));
+assert.ok(main.one.dep);
+assert.strictEqual(main.one, main.two);
+
+// one/ and two/ both looked for dep in root/node_modules, but only one of
+// them had to ask the file system.
+var missing = path.join(root, 'one', 'node_modules', 'dep');
+var found = path.join(root, 'node_modules', 'dep');
+assert.equal(stats[missing], 1);
+assert.equal(stats[found], 1);
+assert.equal(stats[found + '.js'], 1);
+
+// The cache is gone once loading is done, so files that appear later are
+// found.
+assert.equal(Module._statCache, null);
+var later = path.join(root, 'later');
+try { fs.unlinkSync(later + '.js'); } catch (e) {}
+assert.throws(function() {
+  require(later);
+}, /Cannot find module/);
+fs.writeFileSync(later + '.js', 'exports.later = true;');
+assert.ok(require(later).later);
+
+fs.statSync = statSync;
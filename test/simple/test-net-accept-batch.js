@@ -0,0 +1,59 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var N = 50;
+var connections = 0;
+var batches = 0;
+var largest = 0;
+var closed = 0;
+
+var server = net.createServer({ acceptBatchSize: 8 }, function(socket) {
+  connections++;
+  socket.end();
+});
+
+server.listen(common.PORT, function() {
+  var onconnectionbatch = server._handle.onconnectionbatch;
+  assert.equal('function', typeof onconnectionbatch);
+
+  server._handle.onconnectionbatch = function(clients) {
+    batches++;
+    assert.ok(clients.length >= 1 && clients.length <= 8);
+    largest = Math.max(largest, clients.length);
+    onconnectionbatch.call(this, clients);
+  };
+
+  for (var i = 0; i < N; i++) {
+    net.createConnection(common.PORT).on('close', function() {
+      if (++closed == N) server.close();
+    });
+  }
+});
+
+process.on('exit', function() {
+  assert.equal(N, connections);
+  assert.ok(batches <= N);
+  console.log('batches: %d, largest: %d', batches, largest);
+});
@@ -0,0 +1,82 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// A socket given several addresses connects to the one that accepts, and
+// reports an error only once all of them have failed.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var connected = false;
+var refused = false;
+var timedOut = false;
+
+var server = net.createServer(function(socket) {
+  socket.end();
+});
+
+server.listen(common.PORT, '127.0.0.1', function() {
+  // Nothing listens on 127.0.0.2; on Linux that is refused at once, and
+  // elsewhere the connect timeout ends the attempt.
+  var socket = new net.Socket({ connectTimeout: 1000, attemptDelay: 100 });
+  socket.connect(common.PORT, ['127.0.0.2', '127.0.0.1'], function() {
+    connected = true;
+    assert.equal(socket.remoteAddress, '127.0.0.1');
+    assert.equal(socket.remotePort, common.PORT);
+    socket.destroy();
+    server.close();
+    allFail();
+  });
+});
+
+function allFail() {
+  var socket = net.connect(common.PORT + 1, ['127.0.0.1', '127.0.0.1']);
+  socket.on('connect', assert.fail);
+  socket.on('error', function(err) {
+    refused = true;
+    assert.equal(err.code, 'ECONNREFUSED');
+    timeout();
+  });
+}
+
+// 192.0.2.0/24 is reserved for documentation, connects to it go nowhere or
+// are rejected by the network right away.
+function timeout() {
+  var start = Date.now();
+  var socket = new net.Socket();
+  socket.setConnectTimeout(100);
+  socket.connect(common.PORT, '192.0.2.1');
+  socket.on('connect', assert.fail);
+  socket.on('error', function(err) {
+    timedOut = true;
+    assert.ok(Date.now() - start < 5000);
+    assert.ok(/^(ETIMEDOUT|ENETUNREACH|EHOSTUNREACH)$/.test(err.code),
+              err.code);
+  });
+}
+
+process.on('exit', function() {
+  assert.ok(connected);
+  assert.ok(refused);
+  assert.ok(timedOut);
+});
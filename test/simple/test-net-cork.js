@@ -0,0 +1,65 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var received = '';
+var callbacks = 0;
+
+var server = net.createServer(function(socket) {
+  socket.setEncoding('ascii');
+  socket.on('data', function(d) {
+    received += d;
+  });
+  socket.on('end', function() {
+    server.close();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.createConnection(common.PORT, function() {
+    // Writes within one tick are corked automatically.
+    client.write('a', function() { callbacks++; });
+    client.write('b', function() { callbacks++; });
+    assert.equal(0, client._pendingWriteReqs);
+    assert.equal(2, client.bufferSize);
+
+    process.nextTick(function() {
+      assert.equal(1, client._pendingWriteReqs);
+
+      // An explicit cork holds the data across ticks.
+      client.cork();
+      client.write('c', function() { callbacks++; });
+      setTimeout(function() {
+        assert.equal(1, client.bufferSize - client._handle.writeQueueSize);
+        client.uncork();
+        client.end('d');
+      }, 10);
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.equal('abcd', received);
+  assert.equal(3, callbacks);
+});
@@ -0,0 +1,49 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var received = '';
+
+var server = net.createServer({ deferAccept: 1, fastOpen: true },
+                              function(socket) {
+  // With TCP_DEFER_ACCEPT the request is already waiting.
+  socket.setEncoding('utf8');
+  socket.on('data', function(d) {
+    received += d;
+  });
+  socket.on('end', function() {
+    socket.end();
+    server.close();
+  });
+});
+
+server.listen(common.PORT, '127.0.0.1', function() {
+  var client = new net.Socket({ fastOpen: true });
+  client.connect(common.PORT, '127.0.0.1');
+  client.end('GET / HTTP/1.0\r\n\r\n');
+});
+
+process.on('exit', function() {
+  assert.equal('GET / HTTP/1.0\r\n\r\n', received);
+});
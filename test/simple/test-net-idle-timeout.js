@@ -0,0 +1,66 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var net = require('net');
+var assert = require('assert');
+
+// Reads keep pushing the idle timeout back; once they stop it fires once.
+var timeouts = 0;
+var lastData = 0;
+
+var server = net.createServer(function(socket) {
+  socket.setTimeout(100);
+
+  socket.on('data', function() {
+    lastData = Date.now();
+  });
+
+  socket.on('timeout', function() {
+    assert.ok(lastData > 0);
+    assert.ok(Date.now() - lastData >= 99);
+    timeouts++;
+
+    // No second timeout without activity in between.
+    setTimeout(function() {
+      socket.destroy();
+      server.close();
+    }, 250);
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.createConnection(common.PORT);
+  var writes = 0;
+
+  client.on('connect', function() {
+    var iv = setInterval(function() {
+      client.write('ping');
+      if (++writes == 15) clearInterval(iv);
+    }, 20);
+  });
+
+  client.on('error', function() {});
+});
+
+process.on('exit', function() {
+  assert.equal(timeouts, 1);
+});
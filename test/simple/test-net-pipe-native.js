@@ -0,0 +1,96 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// A proxy that pipes sockets into each other natively.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var SIZE = 4 * 1024 * 1024;
+var payload = new Buffer(SIZE);
+for (var i = 0; i < SIZE; i++) payload[i] = i % 251;
+
+var backendPort = common.PORT;
+var proxyPort = common.PORT + 1;
+var proxied = 0;
+var received = [];
+var receivedLength = 0;
+var closed = 0;
+
+var backend = net.createServer(function(socket) {
+  var upload = 0;
+  socket.on('data', function(d) { upload += d.length; });
+  socket.on('end', function() {
+    assert.equal(upload, 5);
+    socket.end(payload);
+  });
+});
+
+var proxy = net.createServer(function(client) {
+  client.pause();
+  var upstream = net.connect(backendPort, function() {
+    client.pipe(upstream);
+    upstream.pipe(client);
+    // A 'data' listener added now sees nothing; the bytes stay native.
+    upstream.on('data', function() {
+      assert.fail('data event on a natively piped socket');
+    });
+  });
+  upstream.on('end', function() {
+    proxied = upstream.bytesRead;
+    assert.equal(client.bytesWritten, SIZE);
+  });
+  client.on('close', function() {
+    if (++closed === 1) {
+      proxy.close();
+      backend.close();
+    }
+  });
+});
+
+backend.listen(backendPort, function() {
+  proxy.listen(proxyPort, function() {
+    var socket = net.connect(proxyPort, function() {
+      socket.end('hello');
+    });
+    socket.on('data', function(d) {
+      received.push(d);
+      receivedLength += d.length;
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(proxied, SIZE);
+  assert.equal(receivedLength, SIZE);
+
+  var all = new Buffer(receivedLength);
+  var offset = 0;
+  received.forEach(function(d) {
+    d.copy(all, offset);
+    offset += d.length;
+  });
+  for (var i = 0; i < SIZE; i++) {
+    if (all[i] !== i % 251) assert.fail('byte ' + i + ' differs');
+  }
+});
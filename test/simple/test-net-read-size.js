@@ -0,0 +1,59 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var N = 12;
+var slabSizes = [];
+
+var server = net.createServer(function(socket) {
+  socket.on('data', function(d) {
+    slabSizes.push(d.parent.length);
+    if (slabSizes.length < N) {
+      socket.write('x');
+    } else {
+      socket.end();
+    }
+  });
+  socket.on('end', function() {
+    server.close();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.createConnection(common.PORT, function() {
+    client.write('x');
+  });
+  // Ping-pong makes sure every byte arrives in a read of its own.
+  client.on('data', function() {
+    client.write('x');
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(N, slabSizes.length);
+  // The first reads come from a full-size slab; once the handle's reads
+  // shrank they are served from small slabs.
+  assert.equal(1024 * 1024, slabSizes[0]);
+  assert.equal(64 * 1024, slabSizes[N - 1]);
+});
@@ -0,0 +1,53 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var listening = 0;
+var error = null;
+
+function onListening() {
+  if (++listening < 2) return;
+  a.close();
+  b.close();
+}
+
+var a = net.createServer({ reusePort: true });
+var b = net.createServer({ reusePort: true });
+
+[a, b].forEach(function(server) {
+  server.on('error', function(e) {
+    assert.equal('ENOTSUP', e.code);
+    error = e;
+  });
+  server.on('listening', onListening);
+});
+
+a.listen(common.PORT, '127.0.0.1', function() {
+  b.listen(common.PORT, '127.0.0.1');
+});
+
+process.on('exit', function() {
+  // Either both servers share the port, or the platform lacks SO_REUSEPORT.
+  assert.ok(listening == 2 || error);
+});
@@ -0,0 +1,71 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+var http = require('http');
+
+
+var netServer = net.createServer({ backlog: 7, pendingAccepts: 512 },
+                                 function() {});
+assert.equal(netServer.backlog, 7);
+assert.equal(netServer.pendingAccepts, 512);
+assert.strictEqual(netServer.listenQueue(), null);
+
+var httpServer = http.createServer({ backlog: 9, allowHalfOpen: false },
+                                   function(req, res) {
+  res.end('ok');
+});
+assert.equal(httpServer.backlog, 9);
+assert.equal(httpServer.allowHalfOpen, true);
+
+// The old signature still works.
+assert.equal(http.createServer(function() {}).listeners('request').length, 1);
+
+function check(server, backlog) {
+  var queue = server.listenQueue();
+  if (process.platform !== 'linux') {
+    assert.strictEqual(queue, null);
+    return;
+  }
+  assert.equal(queue.backlog, backlog);
+  assert.equal(typeof queue.length, 'number');
+  assert.ok(queue.length >= 0);
+  if ('overflows' in queue) {
+    assert.ok(queue.overflows >= 0);
+    assert.ok(queue.drops >= queue.overflows);
+  }
+}
+
+netServer.listen(common.PORT, function() {
+  check(netServer, 7);
+  httpServer.listen(common.PORT + 1, function() {
+    check(httpServer, 9);
+    http.get({ port: common.PORT + 1, path: '/' }, function(res) {
+      assert.equal(res.statusCode, 200);
+      res.on('end', function() {
+        netServer.close();
+        httpServer.close();
+      });
+    });
+  });
+});
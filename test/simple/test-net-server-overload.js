@@ -0,0 +1,79 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var connections = 0;
+var events = [];
+var replies = [];
+
+var server = net.createServer(function(c) {
+  connections++;
+  c.end('welcome\n');
+});
+
+server.setOverload({ maxLag: 50, resumeLag: 20, response: 'busy\n' });
+
+server.on('overload', function(overloaded, rejected) {
+  events.push([overloaded, rejected]);
+});
+
+function connect(cb) {
+  var c = net.connect(common.PORT);
+  var data = '';
+  c.setEncoding('utf8');
+  c.on('data', function(d) { data += d; });
+  c.on('end', function() {
+    replies.push(data);
+    c.end();
+    if (cb) cb();
+  });
+}
+
+server.listen(common.PORT, function() {
+  assert.equal(server.overloaded, false);
+
+  setTimeout(function() {
+    // The connection is accepted on the next turn of the loop, after this
+    // one has held it up for longer than maxLag.
+    connect(function() {
+      assert.equal(server.overloaded, true);
+      // Idle turns since bring the lag back down.
+      setTimeout(function() {
+        connect(function() {
+          assert.equal(server.overloaded, false);
+          server.close();
+        });
+      }, 50);
+    });
+
+    var start = Date.now();
+    while (Date.now() - start < 100);
+  }, 1);
+});
+
+process.on('exit', function() {
+  assert.deepEqual(replies, ['busy\n', 'welcome\n']);
+  assert.equal(connections, 1);
+  assert.deepEqual(events, [[true, 1], [false, 1]]);
+});
@@ -0,0 +1,63 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var chunks = [];
+var received = 0;
+
+assert.equal('number', typeof process.memoryUsage().pinnedSlabs);
+
+net.setSlabCompaction(512);
+
+var server = net.createServer(function(socket) {
+  socket.on('data', function(d) {
+    chunks.push(d);
+    received += d.length;
+    if (received == 100) socket.write('ok');
+    if (received == 100 + 4096) socket.end();
+  });
+  socket.on('end', function() {
+    server.close();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.createConnection(common.PORT, function() {
+    client.write(new Buffer(100));
+  });
+  client.on('data', function() {
+    client.end(new Buffer(4096));
+  });
+});
+
+process.on('exit', function() {
+  net.setSlabCompaction(0);
+
+  // A small read gets a buffer of its own, a big one is a slab slice.
+  assert.equal(100, chunks[0].length);
+  assert.equal(100, chunks[0].parent.length);
+  var last = chunks[chunks.length - 1];
+  assert.ok(last.length > 512);
+  assert.ok(last.parent.length > last.length);
+});
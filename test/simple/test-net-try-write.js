@@ -0,0 +1,80 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var received = '';
+var big = new Buffer(16 * 1024 * 1024);
+big.fill(0x61);
+var queued = false;
+var callbacks = 0;
+
+var server = net.createServer(function(socket) {
+  socket.setEncoding('utf8');
+  socket.on('data', function(d) {
+    received += d;
+  });
+  socket.on('end', function() {
+    server.close();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.createConnection(common.PORT, function() {
+    var handle = client._handle;
+
+    assert.throws(function() { handle.tryWrite(42); }, TypeError);
+
+    // An empty socket takes small writes right away.
+    assert.strictEqual(true, handle.tryWrite(new Buffer('a')));
+    assert.strictEqual(true, handle.tryWrite('ü', 'utf8'));
+    assert.strictEqual(true, handle.tryWrite('c', 'ascii'));
+    assert.equal(0, handle.writeQueueSize);
+
+    // The kernel can't take all of this, the rest is queued.
+    var req = handle.tryWrite(big);
+    assert.ok(req && req !== true);
+    assert.ok(handle.writeQueueSize > 0);
+    assert.ok(handle.writeQueueSize < big.length);
+    client._pendingWriteReqs++;
+    req.oncomplete = function(status) {
+      assert.equal(0, status);
+      queued = true;
+      client._pendingWriteReqs--;
+
+      // Completes through the socket's usual write callback.
+      client.write('d', function() {
+        callbacks++;
+        client.end();
+      });
+    };
+  });
+});
+
+process.on('exit', function() {
+  assert.ok(queued);
+  assert.equal(1, callbacks);
+  assert.equal(3 + big.length + 1, received.length);
+  assert.equal('aüc', received.slice(0, 3));
+  assert.equal('d', received.slice(-1));
+});
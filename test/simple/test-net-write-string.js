@@ -0,0 +1,83 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var small = 'hëllo wörld ';
+var largeAscii = new Array(64 * 1024).join('a') + 'z';
+var largeUtf8 = new Array(16 * 1024).join('ü') + 'z';
+var chunks = [];
+var completed = 0;
+
+var server = net.createServer(function(socket) {
+  socket.on('data', function(d) {
+    chunks.push(d);
+  });
+  socket.on('end', function() {
+    server.close();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.createConnection(common.PORT, function() {
+    var handle = client._handle;
+
+    assert.throws(function() { handle.writeUtf8String(42); }, TypeError);
+    assert.throws(function() { handle.writeAsciiString({}); }, TypeError);
+
+    function write(method, string) {
+      var req = handle[method](string);
+      assert.ok(req);
+      client._pendingWriteReqs++;
+      req.oncomplete = function(status) {
+        assert.equal(0, status);
+        client._pendingWriteReqs--;
+        if (++completed == 6) client.end();
+      };
+    }
+
+    write('writeUtf8String', small);
+    write('writeAsciiString', largeAscii);
+    write('writeUtf8String', largeUtf8);
+    // Externalized by the previous write, written again without a copy.
+    write('writeUtf8String', largeAscii);
+    write('writeAsciiString', small);
+    write('writeAsciiString', largeAscii);
+  });
+});
+
+process.on('exit', function() {
+  var received = '';
+  chunks.forEach(function(chunk) {
+    received += chunk.toString('binary');
+  });
+  var expected = new Buffer(small, 'utf8').toString('binary') +
+                 largeAscii +
+                 new Buffer(largeUtf8, 'utf8').toString('binary') +
+                 largeAscii +
+                 new Buffer(small, 'ascii').toString('binary') +
+                 largeAscii;
+  assert.equal(expected.length, received.length);
+  assert.ok(expected == received);
+  assert.equal(6, completed);
+});
@@ -0,0 +1,82 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var HIGH = 256 * 1024;
+var LOW = 64 * 1024;
+var chunk = new Buffer(64 * 1024);
+
+var received = 0;
+var written = 0;
+var drains = 0;
+var blocked = 0;
+
+var server = net.createServer(function(socket) {
+  // Don't read until the client's queue is over the high watermark.
+  socket.pause();
+  server.socket = socket;
+  socket.on('data', function(data) {
+    received += data.length;
+  });
+  socket.on('end', function() {
+    server.close();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.connect(common.PORT);
+  client.setWriteWatermarks(HIGH, LOW);
+
+  client.on('connect', function() {
+    fill();
+  });
+
+  function fill() {
+    // The kernel buffers take the first writes; the queue builds after.
+    while (client.write(chunk)) {
+      written += chunk.length;
+    }
+    written += chunk.length;
+    blocked++;
+    assert.ok(client.bufferSize >= HIGH);
+
+    if (blocked == 1) server.socket.resume();
+  }
+
+  client.on('drain', function() {
+    drains++;
+    assert.ok(client.bufferSize <= LOW);
+    if (blocked < 3) {
+      fill();
+    } else if (client.bufferSize == 0) {
+      client.end();
+    }
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(blocked, 3);
+  assert.ok(drains >= 3);
+  assert.equal(received, written);
+});
@@ -0,0 +1,80 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var chunks = ['hello', new Buffer(' '), 'wörld', new Buffer('!')];
+var expected = 'hello wörld!';
+var received = '';
+var writevCompleted = false;
+var socketCompleted = false;
+
+var server = net.createServer(function(socket) {
+  socket.setEncoding('utf8');
+  socket.on('data', function(d) {
+    received += d;
+  });
+  socket.on('end', function() {
+    server.close();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.createConnection(common.PORT);
+
+  // Queued while connecting.
+  client._writev(chunks.slice(0, 2), ['ascii'], function() {
+    socketCompleted = true;
+    writeHandle();
+  });
+
+  function writeHandle() {
+    var handle = client._handle;
+    var buffers = [new Buffer('wörld'), new Buffer('!')];
+
+    assert.throws(function() { handle.writev('foo'); }, TypeError);
+    assert.throws(function() { handle.writev([]); }, RangeError);
+    assert.throws(function() { handle.writev([new Buffer(1), 'x']); },
+                  TypeError);
+
+    var req = handle.writev(buffers);
+    assert.ok(req);
+    client._pendingWriteReqs++;
+    req.oncomplete = function(status, handle_, req_, buffers_) {
+      assert.equal(0, status);
+      assert.equal(handle, handle_);
+      assert.equal(req, req_);
+      assert.equal(buffers, buffers_);
+      writevCompleted = true;
+      client._pendingWriteReqs--;
+      client.end();
+    };
+  }
+});
+
+process.on('exit', function() {
+  assert.equal(expected, received);
+  assert.ok(writevCompleted);
+  assert.ok(socketCompleted);
+});
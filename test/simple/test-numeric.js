@@ -0,0 +1,141 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var numeric = require('numeric');
+
+function fill(array, fn) {
+  for (var i = 0; i < array.length; i++) array[i] = fn(i);
+  return array;
+}
+
+function near(actual, expected) {
+  assert.ok(Math.abs(actual - expected) <= 1e-9 * Math.abs(expected),
+            actual + ' is not ' + expected);
+}
+
+var d = fill(new Float64Array(1001), function(i) { return i * 0.5 - 100; });
+var f = fill(new Float32Array(1001), function(i) { return i * 0.25; });
+var n = fill(new Int32Array(1001), function(i) { return i - 500; });
+var u = fill(new Uint32Array(10), function(i) { return 0xffffffff - i; });
+
+// Reductions
+near(numeric.sum(d), 0.5 * 1000 * 1001 / 2 - 100 * 1001);
+near(numeric.sum(f), 0.25 * 1000 * 1001 / 2);
+assert.equal(numeric.sum(n), 500);
+assert.equal(numeric.sum(u), 0xffffffff * 10 - 45);
+assert.equal(numeric.sum(new Float64Array(0)), 0);
+
+assert.equal(numeric.min(d), -100);
+assert.equal(numeric.max(d), 400);
+assert.equal(numeric.min(n), -500);
+assert.equal(numeric.max(u), 0xffffffff);
+assert.equal(numeric.min(new Float64Array(0)), Infinity);
+assert.equal(numeric.max(new Float64Array(0)), -Infinity);
+d[7] = NaN;
+assert.ok(isNaN(numeric.min(d)));
+assert.ok(isNaN(numeric.max(d)));
+d[7] = 7 * 0.5 - 100;
+
+var ones = fill(new Float64Array(1001), function() { return 1; });
+near(numeric.dot(d, ones), numeric.sum(d));
+assert.equal(numeric.dot(n, n), 2 * 500 * 501 * 1001 / 6);
+
+assert.throws(function() { numeric.sum([1, 2, 3]); }, TypeError);
+assert.throws(function() { numeric.sum(new Uint8Array(4)); }, TypeError);
+assert.throws(function() { numeric.dot(d, f); }, TypeError);
+assert.throws(function() { numeric.dot(d, new Float64Array(3)); }, TypeError);
+
+// Maps, stored like assignments would store them
+var s = fill(new Float64Array(5), function(i) { return i; });
+assert.strictEqual(numeric.scale(s, 2, 1), s);
+assert.deepEqual(Array.prototype.slice.call(s), [1, 3, 5, 7, 9]);
+numeric.scale(s, 0.5);
+assert.deepEqual(Array.prototype.slice.call(s), [0.5, 1.5, 2.5, 3.5, 4.5]);
+
+var w = fill(new Int32Array(3), function(i) { return i - 1; });
+numeric.scale(w, 1e10);
+var expected = new Int32Array(3);
+for (var i = 0; i < 3; i++) expected[i] = (i - 1) * 1e10;
+assert.deepEqual(Array.prototype.slice.call(w),
+                 Array.prototype.slice.call(expected));
+
+// Histograms
+var h = new Float64Array([0, 1, 2, 3, 4, 5, -1, NaN]);
+assert.deepEqual(numeric.histogram(h, { bins: 4, min: 0, max: 4 }),
+                 [1, 1, 1, 2]);
+assert.deepEqual(numeric.histogram(n, 2), [500, 501]);
+assert.deepEqual(numeric.histogram(new Int32Array([3, 3]), 2), [2, 0]);
+assert.throws(function() { numeric.histogram(n, 0); }, TypeError);
+
+
+// On the thread pool, over several chunks
+var big = fill(new Int32Array(2.5 * 1024 * 1024), function(i) {
+  return i % 1000;
+});
+var bigSum = 0;
+for (var i = 0; i < big.length; i++) bigSum += big[i];
+
+var done = {};
+
+numeric.sum(big, function(err, sum) {
+  assert.ifError(err);
+  assert.equal(sum, bigSum);
+  done.sum = true;
+});
+
+numeric.max(big, function(err, max) {
+  assert.ifError(err);
+  assert.equal(max, 999);
+  done.max = true;
+});
+
+numeric.histogram(big, { bins: 10 }, function(err, counts) {
+  assert.ifError(err);
+  assert.equal(counts.length, 10);
+  assert.equal(counts.reduce(function(a, b) { return a + b; }), big.length);
+  done.histogram = true;
+});
+
+var sync = true;
+numeric.histogram(new Float64Array(0), 3, function(err) {
+  assert.ok(!sync);
+  assert.ok(err instanceof TypeError);
+  done.empty = true;
+});
+sync = false;
+
+var bigD = fill(new Float64Array(1.5 * 1024 * 1024), function(i) {
+  return i % 7;
+});
+numeric.scale(bigD, 2, 1, function(err, array) {
+  assert.ifError(err);
+  assert.strictEqual(array, bigD);
+  assert.equal(bigD[0], 1);
+  assert.equal(bigD[bigD.length - 1], ((bigD.length - 1) % 7) * 2 + 1);
+  done.scale = true;
+});
+
+process.on('exit', function() {
+  assert.deepEqual(Object.keys(done).sort(),
+                   ['empty', 'histogram', 'max', 'scale', 'sum']);
+});
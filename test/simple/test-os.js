@@ -39,6 +39,19 @@ var cpus = os.cpus();
 console.log('cpus = ', cpus);
 assert.ok(cpus.length > 0);
 
+var times = os.cpuTimes();
+assert.ok(times instanceof Float64Array);
+assert.equal(times.length, cpus.length * 5);
+assert.ok(times[0] >= cpus[0].times.user);
+assert.ok(times[3] >= cpus[0].times.idle);
+assert.strictEqual(os.cpuTimes(times), times);
+assert.throws(function() { os.cpuTimes([]); }, TypeError);
+// A replaced global constructor doesn't get written through.
+var RealFloat64Array = Float64Array;
+Float64Array = function() { return new RealFloat64Array(1); };
+assert.throws(function() { os.cpuTimes(); }, TypeError);
+Float64Array = RealFloat64Array;
+
 var type = os.type();
 console.log('type = ', type);
 assert.ok(type.length > 0);
@@ -0,0 +1,48 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var spawn = require('child_process').spawn;
+
+if (process.platform !== 'linux') {
+  console.error('Skipping: perf maps are only written on Linux.');
+  process.exit(0);
+}
+
+var script = 'function perfMapTarget() { return Math.sqrt(2); }' +
+             'for (var i = 0; i < 1e5; i++) perfMapTarget();';
+var child = spawn(process.execPath, ['--perf-basic-prof', '-e', script]);
+
+child.on('exit', function(code) {
+  assert.equal(code, 0);
+  var path = '/tmp/perf-' + child.pid + '.map';
+  var map = fs.readFileSync(path, 'utf8');
+  fs.unlinkSync(path);
+
+  var lines = map.split('\n').filter(Boolean);
+  assert.ok(lines.length > 0);
+  lines.forEach(function(line) {
+    assert.ok(/^[0-9a-f]+ [0-9a-f]+ \S/.test(line), line);
+  });
+  assert.ok(/perfMapTarget/.test(map));
+});
@@ -0,0 +1,103 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+
+assert.strictEqual(process.asyncTracking(), false);
+assert.strictEqual(process.getAsyncContext(), 0);
+
+// Without tracking, contexts are neither kept nor recorded.
+process.setAsyncContext(1);
+fs.stat(__filename, function(err) {
+  assert.ifError(err);
+  assert.strictEqual(process.getAsyncContext(), 0);
+  tracked();
+});
+assert.strictEqual(process.setAsyncContext(0), 1);
+
+function tracked() {
+  assert.strictEqual(process.asyncTracking(true), true);
+  assert.equal(process.asyncRecords().records.length, 0);
+
+  var done = 0;
+
+  assert.strictEqual(process.setAsyncContext(7), 0);
+  fs.stat(__filename, function(err) {
+    assert.ifError(err);
+    assert.strictEqual(process.getAsyncContext(), 7);
+
+    // Requests made from a callback inherit its context.
+    fs.readFile(__filename, function(err) {
+      assert.ifError(err);
+      assert.strictEqual(process.getAsyncContext(), 7);
+      process.setAsyncContext(9);
+      done++;
+      check();
+    });
+  });
+
+  process.setAsyncContext(8);
+  fs.stat(__filename, function(err) {
+    assert.ifError(err);
+    assert.strictEqual(process.getAsyncContext(), 8);
+    done++;
+    check();
+  });
+
+  // Requests made outside any context are not recorded.
+  process.setAsyncContext(0);
+  fs.stat(__filename, function(err) {
+    assert.ifError(err);
+    assert.strictEqual(process.getAsyncContext(), 0);
+    done++;
+    check();
+  });
+
+  function check() {
+    if (done < 3) return;
+    // A context set by a callback ended with it.
+    assert.strictEqual(process.getAsyncContext(), 0);
+
+    process.nextTick(function() {
+      var result = process.asyncRecords();
+      assert.equal(result.lost, 0);
+      var contexts = result.records.map(function(r) {
+        assert.ok(r.end >= r.start);
+        assert.ok(r.type === 'fs' || r.type === 'work');
+        return r.context;
+      }).sort();
+      assert.ok(contexts.indexOf(7) != -1);
+      assert.ok(contexts.indexOf(8) != -1);
+      assert.ok(contexts.indexOf(0) == -1);
+      assert.equal(process.asyncRecords().records.length, 0);
+
+      assert.strictEqual(process.asyncTracking(false), false);
+      finished = true;
+    });
+  }
+}
+
+var finished = false;
+process.on('exit', function() {
+  assert.ok(finished);
+});
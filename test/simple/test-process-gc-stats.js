@@ -0,0 +1,54 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var before = process.gcStats();
+['scavenge', 'markSweep'].forEach(function(kind) {
+  assert.equal(typeof before[kind].count, 'number');
+  assert.equal(typeof before[kind].pauseTime, 'number');
+  assert.equal(typeof before[kind].reclaimed, 'number');
+  assert.equal(before[kind].histogram.length, 24);
+});
+['steps', 'deferred', 'overruns', 'collisions'].forEach(function(name) {
+  assert.equal(typeof before.idle[name], 'number');
+});
+assert.ok(before.idle.overruns <= before.idle.steps);
+assert.ok(before.heapUsed <= before.heapTotal);
+assert.equal(typeof before.external, 'number');
+
+// Short-lived garbage is collected by scavenges.
+var keep;
+for (var i = 0; i < 1e6; i++) keep = { i: i, s: 'x' + i };
+
+var after = process.gcStats();
+var scavenges = after.scavenge.count - before.scavenge.count;
+assert.ok(scavenges > 0);
+assert.ok(after.scavenge.reclaimed > before.scavenge.reclaimed);
+assert.ok(after.scavenge.pauseTime >= before.scavenge.pauseTime);
+assert.ok(after.scavenge.maxPauseTime >= after.scavenge.lastPauseTime);
+
+var counted = 0;
+after.scavenge.histogram.forEach(function(n, i) {
+  counted += n - before.scavenge.histogram[i];
+});
+assert.equal(counted, scavenges);
@@ -0,0 +1,59 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+
+var start = process.hrtime();
+assert.ok(Array.isArray(start));
+assert.equal(start.length, 2);
+assert.ok(start[1] >= 0 && start[1] < 1e9);
+
+// Busy wait so that time passes on any clock.
+var until = Date.now() + 20;
+while (Date.now() < until);
+
+var diff = process.hrtime(start);
+assert.ok(diff[1] >= 0 && diff[1] < 1e9);
+var nsecs = diff[0] * 1e9 + diff[1];
+assert.ok(nsecs >= 15e6, nsecs);
+assert.ok(nsecs < 10e9, nsecs);
+
+var now = process.hrtime();
+assert.ok(now[0] * 1e9 + now[1] >= start[0] * 1e9 + start[1]);
+
+var fill = new Float64Array(2);
+assert.strictEqual(process.hrtime(fill), fill);
+assert.ok(fill[0] * 1e9 + fill[1] >= now[0] * 1e9 + now[1]);
+
+assert.throws(function() { process.hrtime([1]); }, TypeError);
+
+// The loop time only moves between iterations.
+var loopTime = process.loopTime();
+assert.equal(typeof loopTime, 'number');
+until = Date.now() + 20;
+while (Date.now() < until);
+assert.equal(process.loopTime(), loopTime);
+
+setTimeout(function() {
+  assert.ok(process.loopTime() >= loopTime + 10);
+}, 10);
@@ -0,0 +1,84 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+
+var before = process.loopStats();
+assert.equal(typeof before.iterations, 'number');
+assert.equal(typeof before.pollTime, 'number');
+assert.equal(typeof before.callbackTime, 'number');
+assert.equal(typeof before.callbacks.count, 'number');
+assert.equal(before.callbacks.histogram.length, 24);
+assert.ok(before.handles >= before.activeHandles);
+assert.equal(typeof before.requestPool.size, 'number');
+assert.equal(typeof before.requestPool.hits, 'number');
+if (process.platform !== 'win32') {
+  assert.equal(typeof before.eio.ready, 'number');
+  assert.equal(typeof before.eio.pending, 'number');
+}
+
+// Requests in flight are counted until their callbacks have run.
+var N = 20;
+var pending = N;
+for (var i = 0; i < N; i++) {
+  fs.stat(__filename, function(err) {
+    assert.ifError(err);
+    if (--pending === 0) setTimeout(busy, 10);
+  });
+}
+assert.ok(process.loopStats().requests >= N);
+
+// A callback that blocks the loop shows up as callback time, in the
+// histogram and as the longest callback phase.
+function busy() {
+  var start = Date.now();
+  while (Date.now() - start < 50);
+  setTimeout(check, 100);
+}
+
+function check() {
+  var after = process.loopStats();
+  assert.ok(after.iterations > before.iterations);
+  assert.ok(after.callbacks.count - before.callbacks.count >= N);
+  assert.ok(after.callbacks.maxTime >= 49);
+  assert.ok(after.maxCallbackTime >= 49);
+  assert.ok(after.callbackTime - before.callbackTime >= 49);
+  // the 100ms timer was waited for in the poll
+  assert.ok(after.pollTime - before.pollTime >= 90);
+
+  // 50ms is in the bucket under 2^16us
+  var slow = 0;
+  for (var i = 16; i < after.callbacks.histogram.length; i++) {
+    slow += after.callbacks.histogram[i] - before.callbacks.histogram[i];
+  }
+  assert.ok(slow >= 1);
+
+  // The objects of the finished requests went back to the pool, and the
+  // next request takes one.
+  assert.ok(after.requestPool.size >= N);
+  fs.stat(__filename, function(err) {
+    assert.ifError(err);
+    var stats = process.loopStats();
+    assert.ok(stats.requestPool.hits > after.requestPool.hits);
+  });
+}
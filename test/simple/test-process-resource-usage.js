@@ -0,0 +1,48 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+
+if (process.platform === 'win32') {
+  assert.equal(process.resourceUsage, undefined);
+  return;
+}
+
+var before = process.resourceUsage();
+[
+  'userCPUTime', 'systemCPUTime', 'maxRSS', 'minorPageFaults',
+  'majorPageFaults', 'fsRead', 'fsWrite', 'signals',
+  'voluntaryContextSwitches', 'involuntaryContextSwitches'
+].forEach(function(name) {
+  assert.equal(typeof before[name], 'number', name);
+  assert.ok(before[name] >= 0, name);
+});
+
+// Burn some CPU; user time must go up, and never down.
+var start = Date.now();
+while (Date.now() - start < 50);
+
+var after = process.resourceUsage();
+assert.ok(after.userCPUTime > before.userCPUTime);
+assert.ok(after.systemCPUTime >= before.systemCPUTime);
+assert.ok(after.minorPageFaults >= before.minorPageFaults);
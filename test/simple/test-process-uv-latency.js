@@ -0,0 +1,70 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+
+var SLOT = 27;
+var FS = 0;
+
+function sum(array, from, to) {
+  var total = 0;
+  for (var i = from; i < to; i++) total += array[i];
+  return total;
+}
+
+var before = process.uvLatency();
+assert.ok(before instanceof Float64Array);
+assert.equal(before.length, 5 * SLOT);
+
+assert.throws(function() {
+  process.uvLatency(new Float64Array(3));
+}, TypeError);
+
+// A replaced global constructor doesn't get written through.
+var RealFloat64Array = Float64Array;
+Float64Array = function() { return new RealFloat64Array(1); };
+assert.throws(function() { process.uvLatency(); }, TypeError);
+Float64Array = function() { return { length: 5 * SLOT }; };
+assert.throws(function() { process.uvLatency(); }, TypeError);
+Float64Array = RealFloat64Array;
+
+var N = 50;
+var pending = N;
+
+for (var i = 0; i < N; i++) {
+  fs.stat(__filename, function(err) {
+    assert.ifError(err);
+    if (--pending === 0) process.nextTick(check);
+  });
+}
+
+function check() {
+  var after = process.uvLatency(new Float64Array(5 * SLOT));
+  var completed = after[FS + 1] - before[FS + 1];
+
+  assert.ok(completed >= N);
+  assert.ok(after[FS + 2] > before[FS + 2]);
+  // Every completed request lands in exactly one bucket.
+  assert.equal(sum(after, FS + 3, FS + SLOT), after[FS + 1]);
+  assert.ok(after[FS] >= 0);
+}
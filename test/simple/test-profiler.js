@@ -0,0 +1,94 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var profiler = require('profiler');
+
+function busy() {
+  var sum = 0;
+  for (var i = 0; i < 1e6; i++) sum += Math.sqrt(i);
+  return sum;
+}
+
+assert.equal(profiler.stop('not started'), null);
+
+profiler.start('sync');
+var end = Date.now() + 200;
+while (Date.now() < end) busy();
+var json = profiler.stop('sync');
+assert.equal(typeof json, 'string');
+
+var profile = JSON.parse(json);
+assert.equal(profile.title, 'sync');
+assert.ok(Array.isArray(profile.head.children));
+
+var found = false;
+(function walk(node) {
+  assert.equal(typeof node.functionName, 'string');
+  assert.equal(typeof node.selfSamples, 'number');
+  if (node.functionName === 'busy') found = true;
+  node.children.forEach(walk);
+})(profile.head);
+assert.ok(found, 'busy() shows up in the profile');
+
+// Stopped profiles are not kept around.
+assert.equal(profiler.stop('sync'), null);
+assert.equal(process.binding('profiler').getProfilesCount(), 0);
+
+var recorded = false;
+profiler.record(50, function(err, json) {
+  assert.ifError(err);
+  assert.ok(JSON.parse(json).head);
+  recorded = true;
+});
+
+var fs = require('fs');
+var path = require('path');
+var snapshotPath = path.join(common.tmpDir, 'test.heapsnapshot');
+profiler.writeHeapSnapshot(snapshotPath, 'test');
+var snapshot = JSON.parse(fs.readFileSync(snapshotPath, 'utf8'));
+assert.equal(snapshot.snapshot.title, 'test');
+assert.ok(Array.isArray(snapshot.nodes));
+fs.unlinkSync(snapshotPath);
+
+var signalled = false;
+if (process.platform !== 'win32') {
+  profiler.snapshotOnSignal(common.tmpDir);
+  process.kill(process.pid, 'SIGUSR2');
+  setTimeout(function() {
+    fs.readdirSync(common.tmpDir).forEach(function(name) {
+      if (/^heap-\d+-\d+\.heapsnapshot$/.test(name)) {
+        fs.unlinkSync(path.join(common.tmpDir, name));
+        signalled = true;
+      }
+    });
+    profiler.snapshotOnSignal(false);
+  }, 500);
+} else {
+  signalled = true;
+}
+
+process.on('exit', function() {
+  assert.ok(recorded);
+  assert.ok(signalled);
+});
@@ -208,3 +208,33 @@ assert.equal(0xd8, b[17]);
 assert.equal(0xa2, b[18]);
 assert.equal(0xe6, b[19]);
 
+
+
+// parse() and unescape() decode natively; they must agree with the generic
+// JS versions, which a custom unescape function falls back to.
+var nativeUnescape = qs.unescape;
+function jsUnescape(s, decodeSpaces) {
+  return qs.unescapeBuffer(s, decodeSpaces).toString();
+}
+[
+  '', 'a', 'a=b', 'a=b=c', '=', '&', 'a&&b', 'a&', '&a', 'a=1&a=2&a=3',
+  'a+b=c+d', '%', '%4', '%41', '%4g', '%g1', '%%41', '%+', 'x%', 'x%4',
+  '%e2%82%ac=%E2%82%AC', '%e2%82=%ff', 'é=€',
+  '__proto__=1&a=2', 'hasOwnProperty=1&hasOwnProperty=2', 'toString=x'
+].forEach(function(s) {
+  assert.equal(nativeUnescape(s, true), jsUnescape(s, true));
+  assert.equal(nativeUnescape(s, false), jsUnescape(s, false));
+
+  var actual = qs.parse(s);
+  var actualSep = qs.parse(s, '=&', '+');
+  qs.unescape = jsUnescape;
+  var expected = qs.parse(s);
+  var expectedSep = qs.parse(s, '=&', '+');
+  qs.unescape = nativeUnescape;
+
+  assert.deepEqual(actual, expected);
+  assert.deepEqual(Object.keys(actual), Object.keys(expected));
+  assert.deepEqual(actualSep, expectedSep);
+});
+assert.equal(Object.getPrototypeOf(qs.parse('__proto__=1')),
+             Object.prototype);
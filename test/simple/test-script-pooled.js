@@ -0,0 +1,82 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var vm = require('vm');
+
+common.globalCheck = false;
+
+common.debug('run a string');
+assert.equal('passed', vm.runInPooledContext('\'passed\';'));
+
+common.debug('pass values in and out');
+var sandbox = { foo: 0, baz: 3 };
+vm.runInPooledContext('foo = 1; bar = 2; if (baz !== 3) throw new Error();',
+                      sandbox);
+assert.equal(1, sandbox.foo);
+assert.equal(2, sandbox.bar);
+
+common.debug('globals do not outlive a run');
+for (var i = 0; i < 10; i++) {
+  assert.equal('undefined', vm.runInPooledContext('var v = 1; w = 2; ' +
+                                                  'typeof foo + typeof x',
+                                                  { x: i }).slice(0, 9));
+  assert.equal('undefined undefined',
+               vm.runInPooledContext('typeof v + " " + typeof w'));
+}
+
+common.debug('replaced and deleted globals come back');
+vm.runInPooledContext('Math = 1; delete JSON; undefined = 2');
+assert.equal('function object',
+             vm.runInPooledContext('typeof Math.max + " " + typeof JSON'));
+assert.equal(true, vm.runInPooledContext('undefined === void 0'));
+
+common.debug('thrown errors');
+assert.throws(function() {
+  vm.runInPooledContext('leaked = 1; throw new Error(\'test\');');
+}, /test/);
+assert.throws(function() {
+  vm.runInPooledContext('leaked = ;');
+}, SyntaxError);
+assert.equal('undefined', vm.runInPooledContext('typeof leaked'));
+
+common.debug('nested runs');
+var inner = vm.runInPooledContext('outer = 1; f()', {
+  f: function() { return vm.runInPooledContext('typeof outer'); }
+});
+assert.equal('undefined', inner);
+
+common.debug('precompiled script');
+var script = vm.createScript('count += 1; name = "kitty"', 'pooled.vm');
+sandbox = { count: 2 };
+for (var i = 0; i < 10; i++) script.runInPooledContext(sandbox);
+assert.equal(12, sandbox.count);
+assert.equal('kitty', sandbox.name);
+
+common.debug('accessors and circular references');
+sandbox = {
+  get getter() { return 'ok'; }
+};
+sandbox.self = sandbox;
+assert.deepEqual(['ok', true],
+                 vm.runInPooledContext('[getter, self === this]', sandbox));
@@ -0,0 +1,58 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var spawn = require('child_process').spawn;
+
+if (process.argv[2] === 'child') {
+  // Typed array constructors are built the first time they are used. One
+  // assigned to before that keeps the script's value.
+  Uint16Array = 'mine';
+  assert.equal(typeof Int8Array, 'function');
+  assert.equal(Uint16Array, 'mine');
+  assert.ok(new Float64Array(2) instanceof Float64Array);
+  Uint8Array = 42;
+  assert.equal(Uint8Array, 42);
+  return;
+}
+
+var env = {};
+for (var k in process.env) env[k] = process.env[k];
+env.NODE_TRACE_STARTUP = '1';
+
+var child = spawn(process.execPath, [__filename, 'child'], { env: env });
+var stderr = '';
+child.stderr.setEncoding('utf8');
+child.stderr.on('data', function(data) {
+  stderr += data;
+});
+
+child.on('exit', function(code) {
+  assert.equal(code, 0, stderr);
+  var match = /^startup: (.*)$/m.exec(stderr);
+  assert.ok(match, stderr);
+  var list = match[1].split(', ');
+  assert.notEqual(list.indexOf('NativeModule module'), -1);
+  // stdio and timers must not be set up before the main script asks.
+  assert.equal(list.indexOf('NativeModule tty'), -1);
+  assert.equal(list.indexOf('Binding timer_wrap'), -1);
+});
@@ -0,0 +1,71 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// With NODE_STDIO_BUFFER set, stdout output arrives complete and in order,
+// whether the child exits normally, through process.exit() or by throwing.
+
+var common = require('../common');
+var assert = require('assert');
+var spawn = require('child_process').spawn;
+
+var LINES = 1000;
+
+var scripts = {
+  normal: 'for (var i = 0; i < ' + LINES + '; i++) console.log(i);',
+  exit: 'for (var i = 0; i < ' + LINES + '; i++) console.log(i);' +
+        'process.on("exit", function() { console.log("exit"); });' +
+        'process.exit(3);',
+  'throw': 'for (var i = 0; i < ' + LINES + '; i++) console.log(i);' +
+           'throw new Error("boom");'
+};
+
+var expected = [];
+for (var i = 0; i < LINES; i++) expected.push(i);
+expected = expected.join('\n') + '\n';
+
+var done = 0;
+
+function run(name, code, output) {
+  var env = {};
+  for (var k in process.env) env[k] = process.env[k];
+  env.NODE_STDIO_BUFFER = '4096';
+
+  var child = spawn(process.execPath, ['-e', scripts[name]], { env: env });
+  var out = '';
+  child.stdout.setEncoding('utf8');
+  child.stdout.on('data', function(d) {
+    out += d;
+  });
+  child.on('exit', function(exitCode) {
+    assert.equal(exitCode, code, name);
+    assert.equal(out, output, name);
+    done++;
+  });
+}
+
+run('normal', 0, expected);
+run('exit', 3, expected + 'exit\n');
+run('throw', 1, expected);
+
+process.on('exit', function() {
+  assert.equal(done, 3);
+});
@@ -0,0 +1,76 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Flags: --expose_gc
+
+// Slabs used for socket reads should be handed back to the slab pool once
+// the data read into them has been garbage collected.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+var getSlabPoolStats = process.binding('tcp_wrap').getSlabPoolStats;
+
+var chunk = new Buffer(64 * 1024);
+var rounds = 0;
+var before = getSlabPoolStats();
+
+function pump(cb) {
+  var server = net.createServer(function(socket) {
+    var received = 0;
+    socket.on('data', function(d) {
+      received += d.length;
+    });
+    socket.on('end', function() {
+      assert.equal(4 * 1024 * 1024, received);
+      server.close();
+    });
+  });
+
+  server.listen(common.PORT, function() {
+    var client = net.createConnection(common.PORT);
+    client.on('connect', function() {
+      for (var i = 0; i < 64; i++) client.write(chunk);
+      client.end();
+    });
+  });
+
+  server.on('close', cb);
+}
+
+function round() {
+  pump(function() {
+    rounds++;
+    gc();
+    if (rounds < 3) round();
+  });
+}
+
+round();
+
+process.on('exit', function() {
+  var stats = getSlabPoolStats();
+  assert.equal(3, rounds);
+  assert.ok(stats.misses > before.misses);
+  assert.ok(stats.hits > before.hits);
+  assert.ok(stats.pooled >= 0);
+  assert.ok(stats.bytesResident > 0);
+});
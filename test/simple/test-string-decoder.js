@@ -82,3 +82,26 @@ for (var j = 2; j < buffer.length; j++) {
 }
 console.log(' crayon!');
 
+
+// Long input around the split characters, written one byte at a time and in
+// two pieces split at every offset.
+var text = new Array(40).join('x') + 'é€😀' +
+           new Array(100).join('y') + '中';
+buffer = new Buffer(text);
+
+decoder = new StringDecoder('utf8');
+var out = '';
+for (var i = 0; i < buffer.length; i++) {
+  out += decoder.write(buffer.slice(i, i + 1));
+}
+assert.equal(out, text);
+
+for (var i = 0; i <= buffer.length; i++) {
+  decoder = new StringDecoder('utf8');
+  out = decoder.write(buffer.slice(0, i)) + decoder.write(buffer.slice(i));
+  assert.equal(out, text);
+}
+
+assert.throws(function() {
+  new StringDecoder('utf8').write('not a buffer');
+}, TypeError);
@@ -0,0 +1,72 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var order = [];
+
+// Immediates run in order, with their arguments, after ticks.
+setImmediate(function(a, b) {
+  assert.equal(a, 'a');
+  assert.equal(b, 'b');
+  order.push('immediate 1');
+
+  // Queued while the batch runs: waits for the next iteration, but the
+  // tick queued here runs before it.
+  setImmediate(function() {
+    order.push('immediate 3');
+  });
+  process.nextTick(function() {
+    order.push('tick 2');
+  });
+}, 'a', 'b');
+
+var cleared = setImmediate(function() {
+  assert.fail('cleared immediate ran');
+});
+
+setImmediate(function() {
+  order.push('immediate 2');
+});
+
+clearImmediate(cleared);
+
+process.nextTick(function() {
+  order.push('tick 1');
+});
+
+// Many immediates, queued from one another, yield to I/O between batches.
+var n = 0;
+var timerRan = false;
+function spin() {
+  if (++n < 100000 && !timerRan) setImmediate(spin);
+}
+setImmediate(spin);
+setTimeout(function() {
+  timerRan = true;
+}, 1);
+
+process.on('exit', function() {
+  assert.deepEqual(order, ['tick 1', 'immediate 1', 'tick 2',
+                           'immediate 2', 'immediate 3']);
+  assert.ok(timerRan);
+});
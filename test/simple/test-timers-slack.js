@@ -0,0 +1,77 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+assert.equal(process.setTimerSlack(50), 0);
+
+var start;
+var batch = 0;
+var fired = [];
+
+function fire(name, after) {
+  return function() {
+    assert.ok(Date.now() - start >= after - 1);
+    fired.push(name + ':' + batch);
+    // anything that runs after this callback is in a later wakeup
+    setImmediate(function() { batch++; });
+  };
+}
+
+// This one fires on a slack boundary, so that the timeouts below all fall
+// before the next.
+setTimeout(function() {
+  start = Date.now();
+
+  setTimeout(fire('a', 10), 10);
+  setTimeout(fire('b', 20), 20);
+  setTimeout(fire('c', 30), 30);
+  setTimeout(fire('precise', 5), 5).precise();
+
+  var interval = setInterval(function() {
+    clearInterval(interval);
+    assert.ok(Date.now() - start >= 29);
+    fired.push('interval');
+  }, 30);
+
+  // A precise interval keeps the period it was given, not the rounded one.
+  var ticks = 0;
+  var preciseInterval = setInterval(function() {
+    if (++ticks < 4) return;
+    clearInterval(preciseInterval);
+    var elapsed = Date.now() - start;
+    assert.ok(elapsed >= 4 * 15 - 1, elapsed);
+    assert.ok(elapsed < 4 * 50, elapsed);
+    fired.push('precise interval');
+  }, 15).precise();
+
+  assert.equal(process.setTimerSlack(0), 50);
+}, 1);
+
+process.on('exit', function() {
+  // the precise timeout ran first and by itself, the others together
+  assert.equal(fired[0], 'precise:0');
+  assert.deepEqual(fired.filter(function(name) {
+    return name !== 'interval' && name !== 'precise interval';
+  }).slice(1), ['a:1', 'b:1', 'c:1']);
+  assert.equal(fired.length, 6);
+});
@@ -0,0 +1,90 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var timers = require('timers');
+
+// Many distinct durations share the timing wheel. Each timeout fires once
+// and not before its time.
+(function() {
+  var N = 500;
+  var start = Date.now();
+  var fired = [];
+
+  for (var i = 0; i < N; i++) {
+    (function(msecs) {
+      setTimeout(function() {
+        assert.ok(Date.now() - start >= msecs - 1);
+        fired.push(msecs);
+      }, msecs);
+    })(1 + (i * 7919) % 600);
+  }
+
+  process.on('exit', function() {
+    assert.equal(fired.length, N);
+  });
+})();
+
+// A timeout cleared by the callback of one that fires in the same turn
+// does not run.
+(function() {
+  var a = setTimeout(function() {
+    clearTimeout(b);
+  }, 50);
+  var b = setTimeout(function() {
+    assert.fail('cleared timeout fired');
+  }, 50);
+})();
+
+// active() pushes an idle timeout back without it firing early.
+(function() {
+  var start = Date.now();
+  var last = start;
+  var ncalled = 0;
+  var item = {
+    _onTimeout: function() {
+      assert.ok(Date.now() - last >= 99);
+      ncalled++;
+    }
+  };
+
+  timers.enroll(item, 100);
+  timers.active(item);
+
+  var iv = setInterval(function() {
+    last = Date.now();
+    timers.active(item);
+    if (last - start >= 250) clearInterval(iv);
+  }, 20);
+
+  process.on('exit', function() {
+    assert.equal(ncalled, 1);
+  });
+})();
+
+// Timeouts beyond the reach of the wheel are added again for the rest.
+(function() {
+  var t = setTimeout(assert.fail, Math.pow(2, 33));
+  setTimeout(function() {
+    clearTimeout(t);
+  }, 10);
+})();
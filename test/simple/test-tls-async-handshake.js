@@ -0,0 +1,83 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+// With asyncHandshake the key exchange runs on the thread pool; a burst of
+// clients must still all complete and see their new sessions reported.
+
+var common = require('../common');
+var assert = require('assert');
+var tls = require('tls');
+var fs = require('fs');
+
+var CLIENTS = 20;
+
+var options = {
+  key: fs.readFileSync(common.fixturesDir + '/keys/agent1-key.pem'),
+  cert: fs.readFileSync(common.fixturesDir + '/keys/agent1-cert.pem'),
+  asyncHandshake: true
+};
+
+var secured = 0;
+var echoed = 0;
+var newSessions = 0;
+
+var server = tls.createServer(options, function(c) {
+  secured++;
+  c.pipe(c);
+});
+
+// A session store turns tickets off, so sessions are created while the
+// handshake runs on the thread pool and must be reported afterwards.
+server.on('newSession', function(id, session) {
+  assert.ok(Buffer.isBuffer(session));
+  newSessions++;
+});
+
+server.on('resumeSession', function(id, callback) {
+  callback(null, null);
+});
+
+server.listen(common.PORT, function() {
+  for (var i = 0; i < CLIENTS; i++) connect(i);
+});
+
+function connect(i) {
+  var client = tls.connect(common.PORT, function() {
+    client.write('hello ' + i);
+  });
+  client.setEncoding('utf8');
+  client.on('data', function(d) {
+    assert.equal(d, 'hello ' + i);
+    client.end();
+    if (++echoed === CLIENTS) server.close();
+  });
+}
+
+process.on('exit', function() {
+  assert.equal(secured, CLIENTS);
+  assert.equal(echoed, CLIENTS);
+  assert.equal(newSessions, CLIENTS);
+});
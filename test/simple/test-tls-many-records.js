@@ -0,0 +1,72 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Data written in many small records and in a few large ones must come
+// through the connection's buffers intact and in order.
+
+var common = require('../common');
+var assert = require('assert');
+var tls = require('tls');
+var fs = require('fs');
+var crypto = require('crypto');
+
+var options = {
+  key: fs.readFileSync(common.fixturesDir + '/keys/agent2-key.pem'),
+  cert: fs.readFileSync(common.fixturesDir + '/keys/agent2-cert.pem')
+};
+
+var payload = new Buffer(3 * 1024 * 1024 + 17);
+for (var i = 0; i < payload.length; i++) payload[i] = (i * 7 + (i >> 11)) & 0xff;
+var expected = crypto.createHash('sha1').update(payload).digest('hex');
+
+// Odd sizes so records straddle the buffers inside the connection.
+var sizes = [1, 7, 333, 4096, 16385, 65537, 300000];
+
+var server = tls.Server(options, function(socket) {
+  var off = 0;
+  var n = 0;
+  while (off < payload.length) {
+    var size = sizes[n++ % sizes.length];
+    socket.write(payload.slice(off, Math.min(off + size, payload.length)));
+    off += size;
+  }
+  socket.end();
+});
+
+var received = 0;
+var sha1 = crypto.createHash('sha1');
+
+server.listen(common.PORT, function() {
+  var client = tls.connect(common.PORT);
+  client.on('data', function(d) {
+    received += d.length;
+    sha1.update(d);
+  });
+  client.on('end', function() {
+    server.close();
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(received, payload.length);
+  assert.equal(sha1.digest('hex'), expected);
+});
@@ -0,0 +1,95 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+// Many small writes in one tick go out as one TLS record when the stream
+// coalesces them, and as one record each when it doesn't.
+
+var common = require('../common');
+var assert = require('assert');
+var tls = require('tls');
+var fs = require('fs');
+
+var WRITES = 200;
+
+var options = {
+  key: fs.readFileSync(common.fixturesDir + '/keys/agent1-key.pem'),
+  cert: fs.readFileSync(common.fixturesDir + '/keys/agent1-cert.pem')
+};
+
+var encrypted = {};
+var received = {};
+
+var server = tls.createServer(options, function(c) {
+  assert.throws(function() { c.setRecordSize(16385); }, RangeError);
+
+  c.setEncoding('utf8');
+  c.once('data', function(mode) {
+    var bytes = 0;
+    c.encrypted.on('data', function(d) {
+      bytes += d.length;
+    });
+    c.on('close', function() {
+      encrypted[mode] = bytes;
+    });
+
+    if (mode === 'coalesced') c.setRecordSize(4096);
+    for (var i = 0; i < WRITES; i++) c.write('x');
+    c.end();
+  });
+});
+
+server.listen(common.PORT, function() {
+  connect('plain', function() {
+    connect('coalesced', function() {
+      server.close();
+    });
+  });
+});
+
+function connect(mode, cb) {
+  var client = tls.connect(common.PORT, function() {
+    client.write(mode);
+  });
+  var data = '';
+  client.setEncoding('utf8');
+  client.on('data', function(d) {
+    data += d;
+  });
+  client.on('end', function() {
+    received[mode] = data;
+    cb();
+  });
+}
+
+process.on('exit', function() {
+  var all = new Array(WRITES + 1).join('x');
+  assert.equal(received.plain, all);
+  assert.equal(received.coalesced, all);
+
+  // Each record has at least a 5 byte header
+  assert.ok(encrypted.plain > WRITES * 5);
+  assert.ok(encrypted.coalesced < WRITES);
+});
@@ -0,0 +1,115 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+// Two independent servers share one session store through the
+// 'newSession' and 'resumeSession' events, the way cluster workers would.
+
+var common = require('../common');
+var assert = require('assert');
+var tls = require('tls');
+var fs = require('fs');
+
+var options = {
+  key: fs.readFileSync(common.fixturesDir + '/keys/agent1-key.pem'),
+  cert: fs.readFileSync(common.fixturesDir + '/keys/agent1-cert.pem')
+};
+
+var store = {};
+var newSessions = 0;
+var lookups = 0;
+var reusedOnServer = [];
+
+function createServer(port, cb) {
+  var server = tls.createServer(options, function(c) {
+    reusedOnServer.push(c.isSessionReused());
+    c.write('ok');
+  });
+
+  server.on('newSession', function(id, session) {
+    assert.ok(Buffer.isBuffer(id));
+    assert.ok(Buffer.isBuffer(session));
+    newSessions++;
+    store[id.toString('hex')] = session;
+  });
+
+  server.on('resumeSession', function(id, callback) {
+    lookups++;
+    // Answer asynchronously, like a real shared store would
+    setTimeout(function() {
+      callback(null, store[id.toString('hex')] || null);
+    }, 10);
+  });
+
+  server.listen(port, cb);
+  return server;
+}
+
+function connect(port, session, cb) {
+  var client = tls.connect(port, { session: session }, function() {
+    var reused = client.isSessionReused();
+    var session = client.getSession();
+    client.setEncoding('utf8');
+    client.on('data', function(d) {
+      assert.equal(d, 'ok');
+      client.end();
+    });
+    client.on('end', function() {
+      cb(reused, session);
+    });
+  });
+}
+
+var serverA = createServer(common.PORT, function() {
+  var serverB = createServer(common.PORT + 1, function() {
+    var serverC = createServer(common.PORT + 2, function() {
+      // A fresh client has nothing to resume
+      connect(common.PORT, undefined, function(reused, session) {
+        assert.equal(reused, false);
+        assert.ok(session);
+
+        // The session negotiated with A is picked up by B from the store
+        connect(common.PORT + 1, session, function(reused) {
+          assert.equal(reused, true);
+
+          // Unknown sessions fall back to a full handshake
+          store = {};
+          connect(common.PORT + 2, session, function(reused) {
+            assert.equal(reused, false);
+            serverA.close();
+            serverB.close();
+            serverC.close();
+          });
+        });
+      });
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.deepEqual(reusedOnServer, [false, true, false]);
+  assert.equal(lookups, 2);
+  assert.equal(newSessions, 2);
+});
@@ -0,0 +1,101 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+// Servers with identical options and shareContext use one OpenSSL context,
+// so they also share its session cache and ticket keys.
+
+var common = require('../common');
+var assert = require('assert');
+var tls = require('tls');
+var fs = require('fs');
+
+var options = {
+  key: fs.readFileSync(common.fixturesDir + '/keys/agent1-key.pem'),
+  cert: fs.readFileSync(common.fixturesDir + '/keys/agent1-cert.pem'),
+  shareContext: true
+};
+
+var reusedOnServer = [];
+
+function createServer(port, options, cb) {
+  var server = tls.createServer(options, function(c) {
+    reusedOnServer.push(c.isSessionReused());
+    c.write('ok');
+  });
+  server.listen(port, cb);
+  return server;
+}
+
+function connect(port, session, cb) {
+  var reused, established;
+  var client = tls.connect(port, { session: session }, function() {
+    reused = client.isSessionReused();
+    established = client.getSession();
+  });
+  client.setEncoding('utf8');
+  client.on('data', function(d) {
+    assert.equal(d, 'ok');
+    client.end();
+  });
+  client.on('end', function() {
+    cb(reused, established);
+  });
+}
+
+var unshared = {
+  key: options.key,
+  cert: options.cert
+};
+
+var serverA = createServer(common.PORT, options, function() {
+  var serverB = createServer(common.PORT + 1, options, function() {
+    var serverC = createServer(common.PORT + 2, unshared, function() {
+      // Shared contexts can't take per-server ticket keys
+      assert.throws(function() {
+        serverA.setTicketKeys(new Buffer(48));
+      }, /shared/);
+
+      connect(common.PORT, undefined, function(reused, session) {
+        assert.equal(reused, false);
+
+        connect(common.PORT + 1, session, function(reused) {
+          assert.equal(reused, true);
+
+          connect(common.PORT + 2, session, function(reused) {
+            assert.equal(reused, false);
+            serverA.close();
+            serverB.close();
+            serverC.close();
+          });
+        });
+      });
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.deepEqual(reusedOnServer, [false, true, false]);
+});
@@ -0,0 +1,71 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Data emitted by TLS streams is cut from a shared slab, in slices of
+// exactly the size that was read.
+
+var common = require('../common');
+var assert = require('assert');
+var tls = require('tls');
+var fs = require('fs');
+
+var options = {
+  key: fs.readFileSync(common.fixturesDir + '/keys/agent2-key.pem'),
+  cert: fs.readFileSync(common.fixturesDir + '/keys/agent2-cert.pem')
+};
+
+var messages = ['first', 'second', 'third'];
+var chunks = [];
+
+var server = tls.Server(options, function(socket) {
+  socket.on('data', function(d) {
+    // Echo one message at a time so each arrives in its own chunk.
+    socket.write(messages[chunks.length]);
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = tls.connect(common.PORT, function() {
+    client.write('go');
+  });
+  client.on('data', function(d) {
+    chunks.push(d);
+    if (chunks.length === messages.length) {
+      client.end();
+      server.close();
+    } else {
+      client.write('more');
+    }
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(chunks.length, messages.length);
+  for (var i = 0; i < chunks.length; i++) {
+    assert.equal(chunks[i].toString(), messages[i]);
+    assert.equal(chunks[i].length, messages[i].length);
+  }
+  // Consecutive small reads share one slab rather than a 64K buffer each.
+  assert.ok(chunks[0].parent === chunks[1].parent);
+  assert.ok(chunks[1].parent === chunks[2].parent);
+  assert.ok(chunks[1].offset >= chunks[0].offset + chunks[0].length);
+});
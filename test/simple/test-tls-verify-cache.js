@@ -0,0 +1,89 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+// A server with verifyCacheTTL remembers client chains that verified, and
+// forgets them when a CRL is added.
+
+var common = require('../common');
+var assert = require('assert');
+var tls = require('tls');
+var fs = require('fs');
+
+function loadPEM(n) {
+  return fs.readFileSync(common.fixturesDir + '/keys/' + n + '.pem');
+}
+
+var authorized = [];
+
+var server = tls.createServer({
+  key: loadPEM('agent2-key'),
+  cert: loadPEM('agent2-cert'),
+  ca: [loadPEM('ca2-cert')],
+  requestCert: true,
+  verifyCacheTTL: 60 * 1000
+}, function(c) {
+  authorized.push(c.authorized);
+  c.end('ok');
+});
+
+function connect(cb) {
+  var client = tls.connect(common.PORT, {
+    key: loadPEM('agent4-key'),
+    cert: loadPEM('agent4-cert')
+  });
+  client.on('data', function() {});
+  client.on('end', cb);
+}
+
+assert.deepEqual(server.getVerifyCacheStats(),
+                 { size: 0, hits: 0, misses: 0 });
+
+server.listen(common.PORT, function() {
+  connect(function() {
+    assert.deepEqual(server.getVerifyCacheStats(),
+                     { size: 1, hits: 0, misses: 1 });
+
+    connect(function() {
+      assert.deepEqual(server.getVerifyCacheStats(),
+                       { size: 1, hits: 1, misses: 1 });
+
+      // agent4 is revoked by ca2-crl
+      server.addCRL(loadPEM('ca2-crl'));
+      assert.equal(server.getVerifyCacheStats().size, 0);
+
+      connect(function() {
+        var stats = server.getVerifyCacheStats();
+        assert.equal(stats.size, 0);
+        assert.equal(stats.misses, 2);
+        server.close();
+      });
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.deepEqual(authorized, [true, true, false]);
+});
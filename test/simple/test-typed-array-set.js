@@ -0,0 +1,97 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+function values(a) {
+  return Array.prototype.slice.call(a);
+}
+
+// Between types, elements convert as if stored one by one.
+var f64 = new Float64Array([1.5, -1.5, 300, -129, 4294967297, NaN, Infinity]);
+assert.deepEqual(values(new Int8Array(f64)), [1, -1, 44, 127, 1, 0, 0]);
+assert.deepEqual(values(new Uint8Array(f64)), [1, 255, 44, 127, 1, 0, 0]);
+assert.deepEqual(values(new Uint32Array(f64)),
+                 [1, 4294967295, 300, 4294967167, 1, 0, 0]);
+
+var i16 = new Int16Array([-1, 2, -32768]);
+assert.deepEqual(values(new Float32Array(i16)), [-1, 2, -32768]);
+assert.deepEqual(values(new Uint16Array(i16)), [65535, 2, 32768]);
+
+var f32 = new Float32Array(5);
+f32.set(new Uint32Array([0xffffffff, 7]), 1);
+assert.deepEqual(values(f32), [0, 4294967296, 7, 0, 0]);
+
+// Plain arrays skip the indexed setter but convert the same way.
+var u8 = new Uint8Array(4);
+u8.set([257, -1, '3', 2.9], 0);
+assert.deepEqual(values(u8), [1, 255, 3, 2]);
+assert.throws(function() { u8.set([1, 2], 3); }, RangeError);
+
+// Overlapping views of one ArrayBuffer of different types.
+var ab = new ArrayBuffer(8);
+var bytes = new Uint8Array(ab);
+var words = new Uint16Array(ab, 0, 2);
+bytes.set([1, 2, 3, 4]);
+var expected = [1, 2, words[0] & 255, words[1] & 255, 0, 0, 0, 0];
+bytes.set(words, 2);
+assert.deepEqual(values(bytes), expected);
+
+// Buffers are sources of bytes.
+var buf = new Buffer([1, 2, 255]);
+assert.deepEqual(values(new Int16Array(buf)), [1, 2, 255]);
+var i32 = new Int32Array(4);
+i32.set(buf, 1);
+assert.deepEqual(values(i32), [0, 1, 2, 255]);
+
+// With a byte offset a typed array views the memory of a Buffer.
+var data = new Buffer(16);
+data.fill(0);
+var view = new Uint32Array(data, 4, 2);
+assert.equal(view.length, 2);
+assert.equal(view.byteOffset, 4);
+view[0] = 0x01020304;
+assert.deepEqual(values(data.slice(4, 8)).sort(), [1, 2, 3, 4]);
+data[12] = 9;
+assert.equal(new Uint8Array(data, 12)[0], 9);
+assert.equal(new Float64Array(data, 8).length, 1);
+
+assert.throws(function() { new Uint32Array(data, 2); }, RangeError);
+assert.throws(function() { new Uint32Array(data.slice(1), 0); }, RangeError);
+assert.throws(function() { new Uint32Array(data, 4, 4); }, RangeError);
+
+// A source whose length property claims more elements than its memory holds
+// is read element by element past its end, not beyond its allocation.
+var spoofed = new Buffer([7, 8]);
+spoofed.length = 100000;
+var copy = new Uint8Array(spoofed);
+assert.equal(copy.length, 100000);
+assert.equal(copy[0], 7);
+assert.equal(copy[1], 8);
+assert.equal(copy[2], 0);
+assert.equal(copy[99999], 0);
+var target = new Float64Array(100001);
+target.set(spoofed, 1);
+assert.equal(target[1], 7);
+assert.equal(target[2], 8);
+assert.ok(isNaN(target[100000]));
+assert.deepEqual(values(new Int16Array({ length: 3 })), [0, 0, 0]);
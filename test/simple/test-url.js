@@ -522,6 +522,22 @@ for (var u in parseTestsWithQueryString) {
   assert.deepEqual(actual, expected);
 }
 
+// Plain request paths take a shortcut in url.parse(). The result must be
+// the same as from the general parser, which slashesDenoteHost forces.
+var pathTests = [
+  '/', '/a', '/foo/bar?baz=quux', '/?', '/#', '/?#', '/a#b?c', '/a?b#c?d',
+  '/a?x=1&y=2&x=3', '/{}|^~[]\\', '/%zz', '/a;b', '/a@b', '/a?',
+  "/a'b", '/a b', '/a\tb', '/a<b>'
+];
+pathTests.forEach(function(u) {
+  [false, true].forEach(function(parseQueryString) {
+    var actual = url.parse(u, parseQueryString),
+        expected = url.parse(u, parseQueryString, true);
+    assert.deepEqual(actual, expected);
+    assert.deepEqual(Object.keys(actual), Object.keys(expected));
+  });
+});
+
 // some extra formatting tests, just to verify
 // that it'll format slightly wonky content to a valid url.
 var formatTests = {
@@ -0,0 +1,93 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// util.inspect() formats primitives and flat objects and arrays natively
+// unless colors or showHidden are on. The results must be those of
+// lib/util.js.
+
+var common = require('../common');
+var assert = require('assert');
+var util = require('util');
+
+[
+  ['a', "'a'"],
+  ["it's", "'it\\'s'"],
+  ['q"uote', "'q\"uote'"],
+  ['back\\slash"\'', "'back\\\\slash\"\\''"],
+  ['\u0001\u001f\n\t\b\f\r\u007f é中',
+   "'\\u0001\\u001f\\n\\t\\b\\f\\r\u007f é中'"],
+  [-0, '0'],
+  [1.5e300, '1.5e+300'],
+  [NaN, 'NaN'],
+  [true, 'true'],
+  [null, 'null'],
+  [undefined, 'undefined'],
+  [{}, '{}'],
+  [[], '[]'],
+  [{ a: 1, b: 'x' }, "{ a: 1, b: 'x' }"],
+  [{ 'a-b': 1, '1': 2, _x: 3, '': 4, "o'k": 5, 'é': 6 },
+   "{ '1': 2, 'a-b': 1, _x: 3, '': 4, 'o\\'k': 5, 'é': 6 }"],
+  [[1, 'two', null, undefined, false],
+   "[ 1, 'two', null, undefined, false ]"],
+  // Entries over 60 characters in all go on lines of their own.
+  [{ aaaaaaaaaa: 1, bbbbbbbbbbb: 2, ccccccccccccc: 3, dddddddddd: 4, eeeee: 5 },
+   '{ aaaaaaaaaa: 1,\n  bbbbbbbbbbb: 2,\n  ccccccccccccc: 3,\n' +
+   '  dddddddddd: 4,\n  eeeee: 5 }'],
+  [{ aaaaaaaaaa: 1, bbbbbbbbbbb: 2, ccccccccccccc: 3, dddddddd: 4 },
+   '{ aaaaaaaaaa: 1, bbbbbbbbbbb: 2, ccccccccccccc: 3, dddddddd: 4 }'],
+  [{ s: 'line\nbreak', nested: { a: [1, 2] } },
+   "{ s: 'line\\nbreak', nested: { a: [ 1, 2 ] } }"]
+].forEach(function(test) {
+  assert.equal(util.inspect(test[0]), test[1]);
+});
+
+// What the native code leaves to lib/util.js.
+var getter = { b: 2 };
+getter.__defineGetter__('a', function() { return 1; });
+assert.equal(util.inspect(getter), '{ b: 2, a: [Getter] }');
+
+var hole = [1, 2, 3];
+delete hole[1];
+assert.equal(util.inspect(hole), '[ 1, , 3 ]');
+
+var named = [1, 2];
+named.extra = true;
+assert.equal(util.inspect(named), '[ 1, 2, extra: true ]');
+
+assert.equal(util.inspect({ a: 1, inspect: function() { return 'custom'; } }),
+             'custom');
+assert.equal(util.inspect(function named() {}), '[Function: named]');
+
+// Cycles are left to lib/util.js.
+var cycle = { a: 1 };
+cycle.self = cycle;
+assert.equal(util.inspect(cycle), '{ a: 1, self: [Circular] }');
+
+// format() replaces only while there are arguments.
+assert.equal(util.format('%s %d %j %% %x', 'a', '42', { b: [1] }, 'rest'),
+             'a 42 {"b":[1]} % %x rest');
+assert.equal(util.format('%s %%', 'a'), 'a %%');
+assert.equal(util.format('%s:', 'a', 1, null, { c: 'd' }, [1]),
+             "a: 1 null { c: 'd' } [ 1 ]");
+assert.throws(function() {
+  util.format('%s', { toString: function() { throw new Error('boom'); } });
+}, /boom/);
@@ -0,0 +1,125 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var util = require('util');
+
+
+// Every split of the text gives what JSON.parse() gives.
+var texts = [
+  '{"a":[1,-0,2.5e3,true,false,null,"x\\n\\u00e9\\ud83d\\ude00"],"b":{}}',
+  ' [ 12345678901234567890 , -1.5E-3, 0, "éè😀" ] ',
+  '"\\"quoted\\" \\\\ \\/ \\b\\f\\r\\t"',
+  '{"__proto__": 1, "0": "zero", "k": {"k": {"k": []}}}',
+  '42',
+  'null'
+];
+
+texts.forEach(function(text) {
+  var buffer = new Buffer(text, 'utf8');
+  var expected = JSON.parse(text);
+  for (var size = 1; size <= buffer.length; size++) {
+    var parser = new util.JSONParser();
+    for (var i = 0; i < buffer.length; i += size) {
+      parser.write(buffer.slice(i, Math.min(i + size, buffer.length)));
+    }
+    var value = parser.end();
+    assert.deepEqual(value, expected);
+    assert.strictEqual(JSON.stringify(value), JSON.stringify(expected));
+  }
+});
+
+// Own properties, even __proto__, like JSON.parse().
+var object = new util.JSONParser().end('{"__proto__": {"x": 1}}');
+assert.ok(Object.prototype.hasOwnProperty.call(object, '__proto__'));
+assert.strictEqual(object.x, undefined);
+
+// -0 survives.
+assert.strictEqual(1 / new util.JSONParser().end('-0'), -Infinity);
+
+// A parser can be used again after end().
+var parser = new util.JSONParser();
+parser.write('[1');
+assert.deepEqual(parser.end(']'), [1]);
+assert.deepEqual(parser.end('{"a":2}'), { a: 2 });
+
+// Errors.
+['{', '[1,]', '{"a" 1}', '01', '"\\x"', '"\u0001"', 'tru', 'truth', '1 2',
+ '{"a":1}}', '', '-', '1.', '1e'].forEach(function(text) {
+  assert.throws(function() {
+    var parser = new util.JSONParser();
+    for (var i = 0; i < text.length; i++) parser.write(text.charAt(i));
+    parser.end();
+  }, SyntaxError);
+});
+
+parser = new util.JSONParser();
+assert.throws(function() { parser.write('[}'); }, SyntaxError);
+assert.throws(function() { parser.write(']'); }, /earlier write/);
+
+
+// IncomingMessage#readJSON().
+var body = { list: [], text: new Array(5000).join('é') };
+for (var i = 0; i < 1000; i++) body.list.push({ id: i, ok: i % 2 === 0 });
+
+var responses = 0;
+
+var server = http.createServer(function(req, res) {
+  req.readJSON(function(err, value) {
+    if (req.url === '/bad') {
+      assert.ok(err instanceof SyntaxError);
+    } else {
+      assert.equal(err, null);
+      assert.deepEqual(value, body);
+    }
+    res.end(JSON.stringify({ url: req.url }));
+  });
+});
+
+server.listen(common.PORT, function() {
+  function post(path, data) {
+    var req = http.request({
+      port: common.PORT,
+      method: 'POST',
+      path: path
+    }, function(res) {
+      res.readJSON(function(err, value) {
+        assert.equal(err, null);
+        assert.deepEqual(value, { url: path });
+        if (++responses === 2) server.close();
+      });
+    });
+    // In many small writes, so that the body comes in pieces.
+    for (var i = 0; i < data.length; i += 1000) {
+      req.write(data.slice(i, i + 1000));
+    }
+    req.end();
+  }
+
+  post('/good', JSON.stringify(body));
+  post('/bad', JSON.stringify(body).slice(0, -1) + ']');
+});
+
+process.on('exit', function() {
+  assert.equal(responses, 2);
+});
@@ -0,0 +1,73 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var vm = require('vm');
+
+common.globalCheck = false;
+
+common.debug('same code, different contexts');
+var code = 'typeof tenant === "undefined" ? "none" : tenant.name';
+for (var i = 0; i < 5; i++) {
+  var context = vm.createContext({ tenant: { name: 't' + i } });
+  assert.equal('t' + i, vm.runInContext(code, context));
+  assert.equal('n' + i, vm.runInNewContext(code, { tenant: { name: 'n' + i } }));
+}
+assert.equal('none', vm.runInNewContext(code));
+
+common.debug('code compiled for one context does not keep its globals');
+var a = vm.createContext({});
+var b = vm.createContext({});
+vm.runInContext('var counter = 0;', a);
+vm.runInContext('var counter = 100;', b);
+for (var i = 0; i < 3; i++) {
+  vm.runInContext('counter++', a);
+  vm.runInContext('counter++', b);
+}
+assert.equal(3, a.counter);
+assert.equal(103, b.counter);
+
+common.debug('the filename is part of the key');
+['first.vm', 'second.vm'].forEach(function(filename) {
+  try {
+    vm.runInNewContext('throw new Error("x")', {}, filename);
+    assert.fail('no error');
+  } catch (e) {
+    assert.ok(e.stack.indexOf(filename) !== -1, e.stack);
+  }
+});
+
+common.debug('more code than the cache holds');
+for (var i = 0; i < 200; i++) {
+  assert.equal(i * 2, vm.runInNewContext(i + ' * n', { n: 2 }));
+}
+for (var i = 0; i < 200; i++) {
+  assert.equal(i * 3, vm.runInNewContext(i + ' * n', { n: 3 }));
+}
+
+common.debug('syntax errors are not cached');
+for (var i = 0; i < 2; i++) {
+  assert.throws(function() {
+    vm.runInNewContext('var = ;');
+  }, SyntaxError);
+}
@@ -0,0 +1,145 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var websocket = require('websocket');
+
+
+function collect(options) {
+  var parser = new websocket.Parser(options);
+  parser.messages = [];
+  parser.onmessage = function(opcode, payload) {
+    parser.messages.push([opcode, payload.toString()]);
+  };
+  return parser;
+}
+
+
+// Header encodings.
+assert.deepEqual(websocket.frame(websocket.TEXT, 'hi'),
+                 new Buffer([0x81, 2, 0x68, 0x69]));
+assert.deepEqual(websocket.frame(websocket.PING, null, { fin: true }),
+                 new Buffer([0x89, 0]));
+assert.deepEqual(websocket.frame(websocket.BINARY, 'x', { fin: false }),
+                 new Buffer([0x02, 1, 0x78]));
+var key = new Buffer([1, 2, 3, 4]);
+assert.deepEqual(websocket.frame(websocket.TEXT, 'abcde', { mask: key }),
+                 new Buffer([0x81, 0x85, 1, 2, 3, 4,
+                             0x61 ^ 1, 0x62 ^ 2, 0x63 ^ 3, 0x64 ^ 4, 0x65 ^ 1]));
+var f = websocket.frame(websocket.BINARY, new Buffer(126));
+assert.equal(f.length, 4 + 126);
+assert.equal(f[1], 126);
+assert.equal(f.readUInt16BE(2), 126);
+f = websocket.frame(websocket.BINARY, new Buffer(65536));
+assert.equal(f.length, 10 + 65536);
+assert.equal(f[1], 127);
+assert.equal(f.readUInt32BE(2), 0);
+assert.equal(f.readUInt32BE(6), 65536);
+assert.equal(websocket.frame(websocket.TEXT, 'x', { mask: true })[1], 0x81);
+
+
+// mask() against a byte at a time, for all alignments and lengths.
+for (var start = 0; start < 9; start++) {
+  for (var len = 0; len < 70; len++) {
+    var buf = new Buffer(start + len + 3);
+    for (var i = 0; i < buf.length; i++) buf[i] = (i * 7) & 0xff;
+    var expected = new Buffer(buf.length);
+    buf.copy(expected);
+    for (i = 0; i < len; i++) expected[start + i] ^= key[i & 3];
+    websocket.mask(buf, key, start, start + len);
+    assert.deepEqual(buf, expected);
+  }
+}
+
+
+// Masked frames of every length class, whole and a byte at a time.
+var payloads = ['', 'a', 'hello world', new Array(200).join('x'),
+                new Array(70000).join('yz')];
+var stream = Buffer.concat(payloads.map(function(p) {
+  return websocket.frame(websocket.TEXT, p, { mask: true });
+}));
+
+var parser = collect({ requireMask: true });
+var copy = new Buffer(stream.length);
+stream.copy(copy);
+assert.equal(parser.execute(copy), null);
+assert.deepEqual(parser.messages, payloads.map(function(p) {
+  return [websocket.TEXT, p];
+}));
+
+parser = collect({ requireMask: true });
+stream.copy(copy);
+for (i = 0; i < 300; i++) assert.equal(parser.execute(copy, i, i + 1), null);
+assert.equal(parser.execute(copy, 300), null);
+assert.deepEqual(parser.messages, payloads.map(function(p) {
+  return [websocket.TEXT, p];
+}));
+
+
+// A fragmented message with a ping between its fragments.
+parser = collect();
+assert.equal(parser.execute(Buffer.concat([
+  websocket.frame(websocket.TEXT, 'frag', { fin: false }),
+  websocket.frame(websocket.PING, 'p'),
+  websocket.frame(websocket.CONTINUATION, 'men', { fin: false }),
+  websocket.frame(websocket.CONTINUATION, 'ted'),
+  websocket.frame(websocket.BINARY, 'next')
+])), null);
+assert.deepEqual(parser.messages, [[websocket.PING, 'p'],
+                                   [websocket.TEXT, 'fragmented'],
+                                   [websocket.BINARY, 'next']]);
+
+
+// Protocol errors.
+function parseError(bytes, options) {
+  var parser = collect(options);
+  var err = parser.execute(bytes);
+  assert.ok(err instanceof Error);
+  assert.throws(function() { parser.execute(bytes); });
+  parser.reset();
+  return err;
+}
+
+var err = parseError(Buffer.concat([websocket.frame(websocket.TEXT, 'ok'),
+                                    new Buffer([0xc1, 0])]));
+assert.equal(err.reason, 'reserved bits set');
+assert.equal(err.closeCode, 1002);
+assert.equal(err.bytesParsed, 4);
+
+assert.equal(parseError(new Buffer([0x83, 0])).reason, 'unknown opcode');
+assert.equal(parseError(new Buffer([0x80, 0])).reason,
+             'unexpected continuation frame');
+assert.equal(parseError(new Buffer([0x01, 0, 0x81, 0])).reason,
+             'expected continuation frame');
+assert.equal(parseError(new Buffer([0x09, 0])).reason,
+             'fragmented control frame');
+assert.equal(parseError(websocket.frame(websocket.PING, new Buffer(126)))
+             .reason, 'control frame too long');
+assert.equal(parseError(websocket.frame(websocket.TEXT, 'x'),
+                        { requireMask: true }).reason, 'unmasked frame');
+
+err = parseError(Buffer.concat([
+  websocket.frame(websocket.TEXT, 'abc', { fin: false }),
+  websocket.frame(websocket.CONTINUATION, 'def')
+]), { maxPayload: 5 });
+assert.equal(err.reason, 'message too big');
+assert.equal(err.closeCode, 1009);
@@ -0,0 +1,55 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var zlib = require('zlib');
+
+var before = process.uvCounters();
+assert.equal(typeof before.work_batch, 'number');
+assert.equal(typeof before.work_batch_limited, 'number');
+assert.equal(typeof before.work_batched, 'object');
+['other', 'fs', 'zlib', 'crypto'].forEach(function(type) {
+  assert.equal(typeof before.work_batched[type], 'number');
+});
+
+// Thread pool completions are run in batches and counted by kind.
+var N = 100;
+var pending = N;
+var input = new Buffer(1024);
+input.fill(42);
+
+for (var i = 0; i < N; i++) {
+  zlib.deflate(input, function(err, result) {
+    assert.ifError(err);
+    assert.ok(result.length > 0);
+    if (--pending === 0) {
+      setTimeout(check, 10);
+    }
+  });
+}
+
+function check() {
+  var after = process.uvCounters();
+  assert.ok(after.work_batched.zlib - before.work_batched.zlib >= N);
+  assert.ok(after.work_batch > before.work_batch);
+  assert.equal(after.work_batched.crypto, before.work_batched.crypto);
+}
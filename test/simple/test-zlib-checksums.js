@@ -0,0 +1,70 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var zlib = require('zlib');
+
+assert.strictEqual(zlib.crc32('123456789'), 0xcbf43926);
+assert.strictEqual(zlib.crc32c('123456789'), 0xe3069283);
+assert.strictEqual(zlib.adler32('123456789'), 0x091e01de);
+
+assert.strictEqual(zlib.crc32(''), 0);
+assert.strictEqual(zlib.crc32c(new Buffer(0)), 0);
+assert.strictEqual(zlib.adler32(''), 1);
+
+// Strings are UTF-8.
+assert.strictEqual(zlib.crc32('héllo'), 0x9e3b8236);
+
+// RFC 3720 test vectors.
+var zeros = new Buffer(32);
+zeros.fill(0);
+var ones = new Buffer(32);
+ones.fill(0xff);
+assert.strictEqual(zlib.crc32c(zeros), 0x8a9136aa);
+assert.strictEqual(zlib.crc32c(ones), 0x62a8ab43);
+
+// Continuing a checksum.
+assert.strictEqual(zlib.crc32('world', zlib.crc32('hello ')), 0x0d4a1185);
+assert.strictEqual(zlib.crc32c('world', zlib.crc32c('hello ')), 0xc99465aa);
+assert.strictEqual(zlib.adler32('world', zlib.adler32('hello ')),
+                   zlib.adler32('hello world'));
+
+// Every alignment and length gives the same result in one go and in two
+// pieces, whichever code path handles it.
+var data = new Buffer(1000);
+for (var i = 0; i < data.length; i++) data[i] = (i * 31 + 7) & 0xff;
+for (var start = 0; start < 9; start++) {
+  for (var len = 0; len < 40; len++) {
+    var piece = data.slice(start, start + len);
+    var half = len >> 1;
+    ['crc32', 'crc32c', 'adler32'].forEach(function(name) {
+      var whole = zlib[name](piece);
+      var split = zlib[name](piece.slice(half),
+                             zlib[name](piece.slice(0, half)));
+      assert.strictEqual(whole, split);
+    });
+  }
+}
+assert.strictEqual(zlib.crc32c(data.slice(3)),
+                   zlib.crc32c(data.slice(503), zlib.crc32c(data.slice(3, 503))));
+
+assert.throws(function() { zlib.crc32(123); }, TypeError);
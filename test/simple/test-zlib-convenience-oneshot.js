@@ -0,0 +1,101 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// zlib convenience methods compress and decompress in one request.
+
+var common = require('../common');
+var assert = require('assert');
+var zlib = require('zlib');
+var fs = require('fs');
+var path = require('path');
+
+var big = fs.readFileSync(path.join(common.fixturesDir, 'person.jpg'));
+// Compresses well, so inflate has to grow its output buffer.
+var repetitive = new Buffer(1024 * 1024);
+repetitive.fill(0x61);
+
+var pairs = [
+  ['deflate', 'inflate'],
+  ['gzip', 'gunzip'],
+  ['deflateRaw', 'inflateRaw'],
+  ['gzip', 'unzip']
+];
+
+var done = 0;
+var expected = 0;
+
+pairs.forEach(function(pair) {
+  [new Buffer(0), new Buffer('hello'), big, repetitive].forEach(
+      function(input) {
+        expected++;
+        zlib[pair[0]](input, function(err, compressed) {
+          assert.equal(err, null);
+          assert.ok(Buffer.isBuffer(compressed));
+          // Same bytes as the synchronous version.
+          assert.equal(compressed.toString('hex'),
+                       zlib[pair[0] + 'Sync'](input).toString('hex'));
+          zlib[pair[1]](compressed, function(err, output) {
+            assert.equal(err, null);
+            assert.equal(output.length, input.length);
+            assert.equal(output.toString('hex'), input.toString('hex'));
+            done++;
+          });
+        });
+      });
+});
+
+// Results are Buffers, with the methods of one.
+expected++;
+zlib.gunzip(zlib.gzipSync('hello world'), function(err, output) {
+  assert.equal(err, null);
+  assert.ok(output instanceof Buffer);
+  assert.equal(output.toString(), 'hello world');
+  assert.equal(output.slice(6).toString(), 'world');
+  done++;
+});
+
+expected++;
+zlib.inflate(new Buffer('not deflate data'), function(err, output) {
+  assert.ok(/Z_DATA_ERROR/.test(err.message));
+  assert.equal(output, undefined);
+  done++;
+});
+
+expected++;
+var deflated = zlib.deflateSync(big);
+zlib.inflate(deflated.slice(0, deflated.length >> 1), function(err) {
+  assert.ok(/unexpected end of input/.test(err.message));
+  done++;
+});
+
+expected++;
+var sync = true;
+zlib.gzip(42, function(err) {
+  assert.ok(!sync);
+  assert.ok(err instanceof Error);
+  done++;
+});
+sync = false;
+
+process.on('exit', function() {
+  assert.equal(done, expected);
+});
@@ -0,0 +1,110 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Preset dictionaries for deflate and inflate.
+
+var common = require('../common');
+var assert = require('assert');
+var zlib = require('zlib');
+
+var dictionary = new Buffer('{"type":"event","level":"info","host":' +
+                            '"web-","timestamp":"2011-11-","message":"' +
+                            'request handled in ms","status":200}');
+
+function message(i) {
+  return new Buffer(JSON.stringify({
+    type: 'event',
+    level: 'info',
+    host: 'web-' + (i % 4),
+    timestamp: '2011-11-' + (10 + i % 20) + 'T12:00:00Z',
+    message: 'request handled in ' + i + 'ms',
+    status: 200
+  }));
+}
+
+var opts = { dictionary: dictionary };
+var plainSize = 0;
+var dictSize = 0;
+
+for (var i = 0; i < 20; i++) {
+  var input = message(i);
+  var plain = zlib.deflateSync(input);
+  var withDict = zlib.deflateSync(input, opts);
+  plainSize += plain.length;
+  dictSize += withDict.length;
+
+  assert.equal(zlib.inflateSync(withDict, opts).toString(), input.toString());
+  assert.equal(zlib.unzipSync(withDict, opts).toString(), input.toString());
+
+  var raw = zlib.deflateRawSync(input, opts);
+  assert.equal(zlib.inflateRawSync(raw, opts).toString(), input.toString());
+}
+
+assert.ok(dictSize * 2 < plainSize,
+          'dictionary should help: ' + dictSize + ' vs ' + plainSize);
+
+// A reused, reset stream still gets the dictionary.
+var again = zlib.deflateSync(message(0), opts);
+assert.equal(again.toString('hex'),
+             zlib.deflateSync(message(0), opts).toString('hex'));
+
+assert.throws(function() {
+  zlib.inflateSync(zlib.deflateSync(message(1), opts));
+}, /Missing dictionary/);
+
+assert.throws(function() {
+  zlib.inflateSync(zlib.deflateSync(message(1), opts),
+                   { dictionary: new Buffer('something else') });
+}, /Z_DATA_ERROR/);
+
+assert.throws(function() {
+  zlib.createGzip({ dictionary: dictionary });
+}, /dictionary/);
+
+assert.throws(function() {
+  zlib.createDeflate({ dictionary: 'not a buffer' });
+}, /Invalid dictionary/);
+
+// Streams, through the thread pool.
+var deflate = zlib.createDeflate({ dictionary: dictionary, inlineSize: 0 });
+var inflate = zlib.createInflate({ dictionary: dictionary, inlineSize: 0 });
+var output = [];
+inflate.on('data', function(chunk) {
+  output.push(chunk.toString());
+});
+var ended = false;
+inflate.on('end', function() {
+  ended = true;
+});
+deflate.pipe(inflate);
+
+var expected = '';
+for (var i = 0; i < 10; i++) {
+  expected += message(i).toString();
+  deflate.write(message(i));
+}
+deflate.end();
+
+process.on('exit', function() {
+  assert.ok(ended);
+  assert.equal(output.join(''), expected);
+});
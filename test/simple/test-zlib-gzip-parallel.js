@@ -0,0 +1,104 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// zlib.gzip() with { parallel: true } splits the input into blocks that are
+// deflated concurrently, and must still produce one valid gzip stream.
+
+var common = require('../common');
+var assert = require('assert');
+var zlib = require('zlib');
+var fs = require('fs');
+var path = require('path');
+
+var jpg = fs.readFileSync(path.join(common.fixturesDir, 'person.jpg'));
+
+// Text repeating across block boundaries, so the dictionaries matter.
+var lines = [];
+for (var i = 0; i < 20000; i++) {
+  lines.push('line ' + (i % 97) + ' of the export ' + (i % 13));
+}
+var text = new Buffer(lines.join('\n'));
+
+var inputs = [
+  new Buffer(0),
+  new Buffer('hello'),
+  jpg,
+  text,
+  // exactly two blocks
+  text.slice(0, 64 * 1024)
+];
+
+var done = 0;
+var expected = 0;
+
+inputs.forEach(function(input) {
+  expected++;
+  var opts = { parallel: true, blockSize: 32 * 1024 };
+  zlib.gzip(input, opts, function(err, gz) {
+    assert.equal(err, null);
+    assert.equal(gz[0], 0x1f);
+    assert.equal(gz[1], 0x8b);
+
+    // One member: gunzip reads it, and so does the streaming Gunzip.
+    var out = zlib.gunzipSync(gz);
+    assert.equal(out.toString('hex'), input.toString('hex'));
+
+    // Priming with the previous block keeps the size close to serial.
+    var serial = zlib.gzipSync(input);
+    assert.ok(gz.length <= serial.length * 1.05 + 64,
+              gz.length + ' vs ' + serial.length);
+
+    var gunzip = zlib.createGunzip();
+    var chunks = [];
+    gunzip.on('data', function(c) { chunks.push(c.toString('hex')); });
+    gunzip.on('end', function() {
+      assert.equal(chunks.join(''), input.toString('hex'));
+      done++;
+    });
+    gunzip.end(gz);
+  });
+});
+
+expected++;
+zlib.gzip(text, { parallel: true, level: 1 }, function(err, gz) {
+  assert.equal(err, null);
+  assert.ok(gz instanceof Buffer);
+  assert.equal(gz.slice(0, 2).toString('hex'), '1f8b');
+  // And back through the one-shot gunzip.
+  zlib.gunzip(gz, function(err, out) {
+    assert.equal(err, null);
+    assert.equal(out.toString(), text.toString());
+    done++;
+  });
+});
+
+assert.throws(function() {
+  zlib.gzip(text, { parallel: true, blockSize: 1024 }, function() {});
+}, /Invalid block size/);
+
+assert.throws(function() {
+  zlib.gzip(text, { parallel: true, level: 42 }, function() {});
+}, /Invalid compression level/);
+
+process.on('exit', function() {
+  assert.equal(done, expected);
+});
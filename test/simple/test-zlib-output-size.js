@@ -0,0 +1,94 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// The convenience methods inflate into a buffer of the expected size, or
+// into a given buffer, and still get the whole output when it's larger.
+
+var common = require('../common');
+var assert = require('assert');
+var zlib = require('zlib');
+
+var input = new Buffer(100000);
+for (var i = 0; i < input.length; i++) input[i] = (i * 7) % 251;
+
+var done = 0;
+
+zlib.gzip(input, function(err, compressed) {
+  if (err) throw err;
+
+  // Exact, too small and too large hints.
+  [input.length, 10, input.length * 3, 0].forEach(function(size) {
+    zlib.gunzip(compressed, { outputSize: size }, function(err, result) {
+      if (err) throw err;
+      assert.deepEqual(result, input);
+      done++;
+    });
+  });
+
+  // Into a buffer that is large enough, at an offset of a larger one.
+  var big = new Buffer(input.length + 100);
+  var output = big.slice(50, 50 + input.length + 10);
+  zlib.gunzip(compressed, { output: output }, function(err, result) {
+    if (err) throw err;
+    assert.equal(result.length, input.length);
+    assert.equal(result.parent, big.parent);
+    assert.deepEqual(result, input);
+    done++;
+  });
+
+  // Into one that is too small, which the output outgrows.
+  var small = new Buffer(1000);
+  zlib.gunzip(compressed, { output: small }, function(err, result) {
+    if (err) throw err;
+    assert.notEqual(result.parent, small.parent);
+    assert.deepEqual(result, input);
+    done++;
+  });
+
+  // Compressing into a given buffer works too.
+  zlib.deflate(input, { output: new Buffer(input.length) },
+               function(err, deflated) {
+    if (err) throw err;
+    zlib.inflate(deflated, function(err, result) {
+      if (err) throw err;
+      assert.deepEqual(result, input);
+      done++;
+    });
+  });
+
+  // Errors still come through.
+  zlib.gunzip(compressed.slice(0, 100), { outputSize: input.length },
+              function(err) {
+    assert.ok(err instanceof Error);
+    done++;
+  });
+});
+
+assert.throws(function() {
+  zlib.inflate(new Buffer(1), { output: 'x' }, function() {});
+}, TypeError);
+assert.throws(function() {
+  zlib.inflate(new Buffer(1), { outputSize: -1 }, function() {});
+}, TypeError);
+
+process.on('exit', function() {
+  assert.equal(done, 8);
+});
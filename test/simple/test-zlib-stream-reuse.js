@@ -0,0 +1,86 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Closed zlib streams are reset and reused by later streams with the same
+// settings. Make sure a reused stream behaves like a fresh one.
+
+var common = require('../common');
+var assert = require('assert');
+var zlib = require('zlib');
+var fs = require('fs');
+var path = require('path');
+
+var input = fs.readFileSync(path.join(common.fixturesDir, 'person.jpg'));
+var text = new Buffer(new Array(2000).join('hello zlib '));
+
+// Different settings must not share a stream.
+var fast = zlib.deflateSync(text, { level: 1 });
+var best = zlib.deflateSync(text, { level: 9 });
+var huffman = zlib.deflateSync(text, { strategy: zlib.Z_HUFFMAN_ONLY });
+assert.notEqual(fast.toString('hex'), best.toString('hex'));
+assert.notEqual(huffman.toString('hex'), best.toString('hex'));
+
+for (var i = 0; i < 5; i++) {
+  assert.equal(zlib.deflateSync(text, { level: 1 }).toString('hex'),
+               fast.toString('hex'));
+  assert.equal(zlib.deflateSync(text, { level: 9 }).toString('hex'),
+               best.toString('hex'));
+  assert.equal(zlib.deflateSync(text, { strategy: zlib.Z_HUFFMAN_ONLY })
+                   .toString('hex'),
+               huffman.toString('hex'));
+  assert.equal(zlib.inflateSync(best).toString(), text.toString());
+}
+
+// A stream abandoned halfway leaves nothing behind for the next one.
+var gzipped = zlib.gzipSync(input);
+var partial = zlib.createGzip({ inline: true });
+partial.write(input.slice(0, 1000));
+partial._binding.close();
+
+var gunzip = zlib.createGunzip({ inline: true });
+gunzip.write(gzipped.slice(0, 100));
+gunzip._binding.close();
+
+assert.equal(zlib.gzipSync(input).toString('hex'), gzipped.toString('hex'));
+assert.equal(zlib.gunzipSync(gzipped).toString('hex'), input.toString('hex'));
+
+// Raw, zlib and gzip streams with the same windowBits stay apart too.
+var done = 0;
+zlib.deflateRaw(text, function(err, raw) {
+  assert.equal(err, null);
+  zlib.gzip(text, function(err, gz) {
+    assert.equal(err, null);
+    zlib.inflateRaw(raw, function(err, out) {
+      assert.equal(err, null);
+      assert.equal(out.toString(), text.toString());
+      zlib.unzip(gz, function(err, out) {
+        assert.equal(err, null);
+        assert.equal(out.toString(), text.toString());
+        done++;
+      });
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(done, 1);
+});
@@ -0,0 +1,100 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var zlib = require('zlib');
+var fs = require('fs');
+var path = require('path');
+
+var big = fs.readFileSync(path.join(common.fixturesDir, 'person.jpg'));
+var small = new Buffer('{"hello":"world","list":[1,2,3]}');
+
+var pairs = [
+  ['deflateSync', 'inflateSync'],
+  ['gzipSync', 'gunzipSync'],
+  ['deflateRawSync', 'inflateRawSync'],
+  ['deflateSync', 'unzipSync'],
+  ['gzipSync', 'unzipSync']
+];
+
+pairs.forEach(function(pair) {
+  [small, big].forEach(function(input) {
+    var compressed = zlib[pair[0]](input);
+    assert.ok(Buffer.isBuffer(compressed));
+    var output = zlib[pair[1]](compressed);
+    assert.equal(output.toString('hex'), input.toString('hex'));
+  });
+});
+
+// Strings, options and small chunks.
+var gz = zlib.gzipSync('hello world', { chunkSize: 64, level: 9 });
+assert.equal(zlib.gunzipSync(gz, { chunkSize: 64 }).toString(),
+             'hello world');
+
+// Compatible with the streams.
+zlib.gunzip(zlib.gzipSync(big), function(err, output) {
+  assert.equal(err, null);
+  assert.equal(output.toString('hex'), big.toString('hex'));
+});
+
+assert.throws(function() {
+  zlib.inflateSync(new Buffer('not deflate data'));
+}, /Z_DATA_ERROR/);
+
+assert.throws(function() {
+  var deflated = zlib.deflateSync(big);
+  zlib.inflateSync(deflated.slice(0, deflated.length >> 1));
+}, /unexpected end of input/);
+
+assert.throws(function() {
+  zlib.deflateSync(42);
+}, TypeError);
+
+// Streams processing everything on the main thread, or nothing.
+var ended = 0;
+[{ inline: true }, { inlineSize: 0 }, {}].forEach(function(opts) {
+  var chunks = [];
+  var deflate = zlib.createDeflate(opts);
+  var sync = true;
+  deflate.on('data', function(chunk) {
+    assert.ok(!sync);
+    chunks.push(chunk);
+  });
+  deflate.on('end', function() {
+    var length = 0;
+    chunks.forEach(function(c) { length += c.length; });
+    var all = new Buffer(length);
+    var offset = 0;
+    chunks.forEach(function(c) { c.copy(all, offset); offset += c.length; });
+    assert.equal(zlib.inflateSync(all).toString('hex'),
+                 big.toString('hex') + small.toString('hex'));
+    ended++;
+  });
+  deflate.write(big);
+  deflate.write(small);
+  deflate.end();
+  sync = false;
+});
+
+process.on('exit', function() {
+  assert.equal(ended, 3);
+});
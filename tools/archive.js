@@ -0,0 +1,102 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Makes an application archive for NODE_ARCHIVE, see lib/module.js for the
+// format.
+//
+//   node tools/archive.js archive dir
+//
+// Every file below dir goes in, except hidden ones and addons, which are
+// only recorded so that require() looks for them on disk. Links are
+// followed.
+
+var fs = require('fs');
+var path = require('path');
+
+var MAGIC = 'NODEARC1';
+
+
+function walk(dir, key, entries, files, skip) {
+  fs.readdirSync(dir).sort().forEach(function(name) {
+    if (name.charAt(0) === '.') return;
+
+    var filename = path.join(dir, name);
+    if (path.resolve(filename) === skip) return;
+
+    var entryKey = key ? key + '/' + name : name;
+    var stat = fs.statSync(filename);
+
+    if (stat.isDirectory()) {
+      entries[entryKey] = 1;
+      walk(filename, entryKey, entries, files, skip);
+    } else if (path.extname(name) === '.node') {
+      entries[entryKey] = 0;
+    } else if (stat.isFile()) {
+      files.push({ key: entryKey, filename: filename, size: stat.size });
+    }
+  });
+}
+
+
+function build(archive, dir) {
+  var entries = {};
+  var files = [];
+  var offset = 0;
+
+  // Leave out the archive itself, should it be written into dir.
+  walk(dir, '', entries, files, path.resolve(archive));
+
+  files.forEach(function(file) {
+    entries[file.key] = [offset, file.size];
+    offset += file.size;
+  });
+
+  var index = new Buffer(JSON.stringify(entries), 'utf8');
+  var header = new Buffer(12);
+  header.write(MAGIC, 0, 'ascii');
+  header.writeUInt32LE(index.length, 8);
+
+  var fd = fs.openSync(archive, 'w');
+  try {
+    fs.writeSync(fd, header, 0, header.length, null);
+    fs.writeSync(fd, index, 0, index.length, null);
+    files.forEach(function(file) {
+      var data = fs.readFileSync(file.filename);
+      if (data.length !== file.size) {
+        throw new Error(file.filename + ' changed while archiving it');
+      }
+      if (data.length > 0) fs.writeSync(fd, data, 0, data.length, null);
+    });
+  } finally {
+    fs.closeSync(fd);
+  }
+
+  return files.length;
+}
+
+
+if (process.argv.length !== 4) {
+  console.error('usage: node tools/archive.js archive dir');
+  process.exit(1);
+}
+
+var count = build(process.argv[2], process.argv[3]);
+console.log(process.argv[2] + ': ' + count + ' files');